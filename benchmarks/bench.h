@@ -0,0 +1,144 @@
+/*
+ * The harness for morph_benchmarks. Each case is run in samples, each of as many iterations
+ * as take at least min_sample_s, and the statistics of the time per iteration over the
+ * samples are printed as a table and can be written as JSON, to compare one build (or one
+ * release) with another.
+ */
+#pragma once
+
+#include <morph/running_stats.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstddef>
+
+namespace bench {
+
+    //! Keep the compiler from optimising away the computation of x
+    template <typename T>
+    inline void do_not_optimize (const T& x)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile ("" : : "r,m"(x) : "memory");
+#else
+        static volatile const void* sink = nullptr;
+        sink = &x;
+#endif
+    }
+
+    //! The results of one case
+    struct result
+    {
+        std::string name;
+        //! Iterations per sample
+        std::size_t iterations = 0;
+        //! Time per iteration in ns, over the samples
+        morph::running_stats<double> ns;
+        double median_ns = 0.0;
+        //! Items (elements, hexes, vertices...) processed per iteration, if given
+        double items = 0.0;
+    };
+
+    class suite
+    {
+    public:
+        //! Run only the cases whose names contain filter
+        std::string filter;
+        //! The number of samples per case
+        unsigned int samples = 10;
+        //! The least time that a sample should take
+        double min_sample_s = 0.02;
+        //! If true, list the cases rather than running them
+        bool list_only = false;
+
+        /*!
+         * Time f, which carries out one iteration of the case called name. setup (if given)
+         * is called before each sample, outside the timing. items is the number of items
+         * that an iteration processes, for the throughput.
+         */
+        void run (const std::string& name, const std::function<void()>& f, const double items = 0.0,
+                  const std::function<void()>& setup = nullptr)
+        {
+            if (!this->filter.empty() && name.find (this->filter) == std::string::npos) { return; }
+            if (this->list_only) { std::cout << name << "\n"; return; }
+
+            // Find the number of iterations that take at least min_sample_s
+            if (setup) { setup(); }
+            std::size_t n = 1;
+            for (;;) {
+                const double s = suite::time_s (f, n);
+                if (s >= this->min_sample_s || n >= (std::size_t{1} << 30)) { break; }
+                const double grow = s > 0.0 ? 1.5 * this->min_sample_s / s : 10.0;
+                n = static_cast<std::size_t>(static_cast<double>(n) * std::clamp (grow, 2.0, 100.0));
+            }
+
+            result r;
+            r.name = name;
+            r.iterations = n;
+            r.items = items;
+            std::vector<double> per_iter;
+            for (unsigned int i = 0; i < this->samples; ++i) {
+                if (setup) { setup(); }
+                const double ns = 1e9 * suite::time_s (f, n) / static_cast<double>(n);
+                r.ns.add (ns);
+                per_iter.push_back (ns);
+            }
+            std::sort (per_iter.begin(), per_iter.end());
+            const std::size_t m = per_iter.size() / 2;
+            r.median_ns = per_iter.size() % 2 ? per_iter[m] : 0.5 * (per_iter[m - 1] + per_iter[m]);
+
+            std::cout << std::left << std::setw (56) << r.name << std::right << std::fixed << std::setprecision (1)
+                      << std::setw (14) << r.median_ns << " ns" << std::setw (10) << r.ns.std() << " ns";
+            if (items > 0.0) { std::cout << std::setw (12) << std::setprecision (2) << items / r.median_ns * 1e3 << " M/s"; }
+            std::cout << std::endl;
+            this->results.push_back (r);
+        }
+
+        /*!
+         * The results as json, in the layout of Google Benchmark's --benchmark_format=json
+         * (with real_time the median) so that its compare.py can compare two runs, plus the
+         * spread of the samples: {"context": {...}, "benchmarks": [{"name", "iterations",
+         * "repetitions", "real_time", "mean", "stddev", "min", "max", "time_unit",
+         * "items_per_second"}]}
+         */
+        nlohmann::json to_json (const nlohmann::json& context) const
+        {
+            nlohmann::json j;
+            j["context"] = context;
+            j["benchmarks"] = nlohmann::json::array();
+            for (const result& r : this->results) {
+                nlohmann::json b;
+                b["name"] = r.name;
+                b["run_type"] = "iteration";
+                b["iterations"] = r.iterations;
+                b["repetitions"] = r.ns.count();
+                b["real_time"] = r.median_ns;
+                b["cpu_time"] = r.median_ns;
+                b["mean"] = r.ns.mean();
+                b["stddev"] = r.ns.std();
+                b["min"] = r.ns.min();
+                b["max"] = r.ns.max();
+                b["time_unit"] = "ns";
+                if (r.items > 0.0) { b["items_per_second"] = r.items / r.median_ns * 1e9; }
+                j["benchmarks"].push_back (b);
+            }
+            return j;
+        }
+
+        std::vector<result> results;
+
+    private:
+        static double time_s (const std::function<void()>& f, const std::size_t n)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < n; ++i) { f(); }
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+    };
+
+} // namespace bench
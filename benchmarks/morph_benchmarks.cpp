@@ -0,0 +1,338 @@
+/*
+ * Microbenchmarks of morphologica's hot paths: vvec arithmetic, HexGrid construction, boundary
+ * setup and convolution, RD_Base::compute_laplace, Grid::resample_image, HdfData reads and
+ * writes, FeedForwardNet training, ColourMap conversion and the vertex builds of the main
+ * VisualModels (which need no GL context).
+ *
+ * morph_benchmarks [--filter text] [--json file] [--samples n] [--min-time s] [--list]
+ *
+ * --json writes the results to file in the layout of Google Benchmark's JSON output, for
+ * comparing one build with another. Build in Release mode.
+ */
+
+#include <morph/Visual.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <morph/Random.h>
+#include <morph/HexGrid.h>
+#include <morph/Grid.h>
+#include <morph/RD_Base.h>
+#include <morph/stored_field.h>
+#include <morph/HdfData.h>
+#include <morph/ColourMap.h>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/HexGridVisual.h>
+#include <morph/GridVisual.h>
+#include <morph/ScatterVisual.h>
+#include <morph/QuiverVisual.h>
+#include <morph/version.h>
+
+#include "bench.h"
+
+#include <nlohmann/json.hpp>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <thread>
+#include <ctime>
+#include <cmath>
+#include <cstdlib>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+// A diffusing field, for timing RD_Base's Laplacian
+struct rd_diffuse : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> lapu;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+    }
+    void init() { this->noiseify_vector_variable (this->u, 0.5f, 1.0f); }
+    void step() { this->compute_laplace (this->u, this->lapu); }
+};
+
+// A VisualModel whose vertices can be rebuilt without a GL context
+template <typename M>
+struct vertex_builder : public M
+{
+    using M::M;
+    void rebuild()
+    {
+        this->vertexPositions.clear();
+        this->vertexNormals.clear();
+        this->vertexColors.clear();
+        this->indices.clear();
+        this->idx = 0u;
+        this->initializeVertices();
+    }
+    std::size_t vertices() const { return this->vertexPositions.size() / 3u; }
+};
+
+void bench_vvec (bench::suite& s)
+{
+    constexpr std::size_t n = 1000000;
+    morph::vvec<float> a (n);
+    morph::vvec<float> b (n);
+    morph::vvec<float> c (n);
+    a.randomize();
+    b.randomize();
+    const double items = static_cast<double>(n);
+    s.run ("vvec<float>/sum 1M", [&]() { bench::do_not_optimize (a.sum()); }, items);
+    s.run ("vvec<float>/dot 1M", [&]() { bench::do_not_optimize (a.dot (b)); }, items);
+    s.run ("vvec<float>/max 1M", [&]() { bench::do_not_optimize (a.max()); }, items);
+    s.run ("vvec<float>/c = a + b 1M", [&]() { c = a + b; bench::do_not_optimize (c[0]); }, items);
+    s.run ("vvec<float>/c *= b 1M", [&]() { c *= b; bench::do_not_optimize (c[0]); }, items, [&]() { c = a; });
+    s.run ("vvec<float>/c = a * 2 + b 1M", [&]() { c = a * 2.0f + b; bench::do_not_optimize (c[0]); }, items);
+}
+
+void bench_hexgrid (bench::suite& s)
+{
+    s.run ("HexGrid/construct d=0.01 span=3", []() {
+        morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+        bench::do_not_optimize (hg.num());
+    });
+    s.run ("HexGrid/construct + setCircularBoundary", []() {
+        morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+        hg.setCircularBoundary (0.6f);
+        bench::do_not_optimize (hg.num());
+    });
+    s.run ("HexGrid/construct + setEllipticalBoundary", []() {
+        morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+        hg.setEllipticalBoundary (0.7f, 0.4f);
+        bench::do_not_optimize (hg.num());
+    });
+
+    morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.5f);
+    morph::HexGrid kernel (0.01f, 0.2f, 0.0f);
+    kernel.setCircularBoundary (0.05f);
+    std::vector<float> kerneldata (kernel.num(), 1.0f / static_cast<float>(kernel.num()));
+    std::vector<float> data (hg.num());
+    morph::RandUniform<float> rng;
+    for (auto& d : data) { d = rng.get(); }
+    std::vector<float> result (hg.num(), 0.0f);
+    morph::HexGrid::convolution_table<float> tbl = hg.get_convolution_table (kernel, kerneldata);
+    s.run ("HexGrid/convolve (table) " + std::to_string (hg.num()) + " x " + std::to_string (kernel.num()),
+           [&]() { hg.convolve (tbl, data, result); bench::do_not_optimize (result[0]); }, static_cast<double>(hg.num()));
+    s.run ("HexGrid/get_convolution_table", [&]() {
+        auto t = hg.get_convolution_table (kernel, kerneldata);
+        bench::do_not_optimize (t.rows);
+    });
+}
+
+void bench_rd (bench::suite& s)
+{
+    for (const bool ghost : { false, true }) {
+        rd_diffuse m;
+        m.hextohex_d = 0.005f;
+        m.svgpath = "";
+        m.ghost_stencil = ghost;
+        m.allocate();
+        m.init();
+        s.run (std::string("RD_Base/compute_laplace") + (ghost ? " (ghost stencil) " : " ") + std::to_string (m.nhex) + " hexes",
+               [&m]() { m.step(); bench::do_not_optimize (m.lapu[0]); }, static_cast<double>(m.nhex));
+    }
+
+    // The same Laplacian reading a bfloat16 field, for half the bandwidth
+    rd_diffuse m;
+    m.hextohex_d = 0.005f;
+    m.svgpath = "";
+    m.allocate();
+    m.init();
+    morph::stored_field<morph::bfloat16> ub;
+    ub.store (m.u);
+    s.run (std::string("RD_Base/compute_laplace (bfloat16 field) ") + std::to_string (m.nhex) + " hexes",
+           [&m, &ub]() { m.compute_laplace (ub, m.lapu); bench::do_not_optimize (m.lapu[0]); }, static_cast<double>(m.nhex));
+}
+
+void bench_grid (bench::suite& s)
+{
+    morph::Grid<unsigned int, float> g (150, 150, { 0.01f, 0.01f });
+    constexpr unsigned int img_w = 64;
+    morph::vvec<float> img (img_w * img_w);
+    img.randomize();
+    s.run ("Grid/resample_image 64x64 to 150x150", [&]() {
+        morph::vvec<float> r = g.resample_image (img, img_w, { 1.5f, 1.5f }, { 0.0f, 0.0f });
+        bench::do_not_optimize (r[0]);
+    }, static_cast<double>(g.n()));
+}
+
+void bench_hdf (bench::suite& s)
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "morph_benchmarks.h5").string();
+    constexpr std::size_t n = 1000000;
+    std::vector<float> v (n);
+    morph::RandUniform<float> rng;
+    for (auto& x : v) { x = rng.get(); }
+    const double bytes = static_cast<double>(n * sizeof (float));
+    s.run ("HdfData/write 1M floats (items are bytes)", [&]() {
+        morph::HdfData d (path, morph::FileAccess::TruncateWrite);
+        d.add_contained_vals ("/v", v);
+    }, bytes);
+    std::vector<float> r;
+    s.run ("HdfData/read 1M floats (items are bytes)", [&]() {
+        morph::HdfData d (path, morph::FileAccess::ReadOnly);
+        d.read_contained_vals ("/v", r);
+        bench::do_not_optimize (r[0]);
+    }, bytes);
+    std::filesystem::remove (path);
+}
+
+void bench_nn (bench::suite& s)
+{
+    constexpr std::size_t ns = 512;
+    morph::nn::FeedForwardNet<float> ff (std::vector<unsigned int>{ 64, 32, 10 });
+    std::vector<morph::vvec<float>> ins (ns, morph::vvec<float>(64));
+    std::vector<morph::vvec<float>> outs (ns, morph::vvec<float>(10, 0.0f));
+    for (std::size_t i = 0; i < ns; ++i) {
+        ins[i].randomize();
+        outs[i][i % 10] = 1.0f;
+    }
+    s.run ("FeedForwardNet/train_parallel epoch 512 x (64-32-10)", [&]() {
+        bench::do_not_optimize (ff.train_parallel (ins, outs, 32, 0.1f));
+    }, static_cast<double>(ns));
+}
+
+void bench_colourmap (bench::suite& s)
+{
+    constexpr std::size_t n = 100000;
+    std::vector<float> data (n);
+    morph::RandUniform<float> rng;
+    for (auto& d : data) { d = rng.get(); }
+    std::vector<float> rgb (3 * n);
+    morph::ColourMap<float> cm (morph::ColourMapType::Plasma);
+    s.run ("ColourMap/convert Plasma 100k", [&]() {
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::array<float, 3> c = cm.convert (data[i]);
+            rgb[3 * i] = c[0];
+            rgb[3 * i + 1] = c[1];
+            rgb[3 * i + 2] = c[2];
+        }
+        bench::do_not_optimize (rgb[0]);
+    }, static_cast<double>(n));
+    morph::ColourMap<float> cml (morph::ColourMapType::Plasma);
+    cml.setLutSize (1024);
+    s.run ("ColourMap/convert_batch Plasma 100k (1024 lut)", [&]() {
+        cml.convert_batch (data, rgb.data());
+        bench::do_not_optimize (rgb[0]);
+    }, static_cast<double>(n));
+}
+
+void bench_visuals (bench::suite& s)
+{
+    const morph::vec<float> offset = { 0.0f, 0.0f, 0.0f };
+    morph::RandUniform<float> rng;
+
+    morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+    std::vector<float> hdata (hg.num());
+    for (auto& d : hdata) { d = rng.get(); }
+    vertex_builder<morph::HexGridVisual<float>> hgv (&hg, offset);
+    hgv.setScalarData (&hdata);
+    hgv.rebuild();
+    s.run ("HexGridVisual/vertices " + std::to_string (hg.num()) + " hexes (items are vertices)",
+           [&]() { hgv.rebuild(); }, static_cast<double>(hgv.vertices()));
+
+    morph::Grid<unsigned int, float> g (256, 256, { 0.01f, 0.01f });
+    std::vector<float> gdata (g.n());
+    for (auto& d : gdata) { d = rng.get(); }
+    vertex_builder<morph::GridVisual<float>> gv (&g, offset);
+    gv.setScalarData (&gdata);
+    gv.rebuild();
+    s.run ("GridVisual/vertices 256x256 (items are vertices)", [&]() { gv.rebuild(); }, static_cast<double>(gv.vertices()));
+
+    constexpr std::size_t np = 2000;
+    std::vector<morph::vec<float>> coords (np);
+    std::vector<float> sdata (np);
+    std::vector<morph::vec<float, 3>> quivers (np);
+    for (std::size_t i = 0; i < np; ++i) {
+        coords[i] = { rng.get(), rng.get(), rng.get() };
+        quivers[i] = { rng.get() - 0.5f, rng.get() - 0.5f, rng.get() - 0.5f };
+        sdata[i] = rng.get();
+    }
+    vertex_builder<morph::ScatterVisual<float>> sv (offset);
+    sv.setDataCoords (&coords);
+    sv.setScalarData (&sdata);
+    sv.radiusFixed = 0.01f;
+    sv.rebuild();
+    s.run ("ScatterVisual/vertices 2000 spheres (items are vertices)", [&]() { sv.rebuild(); }, static_cast<double>(sv.vertices()));
+
+    vertex_builder<morph::QuiverVisual<float>> qv (&coords, offset, &quivers, morph::ColourMapType::Viridis);
+    qv.rebuild();
+    s.run ("QuiverVisual/vertices 2000 quivers (items are vertices)", [&]() { qv.rebuild(); }, static_cast<double>(qv.vertices()));
+}
+
+int main (int argc, char** argv)
+{
+    bench::suite s;
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--filter" && i + 1 < argc) {
+            s.filter = argv[++i];
+        } else if (a == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (a == "--samples" && i + 1 < argc) {
+            s.samples = static_cast<unsigned int>(std::max (1, std::atoi (argv[++i])));
+        } else if (a == "--min-time" && i + 1 < argc) {
+            s.min_sample_s = std::atof (argv[++i]);
+        } else if (a == "--list") {
+            s.list_only = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter text] [--json file] [--samples n] [--min-time s] [--list]\n";
+            return 1;
+        }
+    }
+
+    try {
+        bench_vvec (s);
+        bench_hexgrid (s);
+        bench_rd (s);
+        bench_grid (s);
+        bench_hdf (s);
+        bench_nn (s);
+        bench_colourmap (s);
+        bench_visuals (s);
+    } catch (const std::exception& e) {
+        std::cerr << "morph_benchmarks: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!json_path.empty() && !s.list_only) {
+        nlohmann::json context;
+        const std::time_t now = std::time (nullptr);
+        char date[32];
+        std::strftime (date, sizeof (date), "%Y-%m-%dT%H:%M:%S", std::localtime (&now));
+        context["date"] = date;
+        context["executable"] = argv[0];
+        context["morphologica_version"] = morph::version_string();
+        context["num_cpus"] = std::thread::hardware_concurrency();
+#ifdef _OPENMP
+        context["omp_threads"] = omp_get_max_threads();
+#endif
+#if defined(__clang__)
+        context["compiler"] = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+        context["compiler"] = std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+        context["compiler"] = "msvc " + std::to_string (_MSC_VER);
+#endif
+#ifdef NDEBUG
+        context["library_build_type"] = "release";
+#else
+        context["library_build_type"] = "debug";
+#endif
+        std::ofstream f (json_path);
+        if (!f.is_open()) { std::cerr << "morph_benchmarks: Can't write " << json_path << std::endl; return 1; }
+        f << s.to_json (context).dump (2) << "\n";
+    }
+    return 0;
+}
@@ -106,6 +106,9 @@ public:
         this->resize_vector_vector (this->poiss, this->N);
         this->sum_n.resize (this->N, Flt{0});
         this->sum_c.resize (this->N, Flt{0});
+        // The densities and concentrations are the state to save in a checkpoint
+        this->checkpoint_var ("n", this->n);
+        this->checkpoint_var ("c", this->c);
 
         // Initialise with noise
         Flt noiseamp = Flt{0.1};
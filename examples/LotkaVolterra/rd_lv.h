@@ -46,6 +46,9 @@ public:
         // a member of this class (via its parent, RD_Base)
         this->resize_vector_variable (this->u);
         this->resize_vector_variable (this->v);
+        // u and v are the state to save in a checkpoint
+        this->checkpoint_var ("u", this->u);
+        this->checkpoint_var ("v", this->v);
     }
 
     //! Initialise variables and parameters and do any one-time computations
@@ -3,6 +3,7 @@
 #include <vector>
 #include <deque>
 #include <morph/vec.h>
+#include <morph/cell_list.h>
 
 // A retinotectal axon branch class. Holds current and historical positions, a preferred
 // termination zone, and the algorithm for computing the next position. Could derive
@@ -10,9 +11,12 @@
 template<typename T>
 struct branch
 {
-    // Compute the next position for this branch, using information from all other
-    // branches and the parameters vector, m
-    void compute_next (const std::vector<branch<T>>& branches, const morph::vec<T, 4>& m)
+    // Compute the next position for this branch, using information from the other
+    // branches and the parameters vector, m. Only branches closer than two_r interact, so
+    // these are found with cells, a cell_list of the current branch locations (in the same
+    // order as branches).
+    void compute_next (const std::vector<branch<T>>& branches, const morph::cell_list<T, 2>& cells,
+                       const morph::vec<T, 4>& m)
     {
         // Current location is named b
         morph::vec<T, 2> b = path.back();
@@ -25,7 +29,12 @@ struct branch
         morph::vec<T, 2> nullvec = {0, 0}; // null vector
         // Other branches are called k, making a set B_b, with a number of members that I call n_k
         T n_k = T{0};
-        for (auto k : branches) {
+        // The neighbours come back in index order, so C and I are summed in the same order
+        // as in a loop over all the branches. One list per thread, reused from step to step.
+        thread_local std::vector<unsigned int> near;
+        cells.within (b, this->two_r, near);
+        for (unsigned int ki : near) {
+            const branch<T>& k = branches[ki];
             if (k.id == this->id) { continue; } // Don't interact with self
             // Paper deals with U_C(b,k) - the vector from branch b to branch k - and
             // sums these. However, that gives a competition term with a sign error. So
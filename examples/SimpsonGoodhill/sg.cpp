@@ -11,6 +11,7 @@
 #include <memory>
 
 #include <morph/vec.h>
+#include <morph/cell_list.h>
 #include <morph/CartGrid.h>
 #include <morph/Config.h>
 #include <morph/Random.h>
@@ -65,10 +66,14 @@ struct SimpsonGoodhill
 
     void step()
     {
+        // Bin the current branch locations so that each branch need only look at its near
+        // neighbours
+        for (unsigned int i = 0; i < this->branches.size(); ++i) { this->locations[i] = this->branches[i].path.back(); }
+        this->cells.build (this->locations, branch<T>::two_r);
         // Compute the next position for each branch:
-#pragma omp parallel for
+#pragma omp parallel for schedule(dynamic, 64)
         for (unsigned int i = 0; i < this->branches.size(); ++i) {
-            this->branches[i].compute_next (this->branches, this->m);
+            this->branches[i].compute_next (this->branches, this->cells, this->m);
         }
         // Update centroids
         for (unsigned int i = 0; i < this->retina->num(); ++i) { this->ax_centroids.p[i] = {T{0}, T{0}, T{0}}; }
@@ -98,6 +103,7 @@ struct SimpsonGoodhill
         this->retina->setBoundaryOnOuterEdge();
         std::cout << "Retina has " << this->retina->num() << " cells\n";
         this->branches.resize(this->retina->num() * bpa);
+        this->locations.resize (this->branches.size());
 
         std::cout << "Retina is " << this->retina->widthnum() << " wide and " << this->retina->depthnum() << " high\n";
         this->ax_centroids.init (this->retina->widthnum(), this->retina->depthnum());
@@ -201,6 +207,9 @@ struct SimpsonGoodhill
     morph::vec<T,2> centre = { T{0.5}, T{0.5} }; // FIXME get from CartGrid
     // (rgcside^2 * bpa) branches, as per the paper
     std::vector<branch<T>> branches;
+    // The current location of each branch, and the cell list made from them each step
+    std::vector<morph::vec<T, 2>> locations;
+    morph::cell_list<T, 2> cells;
     // Centroid of the branches for each axon
     net<T> ax_centroids;
     // A visual environment
@@ -21,8 +21,13 @@ int main()
     v.fov = 15.0f;
     v.zFar = 200.0f;
     v.lightingEffects();
+    // Show where the frame time goes: GPU time, draw calls and buffer uploads
+    v.profiling = true;
+    v.show_profile = true;
     morph::VisualTextModel<>* fps_tm;
     v.addLabel ("0 FPS", {0.13f, -0.23f, 0.0f}, fps_tm); // With fps_tm can update the VisualTextModel with fps_tm->setupText("new text")
+    // Make the FPS label updatable, so that updateText rewrites only the glyphs that change
+    fps_tm->reserve (96);
 
     // Create a HexGrid to show in the scene
     morph::HexGrid hg(0.02f, 15.0f, 0.0f);
@@ -101,7 +106,7 @@ int main()
             rest_fps = std::max (rest_fps, std::round((((double)fcount/rest_tau))*1000.0));
             std::stringstream ss;
             ss << "FPS: " << data_fps << " [dat] " << update_fps << " [upd] " << rest_fps << " [rest] " << all_fps << " [all]\n";
-            fps_tm->setupText (ss.str());
+            fps_tm->updateText (ss.str());
             data_dur = sc::duration{0};
             update_dur = sc::duration{0};
             all_dur = sc::duration{0};
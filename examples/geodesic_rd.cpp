@@ -0,0 +1,82 @@
+/*
+ * The Gray-Scott reaction-diffusion system on the surface of a sphere, on a
+ * morph::GeodesicGrid. GeodesicVisual::setGrid draws the grid's own vertices, so the field b
+ * is copied into the visual's data as it is.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <cmath>
+
+#include <morph/vec.h>
+#include <morph/mathconst.h>
+#include <morph/Visual.h>
+#include <morph/GeodesicGrid.h>
+#include <morph/GeodesicVisual.h>
+
+int main()
+{
+    morph::Visual v(1024, 1024, "Gray-Scott on a morph::GeodesicGrid");
+
+    // 40962 elements. The radius makes the elements about 1 apart, the usual spacing for these
+    // parameters.
+    constexpr unsigned int iterations = 6;
+    const float radius = std::sqrt (static_cast<float>(10 * (1 << (2 * iterations)) + 2) / (4.0f * morph::mathconst<float>::pi));
+    morph::GeodesicGrid<float> gg (iterations, radius);
+
+    // a is 1 everywhere and b is 0, but for a few spots scattered over the sphere
+    std::vector<float> a (gg.n(), 1.0f);
+    std::vector<float> b (gg.n(), 0.0f);
+    const morph::vec<float, 3> spots[4] = { { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 }, { -0.6f, 0.6f, -0.5f } };
+    for (std::size_t i = 0; i < gg.n(); ++i) {
+        const morph::vec<float, 3> c = gg.coord (i) / radius;
+        for (const morph::vec<float, 3>& s : spots) {
+            if ((c - s / s.length()).length() < 0.1f) { b[i] = 1.0f; }
+        }
+    }
+
+    auto gv = std::make_unique<morph::GeodesicVisual<float>> (morph::vec<float, 3>{ 0.0f, 0.0f, 0.0f }, 1.0f);
+    v.bindmodel (gv);
+    gv->setGrid (gg);
+    gv->radius = 1.0f; // Draw on the unit sphere, whatever the grid's radius
+    gv->cm.setType (morph::ColourMapType::Twilight);
+    gv->colourScale.do_autoscale = false;
+    gv->colourScale.compute_scaling (0.0f, 0.5f);
+    gv->finalize();
+    auto gvp = v.addVisualModel (gv);
+
+    morph::VisualTextModel<>* info_tm;
+    v.addLabel ("", { -1.0f, -1.3f, 0.0f }, info_tm);
+
+    constexpr float Da = 0.2f;
+    constexpr float Db = 0.1f;
+    constexpr float F = 0.055f;
+    constexpr float k = 0.062f;
+    constexpr float dt = 1.0f;
+    std::vector<float> lapa, lapb;
+    unsigned int step = 0;
+    while (!v.readyToFinish) {
+        for (int s = 0; s < 20; ++s, ++step) {
+            gg.laplacian (a, lapa);
+            gg.laplacian (b, lapb);
+            for (std::size_t i = 0; i < gg.n(); ++i) {
+                const float abb = a[i] * b[i] * b[i];
+                a[i] += dt * (Da * lapa[i] - abb + F * (1.0f - a[i]));
+                b[i] += dt * (Db * lapb[i] + abb - (F + k) * b[i]);
+            }
+        }
+        // Element i of the grid is vertex i of the visual
+        gvp->data.assign (b.begin(), b.end());
+        gvp->reinitColours();
+
+        std::stringstream ss;
+        ss << "step " << step << " on " << gg.n() << " elements";
+        info_tm->setupText (ss.str());
+        v.render();
+        v.poll();
+    }
+
+    return 0;
+}
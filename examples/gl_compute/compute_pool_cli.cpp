@@ -0,0 +1,57 @@
+/*
+ * A parameter sweep across every GPU on the machine with morph::gl::compute_pool. Each job
+ * makes a data set from its parameter, sums it on the GPU with morph::gl::primitives and
+ * stores the result. Jobs go to whichever GPU context is free.
+ */
+
+// As in shader_naive_scan_cli.cpp, include the GL headers for your target version first
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_pool.h>
+#include <morph/gl/ssbo.h>
+#include <morph/gl/primitives.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+int main()
+{
+    constexpr int glver = morph::gl::version_3_1_es;
+    for (auto d : morph::gl::egl_devices()) { std::cout << "EGL device: " << (d.name.empty() ? "(default)" : d.name) << std::endl; }
+
+    // Two contexts per GPU, so one job's data set-up overlaps another's compute
+    morph::gl::compute_pool<glver> pool (2);
+    std::cout << pool.size() << " contexts on " << pool.num_devices() << " device(s)\n";
+
+    constexpr unsigned int nparams = 32;
+    constexpr unsigned int n = 1u << 20;
+    std::vector<float> results (nparams, 0.0f);
+    std::vector<unsigned int> ran_on (nparams, 0u);
+    for (unsigned int p = 0; p < nparams; ++p) {
+        pool.push ([p, &results, &ran_on](morph::gl::compute_context<glver>& ctx) {
+            const float a = 0.1f * (p + 1);
+            morph::vvec<float> data (n);
+            for (unsigned int i = 0; i < n; ++i) { data[i] = std::sin (a * i / n); }
+            unsigned int buf = 0;
+            morph::gl::setup_ssbo (0, buf, data);
+            // GL objects belong to the context, so each job makes its own primitives
+            morph::gl::primitives<glver> prim;
+            results[p] = prim.sum<float> (buf, n) / n;
+            glDeleteBuffers (1, &buf);
+            ran_on[p] = ctx.device_index;
+        });
+    }
+    pool.wait();
+
+    int rtn = 0;
+    for (unsigned int p = 0; p < nparams; ++p) {
+        // The mean of sin (a x) over [0, 1) is (1 - cos a) / a
+        const float a = 0.1f * (p + 1);
+        const float expected = (1.0f - std::cos (a)) / a;
+        std::cout << "a = " << a << ": mean " << results[p] << " (device " << ran_on[p] << ")\n";
+        if (std::abs (results[p] - expected) > 1e-3f) { --rtn; }
+    }
+    std::cout << (rtn == 0 ? "All results as expected\n" : "Some results are wrong\n");
+    return rtn;
+}
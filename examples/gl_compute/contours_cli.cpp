@@ -0,0 +1,114 @@
+/*
+ * Display-free example of morph::gl::contour_extractor: find the contours of a field on a
+ * HexGrid (along the hex edges) and on a Grid (by marching squares) in a compute shader, and
+ * check them against the contour hexes of morph::hex_contours (the engine of
+ * ShapeAnalysis::get_contours) and against the field itself.
+ */
+
+// As in shader_naive_scan_cli.cpp, include the GL headers for your target version first
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_manager_cli.h>
+#include <morph/gl/contour_extractor.h>
+#include <morph/ShapeAnalysis.h>
+#include <morph/HexGrid.h>
+#include <morph/Grid.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <set>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace my {
+
+    constexpr int glver = morph::gl::version_3_1_es;
+
+    struct compute_manager : public morph::gl::compute_manager_cli<glver>
+    {
+        compute_manager() { this->init(); }
+
+        // contour_extractor compiles its own programs on first use
+        void load_shaders() final {}
+
+        void compute() final
+        {
+            using sc = std::chrono::steady_clock;
+            int rtn = 0;
+
+            // Two overlapping bumps on a HexGrid
+            morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+            hg.setCircularBoundary (1.0f);
+            std::vector<float> f (hg.num());
+            for (unsigned int i = 0; i < hg.num(); ++i) {
+                const float x = hg.d_x[i];
+                const float y = hg.d_y[i];
+                f[i] = std::exp (-8.0f * ((x - 0.3f) * (x - 0.3f) + y * y)) + std::exp (-8.0f * ((x + 0.3f) * (x + 0.3f) + y * y));
+            }
+            // An absolute threshold, as in hex_contours::find_nonorm (get_contours would normalise f first)
+            const float threshold = 0.5f;
+
+            sc::time_point t0 = sc::now();
+            morph::hex_contours<float> hc (hg);
+            const std::vector<unsigned int>& cpu = hc.find_nonorm (f, threshold);
+            sc::time_point t1 = sc::now();
+            morph::gl::contour_extractor<glver> ce;
+            ce.set_hexgrid (hg);
+            ce.dispatch (threshold, f); // the first call compiles the shader
+            sc::time_point t2 = sc::now();
+            ce.dispatch (threshold, f);
+            morph::vvec<morph::vec<float, 3>> seg = ce.segments();
+            sc::time_point t3 = sc::now();
+
+            // Each segment separates a contour hex from a hex below the threshold
+            std::set<unsigned int> contour_hexes;
+            contour_hexes.insert (cpu.begin(), cpu.end());
+            std::set<unsigned int> found;
+            const float d = hg.getd();
+            unsigned int bad = 0;
+            for (std::size_t k = 0; k + 1 < seg.size(); k += 2) {
+                const morph::vec<float, 3> mid = (seg[k] + seg[k + 1]) * 0.5f;
+                const morph::vec<float, 3> along = seg[k + 1] - seg[k];
+                morph::vec<float, 2> normal = { -along[1], along[0] };
+                normal.renormalize();
+                // The hexes on either side of the segment
+                int a = hg.findHexNearest ({ mid[0] + 0.5f * d * normal[0], mid[1] + 0.5f * d * normal[1] })->vi;
+                int b = hg.findHexNearest ({ mid[0] - 0.5f * d * normal[0], mid[1] - 0.5f * d * normal[1] })->vi;
+                if (f[a] < threshold) { std::swap (a, b); }
+                if (f[a] < threshold || f[b] >= threshold || !contour_hexes.count (a)) { ++bad; }
+                found.insert (a);
+            }
+            std::cout << "HexGrid (" << hg.num() << " hexes): " << seg.size() / 2 << " edges around " << found.size()
+                      << " hexes; hex_contours found " << contour_hexes.size() << ". CPU "
+                      << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, GPU "
+                      << std::chrono::duration<double, std::milli>(t3 - t2).count() << " ms (including upload and readback)\n";
+            if (bad > 0 || found != contour_hexes) { std::cout << "The hex edges do not match hex_contours\n"; --rtn; }
+
+            // A circle of radius 0.5 on a Grid
+            morph::Grid<unsigned int, float> g (400U, 300U, morph::vec<float, 2>{ 0.005f, 0.005f }, morph::vec<float, 2>{ -1.0f, -0.75f });
+            std::vector<float> r2 (g.n());
+            for (unsigned int i = 0; i < g.n(); ++i) { r2[i] = g[i][0] * g[i][0] + g[i][1] * g[i][1]; }
+            ce.set_grid (g);
+            ce.dispatch (0.25f, r2);
+            seg = ce.segments();
+            float maxerr = 0.0f;
+            for (const morph::vec<float, 3>& v : seg) { maxerr = std::max (maxerr, std::abs (v.length() - 0.5f)); }
+            std::cout << "Grid (" << g.n() << " elements): " << seg.size() / 2 << " segments, largest distance from the circle " << maxerr << std::endl;
+            // Linear interpolation of r^2 across a cell of side h is out by at most about h^2 / 4r
+            if (seg.empty() || maxerr > 1e-4f) { std::cout << "The marching squares contour is not on the circle\n"; --rtn; }
+
+            std::cout << "GPU contours " << (rtn == 0 ? "agree with" : "DIFFER from") << " the CPU results\n";
+            this->result = rtn;
+        }
+
+        int result = 0;
+    };
+} // namespace my
+
+int main()
+{
+    my::compute_manager c;
+    c.compute();
+    return c.result;
+}
@@ -0,0 +1,97 @@
+/*
+ * Train the 784-30-10 MNIST network of standalone_examples/neuralnet/ff_mnist.cpp on the GPU
+ * with morph::nn::FeedForwardNetGPU.
+ *
+ * The training images are uploaded into an SSBO once. Each epoch then runs entirely in compute
+ * shaders; only the (shuffled) sample order goes to the GPU and the epoch's mean cost comes back.
+ * After each epoch the weights are copied back to the CPU-side FeedForwardNet, which is evaluated
+ * on the test set.
+ *
+ * Uses morph::gl::compute_manager_cli, so no display is needed.
+ *
+ * Usage: ./ff_mnist_gpu [epochs] [mini_batch_size] [eta]
+ */
+
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_manager_cli.h>
+#include <morph/nn/FeedForwardNetGPU.h>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/Mnist.h>
+#include <morph/vvec.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <chrono>
+
+namespace my {
+
+    struct ff_gpu : public morph::gl::compute_manager_cli<morph::gl::version_3_1_es>
+    {
+        ff_gpu (morph::nn::FeedForwardNet<float>& net, const unsigned int nb)
+        {
+            this->init();
+            this->gpu = std::make_unique<morph::nn::FeedForwardNetGPU<morph::gl::version_3_1_es>> (net, nb);
+        }
+
+        // FeedForwardNetGPU builds its own shader programs
+        void load_shaders() final {}
+
+        // One epoch with a fresh shuffle of the training set
+        void compute() final
+        {
+            std::vector<unsigned int> order (this->gpu->nsamples);
+            std::iota (order.begin(), order.end(), 0U);
+            std::shuffle (order.begin(), order.end(), this->rng);
+            this->cost = this->gpu->train_epoch (this->eta, order);
+        }
+
+        std::unique_ptr<morph::nn::FeedForwardNetGPU<morph::gl::version_3_1_es>> gpu;
+        float eta = 3.0f;
+        float cost = 0.0f;
+        std::mt19937 rng{42};
+    };
+} // namespace my
+
+int main (int argc, char** argv)
+{
+    unsigned int epochs = argc > 1 ? std::stoul (argv[1]) : 30;
+    unsigned int mini_batch_size = argc > 2 ? std::stoul (argv[2]) : 10;
+    float eta = argc > 3 ? std::stof (argv[3]) : 3.0f;
+
+    morph::Mnist m (std::string("../standalone_examples/neuralnet/mnist/"));
+
+    // The training set as vectors of inputs and one-hot desired outputs
+    std::vector<morph::vvec<float>> ins;
+    std::vector<morph::vvec<float>> outs;
+    for (auto& t : m.training_f) {
+        ins.push_back (t.second.second);
+        morph::vvec<float> o (10, 0.0f);
+        o[t.first] = 1.0f;
+        outs.push_back (o);
+    }
+
+    morph::nn::FeedForwardNet<float> ff1 ({784, 30, 10});
+    my::ff_gpu c (ff1, mini_batch_size);
+    c.eta = eta;
+    c.gpu->set_training_data (ins, outs);
+
+    using sc = std::chrono::steady_clock;
+    for (unsigned int ep = 0; ep < epochs; ++ep) {
+        sc::time_point t0 = sc::now();
+        c.compute();
+        c.gpu->download_params();
+        sc::duration dt = sc::now() - t0;
+        unsigned int numcorrect = ff1.evaluate (m.test_f);
+        std::cout << "Epoch " << ep << ": mean cost " << c.cost << ", "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(dt).count() << " ms; "
+                  << numcorrect << "/10000 test images characterized correctly\n";
+    }
+
+    return 0;
+}
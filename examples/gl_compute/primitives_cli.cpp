@@ -0,0 +1,118 @@
+/*
+ * Display-free example of the morph::gl::primitives compute building blocks: prefix scan,
+ * reductions, radix sort and histogram on SSBOs, each checked against the same computation on
+ * the CPU.
+ */
+
+// As in shader_naive_scan_cli.cpp, include the GL headers for your target version first
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_manager_cli.h>
+#include <morph/gl/ssbo.h>
+#include <morph/gl/primitives.h>
+#include <morph/vvec.h>
+#include <morph/histo.h>
+#include <morph/Random.h>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+
+namespace my {
+
+    constexpr int glver = morph::gl::version_3_1_es;
+
+    struct compute_manager : public morph::gl::compute_manager_cli<glver>
+    {
+        compute_manager() { this->init(); }
+
+        // primitives compiles its own programs on first use
+        void load_shaders() final {}
+
+        void compute() final
+        {
+            constexpr unsigned int n = 100000;
+            morph::RandUniform<float> rngf (-1.0f, 1.0f, 1);
+            morph::RandUniform<unsigned int> rngu (0u, 0xffffffffu, 2);
+            morph::vvec<float> f (n);
+            morph::vvec<unsigned int> u (n);
+            morph::vvec<unsigned int> idx (n);
+            for (unsigned int i = 0; i < n; ++i) {
+                f[i] = rngf.get();
+                u[i] = rngu.get();
+                idx[i] = i;
+            }
+            unsigned int f_ssbo = 0;
+            unsigned int u_ssbo = 0;
+            unsigned int idx_ssbo = 0;
+            unsigned int out_ssbo = 0;
+            unsigned int bins_ssbo = 0;
+            morph::gl::setup_ssbo (0, f_ssbo, f);
+            morph::gl::setup_ssbo (0, u_ssbo, u);
+            morph::gl::setup_ssbo (0, idx_ssbo, idx);
+            morph::gl::setup_ssbo (0, out_ssbo, u);
+            morph::gl::setup_ssbo (0, bins_ssbo, morph::vvec<unsigned int> (20, 0u));
+
+            int rtn = 0;
+
+            // Exclusive scan of unsigned ints (wrapping, as on the GPU)
+            morph::vvec<unsigned int> small (n);
+            for (unsigned int i = 0; i < n; ++i) { small[i] = u[i] % 100u; }
+            morph::gl::copy_vvec_to_ssbo (0, u_ssbo, small);
+            this->prim.exclusive_scan<unsigned int> (u_ssbo, out_ssbo, n);
+            morph::vvec<unsigned int> gpu (n);
+            morph::gl::ssbo_copy_to_vvec (0, out_ssbo, gpu);
+            morph::vvec<unsigned int> cpu (n);
+            std::exclusive_scan (small.begin(), small.end(), cpu.begin(), 0u);
+            if (gpu != cpu) { std::cout << "exclusive_scan differs\n"; --rtn; }
+
+            // Reductions
+            const float fsum = this->prim.sum<float> (f_ssbo, n);
+            if (std::abs (fsum - f.sum()) > 1e-2f) { std::cout << "sum " << fsum << " != " << f.sum() << std::endl; --rtn; }
+            if (this->prim.min<float> (f_ssbo, n) != f.min()) { std::cout << "min differs\n"; --rtn; }
+            if (this->prim.max<float> (f_ssbo, n) != f.max()) { std::cout << "max differs\n"; --rtn; }
+            if (this->prim.argmax<float> (f_ssbo, n) != f.argmax()) { std::cout << "argmax differs\n"; --rtn; }
+
+            // Sort keys, carrying their indices
+            morph::gl::copy_vvec_to_ssbo (0, u_ssbo, u);
+            this->prim.sort (u_ssbo, n, idx_ssbo);
+            morph::gl::ssbo_copy_to_vvec (0, u_ssbo, gpu);
+            morph::vvec<unsigned int> gpu_idx (n);
+            morph::gl::ssbo_copy_to_vvec (0, idx_ssbo, gpu_idx);
+            std::vector<unsigned int> order (n);
+            std::iota (order.begin(), order.end(), 0u);
+            std::stable_sort (order.begin(), order.end(), [&u](unsigned int a, unsigned int b) { return u[a] < u[b]; });
+            for (unsigned int i = 0; i < n; ++i) {
+                if (gpu_idx[i] != order[i] || gpu[i] != u[order[i]]) { std::cout << "sort differs at " << i << std::endl; --rtn; break; }
+            }
+
+            // Histogram into 20 bins over [-1, 1]
+            this->prim.histogram (f_ssbo, n, bins_ssbo, 20, morph::range<float>{ -1.0f, 1.0f });
+            morph::vvec<unsigned int> gpu_bins (20);
+            morph::gl::ssbo_copy_to_vvec (0, bins_ssbo, gpu_bins);
+            morph::histo<float> h (f, 20, morph::range<float>{ -1.0f, 1.0f });
+            for (unsigned int b = 0; b < 20; ++b) {
+                if (gpu_bins[b] != h.counts[b]) { std::cout << "histogram bin " << b << " differs\n"; --rtn; break; }
+            }
+
+            glDeleteBuffers (1, &f_ssbo);
+            glDeleteBuffers (1, &u_ssbo);
+            glDeleteBuffers (1, &idx_ssbo);
+            glDeleteBuffers (1, &out_ssbo);
+            glDeleteBuffers (1, &bins_ssbo);
+            std::cout << "GPU primitives " << (rtn == 0 ? "agree with" : "DIFFER from") << " the CPU results\n";
+            this->result = rtn;
+        }
+
+        int result = 0;
+
+    private:
+        morph::gl::primitives<glver> prim;
+    };
+} // namespace my
+
+int main()
+{
+    my::compute_manager c;
+    c.compute();
+    return c.result;
+}
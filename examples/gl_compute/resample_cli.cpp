@@ -0,0 +1,95 @@
+/*
+ * Display-free example of morph::gl::image_resampler: resample an image onto a HexGrid and a
+ * Grid in a compute shader, check the results against HexGrid::resampleImage and
+ * Grid::resample_image and compare the times.
+ */
+
+// As in shader_naive_scan_cli.cpp, include the GL headers for your target version first
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_manager_cli.h>
+#include <morph/gl/image_resampler.h>
+#include <morph/HexGrid.h>
+#include <morph/Grid.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace my {
+
+    constexpr int glver = morph::gl::version_3_1_es;
+
+    struct compute_manager : public morph::gl::compute_manager_cli<glver>
+    {
+        compute_manager() { this->init(); }
+
+        // image_resampler compiles its own programs on first use
+        void load_shaders() final {}
+
+        void compute() final
+        {
+            using sc = std::chrono::steady_clock;
+            int rtn = 0;
+
+            // A 1 megapixel image with some structure
+            const unsigned int pw = 1000;
+            const unsigned int ph = 1000;
+            morph::vvec<float> img (pw * ph);
+            for (unsigned int j = 0; j < ph; ++j) {
+                for (unsigned int i = 0; i < pw; ++i) { img[j * pw + i] = 0.5f + 0.5f * std::sin (i * 0.021f) * std::cos (j * 0.013f); }
+            }
+            const morph::vec<unsigned int, 2> pixsz = { pw, ph };
+            const morph::vec<float, 2> offset = { 0.013f, -0.02f };
+
+            // HexGrid
+            morph::HexGrid hg (0.005f, 3.0f, 0.0f);
+            hg.setCircularBoundary (0.8f);
+            const morph::vec<float, 2> hscale = { 2.0f, 2.0f };
+            sc::time_point t0 = sc::now();
+            morph::vvec<float> cpu = hg.resampleImage (img, pw, hscale, offset);
+            sc::time_point t1 = sc::now();
+            morph::gl::image_resampler<glver> hrs;
+            hrs.set_centres (hg.d_x, hg.d_y);
+            const morph::gl::resample_geometry hgeom = morph::gl::resample_geometry::hexgrid (pixsz, hscale, offset);
+            morph::vvec<float> gpu = hrs.resample (img, pw, hgeom); // the first call compiles the shaders
+            sc::time_point t2 = sc::now();
+            gpu = hrs.resample (img, pw, hgeom);
+            sc::time_point t3 = sc::now();
+            float maxdiff = (gpu - cpu).abs().max();
+            std::cout << "HexGrid (" << hg.num() << " hexes): CPU " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+                      << " ms, GPU " << std::chrono::duration<double, std::milli>(t3 - t2).count()
+                      << " ms (including upload and readback); max difference " << maxdiff << std::endl;
+            if (maxdiff > 1e-4f) { std::cout << "image_resampler differs from HexGrid::resampleImage\n"; --rtn; }
+
+            // Grid
+            morph::Grid g (400U, 300U, morph::vec<float, 2>{ 0.005f, 0.005f });
+            const morph::vec<float, 2> gscale = { 1.0f, 1.0f };
+            cpu = g.resample_image (img, pw, gscale, offset);
+            morph::gl::image_resampler<glver> grs;
+            grs.set_centres (g.v_c);
+            gpu = grs.resample (img, pw, morph::gl::resample_geometry::grid (pixsz, gscale, offset, g.width()));
+            maxdiff = (gpu - cpu).abs().max();
+            std::cout << "Grid (" << g.n() << " elements): max difference " << maxdiff << std::endl;
+            if (maxdiff > 1e-4f) { std::cout << "image_resampler differs from Grid::resample_image\n"; --rtn; }
+
+            // A flat image is passed through, as on the CPU
+            morph::vvec<float> flat (pw * ph, 0.25f);
+            gpu = grs.resample (flat, pw, morph::gl::resample_geometry::grid (pixsz, gscale, offset, g.width()));
+            if (gpu.min() != 0.25f || gpu.max() != 0.25f) { std::cout << "flat image not passed through\n"; --rtn; }
+
+            std::cout << "GPU resampling " << (rtn == 0 ? "agrees with" : "DIFFERS from") << " the CPU results\n";
+            this->result = rtn;
+        }
+
+        int result = 0;
+    };
+} // namespace my
+
+int main()
+{
+    my::compute_manager c;
+    c.compute();
+    return c.result;
+}
@@ -0,0 +1,187 @@
+/*
+ * GPU-resident reaction-diffusion. A parameter sweep of the Schnakenberg RD system
+ * (see examples/schnakenberg) in which many models are stepped together in a compute
+ * shader, with morph::gl::rd_batch.
+ *
+ * The HexGrid neighbour relations (the ghost stencil of RD_Base), the parameters and the
+ * state of every model are copied into SSBOs once. Each call to compute() then dispatches
+ * steps_per_batch timesteps, one dispatch per step for all the models, and reads back only
+ * each model's largest rate of change, so that models which have reached a steady state
+ * (or blown up) are frozen. The state is only copied back to the CPU when it is needed,
+ * here to check the result and to save.
+ *
+ * The shader uses forward Euler integration. The first model is also stepped on the CPU,
+ * with the same scheme, as a check.
+ *
+ * Uses morph::gl::compute_manager_cli, so no display is needed.
+ *
+ * Usage: ./schnak_gpu [nmodels] [nbatches] [steps_per_batch]
+ */
+
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_manager_cli.h>
+#include <morph/gl/rd_batch.h>
+#include <morph/vvec.h>
+#include <morph/HdfData.h>
+#include "../schnakenberg/rd_schnakenberg.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cmath>
+
+namespace my {
+
+    // F = k1 - k2 A + k3 A^2 B + D_A lap(A)
+    // G = k4        - k3 A^2 B + D_B lap(B)
+    // with the parameters k1, k2, k3, k4, D_A, D_B of model m
+    const char* schnak_derivs =
+    "void derivs (uint m, float u[NF], float lap[NF], out float du[NF])\n"
+    "{\n"
+    "    float a2b = param (m, 2u) * u[0] * u[0] * u[1];\n"
+    "    du[0] = param (m, 0u) - param (m, 1u) * u[0] + a2b + param (m, 4u) * lap[0];\n"
+    "    du[1] = param (m, 3u) - a2b + param (m, 5u) * lap[1];\n"
+    "}\n";
+
+    struct schnak_gpu : public morph::gl::compute_manager_cli<morph::gl::version_3_1_es>
+    {
+        // Number of floats in the parameter block for each model (k1, k2, k3, k4, D_A, D_B)
+        static constexpr unsigned int nparams = 6;
+
+        // RD is used for its HexGrid and its initial state. params holds nparams values for
+        // each model that will be run.
+        schnak_gpu (RD_Schnakenberg<float>& RD, const morph::vvec<float>& params)
+            : batch(*RD.hg, static_cast<unsigned int>(params.size() / nparams), 2, nparams)
+        {
+            if (params.size() % nparams != 0) { throw std::runtime_error ("params must hold 6 values for each model"); }
+            this->nhex = this->batch.num_hexes();
+            this->nmodels = this->batch.num_instances();
+            this->batch.params = params;
+            // Every model starts from RD's initial state
+            for (unsigned int m = 0; m < this->nmodels; ++m) {
+                this->batch.set_field (m, 0, RD.A);
+                this->batch.set_field (m, 1, RD.B);
+            }
+            this->batch.reaction = schnak_derivs;
+            this->batch.dt = static_cast<float>(RD.get_dt());
+            this->batch.tolerance = 1e-4f;
+
+            this->init();
+        }
+
+        // rd_batch compiles its own shader in batch.init()
+        void load_shaders() final { this->batch.init(); }
+
+        // Advance the running models by steps_per_batch timesteps
+        void compute() final { this->batch.step (this->steps_per_batch); }
+
+        float getA (unsigned int m, unsigned int h) { this->batch.fetch(); return this->batch.value (m, 0, h); }
+        float getB (unsigned int m, unsigned int h) { this->batch.fetch(); return this->batch.value (m, 1, h); }
+
+        // Save A and B for each model to HDF5, as /A<m> and /B<m>, with the step at which each settled
+        void save (const std::string& fname)
+        {
+            morph::HdfData data (fname);
+            for (unsigned int m = 0; m < this->nmodels; ++m) {
+                std::string pa = std::string("/A") + std::to_string (m);
+                std::string pb = std::string("/B") + std::to_string (m);
+                data.add_contained_vals (pa.c_str(), this->batch.field (m, 0));
+                data.add_contained_vals (pb.c_str(), this->batch.field (m, 1));
+            }
+            std::vector<unsigned long long> status (this->nmodels);
+            for (unsigned int m = 0; m < this->nmodels; ++m) { status[m] = static_cast<unsigned long long>(this->batch.status[m]); }
+            data.add_contained_vals ("/status", status);
+            data.add_contained_vals ("/settled_at", this->batch.settled_at);
+            data.add_val ("/stepCount", this->batch.steps);
+        }
+
+        unsigned int steps_per_batch = 100;
+        unsigned int nhex = 0;
+        unsigned int nmodels = 0;
+        morph::gl::rd_batch<morph::gl::version_3_1_es> batch;
+    };
+} // namespace my
+
+// A forward Euler step of RD on the CPU, for comparison with the shader
+void cpu_euler_step (RD_Schnakenberg<float>& RD)
+{
+    std::vector<float> lapA (RD.nhex, 0.0f);
+    std::vector<float> lapB (RD.nhex, 0.0f);
+    RD.compute_laplace (RD.A, lapA);
+    RD.compute_laplace (RD.B, lapB);
+    float dt = RD.get_dt();
+    for (unsigned int h = 0; h < RD.nhex; ++h) {
+        float a2b = RD.k3 * RD.A[h] * RD.A[h] * RD.B[h];
+        float dA = RD.k1 - RD.k2 * RD.A[h] + a2b + RD.D_A * lapA[h];
+        float dB = RD.k4 - a2b + RD.D_B * lapB[h];
+        RD.A[h] += dt * dA;
+        RD.B[h] += dt * dB;
+    }
+}
+
+int main (int argc, char** argv)
+{
+    unsigned int nmodels = argc > 1 ? std::stoul (argv[1]) : 64;
+    unsigned int nbatches = argc > 2 ? std::stoul (argv[2]) : 100;
+    unsigned int steps_per_batch = argc > 3 ? std::stoul (argv[3]) : 100;
+
+    RD_Schnakenberg<float> RD;
+    RD.svgpath = "";
+    RD.ellipse_a = 60.0f;
+    RD.ellipse_b = 20.0f;
+    RD.hextohex_d = 0.25f;
+    RD.hexspan = 155.0f;
+    RD.ghost_stencil = true;
+    RD.allocate();
+    RD.set_dt (0.005f);
+    RD.k1 = 0.01f;
+    RD.k4 = 1.7f;
+    RD.D_A = 1.0f;
+    RD.init();
+
+    // Sweep D_B from 10 to 30 across the models. Model 0 has the CPU model's parameters.
+    RD.D_B = 10.0f;
+    morph::vvec<float> params (6 * nmodels, 0.0f);
+    for (unsigned int m = 0; m < nmodels; ++m) {
+        float D_B = 10.0f + (nmodels > 1 ? 20.0f * m / (nmodels - 1) : 0.0f);
+        params[6*m]   = RD.k1;
+        params[6*m+1] = RD.k2;
+        params[6*m+2] = RD.k3;
+        params[6*m+3] = RD.k4;
+        params[6*m+4] = RD.D_A;
+        params[6*m+5] = D_B;
+    }
+
+    my::schnak_gpu g (RD, params);
+    g.steps_per_batch = steps_per_batch;
+    std::cout << nmodels << " models of " << g.nhex << " hexes\n";
+
+    // Check the first batch against the CPU
+    g.compute();
+    for (unsigned int i = 0; i < steps_per_batch; ++i) { cpu_euler_step (RD); }
+    float maxdiff = 0.0f;
+    for (unsigned int h = 0; h < g.nhex; ++h) {
+        maxdiff = std::max (maxdiff, std::abs (g.getA (0, h) - RD.A[h]));
+        maxdiff = std::max (maxdiff, std::abs (g.getB (0, h) - RD.B[h]));
+    }
+    std::cout << "Max difference from the CPU after " << steps_per_batch << " steps: " << maxdiff << "\n";
+
+    // Step until every model has settled, or for nbatches batches
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    unsigned long long model_steps = 0;
+    for (unsigned int b = 1; b < nbatches && g.batch.num_running() > 0; ++b) {
+        model_steps += static_cast<unsigned long long>(g.batch.num_running()) * steps_per_batch;
+        g.compute();
+    }
+    glFinish();
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    double us = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+    if (model_steps > 0) { std::cout << "GPU: " << us / model_steps << " us per model step\n"; }
+    std::cout << (nmodels - g.batch.num_running()) << " of " << nmodels << " models settled after "
+              << g.batch.steps << " steps\n";
+
+    g.save ("./schnak_gpu.h5");
+
+    return 0;
+}
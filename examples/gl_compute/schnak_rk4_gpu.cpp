@@ -0,0 +1,120 @@
+/*
+ * GPU-resident reaction-diffusion with morph::gl::rd_compute. The Schnakenberg model of
+ * examples/schnakenberg is stepped with RK4 in compute shaders, just as RD_Schnakenberg::step()
+ * steps it on the CPU.
+ *
+ * The HexGrid neighbour relations (the ghost stencil of RD_Base), the parameters and the state
+ * are copied into SSBOs once. Each call to compute() then advances the model steps_per_batch
+ * timesteps on the GPU. The state is only copied back to the CPU when it is needed, here to
+ * check the first batch against the CPU model and to save.
+ *
+ * Uses morph::gl::compute_manager_cli, so no display is needed.
+ *
+ * Usage: ./schnak_rk4_gpu [nbatches] [steps_per_batch]
+ */
+
+#include <GLES3/gl31.h>
+
+#include <morph/gl/compute_manager_cli.h>
+#include <morph/gl/rd_compute.h>
+#include <morph/vvec.h>
+#include <morph/HdfData.h>
+#include "../schnakenberg/rd_schnakenberg.h"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cmath>
+
+namespace my {
+
+    // F = k1 - k2 A + k3 A^2 B + D_A lap(A)
+    // G = k4        - k3 A^2 B + D_B lap(B)
+    // with the parameters k1, k2, k3, k4, D_A, D_B
+    const char* schnak_derivs =
+    "void derivs (float u[NF], float lap[NF], out float du[NF])\n"
+    "{\n"
+    "    float a2b = param (2u) * u[0] * u[0] * u[1];\n"
+    "    du[0] = param (0u) - param (1u) * u[0] + a2b + param (4u) * lap[0];\n"
+    "    du[1] = param (3u) - a2b + param (5u) * lap[1];\n"
+    "}\n";
+
+    struct schnak_rk4_gpu : public morph::gl::compute_manager_cli<morph::gl::version_3_1_es>
+    {
+        // RD gives the HexGrid, the parameters, the timestep and the initial state
+        schnak_rk4_gpu (RD_Schnakenberg<float>& RD) : rd(*RD.hg, 2, 6)
+        {
+            this->rd.params = { RD.k1, RD.k2, RD.k3, RD.k4, RD.D_A, RD.D_B };
+            this->rd.set_field (0, RD.A);
+            this->rd.set_field (1, RD.B);
+            this->rd.reaction = schnak_derivs;
+            this->rd.dt = static_cast<float>(RD.get_dt());
+            this->init();
+        }
+
+        // rd_compute compiles its own shader in rd.init()
+        void load_shaders() final { this->rd.init(); }
+
+        // Advance the model by steps_per_batch RK4 steps
+        void compute() final { this->rd.step (this->steps_per_batch); }
+
+        void save (const std::string& fname)
+        {
+            morph::HdfData data (fname);
+            data.add_contained_vals ("/A", this->rd.field (0));
+            data.add_contained_vals ("/B", this->rd.field (1));
+            data.add_val ("/stepCount", this->rd.steps);
+        }
+
+        unsigned int steps_per_batch = 100;
+        morph::gl::rd_compute<morph::gl::version_3_1_es> rd;
+    };
+} // namespace my
+
+int main (int argc, char** argv)
+{
+    unsigned int nbatches = argc > 1 ? std::stoul (argv[1]) : 100;
+    unsigned int steps_per_batch = argc > 2 ? std::stoul (argv[2]) : 100;
+
+    RD_Schnakenberg<float> RD;
+    RD.svgpath = "";
+    RD.ellipse_a = 60.0f;
+    RD.ellipse_b = 20.0f;
+    RD.hextohex_d = 0.25f;
+    RD.hexspan = 155.0f;
+    RD.ghost_stencil = true;
+    RD.allocate();
+    RD.set_dt (0.005f);
+    RD.k1 = 0.01f;
+    RD.k4 = 1.7f;
+    RD.D_A = 1.0f;
+    RD.D_B = 20.0f;
+    RD.init();
+
+    my::schnak_rk4_gpu g (RD);
+    g.steps_per_batch = steps_per_batch;
+    std::cout << "One model of " << g.rd.num_hexes() << " hexes\n";
+
+    // Check the first batch against the CPU model's own RK4 steps
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < steps_per_batch; ++i) { RD.step(); }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    g.compute();
+    morph::vvec<float> A (RD.A.begin(), RD.A.end());
+    morph::vvec<float> B (RD.B.begin(), RD.B.end());
+    float maxdiff = std::max ((g.rd.field (0) - A).abs().max(), (g.rd.field (1) - B).abs().max());
+    std::cout << "Max difference from the CPU after " << steps_per_batch << " steps: " << maxdiff << "\n";
+
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    for (unsigned int b = 1; b < nbatches; ++b) { g.compute(); }
+    glFinish();
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+    double cpu_us = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+    double gpu_us = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count());
+    std::cout << "CPU: " << cpu_us / steps_per_batch << " us per step\n";
+    if (nbatches > 1) { std::cout << "GPU: " << gpu_us / ((nbatches - 1) * steps_per_batch) << " us per step\n"; }
+
+    g.save ("./schnak_rk4_gpu.h5");
+
+    return 0;
+}
@@ -60,7 +60,8 @@ namespace my {
             this->input_ssbo.copy_to_gpu(); // should have happened in init?
 
             this->scan_program.use();
-            this->scan_program.dispatch (dsz, 1, 1);
+            // No barrier needed here; copy_from_gpu makes the one it needs
+            this->scan_program.dispatch (dsz, 1, 1, 0);
 
             this->output_ssbo.copy_from_gpu();
             this->debug_ssbo.copy_from_gpu();
@@ -136,7 +136,9 @@ namespace my {
 
             this->measure_compute(); // optional
             this->compute_program.use();
-            this->compute_program.dispatch (dwidth, dheight, 1);
+            // The output images are drawn as textures (copy_from_gpu makes its own barrier)
+            this->compute_program.dispatch (dwidth, dheight, 1,
+                                            GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
 
             // To retreive data from the SSBO:
             // morph::range<float> ssbo_range = this->input_ssbo.get_range();
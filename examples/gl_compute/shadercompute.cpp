@@ -94,8 +94,10 @@ namespace my {
             this->compute_program.use();
             // Set time into a uniform in the compute program
             this->compute_program.set_uniform<float> ("t", this->frame_count);
-            // This is dispatch with work groups of (a, b, 1)
-            this->compute_program.dispatch (tex_width/10, tex_height/10, 1);
+            // This is dispatch with work groups of (a, b, 1). The image it writes is then sampled
+            // as a texture in render().
+            this->compute_program.dispatch (tex_width/10, tex_height/10, 1,
+                                            GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
         }
 
         // Override the render method to do whatever visualization you want
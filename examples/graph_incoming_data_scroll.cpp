@@ -0,0 +1,47 @@
+/*
+ * Visualize a stream of data on a graph whose x axis scrolls along with the data.
+ */
+#include <morph/Visual.h>
+#include <morph/GraphVisual.h>
+#include <iostream>
+#include <cmath>
+
+int main()
+{
+    int rtn = -1;
+
+    morph::Visual v(1024, 768, "Scrolling graph");
+    v.zNear = 0.001;
+    v.backgroundWhite();
+
+    try {
+        auto gv = std::make_unique<morph::GraphVisual<float>> (morph::vec<float>({0,0,0}));
+        v.bindmodel (gv);
+        gv->setsize (1.33, 1);
+        // The first window of the x axis. The window keeps this width as the data arrives.
+        gv->setlimits (0, 10, -1.2, 1.2);
+        gv->scroll_window = 10.0f;
+        gv->scroll_step = 0.5f; // Jump forward half a window each time the data reaches the end
+        gv->policy = morph::stylepolicy::lines;
+        gv->prepdata ("sin(x)");
+        gv->xlabel = "t";
+        gv->finalize();
+        auto gvp = v.addVisualModel (gv);
+
+        float t = 0.0f;
+        while (v.readyToFinish == false) {
+            v.waitevents (0.018);
+            // Only the newly appended line segments are computed, except when the window moves
+            gvp->append (t, std::sin (t), 0);
+            t += 0.02f;
+            v.render();
+        }
+        rtn = 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
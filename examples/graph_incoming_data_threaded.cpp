@@ -0,0 +1,62 @@
+/*
+ * A scrolling graph of data that arrives on another thread. The thread pushes samples into the
+ * GraphVisual's lock free queue and the graph appends them in one batch on each frame.
+ */
+#include <morph/Visual.h>
+#include <morph/GraphVisual.h>
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+int main()
+{
+    int rtn = -1;
+
+    morph::Visual v(1024, 768, "Graph of data from another thread");
+    v.zNear = 0.001;
+    v.backgroundWhite();
+
+    try {
+        auto gv = std::make_unique<morph::GraphVisual<float>> (morph::vec<float>({0,0,0}));
+        v.bindmodel (gv);
+        gv->setsize (1.33, 1);
+        gv->setlimits (0, 10, -1.2, 1.2);
+        gv->scroll_window = 10.0f;
+        gv->scroll_step = 0.5f;
+        gv->policy = morph::stylepolicy::lines;
+        gv->prepdata ("sin(t)");
+        gv->xlabel = "t";
+        gv->finalize();
+        // One queue per dataset, made before the producer starts
+        gv->make_incoming (8192);
+        auto gvp = v.addVisualModel (gv);
+
+        // The producer samples far faster than the display, and never touches the OpenGL context
+        std::atomic<bool> finished = false;
+        std::thread producer ([gvp, &finished]() {
+            float t = 0.0f;
+            while (!finished) {
+                gvp->push (t, std::sin (t), 0);
+                t += 0.0002f;
+                std::this_thread::sleep_for (std::chrono::microseconds (20));
+            }
+        });
+
+        while (v.readyToFinish == false) {
+            v.waitevents (0.018);
+            v.render(); // appends whatever the producer pushed since the last frame
+        }
+        finished = true;
+        producer.join();
+        std::cout << gvp->incoming_dropped_count() << " samples were dropped\n";
+        rtn = 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
@@ -0,0 +1,39 @@
+// A graph of a million points, whose markers and lines are drawn instanced
+// (GraphVisual::instanced_data), so that each point uploads 13 floats for its marker and 13 for
+// its line segment, rather than tens of vertices.
+
+#include <morph/Visual.h>
+#include <morph/GraphVisual.h>
+#include <morph/vvec.h>
+#include <morph/Random.h>
+
+int main()
+{
+    morph::Visual v(1024, 768, "A million points with GraphVisual::instanced_data");
+    auto gv = std::make_unique<morph::GraphVisual<float>> (morph::vec<float>({0,0,0}));
+    v.bindmodel (gv);
+    gv->instanced_data = true;
+
+    constexpr unsigned int N = 1000000;
+    morph::vvec<float> x;
+    x.linspace (0.0f, 100.0f, N);
+    // A random walk
+    morph::RandNormal<float> rn (0.0f, 0.01f);
+    morph::vvec<float> y (N, 0.0f);
+    for (unsigned int i = 1; i < N; ++i) { y[i] = y[i-1] + rn.get(); }
+
+    morph::DatasetStyle ds (morph::stylepolicy::both);
+    ds.linecolour = morph::colour::crimson;
+    ds.linewidth = 0.002f;
+    ds.markercolour = morph::colour::navy;
+    ds.markersize = 0.004f;
+    ds.markerstyle = morph::markerstyle::circle;
+    ds.markergap = 0.0f; // join the lines to the markers
+    ds.datalabel = "random walk";
+    gv->setdata (x, y, ds);
+    gv->finalize();
+    v.addVisualModel (gv);
+
+    v.keepOpen();
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * An example morph::Visual scene, containing a large Grid shown with GridVisual, in which only a
+ * few small tiles of the data change each frame. The changed tiles are marked with
+ * markTileDirty() and reinitColoursDirty() recolours and uploads just those.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <morph/vec.h>
+#include <morph/Random.h>
+#include <morph/Visual.h>
+#include <morph/GridVisual.h>
+#include <morph/Grid.h>
+
+int main()
+{
+    morph::Visual v(1600, 1000, "GridVisual: recolouring only the tiles that change");
+
+    constexpr unsigned int Nside = 1000;
+    constexpr unsigned int tile = 8;
+    constexpr unsigned int n_tiles = 16; // tiles changed per frame
+    constexpr morph::vec<float, 2> grid_spacing = {0.001f, 0.001f};
+    morph::Grid grid(Nside, Nside, grid_spacing);
+    std::cout << "Number of pixels in grid:" << grid.n() << std::endl;
+
+    std::vector<float> data(grid.n(), 0.0f);
+
+    morph::vec<float, 3> offset = { -0.5f * grid.width(), -0.5f * grid.height(), 0.0f };
+    auto gv = std::make_unique<morph::GridVisual<float>>(&grid, offset);
+    v.bindmodel (gv);
+    gv->gridVisMode = morph::GridVisMode::Triangles;
+    gv->setScalarData (&data);
+    gv->cm.setType (morph::ColourMapType::Viridis);
+    gv->zScale.setParams (0, 0);
+    // A fixed colour scale, so that no change to the data can force a full recolour
+    gv->colourScale.do_autoscale = false;
+    gv->colourScale.compute_scaling (0, 1);
+    gv->finalize();
+    auto gvp = v.addVisualModel (gv);
+
+    morph::RandUniform<unsigned int> rnd_pos (0, Nside - tile);
+    morph::RandUniform<float> rnd_val (0.0f, 1.0f);
+
+    while (!v.readyToFinish) {
+        v.poll();
+        for (unsigned int t = 0; t < n_tiles; ++t) {
+            unsigned int x0 = rnd_pos.get();
+            unsigned int y0 = rnd_pos.get();
+            float val = rnd_val.get();
+            for (unsigned int y = y0; y < y0 + tile; ++y) {
+                for (unsigned int x = x0; x < x0 + tile; ++x) { data[y * Nside + x] = val; }
+            }
+            gvp->markTileDirty (x0, y0, tile, tile);
+        }
+        gvp->reinitColoursDirty();
+        v.render();
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * An example morph::Visual scene showing a very large Grid with GridVisual in
+ * GridVisMode::Texture. The data are uploaded as a texture and coloured on the GPU, so that
+ * a 25 megapixel field needs only a few vertices and a fast update.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+
+#include <morph/vec.h>
+#include <morph/Visual.h>
+#include <morph/GridVisual.h>
+#include <morph/Grid.h>
+
+int main()
+{
+    morph::Visual v(1600, 1000, "morph::GridVisual in GridVisMode::Texture");
+
+    morph::VisualTextModel<>* fps_tm;
+    v.addLabel ("0 FPS", {0.53f, -0.23f, 0.0f}, fps_tm);
+
+    // A large grid
+    constexpr unsigned int Nside = 5000;
+    constexpr morph::vec<float, 2> grid_spacing = {0.0002f, 0.0002f};
+    morph::Grid grid(Nside, Nside, grid_spacing);
+    std::cout << "Number of pixels in grid:" << grid.n() << std::endl;
+
+    std::vector<float> data(grid.n(), 0.0f);
+
+    morph::vec<float, 3> offset = { -0.5f * grid.width(), -0.5f * grid.height(), 0.0f };
+    auto gv = std::make_unique<morph::GridVisual<float>>(&grid, offset);
+    v.bindmodel (gv);
+    gv->gridVisMode = morph::GridVisMode::Texture;
+    gv->setScalarData (&data);
+    gv->cm.setType (morph::ColourMapType::Cork);
+    gv->colourScale.do_autoscale = false;
+    gv->colourScale.compute_scaling (-1, 1);
+    gv->addLabel (std::string("GridVisMode::Texture, cm: ") + gv->cm.getTypeStr(), morph::vec<float>({0,-0.1,0}), morph::TextFeatures(0.03f));
+    gv->finalize();
+    auto gvp = v.addVisualModel (gv);
+
+    using sc = std::chrono::steady_clock;
+    sc::time_point t0 = sc::now();
+    unsigned int fcount = 0;
+    unsigned int incrementer = 0;
+    while (!v.readyToFinish) {
+        v.poll();
+
+        float length = (incrementer++ % 1000) * 0.01f;
+#pragma omp parallel for
+        for (unsigned int ri = 0; ri < grid.n(); ++ri) {
+            auto coord = grid[ri];
+            data[ri] = std::sin (length * coord[0]) * std::sin (0.5f * length * coord[1]);
+        }
+        // In Texture mode, reinitColours() only re-uploads the data texture
+        gvp->reinitColours();
+        v.render();
+
+        if (++fcount == 50) {
+            double secs = std::chrono::duration<double>(sc::now() - t0).count();
+            fps_tm->setupText (std::string("FPS: ") + std::to_string (static_cast<int>(std::round (fcount / secs))));
+            fcount = 0;
+            t0 = sc::now();
+        }
+    }
+
+    return 0;
+}
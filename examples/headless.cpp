@@ -0,0 +1,69 @@
+/*
+ * Render a scene with no window or display (e.g. on a cluster node) and save each frame
+ * as a PNG. Uses morph::VisualHeadless, which renders into a framebuffer object on an EGL
+ * context.
+ *
+ * Usage: ./headless [nframes]
+ */
+#include <morph/VisualHeadless.h>
+#include <morph/ScatterVisual.h>
+#include <morph/ColourMap.h>
+#include <morph/scale.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <string>
+#include <cmath>
+
+int main (int argc, char** argv)
+{
+    int nframes = argc > 1 ? std::stoi (argv[1]) : 10;
+
+    int rtn = 0;
+    try {
+        morph::VisualHeadless<> v (1024, 768, "morph::VisualHeadless");
+        v.showCoordArrows = true;
+        v.lightingEffects();
+
+        morph::vvec<morph::vec<float, 3>> points (20*20);
+        morph::vvec<float> data (20*20);
+
+        morph::scale<float> scale1;
+        scale1.setParams (1.0, 0.0);
+        auto sv = std::make_unique<morph::ScatterVisual<float>> (morph::vec<float>{0,0,0});
+        v.bindmodel (sv);
+        sv->setDataCoords (&points);
+        sv->setScalarData (&data);
+        sv->radiusFixed = 0.03f;
+        sv->colourScale = scale1;
+        sv->cm.setType (morph::ColourMapType::Plasma);
+        sv->finalize();
+        auto svp = v.addVisualModel (sv);
+
+        for (int f = 0; f < nframes; ++f) {
+            // A surface that changes with each frame
+            float phase = 0.2f * f;
+            size_t k = 0;
+            for (int i = -10; i < 10; ++i) {
+                for (int j = -10; j < 10; ++j) {
+                    float x = 0.1f * i;
+                    float y = 0.1f * j;
+                    float z = x * std::exp(-(x*x) - (y*y)) * std::cos (phase);
+                    points[k] = {x, y, z};
+                    data[k] = z;
+                    k++;
+                }
+            }
+            svp->reinit();
+            v.render();
+            std::string fname = std::string("./headless_") + std::to_string (f) + ".png";
+            v.saveImage (fname);
+            std::cout << "Saved " << fname << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
@@ -0,0 +1,62 @@
+/*
+ * Show a high order HEALPix map with HealpixVisual's lod mode, which draws the map from a
+ * texture on a mesh that is refined only where the view comes close. The map is updated
+ * every frame by changing only the data texture. Zoom in to see the pixels.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <sstream>
+#include <morph/Visual.h>
+#include <morph/HealpixVisual.h>
+
+int main (int argc, char** argv)
+{
+    int ord = 10; // HEALPix order. At order 10 there are 12.6 M pixels
+    if (argc > 1) { ord = std::atoi (argv[1]); }
+
+    morph::Visual v(1024, 768, "Healpix level of detail");
+
+    auto hpv = std::make_unique<morph::HealpixVisual<float>> (morph::vec<float>{0,0,0});
+    v.bindmodel (hpv);
+    hpv->lod = true;
+    hpv->set_order (ord);
+    hpv->cm.setType (morph::ColourMapType::Plasma);
+    hpv->colourScale.do_autoscale = false;
+    hpv->colourScale.compute_scaling (-1.0f, 1.0f);
+
+    // A pattern of waves, with the NEST index added as fine detail
+    std::vector<int64_t> nest (hpv->n_pixels());
+    for (int64_t p = 0; p < hpv->n_pixels(); ++p) { nest[p] = p; }
+    std::vector<hp::t_ang> angs (hpv->n_pixels());
+    hp::nest2ang (hp::ring_table (hpv->get_nside()), nest, angs);
+    auto fill = [&hpv, &angs](const float phase) {
+        for (int64_t p = 0; p < hpv->n_pixels(); ++p) {
+            const float th = static_cast<float>(angs[p].theta);
+            const float ph = static_cast<float>(angs[p].phi);
+            hpv->pixeldata[p] = 0.8f * std::sin (6.0f * th + phase) * std::cos (5.0f * ph)
+            + 0.2f * static_cast<float>(p % 16) / 16.0f;
+        }
+    };
+    fill (0.0f);
+
+    std::stringstream ss;
+    constexpr bool centre_horz = true;
+    ss << "Order " << ord << " HEALPix with " << hpv->n_pixels() << " pixels\n";
+    hpv->addLabel (ss.str(), {0.0f, -1.2f , 0.0f }, morph::TextFeatures{0.08f, centre_horz});
+
+    hpv->finalize();
+    auto hpvp = v.addVisualModel (hpv);
+
+    float phase = 0.0f;
+    while (!v.readyToFinish) {
+        v.waitevents (0.018);
+        phase += 0.05f;
+        fill (phase);
+        // With a fixed colourScale, this re-computes the texture levels but no vertices
+        hpvp->reinitColours();
+        v.render();
+    }
+
+    return 0;
+}
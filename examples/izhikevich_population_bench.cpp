@@ -0,0 +1,102 @@
+/*
+ * Benchmark morph::nn::IzhikevichPopulation against the loop of examples/izhikevich.cpp
+ * applied to a vector of single neuron objects. Both run unconnected neurons with a spread of
+ * input currents; the population is then run again with random sparse connections.
+ *
+ * Usage: ./izhikevich_population_bench [num_neurons] [num_steps] [fan_out]
+ *
+ * Author: Seb James
+ */
+
+#include <morph/nn/IzhikevichPopulation.h>
+#include <morph/Random.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+
+using std::chrono::microseconds;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+
+// The neuron of examples/izhikevich.cpp, cut down to its step function
+struct izhi
+{
+    float I = 0.0f;
+    float u = -10.0f;
+    float v = -70.0f;
+    float a = 0.03f;
+    float b = 0.193f;
+    float c = -65.0f;
+    float d = 0.05f;
+    float A = 0.032f;
+    float B = 4.0f;
+    float C = 113.147f;
+    float T = 0.4f;
+    float SI = 5.0f;
+    float vpeak = 30.0f;
+    float dv (const float _u, const float _v) { return (A*T) * _v * _v + (B*T) * _v + (C*T) - _u * T + I * (T/SI); }
+    float du (const float _u, const float _v) { return a * T * (b * _v - _u); }
+    void step()
+    {
+        bool spike = (v > vpeak);
+        float _du = this->du (u, v);
+        v = spike ? c       : (v + this->dv (u, v));
+        u = spike ? (u + d) : (u + _du);
+    }
+};
+
+int main (int argc, char** argv)
+{
+    unsigned int N = argc > 1 ? std::stoul (argv[1]) : 1000000;
+    unsigned int nsteps = argc > 2 ? std::stoul (argv[2]) : 200;
+    unsigned int fan_out = argc > 3 ? std::stoul (argv[3]) : 100;
+
+    morph::RandUniform<float> rng (0.0f, 10.0f, 1);
+    std::vector<float> current (N);
+    for (auto& i : current) { i = rng.get(); }
+
+    // The example's way: an array of structures, stepped one by one
+    std::vector<izhi> neurons (N);
+    for (unsigned int i = 0; i < N; ++i) { neurons[i].I = current[i]; }
+    auto t0 = steady_clock::now();
+    for (unsigned int t = 0; t < nsteps; ++t) {
+        for (auto& n : neurons) { n.step(); }
+    }
+    double t_scalar = duration_cast<microseconds>(steady_clock::now() - t0).count() / 1000.0;
+
+    // The population, as a structure of arrays
+    morph::nn::IzhikevichPopulation<float> pop (N);
+    for (unsigned int i = 0; i < N; ++i) { pop.Iext[i] = current[i]; }
+    t0 = steady_clock::now();
+    for (unsigned int t = 0; t < nsteps; ++t) { pop.step(); }
+    double t_pop = duration_cast<microseconds>(steady_clock::now() - t0).count() / 1000.0;
+
+    // Compare the end states
+    float maxdiff = 0.0f;
+    for (unsigned int i = 0; i < N; ++i) { maxdiff = std::max (maxdiff, std::abs (neurons[i].v - pop.v[i])); }
+
+    // The population again, now connected
+    morph::RandUniform<unsigned int> rng_n (0, N - 1, 2);
+    morph::RandUniform<float> rng_w (-0.5f, 1.0f, 3);
+    pop.reset();
+    for (unsigned int i = 0; i < N; ++i) {
+        for (unsigned int k = 0; k < fan_out; ++k) { pop.connect (i, rng_n.get(), rng_w.get()); }
+    }
+    pop.setNet();
+    unsigned long long nspikes = 0;
+    t0 = steady_clock::now();
+    for (unsigned int t = 0; t < nsteps; ++t) {
+        pop.step();
+        nspikes += pop.spikes.size();
+    }
+    double t_net = duration_cast<microseconds>(steady_clock::now() - t0).count() / 1000.0;
+
+    std::cout << N << " neurons, " << nsteps << " steps\n";
+    std::cout << "  example loop (array of structures): " << t_scalar << " ms\n";
+    std::cout << "  IzhikevichPopulation:               " << t_pop << " ms ("
+              << t_scalar / t_pop << "x), max |dv| at end " << maxdiff << "\n";
+    std::cout << "  with " << pop.num_connections() << " connections: " << t_net << " ms, "
+              << nspikes << " spikes propagated\n";
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * A dashboard of 40 numbers that change every frame. The labels are made updatable with
+ * VisualTextModel::reserve, so each frame only the quads of the digits that have changed are
+ * rewritten, in place of a full setupText rebuild. Press 't' to switch between updateNumber and
+ * setupText and compare the update times.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <sstream>
+
+#include <morph/vec.h>
+#include <morph/Visual.h>
+#include <morph/VisualTextModel.h>
+
+// A Visual that toggles the update method with the 't' key
+struct live_visual final : public morph::Visual<>
+{
+    live_visual (int width, int height, const std::string& title) : morph::Visual<> (width, height, title) {}
+    bool use_setup = false;
+protected:
+    void key_callback_extra (int key, [[maybe_unused]] int scancode, int action, [[maybe_unused]] int mods) override
+    {
+        if (key == morph::key::t && action == morph::keyaction::press) {
+            this->use_setup = !this->use_setup;
+            std::cout << "Now updating with " << (this->use_setup ? "setupText" : "updateNumber") << std::endl;
+        }
+    }
+};
+
+int main()
+{
+    live_visual v (1200, 800, "40 live labels");
+
+    constexpr unsigned int n_rows = 10;
+    constexpr unsigned int n_cols = 4;
+    std::vector<morph::VisualTextModel<>*> labels (n_rows * n_cols, nullptr);
+    for (unsigned int j = 0; j < n_rows; ++j) {
+        for (unsigned int i = 0; i < n_cols; ++i) {
+            morph::VisualTextModel<>* tm = nullptr;
+            v.addLabel ("0.000", { -0.4f + 0.25f * i, 0.3f - 0.06f * j, 0.0f }, tm, morph::TextFeatures (0.03f));
+            // Room for a sign, 4 digits, a point and 3 decimal places
+            tm->reserve (10);
+            labels[j * n_cols + i] = tm;
+        }
+    }
+    morph::VisualTextModel<>* time_tm = nullptr;
+    v.addLabel ("", { -0.4f, -0.35f, 0.0f }, time_tm, morph::TextFeatures (0.025f));
+    time_tm->reserve (64);
+
+    using sc = std::chrono::steady_clock;
+    sc::duration update_dur{0};
+    unsigned int frame = 0;
+    while (v.readyToFinish == false) {
+        v.waitevents (0.00001);
+        // render() leaves the GL context current for the label updates
+        v.render();
+
+        sc::time_point t0 = sc::now();
+        for (unsigned int l = 0; l < labels.size(); ++l) {
+            const double value = 100.0 * std::sin (0.01 * frame * (1.0 + 0.1 * l));
+            if (v.use_setup) {
+                std::stringstream ss;
+                ss.precision (3);
+                ss << std::fixed << value;
+                labels[l]->setupText (ss.str());
+            } else {
+                labels[l]->updateNumber (value, 3, 9);
+            }
+        }
+        update_dur += sc::now() - t0;
+
+        if (++frame % 200 == 0) {
+            std::stringstream ss;
+            ss << (v.use_setup ? "setupText: " : "updateNumber: ")
+               << std::chrono::duration<double, std::micro>(update_dur).count() / 200.0 << " us per frame for 40 labels";
+            time_tm->updateText (ss.str());
+            update_dur = sc::duration{0};
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * A front of the Fisher-KPP equation, du/dt = D lap(u) + r u (1 - u), spreading out from a
+ * spot on a morph::QuadGrid. Every few steps the grid is refined about the front (where the
+ * gradient is large) and coarsened behind and ahead of it, so the fine elements follow the
+ * front and the number of elements stays small. QuadGridVisual shows the leaves' outlines.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <memory>
+
+#include <morph/vec.h>
+#include <morph/Visual.h>
+#include <morph/QuadGrid.h>
+#include <morph/QuadGridVisual.h>
+
+int main()
+{
+    morph::Visual v(1200, 1000, "A front on a morph::QuadGrid");
+
+    // 32 x 32 root cells, refined up to 4 levels (to the resolution of a 512 x 512 grid)
+    morph::QuadGrid<float> qg (32, 32, { 1.0f / 32.0f, 1.0f / 32.0f }, { 0.0f, 0.0f }, 4);
+    std::vector<float> u (qg.n(), 0.0f);
+    auto init_spot = [&qg, &u]() {
+        for (std::size_t i = 0; i < qg.n(); ++i) {
+            morph::vec<float, 2> d = qg.coord (i) - morph::vec<float, 2>{ 0.5f, 0.5f };
+            u[i] = d.length() < 0.05f ? 1.0f : 0.0f;
+        }
+    };
+    // Resolve the initial spot before starting
+    for (unsigned int l = 0; l < qg.get_max_level(); ++l) {
+        init_spot();
+        qg.adapt (qg.gradient (u), 4.0f, 1.0f, { &u });
+    }
+    init_spot();
+
+    auto qgv = std::make_unique<morph::QuadGridVisual<float>>(&qg, morph::vec<float>{ -0.5f, -0.5f, 0.0f });
+    v.bindmodel (qgv);
+    qgv->setScalarData (&u);
+    qgv->colourScale.do_autoscale = false;
+    qgv->colourScale.compute_scaling (0.0f, 1.0f);
+    qgv->cm.setType (morph::ColourMapType::Inferno);
+    qgv->show_borders = true;
+    qgv->finalize();
+    auto qgvp = v.addVisualModel (qgv);
+
+    morph::VisualTextModel<>* info_tm;
+    v.addLabel ("", { -0.5f, -0.6f, 0.0f }, info_tm);
+
+    constexpr float D = 2e-5f;
+    constexpr float r = 5.0f;
+    std::vector<float> lap;
+    unsigned int step = 0;
+    while (!v.readyToFinish) {
+        // dt is limited by the finest elements: dt < h^2 / (4 D)
+        const float h = qg.get_dx()[0] / static_cast<float>(1u << qg.get_max_level());
+        const float dt = 0.2f * h * h / D;
+        for (int s = 0; s < 10; ++s, ++step) {
+            qg.laplacian (u, lap);
+            for (std::size_t i = 0; i < qg.n(); ++i) { u[i] += dt * (D * lap[i] + r * u[i] * (1.0f - u[i])); }
+        }
+        // Refine about the front, coarsen elsewhere
+        qg.adapt (qg.gradient (u), 4.0f, 1.0f, { &u });
+        qgvp->reinit();
+
+        std::stringstream ss;
+        ss << "step " << step << ": " << qg.n() << " elements (a uniform grid would have " << (512 * 512) << ")";
+        info_tm->setupText (ss.str());
+        v.render();
+        v.poll();
+    }
+
+    return 0;
+}
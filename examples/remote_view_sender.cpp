@@ -0,0 +1,59 @@
+/*
+ * A simulation on a node with no display, whose scene is streamed to remote viewers by
+ * morph::remote_sender. The HexGrid's mesh is sent to each viewer once; after that, only its
+ * colours. Watch it with ./remote_view_viewer (through an ssh tunnel to port 40404, or with
+ * the sender listening on "0.0.0.0").
+ *
+ * Usage: ./remote_view_sender [nframes]
+ */
+#include <morph/VisualHeadless.h>
+#include <morph/HexGridVisual.h>
+#include <morph/HexGrid.h>
+#include <morph/remote_view.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+int main (int argc, char** argv)
+{
+    const int nframes = argc > 1 ? std::stoi (argv[1]) : 100000;
+
+    int rtn = 0;
+    try {
+        morph::VisualHeadless<> v (1024, 768, "morph::remote_sender");
+        morph::remote_sender<> sender (40404);
+        std::cout << "Serving the scene on port " << sender.port() << std::endl;
+
+        morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+        hg.setCircularBoundary (0.6f);
+        std::vector<float> data (hg.num(), 0.0f);
+        auto hgv = std::make_unique<morph::HexGridVisual<float>>(&hg, morph::vec<float, 3>{ 0.0f, 0.0f, 0.0f });
+        v.bindmodel (hgv);
+        hgv->cm.setType (morph::ColourMapType::Plasma);
+        hgv->zScale.setParams (0.0f, 0.0f);
+        hgv->colourScale.compute_scaling (-1.0f, 1.0f);
+        hgv->setScalarData (&data);
+        hgv->finalize();
+        hgv->addLabel ("A travelling wave", { -0.6f, -0.7f, 0.0f });
+        auto hgvp = v.addVisualModel (hgv);
+
+        for (int f = 0; f < nframes; ++f) {
+            for (unsigned int h = 0; h < hg.num(); ++h) {
+                data[h] = std::sin (20.0f * hg.d_x[h] - 0.1f * f) * std::cos (10.0f * hg.d_y[h]);
+            }
+            hgvp->updateData (&data);
+            // Nothing is drawn here: the viewers render the models themselves
+            sender.publish (v);
+            std::this_thread::sleep_for (std::chrono::milliseconds (16));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
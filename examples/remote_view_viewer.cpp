@@ -0,0 +1,34 @@
+/*
+ * Show the scene streamed by ./remote_view_sender (or by any program that publishes its
+ * Visual with morph::remote_sender). The scene is rendered here, so it can be rotated and
+ * zoomed as usual.
+ *
+ * Usage: ./remote_view_viewer [host] [port]
+ */
+#include <morph/Visual.h>
+#include <morph/remote_view.h>
+#include <iostream>
+#include <string>
+
+int main (int argc, char** argv)
+{
+    const std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    const unsigned short port = argc > 2 ? static_cast<unsigned short>(std::stoi (argv[2])) : 40404;
+
+    int rtn = 0;
+    try {
+        morph::Visual v (1024, 768, "morph::remote_receiver: " + host);
+        v.showCoordArrows = true;
+        morph::remote_receiver<> receiver (host, port);
+        while (!v.readyToFinish && receiver.connected()) {
+            receiver.update (v, 10);
+            v.poll();
+            v.render();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
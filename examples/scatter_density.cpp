@@ -0,0 +1,74 @@
+/*
+ * A scatter plot of ten million points, drawn as a density. The points are binned into a
+ * grid and each bin is coloured by the (log) number of points in it, so the cost of drawing
+ * is set by the number of bins. setDensityWindow rebins just the points in a window, as on
+ * zooming in.
+ */
+#include <morph/Visual.h>
+#include <morph/ColourMap.h>
+#include <morph/ScatterVisual.h>
+#include <morph/Random.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::Visual v(1024, 768, "morph::ScatterVisual density");
+    v.showCoordArrows = true;
+
+    try {
+        // Two overlapping normal distributions
+        constexpr std::size_t n = 10000000;
+        morph::RandNormal<float> rng (0.0f, 1.0f);
+        std::vector<float> r = rng.get (2 * n);
+        morph::vvec<morph::vec<float, 3>> points (n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const float s = i % 3 == 0 ? 0.15f : 0.3f;
+            const float c = i % 3 == 0 ? 0.4f : -0.2f;
+            points[i] = { c + s * r[2 * i], s * r[2 * i + 1], 0.0f };
+        }
+
+        auto sv = std::make_unique<morph::ScatterVisual<float>> (morph::vec<float>{ -0.5f, 0.0f, 0.0f });
+        v.bindmodel (sv);
+        sv->setDataCoords (&points);
+        sv->density = true;
+        sv->density_bins = { 400u, 300u };
+        sv->densityScale.setlog();
+        sv->densityScale.do_autoscale = true;
+        sv->cm.setType (morph::ColourMapType::Plasma);
+        sv->finalize();
+        auto svp = v.addVisualModel (sv);
+
+        // A second copy, zoomed in on the narrower distribution
+        auto sz = std::make_unique<morph::ScatterVisual<float>> (morph::vec<float>{ 1.2f, 0.0f, 0.0f });
+        v.bindmodel (sz);
+        sz->setDataCoords (&points);
+        sz->density = true;
+        sz->density_bins = { 200u, 200u };
+        sz->densityScale.setlog();
+        sz->densityScale.do_autoscale = true;
+        sz->cm.setType (morph::ColourMapType::Plasma);
+        sz->finalize();
+        auto szp = v.addVisualModel (sz);
+        szp->setDensityWindow ({ 0.2f, -0.2f }, { 0.6f, 0.2f });
+
+        std::cout << svp->density_counts.size() << " bins for " << n << " points\n";
+
+        v.render();
+        while (v.readyToFinish == false) {
+            v.waitevents (0.018);
+            v.render();
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
@@ -124,7 +124,7 @@ int main()
                                                                         morph::ColourMapType::Rainbow);
                 v.bindmodel (vmp);
                 clrs.linspace (0, 0.66, vneighb_vertices[i].size());
-                vmp->scalarData = &clrs;
+                vmp->setScalarData (&clrs);
                 vmp->colourScale.compute_scaling (0, 1);
                 vmp->do_quiver_length_scaling = false; // Don't (auto)scale the lengths of the vectors
                 vmp->quiver_length_gain = 0.5f;        // Apply a fixed gain to the length of the quivers on screen
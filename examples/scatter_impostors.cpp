@@ -0,0 +1,69 @@
+/*
+ * A million cells drawn as spheres. With sphere_impostors, each sphere is one quad on which
+ * the fragment shader ray casts the sphere, so the spheres stay round at any zoom while the
+ * GPU processes four vertices per cell rather than a few hundred. A SphereVisual drawn the
+ * same way sits at the centre of the cloud.
+ */
+#include <morph/Visual.h>
+#include <morph/ColourMap.h>
+#include <morph/ScatterVisual.h>
+#include <morph/SphereVisual.h>
+#include <morph/Random.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <vector>
+#include <iostream>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::Visual v(1024, 768, "morph::ScatterVisual sphere impostors");
+    v.showCoordArrows = true;
+    v.lightingEffects();
+
+    try {
+        // Cells placed uniformly in a cube, coloured by their distance from its centre
+        constexpr std::size_t n = 1000000;
+        morph::RandUniform<float> rng (-1.0f, 1.0f);
+        std::vector<float> r = rng.get (3 * n);
+        morph::vvec<morph::vec<float, 3>> points (n);
+        morph::vvec<float> data (n);
+        for (std::size_t i = 0; i < n; ++i) {
+            points[i] = { r[3 * i], r[3 * i + 1], r[3 * i + 2] };
+            data[i] = points[i].length();
+        }
+
+        auto sv = std::make_unique<morph::ScatterVisual<float>> (morph::vec<float>{ 0.0f, 0.0f, 0.0f });
+        v.bindmodel (sv);
+        sv->instanced = true;
+        sv->sphere_impostors = true;
+        sv->setDataCoords (&points);
+        sv->setScalarData (&data);
+        sv->radiusFixed = 0.004f;
+        sv->cm.setType (morph::ColourMapType::Viridis);
+        sv->finalize();
+        auto svp = v.addVisualModel (sv);
+
+        auto sp = std::make_unique<morph::SphereVisual<>> (morph::vec<float>{ 0.0f, 0.0f, 0.0f }, 0.2f,
+                                                           std::array<float, 3>{ 1.0f, 0.3f, 0.1f });
+        v.bindmodel (sp);
+        sp->sphere_impostors = true;
+        sp->finalize();
+        v.addVisualModel (sp);
+
+        std::cout << svp->numInstances() << " spheres, four vertices each\n";
+
+        v.render();
+        while (v.readyToFinish == false) {
+            v.waitevents (0.018);
+            v.render();
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    return rtn;
+}
@@ -45,6 +45,10 @@ public:
     alignas(Flt) Flt D_A = 0.1;
     alignas(Flt) Flt D_B = 0.1;
 
+    //! Laplacians of A and B, reused at each stage of each step
+    std::vector<Flt> lapA;
+    std::vector<Flt> lapB;
+
     /*!
      * Simple constructor; no arguments. Simply call RD_Base constructor.
      */
@@ -67,6 +71,13 @@ public:
         // a member of this class (via its parent, RD_Base)
         this->resize_vector_variable (this->A);
         this->resize_vector_variable (this->B);
+        this->resize_vector_variable (this->lapA);
+        this->resize_vector_variable (this->lapB);
+        // A and B are the state to integrate and to save in a checkpoint
+        this->integrate_var (this->A);
+        this->integrate_var (this->B);
+        this->checkpoint_var ("A", this->A);
+        this->checkpoint_var ("B", this->B);
     }
 
     /*!
@@ -81,7 +92,8 @@ public:
     }
 
     /*!
-     * Save the variables to HDF5.
+     * Save the variables to HDF5. Copies of A and B are written out by a background
+     * thread, so the simulation need not wait for the disk.
      */
     void save()
     {
@@ -90,170 +102,49 @@ public:
         fname.width(5);
         fname.fill('0');
         fname << this->stepCount << ".h5";
-        morph::HdfData data(fname.str());
-        std::stringstream path;
-        // The A variables
-        path << "/A";
-        data.add_contained_vals (path.str().c_str(), this->A);
-        // The B variable
-        path.str("");
-        path.clear();
-        path << "/B";
-        data.add_contained_vals (path.str().c_str(), this->B);
-    }
-
-    /*!
-     * Schnakenberg computation for reagent A
-     */
-    void compute_dAdt (std::vector<Flt>& A_, std::vector<Flt>& dAdt)
-    {
-        std::vector<Flt> lapA(this->nhex, 0.0);
-        this->compute_laplace (A_, lapA);
-#pragma omp parallel for
-        for (unsigned int h=0; h<this->nhex; ++h) {
-            dAdt[h] = this->k1 - (this->k2 * A_[h])
-                + (this->k3 * A_[h] * A_[h] * this->B[h]) + this->D_A * lapA[h];
-        }
+        typename morph::hdf_writer<Flt>::job j;
+        j.filename = fname.str();
+        j.add ("/A", this->A);
+        j.add ("/B", this->B);
+        this->save_async (std::move (j));
     }
 
     /*!
-     * Schnakenberg computation for reagent B
+     * The Schnakenberg derivatives of A (*y[0]) and B (*y[1]), for the integrator
      */
-    void compute_dBdt (std::vector<Flt>& B_, std::vector<Flt>& dBdt)
+    void derivatives (Flt, const typename morph::rk_integrator<Flt>::state& y,
+                      typename morph::rk_integrator<Flt>::derivs& dydt)
     {
-        std::vector<Flt> lapB(this->nhex, 0.0);
-        this->compute_laplace (B_, lapB);
+        const std::vector<Flt>& A_ = *y[0];
+        const std::vector<Flt>& B_ = *y[1];
+        this->compute_laplace (A_, this->lapA);
+        this->compute_laplace (B_, this->lapB);
 #pragma omp parallel for
         for (unsigned int h=0; h<this->nhex; ++h) {
-            // G = k4        - k3 A^2 B
-            dBdt[h] = this->k4 - (this->k3 * this->A[h] * this->A[h] * B_[h]) + this->D_B * lapB[h];
+            // F = k1 - k2 A + k3 A^2 B; G = k4 - k3 A^2 B
+            const Flt a2b = this->k3 * A_[h] * A_[h] * B_[h];
+            dydt[0][h] = this->k1 - (this->k2 * A_[h]) + a2b + this->D_A * this->lapA[h];
+            dydt[1][h] = this->k4 - a2b + this->D_B * this->lapB[h];
         }
     }
 
     /*!
-     * Simulate one timestep of the model
+     * Simulate one timestep of the model with 4th order Runge-Kutta
      */
     void step()
     {
         this->stepCount++;
+        this->step_rk4 ([this](Flt t, const auto& y, auto& dydt) { this->derivatives (t, y, dydt); });
+    }
 
-        // 1. 4th order Runge-Kutta computation for A
-        {
-            // Atst: "A at a test point". Atst is a temporary estimate for A.
-            std::vector<Flt> Atst(this->nhex, 0.0);
-            std::vector<Flt> dAdt(this->nhex, 0.0);
-            std::vector<Flt> K1(this->nhex, 0.0);
-            std::vector<Flt> K2(this->nhex, 0.0);
-            std::vector<Flt> K3(this->nhex, 0.0);
-            std::vector<Flt> K4(this->nhex, 0.0);
-
-            /*
-             * Stage 1
-             */
-            this->compute_dAdt (this->A, dAdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K1[h] = dAdt[h] * this->dt;
-                Atst[h] = this->A[h] + K1[h] * 0.5 ;
-            }
-
-            /*
-             * Stage 2
-             */
-            this->compute_dAdt (Atst, dAdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K2[h] = dAdt[h] * this->dt;
-                Atst[h] = this->A[h] + K2[h] * 0.5;
-            }
-
-            /*
-             * Stage 3
-             */
-            this->compute_dAdt (Atst, dAdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K3[h] = dAdt[h] * this->dt;
-                Atst[h] = this->A[h] + K3[h];
-            }
-
-            /*
-             * Stage 4
-             */
-            this->compute_dAdt (Atst, dAdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K4[h] = dAdt[h] * this->dt;
-            }
-
-            /*
-             * Final sum together. This could be incorporated in the for loop for
-             * Stage 4, but I've separated it out for pedagogy.
-             */
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                A[h] += ((K1[h] + 2.0 * (K2[h] + K3[h]) + K4[h])/(Flt)6.0);
-            }
-        }
-
-        // 2. 4th order Runge-Kutta computation of B
-        {
-            // Btst: "B at a test point". Btst is a temporary estimate for B.
-            std::vector<Flt> Btst(this->nhex, 0.0);
-            std::vector<Flt> dBdt(this->nhex, 0.0);
-            std::vector<Flt> K1(this->nhex, 0.0);
-            std::vector<Flt> K2(this->nhex, 0.0);
-            std::vector<Flt> K3(this->nhex, 0.0);
-            std::vector<Flt> K4(this->nhex, 0.0);
-
-            /*
-             * Stage 1
-             */
-            this->compute_dBdt (this->B, dBdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K1[h] = dBdt[h] * this->dt;
-                Btst[h] = this->B[h] + K1[h] * 0.5 ;
-            }
-
-            /*
-             * Stage 2
-             */
-            this->compute_dBdt (Btst, dBdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K2[h] = dBdt[h] * this->dt;
-                Btst[h] = this->B[h] + K2[h] * 0.5;
-            }
-
-            /*
-             * Stage 3
-             */
-            this->compute_dBdt (Btst, dBdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K3[h] = dBdt[h] * this->dt;
-                Btst[h] = this->B[h] + K3[h];
-            }
-
-            /*
-             * Stage 4
-             */
-            this->compute_dBdt (Btst, dBdt);
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                K4[h] = dBdt[h] * this->dt;
-            }
-
-            /*
-             * Final sum together. This could be incorporated in the for loop for
-             * Stage 4, but I've separated it out for pedagogy.
-             */
-#pragma omp parallel for
-            for (unsigned int h=0; h<this->nhex; ++h) {
-                B[h] += ((K1[h] + 2.0 * (K2[h] + K3[h]) + K4[h])/(Flt)6.0);
-            }
-        }
+    //! RD_Base's accounting, plus the Laplacians, which are not checkpointed
+    morph::memory_usage memory_usage() const override
+    {
+        morph::memory_usage mu = morph::RD_Base<Flt>::memory_usage();
+        mu.name = "RD_Schnakenberg";
+        mu.add ("lapA", this->lapA);
+        mu.add ("lapB", this->lapB);
+        return mu;
     }
 
 }; // RD_Schnakenberg
@@ -0,0 +1,93 @@
+/*
+ * A morphologica example: benchmark the two stencil modes of RD_Base using the
+ * Schnakenberg RD system. Times compute_laplace with the default (branching) stencil
+ * and with the ghost stencil (RD_Base::ghost_stencil = true), checks that they give
+ * the same results, then runs a number of full model steps with each.
+ *
+ * Usage: ./schnak_stencil_bench [hextohex_d] [nsteps]
+ *
+ * Author: Seb James
+ */
+
+#ifndef FLT
+# error "Please define FLT when compiling (hint: See CMakeLists.txt)"
+#endif
+
+#include "rd_schnakenberg.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+
+using std::chrono::microseconds;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+
+// Set up an RD_Schnakenberg with an elliptical boundary
+void setup (RD_Schnakenberg<FLT>& RD, float hextohex_d, bool ghost)
+{
+    RD.svgpath = "";
+    RD.ellipse_a = 60.0f;
+    RD.ellipse_b = 20.0f;
+    RD.hextohex_d = hextohex_d;
+    RD.hexspan = 155.0f;
+    RD.ghost_stencil = ghost;
+    RD.allocate();
+    RD.set_dt (0.005);
+    RD.k1 = 0.01;
+    RD.k4 = 1.7;
+    RD.D_A = 1;
+    RD.D_B = 20;
+    RD.init();
+}
+
+int main (int argc, char** argv)
+{
+    float hextohex_d = argc > 1 ? std::stof (argv[1]) : 0.25f;
+    unsigned int nsteps = argc > 2 ? std::stoul (argv[2]) : 100;
+    constexpr unsigned int nlaplace = 1000;
+
+    RD_Schnakenberg<FLT> RD_branch;
+    setup (RD_branch, hextohex_d, false);
+    RD_Schnakenberg<FLT> RD_ghost;
+    setup (RD_ghost, hextohex_d, true);
+    // Start both from the same state
+    RD_ghost.A = RD_branch.A;
+    RD_ghost.B = RD_branch.B;
+
+    std::cout << "Grid of " << RD_branch.nhex << " hexes\n";
+
+    std::vector<FLT> lap_branch (RD_branch.nhex, FLT{0});
+    std::vector<FLT> lap_ghost (RD_ghost.nhex, FLT{0});
+
+    steady_clock::time_point t0 = steady_clock::now();
+    for (unsigned int i = 0; i < nlaplace; ++i) { RD_branch.compute_laplace (RD_branch.A, lap_branch); }
+    steady_clock::time_point t1 = steady_clock::now();
+    for (unsigned int i = 0; i < nlaplace; ++i) { RD_ghost.compute_laplace (RD_ghost.A, lap_ghost); }
+    steady_clock::time_point t2 = steady_clock::now();
+
+    double us_branch = static_cast<double>(duration_cast<microseconds>(t1 - t0).count()) / nlaplace;
+    double us_ghost = static_cast<double>(duration_cast<microseconds>(t2 - t1).count()) / nlaplace;
+    std::cout << "compute_laplace: branching stencil " << us_branch << " us/call, ghost stencil "
+              << us_ghost << " us/call (" << us_branch / us_ghost << "x)\n";
+
+    FLT maxdiff = FLT{0};
+    for (unsigned int h = 0; h < RD_branch.nhex; ++h) {
+        maxdiff = std::max (maxdiff, std::abs (lap_branch[h] - lap_ghost[h]));
+    }
+    std::cout << "Max difference between Laplacians: " << maxdiff << "\n";
+
+    t0 = steady_clock::now();
+    for (unsigned int i = 0; i < nsteps; ++i) { RD_branch.step(); }
+    t1 = steady_clock::now();
+    for (unsigned int i = 0; i < nsteps; ++i) { RD_ghost.step(); }
+    t2 = steady_clock::now();
+
+    us_branch = static_cast<double>(duration_cast<microseconds>(t1 - t0).count()) / nsteps;
+    us_ghost = static_cast<double>(duration_cast<microseconds>(t2 - t1).count()) / nsteps;
+    std::cout << "step(): branching stencil " << us_branch << " us/step, ghost stencil "
+              << us_ghost << " us/step (" << us_branch / us_ghost << "x)\n";
+
+    return maxdiff == FLT{0} ? 0 : 1;
+}
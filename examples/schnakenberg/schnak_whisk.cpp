@@ -341,6 +341,9 @@ int main (int argc, char **argv)
         }
     }
 
+    // Let the background writer finish saving the data frames
+    RD.save_wait();
+
     // Before saving the json, we'll place any additional useful info
     // in there, such as the FLT. If float_width is 4, then
     // results were computed with single precision, if 8, then double
@@ -0,0 +1,97 @@
+/*
+ * Show the live state of a simulation that publishes with morph::shm_publisher (for example,
+ * an RD_Base model after live_open()). The state is read in place from shared memory, so
+ * watching a simulation costs it nothing.
+ *
+ * Usage: shm_state_view /shm_name [field]
+ *
+ * The field (the first non-constant field, if not given) is shown as a scatter of spheres at
+ * the positions given by the constant fields "x" and "y".
+ */
+#include <morph/Visual.h>
+#include <morph/ScatterVisual.h>
+#include <morph/ColourMap.h>
+#include <morph/shm_state.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <nlohmann/json.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <span>
+#include <thread>
+#include <chrono>
+
+int main (int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " /shm_name [field]\n";
+        return 1;
+    }
+    const std::string name = argv[1];
+
+    morph::shm_reader rd (name);
+    std::cout << "Waiting for " << name << "...\n";
+    while (!rd.open()) { std::this_thread::sleep_for (std::chrono::milliseconds (200)); }
+
+    std::string field = argc > 2 ? argv[2] : "";
+    bool is_double = false;
+    for (const auto& f : rd.fields()) {
+        if (f.constant) { continue; }
+        if (field.empty()) { field = f.name; }
+        if (f.name == field) { is_double = f.elem_bytes == 8; }
+    }
+    if (field.empty()) {
+        std::cerr << name << " has no fields to show\n";
+        return 1;
+    }
+
+    // The positions are constant, so they're read once
+    std::span<const float> x = rd.constant<float> ("x");
+    std::span<const float> y = rd.constant<float> ("y");
+    morph::vvec<morph::vec<float, 3>> points (x.size());
+    for (std::size_t i = 0; i < x.size(); ++i) { points[i] = { x[i], y[i], 0.0f }; }
+
+    float radius = 0.01f;
+    try {
+        nlohmann::json md = nlohmann::json::parse (rd.metadata());
+        if (md.contains ("hextohex_d")) { radius = 0.5f * md["hextohex_d"].get<float>(); }
+    } catch (const nlohmann::json::exception&) {
+        // The metadata need not be JSON
+    }
+
+    morph::Visual v (1024, 768, name + ": " + field);
+    v.lightingEffects();
+
+    // A double field is converted into this; a float field is shown without a copy
+    morph::vvec<float> converted (points.size(), 0.0f);
+
+    auto sv = std::make_unique<morph::ScatterVisual<float>> (morph::vec<float>{ 0.0f, 0.0f, 0.0f });
+    v.bindmodel (sv);
+    sv->setDataCoords (&points);
+    sv->setScalarData (&converted);
+    sv->radiusFixed = radius;
+    sv->cm.setType (morph::ColourMapType::Plasma);
+    sv->finalize();
+    auto svp = v.addVisualModel (sv);
+
+    morph::shm_reader::frame f;
+    while (!v.readyToFinish && !rd.closed()) {
+        if (rd.latest (f)) {
+            // Rebuild the model from the frame as it is in shared memory. If the publisher
+            // overwrote the frame meanwhile, the next one will be along shortly.
+            if (is_double) {
+                std::span<const double> d = rd.view<double> (f, field);
+                for (std::size_t i = 0; i < d.size() && i < converted.size(); ++i) { converted[i] = static_cast<float>(d[i]); }
+                svp->updateData (&converted);
+            } else {
+                svp->updateData (rd.view<float> (f, field));
+            }
+            if (!rd.valid (f)) { std::cout << "frame " << f.number << " was torn\n"; }
+        }
+        v.waitevents (0.018);
+        v.render();
+    }
+
+    return 0;
+}
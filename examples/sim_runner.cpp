@@ -0,0 +1,98 @@
+/*
+ * A diffusing field on a HexGrid, stepped as fast as it will go on its own thread by
+ * morph::sim_runner, while the main thread draws its latest state at the display's rate.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <sstream>
+
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <morph/Visual.h>
+#include <morph/HexGridVisual.h>
+#include <morph/HexGrid.h>
+#include <morph/sim_runner.h>
+
+// Explicit diffusion with a source that circles the centre of the grid
+struct diffusion
+{
+    const morph::HexGrid& hg;
+    morph::vvec<float> u;
+    morph::vvec<float> lap;
+    float t = 0.0f;
+    static constexpr float D = 0.1f;
+
+    diffusion (const morph::HexGrid& _hg) : hg(_hg), u(_hg.num(), 0.0f), lap(_hg.num(), 0.0f) {}
+
+    void step()
+    {
+        const float d = this->hg.getd();
+        const float dt = 0.2f * d * d / D; // within the stability limit
+        const float twothirds_over_d2 = 2.0f / (3.0f * d * d);
+        const int n = static_cast<int>(this->hg.num());
+#pragma omp parallel for
+        for (int h = 0; h < n; ++h) {
+            float s = 0.0f;
+            // Missing neighbours take the value of hex h (zero flux across the boundary)
+            for (int nb : { this->hg.d_ne[h], this->hg.d_nne[h], this->hg.d_nnw[h], this->hg.d_nw[h], this->hg.d_nsw[h], this->hg.d_nse[h] }) {
+                s += nb >= 0 ? this->u[nb] : this->u[h];
+            }
+            this->lap[h] = twothirds_over_d2 * (s - 6.0f * this->u[h]);
+        }
+        const morph::vec<float, 2> src = { 0.3f * std::cos (this->t), 0.3f * std::sin (this->t) };
+        for (int h = 0; h < n; ++h) {
+            const float r2 = (morph::vec<float, 2>{ this->hg.d_x[h], this->hg.d_y[h] } - src).sos();
+            this->u[h] += dt * (D * this->lap[h] + std::exp (-r2 / 0.002f) - 0.5f * this->u[h]);
+        }
+        this->t += dt;
+    }
+};
+
+int main()
+{
+    morph::Visual v(1024, 768, "morph::sim_runner");
+    v.showCoordArrows = false;
+    morph::VisualTextModel<>* steps_label = nullptr;
+    v.addLabel ("0 steps", { -0.6f, 0.65f, 0.0f }, steps_label);
+
+    morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+    diffusion model (hg);
+
+    // What the HexGridVisual shows. It is copied from each snapshot, which sim_runner reuses.
+    std::vector<float> shown (hg.num(), 0.0f);
+    auto hgv = std::make_unique<morph::HexGridVisual<float>>(&hg, morph::vec<float, 3>{ 0.0f, 0.0f, 0.0f });
+    v.bindmodel (hgv);
+    hgv->cm.setType (morph::ColourMapType::Plasma);
+    hgv->zScale.setParams (0.0f, 0.0f);
+    hgv->colourScale.compute_scaling (0.0f, 0.05f);
+    hgv->setScalarData (&shown);
+    hgv->finalize();
+    auto hgvp = v.addVisualModel (hgv);
+
+    // Step on the simulation thread; publish no more often than the display can show (the
+    // renderer only ever wants the latest state, so older snapshots are just overwritten)
+    morph::sim_runner<std::vector<float>> runner;
+    runner.publish_interval = 1.0 / 60.0;
+    runner.backpressure = morph::sim_backpressure::overwrite;
+    runner.start ([&model]() { model.step(); return true; },
+                  [&model](std::vector<float>& snap) { snap.assign (model.u.begin(), model.u.end()); });
+
+    while (!v.readyToFinish) {
+        v.poll();
+        if (const std::vector<float>* u = runner.latest()) {
+            shown = *u;
+            hgvp->updateData (&shown);
+            std::stringstream ss;
+            ss << runner.current_step() << " steps";
+            steps_label->setupText (ss.str());
+        }
+        v.render();
+    }
+    runner.stop();
+    std::cout << runner.steps() << " steps, " << runner.published() << " snapshots\n";
+
+    return 0;
+}
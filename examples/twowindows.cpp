@@ -26,8 +26,9 @@ int main()
     v.lightingEffects();
 
     // If I define a second Visual here, then the OpenGL context will now be 'pointing'
-    // at this Visual v2
-    morph::Visual v2(768, 768, "Graph on Window 2");
+    // at this Visual v2. Passing v makes the two contexts share objects, so that v2 re-uses
+    // the shader programs and font textures that v has already made.
+    morph::Visual v2(768, 768, "Graph on Window 2", v);
     v2.showCoordArrows = true;
     v2.showTitle = true;
     v2.backgroundWhite();
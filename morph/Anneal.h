@@ -13,11 +13,13 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <stdexcept>
 #include <morph/MathAlgo.h>
 #include <morph/vvec.h>
 #include <morph/vec.h>
 #include <morph/Random.h>
 #include <morph/HdfData.h>
+#include <morph/objective_cache.h>
 
 namespace morph {
 
@@ -34,6 +36,8 @@ namespace morph {
         NeedToCompute,
         // Client needs to compute the objectives of a set of parameter sets, x_set
         NeedToComputeSet,
+        // Client needs to compute f_x_cands, the objectives of the batch of candidates x_cands
+        NeedToComputeBatch,
         // The algorithm has finished
         ReadyToStop
     };
@@ -102,6 +106,15 @@ namespace morph {
         bool display_temperatures = true;
         // Display info on reannealing?
         bool display_reanneal = true;
+        //! How many candidates to generate on each step. If this is more than 1, the state
+        //! will be NeedToComputeBatch rather than NeedToCompute and the client computes
+        //! f_x_cands for all of x_cands, which it may do in parallel (see compute()). The
+        //! candidates are then tested for acceptance in turn.
+        unsigned int batch_size = 1;
+        //! If set, compute() evaluates the objective through this cache. Candidates are
+        //! screened against f_x_best, so that those the cache's surrogate predicts to be
+        //! much worse get the prediction instead of a real evaluation.
+        morph::objective_cache<T>* cache = nullptr;
 
     public: // Parameter vectors and objective fn results need to be client-accessible.
 
@@ -127,6 +140,10 @@ namespace morph {
         morph::vvec<T> x_plusdelta;
         //! The set of objective function values for x_set.
         T f_x_plusdelta = T{0};
+        //! The candidates of a batch, when batch_size > 1.
+        morph::vvec<morph::vvec<T>> x_cands;
+        //! The objective function values of x_cands, to be computed by the client.
+        morph::vvec<T> f_x_cands;
 
     public: // Statistical records and state.
 
@@ -281,7 +298,16 @@ namespace morph {
             this->T_cost_0 = this->c_cost;
             this->T_cost = this->c_cost;
 
-            this->state = Anneal_State::NeedToCompute;
+            if (this->batch_size > 1) {
+                // The first batch is the initial parameters and batch_size - 1 candidates near them
+                this->x_cands.resize (this->batch_size);
+                this->x_cands[0] = this->x_cand;
+                for (unsigned int j = 1; j < this->batch_size; ++j) { this->x_cands[j] = this->generate_candidate(); }
+                this->f_x_cands.assign (this->batch_size, this->f_x_cand);
+                this->state = Anneal_State::NeedToComputeBatch;
+            } else {
+                this->state = Anneal_State::NeedToCompute;
+            }
         }
 
         //! Advance the simulated annealing algorithm by one step.
@@ -294,13 +320,31 @@ namespace morph {
                 return;
             }
 
+            // The batch generated before a reanneal was not computed, so there is nothing to accept
+            bool batch_computed = true;
             if (this->state == Anneal_State::NeedToComputeSet) {
                 this->complete_reanneal();
                 this->state = Anneal_State::NeedToStep;
+                batch_computed = false;
             }
 
             this->cooling_schedule();
-            this->acceptance_check();
+            this->f_x_hist.push_back (this->f_x);
+            this->f_x_best_hist.push_back (this->f_x_best);
+            if (this->batch_size > 1) {
+                if (batch_computed) {
+                    if (this->f_x_cands.size() != this->x_cands.size()) {
+                        throw std::runtime_error ("Anneal::step: f_x_cands must hold an objective value for each of x_cands");
+                    }
+                    for (unsigned int j = 0; j < this->x_cands.size(); ++j) {
+                        this->x_cand = this->x_cands[j];
+                        this->f_x_cand = this->f_x_cands[j];
+                        this->acceptance_check();
+                    }
+                }
+            } else {
+                this->acceptance_check();
+            }
             this->generate_next();
             ++this->k;
             ++this->k_r;
@@ -311,7 +355,46 @@ namespace morph {
                 // allow Anneal::complete_reanneal() to complete the reannealing.
                 this->state = Anneal_State::NeedToComputeSet;
             } else {
-                this->state = Anneal_State::NeedToCompute;
+                this->state = this->batch_size > 1 ? Anneal_State::NeedToComputeBatch : Anneal_State::NeedToCompute;
+            }
+        }
+
+        /*!
+         * Compute the objective values that the current state asks for, by calling
+         * objective (const morph::vvec<T>&) which returns a T. The candidates of a batch
+         * are computed in parallel, so objective must be safe to call from several threads
+         * at once.
+         */
+        template <typename F>
+        void compute (F objective)
+        {
+            auto candidate_objective = [this, &objective](const morph::vvec<T>& xc) {
+                if (this->cache == nullptr) { return objective (xc); }
+                return this->cache->evaluate (xc, objective, this->f_x_best, this->downhill);
+            };
+            if (this->state == Anneal_State::NeedToCompute) {
+                this->f_x_cand = candidate_objective (this->x_cand);
+            } else if (this->state == Anneal_State::NeedToComputeSet) {
+                // The tangents need real values, so these are never screened
+                this->f_x_plusdelta = this->cache == nullptr ? objective (this->x_plusdelta)
+                                                             : this->cache->evaluate (this->x_plusdelta, objective);
+            } else if (this->state == Anneal_State::NeedToComputeBatch) {
+                const int nc = static_cast<int>(this->x_cands.size());
+                this->f_x_cands.resize (nc);
+#pragma omp parallel for schedule(dynamic, 1)
+                for (int j = 0; j < nc; ++j) { this->f_x_cands[j] = candidate_objective (this->x_cands[j]); }
+            }
+        }
+
+        //! Run the whole optimisation (calling init() first if necessary), computing the
+        //! objectives with compute (objective).
+        template <typename F>
+        void run (F objective)
+        {
+            if (this->state == Anneal_State::NeedToInit) { this->init(); }
+            while (this->state != Anneal_State::ReadyToStop) {
+                this->compute (objective);
+                this->step();
             }
         }
 
@@ -364,6 +447,7 @@ namespace morph {
             data.add_val ("/downhill", this->downhill);
             data.add_val ("/reanneal_after_steps", this->reanneal_after_steps);
             data.add_val ("/exit_at_T_f", this->exit_at_T_f);
+            data.add_val ("/batch_size", this->batch_size);
         }
 
     protected: // Internal algorithm methods.
@@ -385,8 +469,8 @@ namespace morph {
             return x_new;
         }
 
-        //! A function to generate a new set of parameters for x_cand.
-        void generate_next()
+        //! Generate a new set of parameters near to x.
+        morph::vvec<T> generate_candidate()
         {
             morph::vvec<T> x_new;
             bool generated = false;
@@ -402,7 +486,18 @@ namespace morph {
             }
             ++this->num_generated;
             ++this->num_generated_recently;
-            this->x_cand = x_new;
+            return x_new;
+        }
+
+        //! A function to generate a new set of parameters for x_cand (or, for a batch, x_cands).
+        void generate_next()
+        {
+            if (this->batch_size > 1) {
+                this->x_cands.resize (this->batch_size);
+                for (auto& xc : this->x_cands) { xc = this->generate_candidate(); }
+            } else {
+                this->x_cand = this->generate_candidate();
+            }
         }
 
         //! The cooling schedule function updates temperatures on each step.
@@ -434,9 +529,6 @@ namespace morph {
         //! and x_best as necessary, and updates statistical variables.
         void acceptance_check()
         {
-            this->f_x_hist.push_back (this->f_x);
-            this->f_x_best_hist.push_back (this->f_x_best);
-
             bool candidate_is_better = false;
             if ((this->downhill == true && this->f_x_cand < this->f_x)
                 || (this->downhill == false && this->f_x_cand > this->f_x)) {
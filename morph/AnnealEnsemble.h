@@ -0,0 +1,135 @@
+/*
+ * An ensemble of Anneal optimisers that run in parallel from different starting points
+ * and share the best parameters found so far.
+ */
+#pragma once
+
+#include <morph/Anneal.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+
+#include <vector>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <limits>
+
+namespace morph {
+
+    /*!
+     * Several independent Anneal optimisations of the same objective, each started from
+     * its own point in the parameter space and run in its own OpenMP thread. Every
+     * share_interval steps, a member that has found a better f_x_best than the ensemble
+     * records it as the ensemble's best, and a member that is behind takes the
+     * ensemble's best as its own x_best (to which it will return on its next
+     * reanneal). For objectives that are costly, this makes use of many cores even
+     * though each annealer evaluates one candidate at a time (it can be combined with
+     * Anneal::batch_size, though nested parallelism needs to be enabled for batches to
+     * be computed in parallel).
+     *
+     * \code
+     * morph::AnnealEnsemble<double> ens (p, p_ranges, 16);
+     * for (auto& a : ens.members) { a.temperature_ratio_scale = 1e-3; } // and so on
+     * ens.run (objective); // objective(const morph::vvec<double>&) -> double
+     * std::cout << ens.x_best << ": " << ens.f_x_best << std::endl;
+     * \endcode
+     *
+     * \tparam T The type for the numbers in the algorithm (float or double)
+     */
+    template <typename T>
+    class AnnealEnsemble
+    {
+    public:
+        //! The annealers. Set their parameters before calling run(). Member 0 starts from
+        //! the initial parameters, the others from random points within the ranges.
+        std::vector<morph::Anneal<T>> members;
+        //! How many steps a member takes between comparisons with the ensemble's best
+        unsigned int share_interval = 20;
+        //! The best parameters found by any member
+        morph::vvec<T> x_best;
+        //! The objective value of x_best
+        T f_x_best = T{0};
+        //! Which member found x_best
+        unsigned int best_member = 0;
+
+        AnnealEnsemble (const morph::vvec<T>& initial_params,
+                        const morph::vvec<morph::vec<T,2>>& param_ranges, const unsigned int n_members)
+        {
+            if (n_members == 0) { throw std::runtime_error ("AnnealEnsemble: need at least one member"); }
+            morph::vvec<T> range_min (param_ranges.size());
+            morph::vvec<T> range_max (param_ranges.size());
+            for (unsigned int i = 0; i < param_ranges.size(); ++i) {
+                range_min[i] = param_ranges[i][0];
+                range_max[i] = param_ranges[i][1];
+            }
+            this->members.reserve (n_members);
+            this->members.emplace_back (initial_params, param_ranges);
+            for (unsigned int i = 1; i < n_members; ++i) {
+                morph::vvec<T> p (initial_params.size());
+                p.randomize();
+                p = range_min + p * (range_max - range_min);
+                this->members.emplace_back (p, param_ranges);
+            }
+            // Output from many threads at once would be unreadable
+            for (auto& a : this->members) {
+                a.display_temperatures = false;
+                a.display_reanneal = false;
+            }
+        }
+
+        /*!
+         * Run all the members to completion, each calling objective (const
+         * morph::vvec<T>&), which returns a T. objective is called from several threads
+         * at once. Members that are still in state NeedToInit are init()ed first, so
+         * set their parameters before calling run().
+         */
+        template <typename F>
+        void run (F objective)
+        {
+            this->f_x_best = this->members[0].downhill ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+            this->x_best.clear();
+            std::vector<std::exception_ptr> errors (this->members.size());
+            const int nm = static_cast<int>(this->members.size());
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int i = 0; i < nm; ++i) {
+                // An exception must not escape the parallel region
+                try {
+                    morph::Anneal<T>& a = this->members[i];
+                    if (a.state == Anneal_State::NeedToInit) { a.init(); }
+                    while (a.state != Anneal_State::ReadyToStop) {
+                        a.compute (objective);
+                        a.step();
+                        if (a.steps % this->share_interval == 0) { this->share (i); }
+                    }
+                    this->share (i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+            for (auto& e : errors) { if (e) { std::rethrow_exception (e); } }
+        }
+
+    protected:
+        //! Guards x_best, f_x_best and best_member
+        std::mutex best_mutex;
+
+        //! Compare member i's best with the ensemble's best and update whichever is behind
+        void share (const unsigned int i)
+        {
+            morph::Anneal<T>& a = this->members[i];
+            std::lock_guard<std::mutex> lk (this->best_mutex);
+            // Until a member has accepted a candidate, its f_x_best is not a real objective value
+            if (a.num_accepted == 0) { return; }
+            const bool member_better = a.downhill ? a.f_x_best < this->f_x_best : a.f_x_best > this->f_x_best;
+            if (this->x_best.empty() || member_better) {
+                this->x_best = a.x_best;
+                this->f_x_best = a.f_x_best;
+                this->best_member = i;
+            } else if (a.f_x_best != this->f_x_best) {
+                a.x_best = this->x_best;
+                a.f_x_best = this->f_x_best;
+            }
+        }
+    };
+
+} // namespace morph
@@ -86,10 +86,10 @@ namespace morph
          * Compute the Euclidean distance from the current coordinate to the given
          * coordinate.
          */
-        Flt distanceTo (BezCoord& other) const { return (this->coord - other.coord).length(); }
+        Flt distanceTo (const BezCoord& other) const { return (this->coord - other.coord).length(); }
 
         //! Horizontal distance between two BezCoords.
-        Flt horzDistanceTo (BezCoord& other) const { return (std::abs(this->x() - other.x())); }
+        Flt horzDistanceTo (const BezCoord& other) const { return (std::abs(this->x() - other.x())); }
 
         //! Vertical distance between two BezCoords.
         Flt vertDistanceTo (BezCoord& other) const { return (std::abs(this->y() - other.y())); }
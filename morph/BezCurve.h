@@ -16,6 +16,8 @@
 #include <stdexcept>
 #include <cmath>
 #include <cstddef>
+#include <algorithm>
+#include <span>
 // This is left as a hint in case anyone tries to compile this with Intel's compiler:
 #ifdef __ICC__
 # define ARMA_ALLOW_FAKE_GCC 1
@@ -571,6 +573,103 @@ namespace morph
             this->init();
         }
 
+        /*!
+         * Make this the cubic Bezier curve from the first to the last of \a points which is
+         * the least squares best fit to all of them. Each point is given a parameter t
+         * from its proportion of the chord length. The two inner control points are then
+         * the closed form solution of their 2x2 normal equations, and each t is moved to
+         * the nearest point on the curve by a Newton-Raphson step, \a reparam times over.
+         * Unlike fit (points), which interpolates points with a curve of order
+         * points.size()-1, there are no dense matrices to invert, so this is fast enough
+         * for fitting many segments of a long boundary.
+         *
+         * \return the sum of the squared distances from points to the curve at their t
+         */
+        Flt fitCubic (std::span<const morph::vec<Flt, 2>> points, unsigned int reparam = 4)
+        {
+            const std::size_t n = points.size();
+            if (n < 2) { throw std::runtime_error ("BezCurve::fitCubic: Need at least 2 points"); }
+
+            // As in fit(), work in double precision
+            const double p0[2] = { points[0][0], points[0][1] };
+            const double p3[2] = { points[n-1][0], points[n-1][1] };
+            double p1[2] = { 0.0, 0.0 };
+            double p2[2] = { 0.0, 0.0 };
+
+            // Chord length parameterisation
+            std::vector<double> t (n, 0.0);
+            for (std::size_t i = 1; i < n; ++i) {
+                const double dx = static_cast<double>(points[i][0]) - points[i-1][0];
+                const double dy = static_cast<double>(points[i][1]) - points[i-1][1];
+                t[i] = t[i-1] + std::sqrt (dx*dx + dy*dy);
+            }
+            for (std::size_t i = 1; i < n; ++i) { t[i] = t[n-1] > 0.0 ? t[i] / t[n-1] : static_cast<double>(i) / (n - 1); }
+
+            double sos = 0.0;
+            for (unsigned int iter = 0; iter <= reparam; ++iter) {
+                // The normal equations for p1 and p2, given fixed p0, p3 and t
+                double a11 = 0.0, a12 = 0.0, a22 = 0.0;
+                double r1[2] = { 0.0, 0.0 };
+                double r2[2] = { 0.0, 0.0 };
+                for (std::size_t i = 0; i < n; ++i) {
+                    const double u = 1.0 - t[i];
+                    const double b0 = u * u * u;
+                    const double b1 = 3.0 * u * u * t[i];
+                    const double b2 = 3.0 * u * t[i] * t[i];
+                    const double b3 = t[i] * t[i] * t[i];
+                    a11 += b1 * b1;
+                    a12 += b1 * b2;
+                    a22 += b2 * b2;
+                    for (int j = 0; j < 2; ++j) {
+                        const double r = points[i][j] - b0 * p0[j] - b3 * p3[j];
+                        r1[j] += b1 * r;
+                        r2[j] += b2 * r;
+                    }
+                }
+                const double det = a11 * a22 - a12 * a12;
+                for (int j = 0; j < 2; ++j) {
+                    if (std::abs (det) > 1e-12 * a11 * a22) {
+                        p1[j] = (a22 * r1[j] - a12 * r2[j]) / det;
+                        p2[j] = (a11 * r2[j] - a12 * r1[j]) / det;
+                    } else {
+                        // Too few (or degenerate) points to place the controls; make a straight line
+                        p1[j] = p0[j] + (p3[j] - p0[j]) / 3.0;
+                        p2[j] = p0[j] + 2.0 * (p3[j] - p0[j]) / 3.0;
+                    }
+                }
+
+                // Newton-Raphson reparameterisation, or the final sum of squares
+                sos = 0.0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    const double u = 1.0 - t[i];
+                    double q[2], dq[2], ddq[2];
+                    for (int j = 0; j < 2; ++j) {
+                        q[j] = u*u*u * p0[j] + 3.0*u*u*t[i] * p1[j] + 3.0*u*t[i]*t[i] * p2[j] + t[i]*t[i]*t[i] * p3[j] - points[i][j];
+                        dq[j] = 3.0 * (u*u * (p1[j] - p0[j]) + 2.0*u*t[i] * (p2[j] - p1[j]) + t[i]*t[i] * (p3[j] - p2[j]));
+                        ddq[j] = 6.0 * (u * (p2[j] - 2.0*p1[j] + p0[j]) + t[i] * (p3[j] - 2.0*p2[j] + p1[j]));
+                    }
+                    sos += q[0]*q[0] + q[1]*q[1];
+                    if (iter == reparam || i == 0 || i == n-1) { continue; }
+                    const double num = q[0]*dq[0] + q[1]*dq[1];
+                    const double den = dq[0]*dq[0] + dq[1]*dq[1] + q[0]*ddq[0] + q[1]*ddq[1];
+                    if (den != 0.0) { t[i] = std::clamp (t[i] - num / den, 0.0, 1.0); }
+                }
+            }
+
+            this->C.set_size (4, 2);
+            this->C(0,0) = static_cast<Flt>(p0[0]);
+            this->C(0,1) = static_cast<Flt>(p0[1]);
+            this->C(1,0) = static_cast<Flt>(p1[0]);
+            this->C(1,1) = static_cast<Flt>(p1[1]);
+            this->C(2,0) = static_cast<Flt>(p2[0]);
+            this->C(2,1) = static_cast<Flt>(p2[1]);
+            this->C(3,0) = static_cast<Flt>(p3[0]);
+            this->C(3,1) = static_cast<Flt>(p3[1]);
+            this->init();
+
+            return static_cast<Flt>(sos);
+        }
+
         //! Obtain and return the derivative of this Bezier curve
         BezCurve<Flt> derivative() const
         {
@@ -771,6 +870,10 @@ namespace morph
                 // curve with a single control point. The tangent to a line is
                 // simply the line:
                 tang = this->computePoint (t);
+            } else if (this->order <= 4) {
+                // Evaluate the derivative directly from its control points, as
+                // derivative().computePoint (t) would, without building a BezCurve
+                tang = this->computeDerivativeLowOrder (t);
             } else {
                 BezCurve<Flt> deriv = this->derivative();
                 tang = deriv.computePoint (t);
@@ -831,11 +934,64 @@ namespace morph
         {
             this->scale = s;
             this->linlengthscaled = this->scale * this->linlength;
+            this->cacheSetup();
         }
 
+        //! Get the scaling factor.
+        Flt getScale() const { return this->scale; }
+
         //! A setter for the length threshold.
         void setLthresh (const Flt l) { this->lthresh = l; }
 
+        //! Get the length threshold.
+        Flt getLthresh() const { return this->lthresh; }
+
+        /*!
+         * The (scaled) length of the curve, measured along the curve, from the arc length
+         * table that is computed whenever the control points or the scale change.
+         */
+        Flt getArcLength() const { return this->arc_s.empty() ? Flt{0} : this->arc_s.back(); }
+
+        /*!
+         * The parameter t at which the curve has come a distance s along itself from t=0,
+         * interpolated from the arc length table. s is clamped to [0, getArcLength()].
+         */
+        Flt computeParamAtLength (Flt s) const
+        {
+            if (this->arc_s.empty() || s <= Flt{0}) { return Flt{0}; }
+            if (s >= this->arc_s.back()) { return Flt{1}; }
+            auto hi = std::upper_bound (this->arc_s.begin(), this->arc_s.end(), s);
+            const std::size_t i = (hi - this->arc_s.begin()) - 1;
+            const Flt ds = this->arc_s[i+1] - this->arc_s[i];
+            const Flt frac = ds > Flt{0} ? (s - this->arc_s[i]) / ds : Flt{0};
+            return std::min (Flt{1}, (static_cast<Flt>(i) + frac) / static_cast<Flt>(BezCurve<Flt>::arc_segments));
+        }
+
+        /*!
+         * Compute points on the curve which are distance l from each other measured along
+         * the curve (rather than as the crow flies, as computePoints (l, firstl) does). No
+         * search is needed; the parameters come from the arc length table. As for
+         * computePoints (l, firstl), the first point is a distance firstl from the start if
+         * firstl is non-zero and the last element is a null BezCoord holding the length of
+         * curve remaining after the last point.
+         */
+        std::vector<BezCoord<Flt>> computePointsByArcLength (Flt l, Flt firstl = Flt{0}) const
+        {
+            if (l <= Flt{0}) { throw std::runtime_error ("BezCurve::computePointsByArcLength: l must be positive"); }
+            std::vector<BezCoord<Flt>> rtn;
+            const Flt len = this->getArcLength();
+            Flt s = firstl > Flt{0} ? firstl : l;
+            while (s <= len) {
+                rtn.push_back (this->computePoint (this->computeParamAtLength (s)));
+                s += l;
+            }
+            BezCoord<Flt> last (true);
+            last.setRemaining (len - (s - l));
+            last.param = Flt{1};
+            rtn.push_back (last);
+            return rtn;
+        }
+
         //! Gets the initial control point, unscaled
         morph::vec<Flt, 2> getInitialPointUnscaled() const
         {
@@ -894,6 +1050,47 @@ namespace morph
                                          + (C(order,1)-C(0,1)) * (C(order,1) - C(0,1)));
             this->linlengthscaled = this->scale * this->linlength;
             this->matrixSetup();
+            this->cacheSetup();
+        }
+
+        /*!
+         * Copy the control points out of C for the fast evaluation of low order curves, and
+         * compute the end point and the arc length table. Called whenever C or scale change.
+         */
+        void cacheSetup()
+        {
+            this->ctrl.resize (this->C.n_rows);
+            for (unsigned int i = 0; i < this->C.n_rows; ++i) { this->ctrl[i] = { this->C(i,0), this->C(i,1) }; }
+            if (this->order == 0) { return; }
+            this->endpoint = this->computePoint (Flt{1});
+
+            constexpr unsigned int n = BezCurve<Flt>::arc_segments;
+            this->arc_s.resize (n + 1);
+            this->arc_s[0] = Flt{0};
+            if (this->order == 3) {
+                // Step along the cubic by forward differencing its power basis form,
+                // a t^3 + b t^2 + c t + d, at the n+1 equally spaced values of t
+                const morph::vec<Flt, 2>* p = this->ctrl.data();
+                const morph::vec<Flt, 2> a = (p[3] - p[0] + (p[1] - p[2]) * Flt{3}) * this->scale;
+                const morph::vec<Flt, 2> b = (p[0] - p[1] * Flt{2} + p[2]) * Flt{3} * this->scale;
+                const morph::vec<Flt, 2> c = (p[1] - p[0]) * Flt{3} * this->scale;
+                const Flt h = Flt{1} / static_cast<Flt>(n);
+                morph::vec<Flt, 2> d1 = a * (h * h * h) + b * (h * h) + c * h;
+                morph::vec<Flt, 2> d2 = a * (Flt{6} * h * h * h) + b * (Flt{2} * h * h);
+                const morph::vec<Flt, 2> d3 = a * (Flt{6} * h * h * h);
+                for (unsigned int i = 1; i <= n; ++i) {
+                    this->arc_s[i] = this->arc_s[i-1] + d1.length();
+                    d1 += d2;
+                    d2 += d3;
+                }
+            } else {
+                BezCoord<Flt> b0 = this->computePoint (Flt{0});
+                for (unsigned int i = 1; i <= n; ++i) {
+                    BezCoord<Flt> b1 = this->computePoint (i == n ? Flt{1} : static_cast<Flt>(i) / static_cast<Flt>(n));
+                    this->arc_s[i] = this->arc_s[i-1] + b0.distanceTo (b1);
+                    b0 = b1;
+                }
+            }
         }
 
         /*!
@@ -932,8 +1129,9 @@ namespace morph
             DBG2 ("computePointLinear (t=" << t << ")");
             this->checkt(t);
             morph::vec<Flt, 2> b;
-            b[0] =  ((1-t) * this->C(0,0) + t * this->C(1,0)) * this->scale;
-            b[1] = ((1-t) * this->C(0,1) + t * this->C(1,1)) * this->scale;
+            const morph::vec<Flt, 2>* p = this->ctrl.data();
+            b[0] =  ((1-t) * p[0][0] + t * p[1][0]) * this->scale;
+            b[1] = ((1-t) * p[0][1] + t * p[1][1]) * this->scale;
             return BezCoord<Flt>(t, b);
         }
 
@@ -950,8 +1148,7 @@ namespace morph
         {
             DBG2 ("Called computePointLinear(Flt t="<<t<<", Flt l="<<l<<")");
             BezCoord<Flt> b1 = this->computePoint (t);
-            BezCoord<Flt> e1 = this->computePoint (Flt{1});
-            Flt toEnd = b1.distanceTo (e1);
+            Flt toEnd = b1.distanceTo (this->endpoint);
             if (toEnd < l) {
                 // Return null coordinate as the result and set remaining to toEnd and
                 // the last param to t.
@@ -975,12 +1172,13 @@ namespace morph
             this->checkt (t);
             morph::vec<Flt, 2> b;
             Flt t_ = 1-t;
-            b[0] = (t_ * t_ * this->C(0,0)
-                    + 2 * t_ * t * this->C(1,0)
-                    + t * t * this->C(2,0)) * this->scale;
-            b[1] = (t_ * t_ * this->C(0,1)
-                    + 2 * t_ * t * this->C(1,1)
-                    + t * t * this->C(2,1)) * this->scale;
+            const morph::vec<Flt, 2>* p = this->ctrl.data();
+            b[0] = (t_ * t_ * p[0][0]
+                    + 2 * t_ * t * p[1][0]
+                    + t * t * p[2][0]) * this->scale;
+            b[1] = (t_ * t_ * p[0][1]
+                    + 2 * t_ * t * p[1][1]
+                    + t * t * p[2][1]) * this->scale;
             return BezCoord<Flt>(t, b);
         }
 
@@ -993,14 +1191,47 @@ namespace morph
             this->checkt (t);
             morph::vec<Flt, 2> b;
             Flt t_ = 1-t;
-            b[0] = (t_ * t_ * t_ * this->C(0,0)
-                    + 3 * t_ * t_ * t * this->C(1,0)
-                    + 3 * t_ * t * t * this->C(2,0)
-                    + t * t * t * this->C(3,0)) * this->scale;
-            b[1] = (t_ * t_ * t_ * this->C(0,1)
-                    + 3 * t_ * t_ * t * this->C(1,1)
-                    + 3 * t_ * t * t * this->C(2,1)
-                    + t * t * t * this->C(3,1)) * this->scale;
+            const morph::vec<Flt, 2>* p = this->ctrl.data();
+            b[0] = (t_ * t_ * t_ * p[0][0]
+                    + 3 * t_ * t_ * t * p[1][0]
+                    + 3 * t_ * t * t * p[2][0]
+                    + t * t * t * p[3][0]) * this->scale;
+            b[1] = (t_ * t_ * t_ * p[0][1]
+                    + 3 * t_ * t_ * t * p[1][1]
+                    + 3 * t_ * t * t * p[2][1]
+                    + t * t * t * p[3][1]) * this->scale;
+            return BezCoord<Flt>(t, b);
+        }
+
+        /*!
+         * The derivative of a curve of order 2, 3 or 4 at t, unscaled, computed exactly as
+         * derivative().computePoint (t) would compute it.
+         */
+        BezCoord<Flt> computeDerivativeLowOrder (Flt t) const
+        {
+            this->checkt (t);
+            const Flt o = static_cast<Flt>(this->order);
+            std::array<morph::vec<Flt, 2>, 4> d;
+            for (unsigned int i = 0; i < this->order; ++i) {
+                d[i][0] = o * (this->ctrl[i+1][0] - this->ctrl[i][0]);
+                d[i][1] = o * (this->ctrl[i+1][1] - this->ctrl[i][1]);
+            }
+            Flt t_ = 1-t;
+            morph::vec<Flt, 2> b;
+            switch (this->order) {
+            case 2:
+                b[0] = (t_ * d[0][0] + t * d[1][0]);
+                b[1] = (t_ * d[0][1] + t * d[1][1]);
+                break;
+            case 3:
+                b[0] = (t_ * t_ * d[0][0] + 2 * t_ * t * d[1][0] + t * t * d[2][0]);
+                b[1] = (t_ * t_ * d[0][1] + 2 * t_ * t * d[1][1] + t * t * d[2][1]);
+                break;
+            default:
+                b[0] = (t_ * t_ * t_ * d[0][0] + 3 * t_ * t_ * t * d[1][0] + 3 * t_ * t * t * d[2][0] + t * t * t * d[3][0]);
+                b[1] = (t_ * t_ * t_ * d[0][1] + 3 * t_ * t_ * t * d[1][1] + 3 * t_ * t * t * d[2][1] + t * t * t * d[3][1]);
+                break;
+            }
             return BezCoord<Flt>(t, b);
         }
 
@@ -1039,8 +1270,7 @@ namespace morph
 
             // Find distance from the initial position to the end of the
             // curve. If this is a shorter distance than l, then return.
-            BezCoord<Flt> e1 = this->computePoint (Flt{1});
-            Flt toEnd = b1.distanceTo (e1);
+            Flt toEnd = b1.distanceTo (this->endpoint);
             if (toEnd < l) {
                 // Return null coordinate as the result and set remaining to
                 // toEnd and the last param to t.
@@ -1103,8 +1333,7 @@ namespace morph
 
             // Find distance from the initial position to the end of the curve. If this
             // is a shorter distance than l, then return.
-            BezCoord<Flt> e1 = this->computePoint (Flt{1});
-            Flt toEnd = b1.horzDistanceTo (e1);
+            Flt toEnd = b1.horzDistanceTo (this->endpoint);
             if (toEnd < x) {
                 // Return null coordinate as the result and set remaining to toEnd and
                 // the last param to t.
@@ -1245,6 +1474,18 @@ namespace morph
 
         //! M*C
         arma::Mat<Flt> MC;
+
+        //! A copy of the control points in C, read by the evaluations of low order curves
+        std::vector<morph::vec<Flt, 2>> ctrl;
+
+        //! The point at t=1, as computePoint (1) gives it
+        BezCoord<Flt> endpoint;
+
+        //! The number of equal steps in t of the arc length table
+        static constexpr unsigned int arc_segments = 64;
+
+        //! The scaled length along the curve from t=0 to t=i/arc_segments, for i = 0 to arc_segments
+        std::vector<Flt> arc_s;
     };
 
 } // namespace morph
@@ -8,10 +8,13 @@
 #pragma once
 
 #include <morph/BezCurve.h>
+#include <morph/threadpool.h>
 
 #include <limits>
 #include <list>
 #include <vector>
+#include <span>
+#include <stdexcept>
 #include <utility>
 #include <string>
 #include <iostream>
@@ -179,50 +182,17 @@ namespace morph
          */
         void computePoints (Flt step, bool invertY = false)
         {
-            this->points.clear();
-            this->tangents.clear();
-            this->normals.clear();
-
-            // First the very start point:
-            BezCoord<Flt> startPt = this->curves.front().computePoint (Flt{0});
-            if (invertY) {
-                startPt.invertY();
-            }
-            this->points.push_back (startPt);
-
-            // Make cp a complete set of points for the current curve *including
-            // the point in the curve for t=0*
-            std::pair<BezCoord<Flt>, BezCoord<Flt>> tn0 = this->curves.front().computeTangentNormal(Flt{0});
-            this->tangents.push_back (tn0.first);
-            this->normals.push_back (tn0.second);
-
-            typename std::list<BezCurve<Flt>>::const_iterator i = this->curves.begin();
-            // Don't forget to set the scaling factor in each
-            // BezCurve before generating points:
-            Flt firstl = Flt{0};
-            while (i != this->curves.end()) {
-                std::vector<BezCoord<Flt>> cp = i->computePoints (step, firstl);
-                if (cp.back().isNull()) {
-                    firstl = step - cp.back().getRemaining();
-                    cp.pop_back();
-                }
-                if (invertY) {
-                    typename std::vector<BezCoord<Flt>>::iterator bci = cp.begin();
-                    while (bci != cp.end()) {
-                        bci->invertY();
-                        ++bci;
-                    }
-                }
-                this->points.insert (this->points.end(), cp.begin(), cp.end());
+            this->computePathPoints (step, invertY, false);
+        }
 
-                // Now compute tangents and normals
-                for (BezCoord<Flt> bp : cp) {
-                    std::pair<BezCoord<Flt>, BezCoord<Flt>> tn = i->computeTangentNormal(bp.t());
-                    this->tangents.push_back (tn.first);
-                    this->normals.push_back (tn.second);
-                }
-                ++i;
-            }
+        /*!
+         * Like computePoints (step, invertY), but space the points a distance step apart
+         * measured along the curves, using each BezCurve's arc length table rather than a
+         * search for each point.
+         */
+        void computePointsByArcLength (Flt step, bool invertY = false)
+        {
+            this->computePathPoints (step, invertY, true);
         }
 
         // Getters
@@ -305,6 +275,121 @@ namespace morph
                 }
             }
         }
+
+        /*!
+         * Replace the curves of this path with cubic Bezier curves fitted to \a points by
+         * BezCurve::fitCubic. \a joins holds the indices of the points at which one curve
+         * ends and the next begins, in increasing order; the first curve starts at
+         * points[0] and the last ends at points.back(). The curves are fitted in parallel.
+         *
+         * \return the total sum of the squared distances from points to the curves
+         */
+        Flt fitCubics (std::span<const morph::vec<Flt, 2>> points, const std::vector<std::size_t>& joins,
+                       unsigned int reparam = 4)
+        {
+            if (points.size() < 2) { throw std::runtime_error ("BezCurvePath::fitCubics: Need at least 2 points"); }
+            std::vector<std::size_t> ends = { 0 };
+            for (std::size_t j : joins) {
+                if (j <= ends.back() || j >= points.size() - 1) {
+                    throw std::runtime_error ("BezCurvePath::fitCubics: joins must increase and lie inside points");
+                }
+                ends.push_back (j);
+            }
+            ends.push_back (points.size() - 1);
+
+            std::vector<BezCurve<Flt>> fitted (ends.size() - 1);
+            std::vector<Flt> sos (fitted.size(), Flt{0});
+            morph::parallel_for (std::size_t{0}, fitted.size(), [&](std::size_t k) {
+                sos[k] = fitted[k].fitCubic (points.subspan (ends[k], ends[k+1] - ends[k] + 1), reparam);
+            }, 1);
+
+            this->curves.clear();
+            this->points_key.clear();
+            this->scale = Flt{1};
+            this->initialCoordinate = points[0];
+            Flt total = Flt{0};
+            for (std::size_t k = 0; k < fitted.size(); ++k) {
+                this->curves.push_back (std::move (fitted[k]));
+                total += sos[k];
+            }
+            return total;
+        }
+
+    private:
+        /*!
+         * What points, tangents and normals were last computed from: the step, invertY, the
+         * spacing method and each curve's scale, threshold and control points. While these
+         * (and the number of points) are unchanged, computing the points again does nothing.
+         */
+        std::vector<Flt> points_key;
+
+        //! Make the key for points_key
+        std::vector<Flt> pointsKey (Flt step, bool invertY, bool arclength) const
+        {
+            std::vector<Flt> key = { step, invertY ? Flt{1} : Flt{0}, arclength ? Flt{1} : Flt{0} };
+            for (const BezCurve<Flt>& c : this->curves) {
+                key.push_back (c.getScale());
+                key.push_back (c.getLthresh());
+                key.push_back (static_cast<Flt>(c.getOrder()));
+                for (const morph::vec<Flt, 2>& cp : c.getControls()) { key.push_back (cp[0]); key.push_back (cp[1]); }
+            }
+            return key;
+        }
+
+        //! The common code of computePoints and computePointsByArcLength
+        void computePathPoints (Flt step, bool invertY, bool arclength)
+        {
+            std::vector<Flt> key = this->pointsKey (step, invertY, arclength);
+            if (key == this->points_key && !this->points.empty()
+                && this->points.size() == this->tangents.size() && this->points.size() == this->normals.size()) {
+                return;
+            }
+            this->points_key.swap (key);
+            this->points.clear();
+            this->tangents.clear();
+            this->normals.clear();
+
+            // First the very start point:
+            BezCoord<Flt> startPt = this->curves.front().computePoint (Flt{0});
+            if (invertY) {
+                startPt.invertY();
+            }
+            this->points.push_back (startPt);
+
+            // Make cp a complete set of points for the current curve *including
+            // the point in the curve for t=0*
+            std::pair<BezCoord<Flt>, BezCoord<Flt>> tn0 = this->curves.front().computeTangentNormal(Flt{0});
+            this->tangents.push_back (tn0.first);
+            this->normals.push_back (tn0.second);
+
+            typename std::list<BezCurve<Flt>>::const_iterator i = this->curves.begin();
+            // Don't forget to set the scaling factor in each
+            // BezCurve before generating points:
+            Flt firstl = Flt{0};
+            while (i != this->curves.end()) {
+                std::vector<BezCoord<Flt>> cp = arclength ? i->computePointsByArcLength (step, firstl) : i->computePoints (step, firstl);
+                if (cp.back().isNull()) {
+                    firstl = step - cp.back().getRemaining();
+                    cp.pop_back();
+                }
+                if (invertY) {
+                    typename std::vector<BezCoord<Flt>>::iterator bci = cp.begin();
+                    while (bci != cp.end()) {
+                        bci->invertY();
+                        ++bci;
+                    }
+                }
+                this->points.insert (this->points.end(), cp.begin(), cp.end());
+
+                // Now compute tangents and normals
+                for (BezCoord<Flt> bp : cp) {
+                    std::pair<BezCoord<Flt>, BezCoord<Flt>> tn = i->computeTangentNormal(bp.t());
+                    this->tangents.push_back (tn.first);
+                    this->normals.push_back (tn.second);
+                }
+                ++i;
+            }
+        }
     };
 
 } // namespace morph
@@ -0,0 +1,663 @@
+/*
+ * The Covariance Matrix Adaptation Evolution Strategy (CMA-ES), with IPOP and BIPOP restarts.
+ *
+ * Hansen, N. (2016). The CMA Evolution Strategy: A Tutorial. arXiv:1604.00772
+ *
+ * Auger, A. and Hansen, N. (2005). A restart CMA evolution strategy with increasing population
+ * size. IEEE Congress on Evolutionary Computation, 1769-1776.
+ *
+ * Hansen, N. (2009). Benchmarking a BI-population CMA-ES on the BBOB-2009 function testbed.
+ * GECCO Workshop on Black-Box Optimization Benchmarking, 2389-2396.
+ */
+#pragma once
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <morph/Random.h>
+#include <morph/HdfData.h>
+
+namespace morph {
+
+    //! What state is an instance of the CMAES class in?
+    enum class CMAES_State
+    {
+        // The state is unknown
+        Unknown,
+        // Client code needs to call the init() function to setup parameters
+        NeedToInit,
+        // Client needs to compute f_x_cands, the objectives of the population x_cands
+        NeedToComputeBatch,
+        // The algorithm has finished
+        ReadyToStop
+    };
+
+    //! Why did a run (between restarts), or the whole optimisation, stop?
+    enum class CMAES_StopCondition
+    {
+        Unknown,
+        // The objective changed by less than tol_fun over recent generations
+        TolFun,
+        // The search distribution is smaller than tol_x in every direction
+        TolX,
+        // The condition number of the covariance matrix exceeded max_condition
+        ConditionCov,
+        // Adding a step of 0.2 standard deviations to the mean did not change it
+        NoEffectCoord,
+        // f_x_best reached target
+        TargetReached,
+        // max_evaluations objectives were computed
+        MaxEvaluations,
+        // max_restarts restarts were made
+        MaxRestarts
+    };
+
+    //! How CMAES restarts once a run has stopped
+    enum class CMAES_Restart
+    {
+        // Don't restart
+        None,
+        // Restart with twice the population each time. Suits multimodal objectives with global structure.
+        IPOP,
+        // Alternate between IPOP runs and runs with small populations and step sizes, sharing the evaluations between them
+        BIPOP
+    };
+
+    /*!
+     * A CMA-ES optimiser. The design is that of Anneal and NM_Simplex: the client code creates
+     * a CMAES object, sets parameters, calls init() and then runs a loop, computing the
+     * objectives of the whole population, x_cands, whenever state is NeedToComputeBatch and
+     * then calling step(). The population holds lambda candidates, which may be computed in
+     * parallel (compute() does this with OpenMP). Each generation moves the mean towards the
+     * best of them and adapts the step size sigma and the covariance matrix C of the sampling
+     * distribution, which learns the scaling and correlations of the parameters. Each run stops
+     * when the distribution has converged; the optimisation then restarts (see CMAES_Restart)
+     * until max_restarts or max_evaluations is reached.
+     *
+     * \tparam T The type for the numbers in the algorithm. Expected to be floating
+     * point, so float or double.
+     *
+     * \tparam debug Set true to show some text output
+     */
+    template <typename T, bool debug=false>
+    class CMAES
+    {
+    public: // Algorithm parameters to be adjusted by user before calling CMAES::init()
+
+        //! By default we *descend* to the *minimum* of the objective. Set false to ascend to the maximum.
+        bool downhill = true;
+        //! The initial step size. A quarter to a third of the width of the region to search is a good choice.
+        T sigma0 = T{0.3};
+        //! The population of the first run. If 0, the default of 4 + 3 ln(D) is used.
+        unsigned int lambda0 = 0;
+        //! The restart strategy
+        CMAES_Restart restart = CMAES_Restart::IPOP;
+        //! The most restarts. For BIPOP, this counts only the restarts with a larger population.
+        unsigned int max_restarts = 9;
+        //! Stop once this many objectives have been computed
+        unsigned long long int max_evaluations = std::numeric_limits<unsigned long long int>::max();
+        //! If true, stop once f_x_best is at least as good as target
+        bool stop_at_target = false;
+        T target = T{0};
+        //! A run stops when the best objectives of recent generations, and of the current
+        //! population, all lie within tol_fun of each other...
+        T tol_fun = T{1e-12};
+        //! ...or when the distribution's standard deviation is less than tol_x (times sigma0) in every direction...
+        T tol_x = T{1e-12};
+        //! ...or when the covariance matrix's condition number exceeds this
+        T max_condition = T{1e14};
+        //! Save the population of every generation in the history (see save())
+        bool save_populations = false;
+
+    public: // The population and its objectives need to be client-accessible.
+
+        //! Allow user to set parameter names, so that these can be saved out
+        std::vector<std::string> param_names;
+        //! The population of candidates, to be computed by the client
+        morph::vvec<morph::vvec<T>> x_cands;
+        //! The objective function values of x_cands, to be computed by the client
+        morph::vvec<T> f_x_cands;
+        //! The best parameters so far, over all runs
+        morph::vvec<T> x_best;
+        //! The value of the objective function for the best parameters
+        T f_x_best = T{0};
+
+    public: // Statistical records and state.
+
+        //! The number of objectives computed
+        unsigned long long int evaluations = 0;
+        //! The number of generations, over all runs, and within the current run
+        unsigned int generations = 0;
+        unsigned int run_generations = 0;
+        //! The number of restarts made
+        unsigned int restarts = 0;
+        //! The best objective of each generation
+        morph::vvec<T> f_gen_best_hist;
+        //! f_x_best after each generation
+        morph::vvec<T> f_x_best_hist;
+        //! sigma at each generation
+        morph::vvec<T> sigma_hist;
+        //! The population size of each generation
+        morph::vvec<unsigned int> lambda_hist;
+        //! The mean of the distribution at each generation
+        morph::vvec<morph::vvec<T>> mean_hist;
+        //! If save_populations, every population and its objectives
+        morph::vvec<morph::vvec<T>> population_hist;
+        morph::vvec<T> f_population_hist;
+        //! The generation at which each restart was made, and why the run before it stopped
+        morph::vvec<unsigned int> restart_generations;
+        std::vector<CMAES_StopCondition> run_stop_conditions;
+
+        //! The state tells client code what it needs to do next.
+        CMAES_State state = CMAES_State::Unknown;
+        //! The stopping condition is recorded
+        CMAES_StopCondition reason_for_exit = CMAES_StopCondition::Unknown;
+
+    public: // Internal algorithm parameters, but public so it's easy to make graphs
+
+        //! The number of dimensions in the parameter search space
+        unsigned int D = 0;
+        //! The population size and number of parents of the current run
+        unsigned int lambda = 0;
+        unsigned int mu = 0;
+        //! The recombination weights and their variance effective selection mass
+        morph::vvec<T> weights;
+        T mueff = T{0};
+        //! Learning rates: cumulation for C and sigma, rank one and rank mu updates, sigma damping
+        T cc = T{0};
+        T cs = T{0};
+        T c1 = T{0};
+        T cmu = T{0};
+        T damps = T{0};
+        //! E|N(0,I)|
+        T chiN = T{0};
+        //! The mean and step size of the sampling distribution
+        morph::vvec<T> mean;
+        T sigma = T{0};
+        //! The evolution paths for C and sigma
+        morph::vvec<T> pc;
+        morph::vvec<T> ps;
+        //! The covariance matrix (row major, D by D) and its eigendecomposition C = B diag(eigvals) B^T
+        morph::vvec<T> C;
+        morph::vvec<T> B;
+        morph::vvec<T> eigvals;
+        //! Parameter ranges, if given. Candidates are kept within them.
+        morph::vvec<T> range_min;
+        morph::vvec<T> range_max;
+        //! The random number generators used to sample the population and restart points
+        morph::RandNormal<T> rng_n;
+        morph::RandUniform<T> rng_u;
+
+    public: // User-accessible methods.
+
+        //! Search from initial_params, with no bounds
+        CMAES (const morph::vvec<T>& initial_params) { this->setup (initial_params); }
+
+        //! Search from initial_params, with a fixed seed for the random numbers
+        CMAES (const morph::vvec<T>& initial_params, unsigned int _seed)
+            : rng_n (_seed), rng_u (_seed + 1u) { this->setup (initial_params); }
+
+        /*!
+         * Search from initial_params within param_ranges. sigma0 is set to 0.3 of the mean
+         * range (the parameters are best scaled to have similar ranges) and, when restarting,
+         * the search starts from a random point within the ranges.
+         */
+        CMAES (const morph::vvec<T>& initial_params, const morph::vvec<morph::vec<T,2>>& param_ranges)
+        {
+            this->setup (initial_params);
+            this->set_ranges (param_ranges);
+        }
+
+        CMAES (const morph::vvec<T>& initial_params, const morph::vvec<morph::vec<T,2>>& param_ranges, unsigned int _seed)
+            : rng_n (_seed), rng_u (_seed + 1u)
+        {
+            this->setup (initial_params);
+            this->set_ranges (param_ranges);
+        }
+
+        //! After constructing, then setting parameters, the user must call init.
+        void init()
+        {
+            this->f_x_best = this->downhill ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+            this->x_best = this->x0;
+            this->evaluations = 0;
+            this->generations = 0;
+            this->restarts = 0;
+            this->lambda_default = this->lambda0 > 0 ? this->lambda0
+                                                     : 4u + static_cast<unsigned int>(std::floor (T{3} * std::log (static_cast<T>(this->D))));
+            this->lambda_large = this->lambda_default;
+            this->budget_large = 0;
+            this->budget_small = 0;
+            this->large_run = true;
+            this->large_restarts = 0;
+            this->start_run (this->x0, this->sigma0, this->lambda_default);
+        }
+
+        //! Update the distribution from the objectives of the population, then sample the next population.
+        void step()
+        {
+            if (this->state != CMAES_State::NeedToComputeBatch) {
+                throw std::runtime_error ("CMAES::step: call init() first, and don't step once ReadyToStop");
+            }
+            if (this->f_x_cands.size() != this->x_cands.size()) {
+                throw std::runtime_error ("CMAES::step: f_x_cands must hold an objective value for each of x_cands");
+            }
+            this->evaluations += this->lambda;
+            if (this->large_run) { this->budget_large += this->lambda; } else { this->budget_small += this->lambda; }
+            ++this->generations;
+            ++this->run_generations;
+
+            // Rank the population, best first
+            std::vector<unsigned int> order (this->lambda);
+            std::iota (order.begin(), order.end(), 0u);
+            std::sort (order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return this->better (this->f_x_cands[a], this->f_x_cands[b]); });
+            const T f_gen_best = this->f_x_cands[order[0]];
+            if (this->better (f_gen_best, this->f_x_best)) {
+                this->f_x_best = f_gen_best;
+                this->x_best = this->x_cands[order[0]];
+            }
+            this->record (f_gen_best);
+            this->update_distribution (order);
+
+            // Check the run's stopping conditions over the objectives of recent generations
+            this->recent_best.push_back (f_gen_best);
+            const std::size_t hist_len = 10u + static_cast<std::size_t>(std::ceil (T{30} * this->D / this->lambda));
+            if (this->recent_best.size() > hist_len) { this->recent_best.erase (this->recent_best.begin()); }
+            const T f_gen_worst = this->f_x_cands[order[this->lambda - 1]];
+
+            if (this->stop_at_target && !this->better (this->target, this->f_x_best)) {
+                return this->finish (CMAES_StopCondition::TargetReached);
+            }
+            if (this->evaluations >= this->max_evaluations) { return this->finish (CMAES_StopCondition::MaxEvaluations); }
+
+            CMAES_StopCondition run_stop = this->run_stop_check (f_gen_best, f_gen_worst, hist_len);
+            if (run_stop != CMAES_StopCondition::Unknown) {
+                this->run_stop_conditions.push_back (run_stop);
+                if (this->restart == CMAES_Restart::None) { return this->finish (run_stop); }
+                if (this->large_restarts >= this->max_restarts) { return this->finish (CMAES_StopCondition::MaxRestarts); }
+                this->restart_run();
+                return;
+            }
+            this->sample();
+        }
+
+        /*!
+         * Compute the objectives of the population by calling objective (const
+         * morph::vvec<T>&) which returns a T. The candidates are computed in parallel, so
+         * objective must be safe to call from several threads at once.
+         */
+        template <typename F>
+        void compute (F objective)
+        {
+            if (this->state != CMAES_State::NeedToComputeBatch) { return; }
+            const int nc = static_cast<int>(this->x_cands.size());
+            this->f_x_cands.resize (nc);
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int j = 0; j < nc; ++j) { this->f_x_cands[j] = objective (this->x_cands[j]); }
+        }
+
+        //! Run the whole optimisation (calling init() first if necessary), computing the
+        //! objectives with compute (objective).
+        template <typename F>
+        void run (F objective)
+        {
+            if (this->state == CMAES_State::NeedToInit) { this->init(); }
+            while (this->state != CMAES_State::ReadyToStop) {
+                this->compute (objective);
+                this->step();
+            }
+        }
+
+        //! Save optimization info/history into an HDF5 file, along with the optimization parameters.
+        void save (const std::string& path) const
+        {
+            morph::HdfData data(path, morph::FileAccess::TruncateWrite);
+            data.add_contained_vals ("/f_gen_best_hist", this->f_gen_best_hist);
+            data.add_contained_vals ("/f_x_best_hist", this->f_x_best_hist);
+            data.add_contained_vals ("/sigma_hist", this->sigma_hist);
+            data.add_contained_vals ("/lambda_hist", this->lambda_hist);
+            if (!this->mean_hist.empty()) { data.add_contained_vals ("/mean_hist", this->mean_hist); }
+            if (!this->population_hist.empty()) {
+                data.add_contained_vals ("/population_hist", this->population_hist);
+                data.add_contained_vals ("/f_population_hist", this->f_population_hist);
+            }
+            data.add_contained_vals ("/restart_generations", this->restart_generations);
+            std::vector<int> rsc;
+            for (auto c : this->run_stop_conditions) { rsc.push_back (static_cast<int>(c)); }
+            data.add_contained_vals ("/run_stop_conditions", rsc);
+            data.add_contained_vals ("/x_best", this->x_best);
+            int i = 1;
+            for (auto pn : this->param_names) {
+                std::string s_name = "/param_name_" + std::to_string(i++);
+                data.add_string (s_name.c_str(), pn);
+            }
+            data.add_val ("/f_x_best", this->f_x_best);
+            data.add_val ("/evaluations", this->evaluations);
+            data.add_val ("/generations", this->generations);
+            data.add_val ("/restarts", this->restarts);
+            data.add_val ("/reason_for_exit", static_cast<int>(this->reason_for_exit));
+
+            data.add_val ("/D", this->D);
+            data.add_contained_vals ("/x0", this->x0);
+            data.add_contained_vals ("/mean", this->mean);
+            data.add_val ("/sigma", this->sigma);
+            data.add_contained_vals ("/C", this->C);
+            if (!this->range_min.empty()) {
+                data.add_contained_vals ("/range_min", this->range_min);
+                data.add_contained_vals ("/range_max", this->range_max);
+            }
+
+            data.add_val ("/downhill", this->downhill);
+            data.add_val ("/sigma0", this->sigma0);
+            data.add_val ("/lambda0", this->lambda0);
+            data.add_val ("/restart", static_cast<int>(this->restart));
+            data.add_val ("/max_restarts", this->max_restarts);
+            data.add_val ("/tol_fun", this->tol_fun);
+            data.add_val ("/tol_x", this->tol_x);
+            data.add_val ("/max_condition", this->max_condition);
+        }
+
+    protected: // Internal algorithm methods and state.
+
+        //! The initial parameters, the centre of the first run
+        morph::vvec<T> x0;
+        //! The candidates as sampled, y = (x - mean) / sigma, before any clamping to the ranges
+        morph::vvec<morph::vvec<T>> y_cands;
+        //! The best objective of recent generations of this run
+        std::vector<T> recent_best;
+        //! The generation of this run at which B and eigvals were last computed from C
+        unsigned int eigen_generation = 0;
+        //! BIPOP's bookkeeping: the default and large populations, and the evaluations used by each regime
+        unsigned int lambda_default = 0;
+        unsigned int lambda_large = 0;
+        unsigned long long int budget_large = 0;
+        unsigned long long int budget_small = 0;
+        bool large_run = true;
+        unsigned int large_restarts = 0;
+
+        void setup (const morph::vvec<T>& initial_params)
+        {
+            this->D = initial_params.size();
+            if (this->D == 0) { throw std::runtime_error ("CMAES: initial_params is empty"); }
+            this->x0 = initial_params;
+            this->x_best = initial_params;
+            this->state = CMAES_State::NeedToInit;
+        }
+
+        void set_ranges (const morph::vvec<morph::vec<T,2>>& param_ranges)
+        {
+            if (param_ranges.size() != this->D) { throw std::runtime_error ("CMAES: need one range per parameter"); }
+            this->range_min.resize (this->D);
+            this->range_max.resize (this->D);
+            for (unsigned int i = 0; i < this->D; ++i) {
+                this->range_min[i] = param_ranges[i][0];
+                this->range_max[i] = param_ranges[i][1];
+            }
+            this->sigma0 = T{0.3} * (this->range_max - this->range_min).mean();
+        }
+
+        bool better (const T a, const T b) const { return this->downhill ? a < b : a > b; }
+
+        //! Set the strategy parameters for a population of _lambda and sample the first population of a run
+        void start_run (const morph::vvec<T>& m0, const T _sigma, const unsigned int _lambda)
+        {
+            const T n = static_cast<T>(this->D);
+            this->lambda = std::max (2u, _lambda);
+            this->mu = this->lambda / 2u;
+            this->weights.resize (this->mu);
+            for (unsigned int i = 0; i < this->mu; ++i) {
+                this->weights[i] = std::log (static_cast<T>(this->lambda) / T{2} + T{0.5}) - std::log (static_cast<T>(i + 1));
+            }
+            this->weights /= this->weights.sum();
+            this->mueff = T{1} / this->weights.sos();
+            this->cc = (T{4} + this->mueff / n) / (n + T{4} + T{2} * this->mueff / n);
+            this->cs = (this->mueff + T{2}) / (n + this->mueff + T{5});
+            this->c1 = T{2} / ((n + T{1.3}) * (n + T{1.3}) + this->mueff);
+            this->cmu = std::min (T{1} - this->c1,
+                                  T{2} * (this->mueff - T{2} + T{1} / this->mueff) / ((n + T{2}) * (n + T{2}) + this->mueff));
+            this->damps = T{1} + T{2} * std::max (T{0}, std::sqrt ((this->mueff - T{1}) / (n + T{1})) - T{1}) + this->cs;
+            this->chiN = std::sqrt (n) * (T{1} - T{1} / (T{4} * n) + T{1} / (T{21} * n * n));
+
+            this->mean = m0;
+            this->sigma = _sigma;
+            this->pc.assign (this->D, T{0});
+            this->ps.assign (this->D, T{0});
+            this->C.assign (this->D * this->D, T{0});
+            this->B.assign (this->D * this->D, T{0});
+            for (unsigned int i = 0; i < this->D; ++i) {
+                this->C[i * this->D + i] = T{1};
+                this->B[i * this->D + i] = T{1};
+            }
+            this->eigvals.assign (this->D, T{1});
+            this->eigen_generation = 0;
+            this->run_generations = 0;
+            this->recent_best.clear();
+            if constexpr (debug) {
+                std::cout << "CMAES: run " << this->restarts << " with lambda = " << this->lambda << ", sigma = " << this->sigma << "\n";
+            }
+            this->sample();
+        }
+
+        //! Sample lambda candidates from N(mean, sigma^2 C)
+        void sample()
+        {
+            const unsigned int n = this->D;
+            this->x_cands.resize (this->lambda);
+            this->y_cands.resize (this->lambda);
+            morph::vvec<T> z (n);
+            morph::vvec<T> sd = this->eigvals.sqrt();
+            for (unsigned int k = 0; k < this->lambda; ++k) {
+                morph::vvec<T>& y = this->y_cands[k];
+                morph::vvec<T>& x = this->x_cands[k];
+                // Resample a candidate outside the ranges a few times before clamping it
+                for (unsigned int attempt = 0; attempt < 10u; ++attempt) {
+                    for (unsigned int i = 0; i < n; ++i) { z[i] = this->rng_n.get() * sd[i]; }
+                    y.assign (n, T{0});
+                    for (unsigned int i = 0; i < n; ++i) {
+                        for (unsigned int j = 0; j < n; ++j) { y[i] += this->B[i * n + j] * z[j]; }
+                    }
+                    x = this->mean + y * this->sigma;
+                    if (this->within_ranges (x)) { break; }
+                }
+                if (!this->range_min.empty()) {
+                    for (unsigned int i = 0; i < n; ++i) { x[i] = std::clamp (x[i], this->range_min[i], this->range_max[i]); }
+                    // The update learns from the step that was actually evaluated
+                    y = (x - this->mean) / this->sigma;
+                }
+            }
+            this->f_x_cands.assign (this->lambda, T{0});
+            this->state = CMAES_State::NeedToComputeBatch;
+        }
+
+        bool within_ranges (const morph::vvec<T>& x) const
+        {
+            if (this->range_min.empty()) { return true; }
+            for (unsigned int i = 0; i < this->D; ++i) {
+                if (x[i] < this->range_min[i] || x[i] > this->range_max[i]) { return false; }
+            }
+            return true;
+        }
+
+        void record (const T f_gen_best)
+        {
+            this->f_gen_best_hist.push_back (f_gen_best);
+            this->f_x_best_hist.push_back (this->f_x_best);
+            this->sigma_hist.push_back (this->sigma);
+            this->lambda_hist.push_back (this->lambda);
+            this->mean_hist.push_back (this->mean);
+            if (this->save_populations) {
+                for (unsigned int k = 0; k < this->lambda; ++k) {
+                    this->population_hist.push_back (this->x_cands[k]);
+                    this->f_population_hist.push_back (this->f_x_cands[k]);
+                }
+            }
+        }
+
+        //! Move the mean and adapt sigma and C from the population, ranked by order
+        void update_distribution (const std::vector<unsigned int>& order)
+        {
+            const unsigned int n = this->D;
+            // The weighted mean step of the best mu
+            morph::vvec<T> yw (n, T{0});
+            for (unsigned int i = 0; i < this->mu; ++i) { yw += this->y_cands[order[i]] * this->weights[i]; }
+            this->mean += yw * this->sigma;
+
+            // C^-1/2 yw = B diag(1/sqrt(eigvals)) B^T yw
+            morph::vvec<T> bty (n, T{0});
+            for (unsigned int j = 0; j < n; ++j) {
+                for (unsigned int i = 0; i < n; ++i) { bty[j] += this->B[i * n + j] * yw[i]; }
+                bty[j] /= std::sqrt (this->eigvals[j]);
+            }
+            morph::vvec<T> cy (n, T{0});
+            for (unsigned int i = 0; i < n; ++i) {
+                for (unsigned int j = 0; j < n; ++j) { cy[i] += this->B[i * n + j] * bty[j]; }
+            }
+            this->ps = this->ps * (T{1} - this->cs) + cy * std::sqrt (this->cs * (T{2} - this->cs) * this->mueff);
+            const T psn = this->ps.length() / std::sqrt (T{1} - std::pow (T{1} - this->cs, T{2} * this->run_generations));
+            const bool hsig = psn / this->chiN < T{1.4} + T{2} / (static_cast<T>(n) + T{1});
+            this->pc *= (T{1} - this->cc);
+            if (hsig) { this->pc += yw * std::sqrt (this->cc * (T{2} - this->cc) * this->mueff); }
+
+            // The rank one and rank mu updates of C
+            const T c1a = this->c1 * (hsig ? T{1} : T{1} - this->cc * (T{2} - this->cc));
+            const T keep = T{1} - c1a - this->cmu;
+            for (unsigned int i = 0; i < n; ++i) {
+                for (unsigned int j = 0; j <= i; ++j) {
+                    T rmu = T{0};
+                    for (unsigned int k = 0; k < this->mu; ++k) {
+                        const morph::vvec<T>& y = this->y_cands[order[k]];
+                        rmu += this->weights[k] * y[i] * y[j];
+                    }
+                    const T cij = keep * this->C[i * n + j] + this->c1 * this->pc[i] * this->pc[j] + this->cmu * rmu;
+                    this->C[i * n + j] = cij;
+                    this->C[j * n + i] = cij;
+                }
+            }
+
+            this->sigma *= std::exp ((this->cs / this->damps) * (this->ps.length() / this->chiN - T{1}));
+
+            // The eigendecomposition costs O(D^3), so it is only redone often enough to keep up with C
+            const T gap = static_cast<T>(this->lambda) / ((this->c1 + this->cmu) * static_cast<T>(n) * T{10});
+            if (static_cast<T>(this->run_generations - this->eigen_generation) >= gap) {
+                this->eigen_generation = this->run_generations;
+                this->eigendecompose();
+            }
+        }
+
+        //! B and eigvals from C, by cyclic Jacobi rotations
+        void eigendecompose()
+        {
+            const unsigned int n = this->D;
+            morph::vvec<T> a = this->C;
+            morph::vvec<T>& v = this->B;
+            v.assign (n * n, T{0});
+            for (unsigned int i = 0; i < n; ++i) { v[i * n + i] = T{1}; }
+            for (unsigned int sweep = 0; sweep < 50u; ++sweep) {
+                T off = T{0};
+                for (unsigned int i = 0; i < n; ++i) {
+                    for (unsigned int j = i + 1; j < n; ++j) { off += a[i * n + j] * a[i * n + j]; }
+                }
+                if (off <= std::numeric_limits<T>::min()) { break; }
+                for (unsigned int p = 0; p < n; ++p) {
+                    for (unsigned int q = p + 1; q < n; ++q) {
+                        const T apq = a[p * n + q];
+                        if (apq == T{0}) { continue; }
+                        const T theta = (a[q * n + q] - a[p * n + p]) / (T{2} * apq);
+                        const T t = std::copysign (T{1}, theta) / (std::abs (theta) + std::sqrt (theta * theta + T{1}));
+                        const T c = T{1} / std::sqrt (t * t + T{1});
+                        const T s = t * c;
+                        for (unsigned int k = 0; k < n; ++k) {
+                            const T akp = a[k * n + p];
+                            const T akq = a[k * n + q];
+                            a[k * n + p] = c * akp - s * akq;
+                            a[k * n + q] = s * akp + c * akq;
+                        }
+                        for (unsigned int k = 0; k < n; ++k) {
+                            const T apk = a[p * n + k];
+                            const T aqk = a[q * n + k];
+                            a[p * n + k] = c * apk - s * aqk;
+                            a[q * n + k] = s * apk + c * aqk;
+                        }
+                        for (unsigned int k = 0; k < n; ++k) {
+                            const T vkp = v[k * n + p];
+                            const T vkq = v[k * n + q];
+                            v[k * n + p] = c * vkp - s * vkq;
+                            v[k * n + q] = s * vkp + c * vkq;
+                        }
+                    }
+                }
+            }
+            // Rounding can leave tiny negative eigenvalues of a nearly singular C
+            for (unsigned int i = 0; i < n; ++i) {
+                this->eigvals[i] = std::max (a[i * n + i], std::numeric_limits<T>::min());
+            }
+        }
+
+        //! The reason this run should stop, or Unknown if it should go on
+        CMAES_StopCondition run_stop_check (const T f_gen_best, const T f_gen_worst, const std::size_t hist_len) const
+        {
+            const unsigned int n = this->D;
+            if (this->recent_best.size() >= hist_len) {
+                auto [mn, mx] = std::minmax_element (this->recent_best.begin(), this->recent_best.end());
+                if ((*mx - *mn) < this->tol_fun && std::abs (f_gen_worst - f_gen_best) < this->tol_fun) {
+                    return CMAES_StopCondition::TolFun;
+                }
+            }
+            bool small = true;
+            for (unsigned int i = 0; i < n && small; ++i) {
+                const T sd = this->sigma * std::max (std::abs (this->pc[i]), std::sqrt (this->C[i * n + i]));
+                small = sd < this->tol_x * this->sigma0;
+            }
+            if (small) { return CMAES_StopCondition::TolX; }
+            const T emax = this->eigvals.max();
+            const T emin = this->eigvals.min();
+            if (emax > this->max_condition * emin) { return CMAES_StopCondition::ConditionCov; }
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->mean[i] == this->mean[i] + T{0.2} * this->sigma * std::sqrt (this->C[i * n + i])) {
+                    return CMAES_StopCondition::NoEffectCoord;
+                }
+            }
+            return CMAES_StopCondition::Unknown;
+        }
+
+        //! Start again, from x0 or a random point within the ranges, with the population the restart strategy chooses
+        void restart_run()
+        {
+            ++this->restarts;
+            this->restart_generations.push_back (this->generations);
+            morph::vvec<T> m0 = this->x0;
+            if (!this->range_min.empty()) {
+                for (unsigned int i = 0; i < this->D; ++i) {
+                    m0[i] = this->range_min[i] + this->rng_u.get() * (this->range_max[i] - this->range_min[i]);
+                }
+            }
+            if (this->restart == CMAES_Restart::BIPOP && this->budget_small < this->budget_large) {
+                // A small population with a small step size, for a local search. u^2 favours populations near lambda_default.
+                const T u = this->rng_u.get();
+                const T ratio = static_cast<T>(this->lambda_large) / static_cast<T>(this->lambda_default);
+                const unsigned int ls = static_cast<unsigned int>(std::floor (this->lambda_default * std::pow (ratio, u * u)));
+                this->large_run = false;
+                this->start_run (m0, this->sigma0 * std::pow (T{10}, T{-2} * this->rng_u.get()), std::max (ls, this->lambda_default));
+            } else {
+                this->lambda_large *= 2u;
+                this->large_run = true;
+                ++this->large_restarts;
+                this->start_run (m0, this->sigma0, this->lambda_large);
+            }
+        }
+
+        void finish (const CMAES_StopCondition why)
+        {
+            this->reason_for_exit = why;
+            this->state = CMAES_State::ReadyToStop;
+            if constexpr (debug) { std::cout << "CMAES: finished with f_x_best = " << this->f_x_best << "\n"; }
+        }
+    };
+
+} // namespace morph
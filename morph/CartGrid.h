@@ -22,6 +22,10 @@
 #include <morph/vvec.h>
 #include <morph/scale.h>
 #include <morph/range.h>
+#include <morph/MathAlgo.h>
+#include <morph/kd_tree.h>
+#include <morph/shift_operator.h>
+#include <morph/memory_usage.h>
 
 // If the CartGrid::save and CartGrid::load methods are required, define
 // CARTGRID_COMPILE_LOAD_AND_SAVE. A link to libhdf5 will be required in your program.
@@ -31,6 +35,7 @@
 
 #include <set>
 #include <list>
+#include <algorithm>
 #include <string>
 #include <array>
 #include <stdexcept>
@@ -167,6 +172,38 @@ namespace morph {
             return new_indicies;
         }
 
+        /*!
+         * Make the operator that shifts data (and indices) on this grid by the metric shifts
+         * x_shift and y_shift, rounded to whole rects as in shiftIndiciesByMetric(). Data that is
+         * shifted off the edge of the CartGrid is dropped, and the rects it leaves are set to 0.
+         * Only for rectangular cartgrids with populated d_ vectors.
+         */
+        morph::shift_operator<float> shiftOperatorByMetric (float x_shift, float y_shift) const
+        {
+            int w = 1 + this->x_span/this->d;
+            int x_step = static_cast<int>(std::round(x_shift/this->d));
+            int y_step = static_cast<int>(std::round(y_shift/this->v));
+            const unsigned int n = static_cast<unsigned int>(this->d_xi.size());
+            std::vector<morph::shift_operator<float>::entry> entries;
+            entries.reserve (n);
+            for (unsigned int i = 0; i < n; ++i) {
+                int x_moved = this->d_xi[i] + x_step;
+                if (this->xi_minmax.includes (x_moved) == false) { continue; }
+                int y_moved = this->d_yi[i] + y_step;
+                if (this->yi_minmax.includes (y_moved) == false) { continue; }
+                int dst = (x_moved - this->xi_minmax.min) + w * (y_moved - this->yi_minmax.min);
+                if (dst < 0 || static_cast<unsigned int>(dst) >= n) { continue; }
+                entries.push_back ({ i, static_cast<unsigned int>(dst), 1.0f });
+            }
+            return morph::shift_operator<float> (n, entries);
+        }
+
+        //! Shift the indices inds with an operator made by shiftOperatorByMetric()
+        morph::vvec<int> shiftIndiciesByMetric (const morph::vvec<int>& inds, const morph::shift_operator<float>& op) const
+        {
+            return op.shift_indices (inds);
+        }
+
         //! Get all the (x,y,z) coordinates from the grid and return as vector of Vectors
         std::vector<morph::vec<float, 3>> getCoordinates3()
         {
@@ -429,9 +466,11 @@ namespace morph {
             cgdata.read_contained_vals ("/d_yi", this->d_yi);
             cgdata.read_contained_vals ("/d_ne", this->d_ne);
             cgdata.read_contained_vals ("/d_nne", this->d_nne);
+            cgdata.read_contained_vals ("/d_nn", this->d_nn);
             cgdata.read_contained_vals ("/d_nnw", this->d_nnw);
             cgdata.read_contained_vals ("/d_nw", this->d_nw);
             cgdata.read_contained_vals ("/d_nsw", this->d_nsw);
+            cgdata.read_contained_vals ("/d_ns", this->d_ns);
             cgdata.read_contained_vals ("/d_nse", this->d_nse);
             cgdata.read_contained_vals ("/d_flags", this->d_flags);
 
@@ -448,145 +487,27 @@ namespace morph {
             }
 
             // After creating rects list, need to set neighbour relations in each Rect, as loaded in d_ne,
-            // etc.
-            for (morph::Rect& _r : this->rects) {
-                DBG ("Set neighbours for Rect " << _r.outputRG());
-                // For each Rect, six loops through rects:
-                if (_r.has_ne() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_ne[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.ne = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour E relation...");
-                    }
-                }
-
-                if (_r.has_nne() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nne[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.nne = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour NE relation...");
-                    }
-                }
-
-                if (_r.has_nn() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nn[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.nn = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour N relation...");
-                    }
-                }
-
-                if (_r.has_nnw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nnw[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.nnw = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour NW relation...");
-                    }
-                }
-
-                if (_r.has_nw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nw[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.nw = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour W relation...");
-                    }
-                }
-
-                if (_r.has_nsw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nsw[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.nsw = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour SW relation...");
-                    }
-                }
-
-                if (_r.has_ns() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_ns[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.ns = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour S relation...");
-                    }
-                }
-
-                if (_r.has_nse() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nse[_r.vi];
-                    std::list<morph::Rect>::iterator ri = this->rects.begin();
-                    while (ri != this->rects.end()) {
-                        if (ri->vi == neighb_it) {
-                            matched = true;
-                            _r.nse = ri;
-                            break;
-                        }
-                        ++ri;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match rects neighbour SE relation...");
-                    }
+            // etc. Look the neighbours up by vector index, rather than searching rects for each one.
+            std::vector<std::list<morph::Rect>::iterator> byvi;
+            for (auto ri = this->rects.begin(); ri != this->rects.end(); ++ri) {
+                if (ri->vi >= byvi.size()) { byvi.resize (ri->vi + 1, this->rects.end()); }
+                byvi[ri->vi] = ri;
+            }
+            auto neighbour = [this, &byvi](int ni, const char* dirn) {
+                if (ni < 0 || static_cast<unsigned int>(ni) >= byvi.size() || byvi[ni] == this->rects.end()) {
+                    throw std::runtime_error (std::string("Failed to match rects neighbour ") + dirn + " relation...");
                 }
+                return byvi[ni];
+            };
+            for (morph::Rect& _r : this->rects) {
+                if (_r.has_ne() == true) { _r.ne = neighbour (this->d_ne[_r.vi], "E"); }
+                if (_r.has_nne() == true) { _r.nne = neighbour (this->d_nne[_r.vi], "NE"); }
+                if (_r.has_nn() == true) { _r.nn = neighbour (this->d_nn[_r.vi], "N"); }
+                if (_r.has_nnw() == true) { _r.nnw = neighbour (this->d_nnw[_r.vi], "NW"); }
+                if (_r.has_nw() == true) { _r.nw = neighbour (this->d_nw[_r.vi], "W"); }
+                if (_r.has_nsw() == true) { _r.nsw = neighbour (this->d_nsw[_r.vi], "SW"); }
+                if (_r.has_ns() == true) { _r.ns = neighbour (this->d_ns[_r.vi], "S"); }
+                if (_r.has_nse() == true) { _r.nse = neighbour (this->d_nse[_r.vi], "SE"); }
             }
         }
 #endif // CARTGRID_COMPILE_LOAD_AND_SAVE
@@ -925,6 +846,115 @@ namespace morph {
             //polar_data /= polar_data.max(); // renormalise?
         }
 
+        /*!
+         * The parts of resampleToPolar() that stay the same from one view to the next, for a
+         * given polar grid, radial scaling and image grid. Make it with makePolarStencil().
+         */
+        struct polar_stencil
+        {
+            //! For each polar sample, its location relative to the view position with a zero view angle
+            std::vector<morph::vec<float, 2>> offsets;
+            //! The factor for the Gaussian weights of the pixels around each sample
+            float assumecirc = 0.0f;
+            //! The image grid that the stencil was made for: its rect spacing and its number of columns and rows
+            morph::vec<float, 2> dist_per_pix = { 0.0f, 0.0f };
+            morph::vec<int, 2> cols_rows = { 0, 0 };
+        };
+
+        /*!
+         * Compute the sample locations (in polar coordinates, relative to the view) and weight
+         * parameter that resampleToPolar() computes on each call, so that the resampling for
+         * each new view_pos and view_angle is just a rotation and translation of the samples.
+         * This grid is assumed to be rectangular, with its d_ vectors in raster order.
+         */
+        polar_stencil makePolarStencil (morph::CartGrid& cg_polar, morph::scaling_function radscale = morph::scaling_function::Linear)
+        {
+            polar_stencil st;
+            st.dist_per_pix = { this->d, this->v };
+            morph::vec<float, 2> params = 1.0f / (2.0f * st.dist_per_pix * st.dist_per_pix);
+            st.assumecirc = params.mean();
+            st.cols_rows = { this->xi_minmax.span() + 1, this->yi_minmax.span() + 1 };
+            if (static_cast<std::size_t>(st.cols_rows.product()) != this->d_x.size()) {
+                throw std::runtime_error ("CartGrid::makePolarStencil: The image grid must be rectangular");
+            }
+
+            morph::vec<float, 2> polar_span = cg_polar.getSpan();
+            morph::vec<unsigned int, 2> polar_span_pix = cg_polar.getSpanPix();
+            if (polar_span_pix[0]%2 == 0) {
+                throw std::runtime_error ("Fix cg_polar to have an odd width (so that it runs from -x:0:+x)");
+            }
+            float rad_per_dist = morph::mathconst<float>::two_pi/(polar_span[0]+cg_polar.getd());
+
+            st.offsets.resize (cg_polar.num());
+            for (unsigned int xi = 0; xi < cg_polar.num(); ++xi) {
+                float r = cg_polar.d_y[xi];
+                if (radscale == morph::scaling_function::Logarithmic) {
+                    r = (std::log (this->v+cg_polar.d_y[xi]) - std::log(this->v)) * 0.4f;
+                }
+                float phi = cg_polar.d_x[xi] * rad_per_dist;
+                st.offsets[xi] = { r * std::cos (phi), r * std::sin (phi) };
+            }
+            return st;
+        }
+
+        /*!
+         * Resample image_data to polar_data as resampleToPolar() does, using a stencil made by
+         * makePolarStencil() for this grid. The pixel nearest to each sample is found by
+         * rounding, rather than by a search, and the Gaussian weights of the 3x3 pixels around
+         * it are computed as products of weights in x and in y.
+         */
+        void resampleToPolar (const morph::vvec<float>& image_data, const polar_stencil& st,
+                              morph::vvec<float>& polar_data, morph::vec<float, 2> view_pos, float view_angle) const
+        {
+            if (st.dist_per_pix[0] != this->d || st.dist_per_pix[1] != this->v
+                || static_cast<std::size_t>(st.cols_rows.product()) != this->d_x.size()) {
+                throw std::runtime_error ("CartGrid::resampleToPolar: The stencil was made for a different grid");
+            }
+            polar_data.resize (st.offsets.size());
+            const float ca = std::cos (view_angle);
+            const float sa = std::sin (view_angle);
+            const int nc = st.cols_rows[0];
+            const int nr = st.cols_rows[1];
+            const int ns = static_cast<int>(st.offsets.size());
+#pragma omp parallel for
+            for (int i = 0; i < ns; ++i) {
+                const morph::vec<float, 2>& o = st.offsets[i];
+                // The sample location in the image frame
+                const float x = o[0] * ca - o[1] * sa + view_pos[0];
+                const float y = o[0] * sa + o[1] * ca + view_pos[1];
+                if (x < this->x_minmax.min || x > this->x_minmax.max || y < this->y_minmax.min || y > this->y_minmax.max) {
+                    polar_data[i] = 0.0f;
+                    continue;
+                }
+                const int c = std::clamp (static_cast<int>(std::round ((x - this->x_minmax.min) / this->d)), 0, nc - 1);
+                const int r = std::clamp (static_cast<int>(std::round ((y - this->y_minmax.min) / this->v)), 0, nr - 1);
+                // Weights of the columns c-1, c, c+1 and the rows r-1, r, r+1
+                std::array<float, 3> wx = { 0.0f, 0.0f, 0.0f };
+                std::array<float, 3> wy = { 0.0f, 0.0f, 0.0f };
+                for (int k = 0; k < 3; ++k) {
+                    if (c + k - 1 >= 0 && c + k - 1 < nc) {
+                        const float dx = x - this->d_x[c + k - 1];
+                        wx[k] = std::exp (-(st.assumecirc * dx * dx));
+                    }
+                    if (r + k - 1 >= 0 && r + k - 1 < nr) {
+                        const float dy = y - this->d_y[(r + k - 1) * nc];
+                        wy[k] = std::exp (-(st.assumecirc * dy * dy));
+                    }
+                }
+                float expr = 0.0f;
+                float contributors = 0.0f;
+                for (int kr = 0; kr < 3; ++kr) {
+                    if (r + kr - 1 < 0 || r + kr - 1 >= nr) { continue; }
+                    for (int kc = 0; kc < 3; ++kc) {
+                        if (c + kc - 1 < 0 || c + kc - 1 >= nc) { continue; }
+                        expr += wx[kc] * wy[kr] * image_data[(r + kr - 1) * nc + c + kc - 1];
+                        contributors += 1.0f;
+                    }
+                }
+                polar_data[i] = expr / contributors;
+            }
+        }
+
 #ifdef CARTGRID_COMPILE_WITH_BEZCURVES
         /*!
          * This sets a boundary, just as
@@ -1147,6 +1177,31 @@ namespace morph {
          */
         unsigned int num() const { return this->rects.size(); }
 
+        //! The memory held by the grid: the list of Rects, the lists of pointers into it and the d_ arrays
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage m ("CartGrid");
+            m.add ("rects", this->rects);
+            m.add ("vrects", this->vrects);
+            m.add ("brects", this->brects);
+            morph::memory_usage& d = m.add (morph::memory_usage ("d_ arrays"));
+            d.add ("d_x", this->d_x);
+            d.add ("d_y", this->d_y);
+            d.add ("d_ne", this->d_ne);
+            d.add ("d_nne", this->d_nne);
+            d.add ("d_nn", this->d_nn);
+            d.add ("d_nnw", this->d_nnw);
+            d.add ("d_nw", this->d_nw);
+            d.add ("d_nsw", this->d_nsw);
+            d.add ("d_ns", this->d_ns);
+            d.add ("d_nse", this->d_nse);
+            d.add ("d_xi", this->d_xi);
+            d.add ("d_yi", this->d_yi);
+            d.add ("d_flags", this->d_flags);
+            d.add ("d_distToBoundary", this->d_distToBoundary);
+            return m;
+        }
+
         /*!
          * \brief Obtain the vector index of the last Rect in rects.
          *
@@ -1296,34 +1351,40 @@ namespace morph {
         float getRectArea() const { return (this->d * this->v); }
 
         /*!
-         * Run through all the rects and compute the distance to the nearest boundary
-         * rect.
+         * Run through all the rects and compute the distance to the nearest boundary rect (0 for
+         * boundary rects and -100 for rects outside the boundary). The boundary rects go into a
+         * kd_tree, so this is O(N log B) for N rects and B boundary rects, and the distances are
+         * exactly those of a search over every boundary rect. d_distToBoundary is updated too,
+         * if the d_ vectors have been populated.
          */
         void computeDistanceToBoundary()
         {
-            std::list<morph::Rect>::iterator r = this->rects.begin();
-            while (r != this->rects.end()) {
+            std::vector<morph::vec<float, 2>> bpts;
+            std::vector<std::list<morph::Rect>::iterator> brects;
+            std::vector<std::list<morph::Rect>::iterator> inside;
+            for (auto r = this->rects.begin(); r != this->rects.end(); ++r) {
                 if (r->testFlags(RECT_IS_BOUNDARY) == true) {
                     r->distToBoundary = 0.0f;
+                    bpts.push_back ({ r->x, r->y });
+                    brects.push_back (r);
+                } else if (r->testFlags(RECT_INSIDE_BOUNDARY) == false) {
+                    // Set to a dummy, negative value
+                    r->distToBoundary = -100.0;
                 } else {
-                    if (r->testFlags(RECT_INSIDE_BOUNDARY) == false) {
-                        // Set to a dummy, negative value
-                        r->distToBoundary = -100.0;
-                    } else {
-                        // Not a boundary rect, but inside boundary
-                        std::list<morph::Rect>::iterator br = this->rects.begin();
-                        while (br != this->rects.end()) {
-                            if (br->testFlags(RECT_IS_BOUNDARY) == true) {
-                                float delta = r->distanceFrom (*br);
-                                if (delta < r->distToBoundary || r->distToBoundary < 0.0f) {
-                                    r->distToBoundary = delta;
-                                }
-                            }
-                            ++br;
-                        }
-                    }
+                    inside.push_back (r);
                 }
-                ++r;
+            }
+            morph::kd_tree<float, 2> tree;
+            tree.build (bpts);
+            const int ni = static_cast<int>(inside.size());
+#pragma omp parallel for
+            for (int i = 0; i < ni; ++i) {
+                const unsigned int j = tree.nearest ({ inside[i]->x, inside[i]->y });
+                // Not a boundary rect, but inside boundary. With no boundary rects, leave distToBoundary alone.
+                if (j != morph::kd_tree<float, 2>::none) { inside[i]->distToBoundary = inside[i]->distanceFrom (*brects[j]); }
+            }
+            if (this->d_distToBoundary.size() == this->rects.size()) {
+                for (const auto& r : this->rects) { this->d_distToBoundary[r.di] = r.distToBoundary; }
             }
         }
 
@@ -1533,7 +1594,10 @@ namespace morph {
                 throw std::runtime_error ("Pass in separate memory for the result.");
             }
             // For each rect in this CartGrid, compute the convolution kernel
-            for (std::list<Rect>::iterator ri = this->rects.begin(); ri != this->rects.end(); ++ri) {
+            const int nr = this->vrects.size();
+#pragma omp parallel for
+            for (int i = 0; i < nr; ++i) {
+                const Rect* ri = this->vrects[i];
                 result[ri->vi] = data[ri->vi]; // The 'on' part of the filter
                 T count = T{0};
                 T offpart = T{0};
@@ -1550,7 +1614,11 @@ namespace morph {
             }
         }
 
-        //! Apply a box filter. SLOOOOOW algorithm.
+        /*!
+         * Apply a box filter of side boxside. For a whole rectangular CartGrid this is the fast,
+         * parallel MathAlgo::boxfilter_2d_blocks (wrapping horizontally if the CartGrid does). For
+         * other domains, it walks the neighbour relations of each rect, which is slow.
+         */
         template<typename T, bool onlysum=false>
         void boxfilter (const std::vector<T>& data, std::vector<T>& result, unsigned int boxside)
         {
@@ -1572,6 +1640,16 @@ namespace morph {
             // (left/down) is (boxside/2)-1
             unsigned int neg_steps = boxside%2==0 ? (boxside/2) - 1 : (boxside-1)/2;
             unsigned int pos_steps = boxside%2==0 ? (boxside/2) : (boxside-1)/2;
+
+            if (boxside > 0 && this->domainShape == GridDomainShape::Rectangle
+                && this->w_px > 0 && static_cast<std::size_t>(this->w_px) * this->h_px == this->rects.size()) {
+                // All the rects are present, in rows, so the fast filter applies
+                const bool horz_wrap = this->domainWrap == GridDomainWrap::Horizontal || this->domainWrap == GridDomainWrap::Both;
+                morph::MathAlgo::boxfilter_2d_blocks<T, T, onlysum> (data.data(), result.data(), this->w_px, this->h_px,
+                                                                     neg_steps, pos_steps, horz_wrap);
+                return;
+            }
+
             T oneover_boxa = T{1} / (static_cast<T>(boxside) * static_cast<T>(boxside)); // 1/ square box area
 
             // Now can go through the rects
@@ -1739,6 +1817,74 @@ namespace morph {
             }
         }
 
+        /*!
+         * Using this CartGrid as the domain, convolve the domain data \a data with the separable
+         * kernel kernel_x[i] * kernel_y[j], returning the result in \a result. This is the same as
+         * convolve() with a kernel CartGrid holding that product, with kernel_x[kernel_x.size()/2]
+         * at x offset 0 and higher indices to the east (and kernel_y likewise, with higher indices
+         * to the north), but it costs O(Kx + Ky) per element rather than O(Kx * Ky). Kernel
+         * elements that fall off the edge of the domain contribute nothing. The kernels must have
+         * an odd number of elements.
+         */
+        template<typename T>
+        void convolve_separable (const std::vector<T>& kernel_x, const std::vector<T>& kernel_y,
+                                 const std::vector<T>& data, std::vector<T>& result)
+        {
+            if (result.size() != this->rects.size()) {
+                throw std::runtime_error ("The result vector is not the same size as the CartGrid.");
+            }
+            if (result.size() != data.size()) {
+                throw std::runtime_error ("The data vector is not the same size as the CartGrid.");
+            }
+            if (kernel_x.size() % 2 == 0 || kernel_y.size() % 2 == 0) {
+                throw std::runtime_error ("The separable kernels must have an odd number of elements.");
+            }
+            if (&data == &result) {
+                throw std::runtime_error ("Pass in separate memory for the result.");
+            }
+
+            const int khx = kernel_x.size() / 2;
+            const int khy = kernel_y.size() / 2;
+            const int nr = this->vrects.size();
+
+            // First pass along x, into tmp
+            std::vector<T> tmp (data.size(), T{0});
+#pragma omp parallel for
+            for (int i = 0; i < nr; ++i) {
+                const Rect* r = this->vrects[i];
+                T sum = kernel_x[khx] * data[r->vi];
+                const Rect* p = r;
+                for (int j = 1; j <= khx && p->has_ne(); ++j) {
+                    p = &(*p->ne);
+                    sum += kernel_x[khx + j] * data[p->vi];
+                }
+                p = r;
+                for (int j = 1; j <= khx && p->has_nw(); ++j) {
+                    p = &(*p->nw);
+                    sum += kernel_x[khx - j] * data[p->vi];
+                }
+                tmp[r->vi] = sum;
+            }
+
+            // Second pass along y, into result
+#pragma omp parallel for
+            for (int i = 0; i < nr; ++i) {
+                const Rect* r = this->vrects[i];
+                T sum = kernel_y[khy] * tmp[r->vi];
+                const Rect* p = r;
+                for (int j = 1; j <= khy && p->has_nn(); ++j) {
+                    p = &(*p->nn);
+                    sum += kernel_y[khy + j] * tmp[p->vi];
+                }
+                p = r;
+                for (int j = 1; j <= khy && p->has_ns(); ++j) {
+                    p = &(*p->ns);
+                    sum += kernel_y[khy - j] * tmp[p->vi];
+                }
+                result[r->vi] = sum;
+            }
+        }
+
         /*!
          * What shape domain to set? Set this to the non-default BEFORE calling
          * CartGrid::setBoundary (const BezCurvePath& p) - that's where the domainShape
@@ -1797,8 +1943,8 @@ namespace morph {
             int halfRows = std::abs(std::ceil(halfY/this->v));
 
             if (this->domainShape == GridDomainShape::Rectangle) {
-                this->w_px = 2 * halfRows + 1;
-                this->h_px = 2 * halfCols + 1;
+                this->w_px = 2 * halfCols + 1;
+                this->h_px = 2 * halfRows + 1;
             }
 
             this->x_minmax = morph::range<float>(-halfCols * this->d, halfCols * this->d);
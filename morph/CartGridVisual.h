@@ -9,6 +9,8 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cmath>
 
 #define R_NE(hi) (this->cg->d_ne[hi])
 #define R_HAS_NE(hi) (this->cg->d_ne[hi] == -1 ? false : true)
@@ -39,7 +41,8 @@ namespace morph {
     enum class CartVisMode
     {
         Triangles, // Render triangles with a triangle vertex at the centre of each Rect.
-        RectInterp  // Render each rect as an actual rectangle made of 4 triangles.
+        RectInterp, // Render each rect as an actual rectangle made of 4 triangles.
+        Heightmap   // As Triangles, but with z, normals and colours computed by the vertex shader from a data texture
     };
 
     //! The template argument T is the type of the data which this HexGridVisual
@@ -64,6 +67,20 @@ namespace morph {
             // Note: VisualModel::finalize() should be called before rendering
         }
 
+        //! Models of one CartGrid may share their mesh (see VisualModel::share_geometry)
+        const void* geometry_source() const override { return this->cg; }
+
+        //! For VisualDataModel::updateColourFromBuffer. 0 in Heightmap mode, in which the
+        //! colours come from the data texture.
+        unsigned int verticesPerDatum() const
+        {
+            switch (this->cartVisMode) {
+            case CartVisMode::Triangles: { return 1u; }
+            case CartVisMode::Heightmap: { return 0u; }
+            default: { return 5u; }
+            }
+        }
+
         //! Do the computations to initialize the vertices that will represent the HexGrid.
         virtual void initializeVertices()
         {
@@ -81,6 +98,11 @@ namespace morph {
                 this->initializeVerticesTris();
                 break;
             }
+            case CartVisMode::Heightmap:
+            {
+                this->initializeVerticesHeightmap();
+                break;
+            }
             case CartVisMode::RectInterp:
             default:
             {
@@ -119,10 +141,8 @@ namespace morph {
             unsigned int nrect = this->cg->num();
 
             if (this->scalarData != nullptr) {
-                this->dcopy.resize (this->scalarData->size());
-                this->zScale.transform (*(this->scalarData), dcopy);
-                this->dcolour.resize (this->scalarData->size());
-                this->colourScale.transform (*(this->scalarData), dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
             } else if (this->vectorData != nullptr) {
                 this->dcopy.resize (this->vectorData->size());
                 this->dcolour.resize (this->vectorData->size());
@@ -152,6 +172,13 @@ namespace morph {
                 this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
             }
 
+            this->computeTriangleIndices();
+        }
+
+        //! Build the indices of the triangles between rect centres (one vertex per rect)
+        void computeTriangleIndices()
+        {
+            unsigned int nrect = this->cg->num();
             // Build indices based on neighbour relations in the CartGrid
             for (unsigned int ri = 0; ri < nrect; ++ri) {
                 if (R_HAS_NNE(ri) && R_HAS_NE(ri)) {
@@ -170,6 +197,45 @@ namespace morph {
             this->idx += nrect;
         }
 
+        /*!
+         * Initialize with a vertex at each rect centre, like initializeVerticesTris, but leave
+         * z, the normals and the colours to the vertex shader, which computes them from the data
+         * in a texture (see VisualModel::data_tex_displace). The x/y mesh is built once; an
+         * update (with updateData) only copies the data for the texture, which is a single small
+         * upload. Requires scalarData, a one dimensional colour map and linear colourScale and
+         * zScale.
+         */
+        void initializeVerticesHeightmap()
+        {
+            this->idx = 0;
+            unsigned int nrect = this->cg->num();
+            if (nrect == 0) { return; }
+            const float dx = this->cg->getd();
+            const float dy = this->cg->getv();
+            const float xmin = *std::min_element (this->cg->d_x.begin(), this->cg->d_x.end());
+            const float ymin = *std::min_element (this->cg->d_y.begin(), this->cg->d_y.end());
+            std::vector<morph::vec<int, 2>> tc (nrect);
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                tc[ri] = { static_cast<int>(std::round ((this->cg->d_x[ri] - xmin) / dx)),
+                           static_cast<int>(std::round ((this->cg->d_y[ri] - ymin) / dy)) };
+            }
+            static constexpr std::array<morph::vec<int, 2>, 8> nbrs = {
+                morph::vec<int, 2>{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+            };
+            this->set_height_texels (tc, nbrs);
+            for (unsigned int ri = 0; ri < nrect; ++ri) {
+                this->vertex_push (this->cg->d_x[ri]+centering_offset[0],
+                                   this->cg->d_y[ri]+centering_offset[1], 0.0f, this->vertexPositions);
+                // A blue component of -2 tells the shader that red and green hold the texel
+                this->vertex_push (static_cast<float>(tc[ri][0]), static_cast<float>(tc[ri][1]), -2.0f, this->vertexColors);
+                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
+            }
+            this->computeTriangleIndices();
+            this->data_tex_displace = 1;
+            this->data_tex_spacing = { dx, dy };
+            this->setup_height_map();
+        }
+
         //! Show a set of hexes at the zero?
         bool zerogrid = false;
 
@@ -187,10 +253,8 @@ namespace morph {
             this->idx = 0;
 
             if (this->scalarData != nullptr) {
-                this->dcopy.resize (this->scalarData->size());
-                this->zScale.transform (*(this->scalarData), dcopy);
-                this->dcolour.resize (this->scalarData->size());
-                this->colourScale.transform (*(this->scalarData), dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
             } else if (this->vectorData != nullptr) {
                 this->dcopy.resize (this->vectorData->size());
                 this->dcolour.resize (this->vectorData->size());
@@ -448,7 +512,8 @@ namespace morph {
 #endif
         }
 
-        //! How to render the elements. Triangles are faster. RectInterp more often used.
+        //! How to render the elements. Triangles are faster. RectInterp more often used. Heightmap
+        //! is fastest to update.
         CartVisMode cartVisMode = CartVisMode::RectInterp;
 
         //! Set this to true to adjust the positions that the CartGridVisual uses to plot
@@ -466,6 +531,17 @@ namespace morph {
         float border_thickness_fixed = 0.0f;
 
     protected:
+        //! In Heightmap mode, only the data texture changes after updateData
+        void scalarDataUpdated() override
+        {
+            if (this->cartVisMode == CartVisMode::Heightmap) {
+                this->setup_height_map();
+                this->displaceBoundingBox();
+            } else {
+                this->reinit();
+            }
+        }
+
         //! An overridable function to set the colour of rect ri
         std::array<float, 3> setColour (unsigned int ri)
         {
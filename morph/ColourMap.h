@@ -6,6 +6,8 @@
 #include <morph/colourmaps_cet.h>     // Colour map tables from CET
 
 #include <string_view>
+#include <vector>
+#include <array>
 #include <stdexcept>
 #include <cmath>
 #include <cstdint>
@@ -562,6 +564,14 @@ namespace morph {
         //! colour retrieved from the map.
         bool act_2d = false;
 
+        //! The number of entries in the lookup table used by convert_batch (0 for no table)
+        unsigned int lut_n = 0;
+        //! The lookup table: lut_n RGB triplets sampled evenly from [0,1], then the nan colour
+        std::vector<float> lut;
+        //! The type and hue/sat/val parameters with which lut was made
+        ColourMapType lut_type = ColourMapType::Plasma;
+        std::array<float, 9> lut_hsv = {};
+
     public:
         //! Default constructor is required, but need not do anything.
         ColourMap() {}
@@ -1618,7 +1628,7 @@ namespace morph {
         }
 
         //! Return the colour that represents not-a-number
-        static std::array<float, 3> nanColour (ColourMapType _t)
+        static constexpr std::array<float, 3> nanColour (ColourMapType _t)
         {
             std::array<float, 3> c = {0.0f, 0.0f, 0.0f};
             switch (_t) {
@@ -2945,6 +2955,61 @@ namespace morph {
 
         void set_act_2d (const bool _2d) { this->act_2d = _2d; }
 
+        /*!
+         * Use a lookup table of n colours in convert_batch. Each datum's colour is then the table
+         * entry nearest to it, rather than being re-computed. For the colour maps that are
+         * themselves tables of n colours (most of the CET and Crameri maps have 256 entries)
+         * the result is exactly as from convert(). Set n to 0 (the default) to convert each datum
+         * in full. Only used for floating point T.
+         */
+        void setLutSize (const unsigned int n)
+        {
+            if (n == 1) { throw std::runtime_error ("ColourMap::setLutSize: A lookup table needs 0 or at least 2 entries"); }
+            this->lut_n = n;
+            this->lut.clear();
+        }
+        unsigned int getLutSize() const { return this->lut_n; }
+
+        /*!
+         * Convert each datum in data (for a one dimensional map) and write its colour into
+         * rgb_out, which must have room for 3 * data.size() floats. If a lookup table size has
+         * been set with setLutSize, the data are clamped, scaled to table indices and gathered
+         * from the table in one tight loop. The table is (re)made when the map has changed since
+         * it was last used.
+         */
+        void convert_batch (const std::vector<T>& data, float* rgb_out)
+        {
+            if (ColourMap<T>::numDatums (this->type) != 1) {
+                throw std::runtime_error ("ColourMap::convert_batch: Only for one dimensional colour maps");
+            }
+            const std::size_t n = data.size();
+            if constexpr (std::is_floating_point<std::decay_t<T>>::value == true) {
+                if (this->lut_n > 1) {
+                    this->update_lut();
+                    const float* lt = this->lut.data();
+                    const unsigned int nan_i = this->lut_n; // the last entry is the nan colour
+                    const float s = static_cast<float>(this->lut_n - 1);
+#pragma omp parallel for
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const float d = static_cast<float>(data[i]);
+                        const unsigned int li = std::isnan (d) ? nan_i
+                        : static_cast<unsigned int>((d > 1.0f ? 1.0f : (d < 0.0f ? 0.0f : d)) * s + 0.5f);
+                        rgb_out[3 * i] = lt[3 * li];
+                        rgb_out[3 * i + 1] = lt[3 * li + 1];
+                        rgb_out[3 * i + 2] = lt[3 * li + 2];
+                    }
+                    return;
+                }
+            }
+#pragma omp parallel for
+            for (std::size_t i = 0; i < n; ++i) {
+                std::array<float, 3> c = this->convert (data[i]);
+                rgb_out[3 * i] = c[0];
+                rgb_out[3 * i + 1] = c[1];
+                rgb_out[3 * i + 2] = c[2];
+            }
+        }
+
         /*!
          * @param datum gray value from 0.0 to 1.0
          *
@@ -3053,6 +3118,29 @@ namespace morph {
         }
 
     private:
+        //! Make lut, unless it was already made with the current colour map type and parameters
+        void update_lut()
+        {
+            std::array<float, 9> hsv = { this->hue, this->sat, this->val, this->hue2, this->sat2, this->val2,
+                                         this->hue3, this->sat3, this->val3 };
+            if (this->lut.size() == 3u * (this->lut_n + 1u) && this->lut_type == this->type && this->lut_hsv == hsv) {
+                return;
+            }
+            this->lut.resize (3u * (this->lut_n + 1u));
+            for (unsigned int i = 0; i < this->lut_n; ++i) {
+                std::array<float, 3> c = this->convert (static_cast<T>(i) / static_cast<T>(this->lut_n - 1));
+                this->lut[3 * i] = c[0];
+                this->lut[3 * i + 1] = c[1];
+                this->lut[3 * i + 2] = c[2];
+            }
+            std::array<float, 3> c = ColourMap<T>::nanColour (this->type);
+            this->lut[3 * this->lut_n] = c[0];
+            this->lut[3 * this->lut_n + 1] = c[1];
+            this->lut[3 * this->lut_n + 2] = c[2];
+            this->lut_type = this->type;
+            this->lut_hsv = hsv;
+        }
+
         /*!
          * @param datum gray value from 0.0 to 1.0
          *
@@ -0,0 +1,386 @@
+/*!
+ * \file
+ *
+ * This file contains morph::ColourMapCt<>, a colour map whose ColourMapType is a template
+ * argument. It is to morph::ColourMap what morph::Gridct is to morph::Grid.
+ *
+ * morph::ColourMap::convert() switches on the map type (and checks its flags) for every datum.
+ * When the colour map is fixed at compile time, ColourMapCt<>::convert() resolves the lookup
+ * table, or the function, at compile time, so that converting a datum compiles down to a clamp,
+ * a multiply and a table load. For the table-based maps, convert() is constexpr.
+ *
+ * Only the maps that have no runtime parameters are available. These are the table-based maps
+ * (the matplotlib, CET and Crameri maps, with Jet and Rainbow), William Lenthe's ramp and cyclic
+ * maps, Greyscale, GreyscaleInv, RainbowZeroBlack, RainbowZeroWhite and the MonovalRed/Green/Blue
+ * maps. The colours are the same as those from ColourMap::convert() for the same map.
+ *
+ * \author Seb James
+ * \date 2025
+ */
+
+#pragma once
+
+#include <morph/ColourMap.h>
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+namespace morph {
+
+    namespace colourmap_ct {
+
+        //! A pointer to the lookup table for cmt, or nullptr if cmt is not a table-based map
+        template <ColourMapType cmt>
+        constexpr auto table()
+        {
+            if constexpr (cmt == ColourMapType::Jet) {
+                return &morph::cet::cm_CET_R4;
+            } else if constexpr (cmt == ColourMapType::Rainbow) {
+                return &morph::cet::cm_CET_C6;
+            } else if constexpr (cmt == ColourMapType::Magma) {
+                return &morph::cm_magma;
+            } else if constexpr (cmt == ColourMapType::Inferno) {
+                return &morph::cm_inferno;
+            } else if constexpr (cmt == ColourMapType::Plasma) {
+                return &morph::cm_plasma;
+            } else if constexpr (cmt == ColourMapType::Viridis) {
+                return &morph::cm_viridis;
+            } else if constexpr (cmt == ColourMapType::Cividis) {
+                return &morph::cm_cividis;
+            } else if constexpr (cmt == ColourMapType::Twilight) {
+                return &morph::cm_twilight;
+            } else if constexpr (cmt == ColourMapType::Petrov) {
+                return &morph::cm_petrov;
+            } else if constexpr (cmt == ColourMapType::Devon) {
+                return &morph::crameri::cm_devon;
+            } else if constexpr (cmt == ColourMapType::NaviaW) {
+                return &morph::crameri::cm_naviaW;
+            } else if constexpr (cmt == ColourMapType::BrocO) {
+                return &morph::crameri::cm_brocO;
+            } else if constexpr (cmt == ColourMapType::Acton) {
+                return &morph::crameri::cm_acton;
+            } else if constexpr (cmt == ColourMapType::Batlow) {
+                return &morph::crameri::cm_batlow;
+            } else if constexpr (cmt == ColourMapType::Berlin) {
+                return &morph::crameri::cm_berlin;
+            } else if constexpr (cmt == ColourMapType::Tofino) {
+                return &morph::crameri::cm_tofino;
+            } else if constexpr (cmt == ColourMapType::Broc) {
+                return &morph::crameri::cm_broc;
+            } else if constexpr (cmt == ColourMapType::CorkO) {
+                return &morph::crameri::cm_corkO;
+            } else if constexpr (cmt == ColourMapType::Lapaz) {
+                return &morph::crameri::cm_lapaz;
+            } else if constexpr (cmt == ColourMapType::BamO) {
+                return &morph::crameri::cm_bamO;
+            } else if constexpr (cmt == ColourMapType::Vanimo) {
+                return &morph::crameri::cm_vanimo;
+            } else if constexpr (cmt == ColourMapType::Lajolla) {
+                return &morph::crameri::cm_lajolla;
+            } else if constexpr (cmt == ColourMapType::Lisbon) {
+                return &morph::crameri::cm_lisbon;
+            } else if constexpr (cmt == ColourMapType::GrayC) {
+                return &morph::crameri::cm_grayC;
+            } else if constexpr (cmt == ColourMapType::Roma) {
+                return &morph::crameri::cm_roma;
+            } else if constexpr (cmt == ColourMapType::Vik) {
+                return &morph::crameri::cm_vik;
+            } else if constexpr (cmt == ColourMapType::Navia) {
+                return &morph::crameri::cm_navia;
+            } else if constexpr (cmt == ColourMapType::Bilbao) {
+                return &morph::crameri::cm_bilbao;
+            } else if constexpr (cmt == ColourMapType::Turku) {
+                return &morph::crameri::cm_turku;
+            } else if constexpr (cmt == ColourMapType::Lipari) {
+                return &morph::crameri::cm_lipari;
+            } else if constexpr (cmt == ColourMapType::VikO) {
+                return &morph::crameri::cm_vikO;
+            } else if constexpr (cmt == ColourMapType::BatlowK) {
+                return &morph::crameri::cm_batlowK;
+            } else if constexpr (cmt == ColourMapType::Oslo) {
+                return &morph::crameri::cm_oslo;
+            } else if constexpr (cmt == ColourMapType::Oleron) {
+                return &morph::crameri::cm_oleron;
+            } else if constexpr (cmt == ColourMapType::Davos) {
+                return &morph::crameri::cm_davos;
+            } else if constexpr (cmt == ColourMapType::Fes) {
+                return &morph::crameri::cm_fes;
+            } else if constexpr (cmt == ColourMapType::Managua) {
+                return &morph::crameri::cm_managua;
+            } else if constexpr (cmt == ColourMapType::Glasgow) {
+                return &morph::crameri::cm_glasgow;
+            } else if constexpr (cmt == ColourMapType::Tokyo) {
+                return &morph::crameri::cm_tokyo;
+            } else if constexpr (cmt == ColourMapType::Bukavu) {
+                return &morph::crameri::cm_bukavu;
+            } else if constexpr (cmt == ColourMapType::Bamako) {
+                return &morph::crameri::cm_bamako;
+            } else if constexpr (cmt == ColourMapType::BatlowW) {
+                return &morph::crameri::cm_batlowW;
+            } else if constexpr (cmt == ColourMapType::Nuuk) {
+                return &morph::crameri::cm_nuuk;
+            } else if constexpr (cmt == ColourMapType::Cork) {
+                return &morph::crameri::cm_cork;
+            } else if constexpr (cmt == ColourMapType::Hawaii) {
+                return &morph::crameri::cm_hawaii;
+            } else if constexpr (cmt == ColourMapType::Bam) {
+                return &morph::crameri::cm_bam;
+            } else if constexpr (cmt == ColourMapType::Imola) {
+                return &morph::crameri::cm_imola;
+            } else if constexpr (cmt == ColourMapType::RomaO) {
+                return &morph::crameri::cm_romaO;
+            } else if constexpr (cmt == ColourMapType::Buda) {
+                return &morph::crameri::cm_buda;
+            } else if constexpr (cmt == ColourMapType::CET_L02) {
+                return &morph::cet::cm_CET_L02;
+            } else if constexpr (cmt == ColourMapType::CET_L13) {
+                return &morph::cet::cm_CET_L13;
+            } else if constexpr (cmt == ColourMapType::CET_C4) {
+                return &morph::cet::cm_CET_C4;
+            } else if constexpr (cmt == ColourMapType::CET_D04) {
+                return &morph::cet::cm_CET_D04;
+            } else if constexpr (cmt == ColourMapType::CET_L12) {
+                return &morph::cet::cm_CET_L12;
+            } else if constexpr (cmt == ColourMapType::CET_C1s) {
+                return &morph::cet::cm_CET_C1s;
+            } else if constexpr (cmt == ColourMapType::CET_L01) {
+                return &morph::cet::cm_CET_L01;
+            } else if constexpr (cmt == ColourMapType::CET_C5) {
+                return &morph::cet::cm_CET_C5;
+            } else if constexpr (cmt == ColourMapType::CET_D11) {
+                return &morph::cet::cm_CET_D11;
+            } else if constexpr (cmt == ColourMapType::CET_L04) {
+                return &morph::cet::cm_CET_L04;
+            } else if constexpr (cmt == ColourMapType::CET_CBL2) {
+                return &morph::cet::cm_CET_CBL2;
+            } else if constexpr (cmt == ColourMapType::CET_C4s) {
+                return &morph::cet::cm_CET_C4s;
+            } else if constexpr (cmt == ColourMapType::CET_L15) {
+                return &morph::cet::cm_CET_L15;
+            } else if constexpr (cmt == ColourMapType::CET_L20) {
+                return &morph::cet::cm_CET_L20;
+            } else if constexpr (cmt == ColourMapType::CET_CBD1) {
+                return &morph::cet::cm_CET_CBD1;
+            } else if constexpr (cmt == ColourMapType::CET_D06) {
+                return &morph::cet::cm_CET_D06;
+            } else if constexpr (cmt == ColourMapType::CET_I3) {
+                return &morph::cet::cm_CET_I3;
+            } else if constexpr (cmt == ColourMapType::CET_D01A) {
+                return &morph::cet::cm_CET_D01A;
+            } else if constexpr (cmt == ColourMapType::CET_L16) {
+                return &morph::cet::cm_CET_L16;
+            } else if constexpr (cmt == ColourMapType::CET_L06) {
+                return &morph::cet::cm_CET_L06;
+            } else if constexpr (cmt == ColourMapType::CET_C2s) {
+                return &morph::cet::cm_CET_C2s;
+            } else if constexpr (cmt == ColourMapType::CET_I1) {
+                return &morph::cet::cm_CET_I1;
+            } else if constexpr (cmt == ColourMapType::CET_C7s) {
+                return &morph::cet::cm_CET_C7s;
+            } else if constexpr (cmt == ColourMapType::CET_I2) {
+                return &morph::cet::cm_CET_I2;
+            } else if constexpr (cmt == ColourMapType::CET_C6s) {
+                return &morph::cet::cm_CET_C6s;
+            } else if constexpr (cmt == ColourMapType::CET_C6) {
+                return &morph::cet::cm_CET_C6;
+            } else if constexpr (cmt == ColourMapType::CET_L05) {
+                return &morph::cet::cm_CET_L05;
+            } else if constexpr (cmt == ColourMapType::CET_D08) {
+                return &morph::cet::cm_CET_D08;
+            } else if constexpr (cmt == ColourMapType::CET_L03) {
+                return &morph::cet::cm_CET_L03;
+            } else if constexpr (cmt == ColourMapType::CET_L14) {
+                return &morph::cet::cm_CET_L14;
+            } else if constexpr (cmt == ColourMapType::CET_C2) {
+                return &morph::cet::cm_CET_C2;
+            } else if constexpr (cmt == ColourMapType::CET_R3) {
+                return &morph::cet::cm_CET_R3;
+            } else if constexpr (cmt == ColourMapType::CET_D01) {
+                return &morph::cet::cm_CET_D01;
+            } else if constexpr (cmt == ColourMapType::CET_C1) {
+                return &morph::cet::cm_CET_C1;
+            } else if constexpr (cmt == ColourMapType::CET_D02) {
+                return &morph::cet::cm_CET_D02;
+            } else if constexpr (cmt == ColourMapType::CET_CBC1) {
+                return &morph::cet::cm_CET_CBC1;
+            } else if constexpr (cmt == ColourMapType::CET_D09) {
+                return &morph::cet::cm_CET_D09;
+            } else if constexpr (cmt == ColourMapType::CET_L10) {
+                return &morph::cet::cm_CET_L10;
+            } else if constexpr (cmt == ColourMapType::CET_R1) {
+                return &morph::cet::cm_CET_R1;
+            } else if constexpr (cmt == ColourMapType::CET_C3) {
+                return &morph::cet::cm_CET_C3;
+            } else if constexpr (cmt == ColourMapType::CET_CBL1) {
+                return &morph::cet::cm_CET_CBL1;
+            } else if constexpr (cmt == ColourMapType::CET_C3s) {
+                return &morph::cet::cm_CET_C3s;
+            } else if constexpr (cmt == ColourMapType::CET_C5s) {
+                return &morph::cet::cm_CET_C5s;
+            } else if constexpr (cmt == ColourMapType::CET_L08) {
+                return &morph::cet::cm_CET_L08;
+            } else if constexpr (cmt == ColourMapType::CET_R4) {
+                return &morph::cet::cm_CET_R4;
+            } else if constexpr (cmt == ColourMapType::CET_R2) {
+                return &morph::cet::cm_CET_R2;
+            } else if constexpr (cmt == ColourMapType::CET_L11) {
+                return &morph::cet::cm_CET_L11;
+            } else if constexpr (cmt == ColourMapType::CET_D10) {
+                return &morph::cet::cm_CET_D10;
+            } else if constexpr (cmt == ColourMapType::CET_D07) {
+                return &morph::cet::cm_CET_D07;
+            } else if constexpr (cmt == ColourMapType::CET_L17) {
+                return &morph::cet::cm_CET_L17;
+            } else if constexpr (cmt == ColourMapType::CET_D12) {
+                return &morph::cet::cm_CET_D12;
+            } else if constexpr (cmt == ColourMapType::CET_CBC2) {
+                return &morph::cet::cm_CET_CBC2;
+            } else if constexpr (cmt == ColourMapType::CET_D13) {
+                return &morph::cet::cm_CET_D13;
+            } else if constexpr (cmt == ColourMapType::CET_D03) {
+                return &morph::cet::cm_CET_D03;
+            } else if constexpr (cmt == ColourMapType::CET_C7) {
+                return &morph::cet::cm_CET_C7;
+            } else if constexpr (cmt == ColourMapType::CET_L07) {
+                return &morph::cet::cm_CET_L07;
+            } else if constexpr (cmt == ColourMapType::CET_L09) {
+                return &morph::cet::cm_CET_L09;
+            } else if constexpr (cmt == ColourMapType::CET_L18) {
+                return &morph::cet::cm_CET_L18;
+            } else if constexpr (cmt == ColourMapType::CET_L19) {
+                return &morph::cet::cm_CET_L19;
+            } else {
+                return nullptr;
+            }
+        }
+
+        //! True if the ColourMapType cmt is defined by a lookup table
+        template <ColourMapType cmt>
+        constexpr bool has_table = !std::is_null_pointer_v<decltype(table<cmt>())>;
+
+        //! True if the ColourMapType cmt is computed by a function with no runtime parameters
+        template <ColourMapType cmt>
+        constexpr bool has_function = (cmt == ColourMapType::Fire || cmt == ColourMapType::Ocean
+                                       || cmt == ColourMapType::Ice || cmt == ColourMapType::DivBlueRed
+                                       || cmt == ColourMapType::CyclicGrey || cmt == ColourMapType::CyclicFour
+                                       || cmt == ColourMapType::CyclicSix || cmt == ColourMapType::CyclicDivBlueRed
+                                       || cmt == ColourMapType::Greyscale || cmt == ColourMapType::GreyscaleInv
+                                       || cmt == ColourMapType::RainbowZeroBlack || cmt == ColourMapType::RainbowZeroWhite
+                                       || cmt == ColourMapType::MonovalRed || cmt == ColourMapType::MonovalGreen
+                                       || cmt == ColourMapType::MonovalBlue);
+
+    } // namespace colourmap_ct
+
+    /*!
+     * A one dimensional colour map, fixed at compile time.
+     *
+     * \code
+     * using cmap = morph::ColourMapCt<morph::ColourMapType::Plasma>;
+     * constexpr std::array<float, 3> mid = cmap::convert (0.5f);
+     * \endcode
+     *
+     * \tparam cmt The ColourMapType. Maps with runtime parameters (such as the hue of a
+     * Monochrome map) and the 2D and 3D maps are rejected with a static_assert.
+     *
+     * \tparam T The type of the datum. As for ColourMap, floating point inputs are in [0, 1] and
+     * integral inputs are in [0, range_max].
+     */
+    template <ColourMapType cmt, typename T = float>
+    struct ColourMapCt
+    {
+        static_assert (colourmap_ct::has_table<cmt> || colourmap_ct::has_function<cmt>,
+                       "ColourMapCt: This ColourMapType has runtime parameters or is not a 1D map; use morph::ColourMap");
+
+        //! The colour map type
+        static constexpr ColourMapType type = cmt;
+
+        //! The maximum value of the input range. 1 for floating point T.
+        static constexpr T range_max = ColourMap<T>::range_max_init();
+
+        //! The colour that represents not-a-number
+        static constexpr std::array<float, 3> nan_colour = ColourMap<T>::nanColour (cmt);
+
+        //! Convert the scalar datum into an RGB colour
+        static constexpr std::array<float, 3> convert (const T _datum)
+        {
+            float datum = 0.0f;
+            if constexpr (std::is_floating_point<std::decay_t<T>>::value == true) {
+                if (_datum != _datum) { return nan_colour; } // std::isnan is not constexpr
+                datum = _datum > T{1} ? 1.0f : static_cast<float>(_datum);
+                datum = datum < 0.0f ? 0.0f : datum;
+            } else if constexpr (std::is_same<std::decay_t<T>, bool>::value == true) {
+                datum = _datum ? 1.0f : 0.0f;
+            } else if constexpr (std::is_integral<std::decay_t<T>>::value == true) {
+                datum = _datum < 0 ? 0.0f : static_cast<float>(_datum) / static_cast<float>(range_max);
+                datum = datum > 1.0f ? 1.0f : datum;
+            } else {
+                static_assert (std::is_arithmetic<std::decay_t<T>>::value, "ColourMapCt: Unhandled data type");
+            }
+
+            if constexpr (colourmap_ct::has_table<cmt>) {
+                return ColourMapCt<cmt, T>::lookup (datum);
+            } else {
+                std::array<float, 3> c = { 0.0f, 0.0f, 0.0f };
+                if constexpr (cmt == ColourMapType::Fire) {
+                    lenthe::colormap::ramp::fire<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::Ocean) {
+                    lenthe::colormap::ramp::ocean<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::Ice) {
+                    lenthe::colormap::ramp::ice<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::DivBlueRed) {
+                    lenthe::colormap::ramp::div<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::CyclicGrey) {
+                    lenthe::colormap::cyclic::gray<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::CyclicFour) {
+                    lenthe::colormap::cyclic::four<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::CyclicSix) {
+                    lenthe::colormap::cyclic::six<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::CyclicDivBlueRed) {
+                    lenthe::colormap::cyclic::div<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::Greyscale) {
+                    lenthe::colormap::ramp::gray<float> (1.0f - datum, c.data());
+                } else if constexpr (cmt == ColourMapType::GreyscaleInv) {
+                    lenthe::colormap::ramp::gray<float> (datum, c.data());
+                } else if constexpr (cmt == ColourMapType::RainbowZeroBlack) {
+                    if (datum != 0.0f) { c = ColourMapCt<ColourMapType::Rainbow, T>::lookup (datum); }
+                } else if constexpr (cmt == ColourMapType::RainbowZeroWhite) {
+                    c = datum != 0.0f ? ColourMapCt<ColourMapType::Rainbow, T>::lookup (datum) : std::array<float, 3>{ 1.0f, 1.0f, 1.0f };
+                } else if constexpr (cmt == ColourMapType::MonovalRed) {
+                    c[0] = datum;
+                } else if constexpr (cmt == ColourMapType::MonovalGreen) {
+                    c[1] = datum;
+                } else if constexpr (cmt == ColourMapType::MonovalBlue) {
+                    c[2] = datum;
+                }
+                return c;
+            }
+        }
+
+        //! Convert each datum in data, writing 3 * data.size() floats (RGB triplets) into rgb_out
+        static void convert (const std::vector<T>& data, float* rgb_out)
+        {
+            const std::size_t n = data.size();
+#pragma omp parallel for
+            for (std::size_t i = 0; i < n; ++i) {
+                const std::array<float, 3> c = ColourMapCt<cmt, T>::convert (data[i]);
+                rgb_out[3 * i] = c[0];
+                rgb_out[3 * i + 1] = c[1];
+                rgb_out[3 * i + 2] = c[2];
+            }
+        }
+
+        //! Look up datum (in [0, 1]) in the table. The nearest entry is chosen, as in ColourMap::convert().
+        static constexpr std::array<float, 3> lookup (const float datum)
+        {
+            constexpr auto tbl = colourmap_ct::table<cmt>();
+            static_assert (!std::is_null_pointer_v<decltype(tbl)>, "ColourMapCt: No table for this ColourMapType");
+            constexpr float n1 = static_cast<float>(tbl->size() - 1);
+            // This is std::round (datum * n1) for datum >= 0, which is not constexpr in C++20
+            const std::size_t datum_i = static_cast<std::size_t>(static_cast<double>(datum * n1) + 0.5);
+            return (*tbl)[datum_i];
+        }
+    };
+
+} // namespace morph
@@ -12,7 +12,12 @@
 #include <morph/tools.h>
 #include <morph/vvec.h>
 #include <morph/vec.h>
+#include <morph/range.h>
 #include <list>
+#include <map>
+#include <vector>
+#include <functional>
+#include <type_traits>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -336,6 +341,13 @@ namespace morph {
             return rtn;
         }
 
+        //! The JSON value thingname, without a copy, or nullptr if there is none
+        const nlohmann::json* find (const std::string& thingname) const
+        {
+            auto it = this->root.find (thingname);
+            return it == this->root.end() ? nullptr : &(*it);
+        }
+
         bool getBool (const std::string& thing, bool defaultval) const
         {
             return this->get<bool> (thing, defaultval);
@@ -414,4 +426,144 @@ namespace morph {
         // The file that holds the JSON
         std::string thefile = "";
     };
+
+    /*!
+     * Bind the members of a plain struct of parameters, S, to keys in a Config, once, so that a
+     * model reads its parameters from the struct, at no cost, rather than with Config::getFloat()
+     * and friends in its step function.
+     *
+     *\code{.cpp}
+     * struct params { float alpha = 0; int steps = 0; };
+     * morph::ConfigBinding<params> pb;
+     * pb.bind ("alpha", &params::alpha, 0.5f, morph::range<float>{0.0f, 1.0f})
+     *   .bind ("steps", &params::steps, 1000);
+     * params p = pb.snapshot (conf); // throws if alpha is out of range
+     *\endcode
+     *
+     * Values are read with Config::get(), so command line overrides apply. For a live reload,
+     * call update() after re-reading the config; it rewrites the struct and returns the keys
+     * whose values changed, which on_change is called with, too.
+     */
+    template <typename S>
+    class ConfigBinding
+    {
+    public:
+        //! Bind member m to key, which takes the value defaultval if it is absent
+        template <typename T>
+        ConfigBinding<S>& bind (const std::string& key, T S::* m, const T& defaultval)
+        {
+            this->bindings.push_back ({
+                key,
+                [key, m, defaultval](const Config& conf, S& s) -> std::string {
+                    try {
+                        s.*m = ConfigBinding<S>::read (conf, key, defaultval, static_cast<const T*>(nullptr));
+                    } catch (const std::exception& e) {
+                        return std::string("'") + key + "': " + e.what();
+                    }
+                    return std::string();
+                },
+                [m](const S& a, const S& b) { return a.*m == b.*m; }
+            });
+            return *this;
+        }
+
+        //! Bind member m to key, whose value must lie within valid
+        template <typename T> requires std::is_arithmetic_v<T>
+        ConfigBinding<S>& bind (const std::string& key, T S::* m, const T& defaultval, const morph::range<T>& valid)
+        {
+            this->bind (key, m, defaultval);
+            auto read = std::move (this->bindings.back().read);
+            this->bindings.back().read = [read, key, m, valid](const Config& conf, S& s) -> std::string {
+                std::string err = read (conf, s);
+                if (err.empty() && !valid.includes (s.*m)) {
+                    std::stringstream ee;
+                    ee << "'" << key << "': " << s.*m << " is outside the range " << valid;
+                    err = ee.str();
+                }
+                return err;
+            };
+            return *this;
+        }
+
+        /*!
+         * Read every bound parameter from conf into a new S. If any can't be read, or is out of
+         * range, throw a runtime_error that lists them all.
+         */
+        S snapshot (const Config& conf) const
+        {
+            S s{};
+            this->read_all (conf, s);
+            return s;
+        }
+
+        /*!
+         * Read every bound parameter from conf into s, returning the keys whose values changed
+         * (and calling on_change with them, if any did). s is unchanged if there is an error.
+         */
+        std::vector<std::string> update (const Config& conf, S& s) const
+        {
+            S fresh = s;
+            this->read_all (conf, fresh);
+            std::vector<std::string> changed;
+            for (const auto& b : this->bindings) {
+                if (!b.equal (s, fresh)) { changed.push_back (b.key); }
+            }
+            s = fresh;
+            if (!changed.empty() && this->on_change) { this->on_change (s, changed); }
+            return changed;
+        }
+
+        //! The bound keys, in the order they were bound
+        std::vector<std::string> keys() const
+        {
+            std::vector<std::string> k;
+            for (const auto& b : this->bindings) { k.push_back (b.key); }
+            return k;
+        }
+
+        //! Called by update() with the updated struct and the keys that changed
+        std::function<void(const S&, const std::vector<std::string>&)> on_change;
+
+    private:
+        struct binding
+        {
+            std::string key;
+            //! Read the value into the struct. Returns an error message, or an empty string.
+            std::function<std::string(const Config&, S&)> read;
+            std::function<bool(const S&, const S&)> equal;
+        };
+
+        //! Read the value of key as a T, as Config::get() does. The last argument selects the overload.
+        template <typename T>
+        static T read (const Config& conf, const std::string& key, const T& defaultval, const T*)
+        {
+            return conf.get<T> (key, defaultval);
+        }
+        //! Read an array as a vec
+        template <typename F, std::size_t N>
+        static morph::vec<F, N> read (const Config& conf, const std::string& key, const morph::vec<F, N>& defaultval,
+                                      const morph::vec<F, N>*)
+        {
+            return conf.find (key) == nullptr ? defaultval : conf.getvec<F, N> (key);
+        }
+        //! Read an array as a vvec
+        template <typename F>
+        static morph::vvec<F> read (const Config& conf, const std::string& key, const morph::vvec<F>& defaultval,
+                                    const morph::vvec<F>*)
+        {
+            return conf.find (key) == nullptr ? defaultval : conf.getvvec<F> (key);
+        }
+
+        void read_all (const Config& conf, S& s) const
+        {
+            std::string errs;
+            for (const auto& b : this->bindings) {
+                std::string e = b.read (conf, s);
+                if (!e.empty()) { errs += (errs.empty() ? "" : "; ") + e; }
+            }
+            if (!errs.empty()) { throw std::runtime_error (std::string("ConfigBinding: ") + errs); }
+        }
+
+        std::vector<binding> bindings;
+    };
 } // namespace
@@ -0,0 +1,327 @@
+/*!
+ * \file
+ *
+ * A driver for parameter sweeps. From a base morph::Config and a set of values for some of
+ * its parameters, ConfigSweep runs a program once for each combination of values, a bounded
+ * number at a time, with morph::Process. Each run gets its values as Config overrides
+ * (-co:key=value), so the program reads them with Config::get() as usual.
+ */
+#pragma once
+
+#ifndef __WIN__
+
+#include <nlohmann/json.hpp>
+#include <morph/Config.h>
+#include <morph/Process.h>
+#include <map>
+#include <list>
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <functional>
+#include <filesystem>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+extern "C" {
+#include <unistd.h>
+}
+
+namespace morph {
+
+    /*!
+     * Run a program over the Cartesian product of sets of parameter values.
+     *
+     * The base config is written to outdir/base_config.json. Run i is started as
+     *
+     *   program outdir/base_config.json [args...] -co:key=value... -co:<output_key>=outdir/run_i
+     *
+     * with the directory outdir/run_i made for it to write its HdfData (or other) output into.
+     * Its stdout and stderr go to outdir/run_i/log.txt. No more than max_workers runs go at
+     * once; each worker takes the next variant as soon as its run finishes, so a few slow runs
+     * don't leave the other cores idle.
+     *
+     * After each run, outdir/sweep.json records the run's overrides, exit status and output
+     * directory. With resume set, run() skips the variants that sweep.json shows to have
+     * succeeded, so an interrupted sweep can be restarted.
+     *
+     *\code{.cpp}
+     * morph::Config base ("./params.json");
+     * morph::ConfigSweep sweep ("/path/to/model", base, "./sweep_out");
+     * sweep.add_values ("D", { "0.01", "0.02", "0.04" });
+     * sweep.add_range ("k", 0.1f, 0.5f, 0.1f);
+     * for (const auto& r : sweep.run()) {
+     *     if (r.status == 0) { morph::HdfData d (r.output_dir + "/results.h5", morph::FileAccess::ReadOnly); }
+     * }
+     *\endcode
+     */
+    class ConfigSweep
+    {
+    public:
+        //! The outcome of one run
+        struct result
+        {
+            //! The index of the variant (see variants())
+            unsigned int index = 0;
+            //! The overrides for the run
+            std::map<std::string, std::string> overrides;
+            //! The program's exit status; -1 if it crashed, couldn't be started or has not run
+            int status = -1;
+            //! The directory the run's output went into
+            std::string output_dir;
+        };
+
+        /*!
+         * A sweep of program (the full path, as for Process::start) over variations of base,
+         * writing into outdir. Any config_overrides in base apply to every run, unless
+         * overridden by the sweep.
+         */
+        ConfigSweep (const std::string& _program, const Config& base, const std::string& _outdir)
+            : program(_program), outdir(_outdir), base_root(base.root), base_overrides(base.config_overrides)
+        {
+            unsigned int n = std::thread::hardware_concurrency();
+            this->max_workers = n > 0 ? n : 1;
+        }
+
+        //! Sweep the parameter key over values (as they would be given with -co:key=value)
+        void add_values (const std::string& key, const std::vector<std::string>& values)
+        {
+            if (values.empty()) { throw std::runtime_error ("ConfigSweep: No values for " + key); }
+            this->axes.push_back ({ key, values });
+        }
+
+        //! Sweep the numerical parameter key from start to stop (inclusive, to within step/1000)
+        template <typename T>
+        void add_range (const std::string& key, const T start, const T stop, const T step)
+        {
+            if (!(step > T{0})) { throw std::runtime_error ("ConfigSweep: step must be positive for " + key); }
+            std::vector<std::string> values;
+            for (unsigned int i = 0; ; ++i) {
+                const T v = start + static_cast<T>(i) * step;
+                if (static_cast<double>(v) > static_cast<double>(stop) + static_cast<double>(step) * 1e-3) { break; }
+                std::stringstream ss;
+                ss << std::setprecision (std::numeric_limits<T>::digits10 + 1) << v;
+                values.push_back (ss.str());
+            }
+            this->add_values (key, values);
+        }
+
+        //! The overrides of each run. The parameter added first varies slowest.
+        std::vector<std::map<std::string, std::string>> variants() const
+        {
+            std::vector<std::map<std::string, std::string>> vars (1, this->base_overrides);
+            for (const auto& [key, values] : this->axes) {
+                std::vector<std::map<std::string, std::string>> next;
+                next.reserve (vars.size() * values.size());
+                for (const auto& v : vars) {
+                    for (const auto& val : values) {
+                        next.push_back (v);
+                        next.back()[key] = val;
+                    }
+                }
+                vars.swap (next);
+            }
+            return vars;
+        }
+
+        /*!
+         * Run every variant (or, with resume, every one that has not yet succeeded) and return
+         * the results of all of them, in variant order. Blocks until the last run finishes.
+         */
+        std::vector<result> run()
+        {
+            std::filesystem::create_directories (this->outdir);
+            const std::string configpath = this->outdir + "/base_config.json";
+            {
+                std::ofstream cf (configpath, std::ios::out | std::ios::trunc);
+                if (!cf.is_open()) { throw std::runtime_error ("ConfigSweep: Can't write " + configpath); }
+                cf << std::setw(4) << this->base_root << std::endl;
+            }
+
+            const std::vector<std::map<std::string, std::string>> vars = this->variants();
+            this->results.assign (vars.size(), result{});
+            for (unsigned int i = 0; i < vars.size(); ++i) {
+                this->results[i].index = i;
+                this->results[i].overrides = vars[i];
+                this->results[i].output_dir = this->outdir + "/run_" + std::to_string (i);
+            }
+            if (this->resume) { this->read_manifest(); }
+
+            std::deque<unsigned int> pending;
+            for (unsigned int i = 0; i < vars.size(); ++i) {
+                if (this->results[i].status != 0) { pending.push_back (i); }
+            }
+
+            std::list<worker> active;
+            while (!pending.empty() || !active.empty()) {
+                while (active.size() < std::max (1u, this->max_workers) && !pending.empty()) {
+                    const unsigned int i = pending.front();
+                    pending.pop_front();
+                    active.emplace_back();
+                    if (!this->launch (active.back(), configpath, i)) {
+                        active.pop_back();
+                        this->finish (i, -1);
+                    }
+                }
+                bool busy = false;
+                for (auto w = active.begin(); w != active.end();) {
+                    w->proc.probeProcess();
+                    busy |= w->drain();
+                    // probeProcess() stops looking for the process's exit once it has seen an error
+                    const bool failed = w->proc.getError() != PROCESSNOERROR;
+                    if (failed && w->proc.running()) { w->proc.waitForFinished(); }
+                    if (!w->proc.running()) {
+                        w->drain (true);
+                        const int status = failed ? -1 : w->proc.getExitStatus();
+                        this->finish (w->index, status);
+                        w = active.erase (w);
+                        busy = true;
+                    } else {
+                        ++w;
+                    }
+                }
+                if (!busy) { std::this_thread::sleep_for (std::chrono::milliseconds (this->poll_ms)); }
+            }
+            return this->results;
+        }
+
+        //! Extra arguments for every run, placed after the config file path
+        std::vector<std::string> args;
+        //! The Config key through which each run is told its output directory
+        std::string output_key = "output_dir";
+        //! The most runs at once. Defaults to the number of hardware threads.
+        unsigned int max_workers = 1;
+        //! If true, skip the variants that a previous run() of this sweep completed successfully
+        bool resume = true;
+        //! How long to sleep, in ms, when no run has anything to report
+        unsigned int poll_ms = 5;
+        //! Called in the thread that called run() as each run finishes
+        std::function<void(const result&)> on_finished;
+
+    private:
+        //! One running variant
+        struct worker
+        {
+            Process proc;
+            ProcessData pdata;
+            std::unique_ptr<ConfigProcessCallbacks> cb;
+            unsigned int index = 0;
+            std::ofstream log;
+
+            //! Copy any waiting stdout and stderr to the log. Returns true if there was any.
+            bool drain (const bool finished = false)
+            {
+                bool got = false;
+                // Once the process has gone, the pipes are at their end, so reads can't block
+                if (finished || this->pdata.getStdOutReady()) {
+                    std::string o = this->proc.readAllStandardOutput();
+                    this->log << o;
+                    got |= !o.empty();
+                    this->pdata.setStdOutReady (false);
+                }
+                if (finished || this->pdata.getStdErrReady()) {
+                    std::string e = this->proc.readAllStandardError();
+                    this->log << e;
+                    got |= !e.empty();
+                    this->pdata.setStdErrReady (false);
+                }
+                return got;
+            }
+        };
+
+        //! Start variant i in w. Returns false if it failed to start.
+        bool launch (worker& w, const std::string& configpath, const unsigned int i)
+        {
+            const result& r = this->results[i];
+            std::filesystem::create_directories (r.output_dir);
+            w.index = i;
+            w.log.open (r.output_dir + "/log.txt", std::ios::out | std::ios::trunc);
+            w.cb = std::make_unique<ConfigProcessCallbacks>(&w.pdata);
+            w.proc.setCallbacks (w.cb.get());
+            w.proc.setUseSpawn (true);
+
+            std::list<std::string> argl = { this->program, configpath };
+            for (const auto& a : this->args) { argl.push_back (a); }
+            for (const auto& [key, val] : r.overrides) { argl.push_back ("-co:" + key + "=" + val); }
+            argl.push_back ("-co:" + this->output_key + "=" + r.output_dir);
+
+            if (w.proc.start (this->program, argl) != PROCESS_MAIN_APP) {
+                // In the child, start() only returns if it could not set up its stdin/out/err
+                if (w.proc.getPid() == 0) { _exit (-1); }
+                return false;
+            }
+            return w.proc.waitForStarted();
+        }
+
+        //! Record that variant i finished with status
+        void finish (const unsigned int i, const int status)
+        {
+            this->results[i].status = status;
+            this->write_manifest();
+            if (this->on_finished) { this->on_finished (this->results[i]); }
+        }
+
+        //! Read the results of an earlier run() from outdir/sweep.json, if they match this sweep
+        void read_manifest()
+        {
+            std::ifstream mf (this->outdir + "/sweep.json");
+            if (!mf.is_open()) { return; }
+            nlohmann::json m;
+            try {
+                mf >> m;
+            } catch (const nlohmann::json::exception& e) {
+                std::cerr << "ConfigSweep: Ignoring unreadable sweep.json (" << e.what() << ")\n";
+                return;
+            }
+            if (!m.contains ("runs")) { return; }
+            for (const auto& jr : m["runs"]) {
+                const unsigned int i = jr.value ("index", 0u);
+                if (i >= this->results.size()) { continue; }
+                // Only trust a record for the same overrides
+                if (jr.value ("overrides", std::map<std::string, std::string>{}) != this->results[i].overrides) { continue; }
+                if (!std::filesystem::is_directory (this->results[i].output_dir)) { continue; }
+                this->results[i].status = jr.value ("status", -1);
+            }
+        }
+
+        //! Write the results so far to outdir/sweep.json, replacing it in one step
+        void write_manifest() const
+        {
+            nlohmann::json m;
+            m["program"] = this->program;
+            m["runs"] = nlohmann::json::array();
+            for (const auto& r : this->results) {
+                m["runs"].push_back ({ { "index", r.index }, { "overrides", r.overrides },
+                                       { "status", r.status }, { "output_dir", r.output_dir } });
+            }
+            const std::string path = this->outdir + "/sweep.json";
+            {
+                std::ofstream mf (path + ".tmp", std::ios::out | std::ios::trunc);
+                mf << std::setw(4) << m << std::endl;
+            }
+            std::filesystem::rename (path + ".tmp", path);
+        }
+
+        //! The program to run
+        std::string program;
+        //! The directory for the sweep's config, records and runs
+        std::string outdir;
+        //! The base config
+        nlohmann::json base_root;
+        std::map<std::string, std::string> base_overrides;
+        //! The swept parameters and their values, in the order they were added
+        std::vector<std::pair<std::string, std::vector<std::string>>> axes;
+        //! The result of each variant
+        std::vector<result> results;
+    };
+
+} // namespace morph
+
+#endif // __WIN__
@@ -54,10 +54,8 @@ namespace morph {
             this->idx = 0;
 
             if (this->scalarData != nullptr) {
-                this->dcopy.resize (this->scalarData->size());
-                this->zScale.transform (*(this->scalarData), this->dcopy);
-                this->dcolour.resize (this->scalarData->size());
-                this->colourScale.transform (*(this->scalarData), this->dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
             } else if (this->vectorData != nullptr) {
                 this->dcopy.resize (this->vectorData->size());
                 this->dcolour.resize (this->vectorData->size());
@@ -14,7 +14,9 @@
 #include <vector>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 #include <morph/DirichVtx.h>
+#include <morph/dirichlet_labels.h>
 #include <morph/NM_Simplex.h>
 #include <morph/HdfData.h>
 #include <morph/Hex.h>
@@ -308,6 +310,19 @@ namespace morph {
             DBG2 ("Area = " << this->area);
         }
 
+        /*!
+         * Compute the area of this domain as the number of hexes in its connected component of
+         * \a labels, which must have been computed for the identity map that gave the vertices.
+         * Unlike compute_area (HexGrid*, f) this needs no walk of the domain's border.
+         */
+        void compute_area (const dirichlet_labels<Flt>& labels)
+        {
+            if (this->vertices.empty()) { throw std::runtime_error ("DirichDom::compute_area: the domain has no vertices"); }
+            // Each vertex lives on a hex of the domain it belongs to
+            this->area = labels.area (labels.label[this->vertices.front().hi->vi]);
+            DBG2 ("Area = " << this->area);
+        }
+
         //! This is the objective function for the gradient descent. Put it in DirichDom
         Flt compute_sos (const Flt& x, const Flt& y) const
         {
@@ -0,0 +1,234 @@
+/*!
+ * \file
+ *
+ * morph::GeodesicGrid, a simulation domain on the surface of a sphere, made from the
+ * icosahedral geodesic polyhedron of morph::geometry::make_icosahedral_geodesic.
+ *
+ * Each vertex of the geodesic is an element of the grid: the 12 vertices of the original
+ * icosahedron have five neighbours and all the others have six, so the whole sphere is covered
+ * with near-uniform cells and none is wasted or badly distorted, as they are when a flat
+ * HexGrid is projected onto a sphere. The elements are in the geodesic's own (spiral) order,
+ * which is the order of the vertices that GeodesicVisual draws, so a field on the grid can be
+ * passed to GeodesicVisual::data as it is (see GeodesicVisual::setGrid).
+ *
+ * laplacian() is the cotangent Laplacian, a finite volume Laplacian on the dual (Voronoi) cells
+ * of the vertices, so that it conserves the integral of a field and can replace the HexGrid
+ * Laplacian in an RD_Base-style model. Its error falls as the grid is refined, except along the
+ * lines of the original icosahedron's edges where the bisected geodesic is irregular; there it
+ * stays at a few percent of the largest value of the Laplacian.
+ *
+ *\code{.cpp}
+ * morph::GeodesicGrid<float> gg (5, 1.0f); // 10242 elements on the unit sphere
+ * std::vector<float> u (gg.n(), 0.0f), lap;
+ * // ...
+ * gg.laplacian (u, lap);
+ *\endcode
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/geometry.h>
+#include <morph/mathconst.h>
+#include <morph/memory_usage.h>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+
+    template <typename C = float>
+    struct GeodesicGrid
+    {
+        static_assert (std::is_floating_point_v<C>, "GeodesicGrid: The coordinate type must be floating point");
+
+        /*!
+         * The geodesic of _iterations subdivisions of the icosahedron (10 * 4^_iterations + 2
+         * elements) on a sphere of radius _radius. The geometry is always computed in double
+         * precision.
+         */
+        GeodesicGrid (const unsigned int _iterations, const C _radius = C{1})
+            : iterations(_iterations), radius(_radius)
+        {
+            if (this->iterations > 10) { throw std::runtime_error ("GeodesicGrid: iterations may not exceed 10"); }
+            if (!(this->radius > C{0})) { throw std::runtime_error ("GeodesicGrid: radius must be > 0"); }
+            this->init();
+        }
+
+        //! The number of elements (the vertices of the geodesic)
+        std::size_t n() const { return this->coords.size(); }
+        unsigned int get_iterations() const { return this->iterations; }
+        C get_radius() const { return this->radius; }
+
+        //! The position of element i, on the sphere
+        morph::vec<C, 3> coord (const std::size_t i) const { return this->coords[i]; }
+        morph::vec<C, 3> operator[] (const std::size_t i) const { return this->coords[i]; }
+        //! The area of element i's cell
+        C area (const std::size_t i) const { return this->areas[i]; }
+        //! The number of neighbours of element i (5 or 6)
+        unsigned int num_neighbours (const std::size_t i) const { return this->nbr_start[i + 1] - this->nbr_start[i]; }
+        //! True for the 12 elements with five neighbours
+        bool is_fivefold (const std::size_t i) const { return this->num_neighbours (i) == 5u; }
+
+        //! The elements' positions on the sphere of radius radius
+        std::vector<morph::vec<C, 3>> coords;
+        //! The area of each element's dual cell. These sum to the area of the sphere.
+        std::vector<C> areas;
+        //! The triangles of the geodesic, as three element indices, anticlockwise seen from outside
+        std::vector<std::array<std::uint32_t, 3>> faces;
+
+        /*!
+         * The neighbours of element i are nbr[j] for j in [nbr_start[i], nbr_start[i+1]), in
+         * order anticlockwise about the outward normal. nbr_w[j] is the cotangent weight of
+         * the edge to neighbour j, (cot a + cot b) / 2 where a and b are the angles opposite
+         * the edge in the two triangles that share it, which is the length of the cells'
+         * shared face over the distance between the elements.
+         */
+        std::vector<std::uint32_t> nbr_start;
+        std::vector<std::uint32_t> nbr;
+        std::vector<C> nbr_w;
+
+        /*!
+         * The Laplacian of u: for each element, the sum over its edges of nbr_w (u_neighbour
+         * - u) over its area. The weight of an edge is the same from both ends, so the
+         * integral of u is conserved.
+         */
+        template <typename F>
+        void laplacian (const std::vector<F>& u, std::vector<F>& lap) const
+        {
+            if (u.size() != this->n()) { throw std::runtime_error ("GeodesicGrid::laplacian: u is the wrong size"); }
+            lap.resize (this->n());
+            const long long int nn = static_cast<long long int>(this->n());
+#pragma omp parallel for
+            for (long long int i = 0; i < nn; ++i) {
+                F s = F{0};
+                for (std::uint32_t j = this->nbr_start[i]; j < this->nbr_start[i + 1]; ++j) {
+                    s += static_cast<F>(this->nbr_w[j]) * (u[this->nbr[j]] - u[i]);
+                }
+                lap[i] = s / static_cast<F>(this->areas[i]);
+            }
+        }
+
+        //! The integral of u over the sphere
+        template <typename F>
+        F integral (const std::vector<F>& u) const
+        {
+            F s = F{0};
+            for (std::size_t i = 0; i < this->n(); ++i) { s += u[i] * static_cast<F>(this->areas[i]); }
+            return s;
+        }
+
+        //! The memory held by this GeodesicGrid
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("GeodesicGrid", sizeof (*this));
+            mu.add ("coords", this->coords);
+            mu.add ("areas", this->areas);
+            mu.add ("faces", this->faces);
+            mu.add ("neighbours", this->nbr_start).cpu += morph::heap_bytes (this->nbr) + morph::heap_bytes (this->nbr_w);
+            return mu;
+        }
+
+    private:
+        unsigned int iterations = 0;
+        C radius = C{1};
+
+        void init()
+        {
+            using vd = morph::vec<double, 3>;
+            const morph::geometry::icosahedral_geodesic<double> geo =
+            morph::geometry::make_icosahedral_geodesic<double> (static_cast<int>(this->iterations));
+            const std::size_t nv = geo.poly.vertices.size();
+
+            const double r = static_cast<double>(this->radius);
+            std::vector<vd> p (nv);
+            this->coords.resize (nv);
+            for (std::size_t i = 0; i < nv; ++i) {
+                p[i] = geo.poly.vertices[i];
+                p[i].renormalize();
+                p[i] *= r;
+                this->coords[i] = p[i].template as<C>();
+            }
+
+            // The faces, wound anticlockwise seen from outside, and each element's neighbours
+            this->faces.resize (geo.poly.faces.size());
+            std::vector<std::vector<std::uint32_t>> nb (nv);
+            for (std::size_t f = 0; f < geo.poly.faces.size(); ++f) {
+                std::array<std::uint32_t, 3> t = {
+                    static_cast<std::uint32_t>(geo.poly.faces[f][0]),
+                    static_cast<std::uint32_t>(geo.poly.faces[f][1]),
+                    static_cast<std::uint32_t>(geo.poly.faces[f][2])
+                };
+                if ((p[t[1]] - p[t[0]]).cross (p[t[2]] - p[t[0]]).dot (p[t[0]]) < 0.0) { std::swap (t[1], t[2]); }
+                this->faces[f] = t;
+                for (unsigned int k = 0; k < 3; ++k) {
+                    for (unsigned int l = 1; l < 3; ++l) {
+                        const std::uint32_t o = t[(k + l) % 3];
+                        if (std::find (nb[t[k]].begin(), nb[t[k]].end(), o) == nb[t[k]].end()) { nb[t[k]].push_back (o); }
+                    }
+                }
+            }
+
+            // Sort the neighbours by their angle about each element's outward normal
+            this->nbr_start.assign (nv + 1, 0);
+            for (std::size_t i = 0; i < nv; ++i) {
+                const vd nrm = p[i] / r;
+                vd e1 = p[nb[i][0]] - p[i];
+                e1 -= nrm * e1.dot (nrm);
+                e1.renormalize();
+                const vd e2 = nrm.cross (e1);
+                std::vector<std::pair<double, std::uint32_t>> a;
+                for (std::uint32_t k : nb[i]) {
+                    const vd d = p[k] - p[i];
+                    a.emplace_back (std::atan2 (d.dot (e2), d.dot (e1)), k);
+                }
+                std::sort (a.begin(), a.end());
+                for (std::size_t k = 0; k < a.size(); ++k) { nb[i][k] = a[k].second; }
+                this->nbr_start[i + 1] = this->nbr_start[i] + static_cast<std::uint32_t>(nb[i].size());
+            }
+            this->nbr.resize (this->nbr_start[nv]);
+            for (std::size_t i = 0; i < nv; ++i) { std::copy (nb[i].begin(), nb[i].end(), this->nbr.begin() + this->nbr_start[i]); }
+
+            // The cotangent weights and the Voronoi areas, from the angles of each (flat) triangle
+            std::vector<double> w (this->nbr.size(), 0.0);
+            std::vector<double> ar (nv, 0.0);
+            auto add_w = [this, &w](const std::uint32_t a, const std::uint32_t b, const double c) {
+                for (std::uint32_t j = this->nbr_start[a]; j < this->nbr_start[a + 1]; ++j) {
+                    if (this->nbr[j] == b) { w[j] += c; return; }
+                }
+            };
+            for (const std::array<std::uint32_t, 3>& t : this->faces) {
+                for (unsigned int k = 0; k < 3; ++k) {
+                    // The angle at t[k] is opposite the edge (a, b)
+                    const std::uint32_t a = t[(k + 1) % 3];
+                    const std::uint32_t b = t[(k + 2) % 3];
+                    const vd ea = p[a] - p[t[k]];
+                    const vd eb = p[b] - p[t[k]];
+                    const double cot = ea.dot (eb) / ea.cross (eb).length();
+                    add_w (a, b, 0.5 * cot);
+                    add_w (b, a, 0.5 * cot);
+                    // The part of triangle t in a's and b's Voronoi cells that borders edge (a, b)
+                    const double l2 = (p[b] - p[a]).sos();
+                    ar[a] += l2 * cot / 8.0;
+                    ar[b] += l2 * cot / 8.0;
+                }
+            }
+
+            // The flat cells cover the polyhedron, which is a little smaller than the sphere.
+            // Scale them up so that the areas sum to that of the sphere (and the integral of a
+            // constant is exact).
+            double total = 0.0;
+            for (double _a : ar) { total += _a; }
+            const double scale = 4.0 * morph::mathconst<double>::pi * r * r / total;
+            this->areas.resize (nv);
+            for (std::size_t i = 0; i < nv; ++i) { this->areas[i] = static_cast<C>(ar[i] * scale); }
+            this->nbr_w.resize (w.size());
+            for (std::size_t j = 0; j < w.size(); ++j) { this->nbr_w[j] = static_cast<C>(w[j]); }
+        }
+    };
+
+} // namespace morph
@@ -5,7 +5,10 @@
 #include <morph/mathconst.h>
 #include <morph/scale.h>
 #include <morph/ColourMap.h>
+#include <morph/GeodesicGrid.h>
+#include <morph/unit_sphere.h>
 #include <array>
+#include <cstdint>
 
 namespace morph {
 
@@ -41,6 +44,28 @@ namespace morph {
             this->colourScale.do_autoscale = true;
         }
 
+        /*!
+         * Draw the elements of gg, as vertex colours: vertex i of the model is element i of gg,
+         * so a field on gg can be copied straight into data (or cdata) with no remapping.
+         * Sets colourFaces false, iterations and radius. Call before finalize().
+         */
+        template <typename C>
+        void setGrid (const morph::GeodesicGrid<C>& gg)
+        {
+            this->colourFaces = false;
+            this->iterations = static_cast<int>(gg.get_iterations());
+            this->radius = static_cast<float>(gg.get_radius());
+            this->grid_mesh.vertices.resize (gg.n());
+            for (std::size_t i = 0; i < gg.n(); ++i) {
+                this->grid_mesh.vertices[i] = (gg.coord (i) / gg.get_radius()).as_float();
+            }
+            this->grid_mesh.indices.clear();
+            this->grid_mesh.indices.reserve (3 * gg.faces.size());
+            for (const std::array<std::uint32_t, 3>& f : gg.faces) {
+                this->grid_mesh.indices.insert (this->grid_mesh.indices.end(), f.begin(), f.end());
+            }
+        }
+
         //! Initialize vertex buffer objects and vertex array object.
         void initializeVertices()
         {
@@ -53,7 +78,14 @@ namespace morph {
             this->n_faces = gi.n_faces;
             this->n_verts = gi.n_vertices;
 
-            if (this->colourFaces == true) {
+            if (!this->grid_mesh.vertices.empty()) {
+                // The elements of a GeodesicGrid, in its order (see setGrid)
+                this->n_verts = this->computeSphereMesh (this->grid_mesh, morph::vec<float, 3>({0,0,0}),
+                                                         this->cm.convert(0.0f), this->radius);
+                this->n_faces = static_cast<int>(this->grid_mesh.indices.size() / 3);
+                this->data.resize (this->n_verts, T{0});
+
+            } else if (this->colourFaces == true) {
                 // Resize our data.
                 this->data.resize (this->n_faces, T{0});
 
@@ -196,6 +228,10 @@ namespace morph {
         int n_verts = 0;
         //! This may be filled with the number of faces in the geodesic
         int n_faces = 0;
+
+    protected:
+        //! The vertices and triangles of a GeodesicGrid passed to setGrid()
+        morph::unit_sphere_mesh grid_mesh;
     };
 
 } // namespace morph
@@ -13,7 +13,10 @@
 #include <cmath>
 #include <sstream>
 #include <memory>
+#include <algorithm>
 #include <cstdint>
+#include <span>
+#include <atomic>
 #include <morph/mathconst.h>
 #include <morph/tools.h>
 #include <morph/scale.h>
@@ -22,10 +25,13 @@
 #include <morph/vvec.h>
 #include <morph/quaternion.h>
 #include <morph/histo.h>
+#include <morph/minmax_pyramid.h>
+#include <morph/spsc_ring.h>
 #include <morph/colour.h>
 #include <morph/gl/version.h>
 #include <morph/VisualModel.h>
 #include <morph/VisualTextModel.h>
+#include <morph/InstancedShapeVisual.h>
 #include <morph/graphstyles.h>
 #include <morph/ColourMap.h>
 #include <morph/Grid.h>
@@ -111,11 +117,21 @@ namespace morph {
             (this->graphDataCoords[didx])->resize (oldsz+1);
             this->graphDataCoords[didx].get()->at(oldsz) = morph::vec<float>{ static_cast<float>(a), static_cast<float>(o), float{0} };
             int redraw_plot = 0;
+            bool scrolled = false;
             morph::range<Flt> xrange = this->datarange_x;
             morph::range<Flt> yrange = this->datarange_y;
             morph::range<Flt> y2range = this->datarange_y2;
             // check x axis
-            if (this->auto_rescale_x) { redraw_plot += xrange.update (_abscissa) ? 1 : 0; }
+            if (this->scroll_window > Flt{0}) {
+                // Jump the window forwards if the new datum is off the right hand end
+                if (_abscissa > xrange.max) {
+                    xrange.max = _abscissa + this->scroll_step * this->scroll_window;
+                    xrange.min = xrange.max - this->scroll_window;
+                    this->drop_data_before (xrange.min);
+                    scrolled = true;
+                    ++redraw_plot;
+                }
+            } else if (this->auto_rescale_x) { redraw_plot += xrange.update (_abscissa) ? 1 : 0; }
 
             // check y axis
             if (this->auto_rescale_y) {
@@ -128,38 +144,217 @@ namespace morph {
 
             // update graph if necessary
             if (redraw_plot > 0) {
-                this->clear_graph_data();
+                this->rebuild_appended (xrange, yrange, y2range, scrolled, this->datastyles[didx].axisside, didx == 0);
+            }
+            // else the new datum's vertices are added to the existing ones by drawAppendedData() in render_geometry()
+        }
 
-                // setdata or this function will re-add these
-                this->graphDataCoords.clear();
-                this->datastyles.clear();
+        /*!
+         * Append many data to dataset didx. The same as calling append() for each pair of
+         * _abscissae and _ordinates, except that if the data move the axis limits (with
+         * auto_rescale_x, auto_rescale_y or scroll_window), the graph is rebuilt once, not
+         * once for each datum that moves them.
+         */
+        template <typename Ctnr1, typename Ctnr2>
+        std::enable_if_t<morph::is_copyable_container<Ctnr1>::value
+                         && morph::is_copyable_container<Ctnr2>::value, void>
+        append (const Ctnr1& _abscissae, const Ctnr2& _ordinates, const unsigned int didx)
+        {
+            if (_abscissae.size() != _ordinates.size()) { throw std::runtime_error ("GraphVisual::append: size mismatch"); }
+            if (_abscissae.empty()) { return; }
+            const morph::axisside side = this->datastyles[didx].axisside;
 
-                this->pendingAppended = true; // as the graph will be re-drawn
-                if (didx == 0) { this->abscissa_scale.reset(); }
-                if (this->datastyles[didx].axisside == morph::axisside::left) {
-                    this->ord1_scale.reset();
-                } else {
-                    this->ord2_scale.reset();
+            // Find the axis limits after all the data, as append() would move them
+            morph::range<Flt> xrange = this->datarange_x;
+            morph::range<Flt> yrange = this->datarange_y;
+            morph::range<Flt> y2range = this->datarange_y2;
+            bool scrolled = false;
+            bool moved = false;
+            auto oi = _ordinates.begin();
+            for (auto ai = _abscissae.begin(); ai != _abscissae.end(); ++ai, ++oi) {
+                const Flt x = static_cast<Flt>(*ai);
+                const Flt y = static_cast<Flt>(*oi);
+                if (this->scroll_window > Flt{0}) {
+                    if (x > xrange.max) {
+                        xrange.max = x + this->scroll_step * this->scroll_window;
+                        xrange.min = xrange.max - this->scroll_window;
+                        scrolled = true;
+                        moved = true;
+                    }
+                } else if (this->auto_rescale_x) { moved = xrange.update (x) || moved; }
+                if (this->auto_rescale_y) {
+                    moved = (side == morph::axisside::left ? yrange.update (y) : y2range.update (y)) || moved;
                 }
-                this->setlimits (xrange, yrange, y2range);
+            }
 
-                if (!this->ord1.empty()) {
-                    // vvec, vvec, datasetstyle
-                    this->setdata (this->absc1, this->ord1, this->ds_ord1);
+            if (!moved) {
+                // Each datum's vertices are added to the existing ones
+                oi = _ordinates.begin();
+                for (auto ai = _abscissae.begin(); ai != _abscissae.end(); ++ai, ++oi) {
+                    this->append (static_cast<Flt>(*ai), static_cast<Flt>(*oi), didx);
                 }
-                if (!this->ord2.empty()) {
-                    this->setdata (this->absc2, this->ord2, this->ds_ord2);
+                return;
+            }
+
+            morph::vvec<Flt>& absc = side == morph::axisside::left ? this->absc1 : this->absc2;
+            morph::vvec<Flt>& ord = side == morph::axisside::left ? this->ord1 : this->ord2;
+            oi = _ordinates.begin();
+            for (auto ai = _abscissae.begin(); ai != _abscissae.end(); ++ai, ++oi) {
+                absc.push_back (static_cast<Flt>(*ai));
+                ord.push_back (static_cast<Flt>(*oi));
+            }
+            if (scrolled) { this->drop_data_before (xrange.min); }
+            this->rebuild_appended (xrange, yrange, y2range, scrolled, side, didx == 0);
+        }
+
+        /*!
+         * Make a queue for each dataset prepared so far, into which other threads can push()
+         * data without the OpenGL context. Call on the thread that renders, after prepdata() or
+         * setdata() and before any thread pushes. capacity is the size of each queue; data
+         * pushed while a queue is full are dropped.
+         */
+        void make_incoming (const std::size_t capacity = 4096)
+        {
+            this->incoming.clear();
+            for (std::size_t i = 0; i < this->datastyles.size(); ++i) {
+                this->incoming.push_back (std::make_unique<morph::spsc_ring<morph::vec<Flt, 2>>>(capacity));
+            }
+        }
+
+        /*!
+         * Queue the datum (x, y) for dataset didx, from a thread other than the renderer. This
+         * takes no locks and no context; the data queued are appended together at the start of
+         * the next frame that draws the graph (see drain_incoming()). Each dataset's queue
+         * takes data from one thread at a time. Returns false if the queue was full and the
+         * datum was dropped.
+         */
+        bool push (const Flt x, const Flt y, const unsigned int didx)
+        {
+            if (didx >= this->incoming.size()) { throw std::runtime_error ("GraphVisual::push: no queue for this dataset. Call make_incoming()"); }
+            if (this->incoming[didx]->push (morph::vec<Flt, 2>{ x, y })) { return true; }
+            this->incoming_dropped.fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+
+        //! Queue many data for dataset didx. Returns the number queued; the rest were dropped.
+        std::size_t push (std::span<const morph::vec<Flt, 2>> xy, const unsigned int didx)
+        {
+            if (didx >= this->incoming.size()) { throw std::runtime_error ("GraphVisual::push: no queue for this dataset. Call make_incoming()"); }
+            const std::size_t n = this->incoming[didx]->push (xy);
+            if (n < xy.size()) { this->incoming_dropped.fetch_add (xy.size() - n, std::memory_order_relaxed); }
+            return n;
+        }
+
+        //! The number of data that push() has dropped because a queue was full
+        std::uint64_t incoming_dropped_count() const { return this->incoming_dropped.load (std::memory_order_relaxed); }
+
+        /*!
+         * Append everything queued by push() to the graph, one batch per dataset. Called on
+         * the rendering thread by render_geometry(). Returns the number of data appended.
+         */
+        std::size_t drain_incoming()
+        {
+            std::size_t n = 0;
+            for (unsigned int d = 0; d < this->incoming.size(); ++d) {
+                this->drain_xy.clear();
+                if (this->incoming[d]->pop_all (this->drain_xy) == 0) { continue; }
+                this->drain_x.resize (this->drain_xy.size());
+                this->drain_y.resize (this->drain_xy.size());
+                for (std::size_t i = 0; i < this->drain_xy.size(); ++i) {
+                    this->drain_x[i] = this->drain_xy[i][0];
+                    this->drain_y[i] = this->drain_xy[i][1];
                 }
+                this->append (this->drain_x, this->drain_y, d);
+                n += this->drain_xy.size();
             }
+            return n;
+        }
 
-            VisualModel<glver>::clear(); // Get rid of the vertices.
-            this->initializeVertices(); // Re-build
+        /*!
+         * Scrolling mode for append(). If scroll_window > 0, then the x axis shows a window of
+         * this width. When appended data passes the right hand end of the axis, the window is
+         * moved forwards by scroll_step * scroll_window beyond the new datum, and data that has
+         * left the window is dropped. The graph has to be rebuilt only when the window moves.
+         * Use setlimits_x to set the first window before calling prepdata().
+         */
+        Flt scroll_window = Flt{0};
+        //! The fraction of scroll_window by which the window moves forwards
+        Flt scroll_step = Flt{0.25};
+
+        /*!
+         * Level of detail for long datasets. If lod_bins > 1, then setdata() reduces any dataset
+         * with more than 2 * lod_bins points to the min and max of each of lod_bins - 1 bins, so
+         * that the number of vertices depends on lod_bins and not on the size of the data. If
+         * the x axis limits have been set, only the data within them is binned. A value similar
+         * to the width of the graph in pixels (e.g. 2000) gives a line that looks the same as the
+         * full data. The abscissae must be in ascending order; otherwise the data is not reduced.
+         * Markers are drawn only for the points that are kept.
+         */
+        unsigned int lod_bins = 0;
+
+        //! Compute the min/max envelope of _data into env_absc/env_data. Return false if the
+        //! abscissae are not sorted.
+        template <typename Ctnr1, typename Ctnr2>
+        bool lod_envelope (const Ctnr1& _abscissae, const Ctnr2& _data, morph::vvec<Flt>& env_absc, morph::vvec<Flt>& env_data)
+        {
+            morph::vvec<Flt> absc;
+            absc.set_from (_abscissae);
+            morph::vvec<Flt> ord;
+            ord.set_from (_data);
+            if (!std::is_sorted (absc.begin(), absc.end())) { return false; }
+
+            // With manual x limits, bin only the visible data (plus one point either side)
+            std::size_t i0 = 0;
+            std::size_t i1 = absc.size();
+            if (this->scalingpolicy_x == morph::scalingpolicy::manual) {
+                i0 = std::lower_bound (absc.begin(), absc.end(), this->datarange_x.min) - absc.begin();
+                i1 = std::upper_bound (absc.begin(), absc.end(), this->datarange_x.max) - absc.begin();
+                if (i0 > 0) { --i0; }
+                if (i1 < absc.size()) { ++i1; }
+            }
+
+            morph::minmax_pyramid pyr (ord);
+            std::vector<std::size_t> keep = pyr.envelope (ord, i0, i1, this->lod_bins - 1);
+            env_absc.resize (keep.size());
+            env_data.resize (keep.size());
+            for (std::size_t i = 0; i < keep.size(); ++i) {
+                env_absc[i] = absc[keep[i]];
+                env_data[i] = ord[keep[i]];
+            }
+            return true;
         }
 
-        //! Before calling the base class's render method, check if we have any pending data
-        void render()
+        //! Remove appended data with abscissa less than x (used in scrolling mode)
+        void drop_data_before (const Flt x)
         {
-            if (this->pendingAppended == true) {
+            auto drop = [x](morph::vvec<Flt>& absc, morph::vvec<Flt>& ord)
+            {
+                std::size_t n = 0;
+                while (n < absc.size() && absc[n] < x) { ++n; }
+                absc.erase (absc.begin(), absc.begin() + n);
+                ord.erase (ord.begin(), ord.begin() + n);
+            };
+            drop (this->absc1, this->ord1);
+            drop (this->absc2, this->ord2);
+        }
+
+        //! True if appended data is waiting to be drawn by render_geometry()
+        bool render_pending() const override
+        {
+            if (this->pendingAppended == true || VisualModel<glver>::render_pending()) { return true; }
+            for (const auto& q : this->incoming) { if (!q->empty()) { return true; } }
+            for (auto layer : { &this->marker_instances, &this->line_instances, &this->join_instances }) {
+                for (auto& m : *layer) { if (m && m->sync_pending()) { return true; } }
+            }
+            return false;
+        }
+
+        //! Before calling the base class's render_geometry method, check if we have any pending data
+        void render_geometry()
+        {
+            // Data pushed from other threads since the last frame
+            if (!this->incoming.empty() && !this->build_running()) { this->drain_incoming(); }
+            if (this->pendingAppended == true && !this->build_running()) {
                 // After adding to graphDataCoords, we have to create the new OpenGL
                 // vertices (CPU side) and update the OpenGL buffers.
                 this->drawAppendedData();
@@ -167,7 +362,8 @@ namespace morph {
                 this->pendingAppended = false;
             }
             // Now do the usual drawing stuff from VisualModel:
-            VisualModel<glver>::render();
+            VisualModel<glver>::render_geometry();
+            if (this->hide == false) { this->render_data_instances(); }
         }
 
         //! Clear all the coordinate data for the graph, but leave the containers in place.
@@ -180,12 +376,19 @@ namespace morph {
             this->reinit();
         }
 
-        //! Update the data for the graph, recomputing the vertices when done.
+        /*!
+         * Update the data for the graph, recomputing the vertices when done. If the axis limits
+         * are unchanged, only the vertices of the data are recomputed; the axes, the legend and
+         * all the texts are kept from the last full build. Call reinit() for a full rebuild
+         * after changing a style such as axiscolour.
+         */
         template <typename Ctnr1, typename Ctnr2>
         std::enable_if_t<morph::is_copyable_container<Ctnr1>::value
                          && morph::is_copyable_container<Ctnr2>::value, void>
         update (const Ctnr1& _abscissae, const Ctnr2& _data, const unsigned int data_idx)
         {
+            // A build that is still running reads the data coordinates
+            if (this->build_async) { this->wait_async_build(); }
             unsigned int dsize = _data.size();
             morph::range<Flt> datarange;
 
@@ -262,7 +465,16 @@ namespace morph {
                 this->graphDataCoords[data_idx].get()->at(i) = morph::vec<float>{ static_cast<float>(ad[i]), static_cast<float>(sd[i]), float{0} };
             }
 
-            this->clearTexts(); // VisualModel::clearTexts()
+            // If the axis limits did not change, the axes, legend and texts of the last build
+            // are still good and initializeVertices() reuses them
+            this->data_only_update = this->decorations_valid && this->decoration_ranges == this->current_ranges();
+
+            if (this->build_async) {
+                // The texts are cleared and re-made on the render thread
+                this->reinit_async();
+                return;
+            }
+            if (!this->data_only_update) { this->clearTexts(); } // VisualModel::clearTexts()
             this->reinit();
         }
 
@@ -289,6 +501,7 @@ namespace morph {
                 std::cout << "Can't add change data label at graphDataCoords index " << data_idx << std::endl;
                 return;
             }
+            if (this->datastyles[data_idx].datalabel != datalabel) { this->decorations_valid = false; }
             this->datastyles[data_idx].datalabel = datalabel;
             this->update (_abscissae, _data, data_idx);
         }
@@ -454,6 +667,16 @@ namespace morph {
                 throw std::runtime_error (ee.str());
             }
 
+            // Reduce a very long dataset to its min/max envelope (see lod_bins)
+            if (this->lod_bins > 1 && _data.size() > 2 * this->lod_bins) {
+                morph::vvec<Flt> env_absc;
+                morph::vvec<Flt> env_data;
+                if (this->lod_envelope (_abscissae, _data, env_absc, env_data)) {
+                    this->setdata (env_absc, env_data, ds);
+                    return;
+                }
+            }
+
             // Save data first
             if (ds.axisside == morph::axisside::left) {
                 this->absc1.set_from (_abscissae);
@@ -929,16 +1152,155 @@ namespace morph {
         //! Is there pending appended data that needs to be converted into OpenGL shapes?
         bool pendingAppended = false;
 
+        /*!
+         * Rebuild the graph from absc1/ord1 and absc2/ord2 after appended data have moved the
+         * axis limits to xrange, yrange and y2range. side is the axis of the data appended.
+         */
+        void rebuild_appended (const morph::range<Flt>& xrange, const morph::range<Flt>& yrange, const morph::range<Flt>& y2range,
+                               const bool scrolled, const morph::axisside side, const bool reset_abscissa)
+        {
+            this->clear_graph_data();
+
+            // setdata or this function will re-add these
+            this->graphDataCoords.clear();
+            this->datastyles.clear();
+
+            this->pendingAppended = true; // as the graph will be re-drawn
+            if (reset_abscissa || scrolled) { this->abscissa_scale.reset(); }
+            if (scrolled) {
+                // The abscissa scaling is recomputed in setdata for both axes
+                this->ord1_scale.reset();
+                this->ord2_scale.reset();
+            } else if (side == morph::axisside::left) {
+                this->ord1_scale.reset();
+            } else {
+                this->ord2_scale.reset();
+            }
+            this->setlimits (xrange, yrange, y2range);
+
+            if (!this->ord1.empty()) {
+                // vvec, vvec, datasetstyle
+                this->setdata (this->absc1, this->ord1, this->ds_ord1);
+            }
+            if (!this->ord2.empty()) {
+                this->setdata (this->absc2, this->ord2, this->ds_ord2);
+            }
+
+            VisualModel<glver>::clear(); // Get rid of the vertices.
+            this->build_vertices(); // Re-build
+        }
+
+        //! The queues of data from push(), one per dataset (see make_incoming())
+        std::vector<std::unique_ptr<morph::spsc_ring<morph::vec<Flt, 2>>>> incoming;
+        std::atomic<std::uint64_t> incoming_dropped = 0;
+        //! Reused by drain_incoming()
+        std::vector<morph::vec<Flt, 2>> drain_xy;
+        morph::vvec<Flt> drain_x;
+        morph::vvec<Flt> drain_y;
+
+        /*!
+         * The vertices of the axes and the legend from the last full build, with indices that
+         * count from 0. update() reuses these, and the texts, while the axis limits stay the same.
+         */
+        struct decoration_vertices
+        {
+            std::vector<float> positions;
+            std::vector<float> normals;
+            std::vector<float> colors;
+            std::vector<GLuint> indices;
+            GLuint n_vertices = 0u;
+            void clear()
+            {
+                this->positions.clear();
+                this->normals.clear();
+                this->colors.clear();
+                this->indices.clear();
+                this->n_vertices = 0u;
+            }
+        };
+        decoration_vertices decorations;
+        //! True if decorations (and the texts) match the last full build
+        bool decorations_valid = false;
+        //! Set by update() if only the data vertices need to be rebuilt
+        bool data_only_update = false;
+        //! Whether the build in progress reuses decorations (read by finish_async_build())
+        bool building_from_decorations = false;
+        //! The axis limits and the graph size at the last full build
+        std::array<Flt, 8> decoration_ranges = {};
+
+        std::array<Flt, 8> current_ranges() const
+        {
+            return { this->datarange_x.min, this->datarange_x.max, this->datarange_y.min,
+                     this->datarange_y.max, this->datarange_y2.min, this->datarange_y2.max,
+                     static_cast<Flt>(this->width), static_cast<Flt>(this->height) };
+        }
+
+        //! Copy the vertices from vertex v0 and index i0 onwards onto the end of decorations
+        void store_decorations (const GLuint v0, const std::size_t i0)
+        {
+            const std::size_t f0 = static_cast<std::size_t>(v0) * 3u;
+            this->decorations.positions.insert (this->decorations.positions.end(), this->vertexPositions.begin() + f0, this->vertexPositions.end());
+            this->decorations.normals.insert (this->decorations.normals.end(), this->vertexNormals.begin() + f0, this->vertexNormals.end());
+            this->decorations.colors.insert (this->decorations.colors.end(), this->vertexColors.begin() + f0, this->vertexColors.end());
+            const GLuint offset = this->decorations.n_vertices;
+            for (std::size_t i = i0; i < this->indices.size(); ++i) {
+                this->decorations.indices.push_back (this->indices[i] - v0 + offset);
+            }
+            this->decorations.n_vertices += this->idx - v0;
+        }
+
+        //! Append the stored decorations to the model's vertices
+        void append_decorations()
+        {
+            this->vertexPositions.insert (this->vertexPositions.end(), this->decorations.positions.begin(), this->decorations.positions.end());
+            this->vertexNormals.insert (this->vertexNormals.end(), this->decorations.normals.begin(), this->decorations.normals.end());
+            this->vertexColors.insert (this->vertexColors.end(), this->decorations.colors.begin(), this->decorations.colors.end());
+            for (auto i : this->decorations.indices) { this->indices.push_back (this->idx + i); }
+            this->idx += this->decorations.n_vertices;
+        }
+
         //! Compute stuff for a graph
         void initializeVertices()
         {
             // The indices index
             this->idx = 0;
+            this->building_from_decorations = this->data_only_update;
+            this->data_only_update = false;
+            if (this->building_from_decorations) {
+                // Axes, legend and texts are unchanged since the last full build
+                this->append_decorations();
+                this->drawData();
+                return;
+            }
+            this->decorations.clear();
+            this->decorations_valid = false;
             this->drawAxes();
+            this->store_decorations (0u, 0u);
             this->drawData();
+            // In an asynchronous build, the text is added on the render thread, in finish_async_build()
+            if (this->async_build_thread()) { return; }
+            this->drawTextParts();
+        }
+
+        //! The legend and the labels, which need the OpenGL context for their text
+        void drawTextParts()
+        {
+            const GLuint v0 = this->idx;
+            const std::size_t i0 = this->indices.size();
             if (this->legend == true) { this->drawLegend(); }
             this->drawTickLabels(); // from which we can store the tick label widths
             this->drawAxisLabels();
+            this->store_decorations (v0, i0);
+            this->decoration_ranges = this->current_ranges();
+            this->decorations_valid = true;
+        }
+
+        //! After an asynchronous build, replace the text
+        void finish_async_build() override
+        {
+            if (this->building_from_decorations) { return; }
+            this->clearTexts();
+            this->drawTextParts();
         }
 
         //! Is the passed in coordinate within the graph axes (in the x/y sense, ignoring z)?
@@ -1023,6 +1385,21 @@ namespace morph {
                                   << " does not match quivers size: " << quivers.size() << std::endl;
                     }
 
+                } else if (this->instanced_data) { // Regular markers, as instances of one polygon
+
+                    int n = 20;
+                    float rotation = 0.0f;
+                    marker_polygon (this->datastyles[dsi].markerstyle, n, rotation);
+                    InstancedShapeVisual<glver>* mi = this->data_instances (this->marker_instances, dsi);
+                    mi->setShape (instanced_shape::polygon, n, rotation);
+                    for (unsigned int i = coords_start; i < coords_end; ++i) {
+                        morph::vec<float> p = (*this->graphDataCoords[dsi])[i];
+                        if (this->within_axes (p)) {
+                            p[2] += this->thickness;
+                            mi->addPolygon (p, this->datastyles[dsi].markersize, this->datastyles[dsi].markercolour);
+                        }
+                    }
+
                 } else { // Regular data markers
 
                     for (unsigned int i = coords_start; i < coords_end; ++i) {
@@ -1039,6 +1416,8 @@ namespace morph {
                 // If appending markers to a dataset, need to add the line preceding the first marker
                 if (appending == true) { if (coords_start != 0) { coords_start -= 1; } }
 
+                if (this->instanced_data) { return this->drawInstancedLines (dsi, coords_start, coords_end); }
+
                 for (unsigned int i = coords_start+1; i < coords_end; ++i) {
                     // Draw tube from location -1 to location 0.
                     if (this->draw_beyond_axes == true
@@ -1103,12 +1482,86 @@ namespace morph {
             }
         }
 
+        /*!
+         * The lines of dataset dsi between coords_start and coords_end, as instances of a unit
+         * segment, with a disc at each interior point for a round join.
+         */
+        void drawInstancedLines (unsigned int dsi, unsigned int coords_start, unsigned int coords_end)
+        {
+            const morph::DatasetStyle& ds = this->datastyles[dsi];
+            const std::vector<morph::vec<float>>& c = *this->graphDataCoords[dsi];
+            InstancedShapeVisual<glver>* li = this->data_instances (this->line_instances, dsi);
+            li->setShape (instanced_shape::segment);
+            InstancedShapeVisual<glver>* ji = nullptr;
+            if (ds.markergap <= 0.0f) {
+                ji = this->data_instances (this->join_instances, dsi);
+                ji->setShape (instanced_shape::polygon, 20);
+            }
+            for (unsigned int i = coords_start + 1; i < coords_end; ++i) {
+                morph::vec<float> p0 = c[i-1];
+                morph::vec<float> p1 = c[i];
+                if (this->draw_beyond_axes == false && !(this->within_axes (p0) && this->within_axes (p1))) { continue; }
+                if (ds.markergap > 0.0f) {
+                    // Solid lines between marker points with gaps between line and marker
+                    li->addSegment (p0, p1, ds.linewidth, ds.linecolour, ds.markergap);
+                } else {
+                    li->addSegment (p0, p1, ds.linewidth, ds.linecolour);
+                    if (i > 1) { ji->addPolygon (p0, ds.linewidth, ds.linecolour); }
+                }
+            }
+        }
+
+        //! The instanced shapes for dataset dsi in one of marker/line/join_instances, made if necessary
+        InstancedShapeVisual<glver>* data_instances (std::vector<std::unique_ptr<InstancedShapeVisual<glver>>>& layer,
+                                                     const unsigned int dsi)
+        {
+            if (layer.size() <= dsi) { layer.resize (dsi + 1); }
+            if (!layer[dsi]) {
+                layer[dsi] = std::make_unique<InstancedShapeVisual<glver>>();
+                this->bindmodel (layer[dsi]);
+            }
+            return layer[dsi].get();
+        }
+
+        //! Remove all the instanced markers and lines (their buffers are kept)
+        void clear_data_instances()
+        {
+            for (auto layer : { &this->marker_instances, &this->line_instances, &this->join_instances }) {
+                for (auto& m : *layer) { if (m) { m->clear_shapes(); } }
+            }
+        }
+
+        //! Upload and draw the instanced markers and lines, in the graph's frame. Needs the context.
+        void render_data_instances()
+        {
+            for (auto layer : { &this->line_instances, &this->join_instances, &this->marker_instances }) {
+                for (auto& m : *layer) {
+                    if (!m) { continue; }
+                    // While a build runs, the instances belong to it; draw what was last uploaded
+                    if (!this->build_running()) { m->sync(); }
+                    m->setSceneMatrix (this->scenematrix);
+                    m->setViewMatrix (this->model_scaling * this->viewmatrix);
+                    m->setAlpha (this->alpha);
+                    m->render_geometry();
+                }
+            }
+        }
+
+        //! Instanced shapes for each dataset, used if instanced_data is true
+        std::vector<std::unique_ptr<InstancedShapeVisual<glver>>> marker_instances;
+        std::vector<std::unique_ptr<InstancedShapeVisual<glver>>> line_instances;
+        std::vector<std::unique_ptr<InstancedShapeVisual<glver>>> join_instances;
+
         // Defines a boolean 'true' that can be provided as arg to drawDataCommon()
         static constexpr bool appending_data = true;
 
         //! Draw markers and lines for data points that are being appended to a graph
         void drawAppendedData()
         {
+            // A dataset may have been added by append() since the last drawData()
+            if (this->coords_lengths.size() < this->graphDataCoords.size()) {
+                this->coords_lengths.resize (this->graphDataCoords.size(), 0u);
+            }
             for (unsigned int dsi = 0; dsi < this->graphDataCoords.size(); ++dsi) {
                 // Start is old end:
                 unsigned int coords_start = this->coords_lengths[dsi];
@@ -1121,6 +1574,7 @@ namespace morph {
         //! Draw all markers and lines for datasets in the graph (as stored in graphDataCoords)
         void drawData()
         {
+            this->clear_data_instances();
             unsigned int coords_start = 0;
             this->coords_lengths.resize (this->graphDataCoords.size());
             for (unsigned int dsi = 0; dsi < static_cast<unsigned int>(this->graphDataCoords.size()); ++dsi) {
@@ -1636,96 +2090,41 @@ namespace morph {
             }
         }
 
-        //! Generate vertices for a marker of the given style at location p
-        void marker (morph::vec<float>& p, const morph::DatasetStyle& style)
+        /*!
+         * The polygon for a marker style: n sides, with the first vertex at angle rotation from
+         * the +y axis. 'up' shapes have a vertex pointing up, the others a flat top.
+         */
+        static void marker_polygon (const morph::markerstyle ms, int& n, float& rotation)
         {
-            switch (style.markerstyle) {
+            bool flattop = false;
+            switch (ms) {
             case morph::markerstyle::triangle:
-            case morph::markerstyle::uptriangle:
-            {
-                this->polygonMarker (p, 3, style);
-                break;
-            }
-            case morph::markerstyle::downtriangle:
-            {
-                this->polygonFlattop (p, 3, style);
-                break;
-            }
-            case morph::markerstyle::square:
-            {
-                this->polygonFlattop (p, 4, style);
-                break;
-            }
-            case morph::markerstyle::diamond:
-            {
-                this->polygonMarker (p, 4, style);
-                break;
-            }
-            case morph::markerstyle::pentagon:
-            {
-                this->polygonFlattop (p, 5, style);
-                break;
-            }
-            case morph::markerstyle::uppentagon:
-            {
-                this->polygonMarker (p, 5, style);
-                break;
-            }
-            case morph::markerstyle::hexagon:
-            {
-                this->polygonFlattop (p, 6, style);
-                break;
-            }
-            case morph::markerstyle::uphexagon:
-            {
-                this->polygonMarker (p, 6, style);
-                break;
-            }
-            case morph::markerstyle::heptagon:
-            {
-                this->polygonFlattop (p, 7, style);
-                break;
-            }
-            case morph::markerstyle::upheptagon:
-            {
-                this->polygonMarker (p, 7, style);
-                break;
-            }
-            case morph::markerstyle::octagon:
-            {
-                this->polygonFlattop (p, 8, style);
-                break;
-            }
-            case morph::markerstyle::upoctagon:
-            {
-                this->polygonMarker (p, 8, style);
-                break;
-            }
+            case morph::markerstyle::uptriangle: { n = 3; break; }
+            case morph::markerstyle::downtriangle: { n = 3; flattop = true; break; }
+            case morph::markerstyle::square: { n = 4; flattop = true; break; }
+            case morph::markerstyle::diamond: { n = 4; break; }
+            case morph::markerstyle::pentagon: { n = 5; flattop = true; break; }
+            case morph::markerstyle::uppentagon: { n = 5; break; }
+            case morph::markerstyle::hexagon: { n = 6; flattop = true; break; }
+            case morph::markerstyle::uphexagon: { n = 6; break; }
+            case morph::markerstyle::heptagon: { n = 7; flattop = true; break; }
+            case morph::markerstyle::upheptagon: { n = 7; break; }
+            case morph::markerstyle::octagon: { n = 8; flattop = true; break; }
+            case morph::markerstyle::upoctagon: { n = 8; break; }
             case morph::markerstyle::circle:
-            default:
-            {
-                this->polygonMarker (p, 20, style);
-                break;
-            }
+            default: { n = 20; break; }
             }
+            rotation = flattop ? morph::mathconst<float>::pi / static_cast<float>(n) : 0.0f;
         }
 
-        // Create an n sided polygon with first vertex 'pointing up'
-        void polygonMarker  (morph::vec<float> p, int n, const morph::DatasetStyle& style)
-        {
-            p[2] += this->thickness;
-            this->computeFlatPoly (p, this->ux, this->uy,
-                                   style.markercolour,
-                                   style.markersize*Flt{0.5}, n);
-        }
-
-        // Create an n sided polygon with a flat edge 'pointing up'
-        void polygonFlattop (morph::vec<float> p, int n, const morph::DatasetStyle& style)
+        //! Generate vertices for a marker of the given style at location p
+        void marker (morph::vec<float> p, const morph::DatasetStyle& style)
         {
+            int n = 20;
+            float rotation = 0.0f;
+            marker_polygon (style.markerstyle, n, rotation);
             p[2] += this->thickness;
-            this->computeFlatPoly (p, this->ux, this->uy,
-                                   style.markercolour,
-                                   style.markersize*Flt{0.5}, n, morph::mathconst<float>::pi/static_cast<float>(n));
+            this->computeFlatPoly (p, this->ux, this->uy, style.markercolour, style.markersize * Flt{0.5}, n, rotation);
         }
 
         // Given the data, compute the ticks (or use the ones that client code gave us)
@@ -1927,6 +2326,21 @@ namespace morph {
         std::string ylabel2 = "y2";
         //! Whether or not to show a legend
         bool legend = true;
+        /*!
+         * If true, update() rebuilds the graph with reinit_async(), away from the thread that
+         * calls it and needing no OpenGL context there. The new graph is drawn from the frame
+         * after the build finishes.
+         */
+        bool build_async = false;
+        /*!
+         * If true, the regular markers and the solid lines of the datasets are drawn as
+         * instances of one polygon or segment (see InstancedShapeVisual) instead of being made
+         * of the graph's own triangles. Each marker or line segment then uploads 13 floats,
+         * rather than the 21 vertices of a circle marker, which suits datasets of millions of
+         * points. Lines get round joins rather than mitred ones. Bars, quivers and the legend
+         * are drawn as usual. Set before finalize().
+         */
+        bool instanced_data = false;
 
     protected:
         //! This is used to set a spacing between elements in the graph (markers and
@@ -15,10 +15,13 @@
 #include <sstream>
 #include <limits>
 #include <type_traits>
-#include <set>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 #include <morph/vec.h>
 #include <morph/vvec.h>
 #include <morph/GridFeatures.h>
+#include <morph/threadpool.h>
 
 namespace morph {
 
@@ -243,7 +246,8 @@ namespace morph {
 
         //! Set up memory and populate v_c. Called if parameters w, h, offset
         //! or order change. Does not need to change if wrap changes, as neighbour
-        //! relationships are always runtime computed.
+        //! relationships are runtime computed (or, if compute_neighbour_table() has been
+        //! called, recomputed here).
         void init()
         {
             static_assert (std::numeric_limits<I>::is_integer, "The index type I must be an integer type");
@@ -272,8 +276,60 @@ namespace morph {
 
             this->v_c.resize (this->n());
             for (I i = 0; i < this->n(); ++i) { this->v_c[i] = this->coord (i); }
+
+            if (!this->nbr.empty()) { this->compute_neighbour_table(); }
         }
 
+        /*!
+         * Precompute all the neighbour relationships into a table of 8 indices per element,
+         * after which index_ne(), index_nne() and the other neighbour functions (and so the
+         * has_ and coord_ neighbour functions) become table lookups instead of row/column
+         * arithmetic. The table costs 8 * n() indices of memory, so it is optional. Once
+         * built, init() keeps it up to date.
+         */
+        void compute_neighbour_table()
+        {
+            // Compute with the table empty, so that the index_ functions do the arithmetic
+            std::vector<I> table (8 * static_cast<std::size_t>(this->n()));
+            this->nbr.clear();
+            for (I i = 0; i < this->n(); ++i) {
+                I* t = table.data() + 8 * static_cast<std::size_t>(i);
+                t[nbr_ne] = this->index_ne (i);
+                t[nbr_nne] = this->index_nne (i);
+                t[nbr_nn] = this->index_nn (i);
+                t[nbr_nnw] = this->index_nnw (i);
+                t[nbr_nw] = this->index_nw (i);
+                t[nbr_nsw] = this->index_nsw (i);
+                t[nbr_ns] = this->index_ns (i);
+                t[nbr_nse] = this->index_nse (i);
+            }
+            this->nbr.swap (table);
+        }
+
+        //! Discard the neighbour table, returning to computed neighbour relationships
+        void clear_neighbour_table() { this->nbr.clear(); this->nbr.shrink_to_fit(); }
+
+        //! True if compute_neighbour_table() has been called
+        bool has_neighbour_table() const { return !this->nbr.empty(); }
+
+        /*!
+         * The 8 neighbours of element index from the neighbour table, in the order east,
+         * north-east, north, north-west, west, south-west, south, south-east (offsets nbr_ne
+         * to nbr_nse). A missing neighbour is std::numeric_limits<I>::max(). Requires
+         * compute_neighbour_table() to have been called and index to be < n().
+         */
+        const I* neighbours (const I index) const { return this->nbr.data() + 8 * static_cast<std::size_t>(index); }
+
+        //! Offsets of each direction in the 8 entries returned by neighbours()
+        static constexpr unsigned int nbr_ne = 0;
+        static constexpr unsigned int nbr_nne = 1;
+        static constexpr unsigned int nbr_nn = 2;
+        static constexpr unsigned int nbr_nnw = 3;
+        static constexpr unsigned int nbr_nw = 4;
+        static constexpr unsigned int nbr_nsw = 5;
+        static constexpr unsigned int nbr_ns = 6;
+        static constexpr unsigned int nbr_nse = 7;
+
         //! Indexing the grid will return a memorized vec location.
         morph::vec<C, 2> operator[] (const I index) const
         {
@@ -353,6 +409,7 @@ namespace morph {
         //! to the east, return std::numeric_limits<I>::max()
         I index_ne (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_ne); }
             I c = this->col (index);
             if (c == (w - I{1}) && (wrap == GridDomainWrap::None || wrap == GridDomainWrap::Vertical)) {
                 return std::numeric_limits<I>::max();
@@ -377,6 +434,7 @@ namespace morph {
         //! to the west, return std::numeric_limits<I>::max()
         I index_nw (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_nw); }
             I c = this->col (index);
             if (c == 0 && (wrap == GridDomainWrap::None || wrap == GridDomainWrap::Vertical)) {
                 return std::numeric_limits<I>::max();
@@ -401,6 +459,7 @@ namespace morph {
         //! to the north, return std::numeric_limits<I>::max()
         I index_nn (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_nn); }
             I r = this->row (index);
             if (order == morph::GridOrder::bottomleft_to_topright) {
 
@@ -460,6 +519,7 @@ namespace morph {
         //! to the south, return std::numeric_limits<I>::max()
         I index_ns (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_ns); }
             I r = this->row (index);
 
             if (order == morph::GridOrder::bottomleft_to_topright) {
@@ -520,6 +580,7 @@ namespace morph {
         bool has_nne (const I index) const { return has_ne (index) && has_nn (index); }
         I index_nne (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_nne); }
             I nn = this->index_nn (index);
             return nn < this->n() ? index_ne (nn) : std::numeric_limits<I>::max();
         }
@@ -533,6 +594,7 @@ namespace morph {
         bool has_nnw (const I index) const { return has_nw (index) && has_nn (index); }
         I index_nnw (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_nnw); }
             I nn = this->index_nn (index);
             return nn < this->n() ? index_nw (nn) : std::numeric_limits<I>::max();
         }
@@ -546,6 +608,7 @@ namespace morph {
         bool has_nse (const I index) const { return has_ne (index) && has_ns (index); }
         I index_nse (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_nse); }
             I ns = this->index_ns (index);
             return ns < this->n() ? index_ne (ns) : std::numeric_limits<I>::max();
         }
@@ -559,6 +622,7 @@ namespace morph {
         bool has_nsw (const I index) const { return has_nw (index) && has_ns (index); }
         I index_nsw (const I index) const
         {
+            if (!this->nbr.empty()) { return this->table_lookup (index, nbr_nsw); }
             I ns = this->index_ns (index);
             return ns < this->n() ? index_nw (ns) : std::numeric_limits<I>::max();
         }
@@ -734,6 +798,10 @@ namespace morph {
         /*!
          * Resampling function (monochrome).
          *
+         * Each Grid element gets the sum of the image pixels within 3 sigma of it, weighted by a 2D
+         * Gaussian whose sigma is the pixel spacing. Only the pixels in that window are
+         * visited, so the cost is independent of the image size.
+         *
          * \param image_data (input) The monochrome image as a vvec of floats. The image
          * is interpreted as running from bottom left to top right (matching the default
          * value of Grid::order). Thus, the very first float in the vvec is at x=0,
@@ -793,23 +861,45 @@ namespace morph {
             morph::vec<float, 2> params = 1.0f / (2.0f * dist_per_pix * dist_per_pix);
             morph::vec<float, 2> threesig = 3.0f * dist_per_pix;
 
-#pragma omp parallel for // parallel on this outer loop gives best result (5.8 s vs 7 s)
-            for (typename std::vector<float>::size_type xi = 0u; xi < this->v_c.size(); ++xi) {
-                float expr = 0.0f;
-                for (unsigned int i = 0; i < csz; ++i) {
-                    // Get x/y pixel coords:
-                    morph::vec<unsigned int, 2> idx = {(i % image_pixelsz[0]), (i / image_pixelsz[0])};
-                    // Get the coordinates of the input pixel at index idx (in target units):
-                    morph::vec<float, 2> posn = (dist_per_pix * idx) + image_offset;
-                    // Distance from input pixel to output pixel:
-                    morph::vec<float, 2> _v_c = this->v_c[xi] - posn;
-                    // Compute contributions to each Grid pixel, using 2D (elliptical) Gaussian
-                    if (_v_c < threesig) { // Testing for distance gives slight speedup
-                        expr += std::exp ( - ( (params[0] * _v_c[0] * _v_c[0]) + (params[1] * _v_c[1] * _v_c[1]) ) ) * image_data[i];
+            // The input pixels lie on a regular lattice and the Gaussian is separable, so each
+            // Grid column (and row) has a fixed window of input pixel columns (rows) within
+            // 3 sigma, and fixed weights for them. Compute these once.
+            struct window { long long first = 0; std::vector<float> wt; };
+            auto make_window = [&](const float p, const unsigned int dim) {
+                window win;
+                // Input pixel j of dimension dim is at dist_per_pix[dim] * j + image_offset[dim]
+                const float pj = (p - image_offset[dim]) / dist_per_pix[dim];
+                const long long j0 = std::max (0LL, static_cast<long long>(std::ceil (pj - 3.0f)));
+                const long long j1 = std::min (static_cast<long long>(image_pixelsz[dim]) - 1,
+                                               static_cast<long long>(std::floor (pj + 3.0f)));
+                win.first = j0;
+                for (long long j = j0; j <= j1; ++j) {
+                    const float d = p - (dist_per_pix[dim] * static_cast<float>(j) + image_offset[dim]);
+                    win.wt.push_back (std::abs (d) < threesig[dim] ? std::exp (-params[dim] * d * d) : 0.0f);
+                }
+                return win;
+            };
+            std::vector<window> colwin (this->w);
+            std::vector<window> rowwin (this->h);
+            for (I c = 0; c < this->w; ++c) { colwin[c] = make_window (static_cast<float>(this->v_c[c][0]), 0); }
+            for (I r = 0; r < this->h; ++r) { rowwin[r] = make_window (static_cast<float>(this->v_c[r * this->w][1]), 1); }
+
+            const long long gw = static_cast<long long>(this->w);
+            const long long gh = static_cast<long long>(this->h);
+            morph::parallel_for (0LL, gh, [&](long long r) {
+                const window& rw = rowwin[r];
+                for (long long c = 0; c < gw; ++c) {
+                    const window& cw = colwin[c];
+                    float expr = 0.0f;
+                    for (std::size_t b = 0; b < rw.wt.size(); ++b) {
+                        const float* row = image_data.data() + (rw.first + b) * image_pixelsz[0] + cw.first;
+                        float rowsum = 0.0f;
+                        for (std::size_t a = 0; a < cw.wt.size(); ++a) { rowsum += cw.wt[a] * row[a]; }
+                        expr += rw.wt[b] * rowsum;
                     }
+                    expr_resampled[r * gw + c] = expr;
                 }
-                expr_resampled[xi] = expr;
-            }
+            });
 
             expr_resampled /= expr_resampled.max(); // renormalise result
             return expr_resampled;
@@ -818,6 +908,11 @@ namespace morph {
         /*!
          * Returns all the indices of the grid with a given radius (radius argument) of a given (x,y) location (loc argument)
          *
+         * The element nearest to loc comes first, followed by the others in ascending index
+         * order. The circle is rasterised directly: the range of rows that it spans is
+         * computed from loc and radius, and for each row, the range of columns, so only the
+         * elements in the circle's bounding box (clipped to the grid) are tested.
+         *
          * \param loc (x,y) metric location of the center of the circle
          * \param radius radius defining the circle
          * \param inds_in_radius A vector of indices within the circle - supplied as a reference
@@ -826,36 +921,38 @@ namespace morph {
                                 const C radius,
                                 morph::vvec<I>& inds_in_radius) const
         {
-            morph::vvec<I> inds_in_circle;
-            morph::vvec<I> inds_in_previous_circle;
-            std::set<I> seen;
-
-            // Find first index (middle of circle)
-            I current_ind = this->index_lookup (loc);
-            inds_in_radius.push_back (current_ind);
-            seen.insert (current_ind);
-            inds_in_circle.push_back (current_ind);
-
-            while (!inds_in_circle.empty()) {
-
-                inds_in_previous_circle = inds_in_circle;
-                inds_in_circle.clear();
-                morph::vvec<I> nearest_neighbours;
-                this->find_nearest_neighbours (inds_in_previous_circle, nearest_neighbours);
-
-                for (auto n : nearest_neighbours) {
-                    if (!seen.count(n)) {
-                        if ((this->coord_lookup (n) - loc).length() < radius) {
-                            inds_in_circle.push_back (n);
-                        }
-                    }
-                    seen.insert(n);
-                }
-
-                if (!inds_in_circle.empty()) {
-                    inds_in_radius.concat (inds_in_circle);
+            // Find first index (middle of circle). Throws if loc is off-grid.
+            const I centre_ind = this->index_lookup (loc);
+            inds_in_radius.push_back (centre_ind);
+
+            // Work in units of columns and rows. y runs the other way for the top-left orders.
+            using ll = long long int;
+            const bool topleft = (this->order == morph::GridOrder::topleft_to_bottomright
+                                  || this->order == morph::GridOrder::topleft_to_bottomright_colmaj);
+            const double cx = static_cast<double>(loc[0] - this->offset[0]) / static_cast<double>(this->dx[0]);
+            double cy = static_cast<double>(loc[1] - this->offset[1]) / static_cast<double>(this->dx[1]);
+            if (topleft) { cy = -cy; }
+            const double rx = static_cast<double>(radius) / static_cast<double>(this->dx[0]);
+            const double ry = static_cast<double>(radius) / static_cast<double>(this->dx[1]);
+            if (!(rx > 0.0) || !(ry > 0.0)) { return; }
+
+            // The spans are widened by one element on each side, and each element in them
+            // then gets the same distance test as before, so rounding can't lose an element
+            const ll r0 = std::max (ll{0}, static_cast<ll>(std::floor (cy - ry)) - 1);
+            const ll r1 = std::min (static_cast<ll>(this->h) - 1, static_cast<ll>(std::ceil (cy + ry)) + 1);
+            const std::size_t first = inds_in_radius.size();
+            for (ll r = r0; r <= r1; ++r) {
+                const double v = (static_cast<double>(r) - cy) / ry;
+                const double half = v * v < 1.0 ? rx * std::sqrt (1.0 - v * v) : 0.0;
+                const ll c0 = std::max (ll{0}, static_cast<ll>(std::floor (cx - half)) - 1);
+                const ll c1 = std::min (static_cast<ll>(this->w) - 1, static_cast<ll>(std::ceil (cx + half)) + 1);
+                for (ll c = c0; c <= c1; ++c) {
+                    const I i = this->rowmaj() ? static_cast<I>(r * this->w + c) : static_cast<I>(c * this->h + r);
+                    if (i != centre_ind && (this->v_c[i] - loc).length() < radius) { inds_in_radius.push_back (i); }
                 }
             }
+            // Row by row gives ascending order for row-major grids; column-major needs a sort
+            if (!this->rowmaj()) { std::sort (inds_in_radius.begin() + first, inds_in_radius.end()); }
         }
 
         /*!
@@ -883,6 +980,15 @@ namespace morph {
         //! This vector structure contains the coords for this grid. Note that it is public and so
         //! acccessible by client code
         morph::vvec<morph::vec<C, 2>> v_c;
+
+    private:
+        //! The optional neighbour table, 8 entries per element (see neighbours())
+        std::vector<I> nbr;
+
+        I table_lookup (const I index, const unsigned int dir) const
+        {
+            return index < this->n() ? this->nbr[8 * static_cast<std::size_t>(index) + dir] : std::numeric_limits<I>::max();
+        }
     };
 
 } // namespace morph
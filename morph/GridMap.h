@@ -0,0 +1,676 @@
+/*!
+ * \file
+ *
+ * A precomputed interpolation from the elements of one grid to the elements of another. A
+ * GridMap is a sparse matrix, held in compressed sparse row (CSR) form, whose rows are the
+ * destination elements and whose columns are the source elements. Making it does the
+ * nearest element searches and works out the interpolation weights once; apply() then moves
+ * a field from the source grid to the destination grid with one parallel sparse
+ * matrix-vector product, as often as needed.
+ *
+ * The source may be a morph::HexGrid, a morph::CartGrid, a morph::Grid or a HEALPix grid
+ * (morph::healpix_grid). The destination is any of these, or simply a list of locations.
+ * HexGrids, CartGrids and Grids are planar, with 2D locations; the HEALPix grid's locations
+ * are unit vectors. To map between a planar grid and the sphere, transform the locations
+ * returned by GridMap::locations() with your projection and pass them to the constructor.
+ *
+ * If GridMap::save, load and initCached are required, define
+ * GRIDMAP_COMPILE_LOAD_AND_SAVE. A link to libhdf5 will be required in your program.
+ */
+#pragma once
+
+#include <morph/HexGrid.h>
+#include <morph/CartGrid.h>
+#include <morph/Grid.h>
+#include <morph/GridFeatures.h>
+#include <morph/healpix/healpix_bare.hpp>
+#include <morph/kd_tree.h>
+#include <morph/mathconst.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <morph/fnv1a.h>
+
+#ifdef GRIDMAP_COMPILE_LOAD_AND_SAVE
+# include <morph/HdfData.h>
+# include <filesystem>
+#endif
+
+#include <vector>
+#include <array>
+#include <span>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace morph {
+
+    //! How a GridMap interpolates the source grid at each destination element
+    enum class gridmap_method
+    {
+        nearest,  // The value of the nearest source element
+        linear,   // Barycentric (HexGrid), bilinear (CartGrid, Grid) or HEALPix ring interpolation
+        gaussian  // The Gaussian-weighted mean of the source elements within 3 sigma
+    };
+
+    //! A HEALPix grid with nside pixels along each side of its base pixels, its data in NEST order
+    struct healpix_grid
+    {
+        int64_t nside = 1;
+        int64_t num() const { return hp::nside2npix (this->nside); }
+    };
+
+    /*!
+     * A sparse interpolation matrix from one grid to another.
+     *
+     * A destination location that lies outside a planar source (by more than about one element
+     * spacing for the nearest and linear methods, or by more than 3 sigma from any element for
+     * the gaussian method) has no entries, and apply() sets it to zero. The linear method uses
+     * the source elements of the triangle (HexGrid) or rectangle (CartGrid, Grid) that
+     * contains the location; where some of these are missing, at the edge of the source, the
+     * weights of those that remain are renormalised.
+     *
+     * \tparam F The type of the weights
+     */
+    template <typename F = float>
+    struct GridMap
+    {
+        //! An empty map. valid() is false.
+        GridMap() = default;
+
+        /*!
+         * Make the map from the elements of src to the locations dst_locations. These are 2D
+         * for a planar source and unit vectors for a HEALPix source. sigma is the width of the
+         * gaussian method's kernel, in the units of the source (radians for HEALPix).
+         */
+        template <typename S, std::size_t N>
+        GridMap (const S& src, const std::vector<morph::vec<float, N>>& dst_locations,
+                 const gridmap_method m, const float sigma = 0.0f)
+        {
+            this->init (src, dst_locations, m, sigma);
+        }
+
+        //! Make the map from the elements of src to the elements of dst, which lie in the same space
+        template <typename S, typename D>
+        GridMap (const S& src, const D& dst, const gridmap_method m, const float sigma = 0.0f)
+        {
+            this->init (src, GridMap<F>::locations (dst), m, sigma);
+        }
+
+        //! (Re)make the map. See GridMap (const S&, const std::vector<morph::vec<float, N>>&, gridmap_method, float)
+        template <typename S, std::size_t N>
+        void init (const S& src, const std::vector<morph::vec<float, N>>& dst_locations,
+                   const gridmap_method m, const float sigma = 0.0f)
+        {
+            static_assert (N == GridMap<F>::space_dims<S>(), "GridMap: the locations must be in the source's space");
+            if (m == gridmap_method::gaussian && !(sigma > 0.0f)) {
+                throw std::runtime_error ("GridMap: The gaussian method needs sigma > 0");
+            }
+            if (dst_locations.size() >= static_cast<std::size_t>(std::numeric_limits<unsigned int>::max())) {
+                throw std::runtime_error ("GridMap: Too many destination elements");
+            }
+            this->method = m;
+            this->sigma = sigma;
+            this->build (src, dst_locations);
+        }
+
+        //! The locations of the elements of a HexGrid, in the order of its d_ vectors
+        static std::vector<morph::vec<float, 2>> locations (const morph::HexGrid& g)
+        {
+            std::vector<morph::vec<float, 2>> l (g.d_x.size());
+            for (std::size_t i = 0; i < l.size(); ++i) { l[i] = { g.d_x[i], g.d_y[i] }; }
+            return l;
+        }
+
+        //! The locations of the elements of a CartGrid, in the order of its d_ vectors
+        static std::vector<morph::vec<float, 2>> locations (const morph::CartGrid& g)
+        {
+            std::vector<morph::vec<float, 2>> l (g.d_x.size());
+            for (std::size_t i = 0; i < l.size(); ++i) { l[i] = { g.d_x[i], g.d_y[i] }; }
+            return l;
+        }
+
+        //! The locations of the elements of a Grid
+        template <typename I, typename C>
+        static std::vector<morph::vec<float, 2>> locations (const morph::Grid<I, C>& g)
+        {
+            std::vector<morph::vec<float, 2>> l (g.n());
+            for (I i = 0; i < g.n(); ++i) { l[i] = g.v_c[i].template as<float>(); }
+            return l;
+        }
+
+        //! The locations of the pixel centres of a HEALPix grid, as unit vectors, in NEST order
+        static std::vector<morph::vec<float, 3>> locations (const healpix_grid& g)
+        {
+            const hp::ring_table rt (g.nside);
+            std::vector<int64_t> pix (g.num());
+            for (int64_t p = 0; p < g.num(); ++p) { pix[p] = p; }
+            std::vector<hp::t_vec> v (pix.size());
+            hp::nest2vec (rt, pix, v);
+            std::vector<morph::vec<float, 3>> l (v.size());
+            for (std::size_t i = 0; i < l.size(); ++i) {
+                l[i] = { static_cast<float>(v[i].x), static_cast<float>(v[i].y), static_cast<float>(v[i].z) };
+            }
+            return l;
+        }
+
+        /*!
+         * Write the field in, on the source grid, to out, on the destination grid. out is
+         * resized to dst_size() if necessary (so a buffer that is reused does not allocate). in
+         * and out must not be the same vector.
+         */
+        template <typename T, typename Ai, typename Ao>
+        void apply (const std::vector<T, Ai>& in, std::vector<T, Ao>& out) const
+        {
+            if (in.size() < this->n_src) { throw std::runtime_error ("GridMap::apply: in is too small"); }
+            if (static_cast<const void*>(&in) == static_cast<const void*>(&out)) {
+                throw std::runtime_error ("GridMap::apply: in and out must differ");
+            }
+            const int nd = static_cast<int>(this->dst_size());
+            out.resize (nd);
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < nd; ++i) {
+                T acc = T{0};
+                for (unsigned int j = this->row_start[i]; j < this->row_start[i + 1]; ++j) {
+                    acc += this->weight[j] * in[this->col[j]];
+                }
+                out[i] = acc;
+            }
+        }
+
+        //! Return the field in, on the source grid, on the destination grid
+        template <typename T, typename Ai>
+        morph::vvec<T> apply (const std::vector<T, Ai>& in) const
+        {
+            morph::vvec<T> out;
+            this->apply (in, out);
+            return out;
+        }
+
+        //! False for an empty map
+        bool valid() const { return !this->row_start.empty(); }
+
+        //! The number of source elements
+        std::size_t src_size() const { return this->n_src; }
+
+        //! The number of destination elements
+        std::size_t dst_size() const { return this->row_start.empty() ? 0 : this->row_start.size() - 1; }
+
+        //! The number of non-zero entries in the matrix
+        std::size_t num_entries() const { return this->col.size(); }
+
+        //! True if destination element i takes a value from the source
+        bool covers (const std::size_t i) const { return this->row_start[i + 1] > this->row_start[i]; }
+
+        //! The source elements and weights for destination element i
+        std::pair<std::span<const unsigned int>, std::span<const F>> row (const std::size_t i) const
+        {
+            const std::size_t b = this->row_start[i];
+            const std::size_t n = this->row_start[i + 1] - b;
+            return { std::span<const unsigned int> (this->col.data() + b, n), std::span<const F> (this->weight.data() + b, n) };
+        }
+
+        gridmap_method get_method() const { return this->method; }
+        float get_sigma() const { return this->sigma; }
+
+        /*!
+         * A key for the GridMap that init (src, dst_locations, m, sigma) would make. It is a
+         * hash of the source and destination locations and the parameters.
+         */
+        template <typename S, std::size_t N>
+        static unsigned long long int cacheKey (const S& src, const std::vector<morph::vec<float, N>>& dst_locations,
+                                                const gridmap_method m, const float sigma = 0.0f)
+        {
+            // 64 bit FNV-1a, as HexGrid::cacheKey()
+            std::uint64_t h = morph::fnv1a_basis;
+            auto mix = [&h](const void* data, std::size_t n) { h = morph::fnv1a (data, n, h); };
+            const std::array<unsigned int, 4> params = { GridMap<F>::cache_format, static_cast<unsigned int>(m),
+                                                         static_cast<unsigned int>(sizeof (F)), GridMap<F>::source_tag (src) };
+            mix (params.data(), sizeof (params));
+            mix (&sigma, sizeof (sigma));
+            const auto sl = GridMap<F>::locations (src);
+            mix (sl.data(), sl.size() * sizeof (sl[0]));
+            mix (dst_locations.data(), dst_locations.size() * sizeof (dst_locations[0]));
+            return h == 0 ? 1 : h; // 0 means 'no key' to load
+        }
+
+        //! The cache file name, within \a cachedir, for a GridMap with cacheKey \a key
+        static std::string cacheName (const std::string& cachedir, const unsigned long long int key)
+        {
+            std::stringstream ss;
+            ss << cachedir << (cachedir.empty() || cachedir.back() == '/' ? "" : "/")
+               << "gridmap_" << std::hex << std::setw(16) << std::setfill('0') << key << ".h5";
+            return ss.str();
+        }
+
+        //! The version of the layout written by save()
+        static constexpr unsigned int cache_format = 1;
+
+#ifdef GRIDMAP_COMPILE_LOAD_AND_SAVE
+        //! Save the map to the HDF5 file at \a path, with the cache key \a key
+        void save (const std::string& path, const unsigned long long int key = 0) const
+        {
+            morph::HdfData data (path);
+            data.add_val ("/cache_format", GridMap<F>::cache_format);
+            data.add_val ("/cache_key", key);
+            data.add_val ("/method", static_cast<unsigned int>(this->method));
+            data.add_val ("/sigma", this->sigma);
+            data.add_val ("/n_src", static_cast<unsigned long long int>(this->n_src));
+            data.add_contained_vals ("/row_start", this->row_start);
+            data.add_contained_vals ("/col", this->col);
+            data.add_contained_vals ("/weight", this->weight);
+        }
+
+        /*!
+         * Replace this map with the one saved by save() in the file at \a path. If \a key is
+         * non-zero, the file must have been saved with the same key. Returns false, leaving
+         * the map unchanged, if the file can't be read or doesn't match.
+         */
+        bool load (const std::string& path, const unsigned long long int key = 0)
+        {
+            if (!std::filesystem::exists (path)) { return false; }
+            try {
+                morph::HdfData data (path, morph::FileAccess::ReadOnly);
+                unsigned int fmt = 0;
+                unsigned long long int filekey = 0;
+                data.read_val ("/cache_format", fmt);
+                data.read_val ("/cache_key", filekey);
+                if (fmt != GridMap<F>::cache_format || (key != 0 && filekey != key)) { return false; }
+                unsigned int m = 0;
+                float s = 0.0f;
+                unsigned long long int ns = 0;
+                std::vector<unsigned int> rs;
+                std::vector<unsigned int> c;
+                std::vector<F> w;
+                data.read_val ("/method", m);
+                data.read_val ("/sigma", s);
+                data.read_val ("/n_src", ns);
+                data.read_contained_vals ("/row_start", rs);
+                data.read_contained_vals ("/col", c);
+                data.read_contained_vals ("/weight", w);
+                if (rs.empty() || c.size() != w.size() || rs.back() != c.size()) { return false; }
+                for (std::size_t i = 1; i < rs.size(); ++i) { if (rs[i] < rs[i - 1]) { return false; } }
+                for (unsigned int j : c) { if (j >= ns) { return false; } }
+                this->method = static_cast<gridmap_method>(m);
+                this->sigma = s;
+                this->n_src = static_cast<std::size_t>(ns);
+                this->row_start.swap (rs);
+                this->col.swap (c);
+                this->weight.swap (w);
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
+
+        /*!
+         * Equivalent to init (src, dst_locations, m, sigma), except that the map is kept in
+         * a cache file in the directory \a cachedir (which may be the same directory as a
+         * HexGrid cache). If the cache holds this map it is loaded, otherwise it is made and
+         * saved for next time.
+         *
+         * \return true if the map came from the cache
+         */
+        template <typename S, std::size_t N>
+        bool initCached (const S& src, const std::vector<morph::vec<float, N>>& dst_locations,
+                         const gridmap_method m, const float sigma, const std::string& cachedir)
+        {
+            const unsigned long long int key = GridMap<F>::cacheKey (src, dst_locations, m, sigma);
+            const std::string cachefile = GridMap<F>::cacheName (cachedir, key);
+            if (this->load (cachefile, key)) { return true; }
+            this->init (src, dst_locations, m, sigma);
+            this->save (cachefile, key);
+            return false;
+        }
+
+        //! initCached() for the elements of dst, which lie in the same space as src
+        template <typename S, typename D>
+        bool initCached (const S& src, const D& dst, const gridmap_method m, const float sigma, const std::string& cachedir)
+        {
+            return this->initCached (src, GridMap<F>::locations (dst), m, sigma, cachedir);
+        }
+#endif // GRIDMAP_COMPILE_LOAD_AND_SAVE
+
+    private:
+        //! One source element and its weight
+        using entry = std::pair<unsigned int, F>;
+
+        //! The dimensionality of the locations of grid type S
+        template <typename S>
+        static constexpr std::size_t space_dims() { return std::is_same_v<S, healpix_grid> ? 3 : 2; }
+
+        //! A number for the type of the source, for cacheKey()
+        static unsigned int source_tag (const morph::HexGrid&) { return 1u; }
+        static unsigned int source_tag (const morph::CartGrid&) { return 2u; }
+        template <typename I, typename C>
+        static unsigned int source_tag (const morph::Grid<I, C>& g) { return 3u + 16u * static_cast<unsigned int>(g.get_wrap()); }
+        static unsigned int source_tag (const healpix_grid&) { return 4u; }
+
+        /*!
+         * Fill the matrix, calling row_of (location, entries) for each destination location, in
+         * parallel. Entries with zero weight are dropped.
+         */
+        template <std::size_t N, typename Fn>
+        void assemble (const std::size_t nsrc, const std::vector<morph::vec<float, N>>& dst, Fn row_of)
+        {
+            const int nd = static_cast<int>(dst.size());
+            std::vector<std::vector<entry>> rows (dst.size());
+#pragma omp parallel for schedule(dynamic, 256)
+            for (int i = 0; i < nd; ++i) { row_of (dst[i], rows[i]); }
+
+            this->n_src = nsrc;
+            this->row_start.assign (dst.size() + 1, 0u);
+            for (int i = 0; i < nd; ++i) {
+                unsigned int nz = 0;
+                for (const entry& e : rows[i]) { nz += e.second != F{0} ? 1u : 0u; }
+                this->row_start[i + 1] = this->row_start[i] + nz;
+            }
+            this->col.resize (this->row_start.back());
+            this->weight.resize (this->row_start.back());
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < nd; ++i) {
+                unsigned int j = this->row_start[i];
+                for (const entry& e : rows[i]) {
+                    if (e.second == F{0}) { continue; }
+                    this->col[j] = e.first;
+                    this->weight[j++] = e.second;
+                }
+            }
+        }
+
+        //! Append the entries of the vertices vi (-1 for missing) with weights w, renormalised over those present
+        template <std::size_t K>
+        static bool add_vertices (const std::array<int, K>& vi, const std::array<F, K>& w, std::vector<entry>& row)
+        {
+            F wsum = F{0};
+            for (std::size_t k = 0; k < K; ++k) { if (vi[k] >= 0) { wsum += w[k]; } }
+            if (!(wsum > F{0})) { return false; }
+            for (std::size_t k = 0; k < K; ++k) {
+                if (vi[k] >= 0) { row.push_back ({ static_cast<unsigned int>(vi[k]), w[k] / wsum }); }
+            }
+            return true;
+        }
+
+        /*!
+         * Build a planar map for the source locations sl with element spacing h. linear (x,
+         * row) adds the linear interpolation entries for x, returning false if it can't.
+         */
+        template <typename Fn>
+        void build_planar (const std::vector<morph::vec<float, 2>>& sl, const float h,
+                           const std::vector<morph::vec<float, 2>>& dst, Fn linear)
+        {
+            morph::kd_tree<float, 2> tree;
+            tree.build (sl);
+            const float h2 = h * h;
+            auto nearest = [&tree, h2](const morph::vec<float, 2>& x, std::vector<entry>& row) {
+                float d2 = 0.0f;
+                const unsigned int j = tree.nearest (x, &d2);
+                if (j != morph::kd_tree<float, 2>::none && d2 <= h2) { row.push_back ({ j, F{1} }); }
+            };
+            if (this->method == gridmap_method::nearest) {
+                this->assemble (sl.size(), dst, nearest);
+            } else if (this->method == gridmap_method::linear) {
+                this->assemble (sl.size(), dst, [&](const morph::vec<float, 2>& x, std::vector<entry>& row) {
+                    if (!linear (x, row)) { nearest (x, row); }
+                });
+            } else {
+                const float s = this->sigma;
+                this->assemble (sl.size(), dst, [&tree, &sl, s](const morph::vec<float, 2>& x, std::vector<entry>& row) {
+                    std::vector<unsigned int> found;
+                    tree.within (x, 3.0f * s, found);
+                    std::sort (found.begin(), found.end());
+                    GridMap<F>::add_gaussian (found, [&](unsigned int j) { return (sl[j] - x).sos(); }, s, row);
+                });
+            }
+        }
+
+        //! Append normalised Gaussian weights for the elements found, their squared distances given by dist2 (j)
+        template <typename D2>
+        static void add_gaussian (const std::vector<unsigned int>& found, D2 dist2, const float s, std::vector<entry>& row)
+        {
+            const F p = F{1} / (F{2} * s * s);
+            F wsum = F{0};
+            for (unsigned int j : found) {
+                const F w = std::exp (-p * static_cast<F>(dist2 (j)));
+                row.push_back ({ j, w });
+                wsum += w;
+            }
+            if (wsum > F{0}) { for (entry& e : row) { e.second /= wsum; } }
+        }
+
+        //! A HexGrid source. Its hex centres form a triangular lattice in the axial coordinates (ri, gi).
+        void build (const morph::HexGrid& src, const std::vector<morph::vec<float, 2>>& dst)
+        {
+            const std::size_t n = src.d_x.size();
+            int rmin = std::numeric_limits<int>::max();
+            int gmin = std::numeric_limits<int>::max();
+            int rmax = std::numeric_limits<int>::min();
+            int gmax = std::numeric_limits<int>::min();
+            for (std::size_t i = 0; i < n; ++i) {
+                rmin = std::min (rmin, src.d_ri[i]);
+                rmax = std::max (rmax, src.d_ri[i]);
+                gmin = std::min (gmin, src.d_gi[i]);
+                gmax = std::max (gmax, src.d_gi[i]);
+            }
+            const int rspan = n > 0 ? rmax - rmin + 1 : 0;
+            const int gspan = n > 0 ? gmax - gmin + 1 : 0;
+            std::vector<int> lattice (static_cast<std::size_t>(rspan) * gspan, -1);
+            for (std::size_t i = 0; i < n; ++i) {
+                lattice[(src.d_ri[i] - rmin) + static_cast<std::size_t>(src.d_gi[i] - gmin) * rspan] = static_cast<int>(i);
+            }
+            auto at = [&lattice, rmin, gmin, rspan, gspan](int r, int g) {
+                r -= rmin;
+                g -= gmin;
+                return (r < 0 || g < 0 || r >= rspan || g >= gspan) ? -1 : lattice[r + static_cast<std::size_t>(g) * rspan];
+            };
+            const float d = src.getd();
+            const float v = src.getv();
+            this->build_planar (GridMap<F>::locations (src), d, dst, [at, d, v](const morph::vec<float, 2>& x, std::vector<entry>& row) {
+                // Fractional axial coordinates (see Hex::computeLocation) and the lattice
+                // rhombus containing x, which is split into two triangles along r + g = 1
+                const float gf = x[1] / v;
+                const float rf = (x[0] - gf * d * 0.5f) / d;
+                const int r0 = static_cast<int>(std::floor (rf));
+                const int g0 = static_cast<int>(std::floor (gf));
+                const F fr = static_cast<F>(rf - r0);
+                const F fg = static_cast<F>(gf - g0);
+                if (fr + fg <= F{1}) {
+                    return GridMap<F>::add_vertices<3> ({ at (r0, g0), at (r0 + 1, g0), at (r0, g0 + 1) },
+                                                        { F{1} - fr - fg, fr, fg }, row);
+                }
+                return GridMap<F>::add_vertices<3> ({ at (r0 + 1, g0), at (r0, g0 + 1), at (r0 + 1, g0 + 1) },
+                                                    { F{1} - fg, F{1} - fr, fr + fg - F{1} }, row);
+            });
+        }
+
+        //! A CartGrid source, whose elements lie on a rectangular lattice (xi, yi)
+        void build (const morph::CartGrid& src, const std::vector<morph::vec<float, 2>>& dst)
+        {
+            const std::size_t n = src.d_x.size();
+            int xmin = std::numeric_limits<int>::max();
+            int ymin = std::numeric_limits<int>::max();
+            int xmax = std::numeric_limits<int>::min();
+            int ymax = std::numeric_limits<int>::min();
+            for (std::size_t i = 0; i < n; ++i) {
+                xmin = std::min (xmin, src.d_xi[i]);
+                xmax = std::max (xmax, src.d_xi[i]);
+                ymin = std::min (ymin, src.d_yi[i]);
+                ymax = std::max (ymax, src.d_yi[i]);
+            }
+            const int xspan = n > 0 ? xmax - xmin + 1 : 0;
+            const int yspan = n > 0 ? ymax - ymin + 1 : 0;
+            std::vector<int> lattice (static_cast<std::size_t>(xspan) * yspan, -1);
+            for (std::size_t i = 0; i < n; ++i) {
+                lattice[(src.d_xi[i] - xmin) + static_cast<std::size_t>(src.d_yi[i] - ymin) * xspan] = static_cast<int>(i);
+            }
+            auto at = [&lattice, xmin, ymin, xspan, yspan](int a, int b) {
+                a -= xmin;
+                b -= ymin;
+                return (a < 0 || b < 0 || a >= xspan || b >= yspan) ? -1 : lattice[a + static_cast<std::size_t>(b) * xspan];
+            };
+            // Rect::computeLocation puts element (xi, yi) at (d xi, v yi)
+            const float dx = src.getd();
+            const float dy = src.getv();
+            this->build_planar (GridMap<F>::locations (src), std::max (dx, dy), dst,
+                                [at, dx, dy](const morph::vec<float, 2>& x, std::vector<entry>& row) {
+                                    const float fx = x[0] / dx;
+                                    const float fy = x[1] / dy;
+                                    const int x0 = static_cast<int>(std::floor (fx));
+                                    const int y0 = static_cast<int>(std::floor (fy));
+                                    const F tx = static_cast<F>(fx - x0);
+                                    const F ty = static_cast<F>(fy - y0);
+                                    return GridMap<F>::add_vertices<4> ({ at (x0, y0), at (x0 + 1, y0), at (x0, y0 + 1), at (x0 + 1, y0 + 1) },
+                                                                        { (F{1} - tx) * (F{1} - ty), tx * (F{1} - ty), (F{1} - tx) * ty, tx * ty }, row);
+                                });
+        }
+
+        //! A Grid source, in any GridOrder and with wrapping
+        template <typename I, typename C>
+        void build (const morph::Grid<I, C>& src, const std::vector<morph::vec<float, 2>>& dst)
+        {
+            const int w = static_cast<int>(src.get_w());
+            const int h = static_cast<int>(src.get_h());
+            const morph::vec<float, 2> spacing = src.get_dx().template as<float>();
+            const morph::vec<float, 2> off = src.get_offset().template as<float>();
+            const GridOrder order = src.get_order();
+            const GridDomainWrap wrap = src.get_wrap();
+            const bool topdown = order == GridOrder::topleft_to_bottomright || order == GridOrder::topleft_to_bottomright_colmaj;
+            const bool colmaj = order == GridOrder::bottomleft_to_topright_colmaj || order == GridOrder::topleft_to_bottomright_colmaj;
+            const bool hwrap = wrap == GridDomainWrap::Horizontal || wrap == GridDomainWrap::Both;
+            const bool vwrap = wrap == GridDomainWrap::Vertical || wrap == GridDomainWrap::Both;
+            // The index of the element in column c and the r-th row counted from index 0's row (see Grid::coord)
+            auto at = [w, h, colmaj, hwrap, vwrap](int c, int r) {
+                if (hwrap) { c = ((c % w) + w) % w; }
+                if (vwrap) { r = ((r % h) + h) % h; }
+                if (c < 0 || r < 0 || c >= w || r >= h) { return -1; }
+                return colmaj ? c * h + r : r * w + c;
+            };
+            this->build_planar (GridMap<F>::locations (src), std::max (std::abs (spacing[0]), std::abs (spacing[1])), dst,
+                                [at, spacing, off, topdown](const morph::vec<float, 2>& x, std::vector<entry>& row) {
+                                    const float fc = (x[0] - off[0]) / spacing[0];
+                                    const float fr = (topdown ? off[1] - x[1] : x[1] - off[1]) / spacing[1];
+                                    const int c0 = static_cast<int>(std::floor (fc));
+                                    const int r0 = static_cast<int>(std::floor (fr));
+                                    const F tc = static_cast<F>(fc - c0);
+                                    const F tr = static_cast<F>(fr - r0);
+                                    return GridMap<F>::add_vertices<4> ({ at (c0, r0), at (c0 + 1, r0), at (c0, r0 + 1), at (c0 + 1, r0 + 1) },
+                                                                        { (F{1} - tc) * (F{1} - tr), tc * (F{1} - tr), (F{1} - tc) * tr, tc * tr }, row);
+                                });
+        }
+
+        /*!
+         * A HEALPix source. The linear method is HEALPix's own interpolation (as
+         * healpix_base::get_interpol): linear in phi between the two nearest pixels on each of
+         * the rings above and below the location, then linear in theta between the rings.
+         */
+        void build (const healpix_grid& src, const std::vector<morph::vec<float, 3>>& dst)
+        {
+            const int64_t nside = src.nside;
+            const int64_t npix = src.num();
+            const hp::ring_table rt (nside);
+            if (npix >= static_cast<int64_t>(std::numeric_limits<unsigned int>::max())) {
+                throw std::runtime_error ("GridMap: Too many HEALPix pixels");
+            }
+            if (this->method == gridmap_method::nearest) {
+                this->assemble (npix, dst, [nside](const morph::vec<float, 3>& x, std::vector<entry>& row) {
+                    const int64_t p = hp::vec2nest (nside, hp::t_vec{ x[0], x[1], x[2] });
+                    row.push_back ({ static_cast<unsigned int>(p), F{1} });
+                });
+
+            } else if (this->method == gridmap_method::linear) {
+                this->assemble (npix, dst, [&rt, nside, npix](const morph::vec<float, 3>& x, std::vector<entry>& row) {
+                    const hp::t_ang a = hp::vec2ang (hp::t_vec{ x[0], x[1], x[2] });
+                    const double z = std::cos (a.theta);
+                    // The ring (numbered from 1 at the north) at or above z, or 0 above the first ring
+                    const double az = std::abs (z);
+                    int64_t ir1 = 0;
+                    if (az <= 2.0 / 3.0) {
+                        ir1 = static_cast<int64_t>(nside * (2.0 - 1.5 * z));
+                    } else {
+                        const int64_t iring = static_cast<int64_t>(nside * std::sqrt (3.0 * (1.0 - az)));
+                        ir1 = z > 0.0 ? iring : 4 * nside - iring - 1;
+                    }
+                    const int64_t ir2 = ir1 + 1;
+                    std::array<int64_t, 4> pix = { 0, 0, 0, 0 };
+                    std::array<double, 4> wgt = { 0.0, 0.0, 0.0, 0.0 };
+                    // The two pixels of ring ir either side of phi, and their weights
+                    auto ring_pair = [&rt, &a, &pix, &wgt](const int64_t ir, const int k) {
+                        const std::size_t r = static_cast<std::size_t>(ir - 1);
+                        const int64_t nr = 4 * rt.nr[r];
+                        const double t = (a.phi - rt.phi0[r]) / rt.dphi[r];
+                        const int64_t i1 = static_cast<int64_t>(std::floor (t));
+                        const double w1 = t - i1;
+                        pix[k] = rt.startpix[r] + ((i1 % nr) + nr) % nr;
+                        pix[k + 1] = rt.startpix[r] + (((i1 + 1) % nr) + nr) % nr;
+                        wgt[k] = 1.0 - w1;
+                        wgt[k + 1] = w1;
+                    };
+                    if (ir1 > 0) { ring_pair (ir1, 0); }
+                    if (ir2 < 4 * nside) { ring_pair (ir2, 2); }
+                    if (ir1 == 0) {
+                        // Above the first ring; share the rest of the weight among its 4 pixels
+                        const double wtheta = a.theta / rt.theta[ir2 - 1];
+                        wgt[2] *= wtheta;
+                        wgt[3] *= wtheta;
+                        const double fac = (1.0 - wtheta) * 0.25;
+                        wgt = { fac, fac, wgt[2] + fac, wgt[3] + fac };
+                        pix[0] = (pix[2] + 2) & 3;
+                        pix[1] = (pix[3] + 2) & 3;
+                    } else if (ir2 == 4 * nside) {
+                        // Below the last ring
+                        const double theta1 = rt.theta[ir1 - 1];
+                        const double wtheta = (a.theta - theta1) / (morph::mathconst<double>::pi - theta1);
+                        wgt[0] *= (1.0 - wtheta);
+                        wgt[1] *= (1.0 - wtheta);
+                        const double fac = wtheta * 0.25;
+                        wgt = { wgt[0] + fac, wgt[1] + fac, fac, fac };
+                        pix[2] = ((pix[0] + 2) & 3) + npix - 4;
+                        pix[3] = ((pix[1] + 2) & 3) + npix - 4;
+                    } else {
+                        const double theta1 = rt.theta[ir1 - 1];
+                        const double wtheta = (a.theta - theta1) / (rt.theta[ir2 - 1] - theta1);
+                        wgt[0] *= (1.0 - wtheta);
+                        wgt[1] *= (1.0 - wtheta);
+                        wgt[2] *= wtheta;
+                        wgt[3] *= wtheta;
+                    }
+                    for (int k = 0; k < 4; ++k) {
+                        row.push_back ({ static_cast<unsigned int>(hp::ring2nest (nside, pix[k])), static_cast<F>(wgt[k]) });
+                    }
+                });
+
+            } else {
+                // Gaussian in the angle between the unit vectors, searching within the chord of 3 sigma
+                const std::vector<morph::vec<float, 3>> sl = GridMap<F>::locations (src);
+                morph::kd_tree<float, 3> tree;
+                tree.build (sl);
+                const float s = this->sigma;
+                const float chord = 2.0f * std::sin (0.5f * std::min (3.0f * s, morph::mathconst<float>::pi));
+                this->assemble (npix, dst, [&tree, &sl, s, chord](const morph::vec<float, 3>& x, std::vector<entry>& row) {
+                    std::vector<unsigned int> found;
+                    tree.within (x, chord, found);
+                    std::sort (found.begin(), found.end());
+                    GridMap<F>::add_gaussian (found, [&](unsigned int j) {
+                        const float ang = 2.0f * std::asin (std::min (1.0f, 0.5f * (sl[j] - x).length()));
+                        return ang * ang;
+                    }, s, row);
+                });
+            }
+        }
+
+        gridmap_method method = gridmap_method::nearest;
+        float sigma = 0.0f;
+        std::size_t n_src = 0;
+        //! The entries of destination i are col[row_start[i]] to col[row_start[i + 1] - 1]
+        std::vector<unsigned int> row_start;
+        std::vector<unsigned int> col;
+        std::vector<F> weight;
+    };
+
+} // namespace morph
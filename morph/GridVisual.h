@@ -9,6 +9,7 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <algorithm>
 #include <unordered_map>
 
 namespace morph {
@@ -73,28 +74,15 @@ namespace morph {
                 throw std::runtime_error ("grid is nullptr in reinitColours()");
             }
 
+            // In Texture mode, the colours are computed on the GPU from the data texture
+            if (this->gridVisMode == GridVisMode::Texture) {
+                this->initializeVerticesTexture (false);
+                return;
+            }
+
             std::size_t n_data = static_cast<std::size_t>(this->grid->n());
-            std::size_t n_cvertices_per_datum = 0;
             // Different gridVisModes will have generated different numbers of OpenGL colour vertices
-            switch (this->gridVisMode) {
-            case GridVisMode::Triangles:
-            {
-                n_cvertices_per_datum = 1; // initializeVertices used initializeVerticesTris
-                break;
-            }
-            case GridVisMode::Columns:
-            {
-                n_cvertices_per_datum = 13; // used initializeVerticesCols
-                break;
-            }
-            case GridVisMode::Pixels:
-            case GridVisMode::RectInterp:
-            default:
-            {
-                n_cvertices_per_datum = 5; // used initializeVerticesRectsInterpolated or initializeVerticesPixels
-                break;
-            }
-            }
+            std::size_t n_cvertices_per_datum = this->verticesPerDatum();
             if (this->vertexColors.size() < n_data * n_cvertices_per_datum * 3) {
                 throw std::runtime_error ("vertexColors is not big enough to reinitColours()");
             }
@@ -109,6 +97,128 @@ namespace morph {
             }
         }
 
+        /*!
+         * The number of colour vertices for each datum, which are vertices [i * n, (i+1) * n) for
+         * datum i. 0 in Texture mode, in which the colours come from the data texture.
+         */
+        unsigned int verticesPerDatum() const override
+        {
+            switch (this->gridVisMode) {
+            case GridVisMode::Texture: { return 0u; }
+            case GridVisMode::Triangles: { return 1u; }   // initializeVerticesTris
+            case GridVisMode::Columns: { return 13u; }    // initializeVerticesCols
+            case GridVisMode::Pixels:
+            case GridVisMode::RectInterp:
+            default: { return 5u; }                      // initializeVerticesRectsInterpolated/Pixels
+            }
+        }
+
+        //! Record that the data [first, first + count) has changed, for reinitColoursDirty()
+        void markDataDirty (const std::size_t first, const std::size_t count)
+        {
+            if (count > 0) { this->dirty_data.push_back ({ first, first + count }); }
+        }
+
+        /*!
+         * Record that the tw by th block of elements whose first element is at column x0 and row
+         * y0 has changed, for reinitColoursDirty(). Columns and rows count in the grid's index
+         * order, so element (x, y) is index y * w + x in a row-major grid and x * h + y in a
+         * column-major one.
+         */
+        void markTileDirty (const I x0, const I y0, const I tw, const I th)
+        {
+            morph::vec<I, 2> dims = this->grid->get_dims();
+            const I x1 = std::min (static_cast<I>(x0 + tw), dims[0]);
+            const I y1 = std::min (static_cast<I>(y0 + th), dims[1]);
+            if (x0 >= x1 || y0 >= y1) { return; }
+            if (this->grid->rowmaj()) {
+                for (I y = y0; y < y1; ++y) {
+                    this->markDataDirty (static_cast<std::size_t>(y) * dims[0] + x0, x1 - x0);
+                }
+            } else {
+                for (I x = x0; x < x1; ++x) {
+                    this->markDataDirty (static_cast<std::size_t>(x) * dims[1] + y0, y1 - y0);
+                }
+            }
+        }
+
+        /*!
+         * Like reinitColours(), but recolour only the data marked with markDataDirty() or
+         * markTileDirty() since the last call, and upload only their colour vertices, so that
+         * the cost is proportional to the change rather than the size of the grid. The marks are
+         * then cleared.
+         *
+         * The data are coloured with the current colourScale. If colourScale autoscales and a
+         * changed datum falls outside the range it was scaled to, the whole model is rescaled and
+         * recoloured with reinitColours(). (The range is not shrunk when extreme values change, as
+         * finding that out would need all of the data.) reinitColours() is also used if more than
+         * half of the data changed, for vector data and in Texture mode.
+         */
+        void reinitColoursDirty()
+        {
+            if (this->dirty_data.empty()) { return; }
+            std::vector<std::array<std::size_t, 2>> ranges;
+            ranges.swap (this->dirty_data);
+
+            const std::size_t n_data = static_cast<std::size_t>(this->grid->n());
+            const std::size_t ncv = this->verticesPerDatum();
+            if (ncv == 0 || this->scalarData == nullptr || this->scalarData->size() != n_data
+                || this->dcolour.size() != n_data || this->vertexColors.size() < 3u * ncv * n_data
+                || !this->colourScale.ready()) {
+                this->reinitColours();
+                return;
+            }
+
+            // Sort and merge the ranges
+            std::sort (ranges.begin(), ranges.end());
+            std::size_t m = 0;
+            for (std::size_t k = 1; k < ranges.size(); ++k) {
+                if (ranges[k][0] <= ranges[m][1]) {
+                    ranges[m][1] = std::max (ranges[m][1], ranges[k][1]);
+                } else {
+                    ranges[++m] = ranges[k];
+                }
+            }
+            ranges.resize (m + 1);
+            std::size_t n_dirty = 0;
+            for (auto& r : ranges) {
+                r[1] = std::min (r[1], n_data);
+                n_dirty += r[1] > r[0] ? r[1] - r[0] : 0;
+            }
+            if (2u * n_dirty > n_data) {
+                this->reinitColours();
+                return;
+            }
+
+            // Scale the changed data. A value the current scaling would put out of range is a rescale.
+            const morph::range<float> out_range = this->colourScale.output_range;
+            for (const auto& r : ranges) {
+                for (std::size_t i = r[0]; i < r[1]; ++i) {
+                    float d = this->colourScale.transform_one ((*this->scalarData)[i]);
+                    if (this->colourScale.do_autoscale == true && (d < out_range.min || d > out_range.max)) {
+                        this->reinitColours();
+                        return;
+                    }
+                    this->dcolour[i] = d;
+                }
+            }
+
+            // Recolour and upload vertex colours for each range
+            for (const auto& r : ranges) {
+                if (r[1] <= r[0]) { continue; }
+                for (std::size_t i = r[0]; i < r[1]; ++i) {
+                    auto c = this->cm.convert (this->dcolour[i]);
+                    std::size_t d_idx = 3 * i * ncv;
+                    for (std::size_t j = 0; j < ncv; ++j) {
+                        this->vertexColors[d_idx + 3 * j] = c[0];
+                        this->vertexColors[d_idx + 3 * j + 1] = c[1];
+                        this->vertexColors[d_idx + 3 * j + 2] = c[2];
+                    }
+                }
+                this->reinit_colour_range (r[0] * ncv, (r[1] - r[0]) * ncv);
+            }
+        }
+
     public:
         // function that draws a border around the whole image
         void drawBorder()
@@ -353,10 +463,8 @@ namespace morph {
                     throw std::runtime_error ("GridVisual error: grid size does not match scalarData size");
                 }
 
-                this->dcopy.resize (this->scalarData->size());
-                this->zScale.transform (*(this->scalarData), dcopy);
-                this->dcolour.resize (this->scalarData->size());
-                this->colourScale.transform (*(this->scalarData), dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
 
             } else if (this->vectorData != nullptr) {
 
@@ -425,6 +533,11 @@ namespace morph {
                 this->initializeVerticesPixels();
                 break;
             }
+            case GridVisMode::Texture:
+            {
+                this->initializeVerticesTexture();
+                break;
+            }
             case GridVisMode::RectInterp:
             default:
             {
@@ -469,11 +582,12 @@ namespace morph {
             this->vertexColors.resize (vcsz + add_v);
             this->vertexNormals.resize (vnsz + add_v);
 
-            I vidx = 0;
+            // Each element writes its own 3 floats, so the elements can be filled in parallel
+#pragma omp parallel for
             for (I ri = 0; ri < this->grid->n(); ++ri) {
                 std::array<float, 3> clr = this->setColour (ri);
 
-                vidx = vpsz + ri * 3;
+                I vidx = vpsz + ri * 3;
                 this->vertexPositions[vidx++] = (*this->grid)[ri][0]+centering_offset[0];
                 this->vertexPositions[vidx++] = (*this->grid)[ri][1]+centering_offset[1];
                 this->vertexPositions[vidx++] = dcopy[ri];
@@ -499,11 +613,11 @@ namespace morph {
             size_t sz_end = sz_start + add_i;
             this->indices.resize (sz_end, 0);
             I i0 = static_cast<I>(sz_start);
-            I ind_idx = i0;
             I six_ci_sz = ci_sz * I{6};
             if (this->grid->get_order() == morph::GridOrder::bottomleft_to_topright) {
+#pragma omp parallel for
                 for (I ri = 0; ri < ri_sz; ++ri) {
-                    ind_idx = i0 + ri * six_ci_sz;
+                    I ind_idx = i0 + ri * six_ci_sz;
                     for (I ci = 0; ci < ci_sz; ++ci) {
                         // Triangle 1
                         I ii = ri * dims[0] + ci;
@@ -517,8 +631,9 @@ namespace morph {
                     }
                 }
             } else if (this->grid->get_order() == morph::GridOrder::topleft_to_bottomright) {
+#pragma omp parallel for
                 for (I ri = 0; ri < ri_sz; ++ri) {
-                    ind_idx = i0 + ri * six_ci_sz;
+                    I ind_idx = i0 + ri * six_ci_sz;
                     for (I ci = 0; ci < ci_sz; ++ci) {
                         // Triangle 1
                         I ii = ri * dims[0] + ci;
@@ -532,8 +647,9 @@ namespace morph {
                     }
                 }
             } else if (this->grid->get_order() == morph::GridOrder::bottomleft_to_topright_colmaj) {
+#pragma omp parallel for
                 for (I ri = 0; ri < ri_sz; ++ri) {
-                    ind_idx = i0 + ri * six_ci_sz;
+                    I ind_idx = i0 + ri * six_ci_sz;
                     for (I ci = 0; ci < ci_sz; ++ci) {
                         // Triangle 1
                         I ii = ci * dims[1] + ri;
@@ -547,8 +663,9 @@ namespace morph {
                     }
                 }
             } else if (this->grid->get_order() == morph::GridOrder::topleft_to_bottomright_colmaj) {
+#pragma omp parallel for
                 for (I ri = 0; ri < ri_sz; ++ri) {
-                    ind_idx = i0 + ri * six_ci_sz;
+                    I ind_idx = i0 + ri * six_ci_sz;
                     for (I ci = 0; ci < ci_sz; ++ci) {
                         // Triangle 1
                         I ii = ci * dims[1] + ri;
@@ -575,66 +692,71 @@ namespace morph {
         void initializeVerticesRectsInterpolated()
         {
             morph::vec<float, 2> dx = this->grid->get_dx();
-            float hx = 0.5f * dx[0];
-            float vy = 0.5f * dx[1];
+            const float hx = 0.5f * dx[0];
+            const float vy = 0.5f * dx[1];
 
-            morph::vec<float, 2> gridline_ht = this->get_gridline_ht();
+            const morph::vec<float, 2> gridline_ht = this->get_gridline_ht();
 
             this->idx = 0;
             this->setupScaling();
 
-            float datumC = 0.0f;   // datum at the centre
-            float datumNE = 0.0f;  // datum at the hex to the east.
-            float datumNNE = 0.0f;
-            float datumNN = 0.0f;
-            float datumNNW = 0.0f;
-            float datumNW = 0.0f;
-            float datumNSW = 0.0f;
-            float datumNS = 0.0f;
-            float datumNSE = 0.0f;
-
-            float datum = 0.0f;
-
-            morph::vec<float> vtx_0, vtx_1, vtx_2;
-
             // Thickness of spacing for selected pixels
             const float selth_x = this->options.test (gridvisual_flags::selected_pix_thickness_fixed) ? this->selected_pix_thickness : dx[0] * this->selected_pix_thickness;
             const float selth_y = this->options.test (gridvisual_flags::selected_pix_thickness_fixed) ? this->selected_pix_thickness : dx[1] * this->selected_pix_thickness;
-            float sx = 0.0f;
-            float sy = 0.0f;
-
+            const bool showselected = this->options.test (gridvisual_flags::showselectedpixborder);
+
+            // Each rect has exactly 5 vertices (15 floats each of positions, normals and colours)
+            // and 12 indices, so allocate all of them now and fill each rect's ranges in parallel.
+            const std::size_t n_el = static_cast<std::size_t>(this->grid->n());
+            const std::size_t vp0 = this->vertexPositions.size();
+            const std::size_t vn0 = this->vertexNormals.size();
+            const std::size_t vc0 = this->vertexColors.size();
+            const std::size_t i0 = this->indices.size();
+            const GLuint idx0 = this->idx;
+            this->vertexPositions.resize (vp0 + 15u * n_el);
+            this->vertexNormals.resize (vn0 + 15u * n_el);
+            this->vertexColors.resize (vc0 + 15u * n_el);
+            this->indices.resize (i0 + 12u * n_el);
+
+#pragma omp parallel for
             for (I ri = 0; ri < this->grid->n(); ++ri) {
 
-                if (this->options.test (gridvisual_flags::showselectedpixborder) == true) {
-                    if (this->selected_pix.contains(ri)) {
-                        sx = selth_x;
-                        sy = selth_y;
-                    } else { // ri is not in selected_pix
-                        sx = 0.0f;
-                        sy = 0.0f;
-                    }
-                } // else sx = sy = 0
+                float sx = 0.0f;
+                float sy = 0.0f;
+                if (showselected && this->selected_pix.contains(ri)) {
+                    sx = selth_x;
+                    sy = selth_y;
+                }
 
                 // Use the linear scaled copy of the data, dcopy.
-                datumC  = dcopy[ri];
-                datumNE =  this->grid->has_ne(ri)  ? dcopy[this->grid->index_ne(ri)] : datumC;
-                datumNN =  this->grid->has_nn(ri)  ? dcopy[this->grid->index_nn(ri)] : datumC;
-                datumNW =  this->grid->has_nw(ri)  ? dcopy[this->grid->index_nw(ri)] : datumC;
-                datumNS =  this->grid->has_ns(ri)  ? dcopy[this->grid->index_ns(ri)] : datumC;
-                datumNNE = this->grid->has_nne(ri) ? dcopy[this->grid->index_nne(ri)] : datumC;
-                datumNNW = this->grid->has_nnw(ri) ? dcopy[this->grid->index_nnw(ri)] : datumC;
-                datumNSW = this->grid->has_nsw(ri) ? dcopy[this->grid->index_nsw(ri)] : datumC;
-                datumNSE = this->grid->has_nse(ri) ? dcopy[this->grid->index_nse(ri)] : datumC;
+                const float datumC  = dcopy[ri];
+                const float datumNE =  this->grid->has_ne(ri)  ? dcopy[this->grid->index_ne(ri)] : datumC;
+                const float datumNN =  this->grid->has_nn(ri)  ? dcopy[this->grid->index_nn(ri)] : datumC;
+                const float datumNW =  this->grid->has_nw(ri)  ? dcopy[this->grid->index_nw(ri)] : datumC;
+                const float datumNS =  this->grid->has_ns(ri)  ? dcopy[this->grid->index_ns(ri)] : datumC;
+                const float datumNNE = this->grid->has_nne(ri) ? dcopy[this->grid->index_nne(ri)] : datumC;
+                const float datumNNW = this->grid->has_nnw(ri) ? dcopy[this->grid->index_nnw(ri)] : datumC;
+                const float datumNSW = this->grid->has_nsw(ri) ? dcopy[this->grid->index_nsw(ri)] : datumC;
+                const float datumNSE = this->grid->has_nse(ri) ? dcopy[this->grid->index_nse(ri)] : datumC;
+
+                float datum = 0.0f;
 
                 // Use a single colour for each rect, even though rectangle's z positions are
                 // interpolated. Do the _colour_ scaling:
                 std::array<float, 3> clr = this->setColour (ri);
 
-                // First push the 5 positions of the triangle vertices, starting with the centre
-                // Use the centre position as the first location for finding the normal vector
-                vtx_0 = { (*this->grid)[ri][0] + centering_offset[0], (*this->grid)[ri][1] + centering_offset[1], datumC };
-                this->vertex_push (vtx_0, this->vertexPositions);
+                // Where this rect's data go
+                const std::size_t el = static_cast<std::size_t>(ri);
+                const std::size_t vp = vp0 + 15u * el;
+                const std::size_t vn = vn0 + 15u * el;
+                const std::size_t vc = vc0 + 15u * el;
+                const std::size_t ii = i0 + 12u * el;
+                const GLuint v0 = idx0 + static_cast<GLuint>(5u * el);
 
+                // First set the 5 positions of the triangle vertices, starting with the centre
+                // Use the centre position as the first location for finding the normal vector
+                morph::vec<float> vtx_0 = { (*this->grid)[ri][0] + centering_offset[0], (*this->grid)[ri][1] + centering_offset[1], datumC };
+                this->vertex_set (vtx_0, this->vertexPositions, vp);
 
                 // NE vertex
                 // Compute mean of this->data[ri] and N, NE and E elements
@@ -649,8 +771,8 @@ namespace morph {
                 } else {
                     datum = datumC;
                 }
-                vtx_1 = { (*this->grid)[ri][0] + hx + centering_offset[0] - gridline_ht[0] - sx, (*this->grid)[ri][1] + vy + centering_offset[1] - gridline_ht[1] - sy, datum };
-                this->vertex_push (vtx_1, this->vertexPositions);
+                morph::vec<float> vtx_1 = { (*this->grid)[ri][0] + hx + centering_offset[0] - gridline_ht[0] - sx, (*this->grid)[ri][1] + vy + centering_offset[1] - gridline_ht[1] - sy, datum };
+                this->vertex_set (vtx_1, this->vertexPositions, vp + 3);
 
                 // SE vertex
                 if (this->grid->has_ns(ri) && this->grid->has_ne(ri) && this->grid->has_nse(ri)) {
@@ -664,9 +786,8 @@ namespace morph {
                 } else {
                     datum = datumC;
                 }
-                vtx_2 = {{(*this->grid)[ri][0] + hx + centering_offset[0] - gridline_ht[0] - sx, (*this->grid)[ri][1] - vy + centering_offset[1] + gridline_ht[1] + sy, datum}};
-                this->vertex_push (vtx_2, this->vertexPositions);
-
+                morph::vec<float> vtx_2 = {{(*this->grid)[ri][0] + hx + centering_offset[0] - gridline_ht[0] - sx, (*this->grid)[ri][1] - vy + centering_offset[1] + gridline_ht[1] + sy, datum}};
+                this->vertex_set (vtx_2, this->vertexPositions, vp + 6);
 
                 // SW vertex
                 if (this->grid->has_ns(ri) && this->grid->has_nw(ri) && this->grid->has_nsw(ri)) {
@@ -679,7 +800,7 @@ namespace morph {
                     datum = datumC;
                 }
                 // vtx_3
-                this->vertex_push ((*this->grid)[ri][0] - hx + centering_offset[0] + gridline_ht[0] + sx, (*this->grid)[ri][1] - vy + centering_offset[1] + gridline_ht[1] + sy, datum, this->vertexPositions);
+                this->vertex_set (morph::vec<float>{ (*this->grid)[ri][0] - hx + centering_offset[0] + gridline_ht[0] + sx, (*this->grid)[ri][1] - vy + centering_offset[1] + gridline_ht[1] + sy, datum }, this->vertexPositions, vp + 9);
 
                 // NW vertex
                 if (this->grid->has_nn(ri) && this->grid->has_nw(ri) && this->grid->has_nnw(ri)) {
@@ -692,7 +813,7 @@ namespace morph {
                     datum = datumC;
                 }
                 // vtx_4
-                this->vertex_push ((*this->grid)[ri][0] - hx + centering_offset[0] + gridline_ht[0] + sx, (*this->grid)[ri][1] + vy + centering_offset[1] - gridline_ht[1] - sy, datum, this->vertexPositions);
+                this->vertex_set (morph::vec<float>{ (*this->grid)[ri][0] - hx + centering_offset[0] + gridline_ht[0] + sx, (*this->grid)[ri][1] + vy + centering_offset[1] - gridline_ht[1] - sy, datum }, this->vertexPositions, vp + 12);
 
                 // From vtx_0,1,2 compute normal. This sets the correct normal, but note that there
                 // is only one 'layer' of vertices; the back of the GridVisual will be coloured the
@@ -702,38 +823,30 @@ namespace morph {
                 morph::vec<float> plane2 = vtx_2 - vtx_0;
                 morph::vec<float> vnorm = plane2.cross (plane1);
                 vnorm.renormalize();
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-
-                // Five vertices with the same colour
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
-                this->vertex_push (clr, this->vertexColors);
+                // Five vertices with the same normal and the same colour
+                for (std::size_t v = 0; v < 15u; v += 3u) {
+                    this->vertex_set (vnorm, this->vertexNormals, vn + v);
+                    this->vertex_set (clr, this->vertexColors, vc + v);
+                }
 
                 // Define indices now to produce the 4 triangles in the pixel
-                this->indices.push_back (this->idx+1);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+2);
-
-                this->indices.push_back (this->idx+2);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+3);
+                this->indices[ii] = v0 + 1;
+                this->indices[ii + 1] = v0;
+                this->indices[ii + 2] = v0 + 2;
 
-                this->indices.push_back (this->idx+3);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+4);
+                this->indices[ii + 3] = v0 + 2;
+                this->indices[ii + 4] = v0;
+                this->indices[ii + 5] = v0 + 3;
 
-                this->indices.push_back (this->idx+4);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+1);
+                this->indices[ii + 6] = v0 + 3;
+                this->indices[ii + 7] = v0;
+                this->indices[ii + 8] = v0 + 4;
 
-                this->idx += 5; // 5 vertices (each of 3 floats for x/y/z), 15 indices.
+                this->indices[ii + 9] = v0 + 4;
+                this->indices[ii + 10] = v0;
+                this->indices[ii + 11] = v0 + 1;
             }
+            this->idx += static_cast<GLuint>(5u * n_el); // 5 vertices (each of 3 floats for x/y/z), 12 indices per rect.
         }
 
         void initializeVerticesCols()
@@ -915,6 +1028,131 @@ namespace morph {
             }
         }
 
+        /*!
+         * Draw the grid as a single flat rectangle. Its colours are computed on the GPU: the data
+         * are uploaded as a float texture (see VisualModel::data_tex) which the fragment shader
+         * scales with colourScale and looks up in a table sampled from the colour map. There are
+         * only 4 vertices however large the grid, and updating the data is one texture upload.
+         *
+         * Only scalarData with a one dimensional colour map and a linear colourScale can be drawn
+         * like this. zScale is not applied. If geometry is false, only the texture data (and
+         * colour scaling) are updated.
+         */
+        void initializeVerticesTexture (const bool geometry = true)
+        {
+            if (this->grid == nullptr) {
+                throw std::runtime_error ("GridVisual error: grid is a nullptr");
+            }
+            if (this->scalarData == nullptr) {
+                throw std::runtime_error ("GridVisual: gridVisMode == Texture requires scalarData");
+            }
+            if (this->scalarData->size() != static_cast<std::size_t>(this->grid->n())) {
+                throw std::runtime_error ("GridVisual error: grid size does not match scalarData size");
+            }
+            if (this->cm.numDatums() != 1) {
+                throw std::runtime_error ("GridVisual: gridVisMode == Texture requires a one dimensional colour map");
+            }
+            if (this->colourScale.getType() != morph::scaling_function::Linear) {
+                throw std::runtime_error ("GridVisual: gridVisMode == Texture requires a linear colourScale");
+            }
+            if (!this->colourScale.ready()) {
+                if (this->colourScale.do_autoscale == false) {
+                    throw std::runtime_error ("GridVisual: colourScale params are not set and do_autoscale is false");
+                }
+                if (this->scalarData->contiguous()) {
+                    this->colourScale.compute_scaling_from_data (this->scalarData->span());
+                } else {
+                    this->colourScale.compute_scaling_from_data (*this->scalarData);
+                }
+            }
+            this->data_tex_scale = { this->colourScale.getParams(0), this->colourScale.getParams(1) };
+            // Contiguous float data is uploaded directly; anything else is packed into tex_data
+            if (!std::is_same<std::decay_t<T>, float>::value || !this->scalarData->contiguous()) {
+                this->tex_data.resize (this->scalarData->size());
+                for (std::size_t i = 0; i < this->tex_data.size(); ++i) {
+                    this->tex_data[i] = static_cast<float>((*this->scalarData)[i]);
+                }
+            }
+            // The upload happens in render_geometry, when the GL context is certain to be current
+            this->data_tex_dirty = true;
+
+            if (geometry == false) { return; }
+
+            this->idx = 0;
+            morph::vec<float, 2> dx = this->grid->get_dx();
+            morph::vec<float, 4> ext = this->grid->extents(); // {xmin, xmax, ymin, ymax}
+            float left  = ext[0] - 0.5f * dx[0] + this->centering_offset[0];
+            float right = ext[1] + 0.5f * dx[0] + this->centering_offset[0];
+            float bot   = ext[2] - 0.5f * dx[1] + this->centering_offset[1];
+            float top   = ext[3] + 0.5f * dx[1] + this->centering_offset[1];
+
+            // Texture coordinates of the corners BL, BR, TR, TL. Texture rows are contiguous runs
+            // of data, with the first datum at texture coordinate (0,0).
+            std::array<morph::vec<float, 2>, 4> uv;
+            switch (this->grid->get_order()) {
+            case morph::GridOrder::bottomleft_to_topright:
+                uv = { morph::vec<float, 2>{0, 0}, {1, 0}, {1, 1}, {0, 1} };
+                break;
+            case morph::GridOrder::topleft_to_bottomright:
+                uv = { morph::vec<float, 2>{0, 1}, {1, 1}, {1, 0}, {0, 0} };
+                break;
+            case morph::GridOrder::bottomleft_to_topright_colmaj:
+                uv = { morph::vec<float, 2>{0, 0}, {0, 1}, {1, 1}, {1, 0} };
+                break;
+            case morph::GridOrder::topleft_to_bottomright_colmaj:
+                uv = { morph::vec<float, 2>{1, 0}, {1, 1}, {0, 1}, {0, 0} };
+                break;
+            default:
+                throw std::runtime_error ("morph::GridVisual: Unhandled morph::GridOrder");
+            }
+
+            this->vertex_push (left, bot, 0.0f, this->vertexPositions);
+            this->vertex_push (right, bot, 0.0f, this->vertexPositions);
+            this->vertex_push (right, top, 0.0f, this->vertexPositions);
+            this->vertex_push (left, top, 0.0f, this->vertexPositions);
+            for (unsigned int i = 0; i < 4; ++i) {
+                this->vertex_push (this->uz, this->vertexNormals);
+                // A negative blue component tells the shader to colour from the data texture
+                this->vertex_push (uv[i][0], uv[i][1], -1.0f, this->vertexColors);
+            }
+            this->indices.push_back (this->idx);
+            this->indices.push_back (this->idx + 1);
+            this->indices.push_back (this->idx + 2);
+            this->indices.push_back (this->idx);
+            this->indices.push_back (this->idx + 2);
+            this->indices.push_back (this->idx + 3);
+            this->idx += 4;
+        }
+
+        //! True if the data texture is waiting to be uploaded by render_geometry()
+        bool render_pending() const override
+        {
+            return (this->gridVisMode == GridVisMode::Texture && this->data_tex_dirty && this->hide == false)
+            || VisualDataModel<T, glver>::render_pending();
+        }
+
+        //! In Texture mode, upload the data texture if it has changed, then draw
+        void render_geometry() override
+        {
+            if (this->gridVisMode == GridVisMode::Texture && this->data_tex_dirty && this->hide == false && !this->build_running()) {
+                morph::vec<I, 2> dims = this->grid->get_dims();
+                bool rowmaj = this->grid->rowmaj();
+                unsigned int tw = static_cast<unsigned int>(rowmaj ? dims[0] : dims[1]);
+                unsigned int th = static_cast<unsigned int>(rowmaj ? dims[1] : dims[0]);
+                if constexpr (std::is_same<std::decay_t<T>, float>::value) {
+                    if (this->scalarData->contiguous()) {
+                        this->upload_data_texture (this->scalarData->data(), tw, th);
+                    } else {
+                        this->upload_data_texture (this->tex_data.data(), tw, th);
+                    }
+                } else {
+                    this->upload_data_texture (this->tex_data.data(), tw, th);
+                }
+                this->data_tex_dirty = false;
+            }
+            VisualDataModel<T, glver>::render_geometry();
+        }
+
         //! Floating pixels
         void initializeVerticesPixels()
         {
@@ -1154,8 +1392,7 @@ namespace morph {
         void reinitColoursScalar (const std::size_t n_data, const std::size_t n_cvertices_per_datum)
         {
             if (this->colourScale.do_autoscale == true) { this->colourScale.reset(); }
-            this->dcolour.resize (this->scalarData->size());
-            this->colourScale.transform (*(this->scalarData), dcolour);
+            this->transformScalarData (this->colourScale, this->dcolour);
 
             // Replace elements of vertexColors
             for (std::size_t i = 0u; i < n_data; ++i) {
@@ -1223,6 +1460,9 @@ namespace morph {
             return clr;
         }
 
+        //! The data ranges [first, end) marked by markDataDirty() and markTileDirty()
+        std::vector<std::array<std::size_t, 2>> dirty_data;
+
         //! The morph::Grid<> to visualize
         const morph::Grid<I, C>* grid;
 
@@ -1232,6 +1472,10 @@ namespace morph {
         std::vector<float> dcolour;
         std::vector<float> dcolour2;
         std::vector<float> dcolour3;
+        //! The data, as floats, for the data texture in Texture mode (unused if T is float)
+        std::vector<float> tex_data;
+        //! Set when the data texture needs to be uploaded again
+        bool data_tex_dirty = false;
 
         // A centering offset to make sure that the grid is centred on
         // this->mv_offset. This is computed so that you *add* centering_offset to each
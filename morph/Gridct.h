@@ -20,6 +20,9 @@
 #include <morph/vec.h>
 #include <morph/vvec.h>
 #include <morph/GridFeatures.h>
+#include <morph/stencil.h>
+#include <array>
+#include <vector>
 
 namespace morph {
 
@@ -101,6 +104,46 @@ namespace morph {
         constexpr GridDomainWrap get_wrap() const { return wrap; }
         constexpr GridOrder get_order() const { return order; }
 
+        //! The index offset to the next row north
+        static constexpr long long north = order == morph::GridOrder::bottomleft_to_topright
+                                           ? static_cast<long long>(w) : -static_cast<long long>(w);
+
+        /*!
+         * Index offsets to the 8 neighbours of an element that is not on an edge of the
+         * grid, in the order ne, nne, nn, nnw, nw, nsw, ns, nse. Where interior(index) is
+         * true, index + nbr_offset[k] is the neighbour, with no need for the wrap and
+         * bounds tests that index_ne() and friends make.
+         */
+        static constexpr std::array<long long, 8> nbr_offset = { 1, north + 1, north, north - 1, -1, -north - 1, -north, -north + 1 };
+
+        //! True if the element at index is at least radius elements from every edge
+        static constexpr bool interior (const I index, const I radius = 1)
+        {
+            const I c = index % w;
+            const I r = index / w;
+            return index < n && c >= radius && c + radius < w && r >= radius && r + radius < h;
+        }
+
+        //! The layout of the elements, from which morph::apply_stencil() computes the tap
+        //! offsets of a stencil at compile time
+        static constexpr stencil_detail::rect_layout stencil_layout = stencil_detail::make_layout (w, h, wrap, order);
+
+        /*!
+         * Apply the stencil S to the fields, calling update (i, sums) for every element i (see
+         * morph::apply_stencil_fused()). The interior of the grid is processed with
+         * compile-time strides and an unrolled sum over the taps, and only the strips within
+         * the stencil's radius of an edge take the slow path that tests for wrapping.
+         */
+        template <auto S, typename F, typename... V>
+        void apply_stencil_fused (F update, const V&... fields) const { morph::apply_stencil_fused<S> (*this, update, fields...); }
+
+        //! Apply the stencil S to in, writing scale times the stencil sums into out
+        template <auto S, typename T>
+        void apply_stencil (const std::vector<T>& in, std::vector<T>& out, const T scale = T{1}) const
+        {
+            morph::apply_stencil<S> (*this, in, out, scale);
+        }
+
         //! Constructor only required to populate v_x/v_y
         Gridct()
         {
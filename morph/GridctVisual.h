@@ -94,10 +94,8 @@ namespace morph {
             this->idx = 0;
 
             if (this->scalarData != nullptr) {
-                this->dcopy.resize (this->scalarData->size());
-                this->zScale.transform (*(this->scalarData), dcopy);
-                this->dcolour.resize (this->scalarData->size());
-                this->colourScale.transform (*(this->scalarData), dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
             } else if (this->vectorData != nullptr) {
                 this->dcopy.resize (this->vectorData->size());
                 this->dcolour.resize (this->vectorData->size());
@@ -119,6 +117,10 @@ namespace morph {
                 }
             }
 
+            this->vertexPositions.reserve (3u * this->grid->n);
+            this->vertexNormals.reserve (3u * this->grid->n);
+            this->vertexColors.reserve (3u * this->grid->n);
+
             for (unsigned int ri = 0; ri < this->grid->n; ++ri) {
                 std::array<float, 3> clr = this->setColour (ri);
                 this->vertex_push ((*this->grid)[ri][0]+centering_offset[0],
@@ -127,38 +129,42 @@ namespace morph {
                 this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
             }
 
-            // Build indices row by row.
-            auto dims = this->grid->get_dims();
-            if (this->grid->get_order() == morph::GridOrder::bottomleft_to_topright) {
-                for (unsigned int ri = 0; ri < dims[1]-1; ++ri) {
-                    for (unsigned int ci = 0; ci < dims[0]-1; ++ci) {
-                        // Triangle 1
-                        unsigned int ii = ri * dims[0] + ci;
-                        this->indices.push_back (ii);
-                        this->indices.push_back (ii + dims[0] + 1); // NNE
-                        this->indices.push_back (ii + 1);           // NE
-                        // Triangle 2
-                        this->indices.push_back (ii);
-                        this->indices.push_back (ii + dims[0]);     // NN
-                        this->indices.push_back (ii + dims[0] + 1); // NNE
+            // Build indices row by row, or copy them from the table made at compile time
+            if constexpr (rodata_indices && tri_indices_known) {
+                this->indices.insert (this->indices.end(), tri_indices.begin(), tri_indices.end());
+            } else {
+                auto dims = this->grid->get_dims();
+                if (this->grid->get_order() == morph::GridOrder::bottomleft_to_topright) {
+                    for (unsigned int ri = 0; ri < dims[1]-1; ++ri) {
+                        for (unsigned int ci = 0; ci < dims[0]-1; ++ci) {
+                            // Triangle 1
+                            unsigned int ii = ri * dims[0] + ci;
+                            this->indices.push_back (ii);
+                            this->indices.push_back (ii + dims[0] + 1); // NNE
+                            this->indices.push_back (ii + 1);           // NE
+                            // Triangle 2
+                            this->indices.push_back (ii);
+                            this->indices.push_back (ii + dims[0]);     // NN
+                            this->indices.push_back (ii + dims[0] + 1); // NNE
+                        }
                     }
-                }
-            } else if (this->grid->get_order() == morph::GridOrder::topleft_to_bottomright) {
-                for (unsigned int ri = 0; ri < dims[1]-1; ++ri) {
-                    for (unsigned int ci = 0; ci < dims[0]-1; ++ci) {
-                        // Triangle 1
-                        unsigned int ii = ri * dims[0] + ci;
-                        this->indices.push_back (ii);
-                        this->indices.push_back (ii + 1);
-                        this->indices.push_back (ii + dims[0] + 1); // NSE
-                        // Triangle 2
-                        this->indices.push_back (ii);
-                        this->indices.push_back (ii + dims[0] + 1); // NSE
-                        this->indices.push_back (ii + dims[0]);     // NS
+                } else if (this->grid->get_order() == morph::GridOrder::topleft_to_bottomright) {
+                    for (unsigned int ri = 0; ri < dims[1]-1; ++ri) {
+                        for (unsigned int ci = 0; ci < dims[0]-1; ++ci) {
+                            // Triangle 1
+                            unsigned int ii = ri * dims[0] + ci;
+                            this->indices.push_back (ii);
+                            this->indices.push_back (ii + 1);
+                            this->indices.push_back (ii + dims[0] + 1); // NSE
+                            // Triangle 2
+                            this->indices.push_back (ii);
+                            this->indices.push_back (ii + dims[0] + 1); // NSE
+                            this->indices.push_back (ii + dims[0]);     // NS
+                        }
                     }
+                } else {
+                    throw std::runtime_error ("morph::GridctVisual: Unhandled morph::GridOrder");
                 }
-            } else {
-                throw std::runtime_error ("morph::GridctVisual: Unhandled morph::GridOrder");
             }
 
             this->idx += this->grid->n;
@@ -175,10 +181,8 @@ namespace morph {
             this->idx = 0;
 
             if (this->scalarData != nullptr) {
-                this->dcopy.resize (this->scalarData->size());
-                this->zScale.transform (*(this->scalarData), dcopy);
-                this->dcolour.resize (this->scalarData->size());
-                this->colourScale.transform (*(this->scalarData), dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
             } else if (this->vectorData != nullptr) {
                 this->dcopy.resize (this->vectorData->size());
                 this->dcolour.resize (this->vectorData->size());
@@ -220,6 +224,11 @@ namespace morph {
 
             morph::vec<float> vtx_0, vtx_1, vtx_2;
 
+            this->vertexPositions.reserve (15u * this->grid->n);
+            this->vertexNormals.reserve (15u * this->grid->n);
+            this->vertexColors.reserve (15u * this->grid->n);
+            this->indices.reserve (12u * this->grid->n);
+
             for (I ri = 0; ri < this->grid->n; ++ri) {
 
                 // Use the linear scaled copy of the data, dcopy.
@@ -326,24 +335,31 @@ namespace morph {
                 this->vertex_push (clr, this->vertexColors);
                 this->vertex_push (clr, this->vertexColors);
 
-                // Define indices now to produce the 4 triangles in the hex
-                this->indices.push_back (this->idx+1);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+2);
+                if constexpr (!rodata_indices) {
+                    // Define indices now to produce the 4 triangles in the hex
+                    this->indices.push_back (this->idx+1);
+                    this->indices.push_back (this->idx);
+                    this->indices.push_back (this->idx+2);
 
-                this->indices.push_back (this->idx+2);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+3);
+                    this->indices.push_back (this->idx+2);
+                    this->indices.push_back (this->idx);
+                    this->indices.push_back (this->idx+3);
 
-                this->indices.push_back (this->idx+3);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+4);
+                    this->indices.push_back (this->idx+3);
+                    this->indices.push_back (this->idx);
+                    this->indices.push_back (this->idx+4);
 
-                this->indices.push_back (this->idx+4);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+1);
+                    this->indices.push_back (this->idx+4);
+                    this->indices.push_back (this->idx);
+                    this->indices.push_back (this->idx+1);
+                }
 
-                this->idx += 5; // 5 vertices (each of 3 floats for x/y/z), 15 indices.
+                this->idx += 5; // 5 vertices (each of 3 floats for x/y/z), 12 indices.
+            }
+
+            // The indices of every rect, from the table made at compile time
+            if constexpr (rodata_indices) {
+                this->indices.insert (this->indices.end(), rect_indices.begin(), rect_indices.end());
             }
         }
 
@@ -367,6 +383,68 @@ namespace morph {
         float border_thickness_fixed = 0.0f;
 
     protected:
+        /*!
+         * If true, the indices of both modes are copied from tables computed at compile time
+         * from w, h and order (tri_indices and rect_indices), which the compiler places in
+         * read-only data, rather than built element by element. Grids of more than 4096
+         * elements build their indices at runtime, so as not to exceed the compilers' limits on
+         * constant evaluation (or bloat the binary).
+         */
+        static constexpr bool rodata_indices = static_cast<std::size_t>(w) * static_cast<std::size_t>(h) <= 4096u;
+
+        //! True if order is one for which initializeVerticesTris() can triangulate the grid
+        static constexpr bool tri_indices_known = order == morph::GridOrder::bottomleft_to_topright
+                                                  || order == morph::GridOrder::topleft_to_bottomright;
+
+        //! The number of indices in GridVisMode::Triangles: two triangles for each square of
+        //! four neighbouring elements
+        static constexpr std::size_t n_tri_indices = w > 1 && h > 1 ? 6u * (w - 1) * (h - 1) : 0u;
+
+        //! Compute the indices of GridVisMode::Triangles, as initializeVerticesTris() would
+        static constexpr std::array<GLuint, n_tri_indices> make_tri_indices()
+        {
+            std::array<GLuint, n_tri_indices> ind = {};
+            std::size_t k = 0u;
+            const GLuint gw = static_cast<GLuint>(w);
+            for (GLuint ri = 0; ri + 1u < static_cast<GLuint>(h); ++ri) {
+                for (GLuint ci = 0; ci + 1u < gw; ++ci) {
+                    const GLuint ii = ri * gw + ci;
+                    if constexpr (order == morph::GridOrder::bottomleft_to_topright) {
+                        ind[k++] = ii;
+                        ind[k++] = ii + gw + 1u; // NNE
+                        ind[k++] = ii + 1u;      // NE
+                        ind[k++] = ii;
+                        ind[k++] = ii + gw;      // NN
+                        ind[k++] = ii + gw + 1u; // NNE
+                    } else {
+                        ind[k++] = ii;
+                        ind[k++] = ii + 1u;
+                        ind[k++] = ii + gw + 1u; // NSE
+                        ind[k++] = ii;
+                        ind[k++] = ii + gw + 1u; // NSE
+                        ind[k++] = ii + gw;      // NS
+                    }
+                }
+            }
+            return ind;
+        }
+
+        //! Compute the indices of GridVisMode::RectInterp: 4 triangles around the centre of
+        //! each rect, whose 5 vertices are the centre then the NE, SE, SW and NW corners
+        static constexpr std::array<GLuint, 12u * static_cast<std::size_t>(w) * h> make_rect_indices()
+        {
+            std::array<GLuint, 12u * static_cast<std::size_t>(w) * h> ind = {};
+            constexpr std::array<GLuint, 12> tris = { 1, 0, 2,  2, 0, 3,  3, 0, 4,  4, 0, 1 };
+            for (std::size_t ri = 0u; ri < static_cast<std::size_t>(w) * h; ++ri) {
+                for (std::size_t j = 0u; j < 12u; ++j) { ind[12u * ri + j] = static_cast<GLuint>(5u * ri) + tris[j]; }
+            }
+            return ind;
+        }
+
+        //! The index tables. Only computed in the instantiations that copy from them.
+        static constexpr std::array<GLuint, n_tri_indices> tri_indices = make_tri_indices();
+        static constexpr std::array<GLuint, 12u * static_cast<std::size_t>(w) * h> rect_indices = make_rect_indices();
+
         //! An overridable function to set the colour of rect ri
         std::array<float, 3> setColour (unsigned int ri)
         {
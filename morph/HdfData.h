@@ -3,6 +3,10 @@
  *
  * If you define BUILD_HDFDATA_WITH_OPENCV before including this code, then you will
  * need OpenCV and you'll be able to save/load containers of cv::Points and cv::Mats.
+ *
+ * If you define BUILD_HDFDATA_WITH_MPI, you'll need MPI and an HDF5 library built with
+ * parallel support, and all the ranks of an MPI communicator can share one file (see
+ * the HdfData constructor that takes an MPI_Comm, and add_rank_vals).
  */
 #pragma once
 
@@ -11,19 +15,38 @@
 # include <opencv2/core/mat.hpp>
 #endif
 
+#ifdef BUILD_HDFDATA_WITH_MPI
+# include <mpi.h>
+#endif
+
 #include <hdf5.h>
+#if defined BUILD_HDFDATA_WITH_MPI && !defined H5_HAVE_PARALLEL
+# error "BUILD_HDFDATA_WITH_MPI requires an HDF5 library built with parallel (MPI-IO) support"
+#endif
 #include <vector>
 #include <array>
 #include <list>
+#include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <bitset>
+#include <algorithm>
+#include <type_traits>
 #include <cstddef>
+#include <cstring>
 #include <sstream>
 #include <stdexcept>
+#include <span>
+#if defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+#endif
 #include <morph/vec.h>
 #include <morph/vvec.h>
 #include <morph/tools.h>
+#include <morph/trace.h>
 
 #ifdef __WIN__
 #define __PRETTY_FUNCTION__ __FUNCSIG__
@@ -57,6 +80,19 @@ namespace morph {
         ReadWrite
     };
 
+    /*!
+     * The compression filter applied to datasets that HdfData creates. Gzip (deflate) and
+     * Szip are built into most HDF5 libraries; LZ4 is the registered third party filter
+     * 32004, which HDF5 loads as a plugin (found via HDF5_PLUGIN_PATH).
+     */
+    enum class Compression
+    {
+        None,
+        Gzip,
+        Szip,
+        LZ4
+    };
+
     /*!
      * Very simple data access class, wrapping around the HDF5 C API. Operates either in
      * write mode (the default) or read mode. Choose which when constructing.
@@ -70,6 +106,14 @@ namespace morph {
         //! The file access mode chosen by the user at construction time.
         FileAccess file_access = FileAccess::TruncateWrite;
 
+        //! This process's rank among those sharing the file, and their number
+        int comm_rank = 0;
+        int comm_size = 1;
+#ifdef BUILD_HDFDATA_WITH_MPI
+        //! The communicator whose ranks share the file, or MPI_COMM_NULL if the file is not shared
+        MPI_Comm comm = MPI_COMM_NULL;
+#endif
+
         /*!
          * If there's an error in status, output a context (given by emsg) sensible
          * message and throw an exception.
@@ -90,7 +134,9 @@ namespace morph {
          */
         hid_t open_dataset (const char* path, hid_t dtype_id, hid_t space_id)
         {
-            hid_t dataset_id = H5Dcreate2 (this->file_id, path, dtype_id, space_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+            hid_t dcpl_id = this->dataset_create_plist (space_id, this->chunk_dims);
+            hid_t dataset_id = H5Dcreate2 (this->file_id, path, dtype_id, space_id, H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
+            if (dcpl_id != H5P_DEFAULT) { H5Pclose (dcpl_id); }
             if (this->file_access == FileAccess::ReadWrite) {
                 if (dataset_id < 0) {
                     dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
@@ -102,6 +148,240 @@ namespace morph {
             return dataset_id;
         }
 
+        /*!
+         * The dataset creation property list for a new dataset with dataspace space_id,
+         * according to chunk_shape and compression. Returns H5P_DEFAULT (contiguous
+         * storage) if neither is set, or for single-valued datasets, unless the dataset
+         * is extendible, which requires chunks. Otherwise the caller must H5Pclose the
+         * list.
+         */
+        hid_t dataset_create_plist (hid_t space_id, const std::vector<hsize_t>& chunk_shape, const bool extendible = false) const
+        {
+            if (!extendible && this->compression == Compression::None && chunk_shape.empty()) { return H5P_DEFAULT; }
+            const int rank = H5Sget_simple_extent_ndims (space_id);
+            if (rank < 1) { return H5P_DEFAULT; }
+            std::vector<hsize_t> dims (rank, 0);
+            H5Sget_simple_extent_dims (space_id, dims.data(), NULL);
+            if (!extendible && H5Sget_simple_extent_npoints (space_id) <= 1) { return H5P_DEFAULT; }
+
+            // The chunk shape. Automatically, the whole dataset, halved along dim 0 (then
+            // dim 1...) until a chunk holds no more than 2^18 elements.
+            std::vector<hsize_t> chunk (rank, 1);
+            if (static_cast<int>(chunk_shape.size()) == rank) {
+                for (int i = 0; i < rank; ++i) { chunk[i] = chunk_shape[i] > 0 ? chunk_shape[i] : 1; }
+            } else {
+                for (int i = 0; i < rank; ++i) { chunk[i] = dims[i] > 0 ? dims[i] : 1; }
+                auto nelem = [&chunk]() { hsize_t n = 1; for (auto c : chunk) { n *= c; } return n; };
+                for (int i = 0; i < rank && nelem() > (hsize_t{1} << 18); ++i) {
+                    while (chunk[i] > 1 && nelem() > (hsize_t{1} << 18)) { chunk[i] = (chunk[i] + 1) / 2; }
+                }
+            }
+            // A fixed size dataset's chunks may be no larger than the dataset
+            if (!extendible) { for (int i = 0; i < rank; ++i) { chunk[i] = std::min (chunk[i], std::max (dims[i], hsize_t{1})); } }
+
+            hid_t dcpl_id = H5Pcreate (H5P_DATASET_CREATE);
+            herr_t status = H5Pset_chunk (dcpl_id, rank, chunk.data());
+            if (status >= 0) {
+                if (this->compression == Compression::Gzip) {
+                    if (H5Zfilter_avail (H5Z_FILTER_DEFLATE) <= 0) {
+                        H5Pclose (dcpl_id);
+                        throw std::runtime_error ("HdfData: This HDF5 library has no gzip (deflate) filter");
+                    }
+                    H5Pset_shuffle (dcpl_id);
+                    status = H5Pset_deflate (dcpl_id, this->compression_level);
+                } else if (this->compression == Compression::Szip) {
+                    unsigned int info = 0;
+                    if (H5Zfilter_avail (H5Z_FILTER_SZIP) <= 0
+                        || H5Zget_filter_info (H5Z_FILTER_SZIP, &info) < 0
+                        || !(info & H5Z_FILTER_CONFIG_ENCODE_ENABLED)) {
+                        H5Pclose (dcpl_id);
+                        throw std::runtime_error ("HdfData: This HDF5 library cannot encode with szip");
+                    }
+                    status = H5Pset_szip (dcpl_id, H5_SZIP_NN_OPTION_MASK, 16);
+                } else if (this->compression == Compression::LZ4) {
+                    if (H5Zfilter_avail (HdfData::lz4_filter_id) <= 0) {
+                        H5Pclose (dcpl_id);
+                        throw std::runtime_error ("HdfData: The LZ4 filter plugin is not available (is HDF5_PLUGIN_PATH set?)");
+                    }
+                    H5Pset_shuffle (dcpl_id);
+                    status = H5Pset_filter (dcpl_id, HdfData::lz4_filter_id, H5Z_FLAG_MANDATORY, 0, NULL);
+                }
+            }
+            if (status < 0) {
+                H5Pclose (dcpl_id);
+                throw std::runtime_error ("HdfData: Failed to set up dataset chunking/compression");
+            }
+            return dcpl_id;
+        }
+
+        //! The file and memory HDF5 types for T, chosen as in add_contained_vals
+        template <typename T>
+        static void h5_types (hid_t& file_type, hid_t& mem_type)
+        {
+            if constexpr (std::is_same<std::decay_t<T>, double>::value == true) {
+                file_type = H5T_IEEE_F64LE;
+                mem_type = H5T_NATIVE_DOUBLE;
+            } else if constexpr (std::is_same<std::decay_t<T>, float>::value == true) {
+                file_type = H5T_IEEE_F64LE;
+                mem_type = H5T_NATIVE_FLOAT;
+            } else if constexpr (std::is_same<std::decay_t<T>, char>::value == true) {
+                file_type = H5T_STD_I64LE;
+                mem_type = H5T_NATIVE_CHAR;
+            } else if constexpr (std::is_same<std::decay_t<T>, short>::value == true) {
+                // Kept narrow in the file, for compact (quantised) data
+                file_type = H5T_STD_I16LE;
+                mem_type = H5T_NATIVE_SHORT;
+            } else if constexpr (std::is_same<std::decay_t<T>, int>::value == true) {
+                file_type = H5T_STD_I64LE;
+                mem_type = H5T_NATIVE_INT;
+            } else if constexpr (std::is_same<std::decay_t<T>, long long int>::value == true) {
+                file_type = H5T_STD_I64LE;
+                mem_type = H5T_NATIVE_LLONG;
+            } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true) {
+                file_type = H5T_STD_U64LE;
+                mem_type = H5T_NATIVE_UINT;
+            } else if constexpr (std::is_same<std::decay_t<T>, unsigned char>::value == true) {
+                file_type = H5T_STD_U64LE;
+                mem_type = H5T_NATIVE_UCHAR;
+            } else if constexpr (std::is_same<std::decay_t<T>, unsigned long long int>::value == true) {
+                file_type = H5T_STD_U64LE;
+                mem_type = H5T_NATIVE_ULLONG;
+            } else {
+                []<bool flag = false>() { static_assert(flag, "HdfData: Don't know how to store that type"); }();
+            }
+        }
+
+        //! True if h5_types knows T
+        template <typename T>
+        static constexpr bool has_h5_types()
+        {
+            using D = std::decay_t<T>;
+            return std::is_same_v<D, double> || std::is_same_v<D, float> || std::is_same_v<D, char>
+            || std::is_same_v<D, short> || std::is_same_v<D, int> || std::is_same_v<D, long long int>
+            || std::is_same_v<D, unsigned int> || std::is_same_v<D, unsigned char> || std::is_same_v<D, unsigned long long int>;
+        }
+
+        //! A value queued by add_val or add_string while batch_scalars is set
+        struct batched_scalar
+        {
+            //! The types of the value in the file and in bytes; file_type is -1 for a string
+            hid_t file_type = -1;
+            hid_t mem_type = -1;
+            std::vector<unsigned char> bytes;
+        };
+        //! The queued values, by group path ("" for the root group) and then name
+        std::map<std::string, std::map<std::string, batched_scalar>> batched;
+        //! The groups that process_groups has verified or created already
+        std::set<std::string> known_groups;
+
+        //! Split path into its group ("" for the root group) and the name within it
+        static std::pair<std::string, std::string> split_path (const std::string& path)
+        {
+            const std::string::size_type p = path.rfind ('/');
+            if (p == std::string::npos) { return { std::string(""), path }; }
+            return { path.substr (0, p), path.substr (p + 1) };
+        }
+
+        //! Queue the value at path, to be written by flush()
+        void queue_scalar (const char* path, const hid_t file_type, const hid_t mem_type, const void* v, const std::size_t n)
+        {
+            const auto [group, name] = HdfData::split_path (path);
+            if (name.empty()) { throw std::runtime_error ("HdfData: A batched value needs a name"); }
+            batched_scalar& b = this->batched[group][name];
+            b.file_type = file_type;
+            b.mem_type = mem_type;
+            b.bytes.assign (static_cast<const unsigned char*>(v), static_cast<const unsigned char*>(v) + n);
+        }
+
+        //! The path of part k of the batch dataset of group (see batch_scalars)
+        static std::string batch_part (const std::string& group, const unsigned int k)
+        {
+            return group + "/" + HdfData::batch_dataset_name + (k == 0 ? std::string("") : std::to_string (k));
+        }
+
+        /*!
+         * Read the value at path from its group's batch dataset into buf, as mem_type (or, if
+         * str is given, as a string into str). Returns false if it isn't there.
+         */
+        bool read_batched (const std::string& path, const hid_t mem_type, void* buf, std::string* str = nullptr) const
+        {
+            const auto [group, name] = HdfData::split_path (path);
+            if (name.empty()) { return false; }
+            for (unsigned int k = 0; this->exists (HdfData::batch_part (group, k)); ++k) {
+                hid_t dataset_id = H5Dopen2 (this->file_id, HdfData::batch_part (group, k).c_str(), H5P_DEFAULT);
+                if (dataset_id < 0) { return false; }
+                hid_t type_id = H5Dget_type (dataset_id);
+                const int member = H5Tget_member_index (type_id, name.c_str());
+                bool found = false;
+                if (member >= 0) {
+                    hid_t mtype = mem_type;
+                    if (str != nullptr) {
+                        hid_t ftype = H5Tget_member_type (type_id, static_cast<unsigned int>(member));
+                        str->assign (H5Tget_size (ftype), '\0');
+                        H5Tclose (ftype);
+                        mtype = H5Tcopy (H5T_C_S1);
+                        H5Tset_size (mtype, str->size());
+                        H5Tset_strpad (mtype, H5T_STR_NULLPAD);
+                        buf = str->data();
+                    }
+                    // A compound of the one member reads only that member
+                    hid_t read_type = H5Tcreate (H5T_COMPOUND, H5Tget_size (mtype));
+                    H5Tinsert (read_type, name.c_str(), 0, mtype);
+                    found = H5Dread (dataset_id, read_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) >= 0;
+                    H5Tclose (read_type);
+                    if (str != nullptr) {
+                        H5Tclose (mtype);
+                        str->resize (std::strlen (str->c_str()));
+                    }
+                }
+                H5Tclose (type_id);
+                H5Dclose (dataset_id);
+                if (member >= 0) { return found; }
+            }
+            return false;
+        }
+
+        /*!
+         * Read the 2D dataset at path, of shape [n, N], straight into the contiguous
+         * storage of vals, a std::vector-like container of array<T,N> or vec<T,N>. The
+         * elements have exactly the layout of one row of the dataset, so no intermediate
+         * copy is needed.
+         */
+        template <typename T, std::size_t N, typename V>
+        void read_rows_into (const char* path, V& vals)
+        {
+            using E = typename V::value_type;
+            static_assert (sizeof (E) == N * sizeof (T), "HdfData: element type does not have the layout T[N]");
+            hid_t file_type = 0, mem_type = 0;
+            HdfData::h5_types<T> (file_type, mem_type);
+
+            hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+            if (this->check_dataset_id (dataset_id, path) == -1) { return; }
+            hid_t space_id = H5Dget_space (dataset_id);
+            hsize_t dims[2] = {0,0};
+            int ndims = H5Sget_simple_extent_dims (space_id, dims, NULL);
+            H5Sclose (space_id);
+            if (ndims != 2) {
+                H5Dclose (dataset_id);
+                std::stringstream ee;
+                ee << "Error. Expected 2D data to be stored in " << path;
+                throw std::runtime_error (ee.str());
+            }
+            if (dims[1] != N) {
+                H5Dclose (dataset_id);
+                std::stringstream ee;
+                ee << "Error. Expecting to read arrays of size N=" << N << " but HDF5 says dims[1] is " << dims[1];
+                throw std::runtime_error (ee.str());
+            }
+            vals.resize (dims[0]);
+
+            herr_t status = 0;
+            if (dims[0] > 0) { status = H5Dread (dataset_id, mem_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, vals.data()); }
+            this->handle_error (status, "Error. status after H5Dread: ");
+            status = H5Dclose (dataset_id);
+            this->handle_error (status, "Error. status after H5Dclose: ");
+        }
+
         /*!
          * Check the 2D dataspace enclosed within the dataset. If one ALREADY exists,
          * make sure its size will support the saving of data of size dim0 by dim1. If
@@ -231,21 +511,62 @@ namespace morph {
             this->init (fname, _file_access, show_hdf_internal_errors);
         }
 
+#ifdef BUILD_HDFDATA_WITH_MPI
+        /*!
+         * Construct, opening one file shared by every rank of _comm through MPI-IO. This
+         * is collective: all the ranks must construct with the same fname and access.
+         *
+         * Every call that creates something in the file (a group or a dataset) must then
+         * also be made on all the ranks, in the same order and with the same arguments,
+         * because the file's layout is decided collectively. Metadata is written
+         * collectively too, so the file's structure is written once, not once per rank.
+         * add_rank_vals writes a shared dataset with a row per rank. The ordinary
+         * add_* calls may also be made, collectively, with the same values on each rank.
+         */
+        HdfData (const std::string fname, MPI_Comm _comm,
+                 const FileAccess _file_access = FileAccess::TruncateWrite,
+                 const bool show_hdf_internal_errors = false)
+        {
+            MPI_Comm_dup (_comm, &this->comm);
+            MPI_Comm_rank (this->comm, &this->comm_rank);
+            MPI_Comm_size (this->comm, &this->comm_size);
+            hid_t fapl_id = H5Pcreate (H5P_FILE_ACCESS);
+            H5Pset_fapl_mpio (fapl_id, this->comm, MPI_INFO_NULL);
+            H5Pset_all_coll_metadata_ops (fapl_id, true);
+            H5Pset_coll_metadata_write (fapl_id, true);
+            try {
+                this->init (fname, _file_access, show_hdf_internal_errors, fapl_id);
+            } catch (...) {
+                H5Pclose (fapl_id);
+                MPI_Comm_free (&this->comm);
+                throw;
+            }
+            H5Pclose (fapl_id);
+        }
+#endif
+
+        //! This process's rank in the communicator sharing the file (0 if not shared)
+        int rank() const { return this->comm_rank; }
+        //! The number of ranks sharing the file (1 if not shared)
+        int ranks() const { return this->comm_size; }
+
     private:
         void init (const std::string fname,
                    const FileAccess _file_access,
-                   const bool show_hdf_internal_errors)
+                   const bool show_hdf_internal_errors,
+                   const hid_t fapl_id = H5P_DEFAULT)
         {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::open", "io");
             this->file_access = _file_access;
             if (this->file_access == FileAccess::ReadOnly) {
                 // std::cout << "Open read-only\n";
-                this->file_id = H5Fopen (fname.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+                this->file_id = H5Fopen (fname.c_str(), H5F_ACC_RDONLY, fapl_id);
             } else if (this->file_access == FileAccess::ReadWrite) {
                 // std::cout << "Open read-write\n";
-                this->file_id = H5Fopen (fname.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+                this->file_id = H5Fopen (fname.c_str(), H5F_ACC_RDWR, fapl_id);
             } else {
                 // std::cout << "Open for writing (after truncation)\n";
-                this->file_id = H5Fcreate (fname.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+                this->file_id = H5Fcreate (fname.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl_id);
             }
             // Check it's open, if not throw exception
             if ((int)this->file_id < 0) {
@@ -263,8 +584,17 @@ namespace morph {
         //! Deconstruct, closing the file_id
         ~HdfData()
         {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::close", "io");
+            try {
+                this->flush();
+            } catch (const std::exception& e) {
+                std::cerr << "Error writing batched values to HDF5 file: " << e.what() << std::endl;
+            }
             herr_t status = H5Fclose (this->file_id);
             if (status) { std::cerr << "Error closing HDF5 file; status: " << status << std::endl; }
+#ifdef BUILD_HDFDATA_WITH_MPI
+            if (this->comm != MPI_COMM_NULL) { MPI_Comm_free (&this->comm); }
+#endif
         }
 
         /*!
@@ -280,6 +610,137 @@ namespace morph {
          */
         ReadErrorAction read_error_action = ReadErrorAction::Info;
 
+        /*!
+         * Storage options for the datasets created from here on. By default, datasets are
+         * contiguous and uncompressed. Setting compression (or chunk_dims) makes new
+         * datasets chunked, with chunks of shape chunk_dims if it has the dataset's rank,
+         * or else chunks of up to 2^18 elements chosen automatically. Gzip and LZ4 are
+         * preceded by the byte shuffle filter. Datasets of a single value are never
+         * chunked. Data compressed with these filters is read back transparently.
+         */
+        Compression compression = Compression::None;
+        //! The gzip level, 0 to 9
+        unsigned int compression_level = 4;
+        //! The chunk shape, one entry per dataset dimension; empty for automatic
+        std::vector<hsize_t> chunk_dims;
+
+        /*!
+         * If true, add_val and add_string don't write a dataset each. They queue the value
+         * until flush() (or the destructor), which writes all those in one group as the
+         * members of one compound dataset, batch_dataset_name, in that group (split into
+         * parts batch_dataset_name1, 2,... if there are thousands). That is one dataset per
+         * group instead of one per value, which makes saving hundreds of parameters much
+         * quicker. read_val and read_string find the values there (as the member named by
+         * the last part of the path) when there is no dataset of their own, so client code
+         * reads them back as before. exists() sees only the batch dataset. A value queued
+         * again before flush() replaces the first.
+         */
+        bool batch_scalars = false;
+
+        //! The name of the compound dataset in each group that holds its batched values
+        static constexpr const char* batch_dataset_name = "_batch";
+
+        /*!
+         * Write the values queued while batch_scalars is set, one compound dataset per group.
+         * Members of an existing batch dataset that are not queued again are kept. With MPI,
+         * this is collective.
+         */
+        void flush()
+        {
+            if (this->batched.empty()) { return; }
+            MORPH_TRACE_SCOPE_CAT ("HdfData::flush", "io");
+            // A member of the new compound: its type in the file and its bytes in that type
+            struct member { std::string name; hid_t type; std::vector<unsigned char> bytes; };
+            for (const auto& [group, vals] : this->batched) {
+                this->process_groups (HdfData::batch_part (group, 0).c_str());
+                std::vector<member> members;
+                // Keep what an earlier flush (or an earlier session) wrote here
+                for (unsigned int k = 0; H5Lexists (this->file_id, HdfData::batch_part (group, k).c_str(), H5P_DEFAULT) > 0; ++k) {
+                    const std::string bpath = HdfData::batch_part (group, k);
+                    hid_t dataset_id = H5Dopen2 (this->file_id, bpath.c_str(), H5P_DEFAULT);
+                    hid_t type_id = H5Dget_type (dataset_id);
+                    std::vector<unsigned char> old (H5Tget_size (type_id));
+                    herr_t status = H5Dread (dataset_id, type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, old.data());
+                    this->handle_error (status, "Error. status after H5Dread of batch dataset: ");
+                    const int nm = H5Tget_nmembers (type_id);
+                    for (unsigned int i = 0; i < static_cast<unsigned int>(nm); ++i) {
+                        char* cname = H5Tget_member_name (type_id, i);
+                        std::string name (cname);
+                        H5free_memory (cname);
+                        hid_t mtype = H5Tget_member_type (type_id, i);
+                        if (vals.count (name) > 0) { H5Tclose (mtype); continue; }
+                        const std::size_t off = H5Tget_member_offset (type_id, i);
+                        members.push_back ({ name, mtype, std::vector<unsigned char>(old.begin() + off, old.begin() + off + H5Tget_size (mtype)) });
+                    }
+                    H5Tclose (type_id);
+                    H5Dclose (dataset_id);
+                    status = H5Ldelete (this->file_id, bpath.c_str(), H5P_DEFAULT);
+                    this->handle_error (status, "Error. status after H5Ldelete of batch dataset: ");
+                }
+                for (const auto& [name, b] : vals) {
+                    member m = { name, -1, b.bytes };
+                    if (b.file_type < 0) {
+                        m.type = H5Tcopy (H5T_C_S1);
+                        H5Tset_size (m.type, std::max (std::size_t{1}, m.bytes.size()));
+                        H5Tset_strpad (m.type, H5T_STR_NULLPAD);
+                        m.bytes.resize (H5Tget_size (m.type), 0);
+                    } else {
+                        // Convert to the file's representation in place
+                        m.type = H5Tcopy (b.file_type);
+                        m.bytes.resize (std::max (m.bytes.size(), H5Tget_size (m.type)), 0);
+                        herr_t status = H5Tconvert (b.mem_type, m.type, 1, m.bytes.data(), nullptr, H5P_DEFAULT);
+                        this->handle_error (status, "Error. status after H5Tconvert: ");
+                        m.bytes.resize (H5Tget_size (m.type));
+                    }
+                    members.push_back (std::move (m));
+                }
+                /*
+                 * A datatype is held in the dataset's object header, whose messages are limited
+                 * to 64 KiB, so members are split between parts, estimating for each member its
+                 * name and about 48 bytes of type description.
+                 */
+                constexpr std::size_t part_header_budget = 32768;
+                std::size_t first = 0;
+                for (unsigned int k = 0; first < members.size(); ++k) {
+                    std::size_t last = first;
+                    std::size_t header = 0;
+                    std::size_t total = 0;
+                    while (last < members.size() && (last == first || header + members[last].name.size() + 56 < part_header_budget)) {
+                        header += members[last].name.size() + 56;
+                        total += members[last].bytes.size();
+                        ++last;
+                    }
+                    hid_t ctype = H5Tcreate (H5T_COMPOUND, total);
+                    std::vector<unsigned char> row (total);
+                    std::size_t off = 0;
+                    for (std::size_t i = first; i < last; ++i) {
+                        member& m = members[i];
+                        H5Tinsert (ctype, m.name.c_str(), off, m.type);
+                        if (!m.bytes.empty()) { std::memcpy (row.data() + off, m.bytes.data(), m.bytes.size()); }
+                        off += m.bytes.size();
+                        H5Tclose (m.type);
+                    }
+                    hsize_t dim_single[1] = { 1 };
+                    hid_t dataspace_id = H5Screate_simple (1, dim_single, NULL);
+                    hid_t dataset_id = H5Dcreate2 (this->file_id, HdfData::batch_part (group, k).c_str(), ctype, dataspace_id,
+                                                   H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+                    herr_t status = dataset_id < 0 ? dataset_id : H5Dwrite (dataset_id, ctype, H5S_ALL, H5S_ALL, H5P_DEFAULT, row.data());
+                    if (dataset_id >= 0) { H5Dclose (dataset_id); }
+                    H5Sclose (dataspace_id);
+                    H5Tclose (ctype);
+                    this->handle_error (status, "Error. status after writing batch dataset: ");
+                    first = last;
+                }
+            }
+            this->batched.clear();
+        }
+
+        //! The HDF5 registered filter id of the LZ4 filter
+        static constexpr H5Z_filter_t lz4_filter_id = 32004;
+
+        //! The number of values to read at once when a dataset is read in blocks of rows
+        static constexpr hsize_t read_block_elements = hsize_t{1} << 20;
+
         /*!
          * Templated version of read_contained_vals, for vector/list/deque (but not map,
          * which is more complex) and whatever simple value (int, double, float, etc) is
@@ -292,6 +753,7 @@ namespace morph {
                    typename Allocator=std::allocator<T> >
         void read_contained_vals (const char* path, Container<T, Allocator>& vals)
         {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::read_contained_vals", "io");
             hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
             if (this->check_dataset_id (dataset_id, path) == -1) { return; }
 
@@ -304,8 +766,9 @@ namespace morph {
                 throw std::runtime_error (ee.str());
             }
 
-            // Read the data from HDF5 into a vector. Thereafter, copy it into the
-            // Container vals. This ensures vals can be std::list.
+            // A std::vector (or vvec) is read in place. Other containers, such as
+            // std::list, are read into the vector invals and then copied into vals.
+            constexpr bool contiguous = std::is_base_of_v<std::vector<T, Allocator>, Container<T, Allocator>>;
             std::vector<T> invals;
 
             // If cv::Point like. Could add pair<float, float> and pair<double, double>,
@@ -349,7 +812,7 @@ namespace morph {
                        << ":\nError: Expected 2 coordinates to be stored in each cv::Point/array<*,2>/pair<> of " << path;
                     throw std::runtime_error (ee.str());
                 }
-                invals.resize (dims[0]);
+                if constexpr (!contiguous) { invals.resize (dims[0]); }
                 vals.resize (dims[0]);
 
             } else {
@@ -363,76 +826,79 @@ namespace morph {
                        << ":\nError: Expected 1D data to be stored in " << path << ". ndims=" << ndims;
                     throw std::runtime_error (ee.str());
                 }
-                invals.resize (dims[0], T{0});
+                if constexpr (!contiguous) { invals.resize (dims[0], T{0}); }
                 vals.resize (dims[0], T{0});
             }
+            H5Sclose (space_id);
 
             herr_t status = 0;
-
-            if constexpr (std::is_same<std::decay_t<T>, float>::value == true
+            void* dst = nullptr;
+            if constexpr (contiguous) { dst = vals.data(); } else { dst = invals.data(); }
+            if (vals.empty()) {
+                // Nothing to read
+            } else if constexpr (std::is_same<std::decay_t<T>, float>::value == true
                           || std::is_same<typename std::decay<T>::type, std::array<float,2>>::value == true
                           || std::is_same<typename std::decay<T>::type, morph::vec<float,2>>::value == true
                           || std::is_same<typename std::decay<T>::type, std::pair<float, float>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, double>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<double,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<double,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<double, double>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, int>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<int, int>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, short int>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<short int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<short int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<short int, short int>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<unsigned int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<unsigned int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<unsigned int, unsigned int>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, unsigned short int>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<unsigned short int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<unsigned short int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<unsigned short int, unsigned short int>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_USHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_USHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, unsigned long long int>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<unsigned long long int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<unsigned long long int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<unsigned long long int, unsigned long long int>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<std::decay_t<T>, long long int>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::array<long long int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, morph::vec<long long int,2>>::value == true
                                  || std::is_same<typename std::decay<T>::type, std::pair<long long int, long long int>>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
 #ifdef BUILD_HDFDATA_WITH_OPENCV
             } else if constexpr (std::is_same<typename std::decay<T>::type, cv::Point2i>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<typename std::decay<T>::type, cv::Point2d>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 
             } else if constexpr (std::is_same<typename std::decay<T>::type, cv::Point2f>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dst);
 #endif
             } else {
                 throw std::runtime_error ("HdfData::read_contained_vals<T>: Don't know how to read that type");
             }
 
-            // Copy invals into vals
-            std::copy (invals.begin(), invals.end(), vals.begin());
+            if constexpr (!contiguous) { std::copy (invals.begin(), invals.end(), vals.begin()); }
 
             this->handle_error (status, "Error. status after H5Dread: ");
             status = H5Dclose (dataset_id);
@@ -458,47 +924,14 @@ namespace morph {
         template<typename T, std::size_t N>
         void read_contained_vals (const char* path, std::vector<std::array<T, N>>& vals)
         {
-            hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
-            if (this->check_dataset_id (dataset_id, path) == -1) { return; }
-            hid_t space_id = H5Dget_space (dataset_id);
-            hsize_t dims[2] = {0,0};
-            int ndims = H5Sget_simple_extent_dims (space_id, dims, NULL);
-            if (ndims != 2) {
-                std::stringstream ee;
-                ee << "Error. Expected 2D data to be stored in " << path;
-                throw std::runtime_error (ee.str());
-            }
-            if (dims[1] != N) {
-                std::stringstream ee;
-                ee << "Error. Expecting to read arrays of size N=" << N << " but HDF5 says dims[1] is " << dims[1];
-                throw std::runtime_error (ee.str());
-            }
-            vals.resize(dims[0]);
-
-            herr_t status = 0;
-            if constexpr (std::is_same<std::decay_t<T>, double>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, float>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, long long int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
+            this->read_rows_into<T, N> (path, vals);
+        }
 
-            } else if constexpr (std::is_same<typename std::decay<T>::type, unsigned long long int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-            } else {
-                throw std::runtime_error ("HdfData::read_contained_vals<vector<array<T,N>>: Don't know how to read that type T");
-            }
-            this->handle_error (status, "Error. status after H5Dread: ");
-            status = H5Dclose (dataset_id);
-            this->handle_error (status, "Error. status after H5Dclose: ");
+        //! read_contained_vals for a vector of vec<T,N>, such as a HexGrid's saved positions
+        template<typename T, std::size_t N>
+        void read_contained_vals (const char* path, std::vector<morph::vec<T, N>>& vals)
+        {
+            this->read_rows_into<T, N> (path, vals);
         }
 
         //! read_contained_vals for an array<T,N> (and by extension, a morph::vec<T,N>)
@@ -516,6 +949,12 @@ namespace morph {
                    << ":\nError: Expected 1D data to be stored in " << path << ". ndims=" << ndims;
                 throw std::runtime_error (ee.str());
             }
+            // vals is read in place, so it must be exactly the size of the dataset
+            if (dims[0] != N) {
+                std::stringstream ee;
+                ee << "Error. Expecting to read an array of size N=" << N << " but HDF5 says " << path << " has " << dims[0] << " elements";
+                throw std::runtime_error (ee.str());
+            }
 
             herr_t status = 0;
             if constexpr (std::is_same<std::decay_t<T>, double>::value == true) {
@@ -553,108 +992,458 @@ namespace morph {
         template<typename T, std::size_t N>
         void read_contained_vals (const char* path, morph::vvec<morph::vec<T, N>>& vals)
         {
+            this->read_rows_into<T, N> (path, vals);
+        }
+
+        /*!
+         * read_contained_vals for vvec of identically sized vvecs of scalar types T. The
+         * rows are separate allocations, so they can't all be filled by one H5Dread.
+         * Instead, blocks of rows of about read_block_elements values are read into a
+         * buffer and copied out; rows at least that long are read straight into place.
+         * The extra memory is therefore bounded, rather than the size of the dataset.
+         */
+        template<typename T>
+        void read_contained_vals (const char* path, morph::vvec<morph::vvec<T>>& vals)
+        {
+            hid_t file_type = 0, mem_type = 0;
+            HdfData::h5_types<T> (file_type, mem_type);
+
             hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
             if (this->check_dataset_id (dataset_id, path) == -1) { return; }
             hid_t space_id = H5Dget_space (dataset_id);
             hsize_t dims[2] = {0,0};
             int ndims = H5Sget_simple_extent_dims (space_id, dims, NULL);
             if (ndims != 2) {
+                H5Sclose (space_id);
+                H5Dclose (dataset_id);
                 std::stringstream ee;
                 ee << "Error. Expected 2D data to be stored in " << path;
                 throw std::runtime_error (ee.str());
             }
-            if (dims[1] != N) {
-                std::stringstream ee;
-                ee << "Error. Expecting to read arrays of size N=" << N << " but HDF5 says dims[1] is " << dims[1];
-                throw std::runtime_error (ee.str());
-            }
-            vals.resize(dims[0]);
-
-            herr_t status = 0;
-            if constexpr (std::is_same<std::decay_t<T>, double>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, float>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
 
-            } else if constexpr (std::is_same<std::decay_t<T>, int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, long long int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-
-            } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
+            vals.resize (dims[0]);
+            for (auto& v : vals) { v.resize (dims[1]); }
 
-            } else if constexpr (std::is_same<typename std::decay<T>::type, unsigned long long int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(vals[0]));
-            } else {
-                throw std::runtime_error ("HdfData::read_contained_vals<vector<array<T,N>>: Don't know how to read that type T");
+            herr_t status = 0;
+            if (dims[0] > 0 && dims[1] > 0) {
+                const hsize_t rows_per_read = std::max (hsize_t{1}, HdfData::read_block_elements / dims[1]);
+                morph::vvec<T> invals;
+                if (rows_per_read > 1) { invals.resize (std::min (rows_per_read, dims[0]) * dims[1]); }
+                for (hsize_t r0 = 0; r0 < dims[0] && status >= 0; r0 += rows_per_read) {
+                    const hsize_t nr = std::min (rows_per_read, dims[0] - r0);
+                    const hsize_t start[2] = { r0, 0 };
+                    const hsize_t count[2] = { nr, dims[1] };
+                    status = H5Sselect_hyperslab (space_id, H5S_SELECT_SET, start, NULL, count, NULL);
+                    if (status < 0) { break; }
+                    hid_t memspace_id = H5Screate_simple (2, count, NULL);
+                    T* dst = rows_per_read > 1 ? invals.data() : vals[r0].data();
+                    status = H5Dread (dataset_id, mem_type, memspace_id, space_id, H5P_DEFAULT, dst);
+                    H5Sclose (memspace_id);
+                    if (rows_per_read > 1) {
+                        for (hsize_t i = 0; i < nr; ++i) {
+                            std::copy (invals.begin() + i * dims[1], invals.begin() + (i + 1) * dims[1], vals[r0 + i].begin());
+                        }
+                    }
+                }
             }
+            H5Sclose (space_id);
             this->handle_error (status, "Error. status after H5Dread: ");
             status = H5Dclose (dataset_id);
             this->handle_error (status, "Error. status after H5Dclose: ");
         }
 
-        //! read_contained_vals for vvec of identically sized vvecs of scalar types T
-        template<typename T>
-        void read_contained_vals (const char* path, morph::vvec<morph::vvec<T>>& vals)
+        //! True if there is a dataset or a group at path
+        bool exists (const std::string& path) const
+        {
+            // H5Lexists fails if a group on the way is missing, so check each in turn
+            std::string::size_type p = 0;
+            while ((p = path.find ('/', p + 1)) != std::string::npos) {
+                if (H5Lexists (this->file_id, path.substr (0, p).c_str(), H5P_DEFAULT) <= 0) { return false; }
+            }
+            return H5Lexists (this->file_id, path.c_str(), H5P_DEFAULT) > 0;
+        }
+
+        //! The dimensions of the dataset at path (empty if there is no such dataset)
+        std::vector<hsize_t> get_dims (const char* path) const
+        {
+            std::vector<hsize_t> dims;
+            hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+            if (this->check_dataset_id (dataset_id, path) == -1) { return dims; }
+            hid_t space_id = H5Dget_space (dataset_id);
+            int ndims = H5Sget_simple_extent_ndims (space_id);
+            if (ndims > 0) {
+                dims.resize (ndims, 0);
+                H5Sget_simple_extent_dims (space_id, dims.data(), NULL);
+            }
+            H5Sclose (space_id);
+            H5Dclose (dataset_id);
+            return dims;
+        }
+
+        /*!
+         * Read a hyperslab of the dataset at path into buf: count[d] elements along each
+         * dimension d, starting at start[d] and stepping by stride[d] (1 if stride is
+         * empty). Only the selected elements are read from the file. buf must have room for
+         * the product of count; the elements arrive in row-major order. T is one of the
+         * scalar types that add_contained_vals writes.
+         */
+        template <typename T>
+        void read_slice (const char* path, const std::vector<hsize_t>& start, const std::vector<hsize_t>& count,
+                         T* buf, const std::vector<hsize_t>& stride = {})
         {
+            hid_t file_type = 0;
+            hid_t mem_type = 0;
+            HdfData::h5_types<T> (file_type, mem_type);
+
             hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
             if (this->check_dataset_id (dataset_id, path) == -1) { return; }
             hid_t space_id = H5Dget_space (dataset_id);
-            hsize_t dims[2] = {0,0};
-            int ndims = H5Sget_simple_extent_dims (space_id, dims, NULL);
-            if (ndims != 2) {
+            const int ndims = H5Sget_simple_extent_ndims (space_id);
+            if (ndims < 1 || static_cast<int>(start.size()) != ndims || static_cast<int>(count.size()) != ndims
+                || (!stride.empty() && static_cast<int>(stride.size()) != ndims)) {
+                H5Sclose (space_id);
+                H5Dclose (dataset_id);
                 std::stringstream ee;
-                ee << "Error. Expected 2D data to be stored in " << path;
+                ee << "HdfData::read_slice: start, count and stride must each have " << ndims << " elements for " << path;
                 throw std::runtime_error (ee.str());
             }
+            herr_t status = H5Sselect_hyperslab (space_id, H5S_SELECT_SET, start.data(),
+                                                 stride.empty() ? NULL : stride.data(), count.data(), NULL);
+            if (status < 0 || H5Sselect_valid (space_id) <= 0) {
+                H5Sclose (space_id);
+                H5Dclose (dataset_id);
+                throw std::runtime_error (std::string("HdfData::read_slice: Selection lies outside dataset ") + path);
+            }
+            hid_t memspace_id = H5Screate_simple (ndims, count.data(), NULL);
+            status = H5Dread (dataset_id, mem_type, memspace_id, space_id, H5P_DEFAULT, buf);
+            H5Sclose (memspace_id);
+            H5Sclose (space_id);
+            H5Dclose (dataset_id);
+            this->handle_error (status, "Error. status after H5Dread (read_slice): ");
+        }
 
-            // Read into a 1D section of memory
-            morph::vvec<T> invals;
-            invals.resize(dims[0] * dims[1]);
+        //! read_slice into a std::vector (or vvec), which is resized to fit
+        template <typename T>
+        void read_slice (const char* path, const std::vector<hsize_t>& start, const std::vector<hsize_t>& count,
+                         std::vector<T>& vals, const std::vector<hsize_t>& stride = {})
+        {
+            hsize_t n = 1;
+            for (auto c : count) { n *= c; }
+            vals.resize (n);
+            this->read_slice (path, start, count, vals.data(), stride);
+        }
 
-            herr_t status = 0;
-            if constexpr (std::is_same<std::decay_t<T>, double>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+        /*!
+         * Reads a dataset a block of rows (elements along the first dimension) at a time,
+         * so that a dataset larger than memory can be streamed through:
+         *
+         *   auto blocks = data.read_blocks<float> ("/frames/A");
+         *   for (auto& b : blocks) { process (b.row0, b.nrows, b.vals); }
+         *
+         * By default a block is one chunk's worth of rows if the dataset is chunked, or
+         * else as many rows as hold about read_block_elements values. The reader keeps the
+         * dataset open and must not outlive the HdfData that made it.
+         */
+        template <typename T>
+        class block_reader
+        {
+        public:
+            //! A block of nrows rows starting at row0. vals holds them in row-major order.
+            struct block
+            {
+                hsize_t row0 = 0;
+                hsize_t nrows = 0;
+                std::vector<T> vals;
+            };
 
-            } else if constexpr (std::is_same<std::decay_t<T>, float>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+            block_reader (hid_t file_id, const char* path, hsize_t rows_per_block)
+            {
+                hid_t file_type = 0;
+                HdfData::h5_types<T> (file_type, this->mem_type);
+                this->dataset_id = H5Dopen2 (file_id, path, H5P_DEFAULT);
+                if (this->dataset_id < 0) { throw std::runtime_error (std::string("HdfData::read_blocks: No dataset ") + path); }
+                hid_t space_id = H5Dget_space (this->dataset_id);
+                const int ndims = H5Sget_simple_extent_ndims (space_id);
+                if (ndims > 0) {
+                    this->dims.resize (ndims, 0);
+                    H5Sget_simple_extent_dims (space_id, this->dims.data(), NULL);
+                }
+                H5Sclose (space_id);
+                if (this->dims.empty()) {
+                    H5Dclose (this->dataset_id);
+                    throw std::runtime_error (std::string("HdfData::read_blocks: Empty dataspace for ") + path);
+                }
+                this->rowsize = 1;
+                for (std::size_t d = 1; d < this->dims.size(); ++d) { this->rowsize *= this->dims[d]; }
+
+                if (rows_per_block == 0) {
+                    hid_t dcpl_id = H5Dget_create_plist (this->dataset_id);
+                    if (H5Pget_layout (dcpl_id) == H5D_CHUNKED) {
+                        std::vector<hsize_t> cdims (this->dims.size(), 0);
+                        H5Pget_chunk (dcpl_id, static_cast<int>(cdims.size()), cdims.data());
+                        rows_per_block = cdims[0];
+                    } else {
+                        rows_per_block = std::max (hsize_t{1}, HdfData::read_block_elements / std::max (this->rowsize, hsize_t{1}));
+                    }
+                    H5Pclose (dcpl_id);
+                }
+                this->rows_per_block = std::max (rows_per_block, hsize_t{1});
+            }
 
-            } else if constexpr (std::is_same<std::decay_t<T>, int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+            ~block_reader() { if (this->dataset_id >= 0) { H5Dclose (this->dataset_id); } }
 
-            } else if constexpr (std::is_same<std::decay_t<T>, long long int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_LLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+            block_reader (const block_reader&) = delete;
+            block_reader& operator= (const block_reader&) = delete;
+            block_reader (block_reader&& other) noexcept { *this = std::move (other); }
+            block_reader& operator= (block_reader&& other) noexcept
+            {
+                if (this != &other) {
+                    if (this->dataset_id >= 0) { H5Dclose (this->dataset_id); }
+                    this->dataset_id = other.dataset_id;
+                    other.dataset_id = -1;
+                    this->mem_type = other.mem_type;
+                    this->dims = std::move (other.dims);
+                    this->rowsize = other.rowsize;
+                    this->rows_per_block = other.rows_per_block;
+                }
+                return *this;
+            }
 
-            } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
+            //! Read the block starting at row0 into b. Returns false if row0 is past the last row.
+            bool read (const hsize_t row0, block& b) const
+            {
+                if (row0 >= this->dims[0]) { return false; }
+                b.row0 = row0;
+                b.nrows = std::min (this->rows_per_block, this->dims[0] - row0);
+                b.vals.resize (b.nrows * this->rowsize);
+                std::vector<hsize_t> start (this->dims.size(), 0);
+                std::vector<hsize_t> count = this->dims;
+                start[0] = row0;
+                count[0] = b.nrows;
+                hid_t space_id = H5Dget_space (this->dataset_id);
+                H5Sselect_hyperslab (space_id, H5S_SELECT_SET, start.data(), NULL, count.data(), NULL);
+                hid_t memspace_id = H5Screate_simple (static_cast<int>(count.size()), count.data(), NULL);
+                herr_t status = H5Dread (this->dataset_id, this->mem_type, memspace_id, space_id, H5P_DEFAULT, b.vals.data());
+                H5Sclose (memspace_id);
+                H5Sclose (space_id);
+                if (status < 0) { throw std::runtime_error ("HdfData::block_reader: H5Dread failed"); }
+                return true;
+            }
 
-            } else if constexpr (std::is_same<typename std::decay<T>::type, unsigned long long int>::value == true) {
-                status = H5Dread (dataset_id, H5T_NATIVE_ULLONG, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(invals[0]));
-            } else {
-                throw std::runtime_error ("HdfData::read_contained_vals<T>: Don't know how to read that type");
+            //! An input iterator over the blocks. The block it refers to is reused as it advances.
+            struct iterator
+            {
+                const block_reader* r = nullptr;
+                block b;
+                bool done = true;
+                const block& operator*() const { return this->b; }
+                const block* operator->() const { return &this->b; }
+                iterator& operator++()
+                {
+                    this->done = !this->r->read (this->b.row0 + this->b.nrows, this->b);
+                    return *this;
+                }
+                bool operator== (const iterator& other) const { return this->done == other.done; }
+                bool operator!= (const iterator& other) const { return this->done != other.done; }
+            };
+
+            iterator begin() const
+            {
+                iterator it;
+                it.r = this;
+                it.done = !this->read (0, it.b);
+                return it;
             }
-            this->handle_error (status, "Error. status after H5Dread: ");
-            status = H5Dclose (dataset_id);
-            this->handle_error (status, "Error. status after H5Dclose: ");
+            iterator end() const { return iterator{}; }
 
-            // Now copy the data from invals into vals
-            vals.resize (dims[0]);
-            for (auto& v : vals) { v.resize(dims[1]); }
-            for (hsize_t i = 0; i < dims[0]; ++i) {
-                for (hsize_t j = 0; j < dims[1]; ++j) {
-                    vals[i][j] = invals[i*dims[1]+j];
+            //! The dataset's dimensions
+            std::vector<hsize_t> dims;
+            //! The number of elements in one row (the product of dims[1..])
+            hsize_t rowsize = 1;
+            //! The number of rows in each block (the last may have fewer)
+            hsize_t rows_per_block = 1;
+
+        private:
+            hid_t dataset_id = -1;
+            hid_t mem_type = 0;
+        };
+
+        //! Stream the dataset at path in blocks of rows_per_block rows (0 to choose from its chunking)
+        template <typename T>
+        block_reader<T> read_blocks (const char* path, const hsize_t rows_per_block = 0) const
+        {
+            return block_reader<T> (this->file_id, path, rows_per_block);
+        }
+
+        /*!
+         * The values of a dataset, as returned by map_contained_vals(): either a read-only view
+         * of the dataset's bytes mapped from the file, or a copy read in the usual way. A
+         * mapping stays valid after the HdfData that made it has gone, while the file is not
+         * changed.
+         */
+        template <typename T>
+        class mapped_vals
+        {
+        public:
+            mapped_vals() = default;
+            ~mapped_vals() { this->unmap(); }
+
+            mapped_vals (const mapped_vals&) = delete;
+            mapped_vals& operator= (const mapped_vals&) = delete;
+            mapped_vals (mapped_vals&& other) noexcept { *this = std::move (other); }
+            mapped_vals& operator= (mapped_vals&& other) noexcept
+            {
+                if (this != &other) {
+                    this->unmap();
+                    this->dims = std::move (other.dims);
+                    // Moving a vector keeps its storage, so ptr stays good for a read copy
+                    this->vals = std::move (other.vals);
+                    this->ptr = other.ptr;
+                    this->n = other.n;
+                    this->map_base = other.map_base;
+                    this->map_len = other.map_len;
+                    other.ptr = nullptr;
+                    other.n = 0;
+                    other.map_base = nullptr;
+                    other.map_len = 0;
+                }
+                return *this;
+            }
+
+            //! The values, in row-major order
+            std::span<const T> span() const { return std::span<const T> (this->ptr, this->n); }
+            const T* data() const { return this->ptr; }
+            std::size_t size() const { return this->n; }
+            bool empty() const { return this->n == 0; }
+            const T& operator[] (const std::size_t i) const { return this->ptr[i]; }
+            const T* begin() const { return this->ptr; }
+            const T* end() const { return this->ptr + this->n; }
+
+            //! True if the values are mapped from the file, false if they were read
+            bool mapped() const { return this->map_base != nullptr; }
+
+            //! The dataset's dimensions
+            std::vector<hsize_t> dims;
+
+        private:
+            friend class HdfData;
+
+            void unmap()
+            {
+#if defined(__unix__) || defined(__APPLE__)
+                if (this->map_base != nullptr) { ::munmap (this->map_base, this->map_len); }
+#endif
+                this->map_base = nullptr;
+            }
+
+            //! The values, when they were read rather than mapped
+            std::vector<T> vals;
+            const T* ptr = nullptr;
+            std::size_t n = 0;
+            void* map_base = nullptr;
+            std::size_t map_len = 0;
+        };
+
+        /*!
+         * The values of the dataset at path, mapped straight from the file where that is
+         * possible: for a file opened ReadOnly with the default (sec2) driver, a dataset
+         * stored contiguously and already written, and a T whose native type is the type in
+         * the file (so double, not float, for what add_contained_vals wrote from floats, and
+         * long long int for ints). Nothing is copied, the pages are read as they are touched,
+         * and processes that map the same file share its page cache. Otherwise (for chunked
+         * or compressed datasets, say) the values are read as by read_contained_vals, and
+         * mapped() is false.
+         */
+        template <typename T>
+        mapped_vals<T> map_contained_vals (const char* path) const
+        {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::map_contained_vals", "io");
+            mapped_vals<T> mv;
+            hid_t file_type = 0, mem_type = 0;
+            HdfData::h5_types<T> (file_type, mem_type);
+            hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+            if (this->check_dataset_id (dataset_id, path) == -1) { return mv; }
+            hid_t space_id = H5Dget_space (dataset_id);
+            const int ndims = H5Sget_simple_extent_ndims (space_id);
+            std::size_t n = ndims > 0 ? 1 : 0;
+            if (ndims > 0) {
+                mv.dims.resize (ndims, 0);
+                H5Sget_simple_extent_dims (space_id, mv.dims.data(), NULL);
+                for (auto d : mv.dims) { n *= d; }
+            }
+            H5Sclose (space_id);
+
+#if defined(__unix__) || defined(__APPLE__)
+            bool mappable = this->file_access == FileAccess::ReadOnly && n > 0;
+            haddr_t offset = HADDR_UNDEF;
+            if (mappable) {
+                hid_t dcpl_id = H5Dget_create_plist (dataset_id);
+                hid_t dtype_id = H5Dget_type (dataset_id);
+                mappable = H5Pget_layout (dcpl_id) == H5D_CONTIGUOUS && H5Tequal (dtype_id, mem_type) > 0;
+                H5Tclose (dtype_id);
+                H5Pclose (dcpl_id);
+                if (mappable) { offset = H5Dget_offset (dataset_id); }
+                mappable = mappable && offset != HADDR_UNDEF && offset % alignof (T) == 0;
+            }
+            if (mappable) {
+                // The offset is from the start of the file only without a user block
+                hid_t fcpl_id = H5Fget_create_plist (this->file_id);
+                hsize_t userblock = 0;
+                H5Pget_userblock (fcpl_id, &userblock);
+                H5Pclose (fcpl_id);
+                hid_t fapl_id = H5Fget_access_plist (this->file_id);
+                mappable = userblock == 0 && H5Pget_driver (fapl_id) == H5FD_SEC2;
+                H5Pclose (fapl_id);
+            }
+            if (mappable) {
+                const ssize_t nlen = H5Fget_name (this->file_id, nullptr, 0);
+                std::string fname (nlen > 0 ? static_cast<std::size_t>(nlen) : 0u, '\0');
+                if (nlen > 0) { H5Fget_name (this->file_id, fname.data(), fname.size() + 1); }
+                const int fd = nlen > 0 ? ::open (fname.c_str(), O_RDONLY) : -1;
+                if (fd >= 0) {
+                    // mmap wants an offset that is a multiple of the page size
+                    const std::size_t page = static_cast<std::size_t>(::sysconf (_SC_PAGESIZE));
+                    const std::size_t base = static_cast<std::size_t>(offset) / page * page;
+                    const std::size_t len = static_cast<std::size_t>(offset) - base + n * sizeof (T);
+                    void* m = ::mmap (nullptr, len, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(base));
+                    ::close (fd);
+                    if (m != MAP_FAILED) {
+                        mv.map_base = m;
+                        mv.map_len = len;
+                        mv.ptr = reinterpret_cast<const T*>(static_cast<const char*>(m) + (static_cast<std::size_t>(offset) - base));
+                        mv.n = n;
+                        H5Dclose (dataset_id);
+                        return mv;
+                    }
                 }
             }
+#endif
+            mv.vals.resize (n);
+            herr_t status = n > 0 ? H5Dread (dataset_id, mem_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, mv.vals.data()) : 0;
+            H5Dclose (dataset_id);
+            this->handle_error (status, "Error. status after H5Dread (map_contained_vals): ");
+            mv.ptr = mv.vals.data();
+            mv.n = n;
+            return mv;
         }
 
         //! Read a simple value of type T
         template <typename T>
         void read_val (const char* path, T& val)
         {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::read_val", "io");
             hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+            if (dataset_id < 0) {
+                // It may be a member of its group's batch dataset (see batch_scalars)
+                if constexpr (std::is_same<std::decay_t<T>, bool>::value == true) {
+                    unsigned int uival = 0;
+                    if (this->read_batched (path, H5T_NATIVE_UINT, &uival)) { val = uival > 0; return; }
+                } else if constexpr (HdfData::has_h5_types<T>()) {
+                    hid_t file_type = 0, mem_type = 0;
+                    HdfData::h5_types<T> (file_type, mem_type);
+                    if (this->read_batched (path, mem_type, &val)) { return; }
+                }
+            }
             if (this->check_dataset_id (dataset_id, path) == -1) { return; }
 
             herr_t status = 0;
@@ -687,6 +1476,7 @@ namespace morph {
         void read_string (const char* path, std::string& str)
         {
             hid_t dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+            if (dataset_id < 0 && this->read_batched (path, -1, nullptr, &str)) { return; }
             hid_t space_id = H5Dget_space (dataset_id);
             hsize_t dims[1] = {0};
             int ndims = H5Sget_simple_extent_dims (space_id, dims, NULL);
@@ -725,7 +1515,8 @@ namespace morph {
                 std::string groupstr("");
                 for (unsigned int g = 1; g < numgroups; ++g) {
                     groupstr += "/" + pbits[g];
-                    this->verify_group (groupstr);
+                    // Once verified, a group is not looked up in the file again
+                    if (this->known_groups.insert (groupstr).second == true) { this->verify_group (groupstr); }
                 }
             }
         }
@@ -752,6 +1543,20 @@ namespace morph {
         template <typename T>
         void add_val (const char* path, const T& val)
         {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::add_val", "io");
+            if (this->batch_scalars == true) {
+                if constexpr (std::is_same<typename std::decay<T>::type, bool>::value == true) {
+                    const unsigned int uival = (val == true ? 1 : 0);
+                    this->queue_scalar (path, H5T_STD_U64LE, H5T_NATIVE_UINT, &uival, sizeof (uival));
+                } else if constexpr (HdfData::has_h5_types<T>()) {
+                    hid_t file_type = 0, mem_type = 0;
+                    HdfData::h5_types<T> (file_type, mem_type);
+                    this->queue_scalar (path, file_type, mem_type, &val, sizeof (T));
+                } else {
+                    throw std::runtime_error ("HdfData::add_val<T>: Don't know how to add that type");
+                }
+                return;
+            }
             this->process_groups (path);
             hsize_t dim_singleparam[1];
             dim_singleparam[0] = 1;
@@ -805,6 +1610,10 @@ namespace morph {
         //! Add a string of chars
         void add_string (const char* path, const std::string& str)
         {
+            if (this->batch_scalars == true) {
+                this->queue_scalar (path, -1, -1, str.data(), str.size());
+                return;
+            }
             this->process_groups (path);
             hsize_t dim_singlestring[1];
             dim_singlestring[0] = str.size();
@@ -969,6 +1778,7 @@ namespace morph {
                    typename Allocator=std::allocator<T> >
         void add_contained_vals (const char* path, const Container<T, Allocator>& vals)
         {
+            MORPH_TRACE_SCOPE_CAT ("HdfData::add_contained_vals", "io");
             if (vals.empty()) { return; }
             this->process_groups (path);
 
@@ -1365,6 +2175,186 @@ namespace morph {
             this->add_contained_vals (path, vT);
         }
 
+        /*!
+         * Append vals as a new row of the extendible 2D dataset at path, creating the
+         * dataset if it does not exist. Use this to save a time series of frames (of state
+         * vectors, say) into one dataset of shape [frames, vals.size()], rather than one
+         * file per frame. The dataset is chunked one row per chunk unless chunk_dims gives
+         * a 2D shape, and compressed according to compression. Every row must have the
+         * same length. Read it back with read_contained_vals (path, vvec<vvec<T>>&).
+         *
+         * \return the index of the row that was written
+         */
+        template <typename T>
+        hsize_t append_vals (const char* path, const std::vector<T>& vals)
+        {
+            if (vals.empty()) { throw std::runtime_error ("HdfData::append_vals: Can't append an empty row"); }
+            hid_t file_type = 0;
+            hid_t mem_type = 0;
+            HdfData::h5_types<T> (file_type, mem_type);
+            const hsize_t n = vals.size();
+
+            hid_t dataset_id = -1;
+            hsize_t dims[2] = { 0, n };
+            if (H5Lexists (this->file_id, path, H5P_DEFAULT) > 0) {
+                dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+                if (dataset_id < 0) { throw std::runtime_error (std::string("HdfData::append_vals: Failed to open ") + path); }
+                hid_t space_id = H5Dget_space (dataset_id);
+                int ndims = H5Sget_simple_extent_ndims (space_id);
+                hsize_t maxdims[2] = { 0, 0 };
+                if (ndims == 2) { H5Sget_simple_extent_dims (space_id, dims, maxdims); }
+                H5Sclose (space_id);
+                if (ndims != 2 || dims[1] != n || maxdims[0] != H5S_UNLIMITED) {
+                    H5Dclose (dataset_id);
+                    std::stringstream ee;
+                    ee << "HdfData::append_vals: " << path << " is not an extendible 2D dataset with rows of " << n << " values";
+                    throw std::runtime_error (ee.str());
+                }
+            } else {
+                this->process_groups (path);
+                hsize_t maxdims[2] = { H5S_UNLIMITED, n };
+                hid_t space_id = H5Screate_simple (2, dims, maxdims);
+                // One row per chunk by default
+                const std::vector<hsize_t> rowchunk = { 1, n };
+                hid_t dcpl_id = -1;
+                try {
+                    dcpl_id = this->dataset_create_plist (space_id, this->chunk_dims.size() == 2 ? this->chunk_dims : rowchunk, true);
+                } catch (const std::exception&) {
+                    H5Sclose (space_id);
+                    throw;
+                }
+                dataset_id = H5Dcreate2 (this->file_id, path, file_type, space_id, H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
+                H5Pclose (dcpl_id);
+                H5Sclose (space_id);
+                if (dataset_id < 0) { throw std::runtime_error (std::string("HdfData::append_vals: Failed to create ") + path); }
+            }
+
+            // Grow by one row and write into it
+            const hsize_t row = dims[0];
+            hsize_t newdims[2] = { row + 1, n };
+            herr_t status = H5Dset_extent (dataset_id, newdims);
+            this->handle_error (status, "Error. status after H5Dset_extent: ");
+            hid_t filespace_id = H5Dget_space (dataset_id);
+            hsize_t start[2] = { row, 0 };
+            hsize_t count[2] = { 1, n };
+            status = H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, start, NULL, count, NULL);
+            this->handle_error (status, "Error. status after H5Sselect_hyperslab: ");
+            hid_t memspace_id = H5Screate_simple (2, count, NULL);
+            status = H5Dwrite (dataset_id, mem_type, memspace_id, filespace_id, H5P_DEFAULT, vals.data());
+            this->handle_error (status, "Error. status after H5Dwrite (append): ");
+            status = H5Sclose (memspace_id);
+            this->handle_error (status, "Error. status after H5Sclose: ");
+            status = H5Sclose (filespace_id);
+            this->handle_error (status, "Error. status after H5Sclose: ");
+            status = H5Dclose (dataset_id);
+            this->handle_error (status, "Error. status after H5Dclose: ");
+            return row;
+        }
+
+        /*!
+         * Write vals as this rank's row of the 2D dataset at path, of shape [ranks(),
+         * vals.size()], which is shared by all the ranks of the file's communicator. For
+         * a parameter sweep with one model per rank, this puts every model's state into
+         * one dataset of one file, in place of a file per rank.
+         *
+         * This is collective: every rank must call it, with the same path and the same
+         * number of values. Each rank writes only its own hyperslab, in one collective
+         * MPI-IO write. Uncompressed datasets are contiguous; compressed ones are
+         * chunked one row per chunk unless chunk_dims gives a 2D shape. If the file was
+         * not opened with a communicator, this writes a dataset of one row.
+         */
+        template <typename T>
+        void add_rank_vals (const char* path, const std::vector<T>& vals)
+        {
+            hid_t file_type = 0;
+            hid_t mem_type = 0;
+            HdfData::h5_types<T> (file_type, mem_type);
+            const hsize_t n = vals.size();
+#ifdef BUILD_HDFDATA_WITH_MPI
+            if (this->comm != MPI_COMM_NULL) {
+                // Agree on the row length, so that every rank throws, or none does
+                unsigned long long nlo = n, nhi = n;
+                MPI_Allreduce (MPI_IN_PLACE, &nlo, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, this->comm);
+                MPI_Allreduce (MPI_IN_PLACE, &nhi, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, this->comm);
+                if (nlo != nhi) {
+                    std::stringstream ee;
+                    ee << "HdfData::add_rank_vals: The ranks have between " << nlo << " and " << nhi
+                       << " values to write to " << path << "; they must all have the same number";
+                    throw std::runtime_error (ee.str());
+                }
+            }
+#endif
+            if (n == 0) { return; }
+
+            hsize_t dims[2] = { static_cast<hsize_t>(this->comm_size), n };
+            hid_t dataset_id = -1;
+            if (H5Lexists (this->file_id, path, H5P_DEFAULT) > 0) {
+                dataset_id = H5Dopen2 (this->file_id, path, H5P_DEFAULT);
+                if (dataset_id < 0) { throw std::runtime_error (std::string("HdfData::add_rank_vals: Failed to open ") + path); }
+                this->check_dataset_space_2_dims (dataset_id, dims[0], dims[1]);
+            } else {
+                this->process_groups (path);
+                hid_t space_id = H5Screate_simple (2, dims, NULL);
+                std::vector<hsize_t> chunk = this->chunk_dims;
+                if (chunk.size() != 2) {
+                    chunk.clear();
+                    if (this->compression != Compression::None) { chunk = { 1, n }; }
+                }
+                hid_t dcpl_id = -1;
+                try {
+                    dcpl_id = this->dataset_create_plist (space_id, chunk);
+                } catch (const std::exception&) {
+                    H5Sclose (space_id);
+                    throw;
+                }
+                dataset_id = H5Dcreate2 (this->file_id, path, file_type, space_id, H5P_DEFAULT, dcpl_id, H5P_DEFAULT);
+                if (dcpl_id != H5P_DEFAULT) { H5Pclose (dcpl_id); }
+                H5Sclose (space_id);
+                if (dataset_id < 0) { throw std::runtime_error (std::string("HdfData::add_rank_vals: Failed to create ") + path); }
+            }
+
+            hid_t filespace_id = H5Dget_space (dataset_id);
+            hsize_t start[2] = { static_cast<hsize_t>(this->comm_rank), 0 };
+            hsize_t count[2] = { 1, n };
+            herr_t status = H5Sselect_hyperslab (filespace_id, H5S_SELECT_SET, start, NULL, count, NULL);
+            this->handle_error (status, "Error. status after H5Sselect_hyperslab: ");
+            hid_t memspace_id = H5Screate_simple (2, count, NULL);
+            hid_t dxpl_id = H5P_DEFAULT;
+#ifdef BUILD_HDFDATA_WITH_MPI
+            if (this->comm != MPI_COMM_NULL) {
+                dxpl_id = H5Pcreate (H5P_DATASET_XFER);
+                H5Pset_dxpl_mpio (dxpl_id, H5FD_MPIO_COLLECTIVE);
+            }
+#endif
+            status = H5Dwrite (dataset_id, mem_type, memspace_id, filespace_id, dxpl_id, vals.data());
+            if (dxpl_id != H5P_DEFAULT) { H5Pclose (dxpl_id); }
+            this->handle_error (status, "Error. status after H5Dwrite (rank row): ");
+            status = H5Sclose (memspace_id);
+            this->handle_error (status, "Error. status after H5Sclose: ");
+            status = H5Sclose (filespace_id);
+            this->handle_error (status, "Error. status after H5Sclose: ");
+            status = H5Dclose (dataset_id);
+            this->handle_error (status, "Error. status after H5Dclose: ");
+        }
+
+        /*!
+         * Read one rank's row of a dataset written by add_rank_vals; by default, this
+         * process's own row. Needn't be called on every rank.
+         */
+        template <typename T>
+        void read_rank_vals (const char* path, std::vector<T>& vals, int row = -1)
+        {
+            if (row < 0) { row = this->comm_rank; }
+            std::vector<hsize_t> dims = this->get_dims (path);
+            if (dims.empty()) { return; } // get_dims acted on read_error_action
+            if (dims.size() != 2 || static_cast<hsize_t>(row) >= dims[0]) {
+                std::stringstream ee;
+                ee << "HdfData::read_rank_vals: " << path << " has no row " << row;
+                throw std::runtime_error (ee.str());
+            }
+            this->read_slice (path, { static_cast<hsize_t>(row), 0 }, { 1, dims[1] }, vals);
+        }
+
         //! Add nvals values from the pointer (to doubles) vals.
         void add_ptrarray_vals (const char* path, double*& vals, const unsigned int nvals)
         {
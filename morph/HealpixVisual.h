@@ -1,4 +1,10 @@
 #include <cstdint>
+#include <cmath>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
 #include <morph/VisualModel.h>
 #include <morph/ColourMap.h>
 #include <morph/scale.h>
@@ -33,6 +39,12 @@ namespace morph {
 
         void reinitColours()
         {
+            // In lod mode, the colours are computed on the GPU from the data texture
+            if (this->lod == true) {
+                this->compute_lod_levels();
+                return;
+            }
+
             size_t n_data = this->n_pixels();
 
             if (this->vertexColors.size() < n_data * 3) {
@@ -347,14 +359,15 @@ namespace morph {
             if (this->reliefScale.do_autoscale == true) { this->reliefScale.reset(); }
             this->reliefScale.transform (this->pixeldata, scaled_relief);
 
-            // The first loop creates all the *vertices* using nest scheme.
+            // The first loop creates all the *vertices* using nest scheme. Find the locations
+            // of all the pixels in one batch conversion first.
             int64_t n_p = this->n_pixels();
+            std::vector<int64_t> nest (n_p);
+            for (int64_t p = 0; p < n_p; ++p) { nest[p] = p; }
+            std::vector<hp::t_vec> pvs (n_p);
+            hp::nest2vec (hp::ring_table (this->nside), nest, pvs);
             for (int64_t p = 0; p < n_p; ++p) {
-                // Convert nest index p to angle for this pixel
-                hp::t_ang ang = hp::nest2ang (this->nside, p);
-
-                // Find the location of the pixel
-                hp::t_vec pv = hp::loc2vec (hp::ang2loc (ang));
+                const hp::t_vec& pv = pvs[p];
                 // Convert it into a morph::vec and modify according to radius and relief
                 float _r = this->r;
                 if (this->relief == true) { _r += scaled_relief[p]; }
@@ -420,11 +433,302 @@ namespace morph {
             this->idx += n_p;
         }
 
+        /*
+         * In lod mode, build the data texture levels from pixeldata. Level 0 holds the map at
+         * order k. The 12 faces are laid out in a 4 x 3 grid of nside x nside blocks (face f at
+         * column f % 4 and row f / 4), with pixel (x, y) of a face at texel (x, y) of its block.
+         * Level l is the map at order k - l: as the NESTed children of a pixel are the 2 x 2
+         * block of texels at (2x, 2y) in the level above, each texel is the mean of those four,
+         * and each level is a mipmap of the one above. The upload happens in render_geometry.
+         */
+        void compute_lod_levels()
+        {
+            if constexpr (!std::is_floating_point<std::decay_t<T>>::value) {
+                throw std::runtime_error ("HealpixVisual: lod mode requires floating point pixeldata");
+            } else {
+                if (this->colourScale.getType() != morph::scaling_function::Linear) {
+                    throw std::runtime_error ("HealpixVisual: lod mode requires a linear colourScale");
+                }
+                if (this->cm.numDatums() != 1) {
+                    throw std::runtime_error ("HealpixVisual: lod mode requires a one dimensional colour map");
+                }
+                if (this->colourScale.do_autoscale == true) {
+                    this->colourScale.reset();
+                    this->colourScale.compute_scaling_from_data (this->pixeldata);
+                } else if (!this->colourScale.ready()) {
+                    throw std::runtime_error ("HealpixVisual: colourScale params are not set and do_autoscale is false");
+                }
+                this->data_tex_scale = { static_cast<float>(this->colourScale.getParams(0)),
+                                         static_cast<float>(this->colourScale.getParams(1)) };
+
+                this->lod_levels.resize (this->k + 1);
+                const int64_t w = 4 * this->nside;
+                this->lod_levels[0].resize (12 * this->nside * this->nside);
+                const int64_t n_p = this->n_pixels();
+#pragma omp parallel for
+                for (int64_t p = 0; p < n_p; ++p) {
+                    const hp::t_hpd xyf = hp::nest2hpd (this->nside, p);
+                    const int64_t tx = (xyf.f % 4) * this->nside + xyf.x;
+                    const int64_t ty = (xyf.f / 4) * this->nside + xyf.y;
+                    this->lod_levels[0][ty * w + tx] = static_cast<float>(this->pixeldata[p]);
+                }
+                for (int64_t l = 1; l <= this->k; ++l) {
+                    const int64_t lw = w >> l;
+                    const int64_t lh = (3 * this->nside) >> l;
+                    const std::vector<float>& up = this->lod_levels[l - 1];
+                    std::vector<float>& down = this->lod_levels[l];
+                    down.resize (lw * lh);
+#pragma omp parallel for
+                    for (int64_t y = 0; y < lh; ++y) {
+                        const float* r0 = up.data() + (2 * y) * (2 * lw);
+                        const float* r1 = r0 + 2 * lw;
+                        for (int64_t x = 0; x < lw; ++x) {
+                            down[y * lw + x] = 0.25f * (r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1]);
+                        }
+                    }
+                }
+                this->lod_lut.resize (3 * this->lod_lut_size);
+                for (unsigned int i = 0; i < this->lod_lut_size; ++i) {
+                    std::array<float, 3> c = this->cm.convert (static_cast<T>(i) / static_cast<T>(this->lod_lut_size - 1));
+                    std::copy (c.begin(), c.end(), this->lod_lut.begin() + 3 * i);
+                }
+                this->lod_tex_dirty = true;
+            }
+        }
+
+        /*
+         * In lod mode, the sphere is drawn as the tiles that are the pixels of order b (the
+         * lesser of lod_tile_order and k). Tile t is a mesh of (2^(m_t - b) + 1)^2 vertices, at
+         * the corners of its NESTed children of order m_t. The vertex 'colours' are positions in
+         * the data texture (see compute_lod_levels), with a negative blue component so that
+         * the default shader colours each fragment from the texel it falls in, and the texture
+         * is mipmapped over the NESTed orders. Updating the colours of the map never touches
+         * the vertices.
+         *
+         * Where two tiles of different mesh orders meet, the vertices of the finer tile along
+         * their shared edge are moved onto the coarser tile's edge, so there are no cracks.
+         */
+        void healpix_lod_mesh()
+        {
+            const int64_t b = std::min (this->lod_tile_order, this->k);
+            const int64_t nb = 1LL << b;
+            const double xnb = 1.0 / static_cast<double>(nb);
+            const int64_t n_tiles = 12 * nb * nb;
+            if (this->lod_tile_m.size() != static_cast<std::size_t>(n_tiles)) {
+                this->lod_tile_m.assign (n_tiles, static_cast<int8_t>(this->lod_min_mesh_order()));
+            }
+            // Each tile's first vertex and first index, so the tiles can be meshed in parallel
+            std::vector<int64_t> v0 (n_tiles + 1, 0);
+            std::vector<int64_t> i0 (n_tiles + 1, 0);
+            for (int64_t t = 0; t < n_tiles; ++t) {
+                const int64_t n = 1LL << (this->lod_tile_m[t] - b);
+                v0[t + 1] = v0[t] + (n + 1) * (n + 1);
+                i0[t + 1] = i0[t] + 6 * n * n;
+            }
+            const std::size_t vbase = this->vertexPositions.size();
+            const std::size_t ibase = this->indices.size();
+            this->vertexPositions.resize (vbase + 3 * v0[n_tiles]);
+            this->vertexNormals.resize (vbase + 3 * v0[n_tiles]);
+            this->vertexColors.resize (vbase + 3 * v0[n_tiles]);
+            this->indices.resize (ibase + i0[n_tiles]);
+#pragma omp parallel
+            {
+                std::vector<morph::vec<double>> p;
+                std::vector<morph::vec<double, 2>> uv;
+#pragma omp for schedule(dynamic)
+                for (int64_t t = 0; t < n_tiles; ++t) {
+                    const hp::t_hpd xyf = hp::nest2hpd (nb, t);
+                    const int64_t m = this->lod_tile_m[t];
+                    const int64_t n = 1LL << (m - b);
+                    const double xn = 1.0 / static_cast<double>(n);
+                    const int64_t row = n + 1;
+                    p.resize (row * row);
+                    uv.resize (row * row);
+                    for (int64_t j = 0; j <= n; ++j) {
+                        for (int64_t i = 0; i <= n; ++i) {
+                            const double fx = (static_cast<double>(xyf.x) + i * xn) * xnb;
+                            const double fy = (static_cast<double>(xyf.y) + j * xn) * xnb;
+                            hp::t_vec pv = hp::loc2vec (hp::hpc2loc (hp::t_hpc{ fx, fy, xyf.f }));
+                            p[j * row + i] = { pv.x, pv.y, pv.z };
+                            uv[j * row + i] = { (static_cast<double>(xyf.f % 4) + fx) / 4.0, (static_cast<double>(xyf.f / 4) + fy) / 3.0 };
+                        }
+                    }
+                    // Move the vertices of edges shared with coarser tiles onto those tiles' edges.
+                    // Edges 0 and 1 are at i = 0 and i = n; edges 2 and 3 at j = 0 and j = n.
+                    for (int e = 0; e < 4; ++e) {
+                        const int64_t m_nb = this->lod_tile_m[this->lod_tile_nb[t][e]];
+                        if (m_nb >= m) { continue; }
+                        const int64_t s = 1LL << (m - m_nb);
+                        auto at = [e, n, row](const int64_t a) {
+                            if (e < 2) { return (a * row) + (e == 0 ? 0 : n); }
+                            return (e == 2 ? 0 : n * row) + a;
+                        };
+                        for (int64_t a = 0; a < n; a += s) {
+                            const int64_t a0 = at (a);
+                            const int64_t a1 = at (a + s);
+                            for (int64_t q = 1; q < s; ++q) {
+                                const double w = static_cast<double>(q) / static_cast<double>(s);
+                                p[at (a + q)] = p[a0] * (1.0 - w) + p[a1] * w;
+                                uv[at (a + q)] = uv[a0] * (1.0 - w) + uv[a1] * w;
+                            }
+                        }
+                    }
+                    float* vp = this->vertexPositions.data() + vbase + 3 * v0[t];
+                    float* vn = this->vertexNormals.data() + vbase + 3 * v0[t];
+                    float* vc = this->vertexColors.data() + vbase + 3 * v0[t];
+                    for (int64_t v = 0; v < row * row; ++v) {
+                        morph::vec<float> pf = p[v].as_float();
+                        const morph::vec<float> pr = pf * this->r;
+                        pf.renormalize();
+                        std::copy (pr.begin(), pr.end(), vp + 3 * v);
+                        std::copy (pf.begin(), pf.end(), vn + 3 * v);
+                        // A negative blue component tells the shader to colour from the data texture
+                        vc[3 * v] = static_cast<float>(uv[v][0]);
+                        vc[3 * v + 1] = static_cast<float>(uv[v][1]);
+                        vc[3 * v + 2] = -1.0f;
+                    }
+                    GLuint* ip = this->indices.data() + ibase + i0[t];
+                    for (int64_t j = 0; j < n; ++j) {
+                        for (int64_t i = 0; i < n; ++i) {
+                            GLuint c0 = this->idx + static_cast<GLuint>(v0[t] + j * row + i);
+                            GLuint c1 = c0 + 1;
+                            GLuint c2 = c0 + static_cast<GLuint>(row);
+                            GLuint c3 = c2 + 1;
+                            *ip++ = c0; *ip++ = c1; *ip++ = c3;
+                            *ip++ = c0; *ip++ = c3; *ip++ = c2;
+                        }
+                    }
+                }
+            }
+            this->idx += static_cast<GLuint>(v0[n_tiles]);
+        }
+
+        // The coarsest mesh order of a tile in lod mode
+        int64_t lod_min_mesh_order() const
+        {
+            return std::clamp (this->lod_mesh_order, std::min (this->lod_tile_order, this->k), this->k);
+        }
+
+        // In lod mode, find the centre, size and edge neighbours of each tile
+        void lod_tiles_init()
+        {
+            const int64_t b = std::min (this->lod_tile_order, this->k);
+            const int64_t nb = 1LL << b;
+            const double xnb = 1.0 / static_cast<double>(nb);
+            const int64_t n_tiles = 12 * nb * nb;
+            this->lod_tile_centre.resize (n_tiles);
+            this->lod_tile_radius.resize (n_tiles);
+            this->lod_tile_nb.resize (n_tiles);
+            this->lod_tile_m.assign (n_tiles, static_cast<int8_t>(this->lod_min_mesh_order()));
+            auto point = [xnb](const hp::t_hpd& xyf, const double dx, const double dy) {
+                hp::t_vec pv = hp::loc2vec (hp::hpc2loc (hp::t_hpc{ (xyf.x + dx) * xnb, (xyf.y + dy) * xnb, xyf.f }));
+                return morph::vec<double>{ pv.x, pv.y, pv.z };
+            };
+            for (int64_t t = 0; t < n_tiles; ++t) {
+                const hp::t_hpd xyf = hp::nest2hpd (nb, t);
+                const morph::vec<double> c = point (xyf, 0.5, 0.5);
+                this->lod_tile_centre[t] = c.as_float();
+                double rad = 0.0;
+                for (double dx : { 0.0, 1.0 }) {
+                    for (double dy : { 0.0, 1.0 }) { rad = std::max (rad, (point (xyf, dx, dy) - c).length()); }
+                }
+                this->lod_tile_radius[t] = static_cast<float>(rad);
+                // The neighbour across each edge holds a point just beyond the edge's middle
+                constexpr double mids[4][2] = { { 0.0, 0.5 }, { 1.0, 0.5 }, { 0.5, 0.0 }, { 0.5, 1.0 } };
+                for (int e = 0; e < 4; ++e) {
+                    const morph::vec<double> pm = point (xyf, mids[e][0], mids[e][1]);
+                    const morph::vec<double> po = pm + (pm - c) * 1e-3;
+                    this->lod_tile_nb[t][e] = static_cast<int32_t>(hp::vec2nest (nb, hp::t_vec{ po[0], po[1], po[2] }));
+                }
+            }
+        }
+
+        /*
+         * In lod mode, choose the mesh order of each tile for a view from the point eye (in
+         * model coordinates). Each tile is refined to the order j at which the map's pixels
+         * subtend lod_pixel_angle from the nearest point of its bounding sphere, and no further
+         * than k. Tiles beyond the horizon are left at the coarsest order. As the mesh follows the order that is seen, the texture coordinates, which
+         * are interpolated linearly across each triangle, stay within a small fraction of a
+         * texel of the true HEALPix pixel. Returns true if any tile's order changed.
+         */
+        bool lod_choose_orders (const morph::vec<float>& eye)
+        {
+            const int64_t m_min = this->lod_min_mesh_order();
+            // The angular size of the pixels of order 0 on a sphere of radius r, sqrt (pi/3) r
+            const float a0 = 1.0233267f * this->r;
+            // Tiles wholly beyond the horizon stay at m_min (there is no horizon from inside)
+            const float el = eye.length();
+            const float horizon = el > this->r ? std::acos (this->r / el) : 0.0f;
+            bool changed = false;
+            for (std::size_t t = 0; t < this->lod_tile_m.size(); ++t) {
+                int64_t m = m_min;
+                bool visible = el <= this->r;
+                if (!visible) {
+                    const float ang = std::acos (std::clamp (this->lod_tile_centre[t].dot (eye) / el, -1.0f, 1.0f));
+                    visible = ang - 2.0f * std::asin (0.5f * this->lod_tile_radius[t]) < horizon;
+                }
+                if (visible) {
+                    const float d = std::max ((eye - this->lod_tile_centre[t] * this->r).length()
+                                              - this->lod_tile_radius[t] * this->r, 1e-4f * this->r);
+                    const float j = std::ceil (std::log2 (a0 / (this->lod_pixel_angle * d)));
+                    m = std::clamp (static_cast<int64_t>(std::max (j, 0.0f)), m_min, this->k);
+                }
+                if (m != this->lod_tile_m[t]) {
+                    this->lod_tile_m[t] = static_cast<int8_t>(m);
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        //! True if, in lod mode, the data texture is waiting to be uploaded by render_geometry()
+        bool render_pending() const override
+        {
+            return (this->lod == true && this->lod_tex_dirty == true) || morph::VisualModel<glver>::render_pending();
+        }
+
+        /*
+         * In lod mode, re-choose the tiles' mesh orders for the current view (rebuilding the
+         * mesh if they changed) and upload the data texture if it has changed, then draw
+         */
+        void render_geometry() override
+        {
+            if (this->lod == true && this->hidden() == false && !this->lod_tile_m.empty() && !this->build_running()) {
+                morph::mat44<float> mv = this->scenematrix * this->model_scaling * this->viewmatrix;
+                const morph::vec<float, 4> e4 = mv.invert() * morph::vec<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f };
+                if (this->lod_choose_orders (e4.less_one_dim() / e4[3])) {
+                    this->vertexPositions.clear();
+                    this->vertexNormals.clear();
+                    this->vertexColors.clear();
+                    this->indices.clear();
+                    this->idx = 0u;
+                    this->healpix_lod_mesh();
+                    if (this->indicate_axes == true) { this->draw_coordaxes(); }
+                    this->reinit_buffers();
+                }
+                if (this->lod_tex_dirty == true) {
+                    std::vector<const float*> levels (this->lod_levels.size());
+                    for (std::size_t l = 0; l < levels.size(); ++l) { levels[l] = this->lod_levels[l].data(); }
+                    this->upload_data_texture (levels, 4 * this->nside, 3 * this->nside, this->lod_lut);
+                    this->lod_tex_dirty = false;
+                }
+            }
+            morph::VisualModel<glver>::render_geometry();
+        }
+
         void initializeVertices()
         {
             if (this->pixeldata.size() != static_cast<uint64_t>(this->n_pixels())) {
                 this->pixeldata.resize (this->n_pixels(), 0.0f);
             }
+            if (this->lod == true) {
+                if (this->relief == true) { throw std::runtime_error ("HealpixVisual: relief is not available in lod mode"); }
+                this->compute_lod_levels();
+                this->lod_tiles_init();
+                this->healpix_lod_mesh();
+                if (this->indicate_axes == true) { this->draw_coordaxes(); }
+                return;
+            }
             if (this->k == 0 || this->show_face_spheres) { this->face_spheres(); }
             if (this->k == 0) { return; }
             this->healpix_triangles_by_nest();
@@ -513,10 +817,45 @@ namespace morph {
         // Show a little coordinate axes set indicating directions?
         bool indicate_axes = false;
 
+        /*
+         * Draw the map from a mipmapped data texture on a view dependent mesh, rather than
+         * with one vertex per pixel (see healpix_lod_mesh). This is the way to show high order
+         * maps: at order 10 (nside 1024, 12.6 M pixels) a view of the whole sphere from three radii
+         * away needs some 140 000 vertices, and the mesh is refined only where the view comes close. pixeldata must be floating point, colourScale linear and cm one
+         * dimensional. Not available with relief or the face and vertex spheres. Set before
+         * finalize().
+         */
+        bool lod = false;
+
+        // In lod mode, the order of the tiles that are meshed at their own orders
+        int64_t lod_tile_order = 4;
+
+        // In lod mode, the coarsest order of the mesh. There is one vertex per pixel at this order.
+        int64_t lod_mesh_order = 6;
+
+        // In lod mode, the angle (radians) that a pixel of the mesh may subtend at the eye
+        float lod_pixel_angle = 0.004f;
+
+        // In lod mode, how many colours are sampled from cm for the shader's colour table
+        unsigned int lod_lut_size = 256;
+
     private:
         // How many sides for the healpix? This is a choice of the user. Default to 3.
         int64_t k = 3; // k is the 'order'
         int64_t nside = 1 << k;
+
+        // In lod mode, the levels of the data texture, from order k down to order 0
+        std::vector<std::vector<float>> lod_levels;
+        // In lod mode, the colour table sampled from cm
+        std::vector<float> lod_lut;
+        // Set when the data texture needs to be uploaded again
+        bool lod_tex_dirty = false;
+        // In lod mode, the unit vector to the centre of each tile and the chord to its furthest corner
+        std::vector<morph::vec<float>> lod_tile_centre;
+        std::vector<float> lod_tile_radius;
+        // In lod mode, the tiles across the edges of each tile (see healpix_lod_mesh) and each tile's mesh order
+        std::vector<std::array<int32_t, 4>> lod_tile_nb;
+        std::vector<int8_t> lod_tile_m;
     };
 
 } // namespace morph
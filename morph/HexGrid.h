@@ -17,15 +17,22 @@
 #include <morph/MathAlgo.h>
 #include <morph/debug.h>
 #include <morph/mat22.h>
+#include <morph/kd_tree.h>
+#include <morph/shift_operator.h>
+#include <morph/memory_usage.h>
+#include <morph/fnv1a.h>
 
 // If the HexGrid::save and HexGrid::load methods are required, define
 // HEXGRID_COMPILE_LOAD_AND_SAVE. A link to libhdf5 will be required in your program.
 #ifdef HEXGRID_COMPILE_LOAD_AND_SAVE
 # include <morph/HdfData.h>
+# include <filesystem>
 #endif
 
 #include <set>
 #include <list>
+#include <algorithm>
+#include <utility>
 #include <string>
 #include <array>
 #include <stdexcept>
@@ -36,9 +43,25 @@
 #include <vector>
 #include <stdexcept>
 #include <limits>
+#include <iomanip>
+#include <iterator>
+#include <unordered_map>
+#include <span>
 
 namespace morph {
 
+    /*!
+     * The order in which a HexGrid numbers its hexes. This sets the order of the
+     * hexes in HexGrid::hexen, the Hex::vi indices and therefore the order of the d_
+     * vectors and of any client data indexed by Hex::vi.
+     */
+    enum class HexGridOrder
+    {
+        list,    // Order of construction; a spiral out from the central hex (by rows for HexGrid::initFromBoundary)
+        morton,  // Along a Morton (Z-order) curve through the hexes' axial coordinates
+        hilbert  // Along a Hilbert curve through the axial coordinates. Best memory locality.
+    };
+
     /*!
      * This class is used to build an hexagonal grid of hexagons. The member hexagons
      * are all arranged with a vertex pointing vertically - "point up". The extent of
@@ -133,6 +156,15 @@ namespace morph {
         unsigned int d_growthbuffer_horz = 0;
         unsigned int d_growthbuffer_vert = 0;
 
+        /*!
+         * The order in which hexes are numbered. If this is set to something other than
+         * HexGridOrder::list before a boundary is applied, then the hexes are sorted
+         * along a space-filling curve when they are renumbered, so that neighbouring
+         * hexes tend to be close together in the d_ vectors. To reorder a grid that is
+         * already set up, call reorder().
+         */
+        HexGridOrder hexorder = HexGridOrder::list;
+
         //! Add entries to all the d_ vectors for the Hex pointed to by hi.
         void d_push_back (std::list<Hex>::iterator hi)
         {
@@ -211,6 +243,7 @@ namespace morph {
             this->d_gi.clear();
             this->d_bi.clear();
             this->d_flags.clear();
+            this->d_distToBoundary.clear();
         }
 
 #ifdef HEXGRID_COMPILE_LOAD_AND_SAVE
@@ -230,6 +263,7 @@ namespace morph {
             hgdata.add_val ("/d_size", d_size);
             hgdata.add_val ("/d_growthbuffer_horz", d_growthbuffer_horz);
             hgdata.add_val ("/d_growthbuffer_vert", d_growthbuffer_vert);
+            hgdata.add_val ("/hexorder", static_cast<unsigned int>(hexorder));
 
             // morph::vec<float, 2>
             hgdata.add_contained_vals ("/boundaryCentroid", boundaryCentroid);
@@ -294,6 +328,15 @@ namespace morph {
             hgdata.read_val ("/d_size", this->d_size);
             hgdata.read_val ("/d_growthbuffer_horz", this->d_growthbuffer_horz);
             hgdata.read_val ("/d_growthbuffer_vert", this->d_growthbuffer_vert);
+            // Files written before hexorder was introduced have no /hexorder; they are in list order
+            {
+                unsigned int _hexorder = static_cast<unsigned int>(HexGridOrder::list);
+                morph::ReadErrorAction rea = hgdata.read_error_action;
+                hgdata.read_error_action = morph::ReadErrorAction::Continue;
+                hgdata.read_val ("/hexorder", _hexorder);
+                hgdata.read_error_action = rea;
+                this->hexorder = static_cast<HexGridOrder>(_hexorder);
+            }
 
             hgdata.read_contained_vals ("/boundaryCentroid", this->boundaryCentroid);
             hgdata.read_contained_vals ("/d_x", this->d_x);
@@ -323,115 +366,381 @@ namespace morph {
             }
 
             // After creating hexen list, need to set neighbour relations in each Hex, as loaded in d_ne,
-            // etc.
+            // etc. Look the neighbours up by vector index, rather than searching hexen for each one.
+            std::vector<std::list<morph::Hex>::iterator> byvi;
+            for (auto hi = this->hexen.begin(); hi != this->hexen.end(); ++hi) {
+                if (hi->vi >= byvi.size()) { byvi.resize (hi->vi + 1, this->hexen.end()); }
+                byvi[hi->vi] = hi;
+            }
+            auto neighbour = [this, &byvi](int ni, const char* dirn) {
+                if (ni < 0 || static_cast<unsigned int>(ni) >= byvi.size() || byvi[ni] == this->hexen.end()) {
+                    throw std::runtime_error (std::string("Failed to match hexen neighbour ") + dirn + " relation...");
+                }
+                return byvi[ni];
+            };
             for (morph::Hex& _h : this->hexen) {
                 DBG ("Set neighbours for Hex " << _h.outputRG());
-                // For each Hex, six loops through hexen:
-                if (_h.has_ne() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_ne[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.ne = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour E relation...");
-                    }
-                }
+                if (_h.has_ne() == true) { _h.ne = neighbour (this->d_ne[_h.vi], "E"); }
+                if (_h.has_nne() == true) { _h.nne = neighbour (this->d_nne[_h.vi], "NE"); }
+                if (_h.has_nnw() == true) { _h.nnw = neighbour (this->d_nnw[_h.vi], "NW"); }
+                if (_h.has_nw() == true) { _h.nw = neighbour (this->d_nw[_h.vi], "W"); }
+                if (_h.has_nsw() == true) { _h.nsw = neighbour (this->d_nsw[_h.vi], "SW"); }
+                if (_h.has_nse() == true) { _h.nse = neighbour (this->d_nse[_h.vi], "SE"); }
+            }
+        }
 
-                if (_h.has_nne() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nne[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nne = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour NE relation...");
-                    }
-                }
+        /*!
+         * Save this HexGrid into the HDF5 file at \a path in a flat form: one array per Hex
+         * attribute (in the order of hexen) and one per neighbour direction, as well as
+         * the d_ vectors. Unlike save(), which writes a group for every Hex, this is a
+         * few large contiguous datasets, and loadCache() reads it back in time linear in
+         * the number of hexes.
+         */
+        void saveCache (const std::string& path, const unsigned long long int key = 0) const
+        {
+            const std::size_t n = this->hexen.size();
+            std::vector<unsigned int> h_vi, h_di, h_flags;
+            std::vector<float> h_x, h_y, h_z, h_r, h_phi, h_dist;
+            std::vector<int> h_ri, h_gi, h_bi;
+            for (auto* vp : { &h_vi, &h_di, &h_flags }) { vp->reserve (n); }
+            for (auto* vp : { &h_x, &h_y, &h_z, &h_r, &h_phi, &h_dist }) { vp->reserve (n); }
+            for (auto* vp : { &h_ri, &h_gi, &h_bi }) { vp->reserve (n); }
+            // Neighbours are recorded as positions in hexen, or -1 for none
+            std::unordered_map<const Hex*, int> pos;
+            pos.reserve (n);
+            for (const morph::Hex& h : this->hexen) { pos[&h] = static_cast<int>(pos.size()); }
+            std::array<std::vector<int>, 6> h_nb;
+            for (auto& nb : h_nb) { nb.reserve (n); }
+            for (const morph::Hex& h : this->hexen) {
+                h_vi.push_back (h.vi);
+                h_di.push_back (h.di);
+                h_x.push_back (h.x);
+                h_y.push_back (h.y);
+                h_z.push_back (h.z);
+                h_r.push_back (h.r);
+                h_phi.push_back (h.phi);
+                h_ri.push_back (h.ri);
+                h_gi.push_back (h.gi);
+                h_bi.push_back (h.bi);
+                h_dist.push_back (h.distToBoundary);
+                h_flags.push_back (h.getFlags());
+                h_nb[0].push_back (h.has_ne() ? pos.at (&(*h.ne)) : -1);
+                h_nb[1].push_back (h.has_nne() ? pos.at (&(*h.nne)) : -1);
+                h_nb[2].push_back (h.has_nnw() ? pos.at (&(*h.nnw)) : -1);
+                h_nb[3].push_back (h.has_nw() ? pos.at (&(*h.nw)) : -1);
+                h_nb[4].push_back (h.has_nsw() ? pos.at (&(*h.nsw)) : -1);
+                h_nb[5].push_back (h.has_nse() ? pos.at (&(*h.nse)) : -1);
+            }
 
-                if (_h.has_nnw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nnw[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nnw = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour NW relation...");
-                    }
-                }
+            morph::HdfData hgdata (path);
+            hgdata.add_val ("/cache_format", HexGrid::cache_format);
+            hgdata.add_val ("/cache_key", key);
+            hgdata.add_val ("/d", this->d);
+            hgdata.add_val ("/v", this->v);
+            hgdata.add_val ("/x_span", this->x_span);
+            hgdata.add_val ("/z", this->z);
+            hgdata.add_val ("/d_rowlen", this->d_rowlen);
+            hgdata.add_val ("/d_numrows", this->d_numrows);
+            hgdata.add_val ("/d_size", this->d_size);
+            hgdata.add_val ("/d_growthbuffer_horz", this->d_growthbuffer_horz);
+            hgdata.add_val ("/d_growthbuffer_vert", this->d_growthbuffer_vert);
+            hgdata.add_val ("/hexorder", static_cast<unsigned int>(this->hexorder));
+            hgdata.add_val ("/gridReduced", static_cast<unsigned int>(this->gridReduced));
+            hgdata.add_contained_vals ("/boundaryCentroid", this->boundaryCentroid);
+            hgdata.add_contained_vals ("/originalBoundaryCentroid", this->originalBoundaryCentroid);
+
+            hgdata.add_val ("/hcount", static_cast<unsigned int>(n));
+            hgdata.add_contained_vals ("/h/vi", h_vi);
+            hgdata.add_contained_vals ("/h/di", h_di);
+            hgdata.add_contained_vals ("/h/x", h_x);
+            hgdata.add_contained_vals ("/h/y", h_y);
+            hgdata.add_contained_vals ("/h/z", h_z);
+            hgdata.add_contained_vals ("/h/r", h_r);
+            hgdata.add_contained_vals ("/h/phi", h_phi);
+            hgdata.add_contained_vals ("/h/ri", h_ri);
+            hgdata.add_contained_vals ("/h/gi", h_gi);
+            hgdata.add_contained_vals ("/h/bi", h_bi);
+            hgdata.add_contained_vals ("/h/distToBoundary", h_dist);
+            hgdata.add_contained_vals ("/h/flags", h_flags);
+            hgdata.add_contained_vals ("/h/ne", h_nb[0]);
+            hgdata.add_contained_vals ("/h/nne", h_nb[1]);
+            hgdata.add_contained_vals ("/h/nnw", h_nb[2]);
+            hgdata.add_contained_vals ("/h/nw", h_nb[3]);
+            hgdata.add_contained_vals ("/h/nsw", h_nb[4]);
+            hgdata.add_contained_vals ("/h/nse", h_nb[5]);
+
+            hgdata.add_contained_vals ("/d_x", this->d_x);
+            hgdata.add_contained_vals ("/d_y", this->d_y);
+            hgdata.add_contained_vals ("/d_distToBoundary", this->d_distToBoundary);
+            hgdata.add_contained_vals ("/d_ri", this->d_ri);
+            hgdata.add_contained_vals ("/d_gi", this->d_gi);
+            hgdata.add_contained_vals ("/d_bi", this->d_bi);
+            hgdata.add_contained_vals ("/d_ne", this->d_ne);
+            hgdata.add_contained_vals ("/d_nne", this->d_nne);
+            hgdata.add_contained_vals ("/d_nnw", this->d_nnw);
+            hgdata.add_contained_vals ("/d_nw", this->d_nw);
+            hgdata.add_contained_vals ("/d_nsw", this->d_nsw);
+            hgdata.add_contained_vals ("/d_nse", this->d_nse);
+            hgdata.add_contained_vals ("/d_flags", this->d_flags);
+        }
 
-                if (_h.has_nw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nw[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nw = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour W relation...");
-                    }
+        /*!
+         * Replace this HexGrid with the one saved by saveCache() in the file at \a
+         * path. If \a key is non-zero, the file must have been saved with the same key.
+         * Returns false, leaving the HexGrid unchanged, if the file can't be read or
+         * doesn't match.
+         */
+        bool loadCache (const std::string& path, const unsigned long long int key = 0)
+        {
+            if (!std::filesystem::exists (path)) { return false; }
+            try {
+                morph::HdfData hgdata (path, morph::FileAccess::ReadOnly);
+                hgdata.read_error_action = morph::ReadErrorAction::Exception;
+                unsigned int fmt = 0;
+                unsigned long long int filekey = 0;
+                hgdata.read_val ("/cache_format", fmt);
+                hgdata.read_val ("/cache_key", filekey);
+                if (fmt != HexGrid::cache_format || (key != 0 && filekey != key)) { return false; }
+
+                unsigned int hcount = 0, _hexorder = 0, _gridReduced = 0;
+                std::vector<unsigned int> h_vi, h_di, h_flags;
+                std::vector<float> h_x, h_y, h_z, h_r, h_phi, h_dist;
+                std::vector<int> h_ri, h_gi, h_bi;
+                std::array<std::vector<int>, 6> h_nb;
+                hgdata.read_val ("/hcount", hcount);
+                hgdata.read_contained_vals ("/h/vi", h_vi);
+                hgdata.read_contained_vals ("/h/di", h_di);
+                hgdata.read_contained_vals ("/h/x", h_x);
+                hgdata.read_contained_vals ("/h/y", h_y);
+                hgdata.read_contained_vals ("/h/z", h_z);
+                hgdata.read_contained_vals ("/h/r", h_r);
+                hgdata.read_contained_vals ("/h/phi", h_phi);
+                hgdata.read_contained_vals ("/h/ri", h_ri);
+                hgdata.read_contained_vals ("/h/gi", h_gi);
+                hgdata.read_contained_vals ("/h/bi", h_bi);
+                hgdata.read_contained_vals ("/h/distToBoundary", h_dist);
+                hgdata.read_contained_vals ("/h/flags", h_flags);
+                hgdata.read_contained_vals ("/h/ne", h_nb[0]);
+                hgdata.read_contained_vals ("/h/nne", h_nb[1]);
+                hgdata.read_contained_vals ("/h/nnw", h_nb[2]);
+                hgdata.read_contained_vals ("/h/nw", h_nb[3]);
+                hgdata.read_contained_vals ("/h/nsw", h_nb[4]);
+                hgdata.read_contained_vals ("/h/nse", h_nb[5]);
+                float _d = 0.0f, _v = 0.0f, _x_span = 0.0f, _z = 0.0f;
+                unsigned int _d_rowlen = 0, _d_numrows = 0, _d_size = 0, _d_gb_horz = 0, _d_gb_vert = 0;
+                morph::vec<float, 2> _bcentroid = { 0.0f, 0.0f };
+                morph::vec<float, 2> _obcentroid = { 0.0f, 0.0f };
+                hgdata.read_val ("/d", _d);
+                hgdata.read_val ("/v", _v);
+                hgdata.read_val ("/x_span", _x_span);
+                hgdata.read_val ("/z", _z);
+                hgdata.read_val ("/d_rowlen", _d_rowlen);
+                hgdata.read_val ("/d_numrows", _d_numrows);
+                hgdata.read_val ("/d_size", _d_size);
+                hgdata.read_val ("/d_growthbuffer_horz", _d_gb_horz);
+                hgdata.read_val ("/d_growthbuffer_vert", _d_gb_vert);
+                hgdata.read_val ("/hexorder", _hexorder);
+                hgdata.read_val ("/gridReduced", _gridReduced);
+                hgdata.read_contained_vals ("/boundaryCentroid", _bcentroid);
+                hgdata.read_contained_vals ("/originalBoundaryCentroid", _obcentroid);
+
+                std::vector<float> _d_x, _d_y, _d_dist;
+                std::vector<int> _d_ri, _d_gi, _d_bi;
+                std::array<std::vector<int>, 6> _d_nb;
+                std::vector<unsigned int> _d_flags;
+                hgdata.read_contained_vals ("/d_x", _d_x);
+                hgdata.read_contained_vals ("/d_y", _d_y);
+                hgdata.read_contained_vals ("/d_distToBoundary", _d_dist);
+                hgdata.read_contained_vals ("/d_ri", _d_ri);
+                hgdata.read_contained_vals ("/d_gi", _d_gi);
+                hgdata.read_contained_vals ("/d_bi", _d_bi);
+                hgdata.read_contained_vals ("/d_ne", _d_nb[0]);
+                hgdata.read_contained_vals ("/d_nne", _d_nb[1]);
+                hgdata.read_contained_vals ("/d_nnw", _d_nb[2]);
+                hgdata.read_contained_vals ("/d_nw", _d_nb[3]);
+                hgdata.read_contained_vals ("/d_nsw", _d_nb[4]);
+                hgdata.read_contained_vals ("/d_nse", _d_nb[5]);
+                hgdata.read_contained_vals ("/d_flags", _d_flags);
+
+                for (auto* vp : { &h_vi, &h_di, &h_flags }) { if (vp->size() != hcount) { return false; } }
+                for (auto* vp : { &h_x, &h_y, &h_z, &h_r, &h_phi, &h_dist }) { if (vp->size() != hcount) { return false; } }
+                for (auto* vp : { &h_ri, &h_gi, &h_bi }) { if (vp->size() != hcount) { return false; } }
+                for (auto& nb : h_nb) {
+                    if (nb.size() != hcount) { return false; }
+                    for (int ni : nb) { if (ni >= static_cast<int>(hcount)) { return false; } }
                 }
 
-                if (_h.has_nsw() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nsw[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nsw = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour SW relation...");
-                    }
+                for (unsigned int di : h_di) { if (di >= hcount) { return false; } }
+                for (auto* vp : { &_d_x, &_d_y, &_d_dist }) { if (vp->size() != hcount) { return false; } }
+                for (auto* vp : { &_d_ri, &_d_gi, &_d_bi }) { if (vp->size() != hcount) { return false; } }
+                if (_d_flags.size() != hcount) { return false; }
+                for (auto& nb : _d_nb) { if (nb.size() != hcount) { return false; } }
+
+                // Build the new hexen aside, so that a failure here leaves this HexGrid as it was
+                std::list<morph::Hex> _hexen;
+                std::vector<morph::Hex*> _vhexen;
+                std::vector<std::list<morph::Hex>::iterator> hi (hcount);
+                _vhexen.reserve (hcount);
+                for (unsigned int i = 0; i < hcount; ++i) {
+                    _hexen.emplace_back (h_vi[i], _d, h_ri[i], h_gi[i]);
+                    hi[i] = std::prev (_hexen.end());
+                    hi[i]->di = h_di[i];
+                    hi[i]->x = h_x[i];
+                    hi[i]->y = h_y[i];
+                    hi[i]->z = h_z[i];
+                    hi[i]->r = h_r[i];
+                    hi[i]->phi = h_phi[i];
+                    hi[i]->bi = h_bi[i];
+                    hi[i]->distToBoundary = h_dist[i];
+                    hi[i]->setFlag (h_flags[i]);
+                    _vhexen.push_back (&(*hi[i]));
+                }
+                // Hex::setFlag records has-neighbour flags, so set the iterators directly
+                for (unsigned int i = 0; i < hcount; ++i) {
+                    if (h_nb[0][i] >= 0) { hi[i]->ne = hi[h_nb[0][i]]; }
+                    if (h_nb[1][i] >= 0) { hi[i]->nne = hi[h_nb[1][i]]; }
+                    if (h_nb[2][i] >= 0) { hi[i]->nnw = hi[h_nb[2][i]]; }
+                    if (h_nb[3][i] >= 0) { hi[i]->nw = hi[h_nb[3][i]]; }
+                    if (h_nb[4][i] >= 0) { hi[i]->nsw = hi[h_nb[4][i]]; }
+                    if (h_nb[5][i] >= 0) { hi[i]->nse = hi[h_nb[5][i]]; }
                 }
 
-                if (_h.has_nse() == true) {
-                    bool matched = false;
-                    unsigned int neighb_it = (unsigned int) this->d_nse[_h.vi];
-                    std::list<morph::Hex>::iterator hi = this->hexen.begin();
-                    while (hi != this->hexen.end()) {
-                        if (hi->vi == neighb_it) {
-                            matched = true;
-                            _h.nse = hi;
-                            break;
-                        }
-                        ++hi;
-                    }
-                    if (!matched) {
-                        throw std::runtime_error ("Failed to match hexen neighbour SE relation...");
-                    }
+                // Everything is read, checked and built, so now modify this HexGrid (none of which throws)
+                this->d = _d;
+                this->v = _v;
+                this->x_span = _x_span;
+                this->z = _z;
+                this->d_rowlen = _d_rowlen;
+                this->d_numrows = _d_numrows;
+                this->d_size = _d_size;
+                this->d_growthbuffer_horz = _d_gb_horz;
+                this->d_growthbuffer_vert = _d_gb_vert;
+                this->hexorder = static_cast<HexGridOrder>(_hexorder);
+                this->gridReduced = _gridReduced != 0u;
+                this->boundaryCentroid = _bcentroid;
+                this->originalBoundaryCentroid = _obcentroid;
+
+                this->clearRegionCache();
+                this->bhexen.clear();
+                this->hexindex.clear();
+                this->hexindex_valid = false;
+                // Swapping lists keeps their iterators valid, so hi still points into this->hexen
+                this->hexen.swap (_hexen);
+                this->vhexen.swap (_vhexen);
+                this->ihexen.swap (hi);
+
+                this->d_x.swap (_d_x);
+                this->d_y.swap (_d_y);
+                this->d_distToBoundary.swap (_d_dist);
+                this->d_ri.swap (_d_ri);
+                this->d_gi.swap (_d_gi);
+                this->d_bi.swap (_d_bi);
+                this->d_ne.swap (_d_nb[0]);
+                this->d_nne.swap (_d_nb[1]);
+                this->d_nnw.swap (_d_nb[2]);
+                this->d_nw.swap (_d_nb[3]);
+                this->d_nsw.swap (_d_nb[4]);
+                this->d_nse.swap (_d_nb[5]);
+                this->d_flags.swap (_d_flags);
+            } catch (const std::exception&) {
+                return false;
+            }
+            // Repopulate bhexen, as setBoundary() would have
+            this->boundaryContiguous();
+            return true;
+        }
+
+        /*!
+         * A key for the HexGrid that init (d_, x_span_, z_) followed by setBoundary (p,
+         * loffset) would make, with the current hexorder. It is a hash of those
+         * parameters and of the boundary points that setBoundary would compute from p,
+         * so it changes whenever the boundary path's content does.
+         */
+        unsigned long long int cacheKey (float d_, float x_span_, float z_,
+                                         const BezCurvePath<float>& p, bool loffset = true) const
+        {
+            // 64 bit FNV-1a
+            std::uint64_t h = morph::fnv1a_basis;
+            auto mix = [&h](const void* data, std::size_t n) { h = morph::fnv1a (data, n, h); };
+            const unsigned int params[3] = { HexGrid::cache_format, static_cast<unsigned int>(this->hexorder), loffset ? 1u : 0u };
+            const float fparams[3] = { d_, x_span_, z_ };
+            mix (params, sizeof (params));
+            mix (fparams, sizeof (fparams));
+            if (!p.isNull()) {
+                BezCurvePath<float> bp = p;
+                bp.computePoints (d_/2.0f, true);
+                for (const auto& bc : bp.getPoints()) {
+                    const float xy[2] = { bc.x(), bc.y() };
+                    mix (xy, sizeof (xy));
                 }
             }
+            return h == 0 ? 1 : h; // 0 means 'no key' to loadCache
         }
+
+        //! The cache file name, within \a cachedir, for a HexGrid with cacheKey \a key
+        static std::string cacheName (const std::string& cachedir, const unsigned long long int key)
+        {
+            std::stringstream ss;
+            ss << cachedir << (cachedir.empty() || cachedir.back() == '/' ? "" : "/")
+               << "hexgrid_" << std::hex << std::setw(16) << std::setfill('0') << key << ".h5";
+            return ss.str();
+        }
+
+        /*!
+         * Equivalent to init (d_, x_span_, z_) then setBoundary (p, loffset), except that
+         * the result is kept in a cache file in the directory \a cachedir. If the cache
+         * already holds this grid (the same parameters, hexorder and boundary) it is
+         * loaded, skipping the grid and boundary construction. Otherwise the grid is
+         * constructed and saved to the cache for next time. Hex::distToBoundary is
+         * cached as it was when the grid was saved, so after a cache miss, call
+         * computeDistanceToBoundary() and then saveCache (cacheName (cachedir, key), key)
+         * to cache the distances, too.
+         *
+         * \return true if the grid came from the cache
+         */
+        bool initCached (float d_, float x_span_, float z_, const BezCurvePath<float>& p,
+                         const std::string& cachedir, bool loffset = true)
+        {
+            const unsigned long long int key = this->cacheKey (d_, x_span_, z_, p, loffset);
+            const std::string cachefile = HexGrid::cacheName (cachedir, key);
+            if (this->loadCache (cachefile, key)) {
+                this->boundary = p;
+                if (!this->boundary.isNull()) { this->boundary.computePoints (this->d/2.0f, true); }
+                return true;
+            }
+            this->hexen.clear();
+            this->init (d_, x_span_, z_);
+            this->setBoundary (p, loffset);
+            this->saveCache (cachefile, key);
+            return false;
+        }
+
+        //! The version of the layout written by saveCache()
+        static constexpr unsigned int cache_format = 1;
 #endif // HEXGRID_COMPILE_LOAD_AND_SAVE
 
+        /*!
+         * A hash of the grid itself: the hex positions and the neighbour relations in
+         * the d_ vectors. Two grids with the same identityHash() can hold each other's
+         * per-hex data, so it is saved with a simulation checkpoint to check the grid
+         * on restart.
+         */
+        unsigned long long int identityHash() const
+        {
+            // 64 bit FNV-1a, as cacheKey()
+            std::uint64_t h = morph::fnv1a_basis;
+            auto mix = [&h](const auto& v) { h = morph::fnv1a (v.data(), v.size() * sizeof (v[0]), h); };
+            mix (this->d_x);
+            mix (this->d_y);
+            mix (this->d_ne);
+            mix (this->d_nne);
+            mix (this->d_nnw);
+            mix (this->d_nw);
+            mix (this->d_nsw);
+            mix (this->d_nse);
+            return h;
+        }
+
         /*!
          * Default constructor
          */
@@ -470,6 +779,225 @@ namespace morph {
             this->init();
         }
 
+        /*!
+         * Equivalent to init (d_, x_span_, z_) then setBoundary (p, loffset) with an
+         * x_span_ large enough to hold the boundary, but without building the hexagonal
+         * grid that setBoundary() would then mostly discard. The boundary's rows are
+         * rasterised directly in axial coordinates, so only the boundary hexes and the
+         * hexes inside the boundary are ever created. These are numbered row by row
+         * from the bottom left (or along the curve given by hexorder) and the d_
+         * vectors are populated in a single pass, in parallel over the rows. x_span is
+         * set to that of the smallest hexagonal grid that would have held the boundary.
+         */
+        void initFromBoundary (float d_, const BezCurvePath<float>& p, float z_ = 0.0f, bool loffset = true)
+        {
+            this->d = d_;
+            this->boundary = p;
+            std::vector<morph::BezCoord<float>> bpoints;
+            if (!this->boundary.isNull()) {
+                // As in setBoundary (const BezCurvePath&, bool)
+                this->boundary.computePoints (this->d/2.0f, true);
+                bpoints = this->boundary.getPoints();
+            }
+            this->initFromBoundary (d_, bpoints, z_, loffset);
+        }
+
+        /*!
+         * Equivalent to init (d_, x_span_, z_) then setBoundary (bpoints, loffset),
+         * without building the full hexagonal grid. See initFromBoundary (float, const
+         * BezCurvePath<float>&, float, bool).
+         */
+        void initFromBoundary (float d_, std::vector<BezCoord<float>>& bpoints, float z_ = 0.0f, bool loffset = true)
+        {
+            this->d = d_;
+            this->v = this->d * morph::mathconst<float>::root_3_over_2;
+            this->z = z_;
+            this->hexen.clear();
+            this->vhexen.clear();
+            this->ihexen.clear();
+            this->clearRegionCache();
+            this->bhexen.clear();
+            this->hexindex.clear();
+            this->hexindex_valid = false;
+            this->d_clear();
+            if (bpoints.empty()) { throw std::runtime_error ("HexGrid::initFromBoundary: The boundary has no points."); }
+
+            this->boundaryCentroid = morph::BezCurvePath<float>::getCentroid (bpoints);
+            if (loffset) {
+                for (auto& bp : bpoints) { bp.subtract (this->boundaryCentroid); }
+                this->originalBoundaryCentroid = this->boundaryCentroid;
+                this->boundaryCentroid = {0.0f, 0.0f};
+            }
+
+            // The rows spanned by the boundary, with one to spare above and below
+            float ymin = bpoints[0].y();
+            float ymax = ymin;
+            for (const auto& bp : bpoints) {
+                ymin = std::min (ymin, bp.y());
+                ymax = std::max (ymax, bp.y());
+            }
+            const int gmin = static_cast<int>(std::floor (ymin / this->v)) - 1;
+            const int gmax = static_cast<int>(std::ceil (ymax / this->v)) + 1;
+            const int nrows = gmax - gmin + 1;
+
+            // The centre of the lattice hex (r, g), computed as in Hex::computeLocation
+            auto hexx = [this](int r, int g) { return this->d * r + (this->d/2.0f) * g; };
+            auto hexy = [this](int g) { return this->v * g; };
+
+            // The boundary hexes in each row are those nearest to the boundary points.
+            // Check the neighbours of the rounded hex, as findHexNearPoint() would.
+            std::vector<std::vector<int>> brow (nrows);
+            static constexpr std::array<std::array<int, 2>, 6> nb = {{ {1,0}, {0,1}, {-1,1}, {-1,0}, {0,-1}, {1,-1} }};
+            for (const auto& bp : bpoints) {
+                morph::vec<int, 2> rg = this->axialRound (bp.coord);
+                auto dist = [&bp, hexx, hexy](int r, int g) {
+                    float dx = bp.x() - hexx (r, g);
+                    float dy = bp.y() - hexy (g);
+                    return std::sqrt (dx*dx + dy*dy);
+                };
+                float dmin = dist (rg[0], rg[1]);
+                for (auto n : nb) {
+                    float dn = dist (rg[0] + n[0], rg[1] + n[1]);
+                    if (dn < dmin) {
+                        dmin = dn;
+                        rg = { rg[0] + n[0], rg[1] + n[1] };
+                    }
+                }
+                brow[rg[1] - gmin].push_back (rg[0]);
+            }
+
+            const std::vector<std::vector<std::pair<float, int>>> crossings = this->polygonRowCrossings (bpoints, gmin, gmax);
+
+            // Rasterise each row: the ri and the flags of the hexes to keep, in order of ri
+            std::vector<std::vector<int>> rowri (nrows);
+            std::vector<std::vector<unsigned int>> rowflags (nrows);
+#pragma omp parallel for schedule(dynamic)
+            for (int row = 0; row < nrows; ++row) {
+                std::vector<int>& b = brow[row];
+                std::sort (b.begin(), b.end());
+                b.erase (std::unique (b.begin(), b.end()), b.end());
+                const std::vector<std::pair<float, int>>& c = crossings[row];
+                if (b.empty() && c.empty()) { continue; }
+                const int g = gmin + row;
+                // Inside hexes lie between the first and last crossings
+                int rlo = std::numeric_limits<int>::max();
+                int rhi = std::numeric_limits<int>::min();
+                if (!b.empty()) {
+                    rlo = b.front();
+                    rhi = b.back();
+                }
+                if (!c.empty()) {
+                    rlo = std::min (rlo, static_cast<int>(std::floor ((c.front().first - hexx (0, g)) / this->d)) - 1);
+                    rhi = std::max (rhi, static_cast<int>(std::ceil ((c.back().first - hexx (0, g)) / this->d)) + 1);
+                }
+                auto bi = b.begin();
+                auto ci = c.begin();
+                for (int r = rlo; r <= rhi; ++r) {
+                    while (bi != b.end() && *bi < r) { ++bi; }
+                    if (bi != b.end() && *bi == r) {
+                        rowri[row].push_back (r);
+                        rowflags[row].push_back (HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY);
+                        continue;
+                    }
+                    // The winding number to the left of the hex, as in markHexesInsidePolygon()
+                    const float x = hexx (r, g);
+                    while (ci != c.end() && ci->first < x) { ++ci; }
+                    if (ci != c.begin() && (ci - 1)->second != 0) {
+                        rowri[row].push_back (r);
+                        rowflags[row].push_back (HEX_INSIDE_BOUNDARY);
+                    }
+                }
+            }
+
+            // Create the hexes, row by row
+            std::vector<unsigned int> rowstart (nrows + 1, 0);
+            for (int row = 0; row < nrows; ++row) { rowstart[row + 1] = rowstart[row] + rowri[row].size(); }
+            const unsigned int n = rowstart[nrows];
+            std::vector<std::list<morph::Hex>::iterator> hi (n);
+            this->vhexen.reserve (n);
+            this->ihexen.reserve (n);
+            int maxring = 0;
+            for (int row = 0; row < nrows; ++row) {
+                const int g = gmin + row;
+                for (unsigned int k = 0; k < rowri[row].size(); ++k) {
+                    const unsigned int vi = rowstart[row] + k;
+                    const int r = rowri[row][k];
+                    this->hexen.emplace_back (vi, this->d, r, g);
+                    hi[vi] = std::prev (this->hexen.end());
+                    hi[vi]->setFlag (rowflags[row][k]);
+                    hi[vi]->di = vi;
+                    this->vhexen.push_back (&(*hi[vi]));
+                    this->ihexen.push_back (hi[vi]);
+                    maxring = std::max ({ maxring, std::abs (r), std::abs (g), std::abs (r + g) });
+                }
+            }
+            this->x_span = 2.0f * this->d * maxring;
+
+            // The index of the hex at (r, row), if there is one
+            auto indexAt = [&rowri, &rowstart, nrows](int r, int row) {
+                if (row < 0 || row >= nrows) { return -1; }
+                const std::vector<int>& ris = rowri[row];
+                auto it = std::lower_bound (ris.begin(), ris.end(), r);
+                return (it != ris.end() && *it == r) ? static_cast<int>(rowstart[row] + (it - ris.begin())) : -1;
+            };
+
+            // Connect the neighbours and populate the d_ vectors, in parallel over the rows
+            for (auto* dv : { &this->d_ri, &this->d_gi, &this->d_bi, &this->d_ne, &this->d_nne,
+                              &this->d_nnw, &this->d_nw, &this->d_nsw, &this->d_nse }) { dv->resize (n); }
+            for (auto* dv : { &this->d_x, &this->d_y, &this->d_distToBoundary }) { dv->resize (n); }
+            this->d_flags.resize (n);
+#pragma omp parallel for schedule(dynamic)
+            for (int row = 0; row < nrows; ++row) {
+                for (unsigned int k = 0; k < rowri[row].size(); ++k) {
+                    const int i = rowstart[row] + k;
+                    const int r = rowri[row][k];
+                    morph::Hex& h = *hi[i];
+                    const std::array<int, 6> nbi = {
+                        (k + 1 < rowri[row].size() && rowri[row][k + 1] == r + 1) ? i + 1 : -1,
+                        indexAt (r, row + 1),
+                        indexAt (r - 1, row + 1),
+                        (k > 0 && rowri[row][k - 1] == r - 1) ? i - 1 : -1,
+                        indexAt (r, row - 1),
+                        indexAt (r + 1, row - 1)
+                    };
+                    if (nbi[0] >= 0) { h.set_ne (hi[nbi[0]]); }
+                    if (nbi[1] >= 0) { h.set_nne (hi[nbi[1]]); }
+                    if (nbi[2] >= 0) { h.set_nnw (hi[nbi[2]]); }
+                    if (nbi[3] >= 0) { h.set_nw (hi[nbi[3]]); }
+                    if (nbi[4] >= 0) { h.set_nsw (hi[nbi[4]]); }
+                    if (nbi[5] >= 0) { h.set_nse (hi[nbi[5]]); }
+                    this->d_ne[i] = nbi[0];
+                    this->d_nne[i] = nbi[1];
+                    this->d_nnw[i] = nbi[2];
+                    this->d_nw[i] = nbi[3];
+                    this->d_nsw[i] = nbi[4];
+                    this->d_nse[i] = nbi[5];
+                    this->d_x[i] = h.x;
+                    this->d_y[i] = h.y;
+                    this->d_ri[i] = h.ri;
+                    this->d_gi[i] = h.gi;
+                    this->d_bi[i] = h.bi;
+                    this->d_flags[i] = h.getFlags();
+                    this->d_distToBoundary[i] = h.distToBoundary;
+                }
+            }
+
+            // The vertex iterators of the hexagonal grid don't exist
+            this->gridReduced = true;
+            if (this->hexorder != HexGridOrder::list) {
+                this->renumberVectorIndices();
+                this->populate_d_vectors();
+            }
+
+            // Check that the boundary is contiguous, collecting bhexen as setBoundary() does
+            auto bhi = std::find_if (this->hexen.cbegin(), this->hexen.cend(),
+                                     [](const morph::Hex& h) { return h.testFlags (HEX_IS_BOUNDARY); });
+            std::set<unsigned int> seen;
+            if (bhi == this->hexen.cend() || this->boundaryContiguous (bhi, bhi, seen) == false) {
+                throw std::runtime_error ("The constructed boundary is not a contiguous sequence of hexes.");
+            }
+        }
+
         /*!
          * Compute the centroid of the passed in list of Hexes.
          */
@@ -490,6 +1018,12 @@ namespace morph {
          */
         std::list<Hex>::iterator findHexNearest (const morph::vec<float, 2>& pos)
         {
+            // Fast path: look up the hex in the axial-coordinate index
+            if (!this->hexindex_valid) { this->buildHexIndex(); }
+            std::list<morph::Hex>::iterator indexed = this->findHexNearestIndexed (pos);
+            if (indexed != this->hexen.end()) { return indexed; }
+
+            // pos is not over any hex in the grid; find the nearest by exhaustive search
             std::list<morph::Hex>::iterator nearest = this->hexen.end();
             std::list<morph::Hex>::iterator hi = this->hexen.begin();
             float dist = std::numeric_limits<float>::max();
@@ -506,10 +1040,30 @@ namespace morph {
             return nearest;
         }
 
+        /*!
+         * For each of the positions in \a posns, find the nearest Hex in the grid and
+         * return its vector index (Hex::vi). Uses the same axial-coordinate index as
+         * findHexNearest, so for positions over the grid each query is O(1).
+         */
+        morph::vvec<unsigned int> findHexNearest (const morph::vvec<morph::vec<float, 2>>& posns)
+        {
+            morph::vvec<unsigned int> indices (posns.size(), 0u);
+            if (this->hexen.empty()) { return indices; }
+            // Build the index before the parallel loop, which only reads from it
+            if (!this->hexindex_valid) { this->buildHexIndex(); }
+#pragma omp parallel for
+            for (typename morph::vvec<morph::vec<float, 2>>::size_type i = 0; i < posns.size(); ++i) {
+                indices[i] = this->findHexNearest (posns[i])->vi;
+            }
+            return indices;
+        }
+
         // If possible, get the hex at the given rgb position
         std::list<Hex>::iterator findHexAt (const morph::vec<int, 3>& rgbpos)
         {
-            std::list<morph::Hex>::iterator hi = this->hexen.begin(); // First hex in hexen is always 0,0,0
+            // Start from the hex at 0,0,0 (which is the first in hexen only for list ordering)
+            if (!this->hexindex_valid) { this->buildHexIndex(); }
+            std::list<morph::Hex>::iterator hi = this->indexedHexAt (0, 0);
 
             // +ri is East
             int inc = rgbpos[0] > 0 ? 1 : -1;
@@ -666,7 +1220,7 @@ namespace morph {
                 }
             }
 
-            this->discardOutsideBoundary();
+            this->discardOutsideBoundary (bpoints);
             this->populate_d_vectors();
         }
 
@@ -998,6 +1552,32 @@ namespace morph {
          */
         unsigned int num() const { return this->hexen.size(); }
 
+        //! The memory held by the grid: the list of Hexes, the lists of pointers into it and the d_ arrays
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage m ("HexGrid");
+            m.add ("hexen", this->hexen);
+            m.add ("vhexen", this->vhexen);
+            m.add ("ihexen", this->ihexen);
+            m.add ("bhexen", this->bhexen);
+            m.add ("hexindex", this->hexindex);
+            morph::memory_usage& d = m.add (morph::memory_usage ("d_ arrays"));
+            d.add ("d_x", this->d_x);
+            d.add ("d_y", this->d_y);
+            d.add ("d_ri", this->d_ri);
+            d.add ("d_gi", this->d_gi);
+            d.add ("d_bi", this->d_bi);
+            d.add ("d_ne", this->d_ne);
+            d.add ("d_nne", this->d_nne);
+            d.add ("d_nnw", this->d_nnw);
+            d.add ("d_nw", this->d_nw);
+            d.add ("d_nsw", this->d_nsw);
+            d.add ("d_nse", this->d_nse);
+            d.add ("d_flags", this->d_flags);
+            d.add ("d_distToBoundary", this->d_distToBoundary);
+            return m;
+        }
+
         /*!
          * \brief Obtain the vector index of the last Hex in hexen.
          *
@@ -1080,6 +1660,16 @@ namespace morph {
          */
         float getv() const { return this->v; }
 
+        /*!
+         * Getter for x_span, the approximate diameter of the initial hexagonal grid.
+         */
+        float getXspan() const { return this->x_span; }
+
+        /*!
+         * Getter for z.
+         */
+        float getz() const { return this->z; }
+
         /*!
          * Get the shortest distance from the centre to the perimeter. This is the
          * "short radius".
@@ -1149,34 +1739,40 @@ namespace morph {
         }
 
         /*!
-         * Run through all the hexes and compute the distance to the nearest boundary
-         * hex.
+         * Run through all the hexes and compute the distance to the nearest boundary hex (0 for
+         * boundary hexes and -100 for hexes outside the boundary). The boundary hexes go into a
+         * kd_tree, so this is O(N log B) for N hexes and B boundary hexes, and the distances are
+         * exactly those of a search over every boundary hex. d_distToBoundary is updated too,
+         * if the d_ vectors have been populated.
          */
         void computeDistanceToBoundary()
         {
-            std::list<morph::Hex>::iterator h = this->hexen.begin();
-            while (h != this->hexen.end()) {
+            std::vector<morph::vec<float, 2>> bpts;
+            std::vector<std::list<morph::Hex>::iterator> bhexes;
+            std::vector<std::list<morph::Hex>::iterator> inside;
+            for (auto h = this->hexen.begin(); h != this->hexen.end(); ++h) {
                 if (h->testFlags(HEX_IS_BOUNDARY) == true) {
                     h->distToBoundary = 0.0f;
+                    bpts.push_back ({ h->x, h->y });
+                    bhexes.push_back (h);
+                } else if (h->testFlags(HEX_INSIDE_BOUNDARY) == false) {
+                    // Set to a dummy, negative value
+                    h->distToBoundary = -100.0;
                 } else {
-                    if (h->testFlags(HEX_INSIDE_BOUNDARY) == false) {
-                        // Set to a dummy, negative value
-                        h->distToBoundary = -100.0;
-                    } else {
-                        // Not a boundary hex, but inside boundary
-                        std::list<morph::Hex>::iterator bh = this->hexen.begin();
-                        while (bh != this->hexen.end()) {
-                            if (bh->testFlags(HEX_IS_BOUNDARY) == true) {
-                                float delta = h->distanceFrom (*bh);
-                                if (delta < h->distToBoundary || h->distToBoundary < 0.0f) {
-                                    h->distToBoundary = delta;
-                                }
-                            }
-                            ++bh;
-                        }
-                    }
+                    inside.push_back (h);
                 }
-                ++h;
+            }
+            morph::kd_tree<float, 2> tree;
+            tree.build (bpts);
+            const int ni = static_cast<int>(inside.size());
+#pragma omp parallel for
+            for (int i = 0; i < ni; ++i) {
+                const unsigned int j = tree.nearest ({ inside[i]->x, inside[i]->y });
+                // Not a boundary hex, but inside boundary. With no boundary hexes, leave distToBoundary alone.
+                if (j != morph::kd_tree<float, 2>::none) { inside[i]->distToBoundary = inside[i]->distanceFrom (*bhexes[j]); }
+            }
+            if (this->d_distToBoundary.size() == this->hexen.size()) {
+                for (const auto& h : this->hexen) { this->d_distToBoundary[h.di] = h.distToBoundary; }
             }
         }
 
@@ -1198,6 +1794,40 @@ namespace morph {
             this->populate_d_neighbours();
         }
 
+        /*!
+         * Renumber the hexes of a HexGrid that has already been set up so that they
+         * follow the ordering \a o (this also sets hexorder). The d_ vectors are
+         * repopulated. The return value is the permutation that was applied, such
+         * that the hex that now has vector index i had vector index perm[i]. Use
+         * apply_reorder() to remap existing data with the permutation.
+         */
+        std::vector<unsigned int> reorder (HexGridOrder o)
+        {
+            this->hexorder = o;
+            std::vector<unsigned int> oldvi;
+            this->sortHexen();
+            oldvi.reserve (this->hexen.size());
+            for (auto& h : this->hexen) { oldvi.push_back (h.vi); }
+            this->renumberVectorIndices();
+            if (!this->d_x.empty()) { this->populate_d_vectors(); }
+            return oldvi;
+        }
+
+        /*!
+         * Given the permutation \a perm returned by reorder(), reorder the elements of
+         * \a data, which was indexed by the old Hex::vi, so that it is indexed by the new
+         * Hex::vi.
+         */
+        template <typename T>
+        static void apply_reorder (const std::vector<unsigned int>& perm, std::vector<T>& data)
+        {
+            if (perm.size() != data.size()) {
+                throw std::runtime_error ("HexGrid::apply_reorder: perm and data are not the same size.");
+            }
+            std::vector<T> olddata (data);
+            for (unsigned int i = 0; i < perm.size(); ++i) { data[i] = olddata[perm[i]]; }
+        }
+
         /*!
          * Get a vector of Hex pointers for all hexes that are inside/on the path
          * defined by the BezCurvePath \a p, thus this gets a 'region of hexes'. The Hex
@@ -1290,15 +1920,9 @@ namespace morph {
         {
             std::vector<std::list<morph::Hex>::iterator> theRegion;
 
-            // Find the hex with index centreindex
-            std::list<Hex>::iterator sh = this->hexen.begin(); // start hex
-            while (sh != this->hexen.end()) {
-                if (sh->vi == centreindex) { break; }
-                sh++;
-            }
-
-            // Return if we didn't find the start hex
-            if (sh == this->hexen.end()) { return theRegion; }
+            // Return if there is no hex with index centreindex
+            if (centreindex >= this->ihexen.size()) { return theRegion; }
+            std::list<Hex>::iterator sh = this->ihexen[centreindex]; // start hex
 
             theRegion.push_back (sh);
             // For each of 6 directions, step out to collect up the hexes on the disc
@@ -1335,6 +1959,90 @@ namespace morph {
             return theRegion;
         }
 
+        /*!
+         * The d_ indices of the hexagonal region of getHexagonalRegion (centreindex,
+         * radius), found from precomputed rings of axial offsets and hexindex rather than by
+         * stepping from neighbour to neighbour. Unlike getHexagonalRegion, the region
+         * includes any hexes of the disc that lie beyond a gap in the grid. The result is
+         * memoised by (centreindex, number of rings), so that repeated queries cost a hash
+         * lookup. The span remains valid until renumberVectorIndices() or clearRegionCache()
+         * is called.
+         */
+        std::span<const unsigned int> hexagonalRegionIndices (unsigned int centreindex, float radius)
+        {
+            if (centreindex >= this->ihexen.size()) { return {}; }
+            // The number of rings that getHexagonalRegion would step out to
+            unsigned int rings = 1;
+            while (this->d * rings < radius) { ++rings; }
+
+            const unsigned long long int key = (static_cast<unsigned long long int>(centreindex) << 32) | rings;
+            auto ci = this->hexregion_cache.find (key);
+            if (ci != this->hexregion_cache.end()) { return ci->second; }
+
+            if (!this->hexindex_valid) { this->buildHexIndex(); }
+            this->computeRegionOffsets (rings);
+            const Hex& c = *this->ihexen[centreindex];
+            const unsigned int n = this->region_ringstart[rings + 1];
+            std::vector<unsigned int> region;
+            region.reserve (n);
+            for (unsigned int k = 0; k < n; ++k) {
+                std::list<morph::Hex>::iterator hi = this->indexedHexAt (c.ri + this->region_offsets[k][0],
+                                                                         c.gi + this->region_offsets[k][1]);
+                if (hi != this->hexen.end()) { region.push_back (hi->vi); }
+            }
+            return this->hexregion_cache.emplace (key, std::move (region)).first->second;
+        }
+
+        /*!
+         * The d_ indices of the hexes inside the region bounded by the closed path \a p, as
+         * getRegion (p, regionCentroid, applyOriginalBoundaryCentroid) would find them. The
+         * result is memoised by a hash of the path's points, so a repeated query does not
+         * re-trace the region boundary. On a cache hit the HEX_IS_REGION_BOUNDARY and
+         * HEX_INSIDE_REGION flags are left as they are. The span remains valid until
+         * renumberVectorIndices() or clearRegionCache() is called.
+         */
+        std::span<const unsigned int> getRegionIndices (BezCurvePath<float>& p, bool applyOriginalBoundaryCentroid = true)
+        {
+            p.computePoints (this->d/2.0f, true);
+            return this->getRegionIndices (p.getPoints(), applyOriginalBoundaryCentroid);
+        }
+
+        //! The overload of getRegionIndices that takes the points of the region's boundary
+        std::span<const unsigned int> getRegionIndices (const std::vector<BezCoord<float>>& bpoints,
+                                                        bool applyOriginalBoundaryCentroid = true)
+        {
+            // The points, and the flag, are the key. As cacheKey(), hash with 64 bit FNV-1a.
+            std::vector<float> key;
+            key.reserve (2 * bpoints.size() + 1);
+            key.push_back (applyOriginalBoundaryCentroid ? 1.0f : 0.0f);
+            for (const auto& bc : bpoints) {
+                key.push_back (bc.x());
+                key.push_back (bc.y());
+            }
+            const std::uint64_t h = morph::fnv1a (key.data(), key.size() * sizeof (float));
+
+            // Compare the points, too, in case two paths share a hash
+            auto range = this->pathregion_cache.equal_range (h);
+            for (auto ci = range.first; ci != range.second; ++ci) {
+                if (ci->second.first == key) { return ci->second.second; }
+            }
+
+            std::vector<BezCoord<float>> pts = bpoints; // getRegion modifies its points
+            morph::vec<float, 2> regionCentroid;
+            std::vector<std::list<Hex>::iterator> theRegion = this->getRegion (pts, regionCentroid, applyOriginalBoundaryCentroid);
+            std::vector<unsigned int> region (theRegion.size());
+            for (std::size_t i = 0; i < theRegion.size(); ++i) { region[i] = theRegion[i]->vi; }
+            auto ci = this->pathregion_cache.emplace (h, std::make_pair (std::move (key), std::move (region)));
+            return ci->second.second;
+        }
+
+        //! Forget the regions memoised by hexagonalRegionIndices() and getRegionIndices()
+        void clearRegionCache()
+        {
+            this->hexregion_cache.clear();
+            this->pathregion_cache.clear();
+        }
+
         /*!
          * For every hex in hexen, unset the flags HEX_IS_REGION_BOUNDARY and
          * HEX_INSIDE_REGION
@@ -1347,33 +2055,54 @@ namespace morph {
         }
 
         /*!
-         * Using this HexGrid as the domain, convolve the domain data \a data with the
-         * kernel data \a kerneldata, which exists on another HexGrid, \a
-         * kernelgrid. Return the result in \a result.
+         * A precomputed gather table for convolving data on a HexGrid with a kernel that
+         * exists on another HexGrid. For the output hex with vector index i, the
+         * contributing data indices are idx[i*stride + k] and their weights are
+         * w[i*stride + k] for k in [0, stride). Kernel hexes that cannot be reached from
+         * hex i (because they would lie outside the domain) are given index 0 and weight
+         * 0, so that the gather in convolve() needs no branches.
          */
         template<typename T>
-        void convolve (const HexGrid& kernelgrid, const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result)
+        struct convolution_table
+        {
+            //! The number of kernel hexes; the row length of idx and w
+            unsigned int stride = 0;
+            //! The number of output hexes; the number of rows in idx and w
+            unsigned int rows = 0;
+            //! The data index for each (output hex, kernel hex) pair
+            std::vector<int> idx;
+            //! The kernel weight for each (output hex, kernel hex) pair
+            std::vector<T> w;
+        };
+
+        /*!
+         * Build, once, the table of data indices and kernel weights that is required to
+         * convolve data on this HexGrid with \a kerneldata, which exists on the HexGrid
+         * \a kernelgrid. Pass the result to convolve (const convolution_table<T>&, ...)
+         * as many times as required.
+         */
+        template<typename T>
+        convolution_table<T> get_convolution_table (const HexGrid& kernelgrid, const std::vector<T>& kerneldata) const
         {
-            if (result.size() != this->hexen.size()) {
-                throw std::runtime_error ("The result vector is not the same size as the HexGrid.");
-            }
-            if (result.size() != data.size()) {
-                throw std::runtime_error ("The data vector is not the same size as the HexGrid.");
-            }
             if (kernelgrid.getd() != this->d) {
                 throw std::runtime_error ("The kernel HexGrid must have same d as this HexGrid to carry out convolution.");
             }
-            if (&data == &result) {
-                throw std::runtime_error ("Pass in separate memory for the result.");
+            if (kerneldata.size() != kernelgrid.hexen.size()) {
+                throw std::runtime_error ("The kernel data vector is not the same size as the kernel HexGrid.");
             }
 
-            // For each hex in this HexGrid, compute the convolution kernel
-            std::list<Hex>::iterator hi = this->hexen.begin();
+            convolution_table<T> tbl;
+            tbl.stride = kernelgrid.hexen.size();
+            tbl.rows = this->hexen.size();
+            tbl.idx.resize (tbl.stride * tbl.rows, 0);
+            tbl.w.resize (tbl.stride * tbl.rows, T{0});
+
+            // For each hex in this HexGrid, find the data hex that each kernel hex refers to
+            std::list<Hex>::const_iterator hi = this->hexen.begin();
             for (; hi != this->hexen.end(); ++hi) {
-                T sum = T{0};
-                // For each kernel hex, sum up.
+                unsigned int k = 0;
                 for (auto kh : kernelgrid.hexen) {
-                    std::list<Hex>::iterator dhi = hi;
+                    std::list<Hex>::const_iterator dhi = hi;
                     // Kernel hex coords r,g are: kh.ri, kh.gi, which may be (are EXPECTED to be) +ve or -ve
                     //
                     // Origin hex coords are h.ri, h.gi
@@ -1386,9 +2115,7 @@ namespace morph {
                     int rr = kh.ri;
                     int gg = kh.gi;
                     bool failed = false;
-                    bool finished = false;
-                    //while (gg != 0 && rr != 0) {
-                    while (!finished) {
+                    while (rr != 0 || gg != 0) {
                         bool moved = false;
                         // Try to move in r direction
                         if (rr > 0) {
@@ -1419,12 +2146,7 @@ namespace morph {
                             } // Didn't move in -g direction
                         }
 
-                        if (rr == 0 && gg == 0) {
-                            finished = true;
-                            break;
-                        }
-
-                        if (!moved) {
+                        if (!moved && (rr != 0 || gg != 0)) {
                             // We're stuck; Can't move in r or g direction, so can't add a contribution
                             failed = true;
                             break;
@@ -1432,18 +2154,84 @@ namespace morph {
                     }
 
                     if (!failed) {
-                        // Can do the sum
-                        sum +=  data[dhi->vi] * kerneldata[kh.vi];
+                        tbl.idx[hi->vi * tbl.stride + k] = static_cast<int>(dhi->vi);
+                        tbl.w[hi->vi * tbl.stride + k] = kerneldata[kh.vi];
                     }
+                    ++k;
                 }
+            }
+
+            return tbl;
+        }
+
+        /*!
+         * Using this HexGrid as the domain, convolve the domain data \a data using the
+         * precomputed convolution table \a tbl (see get_convolution_table). Return the
+         * result in \a result. This is the fast path; use it when convolving repeatedly
+         * with the same kernel.
+         */
+        template<typename T>
+        void convolve (const convolution_table<T>& tbl, const std::vector<T>& data, std::vector<T>& result) const
+        {
+            if (tbl.rows != this->hexen.size()) {
+                throw std::runtime_error ("The convolution table was not computed for a HexGrid of this size.");
+            }
+            if (result.size() != this->hexen.size()) {
+                throw std::runtime_error ("The result vector is not the same size as the HexGrid.");
+            }
+            if (result.size() != data.size()) {
+                throw std::runtime_error ("The data vector is not the same size as the HexGrid.");
+            }
+            if (&data == &result) {
+                throw std::runtime_error ("Pass in separate memory for the result.");
+            }
 
-                result[hi->vi] = sum;
+            const int* idx = tbl.idx.data();
+            const T* w = tbl.w.data();
+            const T* dat = data.data();
+            const unsigned int stride = tbl.stride;
+#pragma omp parallel for
+            for (unsigned int i = 0; i < tbl.rows; ++i) {
+                const int* ri = idx + i * stride;
+                const T* rw = w + i * stride;
+                T sum = T{0};
+                for (unsigned int k = 0; k < stride; ++k) { sum += dat[ri[k]] * rw[k]; }
+                result[i] = sum;
             }
         }
 
+        /*!
+         * Using this HexGrid as the domain, convolve the domain data \a data with the
+         * kernel data \a kerneldata, which exists on another HexGrid, \a
+         * kernelgrid. Return the result in \a result.
+         *
+         * This computes a convolution_table each time it is called. If you convolve with
+         * the same kernel repeatedly, call get_convolution_table once and then use
+         * convolve (const convolution_table<T>&, ...).
+         */
+        template<typename T>
+        void convolve (const HexGrid& kernelgrid, const std::vector<T>& kerneldata, const std::vector<T>& data, std::vector<T>& result)
+        {
+            if (result.size() != this->hexen.size()) {
+                throw std::runtime_error ("The result vector is not the same size as the HexGrid.");
+            }
+            if (result.size() != data.size()) {
+                throw std::runtime_error ("The data vector is not the same size as the HexGrid.");
+            }
+            if (&data == &result) {
+                throw std::runtime_error ("Pass in separate memory for the result.");
+            }
+            convolution_table<T> tbl = this->get_convolution_table (kernelgrid, kerneldata);
+            this->convolve (tbl, data, result);
+        }
+
         /*!
          * Resampling function (monochrome).
          *
+         * Each hex gets the sum of the image pixels within 3 sigma of it, weighted by a 2D
+         * Gaussian whose sigma is the pixel spacing. Only the pixels in that window are
+         * visited, so the cost is independent of the image size.
+         *
          * \param image_data (input) The monochrome image as a vvec of floats.  The
          * image is interpreted as running from bottom left to top right. Thus, the very
          * first float in the vvec is at x=0, y=0.
@@ -1453,17 +2241,21 @@ namespace morph {
          * \param image_offset (input) An offset in HexGrid units to shift the image wrt to the HexGrid's origin
          *
          * \return A new data vvec containing the resampled (and renormalised) hex pixel values
+         *
+         * \tparam Ao The allocator for the returned vvec, such as morph::aligned_allocator<float>
+         * (see morph/allocators.h). The allocator of image_data, Ai, is deduced.
          */
-        morph::vvec<float> resampleImage (const morph::vvec<float>& image_data,
-                                          const unsigned int image_pixelwidth,
-                                          const morph::vec<float, 2>& image_scale,
-                                          const morph::vec<float, 2>& image_offset)
+        template <typename Ao = std::allocator<float>, typename Ai = std::allocator<float>>
+        morph::vvec<float, Ao> resampleImage (const morph::vvec<float, Ai>& image_data,
+                                              const unsigned int image_pixelwidth,
+                                              const morph::vec<float, 2>& image_scale,
+                                              const morph::vec<float, 2>& image_offset)
         {
             unsigned int csz = image_data.size();
             morph::vec<unsigned int, 2> image_pixelsz = {image_pixelwidth, csz / image_pixelwidth};
 
             // Return data object for the resampled result
-            morph::vvec<float> expr_resampled(this->num(), 0.0f);
+            morph::vvec<float, Ao> expr_resampled(this->num(), 0.0f);
 
             // Before resampling, check if all the values in image_data are identical. In this case,
             // we can short-cut the resampling process.
@@ -1491,21 +2283,39 @@ namespace morph {
             morph::vec<float, 2> params = 1.0f / (2.0f * dist_per_pix * dist_per_pix);
             morph::vec<float, 2> threesig = 3.0f * dist_per_pix;
 
-#pragma omp parallel for // parallel on this outer loop gives best result (5.8 s vs 7 s)
-            for (typename std::vector<float>::size_type xi = 0u; xi < this->d_x.size(); ++xi) {
+            // Input pixel j of each dimension is at dist_per_pix * j + origin
+            const morph::vec<float, 2> origin = image_offset - input_centering_offset;
+            // The input pixels within 3 sigma of p, in dimension dim: the first pixel index, the
+            // count (at most 7) and the Gaussian weights
+            auto window = [&](const float p, const unsigned int dim, std::array<float, 8>& wt, long long& first) {
+                const float pj = (p - origin[dim]) / dist_per_pix[dim];
+                first = std::max (0LL, static_cast<long long>(std::ceil (pj - 3.0f)));
+                const long long last = std::min (static_cast<long long>(image_pixelsz[dim]) - 1,
+                                                 static_cast<long long>(std::floor (pj + 3.0f)));
+                unsigned int n = 0;
+                for (long long j = first; j <= last && n < wt.size(); ++j) {
+                    const float d = p - (dist_per_pix[dim] * static_cast<float>(j) + origin[dim]);
+                    wt[n++] = std::abs (d) < threesig[dim] ? std::exp (-params[dim] * d * d) : 0.0f;
+                }
+                return n;
+            };
+
+            const long long nh = static_cast<long long>(this->d_x.size());
+#pragma omp parallel for
+            for (long long xi = 0; xi < nh; ++xi) {
+                // Visit only the input pixels within 3 sigma, with separable weights
+                std::array<float, 8> wx;
+                std::array<float, 8> wy;
+                long long x0 = 0;
+                long long y0 = 0;
+                const unsigned int nx = window (this->d_x[xi], 0, wx, x0);
+                const unsigned int ny = window (this->d_y[xi], 1, wy, y0);
                 float expr = 0.0f;
-                for (unsigned int i = 0; i < csz; ++i) {
-                    // Get x/y pixel coords:
-                    morph::vec<unsigned int, 2> idx = {(i % image_pixelsz[0]), (i / image_pixelsz[0])};
-                    // Get the coordinates of the pixel at index i (in HexGrid units):
-                    morph::vec<float, 2> posn = (dist_per_pix * idx) - input_centering_offset + image_offset;
-                    // Distance from input pixel to output hex:
-                    float _d_x = this->d_x[xi] - posn[0];
-                    float _d_y = this->d_y[xi] - posn[1];
-                    // Compute contributions to each hex pixel, using 2D (elliptical) Gaussian
-                    if (_d_x < threesig[0] && _d_y < threesig[1]) { // Testing for distance gives slight speedup
-                        expr += std::exp ( - ( (params[0] * _d_x * _d_x) + (params[1] * _d_y * _d_y) ) ) * image_data[i];
-                    }
+                for (unsigned int b = 0; b < ny; ++b) {
+                    const float* row = image_data.data() + (y0 + b) * image_pixelsz[0] + x0;
+                    float rowsum = 0.0f;
+                    for (unsigned int a = 0; a < nx; ++a) { rowsum += wx[a] * row[a]; }
+                    expr += wy[b] * rowsum;
                 }
                 expr_resampled[xi] = expr;
             }
@@ -1579,13 +2389,14 @@ namespace morph {
 
         static constexpr bool debug_hexshift = false;
 
-        // Shift data by dx, with wrapping if set for the hexgrid
-        template <typename T>
-        bool shiftdata (morph::vvec<T>& image_data, const morph::vec<float, 2>& dx)
+        /*!
+         * Make the operator that shifts data on this grid by dx (with wrapping if set for the
+         * hexgrid). Build it once and apply it to many data vectors, rather than calling
+         * shiftdata() with the same dx each time. If the shift can't be computed, the operator
+         * is not valid().
+         */
+        morph::shift_operator<float> shiftOperator (const morph::vec<float, 2>& dx)
         {
-            unsigned int csz = image_data.size();
-            morph::vvec<T> shifted(csz, T{0});
-
             // If g and r are purely integral, then the transform is simple; copy data
             // from hex(i,j) in image_data to hex(i+r,j+g) in shifted, where the +r and
             // +g are steps via neighbour relations (to ensure wrapping works)
@@ -1647,20 +2458,18 @@ namespace morph {
 
             if (overlap[0] == -100.0f) {
                 if constexpr (debug_hexshift) { std::cout << "overlap[0] is -100\n"; }
-                return false;
+                return morph::shift_operator<float>{};
             }
 
-            static constexpr bool debugdata = false;
-
+            std::vector<morph::shift_operator<float>::entry> entries;
+            entries.reserve (this->hexen.size() * 19);
             std::list<Hex>::iterator h = this->hexen.begin();
+            // Add overlap[k] of the data at h to the hex dh
+            auto add = [&entries, &h, &overlap](std::list<Hex>::const_iterator dh, const int k) {
+                entries.push_back ({ h->vi, dh->vi, overlap[k] });
+            };
             while (h != this->hexen.end()) {
-                // image_data[i] is the data to shift.
-                bool datatocopy = false;
-                if constexpr (debugdata) {
-                    datatocopy = image_data[h->vi] > T{0} ? true : false;
-                }
                 std::list<Hex>::iterator dest_hex = h;
-                if (datatocopy) std::cout << "Copying hex data at " << h->outputRG() << "...";
                 if (int_rg[1] > 0) {
                     for (int j = 0; j < int_rg[1] && dest_hex->has_nne(); ++j) {
                         dest_hex = dest_hex->nne;
@@ -1679,95 +2488,57 @@ namespace morph {
                         dest_hex = dest_hex->nw;
                     }
                 }
-                // dest_hex should now be set
-                if constexpr (debugdata) { if (datatocopy) { std::cout << " to desthex: " << dest_hex->outputRG() << std::endl; } }
-
-                // Having computed all the overlaps:
-                if (datatocopy && overlap[0]) std::cout << "Adding [0] " << (overlap[0]*100.0f) << "% to dest_hex itself\n";
-                shifted[dest_hex->vi] += overlap[0] * image_data[h->vi];
 
+                // dest_hex is now set. Distribute the data between it and its neighbours.
+                add (dest_hex, 0);
                 if (dest_hex->has_ne()) {
-                    if constexpr (debugdata) { if (datatocopy && overlap[1]) { std::cout << "Adding [1] " << (overlap[1]*100.0f) << "% to dest_hex ne\n"; } }
-                    shifted[dest_hex->ne->vi] += overlap[1] * image_data[h->vi];
-
-                    if (dest_hex->ne->has_ne()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[8]) { std::cout << "Adding [8] " << (overlap[8]*100.0f) << "% to dest_hex ne->ne\n";} }
-                        shifted[dest_hex->ne->ne->vi] += overlap[8] * image_data[h->vi];
-                    }
-                    if (dest_hex->ne->has_nne()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[9]) { std::cout << "Adding [9] " << (overlap[9]*100.0f) << "% to dest_hex ne->nne\n"; } }
-                        shifted[dest_hex->ne->nne->vi] += overlap[9] * image_data[h->vi];
-                    }
+                    add (dest_hex->ne, 1);
+                    if (dest_hex->ne->has_ne()) { add (dest_hex->ne->ne, 8); }
+                    if (dest_hex->ne->has_nne()) { add (dest_hex->ne->nne, 9); }
                 } else {
                     std::cout << "No Neighbour E?? dest_hex " << dest_hex->outputCart() << " has no neighbour east.\n";
                 }
-
                 if (dest_hex->has_nne()) {
-                    if constexpr (debugdata) { if (datatocopy && overlap[2]) { std::cout << "Adding [2] " << (overlap[2]*100.0f) << "% to dest_hex nne\n"; } }
-                    shifted[dest_hex->nne->vi] += overlap[2] * image_data[h->vi];
-                    if (dest_hex->nne->has_nne()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[10]) { std::cout << "Adding [10] " << (overlap[10]*100.0f) << "% to dest_hex nne->nne\n"; } }
-                        shifted[dest_hex->nne->nne->vi] += overlap[10] * image_data[h->vi];
-                    }
-                    if (dest_hex->nne->has_nnw()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[11]) { std::cout << "Adding [11] " << (overlap[11]*100.0f) << "% to dest_hex nne->nnw\n"; } }
-                        shifted[dest_hex->nne->nnw->vi] += overlap[11] * image_data[h->vi];
-                    }
+                    add (dest_hex->nne, 2);
+                    if (dest_hex->nne->has_nne()) { add (dest_hex->nne->nne, 10); }
+                    if (dest_hex->nne->has_nnw()) { add (dest_hex->nne->nnw, 11); }
                 }
                 if (dest_hex->has_nnw()) {
-                    if constexpr (debugdata) { if (datatocopy && overlap[3]) { std::cout << "Adding [3] " << (overlap[3]*100.0f) << "% to dest_hex nnw\n"; } }
-                    shifted[dest_hex->nnw->vi] += overlap[3] * image_data[h->vi];
-                    if (dest_hex->nnw->has_nnw()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[12]) { std::cout << "Adding [12] " << (overlap[12]*100.0f) << "% to dest_hex nnw->nnw\n"; } }
-                        shifted[dest_hex->nnw->nnw->vi] += overlap[12] * image_data[h->vi];
-                    }
-                    if (dest_hex->nnw->has_nw()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[13]) { std::cout << "Adding [13] " << (overlap[13]*100.0f) << "% to dest_hex nnw->nw\n"; } }
-                        shifted[dest_hex->nnw->nw->vi] += overlap[13] * image_data[h->vi];
-                    }
+                    add (dest_hex->nnw, 3);
+                    if (dest_hex->nnw->has_nnw()) { add (dest_hex->nnw->nnw, 12); }
+                    if (dest_hex->nnw->has_nw()) { add (dest_hex->nnw->nw, 13); }
                 }
                 if (dest_hex->has_nw()) {
-                    if constexpr (debugdata) { if (datatocopy && overlap[4]) { std::cout << "Adding [4] " << (overlap[4]*100.0f) << "% to dest_hex nw\n"; } }
-                    shifted[dest_hex->nw->vi] += overlap[4] * image_data[h->vi];
-                    if (dest_hex->nw->has_nw()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[14]) { std::cout << "Adding [14] " << (overlap[14]*100.0f) << "% to dest_hex nw->nw\n"; } }
-                        shifted[dest_hex->nw->nw->vi] += overlap[14] * image_data[h->vi];
-                    }
-                    if (dest_hex->nw->has_nsw()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[15]) { std::cout << "Adding [15] " << (overlap[15]*100.0f) << "% to dest_hex nw->nsw\n"; } }
-                        shifted[dest_hex->nw->nsw->vi] += overlap[15] * image_data[h->vi];
-                    }
+                    add (dest_hex->nw, 4);
+                    if (dest_hex->nw->has_nw()) { add (dest_hex->nw->nw, 14); }
+                    if (dest_hex->nw->has_nsw()) { add (dest_hex->nw->nsw, 15); }
                 }
                 if (dest_hex->has_nsw()) {
-                    if constexpr (debugdata) { if (datatocopy && overlap[5]) { std::cout << "Adding [5] " << (overlap[5]*100.0f) << "% to dest_hex nsw\n"; } }
-                    shifted[dest_hex->nsw->vi] += overlap[5] * image_data[h->vi];
-                    if (dest_hex->nsw->has_nsw()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[16]) { std::cout << "Adding [16] " << (overlap[16]*100.0f) << "% to dest_hex nsw->nsw\n"; } }
-                        shifted[dest_hex->nsw->nsw->vi] += overlap[16] * image_data[h->vi];
-                    }
-                    if (dest_hex->nsw->has_nse()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[17]) { std::cout << "Adding [17] " << (overlap[17]*100.0f) << "% to dest_hex nsw->nse\n"; } }
-                        shifted[dest_hex->nsw->nse->vi] += overlap[17] * image_data[h->vi];
-                    }
+                    add (dest_hex->nsw, 5);
+                    if (dest_hex->nsw->has_nsw()) { add (dest_hex->nsw->nsw, 16); }
+                    if (dest_hex->nsw->has_nse()) { add (dest_hex->nsw->nse, 17); }
                 }
                 if (dest_hex->has_nse()) {
-                    if constexpr (debugdata) { if (datatocopy && overlap[6]) { std::cout << "Adding [6] " << (overlap[6]*100.0f) << "% to dest_hex nse\n"; } }
-                    shifted[dest_hex->nse->vi] += overlap[6] * image_data[h->vi];
-                    if (dest_hex->nse->has_nse()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[18]) { std::cout << "Adding [18] " << (overlap[18]*100.0f) << "% to dest_hex nse->nse\n"; } }
-                        shifted[dest_hex->nse->nse->vi] += overlap[18] * image_data[h->vi];
-                    }
-                    if (dest_hex->nse->has_ne()) {
-                        if constexpr (debugdata) { if (datatocopy && overlap[7]) { std::cout << "Adding [7] " << (overlap[7]*100.0f) << "% to dest_hex nse->ne\n"; } }
-                        shifted[dest_hex->nse->ne->vi] += overlap[7] * image_data[h->vi];
-                    }
+                    add (dest_hex->nse, 6);
+                    if (dest_hex->nse->has_nse()) { add (dest_hex->nse->nse, 18); }
+                    if (dest_hex->nse->has_ne()) { add (dest_hex->nse->ne, 7); }
                 } else {
-                    if constexpr (debugdata) { std::cout << "No nse for hex " << dest_hex->outputRG() << "\n"; }
+                    if constexpr (debug_hexshift) { std::cout << "No nse for hex " << dest_hex->outputRG() << "\n"; }
                 }
-
                 ++h;
             }
 
+            return morph::shift_operator<float> (this->hexen.size(), entries);
+        }
+
+        // Shift data by dx, with wrapping if set for the hexgrid
+        template <typename T>
+        bool shiftdata (morph::vvec<T>& image_data, const morph::vec<float, 2>& dx)
+        {
+            morph::shift_operator<float> op = this->shiftOperator (dx);
+            if (!op.valid()) { return false; }
+            morph::vvec<T> shifted;
+            op.apply (image_data, shifted);
             std::copy (shifted.begin(), shifted.end(), image_data.begin());
             return true;
         }
@@ -2856,6 +3627,9 @@ namespace morph {
          */
         std::vector<Hex*> vhexen;
 
+        //! The iterator into hexen of the Hex with vector index vi is ihexen[vi]. Filled with vhexen.
+        std::vector<std::list<Hex>::iterator> ihexen;
+
         /*!
          * While determining if boundary is continuous, fill this maps container of
          * hexes.
@@ -3458,6 +4232,11 @@ namespace morph {
         {
             bool neighbourNearer = true;
 
+            // If the index can place us on (or next to) the nearest hex, start from there
+            if (!this->hexindex_valid) { this->buildHexIndex(); }
+            std::list<morph::Hex>::iterator indexed = this->findHexNearestIndexed (point.coord);
+            if (indexed != this->hexen.end()) { startFrom = indexed; }
+
             std::list<morph::Hex>::iterator h = startFrom;
             float dmin = h->distanceFrom (point);
             float dcur = 0.0f;
@@ -3751,6 +4530,83 @@ namespace morph {
             }
         }
 
+        /*!
+         * Mark hexes as inside the closed polygon \a bpoints, which should be the
+         * boundary that set the hexes flagged with HEX_IS_BOUNDARY. Those boundary hexes
+         * are inside by definition; every other hex is inside if the winding number of
+         * the polygon about its centre is non-zero (as morph::Winder would find).
+         *
+         * This is a scanline rasterisation of the polygon over the rows (constant gi)
+         * of the grid. Each polygon edge drops its crossing with each row that it spans
+         * into that row's bucket, signed by the edge's direction, so the cost is
+         * proportional to the number of hexes plus the number of crossings, with no walk
+         * around the boundary and no recursion. The winding number of a hex is the sum
+         * of the signs of its row's crossings that lie to its left.
+         */
+        void markHexesInsidePolygon (const std::vector<BezCoord<float>>& bpoints,
+                                     unsigned int bdryFlag = HEX_IS_BOUNDARY,
+                                     unsigned int insideFlag = HEX_INSIDE_BOUNDARY)
+        {
+            if (bpoints.size() < 3 || this->hexen.empty()) { return; }
+
+            int gmin = std::numeric_limits<int>::max();
+            int gmax = std::numeric_limits<int>::min();
+            for (const auto& h : this->hexen) {
+                gmin = std::min (gmin, h.gi);
+                gmax = std::max (gmax, h.gi);
+            }
+            const std::vector<std::vector<std::pair<float, int>>> crossings = this->polygonRowCrossings (bpoints, gmin, gmax);
+
+            for (auto& h : this->hexen) {
+                if (h.testFlags (bdryFlag)) {
+                    h.setFlag (insideFlag);
+                    continue;
+                }
+                const std::vector<std::pair<float, int>>& c = crossings[h.gi - gmin];
+                const auto right = std::lower_bound (c.begin(), c.end(), h.x,
+                                                     [](const std::pair<float, int>& a, const float x) { return a.first < x; });
+                if (right != c.begin() && (right - 1)->second != 0) { h.setFlag (insideFlag); }
+            }
+        }
+
+        /*!
+         * The crossings of the closed polygon \a bpoints with the rows gmin to gmax of the
+         * grid, for markHexesInsidePolygon() and initFromBoundary(). Element g - gmin
+         * holds, sorted by x, the x of each crossing with row g and the winding number
+         * of the polygon just to the right of that crossing.
+         */
+        std::vector<std::vector<std::pair<float, int>>> polygonRowCrossings (const std::vector<BezCoord<float>>& bpoints,
+                                                                            const int gmin, const int gmax) const
+        {
+            // Per row, the x of each crossing and the direction (+1 upwards) of its edge
+            std::vector<std::vector<std::pair<float, int>>> crossings (gmax - gmin + 1);
+            if (bpoints.size() < 3) { return crossings; }
+
+            // Each edge p0-p1 crosses the rows whose y lies in [min(y0,y1), max(y0,y1))
+            const std::size_t np = bpoints.size();
+            for (std::size_t i = 0; i < np; ++i) {
+                const BezCoord<float>& p0 = bpoints[i];
+                const BezCoord<float>& p1 = bpoints[(i + 1) % np];
+                if (p0.y() == p1.y()) { continue; }
+                const float ylo = std::min (p0.y(), p1.y());
+                const float yhi = std::max (p0.y(), p1.y());
+                const int dir = p1.y() > p0.y() ? 1 : -1;
+                const int g0 = std::max (gmin, static_cast<int>(std::floor (ylo / this->v)) - 1);
+                const int g1 = std::min (gmax, static_cast<int>(std::ceil (yhi / this->v)) + 1);
+                for (int g = g0; g <= g1; ++g) {
+                    const float yr = this->v * g;
+                    if (yr < ylo || yr >= yhi) { continue; }
+                    crossings[g - gmin].push_back ({ p0.x() + (yr - p0.y()) * (p1.x() - p0.x()) / (p1.y() - p0.y()), dir });
+                }
+            }
+            // Sort each row and turn the directions into running winding numbers
+            for (auto& c : crossings) {
+                std::sort (c.begin(), c.end());
+                for (std::size_t k = 1; k < c.size(); ++k) { c[k].second += c[k - 1].second; }
+            }
+            return crossings;
+        }
+
         /*!
          * Recursively mark hexes to be kept if they are inside the rectangular hex
          * domain.
@@ -3858,6 +4714,22 @@ namespace morph {
             // Mark those hexes inside the boundary
             std::list<morph::Hex>::iterator centroidHex = this->findHexNearest (this->boundaryCentroid);
             this->markHexesInside (centroidHex);
+            this->discardNotInsideBoundary();
+        }
+
+        /*!
+         * Discard hexes in this->hexen that are outside the boundary polygon \a bpoints,
+         * marking those inside with the scanline pass of markHexesInsidePolygon().
+         */
+        void discardOutsideBoundary (const std::vector<BezCoord<float>>& bpoints)
+        {
+            this->markHexesInsidePolygon (bpoints);
+            this->discardNotInsideBoundary();
+        }
+
+        //! Erase the hexes not marked HEX_INSIDE_BOUNDARY and renumber those that remain
+        void discardNotInsideBoundary()
+        {
             // Run through and discard those hexes outside the boundary:
             auto hi = this->hexen.begin();
             while (hi != this->hexen.end()) {
@@ -3973,16 +4845,231 @@ namespace morph {
          */
         void renumberVectorIndices()
         {
+            // Hexes may have been erased, so the axial-coordinate index must be rebuilt
+            this->hexindex_valid = false;
+            if (this->hexorder != HexGridOrder::list) { this->sortHexen(); }
+            // and any regions cached by vector index are out of date
+            this->clearRegionCache();
             unsigned int vi = 0;
             this->vhexen.clear();
+            this->ihexen.clear();
             auto hi = this->hexen.begin();
             while (hi != this->hexen.end()) {
                 hi->vi = vi++;
                 this->vhexen.push_back (&(*hi));
+                this->ihexen.push_back (hi);
                 ++hi;
             }
         }
 
+        //! Morton (Z-order) index for the integer coordinates x, y
+        static unsigned long long int mortonIndex (unsigned int x, unsigned int y)
+        {
+            unsigned long long int z = 0;
+            for (unsigned int b = 0; b < 32; ++b) {
+                z |= static_cast<unsigned long long int>((x >> b) & 1u) << (2*b);
+                z |= static_cast<unsigned long long int>((y >> b) & 1u) << (2*b + 1);
+            }
+            return z;
+        }
+
+        //! Index along a Hilbert curve filling an n by n square (n a power of 2) for the integer coordinates x, y
+        static unsigned long long int hilbertIndex (unsigned int n, unsigned int x, unsigned int y)
+        {
+            unsigned long long int idx = 0;
+            for (unsigned int s = n/2; s > 0; s /= 2) {
+                unsigned int rx = (x & s) > 0 ? 1 : 0;
+                unsigned int ry = (y & s) > 0 ? 1 : 0;
+                idx += static_cast<unsigned long long int>(s) * s * ((3 * rx) ^ ry);
+                // Rotate the quadrant
+                if (ry == 0) {
+                    if (rx == 1) {
+                        x = n - 1 - x;
+                        y = n - 1 - y;
+                    }
+                    std::swap (x, y);
+                }
+            }
+            return idx;
+        }
+
+        /*!
+         * Sort hexen along the space-filling curve given by hexorder. The curve index of
+         * each Hex is computed once and (index, iterator) pairs are sorted; the list is
+         * then put in that order with splice, which does not invalidate iterators, so the
+         * Hex neighbour relations are preserved.
+         */
+        void sortHexen()
+        {
+            if (this->hexorder == HexGridOrder::list || this->hexen.empty()) { return; }
+            int rmin = std::numeric_limits<int>::max();
+            int gmin = std::numeric_limits<int>::max();
+            int rmax = std::numeric_limits<int>::min();
+            int gmax = std::numeric_limits<int>::min();
+            for (auto& h : this->hexen) {
+                rmin = std::min (rmin, h.ri);
+                gmin = std::min (gmin, h.gi);
+                rmax = std::max (rmax, h.ri);
+                gmax = std::max (gmax, h.gi);
+            }
+            unsigned int n = 1;
+            while (n < static_cast<unsigned int>(std::max (rmax - rmin, gmax - gmin) + 1)) { n *= 2; }
+
+            std::vector<std::pair<unsigned long long int, std::list<Hex>::iterator>> keyed;
+            keyed.reserve (this->hexen.size());
+            for (auto hi = this->hexen.begin(); hi != this->hexen.end(); ++hi) {
+                unsigned int x = static_cast<unsigned int>(hi->ri - rmin);
+                unsigned int y = static_cast<unsigned int>(hi->gi - gmin);
+                keyed.emplace_back (this->hexorder == HexGridOrder::hilbert ? hilbertIndex (n, x, y) : mortonIndex (x, y), hi);
+            }
+            // The curve indices are distinct, so the order of the iterators never decides
+            std::sort (keyed.begin(), keyed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto& k : keyed) { this->hexen.splice (this->hexen.end(), this->hexen, k.second); }
+        }
+
+        /*!
+         * (Re)build hexindex, a dense lookup table from the axial coordinates (ri, gi) of
+         * each Hex in hexen to its iterator. Called lazily by findHexNearest and
+         * findHexNearPoint.
+         */
+        void buildHexIndex()
+        {
+            this->hexindex.clear();
+            this->hexindex_valid = true;
+            if (this->hexen.empty()) { return; }
+            int rmax = std::numeric_limits<int>::min();
+            int gmax = std::numeric_limits<int>::min();
+            this->hexindex_rmin = std::numeric_limits<int>::max();
+            this->hexindex_gmin = std::numeric_limits<int>::max();
+            for (auto h : this->hexen) {
+                this->hexindex_rmin = std::min (this->hexindex_rmin, h.ri);
+                this->hexindex_gmin = std::min (this->hexindex_gmin, h.gi);
+                rmax = std::max (rmax, h.ri);
+                gmax = std::max (gmax, h.gi);
+            }
+            this->hexindex_rspan = rmax - this->hexindex_rmin + 1;
+            this->hexindex_gspan = gmax - this->hexindex_gmin + 1;
+            this->hexindex.resize (this->hexindex_rspan * this->hexindex_gspan, this->hexen.end());
+            for (auto hi = this->hexen.begin(); hi != this->hexen.end(); ++hi) {
+                this->hexindex[(hi->ri - this->hexindex_rmin) + (hi->gi - this->hexindex_gmin) * this->hexindex_rspan] = hi;
+            }
+        }
+
+        //! Return the Hex at axial coordinates (r, g) from hexindex, or hexen.end() if there isn't one
+        std::list<Hex>::iterator indexedHexAt (int r, int g)
+        {
+            int ir = r - this->hexindex_rmin;
+            int ig = g - this->hexindex_gmin;
+            if (ir < 0 || ig < 0 || ir >= this->hexindex_rspan || ig >= this->hexindex_gspan) {
+                return this->hexen.end();
+            }
+            return this->hexindex[ir + ig * this->hexindex_rspan];
+        }
+
+        //! The axial coordinates (ri, gi) of the lattice hex whose centre is nearest to pos
+        morph::vec<int, 2> axialRound (const morph::vec<float, 2>& pos) const
+        {
+            // Fractional axial coordinates (see Hex::computeLocation)
+            float gf = pos[1] / this->v;
+            float rf = (pos[0] - gf * this->d * 0.5f) / this->d;
+            float bf = -rf - gf;
+            // Round in cube coordinates, fixing up the component with the largest error
+            float rr = std::round (rf);
+            float gg = std::round (gf);
+            float bb = std::round (bf);
+            float r_err = std::abs (rr - rf);
+            float g_err = std::abs (gg - gf);
+            float b_err = std::abs (bb - bf);
+            if (r_err > g_err && r_err > b_err) {
+                rr = -gg - bb;
+            } else if (g_err > b_err) {
+                gg = -rr - bb;
+            }
+            return { static_cast<int>(rr), static_cast<int>(gg) };
+        }
+
+        /*!
+         * Use hexindex to find the Hex nearest to pos. The fractional axial coordinates
+         * of pos are rounded to the nearest lattice hex. If that hex exists then it is
+         * the nearest Hex in the grid (only its neighbours are checked, to reproduce the
+         * tie-breaking of an exhaustive search). If it doesn't exist, pos is off the
+         * grid and hexen.end() is returned. hexindex must be valid.
+         */
+        std::list<Hex>::iterator findHexNearestIndexed (const morph::vec<float, 2>& pos)
+        {
+            if (this->hexindex.empty()) { return this->hexen.end(); }
+            const morph::vec<int, 2> rg = this->axialRound (pos);
+            int ri_near = rg[0];
+            int gi_near = rg[1];
+
+            std::list<morph::Hex>::iterator nearest = this->indexedHexAt (ri_near, gi_near);
+            if (nearest == this->hexen.end()) { return nearest; }
+
+            // Check the neighbours so that ties go to the lowest vi, as in an exhaustive search
+            float dx = pos[0] - nearest->x;
+            float dy = pos[1] - nearest->y;
+            float dist = std::sqrt (dx*dx + dy*dy);
+            static constexpr std::array<std::array<int, 2>, 6> nb = {{ {1,0}, {0,1}, {-1,1}, {-1,0}, {0,-1}, {1,-1} }};
+            for (auto n : nb) {
+                std::list<morph::Hex>::iterator hi = this->indexedHexAt (ri_near + n[0], gi_near + n[1]);
+                if (hi == this->hexen.end()) { continue; }
+                dx = pos[0] - hi->x;
+                dy = pos[1] - hi->y;
+                float dl = std::sqrt (dx*dx + dy*dy);
+                if (dl < dist || (dl == dist && hi->vi < nearest->vi)) {
+                    dist = dl;
+                    nearest = hi;
+                }
+            }
+            return nearest;
+        }
+
+        /*!
+         * Fill region_offsets with the axial offsets (dr, dg) of the hexes in rings 0 to
+         * rings (a hex is in ring max(|dr|, |dg|, |dr + dg|)), ring by ring. Ring n starts at
+         * region_offsets[region_ringstart[n]]. Only grows the table.
+         */
+        void computeRegionOffsets (unsigned int rings)
+        {
+            if (this->region_ringstart.size() > rings + 1) { return; }
+            this->region_offsets.clear();
+            this->region_ringstart.clear();
+            const int R = static_cast<int>(rings);
+            for (int n = 0; n <= R; ++n) {
+                this->region_ringstart.push_back (static_cast<unsigned int>(this->region_offsets.size()));
+                for (int dg = -n; dg <= n; ++dg) {
+                    for (int dr = -n; dr <= n; ++dr) {
+                        if (std::max ({ std::abs (dr), std::abs (dg), std::abs (dr + dg) }) == n) {
+                            this->region_offsets.push_back ({ dr, dg });
+                        }
+                    }
+                }
+            }
+            this->region_ringstart.push_back (static_cast<unsigned int>(this->region_offsets.size()));
+        }
+
+        //! Axial offsets of the hexagonal rings about a hex, and the start of each ring. See computeRegionOffsets().
+        std::vector<morph::vec<int, 2>> region_offsets;
+        std::vector<unsigned int> region_ringstart;
+
+        //! Regions memoised by hexagonalRegionIndices(), keyed by (centreindex << 32 | rings)
+        std::unordered_map<unsigned long long int, std::vector<unsigned int>> hexregion_cache;
+
+        //! Regions memoised by getRegionIndices(), keyed by the hash of (flag, points), holding (flag, points) and the region
+        std::unordered_multimap<unsigned long long int, std::pair<std::vector<float>, std::vector<unsigned int>>> pathregion_cache;
+
+        /*!
+         * A dense table of iterators into hexen, indexed by axial coordinate: element
+         * (ri - hexindex_rmin) + (gi - hexindex_gmin) * hexindex_rspan. Empty locations
+         * hold hexen.end(). Invalidated by renumberVectorIndices().
+         */
+        std::vector<std::list<Hex>::iterator> hexindex;
+        int hexindex_rmin = 0;
+        int hexindex_gmin = 0;
+        int hexindex_rspan = 0;
+        int hexindex_gspan = 0;
+        bool hexindex_valid = false;
+
         /*!
          * The centre to centre hex distance between adjacent members of the hex grid.
          */
@@ -0,0 +1,616 @@
+/*!
+ * \file
+ *
+ * A compact hexagonal grid. HexGridFlat holds only the d_ vectors of a HexGrid (positions,
+ * axial coordinates, neighbour indices, flags and distances to the boundary), with no
+ * std::list<Hex> behind them. A hex costs 52 bytes, rather than the several hundred of a
+ * list node holding a Hex, and the grid is a few contiguous arrays, so large grids are
+ * quicker to make, to save and load, and to traverse.
+ *
+ * A HexGridFlat is made by init() (and setBoundary()) just as a HexGrid is, or is copied
+ * from the d_ vectors of an existing HexGrid. The hex_view returned by operator[] gives a
+ * Hex-like view of one hex where that is more convenient than the arrays.
+ */
+#pragma once
+
+#include <morph/HexGrid.h>
+#include <morph/Hex.h>
+#include <morph/BezCurvePath.h>
+#include <morph/BezCoord.h>
+#include <morph/mathconst.h>
+#include <morph/vec.h>
+#include <morph/kd_tree.h>
+
+#ifdef HEXGRID_COMPILE_LOAD_AND_SAVE
+# include <morph/HdfData.h>
+#endif
+
+#include <vector>
+#include <array>
+#include <string>
+#include <deque>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cmath>
+#include <cstddef>
+
+namespace morph {
+
+    class HexGridFlat
+    {
+    public:
+        /*!
+         * The hexes, one element each, with the same meanings as the HexGrid d_ vectors. A
+         * HexGridFlat that was made by init() and setBoundary() holds its hexes in raster
+         * order, row by row (increasing gi) and along each row (increasing ri). One copied
+         * from a HexGrid keeps the HexGrid's order.
+         */
+        std::vector<float> d_x;
+        std::vector<float> d_y;
+        std::vector<int> d_ri;
+        std::vector<int> d_gi;
+        //! Neighbour indices, or -1 where there is no neighbour
+        std::vector<int> d_ne;
+        std::vector<int> d_nne;
+        std::vector<int> d_nnw;
+        std::vector<int> d_nw;
+        std::vector<int> d_nsw;
+        std::vector<int> d_nse;
+        //! The Hex flags (HEX_HAS_NE, HEX_IS_BOUNDARY and so on)
+        std::vector<unsigned int> d_flags;
+        //! Set by computeDistanceToBoundary()
+        std::vector<float> d_distToBoundary;
+
+        //! As HexGrid::boundaryCentroid
+        morph::vec<float, 2> boundaryCentroid = { 0.0f, 0.0f };
+        //! As HexGrid::originalBoundaryCentroid
+        morph::vec<float, 2> originalBoundaryCentroid = { 0.0f, 0.0f };
+
+        //! A read-only, Hex-like view of the hex at index vi in a HexGridFlat
+        struct hex_view
+        {
+            const HexGridFlat* hg = nullptr;
+            unsigned int vi = 0;
+
+            float x() const { return this->hg->d_x[this->vi]; }
+            float y() const { return this->hg->d_y[this->vi]; }
+            morph::vec<float, 2> position() const { return { this->x(), this->y() }; }
+            int ri() const { return this->hg->d_ri[this->vi]; }
+            int gi() const { return this->hg->d_gi[this->vi]; }
+            unsigned int getFlags() const { return this->hg->d_flags[this->vi]; }
+            bool testFlags (const unsigned int f) const { return (this->getFlags() & f) == f; }
+            float distToBoundary() const { return this->hg->d_distToBoundary[this->vi]; }
+            //! As Hex::boundaryHex(): true if the hex is marked as being on the boundary
+            bool boundaryHex() const { return this->testFlags (HEX_IS_BOUNDARY); }
+            //! As Hex::onBoundary(): true if the hex lacks any of its six neighbours
+            bool onBoundary() const { return !this->testFlags (HEX_HAS_NEIGHB_ALL); }
+            //! The index of the neighbour in direction HEX_NEIGHBOUR_POS_E to HEX_NEIGHBOUR_POS_SE, or -1
+            int neighbour (const unsigned int dir) const { return (*this->hg->neighbours()[dir])[this->vi]; }
+            int ne() const { return this->hg->d_ne[this->vi]; }
+            int nne() const { return this->hg->d_nne[this->vi]; }
+            int nnw() const { return this->hg->d_nnw[this->vi]; }
+            int nw() const { return this->hg->d_nw[this->vi]; }
+            int nsw() const { return this->hg->d_nsw[this->vi]; }
+            int nse() const { return this->hg->d_nse[this->vi]; }
+        };
+
+        HexGridFlat() {}
+
+        //! Make the hexagonal grid of hex to hex distance d_ and approximate diameter x_span_
+        HexGridFlat (float d_, float x_span_, float z_ = 0.0f) { this->init (d_, x_span_, z_); }
+
+        //! Copy the hexes of the HexGrid hg, which may then be destroyed
+        explicit HexGridFlat (const morph::HexGrid& hg)
+            : d_x(hg.d_x), d_y(hg.d_y), d_ri(hg.d_ri), d_gi(hg.d_gi)
+            , d_ne(hg.d_ne), d_nne(hg.d_nne), d_nnw(hg.d_nnw), d_nw(hg.d_nw), d_nsw(hg.d_nsw), d_nse(hg.d_nse)
+            , d_flags(hg.d_flags), d_distToBoundary(hg.d_distToBoundary)
+            , boundaryCentroid(hg.boundaryCentroid), originalBoundaryCentroid(hg.originalBoundaryCentroid)
+            , d(hg.getd()), v(hg.getv()), x_span(hg.getXspan()), z(hg.getz())
+        {
+            this->build_index();
+        }
+
+#ifdef HEXGRID_COMPILE_LOAD_AND_SAVE
+        //! Load the grid from the file at path (see load())
+        explicit HexGridFlat (const std::string& path) { this->load (path); }
+#endif
+
+        /*!
+         * Make the hexagonal grid, of hex to hex distance d_ and approximate diameter
+         * x_span_, that HexGrid::init (d_, x_span_, z_) makes. z_ is an identifier for
+         * client code, as for HexGrid.
+         */
+        void init (float d_, float x_span_, float z_ = 0.0f)
+        {
+            this->d = d_;
+            this->v = this->d * morph::mathconst<float>::root_3_over_2;
+            this->x_span = x_span_;
+            this->z = z_;
+            this->clear();
+
+            // The hexes within maxRing hops of the centre, as HexGrid::init makes them
+            const int maxRing = static_cast<int>(std::abs (std::ceil ((this->x_span / 2.0f) / this->d)));
+            const std::size_t n = 1 + 3 * static_cast<std::size_t>(maxRing) * (maxRing + 1);
+            for (auto* vp : { &this->d_x, &this->d_y, &this->d_distToBoundary }) { vp->reserve (n); }
+            for (auto* vp : { &this->d_ri, &this->d_gi }) { vp->reserve (n); }
+            for (int g = -maxRing; g <= maxRing; ++g) {
+                for (int r = std::max (-maxRing, -maxRing - g); r <= std::min (maxRing, maxRing - g); ++r) {
+                    this->push_back (r, g);
+                }
+            }
+            this->d_flags.assign (this->d_x.size(), 0u);
+            this->build_index();
+            this->link_neighbours();
+        }
+
+        /*!
+         * Apply the boundary p, as HexGrid::setBoundary (p, loffset) does: the hexes nearest
+         * to the points of p (computed at steps of d/2) become the boundary, and those
+         * outside it are discarded. The hexes that remain are renumbered in the order they
+         * were in.
+         */
+        void setBoundary (const BezCurvePath<float>& p, bool loffset = true)
+        {
+            if (p.isNull()) { return; }
+            BezCurvePath<float> bp = p;
+            bp.computePoints (this->d / 2.0f, true);
+            std::vector<BezCoord<float>> bpoints = bp.getPoints();
+            this->setBoundary (bpoints, loffset);
+        }
+
+        /*!
+         * Apply the boundary bpoints, as HexGrid::setBoundary (bpoints, loffset). If loffset
+         * is true, bpoints is first translated so that its centroid is at the origin.
+         */
+        void setBoundary (std::vector<BezCoord<float>>& bpoints, bool loffset = true)
+        {
+            this->boundaryCentroid = morph::BezCurvePath<float>::getCentroid (bpoints);
+            if (loffset) {
+                for (auto& bp : bpoints) { bp.subtract (this->boundaryCentroid); }
+                this->originalBoundaryCentroid = this->boundaryCentroid;
+                this->boundaryCentroid = { 0.0f, 0.0f };
+            }
+            if (this->d_x.empty()) { return; }
+
+            // The hex nearest to each boundary point is a boundary hex
+            std::vector<unsigned int> bhexes;
+            int h = std::max (0, this->index_at (0, 0));
+            for (const auto& bp : bpoints) {
+                h = this->findHexNearest (bp.coord, h);
+                if ((this->d_flags[h] & HEX_IS_BOUNDARY) == 0u) { bhexes.push_back (h); }
+                this->d_flags[h] |= HEX_IS_BOUNDARY | HEX_INSIDE_BOUNDARY;
+            }
+            if (!this->boundary_connected (bhexes)) {
+                throw std::runtime_error ("The constructed boundary is not a contiguous sequence of hexes.");
+            }
+
+            this->mark_inside_polygon (bpoints);
+            this->discard_not_inside();
+        }
+
+        //! Apply the elliptical boundary of radii a and b, centred at c (see HexGrid::setEllipticalBoundary)
+        void setEllipticalBoundary (const float a, const float b,
+                                    const morph::vec<float, 2> c = { 0.0f, 0.0f }, bool offset = true)
+        {
+            std::vector<BezCoord<float>> bpoints = this->ellipseCompute (a, b, c);
+            this->setBoundary (bpoints, offset);
+        }
+
+        //! Apply a circular boundary of radius a centred at c
+        void setCircularBoundary (const float a, const morph::vec<float, 2> c = { 0.0f, 0.0f }, bool offset = true)
+        {
+            std::vector<BezCoord<float>> bpoints = this->ellipseCompute (a, a, c);
+            this->setBoundary (bpoints, offset);
+        }
+
+        //! The points on an ellipse that HexGrid::ellipseCompute (a, b, c) returns
+        std::vector<BezCoord<float>> ellipseCompute (const float a, const float b,
+                                                     const morph::vec<float, 2> c = { 0.0f, 0.0f }) const
+        {
+            std::vector<BezCoord<float>> bpoints;
+            const double delta_phi = std::atan2 (this->d / 2.0, a > b ? a : b);
+            for (double phi = 0.0; phi < morph::mathconst<double>::two_pi; phi += delta_phi) {
+                morph::vec<float, 2> xy_pt = { static_cast<float>(a * std::cos (phi)), static_cast<float>(b * std::sin (phi)) };
+                xy_pt += c;
+                bpoints.push_back (BezCoord<float>(xy_pt));
+            }
+            return bpoints;
+        }
+
+        /*!
+         * Set d_distToBoundary as HexGrid::computeDistanceToBoundary() does: the distance to
+         * the nearest boundary hex for hexes inside the boundary, 0 for boundary hexes and
+         * -100 for any others. The nearest boundary hexes are found with a kd_tree.
+         */
+        void computeDistanceToBoundary()
+        {
+            std::vector<morph::vec<float, 2>> bpts;
+            const int n = static_cast<int>(this->num());
+            for (int i = 0; i < n; ++i) {
+                if (this->d_flags[i] & HEX_IS_BOUNDARY) { bpts.push_back ({ this->d_x[i], this->d_y[i] }); }
+            }
+            morph::kd_tree<float, 2> tree;
+            tree.build (bpts);
+#pragma omp parallel for
+            for (int i = 0; i < n; ++i) {
+                if (this->d_flags[i] & HEX_IS_BOUNDARY) {
+                    this->d_distToBoundary[i] = 0.0f;
+                } else if ((this->d_flags[i] & HEX_INSIDE_BOUNDARY) == 0u) {
+                    this->d_distToBoundary[i] = -100.0f;
+                } else {
+                    const unsigned int j = tree.nearest ({ this->d_x[i], this->d_y[i] });
+                    if (j != morph::kd_tree<float, 2>::none) {
+                        const float dx = bpts[j][0] - this->d_x[i];
+                        const float dy = bpts[j][1] - this->d_y[i];
+                        this->d_distToBoundary[i] = std::sqrt (dx * dx + dy * dy);
+                    }
+                }
+            }
+        }
+
+        //! The number of hexes
+        unsigned int num() const { return static_cast<unsigned int>(this->d_x.size()); }
+
+        //! A view of the hex at index vi
+        hex_view operator[] (const unsigned int vi) const { return hex_view{ this, vi }; }
+
+        //! The index of the hex at axial coordinates (r, g), or -1 if the grid has no such hex
+        int index_at (const int r, const int g) const
+        {
+            auto it = std::lower_bound (this->axial_index.begin(), this->axial_index.end(), std::make_pair (g, r),
+                                        [this](const unsigned int i, const std::pair<int, int>& gr) {
+                                            return std::make_pair (this->d_gi[i], this->d_ri[i]) < gr;
+                                        });
+            if (it == this->axial_index.end() || this->d_gi[*it] != g || this->d_ri[*it] != r) { return -1; }
+            return static_cast<int>(*it);
+        }
+
+        /*!
+         * The index of the hex nearest to pos (ties go to the lower index), or -1 if the grid
+         * is empty. The lattice hex under pos is found by rounding its axial coordinates, so
+         * this takes time logarithmic in the number of hexes. If pos is off the grid, then
+         * the search walks from neighbour to nearer neighbour, starting from the hex at index
+         * start, as HexGrid::findHexNearPoint does; with no start, every hex is searched.
+         */
+        int findHexNearest (const morph::vec<float, 2>& pos, const int start = -1) const
+        {
+            if (this->d_x.empty()) { return -1; }
+            // Fractional axial coordinates, rounded in cube coordinates (see HexGrid::findHexNearestIndexed)
+            const float gf = pos[1] / this->v;
+            const float rf = (pos[0] - gf * this->d * 0.5f) / this->d;
+            const float bf = -rf - gf;
+            float rr = std::round (rf);
+            float gg = std::round (gf);
+            const float bb = std::round (bf);
+            const float r_err = std::abs (rr - rf);
+            const float g_err = std::abs (gg - gf);
+            const float b_err = std::abs (bb - bf);
+            if (r_err > g_err && r_err > b_err) {
+                rr = -gg - bb;
+            } else if (g_err > b_err) {
+                gg = -rr - bb;
+            }
+            const int r0 = static_cast<int>(rr);
+            const int g0 = static_cast<int>(gg);
+
+            int nearest = this->index_at (r0, g0);
+            float dist = std::numeric_limits<float>::max();
+            auto consider = [this, &pos, &nearest, &dist](const int i) {
+                const float dx = pos[0] - this->d_x[i];
+                const float dy = pos[1] - this->d_y[i];
+                const float dl = std::sqrt (dx * dx + dy * dy);
+                if (dl < dist || (dl == dist && i < nearest)) { dist = dl; nearest = i; }
+            };
+            if (nearest >= 0) {
+                consider (nearest);
+                for (const auto& o : HexGridFlat::offsets) {
+                    const int i = this->index_at (r0 + o[0], g0 + o[1]);
+                    if (i >= 0) { consider (i); }
+                }
+            } else if (start >= 0) {
+                // Off the grid; walk towards pos
+                nearest = start;
+                consider (start);
+                const auto nbs = this->neighbours();
+                bool nearer = true;
+                while (nearer) {
+                    nearer = false;
+                    for (const auto* nb : nbs) {
+                        const int j = (*nb)[nearest];
+                        if (j < 0) { continue; }
+                        const float dx = pos[0] - this->d_x[j];
+                        const float dy = pos[1] - this->d_y[j];
+                        const float dl = std::sqrt (dx * dx + dy * dy);
+                        if (dl < dist) { dist = dl; nearest = j; nearer = true; break; }
+                    }
+                }
+            } else {
+                // Off the grid; search every hex
+                for (int i = 0; i < static_cast<int>(this->num()); ++i) { consider (i); }
+            }
+            return nearest;
+        }
+
+        //! The indices of the hexes flagged HEX_IS_BOUNDARY, in index order
+        std::vector<unsigned int> getBoundary() const
+        {
+            std::vector<unsigned int> b;
+            for (unsigned int i = 0; i < this->num(); ++i) { if (this->d_flags[i] & HEX_IS_BOUNDARY) { b.push_back (i); } }
+            return b;
+        }
+
+        //! The six neighbour vectors, in the order of HEX_NEIGHBOUR_POS_E to HEX_NEIGHBOUR_POS_SE
+        std::array<const std::vector<int>*, 6> neighbours() const
+        {
+            return { &this->d_ne, &this->d_nne, &this->d_nnw, &this->d_nw, &this->d_nsw, &this->d_nse };
+        }
+
+        //! The number of bytes held by the grid's vectors
+        std::size_t memory_bytes() const
+        {
+            std::size_t b = sizeof (float) * (this->d_x.capacity() + this->d_y.capacity() + this->d_distToBoundary.capacity());
+            b += sizeof (int) * (this->d_ri.capacity() + this->d_gi.capacity());
+            for (const auto* n : this->neighbours()) { b += sizeof (int) * n->capacity(); }
+            b += sizeof (unsigned int) * (this->d_flags.capacity() + this->axial_index.capacity());
+            return b;
+        }
+
+        float getd() const { return this->d; }
+        float getv() const { return this->v; }
+        float getXspan() const { return this->x_span; }
+        float getz() const { return this->z; }
+
+#ifdef HEXGRID_COMPILE_LOAD_AND_SAVE
+        /*!
+         * Save the grid into the HDF5 file at path. The d_ datasets have the same names as
+         * those that HexGrid::save and HexGrid::saveCache write, but there are no per-Hex
+         * records, so the file can be read by HexGridFlat::load only.
+         */
+        void save (const std::string& path) const
+        {
+            morph::HdfData hgdata (path);
+            hgdata.add_val ("/d", this->d);
+            hgdata.add_val ("/v", this->v);
+            hgdata.add_val ("/x_span", this->x_span);
+            hgdata.add_val ("/z", this->z);
+            hgdata.add_contained_vals ("/boundaryCentroid", this->boundaryCentroid);
+            hgdata.add_contained_vals ("/d_x", this->d_x);
+            hgdata.add_contained_vals ("/d_y", this->d_y);
+            hgdata.add_contained_vals ("/d_distToBoundary", this->d_distToBoundary);
+            hgdata.add_contained_vals ("/d_ri", this->d_ri);
+            hgdata.add_contained_vals ("/d_gi", this->d_gi);
+            hgdata.add_contained_vals ("/d_ne", this->d_ne);
+            hgdata.add_contained_vals ("/d_nne", this->d_nne);
+            hgdata.add_contained_vals ("/d_nnw", this->d_nnw);
+            hgdata.add_contained_vals ("/d_nw", this->d_nw);
+            hgdata.add_contained_vals ("/d_nsw", this->d_nsw);
+            hgdata.add_contained_vals ("/d_nse", this->d_nse);
+            hgdata.add_contained_vals ("/d_flags", this->d_flags);
+        }
+
+        /*!
+         * Load the grid from the HDF5 file at path, written by save(), HexGrid::save or
+         * HexGrid::saveCache. Only the d_ datasets are read, so a HexGrid file is loaded
+         * without making any of its Hexes.
+         */
+        void load (const std::string& path)
+        {
+            morph::HdfData hgdata (path, morph::FileAccess::ReadOnly);
+            hgdata.read_val ("/d", this->d);
+            hgdata.read_val ("/v", this->v);
+            hgdata.read_val ("/x_span", this->x_span);
+            hgdata.read_val ("/z", this->z);
+            hgdata.read_contained_vals ("/boundaryCentroid", this->boundaryCentroid);
+            hgdata.read_contained_vals ("/d_x", this->d_x);
+            hgdata.read_contained_vals ("/d_y", this->d_y);
+            hgdata.read_contained_vals ("/d_distToBoundary", this->d_distToBoundary);
+            hgdata.read_contained_vals ("/d_ri", this->d_ri);
+            hgdata.read_contained_vals ("/d_gi", this->d_gi);
+            hgdata.read_contained_vals ("/d_ne", this->d_ne);
+            hgdata.read_contained_vals ("/d_nne", this->d_nne);
+            hgdata.read_contained_vals ("/d_nnw", this->d_nnw);
+            hgdata.read_contained_vals ("/d_nw", this->d_nw);
+            hgdata.read_contained_vals ("/d_nsw", this->d_nsw);
+            hgdata.read_contained_vals ("/d_nse", this->d_nse);
+            hgdata.read_contained_vals ("/d_flags", this->d_flags);
+            const std::size_t n = this->d_x.size();
+            bool ok = this->d_y.size() == n && this->d_distToBoundary.size() == n && this->d_ri.size() == n
+            && this->d_gi.size() == n && this->d_flags.size() == n;
+            for (const auto* nb : this->neighbours()) { ok = ok && nb->size() == n; }
+            if (!ok) { throw std::runtime_error ("HexGridFlat::load: The d_ datasets in " + path + " differ in size"); }
+            this->build_index();
+        }
+#endif
+
+    private:
+        //! The axial offsets (dr, dg) of the neighbours E, NE, NW, W, SW and SE
+        static constexpr std::array<std::array<int, 2>, 6> offsets = {{ {1,0}, {0,1}, {-1,1}, {-1,0}, {0,-1}, {1,-1} }};
+        //! The HEX_HAS_ flags in the same order
+        static constexpr std::array<unsigned int, 6> has_flags = { HEX_HAS_NE, HEX_HAS_NNE, HEX_HAS_NNW,
+                                                                   HEX_HAS_NW, HEX_HAS_NSW, HEX_HAS_NSE };
+
+        std::array<std::vector<int>*, 6> neighbours_mutable()
+        {
+            return { &this->d_ne, &this->d_nne, &this->d_nnw, &this->d_nw, &this->d_nsw, &this->d_nse };
+        }
+
+        void clear()
+        {
+            for (auto* vp : { &this->d_x, &this->d_y, &this->d_distToBoundary }) { vp->clear(); }
+            for (auto* vp : { &this->d_ri, &this->d_gi }) { vp->clear(); }
+            for (auto* n : this->neighbours_mutable()) { n->clear(); }
+            this->d_flags.clear();
+            this->axial_index.clear();
+        }
+
+        //! Append the hex at (r, g), located as Hex::computeLocation() would locate it
+        void push_back (const int r, const int g)
+        {
+            constexpr int b = 0;
+            this->d_x.push_back (this->d * r + (this->d / 2.0f) * g - (this->d / 2.0f) * b);
+            this->d_y.push_back (this->v * g + this->v * b);
+            this->d_ri.push_back (r);
+            this->d_gi.push_back (g);
+            this->d_distToBoundary.push_back (-1.0f);
+        }
+
+        //! Sort axial_index by (gi, ri)
+        void build_index()
+        {
+            this->axial_index.resize (this->d_x.size());
+            for (unsigned int i = 0; i < this->axial_index.size(); ++i) { this->axial_index[i] = i; }
+            auto axial_less = [this](const unsigned int a, const unsigned int b) {
+                return std::make_pair (this->d_gi[a], this->d_ri[a]) < std::make_pair (this->d_gi[b], this->d_ri[b]);
+            };
+            // Grids in raster order are sorted already
+            if (!std::is_sorted (this->axial_index.begin(), this->axial_index.end(), axial_less)) {
+                std::sort (this->axial_index.begin(), this->axial_index.end(), axial_less);
+            }
+        }
+
+        /*!
+         * Set the neighbour vectors and the HEX_HAS_ flags from the axial coordinates. A
+         * dense table of indices over the grid's bounding parallelogram (as HexGrid::hexindex)
+         * is used while linking, and freed afterwards.
+         */
+        void link_neighbours()
+        {
+            const int n = static_cast<int>(this->num());
+            auto nbs = this->neighbours_mutable();
+            for (auto* nb : nbs) { nb->assign (n, -1); }
+            if (n == 0) { return; }
+            // With a margin of one hex all round, so that every neighbour's cell exists
+            const auto [rmin, rmax] = std::minmax_element (this->d_ri.begin(), this->d_ri.end());
+            const auto [gmin, gmax] = std::minmax_element (this->d_gi.begin(), this->d_gi.end());
+            const int r0 = *rmin - 1;
+            const int g0 = *gmin - 1;
+            const std::size_t rspan = *rmax - r0 + 2;
+            const std::size_t gspan = *gmax - g0 + 2;
+            std::vector<int> table (rspan * gspan, -1);
+            auto cell = [r0, g0, rspan](const int r, const int g) { return (r - r0) + (g - g0) * rspan; };
+            for (int i = 0; i < n; ++i) { table[cell (this->d_ri[i], this->d_gi[i])] = i; }
+#pragma omp parallel for
+            for (int i = 0; i < n; ++i) {
+                unsigned int f = this->d_flags[i] & ~static_cast<unsigned int>(HEX_HAS_NEIGHB_ALL);
+                for (unsigned int k = 0; k < 6; ++k) {
+                    const int j = table[cell (this->d_ri[i] + HexGridFlat::offsets[k][0], this->d_gi[i] + HexGridFlat::offsets[k][1])];
+                    (*nbs[k])[i] = j;
+                    if (j >= 0) { f |= HexGridFlat::has_flags[k]; }
+                }
+                this->d_flags[i] = f;
+            }
+        }
+
+        //! True if the boundary hexes bhexes are joined, neighbour to neighbour, into one group
+        bool boundary_connected (const std::vector<unsigned int>& bhexes) const
+        {
+            if (bhexes.empty()) { return false; }
+            std::vector<char> seen (this->num(), 0);
+            std::deque<unsigned int> q = { bhexes[0] };
+            seen[bhexes[0]] = 1;
+            std::size_t reached = 1;
+            while (!q.empty()) {
+                const unsigned int h = q.front();
+                q.pop_front();
+                for (const auto* nb : this->neighbours()) {
+                    const int j = (*nb)[h];
+                    if (j >= 0 && !seen[j] && (this->d_flags[j] & HEX_IS_BOUNDARY)) {
+                        seen[j] = 1;
+                        ++reached;
+                        q.push_back (j);
+                    }
+                }
+            }
+            return reached == bhexes.size();
+        }
+
+        //! Flag HEX_INSIDE_BOUNDARY the hexes whose centres lie inside bpoints, as HexGrid::markHexesInsidePolygon()
+        void mark_inside_polygon (const std::vector<BezCoord<float>>& bpoints)
+        {
+            if (bpoints.size() < 3) { return; }
+            const int gmin = *std::min_element (this->d_gi.begin(), this->d_gi.end());
+            const int gmax = *std::max_element (this->d_gi.begin(), this->d_gi.end());
+            // Per row, the x of each crossing and the direction (+1 upwards) of its edge
+            std::vector<std::vector<std::pair<float, int>>> crossings (gmax - gmin + 1);
+            const std::size_t np = bpoints.size();
+            for (std::size_t i = 0; i < np; ++i) {
+                const BezCoord<float>& p0 = bpoints[i];
+                const BezCoord<float>& p1 = bpoints[(i + 1) % np];
+                if (p0.y() == p1.y()) { continue; }
+                const float ylo = std::min (p0.y(), p1.y());
+                const float yhi = std::max (p0.y(), p1.y());
+                const int dir = p1.y() > p0.y() ? 1 : -1;
+                const int g0 = std::max (gmin, static_cast<int>(std::floor (ylo / this->v)) - 1);
+                const int g1 = std::min (gmax, static_cast<int>(std::ceil (yhi / this->v)) + 1);
+                for (int g = g0; g <= g1; ++g) {
+                    const float yr = this->v * g;
+                    if (yr < ylo || yr >= yhi) { continue; }
+                    crossings[g - gmin].push_back ({ p0.x() + (yr - p0.y()) * (p1.x() - p0.x()) / (p1.y() - p0.y()), dir });
+                }
+            }
+            for (auto& c : crossings) {
+                std::sort (c.begin(), c.end());
+                for (std::size_t k = 1; k < c.size(); ++k) { c[k].second += c[k - 1].second; }
+            }
+            const int n = static_cast<int>(this->num());
+#pragma omp parallel for
+            for (int i = 0; i < n; ++i) {
+                if (this->d_flags[i] & HEX_IS_BOUNDARY) { continue; }
+                const std::vector<std::pair<float, int>>& c = crossings[this->d_gi[i] - gmin];
+                const auto right = std::lower_bound (c.begin(), c.end(), this->d_x[i],
+                                                     [](const std::pair<float, int>& a, const float x) { return a.first < x; });
+                if (right != c.begin() && (right - 1)->second != 0) { this->d_flags[i] |= HEX_INSIDE_BOUNDARY; }
+            }
+        }
+
+        //! Drop the hexes not flagged HEX_INSIDE_BOUNDARY, keeping the order of the rest
+        void discard_not_inside()
+        {
+            const unsigned int n = this->num();
+            std::vector<int> newidx (n, -1);
+            unsigned int k = 0;
+            for (unsigned int i = 0; i < n; ++i) {
+                if (this->d_flags[i] & HEX_INSIDE_BOUNDARY) { newidx[i] = static_cast<int>(k++); }
+            }
+            auto compact = [&newidx, n](auto& vec) {
+                unsigned int j = 0;
+                for (unsigned int i = 0; i < n; ++i) { if (newidx[i] >= 0) { vec[j++] = vec[i]; } }
+                vec.resize (j);
+                vec.shrink_to_fit();
+            };
+            compact (this->d_x);
+            compact (this->d_y);
+            compact (this->d_ri);
+            compact (this->d_gi);
+            compact (this->d_flags);
+            compact (this->d_distToBoundary);
+            auto nbs = this->neighbours_mutable();
+            for (auto* nb : nbs) {
+                compact (*nb);
+                for (int& j : *nb) { j = j >= 0 ? newidx[j] : -1; }
+            }
+            // Neighbours that were discarded are gone
+            for (unsigned int i = 0; i < k; ++i) {
+                for (unsigned int m = 0; m < 6; ++m) {
+                    if ((*nbs[m])[i] < 0) { this->d_flags[i] &= ~HexGridFlat::has_flags[m]; }
+                }
+            }
+            this->build_index();
+        }
+
+        //! Indices of the hexes, sorted by (gi, ri), for index_at()
+        std::vector<unsigned int> axial_index;
+
+        //! The centre to centre distance between adjacent hexes
+        float d = 1.0f;
+        //! The distance between adjacent rows of hexes
+        float v = 1.0f * morph::mathconst<float>::root_3_over_2;
+        //! The approximate diameter of the initial hexagonal grid
+        float x_span = 10.0f;
+        //! The z coordinate of the grid, as HexGrid::z
+        float z = 0.0f;
+    };
+
+} // namespace morph
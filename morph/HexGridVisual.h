@@ -53,7 +53,8 @@ namespace morph {
     enum class HexVisMode
     {
         Triangles, // Render triangles with a triangle vertex at the centre of each Hex. Fast (x3.7 cf. HexInterp).
-        HexInterp  // Render each hex as an actual hex made of 6 triangles.
+        HexInterp, // Render each hex as an actual hex made of 6 triangles.
+        Heightmap  // As Triangles, but with z, normals and colours computed by the vertex shader from a data texture
         // Could add HexBars - like the Giant's Causeway in Co. Antrim
     };
 
@@ -106,9 +107,9 @@ namespace morph {
             if (this->scalarData != nullptr) {
                 // What do these scaling operations do to any NaNs in scalarData? They should remain
                 // NaN. Then in dcopy, might want to make them 0.
-                this->zScale.transform (*(this->scalarData), this->dcopy);
+                this->transformScalarData (this->zScale, this->dcopy);
                 dcopy.replace_nan_with (this->zScale.transform_one(0.0f));
-                this->colourScale.transform (*(this->scalarData), this->dcolour);
+                this->transformScalarData (this->colourScale, this->dcolour);
 
             } else if (this->vectorData != nullptr) {
 
@@ -136,6 +137,14 @@ namespace morph {
                     this->colourScale3.transform (this->dcolour3, this->dcolour3);
                 } // else assume dcolour/dcolour2/dcolour3 are all in range 0->1 (or 0-255) already
             }
+
+            // Convert all the colours in one batch (which is fastest if cm has a lookup table)
+            if (this->cm.numDatums() == 1) {
+                this->dcolour_rgb.resize (3u * this->dcolour.size());
+                this->cm.convert_batch (this->dcolour, this->dcolour_rgb.data());
+            } else {
+                this->dcolour_rgb.clear();
+            }
         }
 
         //! Zoom factor
@@ -171,6 +180,11 @@ namespace morph {
                 this->initializeVerticesTris (update);
                 break;
             }
+            case HexVisMode::Heightmap:
+            {
+                this->initializeVerticesHeightmap (update);
+                break;
+            }
             case HexVisMode::HexInterp:
             default:
             {
@@ -189,16 +203,22 @@ namespace morph {
             this->reinit_buffers(); // could potentially be 'reinit_position_color_buffers_only()'
         }
 
-        // Override the updateData method
-        void updateData (const std::vector<T>* _data)
+        // After updateData, only the positions and colours need to change
+        void scalarDataUpdated() override
         {
-            this->scalarData = _data;
             switch (this->hexVisMode) {
             case HexVisMode::Triangles:
             {
                 this->reinit_on_update(); // instead of VisualDataModel<T,glver>::reinit().
                 break;
             }
+            case HexVisMode::Heightmap:
+            {
+                // Only the data texture changes, and it is uploaded by render_geometry()
+                this->setup_height_map (this->zoom);
+                this->displaceBoundingBox();
+                break;
+            }
             default:
             {
                 VisualDataModel<T,glver>::reinit();
@@ -207,6 +227,20 @@ namespace morph {
             }
         }
 
+        //! Models of one HexGrid may share their mesh (see VisualModel::share_geometry)
+        const void* geometry_source() const override { return this->hg; }
+
+        //! For VisualDataModel::updateColourFromBuffer. Note that marked hexes lose their markings.
+        //! 0 in Heightmap mode, in which the colours come from the data texture.
+        unsigned int verticesPerDatum() const
+        {
+            switch (this->hexVisMode) {
+            case HexVisMode::Triangles: { return 1u; }
+            case HexVisMode::Heightmap: { return 0u; }
+            default: { return 7u; }
+            }
+        }
+
         // Initialize vertex buffer objects and vertex array object.
 
         /*!
@@ -228,9 +262,10 @@ namespace morph {
                 this->vertexPositions.resize (3u * nhex);
                 this->vertexNormals.resize (3u * nhex);
                 this->vertexColors.resize (3u * nhex);
-                this->indices.reserve (6u * nhex);
             }
 
+            // Each hex writes only its own 3 floats, so the hexes can be filled in parallel
+#pragma omp parallel for
             for (unsigned int hi = 0; hi < nhex; ++hi) {
                 std::array<float, 3> clr = this->setColour (hi);
                 // If dataCoords has been populated, use these for hex positions, allowing for
@@ -267,27 +302,84 @@ namespace morph {
 
             // Build indices based on neighbour relations in the HexGrid
             // Only needs to happen *on init*. On update, this will not change :)
+            if (update == false) { this->computeTriangleIndices(); }
+        }
+
+        //! Build the indices of the triangles between hex centres (one vertex per hex)
+        void computeTriangleIndices()
+        {
+            unsigned int nhex = this->hg->num();
+            // Each hex makes 0, 1 or 2 triangles. Count them to find where each hex's
+            // indices go, then fill them in parallel.
+            std::vector<std::size_t> ind_start (nhex + 1u, 0u);
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
+                std::size_t ntri = (HAS_NNE(hi) && HAS_NE(hi) ? 1u : 0u) + (HAS_NW(hi) && HAS_NSW(hi) ? 1u : 0u);
+                ind_start[hi + 1u] = ind_start[hi] + 3u * ntri;
+            }
+            this->indices.resize (ind_start[nhex]);
+#pragma omp parallel for
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
+                std::size_t ind_sz = ind_start[hi];
+                if (HAS_NNE(hi) && HAS_NE(hi)) {
+                    this->indices[ind_sz++] = hi;
+                    this->indices[ind_sz++] = NNE(hi);
+                    this->indices[ind_sz++] = NE(hi);
+                }
+
+                if (HAS_NW(hi) && HAS_NSW(hi)) {
+                    this->indices[ind_sz++] = hi;
+                    this->indices[ind_sz++] = NW(hi);
+                    this->indices[ind_sz++] = NSW(hi);
+                }
+            }
+            this->idx = nhex;
+        }
+
+        /*!
+         * Initialize with a vertex at each hex centre, like initializeVerticesTris, but leave
+         * z, the normals and the colours to the vertex shader, which computes them from the data
+         * in a texture (see VisualModel::data_tex_displace). The x/y mesh is built once; an
+         * update only copies the data for the texture, which is a single small upload.
+         *
+         * Requires scalarData, a one dimensional colour map and linear colourScale and zScale.
+         * dataCoords and markedHexes are not used.
+         */
+        void initializeVerticesHeightmap (const bool update)
+        {
             if (update == false) {
-                std::size_t ind_sz = 0;
+                if (this->dataCoords != nullptr) {
+                    throw std::runtime_error ("HexGridVisual: hexVisMode == Heightmap can't use dataCoords");
+                }
+                unsigned int nhex = this->hg->num();
+                // Texels are hexes by axial coordinates: east is +x, north east is +y
+                std::vector<morph::vec<int, 2>> tc (nhex);
                 for (unsigned int hi = 0; hi < nhex; ++hi) {
-                    if (HAS_NNE(hi) && HAS_NE(hi)) {
-                        //std::cout << "1st triangle " << hi << "->" << NNE(hi) << "->" << NE(hi) << std::endl;
-                        this->indices.resize (ind_sz + 3);
-                        this->indices[ind_sz++] = hi;
-                        this->indices[ind_sz++] = NNE(hi);
-                        this->indices[ind_sz++] = NE(hi);
-                    }
-
-                    if (HAS_NW(hi) && HAS_NSW(hi)) {
-                        //std::cout << "2nd triangle " << hi << "->" << NW(hi) << "->" << NSW(hi) << std::endl;
-                        this->indices.resize (ind_sz + 3);
-                        this->indices[ind_sz++] = hi;
-                        this->indices[ind_sz++] = NW(hi);
-                        this->indices[ind_sz++] = NSW(hi);
-                    }
+                    tc[hi] = { this->hg->d_ri[hi] - this->hg->d_bi[hi], this->hg->d_gi[hi] + this->hg->d_bi[hi] };
+                }
+                static constexpr std::array<morph::vec<int, 2>, 6> nbrs = {
+                    morph::vec<int, 2>{1, 0}, {0, 1}, {-1, 1}, {-1, 0}, {0, -1}, {1, -1}
+                };
+                this->set_height_texels (tc, nbrs);
+                this->vertexPositions.resize (3u * nhex);
+                this->vertexNormals.resize (3u * nhex);
+                this->vertexColors.resize (3u * nhex);
+                for (unsigned int hi = 0; hi < nhex; ++hi) {
+                    this->vertexPositions[hi * 3] = this->zoom * this->hg->d_x[hi];
+                    this->vertexPositions[hi * 3 + 1] = this->zoom * this->hg->d_y[hi];
+                    this->vertexPositions[hi * 3 + 2] = 0.0f;
+                    this->vertexNormals[hi * 3] = 0.0f;
+                    this->vertexNormals[hi * 3 + 1] = 0.0f;
+                    this->vertexNormals[hi * 3 + 2] = 1.0f;
+                    // A blue component of -2 tells the shader that red and green hold the texel
+                    this->vertexColors[hi * 3] = static_cast<float>(tc[hi][0]);
+                    this->vertexColors[hi * 3 + 1] = static_cast<float>(tc[hi][1]);
+                    this->vertexColors[hi * 3 + 2] = -2.0f;
                 }
-                this->idx = nhex;
+                this->computeTriangleIndices();
+                this->data_tex_displace = 2;
+                this->data_tex_spacing = { this->zoom * this->hg->getd(), this->zoom * this->hg->getv() };
             }
+            this->setup_height_map (this->zoom);
         }
 
         //! Initialize as hexes, with z position of each of the 6
@@ -316,41 +408,74 @@ namespace morph {
         {
             // Here's a complication. In a transformed grid, we can't rely on these. Should be able
             // to *compute* them though.
-            float sr = this->hg->getSR();
-            float vne = this->hg->getVtoNE();
-            float lr = this->hg->getLR();
+            const float sr = this->hg->getSR();
+            const float vne = this->hg->getVtoNE();
+            const float lr = this->hg->getLR();
 
             unsigned int nhex = this->hg->num();
 
             this->setupScaling();
 
-            // x and y coords on the HexGrid. May be replaced if dataCoords has been set.
-            float _x = 0.0f;
-            float _y = 0.0f;
-            // These Ts are all floats, right?
-            float datumC = 0.0f;   // datum at the centre
-            float datumNE = 0.0f;  // datum at the hex to the east.
-            float datumNNE = 0.0f; // etc
-            float datumNNW = 0.0f;
-            float datumNW = 0.0f;
-            float datumNSW = 0.0f;
-            float datumNSE = 0.0f;
-
-            float datum = 0.0f;
-            float third = 0.3333333f;
-            float half = 0.5f;
-            morph::vec<float> vtx_0, vtx_1, vtx_2, vtx_tmp;
-
-            morph::vec<float> coordC = { 0.0f, 0.0f, 0.0f };
-            morph::vec<float> coordNE = coordC;
-            morph::vec<float> coordNNE = coordC;
-            morph::vec<float> coordNNW = coordC;
-            morph::vec<float> coordNW = coordC;
-            morph::vec<float> coordNSW = coordC;
-            morph::vec<float> coordNSE = coordC;
+            const float third = 0.3333333f;
+            const float half = 0.5f;
+            const std::array<float, 3> blkclr = {0,0,0};
+
+            // Mark hexes first, as markedHexes can't be modified from the parallel loop below
+            for (unsigned int hi = 0; hi < nhex; ++hi) {
+                if (this->showboundary && (this->hg->vhexen[hi])->boundaryHex() == true) {
+                    this->markHex (hi);
+                }
+                if (this->showcentre) {
+                    float _x = this->dataCoords == nullptr ? this->hg->d_x[hi] : (*this->dataCoords)[hi][0];
+                    float _y = this->dataCoords == nullptr ? this->hg->d_y[hi] : (*this->dataCoords)[hi][1];
+                    if (_x == 0.0f && _y == 0.0f) { this->markHex (hi); }
+                }
+            }
 
+            // Each hex has exactly 7 vertices (21 floats each of positions, normals and colours)
+            // and 18 indices, so allocate all of them now and fill each hex's ranges in parallel.
+            const std::size_t vp0 = this->vertexPositions.size();
+            const std::size_t vn0 = this->vertexNormals.size();
+            const std::size_t vc0 = this->vertexColors.size();
+            const std::size_t i0 = this->indices.size();
+            const GLuint idx0 = this->idx;
+            this->vertexPositions.resize (vp0 + 21u * nhex);
+            this->vertexNormals.resize (vn0 + 21u * nhex);
+            this->vertexColors.resize (vc0 + 21u * nhex);
+            this->indices.resize (i0 + 18u * nhex);
+
+#pragma omp parallel for
             for (unsigned int hi = 0; hi < nhex; ++hi) {
 
+                // x and y coords on the HexGrid. May be replaced if dataCoords has been set.
+                float _x = 0.0f;
+                float _y = 0.0f;
+                float datumC = 0.0f;   // datum at the centre
+                float datumNE = 0.0f;  // datum at the hex to the east.
+                float datumNNE = 0.0f; // etc
+                float datumNNW = 0.0f;
+                float datumNW = 0.0f;
+                float datumNSW = 0.0f;
+                float datumNSE = 0.0f;
+
+                float datum = 0.0f;
+                morph::vec<float> vtx_0, vtx_1, vtx_2, vtx_tmp;
+
+                morph::vec<float> coordC = { 0.0f, 0.0f, 0.0f };
+                morph::vec<float> coordNE = coordC;
+                morph::vec<float> coordNNE = coordC;
+                morph::vec<float> coordNNW = coordC;
+                morph::vec<float> coordNW = coordC;
+                morph::vec<float> coordNSW = coordC;
+                morph::vec<float> coordNSE = coordC;
+
+                // Where this hex's data go
+                const std::size_t vp = vp0 + 21u * hi;
+                const std::size_t vn = vn0 + 21u * hi;
+                const std::size_t vc = vc0 + 21u * hi;
+                const std::size_t ii = i0 + 18u * hi;
+                const GLuint v0 = idx0 + 7u * hi;
+
                 if (this->dataCoords == nullptr) {
                     _x = this->hg->d_x[hi];
                     _y = this->hg->d_y[hi];
@@ -387,19 +512,12 @@ namespace morph {
                 // Use a single colour for each hex, even though hex z positions are
                 // interpolated. Do the _colour_ scaling:
                 std::array<float, 3> clr = this->setColour (hi);
-                if (this->showboundary && (this->hg->vhexen[hi])->boundaryHex() == true) {
-                    this->markHex (hi);
-                }
-                if (this->showcentre && _x == 0.0f && _y == 0.0f) {
-                    this->markHex (hi);
-                }
-                std::array<float, 3> blkclr = {0,0,0};
 
-                // First push the 7 positions of the triangle vertices, starting with the centre
+                // First set the 7 positions of the triangle vertices, starting with the centre
 
                 // Use the centre position as the first location for finding the normal vector
                 vtx_0 = this->dataCoords == nullptr ? morph::vec<float>{ _x, _y, datumC } : coordC;
-                this->vertex_push (this->zoom * vtx_0, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_0, this->vertexPositions, vp);
 
                 // NE vertex
                 if (this->dataCoords == nullptr) {
@@ -431,7 +549,7 @@ namespace morph {
                         vtx_1 = coordC;
                     }
                 }
-                this->vertex_push (this->zoom * vtx_1, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_1, this->vertexPositions, vp + 3);
 
 
                 // SE vertex
@@ -461,7 +579,7 @@ namespace morph {
                         vtx_2 = coordC;
                     }
                 }
-                this->vertex_push (this->zoom * vtx_2, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_2, this->vertexPositions, vp + 6);
 
 
                 // S
@@ -491,7 +609,7 @@ namespace morph {
                         vtx_tmp = coordC;
                     }
                 }
-                this->vertex_push (this->zoom * vtx_tmp, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_tmp, this->vertexPositions, vp + 9);
 
                 // SW
                 if (this->dataCoords == nullptr) {
@@ -520,7 +638,7 @@ namespace morph {
                         vtx_tmp = coordC;
                     }
                 }
-                this->vertex_push (this->zoom * vtx_tmp, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_tmp, this->vertexPositions, vp + 12);
 
                 // NW
                 if (this->dataCoords == nullptr) {
@@ -549,7 +667,7 @@ namespace morph {
                         vtx_tmp = coordC;
                     }
                 }
-                this->vertex_push (this->zoom * vtx_tmp, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_tmp, this->vertexPositions, vp + 15);
 
                 // N
                 if (this->dataCoords == nullptr) {
@@ -578,7 +696,7 @@ namespace morph {
                         vtx_tmp = coordC;
                     }
                 }
-                this->vertex_push (this->zoom * vtx_tmp, this->vertexPositions);
+                this->vertex_set (this->zoom * vtx_tmp, this->vertexPositions, vp + 18);
 
                 // From vtx_0,1,2 compute normal. This sets the correct normal, but note
                 // that there is only one 'layer' of vertices; the back of the
@@ -589,76 +707,30 @@ namespace morph {
                 morph::vec<float> plane2 = vtx_2 - vtx_0;
                 morph::vec<float> vnorm = plane2.cross (plane1);
                 vnorm.renormalize();
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
+                for (std::size_t v = 0; v < 21u; v += 3u) { this->vertex_set (vnorm, this->vertexNormals, vn + v); }
 
                 // Usually seven vertices with the same colour, but if the hex is
                 // marked, then three of the vertices are given the colour black,
                 // marking the hex out visually.
                 if (std::isnan(dcolour[hi])) {
-                    this->vertex_push (clr, this->vertexColors);
-                    this->vertex_push (blkclr, this->vertexColors);
-                    this->vertex_push (blkclr, this->vertexColors);
-                    this->vertex_push (blkclr, this->vertexColors);
-                    this->vertex_push (blkclr, this->vertexColors);
-                    this->vertex_push (blkclr, this->vertexColors);
-                    this->vertex_push (blkclr, this->vertexColors);
+                    this->vertex_set (clr, this->vertexColors, vc);
+                    for (std::size_t v = 3; v < 21u; v += 3u) { this->vertex_set (blkclr, this->vertexColors, vc + v); }
                 } else {
-                    this->vertex_push (clr, this->vertexColors);
-                    if (this->markedHexes.count(hi)) {
-                        this->vertex_push (blkclr, this->vertexColors);
-                    } else {
-                        this->vertex_push (clr, this->vertexColors);
+                    const bool marked = this->markedHexes.count(hi) > 0;
+                    for (std::size_t v = 0; v < 21u; v += 3u) {
+                        // The odd numbered vertices (NE, S and SW) mark the hex
+                        this->vertex_set ((marked && (v / 3u) % 2u == 1u) ? blkclr : clr, this->vertexColors, vc + v);
                     }
-
-                    this->vertex_push (clr, this->vertexColors);
-
-                    if (this->markedHexes.count(hi)) {
-                        this->vertex_push (blkclr, this->vertexColors);
-                    } else {
-                        this->vertex_push (clr, this->vertexColors);
-                    }
-                    this->vertex_push (clr, this->vertexColors);
-                    if (this->markedHexes.count(hi)) {
-                        this->vertex_push (blkclr, this->vertexColors);
-                    } else {
-                        this->vertex_push (clr, this->vertexColors);
-                    }
-                    this->vertex_push (clr, this->vertexColors);
                 }
 
                 // Define indices now to produce the 6 triangles in the hex
-                this->indices.push_back (this->idx+1);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+2);
-
-                this->indices.push_back (this->idx+2);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+3);
-
-                this->indices.push_back (this->idx+3);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+4);
-
-                this->indices.push_back (this->idx+4);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+5);
-
-                this->indices.push_back (this->idx+5);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+6);
-
-                this->indices.push_back (this->idx+6);
-                this->indices.push_back (this->idx);
-                this->indices.push_back (this->idx+1);
-
-                this->idx += 7; // 7 vertices (each of 3 floats for x/y/z), 18 indices.
+                for (GLuint t = 0; t < 6u; ++t) {
+                    this->indices[ii + 3u * t] = v0 + 1u + t;
+                    this->indices[ii + 3u * t + 1u] = v0;
+                    this->indices[ii + 3u * t + 2u] = v0 + (t == 5u ? 1u : 2u + t);
+                }
             }
+            this->idx += 7u * nhex; // 7 vertices (each of 3 floats for x/y/z), 18 indices per hex.
         }
 
         // Show a Flat surface for the zero plane. Currently, this is expensively
@@ -1122,13 +1194,16 @@ namespace morph {
        }
 
         //! How to render the hexes. Triangles are faster, HexInterp allows you to see
-        //! the scale of the hexes in your sim
+        //! the scale of the hexes in your sim. Heightmap is fastest to update.
         HexVisMode hexVisMode = HexVisMode::HexInterp;
 
     protected:
         //! An overridable function to set the colour of hex hi
         virtual std::array<float, 3> setColour (unsigned int hi)
         {
+            if (!this->dcolour_rgb.empty()) {
+                return { this->dcolour_rgb[3 * hi], this->dcolour_rgb[3 * hi + 1], this->dcolour_rgb[3 * hi + 2] };
+            }
             std::array<float, 3> clr = { 0.0f, 0.0f, 0.0f };
             if (this->cm.numDatums() == 3) {
                 //if constexpr (std::is_same<std::decay_t<T>, unsigned char>::value == true) {
@@ -1157,6 +1232,8 @@ namespace morph {
         std::vector<float> dcolour;
         std::vector<float> dcolour2;
         std::vector<float> dcolour3;
+        //! The colours of dcolour, with a one dimensional colour map, as RGB triplets
+        std::vector<float> dcolour_rgb;
     };
 
 } // namespace morph
@@ -0,0 +1,127 @@
+/*!
+ * \file
+ *
+ * A flat shape, either a regular polygon or a unit line segment, drawn instanced: once for each
+ * entry in the model's instanceData. GraphVisual uses these to draw the markers and lines of
+ * big datasets with 13 floats per marker or segment, rather than a fan or strip of triangles.
+ */
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <morph/vec.h>
+#include <morph/quaternion.h>
+#include <morph/mathconst.h>
+#include <morph/VisualModel.h>
+
+namespace morph {
+
+    //! The template shapes of an InstancedShapeVisual
+    enum class instanced_shape
+    {
+        polygon, // A regular polygon of diameter 1 centred on the origin
+        segment  // A rectangle of length 1 (from the origin along x) and width 1
+    };
+
+    /*!
+     * A VisualModel whose vertices are one flat shape in the x-y plane, drawn once per instance.
+     * Add instances with addPolygon() or addSegment(), then call sync() with the context held,
+     * which builds the shape at first and afterwards uploads only the instance buffer.
+     */
+    template <int glver = morph::gl::version_4_1>
+    class InstancedShapeVisual : public VisualModel<glver>
+    {
+    public:
+        InstancedShapeVisual()
+        {
+            this->mv_offset = { 0.0f, 0.0f, 0.0f };
+            this->instanced = true;
+        }
+
+        //! Set the template shape. A polygon has n sides, with its first vertex at angle rotation from the +y axis.
+        void setShape (const instanced_shape _shape, const int _sides = 20, const float _rotation = 0.0f)
+        {
+            if (_shape == this->shape && _sides == this->sides && _rotation == this->rotation) { return; }
+            this->shape = _shape;
+            this->sides = _sides;
+            this->rotation = _rotation;
+            this->mesh_built = false;
+        }
+
+        //! Add a polygon of diameter d centred at p
+        void addPolygon (const vec<float>& p, const float d, const std::array<float, 3>& clr)
+        {
+            this->addInstance (p, { d, d, 1.0f }, quaternion<float>{}, clr);
+            this->instances_changed = true;
+        }
+
+        //! Add a segment of width w from p0 to p1, shortened by shorten at each end
+        void addSegment (const vec<float>& p0, const vec<float>& p1, const float w,
+                         const std::array<float, 3>& clr, const float shorten = 0.0f)
+        {
+            vec<float> d = p1 - p0;
+            const float len = d.length();
+            if (len <= 2.0f * shorten) { return; }
+            const float angle = std::atan2 (d[1], d[0]);
+            const vec<float> start = p0 + (d / len) * shorten;
+            this->addInstance (start, { len - 2.0f * shorten, w, 1.0f }, quaternion<float>(this->uz, angle), clr);
+            this->instances_changed = true;
+        }
+
+        //! Remove all instances
+        void clear_shapes()
+        {
+            if (this->instanceData.empty()) { return; }
+            this->clearInstances();
+            this->instances_changed = true;
+        }
+
+        //! True if sync() has something to upload
+        bool sync_pending() const { return !this->mesh_built || this->instances_changed; }
+
+        /*!
+         * Build the template shape if necessary, otherwise upload any changed instances. Call
+         * with the context held, on the thread that renders.
+         */
+        void sync()
+        {
+            if (!this->mesh_built) {
+                this->vertexPositions.clear();
+                this->vertexNormals.clear();
+                this->vertexColors.clear();
+                this->indices.clear();
+                this->idx = 0u;
+                this->build_vertices();
+                if (this->vbos == nullptr) {
+                    this->postVertexInit(); // also buffers the instances
+                } else {
+                    this->reinit_buffers();
+                }
+                this->mesh_built = true;
+                this->instances_changed = false;
+            } else if (this->instances_changed) {
+                this->reinit_instances();
+                this->instances_changed = false;
+            }
+        }
+
+        void initializeVertices()
+        {
+            // The colour is not used; each instance has its own
+            constexpr std::array<float, 3> white = { 1.0f, 1.0f, 1.0f };
+            if (this->shape == instanced_shape::segment) {
+                this->computeFlatLine ({ 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, this->uz, white, 1.0f);
+            } else {
+                this->computeFlatPoly ({ 0.0f, 0.0f, 0.0f }, this->ux, this->uy, white, 0.5f, this->sides, this->rotation);
+            }
+        }
+
+    protected:
+        instanced_shape shape = instanced_shape::polygon;
+        int sides = 20;
+        float rotation = 0.0f;
+        bool mesh_built = false;
+        bool instances_changed = false;
+    };
+
+} // namespace morph
@@ -431,101 +431,227 @@ namespace morph {
             }
         }
 
-        //! The bubble sort algorithm, high to low. T could be floating point or
-        //! integer types.
-        template<typename T>
-        static void bubble_sort_hi_to_lo (std::vector<T>& values) {
-            T value;
-            unsigned int jplus;
-            for (unsigned int i = 0; i < values.size(); ++i) {
-                for (unsigned int j = 0; j < values.size()-1; ++j) {
-                    jplus = j+1;
-                    if (values[j] < values[jplus]) {
-                        value = values[j];
-                        values[j] = values[jplus];
-                        values[jplus] = value;
-                    }
-                }
-            }
+        /*
+         * Sorting. argsort(), argsort_partial() and top_k() return indices into the values
+         * (which are not modified). Each has a version whose first argument is an execution
+         * policy, such as std::execution::par. To use that, #include <execution> yourself
+         * (MathAlgo.h does not include it) and link whatever your standard library needs for
+         * parallel algorithms (libstdc++ needs TBB).
+         */
+
+        //! A comparison of indices into values, lo to hi (or hi to lo if descending), with ties
+        //! broken by index so that the order is the same whichever sort algorithm is used.
+        template<typename T, typename I>
+        static auto index_compare (const std::vector<T>& values, const bool descending)
+        {
+            return [&values, descending](const I a, const I b) {
+                if (values[a] == values[b]) { return a < b; }
+                return descending ? values[b] < values[a] : values[a] < values[b];
+            };
         }
 
-        //! The bubble sort algorithm, low to high. T could be floating point or
-        //! integer types.
-        template<typename T>
-        static void bubble_sort_lo_to_hi (std::vector<T>& values) {
-            T value;
-            unsigned int jplus;
-            for (unsigned int i = 0; i < values.size(); ++i) {
-                for (unsigned int j = 0; j < values.size()-1; ++j) {
-                    jplus = j+1;
-                    if (values[j] > values[jplus]) {
-                        value = values[j];
-                        values[j] = values[jplus];
-                        values[jplus] = value;
-                    }
-                }
-            }
+        //! The sequence of indices 0, 1, ..., n-1
+        template<typename I>
+        static std::vector<I> index_sequence (const std::size_t n)
+        {
+            std::vector<I> indices (n);
+            for (std::size_t i = 0; i < n; ++i) { indices[i] = static_cast<I>(i); }
+            return indices;
         }
 
-        //! Bubble sort, high to low, order is returned in indices, values are left
-        //! unchanged
-        template<typename T>
-        static void bubble_sort_hi_to_lo (const std::vector<T>& values, std::vector<unsigned int>& indices) {
+        //! \return the indices that would sort values lo to hi (or hi to lo if descending). Equal
+        //! values stay in their original order.
+        template<typename T, typename I = unsigned int>
+        static std::vector<I> argsort (const std::vector<T>& values, const bool descending = false)
+        {
+            std::vector<I> indices = MathAlgo::index_sequence<I> (values.size());
+            std::sort (indices.begin(), indices.end(), MathAlgo::index_compare<T, I> (values, descending));
+            return indices;
+        }
 
-            std::vector<T> vcopy = values;
+        //! argsort() with an execution policy
+        template<typename ExecutionPolicy, typename T, typename I = unsigned int>
+        static std::vector<I> argsort (ExecutionPolicy&& policy, const std::vector<T>& values, const bool descending = false)
+        {
+            std::vector<I> indices = MathAlgo::index_sequence<I> (values.size());
+            std::sort (policy, indices.begin(), indices.end(),
+                       MathAlgo::index_compare<T, I> (values, descending));
+            return indices;
+        }
+
+        //! \return the first k of the indices that argsort() would return, in order. This is
+        //! O(n log k) rather than O(n log n).
+        template<typename T, typename I = unsigned int>
+        static std::vector<I> argsort_partial (const std::vector<T>& values, std::size_t k, const bool descending = false)
+        {
+            k = std::min (k, values.size());
+            std::vector<I> indices = MathAlgo::index_sequence<I> (values.size());
+            std::partial_sort (indices.begin(), indices.begin() + k, indices.end(),
+                               MathAlgo::index_compare<T, I> (values, descending));
+            indices.resize (k);
+            return indices;
+        }
+
+        //! argsort_partial() with an execution policy
+        template<typename ExecutionPolicy, typename T, typename I = unsigned int>
+        static std::vector<I> argsort_partial (ExecutionPolicy&& policy, const std::vector<T>& values,
+                                               std::size_t k, const bool descending = false)
+        {
+            k = std::min (k, values.size());
+            std::vector<I> indices = MathAlgo::index_sequence<I> (values.size());
+            std::partial_sort (policy, indices.begin(), indices.begin() + k, indices.end(),
+                               MathAlgo::index_compare<T, I> (values, descending));
+            indices.resize (k);
+            return indices;
+        }
 
-            // Init indices to be a sequence
-            for (unsigned int i = 0; i < indices.size(); ++i) {
-                indices[i] = i;
+        /*!
+         * \return the indices of the k largest values (or the k smallest if largest is false). The
+         * k elements are selected with std::nth_element in O(n). If sorted is true, they are then
+         * sorted, largest (or smallest) first, in O(k log k); otherwise they are in no particular
+         * order.
+         */
+        template<typename T, typename I = unsigned int>
+        static std::vector<I> top_k (const std::vector<T>& values, std::size_t k,
+                                     const bool largest = true, const bool sorted = true)
+        {
+            k = std::min (k, values.size());
+            std::vector<I> indices = MathAlgo::index_sequence<I> (values.size());
+            auto cmp = MathAlgo::index_compare<T, I> (values, largest);
+            if (k > 0 && k < indices.size()) {
+                std::nth_element (indices.begin(), indices.begin() + (k - 1), indices.end(), cmp);
             }
+            indices.resize (k);
+            if (sorted) { std::sort (indices.begin(), indices.end(), cmp); }
+            return indices;
+        }
 
-            T value;
-            unsigned int index;
-            unsigned int jplus;
-            for (unsigned int i = 0; i < vcopy.size(); ++i) {
-                for (unsigned int j = 0; j < vcopy.size()-1; ++j) {
-                    jplus = j+1;
-                    if (vcopy[j] < vcopy[jplus]) {
-                        // Swap value in the copy
-                        value = vcopy[j];
-                        vcopy[j] = vcopy[jplus];
-                        vcopy[jplus] = value;
-                        // Swap index too
-                        index = indices[j];
-                        indices[j] = indices[jplus];
-                        indices[jplus] = index;
-                    }
-                }
+        //! top_k() with an execution policy
+        template<typename ExecutionPolicy, typename T, typename I = unsigned int>
+        static std::vector<I> top_k (ExecutionPolicy&& policy, const std::vector<T>& values, std::size_t k,
+                                     const bool largest = true, const bool sorted = true)
+        {
+            k = std::min (k, values.size());
+            std::vector<I> indices = MathAlgo::index_sequence<I> (values.size());
+            auto cmp = MathAlgo::index_compare<T, I> (values, largest);
+            if (k > 0 && k < indices.size()) {
+                std::nth_element (policy, indices.begin(), indices.begin() + (k - 1), indices.end(), cmp);
             }
+            indices.resize (k);
+            if (sorted) { std::sort (policy, indices.begin(), indices.end(), cmp); }
+            return indices;
+        }
+
+        //! Sort values, high to low. Despite the name, this is no longer a bubble sort; it is
+        //! std::sort. T could be floating point or integer types.
+        template<typename T>
+        static void bubble_sort_hi_to_lo (std::vector<T>& values)
+        {
+            std::sort (values.begin(), values.end(), [](const T& a, const T& b) { return b < a; });
         }
 
-        //! Bubble sort, low to high, order is returned in indices, values are left
-        //! unchanged
+        //! Sort values, low to high, with std::sort. T could be floating point or integer types.
         template<typename T>
-        static void bubble_sort_lo_to_hi (const std::vector<T>& values, std::vector<unsigned int>& indices) {
+        static void bubble_sort_lo_to_hi (std::vector<T>& values)
+        {
+            std::sort (values.begin(), values.end());
+        }
 
-            std::vector<T> vcopy = values;
+        //! Sort, high to low, order is returned in indices, values are left unchanged. Equal
+        //! values keep their original order, as they did in the bubble sort this replaces.
+        template<typename T>
+        static void bubble_sort_hi_to_lo (const std::vector<T>& values, std::vector<unsigned int>& indices)
+        {
+            indices = MathAlgo::argsort<T, unsigned int> (values, true);
+        }
 
-            // Init indices to be a sequence
-            for (unsigned int i = 0; i < indices.size(); ++i) {
-                indices[i] = i;
-            }
+        //! Sort, low to high, order is returned in indices, values are left unchanged. Equal
+        //! values keep their original order.
+        template<typename T>
+        static void bubble_sort_lo_to_hi (const std::vector<T>& values, std::vector<unsigned int>& indices)
+        {
+            indices = MathAlgo::argsort<T, unsigned int> (values, false);
+        }
+
+        /*!
+         * The box filter used by all of the boxfilter_2d implementations. The box around element
+         * (x, y) covers columns x-neg_steps to x+pos_steps and rows y-neg_steps to y+pos_steps, so
+         * for an odd box side, neg_steps = pos_steps = boxside/2. Rows beyond the top and bottom
+         * of the data contribute nothing. Columns wrap around if horz_wrap is true, otherwise they
+         * too contribute nothing beyond the edges. Unless onlysum is true, the sum is divided by
+         * the full box area, (neg_steps + pos_steps + 1)^2, even at the edges.
+         *
+         * The sums are running sums (of columns, then along rows) so the cost per element does not
+         * depend on the size of the box. The rows are divided into blocks which are filtered in
+         * parallel (with OpenMP); each block starts its column sums afresh.
+         *
+         * \param data The input data; w * h elements, the first row first.
+         * \param result The output; w * h elements. Must not be the same memory as data.
+         */
+        template<typename T, typename T_o = T, bool onlysum = false>
+        static void boxfilter_2d_blocks (const T* data, T_o* result, const int w, const int h,
+                                         const int neg_steps, const int pos_steps, const bool horz_wrap = true)
+        {
+            if (w < 1 || h < 1) { return; }
+            if (neg_steps < 0 || pos_steps < 0) {
+                throw std::runtime_error ("boxfilter_2d_blocks: neg_steps and pos_steps must be >= 0");
+            }
+            const int boxside = neg_steps + pos_steps + 1;
+            const T_o oneover_boxa = T_o{1} / (static_cast<T_o>(boxside) * static_cast<T_o>(boxside));
+
+            // Blocks of rows. Each block costs boxside rows of extra work to start its column
+            // sums, so blocks are at least twice that height.
+            const int block_h = std::max (32, 2 * boxside);
+            const int n_blocks = (h + block_h - 1) / block_h;
+
+            // Column index with horizontal wrapping, or -1 if off the edge and not wrapping
+            auto col = [w, horz_wrap](const int x) { return horz_wrap ? ((x % w) + w) % w : (x >= 0 && x < w ? x : -1); };
+
+#pragma omp parallel for schedule(static)
+            for (int b = 0; b < n_blocks; ++b) {
+                const int y0 = b * block_h;
+                const int y1 = std::min (h, y0 + block_h);
+
+                // Column sums for row y0, over rows y0-neg_steps to y0+pos_steps
+                std::vector<T_o> colsum (w, T_o{0});
+                for (int yy = std::max (0, y0 - neg_steps); yy <= std::min (h - 1, y0 + pos_steps); ++yy) {
+                    const T* row = data + static_cast<std::ptrdiff_t>(yy) * w;
+                    for (int x = 0; x < w; ++x) { colsum[x] += row[x]; }
+                }
+
+                for (int y = y0; y < y1; ++y) {
+                    // Sum along the row. Start with the box for x = 0...
+                    T_o rowsum = T_o{0};
+                    for (int i = -neg_steps; i <= pos_steps; ++i) {
+                        const int c = col (i);
+                        if (c >= 0) { rowsum += colsum[c]; }
+                    }
+                    T_o* out = result + static_cast<std::ptrdiff_t>(y) * w;
+                    // ...then slide it along
+                    for (int x = 0; x < w; ++x) {
+                        if constexpr (onlysum == true) {
+                            out[x] = rowsum;
+                        } else {
+                            out[x] = rowsum * oneover_boxa;
+                        }
+                        int ca = x + pos_steps + 1;
+                        int cs = x - neg_steps;
+                        if (ca >= w) { ca = col (ca); }
+                        if (cs < 0) { cs = col (cs); }
+                        if (ca >= 0) { rowsum += colsum[ca]; }
+                        if (cs >= 0) { rowsum -= colsum[cs]; }
+                    }
 
-            T value;
-            unsigned int index;
-            unsigned int jplus;
-            for (unsigned int i = 0; i < vcopy.size(); ++i) {
-                for (unsigned int j = 0; j < vcopy.size()-1; ++j) {
-                    jplus = j+1;
-                    if (vcopy[j] > vcopy[jplus]) {
-                        // Swap value in the copy
-                        value = vcopy[j];
-                        vcopy[j] = vcopy[jplus];
-                        vcopy[jplus] = value;
-                        // Swap index too
-                        index = indices[j];
-                        indices[j] = indices[jplus];
-                        indices[jplus] = index;
+                    // Move the column sums up a row
+                    if (y + 1 < y1) {
+                        if (y + 1 + pos_steps < h) {
+                            const T* row = data + static_cast<std::ptrdiff_t>(y + 1 + pos_steps) * w;
+                            for (int x = 0; x < w; ++x) { colsum[x] += row[x]; }
+                        }
+                        if (y - neg_steps >= 0) {
+                            const T* row = data + static_cast<std::ptrdiff_t>(y - neg_steps) * w;
+                            for (int x = 0; x < w; ++x) { colsum[x] -= row[x]; }
+                        }
                     }
                 }
             }
@@ -557,72 +683,18 @@ namespace morph {
             if (result.size() != data.size()) {
                 throw std::runtime_error ("The input data vector is not the same size as the result vector.");
             }
-
             // Divide by boxarea without accounting for edges (wrapping will sort horz edges)
-            static constexpr T_o oneover_boxa = T_o{1} / (static_cast<T_o>(boxside) * static_cast<T_o>(boxside));
             static constexpr int halfbox = boxside / 2;
-            static constexpr int halfbox_p1 = halfbox + 1;
-
-            morph::vec<T_o, w> colsum;
-            colsum.zero();
-            T_o rowsum = T{0};
-
-            int h = data.size() / w;
-
-            // process data row by row
-            for (int y = -halfbox; y < h; ++y) {
-
-                // 1. Accumulate column sums; pull out last row.
-                if (y + halfbox < h) {
-                    if (y >= halfbox_p1) {
-                        for (int x = 0; x < w; ++x) {
-                            // Add to the next row from the data array and subtract the last (bottom) row of the colsum
-                            colsum[x] += data[(y + halfbox) * w + x]  -  data[(y - halfbox_p1) * w + x];
-                            // T_o       T                         T
-                        }
-                    } else {
-                        for (int x = 0; x < w; ++x) {
-                            // Just add to the next row from the data array
-                            colsum[x] += data[(y + halfbox) * w + x];
-                        }
-                    }
-                } else {
-                    if (y >= halfbox_p1) {
-                        // Just subtract
-                        for (int x = 0; x < w; ++x) {
-                            colsum[x] -= data[(y - halfbox_p1) * w + x];
-                        }
-                    } // else no op on colsum[x]
-                }
-
-                rowsum = T{0};
-                if (y >= 0) {
-                    // 2. Initialise rowsum. This happens after we have accumulated colsums. Init rowsum as the sum of the end col
-                    for (int i = -halfbox_p1; i < 0; ++i) { rowsum += colsum[i + w]; }
-                    for (int i = 0; i < halfbox; ++i) { rowsum += colsum[i]; }
-
-                    // 3. Compute the sum along the row, and write this into result
-                    int l = -halfbox_p1;
-                    int r = halfbox;
-                    for (int x = 0; x < w; ++x) {
-                        // A modulus where -x modulus w gives always a positive index: (w + (a % w)) % w
-                        rowsum += colsum[(w + (r++ % w)) % w] - colsum[(w + (l++ % w)) % w];
-
-                        if constexpr (onlysum == true) {
-                            result[y * w + x] = rowsum;
-                        } else {
-                            result[y * w + x] = rowsum * oneover_boxa;
-                        }
-                    }
-                }
-            }
+            const int h = data.size() / w;
+            MathAlgo::boxfilter_2d_blocks<T, T_o, onlysum> (data.data(), result.data(), w, h, halfbox, halfbox, true);
         }
 
         /*!
          * Boxfilter implementation 2
          *
          * A 'fixed-size containers boxfilter'. Implemented to see if it is any faster than one in
-         * which input/output data are morph::vvec. Turns out that it runs at the same speed.
+         * which input/output data are morph::vvec. Turns out that it runs at the same speed (and
+         * now all three implementations call boxfilter_2d_blocks).
          *
          * Apply a 2d, horizontally wrapping box filter. Test to see if boxside is odd and disallow
          * even (which was not not tested). Assume the data in the vvec relates to a rectangle of width w.
@@ -643,63 +715,9 @@ namespace morph {
         {
             static_assert ((boxside > 0 && (boxside % 2) > 0),
                            "boxfilter_2d was not designed for even box filter squares (set boxside template param. to an odd value)");
-
             // Divide by boxarea without accounting for edges (wrapping will sort horz edges)
-            static constexpr T_o oneover_boxa = T_o{1} / (static_cast<T_o>(boxside) * static_cast<T_o>(boxside));
             static constexpr int halfbox = boxside / 2;
-            static constexpr int halfbox_p1 = halfbox + 1;
-
-            std::array<T_o, w> colsum;
-            for (auto& el : colsum) { el = T_o{0}; }
-            T_o rowsum = T_o{0};
-
-            // process data row by row
-            for (int y = -halfbox; y < h; ++y) {
-
-                // 1. Accumulate column sums; pull out last row.
-                if (y+halfbox < h) {
-                    if (y >= halfbox_p1) {
-                        for (int x = 0; x < w; ++x) {
-                            // Add to the next row from the data array and subtract the last (bottom) row of the colsum
-                            colsum[x] += data[(y + halfbox) * w + x]  -  data[(y - halfbox_p1) * w + x];
-                            // T_o       T                         T
-                        }
-                    } else {
-                        for (int x = 0; x < w; ++x) {
-                            // Just add to the next row from the data array
-                            colsum[x] += data[(y + halfbox) * w + x];
-                        }
-                    }
-                } else {
-                    if (y >= halfbox_p1) {
-                        // Just subtract
-                        for (int x = 0; x < w; ++x) {
-                            colsum[x] -= data[(y - halfbox_p1) * w + x];
-                        }
-                    } // else no op on colsum[x]
-                }
-
-                rowsum = T{0};
-                if (y >= 0) {
-                    // 2. Initialise rowsum. This happens after we have accumulated colsums. Init rowsum as the sum of the end col
-                    for (int i = -halfbox_p1; i < 0; ++i) { rowsum += colsum[i + w]; }
-                    for (int i = 0; i < halfbox; ++i) { rowsum += colsum[i]; }
-
-                    // 3. Compute the sum along the row, and write this into result
-                    int l = -halfbox_p1;
-                    int r = halfbox;
-                    for (int x = 0; x < w; ++x) {
-                        // A modulus where -x modulus w gives always a positive index: (w + (a % w)) % w
-                        rowsum += colsum[(w + (r++ % w)) % w] - colsum[(w + (l++ % w)) % w];
-
-                        if constexpr (onlysum == true) {
-                            result[y * w + x] = rowsum;
-                        } else {
-                            result[y * w + x] = rowsum * oneover_boxa;
-                        }
-                    }
-                }
-            }
+            MathAlgo::boxfilter_2d_blocks<T, T_o, onlysum> (data.data(), result.data(), w, h, halfbox, halfbox, true);
         }
 
         /*!
@@ -730,63 +748,10 @@ namespace morph {
             if (&data == &result) {
                 throw std::runtime_error ("Pass in separate memory for the result.");
             }
-
             // Divide by boxarea without accounting for edges (wrapping will sort horz edges)
-            static constexpr T oneover_boxa = T{1} / (static_cast<T>(boxside) * static_cast<T>(boxside));
             static constexpr int halfbox = boxside / 2;
-            static constexpr int halfbox_p1 = halfbox + 1;
-
-            morph::vvec<T> colsum (w, T{0});
-            T rowsum = T{0};
-
-            int h = data.size() / w;
-
-            // process data row by row
-            for (int y = -halfbox; y < h; ++y) {
-
-                // 1. Accumulate column sums; pull out last row.
-                if (y + halfbox < h) {
-                    if (y >= halfbox_p1) {
-                        for (int x = 0; x < w; ++x) {
-                            // Add to the next row from the data array and subtract the last (bottom) row of the colsum
-                            colsum[x] += data[(y + halfbox) * w + x]  -  data[(y - halfbox_p1) * w + x];
-                        }
-                    } else {
-                        for (int x = 0; x < w; ++x) {
-                            // Just add to the next row from the data array
-                            colsum[x] += data[(y + halfbox) * w + x];
-                        }
-                    }
-                } else {
-                    if (y >= halfbox_p1) {
-                        // Just subtract
-                        for (int x = 0; x < w; ++x) {
-                            colsum[x] -= data[(y - halfbox_p1) * w + x];
-                        }
-                    } // else no op on colsum[x]
-                }
-
-                rowsum = T{0};
-                if (y >= 0) {
-                    // 2. Initialise rowsum. This happens after we have accumulated colsums. Init rowsum as the sum of the end col
-                    for (int i = -halfbox_p1; i < 0; ++i) { rowsum += colsum[i + w]; }
-                    for (int i = 0; i < halfbox; ++i) { rowsum += colsum[i]; }
-
-                    // 3. Compute the sum along the row, and write this into result
-                    int l = -halfbox_p1;
-                    int r = halfbox;
-                    for (int x = 0; x < w; ++x) {
-                        // A modulus where -x modulus w gives always a positive index: (w + (a % w)) % w
-                        rowsum += colsum[(w + (r++ % w)) % w] - colsum[(w + (l++ % w)) % w];
-
-                        if constexpr (onlysum == true) {
-                            result[y * w + x] = rowsum;
-                        } else {
-                            result[y * w + x] = rowsum * oneover_boxa;
-                        }
-                    }
-                }
-            }
+            const int h = data.size() / w;
+            MathAlgo::boxfilter_2d_blocks<T, T, onlysum> (data.data(), result.data(), w, h, halfbox, halfbox, true);
         }
 
         // Carry out a simple, 2 pixel kernel edge convolution for both vertical and horizontal
@@ -903,26 +868,30 @@ namespace morph {
             }
             ++i;
 
-            // Intermediate rows
-            for (; i < lastrow_index; ++i) {
-                if (i%w == 0) {             // first column
-                    if constexpr (horz_wrap) {
-                        //                R           'L'            'UL'           U             UR          D             DR        'DL'
-                        result[i] -= (data[i+1] + data[i+w-1] + data[w+i+w-1] + data[w+i] + data[w+i+1] + data[i-w] + data[i-w+1] + data[i-1]) / T{8};
-                    } else {
-                        result[i] -= (data[i+1] + data[i+w] + data[i+w+1] + data[i-w] + data[i-w+1]) / T{5};
-                    }
-                } else if ((i+1)%w == 0)  { // on last column
-                    if constexpr (horz_wrap) {
-                        //                L       'R'            U             'UR'           UL           D            DL         'DR'
-                        result[i] -= (data[i-1] + data[i-w+1] + data[i+w] + data[i+1] + data[i+w-1] + data[i-w] + data[i-w-1] + data[i-w-w+1]) / T{5};
-                    } else {
-                        result[i] -= (data[i-1] + data[i+w] + data[i+w-1] + data[i-w] + data[i-w-1]) / T{5};
+            // Intermediate rows, which are independent, so filter them in parallel
+#pragma omp parallel for
+            for (int y = 1; y < lastrow_index / w; ++y) {
+                for (int j = y * w; j < (y + 1) * w; ++j) {
+                    if (j%w == 0) {             // first column
+                        if constexpr (horz_wrap) {
+                            //                R           'L'            'UL'           U             UR          D             DR        'DL'
+                            result[j] -= (data[j+1] + data[j+w-1] + data[w+j+w-1] + data[w+j] + data[w+j+1] + data[j-w] + data[j-w+1] + data[j-1]) / T{8};
+                        } else {
+                            result[j] -= (data[j+1] + data[j+w] + data[j+w+1] + data[j-w] + data[j-w+1]) / T{5};
+                        }
+                    } else if ((j+1)%w == 0)  { // on last column
+                        if constexpr (horz_wrap) {
+                            //                L       'R'            U             'UR'           UL           D            DL         'DR'
+                            result[j] -= (data[j-1] + data[j-w+1] + data[j+w] + data[j+1] + data[j+w-1] + data[j-w] + data[j-w-1] + data[j-w-w+1]) / T{8};
+                        } else {
+                            result[j] -= (data[j-1] + data[j+w] + data[j+w-1] + data[j-w] + data[j-w-1]) / T{5};
+                        }
+                    } else {                    // All the rest have 8 neighbours
+                        result[j] -= (data[j-1] + data[j+1] + data[j+w-1] + data[j+w] + data[j+w+1] + data[j-w-1] + data[j-w] + data[j-w+1]) / T{8};
                     }
-                } else {                    // All the rest have 8 neighbours
-                    result[i] -= (data[i-1] + data[i+1] + data[i+w-1] + data[i+w] + data[i+w+1] + data[i-w-1] + data[i-w] + data[i-w+1]) / T{8};
                 }
             }
+            i = lastrow_index;
             // TL pixel
             if constexpr (horz_wrap) {
                 result[i] -= (data[i+1] + data[i-w+1] + data[i-w] + data[i+w-1] + data[i-1]) / T{5};
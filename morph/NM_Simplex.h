@@ -13,8 +13,10 @@
 #include <cstdint>
 #include <vector>
 #include <functional>
+#include <stdexcept>
 #include <morph/MathAlgo.h>
 #include <morph/vvec.h>
+#include <morph/objective_cache.h>
 
 namespace morph {
 
@@ -33,6 +35,8 @@ namespace morph {
         NeedToComputeExpansion,
         // Need to compute the value of the contracted point, xc
         NeedToComputeContraction,
+        // Need to compute the values of all the points in batch (then call apply_batch)
+        NeedToComputeBatch,
         // The algorithm has finished and found a location within tolerance
         ReadyToStop
     };
@@ -89,6 +93,19 @@ namespace morph {
         //! simplex drop below this value, the algorithm will be deemed to be finished.
         T termination_threshold = T{0.0001};
 
+        //! If true, the reflected, expanded and contracted points are proposed together as
+        //! a batch (state NeedToComputeBatch) so that they can be computed at the same
+        //! time. The simplex takes the same path as it does when parallel is false, but
+        //! each iteration needs one round of objective computations rather than up to
+        //! two. step() computes the batch, and the vertices after a shrink, with an OpenMP
+        //! parallel for, so objective must then be safe to call from several threads.
+        bool parallel = false;
+
+        //! If set, step() computes objective through this cache. Reflected, expanded and
+        //! contracted points are screened against the best vertex, so those that the cache's
+        //! surrogate predicts to be much worse get the prediction instead of a real evaluation.
+        morph::objective_cache<T>* cache = nullptr;
+
         //! The centroid of all points except vertex n (the last one)
         morph::vvec<T> x0;
 
@@ -107,6 +124,11 @@ namespace morph {
         //! The objective function value of the contracted point
         T xc_value;
 
+        //! When state is NeedToComputeBatch, the points xr, xe and xc, in that order
+        morph::vvec<morph::vvec<T>> batch;
+        //! The objective function values of the batch points
+        morph::vvec<T> batch_values;
+
         //! The locations of the simplex vertices. A vector of n+1 vertices, each of n coordinates.
         morph::vvec<morph::vvec<T>> vertices;
 
@@ -201,21 +223,31 @@ namespace morph {
         void step()
         {
             if (this->state == NM_Simplex_State::NeedToComputeThenOrder) {
-                for (unsigned int i = 0; i <= this->n; ++i) {
-                    this->values[i] = this->objective (this->vertices[i]);
+                const int nv = static_cast<int>(this->n + 1);
+#pragma omp parallel for if (this->parallel)
+                for (int i = 0; i < nv; ++i) {
+                    this->values[i] = this->compute_objective (this->vertices[i], false);
                 }
                 this->order();
             } else if (this->state == NM_Simplex_State::NeedToOrder) {
                 this->order();
             } else if (this->state == NM_Simplex_State::NeedToComputeReflection) {
-                T val = this->objective (this->xr);
+                T val = this->compute_objective (this->xr, true);
                 this->apply_reflection (val);
             } else if (this->state == NM_Simplex_State::NeedToComputeExpansion) {
-                T val = this->objective (this->xe);
+                T val = this->compute_objective (this->xe, true);
                 this->apply_expansion (val);
             } else if (this->state == NM_Simplex_State::NeedToComputeContraction) {
-                T val = this->objective (this->xc);
+                T val = this->compute_objective (this->xc, true);
                 this->apply_contraction (val);
+            } else if (this->state == NM_Simplex_State::NeedToComputeBatch) {
+                const int nb = static_cast<int>(this->batch.size());
+                this->batch_values.resize (nb);
+#pragma omp parallel for
+                for (int i = 0; i < nb; ++i) {
+                    this->batch_values[i] = this->compute_objective (this->batch[i], true);
+                }
+                this->apply_batch (this->batch_values);
             }
         }
 
@@ -262,10 +294,22 @@ namespace morph {
             }
 
             this->compute_x0();
-            this->reflect();
+            if (this->parallel) {
+                this->propose_batch();
+            } else {
+                this->reflect();
+            }
         }
 
     private:
+        //! Call objective for the point p, through the cache if there is one
+        T compute_objective (const morph::vvec<T>& p, const bool screen)
+        {
+            if (this->cache == nullptr) { return this->objective (p); }
+            if (screen) { return this->cache->evaluate (p, this->objective, this->values[this->vertex_order[0]], this->downhill); }
+            return this->cache->evaluate (p, this->objective);
+        }
+
         //! Find the reflected point, xr, which is the reflection of the worst point about the
         //! centroid of the simplex.
         void reflect()
@@ -276,7 +320,35 @@ namespace morph {
             this->state = NM_Simplex_State::NeedToComputeReflection;
         }
 
+        //! Compute the reflected point and the expanded and contracted points that may follow
+        //! it, for the client to compute all at once.
+        void propose_batch()
+        {
+            this->operation_count++;
+            unsigned int worst = this->vertex_order[this->n];
+            this->xr = this->x0 + (this->x0 - this->vertices[worst]) * this->alpha;
+            this->xe = this->x0 + (this->xr - this->x0) * this->gamma;
+            this->xc = this->x0 + (this->vertices[worst] - this->x0) * this->rho;
+            this->batch = { this->xr, this->xe, this->xc };
+            this->state = NM_Simplex_State::NeedToComputeBatch;
+        }
+
     public:
+        //! With the objective function values for the points in batch (xr, xe and xc) passed in,
+        //! make the same change to the simplex that the serial algorithm would make.
+        void apply_batch (const morph::vvec<T>& _batch_values)
+        {
+            if (_batch_values.size() != 3) {
+                throw std::runtime_error ("NM_Simplex::apply_batch: expected values for xr, xe and xc");
+            }
+            this->apply_reflection (_batch_values[0]);
+            if (this->state == NM_Simplex_State::NeedToComputeExpansion) {
+                this->apply_expansion (_batch_values[1]);
+            } else if (this->state == NM_Simplex_State::NeedToComputeContraction) {
+                this->apply_contraction (_batch_values[2]);
+            }
+        }
+
         //! With the objective function value for the reflected point xr passed in, apply the
         //! reflection and decide whether to replace, expand or contract.
         void apply_reflection (const T _xr_value)
@@ -2,14 +2,18 @@
 
 #include <morph/tools.h>
 #include <morph/VisualDataModel.h>
-#include <morph/MathAlgo.h>
+#include <morph/point_rows.h>
+#include <morph/threadpool.h>
+#include <morph/unit_sphere.h>
 #include <morph/scale.h>
 #include <morph/vec.h>
 #include <morph/ColourMap.h>
 #include <iostream>
 #include <vector>
 #include <array>
-#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
 namespace morph {
 
@@ -58,6 +62,9 @@ namespace morph {
      * \param _radius_sph The radius of the spheres making up the points. 3 times
      * _radius is good to see the spheres. Make this 0 to omit the spheres.
      *
+     * A sphere is drawn once at each point that is joined to another, and a tube once
+     * along each edge of the triangles that stitch the rows together.
+     *
      */
     template <typename Flt, int glver = morph::gl::version_4_1>
     class PointRowsMeshVisual : public VisualDataModel<Flt, glver>
@@ -88,7 +95,7 @@ namespace morph {
             this->colourScale = cscale;
 
             this->dataCoords = _pointrows;
-            this->scalarData = _data;
+            this->setScalarData (_data);
 
             // Perhaps I should have just passed in 2 colour maps!
             this->cm.setType (_cmt);
@@ -111,7 +118,14 @@ namespace morph {
             return this->cm.convert (datum);
         }
 
-        //! Do the computations to initialize the vertices that will represent the surface.
+        /*!
+         * Do the computations to initialize the vertices that will represent the surface.
+         *
+         * Each adjacent pair of rows is stitched into triangles (see point_rows::stitch) in
+         * parallel, and the edges of the triangles are written into one preallocated list.
+         * Each edge, and each point at the end of an edge, is drawn once: the spheres are
+         * written into the vertex buffers in parallel, and then the tubes are added.
+         */
         void initializeVertices()
         {
             unsigned int npoints = this->dataCoords->size();
@@ -122,155 +136,128 @@ namespace morph {
                 return;
             }
 
-            std::vector<Flt> dcopy = *(this->scalarData);
             this->colourScale.do_autoscale = true;
-            this->colourScale.transform (*this->scalarData, dcopy);
-
-            // First, need to know which set of points form two, adjacent rows. An assumption we'll
-            // accept: The rows are listed in slice-order and the points in each row are listed in
-            // position-along-the-curve order.
+            this->transformScalarData (this->colourScale, this->dcopy);
 
-            std::size_t r1 = 0;
-            std::size_t r1_e = 0;
-            std::size_t r2 = 0;
-            std::size_t r2_e = 0;
+            const std::vector<vec<float, 3>>& p = *this->dataCoords;
+            const std::vector<std::array<std::size_t, 2>> rows = morph::point_rows::find_rows (p, this->pa);
+            const std::size_t npairs = rows.size() > 1 ? rows.size() - 1 : 0;
 
-            std::size_t prlen = this->dataCoords->size();
+            // Stitch each pair of rows
+            std::vector<std::vector<std::uint8_t>> steps (npairs);
+            morph::parallel_for (std::size_t{0}, npairs, [&](std::size_t k) { steps[k] = morph::point_rows::stitch (p, rows[k], rows[k+1]); }, 1);
 
-            // pa is this->pa
-            float x = (*this->dataCoords)[r1][pa];
-            while (r1_e != prlen && (*this->dataCoords)[r1_e][pa] == x) {
-                ++r1_e;
+            // The edges of the triangles: the first edge across the pair of rows, then for each
+            // triangle an edge along a row and (for all but the last) the next edge across.
+            std::vector<std::size_t> eoff (npairs + 1, 0);
+            for (std::size_t k = 0; k < npairs; ++k) {
+                eoff[k+1] = eoff[k] + (steps[k].empty() ? 1 : 2 * steps[k].size());
             }
-            r2 = r1_e--;
-            r2_e = r2;
-            x = (*this->dataCoords)[r2][pa];
-            while (r2_e != prlen && (*this->dataCoords)[r2_e][pa] == x) {
-                ++r2_e;
+            std::vector<std::array<unsigned int, 2>> edges (eoff[npairs]);
+            morph::parallel_for (std::size_t{0}, npairs, [&](std::size_t k) {
+                std::size_t e = eoff[k];
+                auto put = [&edges, &e](std::size_t i, std::size_t j) {
+                    edges[e++] = { static_cast<unsigned int>(std::min (i, j)), static_cast<unsigned int>(std::max (i, j)) };
+                };
+                std::size_t r1 = rows[k][0];
+                std::size_t r2 = rows[k+1][0];
+                put (r1, r2);
+                for (std::size_t s = 0; s < steps[k].size(); ++s) {
+                    if (steps[k][s]) { put (r1, r1 + 1); ++r1; } else { put (r2, r2 + 1); ++r2; }
+                    if (s + 1 < steps[k].size()) { put (r1, r2); }
+                }
+            }, 1);
+            // Neighbouring pairs of rows share the edges along their common row
+            std::sort (edges.begin(), edges.end());
+            edges.erase (std::unique (edges.begin(), edges.end()), edges.end());
+            this->tube_edges.swap (edges);
+
+            // A sphere at each point that is at the end of an edge
+            this->sphere_points.clear();
+            if (this->sradius > 0.0f) {
+                std::vector<std::uint8_t> used (p.size(), 0);
+                for (const std::array<unsigned int, 2>& e : this->tube_edges) { used[e[0]] = used[e[1]] = 1; }
+                for (unsigned int i = 0; i < p.size(); ++i) { if (used[i]) { this->sphere_points.push_back (i); } }
             }
-            r2_e--;
-            // Now r1, r1_e, r2 and r2_e all point to the right places
-            while (r2 != prlen) { // While through all 'rows' - pairs of pointrows
-
-                this->computeSphere ((*this->dataCoords)[r1], this->cm_sph.convert(dcopy[r1]), this->sradius, this->srings, this->sseg);
-                this->computeSphere ((*this->dataCoords)[r2], this->cm_sph.convert(dcopy[r2]), this->sradius, this->srings, this->sseg);
-                this->computeTube ((*this->dataCoords)[r1], (*this->dataCoords)[r2],
-                                   this->cm.convert(dcopy[r1]), this->cm.convert(dcopy[r2]), this->radius, this->tseg);
-                // Now while through the row pushing the rest of the vertices.
-                while (r2 <= r2_e && r1 <= r1_e) {
-
-                    // Now iterate r1 and r2 until we get to the end of the two rows.
-                    // vtx is r1, r2. Question is: Is other vertex ++r1 or ++r2?
-                    std::size_t r1n = r1 + 1U;
-                    std::size_t r2n = r2 + 1U;
-
-                    // Increment and make sure we didn't drop off the end
-                    if (r1n > r1_e && r2n > r2_e) {
-                        r1 = r1n;
-                        r2 = r2n;
-                        break;
-                    }
-
-                    bool completed_end_tri = false;
-                    bool must_be_r1n = false;
-                    bool must_be_r2n = false;
-                    if (r1n > r1_e) {
-                        // Can't add this one, only r2n is possible
-                        must_be_r2n = true;
-                        completed_end_tri = true;
-                    }
-                    if (r2n > r2_e) {
-                        // Can't add this one, only r1n is possible and must be at end of row
-                        must_be_r1n = true;
-                        completed_end_tri = true;
-                    }
-
-                    if (must_be_r1n) {
-                        must_be_r2n = false;
-                    } else if (must_be_r2n) {
-                        must_be_r1n = false;
-                    } else {
-                        // Compute distances to compute angles to decide
-                        float r1_to_r2_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r1], (*this->dataCoords)[r2]);
-
-                        float r1_to_r1n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r1], (*this->dataCoords)[r1n]);
-                        float r1_to_r2n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r1], (*this->dataCoords)[r2n]);
-                        float r2_to_r1n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r2], (*this->dataCoords)[r1n]);
-                        float r2_to_r2n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r2], (*this->dataCoords)[r2n]);
-
-                        float r1_to_r1n = sqrt(r1_to_r1n_sq);
-                        float r1_to_r2n = sqrt(r1_to_r2n_sq);
-                        float r2_to_r1n = sqrt(r2_to_r1n_sq);
-                        float r2_to_r2n = sqrt(r2_to_r2n_sq);
-
-                        float asq = r1_to_r2_sq;
-                        float bsq = r2_to_r1n_sq;
-                        float b = r2_to_r1n;
-                        float csq = r1_to_r1n_sq;
-                        float c = r1_to_r1n;
-                        float alpha1 = std::acos ((bsq + csq - asq)/(2*b*c));
-
-                        bsq = r2_to_r2n_sq;
-                        b = r2_to_r2n;
-                        csq = r1_to_r2n_sq;
-                        c = r1_to_r2n;
-                        float alpha2 = std::acos ((bsq + csq - asq)/(2*b*c));
-
-                        if (alpha2 < alpha1) {
-                            // r1
-                            must_be_r1n = true;
-                            must_be_r2n = false;
-                        } else {
-                            must_be_r1n = false;
-                            must_be_r2n = true;
-                        }
-                    }
-
-                    if (must_be_r1n) {
-                        // r1 is the next
-                        this->computeSphere ((*this->dataCoords)[r1], this->cm_sph.convert(dcopy[r1]), this->sradius, this->srings, this->sseg);
-                        this->computeSphere ((*this->dataCoords)[r1n], this->cm_sph.convert(dcopy[r1n]), this->sradius, this->srings, this->sseg);
-                        this->computeTube ((*this->dataCoords)[r1], (*this->dataCoords)[r1n],
-                                           this->cm.convert(dcopy[r1]), this->cm.convert(dcopy[r1n]), this->radius, this->tseg);
-                        r1 = r1n;
-                    } else {
-                        // r2 is next
-                        this->computeSphere ((*this->dataCoords)[r2], this->cm_sph.convert(dcopy[r2]), this->sradius, this->srings, this->sseg);
-                        this->computeSphere ((*this->dataCoords)[r2n], this->cm_sph.convert(dcopy[r2n]), this->sradius, this->srings, this->sseg);
-                        this->computeTube ((*this->dataCoords)[r2], (*this->dataCoords)[r2n],
-                                           this->cm.convert(dcopy[r2]), this->cm.convert(dcopy[r2n]), this->radius, this->tseg);
-                        r2 = r2n;
-                    }
-
-                    if (completed_end_tri == true) { break; }
-
-                    // Next tri:
-                    this->computeSphere ((*this->dataCoords)[r1], this->cm_sph.convert(dcopy[r1]), this->sradius, this->srings, this->sseg);
-                    this->computeSphere ((*this->dataCoords)[r2], this->cm_sph.convert(dcopy[r2]), this->sradius, this->srings, this->sseg);
-                    this->computeTube ((*this->dataCoords)[r1], (*this->dataCoords)[r2],
-                                       this->cm.convert(dcopy[r1]), this->cm.convert(dcopy[r2]), this->radius, this->tseg);
+            const morph::unit_sphere_mesh& m = morph::unit_sphere::uv (this->srings, this->sseg);
+            this->sphere_nv = m.vertices.size();
+            this->vertex_start = this->vertexPositions.size() / 3;
+            const std::size_t nsph = this->sphere_points.size();
+            const std::size_t nvt = 4 * this->tseg + 2; // see VisualModel::computeFlaredTube
+            const std::size_t nv = nsph * this->sphere_nv + this->tube_edges.size() * nvt;
+            this->vertexPositions.reserve (3 * (this->vertex_start + nv));
+            this->vertexNormals.reserve (3 * (this->vertex_start + nv));
+            this->vertexColors.reserve (3 * (this->vertex_start + nv));
+            this->indices.reserve (this->indices.size() + nsph * m.indices.size() + this->tube_edges.size() * 24 * this->tseg);
+
+            // The spheres are copies of the unit sphere mesh, so they can be written in parallel
+            const std::size_t v0 = this->vertex_start;
+            const std::size_t i0 = this->indices.size();
+            this->vertexPositions.resize (3 * (v0 + nsph * this->sphere_nv));
+            this->vertexNormals.resize (3 * (v0 + nsph * this->sphere_nv));
+            this->vertexColors.resize (3 * (v0 + nsph * this->sphere_nv));
+            this->indices.resize (i0 + nsph * m.indices.size());
+            const GLuint idx0 = this->idx;
+            morph::parallel_for (std::size_t{0}, nsph, [&](std::size_t si) {
+                const unsigned int pi = this->sphere_points[si];
+                const std::array<float, 3> c = this->cm_sph.convert (this->dcopy[pi]);
+                const std::size_t vs = v0 + si * this->sphere_nv;
+                for (std::size_t i = 0; i < this->sphere_nv; ++i) {
+                    this->vertex_set (m.vertices[i] * this->sradius + p[pi], this->vertexPositions, 3 * (vs + i));
+                    this->vertex_set (m.vertices[i], this->vertexNormals, 3 * (vs + i));
+                    this->vertex_set (c, this->vertexColors, 3 * (vs + i));
                 }
+                const std::size_t is = i0 + si * m.indices.size();
+                for (std::size_t i = 0; i < m.indices.size(); ++i) {
+                    this->indices[is + i] = idx0 + static_cast<GLuint>(si * this->sphere_nv + m.indices[i]);
+                }
+            });
+            this->idx += static_cast<GLuint>(nsph * this->sphere_nv);
 
-                // On to the next rows:
-                r1 = r1_e + 1;
-                r1_e = r1;
-                r2 = r2_e; ++r2;
-                r2_e = r2;
-
-                if (r2 == prlen) { break; }
-
-                x = (*this->dataCoords)[r1][pa];
-                while (r1_e != prlen && (*this->dataCoords)[r1_e][pa] == x) { ++r1_e; }
-                r1_e--;
-                r2_e = r2;
-                x = (*this->dataCoords)[r2][pa];
-                while (r2_e != prlen && (*this->dataCoords)[r2_e][pa] == x) { ++r2_e; }
-                r2_e--;
-                // Now r1, r1_e, r2 and r2_e all point to the right places
+            // computeTube appends to the buffers (and orients each tube at random), so the tubes are added in turn
+            for (const std::array<unsigned int, 2>& e : this->tube_edges) {
+                this->computeTube (p[e[0]], p[e[1]], this->cm.convert (this->dcopy[e[0]]), this->cm.convert (this->dcopy[e[1]]),
+                                   this->radius, this->tseg);
             }
             std::cout << "PointRowsMeshVisual has " << this->idx << " vertex indices\n";
         }
 
+        /*!
+         * Recolour the spheres and tubes from the scalar data without stitching the rows
+         * again. The points (dataCoords) are assumed to be unchanged. Falls back to a full
+         * reinit() if the model has not been built, or its vertices have since been changed.
+         */
+        void reinitColours()
+        {
+            const std::size_t nvt = 4 * this->tseg + 2;
+            const std::size_t nsv = this->sphere_points.size() * this->sphere_nv;
+            if (this->tube_edges.empty() || this->weld_vertices || this->vertex_start != 0
+                || this->vertexColors.size() != 3 * (nsv + this->tube_edges.size() * nvt)
+                || this->scalarData->size() != this->dataCoords->size()) {
+                this->reinit();
+                return;
+            }
+            this->colourScale.do_autoscale = true;
+            this->transformScalarData (this->colourScale, this->dcopy);
+#pragma omp parallel for
+            for (std::size_t si = 0; si < this->sphere_points.size(); ++si) {
+                const std::array<float, 3> c = this->cm_sph.convert (this->dcopy[this->sphere_points[si]]);
+                for (std::size_t i = 0; i < this->sphere_nv; ++i) { this->vertex_set (c, this->vertexColors, 3 * (si * this->sphere_nv + i)); }
+            }
+            // The first half of the vertices of each tube (its start cap and ring) have the start colour
+#pragma omp parallel for
+            for (std::size_t ei = 0; ei < this->tube_edges.size(); ++ei) {
+                const std::array<float, 3> c0 = this->cm.convert (this->dcopy[this->tube_edges[ei][0]]);
+                const std::array<float, 3> c1 = this->cm.convert (this->dcopy[this->tube_edges[ei][1]]);
+                const std::size_t vt = nsv + ei * nvt;
+                for (std::size_t i = 0; i < nvt; ++i) { this->vertex_set (i < nvt / 2 ? c0 : c1, this->vertexColors, 3 * (vt + i)); }
+            }
+            this->reinit_colour_buffer();
+        }
+
+        //! After updateData, only the colours need to change
+        void scalarDataUpdated() override { this->reinitColours(); }
+
     private:
         //! Which axis are we perpendicular to?
         unsigned int pa = 0U;
@@ -286,6 +273,15 @@ namespace morph {
         int tseg = 12;
         //! A colour map for the spheres
         morph::ColourMap<float> cm_sph;
+        //! The colour-scaled scalarData, kept to reuse its memory on each update
+        std::vector<float> dcopy;
+        //! The points that have spheres, and the (sorted) pairs of points joined by tubes, for reinitColours()
+        std::vector<unsigned int> sphere_points;
+        std::vector<std::array<unsigned int, 2>> tube_edges;
+        //! The number of vertices in each sphere
+        std::size_t sphere_nv = 0;
+        //! The first vertex made by initializeVertices()
+        std::size_t vertex_start = 0;
     };
 
 } // namespace morph
@@ -2,13 +2,15 @@
 
 #include <morph/tools.h>
 #include <morph/VisualDataModel.h>
-#include <morph/MathAlgo.h>
+#include <morph/point_rows.h>
+#include <morph/threadpool.h>
 #include <morph/scale.h>
 #include <morph/vec.h>
 #include <iostream>
 #include <vector>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 
 namespace morph {
 
@@ -38,7 +40,7 @@ namespace morph {
             this->colourScale = cscale;
 
             this->dataCoords = _pointrows;
-            this->scalarData = _data;
+            this->setScalarData (_data);
 
             this->cm.setHue (_hue);
             this->cm.setType (_cmt);
@@ -55,8 +57,14 @@ namespace morph {
             return this->cm.convert (datum);
         }
 
-        //! Do the computations to initialize the vertices that will represent the
-        //! surface.
+        /*!
+         * Do the computations to initialize the vertices that will represent the surface.
+         *
+         * Each adjacent pair of rows is stitched into triangles (see point_rows::stitch) in
+         * parallel. From the number of triangles in each pair, the vertex buffers are sized
+         * once and then each pair's vertices are written into its own part of them, again
+         * in parallel.
+         */
         void initializeVertices()
         {
             unsigned int npoints = this->dataCoords->size();
@@ -67,236 +75,106 @@ namespace morph {
                 return;
             }
 
-            std::vector<Flt> dcopy = *(this->scalarData);
             this->colourScale.do_autoscale = true;
-            this->colourScale.transform (*this->scalarData, dcopy);
+            this->transformScalarData (this->colourScale, this->dcopy);
 
-            // First, need to know which set of points form two, adjacent rows. An assumption we'll
-            // accept: The rows are listed in slice-order and the points in each row are listed in
-            // position-along-the-curve order.
+            const std::vector<vec<float, 3>>& p = *this->dataCoords;
+            const std::vector<std::array<std::size_t, 2>> rows = morph::point_rows::find_rows (p, this->pa);
+            const std::size_t npairs = rows.size() > 1 ? rows.size() - 1 : 0;
 
-            std::size_t r1 = 0U;
-            std::size_t r1_e = 0U;
-            std::size_t r2 = 0U;
-            std::size_t r2_e = 0U;
+            // Stitch each pair of rows
+            std::vector<std::vector<std::uint8_t>> steps (npairs);
+            morph::parallel_for (std::size_t{0}, npairs, [&](std::size_t k) { steps[k] = morph::point_rows::stitch (p, rows[k], rows[k+1]); }, 1);
 
-            std::size_t prlen = this->dataCoords->size();
-
-            // pa is this->pa
-            float x = (*this->dataCoords)[r1][pa];
-            while (r1_e != prlen && (*this->dataCoords)[r1_e][pa] == x) {
-                ++r1_e;
-            }
-            r2 = r1_e--;
-            r2_e = r2;
-            x = (*this->dataCoords)[r2][pa];
-            while (r2_e != prlen && (*this->dataCoords)[r2_e][pa] == x) {
-                ++r2_e;
+            // Each triangle has its own three vertices. The first two vertices of a pair are
+            // pushed even if it has no triangles.
+            std::vector<std::size_t> voff (npairs + 1, 0);
+            for (std::size_t k = 0; k < npairs; ++k) {
+                voff[k+1] = voff[k] + (steps[k].empty() ? 2 : 3 * steps[k].size());
             }
-            r2_e--;
-            // Now r1, r1_e, r2 and r2_e all point to the right places
-            //std::cout << "r1: " << r1 << ", r1_e: " << r1_e << std::endl;
-            //std::cout << "r2: " << r2 << ", r2_e: " << r2_e << std::endl;
-            //std::cout << "prlen is " << prlen << std::endl;
-            morph::vec<float> v0, v1, v2;
-            while (r2 != prlen) { // While through all 'rows' - pairs of pointrows
-                //std::cout << "====================================" << std::endl;
-                //std::cout << "  ROW" << std::endl;
-                //std::cout << "  r1: " << r1 << ", r1_e: " << r1_e << std::endl;
-                //std::cout << "  r2: " << r2 << ", r2_e: " << r2_e << std::endl;
-                //std::cout << "====================================" << std::endl;
-
-                // Push the first two vertices in the row:
-                // Start vertex 1
-                v1 = (*this->dataCoords)[r1];
-                this->vertex_push ((*this->dataCoords)[r1], this->vertexPositions);
-                this->vertex_push (this->cm.convert(dcopy[r1]), this->vertexColors);
-                //this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-                this->indices.push_back (this->idx);
-                this->idx++;
-                // Start vertex 2
-                v2 = (*this->dataCoords)[r2];
-                this->vertex_push ((*this->dataCoords)[r2], this->vertexPositions);
-                this->vertex_push (this->cm.convert(dcopy[r2]), this->vertexColors);
-                //this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-                this->indices.push_back (this->idx);
-                this->idx++;
-
-                // Let v0 be:
-                morph::vec<float> vnorm = {0.0f, 0.0f, 1.0f};
-                if (r1+1 < r1_e) {
-                    v0 = (*this->dataCoords)[r1+1];
-                    // Compute normal
-                    morph::vec<float> plane1 = v1 - v0;
-                    morph::vec<float> plane2 = v2 - v0;
-                    vnorm = plane2.cross (plane1);
+            const std::size_t nv = voff[npairs];
+            const std::size_t v_start = this->vertexPositions.size() / 3;
+            this->vertexPositions.resize (3 * (v_start + nv));
+            this->vertexNormals.resize (3 * (v_start + nv));
+            this->vertexColors.resize (3 * (v_start + nv));
+            const std::size_t i_start = this->indices.size();
+            this->indices.resize (i_start + nv);
+            this->vsrc.resize (nv);
+            const GLuint idx0 = this->idx;
+
+            morph::parallel_for (std::size_t{0}, npairs, [&](std::size_t k) {
+                std::size_t v = voff[k];
+                // Write vertex v of this model, at point pi, with normal vn
+                auto put = [this, &p, v_start, i_start, idx0](std::size_t v, std::size_t pi, const morph::vec<float>& vn) {
+                    this->vertex_set (p[pi], this->vertexPositions, 3 * (v_start + v));
+                    this->vertex_set (vn, this->vertexNormals, 3 * (v_start + v));
+                    this->vertex_set (this->cm.convert (this->dcopy[pi]), this->vertexColors, 3 * (v_start + v));
+                    this->indices[i_start + v] = idx0 + static_cast<GLuint>(v);
+                    this->vsrc[v] = static_cast<unsigned int>(pi);
+                };
+
+                std::size_t r1 = rows[k][0];
+                std::size_t r2 = rows[k+1][0];
+                morph::vec<float> v1 = p[r1];
+                morph::vec<float> v2 = p[r2];
+                morph::vec<float> vnorm = { 0.0f, 0.0f, 1.0f };
+                if (r1 + 1 < rows[k][1]) {
+                    morph::vec<float> v0 = p[r1 + 1];
+                    vnorm = (v2 - v0).cross (v1 - v0);
                     vnorm.renormalize();
                 }
-                // Push normal twice for the two start vertices:
-                this->vertex_push (vnorm, this->vertexNormals);
-                this->vertex_push (vnorm, this->vertexNormals);
-
-                // Now while through the row pushing the rest of the vertices.
-                //std::cout << "While through the rest, with r2 < r2_e=" << r2_e << std::endl;
-                while (r2 <= r2_e && r1 <= r1_e) {
-
-                    // Now iterate r1 and r2 until we get to the end of the two rows.
-                    // vtx is r1, r2. Question is: Is other vertex ++r1 or ++r2?
-                    std::size_t r1n = r1 + 1U;
-                    std::size_t r2n = r2 + 1U;
-
-                    //std::cout << "**************************" << std::endl;
-                    //std::cout << "r1: " << r1 << ", r1_e: " << r1_e << std::endl;
-                    //std::cout << "r2: " << r2 << ", r2_e: " << r2_e << std::endl;
-
-                    // Increment and make sure we didn't drop off the end
-                    if (r1n > r1_e && r2n > r2_e) {
-                        r1 = r1n;
-                        r2 = r2n;
-                        //std::cout << "Breaking as r1n>r1_e and r2n>r2_e" << std::endl;
-                        break;
-                    }
-
-                    //std::cout << "r1: " << r1 << ", r1n: " << r1n << std::endl;
-                    //std::cout << "r2: " << r2 << ", r2n: " << r2n << std::endl;
-
-                    bool completed_end_tri = false;
-                    bool must_be_r1n = false;
-                    bool must_be_r2n = false;
-                    if (r1n > r1_e) {
-                        // Can't add this one, only r2n is possthis->idxle
-                        must_be_r2n = true;
-                        completed_end_tri = true;
-                    }
-                    if (r2n > r2_e) {
-                        // Can't add this one, only r1n is possthis->idxle and must be at end of row
-                        must_be_r1n = true;
-                        completed_end_tri = true;
-                    }
-
-                    if (must_be_r1n) {
-                        must_be_r2n = false;
-                    } else if (must_be_r2n) {
-                        must_be_r1n = false;
-                    } else {
-                        // Compute distances to compute angles to decide
-                        float r1_to_r2_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r1], (*this->dataCoords)[r2]);
-
-                        float r1_to_r1n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r1], (*this->dataCoords)[r1n]);
-                        float r1_to_r2n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r1], (*this->dataCoords)[r2n]);
-                        float r2_to_r1n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r2], (*this->dataCoords)[r1n]);
-                        float r2_to_r2n_sq = MathAlgo::distance_sq<float, 3> ((*this->dataCoords)[r2], (*this->dataCoords)[r2n]);
-
-                        float r1_to_r1n = sqrt(r1_to_r1n_sq);
-                        float r1_to_r2n = sqrt(r1_to_r2n_sq);
-                        float r2_to_r1n = sqrt(r2_to_r1n_sq);
-                        float r2_to_r2n = sqrt(r2_to_r2n_sq);
-
-                        float asq = r1_to_r2_sq;
-                        float bsq = r2_to_r1n_sq;
-                        float b = r2_to_r1n;
-                        float csq = r1_to_r1n_sq;
-                        float c = r1_to_r1n;
-                        float alpha1 = acos ((bsq + csq - asq)/(2*b*c));
-
-                        bsq = r2_to_r2n_sq;
-                        b = r2_to_r2n;
-                        csq = r1_to_r2n_sq;
-                        c = r1_to_r2n;
-                        float alpha2 = acos ((bsq + csq - asq)/(2*b*c));
-
-                        if (alpha2 < alpha1) {
-                            // r1
-                            must_be_r1n = true;
-                            must_be_r2n = false;
-                        } else {
-                            must_be_r1n = false;
-                            must_be_r2n = true;
-                        }
-                    }
-
-                    if (must_be_r1n) {
-                        // r1 vertex is the next
-                        r1 = r1n;
-                        v0 = (*this->dataCoords)[r1];
-                        this->vertex_push ((*this->dataCoords)[r1], this->vertexPositions);
-                        this->vertex_push (this->cm.convert(dcopy[r1]), this->vertexColors);
-                        this->indices.push_back (this->idx);
-                        this->idx++;
-
-                    } else {
-                        // r2 vertex is next
-                        r2 = r2n;
-                        v0 = (*this->dataCoords)[r2];
-                        this->vertex_push ((*this->dataCoords)[r2], this->vertexPositions);
-                        this->vertex_push (this->cm.convert(dcopy[r2]), this->vertexColors);
-                        this->indices.push_back (this->idx);
-                        this->idx++;
-                    }
-
-                    // Compute normal and push one
-                    morph::vec<float> plane1 = v1 - v0;
-                    morph::vec<float> plane2 = v2 - v0;
-                    morph::vec<float> vnorm = plane2.cross (plane1);
+                put (v++, r1, vnorm);
+                put (v++, r2, vnorm);
+
+                for (std::size_t s = 0; s < steps[k].size(); ++s) {
+                    // The third vertex of the triangle is the next point along one of the rows
+                    const std::size_t r0 = steps[k][s] ? ++r1 : ++r2;
+                    morph::vec<float> v0 = p[r0];
+                    vnorm = (v2 - v0).cross (v1 - v0);
                     vnorm.renormalize();
-                    this->vertex_push (vnorm, this->vertexNormals);
-
-                    if (completed_end_tri == true) {
-                        //std::cout << "Completed the end triangle";
-                        break;
-                    }
-
-                    // Next tri:
-                    v1 = (*this->dataCoords)[r1];
-                    this->vertex_push ((*this->dataCoords)[r1], this->vertexPositions);
-                    this->vertex_push (this->cm.convert(dcopy[r1]), this->vertexColors);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->indices.push_back (this->idx);
-                    this->idx++;
-
-                    v2 = (*this->dataCoords)[r2];
-                    this->vertex_push ((*this->dataCoords)[r2], this->vertexPositions);
-                    this->vertex_push (this->cm.convert(dcopy[r2]), this->vertexColors);
-                    this->vertex_push (vnorm, this->vertexNormals);
-                    this->indices.push_back (this->idx);
-                    this->idx++;
-                }
-
-                // On to the next rows:
-                r1 = r1_e + 1;
-                r1_e = r1;
-                r2 = r2_e; ++r2;
-                r2_e = r2;
-
-                //std::cout << "Next r1 is: " << r1 << std::endl;
-                //std::cout << "Next r2 is: " << r2 << std::endl;
-                //std::cout << "this->idx is now " << this->idx << std::endl;
-                if (r2 == prlen) {
-                    //std::cout << "No more rows, break." << std::endl;
-                    break;
+                    put (v++, r0, vnorm);
+                    if (s + 1 == steps[k].size()) { break; }
+                    // The next triangle starts from the current point of each row
+                    v1 = p[r1];
+                    put (v++, r1, vnorm);
+                    v2 = p[r2];
+                    put (v++, r2, vnorm);
                 }
+            }, 1);
+            this->idx += static_cast<GLuint>(nv);
+        }
 
-                x = (*this->dataCoords)[r1][pa];
-                while (r1_e != prlen && (*this->dataCoords)[r1_e][pa] == x) {
-                    ++r1_e;
-                }
-                r1_e--;
-                r2_e = r2;
-                x = (*this->dataCoords)[r2][pa];
-                while (r2_e != prlen && (*this->dataCoords)[r2_e][pa] == x) {
-                    ++r2_e;
-                }
-                r2_e--;
-                // Now r1, r1_e, r2 and r2_e all point to the right places
-                //std::cout << "Next r1,r1, r1_e, r2_e:" << std::endl;
-                //std::cout << "r1: " << r1 << ", r1_e: " << r1_e << std::endl;
-                //std::cout << "r2: " << r2 << ", r2_e: " << r2_e << std::endl;
+        /*!
+         * Recolour the surface from the scalar data without stitching the rows again. The
+         * points (dataCoords) are assumed to be unchanged. Falls back to a full reinit() if
+         * the model has not been built, or its vertices have since been changed.
+         */
+        void reinitColours()
+        {
+            if (this->vsrc.empty() || this->weld_vertices || this->vertexColors.size() != 3 * this->vsrc.size()
+                || this->scalarData->size() != this->dataCoords->size()) {
+                this->reinit();
+                return;
+            }
+            this->colourScale.do_autoscale = true;
+            this->transformScalarData (this->colourScale, this->dcopy);
+#pragma omp parallel for
+            for (std::size_t v = 0; v < this->vsrc.size(); ++v) {
+                this->vertex_set (this->cm.convert (this->dcopy[this->vsrc[v]]), this->vertexColors, 3 * v);
             }
+            this->reinit_colour_buffer();
         }
 
+        //! After updateData, only the colours need to change
+        void scalarDataUpdated() override { this->reinitColours(); }
+
     private:
         //! Which axis are we perpendicular to?
         unsigned int pa = 0U;
+        //! The colour-scaled scalarData, kept to reuse its memory on each update
+        std::vector<float> dcopy;
+        //! The index of the point in dataCoords from which each vertex was made, for reinitColours()
+        std::vector<unsigned int> vsrc;
     };
 
 } // namespace morph
@@ -17,15 +17,19 @@
 #include <string>
 #include <fstream>
 #include <cstdlib>
+#include <cstddef>
 #include <iostream>
 extern "C" {
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/poll.h>
 #include <signal.h>
+extern char** environ;
 }
 #include <morph/MorphDbg.h>
 
@@ -191,6 +195,7 @@ namespace morph {
             this->signalledStart = false;
             this->pauseBeforeStart = 0;
             this->error = PROCESSNOERROR;
+            this->exitStatus = -1;
             this->progName = "unknown";
             this->environment.clear();
             // Ensure all file descriptors are closed.
@@ -204,12 +209,88 @@ namespace morph {
             write (this->parentToChild[PROCESS_WRITING_END], input.c_str(), input.size());
         }
 
+        /*!
+         * Write \arg n bytes from \arg data to the stdin of the process, blocking until all of them
+         * have gone into the pipe. Use this for large amounts of binary data. Returns false if
+         * the write failed (for example because the process has closed its stdin).
+         */
+        bool writeIn (const void* data, const std::size_t n) const
+        {
+            if (this->parentToChild[PROCESS_WRITING_END] <= 0) { return false; }
+            const char* d = static_cast<const char*>(data);
+            std::size_t done = 0;
+            while (done < n) {
+                ssize_t rtn = write (this->parentToChild[PROCESS_WRITING_END], d + done, n - done);
+                if (rtn < 0) {
+                    if (errno == EINTR) { continue; }
+                    return false;
+                }
+                done += static_cast<std::size_t>(rtn);
+            }
+            return true;
+        }
+
+        //! Close the stdin of the process, so that it sees the end of its input.
+        void closeIn()
+        {
+            if (this->parentToChild[PROCESS_WRITING_END] > 0) {
+                close (this->parentToChild[PROCESS_WRITING_END]);
+                this->parentToChild[PROCESS_WRITING_END] = 0;
+            }
+        }
+
+        /*!
+         * Block until the process exits. Returns its exit status, or -1 if it did not exit
+         * normally or was not running.
+         */
+        int waitForFinished()
+        {
+            if (this->pid <= 0) { return -1; }
+            int status = 0;
+            pid_t rtn = 0;
+            while ((rtn = waitpid (this->pid, &status, 0)) == -1 && errno == EINTR) {}
+            if (rtn != this->pid) { return -1; }
+            this->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+            if (this->callbacks != nullptr) { this->callbacks->processFinishedSignal (this->progName); }
+            this->pid = 0;
+            return this->exitStatus;
+        }
+
         /*!
          * When Process::start() is called, pause useconds before forking and exec-ing
          * the program. This is a setter for this->pauseBeforeStart.
          */
         void setPauseBeforeStart (const unsigned int usecs) { this->pauseBeforeStart = usecs; }
 
+        /*!
+         * If true, start() launches the program with posix_spawn() rather than fork() and
+         * execv(). That avoids copying the page tables of a big parent process, so it is much
+         * faster from a simulation that uses a lot of memory. It is not used if a pause before
+         * start has been set.
+         */
+        void setUseSpawn (const bool s) { this->useSpawn = s; }
+
+        /*!
+         * If the process has exited, reap it, set its exit status and return true; otherwise
+         * return false straight away. Unlike probeProcess(), this doesn't look at the pipes.
+         */
+        bool checkFinished()
+        {
+            if (this->pid <= 0) { return false; }
+            int status = 0;
+            pid_t rtn = waitpid (this->pid, &status, WNOHANG);
+            if (rtn != this->pid) { return false; }
+            this->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+            if (this->callbacks != nullptr) { this->callbacks->processFinishedSignal (this->progName); }
+            this->pid = 0;
+            return true;
+        }
+
+        //! The file descriptor of the parent's end of the child's stdout (0 if not started)
+        int getStdOutFd() const { return this->childToParent[PROCESS_READING_END]; }
+        //! The file descriptor of the parent's end of the child's stderr (0 if not started)
+        int getStdErrFd() const { return this->childErrToParent[PROCESS_READING_END]; }
+
         /*!
          * fork and exec the process using execv, which takes stdin via a fifo and
          * returns output also via a fifo.
@@ -236,6 +317,15 @@ namespace morph {
                 this->error = PROCESSNOMOREPIPES;
                 return PROCESS_FAILURE;
             }
+            // Don't let later children inherit these pipes (which would hold them open, so that
+            // the end of this child's output would not be seen). The child's own stdin, stdout
+            // and stderr are dup2()ed copies, which stay open across exec.
+            for (int fd : { this->parentToChild[0], this->parentToChild[1], this->childToParent[0],
+                            this->childToParent[1], this->childErrToParent[0], this->childErrToParent[1] }) {
+                fcntl (fd, F_SETFD, FD_CLOEXEC);
+            }
+
+            if (this->useSpawn && this->pauseBeforeStart == 0) { return this->spawn (program, args); }
 
             this->pid = fork();
             switch (this->pid) {
@@ -323,6 +413,43 @@ namespace morph {
             return PROCESS_MAIN_APP;
         }
 
+    private:
+        //! The posix_spawn() version of start(), called once the pipes are set up
+        int spawn (const std::string& program, const std::list<std::string>& args)
+        {
+            posix_spawn_file_actions_t fa;
+            posix_spawn_file_actions_init (&fa);
+            posix_spawn_file_actions_adddup2 (&fa, this->parentToChild[PROCESS_READING_END], PROCESS_STDIN);
+            posix_spawn_file_actions_adddup2 (&fa, this->childToParent[PROCESS_WRITING_END], PROCESS_STDOUT);
+            posix_spawn_file_actions_adddup2 (&fa, this->childErrToParent[PROCESS_WRITING_END], PROCESS_STDERR);
+
+            std::vector<char*> argv;
+            for (const auto& a : args) { argv.push_back (const_cast<char*>(a.c_str())); }
+            argv.push_back (nullptr);
+
+            pid_t child = 0;
+            int rtn = posix_spawn (&child, program.c_str(), &fa, nullptr, argv.data(), environ);
+            posix_spawn_file_actions_destroy (&fa);
+
+            // Close the child's ends of the pipes, as start() does after fork()
+            close (this->parentToChild[PROCESS_READING_END]);
+            this->parentToChild[PROCESS_READING_END] = 0;
+            close (this->childToParent[PROCESS_WRITING_END]);
+            this->childToParent[PROCESS_WRITING_END] = 0;
+            close (this->childErrToParent[PROCESS_WRITING_END]);
+            this->childErrToParent[PROCESS_WRITING_END] = 0;
+
+            if (rtn != 0) {
+                DBG ("posix_spawn() failed with " << rtn << ", return PROCESS_FAILURE" << std::flush);
+                this->pid = 0;
+                this->error = PROCESSFAILEDTOSTART;
+                return PROCESS_FAILURE;
+            }
+            this->pid = child;
+            return PROCESS_MAIN_APP;
+        }
+
+    public:
         //! Send a TERM signal to the process.
         void terminate()
         {
@@ -411,7 +538,9 @@ namespace morph {
             int theError;
             if (this->signalledStart == true) {
                 int rtn = 0;
-                if ((rtn = waitpid (this->pid, nullptr, WNOHANG)) == this->pid) {
+                int status = 0;
+                if ((rtn = waitpid (this->pid, &status, WNOHANG)) == this->pid) {
+                    this->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
                     if (this->callbacks != nullptr) {
                         this->callbacks->processFinishedSignal (this->progName);
                     }
@@ -433,6 +562,8 @@ namespace morph {
         // Accessors
         pid_t getPid() const { return this->pid; }
         int getError() const { return this->error; }
+        //! The exit status of the process once it has finished, or -1 if it did not exit normally
+        int getExitStatus() const { return this->exitStatus; }
         void setError (const int e) { this->error = e; }
 
         //! Setter for the callbacks.
@@ -537,6 +668,12 @@ namespace morph {
         //! Process ID of the program
         pid_t pid;
 
+        //! The exit status, set when the process is found to have finished
+        int exitStatus = -1;
+
+        //! If true, start() uses posix_spawn()
+        bool useSpawn = false;
+
         /*!
          * Set to true if the fact that the program has been started has been signalled
          * using the callback callbacks->startedSignal
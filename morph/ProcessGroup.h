@@ -0,0 +1,237 @@
+/*!
+ * \file
+ *
+ * \brief Run many processes at once from one event loop
+ *
+ * ProcessGroup starts processes with morph::Process (using posix_spawn) and waits on the
+ * stdout and stderr of all of them at once, with epoll on Linux and poll elsewhere, calling
+ * back with each chunk of output and with each exit. There's no need to call probeProcess() on
+ * every child in turn.
+ */
+#pragma once
+
+#include <morph/Process.h>
+#include <map>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+extern "C" {
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
+}
+
+namespace morph {
+
+    /*!
+     * A set of child processes, each known by the id that start() returns. Call wait() (or
+     * wait_all()) in a loop; between calls, nothing is read from the children, so the
+     * callbacks are all called from the thread that calls wait().
+     *
+     *\code{.cpp}
+     * morph::ProcessGroup g;
+     * g.on_stdout = [](unsigned int id, const std::string& s) { std::cout << id << ": " << s; };
+     * g.on_finished = [](unsigned int id, int status) { std::cout << id << " exited " << status << "\n"; };
+     * for (int i = 0; i < 100; ++i) { g.start ("/usr/bin/echo", { "echo", std::to_string (i) }); }
+     * g.wait_all();
+     *\endcode
+     */
+    class ProcessGroup
+    {
+    public:
+        ProcessGroup()
+        {
+#ifdef __linux__
+            this->epfd = epoll_create1 (EPOLL_CLOEXEC);
+            if (this->epfd < 0) { throw std::runtime_error ("ProcessGroup: epoll_create1 failed"); }
+#endif
+        }
+
+        ~ProcessGroup()
+        {
+            // Processes that are still running are left to run; their pipes are closed.
+#ifdef __linux__
+            if (this->epfd >= 0) { close (this->epfd); }
+#endif
+        }
+
+        ProcessGroup (const ProcessGroup&) = delete;
+        ProcessGroup& operator= (const ProcessGroup&) = delete;
+
+        //! Called with each chunk of a child's stdout
+        std::function<void(unsigned int, const std::string&)> on_stdout;
+        //! Called with each chunk of a child's stderr
+        std::function<void(unsigned int, const std::string&)> on_stderr;
+        //! Called when a child has exited and all of its output has been read, with its exit status
+        std::function<void(unsigned int, int)> on_finished;
+
+        /*!
+         * Start program (the full path) with args (the first of which should be the program
+         * name). Returns the child's id, or throws if it could not be started.
+         */
+        unsigned int start (const std::string& program, const std::list<std::string>& args)
+        {
+            auto c = std::make_unique<child>();
+            c->proc.setUseSpawn (true);
+            if (c->proc.start (program, args) != PROCESS_MAIN_APP) {
+                throw std::runtime_error ("ProcessGroup: Failed to start " + program);
+            }
+            const unsigned int id = this->next_id++;
+            c->fds[0] = c->proc.getStdOutFd();
+            c->fds[1] = c->proc.getStdErrFd();
+            for (int k = 0; k < 2; ++k) {
+                fcntl (c->fds[k], F_SETFL, fcntl (c->fds[k], F_GETFL) | O_NONBLOCK);
+#ifdef __linux__
+                epoll_event ev = {};
+                ev.events = EPOLLIN;
+                ev.data.u64 = (static_cast<std::uint64_t>(id) << 1) | static_cast<std::uint64_t>(k);
+                if (epoll_ctl (this->epfd, EPOLL_CTL_ADD, c->fds[k], &ev) != 0) {
+                    throw std::runtime_error ("ProcessGroup: epoll_ctl failed");
+                }
+#endif
+            }
+            this->children[id] = std::move (c);
+            return id;
+        }
+
+        //! The Process for child id, for writing to its stdin (say) with Process::writeIn()
+        Process& process (const unsigned int id) { return this->children.at (id)->proc; }
+
+        //! The number of children that have not yet been reported as finished
+        std::size_t size() const { return this->children.size(); }
+
+        /*!
+         * Wait up to timeout_ms (or forever, if it is negative) for output from, or the exit
+         * of, any child, then deal with everything that is ready. Returns the number of
+         * children that finished.
+         */
+        std::size_t wait (const int timeout_ms = -1)
+        {
+            if (this->children.empty()) { return 0; }
+            if (this->open_pipes() == 0) {
+                // Only exits remain to be seen. Children can't be waited on alongside their pipes,
+                // so check for them every millisecond.
+                const auto t0 = std::chrono::steady_clock::now();
+                std::size_t n = 0;
+                while ((n = this->reap()) == 0) {
+                    if (timeout_ms >= 0 && std::chrono::steady_clock::now() - t0 >= std::chrono::milliseconds (timeout_ms)) { break; }
+                    std::this_thread::sleep_for (std::chrono::milliseconds (1));
+                }
+                return n;
+            }
+#ifdef __linux__
+            std::vector<epoll_event> evs (std::max (std::size_t{16}, 2 * this->children.size()));
+            int n = 0;
+            while ((n = epoll_wait (this->epfd, evs.data(), static_cast<int>(evs.size()), timeout_ms)) < 0 && errno == EINTR) {}
+            for (int i = 0; i < n; ++i) {
+                const unsigned int id = static_cast<unsigned int>(evs[i].data.u64 >> 1);
+                const int k = static_cast<int>(evs[i].data.u64 & 1u);
+                auto ci = this->children.find (id);
+                if (ci != this->children.end()) { this->read_pipe (id, *ci->second, k); }
+            }
+#else
+            std::vector<pollfd> pfds;
+            std::vector<std::pair<unsigned int, int>> which;
+            for (auto& [id, c] : this->children) {
+                for (int k = 0; k < 2; ++k) {
+                    if (c->fds[k] > 0) {
+                        pfds.push_back ({ c->fds[k], POLLIN, 0 });
+                        which.push_back ({ id, k });
+                    }
+                }
+            }
+            int n = 0;
+            while ((n = ::poll (pfds.data(), pfds.size(), timeout_ms)) < 0 && errno == EINTR) {}
+            for (std::size_t i = 0; n > 0 && i < pfds.size(); ++i) {
+                if (pfds[i].revents != 0) { this->read_pipe (which[i].first, *this->children[which[i].first], which[i].second); }
+            }
+#endif
+            return this->reap();
+        }
+
+        //! Wait until every child has finished
+        void wait_all()
+        {
+            while (!this->children.empty()) { this->wait (-1); }
+        }
+
+    private:
+        struct child
+        {
+            Process proc;
+            //! The stdout and stderr pipes; 0 once closed
+            int fds[2] = { 0, 0 };
+        };
+
+        //! Read what is waiting on pipe k of child c, closing the pipe at its end
+        void read_pipe (const unsigned int id, child& c, const int k)
+        {
+            char buf[4096];
+            std::string got;
+            for (;;) {
+                ssize_t r = read (c.fds[k], buf, sizeof (buf));
+                if (r > 0) {
+                    got.append (buf, static_cast<std::size_t>(r));
+                    continue;
+                }
+                if (r < 0 && errno == EINTR) { continue; }
+                if (r == 0) {
+                    // End of file: the child has closed its end. Process will close ours.
+#ifdef __linux__
+                    epoll_ctl (this->epfd, EPOLL_CTL_DEL, c.fds[k], nullptr);
+#endif
+                    c.fds[k] = 0;
+                }
+                break; // EOF, or EAGAIN once the pipe is empty
+            }
+            if (!got.empty()) {
+                auto& cb = k == 0 ? this->on_stdout : this->on_stderr;
+                if (cb) { cb (id, got); }
+            }
+        }
+
+        //! The number of children's pipes still open
+        std::size_t open_pipes() const
+        {
+            std::size_t n = 0;
+            for (const auto& [id, c] : this->children) { n += (c->fds[0] > 0) + (c->fds[1] > 0); }
+            return n;
+        }
+
+        //! Reap the children whose output has ended and which have exited. Returns how many.
+        std::size_t reap()
+        {
+            std::size_t n = 0;
+            for (auto ci = this->children.begin(); ci != this->children.end();) {
+                child& c = *ci->second;
+                if (c.fds[0] == 0 && c.fds[1] == 0 && c.proc.checkFinished()) {
+                    const unsigned int id = ci->first;
+                    const int status = c.proc.getExitStatus();
+                    ci = this->children.erase (ci);
+                    ++n;
+                    if (this->on_finished) { this->on_finished (id, status); }
+                } else {
+                    ++ci;
+                }
+            }
+            return n;
+        }
+
+        std::map<unsigned int, std::unique_ptr<child>> children;
+        unsigned int next_id = 0;
+#ifdef __linux__
+        int epfd = -1;
+#endif
+    };
+
+} // namespace morph
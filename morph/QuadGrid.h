@@ -0,0 +1,414 @@
+/*!
+ * \file
+ *
+ * morph::QuadGrid, a Cartesian grid whose elements can be refined (and coarsened again)
+ * locally, for fields with sharp features in small regions.
+ *
+ * The domain is w by h root cells of size dx; each root cell is the root of a quadtree of up
+ * to max_level levels, and the elements of the grid are the leaves of these trees. Neighbouring
+ * leaves differ by at most one level (the mesh is '2:1 balanced'), so each face of a leaf is
+ * shared with one neighbour of the same size, one of twice the size or two of half the size.
+ *
+ * adapt() refines the leaves where an indicator (such as gradient()) is large and coarsens them
+ * where it is small, carrying any number of fields across, conservatively: a refined leaf's
+ * children take its value and a coarsened group of four become their mean, so the integral of
+ * each field over the domain is unchanged. laplacian() is a finite volume Laplacian with zero
+ * flux boundaries that respects the level boundaries, so that the integral of a field is also
+ * conserved by diffusion on the refined mesh.
+ *
+ *\code{.cpp}
+ * morph::QuadGrid<float> qg (64, 64, { 0.01f, 0.01f }, { 0.0f, 0.0f }, 3);
+ * std::vector<float> u (qg.n(), 0.0f);
+ * // ...
+ * qg.adapt (qg.gradient (u), 5.0f, 1.0f, { &u });
+ *\endcode
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/memory_usage.h>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+
+    template <typename C = float>
+    struct QuadGrid
+    {
+        static_assert (std::is_floating_point_v<C>, "QuadGrid: The coordinate type must be floating point");
+
+        //! A leaf of one of the quadtrees: at level, it is cell (ix, iy) of the (w, h) << level cells
+        struct cell
+        {
+            std::uint32_t ix = 0;
+            std::uint32_t iy = 0;
+            std::uint32_t level = 0;
+        };
+
+        /*!
+         * A grid of _w by _h root cells each of size _dx, that may be refined to _max_level
+         * levels (so that its finest elements are _dx / 2^_max_level). _offset is the
+         * coordinate of the centre of the bottom left root cell, as for morph::Grid.
+         */
+        QuadGrid (const unsigned int _w, const unsigned int _h, const morph::vec<C, 2> _dx,
+                  const morph::vec<C, 2> _offset = { C{0}, C{0} }, const unsigned int _max_level = 4)
+            : w(_w), h(_h), dx(_dx), offset(_offset), max_level(_max_level)
+        {
+            if (this->w == 0 || this->h == 0) { throw std::runtime_error ("QuadGrid: w and h must be > 0"); }
+            if (this->max_level > max_levels_limit) { throw std::runtime_error ("QuadGrid: max_level may not exceed 15"); }
+            if ((static_cast<std::uint64_t>(std::max (this->w, this->h)) << this->max_level) >= (std::uint64_t{1} << 30)) {
+                throw std::runtime_error ("QuadGrid: Too many cells on a side at max_level");
+            }
+            this->cells.resize (static_cast<std::size_t>(this->w) * this->h);
+            for (unsigned int y = 0; y < this->h; ++y) {
+                for (unsigned int x = 0; x < this->w; ++x) { this->cells[y * this->w + x] = { x, y, 0 }; }
+            }
+            this->init();
+        }
+
+        //! The number of elements (leaves)
+        std::size_t n() const { return this->cells.size(); }
+        unsigned int get_w() const { return this->w; }
+        unsigned int get_h() const { return this->h; }
+        morph::vec<C, 2> get_dx() const { return this->dx; }
+        unsigned int get_max_level() const { return this->max_level; }
+        const cell& get_cell (const std::size_t i) const { return this->cells[i]; }
+        unsigned int level (const std::size_t i) const { return this->cells[i].level; }
+
+        //! The size of element i
+        morph::vec<C, 2> size (const std::size_t i) const
+        {
+            return this->dx / static_cast<C>(std::uint32_t{1} << this->cells[i].level);
+        }
+        //! The area of element i
+        C area (const std::size_t i) const { return this->size(i).product(); }
+
+        //! The coordinate of the centre of element i
+        morph::vec<C, 2> coord (const std::size_t i) const
+        {
+            const cell& c = this->cells[i];
+            const morph::vec<C, 2> s = this->size (i);
+            return this->origin()
+                + morph::vec<C, 2>{ (static_cast<C>(c.ix) + C{0.5}) * s[0], (static_cast<C>(c.iy) + C{0.5}) * s[1] };
+        }
+        morph::vec<C, 2> operator[] (const std::size_t i) const { return this->coord (i); }
+
+        //! The width and depth of the domain
+        morph::vec<C, 2> extent() const { return { this->dx[0] * this->w, this->dx[1] * this->h }; }
+        //! The bottom left corner of the domain
+        morph::vec<C, 2> origin() const { return this->offset - this->dx / C{2}; }
+
+        //! The index of the leaf that contains point p, or n() if p is outside the domain
+        std::size_t index_of (const morph::vec<C, 2> p) const
+        {
+            const morph::vec<C, 2> q = (p - this->offset + this->dx / C{2}) / this->dx; // in root cells
+            if (q[0] < C{0} || q[1] < C{0} || q[0] >= static_cast<C>(this->w) || q[1] >= static_cast<C>(this->h)) { return this->n(); }
+            for (unsigned int l = 0; l <= this->max_level; ++l) {
+                const C f = static_cast<C>(std::uint32_t{1} << l);
+                auto li = this->leaf.find (key (l, static_cast<std::uint32_t>(q[0] * f), static_cast<std::uint32_t>(q[1] * f)));
+                if (li != this->leaf.end()) { return li->second; }
+            }
+            return this->n();
+        }
+
+        /*!
+         * The neighbours of element i are nbr[j] for j in [nbr_start[i], nbr_start[i+1]).
+         * nbr_w[j] is the length of the face shared with neighbour j over the distance
+         * between the two centres, normal to the face; nbr_dist[j] is that distance.
+         * nbr_dir[j] is the side of the face (0 east, 1 north, 2 west, 3 south) and, where the
+         * two differ in level, nbr_lat[j] is the offset along the face of the centre of the
+         * finer from the centre of the coarser (otherwise 0).
+         */
+        std::vector<std::uint32_t> nbr_start;
+        std::vector<std::uint32_t> nbr;
+        std::vector<C> nbr_w;
+        std::vector<C> nbr_dist;
+        std::vector<std::uint8_t> nbr_dir;
+        std::vector<C> nbr_lat;
+
+        /*!
+         * The finite volume Laplacian of u: for each element, the sum over its faces of the
+         * flux nbr_w (u_neighbour - u) over its area. No flux crosses the domain boundary.
+         *
+         * Across a level boundary the centres of the fine and coarse elements are offset along
+         * the face, so the coarse value is first moved to the fine element's position along
+         * the face with the coarse element's gradient in that direction. Both elements use
+         * that one flux, so it is still conservative, and linear fields have zero Laplacian.
+         */
+        template <typename F>
+        void laplacian (const std::vector<F>& u, std::vector<F>& lap) const
+        {
+            if (u.size() != this->n()) { throw std::runtime_error ("QuadGrid::laplacian: u is the wrong size"); }
+            lap.resize (this->n());
+            const long long int nn = static_cast<long long int>(this->n());
+#pragma omp parallel for
+            for (long long int i = 0; i < nn; ++i) {
+                F s = F{0};
+                for (std::uint32_t j = this->nbr_start[i]; j < this->nbr_start[i + 1]; ++j) {
+                    const std::uint32_t k = this->nbr[j];
+                    F du = u[k] - u[i];
+                    if (this->nbr_lat[j] != C{0}) {
+                        // Along the face, the coarser element's value at the finer's position
+                        const unsigned int lat_axis = this->nbr_dir[j] & 1u ? 0u : 1u;
+                        const bool i_finer = this->cells[i].level > this->cells[k].level;
+                        const std::size_t coarse = i_finer ? k : static_cast<std::size_t>(i);
+                        const F shift = this->axis_gradient (u, coarse, lat_axis) * static_cast<F>(this->nbr_lat[j]);
+                        du += i_finer ? shift : -shift;
+                    }
+                    s += static_cast<F>(this->nbr_w[j]) * du;
+                }
+                lap[i] = s / static_cast<F>(this->area (i));
+            }
+        }
+
+        //! An estimate of |grad u| for each element: the largest difference quotient to a neighbour
+        template <typename F>
+        std::vector<F> gradient (const std::vector<F>& u) const
+        {
+            if (u.size() != this->n()) { throw std::runtime_error ("QuadGrid::gradient: u is the wrong size"); }
+            std::vector<F> g (this->n(), F{0});
+            for (std::size_t i = 0; i < this->n(); ++i) {
+                for (std::uint32_t j = this->nbr_start[i]; j < this->nbr_start[i + 1]; ++j) {
+                    g[i] = std::max (g[i], static_cast<F>(std::abs (u[this->nbr[j]] - u[i]) / static_cast<F>(this->nbr_dist[j])));
+                }
+            }
+            return g;
+        }
+
+        //! The integral of u over the domain
+        template <typename F>
+        F integral (const std::vector<F>& u) const
+        {
+            F s = F{0};
+            for (std::size_t i = 0; i < this->n(); ++i) { s += u[i] * static_cast<F>(this->area (i)); }
+            return s;
+        }
+
+        /*!
+         * Refine the elements whose indicator exceeds refine_above (up to max_level) and
+         * coarsen groups of four siblings whose indicators are all below coarsen_below, then
+         * refine any more elements needed to keep the mesh 2:1 balanced (a coarsening that
+         * would unbalance it is not made). Each of fields is carried across to the new
+         * elements. Returns true if the mesh changed; the element indices are then new.
+         */
+        template <typename F>
+        bool adapt (const std::vector<F>& indicator, const F refine_above, const F coarsen_below,
+                    const std::vector<std::vector<F>*>& fields = {})
+        {
+            const std::size_t n0 = this->n();
+            if (indicator.size() != n0) { throw std::runtime_error ("QuadGrid::adapt: indicator is the wrong size"); }
+            for (const std::vector<F>* f : fields) {
+                if (f == nullptr || f->size() != n0) { throw std::runtime_error ("QuadGrid::adapt: a field is the wrong size"); }
+            }
+
+            // Mark for refinement, and then mark any coarser neighbour of a marked element
+            // (which would otherwise be two levels coarser than its children) until none change
+            std::vector<char> refine (n0, 0);
+            std::vector<std::size_t> todo;
+            for (std::size_t i = 0; i < n0; ++i) {
+                if (indicator[i] > refine_above && this->cells[i].level < this->max_level) { refine[i] = 1; todo.push_back (i); }
+            }
+            while (!todo.empty()) {
+                const std::size_t i = todo.back();
+                todo.pop_back();
+                for (std::uint32_t j = this->nbr_start[i]; j < this->nbr_start[i + 1]; ++j) {
+                    const std::uint32_t k = this->nbr[j];
+                    if (!refine[k] && this->cells[k].level < this->cells[i].level) { refine[k] = 1; todo.push_back (k); }
+                }
+            }
+
+            // Coarsen groups of four leaf siblings, none being refined, none with a neighbour
+            // that is or will be finer than they are. coarsen[i] is 1 for the sibling at
+            // even (ix, iy), which stands for the group, and 2 for the others.
+            std::vector<char> coarsen (n0, 0);
+            for (std::size_t i = 0; i < n0; ++i) {
+                const cell& c = this->cells[i];
+                if (c.level == 0 || (c.ix & 1u) || (c.iy & 1u)) { continue; }
+                std::array<std::size_t, 4> sib;
+                bool ok = true;
+                for (unsigned int s = 0; s < 4 && ok; ++s) {
+                    auto si = this->leaf.find (key (c.level, c.ix + (s & 1u), c.iy + (s >> 1)));
+                    if (si == this->leaf.end()) { ok = false; break; }
+                    sib[s] = si->second;
+                    const std::size_t k = sib[s];
+                    if (refine[k] || !(indicator[k] < coarsen_below)) { ok = false; break; }
+                    for (std::uint32_t j = this->nbr_start[k]; j < this->nbr_start[k + 1]; ++j) {
+                        const std::uint32_t m = this->nbr[j];
+                        if (this->cells[m].level > c.level || (refine[m] && this->cells[m].level == c.level)) { ok = false; break; }
+                    }
+                }
+                if (!ok) { continue; }
+                for (unsigned int s = 0; s < 4; ++s) { coarsen[sib[s]] = s == 0 ? 1 : 2; }
+            }
+
+            std::size_t n_refine = 0;
+            std::size_t n_coarsen = 0;
+            for (std::size_t i = 0; i < n0; ++i) {
+                n_refine += refine[i] ? 1 : 0;
+                n_coarsen += coarsen[i] == 1 ? 1 : 0;
+            }
+            if (n_refine == 0 && n_coarsen == 0) { return false; }
+
+            // Build the new leaves and fields
+            std::vector<cell> nc;
+            nc.reserve (n0 + 3 * n_refine - 3 * n_coarsen);
+            std::vector<std::vector<F>> nf (fields.size());
+            for (auto& f : nf) { f.reserve (nc.capacity()); }
+            auto push = [&nc, &nf, &fields](const cell& c, const std::size_t src, const F* vals) {
+                nc.push_back (c);
+                for (std::size_t f = 0; f < fields.size(); ++f) { nf[f].push_back (vals ? vals[f] : (*fields[f])[src]); }
+            };
+            std::vector<F> mean (fields.size());
+            for (std::size_t i = 0; i < n0; ++i) {
+                const cell& c = this->cells[i];
+                if (refine[i]) {
+                    for (unsigned int s = 0; s < 4; ++s) {
+                        push ({ 2 * c.ix + (s & 1u), 2 * c.iy + (s >> 1), c.level + 1 }, i, nullptr);
+                    }
+                } else if (coarsen[i] == 1) {
+                    for (std::size_t f = 0; f < fields.size(); ++f) {
+                        F s = F{0};
+                        for (unsigned int q = 0; q < 4; ++q) { s += (*fields[f])[this->leaf.at (key (c.level, c.ix + (q & 1u), c.iy + (q >> 1)))]; }
+                        mean[f] = s / F{4};
+                    }
+                    push ({ c.ix / 2, c.iy / 2, c.level - 1 }, i, mean.data());
+                } else if (coarsen[i] == 0) {
+                    push (c, i, nullptr);
+                }
+            }
+            this->cells.swap (nc);
+            for (std::size_t f = 0; f < fields.size(); ++f) { fields[f]->swap (nf[f]); }
+            this->init();
+            return true;
+        }
+
+        //! The memory held by this QuadGrid
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("QuadGrid", sizeof (*this));
+            mu.add ("cells", this->cells);
+            mu.add ("neighbours", this->nbr_start).cpu += morph::heap_bytes (this->nbr)
+                + morph::heap_bytes (this->nbr_w) + morph::heap_bytes (this->nbr_dist)
+                + morph::heap_bytes (this->nbr_dir) + morph::heap_bytes (this->nbr_lat);
+            // An estimate of the hash table: a node per element and a bucket pointer
+            mu.add (morph::memory_usage ("leaf index", this->leaf.size() * (sizeof (std::pair<std::uint64_t, std::uint32_t>) + 2 * sizeof (void*))
+                                         + this->leaf.bucket_count() * sizeof (void*)));
+            return mu;
+        }
+
+    private:
+        static constexpr unsigned int max_levels_limit = 15;
+
+        /*!
+         * The gradient of u at element i along axis, fitted by least squares to the
+         * differences to its neighbours, so that it is exact for a linear u however the
+         * neighbours' centres are offset.
+         */
+        template <typename F>
+        F axis_gradient (const std::vector<F>& u, const std::size_t i, const unsigned int axis) const
+        {
+            const morph::vec<C, 2> ci = this->coord (i);
+            F sxx = F{0}, sxy = F{0}, syy = F{0}, sxu = F{0}, syu = F{0};
+            for (std::uint32_t j = this->nbr_start[i]; j < this->nbr_start[i + 1]; ++j) {
+                const morph::vec<C, 2> d = this->coord (this->nbr[j]) - ci;
+                const F dx_ = static_cast<F>(d[0]);
+                const F dy_ = static_cast<F>(d[1]);
+                const F du = u[this->nbr[j]] - u[i];
+                sxx += dx_ * dx_;
+                sxy += dx_ * dy_;
+                syy += dy_ * dy_;
+                sxu += dx_ * du;
+                syu += dy_ * du;
+            }
+            const F det = sxx * syy - sxy * sxy;
+            if (!(std::abs (det) > std::numeric_limits<F>::epsilon() * (sxx * syy))) { return F{0}; }
+            return axis == 0 ? (syy * sxu - sxy * syu) / det : (sxx * syu - sxy * sxu) / det;
+        }
+
+        unsigned int w = 1;
+        unsigned int h = 1;
+        morph::vec<C, 2> dx = { C{1}, C{1} };
+        morph::vec<C, 2> offset = { C{0}, C{0} };
+        unsigned int max_level = 4;
+
+        //! The leaves
+        std::vector<cell> cells;
+        //! The index into cells of each leaf, by key()
+        std::unordered_map<std::uint64_t, std::uint32_t> leaf;
+
+        static std::uint64_t key (const std::uint32_t l, const std::uint32_t ix, const std::uint32_t iy)
+        {
+            return (static_cast<std::uint64_t>(l) << 60) | (static_cast<std::uint64_t>(ix) << 30) | iy;
+        }
+
+        //! Index the leaves and find their neighbours
+        void init()
+        {
+            this->leaf.clear();
+            this->leaf.reserve (this->n());
+            for (std::size_t i = 0; i < this->n(); ++i) {
+                const cell& c = this->cells[i];
+                this->leaf[key (c.level, c.ix, c.iy)] = static_cast<std::uint32_t>(i);
+            }
+            this->nbr_start.assign (1, 0);
+            this->nbr_start.reserve (this->n() + 1);
+            this->nbr.clear();
+            this->nbr_w.clear();
+            this->nbr_dist.clear();
+            this->nbr_dir.clear();
+            this->nbr_lat.clear();
+            constexpr std::array<std::array<int, 2>, 4> dirs = {{ { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } }};
+            for (std::size_t i = 0; i < this->n(); ++i) {
+                const cell& c = this->cells[i];
+                const morph::vec<C, 2> si = this->size (i);
+                const morph::vec<C, 2> ci = this->coord (i);
+                const std::int64_t nx_max = static_cast<std::int64_t>(this->w) << c.level;
+                const std::int64_t ny_max = static_cast<std::int64_t>(this->h) << c.level;
+                for (std::uint8_t di = 0; di < 4; ++di) {
+                    const auto& d = dirs[di];
+                    const std::int64_t nx = static_cast<std::int64_t>(c.ix) + d[0];
+                    const std::int64_t ny = static_cast<std::int64_t>(c.iy) + d[1];
+                    if (nx < 0 || ny < 0 || nx >= nx_max || ny >= ny_max) { continue; } // domain boundary
+                    const std::uint32_t ux = static_cast<std::uint32_t>(nx);
+                    const std::uint32_t uy = static_cast<std::uint32_t>(ny);
+                    const unsigned int ax = d[0] != 0 ? 1 : 0; // the axis along the face
+                    auto add = [this, &si, &ci, &c, ax, di](const std::uint32_t k) {
+                        const morph::vec<C, 2> sk = this->size (k);
+                        const C dist = (si[1 - ax] + sk[1 - ax]) / C{2};
+                        this->nbr.push_back (k);
+                        this->nbr_dist.push_back (dist);
+                        this->nbr_w.push_back (std::min (si[ax], sk[ax]) / dist);
+                        this->nbr_dir.push_back (di);
+                        const C lat = ci[ax] - this->coord (k)[ax];
+                        this->nbr_lat.push_back (this->cells[k].level == c.level ? C{0} : (this->cells[k].level < c.level ? lat : -lat));
+                    };
+                    auto same = this->leaf.find (key (c.level, ux, uy));
+                    if (same != this->leaf.end()) { add (same->second); continue; }
+                    if (c.level > 0) {
+                        auto coarser = this->leaf.find (key (c.level - 1, ux / 2, uy / 2));
+                        if (coarser != this->leaf.end()) { add (coarser->second); continue; }
+                    }
+                    // Two finer leaves along the face
+                    for (std::uint32_t s = 0; s < 2; ++s) {
+                        const std::uint32_t fx = d[0] == 0 ? 2 * ux + s : 2 * ux + (d[0] < 0 ? 1 : 0);
+                        const std::uint32_t fy = d[1] == 0 ? 2 * uy + s : 2 * uy + (d[1] < 0 ? 1 : 0);
+                        auto finer = this->leaf.find (key (c.level + 1, fx, fy));
+                        if (finer == this->leaf.end()) { throw std::logic_error ("QuadGrid: The mesh is not 2:1 balanced"); }
+                        add (finer->second);
+                    }
+                }
+                this->nbr_start.push_back (static_cast<std::uint32_t>(this->nbr.size()));
+            }
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,127 @@
+/*!
+ * \file
+ *
+ * A visualizer for morph::QuadGrid, drawing each leaf of the grid as a rectangle of its own
+ * size, coloured (and optionally raised in z) according to its datum. After QuadGrid::adapt
+ * has changed the grid (and so the number of data), call reinit().
+ */
+#pragma once
+
+#include <morph/VisualDataModel.h>
+#include <morph/QuadGrid.h>
+#include <morph/ColourMap.h>
+#include <morph/colour.h>
+#include <morph/vec.h>
+#include <array>
+#include <vector>
+#include <stdexcept>
+
+namespace morph {
+
+    //! The template argument T is the type of the data which this QuadGridVisual will visualize
+    template <typename T, typename C = float, int glver = morph::gl::version_4_1>
+    class QuadGridVisual : public VisualDataModel<T, glver>
+    {
+    public:
+        QuadGridVisual (const morph::QuadGrid<C>* _qg, const vec<float> _offset)
+        {
+            this->mv_offset = _offset;
+            this->viewmatrix.translate (this->mv_offset);
+            // Flat by default; set zScale to raise the rectangles by their data
+            this->zScale.setParams (0, 0);
+            this->colourScale.do_autoscale = true;
+            this->qg = _qg;
+        }
+
+        //! For VisualDataModel::updateColourFromBuffer
+        unsigned int verticesPerDatum() const override { return 4u; }
+
+        void initializeVertices()
+        {
+            if (this->qg == nullptr) { throw std::runtime_error ("QuadGridVisual: The QuadGrid is nullptr"); }
+            if (this->scalarData == nullptr) { return; }
+            if (this->scalarData->size() != this->qg->n()) {
+                throw std::runtime_error ("QuadGridVisual: The data size does not match the QuadGrid (call reinit() after adapt())");
+            }
+            this->transformScalarData (this->zScale, this->dcopy);
+            this->transformScalarData (this->colourScale, this->dcolour);
+
+            const std::size_t n = this->qg->n();
+            this->vertexPositions.reserve (12 * n);
+            this->vertexNormals.reserve (12 * n);
+            this->vertexColors.reserve (12 * n);
+            this->indices.reserve (6 * n);
+            const float bz = this->show_borders ? this->border_z : 0.0f;
+            for (std::size_t i = 0; i < n; ++i) {
+                const morph::vec<C, 2> c = this->qg->coord (i);
+                const morph::vec<C, 2> hs = this->qg->size (i) / C{2};
+                // Inset each rectangle to leave its border showing, if required
+                const float inset = this->show_borders ? this->border_width : 0.0f;
+                const float x0 = static_cast<float>(c[0] - hs[0]) + inset;
+                const float x1 = static_cast<float>(c[0] + hs[0]) - inset;
+                const float y0 = static_cast<float>(c[1] - hs[1]) + inset;
+                const float y1 = static_cast<float>(c[1] + hs[1]) - inset;
+                const float z = this->dcopy[i] + bz;
+                std::array<float, 3> clr = this->cm.convert (this->dcolour[i]);
+                this->vertex_push (x0, y0, z, this->vertexPositions);
+                this->vertex_push (x1, y0, z, this->vertexPositions);
+                this->vertex_push (x1, y1, z, this->vertexPositions);
+                this->vertex_push (x0, y1, z, this->vertexPositions);
+                for (unsigned int v = 0; v < 4; ++v) {
+                    this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
+                    this->vertex_push (clr, this->vertexColors);
+                }
+                this->indices.push_back (this->idx);
+                this->indices.push_back (this->idx + 1);
+                this->indices.push_back (this->idx + 2);
+                this->indices.push_back (this->idx);
+                this->indices.push_back (this->idx + 2);
+                this->indices.push_back (this->idx + 3);
+                this->idx += 4;
+            }
+
+            if (this->show_borders) {
+                // One backing rectangle, which shows between the inset cells as their borders
+                const morph::vec<C, 2> e = this->qg->extent();
+                const morph::vec<C, 2> o = this->qg->origin();
+                const float x0 = static_cast<float>(o[0]);
+                const float y0 = static_cast<float>(o[1]);
+                const float x1 = x0 + static_cast<float>(e[0]);
+                const float y1 = y0 + static_cast<float>(e[1]);
+                this->vertex_push (x0, y0, 0.0f, this->vertexPositions);
+                this->vertex_push (x1, y0, 0.0f, this->vertexPositions);
+                this->vertex_push (x1, y1, 0.0f, this->vertexPositions);
+                this->vertex_push (x0, y1, 0.0f, this->vertexPositions);
+                for (unsigned int v = 0; v < 4; ++v) {
+                    this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
+                    this->vertex_push (this->border_colour, this->vertexColors);
+                }
+                this->indices.push_back (this->idx);
+                this->indices.push_back (this->idx + 1);
+                this->indices.push_back (this->idx + 2);
+                this->indices.push_back (this->idx);
+                this->indices.push_back (this->idx + 2);
+                this->indices.push_back (this->idx + 3);
+                this->idx += 4;
+            }
+        }
+
+        //! Show each leaf's outline, so that the refinement can be seen
+        bool show_borders = false;
+        //! The width of the outlines (half on each side of a face)
+        float border_width = 0.0005f;
+        //! The colour of the outlines
+        std::array<float, 3> border_colour = morph::colour::grey20;
+        //! How far above the backing rectangle the leaves are drawn when show_borders is set
+        float border_z = 0.0001f;
+
+    protected:
+        //! The QuadGrid to visualize
+        const morph::QuadGrid<C>* qg = nullptr;
+        //! A copy of the scalarData, scaled to be the z value of each rectangle
+        std::vector<float> dcopy;
+        //! A copy of the scalarData, scaled to be a colour value
+        std::vector<float> dcolour;
+    };
+
+} // namespace morph
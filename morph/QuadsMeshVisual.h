@@ -51,7 +51,7 @@ namespace morph {
                 ++qi;
             }
 
-            this->scalarData = _data;
+            this->setScalarData (_data);
 
             this->cm.setHue (_hue);
             this->cm.setType (_cmt);
@@ -84,9 +84,8 @@ namespace morph {
                 return;
             }
 
-            std::vector<Flt> dcopy = *(this->scalarData);
             this->colourScale.do_autoscale = true;
-            this->colourScale.transform ((*this->scalarData), dcopy);
+            this->transformScalarData (this->colourScale, this->dcopy);
 
             // I'm examining a set of vecs, which means I have to specify the compare
             // operation. See:
@@ -171,6 +170,8 @@ namespace morph {
         float radius = 0.05f;
         //! Tube number of segments
         int tseg = 8;
+        //! The colour-scaled scalarData, kept to reuse its memory on each update
+        std::vector<float> dcopy;
     };
 
 } // namespace morph
@@ -47,7 +47,7 @@ namespace morph {
                 ++qi;
             }
 
-            this->scalarData = _data;
+            this->setScalarData (_data);
 
             this->cm.setHue (_hue);
             this->cm.setType (_cmt);
@@ -79,9 +79,8 @@ namespace morph {
                 return;
             }
 
-            std::vector<Flt> dcopy = *(this->scalarData);
             this->colourScale.do_autoscale = true;
-            this->colourScale.transform ((*this->scalarData), dcopy);
+            this->transformScalarData (this->colourScale, this->dcopy);
 
             morph::vec<float> v0, v1, v2, v3;
             for (unsigned int qi = 0; qi < nquads; ++qi) {
@@ -181,6 +180,8 @@ namespace morph {
 
         //! We own the memory that will be displayed as dataCoords.
         std::unique_ptr<std::vector<vec<float>>> dataCoords_mem;
+        //! The colour-scaled scalarData, kept to reuse its memory on each update
+        std::vector<float> dcopy;
     };
 
 } // namespace morph
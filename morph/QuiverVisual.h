@@ -6,6 +6,8 @@
 #include <morph/scale.h>
 #include <morph/vec.h>
 #include <morph/vvec.h>
+#include <morph/quaternion.h>
+#include <morph/mathconst.h>
 #include <morph/colour.h>
 #include <morph/graphstyles.h>
 #include <iostream>
@@ -13,6 +15,8 @@
 #include <array>
 #include <algorithm>
 #include <functional>
+#include <limits>
+#include <cmath>
 
 namespace morph {
 
@@ -78,9 +82,7 @@ namespace morph {
                 }
             } else {
                 // We have scalarData, use these for the colours
-                vvec<Flt> sdata (this->scalarData->size());
-                std::copy (this->scalarData->begin(), this->scalarData->end(), sdata.begin());
-                this->colourScale.transform  (sdata, lengthcolours);
+                this->colourScale.transform (*this->scalarData, lengthcolours);
             }
 
             // Now scale the lengths for their size on screen. Do this with a linear or log scaling.
@@ -103,6 +105,18 @@ namespace morph {
             // normalized lengths multiplied by a user-settable quiver_length_gain.
             vvec<float> lfactor = nrmlzedlengths/dlengths * this->quiver_length_gain;
 
+            // In instanced mode, the model is a single unit arrow along the z axis, which each
+            // instance scales (by thickness and length), rotates and translates.
+            if (this->instanced) {
+                this->clearInstances();
+                std::array<float, 3> white = { 1.0f, 1.0f, 1.0f };
+                vec<float> cone_start_z = this->uz * (1.0f - this->quiver_arrowhead_prop);
+                this->computeTube (vec<float>{0,0,0}, cone_start_z, white, white, 1.0f, shapesides);
+                if (this->quiver_arrowhead_prop > 0.0f) {
+                    this->computeCone (cone_start_z, this->uz, 0.0f, white, 2.0f, shapesides);
+                }
+            }
+
             vec<Flt> half = { Flt{0.5}, Flt{0.5}, Flt{0.5} };
             vec<Flt> vectorData_i, halfquiv;
             vec<float> start, end, coords_i;
@@ -112,6 +126,10 @@ namespace morph {
                 coords_i = (*this->dataCoords)[i];
 
                 float len = nrmlzedlengths[i] * this->quiver_length_gain;
+                if (this->instanced && (std::isnan(dlengths[i]) || dlengths[i] == Flt{0})) {
+                    // Zero vector markers are not drawn in instanced mode
+                    continue;
+                }
                 if ((std::isnan(dlengths[i]) || dlengths[i] == Flt{0}) && this->show_zero_vectors) {
                     // NaNs denote zero vectors when the lengths have been log scaled.
                     this->computeSphere (coords_i, zero_vector_colour, this->zero_vector_marker_size * quiver_thickness_gain);
@@ -140,6 +158,13 @@ namespace morph {
                 // constant (set fixed_quiver_thickness > 0)
                 float quiv_thick = this->fixed_quiver_thickness ? this->fixed_quiver_thickness : len*quiver_thickness_gain;
 
+                if (this->instanced) {
+                    vec<float> arrow_line = end - start;
+                    this->addInstance (start, { quiv_thick, quiv_thick, arrow_line.length() },
+                                       this->rotation_from_uz (arrow_line), clr);
+                    continue;
+                }
+
                 // The right way to draw an arrow.
                 vec<float> arrow_line = end - start;
                 vec<float> cone_start = arrow_line.shorten (len*quiver_arrowhead_prop);
@@ -157,6 +182,23 @@ namespace morph {
             }
         }
 
+        //! The rotation that takes the unit z vector to the direction of v
+        static quaternion<float> rotation_from_uz (const vec<float>& v)
+        {
+            quaternion<float> q;
+            vec<float> d = v;
+            d.renormalize();
+            vec<float> _uz = { 0.0f, 0.0f, 1.0f };
+            float c = _uz.dot (d);
+            vec<float> axis = _uz.cross (d);
+            if (axis.length() > std::numeric_limits<float>::epsilon()) {
+                q.set_rotation (axis, std::acos (std::clamp (c, -1.0f, 1.0f)));
+            } else if (c < 0.0f) {
+                q.set_rotation (vec<float>{ 1.0f, 0.0f, 0.0f }, morph::mathconst<float>::pi);
+            }
+            return q;
+        }
+
         //! An enumerated type to say whether we draw quivers with coord at mid point; start point or end point
         QuiverGoes qgoes = QuiverGoes::FromCoord;
 
@@ -185,7 +227,8 @@ namespace morph {
         // If true, show a marker indicating the location of zero vectors
         bool show_zero_vectors = false;
 
-        // If false then omit the sphere drawn on the coordinate location
+        // If false then omit the sphere drawn on the coordinate location. The coordinate spheres
+        // are not drawn if this->instanced is true; nor are zero vector markers.
         bool show_coordinate_sphere = true;
 
         // User can choose a colour
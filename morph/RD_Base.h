@@ -6,12 +6,31 @@
 #define HEXGRID_COMPILE_LOAD_AND_SAVE 1
 #include <morph/HexGrid.h>
 #include <morph/HdfData.h>
+#include <morph/hdf_writer.h>
+#include <morph/implicit_diffusion.h>
+#include <morph/rk_integrator.h>
+#include <morph/grid_partition.h>
+#include <morph/step_profile.h>
+#include <morph/memory_usage.h>
+#include <morph/stored_field.h>
+#include <morph/threadpool.h>
+#include <morph/numa.h>
+#ifndef __WIN__
+# include <morph/shm_state.h>
+#endif
 #include <memory>
+#include <filesystem>
+#include <string>
+#include <utility>
 #include <sstream>
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <numeric>
 #include <iomanip>
 #include <cmath>
+#include <cstdint>
+#include <stdexcept>
 #include <hdf5.h>
 #include <morph/MorphDbg.h>
 
@@ -167,6 +186,58 @@ namespace morph {
             morph::tools::createDir (this->logpath);
         }
 
+        /*!
+         * If true, compute_laplace() and spacegrad2D() use the 'ghost stencil' instead of
+         * testing the HexGrid's d_ne, d_nne,... arrays for missing neighbours. Set before
+         * calling allocate() (or call build_ghost_stencil() afterwards).
+         */
+        bool ghost_stencil = false;
+
+        /*!
+         * How the nhex element vectors that allocate() and the resize_ functions make (and the
+         * integrator's stage buffers) are placed in memory. The default, first_touch, fills
+         * each new vector in parallel with the same division of hexes as the compute loops, so
+         * that on a multi-socket machine each thread's hexes are in its own node's memory.
+         * Set before calling allocate().
+         */
+        morph::numa::policy memory_policy = morph::numa::policy::first_touch;
+
+        /*!
+         * If true, allocate() pins each OpenMP thread to a CPU (see morph::numa::pin_threads),
+         * so that threads stay with the memory that they first touched.
+         */
+        bool pin_threads = false;
+
+        /*!
+         * Ghost stencil neighbour indices. These are copies of HexGrid::d_ne and friends
+         * in which each missing neighbour (-1 in d_ne) has been replaced by the index of
+         * the hex itself. A missing neighbour thus takes the value of the boundary hex,
+         * which is the zero-flux boundary condition that compute_laplace() applies, and
+         * the Laplacian becomes a 7-point gather with no branches.
+         */
+        std::vector<int> gs_ne;
+        std::vector<int> gs_nne;
+        std::vector<int> gs_nnw;
+        std::vector<int> gs_nw;
+        std::vector<int> gs_nsw;
+        std::vector<int> gs_nse;
+
+        /*!
+         * Ghost stencil coefficients for spacegrad2D(). The x gradient at hex h is
+         * gx_ne[h] f[gs_ne[h]] + gx_nw[h] f[gs_nw[h]] + gx_0[h] f[h]; the y gradient is
+         * formed in the same way from the nne, nnw, nsw and nse neighbours. The
+         * coefficients encode the choice of finite difference that spacegrad2D() makes
+         * according to which neighbours are present.
+         */
+        std::vector<Flt> gx_ne;
+        std::vector<Flt> gx_nw;
+        std::vector<Flt> gx_0;
+        std::vector<Flt> gy_nne;
+        std::vector<Flt> gy_nnw;
+        std::vector<Flt> gy_nsw;
+        std::vector<Flt> gy_nse;
+        std::vector<Flt> gy_0;
+
         /*!
          * Make the svgpath something that can be set by client code. If empty, then
          * set an elliptical boundary
@@ -192,6 +263,9 @@ namespace morph {
          */
         ~RD_Base() {}
 
+        //! Resize v to nhex elements, placing a new vector in memory according to memory_policy
+        void resize_field (std::vector<Flt>& v) { morph::numa::resize (v, this->nhex, Flt{0}, this->memory_policy); }
+
         /*!
          * Utility functions to resize/zero vector-vectors that hold N
          * different RD variables.
@@ -200,7 +274,7 @@ namespace morph {
         {
             vv.resize (N);
             for (unsigned int i=0; i<N; ++i) {
-                vv[i].resize (this->nhex, Flt{0});
+                this->resize_field (vv[i]);
             }
         }
         void zero_vector_vector (std::vector<std::vector<Flt> >& vv, unsigned int N)
@@ -244,7 +318,7 @@ namespace morph {
             for (unsigned int m=0; m<M; ++m) {
                 vvv[m].resize (N);
                 for (unsigned int i=0; i<N; ++i) {
-                    vvv[m][i].resize (this->nhex, Flt{0});
+                    this->resize_field (vvv[m][i]);
                 }
             }
         }
@@ -260,7 +334,7 @@ namespace morph {
         /*!
          * Resize/zero a variable that'll be nhex elements long
          */
-        void resize_vector_variable (std::vector<Flt>& v) { v.resize (this->nhex, Flt{0}); }
+        void resize_vector_variable (std::vector<Flt>& v) { this->resize_field (v); }
         void zero_vector_variable (std::vector<Flt>& v) { v.assign (this->nhex, Flt{0}); }
 
         /*!
@@ -292,8 +366,8 @@ namespace morph {
          */
         void resize_gradient_field (std::array<std::vector<Flt>, 2>& g)
         {
-            g[0].resize (this->nhex, Flt{0});
-            g[1].resize (this->nhex, Flt{0});
+            this->resize_field (g[0]);
+            this->resize_field (g[1]);
         }
         void zero_gradient_field (std::array<std::vector<Flt>, 2>& g)
         {
@@ -353,16 +427,26 @@ namespace morph {
          */
         void noiseify_vector_variable (std::vector<Flt>& v, Flt offset, Flt gain)
         {
-            morph::RandUniform<Flt> rng;
-            for (auto h : this->hg->hexen) {
+            auto t = this->profile.time ("noise");
+            // The counter-based engine lets the noise be generated in parallel
+            morph::RandUniform<Flt, morph::philox4x32> rng;
+            std::vector<Flt> noise (this->hg->num());
+            rng.get (noise);
+            const int nhex = static_cast<int>(this->hg->vhexen.size());
+#pragma omp parallel for
+            for (int i = 0; i < nhex; ++i) {
+                const Hex* h = this->hg->vhexen[i];
                 // boundarySigmoid. Jumps sharply (100, larger is
                 // sharper) over length scale 0.05 to 1. So if
                 // distance from boundary > 0.05, noise has normal
                 // value. Close to boundary, noise is less.
-                v[h.vi] = rng.get() * gain + offset;
-                if (h.distToBoundary > -0.5) { // It's possible that distToBoundary is set to -1.0
-                    Flt bSig = Flt{1} / ( Flt{1} + std::exp (-Flt{100}*(h.distToBoundary-this->boundaryFalloffDist)) );
-                    v[h.vi] = v[h.vi] * bSig;
+                // On a partitioned grid, v holds only this part's hexes
+                if (this->part && !this->part->owns (static_cast<int>(h->vi))) { continue; }
+                const unsigned int vi = this->part ? h->vi - this->part->begin : h->vi;
+                v[vi] = noise[i] * gain + offset;
+                if (h->distToBoundary > -0.5) { // It's possible that distToBoundary is set to -1.0
+                    Flt bSig = Flt{1} / ( Flt{1} + std::exp (-Flt{100}*(h->distToBoundary-this->boundaryFalloffDist)) );
+                    v[vi] = v[vi] * bSig;
                 }
             }
         }
@@ -375,6 +459,12 @@ namespace morph {
             // Create a HexGrid. 3 is the 'x span' which determines how
             // many hexes are initially created. 0 is the z co-ordinate for the HexGrid.
             this->hg = std::make_unique<HexGrid>(this->hextohex_d, this->hexspan, 0);
+            this->implicit_solver.reset();
+            this->integrator.clear_fields();
+            this->integrator.memory_policy = this->memory_policy;
+            if (this->pin_threads && !morph::numa::pin_threads()) {
+                throw std::runtime_error ("RD_Base::allocate: could not pin the threads to CPUs");
+            }
             DBG ("Initial hexagonal HexGrid has " << this->hg->num() << " hexes");
 
             // Either set a boundary using the svgpath, or set it as an ellipse
@@ -396,6 +486,233 @@ namespace morph {
             DBG ("HexGrid says d = " << this->d);
             this->set_v(this->hg->getv());
             DBG ("HexGrid says v = " << this->v);
+            this->part.reset();
+            this->halo.reset();
+            if (this->num_parts > 1) {
+                // Chunks of the Hilbert curve are compact patches with short boundaries
+                if (this->hg->hexorder == HexGridOrder::list) { this->hg->reorder (HexGridOrder::hilbert); }
+                this->part = std::make_unique<morph::grid_part> (morph::make_grid_part (*this->hg, this->num_parts, this->part_index));
+                this->nhex = this->part->num_owned();
+                this->build_part_stencil();
+            } else if (this->ghost_stencil) {
+                this->build_ghost_stencil();
+            }
+        }
+
+        /*!
+         * To split the model across processes, set num_parts and part_index before
+         * allocate(). allocate() then puts the HexGrid in Hilbert order (if it is in list
+         * order), cuts it into num_parts contiguous pieces and keeps piece part_index: nhex
+         * becomes the number of hexes in the piece and each state vector holds just those
+         * hexes (global indices part->begin to part->end - 1). After allocate(), set halo
+         * to an exchange that delivers the neighbouring pieces' values, such as a
+         * morph::mpi_halo_exchange. compute_laplace() then starts the exchange, works on the
+         * interior hexes while it proceeds, and finishes with the hexes next to other pieces.
+         *
+         * Every process still builds the whole HexGrid; the saving is in the state and the
+         * work. spacegrad2D() and the implicit solvers are not available on a piece.
+         */
+        int num_parts = 1;
+        int part_index = 0;
+        //! This process's piece of the HexGrid, if num_parts > 1
+        std::unique_ptr<morph::grid_part> part;
+        //! The halo exchange used by compute_laplace() on a piece
+        std::unique_ptr<morph::halo_exchange<Flt>> halo;
+
+        /*!
+         * Build the ghost stencil neighbour indices for this process's piece. Neighbours
+         * in other pieces have indices from nhex up, into the ghost values that halo
+         * delivers.
+         */
+        void build_part_stencil()
+        {
+            std::vector<int>* gs[6] = { &this->gs_ne, &this->gs_nne, &this->gs_nnw, &this->gs_nw, &this->gs_nsw, &this->gs_nse };
+            for (unsigned int l = 0; l < 6; ++l) {
+                gs[l]->resize (this->nhex);
+                for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+                    const int j = this->part->links[l][hi];
+                    (*gs[l])[hi] = j < 0 ? static_cast<int>(hi) : j;
+                }
+            }
+        }
+
+        /*!
+         * Populate the ghost stencil neighbour indices and gradient coefficients from
+         * the HexGrid. Requires that hg has been set up and that d and v are set. Called
+         * from allocate() if ghost_stencil is true.
+         */
+        void build_ghost_stencil()
+        {
+            this->gs_ne.resize (this->nhex);
+            this->gs_nne.resize (this->nhex);
+            this->gs_nnw.resize (this->nhex);
+            this->gs_nw.resize (this->nhex);
+            this->gs_nsw.resize (this->nhex);
+            this->gs_nse.resize (this->nhex);
+
+            this->gx_ne.assign (this->nhex, Flt{0});
+            this->gx_nw.assign (this->nhex, Flt{0});
+            this->gx_0.assign (this->nhex, Flt{0});
+            this->gy_nne.assign (this->nhex, Flt{0});
+            this->gy_nnw.assign (this->nhex, Flt{0});
+            this->gy_nsw.assign (this->nhex, Flt{0});
+            this->gy_nse.assign (this->nhex, Flt{0});
+            this->gy_0.assign (this->nhex, Flt{0});
+
+            for (unsigned int hi = 0; hi < this->nhex; ++hi) {
+                int ih = static_cast<int>(hi);
+                this->gs_ne[hi]  = IF_HAS_NE(hi,  NE(hi),  ih);
+                this->gs_nne[hi] = IF_HAS_NNE(hi, NNE(hi), ih);
+                this->gs_nnw[hi] = IF_HAS_NNW(hi, NNW(hi), ih);
+                this->gs_nw[hi]  = IF_HAS_NW(hi,  NW(hi),  ih);
+                this->gs_nsw[hi] = IF_HAS_NSW(hi, NSW(hi), ih);
+                this->gs_nse[hi] = IF_HAS_NSE(hi, NSE(hi), ih);
+
+                // x gradient coefficients, following the cases in spacegrad2D()
+                if (HAS_NE(hi) && HAS_NW(hi)) {
+                    this->gx_ne[hi] = this->oneover2d;
+                    this->gx_nw[hi] = -this->oneover2d;
+                } else if (HAS_NE(hi)) {
+                    this->gx_ne[hi] = this->oneoverd;
+                    this->gx_0[hi] = -this->oneoverd;
+                } else if (HAS_NW(hi)) {
+                    this->gx_0[hi] = this->oneoverd;
+                    this->gx_nw[hi] = -this->oneoverd;
+                }
+
+                // y gradient coefficients
+                if (HAS_NNW(hi) && HAS_NNE(hi) && HAS_NSW(hi) && HAS_NSE(hi)) {
+                    this->gy_nne[hi] = this->oneover4v;
+                    this->gy_nnw[hi] = this->oneover4v;
+                    this->gy_nse[hi] = -this->oneover4v;
+                    this->gy_nsw[hi] = -this->oneover4v;
+                } else if (HAS_NNW(hi) && HAS_NNE(hi)) {
+                    this->gy_nne[hi] = Flt{0.5} * this->oneoverv;
+                    this->gy_nnw[hi] = Flt{0.5} * this->oneoverv;
+                    this->gy_0[hi] = -this->oneoverv;
+                } else if (HAS_NSW(hi) && HAS_NSE(hi)) {
+                    this->gy_nse[hi] = Flt{-0.5} * this->oneoverv;
+                    this->gy_nsw[hi] = Flt{-0.5} * this->oneoverv;
+                    this->gy_0[hi] = this->oneoverv;
+                } else if (HAS_NNW(hi) && HAS_NSW(hi)) {
+                    this->gy_nnw[hi] = this->oneover2v;
+                    this->gy_nsw[hi] = -this->oneover2v;
+                } else if (HAS_NNE(hi) && HAS_NSE(hi)) {
+                    this->gy_nne[hi] = this->oneover2v;
+                    this->gy_nse[hi] = -this->oneover2v;
+                }
+            }
+        }
+
+        /*!
+         * Active region stepping, for models in which most of the domain sits at a steady
+         * state for most of a run (a travelling front, or growth from seeds). With
+         * active_region set, compute_laplace() and for_active() visit only the hexes in
+         * active_hexes and the rest stay frozen. Call active_update() at the end of each
+         * step(): the hexes in which any state vector registered with checkpoint_var()
+         * changed by more than active_tol in that step, with active_halo rings of their
+         * neighbours, are the active hexes of the next step. A frozen hex is so woken when
+         * a neighbour changes. active_hexes is kept in ascending order, which is the order
+         * of the HexGrid's d_ vectors, for locality.
+         *
+         * step() must update the state only through for_active() (or a loop over
+         * active_hexes). After changing the state outside step() (adding a seed, say) call
+         * active_reset(). Not available on a partitioned grid, and the integrator and the
+         * implicit solvers still update every hex.
+         */
+        bool active_region = false;
+        //! The change in a step above which a hex stays (or its neighbours become) active
+        Flt active_tol = Flt{1e-6};
+        //! The number of rings of neighbours about the changed hexes that are also stepped
+        unsigned int active_halo = 1;
+        //! The hexes to step, in ascending order
+        std::vector<unsigned int> active_hexes;
+
+        //! Make every hex active, and take the current state as the reference for active_update()
+        void active_reset()
+        {
+            if (this->part) { throw std::runtime_error ("RD_Base: active region stepping is not available on a partitioned grid"); }
+            // The ghost stencil gives the neighbours (and the Laplacian) with no branches
+            if (this->gs_ne.size() != this->nhex) { this->build_ghost_stencil(); }
+            this->active_hexes.resize (this->nhex);
+            std::iota (this->active_hexes.begin(), this->active_hexes.end(), 0u);
+            this->active_ref.clear();
+            for (std::vector<Flt>* v : this->active_state()) { this->active_ref.push_back (*v); }
+            if (this->active_ref.empty()) {
+                throw std::runtime_error ("RD_Base: active region stepping needs the state registered with checkpoint_var()");
+            }
+            this->active_mark.assign (this->nhex, 0);
+        }
+
+        /*!
+         * Call f (hi) for each active hex hi, or for every hex if active_region is false. The
+         * calls are made concurrently, so f must write only to hex hi's elements.
+         */
+        template <typename F>
+        void for_active (F&& f)
+        {
+            if (!this->active_region) {
+                morph::parallel_for (0u, this->nhex, f);
+                return;
+            }
+            if (this->active_ref.empty()) { this->active_reset(); }
+            const unsigned int* a = this->active_hexes.data();
+            const long long int na = static_cast<long long int>(this->active_hexes.size());
+            morph::parallel_for (0LL, na, [&f, a](long long int k) { f (a[k]); });
+        }
+
+        /*!
+         * Find the hexes to step next: those in which the state changed by more than
+         * active_tol since the last call, and active_halo rings of their neighbours.
+         */
+        void active_update()
+        {
+            if (!this->active_region) { return; }
+            const std::vector<std::vector<Flt>*> state = this->active_state();
+            if (this->active_ref.empty() || state.size() != this->active_ref.size()) {
+                this->active_reset();
+                return;
+            }
+            auto t = this->profile.time ("active_update");
+
+            // Only active hexes can have changed
+            const unsigned int* a = this->active_hexes.data();
+            const long long int na = static_cast<long long int>(this->active_hexes.size());
+            std::uint8_t* mark = this->active_mark.data();
+            morph::parallel_for (0LL, na, [this, &state, a, mark](long long int k) {
+                const unsigned int hi = a[k];
+                bool changed = false;
+                for (std::size_t si = 0; si < state.size(); ++si) {
+                    const Flt x = (*state[si])[hi];
+                    Flt& ref = this->active_ref[si][hi];
+                    if (std::abs (x - ref) > this->active_tol) { changed = true; }
+                    ref = x;
+                }
+                mark[hi] = changed ? 1 : 0;
+            });
+
+            // The changed hexes, then each ring of neighbours about them
+            std::vector<unsigned int>& next = this->active_next;
+            next.clear();
+            for (long long int k = 0; k < na; ++k) {
+                if (mark[a[k]]) { next.push_back (a[k]); }
+            }
+            const int* nb[6] = { this->gs_ne.data(), this->gs_nne.data(), this->gs_nnw.data(),
+                                 this->gs_nw.data(), this->gs_nsw.data(), this->gs_nse.data() };
+            std::size_t ring_begin = 0;
+            for (unsigned int r = 0; r < this->active_halo; ++r) {
+                const std::size_t ring_end = next.size();
+                for (std::size_t q = ring_begin; q < ring_end; ++q) {
+                    for (unsigned int l = 0; l < 6; ++l) {
+                        const unsigned int j = static_cast<unsigned int>(nb[l][next[q]]);
+                        if (!mark[j]) { mark[j] = 1; next.push_back (j); }
+                    }
+                }
+                ring_begin = ring_end;
+            }
+            for (unsigned int hi : next) { mark[hi] = 0; }
+            std::sort (next.begin(), next.end());
+            this->active_hexes.swap (next);
         }
 
         /*!
@@ -455,6 +772,243 @@ namespace morph {
          */
         virtual void save() {}
 
+        /*!
+         * Save a data frame in the background. Fill j with copies of (or, if they are
+         * finished with, moved) state vectors and the simulation can carry on while a
+         * writer thread saves them. The writer is started on first use; it blocks this
+         * call if more than snapshot_queue_bytes of frames are waiting to be written.
+         * For a long run, set j.append and j.tolerance to save each state vector as a
+         * compact series of frames (see hdf_series_writer) in one file.
+         */
+        void save_async (typename morph::hdf_writer<Flt>::job&& j)
+        {
+            auto t = this->profile.time ("save_async");
+            if (this->profile.enabled) {
+                std::size_t nbytes = 0;
+                for (const auto& ds : j.datasets) { nbytes += ds.second.size() * sizeof (Flt); }
+                this->profile.count ("bytes_saved", static_cast<double>(nbytes));
+            }
+            if (!this->snapshot_writer) {
+                this->snapshot_writer = std::make_unique<morph::hdf_writer<Flt>> (this->snapshot_queue_bytes);
+            }
+            this->snapshot_writer->push (std::move (j));
+        }
+
+        //! Block until every frame passed to save_async() is written
+        void save_wait() { if (this->snapshot_writer) { this->snapshot_writer->wait(); } }
+
+        //! The most frame data that save_async() will hold in memory
+        std::size_t snapshot_queue_bytes = std::size_t{256} << 20;
+
+    protected:
+        //! The background writer used by save_async()
+        std::unique_ptr<morph::hdf_writer<Flt>> snapshot_writer;
+
+    public:
+        /*!
+         * A generator for models that add noise in step(). Its state is saved in a
+         * checkpoint, so draw the noise from here if a restarted simulation is to
+         * repeat the original exactly.
+         */
+        morph::RandUniform<Flt, morph::philox4x32> rng;
+
+        /*!
+         * Register a state vector to be saved by save_checkpoint() and restored by
+         * load_checkpoint(). Call this in the derived class's allocate() or init() for
+         * each of the vectors that step() evolves. Only a reference is kept, so v must
+         * live as long as the model. Registering a name again replaces the entry.
+         */
+        void checkpoint_var (const std::string& name, std::vector<Flt>& v)
+        {
+            RD_Base<Flt>::set_checkpoint_entry (this->checkpoint_vecs, name, &v);
+        }
+        //! Register a vector of state vectors (such as the n or c of a multi-species model)
+        void checkpoint_var (const std::string& name, std::vector<std::vector<Flt>>& vv)
+        {
+            RD_Base<Flt>::set_checkpoint_entry (this->checkpoint_vecvecs, name, &vv);
+        }
+
+        /*!
+         * Save everything needed to resume the simulation to the file \a path. The file
+         * is written as path.tmp and then renamed, so a run that is killed while saving
+         * leaves the previous checkpoint intact.
+         */
+        void save_checkpoint (const std::string& path)
+        {
+            auto t = this->profile.time ("save_checkpoint");
+            // The snapshot writer's HDF5 calls must not overlap ours
+            this->save_wait();
+            const std::string tmppath = path + ".tmp";
+            {
+                HdfData data (tmppath);
+                this->write_checkpoint (data);
+            }
+            std::filesystem::rename (tmppath, path);
+        }
+
+        /*!
+         * Resume from a checkpoint made by save_checkpoint(). Call after allocate() and
+         * init() so that the HexGrid exists and the state vectors are registered. The
+         * following steps are then bit-identical to those of the run that saved it.
+         */
+        void load_checkpoint (const std::string& path)
+        {
+            this->save_wait();
+            HdfData data (path, FileAccess::ReadOnly);
+            this->read_checkpoint (data);
+        }
+
+        /*!
+         * Write stepCount, dt, the HexGrid's identityHash(), the state of rng and the
+         * vectors registered with checkpoint_var() into \a group of an open file.
+         * Override this (and read_checkpoint) to save any further state, calling the
+         * base version too.
+         */
+        virtual void write_checkpoint (HdfData& data, const std::string& group = "/checkpoint")
+        {
+            data.add_val ((group + "/stepCount").c_str(), this->stepCount);
+            data.add_val ((group + "/dt").c_str(), this->dt);
+            data.add_val ((group + "/grid_hash").c_str(), this->hg->identityHash());
+            data.add_string ((group + "/rng").c_str(), this->rng.get_state());
+            for (auto& [name, v] : this->checkpoint_vecs) {
+                data.add_contained_vals ((group + "/vars/" + name).c_str(), *v);
+            }
+            for (auto& [name, vv] : this->checkpoint_vecvecs) {
+                const std::string vvpath = group + "/vars/" + name + "/";
+                data.add_val ((vvpath + "n").c_str(), static_cast<unsigned int>(vv->size()));
+                for (unsigned int i = 0; i < vv->size(); ++i) {
+                    data.add_contained_vals ((vvpath + std::to_string (i)).c_str(), (*vv)[i]);
+                }
+            }
+        }
+
+        /*!
+         * Restore the state written by write_checkpoint(). Throws if the checkpoint was
+         * made on a different HexGrid or if a registered vector is missing or is of a
+         * different size.
+         */
+        virtual void read_checkpoint (HdfData& data, const std::string& group = "/checkpoint")
+        {
+            unsigned long long int grid_hash = 0;
+            data.read_val ((group + "/grid_hash").c_str(), grid_hash);
+            if (grid_hash != this->hg->identityHash()) {
+                throw std::runtime_error ("RD_Base::read_checkpoint: checkpoint was made on a different HexGrid");
+            }
+            auto read_var = [&data](const std::string& path, std::vector<Flt>& v) {
+                std::vector<Flt> tmp;
+                data.read_contained_vals (path.c_str(), tmp);
+                if (tmp.size() != v.size()) {
+                    std::stringstream ee;
+                    ee << "RD_Base::read_checkpoint: " << path << " has " << tmp.size()
+                       << " elements; expected " << v.size();
+                    throw std::runtime_error (ee.str());
+                }
+                v.swap (tmp);
+            };
+            for (auto& [name, v] : this->checkpoint_vecs) { read_var (group + "/vars/" + name, *v); }
+            for (auto& [name, vv] : this->checkpoint_vecvecs) {
+                const std::string vvpath = group + "/vars/" + name + "/";
+                unsigned int n = 0;
+                data.read_val ((vvpath + "n").c_str(), n);
+                if (n != vv->size()) {
+                    throw std::runtime_error ("RD_Base::read_checkpoint: " + vvpath + " holds a different number of vectors");
+                }
+                for (unsigned int i = 0; i < n; ++i) { read_var (vvpath + std::to_string (i), (*vv)[i]); }
+            }
+            Flt _dt = Flt{0};
+            data.read_val ((group + "/dt").c_str(), _dt);
+            this->set_dt (_dt);
+            data.read_val ((group + "/stepCount").c_str(), this->stepCount);
+            std::string rng_state;
+            data.read_string ((group + "/rng").c_str(), rng_state);
+            this->rng.set_state (rng_state);
+        }
+
+#ifndef __WIN__
+        /*!
+         * Publish the state vectors registered with checkpoint_var() to the POSIX shared
+         * memory object \a name, so that a viewer in another process can show the model as
+         * it runs (see morph::shm_reader). Call after allocate() and init(), then call
+         * live_publish() whenever there is a frame to show. The hex positions are published
+         * once, as the constant fields "x" and "y"; a vector of vectors vv is published as the
+         * fields "vv/0", "vv/1" and so on.
+         */
+        void live_open (const std::string& name, const unsigned int nslots = 3)
+        {
+            this->live = std::make_unique<morph::shm_publisher>(name);
+            this->live->nslots = nslots;
+            // The positions in the order of the state vectors (which, on a partitioned grid,
+            // hold only this part's hexes)
+            std::vector<float> x (this->nhex, 0.0f);
+            std::vector<float> y (this->nhex, 0.0f);
+            for (const Hex* h : this->hg->vhexen) {
+                if (this->part && !this->part->owns (static_cast<int>(h->vi))) { continue; }
+                const unsigned int vi = this->part ? h->vi - this->part->begin : h->vi;
+                x[vi] = h->x;
+                y[vi] = h->y;
+            }
+            this->live->add_constant ("x", x);
+            this->live->add_constant ("y", y);
+            for (auto& [vname, v] : this->checkpoint_vecs) { this->live->template add_field<Flt> (vname, v->size()); }
+            for (auto& [vname, vv] : this->checkpoint_vecvecs) {
+                for (unsigned int i = 0; i < vv->size(); ++i) {
+                    this->live->template add_field<Flt> (vname + "/" + std::to_string (i), (*vv)[i].size());
+                }
+            }
+            std::stringstream md;
+            md << "{\"hextohex_d\": " << this->hextohex_d << ", \"hexspan\": " << this->hexspan
+               << ", \"nhex\": " << this->nhex << ", \"dt\": " << this->dt << "}";
+            this->live->metadata = md.str();
+            this->live->open();
+        }
+
+        //! Copy the registered state vectors into a new frame for live_open()'s readers
+        void live_publish()
+        {
+            if (!this->live) { return; }
+            for (auto& [vname, v] : this->checkpoint_vecs) { this->live->set (vname, *v); }
+            for (auto& [vname, vv] : this->checkpoint_vecvecs) {
+                for (unsigned int i = 0; i < vv->size(); ++i) { this->live->set (vname + "/" + std::to_string (i), (*vv)[i]); }
+            }
+            this->live->commit (this->stepCount, static_cast<double>(this->stepCount) * static_cast<double>(this->dt));
+        }
+
+        //! The publisher made by live_open()
+        std::unique_ptr<morph::shm_publisher> live;
+#endif
+
+    protected:
+        //! The state vectors registered with checkpoint_var()
+        std::vector<std::pair<std::string, std::vector<Flt>*>> checkpoint_vecs;
+        std::vector<std::pair<std::string, std::vector<std::vector<Flt>>*>> checkpoint_vecvecs;
+
+        //! The state at the last active_update(), one vector per state vector in active_state() order
+        std::vector<std::vector<Flt>> active_ref;
+        //! Per hex flags used while active_update() builds the next active_hexes
+        std::vector<std::uint8_t> active_mark;
+        std::vector<unsigned int> active_next;
+
+        //! The state vectors registered with checkpoint_var(), for active region stepping
+        std::vector<std::vector<Flt>*> active_state()
+        {
+            std::vector<std::vector<Flt>*> st;
+            for (auto& e : this->checkpoint_vecs) { st.push_back (e.second); }
+            for (auto& e : this->checkpoint_vecvecs) {
+                for (std::vector<Flt>& v : *e.second) { st.push_back (&v); }
+            }
+            return st;
+        }
+
+        template <typename V>
+        static void set_checkpoint_entry (std::vector<std::pair<std::string, V*>>& entries, const std::string& name, V* v)
+        {
+            for (auto& e : entries) {
+                if (e.first == name) { e.second = v; return; }
+            }
+            entries.push_back ({ name, v });
+        }
+
+    public:
         /*!
          * Save position information
          */
@@ -591,6 +1145,89 @@ namespace morph {
          */
         virtual void step() = 0;
 
+        /*!
+         * Timers and counters for the parts of step(). RD_Base's compute_laplace(),
+         * spacegrad2D(), diffuse_implicit() and integrator steps, noise and saves time
+         * themselves when profile.enabled is set; time the parts of a step() with
+         * profile.time(). Off by default.
+         */
+        morph::step_profile profile;
+
+        /*!
+         * step(), timed as the section "step", after which the step's timings are added to
+         * profile's statistics. With the profile disabled, this is the same as step().
+         */
+        void step_profiled()
+        {
+            const bool active = this->active_region && !this->active_ref.empty();
+            const std::size_t n_updated = active ? this->active_hexes.size() : this->nhex;
+            {
+                auto t = this->profile.time ("step");
+                this->step();
+            }
+            this->profile.count ("hexes_updated", static_cast<double>(n_updated));
+            this->profile.end_step();
+        }
+
+        /*!
+         * Write profile's statistics to the HDF5 file path, under /profile/sections/<name>
+         * and /profile/counters/<name>, after any saves still in progress.
+         */
+        void save_profile (const std::string& path)
+        {
+            this->save_wait();
+            HdfData data (path);
+            data.add_val ("/profile/steps", static_cast<unsigned long long int>(this->profile.steps()));
+            for (const auto& s : this->profile.sections()) {
+                const std::string g = "/profile/sections/" + s.name;
+                data.add_val ((g + "/calls").c_str(), static_cast<unsigned long long int>(s.calls));
+                data.add_val ((g + "/steps").c_str(), static_cast<unsigned long long int>(s.ms.count()));
+                data.add_val ((g + "/mean_ms").c_str(), s.ms.mean());
+                data.add_val ((g + "/std_ms").c_str(), s.ms.std());
+                data.add_val ((g + "/min_ms").c_str(), s.ms.count() > 0 ? s.ms.min() : 0.0);
+                data.add_val ((g + "/max_ms").c_str(), s.ms.count() > 0 ? s.ms.max() : 0.0);
+                data.add_val ((g + "/p50_ms").c_str(), s.p50.get());
+                data.add_val ((g + "/p90_ms").c_str(), s.p90.get());
+                data.add_val ((g + "/p99_ms").c_str(), s.p99.get());
+            }
+            for (const auto& c : this->profile.counters()) {
+                const std::string g = "/profile/counters/" + c.name;
+                data.add_val ((g + "/total").c_str(), c.total);
+                data.add_val ((g + "/mean_per_step").c_str(), c.per_step.mean());
+            }
+        }
+
+        /*!
+         * The memory held by the model: its HexGrid, the state vectors registered with
+         * checkpoint_var(), the ghost stencil, the integrator's stage buffers and the implicit
+         * solver. A derived model should override this to add the vectors that it has not
+         * registered (its Laplacians, gradients and parameters), as parts of the result.
+         */
+        virtual morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("RD_Base");
+            if (this->hg) { mu.add (this->hg->memory_usage()); }
+            morph::memory_usage& vars = mu.add (morph::memory_usage ("vars"));
+            for (const auto& [name, v] : this->checkpoint_vecs) { vars.add (name, *v); }
+            for (const auto& [name, vv] : this->checkpoint_vecvecs) { vars.add (name, *vv); }
+            if (!this->gs_ne.empty() || !this->gx_ne.empty()) {
+                morph::memory_usage& gs = mu.add (morph::memory_usage ("ghost stencil"));
+                gs.cpu = morph::heap_bytes (this->gs_ne) + morph::heap_bytes (this->gs_nne) + morph::heap_bytes (this->gs_nnw)
+                + morph::heap_bytes (this->gs_nw) + morph::heap_bytes (this->gs_nsw) + morph::heap_bytes (this->gs_nse)
+                + morph::heap_bytes (this->gx_ne) + morph::heap_bytes (this->gx_nw) + morph::heap_bytes (this->gx_0)
+                + morph::heap_bytes (this->gy_nne) + morph::heap_bytes (this->gy_nnw) + morph::heap_bytes (this->gy_nsw)
+                + morph::heap_bytes (this->gy_nse) + morph::heap_bytes (this->gy_0);
+            }
+            if (!this->active_ref.empty()) {
+                morph::memory_usage& ar = mu.add (morph::memory_usage ("active region"));
+                ar.cpu = morph::heap_bytes (this->active_ref) + morph::heap_bytes (this->active_mark)
+                + morph::heap_bytes (this->active_hexes) + morph::heap_bytes (this->active_next);
+            }
+            mu.add (this->integrator.memory_usage());
+            if (this->implicit_solver) { mu.add (this->implicit_solver->memory_usage()); }
+            return mu;
+        }
+
         /*!
          * 2D spatial integration of the function f. Result placed in gradf.
          *
@@ -599,6 +1236,13 @@ namespace morph {
          */
         void spacegrad2D (std::vector<Flt>& f, std::array<std::vector<Flt>, 2>& gradf) {
 
+            if (this->part) { throw std::runtime_error ("RD_Base::spacegrad2D: not available on a partitioned grid"); }
+            auto t = this->profile.time ("spacegrad2D");
+            if (this->ghost_stencil) {
+                this->spacegrad2D_ghost (f, gradf);
+                return;
+            }
+
             // Note - East is positive x; North is positive y.
 #pragma omp parallel for schedule(static)
             for (unsigned int hi=0; hi<this->nhex; ++hi) {
@@ -636,11 +1280,162 @@ namespace morph {
             }
         }
 
+        /*!
+         * The ghost stencil version of spacegrad2D(). Each gradient component is a
+         * weighted sum over a fixed set of neighbours, with no branches.
+         */
+        void spacegrad2D_ghost (const std::vector<Flt>& f, std::array<std::vector<Flt>, 2>& gradf)
+        {
+            const int* ne = this->gs_ne.data();
+            const int* nne = this->gs_nne.data();
+            const int* nnw = this->gs_nnw.data();
+            const int* nw = this->gs_nw.data();
+            const int* nsw = this->gs_nsw.data();
+            const int* nse = this->gs_nse.data();
+            const Flt* _f = f.data();
+            Flt* gx = gradf[0].data();
+            Flt* gy = gradf[1].data();
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi=0; hi<this->nhex; ++hi) {
+                gx[hi] = this->gx_ne[hi] * _f[ne[hi]] + this->gx_nw[hi] * _f[nw[hi]] + this->gx_0[hi] * _f[hi];
+                gy[hi] = this->gy_nne[hi] * _f[nne[hi]] + this->gy_nnw[hi] * _f[nnw[hi]]
+                + this->gy_nsw[hi] * _f[nsw[hi]] + this->gy_nse[hi] * _f[nse[hi]] + this->gy_0[hi] * _f[hi];
+            }
+        }
+
+        /*!
+         * The ghost stencil version of compute_laplace(). A pure 7-point gather which
+         * gives results identical to the branching version.
+         */
+        void compute_laplace_ghost (const std::vector<Flt>& F, std::vector<Flt>& lapF)
+        {
+            Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+            const int* ne = this->gs_ne.data();
+            const int* nne = this->gs_nne.data();
+            const int* nnw = this->gs_nnw.data();
+            const int* nw = this->gs_nw.data();
+            const int* nsw = this->gs_nsw.data();
+            const int* nse = this->gs_nse.data();
+            const Flt* _F = F.data();
+            Flt* _lapF = lapF.data();
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi=0; hi<this->nhex; ++hi) {
+                Flt thesum = Flt{-6} * _F[hi];
+                thesum += _F[ne[hi]];
+                thesum += _F[nne[hi]];
+                thesum += _F[nnw[hi]];
+                thesum += _F[nw[hi]];
+                thesum += _F[nsw[hi]];
+                thesum += _F[nse[hi]];
+                _lapF[hi] = norm * thesum;
+            }
+        }
+
+        /*!
+         * The active region version of compute_laplace(): the ghost stencil gather over the
+         * active hexes only. lapF is left as it was at the frozen hexes.
+         */
+        void compute_laplace_active (const std::vector<Flt>& F, std::vector<Flt>& lapF)
+        {
+            if (this->active_ref.empty()) { this->active_reset(); }
+            Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+            const int* ne = this->gs_ne.data();
+            const int* nne = this->gs_nne.data();
+            const int* nnw = this->gs_nnw.data();
+            const int* nw = this->gs_nw.data();
+            const int* nsw = this->gs_nsw.data();
+            const int* nse = this->gs_nse.data();
+            const Flt* _F = F.data();
+            Flt* _lapF = lapF.data();
+            const unsigned int* a = this->active_hexes.data();
+            const long long int na = static_cast<long long int>(this->active_hexes.size());
+#pragma omp parallel for schedule(static)
+            for (long long int k = 0; k < na; ++k) {
+                const unsigned int hi = a[k];
+                Flt thesum = Flt{-6} * _F[hi];
+                thesum += _F[ne[hi]];
+                thesum += _F[nne[hi]];
+                thesum += _F[nnw[hi]];
+                thesum += _F[nw[hi]];
+                thesum += _F[nsw[hi]];
+                thesum += _F[nse[hi]];
+                _lapF[hi] = norm * thesum;
+            }
+        }
+
+        /*!
+         * The version of compute_laplace() for a piece of a partitioned grid. The interior
+         * hexes are computed while the halo exchange is in flight. The sums are in the same
+         * order as in compute_laplace(), so the results are identical to those of an
+         * undivided run.
+         */
+        void compute_laplace_part (const std::vector<Flt>& F, std::vector<Flt>& lapF)
+        {
+            if (!this->halo) { throw std::runtime_error ("RD_Base::compute_laplace: a partitioned model needs a halo exchange"); }
+            Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+            const int* ne = this->gs_ne.data();
+            const int* nne = this->gs_nne.data();
+            const int* nnw = this->gs_nnw.data();
+            const int* nw = this->gs_nw.data();
+            const int* nsw = this->gs_nsw.data();
+            const int* nse = this->gs_nse.data();
+            this->halo->start (F);
+
+            const int* in = this->part->interior.data();
+            const int nin = static_cast<int>(this->part->interior.size());
+#pragma omp parallel for schedule(static)
+            for (int k = 0; k < nin; ++k) {
+                const int hi = in[k];
+                Flt thesum = Flt{-6} * F[hi];
+                thesum += F[ne[hi]];
+                thesum += F[nne[hi]];
+                thesum += F[nnw[hi]];
+                thesum += F[nw[hi]];
+                thesum += F[nsw[hi]];
+                thesum += F[nse[hi]];
+                lapF[hi] = norm * thesum;
+            }
+
+            const std::vector<Flt>& ghost = this->halo->finish();
+            const int no = static_cast<int>(this->nhex);
+            auto val = [&F, &ghost, no](const int j) { return j < no ? F[j] : ghost[j - no]; };
+            const int* bd = this->part->boundary.data();
+            const int nbd = static_cast<int>(this->part->boundary.size());
+#pragma omp parallel for schedule(static)
+            for (int k = 0; k < nbd; ++k) {
+                const int hi = bd[k];
+                Flt thesum = Flt{-6} * F[hi];
+                thesum += val (ne[hi]);
+                thesum += val (nne[hi]);
+                thesum += val (nnw[hi]);
+                thesum += val (nw[hi]);
+                thesum += val (nsw[hi]);
+                thesum += val (nse[hi]);
+                lapF[hi] = norm * thesum;
+            }
+        }
+
         /*!
          * Compute laplacian of scalar field F, with result placed in lapF.
          */
         virtual void compute_laplace (const std::vector<Flt>& F, std::vector<Flt>& lapF) {
 
+            auto t = this->profile.time ("compute_laplace");
+            if (this->part) {
+                this->compute_laplace_part (F, lapF);
+                return;
+            }
+
+            if (this->active_region) {
+                this->compute_laplace_active (F, lapF);
+                return;
+            }
+
+            if (this->ghost_stencil) {
+                this->compute_laplace_ghost (F, lapF);
+                return;
+            }
+
             Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
 
 #pragma omp parallel for schedule(static)
@@ -685,6 +1480,124 @@ namespace morph {
             }
         }
 
+        /*!
+         * The Laplacian of a field held in reduced precision (see morph::stored_field), such
+         * as bfloat16. Each value is converted to Flt as it is loaded, with the sums in Flt,
+         * so the result is that of compute_laplace() on F.load(), but only the narrow values
+         * are read. Uses the ghost stencil, which is built if necessary. Not available on a
+         * partitioned grid, and it steps every hex even with active_region set.
+         */
+        template <typename S>
+        void compute_laplace (const morph::stored_field<S, Flt>& F, std::vector<Flt>& lapF)
+        {
+            if (this->part) { throw std::runtime_error ("RD_Base::compute_laplace: stored fields are not available on a partitioned grid"); }
+            if (F.size() != this->nhex) { throw std::runtime_error ("RD_Base::compute_laplace: the stored field is the wrong size"); }
+            auto t = this->profile.time ("compute_laplace");
+            if (this->gs_ne.size() != this->nhex) { this->build_ghost_stencil(); }
+            lapF.resize (this->nhex);
+            Flt norm  = Flt{2} / (Flt{3.0} * this->d * this->d);
+            const int* ne = this->gs_ne.data();
+            const int* nne = this->gs_nne.data();
+            const int* nnw = this->gs_nnw.data();
+            const int* nw = this->gs_nw.data();
+            const int* nsw = this->gs_nsw.data();
+            const int* nse = this->gs_nse.data();
+            const S* _F = F.data.data();
+            Flt* _lapF = lapF.data();
+            auto ld = [](const S s) { return morph::storage_conv<S>::template load<Flt> (s); };
+#pragma omp parallel for schedule(static)
+            for (unsigned int hi=0; hi<this->nhex; ++hi) {
+                Flt thesum = Flt{-6} * ld (_F[hi]);
+                thesum += ld (_F[ne[hi]]);
+                thesum += ld (_F[nne[hi]]);
+                thesum += ld (_F[nnw[hi]]);
+                thesum += ld (_F[nw[hi]]);
+                thesum += ld (_F[nsw[hi]]);
+                thesum += ld (_F[nse[hi]]);
+                _lapF[hi] = norm * thesum;
+            }
+        }
+
+        /*!
+         * Replace F with the result of a backward Euler step, of length dt, of diffusion
+         * with coefficient D: F <- (I - D dt Del^2)^-1 F, with the same zero-flux boundary
+         * as compute_laplace(). This is stable for any dt, so in a step() that treats
+         * diffusion implicitly (and the reaction terms explicitly), dt is limited by the
+         * reactions alone rather than by the CFL condition dt < d^2 / (3 D). Returns the
+         * number of conjugate gradient iterations.
+         */
+        unsigned int diffuse_implicit (std::vector<Flt>& F, const Flt D)
+        {
+            auto t = this->profile.time ("diffuse_implicit");
+            const unsigned int iters = this->get_implicit_solver().diffuse (F, D, this->dt);
+            this->profile.count ("cg_iterations", static_cast<double>(iters));
+            return iters;
+        }
+
+        //! The solver used by diffuse_implicit() and step_imex(). Created on first use; set its tolerance as required.
+        std::unique_ptr<morph::diffusion_cg<Flt>> implicit_solver;
+
+        //! Return implicit_solver, creating it if necessary
+        morph::diffusion_cg<Flt>& get_implicit_solver()
+        {
+            if (this->part) { throw std::runtime_error ("RD_Base: the implicit solvers are not available on a partitioned grid"); }
+            if (!this->implicit_solver || this->implicit_solver->size() != this->nhex) {
+                this->implicit_solver = std::make_unique<morph::diffusion_cg<Flt>> (*this->hg);
+            }
+            return *this->implicit_solver;
+        }
+
+        /*!
+         * The integrator used by step_rk4(), step_rk45() and step_imex(). Register the
+         * state vectors that step() evolves with integrate_var(), in allocate(). Its stage
+         * buffers are allocated on the first step and then reused.
+         */
+        morph::rk_integrator<Flt> integrator;
+
+        //! Register a state vector with the integrator. Returns its index in the state passed to the derivative function.
+        std::size_t integrate_var (std::vector<Flt>& v) { return this->integrator.add_field (v); }
+
+        /*!
+         * Advance the registered state vectors by one 4th order Runge-Kutta step of size
+         * dt. f (t, y, dydt) must write the time derivative of each state vector *y[i] into
+         * dydt[i] (see morph::rk_integrator).
+         */
+        template <typename F>
+        void step_rk4 (F&& f)
+        {
+            auto t = this->profile.time ("integrate");
+            this->integrator.rk4 (f, this->dt);
+        }
+
+        /*!
+         * Advance the registered state vectors by one adaptive Dormand-Prince step, which
+         * starts at size dt and is shrunk until it meets integrator.atol and
+         * integrator.rtol. dt is then set to the suggested size of the next step. Returns
+         * the size of the step taken.
+         */
+        template <typename F>
+        Flt step_rk45 (F&& f)
+        {
+            auto t = this->profile.time ("integrate");
+            Flt _dt = this->dt;
+            const Flt taken = this->integrator.rk45 (f, _dt);
+            this->set_dt (_dt);
+            return taken;
+        }
+
+        /*!
+         * Advance the registered state vectors by one step of size dt in which diffusion,
+         * with coefficient D[i] for state vector i, is treated implicitly and f, which
+         * should leave out the diffusion terms, by rk4. dt is limited by the reaction terms
+         * alone.
+         */
+        template <typename F>
+        void step_imex (F&& f, const std::vector<Flt>& D)
+        {
+            auto t = this->profile.time ("integrate");
+            this->integrator.imex (f, this->get_implicit_solver(), D, this->dt);
+        }
+
     }; // RD_Base
 
 } // namespace morph
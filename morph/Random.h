@@ -6,9 +6,18 @@
 #include <type_traits>
 #include <string>
 #include <ostream>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <cmath>
 #include <memory>
+#include <concepts>
+#include <atomic>
+#include <morph/mathconst.h>
+#include <morph/constexpr_math.h>
 
 /*!
  * \file Random.h
@@ -38,9 +47,11 @@
  *
  * std::knuth_b: A shuffle order engine. Quite slow.
  *
- * I've wrapped a selection of distributions, including normal, lognormal, poisson and
- * uniform. Copy the classes here to add additional ones that you might need from the
- * full list: https://en.cppreference.com/w/cpp/numeric/random (such as weibull or
+ * I've wrapped a selection of distributions, including normal, lognormal, exponential,
+ * poisson and uniform. The normal, lognormal and exponential classes use morph::ziggurat
+ * rather than the std:: distributions, which are slower and give different numbers with
+ * different standard libraries. Copy the classes here to add additional ones that you might
+ * need from the full list: https://en.cppreference.com/w/cpp/numeric/random (such as weibull or
  * exponential).
  *
  * See tests/testRandom.cpp for a variety of usage examples. Here is a single, simple
@@ -57,6 +68,17 @@
  * block. Xoroshiro/Xoshiro/Xorshift and SplitMix64. These don't appear to be in the c++
  * standard as yet, but they're short and could probably be implemented easily here,
  * another day.
+ *
+ * For parallel code, there is morph::philox4x32, a counter-based engine. Its nth output is a
+ * function of (seed, stream, n) alone, so it can jump to any point in its sequence, and the
+ * bulk fills RandUniform::get(C&) and RandNormal::get(C&) compute the elements of a container
+ * in parallel with the same result for any number of threads:
+ *
+ * \code
+ * morph::RandUniform<float, morph::philox4x32> rng (42);
+ * morph::vvec<float> noise (1000000);
+ * rng.get (noise); // OpenMP parallel; reproducible for seed 42
+ * \endcode
  */
 
 namespace morph {
@@ -66,6 +88,513 @@ namespace morph {
     // de-duplicated. max(), min() and get() methods all need the dist member
     // attribute, so each one has to be written out in each wrapper class. So it goes.
 
+    /*!
+     * The Philox4x32-10 counter-based random number engine (Salmon et al., "Parallel random
+     * numbers: as easy as 1, 2, 3", SC11, 2011). Each 128 bit counter value is mapped to four 32
+     * bit outputs by ten rounds of multiply/xor under a 64 bit key made from the seed. The
+     * counter is made of a 64 bit block number and a 64 bit stream number, so that one seed gives
+     * 2^64 independent streams.
+     *
+     * The engine state is just the key, the counter and a 4 word buffer, and block(n) gives the
+     * outputs for any block number without changing the state. This meets the
+     * UniformRandomBitGenerator requirements, so it can be the E parameter of RandUniform,
+     * RandNormal and the others.
+     */
+    class philox4x32
+    {
+    public:
+        using result_type = std::uint32_t;
+        static constexpr std::uint64_t default_seed = 20111115u;
+
+        philox4x32() { this->seed (default_seed); }
+        explicit philox4x32 (const std::uint64_t _seed, const std::uint64_t _stream = 0)
+        {
+            this->seed (_seed);
+            this->stream = _stream;
+        }
+
+        static constexpr result_type min() { return 0u; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        //! Set the key from _seed and return to the start of the current stream
+        void seed (const std::uint64_t _seed)
+        {
+            this->key = { static_cast<std::uint32_t>(_seed), static_cast<std::uint32_t>(_seed >> 32) };
+            this->set_counter (0);
+        }
+
+        //! Choose the stream. This is how to split one seed between many independent generators.
+        void set_stream (const std::uint64_t _stream)
+        {
+            this->stream = _stream;
+            this->set_counter (0);
+        }
+        std::uint64_t get_stream() const { return this->stream; }
+
+        //! Jump to the start of block number ctr of the current stream
+        void set_counter (const std::uint64_t ctr)
+        {
+            this->ctr = ctr;
+            this->bufidx = 4;
+        }
+        //! The number of the next block the engine will generate
+        std::uint64_t get_counter() const { return this->ctr; }
+
+        //! The next 32 random bits
+        result_type operator()()
+        {
+            if (this->bufidx == 4) {
+                this->buf = this->block (this->ctr++);
+                this->bufidx = 0;
+            }
+            return this->buf[this->bufidx++];
+        }
+
+        //! Skip z outputs in O(1)
+        void discard (unsigned long long z)
+        {
+            while (z > 0 && this->bufidx < 4) { ++this->bufidx; --z; }
+            this->ctr += z / 4;
+            z %= 4;
+            if (z > 0) {
+                this->buf = this->block (this->ctr++);
+                this->bufidx = static_cast<unsigned int>(z);
+            }
+        }
+
+        /*!
+         * Reserve nblocks whole blocks for the caller to compute with block(), which may be done
+         * in any order and in parallel. Any outputs left in the buffer are dropped. Returns the
+         * number of the first reserved block.
+         */
+        std::uint64_t reserve (const std::uint64_t nblocks)
+        {
+            const std::uint64_t first = this->ctr;
+            this->ctr += nblocks;
+            this->bufidx = 4;
+            return first;
+        }
+
+        //! The four outputs for block number n of the current stream
+        std::array<std::uint32_t, 4> block (const std::uint64_t n) const
+        {
+            std::uint32_t c0 = static_cast<std::uint32_t>(n);
+            std::uint32_t c1 = static_cast<std::uint32_t>(n >> 32);
+            std::uint32_t c2 = static_cast<std::uint32_t>(this->stream);
+            std::uint32_t c3 = static_cast<std::uint32_t>(this->stream >> 32);
+            std::uint32_t k0 = this->key[0];
+            std::uint32_t k1 = this->key[1];
+            for (int r = 0; r < 10; ++r) {
+                const std::uint64_t p0 = static_cast<std::uint64_t>(0xd2511f53u) * c0;
+                const std::uint64_t p1 = static_cast<std::uint64_t>(0xcd9e8d57u) * c2;
+                const std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+                const std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+                c1 = static_cast<std::uint32_t>(p1);
+                c3 = static_cast<std::uint32_t>(p0);
+                c0 = n0;
+                c2 = n2;
+                k0 += 0x9e3779b9u;
+                k1 += 0xbb67ae85u;
+            }
+            return { c0, c1, c2, c3 };
+        }
+
+        //! Convert 64 random bits to a value of floating point type F in [0,1)
+        template <typename F>
+        static F to_unit (const std::uint64_t x)
+        {
+            if constexpr (std::is_same<F, float>::value) {
+                return static_cast<float>(x >> 40) * 0x1.0p-24f;
+            } else {
+                return static_cast<F>(static_cast<double>(x >> 11) * 0x1.0p-53);
+            }
+        }
+
+        //! The 64 bit words (w = 0 or 1) of a block
+        static std::uint64_t word64 (const std::array<std::uint32_t, 4>& b, const unsigned int w)
+        {
+            return static_cast<std::uint64_t>(b[2 * w]) << 32 | b[2 * w + 1];
+        }
+
+        //! Write the engine state as text, in the manner of the standard library engines
+        friend std::ostream& operator<< (std::ostream& os, const philox4x32& e)
+        {
+            os << e.key[0] << ' ' << e.key[1] << ' ' << e.stream << ' ' << e.ctr;
+            for (auto b : e.buf) { os << ' ' << b; }
+            return os << ' ' << e.bufidx;
+        }
+        //! Read a state written by operator<<. On failure e is left unchanged.
+        friend std::istream& operator>> (std::istream& is, philox4x32& e)
+        {
+            philox4x32 t;
+            is >> t.key[0] >> t.key[1] >> t.stream >> t.ctr;
+            for (auto& b : t.buf) { is >> b; }
+            is >> t.bufidx;
+            if (t.bufidx > 4) { is.setstate (std::ios::failbit); }
+            if (!is.fail()) { e = t; }
+            return is;
+        }
+
+    private:
+        std::array<std::uint32_t, 2> key = { 0u, 0u };
+        std::uint64_t stream = 0;
+        std::uint64_t ctr = 0;
+        std::array<std::uint32_t, 4> buf = { 0u, 0u, 0u, 0u };
+        unsigned int bufidx = 4;
+    };
+
+    //! A container that can be filled by the bulk get() functions: it has size() and operator[]
+    //! (a std::vector, morph::vvec and so on)
+    template <typename C, typename T>
+    concept rand_fillable = requires (C& c, std::size_t i)
+    {
+        { c.size() } -> std::convertible_to<std::size_t>;
+        { c[i] } -> std::same_as<T&>;
+    };
+
+    //! The layer tables for morph::ziggurat's normal (n) and exponential (e) distributions
+    struct ziggurat_tables
+    {
+        std::array<std::uint64_t, 128> kn = {};
+        std::array<double, 128> wn = {};
+        std::array<double, 128> fn = {};
+        std::array<std::uint64_t, 256> ke = {};
+        std::array<double, 256> we = {};
+        std::array<double, 256> fe = {};
+    };
+
+    constexpr ziggurat_tables make_ziggurat_tables()
+    {
+        ziggurat_tables t;
+        constexpr double m1 = 4503599627370496.0; // 2^52
+        constexpr double m2 = 9007199254740992.0; // 2^53
+        double dn = 3.442619855899;
+        double tn = dn;
+        constexpr double vn = 9.91256303526217e-3;
+        double q = vn / morph::math::exp (-0.5 * dn * dn);
+        t.kn[0] = static_cast<std::uint64_t>((dn / q) * m1);
+        t.kn[1] = 0;
+        t.wn[0] = q / m1;
+        t.wn[127] = dn / m1;
+        t.fn[0] = 1.0;
+        t.fn[127] = morph::math::exp (-0.5 * dn * dn);
+        for (int i = 126; i >= 1; --i) {
+            dn = morph::math::sqrt (-2.0 * morph::math::log (vn / dn + morph::math::exp (-0.5 * dn * dn)));
+            t.kn[i + 1] = static_cast<std::uint64_t>((dn / tn) * m1);
+            tn = dn;
+            t.fn[i] = morph::math::exp (-0.5 * dn * dn);
+            t.wn[i] = dn / m1;
+        }
+        double de = 7.697117470131487;
+        double te = de;
+        constexpr double ve = 3.949659822581572e-3;
+        q = ve / morph::math::exp (-de);
+        t.ke[0] = static_cast<std::uint64_t>((de / q) * m2);
+        t.ke[1] = 0;
+        t.we[0] = q / m2;
+        t.we[255] = de / m2;
+        t.fe[0] = 1.0;
+        t.fe[255] = morph::math::exp (-de);
+        for (int i = 254; i >= 1; --i) {
+            de = -morph::math::log (ve / de + morph::math::exp (-de));
+            t.ke[i + 1] = static_cast<std::uint64_t>((de / te) * m2);
+            te = de;
+            t.fe[i] = morph::math::exp (-de);
+            t.we[i] = de / m2;
+        }
+        return t;
+    }
+
+    /*!
+     * The ziggurat method of Marsaglia and Tsang (J. Stat. Soft. 5(8), 2000) for normal and
+     * exponential random numbers. Most draws take one 64 bit output from the engine, a table
+     * lookup, a compare and a multiply. The low bits choose the layer and the high 53 bits give
+     * the value, so that the two are independent (the flaw noted by Doornik, 2005, in the
+     * original 32 bit version).
+     *
+     * The tables are computed at compile time, and the rare fallbacks (the wedges and the tail)
+     * use exp() and log() below, made only of IEEE basic operations, rather than std::exp and
+     * std::log. So for a given engine the numbers are the same with any standard library, which
+     * is not the case for std::normal_distribution. (A compiler that fuses multiply-adds in the
+     * fallbacks could still, very rarely, change a result in the last bit.)
+     */
+    struct ziggurat
+    {
+        //! Where the tails begin
+        static constexpr double nr = 3.442619855899;
+        static constexpr double er = 7.697117470131487;
+
+        //! 64 random bits from e, which must give 32 or 64 full bits per call
+        template <typename E>
+        static std::uint64_t bits64 (E& e)
+        {
+            using R = typename E::result_type;
+            static_assert (E::min() == 0 && (E::max() == std::numeric_limits<std::uint32_t>::max()
+                                             || E::max() == std::numeric_limits<std::uint64_t>::max()),
+                           "ziggurat needs an engine that gives 32 or 64 full bits");
+            if constexpr (E::max() == std::numeric_limits<std::uint64_t>::max()) {
+                return static_cast<std::uint64_t>(e());
+            } else {
+                const std::uint64_t hi = static_cast<R>(e());
+                return hi << 32 | static_cast<R>(e());
+            }
+        }
+
+        //! e^x, for x <= 0, by range reduction and a Taylor series (good to about 1 ulp)
+        static double exp (const double x)
+        {
+            constexpr double ln2_hi = 6.93147180369123816490e-01;
+            constexpr double ln2_lo = 1.90821492927058770002e-10;
+            const double k = std::floor (x * 1.44269504088896338700 + 0.5);
+            const double r = (x - k * ln2_hi) - k * ln2_lo; // |r| <= ln2/2
+            double p = 1.0;
+            for (int n = 13; n >= 1; --n) { p = 1.0 + p * r / n; }
+            return std::ldexp (p, static_cast<int>(k));
+        }
+
+        //! The natural log of x > 0, from its mantissa by the series for atanh
+        static double log (const double x)
+        {
+            int e = 0;
+            double m = std::frexp (x, &e); // x = m 2^e, m in [1/2, 1)
+            if (m < 0.70710678118654752440) { m *= 2.0; --e; }
+            const double s = (m - 1.0) / (m + 1.0); // |s| < 0.172
+            const double s2 = s * s;
+            double p = 0.0;
+            for (int n = 21; n >= 3; n -= 2) { p = s2 * (1.0 / n + p); }
+            return e * 0.69314718055994530942 + 2.0 * s * (1.0 + p);
+        }
+
+        //! A uniform number in (0,1) from 64 bits
+        static double open_unit (const std::uint64_t b)
+        {
+            return (static_cast<double>(b >> 11) + 0.5) * 0x1.0p-53;
+        }
+
+        /*!
+         * The fast path for a standard normal number from bits b. Returns true and sets x on
+         * success (about 98.8% of the time); otherwise normal_fix() continues from b.
+         */
+        static bool normal_fast (const std::uint64_t b, double& x)
+        {
+            const std::int64_t hz = static_cast<std::int64_t>(b) >> 11;
+            const unsigned int iz = static_cast<unsigned int>(b & 127u);
+            const std::uint64_t ahz = static_cast<std::uint64_t>(hz < 0 ? -hz : hz);
+            x = static_cast<double>(hz) * tab.wn[iz];
+            return ahz < tab.kn[iz];
+        }
+
+        //! The wedges and tail of the normal distribution, from a draw b that failed normal_fast()
+        template <typename E>
+        static double normal_fix (std::uint64_t b, E& e)
+        {
+            for (;;) {
+                const std::int64_t hz = static_cast<std::int64_t>(b) >> 11;
+                const unsigned int iz = static_cast<unsigned int>(b & 127u);
+                const double x = static_cast<double>(hz) * tab.wn[iz];
+                if (iz == 0) {
+                    // The tail, beyond nr
+                    double xt = 0.0;
+                    double y = 0.0;
+                    do {
+                        xt = -ziggurat::log (open_unit (bits64 (e))) / nr;
+                        y = -ziggurat::log (open_unit (bits64 (e)));
+                    } while (y + y < xt * xt);
+                    return hz > 0 ? nr + xt : -nr - xt;
+                }
+                if (tab.fn[iz] + open_unit (bits64 (e)) * (tab.fn[iz - 1] - tab.fn[iz])
+                    < ziggurat::exp (-0.5 * x * x)) {
+                    return x;
+                }
+                b = bits64 (e);
+                double xf = 0.0;
+                if (normal_fast (b, xf)) { return xf; }
+            }
+        }
+
+        //! A standard normal number from engine e
+        template <typename E>
+        static double normal (E& e)
+        {
+            const std::uint64_t b = bits64 (e);
+            double x = 0.0;
+            return normal_fast (b, x) ? x : normal_fix (b, e);
+        }
+
+        //! The fast path for a unit exponential number from bits b (accepts about 98.9% of draws)
+        static bool exponential_fast (const std::uint64_t b, double& x)
+        {
+            const std::uint64_t jz = b >> 11;
+            const unsigned int iz = static_cast<unsigned int>(b & 255u);
+            x = static_cast<double>(jz) * tab.we[iz];
+            return jz < tab.ke[iz];
+        }
+
+        //! The wedges and tail of the exponential distribution
+        template <typename E>
+        static double exponential_fix (std::uint64_t b, E& e)
+        {
+            for (;;) {
+                const std::uint64_t jz = b >> 11;
+                const unsigned int iz = static_cast<unsigned int>(b & 255u);
+                if (iz == 0) { return er - ziggurat::log (open_unit (bits64 (e))); }
+                const double x = static_cast<double>(jz) * tab.we[iz];
+                if (tab.fe[iz] + open_unit (bits64 (e)) * (tab.fe[iz - 1] - tab.fe[iz])
+                    < ziggurat::exp (-x)) {
+                    return x;
+                }
+                b = bits64 (e);
+                double xf = 0.0;
+                if (exponential_fast (b, xf)) { return xf; }
+            }
+        }
+
+        //! A unit exponential number (rate 1) from engine e
+        template <typename E>
+        static double exponential (E& e)
+        {
+            const std::uint64_t b = bits64 (e);
+            double x = 0.0;
+            return exponential_fast (b, x) ? x : exponential_fix (b, e);
+        }
+
+        static constexpr ziggurat_tables tab = make_ziggurat_tables();
+    };
+
+    /*!
+     * Fill rtn with numbers uniformly distributed in [a,b) from the philox engine g. Element i is
+     * made from block i/2 of a range of blocks reserved from g, and the elements are computed in
+     * parallel, giving the same values for any number of threads.
+     */
+    template <typename T, typename C> requires rand_fillable<C, T>
+    void philox_fill_uniform (morph::philox4x32& g, C& rtn, const T a, const T b)
+    {
+        const long long n = static_cast<long long>(rtn.size());
+        const long long nb = (n + 1) / 2;
+        const std::uint64_t b0 = g.reserve (nb);
+        const T range = b - a;
+#pragma omp parallel for simd
+        for (long long k = 0; k < n / 2; ++k) {
+            const std::array<std::uint32_t, 4> r = g.block (b0 + k);
+            rtn[2 * k] = a + range * morph::philox4x32::to_unit<T> (morph::philox4x32::word64 (r, 0));
+            rtn[2 * k + 1] = a + range * morph::philox4x32::to_unit<T> (morph::philox4x32::word64 (r, 1));
+        }
+        if (n % 2) {
+            const std::array<std::uint32_t, 4> r = g.block (b0 + nb - 1);
+            rtn[n - 1] = a + range * morph::philox4x32::to_unit<T> (morph::philox4x32::word64 (r, 0));
+        }
+    }
+
+    /*!
+     * Fill rtn with offset + scale * x for ziggurat draws x from the philox engine g. The first
+     * draw for element i is word i%2 of block i/2 of a reserved range, and the fast path, which
+     * accepts nearly all draws, runs in parallel. The rejected elements are marked with a NaN
+     * and then finished in a serial pass in index order, drawing from g's stream after the
+     * reserved blocks. So the result is the same for any number of threads.
+     */
+    template <typename T, typename C, typename Fast, typename Fix> requires rand_fillable<C, T>
+    void philox_fill_ziggurat (morph::philox4x32& g, C& rtn, const T offset, const T scale, Fast fast, Fix fix)
+    {
+        const long long n = static_cast<long long>(rtn.size());
+        const long long nb = (n + 1) / 2;
+        const std::uint64_t b0 = g.reserve (nb);
+        constexpr T nan = std::numeric_limits<T>::quiet_NaN();
+#pragma omp parallel for
+        for (long long k = 0; k < nb; ++k) {
+            const std::array<std::uint32_t, 4> r = g.block (b0 + k);
+            for (long long w = 0; w < 2 && 2 * k + w < n; ++w) {
+                double x = 0.0;
+                const bool ok = fast (morph::philox4x32::word64 (r, static_cast<unsigned int>(w)), x);
+                rtn[2 * k + w] = ok ? offset + scale * static_cast<T>(x) : nan;
+            }
+        }
+        for (long long i = 0; i < n; ++i) {
+            if (!std::isnan (rtn[i])) { continue; }
+            const std::array<std::uint32_t, 4> r = g.block (b0 + i / 2);
+            rtn[i] = offset + scale * static_cast<T>(fix (morph::philox4x32::word64 (r, static_cast<unsigned int>(i % 2)), g));
+        }
+    }
+
+    //! Fill rtn with normally distributed numbers from the philox engine g by the ziggurat method
+    template <typename T, typename C> requires rand_fillable<C, T>
+    void philox_fill_normal (morph::philox4x32& g, C& rtn, const T mean, const T sigma)
+    {
+        morph::philox_fill_ziggurat<T> (g, rtn, mean, sigma, morph::ziggurat::normal_fast,
+                                        [](std::uint64_t b, morph::philox4x32& e) { return morph::ziggurat::normal_fix (b, e); });
+    }
+
+    //! Fill rtn with exponentially distributed numbers of rate lambda from the philox engine g
+    template <typename T, typename C> requires rand_fillable<C, T>
+    void philox_fill_exponential (morph::philox4x32& g, C& rtn, const T lambda)
+    {
+        morph::philox_fill_ziggurat<T> (g, rtn, T{0}, T{1} / lambda, morph::ziggurat::exponential_fast,
+                                        [](std::uint64_t b, morph::philox4x32& e) { return morph::ziggurat::exponential_fix (b, e); });
+    }
+
+    /*!
+     * The engines used by vvec::randomize(), randomizeN() and shuffle() when they are not given
+     * a generator. Each thread has its own philox4x32, made on first use, so these calls
+     * construct no engine and make no system call.
+     *
+     * Until seed() is called, each thread's engine is seeded from std::random_device. After
+     * seed(s), all threads share the key s, and each takes its own stream: the thread that
+     * called seed() takes stream 0 and the others take streams 1, 2, ... in the order in which
+     * they next draw numbers. So a single threaded program that calls seed() gets the same
+     * numbers on every run.
+     *
+     *\code{.cpp}
+     * morph::default_rng::seed (42);
+     * morph::vvec<float> v (100);
+     * v.randomize(); // The same on every run
+     *\endcode
+     */
+    class default_rng
+    {
+    public:
+        //! Seed every thread's engine with _seed, from the start of its stream
+        static void seed (const std::uint64_t _seed)
+        {
+            default_rng::global_seed().store (_seed);
+            default_rng::seeded().store (true);
+            default_rng::next_stream().store (0);
+            ++default_rng::generation();
+            default_rng::engine(); // take stream 0 for this thread
+        }
+
+        //! Return to seeding each thread's engine from std::random_device
+        static void seed_from_device()
+        {
+            default_rng::seeded().store (false);
+            ++default_rng::generation();
+        }
+
+        //! This thread's engine
+        static morph::philox4x32& engine()
+        {
+            thread_local morph::philox4x32 e;
+            thread_local std::uint64_t gen = ~std::uint64_t{0};
+            const std::uint64_t g = default_rng::generation().load();
+            if (gen != g) {
+                if (default_rng::seeded().load()) {
+                    e.seed (default_rng::global_seed().load());
+                    e.set_stream (default_rng::next_stream()++);
+                } else {
+                    std::random_device rd;
+                    e.seed (static_cast<std::uint64_t>(rd()) << 32 | rd());
+                    e.set_stream (0);
+                }
+                gen = g;
+            }
+            return e;
+        }
+
+    private:
+        static std::atomic<std::uint64_t>& global_seed() { static std::atomic<std::uint64_t> v{0}; return v; }
+        static std::atomic<bool>& seeded() { static std::atomic<bool> v{false}; return v; }
+        static std::atomic<std::uint64_t>& next_stream() { static std::atomic<std::uint64_t> v{0}; return v; }
+        static std::atomic<std::uint64_t>& generation() { static std::atomic<std::uint64_t> v{0}; return v; }
+    };
+
     /*!
      * RandUniform to be specialised depending on whether T is integral or not
      *
@@ -134,6 +663,20 @@ namespace morph {
         //! Reveal the distribution param methods
         typename std::uniform_real_distribution<T>::param_type param() const { return dist.param(); }
         void param (const typename std::uniform_real_distribution<T>::param_type& prms) { this->dist.param(prms); }
+        //! The engine and distribution state as text. Passing it to set_state() returns the
+        //! generator to the same point in its sequence, so a simulation can be checkpointed.
+        std::string get_state() const
+        {
+            std::ostringstream ss;
+            ss << this->generator << ' ' << this->dist;
+            return ss.str();
+        }
+        void set_state (const std::string& state)
+        {
+            std::istringstream ss (state);
+            ss >> this->generator >> this->dist;
+            if (ss.fail()) { throw std::runtime_error ("RandUniform::set_state: malformed state"); }
+        }
         //! Get 1 random number from the generator
         T get() { return this->dist (this->generator); }
         //! Get n random numbers from the generator
@@ -151,6 +694,21 @@ namespace morph {
         {
             for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
         }
+        /*!
+         * Fill the container rtn (a vvec, std::vector...) with random numbers. If E is
+         * morph::philox4x32, element i is made from block i/2 of a reserved range of blocks, and
+         * the elements are computed in parallel, giving the same values for any number of
+         * threads. Otherwise this is a serial loop over get().
+         */
+        template <typename C> requires rand_fillable<C, T>
+        void get (C& rtn)
+        {
+            if constexpr (std::is_same<E, morph::philox4x32>::value) {
+                morph::philox_fill_uniform (this->generator, rtn, this->dist.a(), this->dist.b());
+            } else {
+                for (std::size_t i = 0; i < rtn.size(); ++i) { rtn[i] = this->dist (this->generator); }
+            }
+        }
         T min() { return this->dist.min(); }
         T max() { return this->dist.max(); }
         //! Change the max/min of the distribution to be in range [a,b)
@@ -220,6 +778,20 @@ namespace morph {
         typename std::uniform_int_distribution<T>::param_type param() const { return dist.param(); }
         //! Reveal the distribution's param setter
         void param (const typename std::uniform_int_distribution<T>::param_type& prms) { this->dist.param(prms); }
+        //! The engine and distribution state as text. Passing it to set_state() returns the
+        //! generator to the same point in its sequence, so a simulation can be checkpointed.
+        std::string get_state() const
+        {
+            std::ostringstream ss;
+            ss << this->generator << ' ' << this->dist;
+            return ss.str();
+        }
+        void set_state (const std::string& state)
+        {
+            std::istringstream ss (state);
+            ss >> this->generator >> this->dist;
+            if (ss.fail()) { throw std::runtime_error ("RandUniform::set_state: malformed state"); }
+        }
         //! Get 1 random number from the generator
         T get() { return this->dist (this->generator); }
         //! Get n random numbers from the generator
@@ -264,7 +836,7 @@ namespace morph {
         std::random_device rd{};
         //! Pseudo random number generator engine
         E generator{rd()};
-        //! Our distribution
+        //! Our distribution, which holds the parameters. The numbers come from morph::ziggurat.
         std::normal_distribution<T> dist;
     public:
         //! Default constructor gives RN generator with mean 0 and standard deviation 1
@@ -307,22 +879,138 @@ namespace morph {
         typename std::normal_distribution<T>::param_type param() const { return dist.param(); }
         //! Reveal the distribution's param setter
         void param (const typename std::normal_distribution<T>::param_type& prms) { this->dist.param(prms); }
-        //! Get 1 random number from the generator
-        T get() { return this->dist (this->generator); }
+        //! The engine and distribution state as text. Passing it to set_state() returns the
+        //! generator to the same point in its sequence, so a simulation can be checkpointed.
+        std::string get_state() const
+        {
+            std::ostringstream ss;
+            ss << this->generator << ' ' << this->dist;
+            return ss.str();
+        }
+        void set_state (const std::string& state)
+        {
+            std::istringstream ss (state);
+            ss >> this->generator >> this->dist;
+            if (ss.fail()) { throw std::runtime_error ("RandNormal::set_state: malformed state"); }
+        }
+        //! Get 1 random number from the generator, by the ziggurat method
+        T get() { return this->dist.mean() + this->dist.stddev() * static_cast<T>(morph::ziggurat::normal (this->generator)); }
         //! Get n random numbers from the generator
         std::vector<T> get (std::size_t n)
         {
             std::vector<T> rtn (n, T{0});
-            for (std::size_t i = 0; i < n; ++i) {
-                rtn[i] = this->dist (this->generator);
+            this->get (rtn);
+            return rtn;
+        }
+        //! Place n random numbers in the array rtn
+        template<std::size_t n>
+        void get (std::array<T, n>& rtn)
+        {
+            for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->get(); }
+        }
+        /*!
+         * Fill the container rtn with normally distributed numbers. If E is morph::philox4x32,
+         * the elements are computed in parallel, with the same values for any number of threads
+         * (see morph::philox_fill_normal). Otherwise this is a serial loop over get().
+         */
+        template <typename C> requires rand_fillable<C, T>
+        void get (C& rtn)
+        {
+            if constexpr (std::is_same<E, morph::philox4x32>::value) {
+                morph::philox_fill_normal (this->generator, rtn, this->dist.mean(), this->dist.stddev());
+            } else {
+                for (std::size_t i = 0; i < rtn.size(); ++i) { rtn[i] = this->get(); }
             }
+        }
+        T min() { return this->dist.min(); }
+        T max() { return this->dist.max(); }
+    };
+
+    /*!
+     * Generate numbers drawn from a random exponential distribution by the ziggurat method.
+     *
+     * \tparam T The type of the random number to be generated
+     *
+     * \tparam E The pseudo-random number generator engine.
+     */
+    template <typename T = double, typename E = std::mt19937_64>
+    class RandExponential
+    {
+    private:
+        //! Random device to provide a seed for the generator
+        std::random_device rd{};
+        //! Pseudo random number generator engine
+        E generator{rd()};
+        //! Our distribution (which holds the rate parameter)
+        std::exponential_distribution<T> dist;
+    public:
+        //! Default constructor gives RN generator with rate 1
+        RandExponential() {}
+        //! This constructor gives RN generator with rate 1 and sets a fixed seed.
+        RandExponential (unsigned int _seed) { this->generator.seed (_seed); }
+        //! This constructor gives RN generator with rate \a lambda
+        RandExponential (T lambda)
+        {
+            typename std::exponential_distribution<T>::param_type prms (lambda);
+            this->dist.param (prms);
+        }
+        //! This constructor gives RN generator with rate \a lambda and sets a fixed seed.
+        RandExponential (T lambda, unsigned int _seed)
+        {
+            this->generator.seed (_seed);
+            typename std::exponential_distribution<T>::param_type prms (lambda);
+            this->dist.param (prms);
+        }
+        //! Copy constructor copies the distribution parameters
+        RandExponential (const RandExponential<T>& rng) { this->param (rng.param()); }
+        //! Copy assignment operator needs to be explicitly defined
+        RandExponential& operator= (const RandExponential<T>& rng)
+        {
+            if (&rng == static_cast<const RandExponential<T>*>(this)) { return *this; }
+            this->param (rng.param());
+            return *this;
+        }
+        //! Reveal the distribution's param getter
+        typename std::exponential_distribution<T>::param_type param() const { return dist.param(); }
+        //! Reveal the distribution's param setter
+        void param (const typename std::exponential_distribution<T>::param_type& prms) { this->dist.param(prms); }
+        //! The engine and distribution state as text, as for RandNormal
+        std::string get_state() const
+        {
+            std::ostringstream ss;
+            ss << this->generator << ' ' << this->dist;
+            return ss.str();
+        }
+        void set_state (const std::string& state)
+        {
+            std::istringstream ss (state);
+            ss >> this->generator >> this->dist;
+            if (ss.fail()) { throw std::runtime_error ("RandExponential::set_state: malformed state"); }
+        }
+        //! Get 1 random number from the generator
+        T get() { return static_cast<T>(morph::ziggurat::exponential (this->generator)) / this->dist.lambda(); }
+        //! Get n random numbers from the generator
+        std::vector<T> get (std::size_t n)
+        {
+            std::vector<T> rtn (n, T{0});
+            this->get (rtn);
             return rtn;
         }
         //! Place n random numbers in the array rtn
         template<std::size_t n>
         void get (std::array<T, n>& rtn)
         {
-            for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
+            for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->get(); }
+        }
+        //! Fill the container rtn, in parallel if E is morph::philox4x32 (see RandNormal::get(C&))
+        template <typename C> requires rand_fillable<C, T>
+        void get (C& rtn)
+        {
+            if constexpr (std::is_same<E, morph::philox4x32>::value) {
+                morph::philox_fill_exponential (this->generator, rtn, this->dist.lambda());
+            } else {
+                for (std::size_t i = 0; i < rtn.size(); ++i) { rtn[i] = this->get(); }
+            }
         }
         T min() { return this->dist.min(); }
         T max() { return this->dist.max(); }
@@ -343,7 +1031,7 @@ namespace morph {
         std::random_device rd{};
         //! Pseudo random number generator engine
         E generator{rd()};
-        //! Our distribution
+        //! Our distribution, which holds the parameters. The numbers come from morph::ziggurat.
         std::lognormal_distribution<T> dist;
     public:
         //! Default constructor gives RN generator with mean-of-the-log 0 and standard
@@ -389,22 +1077,50 @@ namespace morph {
         typename std::lognormal_distribution<T>::param_type param() const { return dist.param(); }
         //! Reveal the distribution's param setter
         void param (const typename std::lognormal_distribution<T>::param_type& prms) { this->dist.param(prms); }
-        //! Get 1 random number from the generator
-        T get() { return this->dist (this->generator); }
+        //! The engine and distribution state as text. Passing it to set_state() returns the
+        //! generator to the same point in its sequence, so a simulation can be checkpointed.
+        std::string get_state() const
+        {
+            std::ostringstream ss;
+            ss << this->generator << ' ' << this->dist;
+            return ss.str();
+        }
+        void set_state (const std::string& state)
+        {
+            std::istringstream ss (state);
+            ss >> this->generator >> this->dist;
+            if (ss.fail()) { throw std::runtime_error ("RandLogNormal::set_state: malformed state"); }
+        }
+        //! Get 1 random number from the generator: exp of a ziggurat normal number
+        T get() { return std::exp (this->dist.m() + this->dist.s() * static_cast<T>(morph::ziggurat::normal (this->generator))); }
         //! Get n random numbers from the generator
         std::vector<T> get (std::size_t n)
         {
             std::vector<T> rtn (n, T{0});
-            for (std::size_t i = 0; i < n; ++i) {
-                rtn[i] = this->dist (this->generator);
-            }
+            this->get (rtn);
             return rtn;
         }
         //! Place n random numbers in the array rtn
         template<std::size_t n>
         void get (std::array<T, n>& rtn)
         {
-            for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->dist (this->generator); }
+            for (std::size_t i = 0; i < n; ++i) { rtn[i] = this->get(); }
+        }
+        /*!
+         * Fill the container rtn. If E is morph::philox4x32, the normal numbers are made in
+         * parallel as in RandNormal::get(C&), then exponentiated in one vectorisable pass.
+         */
+        template <typename C> requires rand_fillable<C, T>
+        void get (C& rtn)
+        {
+            if constexpr (std::is_same<E, morph::philox4x32>::value) {
+                morph::philox_fill_normal (this->generator, rtn, this->dist.m(), this->dist.s());
+                const long long n = static_cast<long long>(rtn.size());
+#pragma omp parallel for simd
+                for (long long i = 0; i < n; ++i) { rtn[i] = std::exp (rtn[i]); }
+            } else {
+                for (std::size_t i = 0; i < rtn.size(); ++i) { rtn[i] = this->get(); }
+            }
         }
         T min() { return this->dist.min(); }
         T max() { return this->dist.max(); }
@@ -470,6 +1186,20 @@ namespace morph {
         typename std::poisson_distribution<T>::param_type param() const { return dist.param(); }
         //! Reveal the distribution's param setter
         void param (const typename std::poisson_distribution<T>::param_type& prms) { this->dist.param(prms); }
+        //! The engine and distribution state as text. Passing it to set_state() returns the
+        //! generator to the same point in its sequence, so a simulation can be checkpointed.
+        std::string get_state() const
+        {
+            std::ostringstream ss;
+            ss << this->generator << ' ' << this->dist;
+            return ss.str();
+        }
+        void set_state (const std::string& state)
+        {
+            std::istringstream ss (state);
+            ss >> this->generator >> this->dist;
+            if (ss.fail()) { throw std::runtime_error ("RandPoisson::set_state: malformed state"); }
+        }
         //! Get 1 random number from the generator
         T get() { return this->dist (this->generator); }
         //! Get n random numbers from the generator
@@ -13,6 +13,12 @@
 #include <list>
 #include <vector>
 #include <map>
+#include <set>
+#include <fstream>
+#include <string_view>
+#include <charconv>
+#include <cctype>
+#include <stdexcept>
 #include <rapidxml/rapidxml.hpp>
 #include <morph/BezCurvePath.h>
 #include <morph/AllocAndRead.h>
@@ -69,6 +75,37 @@ namespace morph
             } // else DID get cortex ID
         }
 
+        /*!
+         * Construct by streaming through the SVG file at svgpath, materialising only the
+         * layers whose ids are in \a layers (all of them if \a layers is empty). See
+         * init(const std::string&, const std::vector<std::string>&).
+         */
+        ReadCurves (const std::string& svgpath, const std::vector<std::string>& layers)
+        {
+            this->init (svgpath, layers);
+        }
+
+        /*!
+         * Initialise by streaming through the SVG file at svgpath, without holding either
+         * the file or its XML tree in memory. Only the paths of the layers named in \a
+         * layers are kept (all layers if \a layers is empty). A layer is a top-level <g>
+         * element, named by its id (or by the id of a path within it that does not begin
+         * with "path", as for the ReadCurves(const std::string&) constructor), or a
+         * top-level <path> with an id. Every path within a <g> is read. The scale bar and
+         * the top-level circles are always read. The path data of the layers is parsed
+         * in parallel once the file has been scanned.
+         *
+         * Throws if any of the requested layers is not in the file.
+         */
+        void init (const std::string& svgpath, const std::vector<std::string>& layers)
+        {
+            this->readStreaming (svgpath, layers);
+            this->setScale();
+            if (this->gotCortex == false && layers.empty()) {
+                std::cerr << "WARNING: No object in SVG with id \"cortex\". Cortical boundary will be null.\n";
+            }
+        }
+
         /*!
          * Get the cortical path as a list of BezCurves
          */
@@ -322,19 +359,20 @@ namespace morph
          */
         void readPath (rapidxml::xml_node<>* path_node, const std::string& layerName)
         {
-            std::string d("");
-            rapidxml::xml_attribute<>* d_attr;
-            if ((d_attr = path_node->first_attribute ("d"))) {
-                d = d_attr->value();
-            } // else failed to get d
-
-            if (d.empty()) {
+            rapidxml::xml_attribute<>* d_attr = path_node->first_attribute ("d");
+            if (d_attr == nullptr || d_attr->value_size() == 0) {
                 throw std::runtime_error ("Found a <path> element without a d attribute");
             }
 
-            DBG ("Path commands for layer " << layerName << ": " << d);
+            DBG ("Path commands for layer " << layerName << ": " << d_attr->value());
+
+            // Parse the attribute's text where it lies in the document
+            this->storePath (ReadCurves::parsePathData (d_attr->value(), d_attr->value() + d_attr->value_size()), layerName);
+        }
 
-            morph::BezCurvePath<float> curves = this->parseD (d);
+        //! Keep the path \a curves, read from the layer \a layerName
+        void storePath (morph::BezCurvePath<float>&& curves, const std::string& layerName)
+        {
             curves.name = layerName;
             if (layerName == "cortex") {
                 this->gotCortex = true;
@@ -377,415 +415,476 @@ namespace morph
         }
 
         /*!
-         * Split up a string of SVG command numbers. These are delimited either by a comma, a space
-         * or by a minus sign. Interpret them as floats and return in a vector.
-         *
-         * This version also sets this->lastCmd where appropriate, and ensures that numParams are
-         * extracted from s. When s contains a longer than numParams list of numbers, endOfCmd is
-         * set to point to the end of the commands read into the return value.
+         * Read a <line> element. Read x1,y1,x2,y2 attributes from which line length can be
+         * determined and lineToMillimetres populated.
          */
-        std::vector<float> splitSvgCmdString (const std::string& s, char cmd,
-                                              unsigned int numParams,
-                                              std::string::size_type& endOfCmd)
+        void readLine (rapidxml::xml_node<>* line_node, const std::string& layerName)
         {
-            std::vector<float> numbers;
-            unsigned int numnum = 0; // number of numbers stored in numbers
-            float n = 0.0f;
-
-            std::string::size_type p0 = 0;
-            std::string::size_type p1 = s.find_first_of ("-, ", p0);
-            while (p1 != std::string::npos && numnum < numParams) {
-
-                if (p1 != p0) {
-                    std::stringstream ss;
-                    ss << s.substr(p0, p1-p0);
-                    std::string ccs = ss.str();
-                    if (morph::tools::containsOnlyWhitespace (ccs)) {
-                        // Do nothing
-                    } else {
-                        ss >> n;
-                        numbers.push_back (n);
-                        ++numnum;
-                    }
-                }
+            std::string x[4];
+            const char* names[4] = { "x1", "x2", "y1", "y2" };
+            for (int i = 0; i < 4; ++i) {
+                rapidxml::xml_attribute<>* attr;
+                if ((attr = line_node->first_attribute (names[i]))) { x[i] = attr->value(); }
+            }
+            this->readLine (x[0], x[1], x[2], x[3], layerName);
+        }
 
-                if (s[p1] == ',') {
-                    p0 = p1+1;
-                } else if (s[p1] == ' ') {
-                    p0 = p1+1;
-                } else if (s[p1] == '-') {
-                    if (false == (p1>0 && s[p1-1] == 'e')) {
-                        p0 = p1; // Not +1 so that we include the - in the next one
-                    } else {
-                        // This '-' character followed an exponent 'e' character, so it does not denote a
-                        // delimiter between values in the string s. So pop off the incomplete number
-                        // string which will just have been pushed back, decrement numnum and carry on.
-                        numbers.pop_back();
-                        --numnum;
-                    }
-                }
+        //! Set the scale bar from the attributes of a <line> element in the layer \a layerName
+        void readLine (const std::string& x1, const std::string& x2,
+                       const std::string& y1, const std::string& y2, const std::string& layerName)
+        {
+            if (x1.empty()) {
+                throw std::runtime_error ("Found a <line> element without a x1 attribute");
+            }
+            if (x2.empty()) {
+                throw std::runtime_error ("Found a <line> element without a x2 attribute");
+            }
+            if (y1.empty()) {
+                throw std::runtime_error ("Found a <line> element without a y1 attribute");
+            }
+            if (y2.empty()) {
+                throw std::runtime_error ("Found a <line> element without a y2 attribute");
+            }
 
-                if (numnum < numParams) {
-                    p1 = s.find_first_of ("-, ", p1+1);
-                }
+            // Now do something with x1,y1,x2,y2: Create a BezCurve object then add this
+            // to this->linePath
+            morph::vec<float, 2> p1;
+            p1[0] = static_cast<float>(std::atof (x1.c_str()));
+            p1[1] = static_cast<float>(std::atof (y1.c_str()));
+            morph::vec<float, 2> p2;
+            p2[0] = static_cast<float>(std::atof (x2.c_str()));
+            p2[1] = static_cast<float>(std::atof (y2.c_str()));
+            morph::BezCurve<float> linecurve (p1, p2);
+            this->linePath.reset();
+            this->linePath.initialCoordinate = p1;
+            this->linePath.addCurve (linecurve);
+
+            this->setupScaling (layerName);
+        }
+
+        //! The name and attributes of an element's tag, which point into the tag text
+        struct svgTag
+        {
+            std::string_view name;
+            bool closing = false;
+            bool selfclosing = false;
+            std::vector<std::pair<std::string_view, std::string_view>> attrs;
+
+            //! The value of the attribute \a a, or an empty view
+            std::string_view attr (std::string_view a) const
+            {
+                for (const auto& nv : this->attrs) { if (nv.first == a) { return nv.second; } }
+                return std::string_view();
             }
 
-            if (p1 == std::string::npos) {
-                // No minus signs. Attempt to convert s into a single float and return
-                std::stringstream ss;
-                ss << s.substr (p0, p1-p0);
-                if (!ss.str().empty()) {
-                    ss >> n;
-                    numbers.push_back (n);
-                    ++numnum;
+            //! Split the text between < and > into name and attributes
+            void parse (std::string_view t)
+            {
+                this->attrs.clear();
+                this->closing = !t.empty() && t.front() == '/';
+                if (this->closing) { t.remove_prefix (1); }
+                this->selfclosing = !t.empty() && t.back() == '/';
+                if (this->selfclosing) { t.remove_suffix (1); }
+                std::size_t i = 0;
+                while (i < t.size() && !std::isspace (static_cast<unsigned char>(t[i]))) { ++i; }
+                this->name = t.substr (0, i);
+                while (i < t.size()) {
+                    while (i < t.size() && std::isspace (static_cast<unsigned char>(t[i]))) { ++i; }
+                    const std::size_t n0 = i;
+                    while (i < t.size() && t[i] != '=' && !std::isspace (static_cast<unsigned char>(t[i]))) { ++i; }
+                    const std::string_view an = t.substr (n0, i - n0);
+                    while (i < t.size() && std::isspace (static_cast<unsigned char>(t[i]))) { ++i; }
+                    if (i >= t.size() || t[i] != '=') { continue; }
+                    ++i;
+                    while (i < t.size() && std::isspace (static_cast<unsigned char>(t[i]))) { ++i; }
+                    if (i >= t.size() || (t[i] != '"' && t[i] != '\'')) { continue; }
+                    const char q = t[i++];
+                    const std::size_t v0 = i;
+                    while (i < t.size() && t[i] != q) { ++i; }
+                    this->attrs.push_back ({ an, t.substr (v0, i - v0) });
+                    ++i;
                 }
             }
+        };
 
-            if (numnum > numParams) {
-                throw std::runtime_error ("splitSvgCmdString: unexpected number of params in command.");
+        /*!
+         * Scan the SVG file at svgpath a block at a time, calling \a on_tag with each element
+         * tag (opening, closing or self-closing) in document order. Comments, CDATA
+         * sections, processing instructions and declarations are skipped, as is the text
+         * between tags. Only the text of the current tag is held.
+         */
+        template <typename F>
+        static void scanSvgTags (const std::string& svgpath, F&& on_tag)
+        {
+            std::ifstream f (svgpath, std::ios::in | std::ios::binary);
+            if (!f.is_open()) {
+                throw std::runtime_error ("ReadCurves: failed to open " + svgpath);
+            }
+            // What the text since the last '<' has turned out to be
+            enum class kind { text, unknown, element, comment, cdata, declaration, instruction };
+            kind k = kind::text;
+            std::string tagtext;
+            char quote = '\0';
+            int brackets = 0;
+            char last[2] = { '\0', '\0' };
+            svgTag tag;
+            std::vector<char> block (1 << 20);
+            while (f) {
+                f.read (block.data(), static_cast<std::streamsize>(block.size()));
+                const std::streamsize nread = f.gcount();
+                for (std::streamsize bi = 0; bi < nread; ++bi) {
+                    const char c = block[bi];
+                    switch (k) {
+                    case kind::text:
+                        if (c == '<') { k = kind::unknown; tagtext.clear(); quote = '\0'; brackets = 0; }
+                        break;
+                    case kind::unknown:
+                        tagtext.push_back (c);
+                        if (tagtext == "!--") {
+                            k = kind::comment;
+                        } else if (tagtext == "![CDATA[") {
+                            k = kind::cdata;
+                        } else if (tagtext[0] == '?') {
+                            k = kind::instruction;
+                        } else if (tagtext[0] != '!') {
+                            k = kind::element;
+                            if (c == '>') { tagtext.pop_back(); tag.parse (tagtext); on_tag (tag); k = kind::text; }
+                        } else if (std::string_view("![CDATA[").substr (0, tagtext.size()) != tagtext
+                                   && std::string_view("!--").substr (0, tagtext.size()) != tagtext) {
+                            k = kind::declaration;
+                            if (c == '>') { k = kind::text; }
+                        }
+                        last[0] = '\0'; last[1] = '\0';
+                        break;
+                    case kind::element:
+                        if (quote != '\0') {
+                            if (c == quote) { quote = '\0'; }
+                        } else if (c == '"' || c == '\'') {
+                            quote = c;
+                        } else if (c == '>') {
+                            tag.parse (tagtext);
+                            on_tag (tag);
+                            k = kind::text;
+                            break;
+                        }
+                        tagtext.push_back (c);
+                        break;
+                    case kind::comment:
+                        if (c == '>' && last[0] == '-' && last[1] == '-') { k = kind::text; }
+                        last[0] = last[1]; last[1] = c;
+                        break;
+                    case kind::cdata:
+                        if (c == '>' && last[0] == ']' && last[1] == ']') { k = kind::text; }
+                        last[0] = last[1]; last[1] = c;
+                        break;
+                    case kind::instruction:
+                        if (c == '>' && last[1] == '?') { k = kind::text; }
+                        last[0] = last[1]; last[1] = c;
+                        break;
+                    case kind::declaration:
+                        // A <!DOCTYPE> may hold an internal subset in [], with its own <!ENTITY>s
+                        if (quote != '\0') {
+                            if (c == quote) { quote = '\0'; }
+                        } else if (c == '"' || c == '\'') {
+                            quote = c;
+                        } else if (c == '[') {
+                            ++brackets;
+                        } else if (c == ']') {
+                            --brackets;
+                        } else if (c == '>' && brackets <= 0) {
+                            k = kind::text;
+                        }
+                        break;
+                    }
+                }
             }
+        }
 
-            endOfCmd = p1;
+        /*!
+         * Read the SVG file at svgpath with scanSvgTags(), keeping the paths of the layers in
+         * \a layers (or of every layer, if it is empty), then parse their path data in
+         * parallel. The results are stored in the same order as read() stores them.
+         */
+        void readStreaming (const std::string& svgpath, const std::vector<std::string>& layers)
+        {
+            const std::set<std::string> wanted (layers.begin(), layers.end());
+            std::set<std::string> found;
+            auto want = [&wanted](const std::string& layer) {
+                return wanted.empty() || wanted.count (layer) > 0 || layer.find ("mm") != std::string::npos;
+            };
+
+            // A layer's path data, or (with an empty d) the scale bar line at the end of a <g>
+            struct item { std::string layer; std::string d; bool is_line = false; std::string line[4]; };
+            std::vector<item> in_g;
+            std::vector<item> top_level;
+            bool got_root = false;
+            int depth = 0;
+            bool in_group = false;
+            std::string g_id("");
+            bool g_has_line = false;
+            item g_line;
+
+            ReadCurves::scanSvgTags (svgpath, [&](const svgTag& t) {
+                if (t.closing) {
+                    --depth;
+                    if (in_group && depth == 1) {
+                        // The end of a top-level <g>
+                        if (g_has_line) {
+                            g_line.layer = g_id;
+                            in_g.push_back (std::move (g_line));
+                            g_line = item();
+                        }
+                        in_group = false;
+                    }
+                    return;
+                }
+                if (!got_root) {
+                    if (t.name != "svg") { throw std::runtime_error ("No root node 'svg'!"); }
+                    got_root = true;
+                } else if (depth == 1 && t.name == "g") {
+                    in_group = true;
+                    g_id = t.attr ("id");
+                    if (!g_id.empty()) { found.insert (g_id); }
+                    g_has_line = false;
+                } else if (in_group && t.name.substr (0, 4) == "path") {
+                    const std::string_view p_id = t.attr ("id");
+                    if (!p_id.empty() && p_id.find ("path") != 0) { g_id = p_id; }
+                    found.insert (g_id);
+                    if (want (g_id)) {
+                        const std::string_view d = t.attr ("d");
+                        if (d.empty()) { throw std::runtime_error ("Found a <path> element without a d attribute"); }
+                        in_g.push_back ({ g_id, std::string(d), false, {} });
+                    }
+                } else if (in_group && t.name.substr (0, 4) == "line") {
+                    if (!g_has_line) {
+                        g_has_line = true;
+                        g_line.is_line = true;
+                        const char* names[4] = { "x1", "x2", "y1", "y2" };
+                        for (int i = 0; i < 4; ++i) { g_line.line[i] = t.attr (names[i]); }
+                    }
+                } else if (depth == 1 && t.name == "path") {
+                    const std::string p_id (t.attr ("id"));
+                    if (!p_id.empty()) {
+                        found.insert (p_id);
+                        if (want (p_id)) {
+                            const std::string_view d = t.attr ("d");
+                            if (d.empty()) { throw std::runtime_error ("Found a <path> element without a d attribute"); }
+                            top_level.push_back ({ p_id, std::string(d), false, {} });
+                        }
+                    }
+                } else if (depth == 1 && t.name == "circle") {
+                    const std::string_view circ_id = t.attr ("id");
+                    const std::string_view cx = t.attr ("cx");
+                    const std::string_view cy = t.attr ("cy");
+                    if (!circ_id.empty() && !cx.empty() && !cy.empty()) {
+                        this->circles[std::string(circ_id)] = morph::vec<float, 2>({ static_cast<float>(std::atof (std::string(cx).c_str())),
+                                                                                    static_cast<float>(std::atof (std::string(cy).c_str())) });
+                    }
+                }
+                if (!t.selfclosing) { ++depth; }
+            });
+            if (!got_root) { throw std::runtime_error ("No root node 'svg'!"); }
 
-            if (endOfCmd == std::string::npos) {
-                this->lastCmd = '\0';
-            } else {
-                this->lastCmd = cmd;
+            for (const std::string& l : wanted) {
+                if (found.count (l) == 0) { throw std::runtime_error ("ReadCurves: no layer \"" + l + "\" in " + svgpath); }
             }
 
-            return numbers;
+            // Parse the layers' path data in parallel, then store in document order
+            in_g.insert (in_g.end(), std::make_move_iterator (top_level.begin()), std::make_move_iterator (top_level.end()));
+            std::vector<morph::BezCurvePath<float>> paths (in_g.size());
+            const long long n_items = static_cast<long long>(in_g.size());
+#pragma omp parallel for schedule(dynamic)
+            for (long long i = 0; i < n_items; ++i) {
+                if (!in_g[i].is_line) {
+                    paths[i] = ReadCurves::parsePathData (in_g[i].d.data(), in_g[i].d.data() + in_g[i].d.size());
+                    std::string().swap (in_g[i].d);
+                }
+            }
+            for (std::size_t i = 0; i < in_g.size(); ++i) {
+                if (in_g[i].is_line) {
+                    if (this->foundLine == true) {
+                        std::cerr << "WARNING: Found a second <line> element in this SVG, was only expecting one (as a single scale bar)\n";
+                    }
+                    this->readLine (in_g[i].line[0], in_g[i].line[1], in_g[i].line[2], in_g[i].line[3], in_g[i].layer);
+                    this->foundLine = true;
+                } else {
+                    this->storePath (std::move (paths[i]), in_g[i].layer);
+                }
+            }
         }
 
         /*!
-         * This parses the d attribute string in an SVG path. I'm assuming this will always be a
-         * list of Bezier Curves.
+         * Parse the path data (the d attribute of a <path>) from \a p to \a e into a
+         * BezCurvePath, reading the numbers in place. Handles the lineto (L, H, V), moveto
+         * (M), cubic (C, S), quadratic (Q, T) and closepath (Z) commands in their absolute
+         * and relative forms, with implicitly repeated commands. An arc (A) becomes a straight
+         * line to its end point.
          *
          * NB: The SVG is encoded in a left-hand coordinate system, with x positive right and y
          * positive down. This parsing does not change that coordinate system, and so the BezCoords
          * in the path may need to have their y coordinates reversed.
          */
-        morph::BezCurvePath<float> parseD (const std::string& d)
+        static morph::BezCurvePath<float> parsePathData (const char* p, const char* const e)
         {
             morph::BezCurvePath<float> curves;
-
-            // As we parse through the path, we have to keep track of the
-            // current coordinate position, as curves are specified from the
-            // position at the end of the previous curve.
-            morph::vec<float, 2> currentCoordinate = {0.0f, 0.0f};
-
-            // The first coordinate of the path. Can be required with a Z
-            // command.
-            morph::vec<float, 2> firstCoordinate = {0.0f, 0.0f};
-
-            // The last Bezier control points, c2, especially may be required
-            // in a shortcut Bezier command (s or S), hence declaring these
-            // outside the scope of the while loop.
-            morph::vec<float, 2> c1; // Control point 1
-            morph::vec<float, 2> c2; // Control point 2
-            morph::vec<float, 2> f;  // Final point of curve
-
-            // A list of SVG command characters
-            const char* svgCmds = "mMcCsSqQtTzZlLhHvV";
-
-            // Text parsing time!
-            std::string::size_type p0 = 0;
-            std::string::size_type p1 = d.find_first_of (svgCmds, p0);
-            std::string::size_type p2 = 0;
-            std::string::size_type p3 = std::string::npos;
-            this->lastCmd = '\0';
-            char cmd = '\0';
-            while (p1 != std::string::npos) {
-
-                // if lastCmd == '\0' switch on d, else switch on lastCmd.
-                if (lastCmd == '\0') {
-                    cmd = d[p1];
-                } else {
-                    cmd = this->lastCmd;
+            morph::vec<float, 2> cur = { 0.0f, 0.0f };
+            morph::vec<float, 2> first = { 0.0f, 0.0f };
+            // The last control point of the last curve, for the shortcut commands S and T
+            morph::vec<float, 2> lastctrl = { 0.0f, 0.0f };
+
+            auto skip = [&p, e]() {
+                while (p < e && (std::isspace (static_cast<unsigned char>(*p)) || *p == ',')) { ++p; }
+            };
+            auto number = [&p, e, &skip](float& v) {
+                skip();
+                const char* q = p;
+                if (q < e && *q == '+') { ++q; }
+                const char* r = (q < e && *q == '-') ? q + 1 : q;
+                if (r >= e || !(std::isdigit (static_cast<unsigned char>(*r)) || *r == '.')) { return false; }
+                const std::from_chars_result res = std::from_chars (q, e, v);
+                if (res.ec != std::errc()) { return false; }
+                p = res.ptr;
+                return true;
+            };
+            auto nparams = [](const char c) {
+                switch (c) {
+                case 'M': case 'm': case 'L': case 'l': case 'T': case 't': return 2;
+                case 'H': case 'h': case 'V': case 'v': return 1;
+                case 'C': case 'c': return 6;
+                case 'S': case 's': case 'Q': case 'q': return 4;
+                case 'A': case 'a': return 7;
+                default: return 0;
                 }
+            };
 
-                p3 = std::string::npos;
-
-                switch (cmd) { // switch on the command character
-
-                case 'L': // lineto command, absolution coordinates
-                case 'l': // lineto command, deltas
-                {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string lCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::tools::containsOnlyWhitespace (lCmd)) {
-                        p3 = lCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (lCmd, cmd, 10000, p3);
-                        if (v.size()%2 != 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path L command (expected pairs of numbers)");
-                        }
-                        for (unsigned int i = 0; i<v.size(); i+=2) {
-                            if (cmd == 'l') { // delta coordinates
-                                f = { currentCoordinate[0] + v[i], currentCoordinate[1] + v[i+1] };
-                            } else {
-                                f = { v[i], v[i+1] };
-                            }
-                            morph::BezCurve<float> c(currentCoordinate, f);
+            char cmd = '\0';
+            char prev = '\0';
+            float v[7];
+            while (true) {
+                skip();
+                if (p >= e) { break; }
+                if (std::isalpha (static_cast<unsigned char>(*p))) {
+                    cmd = *p++;
+                    if (cmd == 'z' || cmd == 'Z') {
+                        if (cur != first) {
+                            BezCurve<float> c(cur, first);
                             curves.addCurve (c);
-                            currentCoordinate = f;
+                            cur = first;
                         }
+                        prev = cmd;
+                        continue;
                     }
-                    break;
+                    if (nparams (cmd) == 0) {
+                        throw std::runtime_error (std::string("Unknown SVG path command ") + cmd);
+                    }
+                } else if (cmd == '\0' || cmd == 'z' || cmd == 'Z') {
+                    throw std::runtime_error ("SVG path data has numbers with no command");
                 }
-
-                case 'H': // horizontal lineto command, absolution coordinates
-                case 'h': // horizontal lineto command, deltas
-                {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string lCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::tools::containsOnlyWhitespace (lCmd)) {
-                        p3 = lCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (lCmd, cmd, 10000, p3);
-                        if (v.size() == 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path H command (expected at least one number)");
-                        }
-                        for (unsigned int i = 0; i<v.size(); ++i) {
-                            if (cmd == 'h') { // delta coordinates
-                                f = { currentCoordinate[0] + v[i], currentCoordinate[1] };
-                            } else {
-                                f = { v[i], currentCoordinate[1] };
-                            }
-                            morph::BezCurve<float> c(currentCoordinate, f);
-                            curves.addCurve (c);
-                            currentCoordinate = f;
-                        }
+                const int np = nparams (cmd);
+                for (int i = 0; i < np; ++i) {
+                    if (!number (v[i])) {
+                        std::stringstream ee;
+                        ee << "Unexpected size of SVG path " << cmd << " command (expected " << np << " numbers, got " << i << ")";
+                        throw std::runtime_error (ee.str());
                     }
+                }
+                const bool rel = std::islower (static_cast<unsigned char>(cmd)) != 0;
+                const morph::vec<float, 2> o = rel ? cur : morph::vec<float, 2>({ 0.0f, 0.0f });
+                switch (cmd) {
+                case 'M': case 'm':
+                {
+                    cur = { o[0] + v[0], o[1] + v[1] };
+                    first = cur;
+                    curves.initialCoordinate = cur;
+                    // Further pairs are implicit linetos
+                    cmd = rel ? 'l' : 'L';
                     break;
                 }
-
-                case 'V': // vertical lineto command, absolution coordinates
-                case 'v': // vertical lineto command, deltas
+                case 'L': case 'l':
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string lCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::tools::containsOnlyWhitespace (lCmd)) {
-                        p3 = lCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (lCmd, cmd, 10000, p3);
-                        if (v.size() == 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path V command (expected at least one number)");
-                        }
-                        for (unsigned int i = 0; i<v.size(); ++i) {
-                            if (cmd == 'v') { // delta coordinates
-                                if (v[i] != 0.0f) {
-                                    f = { currentCoordinate[0], currentCoordinate[1] + v[i] };
-                                    morph::BezCurve<float> c(currentCoordinate, f);
-                                    curves.addCurve (c);
-                                    currentCoordinate = f;
-                                }
-                            } else {
-                                f = { currentCoordinate[0], v[i] };
-                                morph::BezCurve<float> c(currentCoordinate, f);
-                                curves.addCurve (c);
-                                currentCoordinate = f;
-                            }
-                        }
-                    }
+                    morph::vec<float, 2> f = { o[0] + v[0], o[1] + v[1] };
+                    BezCurve<float> c(cur, f);
+                    curves.addCurve (c);
+                    cur = f;
                     break;
                 }
-
-                case 'M': // move command, absolution coordinates
-                case 'm': // move command, deltas
+                case 'H': case 'h':
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string mCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::tools::containsOnlyWhitespace (mCmd)) {
-                        p3 = mCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (mCmd, cmd, 10000, p3);
-                        if (v.size()%2 != 0) {
-                            throw std::runtime_error ("Unexpected size of SVG path M command (expected pairs of numbers)");
-                        }
-
-                        if (cmd == 'm') { // delta coordinates
-                            currentCoordinate = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
-                        } else {
-                            currentCoordinate = { v[0], v[1] };
-                        }
-                        firstCoordinate = currentCoordinate;
-                        curves.initialCoordinate = currentCoordinate;
-
-                        if (v.size() == 2) {
-                            // Just 2 coords means it's a move command; nothing further to do
-                        } else {
-                            // pairs of commands implies linetos.
-                            for (unsigned int i = 2; i<v.size(); i+=2) {
-                                if (cmd == 'm') { // delta coordinates
-                                    f = { currentCoordinate[0] + v[i], currentCoordinate[1] + v[i+1] };
-                                } else {
-                                    f = { v[i], v[i+1] };
-                                }
-                                morph::BezCurve<float> c(currentCoordinate, f);
-                                curves.addCurve (c);
-                                currentCoordinate = f;
-                            }
-                        }
-                    }
+                    morph::vec<float, 2> f = { o[0] + v[0], cur[1] };
+                    BezCurve<float> c(cur, f);
+                    curves.addCurve (c);
+                    cur = f;
                     break;
                 }
-
-                case 'C': // cubic Bezier curve, abs positions
-                case 'c': // cubic Bezier curve, deltas
+                case 'V': case 'v':
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string cCmd = d.substr (p1+1, p2-p1-1); // cCmd may be either a single command (6 params) or a great long line.
-                    if (morph::tools::containsOnlyWhitespace (cCmd)) {
-                        p3 = cCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (cCmd, cmd, 6, p3);
-                        if (v.size() != 6) {
-                            std::stringstream ee;
-                            ee << "Unexpected size of SVG path C command (expected 6 numbers, got " << v.size() << ")";
-                            throw std::runtime_error (ee.str());
-                        }
-                        if (cmd == 'c') { // delta coordinates
-                            c1 = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
-                            c2 = { currentCoordinate[0] + v[2], currentCoordinate[1] + v[3] };
-                            f = { currentCoordinate[0] + v[4], currentCoordinate[1] + v[5] };
-                        } else { // 'C', so absolute coordinates were given
-                            c1 = { v[0],v[1] };
-                            c2 = { v[2],v[3] };
-                            f = { v[4],v[5] };
-                        }
-                        morph::BezCurve<float> c(currentCoordinate, f, c1, c2);
-                        curves.addCurve (c);
-                        currentCoordinate = f;
-                    }
+                    // A zero relative move makes no curve
+                    if (rel && v[0] == 0.0f) { break; }
+                    morph::vec<float, 2> f = { cur[0], o[1] + v[0] };
+                    BezCurve<float> c(cur, f);
+                    curves.addCurve (c);
+                    cur = f;
                     break;
                 }
-
-                case 'S': // shortcut cubic Bezier, absolute coordinates
-                case 's': // shortcut cubic Bezier, deltas
+                case 'C': case 'c':
                 {
-                    p2 = d.find_first_of (svgCmds, p1+1);
-                    std::string sCmd = d.substr (p1+1, p2-p1-1);
-                    if (morph::tools::containsOnlyWhitespace (sCmd)) {
-                        p3 = sCmd.size()-1;
-                    } else {
-                        std::vector<float> v = this->splitSvgCmdString (sCmd, cmd, 4, p3);
-                        if (v.size() != 4) {
-                            throw std::runtime_error ("Unexpected size of SVG path S command (expected 4 numbers)");
-                        }
-                        // c2 and currentCoordinate are stored locally in abs. coordinates:
-                        c1 = (currentCoordinate * 2) - c2;
-                        if (d[p1] == 's') { // delta coordinates
-                            // Deltas are determined from the currentCoordinate
-                            c2 = { currentCoordinate[0] + v[0], currentCoordinate[1] + v[1] };
-                            f =  { currentCoordinate[0] + v[2], currentCoordinate[1]  + v[3] };
-                        } else { // 'S', so absolute coordinates were given
-                            c2 = { v[0], v[1] };
-                            f =  { v[2], v[3] };
-                        }
-                        morph::BezCurve<float> c(currentCoordinate, f, c1, c2);
-                        curves.addCurve (c);
-                        currentCoordinate = f;
-                    }
+                    morph::vec<float, 2> c1 = { o[0] + v[0], o[1] + v[1] };
+                    morph::vec<float, 2> c2 = { o[0] + v[2], o[1] + v[3] };
+                    morph::vec<float, 2> f = { o[0] + v[4], o[1] + v[5] };
+                    BezCurve<float> c(cur, f, c1, c2);
+                    curves.addCurve (c);
+                    cur = f;
+                    lastctrl = c2;
                     break;
                 }
-
-                case 'Q':
-                case 'q': // Quadratic Bezier
+                case 'S': case 's':
                 {
-                    throw std::runtime_error ("Quadratic Bezier is unimplemented");
+                    // The first control point reflects the last one of a preceding C or S
+                    const bool follows = prev == 'C' || prev == 'c' || prev == 'S' || prev == 's';
+                    morph::vec<float, 2> c1 = follows ? (cur * 2.0f) - lastctrl : cur;
+                    morph::vec<float, 2> c2 = { o[0] + v[0], o[1] + v[1] };
+                    morph::vec<float, 2> f = { o[0] + v[2], o[1] + v[3] };
+                    BezCurve<float> c(cur, f, c1, c2);
+                    curves.addCurve (c);
+                    cur = f;
+                    lastctrl = c2;
                     break;
                 }
-                case 'T':
-                case 't': // Shortcut quadratic Bezier
+                case 'Q': case 'q':
                 {
-                    throw std::runtime_error ("Shortcut quadratic Bezier is unimplemented");
+                    morph::vec<float, 2> c1 = { o[0] + v[0], o[1] + v[1] };
+                    morph::vec<float, 2> f = { o[0] + v[2], o[1] + v[3] };
+                    BezCurve<float> c(cur, f, c1);
+                    curves.addCurve (c);
+                    cur = f;
+                    lastctrl = c1;
                     break;
                 }
-                case 'Z':
-                case 'z': // straight line from current position to first point of path.
+                case 'T': case 't':
                 {
-                    if (currentCoordinate != firstCoordinate) {
-                        BezCurve<float> c(currentCoordinate, firstCoordinate);
-                        curves.addCurve (c);
-                        currentCoordinate = firstCoordinate;
-                    }
+                    const bool follows = prev == 'Q' || prev == 'q' || prev == 'T' || prev == 't';
+                    morph::vec<float, 2> c1 = follows ? (cur * 2.0f) - lastctrl : cur;
+                    morph::vec<float, 2> f = { o[0] + v[0], o[1] + v[1] };
+                    BezCurve<float> c(cur, f, c1);
+                    curves.addCurve (c);
+                    cur = f;
+                    lastctrl = c1;
                     break;
                 }
-
-                default:
+                default: // An arc, which is approximated by a straight line to its end
+                {
+                    morph::vec<float, 2> f = { o[0] + v[5], o[1] + v[6] };
+                    BezCurve<float> c(cur, f);
+                    curves.addCurve (c);
+                    cur = f;
                     break;
                 }
-
-                if (p3 == std::string::npos) {
-                    p0 = p1+1;
-                    p1 = d.find_first_of (svgCmds, p0);
-                } else {
-                    p1 = p1+1+p3;
-                    if (p1+1 == p2) {
-                        // It's a new command!
-                        this->lastCmd = '\0';
-                    }
                 }
+                prev = cmd;
             }
-
             return curves;
         }
 
-        /*!
-         * Read a <line> element. Read x1,y1,x2,y2 attributes from which line length can be
-         * determined and lineToMillimetres populated.
-         */
-        void readLine (rapidxml::xml_node<>* line_node, const std::string& layerName)
-        {
-            std::string x1("");
-            rapidxml::xml_attribute<>* x1_attr;
-            if ((x1_attr = line_node->first_attribute ("x1"))) {
-                x1 = x1_attr->value();
-            } // else failed to get x1
-            if (x1.empty()) {
-                throw std::runtime_error ("Found a <line> element without a x1 attribute");
-            }
-            std::string x2("");
-            rapidxml::xml_attribute<>* x2_attr;
-            if ((x2_attr = line_node->first_attribute ("x2"))) {
-                x2 = x2_attr->value();
-            } // else failed to get x2
-            if (x2.empty()) {
-                throw std::runtime_error ("Found a <line> element without a x2 attribute");
-            }
-            std::string y1("");
-            rapidxml::xml_attribute<>* y1_attr;
-            if ((y1_attr = line_node->first_attribute ("y1"))) {
-                y1 = y1_attr->value();
-            } // else failed to get y1
-            if (y1.empty()) {
-                throw std::runtime_error ("Found a <line> element without a y1 attribute");
-            }
-            std::string y2("");
-            rapidxml::xml_attribute<>* y2_attr;
-            if ((y2_attr = line_node->first_attribute ("y2"))) {
-                y2 = y2_attr->value();
-            } // else failed to get y2
-            if (y2.empty()) {
-                throw std::runtime_error ("Found a <line> element without a y2 attribute");
-            }
-
-            // Now do something with x1,y1,x2,y2: Create a BezCurve object then add this
-            // to this->linePath
-            morph::vec<float, 2> p1;
-            p1[0] = static_cast<float>(std::atof (x1.c_str()));
-            p1[1] = static_cast<float>(std::atof (y1.c_str()));
-            morph::vec<float, 2> p2;
-            p2[0] = static_cast<float>(std::atof (x2.c_str()));
-            p2[1] = static_cast<float>(std::atof (y2.c_str()));
-            morph::BezCurve<float> linecurve (p1, p2);
-            this->linePath.reset();
-            this->linePath.initialCoordinate = p1;
-            this->linePath.addCurve (linecurve);
-
-            this->setupScaling (layerName);
-        }
-
         /*!
          * Set up the scaling in all BezCurvePaths based on lineToMillimetres. Do this after file
          * has been read.
@@ -831,7 +930,7 @@ namespace morph
          * lineToMillimetres[0] is the length of the line in the units of the SVG
          * file. lineToMillimeteres.second is the length in mm that the line represents.
          */
-        morph::vec<float, 2> lineToMillimetres;
+        morph::vec<float, 2> lineToMillimetres = { 0.0f, 0.0f };
 
         /*!
          * Set to true once a line was found to set lineToMillimetres.
@@ -852,12 +951,6 @@ namespace morph
          * the root node pointer.
          */
         rapidxml::xml_node<>* root_node = static_cast<rapidxml::xml_node<>*>(0);
-
-        /*!
-         * Records the last command. Used when a string of identical commands needs to be parsed by
-         * parseD.
-         */
-        char lastCmd = '\0';
     };
 
 } // namespace morph
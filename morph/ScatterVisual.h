@@ -10,9 +10,12 @@
 #include <morph/VisualDataModel.h>
 #include <morph/scale.h>
 #include <morph/vec.h>
+#include <morph/quaternion.h>
+#include <morph/point_density.h>
 #include <iostream>
 #include <vector>
 #include <array>
+#include <cstdint>
 
 namespace morph {
 
@@ -28,28 +31,50 @@ namespace morph {
             this->viewmatrix.translate (this->mv_offset);
             this->zScale.setParams (1, 0);
             this->colourScale.do_autoscale = true;
+            this->densityScale.do_autoscale = true;
         }
 
         //! Quick hack to add an additional point
         void add (morph::vec<float> coord, Flt value)
         {
-            std::array<float, 3> clr = this->cm.convert (this->colourScale.transform_one (value));
-            this->computeSphere (coord, clr, this->radiusFixed, 16, 20);
-            this->reinit_buffers();
+            this->add (coord, value, this->radiusFixed);
         }
         //! Additional point with variable size
         void add (morph::vec<float> coord, Flt value, Flt size)
         {
             std::array<float, 3> clr = this->cm.convert (this->colourScale.transform_one (value));
-            this->computeSphere (coord, clr, size, 16, 20);
-            this->reinit_buffers();
+            if (this->instanced) {
+                // Only the instance buffer needs to be re-written, unless there is no sphere yet
+                float r = static_cast<float>(size);
+                this->addInstance (coord, { r, r, r }, morph::quaternion<float>{}, clr);
+                if (this->indices.empty()) {
+                    if (this->sphere_impostors) {
+                        this->computeImpostorQuad (clr);
+                    } else {
+                        this->computeSphere (morph::vec<float>{0,0,0}, clr, 1.0f, 16, 20);
+                    }
+                    this->reinit_buffers();
+                } else {
+                    this->reinit_instances();
+                }
+            } else {
+                this->computeSphere (coord, clr, size, 16, 20);
+                this->reinit_buffers();
+            }
         }
 
-        //! Compute spheres for a scatter plot
+        //! Compute spheres for a scatter plot. If this->instanced is set, compute one unit sphere
+        //! and an instance for each point, which is much faster for large numbers of points. If
+        //! sphere_impostors is set too, the unit sphere is replaced by a quad on which the GPU
+        //! ray casts each sphere (see VisualModel::sphere_impostors).
         void initializeVertices()
         {
             unsigned int ncoords = this->dataCoords == nullptr ? 0 : this->dataCoords->size();
             if (ncoords == 0) { return; }
+            if (this->density) {
+                this->initializeDensity();
+                return;
+            }
             unsigned int ndata = this->scalarData == nullptr ? 0 : this->scalarData->size();
             // If we have vector data, then manipulate colour accordingly.
             unsigned int nvdata = this->vectorData == nullptr ? 0 : this->vectorData->size();
@@ -66,14 +91,9 @@ namespace morph {
             // Find the minimum distance between points to get a radius? Or just allow
             // client code to set it?
 
-            std::vector<Flt> dcopy;
-            std::vector<Flt> vdcopy1;
-            std::vector<Flt> vdcopy2;
-            std::vector<Flt> vdcopy3;
             if (ndata && !nvdata) {
-                dcopy = *(this->scalarData);
                 this->colourScale.do_autoscale = true;
-                this->colourScale.transform (*this->scalarData, dcopy);
+                this->transformScalarData (this->colourScale, this->dcopy);
             } else if (nvdata) {
                 vdcopy1.resize(this->vectorData->size());
                 vdcopy2.resize(this->vectorData->size());
@@ -100,6 +120,16 @@ namespace morph {
 
             } // else no scaling required - spheres will be one colour
 
+            // In instanced mode, the model is a single unit sphere (or impostor quad), drawn once per point
+            if (this->instanced) {
+                this->clearInstances();
+                if (this->sphere_impostors) {
+                    this->computeImpostorQuad (this->cm.getHueRGB());
+                } else {
+                    this->computeSphere (morph::vec<float>{0,0,0}, this->cm.getHueRGB(), 1.0f, 16, 20);
+                }
+            }
+
             for (unsigned int i = 0; i < ncoords; ++i) {
                 // Scale colour (or use single colour)
                 std::array<float, 3> clr = this->cm.getHueRGB();
@@ -111,7 +141,10 @@ namespace morph {
                     //std::cout << "Convert colour from vdcopy1[i]: " << vdcopy1[i] << ", vdcopy2[i]: " << vdcopy2[i] << std::endl;
                     clr = this->cm.convert (vdcopy1[i], vdcopy2[i]);
                 }
-                if (this->sizeFactor == Flt{0}) {
+                if (this->instanced) {
+                    float r = static_cast<float>(this->sizeFactor == Flt{0} ? this->radiusFixed : dcopy[i] * this->sizeFactor);
+                    this->addInstance ((*this->dataCoords)[i], { r, r, r }, morph::quaternion<float>{}, clr);
+                } else if (this->sizeFactor == Flt{0}) {
                     if constexpr (draw_spheres_as_geodesics) {
                         // Slower than regular computeSphere(). 2 iterations gives 320 faces
                         this->template computeSphereGeoFast<float, 2> ((*this->dataCoords)[i], clr, this->radiusFixed);
@@ -146,6 +179,31 @@ namespace morph {
             this->reinit();
         }
 
+        /*!
+         * If true, draw the density of the points instead of a sphere for each point. The
+         * points are binned by x and y into density_bins bins covering the density window,
+         * and each bin that holds any points is drawn as a flat rectangle at z = density_z,
+         * coloured by cm from densityScale of its count. The cost of drawing is then set by
+         * the number of bins rather than the number of points.
+         */
+        bool density = false;
+        morph::vec<unsigned int, 2> density_bins = { 256u, 256u };
+        float density_z = 0.0f;
+        //! Scales the bin counts for the colour map. Autoscaled on each binning while do_autoscale is set.
+        morph::scale<float> densityScale;
+        //! The number of points in each bin in the last binning (bin (i, j) is element j * density_bins[0] + i)
+        std::vector<std::uint32_t> density_counts;
+
+        //! Bin just the points from lo to hi, as on zooming in, and rebuild the model
+        void setDensityWindow (const morph::vec<float, 2>& lo, const morph::vec<float, 2>& hi)
+        {
+            this->density_lo = lo;
+            this->density_hi = hi;
+            this->reinit();
+        }
+        //! Bin all the points again, over the extent of the data
+        void clearDensityWindow() { this->setDensityWindow ({ 0.0f, 0.0f }, { 0.0f, 0.0f }); }
+
         //! Change this to get larger or smaller spheres.
         Flt radiusFixed = Flt{0.05};
         Flt sizeFactor = Flt{0};
@@ -160,6 +218,78 @@ namespace morph {
 
         morph::vec<float, 3> labelOffset = { 0.04f, 0.0f, 0.0f };
         float labelSize = 0.03f;
+
+    protected:
+        //! Bin the points and make a rectangle for each bin that holds any
+        void initializeDensity()
+        {
+            const std::vector<vec<float, 3>>& p = *this->dataCoords;
+            morph::vec<float, 2> lo = this->density_lo;
+            morph::vec<float, 2> hi = this->density_hi;
+            if (!(hi[0] > lo[0] && hi[1] > lo[1])) {
+                const std::array<morph::vec<float, 2>, 2> ex = morph::point_density::extent (p);
+                lo = ex[0];
+                hi = ex[1];
+                // Points all in a line still make a window with some width
+                for (unsigned int d = 0; d < 2; ++d) {
+                    if (!(hi[d] > lo[d])) { lo[d] -= 0.5f; hi[d] += 0.5f; }
+                }
+            }
+            const unsigned int nx = this->density_bins[0];
+            this->density_counts = morph::point_density::histogram (p, this->density_bins, lo, hi);
+
+            std::vector<unsigned int> filled;
+            std::vector<float> dens;
+            for (unsigned int k = 0; k < this->density_counts.size(); ++k) {
+                if (this->density_counts[k] == 0u) { continue; }
+                filled.push_back (k);
+                dens.push_back (static_cast<float>(this->density_counts[k]));
+            }
+            if (filled.empty()) { return; }
+            if (this->densityScale.do_autoscale) { this->densityScale.reset(); }
+            std::vector<float> dscaled (dens.size());
+            this->densityScale.transform (dens, dscaled);
+
+            const morph::vec<float, 2> bw = { (hi[0] - lo[0]) / static_cast<float>(nx),
+                                              (hi[1] - lo[1]) / static_cast<float>(this->density_bins[1]) };
+            const std::size_t nq = filled.size();
+            const std::size_t v0 = this->vertexPositions.size() / 3;
+            const std::size_t i0 = this->indices.size();
+            this->vertexPositions.resize (3 * (v0 + 4 * nq));
+            this->vertexNormals.resize (3 * (v0 + 4 * nq));
+            this->vertexColors.resize (3 * (v0 + 4 * nq));
+            this->indices.resize (i0 + 6 * nq);
+            const GLuint idx0 = this->idx;
+            morph::parallel_for (std::size_t{0}, nq, [&](std::size_t q) {
+                const float x0 = lo[0] + bw[0] * static_cast<float>(filled[q] % nx);
+                const float y0 = lo[1] + bw[1] * static_cast<float>(filled[q] / nx);
+                const std::array<morph::vec<float>, 4> c = { morph::vec<float>{ x0, y0, this->density_z },
+                                                             morph::vec<float>{ x0 + bw[0], y0, this->density_z },
+                                                             morph::vec<float>{ x0 + bw[0], y0 + bw[1], this->density_z },
+                                                             morph::vec<float>{ x0, y0 + bw[1], this->density_z } };
+                const std::array<float, 3> clr = this->cm.convert (dscaled[q]);
+                const std::size_t v = v0 + 4 * q;
+                for (unsigned int j = 0; j < 4u; ++j) {
+                    this->vertex_set (c[j], this->vertexPositions, 3 * (v + j));
+                    this->vertex_set (morph::vec<float>{ 0.0f, 0.0f, 1.0f }, this->vertexNormals, 3 * (v + j));
+                    this->vertex_set (clr, this->vertexColors, 3 * (v + j));
+                }
+                const GLuint b = idx0 + static_cast<GLuint>(4 * q);
+                const std::array<GLuint, 6> tri = { b, b + 1, b + 2, b, b + 2, b + 3 };
+                std::copy (tri.begin(), tri.end(), this->indices.begin() + i0 + 6 * q);
+            });
+            this->idx += static_cast<GLuint>(4 * nq);
+        }
+
+        //! The density window set by setDensityWindow (the extent of the data if hi is not above lo)
+        morph::vec<float, 2> density_lo = { 0.0f, 0.0f };
+        morph::vec<float, 2> density_hi = { 0.0f, 0.0f };
+
+        //! Scaled copies of the data, kept to reuse their memory on each update
+        std::vector<Flt> dcopy;
+        std::vector<Flt> vdcopy1;
+        std::vector<Flt> vdcopy2;
+        std::vector<Flt> vdcopy3;
     };
 
 } // namespace morph
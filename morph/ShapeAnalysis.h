@@ -30,78 +30,133 @@ namespace morph {
     };
 
     /*!
-     * A helper class, containing pattern analysis code to analyse patterns within HexGrids.
+     * Finds contours on a HexGrid from the flat d_flags and d_ neighbour vectors, rather than
+     * by walking the list of Hexes. The fields are processed in parallel and the results are
+     * lists of vector indices, held in buffers that are reused from one call to the next, so
+     * keep one hex_contours per grid when contours are needed at every save step.
+     *
+     * A hex is on the contour of a field if its value is at or above the threshold and a
+     * neighbour's is below it. A boundary hex (one lacking a neighbour) is on the contour if its value is at or above
+     * the threshold (find()) or never (find_nonorm()). The HexGrid must outlive the
+     * hex_contours. Any grid with the same num(), d_flags and d_ neighbour vectors, such as a
+     * HexGridFlat, may be given as G.
      */
-    template <typename Flt>
-    class ShapeAnalysis
+    template <typename Flt, typename G = HexGrid>
+    class hex_contours
     {
     public:
+        explicit hex_contours (const G& _hg) : hg(&_hg) {}
 
         /*!
-         * Obtain the contours (as a vector of list<Hex>) in the scalar fields f, where threshold is
-         * crossed.
+         * Find the contours of the fields f, after normalising them together to [0,1] using
+         * the minimum and maximum over all the fields in the hexes with six neighbours. Returns
+         * one ascending index list per field.
          */
-        static std::vector<std::list<Hex> > get_contours (HexGrid* hg,
-                                                          std::vector<std::vector<Flt> >& f,
-                                                          Flt threshold) {
-
-            unsigned int nhex = hg->num();
-            unsigned int N = f.size();
-
-            std::vector<std::list<Hex> > rtn;
-            // Initialise
-            for (unsigned int li = 0; li < N; ++li) {
-                std::list<Hex> lh;
-                rtn.push_back (lh);
-            }
-
+        const std::vector<std::vector<unsigned int>>& find (const std::vector<std::vector<Flt>>& f, const Flt threshold)
+        {
+            const unsigned int nhex = this->hg->num();
+            const unsigned int* flags = this->hg->d_flags.data();
             Flt maxf = -1e7;
             Flt minf = +1e7;
-            for (auto h : hg->hexen) {
-                if (h.onBoundary() == false) {
-                    for (unsigned int i = 0; i<N; ++i) {
-                        if (f[i][h.vi] > maxf) { maxf = f[i][h.vi]; }
-                        if (f[i][h.vi] < minf) { minf = f[i][h.vi]; }
-                    }
+            for (const std::vector<Flt>& fi : f) {
+                if (fi.size() != nhex) { throw std::runtime_error ("hex_contours::find: a field has the wrong size"); }
+                for (unsigned int h = 0; h < nhex; ++h) {
+                    if (hex_contours<Flt, G>::on_boundary (flags[h])) { continue; }
+                    if (fi[h] > maxf) { maxf = fi[h]; }
+                    if (fi[h] < minf) { minf = fi[h]; }
                 }
             }
-            Flt scalef = 1.0 / (maxf-minf);
-
-            // Re-normalize
-            std::vector<std::vector<Flt> > norm_f;
-            norm_f.resize (N);
-            for (unsigned int i=0; i<N; ++i) {
-                norm_f[i].resize (nhex, 0.0);
+            const Flt scalef = 1.0 / (maxf - minf);
+            this->contours.resize (f.size());
+            const int N = static_cast<int>(f.size());
+#pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < N; ++i) {
+                this->collate (f[i], minf, scalef, threshold, true, this->contours[i]);
             }
+            return this->contours;
+        }
 
-            for (unsigned int i = 0; i<N; ++i) {
-                for (unsigned int h=0; h<nhex; h++) {
-                    norm_f[i][h] = (f[i][h] - minf) * scalef;
-                }
+        //! Find the contour of the single field f without normalising it. Boundary hexes are excluded.
+        const std::vector<unsigned int>& find_nonorm (const std::vector<Flt>& f, const Flt threshold)
+        {
+            if (f.size() != this->hg->num()) { throw std::runtime_error ("hex_contours::find_nonorm: the field has the wrong size"); }
+            this->contours.resize (1);
+            this->collate (f, Flt{0}, Flt{1}, threshold, false, this->contours[0]);
+            return this->contours[0];
+        }
+
+        /*!
+         * Write the contours of the last find() into map, one value per hex: i/N for the
+         * hexes on the contour of field i of N (or (i+1)/(N+1) if nozero), and 0 elsewhere.
+         * Where contours overlap, the higher field wins.
+         */
+        void contour_map (std::vector<Flt>& map, const bool nozero = false) const
+        {
+            map.assign (this->hg->num(), Flt{0});
+            const unsigned int N = this->contours.size();
+            for (unsigned int i = 0; i < N; ++i) {
+                const Flt val = nozero ? (Flt)(i+1)/(Flt)(N+1) : (Flt)i/(Flt)N;
+                for (unsigned int vi : this->contours[i]) { map[vi] = val; }
             }
+        }
 
-            // Collate
-            for (unsigned int i = 0; i<N; ++i) {
-                for (auto h : hg->hexen) {
-                    if (h.onBoundary() == false) {
-                        if (norm_f[i][h.vi] >= threshold) {
-                            if ( (h.has_ne() && norm_f[i][h.ne->vi] < threshold)
-                                 || (h.has_nne() && norm_f[i][h.nne->vi] < threshold)
-                                 || (h.has_nnw() && norm_f[i][h.nnw->vi] < threshold)
-                                 || (h.has_nw() && norm_f[i][h.nw->vi] < threshold)
-                                 || (h.has_nsw() && norm_f[i][h.nsw->vi] < threshold)
-                                 || (h.has_nse() && norm_f[i][h.nse->vi] < threshold) ) {
-                                rtn[i].push_back (h);
-                            }
-                        }
-                    } else { // h.onBoundary() is true
-                        if (norm_f[i][h.vi] >= threshold) {
-                            rtn[i].push_back (h);
-                        }
-                    }
+        //! The contours found by the last call of find() or find_nonorm()
+        std::vector<std::vector<unsigned int>> contours;
+
+    protected:
+        const G* hg;
+
+        //! As Hex::onBoundary(): a hex lacking any of its six neighbours is on the boundary
+        static bool on_boundary (const unsigned int flags)
+        {
+            return (flags & HEX_HAS_NEIGHB_ALL) != HEX_HAS_NEIGHB_ALL;
+        }
+
+        //! Append to out the hexes on the contour of f, normalised as (f - minf) * scalef
+        void collate (const std::vector<Flt>& f, const Flt minf, const Flt scalef, const Flt threshold,
+                      const bool boundary_in, std::vector<unsigned int>& out) const
+        {
+            out.clear();
+            const unsigned int nhex = this->hg->num();
+            const unsigned int* flags = this->hg->d_flags.data();
+            const std::vector<int>* nb[6] = { &this->hg->d_ne, &this->hg->d_nne, &this->hg->d_nnw,
+                                              &this->hg->d_nw, &this->hg->d_nsw, &this->hg->d_nse };
+            auto below = [&f, minf, scalef, threshold](const int j) { return j >= 0 && (f[j] - minf) * scalef < threshold; };
+            for (unsigned int h = 0; h < nhex; ++h) {
+                if ((f[h] - minf) * scalef < threshold) { continue; }
+                if (hex_contours<Flt, G>::on_boundary (flags[h])) {
+                    if (boundary_in) { out.push_back (h); }
+                    continue;
+                }
+                for (const std::vector<int>* n : nb) {
+                    if (below ((*n)[h])) { out.push_back (h); break; }
                 }
             }
+        }
+    };
 
+    /*!
+     * A helper class, containing pattern analysis code to analyse patterns within HexGrids.
+     */
+    template <typename Flt>
+    class ShapeAnalysis
+    {
+    public:
+
+        /*!
+         * Obtain the contours (as a vector of list<Hex>) in the scalar fields f, where threshold is
+         * crossed. hex_contours::find() gives the same contours as lists of indices, without
+         * copying any Hexes.
+         */
+        static std::vector<std::list<Hex> > get_contours (HexGrid* hg,
+                                                          std::vector<std::vector<Flt> >& f,
+                                                          Flt threshold) {
+            hex_contours<Flt> hc (*hg);
+            const std::vector<std::vector<unsigned int>>& c = hc.find (f, threshold);
+            std::vector<std::list<Hex> > rtn (c.size());
+            for (unsigned int i = 0; i < c.size(); ++i) {
+                for (unsigned int vi : c[i]) { rtn[i].push_back (*hg->vhexen[vi]); }
+            }
             return rtn;
         }
 
@@ -112,81 +167,19 @@ namespace morph {
         static std::vector<Flt> get_contour_map (HexGrid* hg,
                                                  std::vector<std::vector<Flt> >& f,
                                                  Flt threshold) {
-
-            unsigned int nhex = hg->num();
-            unsigned int N = f.size();
-
-            std::vector<Flt> rtn (nhex, 0.0);
-
-            Flt maxf = -1e7;
-            Flt minf = +1e7;
-            for (auto h : hg->hexen) {
-                if (h.onBoundary() == false) {
-                    for (unsigned int i = 0; i<N; ++i) {
-                        if (f[i][h.vi] > maxf) { maxf = f[i][h.vi]; }
-                        if (f[i][h.vi] < minf) { minf = f[i][h.vi]; }
-                    }
-                }
-            }
-            Flt scalef = 1.0 / (maxf-minf);
-
-            // Re-normalize
-            std::vector<std::vector<Flt> > norm_f;
-            norm_f.resize (N);
-            for (unsigned int i=0; i<N; ++i) {
-                norm_f[i].resize (nhex, 0.0);
-            }
-
-            for (unsigned int i = 0; i<N; ++i) {
-                for (unsigned int h=0; h<nhex; h++) {
-                    norm_f[i][h] = (f[i][h] - minf) * scalef;
-                }
-            }
-
-            // Collate
-            for (unsigned int i = 0; i<N; ++i) {
-                for (auto h : hg->hexen) {
-                    if (h.onBoundary() == false) {
-                        if (norm_f[i][h.vi] >= threshold) {
-                            if ( (h.has_ne() && norm_f[i][h.ne->vi] < threshold)
-                                 || (h.has_nne() && norm_f[i][h.nne->vi] < threshold)
-                                 || (h.has_nnw() && norm_f[i][h.nnw->vi] < threshold)
-                                 || (h.has_nw() && norm_f[i][h.nw->vi] < threshold)
-                                 || (h.has_nsw() && norm_f[i][h.nsw->vi] < threshold)
-                                 || (h.has_nse() && norm_f[i][h.nse->vi] < threshold) ) {
-                                rtn[h.vi] = (Flt)i/(Flt)N;
-                            }
-                        }
-                    } else { // h.onBoundary() is true
-                        if (norm_f[i][h.vi] >= threshold) {
-                            rtn[h.vi] = (Flt)i/(Flt)N;
-                        }
-                    }
-                }
-            }
-
+            hex_contours<Flt> hc (*hg);
+            std::vector<Flt> rtn;
+            hc.find (f, threshold);
+            hc.contour_map (rtn, false);
             return rtn;
         }
 
         //! Like get_contour_map, but no pre-normalizing and sets contours to the flag value
         //! (used by SPW in SOM model analysis steps)
         static std::vector<Flt> get_contour_map_flag_nonorm (HexGrid* hg,std::vector<Flt> & f, Flt threshold, Flt flagVal) {
-            unsigned int nhex = hg->num();
-            std::vector<Flt> rtn (nhex, 0.0);
-            for (auto h : hg->hexen) {
-                if (h.onBoundary() == false) {
-                    if (f[h.vi] >= threshold) {
-                        if ((h.has_ne() && f[h.ne->vi] < threshold)
-                            || (h.has_nne() && f[h.nne->vi] < threshold)
-                            || (h.has_nnw() && f[h.nnw->vi] < threshold)
-                            || (h.has_nw() && f[h.nw->vi] < threshold)
-                            || (h.has_nsw() && f[h.nsw->vi] < threshold)
-                            || (h.has_nse() && f[h.nse->vi] < threshold) ) {
-                            rtn[h.vi] = flagVal;
-                        }
-                    }
-                }
-            }
+            hex_contours<Flt> hc (*hg);
+            std::vector<Flt> rtn (hg->num(), 0.0);
+            for (unsigned int vi : hc.find_nonorm (f, threshold)) { rtn[vi] = flagVal; }
             return rtn;
         }
 
@@ -196,59 +189,10 @@ namespace morph {
         static std::vector<Flt> get_contour_map_nozero (HexGrid* hg,
                                                         std::vector<std::vector<Flt> >& f,
                                                         Flt threshold) {
-
-            unsigned int nhex = hg->num();
-            unsigned int N = f.size();
-
-            std::vector<Flt> rtn (nhex, 0.0);
-
-            Flt maxf = -1e7;
-            Flt minf = +1e7;
-            for (auto h : hg->hexen) {
-                if (h.onBoundary() == false) {
-                    for (unsigned int i = 0; i<N; ++i) {
-                        if (f[i][h.vi] > maxf) { maxf = f[i][h.vi]; }
-                        if (f[i][h.vi] < minf) { minf = f[i][h.vi]; }
-                    }
-                }
-            }
-            Flt scalef = 1.0 / (maxf-minf);
-
-            // Re-normalize
-            std::vector<std::vector<Flt> > norm_f;
-            norm_f.resize (N);
-            for (unsigned int i=0; i<N; ++i) {
-                norm_f[i].resize (nhex, 0.0);
-            }
-
-            for (unsigned int i = 0; i<N; ++i) {
-                for (unsigned int h=0; h<nhex; h++) {
-                    norm_f[i][h] = (f[i][h] - minf) * scalef;
-                }
-            }
-
-            // Collate
-            for (unsigned int i = 0; i<N; ++i) {
-                for (auto h : hg->hexen) {
-                    if (h.onBoundary() == false) {
-                        if (norm_f[i][h.vi] >= threshold) {
-                            if ( (h.has_ne() && norm_f[i][h.ne->vi] < threshold)
-                                 || (h.has_nne() && norm_f[i][h.nne->vi] < threshold)
-                                 || (h.has_nnw() && norm_f[i][h.nnw->vi] < threshold)
-                                 || (h.has_nw() && norm_f[i][h.nw->vi] < threshold)
-                                 || (h.has_nsw() && norm_f[i][h.nsw->vi] < threshold)
-                                 || (h.has_nse() && norm_f[i][h.nse->vi] < threshold) ) {
-                                rtn[h.vi] = (Flt)(i+1)/(Flt)(N+1); // only this line...
-                            }
-                        }
-                    } else { // h.onBoundary() is true
-                        if (norm_f[i][h.vi] >= threshold) {
-                            rtn[h.vi] = (Flt)(i+1)/(Flt)(N+1); // ...and this line differ from get_contour_map()
-                        }
-                    }
-                }
-            }
-
+            hex_contours<Flt> hc (*hg);
+            std::vector<Flt> rtn;
+            hc.find (f, threshold);
+            hc.contour_map (rtn, true);
             return rtn;
         }
 
@@ -265,15 +209,14 @@ namespace morph {
             std::vector<Flt> rtn (f[0].size(), 0.0);
 
             // Mark regions first.
-            for (auto h : hg->hexen) {
-
+            const int nhex = static_cast<int>(hg->num());
+#pragma omp parallel for schedule(static)
+            for (int h = 0; h < nhex; ++h) {
                 Flt maxf = -1e7;
                 for (unsigned int i = 0; i<N; ++i) {
-                    if (f[i][h.vi] > maxf) {
-                        maxf = f[i][h.vi];
-                        Flt fi = 0.0f;
-                        fi = (Flt)i;
-                        rtn[h.vi] = (fi/N);
+                    if (f[i][h] > maxf) {
+                        maxf = f[i][h];
+                        rtn[h] = static_cast<Flt>(i) / N;
                     }
                 }
             }
@@ -1045,4 +988,128 @@ namespace morph {
 
     }; // ShapeAnalysis
 
+    /*!
+     * The Dirichlet domain analysis of ShapeAnalysis::dirichlet_vertices, kept from one call to
+     * the next. Domains are labelled by a dirichlet_labels, the vertex test runs in parallel
+     * and, after the first call, only the hexes whose identity (or a neighbour's) changed are
+     * re-tested and only the domains that changed are walked again; the others are taken from
+     * the last call. Keep one dirichlet_analysis for the HexGrid and call analyse() at each
+     * analysis point. The HexGrid must outlive it.
+     */
+    template <typename Flt>
+    class dirichlet_analysis
+    {
+    public:
+        explicit dirichlet_analysis (HexGrid* _hg)
+            : hg(_hg)
+            , labels(*_hg)
+            , hexit(_hg->num())
+            , hex_vertices(_hg->num())
+        {
+            for (auto h = this->hg->hexen.begin(); h != this->hg->hexen.end(); ++h) {
+                this->hexit[h->vi] = h;
+                this->list_order.push_back (h->vi);
+            }
+        }
+
+        /*!
+         * As ShapeAnalysis::dirichlet_vertices: find the vertices of the identity map f (into
+         * \a vertices, which is cleared first) and return the domains they outline, in the same
+         * order. Areas come from the labels (see DirichDom::compute_area). The number of hexes
+         * revisited by the labelling is left in revisited.
+         */
+        std::list<DirichDom<Flt>> analyse (std::vector<Flt>& f, std::list<DirichVtx<Flt>>& vertices)
+        {
+            this->revisited = this->labels.update (f);
+            const std::vector<int>& retest = this->labels.touched;
+            const int nretest = static_cast<int>(retest.size());
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int i = 0; i < nretest; ++i) {
+                const int h = retest[i];
+                this->hex_vertices[h].clear();
+                ShapeAnalysis<Flt>::vertex_test (this->hg, f, this->hexit[h], this->hex_vertices[h]);
+            }
+            if (this->labels.relabelled_all) { this->walks.clear(); }
+            this->walks.resize (this->labels.domains.size());
+            for (int d = 0; d < static_cast<int>(this->walks.size()); ++d) {
+                if (this->labels.fresh (d)) { this->walks[d] = walk{}; }
+            }
+
+            // The vertex list, in the order of hexen. Vertices of unchanged domains keep the
+            // closed flags of their last walk; the others are walked afresh.
+            vertices.clear();
+            std::vector<std::pair<int, int>> key;
+            for (int h : this->list_order) {
+                const bool fresh = this->labels.fresh (this->labels.label[h]);
+                int k = 0;
+                for (DirichVtx<Flt> v : this->hex_vertices[h]) {
+                    if (fresh) { v.closed = false; }
+                    vertices.push_back (v);
+                    key.push_back ({ h, k++ });
+                }
+            }
+
+            std::vector<DirichDom<Flt>> doms;
+            std::vector<std::pair<std::size_t, int>> walked;
+            auto dv = vertices.begin();
+            for (std::size_t vk = 0; dv != vertices.end(); ++vk, ++dv) {
+                const int d = this->labels.label[key[vk].first];
+                if (!this->labels.fresh (d)) {
+                    if (this->walks[d].found && this->walks[d].key == key[vk]) { doms.push_back (this->walks[d].dom); }
+                    continue;
+                }
+                if (dv->hi->boundaryHex() == true) {
+                    dv->closed = true;
+                    continue;
+                }
+                DirichDom<Flt> one_domain;
+                DirichVtx<Flt> first_vtx;
+                if (ShapeAnalysis<Flt>::process_domain (this->hg, f, dv, vertices, one_domain, first_vtx)) {
+                    one_domain.f = one_domain.vertices.front().f;
+                    one_domain.compute_area (this->labels);
+                    if (!this->walks[d].found) {
+                        this->walks[d].found = true;
+                        this->walks[d].key = key[vk];
+                        walked.push_back ({ doms.size(), d });
+                    }
+                    doms.push_back (one_domain);
+                }
+            }
+            const int nwalked = static_cast<int>(walked.size());
+#pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < nwalked; ++i) { doms[walked[i].first].compute_edge_deviation(); }
+            for (const auto& w : walked) { this->walks[w.second].dom = doms[w.first]; }
+
+            // Keep the closed flags for the next call
+            auto vi = vertices.begin();
+            for (int h : this->list_order) {
+                for (DirichVtx<Flt>& v : this->hex_vertices[h]) { v.closed = (vi++)->closed; }
+            }
+            return std::list<DirichDom<Flt>> (doms.begin(), doms.end());
+        }
+
+        //! The domain labels of the last call
+        const dirichlet_labels<Flt>& get_labels() const { return this->labels; }
+
+        //! The number of hexes the labelling of the last call revisited
+        unsigned int revisited = 0;
+
+    protected:
+        HexGrid* hg;
+        dirichlet_labels<Flt> labels;
+        //! The Hex of each vector index, and the vector indices in the order of hexen
+        std::vector<std::list<Hex>::iterator> hexit;
+        std::vector<int> list_order;
+        //! The vertices found on each hex by ShapeAnalysis::vertex_test
+        std::vector<std::list<DirichVtx<Flt>>> hex_vertices;
+        //! The outcome of the last walk of each domain: found, from which vertex, and the domain
+        struct walk
+        {
+            bool found = false;
+            std::pair<int, int> key = { -1, -1 };
+            DirichDom<Flt> dom;
+        };
+        std::vector<walk> walks;
+    };
+
 } // namespace morph
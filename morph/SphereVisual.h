@@ -4,6 +4,7 @@
 #pragma once
 
 #include <morph/vec.h>
+#include <morph/quaternion.h>
 #include <morph/VisualModel.h>
 #include <morph/mathconst.h>
 #include <array>
@@ -35,7 +36,15 @@ namespace morph {
 
         void initializeVertices()
         {
-            this->computeSphere ({0,0,0}, this->sphere_colour, this->radius);
+            if (this->sphere_impostors) {
+                // One instance of the impostor quad, ray cast as the sphere
+                this->instanced = true;
+                this->clearInstances();
+                this->addInstance ({0,0,0}, { this->radius, this->radius, this->radius }, morph::quaternion<float>{}, this->sphere_colour);
+                this->computeImpostorQuad (this->sphere_colour);
+            } else {
+                this->computeSphere ({0,0,0}, this->sphere_colour, this->radius);
+            }
         }
 
         //! The radius of the sphere
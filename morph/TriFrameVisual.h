@@ -44,11 +44,9 @@ namespace morph {
             unsigned int ncoords = this->dataCoords->size();
             unsigned int ndata = this->scalarData->size();
 
-            std::vector<Flt> dcopy;
             if (ndata) {
-                dcopy = *(this->scalarData);
                 this->colourScale.do_autoscale = true;
-                this->colourScale.transform (*this->scalarData, dcopy);
+                this->transformScalarData (this->colourScale, this->dcopy);
             } // else no scaling required - spheres will be one colour
 
             // Draw spheres
@@ -77,6 +75,8 @@ namespace morph {
         int tseg = 12;
         //! A colour map for the spheres
         morph::ColourMap<float> cm_sph;
+        //! The colour-scaled scalarData, kept to reuse its memory on each update
+        std::vector<float> dcopy;
     };
 
 } // namespace morph
@@ -66,25 +66,47 @@ namespace morph {
             this->init_gl();
         }
 
+        /*!
+         * Construct a new visualiser with a window whose OpenGL context shares objects with that
+         * of \a _share_with. The Visuals share compiled shader programs and font textures, so
+         * these are made once however many windows there are. _share_with may be destroyed
+         * before this Visual; the shared resources are freed with the last Visual of the group.
+         */
+        Visual (const int _width, const int _height, const std::string& _title,
+                Visual<glver>& _share_with, const bool _version_stdout = true)
+        {
+            this->window_w = _width;
+            this->window_h = _height;
+            this->title = _title;
+
+            this->version_stdout = _version_stdout;
+            this->share_with = &_share_with;
+            this->init_resources (_share_with.window);
+            this->init_gl();
+        }
+
         //! Deconstructor destroys GLFW/Qt window and deregisters access to VisualResources
         virtual ~Visual()
         {
             this->setContext();
+            // Any saveImageAsync() frames must be collected while the context still exists
+            this->free_captures();
             glfwDestroyWindow (this->window);
             this->deconstructCommon();
         }
 
         // Do one-time init of the Visual's resources. This gets/creates the VisualResources,
         // registers this visual with resources, calls init_window for any glfw stuff that needs to
-        // happen, and lastly initializes the freetype code.
-        void init_resources()
+        // happen, and lastly initializes the freetype code. If share_window is not null, the new
+        // window's context shares objects with share_window's.
+        void init_resources (GLFWwindow* share_window = nullptr)
         {
             morph::VisualGlfw<glver>::i().init(); // Init GLFW windows system
             // VisualResources provides font management. Ensure it exists in memory.
             morph::VisualResources<glver>::i().create();
             // Set up the window that will present the OpenGL graphics.  This has to
             // happen BEFORE the call to VisualResources::freetype_init()
-            this->init_window();
+            this->init_window (share_window);
             this->setContext(); // For freetype_init
             this->freetype_init();
             this->releaseContext();
@@ -167,17 +189,30 @@ namespace morph {
 
         /*!
          * Keep on rendering until readToFinish is set true. Used to keep a window open, and
-         * responsive, while displaying the result of a simulation. FIXME: This won't work for two
-         * or more windows because it will block.
+         * responsive, while displaying the result of a simulation. With render_on_demand set,
+         * this sleeps until there is an event (or request_render() is called) whenever there is
+         * nothing new to draw. FIXME: This won't work for two or more windows because it will
+         * block.
          */
         void keepOpen()
         {
             while (this->readyToFinish == false) {
-                glfwWaitEventsTimeout (0.01667); // 16.67 ms ~ 60 Hz
+                if (this->render_on_demand == true && this->needs_render() == false && this->builds_pending() == false) {
+                    glfwWaitEvents();
+                } else {
+                    glfwWaitEventsTimeout (0.01667); // 16.67 ms ~ 60 Hz
+                }
                 this->render();
             }
         }
 
+        //! Request a render, and wake the event loop if it is waiting in glfwWaitEvents()
+        void request_render() override
+        {
+            morph::VisualOwnable<glver>::request_render();
+            glfwPostEmptyEvent();
+        }
+
         //! Wrapper around the glfw polling function
         void poll() { glfwPollEvents(); }
         //! A wait-for-events with a timeout wrapper
@@ -197,9 +232,9 @@ namespace morph {
 
     private:
 
-        void init_window()
+        void init_window (GLFWwindow* share_window)
         {
-            this->window = glfwCreateWindow (this->window_w, this->window_h, this->title.c_str(), NULL, NULL);
+            this->window = glfwCreateWindow (this->window_w, this->window_h, this->title.c_str(), NULL, share_window);
             if (!this->window) {
                 // Window or OpenGL context creation failed
                 throw std::runtime_error("GLFW window creation failed!");
@@ -214,6 +249,7 @@ namespace morph {
             glfwSetWindowSizeCallback (this->window, window_size_callback_dispatch);
             glfwSetWindowCloseCallback (this->window, window_close_callback_dispatch);
             glfwSetScrollCallback (this->window, scroll_callback_dispatch);
+            glfwSetWindowRefreshCallback (this->window, window_refresh_callback_dispatch);
 
             glfwMakeContextCurrent (this->window);
 
@@ -231,6 +267,7 @@ namespace morph {
         {
             Visual<glver>* self = static_cast<Visual<glver>*>(glfwGetWindowUserPointer (_window));
             if (self->key_callback (key, scancode, action, mods)) {
+                self->render_requested = true;
                 self->render();
             }
         }
@@ -243,6 +280,7 @@ namespace morph {
         {
             Visual<glver>* self = static_cast<Visual<glver>*>(glfwGetWindowUserPointer (_window));
             if (self->cursor_position_callback (x, y)) {
+                self->render_requested = true;
                 self->render();
             }
         }
@@ -250,9 +288,16 @@ namespace morph {
         {
             Visual<glver>* self = static_cast<Visual<glver>*>(glfwGetWindowUserPointer (_window));
             if (self->window_size_callback (width, height)) {
+                self->render_requested = true;
                 self->render();
             }
         }
+        // The window system has lost the window's contents, so the next frame must be drawn
+        static void window_refresh_callback_dispatch (GLFWwindow* _window)
+        {
+            Visual<glver>* self = static_cast<Visual<glver>*>(glfwGetWindowUserPointer (_window));
+            self->render_requested = true;
+        }
         static void window_close_callback_dispatch (GLFWwindow* _window)
         {
             Visual<glver>* self = static_cast<Visual<glver>*>(glfwGetWindowUserPointer (_window));
@@ -262,6 +307,7 @@ namespace morph {
         {
             Visual<glver>* self = static_cast<Visual<glver>*>(glfwGetWindowUserPointer (_window));
             if (self->scroll_callback (xoffset, yoffset)) {
+                self->render_requested = true;
                 self->render();
             }
         }
@@ -0,0 +1,349 @@
+/*!
+ * \file
+ *
+ * Declares VisualBatch, which draws the static VisualModels of a Visual from shared buffers
+ * with a single multi-draw indirect call.
+ */
+
+#pragma once
+
+#if defined __gl3_h_ || defined __gl_h_
+// GL headers have been externally included
+#else
+# error "GL headers should have been included already"
+#endif
+
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/VisualCommon.h>
+#include <morph/VisualModel.h>
+#include <morph/mat44.h>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstddef>
+
+namespace morph {
+
+    /*!
+     * A batch of the static VisualModels of one Visual (those with VisualModel::static_batch set;
+     * see VisualOwnable::static_batching).
+     *
+     * The triangles of all the models go into one set of vertex and index buffers. Each model's
+     * model matrix and alpha go into a shader storage buffer, and each model has a command in an
+     * indirect draw buffer, whose base instance selects its entry in the storage buffer. One
+     * glMultiDrawElementsIndirect call then draws every model. A model that is hidden, or outside
+     * the view frustum, has its command's instance count set to 0; moving a model, or changing its
+     * alpha, rewrites its storage buffer entry. Only a change to a model's vertices (or the
+     * addition or removal of a model) rebuilds the vertex buffers.
+     *
+     * This needs shader storage buffers and multi-draw indirect, so OpenGL 4.3. For other
+     * versions, supported is false and the Visual draws each model as usual.
+     */
+    template <int glver = morph::gl::version_4_1>
+    class VisualBatch
+    {
+    public:
+        static constexpr bool supported = !morph::gl::version::gles (glver)
+        && (morph::gl::version::major (glver) > 4
+            || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 3));
+
+        //! The vertex attribute that holds each model's index into the storage buffer
+        static constexpr unsigned int drawidLoc = 8;
+        //! The shader storage buffer binding point of the models' matrices and alphas
+        static constexpr unsigned int models_binding = 0;
+
+        VisualBatch() {}
+
+        ~VisualBatch()
+        {
+            if (this->vao == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            if (this->glfn == nullptr) { return; }
+            this->glfn->DeleteBuffers (num_bufs, this->bufs.data());
+            this->glfn->DeleteVertexArrays (1, &this->vao);
+#else
+            glDeleteBuffers (num_bufs, this->bufs.data());
+            glDeleteVertexArrays (1, &this->vao);
+#endif
+        }
+
+        VisualBatch (const VisualBatch&) = delete;
+        VisualBatch& operator= (const VisualBatch&) = delete;
+
+        /*!
+         * Add m to this frame's batch, to be drawn by render() if visible. Returns false, having
+         * added nothing, if m can't be batched (see VisualModel::batchable()); the caller should
+         * then draw it as usual. Every model that can be batched should be added in every frame,
+         * visible or not, in the same order, so that the batch is not rebuilt.
+         */
+        bool add (morph::VisualModel<glver>* m, const bool visible)
+        {
+            if (!m->batchable()) { return false; }
+            this->frame.push_back ({ m, visible });
+            return true;
+        }
+
+        //! Forget the models of the last build, which may no longer exist. The next render() rebuilds.
+        void invalidate() { this->built.clear(); }
+
+        /*!
+         * Draw the models added since the last call. The batch shader program (see
+         * getStaticBatchVtxShader) must be current, with its view and projection matrices and
+         * lighting set.
+         */
+#ifdef GLAD_OPTION_GL_MX
+        void render (GladGLContext* _glfn)
+        {
+            this->glfn = _glfn;
+#else
+        void render()
+        {
+#endif
+            if (this->frame.empty()) {
+                this->built.clear();
+                return;
+            }
+            if (this->stale()) { this->rebuild(); }
+            this->update();
+            this->frame.clear();
+            if (this->num_visible == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            _glfn->BindBufferBase (GL_SHADER_STORAGE_BUFFER, models_binding, this->bufs[model_buf]);
+            _glfn->BindVertexArray (this->vao);
+            _glfn->BindBuffer (GL_DRAW_INDIRECT_BUFFER, this->bufs[cmd_buf]);
+            _glfn->MultiDrawElementsIndirect (GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(this->built.size()), 0);
+            _glfn->BindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+            _glfn->BindVertexArray (0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBufferBase (GL_SHADER_STORAGE_BUFFER, models_binding, this->bufs[model_buf]);
+            glBindVertexArray (this->vao);
+            glBindBuffer (GL_DRAW_INDIRECT_BUFFER, this->bufs[cmd_buf]);
+            glMultiDrawElementsIndirect (GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(this->built.size()), 0);
+            glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindVertexArray (0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
+
+        //! The number of models in the batch
+        std::size_t size() const { return this->built.size(); }
+
+        //! The number of models drawn by the last render()
+        std::size_t num_drawn() const { return this->num_visible; }
+
+        //! The number of times the vertex buffers have been built
+        unsigned int num_builds() const { return this->builds; }
+
+    protected:
+        //! A model added to the frame
+        struct entry
+        {
+            morph::VisualModel<glver>* m = nullptr;
+            bool visible = false;
+        };
+        //! A model as it was when the buffers were built
+        struct model_state
+        {
+            const morph::VisualModel<glver>* m = nullptr;
+            unsigned int changes = 0;
+            std::size_t n_indices = 0;
+            std::size_t n_vertices = 0;
+        };
+        //! The arguments of one indirect draw of glMultiDrawElementsIndirect
+        struct draw_command
+        {
+            GLuint count = 0;
+            GLuint instance_count = 0;
+            GLuint first_index = 0;
+            GLint base_vertex = 0;
+            GLuint base_instance = 0;
+        };
+        //! One model's entry in the storage buffer: its model matrix, then alpha and padding (std430)
+        static constexpr std::size_t model_floats = 20;
+
+        enum buf_pos { posn_buf, norm_buf, col_buf, idx_buf, drawid_buf, cmd_buf, model_buf, num_bufs };
+
+        //! Have the models, or any of their vertices, changed since the buffers were built?
+        bool stale() const
+        {
+            if (this->vao == 0 || this->frame.size() != this->built.size()) { return true; }
+            for (std::size_t i = 0; i < this->frame.size(); ++i) {
+                const morph::VisualModel<glver>* m = this->frame[i].m;
+                const model_state& b = this->built[i];
+                if (m != b.m || m->changes != b.changes || m->get_indices().size() != b.n_indices
+                    || m->get_positions().size() / 3u != b.n_vertices) { return true; }
+            }
+            return false;
+        }
+
+        //! Concatenate the vertices of the frame's models into the batch's buffers
+        void rebuild()
+        {
+            ++this->builds;
+            this->built.clear();
+            this->commands.clear();
+            std::size_t nv = 0;
+            std::size_t ni = 0;
+            for (const entry& e : this->frame) {
+                nv += e.m->get_positions().size() / 3u;
+                ni += e.m->get_indices().size();
+            }
+            std::vector<float> posn (3u * nv, 0.0f);
+            std::vector<float> norm (3u * nv, 0.0f);
+            std::vector<float> col (3u * nv, 0.0f);
+            std::vector<GLuint> idx;
+            idx.reserve (ni);
+            std::vector<GLuint> drawid (this->frame.size());
+            std::size_t v0 = 0;
+            for (std::size_t i = 0; i < this->frame.size(); ++i) {
+                const morph::VisualModel<glver>* m = this->frame[i].m;
+                const std::size_t n = m->get_positions().size() / 3u;
+                // Normals or colours that are short (as they may be for a model that doesn't light or colour its vertices) stay zero
+                std::copy_n (m->get_positions().begin(), 3u * n, posn.begin() + 3u * v0);
+                std::copy_n (m->get_normals().begin(), std::min (3u * n, m->get_normals().size()), norm.begin() + 3u * v0);
+                std::copy_n (m->get_colours().begin(), std::min (3u * n, m->get_colours().size()), col.begin() + 3u * v0);
+                draw_command c;
+                c.count = static_cast<GLuint>(m->get_indices().size());
+                c.first_index = static_cast<GLuint>(idx.size());
+                c.base_vertex = static_cast<GLint>(v0);
+                c.base_instance = static_cast<GLuint>(i);
+                this->commands.push_back (c);
+                idx.insert (idx.end(), m->get_indices().begin(), m->get_indices().end());
+                drawid[i] = static_cast<GLuint>(i);
+                this->built.push_back ({ m, m->changes, m->get_indices().size(), n });
+                v0 += n;
+            }
+            this->model_data.assign (model_floats * this->frame.size(), 0.0f);
+            this->uploaded_commands.clear();
+            this->uploaded_models.clear();
+
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            if (this->vao == 0) {
+                _glfn->GenVertexArrays (1, &this->vao);
+                _glfn->GenBuffers (num_bufs, this->bufs.data());
+            }
+            _glfn->BindVertexArray (this->vao);
+            _glfn->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->bufs[idx_buf]);
+            _glfn->BufferData (GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_STATIC_DRAW);
+            const std::array<std::pair<buf_pos, const std::vector<float>*>, 3> attribs = {{ { posn_buf, &posn }, { norm_buf, &norm }, { col_buf, &col } }};
+            for (unsigned int a = 0; a < 3; ++a) {
+                _glfn->BindBuffer (GL_ARRAY_BUFFER, this->bufs[attribs[a].first]);
+                _glfn->BufferData (GL_ARRAY_BUFFER, attribs[a].second->size() * sizeof(float), attribs[a].second->data(), GL_STATIC_DRAW);
+                _glfn->VertexAttribPointer (a, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+                _glfn->EnableVertexAttribArray (a);
+            }
+            // One draw id per model, stepped per instance, so that base_instance picks it out
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->bufs[drawid_buf]);
+            _glfn->BufferData (GL_ARRAY_BUFFER, drawid.size() * sizeof(GLuint), drawid.data(), GL_STATIC_DRAW);
+            _glfn->VertexAttribIPointer (drawidLoc, 1, GL_UNSIGNED_INT, 0, (void*)(0));
+            _glfn->EnableVertexAttribArray (drawidLoc);
+            _glfn->VertexAttribDivisor (drawidLoc, 1);
+            _glfn->BindVertexArray (0);
+            _glfn->BindBuffer (GL_DRAW_INDIRECT_BUFFER, this->bufs[cmd_buf]);
+            _glfn->BufferData (GL_DRAW_INDIRECT_BUFFER, this->commands.size() * sizeof(draw_command), nullptr, GL_DYNAMIC_DRAW);
+            _glfn->BindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+            _glfn->BindBuffer (GL_SHADER_STORAGE_BUFFER, this->bufs[model_buf]);
+            _glfn->BufferData (GL_SHADER_STORAGE_BUFFER, this->model_data.size() * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            _glfn->BindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            if (this->vao == 0) {
+                glGenVertexArrays (1, &this->vao);
+                glGenBuffers (num_bufs, this->bufs.data());
+            }
+            glBindVertexArray (this->vao);
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->bufs[idx_buf]);
+            glBufferData (GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_STATIC_DRAW);
+            const std::array<std::pair<buf_pos, const std::vector<float>*>, 3> attribs = {{ { posn_buf, &posn }, { norm_buf, &norm }, { col_buf, &col } }};
+            for (unsigned int a = 0; a < 3; ++a) {
+                glBindBuffer (GL_ARRAY_BUFFER, this->bufs[attribs[a].first]);
+                glBufferData (GL_ARRAY_BUFFER, attribs[a].second->size() * sizeof(float), attribs[a].second->data(), GL_STATIC_DRAW);
+                glVertexAttribPointer (a, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+                glEnableVertexAttribArray (a);
+            }
+            // One draw id per model, stepped per instance, so that base_instance picks it out
+            glBindBuffer (GL_ARRAY_BUFFER, this->bufs[drawid_buf]);
+            glBufferData (GL_ARRAY_BUFFER, drawid.size() * sizeof(GLuint), drawid.data(), GL_STATIC_DRAW);
+            glVertexAttribIPointer (drawidLoc, 1, GL_UNSIGNED_INT, 0, (void*)(0));
+            glEnableVertexAttribArray (drawidLoc);
+            glVertexAttribDivisor (drawidLoc, 1);
+            glBindVertexArray (0);
+            glBindBuffer (GL_DRAW_INDIRECT_BUFFER, this->bufs[cmd_buf]);
+            glBufferData (GL_DRAW_INDIRECT_BUFFER, this->commands.size() * sizeof(draw_command), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->bufs[model_buf]);
+            glBufferData (GL_SHADER_STORAGE_BUFFER, this->model_data.size() * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
+
+        //! Write each model's matrix, alpha and visibility, uploading the buffers that have changed
+        void update()
+        {
+            this->num_visible = 0;
+            for (std::size_t i = 0; i < this->frame.size(); ++i) {
+                const morph::VisualModel<glver>* m = this->frame[i].m;
+                const morph::mat44<float> mm = m->get_model_scaling() * m->getViewMatrix();
+                float* d = this->model_data.data() + model_floats * i;
+                std::copy (mm.mat.begin(), mm.mat.end(), d);
+                d[16] = m->getAlpha();
+                this->commands[i].instance_count = this->frame[i].visible ? 1u : 0u;
+                if (this->frame[i].visible) { ++this->num_visible; }
+            }
+            const bool cmds_changed = this->uploaded_commands.size() != this->commands.size()
+            || std::memcmp (this->uploaded_commands.data(), this->commands.data(), this->commands.size() * sizeof(draw_command)) != 0;
+            const bool models_changed = this->uploaded_models != this->model_data;
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            if (cmds_changed) {
+                _glfn->BindBuffer (GL_DRAW_INDIRECT_BUFFER, this->bufs[cmd_buf]);
+                _glfn->BufferSubData (GL_DRAW_INDIRECT_BUFFER, 0, this->commands.size() * sizeof(draw_command), this->commands.data());
+                _glfn->BindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+            }
+            if (models_changed) {
+                _glfn->BindBuffer (GL_SHADER_STORAGE_BUFFER, this->bufs[model_buf]);
+                _glfn->BufferSubData (GL_SHADER_STORAGE_BUFFER, 0, this->model_data.size() * sizeof(float), this->model_data.data());
+                _glfn->BindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            }
+#else
+            if (cmds_changed) {
+                glBindBuffer (GL_DRAW_INDIRECT_BUFFER, this->bufs[cmd_buf]);
+                glBufferSubData (GL_DRAW_INDIRECT_BUFFER, 0, this->commands.size() * sizeof(draw_command), this->commands.data());
+                glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+            }
+            if (models_changed) {
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->bufs[model_buf]);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, this->model_data.size() * sizeof(float), this->model_data.data());
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            }
+#endif
+            if (cmds_changed) { this->uploaded_commands = this->commands; }
+            if (models_changed) { this->uploaded_models = this->model_data; }
+        }
+
+#ifdef GLAD_OPTION_GL_MX
+        //! The GL function context that the buffers were created in
+        GladGLContext* glfn = nullptr;
+#endif
+        //! The vertex array object of the batch
+        GLuint vao = 0;
+        //! The vertex, index, draw id, indirect command and storage buffers
+        std::array<GLuint, num_bufs> bufs = {};
+        //! The models added to this frame
+        std::vector<entry> frame;
+        //! The models as they were when the buffers were built
+        std::vector<model_state> built;
+        //! The draw commands, and the storage buffer's data, with what was last uploaded of each
+        std::vector<draw_command> commands;
+        std::vector<draw_command> uploaded_commands;
+        std::vector<float> model_data;
+        std::vector<float> uploaded_models;
+        std::size_t num_visible = 0;
+        unsigned int builds = 0;
+    };
+
+} // namespace morph
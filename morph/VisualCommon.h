@@ -25,6 +25,28 @@ namespace morph {
             unsigned int /*GLuint*/ gprog = 0;
             //! A text shader program, which uses textures to draw text on quads.
             unsigned int /*GLuint*/ tprog = 0;
+
+            //! Locations of the uniforms that are set for every model. -1 if not in the program.
+            struct uniform_locations
+            {
+                int /*GLint*/ alpha = -1;
+                int /*GLint*/ v_matrix = -1;
+                int /*GLint*/ m_matrix = -1;
+                int /*GLint*/ instanced = -1;
+                int /*GLint*/ text_colour = -1;
+                // For models coloured from a data texture (see VisualModel::data_tex)
+                int /*GLint*/ data_texture = -1;
+                int /*GLint*/ data_tex = -1;
+                int /*GLint*/ lut_tex = -1;
+                int /*GLint*/ data_scale = -1;
+                int /*GLint*/ data_displace = -1;
+                int /*GLint*/ data_zscale = -1;
+                int /*GLint*/ data_spacing = -1;
+            };
+            //! The uniform locations in gprog, looked up once each time gprog is (re)loaded
+            uniform_locations gprog_locs;
+            //! The uniform locations in tprog
+            uniform_locations tprog_locs;
         };
 
         // This defines different graphics shader types, as used in morph::Visual. The essential
@@ -38,13 +60,15 @@ namespace morph {
         };
 
         //! The locations for the position, normal and colour vertex attributes in the
-        //! morph::Visual GLSL programs
-        enum AttribLocn { posnLoc = 0, normLoc = 1, colLoc = 2, textureLoc = 3 };
+        //! morph::Visual GLSL programs, and for the per-instance attributes used when a
+        //! VisualModel is drawn instanced (position, scale, rotation and colour)
+        enum AttribLocn { posnLoc = 0, normLoc = 1, colLoc = 2, textureLoc = 3,
+                          instPosnLoc = 4, instScaleLoc = 5, instRotnLoc = 6, instColLoc = 7 };
 
         //! A struct to hold information about font glyph properties
         struct CharInfo
         {
-            //! ID handle of the glyph texture
+            //! ID handle of the texture (the glyph atlas page) that holds the glyph
             unsigned int textureID;
             //! Size of glyph
             morph::vec<int,2>  size;
@@ -52,6 +76,8 @@ namespace morph {
             morph::vec<int,2>  bearing;
             //! Offset to advance to next glyph
             unsigned int advance;
+            //! The glyph's rectangle in its texture (a glyph atlas page) as (u0, v0, u1, v1). v0 is the top row.
+            morph::vec<float, 4> uv = { 0.0f, 0.0f, 1.0f, 1.0f };
         };
 
     } // namespace gl
@@ -33,6 +33,8 @@ namespace morph {
             if (!fout.is_open()) {
                 throw std::runtime_error ("VisualCompoundRay::savegltf(): Failed to open file for writing");
             }
+            typename morph::Visual<glver>::restored_vertices rv (this->vm);
+            this->layout = this->make_gltf_layout();
 
             // Output the various sections of the gltf file
             this->gltf_scenes (fout);
@@ -47,6 +49,9 @@ namespace morph {
         }
 
     protected:
+        //! The layout of the glTF being written by savegltf()
+        typename morph::Visual<glver>::gltf_layout layout;
+
         //! Compound-ray gltf needs a background-shader to be specified. This is added to the
         //! "scenes" section
         virtual void compoundRayBackground (std::ofstream& fout) const
@@ -134,10 +139,17 @@ namespace morph {
             fout << "{\n  \"scenes\" : [ { ";
             if (this->enable_compound_ray_gltf == true) { compoundRayBackground (fout); }
             fout << "\"nodes\" : [ ";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                fout << vmi << (vmi < this->vm.size()-1 ? ", " : "");
+            // The camera nodes 0 and 2 are children of the root camera nodes 1 and 3
+            if (this->enable_compound_ray_gltf == true) { fout << "1, 3" << (this->layout.nodes.empty() ? "" : ", "); }
+            const std::size_t n0 = this->enable_compound_ray_gltf == true ? 4u : 0u;
+            for (std::size_t ni = 0u; ni < this->layout.nodes.size(); ++ni) {
+                fout << n0 + ni << (ni < this->layout.nodes.size()-1 ? ", " : "");
             }
             fout << " ] } ],\n";
+            if (this->layout.n_instanced > 0u) {
+                fout << "  \"extensionsUsed\" : [ \"EXT_mesh_gpu_instancing\" ],\n"
+                     << "  \"extensionsRequired\" : [ \"EXT_mesh_gpu_instancing\" ],\n";
+            }
         }
 
         //! Output a nodes section of glTF
@@ -145,12 +157,7 @@ namespace morph {
         {
             fout << "  \"nodes\" : [\n";
             if (this->enable_compound_ray_gltf == true) { compoundRayCameraNodes (fout); }
-            // for loop over VisualModels "mesh" : 0, etc
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                fout << "    { \"mesh\" : " << vmi
-                     << ", \"translation\" : " << this->vm[vmi]->translation_str()
-                     << (vmi < this->vm.size()-1 ? " },\n" : " }\n");
-            }
+            this->gltf_write_nodes (fout, this->layout);
             fout << "  ],\n";
         }
 
@@ -165,116 +172,14 @@ namespace morph {
         {
             // glTF meshes
             fout << "  \"meshes\" : [\n";
-            // for each VisualModel:
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                fout << "    { \"primitives\" : [ { \"attributes\" : { \"POSITION\" : " << 1+vmi*4
-                     << ", \"COLOR_0\" : " << 2+vmi*4
-                     << ", \"NORMAL\" : " << 3+vmi*4 << " }, \"indices\" : " << vmi*4 << ", \"material\": 0 } ] }"
-                     << (vmi < this->vm.size()-1 ? ",\n" : "\n");
-            }
+            this->gltf_write_meshes (fout, this->layout);
             fout << "  ],\n";
         }
 
         // Output the buffers, bufferviews and accessors sections of glTF
         virtual void gltf_buffers (std::ofstream& fout) const
         {
-            // glTF buffers
-            fout << "  \"buffers\" : [\n";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                // indices
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->indices_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->indices_bytes() << "},\n";
-                // pos
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vpos_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vpos_bytes() << "},\n";
-                // col
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vcol_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vcol_bytes() << "},\n";
-                // norm
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vnorm_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vnorm_bytes() << "}";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
-            }
-            fout << "  ],\n";
-
-            // glTF bufferViews
-            fout << "  \"bufferViews\" : [\n";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                // indices
-                fout << "    { ";
-                fout << "\"buffer\" : " << vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->indices_bytes() << ", ";
-                fout << "\"target\" : 34963 ";
-                fout << " },\n";
-                // vpos
-                fout << "    { ";
-                fout << "\"buffer\" : " << 1+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vpos_bytes() << ", ";
-                fout << "\"target\" : 34962 ";
-                fout << " },\n";
-                // vcol
-                fout << "    { ";
-                fout << "\"buffer\" : " << 2+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vcol_bytes() << ", ";
-                fout << "\"target\" : 34962 ";
-                fout << " },\n";
-                // vnorm
-                fout << "    { ";
-                fout << "\"buffer\" : " << 3+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vnorm_bytes() << ", ";
-                fout << "\"target\" : 34962 ";
-                fout << " }";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
-            }
-            fout << "  ],\n";
-
-            // glTF accessors
-            fout << "  \"accessors\" : [\n";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                this->vm[vmi]->computeVertexMaxMins();
-                // indices
-                fout << "    { ";
-                fout << "\"bufferView\" : " << vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                // 5123 unsigned short, 5121 unsigned byte, 5125 unsigned int, 5126 float:
-                fout << "\"componentType\" : 5125, ";
-                fout << "\"type\" : \"SCALAR\", ";
-                fout << "\"count\" : " << this->vm[vmi]->indices_size();
-                fout << "},\n";
-                // vpos
-                fout << "    { ";
-                fout << "\"bufferView\" : " << 1+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"componentType\" : 5126, ";
-                fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vpos_size()/3;
-                // vertex position requires max/min to be specified in the gltf format
-                fout << ", \"max\" : " << this->vm[vmi]->vpos_max() << ", ";
-                fout << "\"min\" : " << this->vm[vmi]->vpos_min();
-                fout << " },\n";
-                // vcol
-                fout << "    { ";
-                fout << "\"bufferView\" : " << 2+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"componentType\" : 5126, ";
-                fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vcol_size()/3;
-                fout << "},\n";
-                // vnorm
-                fout << "    { ";
-                fout << "\"bufferView\" : " << 3+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"componentType\" : 5126, ";
-                fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vnorm_size()/3;
-                fout << "}";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
-            }
-            fout << "  ],\n";
+            this->gltf_write_buffers (fout, this->layout);
         }
 
         //! Output a materials section of glTF
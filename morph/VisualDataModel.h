@@ -4,8 +4,16 @@
 #pragma once
 
 #include <vector>
+#include <span>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <morph/vec.h>
+#include <morph/data_view.h>
 #include <morph/VisualModel.h>
+#include <morph/VisualDefaultShaders.h>
+#include <morph/gl/shaders.h>
 #include <morph/ColourMap.h>
 #include <morph/scale.h>
 
@@ -24,7 +32,16 @@ namespace morph {
             : morph::VisualModel<glver>::VisualModel (_offset) {}
 
         //! Deconstructor should *not* deallocate data - client code should do that
-        ~VisualDataModel() {}
+        ~VisualDataModel()
+        {
+#ifdef GLAD_OPTION_GL_MX
+            if (this->colour_lut_buf) { this->get_glfn(this->parentVis)->DeleteBuffers (1, &this->colour_lut_buf); }
+            if (this->colour_cprog) { this->get_glfn(this->parentVis)->DeleteProgram (this->colour_cprog); }
+#else
+            if (this->colour_lut_buf) { glDeleteBuffers (1, &this->colour_lut_buf); }
+            if (this->colour_cprog) { glDeleteProgram (this->colour_cprog); }
+#endif
+        }
 
         //! Reset the autoscaled flags so that the next time data is transformed by
         //! the Scale objects they will autoscale again (assuming they have
@@ -49,7 +66,16 @@ namespace morph {
 
         void setZScale (const scale<T, float>& zscale) { this->zScale = zscale; }
         void setCScale (const scale<T, float>& cscale) { this->colourScale = cscale; }
-        void setScalarData (const std::vector<T>* _data) { this->scalarData = _data; }
+        void setScalarData (const std::vector<T>* _data) { this->setScalarData (data_view<T>(_data)); }
+        //! Visualize data that is not in a std::vector of T, such as a slice of a larger buffer.
+        //! The data is not copied, so it must outlive the model (or the next setScalarData).
+        void setScalarData (std::span<const T> _data) { this->setScalarData (data_view<T>(_data)); }
+        //! Visualize a (possibly strided) view of data; see data_view::component
+        void setScalarData (const data_view<T>& _view)
+        {
+            this->scalarView = _view;
+            this->scalarData = _view.bound() ? &this->scalarView : nullptr;
+        }
         void setVectorData (const std::vector<vec<T>>* _vectors) { this->vectorData = _vectors; }
         void setDataCoords (std::vector<vec<float>>* _coords) { this->dataCoords = _coords; }
 
@@ -80,14 +106,25 @@ namespace morph {
         //! Update the scalar data
         virtual void updateData (const std::vector<T>* _data)
         {
-            this->scalarData = _data;
-            this->reinit();
+            this->setScalarData (_data);
+            this->scalarDataUpdated();
         }
 
+        //! Update the scalar data from a view of data that is not in a std::vector of T. The
+        //! data is not copied.
+        void updateData (const data_view<T>& _view)
+        {
+            this->setScalarData (_view);
+            this->scalarDataUpdated();
+        }
+
+        //! Update the scalar data from a span, which is not copied
+        void updateData (std::span<const T> _data) { this->updateData (data_view<T>(_data)); }
+
         //! Update the scalar data with an associated z-scaling
         void updateData (const std::vector<T>* _data, const scale<T, float>& zscale)
         {
-            this->scalarData = _data;
+            this->setScalarData (_data);
             this->zScale = zscale;
             this->reinit();
         }
@@ -95,7 +132,7 @@ namespace morph {
         //! Update the scalar data, along with both the z-scaling and the colour-scaling
         void updateData (const std::vector<T>* _data, const scale<T, float>& zscale, const scale<T, float>& cscale)
         {
-            this->scalarData = _data;
+            this->setScalarData (_data);
             this->zScale = zscale;
             this->colourScale = cscale;
             this->reinit();
@@ -106,7 +143,7 @@ namespace morph {
                                  const scale<T, float>& zscale)
         {
             this->dataCoords = _coords;
-            this->scalarData = _data;
+            this->setScalarData (_data);
             this->zScale = zscale;
             this->reinit();
         }
@@ -116,7 +153,7 @@ namespace morph {
                                  const scale<T, float>& zscale, const scale<T, float>& cscale)
         {
             this->dataCoords = _coords;
-            this->scalarData = _data;
+            this->setScalarData (_data);
             this->zScale = zscale;
             this->colourScale = cscale;
             this->reinit();
@@ -144,6 +181,156 @@ namespace morph {
             this->reinit();
         }
 
+        /*!
+         * Recolour the model on the GPU from \a n_data floats that are already in the GL buffer
+         * \a data_buf (for example the name of a morph::gl::ssbo that a compute shader is
+         * updating). A compute shader applies colourScale and the colour map cm, and writes the
+         * result straight into the colour VBO, so the data never has to be copied to the CPU.
+         *
+         * The buffer must belong to the GL context of this model's Visual, which must be OpenGL
+         * 4.3+ or 3.1 ES. colourScale must be linear and must already have its parameters,
+         * because it cannot autoscale on data it does not see. Only one dimensional colour maps
+         * make sense here. The vertex positions (and so any z scaling) are not updated. The
+         * derived class must implement verticesPerDatum().
+         */
+        void updateColourFromBuffer (GLuint data_buf, unsigned int n_data)
+        {
+#ifdef GL_COMPUTE_SHADER
+            unsigned int vpd = this->verticesPerDatum();
+            if (vpd == 0) {
+                throw std::runtime_error ("VisualDataModel::updateColourFromBuffer: Not implemented for this model/mode");
+            }
+            if (this->colourScale.getType() != morph::scaling_function::Linear || !this->colourScale.ready()) {
+                throw std::runtime_error ("VisualDataModel::updateColourFromBuffer: colourScale must be linear with its params set");
+            }
+            // With gpu_resident, vertexColors may have been freed; the colour buffer has its size
+            const std::size_t ncolours = this->cpu_released ? this->vbo_bytes[visgl::colLoc] / sizeof(float) : this->vertexColors.size();
+            if (3u * n_data * vpd > ncolours) {
+                throw std::runtime_error ("VisualDataModel::updateColourFromBuffer: n_data is larger than the model");
+            }
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            if (this->colours_packed) {
+                throw std::runtime_error ("VisualDataModel::updateColourFromBuffer: needs float colours (unset compact_vertices)");
+            }
+
+            // Sample the colour map into a table (again only if the map has changed)
+            bool lut_changed = (this->colour_lut_buf == 0 || this->colour_lut_type != this->cm.getType()
+                                || this->colour_lut_hue != this->cm.getHue());
+            std::vector<float> lut;
+            if (lut_changed) {
+                lut = this->sample_colour_map();
+                this->colour_lut_type = this->cm.getType();
+                this->colour_lut_hue = this->cm.getHue();
+            }
+            std::vector<morph::gl::ShaderInfo> shaders = {
+                {GL_COMPUTE_SHADER, "VisualColour.compute.glsl", morph::getDefaultColourComputeShader(glver), 0 }
+            };
+            GLuint ngrps = (n_data * vpd + 63) / 64;
+            float m = this->colourScale.getParams(0);
+            float c = this->colourScale.getParams(1);
+
+# ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            if (this->colour_cprog == 0) { this->colour_cprog = morph::gl::LoadShaders (shaders, _glfn); }
+            if (lut_changed) {
+                if (this->colour_lut_buf == 0) { _glfn->GenBuffers (1, &this->colour_lut_buf); }
+                _glfn->BindBuffer (GL_SHADER_STORAGE_BUFFER, this->colour_lut_buf);
+                _glfn->BufferData (GL_SHADER_STORAGE_BUFFER, lut.size() * sizeof(float), lut.data(), GL_STATIC_DRAW);
+                _glfn->BindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            }
+            _glfn->UseProgram (this->colour_cprog);
+            _glfn->Uniform1ui (_glfn->GetUniformLocation (this->colour_cprog, "n_data"), n_data);
+            _glfn->Uniform1ui (_glfn->GetUniformLocation (this->colour_cprog, "verts_per_datum"), vpd);
+            _glfn->Uniform1ui (_glfn->GetUniformLocation (this->colour_cprog, "lut_size"), this->colour_lut_size);
+            _glfn->Uniform1f (_glfn->GetUniformLocation (this->colour_cprog, "scale_m"), m);
+            _glfn->Uniform1f (_glfn->GetUniformLocation (this->colour_cprog, "scale_c"), c);
+            _glfn->BindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, data_buf);
+            _glfn->BindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->vbos[VisualModel<glver>::colVBO]);
+            _glfn->BindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->colour_lut_buf);
+            _glfn->DispatchCompute (ngrps, 1, 1);
+            // The colour VBO will next be read as a vertex attribute
+            _glfn->MemoryBarrier (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+# else
+            if (this->colour_cprog == 0) { this->colour_cprog = morph::gl::LoadShaders (shaders); }
+            if (lut_changed) {
+                if (this->colour_lut_buf == 0) { glGenBuffers (1, &this->colour_lut_buf); }
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->colour_lut_buf);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, lut.size() * sizeof(float), lut.data(), GL_STATIC_DRAW);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            }
+            glUseProgram (this->colour_cprog);
+            glUniform1ui (glGetUniformLocation (this->colour_cprog, "n_data"), n_data);
+            glUniform1ui (glGetUniformLocation (this->colour_cprog, "verts_per_datum"), vpd);
+            glUniform1ui (glGetUniformLocation (this->colour_cprog, "lut_size"), this->colour_lut_size);
+            glUniform1f (glGetUniformLocation (this->colour_cprog, "scale_m"), m);
+            glUniform1f (glGetUniformLocation (this->colour_cprog, "scale_c"), c);
+            glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, data_buf);
+            glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->vbos[VisualModel<glver>::colVBO]);
+            glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->colour_lut_buf);
+            glDispatchCompute (ngrps, 1, 1);
+            // The colour VBO will next be read as a vertex attribute
+            glMemoryBarrier (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+# endif
+#else
+            throw std::runtime_error ("VisualDataModel::updateColourFromBuffer: GL headers lack compute shader support");
+#endif
+        }
+
+        /*!
+         * The number of vertices coloured by each datum, for updateColourFromBuffer. The vertices
+         * for datum i must be [i * n, (i+1) * n). Return 0 (the default) if the model or its
+         * current mode does not lay its vertices out like this.
+         */
+        virtual unsigned int verticesPerDatum() const { return 0; }
+
+        //! The number of colours sampled from cm for updateColourFromBuffer and data textures
+        unsigned int colour_lut_size = 256;
+
+        //! Sample the colour map cm at colour_lut_size evenly spaced points in [0, 1] as RGB triplets
+        std::vector<float> sample_colour_map() const
+        {
+            std::vector<float> lut (3 * this->colour_lut_size);
+            for (unsigned int i = 0; i < this->colour_lut_size; ++i) {
+                std::array<float, 3> c = this->cm.convert (static_cast<float>(i) / (this->colour_lut_size - 1));
+                lut[3*i] = c[0];
+                lut[3*i+1] = c[1];
+                lut[3*i+2] = c[2];
+            }
+            return lut;
+        }
+
+        /*!
+         * Upload w x h floats from data (row by row) into the data texture data_tex, and the
+         * colour map cm into lut_tex, creating them if necessary. The texture is re-allocated
+         * only if its size changes. The GL context must be current. Both textures use nearest
+         * neighbour sampling, which is always available for float textures.
+         */
+        void upload_data_texture (const float* data, const unsigned int w, const unsigned int h)
+        {
+            VisualModel<glver>::upload_data_texture ({ data }, w, h, this->sample_colour_map());
+        }
+
+        //! True if the height map texture is waiting to be uploaded by render_geometry()
+        bool render_pending() const override
+        {
+            return (this->height_tex_dirty && this->hide == false) || VisualModel<glver>::render_pending();
+        }
+
+        //! Upload the height map texture (see setup_height_map) if it has changed, then draw
+        void render_geometry() override
+        {
+            if (this->height_tex_dirty && this->hide == false && !this->build_running()) {
+                if (!this->height_texels.empty()) {
+                    this->upload_data_texture (this->height_texels.data(), this->height_tex_dims[0], this->height_tex_dims[1]);
+                }
+                this->height_tex_dirty = false;
+            }
+            VisualModel<glver>::render_geometry();
+        }
+
         //! All data models use a a colour map. Change the type/hue of this colour map
         //! object to generate different types of map.
         ColourMap<float> cm;
@@ -168,7 +355,8 @@ namespace morph {
 
         //! The data to visualize. T may simply be float or double, or, if the
         //! visualization is of directional information, such as in a quiver plot,
-        const std::vector<T>* scalarData = nullptr;
+        //! This points to scalarView (or is nullptr); set it with setScalarData.
+        const data_view<T>* scalarData = nullptr;
 
         //! A container for vector data to visualize. Can also be used for colour of the
         //! hexes.
@@ -178,6 +366,134 @@ namespace morph {
         //! graph, quiver plot). Note fixed type of float, which is suitable for
         //! OpenGL coordinates. Not const as child code may resize or update content.
         std::vector<vec<float>>* dataCoords = nullptr;
+
+    protected:
+        /*!
+         * Apply the scale s to scalarData, writing the result into output, which is resized to
+         * match. Keep output as a member, so that its memory is reused from one update to the
+         * next. Contiguous data goes through the batch (span) transform.
+         */
+        template <typename C>
+        void transformScalarData (scale<T, float>& s, C& output)
+        {
+            output.resize (this->scalarData->size());
+            if constexpr (std::is_same_v<typename C::value_type, float>) {
+                if (this->scalarData->contiguous()) {
+                    s.transform (this->scalarData->span(), std::span<float>(output));
+                    return;
+                }
+            }
+            s.transform (*this->scalarData, output);
+        }
+
+        //! Called by updateData after the scalar data has changed. By default, rebuild the model.
+        virtual void scalarDataUpdated() { this->reinit(); }
+
+        /*!
+         * Lay the data out in the texels of a height map (see VisualModel::data_tex_displace):
+         * datum i goes to texel coords[i]. The coordinates are shifted (in place) so that the
+         * smallest are 0, and height_tex_dims is set to enclose them. An empty texel next to a
+         * datum's texel (at one of the offsets nbrs) takes that datum, so that the finite
+         * differences that give the normals at the edges of the data are not pulled towards 0.
+         */
+        void set_height_texels (std::vector<morph::vec<int, 2>>& coords, std::span<const morph::vec<int, 2>> nbrs)
+        {
+            this->height_texel_src.clear();
+            this->height_tex_dims = { 0u, 0u };
+            if (coords.empty()) { return; }
+            morph::vec<int, 2> cmin = coords[0];
+            morph::vec<int, 2> cmax = coords[0];
+            for (const morph::vec<int, 2>& c : coords) {
+                cmin = { std::min (cmin[0], c[0]), std::min (cmin[1], c[1]) };
+                cmax = { std::max (cmax[0], c[0]), std::max (cmax[1], c[1]) };
+            }
+            const int w = cmax[0] - cmin[0] + 1;
+            const int h = cmax[1] - cmin[1] + 1;
+            this->height_tex_dims = { static_cast<unsigned int>(w), static_cast<unsigned int>(h) };
+            this->height_texel_src.assign (static_cast<std::size_t>(w) * h, -1);
+            for (std::size_t i = 0; i < coords.size(); ++i) {
+                coords[i] -= cmin;
+                this->height_texel_src[static_cast<std::size_t>(coords[i][1]) * w + coords[i][0]] = static_cast<int>(i);
+            }
+            for (std::size_t i = 0; i < coords.size(); ++i) {
+                for (const morph::vec<int, 2>& o : nbrs) {
+                    const morph::vec<int, 2> t = coords[i] + o;
+                    if (t[0] < 0 || t[1] < 0 || t[0] >= w || t[1] >= h) { continue; }
+                    int& src = this->height_texel_src[static_cast<std::size_t>(t[1]) * w + t[0]];
+                    if (src == -1) { src = -2 - static_cast<int>(i); } // Marked as a borrowed datum
+                }
+            }
+            for (int& src : this->height_texel_src) { if (src < -1) { src = -2 - src; } }
+        }
+
+        /*!
+         * Prepare to draw scalarData as a height map laid out by set_height_texels: check that it
+         * can be, autoscale colourScale and zScale if their params are unset, and copy the data
+         * into height_texels, from which render_geometry() uploads the data texture. z is
+         * multiplied by zmult. Requires a one dimensional colour map, and linear colourScale and
+         * zScale (which the vertex shader applies). NaNs are drawn as 0.
+         */
+        void setup_height_map (const float zmult = 1.0f)
+        {
+            if (this->scalarData == nullptr) {
+                throw std::runtime_error ("VisualDataModel: A height map requires scalarData");
+            }
+            if (this->cm.numDatums() != 1) {
+                throw std::runtime_error ("VisualDataModel: A height map requires a one dimensional colour map");
+            }
+            if (this->colourScale.getType() != morph::scaling_function::Linear
+                || this->zScale.getType() != morph::scaling_function::Linear) {
+                throw std::runtime_error ("VisualDataModel: A height map requires a linear colourScale and zScale");
+            }
+            for (scale<T, float>* s : { &this->colourScale, &this->zScale }) {
+                if (s->ready()) { continue; }
+                if (s->do_autoscale == false) {
+                    throw std::runtime_error ("VisualDataModel: scale params are not set and do_autoscale is false");
+                }
+                if (this->scalarData->contiguous()) {
+                    s->compute_scaling_from_data (this->scalarData->span());
+                } else {
+                    s->compute_scaling_from_data (*this->scalarData);
+                }
+            }
+            const int n = static_cast<int>(this->scalarData->size());
+            this->height_texels.resize (this->height_texel_src.size());
+            float lo = std::numeric_limits<float>::max();
+            float hi = std::numeric_limits<float>::lowest();
+            for (std::size_t t = 0; t < this->height_texel_src.size(); ++t) {
+                const int i = this->height_texel_src[t];
+                float v = (i < 0 || i >= n) ? 0.0f : static_cast<float>((*this->scalarData)[i]);
+                if (std::isnan (v)) { v = 0.0f; }
+                this->height_texels[t] = v;
+                lo = std::min (lo, v);
+                hi = std::max (hi, v);
+            }
+            this->data_tex_scale = { this->colourScale.getParams(0), this->colourScale.getParams(1) };
+            this->data_tex_zscale = { zmult * this->zScale.getParams(0), zmult * this->zScale.getParams(1) };
+            if (lo <= hi) {
+                const float zlo = this->data_tex_zscale[0] * lo + this->data_tex_zscale[1];
+                const float zhi = this->data_tex_zscale[0] * hi + this->data_tex_zscale[1];
+                this->data_tex_zrange = { std::min (zlo, zhi), std::max (zlo, zhi) };
+            }
+            // The upload happens in render_geometry, when the GL context is certain to be current
+            this->height_tex_dirty = true;
+        }
+
+        //! The texels of the height map, which datum each one takes (-1 for none) and their size
+        std::vector<float> height_texels;
+        std::vector<int> height_texel_src;
+        morph::vec<unsigned int, 2> height_tex_dims = { 0u, 0u };
+        //! Set when the height map texture needs to be uploaded again
+        bool height_tex_dirty = false;
+
+        //! The view of the scalar data that scalarData points to
+        data_view<T> scalarView;
+
+        //! The compute shader program and colour table for updateColourFromBuffer
+        GLuint colour_cprog = 0;
+        GLuint colour_lut_buf = 0;
+        ColourMapType colour_lut_type = ColourMapType::Plasma;
+        float colour_lut_hue = 0.0f;
     };
 
 } // namespace morph
@@ -105,21 +105,71 @@ namespace morph {
     "uniform mat4 v_matrix;\n"
     "uniform mat4 p_matrix;\n"
     "uniform float alpha;\n"
+    "uniform int instanced;\n"
+    "uniform int data_displace;\n"
+    "uniform highp sampler2D data_tex;\n"
+    "uniform sampler2D lut_tex;\n"
+    "uniform vec2 data_scale;\n"
+    "uniform vec2 data_zscale;\n"
+    "uniform vec2 data_spacing;\n"
     "layout(location = 0) in vec4 position;\n"
     "layout(location = 1) in vec4 normalin;\n"
     "layout(location = 2) in vec3 color;\n"
+    "layout(location = 4) in vec3 inst_posn;\n"
+    "layout(location = 5) in vec3 inst_scale;\n"
+    "layout(location = 6) in vec4 inst_rotn;\n"
+    "layout(location = 7) in vec3 inst_color;\n"
     "out VERTEX\n"
     "{\n"
     "    vec4 normal;\n"
     "    vec4 color;\n"
     "    vec3 fragpos;\n"
     "} vertex;\n"
+    "vec3 qrotate (vec4 q, vec3 v)\n"
+    "{\n"
+    "    return v + 2.0 * cross (q.yzw, cross (q.yzw, v) + q.x * v);\n"
+    "}\n"
+    "float data_z (ivec2 t)\n"
+    "{\n"
+    "    t = clamp (t, ivec2(0), textureSize (data_tex, 0) - 1);\n"
+    "    return data_zscale.x * texelFetch (data_tex, t, 0).r + data_zscale.y;\n"
+    "}\n"
     "void main()\n"
     "{\n"
-    "    gl_Position = (p_matrix * v_matrix * m_matrix * position);\n"
-    "    vertex.color = vec4(color, alpha);\n"
-    "    vertex.fragpos = vec3(m_matrix * position);\n"
-    "    vertex.normal = normalin;\n"
+    "    vec4 p = position;\n"
+    "    vec4 n = normalin;\n"
+    "    vec3 c = color;\n"
+    "    if (instanced != 0) {\n"
+    "        p = vec4(qrotate (inst_rotn, position.xyz * inst_scale) + inst_posn, 1.0);\n"
+    "        n = vec4(normalize (qrotate (inst_rotn, normalin.xyz / inst_scale)), 0.0);\n"
+    "        c = inst_color;\n"
+    "    } else if (data_displace != 0 && color.z < -1.5) {\n"
+    "        ivec2 t = ivec2(color.xy);\n"
+    "        float h = texelFetch (data_tex, t, 0).r;\n"
+    "        p.z = data_zscale.x * h + data_zscale.y;\n"
+    "        vec2 g;\n"
+    "        if (data_displace == 1) {\n"
+    "            g.x = (data_z (t + ivec2(1, 0)) - data_z (t - ivec2(1, 0))) / (2.0 * data_spacing.x);\n"
+    "            g.y = (data_z (t + ivec2(0, 1)) - data_z (t - ivec2(0, 1))) / (2.0 * data_spacing.y);\n"
+    "        } else {\n"
+    "            float e = data_z (t + ivec2(1, 0));\n"
+    "            float w = data_z (t + ivec2(-1, 0));\n"
+    "            float ne = data_z (t + ivec2(0, 1));\n"
+    "            float nw = data_z (t + ivec2(-1, 1));\n"
+    "            float sw = data_z (t + ivec2(0, -1));\n"
+    "            float se = data_z (t + ivec2(1, -1));\n"
+    "            g.x = (2.0 * (e - w) + ne - nw - sw + se) / (6.0 * data_spacing.x);\n"
+    "            g.y = (ne + nw - sw - se) / (4.0 * data_spacing.y);\n"
+    "        }\n"
+    "        n = vec4(normalize (vec3(-g, 1.0)), 0.0);\n"
+    "        float s = clamp (data_scale.x * h + data_scale.y, 0.0, 1.0);\n"
+    "        float nl = float(textureSize (lut_tex, 0).x);\n"
+    "        c = texture (lut_tex, vec2((s * (nl - 1.0) + 0.5) / nl, 0.5)).rgb;\n"
+    "    }\n"
+    "    gl_Position = (p_matrix * v_matrix * m_matrix * p);\n"
+    "    vertex.color = vec4(c, alpha);\n"
+    "    vertex.fragpos = vec3(m_matrix * p);\n"
+    "    vertex.normal = n;\n"
     "}\n";
 
     std::string getDefaultVtxShader (const int glver)
@@ -141,16 +191,26 @@ namespace morph {
     "uniform float ambient_intensity;\n"
     "uniform vec3 diffuse_position;\n"
     "uniform float diffuse_intensity;\n"
+    "uniform int data_texture;\n"
+    "uniform highp sampler2D data_tex;\n"
+    "uniform sampler2D lut_tex;\n"
+    "uniform vec2 data_scale;\n"
     "out vec4 finalcolor;\n"
     "void main()\n"
     "{\n"
+    "    vec4 colr = vertex.color;\n"
+    "    if (data_texture != 0 && colr.z < 0.0) {\n"
+    "        float s = clamp (data_scale.x * texture (data_tex, colr.xy).r + data_scale.y, 0.0, 1.0);\n"
+    "        float n = float(textureSize (lut_tex, 0).x);\n"
+    "        colr.rgb = texture (lut_tex, vec2((s * (n - 1.0) + 0.5) / n, 0.5)).rgb;\n"
+    "    }\n"
     "    vec3 norm = normalize(vec3(vertex.normal));\n"
     "    vec3 light_dirn = normalize(diffuse_position - vertex.fragpos);\n"
     "    float effective_diffuse = max(dot(norm, light_dirn), 0.0);\n"
     "    vec3 diffuse = diffuse_intensity * effective_diffuse * light_colour;\n"
     "    vec3 ambient = ambient_intensity * light_colour;\n"
-    "    vec3 result = (ambient+diffuse) * vec3(vertex.color);\n"
-    "    finalcolor = vec4(result, vertex.color.w);\n"
+    "    vec3 result = (ambient+diffuse) * colr.rgb;\n"
+    "    finalcolor = vec4(result, colr.w);\n"
     "}\n";
 
     std::string getDefaultFragShader (const int glver)
@@ -260,4 +320,206 @@ namespace morph {
         return shdr;
     }
 
+    /*
+     * Sphere impostors, used by VisualModel when sphere_impostors is set. Each instance is one
+     * quad, facing the eye and tangent to the front of the sphere of radius inst_scale.x about
+     * inst_posn, which covers the sphere's silhouette in both perspective and orthographic
+     * projections. The fragment shader casts the ray through each fragment of the quad onto
+     * the sphere, discards the fragments that miss, and writes the depth and the lit colour of
+     * the hit. The lighting is that of the default fragment shader, in view coordinates.
+     */
+    const char* impostorVtxShader = "precision highp float;\n"
+    "uniform mat4 m_matrix;\n"
+    "uniform mat4 v_matrix;\n"
+    "uniform mat4 p_matrix;\n"
+    "uniform float alpha;\n"
+    "uniform vec3 diffuse_position;\n"
+    "layout(location = 0) in vec4 position;\n"
+    "layout(location = 4) in vec3 inst_posn;\n"
+    "layout(location = 5) in vec3 inst_scale;\n"
+    "layout(location = 7) in vec3 inst_color;\n"
+    "out vec3 imp_viewpos;\n"
+    "flat out vec3 imp_centre;\n"
+    "flat out float imp_radius;\n"
+    "flat out vec4 imp_color;\n"
+    "flat out vec3 imp_light;\n"
+    "void main()\n"
+    "{\n"
+    "    mat4 mv = v_matrix * m_matrix;\n"
+    "    vec3 c = vec3(mv * vec4(inst_posn, 1.0));\n"
+    "    float r = inst_scale.x * length (vec3(mv[0]));\n"
+    "    // From the centre towards the eye (at the origin, or at infinity for an orthographic projection)\n"
+    "    vec3 dirn = p_matrix[3][3] != 0.0 ? vec3(0.0, 0.0, 1.0) : normalize (-c);\n"
+    "    vec3 u = normalize (cross (abs (dirn.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), dirn));\n"
+    "    vec3 w = cross (dirn, u);\n"
+    "    vec3 v = c + r * (dirn + position.x * u + position.y * w);\n"
+    "    imp_viewpos = v;\n"
+    "    imp_centre = c;\n"
+    "    imp_radius = r;\n"
+    "    imp_color = vec4(inst_color, alpha);\n"
+    "    imp_light = vec3(v_matrix * vec4(diffuse_position, 1.0));\n"
+    "    gl_Position = p_matrix * vec4(v, 1.0);\n"
+    "}\n";
+
+    std::string getImpostorVtxShader (const int glver)
+    {
+        std::string shdr;
+        shdr += morph::gl::version::shaderpreamble (glver);
+        shdr += impostorVtxShader;
+        return shdr;
+    }
+
+    const char* impostorFragShader = "precision highp float;\n"
+    "uniform mat4 p_matrix;\n"
+    "uniform vec3 light_colour;\n"
+    "uniform float ambient_intensity;\n"
+    "uniform float diffuse_intensity;\n"
+    "in vec3 imp_viewpos;\n"
+    "flat in vec3 imp_centre;\n"
+    "flat in float imp_radius;\n"
+    "flat in vec4 imp_color;\n"
+    "flat in vec3 imp_light;\n"
+    "out vec4 finalcolor;\n"
+    "void main()\n"
+    "{\n"
+    "    // The ray through this fragment, from the quad, which is in front of the sphere\n"
+    "    vec3 rd = p_matrix[3][3] != 0.0 ? vec3(0.0, 0.0, -1.0) : normalize (imp_viewpos);\n"
+    "    vec3 oc = imp_viewpos - imp_centre;\n"
+    "    float b = dot (oc, rd);\n"
+    "    float h = b * b - dot (oc, oc) + imp_radius * imp_radius;\n"
+    "    if (h < 0.0) { discard; }\n"
+    "    vec3 hit = imp_viewpos + (-b - sqrt (h)) * rd;\n"
+    "    vec4 clip = p_matrix * vec4(hit, 1.0);\n"
+    "    float ndc_z = clip.z / clip.w;\n"
+    "    gl_FragDepth = 0.5 * (gl_DepthRange.diff * ndc_z + gl_DepthRange.near + gl_DepthRange.far);\n"
+    "    vec3 norm = (hit - imp_centre) / imp_radius;\n"
+    "    vec3 light_dirn = normalize (imp_light - hit);\n"
+    "    float effective_diffuse = max (dot (norm, light_dirn), 0.0);\n"
+    "    vec3 diffuse = diffuse_intensity * effective_diffuse * light_colour;\n"
+    "    vec3 ambient = ambient_intensity * light_colour;\n"
+    "    finalcolor = vec4((ambient + diffuse) * imp_color.rgb, imp_color.a);\n"
+    "}\n";
+
+    std::string getImpostorFragShader (const int glver)
+    {
+        std::string shdr;
+        shdr += morph::gl::version::shaderpreamble (glver);
+        shdr += impostorFragShader;
+        return shdr;
+    }
+
+    /*
+     * Shaders that scale a frame drawn at reduced resolution (see
+     * VisualOwnable::adaptive_resolution) up to the window. One triangle, from the vertex
+     * IDs alone, covers the window; the frame texture is sampled with linear filtering.
+     */
+    const char* upsampleVtxShader = "out vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 p = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);\n"
+    "    uv = 0.5 * p + 0.5;\n"
+    "    gl_Position = vec4(p, 0.0, 1.0);\n"
+    "}\n";
+
+    std::string getUpsampleVtxShader (const int glver)
+    {
+        std::string shdr;
+        shdr += morph::gl::version::shaderpreamble (glver);
+        shdr += upsampleVtxShader;
+        return shdr;
+    }
+
+    const char* upsampleFragShader = "uniform sampler2D frame;\n"
+    "in vec2 uv;\n"
+    "out vec4 finalcolor;\n"
+    "void main()\n"
+    "{\n"
+    "    finalcolor = texture (frame, uv);\n"
+    "}\n";
+
+    std::string getUpsampleFragShader (const int glver)
+    {
+        std::string shdr;
+        shdr += morph::gl::version::shaderpreamble (glver);
+        shdr += upsampleFragShader;
+        return shdr;
+    }
+
+    /*
+     * The vertex shader of VisualBatch, which draws many static models in one multi-draw
+     * indirect call. Each vertex's draw_id (the base instance of its model's draw command)
+     * selects the model matrix and alpha of its model from the batch_models storage buffer.
+     * Otherwise this is the default vertex shader, for use with the default fragment shader.
+     * Needs OpenGL 4.3.
+     */
+    const char* staticBatchVtxShader = "uniform mat4 v_matrix;\n"
+    "uniform mat4 p_matrix;\n"
+    "layout(location = 0) in vec4 position;\n"
+    "layout(location = 1) in vec4 normalin;\n"
+    "layout(location = 2) in vec3 color;\n"
+    "layout(location = 8) in uint draw_id;\n"
+    "struct batch_model\n"
+    "{\n"
+    "    mat4 m_matrix;\n"
+    "    vec4 params; // alpha, then padding\n"
+    "};\n"
+    "layout(std430, binding = 0) readonly buffer batch_models { batch_model models[]; };\n"
+    "out VERTEX\n"
+    "{\n"
+    "    vec4 normal;\n"
+    "    vec4 color;\n"
+    "    vec3 fragpos;\n"
+    "} vertex;\n"
+    "void main()\n"
+    "{\n"
+    "    mat4 m_matrix = models[draw_id].m_matrix;\n"
+    "    gl_Position = (p_matrix * v_matrix * m_matrix * position);\n"
+    "    vertex.color = vec4(color, models[draw_id].params.x);\n"
+    "    vertex.fragpos = vec3(m_matrix * position);\n"
+    "    vertex.normal = normalin;\n"
+    "}\n";
+
+    std::string getStaticBatchVtxShader (const int glver)
+    {
+        std::string shdr;
+        shdr += morph::gl::version::shaderpreamble (glver);
+        shdr += staticBatchVtxShader;
+        return shdr;
+    }
+
+    /*
+     * A compute shader used by VisualDataModel::updateColourFromBuffer to colour vertices
+     * directly from scalar data held in a GL buffer. Each datum is scaled by scale_m, scale_c
+     * then looked up in a table of colours sampled from a ColourMap. Its output is written
+     * straight into the colour VBO of the model. Needs OpenGL 4.3 or OpenGL 3.1 ES.
+     */
+    const char* defaultColourComputeShader = "precision highp float;\n"
+    "layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;\n"
+    "layout (std430, binding = 0) readonly buffer DataBlock { float data[]; };\n"
+    "layout (std430, binding = 1) writeonly buffer ColourBlock { float colours[]; };\n"
+    "layout (std430, binding = 2) readonly buffer LutBlock { float lut[]; };\n"
+    "uniform uint n_data;\n"
+    "uniform uint verts_per_datum;\n"
+    "uniform uint lut_size;\n"
+    "uniform float scale_m;\n"
+    "uniform float scale_c;\n"
+    "void main()\n"
+    "{\n"
+    "    uint v = gl_GlobalInvocationID.x;\n"
+    "    if (v >= n_data * verts_per_datum) { return; }\n"
+    "    float s = clamp (scale_m * data[v / verts_per_datum] + scale_c, 0.0, 1.0);\n"
+    "    uint li = 3u * uint (round (s * float(lut_size - 1u)));\n"
+    "    colours[3u * v] = lut[li];\n"
+    "    colours[3u * v + 1u] = lut[li + 1u];\n"
+    "    colours[3u * v + 2u] = lut[li + 2u];\n"
+    "}\n";
+
+    std::string getDefaultColourComputeShader (const int glver)
+    {
+        std::string shdr;
+        shdr += morph::gl::version::shaderpreamble (glver);
+        shdr += defaultColourComputeShader;
+        return shdr;
+    }
+
 } // namespace morph
@@ -11,14 +11,21 @@
 #pragma once
 
 #include <map>
+#include <vector>
 #include <iostream>
 #include <utility>
 #include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <cstdint>
 
 #include <morph/tools.h>
 #include <morph/VisualCommon.h> // for visgl::CharInfo
 #include <morph/VisualFont.h>
 #include <morph/TextFeatures.h>
+#include <morph/glyph_cache.h>
+#include <morph/memory_usage.h>
 
 #if defined __gl3_h_ || defined __gl_h_
 // GL headers have been externally included
@@ -191,212 +198,103 @@ namespace morph {
 #endif
                 )
             {
-                std::string fontpath = "";
-#ifdef __WIN__
-		char* userprofile = getenv ("USERPROFILE");
-		std::string uppath("");
-		if (userprofile != nullptr) {
-		    uppath = std::string (userprofile);
-		}
+                // The font is read by FreeType straight from the bytes embedded in the binary
+                const std::pair<const unsigned char*, std::size_t> fontdata = VisualFace::embedded_font (_font);
+                this->font_bytes = static_cast<std::uint64_t>(fontdata.second);
 
-                switch (_font) {
-                case VisualFont::DVSans:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\DejaVuSans.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_dvsansData, vf_dvsansEnd);
-                    break;
-                }
-                case VisualFont::DVSansItalic:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\DejaVuSans-Oblique.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_dvsansitData, vf_dvsansitEnd);
-                    break;
-                }
-                case VisualFont::DVSansBold:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\DejaVuSans-Bold.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_dvsansbdData, vf_dvsansbdEnd);
-                    break;
-                }
-                case VisualFont::DVSansBoldItalic:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\DejaVuSans-BoldOblique.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_dvsansbiData, vf_dvsansbiEnd);
-                    break;
-                }
-                case VisualFont::Vera:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\Vera.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veraData, vf_veraEnd);
-                    break;
-                }
-                case VisualFont::VeraItalic:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraIt.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veraitData, vf_veraitEnd);
-                    break;
-                }
-                case VisualFont::VeraBold:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraBd.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_verabdData, vf_verabdEnd);
-                    break;
-                }
-                case VisualFont::VeraBoldItalic:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraBI.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_verabiData, vf_verabiEnd);
-                    break;
-                }
-                case VisualFont::VeraMono:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraMono.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veramonoData, vf_veramonoEnd);
-                    break;
-                }
-                case VisualFont::VeraMonoBold:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraMoBd.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veramobdData, vf_veramobdEnd);
-                    break;
-                }
-                case VisualFont::VeraMonoItalic:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraMoIt.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veramoitData, vf_veramoitEnd);
-                    break;
-                }
-                case VisualFont::VeraMonoBoldItalic:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraMoBI.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veramobiData, vf_veramobiEnd);
-                    break;
-                }
-                case VisualFont::VeraSerif:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraSe.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_veraseData, vf_veraseEnd);
-                    break;
-                }
-                case VisualFont::VeraSerifBold:
-                {
-                    fontpath = uppath + "\\AppData\\Local\\Temp\\VeraSeBd.ttf";
-                    this->makeTempFontFile<const unsigned char> (fontpath, vf_verasebdData, vf_verasebdEnd);
-                    break;
-                }
-                default:
-                {
-                    std::cout << "ERROR::Unsupported morph font\n";
-                    break;
-                }
-                }
-#else	 // Non-windows:
-                switch (_font) {
-                case VisualFont::DVSans:
-                {
-                    fontpath = "/tmp/DejaVuSans.ttf";
-                    this->makeTempFontFile (fontpath, __start_dvsans_ttf, __stop_dvsans_ttf);
-                    break;
-                }
-                case VisualFont::DVSansItalic:
-                {
-                    fontpath = "/tmp/DejaVuSans-Oblique.ttf";
-                    this->makeTempFontFile (fontpath, __start_dvsansit_ttf, __stop_dvsansit_ttf);
-                    break;
-                }
-                case VisualFont::DVSansBold:
-                {
-                    fontpath = "/tmp/DejaVuSans-Bold.ttf";
-                    this->makeTempFontFile (fontpath, __start_dvsansbd_ttf, __stop_dvsansbd_ttf);
-                    break;
-                }
-                case VisualFont::DVSansBoldItalic:
-                {
-                    fontpath = "/tmp/DejaVuSans-BoldOblique.ttf";
-                    this->makeTempFontFile (fontpath, __start_dvsansbi_ttf, __stop_dvsansbi_ttf);
-                    break;
-                }
-                case VisualFont::Vera:
-                {
-                    fontpath = "/tmp/Vera.ttf";
-                    this->makeTempFontFile (fontpath, __start_vera_ttf, __stop_vera_ttf);
-                    break;
-                }
-                case VisualFont::VeraItalic:
-                {
-                    fontpath = "/tmp/VeraIt.ttf";
-                    this->makeTempFontFile (fontpath, __start_verait_ttf, __stop_verait_ttf);
-                    break;
-                }
-                case VisualFont::VeraBold:
-                {
-                    fontpath = "/tmp/VeraBd.ttf";
-                    this->makeTempFontFile (fontpath, __start_verabd_ttf, __stop_verabd_ttf);
-                    break;
-                }
-                case VisualFont::VeraBoldItalic:
-                {
-                    fontpath = "/tmp/VeraBI.ttf";
-                    this->makeTempFontFile (fontpath, __start_verabi_ttf, __stop_verabi_ttf);
-                    break;
-                }
-                case VisualFont::VeraMono:
-                {
-                    fontpath = "/tmp/VeraMono.ttf";
-                    this->makeTempFontFile (fontpath, __start_veramono_ttf, __stop_veramono_ttf);
-                    break;
-                }
-                case VisualFont::VeraMonoBold:
-                {
-                    fontpath = "/tmp/VeraMoBd.ttf";
-                    this->makeTempFontFile (fontpath, __start_veramobd_ttf, __stop_veramobd_ttf);
-                    break;
-                }
-                case VisualFont::VeraMonoItalic:
-                {
-                    fontpath = "/tmp/VeraMoIt.ttf";
-                    this->makeTempFontFile (fontpath, __start_veramoit_ttf, __stop_veramoit_ttf);
-                    break;
-                }
-                case VisualFont::VeraMonoBoldItalic:
-                {
-                    fontpath = "/tmp/VeraMoBI.ttf";
-                    this->makeTempFontFile (fontpath, __start_veramobi_ttf, __stop_veramobi_ttf);
-                    break;
-                }
-                case VisualFont::VeraSerif:
-                {
-                    fontpath = "/tmp/VeraSe.ttf";
-                    this->makeTempFontFile (fontpath, __start_verase_ttf, __stop_verase_ttf);
-                    break;
-                }
-                case VisualFont::VeraSerifBold:
-                {
-                    fontpath = "/tmp/VeraSeBd.ttf";
-                    this->makeTempFontFile (fontpath, __start_verasebd_ttf, __stop_verasebd_ttf);
-                    break;
+                // Glyph bitmaps are packed, row by row, into atlas pages of atlas_size square
+                // pixels, so that a whole string can be drawn from one texture.
+                GLint max_tex = 0;
+#ifdef GLAD_OPTION_GL_MX
+                if (glfn == nullptr) { throw std::runtime_error ("glfn problem"); }
+                glfn->GetIntegerv (GL_MAX_TEXTURE_SIZE, &max_tex);
+#else
+                glGetIntegerv (GL_MAX_TEXTURE_SIZE, &max_tex);
+#endif
+                this->atlas_size = std::min (static_cast<unsigned int>(max_tex), atlas_size_default);
+                // A glyph must fit on a page
+                while (this->atlas_size < 2 * fontpixels + 2 * morph::glyph_atlas::pad
+                       && this->atlas_size < static_cast<unsigned int>(max_tex)) { this->atlas_size *= 2; }
+
+                // The atlas is rasterised by FreeType only if no other VisualFace (in any window) or
+                // earlier run (see glyph_cache::cache_dir) has already made it.
+                std::shared_ptr<const morph::glyph_atlas> atlas = morph::glyph_cache::i().get (
+                    _font, fontpixels, this->atlas_size, this->font_bytes,
+                    [this, &fontdata, fontpixels, &ft_freetype]() {
+                        return this->rasterise (fontdata, fontpixels, ft_freetype);
+                    });
+
+                // Upload the pages to this context
+                for (std::size_t p = 0; p < atlas->pages.size(); ++p) {
+#ifdef GLAD_OPTION_GL_MX
+                    this->upload_page (atlas->pages[p], atlas->page_heights[p], glfn);
+#else
+                    this->upload_page (atlas->pages[p], atlas->page_heights[p]);
+#endif
                 }
-                default:
-                {
-                    std::cout << "ERROR::Unsupported morph font\n";
-                    break;
+                for (const auto& g : atlas->glyphs) {
+                    morph::visgl::CharInfo glchar = {
+                        this->atlas_textures[g.second.page],
+                        g.second.size,
+                        g.second.bearing,
+                        g.second.advance,
+                        g.second.uv
+                    };
+                    this->glchars.insert (std::pair<char32_t, morph::visgl::CharInfo>(g.first, glchar));
                 }
+                if constexpr (debug_visualface == true) {
+                    std::cout << "VisualFace: " << this->glchars.size() << " glyphs in " << this->atlas_textures.size()
+                              << " atlas page(s) of width " << this->atlas_size << std::endl;
                 }
-#endif // Windows/Non-windows
+            }
+
+            ~VisualFace() { /* GL deconstruction? */ }
 
-                // Keep the face as a morph::Visual owned resource, shared by VisTextModels?
+            //! Set true for informational/debug messages
+            static constexpr bool debug_visualface = false;
+
+            //! The FT_Face that we're managing. Only open while the glyphs are being rasterised.
+            FT_Face face = nullptr;
+
+            //! The OpenGL character info stuff
+            std::map<char32_t, morph::visgl::CharInfo> glchars;
+
+            //! The atlas page textures. Each glyph's CharInfo::textureID is one of these.
+            std::vector<unsigned int> atlas_textures;
+            //! The width of the atlas pages (the last page may be less tall)
+            unsigned int atlas_size = atlas_size_default;
+            //! The preferred atlas page width and height
+            static constexpr unsigned int atlas_size_default = 2048;
+            //! The bytes of texture memory taken by the atlas pages
+            std::size_t atlas_bytes = 0;
+
+            //! The memory held by the glyph table and the atlas textures
+            morph::memory_usage memory_usage (const std::string& name = "VisualFace") const
+            {
+                morph::memory_usage mu (name, 0, this->atlas_bytes);
+                mu.add ("glchars", this->glchars);
+                mu.add ("atlas_textures", this->atlas_textures);
+                return mu;
+            }
+
+        private:
+            //! Rasterise every glyph in the font file held in memory at fontdata into a glyph atlas
+            //! with pages of atlas_size
+            morph::glyph_atlas rasterise (const std::pair<const unsigned char*, std::size_t>& fontdata,
+                                          const unsigned int fontpixels, FT_Library& ft_freetype)
+            {
+                morph::glyph_atlas atlas (this->atlas_size);
+                if (fontdata.first == nullptr) { return atlas; }
                 if constexpr (debug_visualface == true) {
-                    std::cout << "FT_New_Face (ft_freetype, " << fontpath << ", 0, &this->face);\n";
+                    std::cout << "FT_New_Memory_Face (ft_freetype, " << fontdata.second << " bytes, 0, &this->face);\n";
                 }
-                if (FT_New_Face (ft_freetype, fontpath.c_str(), 0, &this->face)) {
+                if (FT_New_Memory_Face (ft_freetype, fontdata.first, static_cast<FT_Long>(fontdata.second), 0, &this->face)) {
                     std::cout << "ERROR::FREETYPE: Failed to load font (font file may be invalid)" << std::endl;
+                    return atlas;
                 }
 
                 FT_Set_Pixel_Sizes (this->face, 0, fontpixels);
 
-                // Can I check this->face for how many glyphs it has? Yes:
-                // std::cout << "This face has " << this->face->num_glyphs << " glyphs.\n";
-
                 // How far to loop. In principle, up to 21 bits worth - that's 2097151 possible characters!
                 for (char32_t c = 0; c < 2097151; c++) {
                     // Check glyph index first, if it's 0 it's a blank so skip.
@@ -408,106 +306,91 @@ namespace morph {
                                   << std::hex << static_cast<unsigned int>(c) << std::dec << std::endl;
                         continue;
                     }
+                    const FT_Bitmap& bm = this->face->glyph->bitmap;
+                    if (!atlas.add (c, bm.buffer, bm.width, bm.rows, bm.pitch,
+                                    {this->face->glyph->bitmap_left, this->face->glyph->bitmap_top},
+                                    static_cast<unsigned int>(this->face->glyph->advance.x))) {
+                        std::cout << "ERROR::VisualFace: Glyph for Unicode 0x" << std::hex << static_cast<unsigned int>(c)
+                                  << std::dec << " is too large for the glyph atlas" << std::endl;
+                    }
+                }
+                atlas.finish();
+                // We no longer do anything Freetypey with the face
+                FT_Done_Face (this->face);
+                this->face = nullptr;
+                return atlas;
+            }
 
-                    // generate texture
-                    unsigned int texture = 0;
+            //! Upload a page of the glyph atlas, height rows of atlas_size pixels, as a new texture
+            void upload_page (const std::vector<unsigned char>& page, const unsigned int height
 #ifdef GLAD_OPTION_GL_MX
-                    if (glfn == nullptr) { throw std::runtime_error ("glfn problem"); }
-                    glfn->GenTextures (1, &texture);
-                    glfn->BindTexture (GL_TEXTURE_2D, texture);
-                    glfn->TexImage2D(
-                        GL_TEXTURE_2D,
-                        0,
-                        GL_RED,
-                        this->face->glyph->bitmap.width,
-                        this->face->glyph->bitmap.rows,
-                        0,
-                        GL_RED,
-                        GL_UNSIGNED_BYTE,
-                        this->face->glyph->bitmap.buffer
-                        );
-                    // set texture options
-                    glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                    glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Could be GL_NEAREST, but doesn't look as good.
-#else
-                    glGenTextures (1, &texture);
-                    glBindTexture (GL_TEXTURE_2D, texture);
-                    glTexImage2D(
-                        GL_TEXTURE_2D,
-                        0,
-                        GL_RED,
-                        this->face->glyph->bitmap.width,
-                        this->face->glyph->bitmap.rows,
-                        0,
-                        GL_RED,
-                        GL_UNSIGNED_BYTE,
-                        this->face->glyph->bitmap.buffer
-                        );
-                    // set texture options
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Could be GL_NEAREST, but doesn't look as good.
+                              , GladGLContext* glfn
 #endif
-                    // now store character for later use
-                    morph::visgl::CharInfo glchar = {
-                        texture,
-                        {static_cast<int>(this->face->glyph->bitmap.width), static_cast<int>(this->face->glyph->bitmap.rows)}, // size
-                        {this->face->glyph->bitmap_left, this->face->glyph->bitmap_top}, // bearing
-                        static_cast<unsigned int>(this->face->glyph->advance.x)          // advance
-                    };
-
-                    if constexpr (debug_visualface == true) {
-                        std::cout << "Inserting character into this->glchars with info: ID:" << glchar.textureID
-                                  << ", Size:" << glchar.size << ", Bearing:" << glchar.bearing
-                                  << ", Advance:" << glchar.advance << std::endl;
-                    }
-                    this->glchars.insert (std::pair<char32_t, morph::visgl::CharInfo>(c, glchar));
-                }
+                )
+            {
+                unsigned int texture = 0;
 #ifdef GLAD_OPTION_GL_MX
-                glfn->BindTexture(GL_TEXTURE_2D, 0);
+                glfn->GenTextures (1, &texture);
+                glfn->BindTexture (GL_TEXTURE_2D, texture);
+                glfn->TexImage2D (GL_TEXTURE_2D, 0, GL_RED, this->atlas_size, height, 0, GL_RED, GL_UNSIGNED_BYTE, page.data());
+                // set texture options
+                glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Could be GL_NEAREST, but doesn't look as good.
+                glfn->BindTexture (GL_TEXTURE_2D, 0);
 #else
-                glBindTexture(GL_TEXTURE_2D, 0);
+                glGenTextures (1, &texture);
+                glBindTexture (GL_TEXTURE_2D, texture);
+                glTexImage2D (GL_TEXTURE_2D, 0, GL_RED, this->atlas_size, height, 0, GL_RED, GL_UNSIGNED_BYTE, page.data());
+                // set texture options
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Could be GL_NEAREST, but doesn't look as good.
+                glBindTexture (GL_TEXTURE_2D, 0);
 #endif
-                // At this point could FT_Done_Face() etc, I think. as we no longer do anything Freetypey with it.
-                FT_Done_Face (this->face);
+                this->atlas_textures.push_back (texture);
+                this->atlas_bytes += static_cast<std::size_t>(this->atlas_size) * height;
             }
 
-            ~VisualFace() { /* GL deconstruction? */ }
-
-            //! Set true for informational/debug messages
-            static constexpr bool debug_visualface = false;
-
-            //! The FT_Face that we're managing
-            FT_Face face;
-
-            //! The OpenGL character info stuff
-            std::map<char32_t, morph::visgl::CharInfo> glchars;
-
-        private:
+            //! The size in bytes of the font file that the face is made from (identifies it in the glyph_cache)
+            std::uint64_t font_bytes = 0;
 
-            //! Create a temporary font file at fontpath, using the embedded data
-            //! starting from filestart and extending to filenend
-            template <typename T = const char>
-            void makeTempFontFile (const std::string& fontpath, T* file_start, T* file_stop)
+            //! The embedded font file for _font: a pointer to its first byte and its size. The
+            //! bytes stay in the binary's read only data, to be read in place by FreeType.
+            static std::pair<const unsigned char*, std::size_t> embedded_font (const morph::VisualFont _font)
             {
-                T* p;
-                if (!morph::tools::fileExists (fontpath)) {
-                    std::ofstream fout;
-                    fout.open (fontpath.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
-                    if (fout.is_open()) {
-                        for (p = file_start; p < file_stop; p++) { fout << *p; }
-                        fout.close();
-                    } else {
-                        std::cout << "WARNING: Failed to open " << fontpath << "!!\n";
-                    }
-                } else {
-                    if constexpr (debug_visualface == true) {
-                        std::cout << "INFO: " << fontpath << " already exists, no need to re-create it\n";
-                    }
+#ifdef __WIN__
+# define MORPH_EMBEDDED_FONT(name) { vf_##name##Data, static_cast<std::size_t>(vf_##name##End - vf_##name##Data) }
+#else
+# define MORPH_EMBEDDED_FONT(name) { reinterpret_cast<const unsigned char*>(__start_##name##_ttf), \
+                                     static_cast<std::size_t>(__stop_##name##_ttf - __start_##name##_ttf) }
+#endif
+                std::pair<const unsigned char*, std::size_t> fd = { nullptr, 0 };
+                switch (_font) {
+                case VisualFont::DVSans: { fd = MORPH_EMBEDDED_FONT(dvsans); break; }
+                case VisualFont::DVSansItalic: { fd = MORPH_EMBEDDED_FONT(dvsansit); break; }
+                case VisualFont::DVSansBold: { fd = MORPH_EMBEDDED_FONT(dvsansbd); break; }
+                case VisualFont::DVSansBoldItalic: { fd = MORPH_EMBEDDED_FONT(dvsansbi); break; }
+                case VisualFont::Vera: { fd = MORPH_EMBEDDED_FONT(vera); break; }
+                case VisualFont::VeraItalic: { fd = MORPH_EMBEDDED_FONT(verait); break; }
+                case VisualFont::VeraBold: { fd = MORPH_EMBEDDED_FONT(verabd); break; }
+                case VisualFont::VeraBoldItalic: { fd = MORPH_EMBEDDED_FONT(verabi); break; }
+                case VisualFont::VeraMono: { fd = MORPH_EMBEDDED_FONT(veramono); break; }
+                case VisualFont::VeraMonoBold: { fd = MORPH_EMBEDDED_FONT(veramobd); break; }
+                case VisualFont::VeraMonoItalic: { fd = MORPH_EMBEDDED_FONT(veramoit); break; }
+                case VisualFont::VeraMonoBoldItalic: { fd = MORPH_EMBEDDED_FONT(veramobi); break; }
+                case VisualFont::VeraSerif: { fd = MORPH_EMBEDDED_FONT(verase); break; }
+                case VisualFont::VeraSerifBold: { fd = MORPH_EMBEDDED_FONT(verasebd); break; }
+                default:
+                {
+                    std::cout << "ERROR::Unsupported morph font\n";
+                    break;
+                }
                 }
+#undef MORPH_EMBEDDED_FONT
+                return fd;
             }
         };
     } // namespace gl
@@ -0,0 +1,259 @@
+/*!
+ * \file
+ *
+ * A morph::VisualOwnable that needs no window or display. It creates a headless OpenGL
+ * context with EGL on a GBM render node (as morph::gl::compute_manager_cli does) and renders
+ * each frame into a framebuffer object. Frames are obtained with saveImage() or, without
+ * writing any file, with readPixels().
+ *
+ * Use this to generate images or movies on cluster nodes with no X server. The client code
+ * should link with EGL and gbm.
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+// EGL and gbm for a headless OpenGL context
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <gbm.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+namespace morph {
+    // There is no window. win_t only needs to be a type that VisualOwnable can point to.
+    using win_t = void;
+}
+
+#include <morph/VisualOwnable.h>
+
+namespace morph {
+
+    /*!
+     * A headless visual scene. Build the scene exactly as for morph::Visual, then call render()
+     * and saveImage() or readPixels() for each frame:
+     *
+     * \code
+     * morph::VisualHeadless<> v (1920, 1080, "frames");
+     * // ...add models...
+     * for (int f = 0; f < nframes; ++f) {
+     *     // ...update models...
+     *     v.render();
+     *     v.saveImage (std::string("frame") + std::to_string(f) + ".png");
+     * }
+     * \endcode
+     *
+     * \tparam glver The OpenGL version, encoded as a single int (see morph::gl::version). Desktop
+     * OpenGL and OpenGL ES versions are both supported, if the driver provides them.
+     */
+    template <int glver = morph::gl::version_4_1>
+    class VisualHeadless : public morph::VisualOwnable<glver>
+    {
+    public:
+        /*!
+         * Create a headless OpenGL context on the DRM render node render_node and a framebuffer
+         * of _width by _height pixels to render into.
+         */
+        VisualHeadless (const int _width, const int _height, const std::string& _title,
+                        const bool _version_stdout = true,
+                        const std::string& render_node = "/dev/dri/renderD128")
+        {
+            this->window_w = _width;
+            this->window_h = _height;
+            this->title = _title;
+            this->version_stdout = _version_stdout;
+
+            this->init_context (render_node);
+            this->setContext();
+            this->init_glad (eglGetProcAddress);
+            this->init_framebuffer();
+            // VisualResources provides font management. Ensure it exists in memory.
+            morph::VisualResources<glver>::i().create();
+            this->freetype_init();
+            this->init_gl();
+        }
+
+        //! Deconstructor frees the framebuffer and the EGL context
+        virtual ~VisualHeadless()
+        {
+            this->setContext();
+            this->free_framebuffer();
+            this->deconstructCommon();
+            eglMakeCurrent (this->egl_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (this->egl_ctx != EGL_NO_CONTEXT) { eglDestroyContext (this->egl_dpy, this->egl_ctx); }
+            if (this->egl_dpy != EGL_NO_DISPLAY) { eglTerminate (this->egl_dpy); }
+            if (this->gbm != nullptr) { gbm_device_destroy (this->gbm); }
+            if (this->drm_fd >= 0) { close (this->drm_fd); }
+        }
+
+        //! Make the EGL context current and bind the framebuffer that frames are rendered into
+        void setContext() final
+        {
+            if (eglMakeCurrent (this->egl_dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, this->egl_ctx) == EGL_FALSE) {
+                throw std::runtime_error ("VisualHeadless: Failed to eglMakeCurrent");
+            }
+            if (this->fbo != 0) {
+#ifdef GLAD_OPTION_GL_MX
+                this->glfn->BindFramebuffer (GL_FRAMEBUFFER, this->fbo);
+#else
+                glBindFramebuffer (GL_FRAMEBUFFER, this->fbo);
+#endif
+            }
+        }
+
+        //! The context is kept current; there is no other window to hand it to.
+        void releaseContext() final {}
+
+        //! There is no swap chain. Flush, so that the frame is complete when it is read.
+        void swapBuffers() final
+        {
+#ifdef GLAD_OPTION_GL_MX
+            this->glfn->Flush();
+#else
+            glFlush();
+#endif
+        }
+
+        //! Change the size of the frames. The framebuffer is re-allocated.
+        void resize (const int _width, const int _height)
+        {
+            this->setContext();
+            this->free_framebuffer();
+            this->set_winsize (_width, _height);
+            this->init_framebuffer();
+        }
+
+        //! Set up the passed-in VisualModel (or VisualTextModel) with functions that need access to Visual attributes.
+        template <typename T>
+        void bindmodel (std::unique_ptr<T>& model)
+        {
+            morph::VisualOwnable<glver>::template bindmodel<T> (model);
+            model->setContext = &morph::VisualOwnable<glver>::set_context;
+            model->releaseContext = &morph::VisualOwnable<glver>::release_context;
+        }
+
+    protected:
+        //! Open the render node and create an EGL context with no surface
+        void init_context (const std::string& render_node)
+        {
+            this->drm_fd = open (render_node.c_str(), O_RDWR);
+            if (this->drm_fd < 0) {
+                throw std::runtime_error ("VisualHeadless: Failed to open " + render_node);
+            }
+            this->gbm = gbm_create_device (this->drm_fd);
+            if (this->gbm == nullptr) {
+                throw std::runtime_error ("VisualHeadless: Failed to gbm_create_device");
+            }
+            this->egl_dpy = eglGetPlatformDisplay (EGL_PLATFORM_GBM_MESA, this->gbm, NULL);
+            if (this->egl_dpy == EGL_NO_DISPLAY) {
+                throw std::runtime_error ("VisualHeadless: Failed to eglGetPlatformDisplay");
+            }
+            if (eglInitialize (this->egl_dpy, NULL, NULL) == EGL_FALSE) {
+                throw std::runtime_error ("VisualHeadless: Failed to eglInitialize");
+            }
+            const char* egl_extension_st = eglQueryString (this->egl_dpy, EGL_EXTENSIONS);
+            if (strstr (egl_extension_st, "EGL_KHR_create_context") == NULL) {
+                throw std::runtime_error ("VisualHeadless: EGL_KHR_create_context is not available");
+            }
+            if (strstr (egl_extension_st, "EGL_KHR_surfaceless_context") == NULL) {
+                throw std::runtime_error ("VisualHeadless: EGL_KHR_surfaceless_context is not available");
+            }
+
+            constexpr bool es = morph::gl::version::gles (glver);
+            const EGLint config_attribs[] = {
+                EGL_RENDERABLE_TYPE, es ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_BIT,
+                EGL_NONE
+            };
+            EGLConfig cfg;
+            EGLint count = 0;
+            if (eglChooseConfig (this->egl_dpy, config_attribs, &cfg, 1, &count) == EGL_FALSE || count < 1) {
+                throw std::runtime_error ("VisualHeadless: Failed to eglChooseConfig");
+            }
+            if (eglBindAPI (es ? EGL_OPENGL_ES_API : EGL_OPENGL_API) == EGL_FALSE) {
+                throw std::runtime_error ("VisualHeadless: Failed to eglBindAPI");
+            }
+            // The profile mask applies only to desktop OpenGL
+            EGLint ctx_attribs[7] = {
+                EGL_CONTEXT_MAJOR_VERSION, morph::gl::version::major (glver),
+                EGL_CONTEXT_MINOR_VERSION, morph::gl::version::minor (glver),
+                EGL_NONE, EGL_NONE, EGL_NONE
+            };
+            if constexpr (!es) {
+                ctx_attribs[4] = EGL_CONTEXT_OPENGL_PROFILE_MASK;
+                ctx_attribs[5] = morph::gl::version::compat (glver)
+                ? EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT : EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT;
+            }
+            this->egl_ctx = eglCreateContext (this->egl_dpy, cfg, EGL_NO_CONTEXT, ctx_attribs);
+            if (this->egl_ctx == EGL_NO_CONTEXT) {
+                throw std::runtime_error ("VisualHeadless: Failed to eglCreateContext");
+            }
+        }
+
+        //! Create the framebuffer object (with colour and depth renderbuffers) that is rendered into
+        void init_framebuffer()
+        {
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            _glfn->GenFramebuffers (1, &this->fbo);
+            _glfn->BindFramebuffer (GL_FRAMEBUFFER, this->fbo);
+            _glfn->GenRenderbuffers (2, this->rbo);
+            _glfn->BindRenderbuffer (GL_RENDERBUFFER, this->rbo[0]);
+            _glfn->RenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, this->window_w, this->window_h);
+            _glfn->FramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->rbo[0]);
+            _glfn->BindRenderbuffer (GL_RENDERBUFFER, this->rbo[1]);
+            _glfn->RenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->window_w, this->window_h);
+            _glfn->FramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->rbo[1]);
+            GLenum status = _glfn->CheckFramebufferStatus (GL_FRAMEBUFFER);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glGenFramebuffers (1, &this->fbo);
+            glBindFramebuffer (GL_FRAMEBUFFER, this->fbo);
+            glGenRenderbuffers (2, this->rbo);
+            glBindRenderbuffer (GL_RENDERBUFFER, this->rbo[0]);
+            glRenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, this->window_w, this->window_h);
+            glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->rbo[0]);
+            glBindRenderbuffer (GL_RENDERBUFFER, this->rbo[1]);
+            glRenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->window_w, this->window_h);
+            glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->rbo[1]);
+            GLenum status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            if (status != GL_FRAMEBUFFER_COMPLETE) {
+                throw std::runtime_error ("VisualHeadless: Framebuffer is incomplete");
+            }
+        }
+
+        void free_framebuffer()
+        {
+            if (this->fbo == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            this->glfn->BindFramebuffer (GL_FRAMEBUFFER, 0);
+            this->glfn->DeleteRenderbuffers (2, this->rbo);
+            this->glfn->DeleteFramebuffers (1, &this->fbo);
+#else
+            glBindFramebuffer (GL_FRAMEBUFFER, 0);
+            glDeleteRenderbuffers (2, this->rbo);
+            glDeleteFramebuffers (1, &this->fbo);
+#endif
+            this->fbo = 0;
+            this->rbo[0] = 0;
+            this->rbo[1] = 0;
+        }
+
+        //! The render node file descriptor and the GBM device on it
+        int drm_fd = -1;
+        struct gbm_device* gbm = nullptr;
+        //! The EGL display and context
+        EGLDisplay egl_dpy = EGL_NO_DISPLAY;
+        EGLContext egl_ctx = EGL_NO_CONTEXT;
+        //! The framebuffer object which is rendered into, with its colour and depth renderbuffers
+        GLuint fbo = 0;
+        GLuint rbo[2] = { 0, 0 };
+    };
+
+} // namespace morph
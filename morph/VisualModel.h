@@ -25,11 +25,20 @@
 #include <morph/range.h>
 #include <morph/mathconst.h>
 #include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/VisualDefaultShaders.h>
 #include <morph/VisualCommon.h>
 #include <morph/VisualTextModel.h>
+#include <morph/VisualTextBatch.h>
 #include <morph/colour.h>
 #include <morph/base64.h>
 #include <morph/MathAlgo.h>
+#include <morph/job_pool.h>
+#include <morph/unit_sphere.h>
+#include <morph/trace.h>
+#include <morph/memory_usage.h>
+#include <morph/mesh_cache.h>
+#include <morph/fnv1a.h>
 #include <iostream>
 #include <vector>
 #include <array>
@@ -39,7 +48,18 @@
 #include <memory>
 #include <functional>
 #include <cstddef>
+#include <cstdint>
 #include <cmath>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <unordered_map>
 
 // Switches on some changes where I carefully unbind gl buffers after calling
 // glBufferData() and rebind when changing the vertex model. Makes no difference on my
@@ -58,6 +78,33 @@ namespace morph {
     template <int>
     class Visual;
 
+    /*!
+     * Buffer objects holding the vertex positions, normals and indices of a mesh that several
+     * VisualModels draw, each with its own colours. See VisualModel::share_geometry. The buffers
+     * are deleted (by release) when the last model lets go of them.
+     */
+    struct shared_geometry
+    {
+        //! The position, normal and index buffers
+        std::array<GLuint, 3> bufs = { 0, 0, 0 };
+        //! Deletes bufs. Set by the model that creates the buffers.
+        std::function<void(std::array<GLuint, 3>&)> release;
+        ~shared_geometry() { if (this->release) { this->release (this->bufs); } }
+    };
+
+    //! Identifies a mesh that may be shared: its GL context, its source (such as a grid), its
+    //! sizes and a hash of its content
+    struct shared_geometry_key
+    {
+        const void* context = nullptr;
+        const void* source = nullptr;
+        std::size_t n_positions = 0;
+        std::size_t n_normals = 0;
+        std::size_t n_indices = 0;
+        std::uint64_t hash = 0;
+        auto operator<=> (const shared_geometry_key&) const = default;
+    };
+
     /*!
      * OpenGL model base class
      *
@@ -96,6 +143,7 @@ namespace morph {
         //! destroy gl buffers in the deconstructor
         virtual ~VisualModel()
         {
+            this->wait_async_build();
             if (this->vbos != nullptr) {
 #ifdef GLAD_OPTION_GL_MX
                 this->get_glfn(this->parentVis)->DeleteBuffers (numVBO, this->vbos.get());
@@ -103,6 +151,35 @@ namespace morph {
 #else
                 glDeleteBuffers (numVBO, this->vbos.get());
                 glDeleteVertexArrays (1, &this->vao);
+#endif
+            }
+            if (this->instance_vbo != 0) {
+#ifdef GLAD_OPTION_GL_MX
+                this->get_glfn(this->parentVis)->DeleteBuffers (1, &this->instance_vbo);
+#else
+                glDeleteBuffers (1, &this->instance_vbo);
+#endif
+            }
+            if (this->impostor_prog != 0) {
+#ifdef GLAD_OPTION_GL_MX
+                this->get_glfn(this->parentVis)->DeleteProgram (this->impostor_prog);
+#else
+                glDeleteProgram (this->impostor_prog);
+#endif
+            }
+            if (this->gpu_queries[0] != 0) {
+#ifdef GLAD_OPTION_GL_MX
+                this->get_glfn(this->parentVis)->DeleteQueries (2, this->gpu_queries);
+#else
+                glDeleteQueries (2, this->gpu_queries);
+#endif
+            }
+            GLuint texs[2] = { this->data_tex, this->lut_tex };
+            if (texs[0] != 0 || texs[1] != 0) {
+#ifdef GLAD_OPTION_GL_MX
+                this->get_glfn(this->parentVis)->DeleteTextures (2, texs);
+#else
+                glDeleteTextures (2, texs);
 #endif
             }
         }
@@ -147,18 +224,12 @@ namespace morph {
                 _glfn->GenBuffers (numVBO, this->vbos.get()); // OpenGL 4.4- safe
             }
 
-            // Set up the indices buffer - bind and buffer the data in this->indices
-            _glfn->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
-
-            std::size_t sz = this->indices.size() * sizeof(GLuint);
-            _glfn->BufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-
             // Binds data from the "C++ world" to the OpenGL shader world for
             // "position", "normalin" and "color"
             // (bind, buffer and set vertex array object attribute)
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupGeometryVBOs();
+            this->setupColourVBO();
+            if (this->instanced) { this->setupInstanceVBO(); }
 
             // Unbind only the vertex array (not the buffers, that causes GL_INVALID_ENUM errors)
             _glfn->BindVertexArray(0); // carefully unbind and rebind
@@ -179,68 +250,229 @@ namespace morph {
                 glGenBuffers (numVBO, this->vbos.get()); // OpenGL 4.4- safe
             }
 
-            // Set up the indices buffer - bind and buffer the data in this->indices
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
-
-            std::size_t sz = this->indices.size() * sizeof(GLuint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-
             // Binds data from the "C++ world" to the OpenGL shader world for
             // "position", "normalin" and "color"
             // (bind, buffer and set vertex array object attribute)
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupGeometryVBOs();
+            this->setupColourVBO();
+            if (this->instanced) { this->setupInstanceVBO(); }
 
             // Unbind only the vertex array (not the buffers, that causes GL_INVALID_ENUM errors)
             glBindVertexArray(0); // carefully unbind and rebind
             morph::gl::Util::checkError (__FILE__, __LINE__);
 #endif
+            this->computeBoundingBox();
             this->postVertexInitRequired = false;
+            this->release_vertices();
         }
 
         //! Initialize vertex buffer objects and vertex array object. Empty for 'text only' VisualModels.
         virtual void initializeVertices() {};
 
+        /*!
+         * Call initializeVertices() (and weld() if weld_vertices is set), adding the time it
+         * takes to profile.build_ms. With a mesh_cache_key, the mesh is read from the cache
+         * instead if it is there, and written to it if not.
+         */
+        void build_vertices() { this->profile.build_ms += this->build_mesh(); }
+
+        //! The work of build_vertices(), returning the time it took in ms
+        double build_mesh()
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            static_assert (std::is_same_v<GLuint, std::uint32_t>, "mesh_cache holds 32 bit indices");
+            const morph::mesh_cache::arrays a = { &this->indices, &this->vertexPositions, &this->vertexNormals,
+                                                  &this->vertexColors, this->instanced ? &this->instanceData : nullptr };
+            if (morph::mesh_cache::load (this->mesh_cache_key, a)) {
+                this->idx = static_cast<GLuint>(this->vertexPositions.size() / 3u);
+            } else {
+                this->initializeVertices();
+                if (this->weld_vertices) { this->weld (this->weld_tolerance); }
+                if (!this->indices.empty()) { morph::mesh_cache::store (this->mesh_cache_key, a); }
+            }
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        }
+
+        /*!
+         * If not empty, the key under which this model's mesh is kept in the on-disk cache in
+         * morph::mesh_cache::dir() (if that is set; see morph/mesh_cache.h). When the cache
+         * holds a mesh with this key, each build copies the indices, vertex arrays and
+         * instances from it and initializeVertices() is not called; otherwise the mesh is built
+         * as usual and then stored. The key must name everything that the mesh depends on (the
+         * model's type, a hash of its grid and data, its options and offset), and must change
+         * when they do, as the cache can't tell. Only set it for models whose
+         * initializeVertices() makes nothing but the mesh: texts and other members that it sets
+         * are not cached. Set before finalize().
+         */
+        std::string mesh_cache_key;
+
+        /*!
+         * If true, finalize() does not build the vertices. They are built (and uploaded) by the
+         * first render_geometry() in which the model is not hidden, so that models that are
+         * hidden at first, and may never be shown, cost nothing until they are. Until then
+         * reinit() and reinit_async() do nothing (the build will use the data as it is then),
+         * and the vertex arrays are empty and the bounding box unset; call ensure_built() to
+         * build them sooner. Set before finalize().
+         */
+        bool lazy_finalize = false;
+
+        /*!
+         * With lazy_finalize, have finalize() queue the build on the shared job_pool with
+         * push_idle(), so that it runs when the pool has nothing else to do, as for
+         * reinit_async(). A model that is drawn before such a build has started is built on the
+         * render thread instead. As for reinit_async(), the data the build reads must not change
+         * until it is uploaded, and text added by initializeVertices() must be added in
+         * finish_async_build() instead.
+         */
+        bool lazy_prebuild = false;
+
+        /*!
+         * Build the vertices of a model held back by lazy_finalize now, if they have not been
+         * built, or wait for its prebuild if that has started. render_geometry() calls this.
+         * Needs the context.
+         */
+        void ensure_built()
+        {
+            if (this->prebuild_claim != nullptr && this->claim_prebuild() == false) {
+                // The prebuild has started, so wait for it and upload its vertices
+                this->wait_async_build();
+                this->collect_async_build();
+                return;
+            }
+            if (this->build_deferred == false) { return; }
+            this->build_deferred = false;
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            this->build_vertices();
+            this->postVertexInitRequired = true;
+        }
+
+        //! True while lazy_finalize holds back the build (including a prebuild that has not finished)
+        bool build_deferred_until_shown() const { return this->build_deferred || this->prebuild_claim != nullptr; }
+
+        /*!
+         * If true, weld() is applied after each build of the vertices, so that the many
+         * vertices the compute* primitives duplicate (the shared corners of neighbouring quads
+         * or hexes of the same colour, say) are uploaded once. Don't set this for a model whose
+         * vertices are later updated in place by their index, as with reinitColours(),
+         * verticesPerDatum() or reinit_range().
+         */
+        bool weld_vertices = false;
+        //! The tolerance that build_vertices() passes to weld()
+        float weld_tolerance = 0.0f;
+
+        /*!
+         * Merge the vertices that have the same position, normal and colour into one, point the
+         * indices at the vertex that is kept and drop any triangle left with two corners the
+         * same. If tolerance is greater than 0, positions are rounded to multiples of it before
+         * they are compared, so that vertices that differ only by rounding error (such as a hex
+         * corner computed from its three hexes in a different order by each) are merged.
+         * Normals and colours must match exactly. Returns the number of vertices removed.
+         */
+        std::size_t weld (const float tolerance = 0.0f)
+        {
+            const std::size_t n = this->vertexPositions.size() / 3u;
+            if (n == 0u || this->vertexNormals.size() != 3u * n || this->vertexColors.size() != 3u * n) { return 0u; }
+            for (auto i : this->indices) { if (i >= n) { return 0u; } }
+
+            using weld_key = std::array<std::int64_t, 9>;
+            struct weld_hash
+            {
+                std::size_t operator() (const weld_key& k) const noexcept
+                {
+                    std::uint64_t h = 0x9e3779b97f4a7c15ull;
+                    for (auto v : k) { h = (h ^ static_cast<std::uint64_t>(v)) * 0x100000001b3ull; h ^= h >> 32; }
+                    return static_cast<std::size_t>(h);
+                }
+            };
+            auto bits = [](const float f) -> std::int64_t
+            {
+                std::uint32_t u = 0u;
+                const float g = f == 0.0f ? 0.0f : f; // -0 and +0 are the same
+                std::memcpy (&u, &g, sizeof (u));
+                return static_cast<std::int64_t>(u);
+            };
+
+            std::unordered_map<weld_key, GLuint, weld_hash> seen;
+            seen.reserve (n);
+            std::vector<GLuint> remap (n);
+            std::size_t kept = 0u;
+            for (std::size_t i = 0u; i < n; ++i) {
+                weld_key k;
+                for (std::size_t j = 0u; j < 3u; ++j) {
+                    const float p = this->vertexPositions[3u * i + j];
+                    k[j] = tolerance > 0.0f ? static_cast<std::int64_t>(std::llround (p / tolerance)) : bits (p);
+                    k[3u + j] = bits (this->vertexNormals[3u * i + j]);
+                    k[6u + j] = bits (this->vertexColors[3u * i + j]);
+                }
+                auto [it, inserted] = seen.emplace (k, static_cast<GLuint>(kept));
+                if (inserted) {
+                    // kept <= i, so the vertex can be moved down in place
+                    for (std::size_t j = 0u; j < 3u; ++j) {
+                        this->vertexPositions[3u * kept + j] = this->vertexPositions[3u * i + j];
+                        this->vertexNormals[3u * kept + j] = this->vertexNormals[3u * i + j];
+                        this->vertexColors[3u * kept + j] = this->vertexColors[3u * i + j];
+                    }
+                    ++kept;
+                }
+                remap[i] = it->second;
+            }
+            this->vertexPositions.resize (3u * kept);
+            this->vertexNormals.resize (3u * kept);
+            this->vertexColors.resize (3u * kept);
+
+            std::size_t ni = 0u;
+            for (std::size_t t = 0u; t + 2u < this->indices.size(); t += 3u) {
+                const GLuint a = remap[this->indices[t]];
+                const GLuint b = remap[this->indices[t + 1u]];
+                const GLuint c = remap[this->indices[t + 2u]];
+                if (a == b || b == c || a == c) { continue; }
+                this->indices[ni++] = a;
+                this->indices[ni++] = b;
+                this->indices[ni++] = c;
+            }
+            this->indices.resize (ni);
+            this->idx = static_cast<GLuint>(kept);
+            return n - kept;
+        }
+
         /*!
          * Re-initialize the buffers. Client code might have appended to
-         * vertexPositions/Colors/Normals and indices before calling this method.
+         * vertexPositions/Colors/Normals and indices before calling this method. The buffers are
+         * created first if they don't exist yet, as for a model whose first build was
+         * reinit_async().
          */
         void reinit_buffers()
         {
+            MORPH_TRACE_SCOPE_CAT ("VisualModel::reinit_buffers", "render");
 #ifdef GLAD_OPTION_GL_MX
             GladGLContext* _glfn = this->get_glfn(this->parentVis);
             if (this->setContext != nullptr) { this->setContext (this->parentVis); }
-            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            if (this->postVertexInitRequired == true || this->vbos == nullptr) { this->postVertexInit(); }
+            if (this->skip_released_upload()) { return; }
             // Now re-set up the VBOs
             _glfn->BindVertexArray (this->vao);                              // carefully unbind and rebind
-            _glfn->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);  // carefully unbind and rebind
-
-            std::size_t sz = this->indices.size() * sizeof(GLuint);
-            _glfn->BufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupGeometryVBOs();
+            this->setupColourVBO();
+            if (this->instanced) { this->setupInstanceVBO(); }
 
             _glfn->BindVertexArray(0);                                // carefully unbind and rebind
             morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);  // carefully unbind and rebind
 
 #else // not GLAD_OPTION_GL_MX
             if (this->setContext != nullptr) { this->setContext (this->parentVis); }
-            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            if (this->postVertexInitRequired == true || this->vbos == nullptr) { this->postVertexInit(); }
+            if (this->skip_released_upload()) { return; }
             // Now re-set up the VBOs
             glBindVertexArray (this->vao);                              // carefully unbind and rebind
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);  // carefully unbind and rebind
-
-            std::size_t sz = this->indices.size() * sizeof(GLuint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
-            this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
-            this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupGeometryVBOs();
+            this->setupColourVBO();
+            if (this->instanced) { this->setupInstanceVBO(); }
 
             glBindVertexArray(0);                               // carefully unbind and rebind
             morph::gl::Util::checkError (__FILE__, __LINE__);   // carefully unbind and rebind
 #endif
+            this->computeBoundingBox();
+            this->release_vertices();
         }
 
         //! reinit ONLY vertexColors buffer
@@ -248,20 +480,317 @@ namespace morph {
         {
             if (this->setContext != nullptr) { this->setContext (this->parentVis); }
             if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            // Freed by gpu_resident, and not recomputed since: the buffer is up to date
+            if (this->cpu_released && this->vertexColors.empty()) { return; }
 #ifdef GLAD_OPTION_GL_MX
             GladGLContext* _glfn = this->get_glfn(this->parentVis);
             // Now re-set up the VBOs
             _glfn->BindVertexArray (this->vao);  // carefully unbind and rebind
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupColourVBO();
             _glfn->BindVertexArray(0);  // carefully unbind and rebind
             morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
 #else
             // Now re-set up the VBOs
             glBindVertexArray (this->vao);  // carefully unbind and rebind
-            this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+            this->setupColourVBO();
             glBindVertexArray(0);  // carefully unbind and rebind
             morph::gl::Util::checkError (__FILE__, __LINE__);
 #endif
+            if (this->cpu_released) { std::vector<float>().swap (this->vertexColors); }
+        }
+
+        /*!
+         * Re-upload only the vertices [first, first + count) of vertexPositions, vertexNormals and
+         * vertexColors, with glBufferSubData. Use this after changing a few vertices in place. If
+         * the number of vertices has changed since the buffers were last set up, then this falls
+         * back to reinit_buffers().
+         */
+        void reinit_range (std::size_t first, std::size_t count)
+        {
+            if (this->cpu_released) {
+                throw std::runtime_error ("VisualModel::reinit_range: the vertices were freed by gpu_resident (call restore_vertices() first)");
+            }
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            std::size_t nverts = this->vertexPositions.size() / 3u;
+            const bool geometry_sized = this->geometry_packed
+            ? (this->vbo_bytes[visgl::posnLoc] == nverts * packed_vertex_bytes && this->vertexNormals.size() == this->vertexPositions.size())
+            : (this->vbo_bytes[visgl::posnLoc] == this->vertexPositions.size() * sizeof(float)
+               && this->vbo_bytes[visgl::normLoc] == this->vertexNormals.size() * sizeof(float));
+            if (!geometry_sized || this->vbo_bytes[visgl::colLoc] != this->colour_bytes()) {
+                this->reinit_buffers();
+                return;
+            }
+            if (first >= nverts || count == 0) { return; }
+            count = std::min (count, nverts - first);
+            // Grow (but don't shrink) the bounding box to include the changed vertices
+            for (std::size_t i = 3u * first; i < 3u * (first + count); i += 3u) {
+                for (unsigned int j = 0; j < 3; ++j) {
+                    this->bb_min[j] = std::min (this->bb_min[j], this->vertexPositions[i+j]);
+                    this->bb_max[j] = std::max (this->bb_max[j], this->vertexPositions[i+j]);
+                }
+            }
+            if (this->colours_packed && !this->colours_packable (first, count)) {
+                this->reinit_buffers();
+                return;
+            }
+            if (this->geometry_packed) {
+                this->subdataPackedGeometry (first, count);
+            } else {
+                this->subdataVBO (this->vbos[posnVBO], this->vertexPositions, first, count);
+                this->subdataVBO (this->vbos[normVBO], this->vertexNormals, first, count);
+            }
+            this->subdataColours (first, count);
+            this->release_vertices();
+        }
+
+        /*!
+         * Re-upload only the colours of vertices [first, first + count), with glBufferSubData.
+         * If the number of vertices has changed since the colour buffer was last set up, then
+         * this re-uploads the whole colour buffer.
+         */
+        void reinit_colour_range (std::size_t first, std::size_t count)
+        {
+            if (this->cpu_released) {
+                throw std::runtime_error ("VisualModel::reinit_colour_range: the vertices were freed by gpu_resident (call restore_vertices() first)");
+            }
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            if (this->vbo_bytes[visgl::colLoc] != this->colour_bytes()) {
+                this->reinit_colour_buffer();
+                return;
+            }
+            std::size_t nverts = this->vertexColors.size() / 3u;
+            if (first >= nverts || count == 0) { return; }
+            count = std::min (count, nverts - first);
+            if (this->colours_packed && !this->colours_packable (first, count)) {
+                this->reinit_colour_buffer();
+                return;
+            }
+            this->subdataColours (first, count);
+            this->release_vertices();
+        }
+
+        //! Record that vertices [first, first + count) have been changed. See reinit_dirty().
+        void markDirty (std::size_t first, std::size_t count)
+        {
+            if (count == 0) { return; }
+            this->dirty_first = std::min (this->dirty_first, first);
+            this->dirty_end = std::max (this->dirty_end, first + count);
+        }
+
+        //! Upload the range of vertices accumulated by calls to markDirty(), then clear it.
+        void reinit_dirty()
+        {
+            if (this->dirty_end > this->dirty_first) {
+                this->reinit_range (this->dirty_first, this->dirty_end - this->dirty_first);
+            }
+            this->dirty_first = std::numeric_limits<std::size_t>::max();
+            this->dirty_end = 0;
+        }
+
+        /*!
+         * The usage hint for glBufferData when the vertex buffers are (re)allocated. Models whose
+         * vertices change on most frames (for example a ScatterVisual of moving points) may set
+         * this to GL_DYNAMIC_DRAW before finalize().
+         */
+        GLenum vbo_usage = GL_STATIC_DRAW;
+
+        /*!
+         * If true, the model's vertices are a template mesh which is drawn once for each instance
+         * in instanceData with a single glDrawElementsInstanced call. Each instance scales,
+         * rotates and translates the mesh and gives it a single colour (see addInstance()). This
+         * suits models made of many copies of one shape, such as ScatterVisual spheres. It needs
+         * the default (projection2d) shader. Set before finalize().
+         */
+        bool instanced = false;
+
+        /*!
+         * If true (and instanced is true), each instance is drawn as a sphere of radius equal to
+         * its x scale, by ray casting in the fragment shader, rather than as a copy of the mesh.
+         * The mesh should then be the single quad made by computeImpostorQuad(). Each sphere
+         * costs four vertices, however large it is on screen, and its silhouette, depth and
+         * lighting are exact at any zoom. The spheres are drawn with the model's own shader
+         * program, because writing gl_FragDepth in the shared program would cost every model
+         * the early depth test. Set before the first render.
+         */
+        bool sphere_impostors = false;
+
+        /*!
+         * If true, then the vertex positions, normals and indices of the model are shared with
+         * any other model in the same Visual that has exactly the same ones (and the same
+         * geometry_source()), so only the colour buffer is the model's own. This suits several
+         * fields shown on one grid with a common z, such as HexGridVisuals whose zScale has been
+         * set with setParams (0, 0). Meshes are compared by a hash of their content each time
+         * the buffers are set up; a model whose mesh differs keeps its own buffers. Don't set
+         * this for instanced models.
+         */
+        bool share_geometry = false;
+
+        //! The object (such as a grid) from which the model's mesh was computed. See share_geometry.
+        virtual const void* geometry_source() const { return nullptr; }
+
+        /*!
+         * If true, the vertex buffers are uploaded in a compact layout: the positions and the
+         * normals interleaved in one buffer, with each normal packed into a
+         * GL_INT_2_10_10_10_REV; the colours as normalised 8 bit RGBA; and 16 bit indices if
+         * there are no more than 65536 vertices. That is 20 rather than 36 bytes per vertex and
+         * 2 rather than 4 per index. The vertex arrays and the compute* functions are unchanged;
+         * only the upload packs them. Colours are rounded to 8 bits per channel, and are left as
+         * floats if any component is outside [0, 1] (as in GridVisMode::Texture). Not applied to
+         * meshes shared with share_geometry. updateColourFromBuffer() needs float colours. Set
+         * before finalize().
+         */
+        bool compact_vertices = false;
+
+        /*!
+         * If true, the CPU copies of the vertex data (vertexPositions, vertexNormals,
+         * vertexColors and indices) are freed once they have been uploaded, which roughly
+         * halves the memory that a large static model takes. The bounding box is kept, so
+         * culling still works, and Visual::savegltf() and saveglb() read the vertices back from
+         * the GPU for as long as they need them. reinit() rebuilds (and frees) the vertices as
+         * usual, but code that changes the vertex arrays in place (reinit_range() and so on)
+         * must call restore_vertices() first. Set before finalize().
+         */
+        bool gpu_resident = false;
+
+        //! True if gpu_resident has freed the vertex arrays, so that they are only on the GPU
+        bool vertices_released() const { return this->cpu_released; }
+
+        /*!
+         * If true, and the parent Visual has static_batching set, this model's triangles are
+         * drawn along with those of the other static models from shared buffers, in one draw
+         * call (see VisualBatch). Its view matrix, alpha and visibility may change freely, but
+         * any change to its vertices rebuilds the whole batch, so it suits models whose vertices
+         * rarely change. A model that overrides render_geometry() is not drawn by it, so should
+         * not set this.
+         */
+        bool static_batch = false;
+
+        /*!
+         * True if the parent Visual's VisualBatch may draw this model in place of its own
+         * render_geometry(): it has static_batch set, is built and uploaded, and is not
+         * instanced, two dimensional, textured with data_tex or freed by gpu_resident.
+         */
+        bool batchable() const
+        {
+            return this->static_batch && !this->instanced && !this->twodimensional && this->data_tex == 0
+            && !this->cpu_released && !this->postVertexInitRequired && this->indices_uploaded > 0
+            && !this->build_running() && !this->build_deferred_until_shown();
+        }
+
+        /*!
+         * Read the vertex arrays back from the buffers into which they were uploaded, if
+         * gpu_resident has freed them. With compact_vertices, the normals and colours come back
+         * as they were packed (to 10 and 8 bits). The GL context must be available. The arrays
+         * are freed again by the next upload, or by release_vertices().
+         */
+        void restore_vertices()
+        {
+            if (!this->cpu_released) { return; }
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            const GLuint ibuf = this->shared_geom != nullptr ? this->shared_geom->bufs[2] : this->vbos[idxVBO];
+            this->indices.resize (this->indices_uploaded);
+            if (this->index_type == GL_UNSIGNED_SHORT) {
+                std::vector<std::uint16_t> indices16 (this->indices_uploaded);
+                this->read_buffer (ibuf, indices16.data(), indices16.size() * sizeof(std::uint16_t));
+                std::copy (indices16.begin(), indices16.end(), this->indices.begin());
+            } else {
+                this->read_buffer (ibuf, this->indices.data(), this->indices.size() * sizeof(GLuint));
+            }
+            if (this->shared_geom != nullptr) {
+                this->vertexPositions.resize (this->shared_key.n_positions);
+                this->vertexNormals.resize (this->shared_key.n_normals);
+                this->read_buffer (this->shared_geom->bufs[0], this->vertexPositions.data(), this->vertexPositions.size() * sizeof(float));
+                this->read_buffer (this->shared_geom->bufs[1], this->vertexNormals.data(), this->vertexNormals.size() * sizeof(float));
+            } else if (this->geometry_packed) {
+                const std::size_t nv = this->vbo_bytes[visgl::posnLoc] / packed_vertex_bytes;
+                std::vector<std::uint32_t> packed (4u * nv);
+                this->read_buffer (this->vbos[posnVBO], packed.data(), packed.size() * sizeof(std::uint32_t));
+                this->vertexPositions.resize (3u * nv);
+                this->vertexNormals.resize (3u * nv);
+                for (std::size_t i = 0; i < nv; ++i) {
+                    std::memcpy (&this->vertexPositions[3u * i], &packed[4u * i], 3u * sizeof(float));
+                    unpack_normal (packed[4u * i + 3u], &this->vertexNormals[3u * i]);
+                }
+            } else {
+                this->vertexPositions.resize (this->vbo_bytes[visgl::posnLoc] / sizeof(float));
+                this->vertexNormals.resize (this->vbo_bytes[visgl::normLoc] / sizeof(float));
+                this->read_buffer (this->vbos[posnVBO], this->vertexPositions.data(), this->vertexPositions.size() * sizeof(float));
+                this->read_buffer (this->vbos[normVBO], this->vertexNormals.data(), this->vertexNormals.size() * sizeof(float));
+            }
+            if (this->colours_packed) {
+                std::vector<std::uint8_t> packed (this->vbo_bytes[visgl::colLoc]);
+                this->read_buffer (this->vbos[colVBO], packed.data(), packed.size());
+                this->vertexColors.resize (3u * (packed.size() / 4u));
+                for (std::size_t i = 0; i < packed.size() / 4u; ++i) {
+                    for (unsigned int j = 0; j < 3; ++j) { this->vertexColors[3u * i + j] = packed[4u * i + j] / 255.0f; }
+                }
+            } else {
+                this->vertexColors.resize (this->vbo_bytes[visgl::colLoc] / sizeof(float));
+                this->read_buffer (this->vbos[colVBO], this->vertexColors.data(), this->vertexColors.size() * sizeof(float));
+            }
+            this->cpu_released = false;
+        }
+
+        //! If gpu_resident, free the CPU copies of the vertex arrays, which must have been uploaded
+        void release_vertices()
+        {
+            if (!this->gpu_resident || this->indices_uploaded == 0 || this->cpu_released) { return; }
+            std::vector<GLuint>().swap (this->indices);
+            std::vector<float>().swap (this->vertexPositions);
+            std::vector<float>().swap (this->vertexNormals);
+            std::vector<float>().swap (this->vertexColors);
+            this->cpu_released = true;
+        }
+
+        //! The number of floats per instance in instanceData
+        static constexpr unsigned int instance_floats = 13;
+
+        /*!
+         * Add an instance of the mesh, scaled (per axis) by scale, rotated by rotn and then
+         * translated to posn, with colour clr. Call reinit_instances() after adding instances
+         * to an already finalized model.
+         */
+        void addInstance (const vec<float>& posn, const vec<float>& scale,
+                          const quaternion<float>& rotn, const std::array<float, 3>& clr)
+        {
+            this->vertex_push (posn, this->instanceData);
+            this->vertex_push (scale, this->instanceData);
+            this->instanceData.push_back (rotn.w);
+            this->instanceData.push_back (rotn.x);
+            this->instanceData.push_back (rotn.y);
+            this->instanceData.push_back (rotn.z);
+            this->vertex_push (clr, this->instanceData);
+        }
+
+        //! Remove all instances
+        void clearInstances() { this->instanceData.clear(); }
+
+        //! The number of instances
+        std::size_t numInstances() const { return this->instanceData.size() / instance_floats; }
+
+        /*!
+         * Upload instanceData. This is the only buffer that needs to be written when the instances
+         * have changed but the template mesh has not.
+         */
+        void reinit_instances()
+        {
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindVertexArray (this->vao);
+            this->setupInstanceVBO();
+            _glfn->BindVertexArray (0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindVertexArray (this->vao);
+            this->setupInstanceVBO();
+            glBindVertexArray (0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            this->computeBoundingBox();
         }
 
         void clearTexts() { this->texts.clear(); }
@@ -273,14 +802,17 @@ namespace morph {
             this->vertexNormals.clear();
             this->vertexColors.clear();
             this->indices.clear();
+            this->instanceData.clear();
             this->clearTexts();
             this->idx = 0u;
+            this->cpu_released = false;
             this->reinit_buffers();
         }
 
         //! Re-create the model - called after updating data
         void reinit()
         {
+            if (this->build_deferred_until_shown()) { return; }
             if (this->setContext != nullptr) { this->setContext (this->parentVis); }
             // Fixme: Better not to clear, then repeatedly pushback here:
             this->vertexPositions.clear();
@@ -289,7 +821,7 @@ namespace morph {
             this->indices.clear();
             // NB: Do NOT call clearTexts() here! We're only updating the model itself.
             this->idx = 0u;
-            this->initializeVertices();
+            this->build_vertices();
             this->reinit_buffers();
         }
 
@@ -300,6 +832,7 @@ namespace morph {
          */
         void reinit_with_clearTexts()
         {
+            if (this->build_deferred_until_shown()) { return; }
             if (this->setContext != nullptr) { this->setContext (this->parentVis); }
             this->vertexPositions.clear();
             this->vertexNormals.clear();
@@ -307,128 +840,450 @@ namespace morph {
             this->indices.clear();
             this->clearTexts();
             this->idx = 0u;
-            this->initializeVertices();
+            this->build_vertices();
             this->reinit_buffers();
         }
 
-        void reserve_vertices (std::size_t n_vertices)
+        /*!
+         * Re-create the model like reinit(), but build the vertices on a thread of the shared
+         * job_pool, so that a big rebuild does not hold up the thread that renders. The OpenGL
+         * context is not needed and may be held by another thread. Until the next frame after
+         * the build finishes, the model is drawn from the buffers that were last uploaded. Then
+         * Visual::render() calls collect_async_build(), which uploads the new vertices.
+         *
+         * While the build runs (build_pending() is true), the vertex arrays belong to it, and
+         * the data it reads must not change. A call made while a build runs waits for it to
+         * finish first. initializeVertices() cannot add text during an asynchronous build (text
+         * needs the context); a model that adds text should check async_build_thread() and add
+         * it in an override of finish_async_build() instead.
+         */
+        void reinit_async()
         {
-            this->vertexPositions.reserve (3u * n_vertices);
-            this->vertexNormals.reserve (3u * n_vertices);
-            this->vertexColors.reserve (3u * n_vertices);
-            this->indices.reserve (6u * n_vertices);
+            if (this->build_deferred_until_shown()) { return; }
+            this->queue_build (false);
         }
 
+        //! True from a call to reinit_async() until its vertices have been uploaded
+        bool build_pending() const { return this->build_state != build_status::idle; }
+
+        //! True while the vertices of an asynchronous build are being computed
+        bool build_running() const { return this->build_state == build_status::running; }
+
         /*!
-         * A function to call initialiseVertices and postVertexInit after any necessary attributes
-         * have been set (see, for example, setting the colour maps up in VisualDataModel).
+         * Block until any asynchronous build has computed its vertices (they may not yet be
+         * uploaded). A prebuild (see lazy_prebuild) that has not started is taken back instead.
          */
-        void finalize()
+        void wait_async_build()
         {
-            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
-            this->initializeVertices();
-            this->postVertexInitRequired = true;
-            // Release context after creating and finalizing this VisualModel. On Visual::render(),
-            // context will be re-acquired.
-            if (this->releaseContext != nullptr) { this->releaseContext (this->parentVis); }
+            this->claim_prebuild();
+            std::unique_lock<std::mutex> lk (this->build_mutex);
+            this->build_cv.wait (lk, [this] { return this->build_state != build_status::running; });
         }
 
-        //! Render the VisualModel. Note that it is assumed that the OpenGL context has been
-        //! obtained by the parent Visual::render call.
-        virtual void render()
+        /*!
+         * If an asynchronous build has finished, call finish_async_build() and upload the new
+         * vertices. Call with the context held, as Visual::render() does for each of its models
+         * at the start of each frame. Rethrows any exception thrown by the build. Returns true
+         * if new vertices were uploaded.
+         */
+        bool collect_async_build()
         {
-            if (this->hide == true) { return; }
-
-            // Execute post-vertex init at render, as GL should be available.
-            if (this->postVertexInitRequired == true) { this->postVertexInit(); }
+            if (this->build_state != build_status::ready) { return false; }
+            // Don't hold up the frame if another thread is just starting a new build
+            std::unique_lock<std::mutex> lk (this->build_mutex, std::try_to_lock);
+            if (!lk.owns_lock() || this->build_state != build_status::ready) { return false; }
+            this->build_state = build_status::idle;
+            this->prebuild_claim = nullptr;
+            this->profile.build_ms += this->async_build_ms;
+            if (this->build_error) {
+                std::exception_ptr e = this->build_error;
+                this->build_error = nullptr;
+                std::rethrow_exception (e);
+            }
+            this->finish_async_build();
+            this->reinit_buffers();
+            return true;
+        }
 
-            GLint prev_shader = 0;
+        //! True on the worker thread that is running initializeVertices() for reinit_async()
+        bool async_build_thread() const { return this->build_thread == std::this_thread::get_id(); }
 
-#ifdef GLAD_OPTION_GL_MX
-            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+        /*!
+         * Called on the render thread, with the context held, after an asynchronous build and
+         * before its vertices are uploaded. Override to do the parts of the build that need
+         * the context, such as adding text. Vertices may be appended here.
+         */
+        virtual void finish_async_build() {}
 
-            _glfn->GetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-            // Ensure the correct program is in play for this VisualModel
-            _glfn->UseProgram (this->get_gprog(this->parentVis));
+        /*!
+         * True if the model has work to do in its next render_geometry(), such as uploading
+         * vertices or a texture, even though nothing that render_revision() hashes has changed.
+         * Derived classes that defer work to render_geometry() should override this. A parent
+         * Visual with render_on_demand set draws a frame whenever a model returns true.
+         */
+        virtual bool render_pending() const
+        {
+            return (this->postVertexInitRequired == true && this->build_running() == false)
+            || this->build_state == build_status::ready;
+        }
 
-            if (!this->indices.empty()) {
-                // It is only necessary to bind the vertex array object before rendering
-                // (not the vertex buffer objects)
-                _glfn->BindVertexArray (this->vao);
+        /*!
+         * A hash of the state that changes what the model draws: the number of uploads to
+         * OpenGL, its visibility, alpha and view matrices, and its texts. The parent Visual
+         * compares these between frames to decide whether a frame needs drawing at all (see
+         * VisualOwnable::render_on_demand).
+         */
+        std::uint64_t render_revision() const
+        {
+            // 64 bit FNV-1a
+            std::uint64_t h = morph::fnv1a_basis;
+            auto mix = [&h](const void* data, std::size_t n) { h = morph::fnv1a (data, n, h); };
+            const unsigned int params[3] = { this->changes, this->hide ? 1u : 0u, static_cast<unsigned int>(this->texts.size()) };
+            mix (params, sizeof (params));
+            mix (&this->alpha, sizeof (this->alpha));
+            mix (this->viewmatrix.mat.data(), sizeof (float) * this->viewmatrix.mat.size());
+            mix (this->model_scaling.mat.data(), sizeof (float) * this->model_scaling.mat.size());
+            for (const auto& t : this->texts) {
+                const unsigned int c = t->get_changes();
+                mix (&c, sizeof (c));
+            }
+            return h;
+        }
 
-                // Pass this->float to GLSL so the model can have an alpha value.
-                GLint loc_a = _glfn->GetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("alpha"));
-                if (loc_a != -1) { _glfn->Uniform1f (loc_a, this->alpha); }
+        //! Timings and counts for the parent Visual's frame profiler (see VisualOwnable::profiling)
+        struct profile_counters
+        {
+            //! GPU time taken to draw the model, in ms. A timer query result, so a frame or two old.
+            double gpu_ms = 0.0;
+            //! CPU time spent in initializeVertices(), in ms
+            double build_ms = 0.0;
+            //! CPU time spent passing vertex, index and texture data to OpenGL, in ms
+            double upload_ms = 0.0;
+            //! The number of draw calls
+            unsigned int draw_calls = 0;
+            //! The number of vertices drawn (indices, times instances)
+            std::size_t vertices = 0;
+            //! The number of bytes of vertex, index and texture data passed to OpenGL
+            std::size_t upload_bytes = 0;
+        };
 
-                GLint loc_v = _glfn->GetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("v_matrix"));
-                if (loc_v != -1) { _glfn->UniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
+        /*!
+         * Accumulated since the last reset (all but gpu_ms). When profiling, the parent Visual
+         * collects and resets the counters of its models at the end of each frame.
+         */
+        profile_counters profile;
 
-                // Should be able to apply scaling to the model matrix
-                GLint loc_m = _glfn->GetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("m_matrix"));
-                if (loc_m != -1) { _glfn->UniformMatrix4fv (loc_m, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data()); }
+        //! Incremented on each upload of vertex, index or texture data (see render_revision())
+        unsigned int changes = 0;
 
-                if constexpr (debug_render) {
-                    std::cout << "VisualModel::render: scenematrix:\n" << scenematrix << std::endl;
-                    std::cout << "VisualModel::render: model viewmatrix:\n" << viewmatrix << std::endl;
+        /*!
+         * Begin a GL_TIME_ELAPSED query, to be ended by gpu_timer_end(). The parent Visual
+         * brackets render_geometry() with these when profiling. Each call first collects the
+         * result of the query made two calls ago, if it's ready, into profile.gpu_ms, so that
+         * the CPU never waits for the GPU. Does nothing on OpenGL ES, which lacks timer queries.
+         */
+        void gpu_timer_begin()
+        {
+            if constexpr (morph::gl::version::gles (glver) == false) {
+                const unsigned int q = this->gpu_query_next;
+#ifdef GLAD_OPTION_GL_MX
+                GladGLContext* _glfn = this->get_glfn(this->parentVis);
+                if (this->gpu_queries[0] == 0) { _glfn->GenQueries (2, this->gpu_queries); }
+                if (this->gpu_query_issued[q]) {
+                    GLint ready = 0;
+                    _glfn->GetQueryObjectiv (this->gpu_queries[q], GL_QUERY_RESULT_AVAILABLE, &ready);
+                    if (ready) {
+                        GLuint64 ns = 0;
+                        _glfn->GetQueryObjectui64v (this->gpu_queries[q], GL_QUERY_RESULT, &ns);
+                        this->profile.gpu_ms = static_cast<double>(ns) * 1e-6;
+                    }
                 }
-
-                // Draw the triangles
-                _glfn->DrawElements (GL_TRIANGLES, static_cast<unsigned int>(this->indices.size()), GL_UNSIGNED_INT, 0);
-
-                // Unbind the VAO
-                _glfn->BindVertexArray(0);
-            }
-            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+                _glfn->BeginQuery (GL_TIME_ELAPSED, this->gpu_queries[q]);
 #else
-            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-            // Ensure the correct program is in play for this VisualModel
-            glUseProgram (this->get_gprog(this->parentVis));
-
-            if (!this->indices.empty()) {
-                // It is only necessary to bind the vertex array object before rendering
-                // (not the vertex buffer objects)
-                glBindVertexArray (this->vao);
-
-                // Pass this->float to GLSL so the model can have an alpha value.
-                GLint loc_a = glGetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("alpha"));
-                if (loc_a != -1) { glUniform1f (loc_a, this->alpha); }
-
-                GLint loc_v = glGetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("v_matrix"));
-                if (loc_v != -1) { glUniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
-
-                // Should be able to apply scaling to the model matrix
-                GLint loc_m = glGetUniformLocation (this->get_gprog(this->parentVis), static_cast<const GLchar*>("m_matrix"));
-                if (loc_m != -1) { glUniformMatrix4fv (loc_m, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data()); }
-
-                if constexpr (debug_render) {
-                    std::cout << "VisualModel::render: scenematrix:\n" << scenematrix << std::endl;
-                    std::cout << "VisualModel::render: model viewmatrix:\n" << viewmatrix << std::endl;
+                if (this->gpu_queries[0] == 0) { glGenQueries (2, this->gpu_queries); }
+                if (this->gpu_query_issued[q]) {
+                    GLint ready = 0;
+                    glGetQueryObjectiv (this->gpu_queries[q], GL_QUERY_RESULT_AVAILABLE, &ready);
+                    if (ready) {
+                        GLuint64 ns = 0;
+                        glGetQueryObjectui64v (this->gpu_queries[q], GL_QUERY_RESULT, &ns);
+                        this->profile.gpu_ms = static_cast<double>(ns) * 1e-6;
+                    }
                 }
-
-                // Draw the triangles
-                glDrawElements (GL_TRIANGLES, static_cast<unsigned int>(this->indices.size()), GL_UNSIGNED_INT, 0);
-
-                // Unbind the VAO
-                glBindVertexArray(0);
-            }
-            morph::gl::Util::checkError (__FILE__, __LINE__);
+                glBeginQuery (GL_TIME_ELAPSED, this->gpu_queries[q]);
 #endif
+            }
+        }
 
-            // Now render any VisualTextModels
-            auto ti = this->texts.begin();
-            while (ti != this->texts.end()) { (*ti)->render(); ti++; }
+        //! End the query begun by gpu_timer_begin()
+        void gpu_timer_end()
+        {
+            if constexpr (morph::gl::version::gles (glver) == false) {
 #ifdef GLAD_OPTION_GL_MX
-            _glfn->UseProgram (prev_shader);
-            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+                this->get_glfn(this->parentVis)->EndQuery (GL_TIME_ELAPSED);
 #else
-            glUseProgram (prev_shader);
-            morph::gl::Util::checkError (__FILE__, __LINE__);
+                glEndQuery (GL_TIME_ELAPSED);
 #endif
+                this->gpu_query_issued[this->gpu_query_next] = true;
+                this->gpu_query_next ^= 1u;
+            }
         }
 
         /*!
-         * Add a text label to the model at location (within the model coordinates)
-         * toffset. Return the text geometry of the added label so caller can place
+         * The memory held by the model: its CPU side vertex data, its buffers and textures on
+         * the GPU, and its texts. Once the model has been uploaded, the CPU copies of the vertex
+         * data are counted as duplicated. A mesh shared with other models (see share_geometry)
+         * is divided between them. Derived models that hold more data should add it as parts.
+         */
+        virtual morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("VisualModel");
+            const bool uploaded = this->indices_uploaded > 0;
+            mu.add ("indices", this->indices, uploaded);
+            mu.add ("vertexPositions", this->vertexPositions, uploaded);
+            mu.add ("vertexNormals", this->vertexNormals, uploaded);
+            mu.add ("vertexColors", this->vertexColors, uploaded);
+            mu.add ("instanceData", this->instanceData, uploaded && this->instance_vbo_bytes > 0);
+
+            std::size_t buffers = this->vbo_bytes[0] + this->vbo_bytes[1] + this->vbo_bytes[2] + this->instance_vbo_bytes;
+            if (this->shared_geom == nullptr) {
+                buffers += this->indices_uploaded * (this->index_type == GL_UNSIGNED_SHORT ? 2u : 4u);
+            } else {
+                const std::size_t shared = this->shared_key.n_indices * sizeof(GLuint)
+                + (this->shared_key.n_positions + this->shared_key.n_normals) * sizeof(float);
+                mu.add (morph::memory_usage ("shared geometry", 0, shared / static_cast<std::size_t>(this->shared_geom.use_count())));
+            }
+            mu.add (morph::memory_usage ("buffers", 0, buffers));
+
+            if (this->data_tex != 0) {
+                std::size_t texels = 0;
+                for (unsigned int l = 0; l < this->data_tex_levels; ++l) {
+                    texels += static_cast<std::size_t>(std::max (this->data_tex_dims[0] >> l, 1u))
+                    * std::max (this->data_tex_dims[1] >> l, 1u);
+                }
+                mu.add (morph::memory_usage ("data_tex", 0, texels * sizeof(float)));
+            }
+
+            if (!this->texts.empty()) {
+                morph::memory_usage& t = mu.add (morph::memory_usage ("texts"));
+                for (std::size_t i = 0; i < this->texts.size(); ++i) {
+                    t.add (this->texts[i]->memory_usage ("text " + std::to_string (i)));
+                }
+            }
+            return mu;
+        }
+
+        void reserve_vertices (std::size_t n_vertices)
+        {
+            this->vertexPositions.reserve (3u * n_vertices);
+            this->vertexNormals.reserve (3u * n_vertices);
+            this->vertexColors.reserve (3u * n_vertices);
+            this->indices.reserve (6u * n_vertices);
+        }
+
+        /*!
+         * A function to call initialiseVertices and postVertexInit after any necessary attributes
+         * have been set (see, for example, setting the colour maps up in VisualDataModel).
+         */
+        void finalize()
+        {
+            if (this->lazy_finalize == true) {
+                // Built on first being drawn, or by a prebuild (which does not need the context)
+                this->build_deferred = true;
+                if (this->lazy_prebuild == true) {
+                    this->build_deferred = false;
+                    this->queue_build (true);
+                }
+                return;
+            }
+            if (this->setContext != nullptr) { this->setContext (this->parentVis); }
+            this->build_vertices();
+            this->postVertexInitRequired = true;
+            // Release context after creating and finalizing this VisualModel. On Visual::render(),
+            // context will be re-acquired.
+            if (this->releaseContext != nullptr) { this->releaseContext (this->parentVis); }
+        }
+
+        /*!
+         * Render the VisualModel. Note that it is assumed that the OpenGL context has been
+         * obtained by the parent Visual::render call. Visual::render does not call this; it calls
+         * render_geometry() for all its models, then render_texts() for all of them, so that it
+         * switches shader program only twice per frame.
+         */
+        virtual void render()
+        {
+            if (this->hide == true) { return; }
+
+            GLint prev_shader = 0;
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->GetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+            // Ensure the correct program is in play for this VisualModel
+            _glfn->UseProgram (this->get_gprog(this->parentVis));
+#else
+            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+            // Ensure the correct program is in play for this VisualModel
+            glUseProgram (this->get_gprog(this->parentVis));
+#endif
+            this->render_geometry();
+            this->render_texts();
+#ifdef GLAD_OPTION_GL_MX
+            _glfn->UseProgram (prev_shader);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glUseProgram (prev_shader);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
+
+        /*!
+         * Draw the triangles of the VisualModel. The parent Visual's graphics shader program
+         * (gprog) must be in use. Derived classes that need to update their vertices just before
+         * drawing should override this.
+         */
+        virtual void render_geometry()
+        {
+            if (this->hide == true) { return; }
+
+            // The first frame in which a model held back by lazy_finalize is visible builds it
+            if (this->build_deferred_until_shown()) { this->ensure_built(); }
+
+            // While an asynchronous build runs, the vertex arrays are its own. Draw what was last uploaded.
+            const bool building = this->build_running();
+
+            // Execute post-vertex init at render, as GL should be available.
+            if (this->postVertexInitRequired == true && !building) { this->postVertexInit(); }
+
+            if (this->indices_uploaded == 0 || this->vbos == nullptr) { return; }
+
+            if (this->instanced && this->sphere_impostors) {
+                this->render_impostors();
+                return;
+            }
+
+            // The uniform locations are looked up once, when the program is loaded
+            const morph::visgl::visual_shaderprogs::uniform_locations locs = this->get_shaderprogs(this->parentVis).gprog_locs;
+
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+
+            // It is only necessary to bind the vertex array object before rendering
+            // (not the vertex buffer objects)
+            _glfn->BindVertexArray (this->vao);
+
+            // Pass this->float to GLSL so the model can have an alpha value.
+            if (locs.alpha != -1) { _glfn->Uniform1f (locs.alpha, this->alpha); }
+            if (locs.v_matrix != -1) { _glfn->UniformMatrix4fv (locs.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            // Should be able to apply scaling to the model matrix
+            if (locs.m_matrix != -1) { _glfn->UniformMatrix4fv (locs.m_matrix, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data()); }
+            if (locs.instanced != -1) { _glfn->Uniform1i (locs.instanced, this->instanced ? 1 : 0); }
+            if (locs.data_texture != -1) { _glfn->Uniform1i (locs.data_texture, this->data_tex != 0 ? 1 : 0); }
+            if (locs.data_displace != -1) { _glfn->Uniform1i (locs.data_displace, this->data_tex != 0 ? this->data_tex_displace : 0); }
+            if (this->data_tex != 0) {
+                // Texture unit 0 is left to the text shader
+                _glfn->ActiveTexture (GL_TEXTURE1);
+                _glfn->BindTexture (GL_TEXTURE_2D, this->data_tex);
+                _glfn->ActiveTexture (GL_TEXTURE2);
+                _glfn->BindTexture (GL_TEXTURE_2D, this->lut_tex);
+                _glfn->ActiveTexture (GL_TEXTURE0);
+                if (locs.data_tex != -1) { _glfn->Uniform1i (locs.data_tex, 1); }
+                if (locs.lut_tex != -1) { _glfn->Uniform1i (locs.lut_tex, 2); }
+                if (locs.data_scale != -1) { _glfn->Uniform2f (locs.data_scale, this->data_tex_scale[0], this->data_tex_scale[1]); }
+                if (locs.data_zscale != -1) { _glfn->Uniform2f (locs.data_zscale, this->data_tex_zscale[0], this->data_tex_zscale[1]); }
+                if (locs.data_spacing != -1) { _glfn->Uniform2f (locs.data_spacing, this->data_tex_spacing[0], this->data_tex_spacing[1]); }
+            }
+
+            if constexpr (debug_render) {
+                std::cout << "VisualModel::render: scenematrix:\n" << scenematrix << std::endl;
+                std::cout << "VisualModel::render: model viewmatrix:\n" << viewmatrix << std::endl;
+            }
+
+            // Draw the triangles
+            if (this->instanced) {
+                _glfn->DrawElementsInstanced (GL_TRIANGLES, static_cast<unsigned int>(this->indices_uploaded), this->index_type, 0, static_cast<GLsizei>(this->numInstances()));
+            } else {
+                _glfn->DrawElements (GL_TRIANGLES, static_cast<unsigned int>(this->indices_uploaded), this->index_type, 0);
+            }
+            this->count_draw();
+
+            // Unbind the VAO
+            _glfn->BindVertexArray(0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            // It is only necessary to bind the vertex array object before rendering
+            // (not the vertex buffer objects)
+            glBindVertexArray (this->vao);
+
+            // Pass this->float to GLSL so the model can have an alpha value.
+            if (locs.alpha != -1) { glUniform1f (locs.alpha, this->alpha); }
+            if (locs.v_matrix != -1) { glUniformMatrix4fv (locs.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            // Should be able to apply scaling to the model matrix
+            if (locs.m_matrix != -1) { glUniformMatrix4fv (locs.m_matrix, 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data()); }
+            if (locs.instanced != -1) { glUniform1i (locs.instanced, this->instanced ? 1 : 0); }
+            if (locs.data_texture != -1) { glUniform1i (locs.data_texture, this->data_tex != 0 ? 1 : 0); }
+            if (locs.data_displace != -1) { glUniform1i (locs.data_displace, this->data_tex != 0 ? this->data_tex_displace : 0); }
+            if (this->data_tex != 0) {
+                // Texture unit 0 is left to the text shader
+                glActiveTexture (GL_TEXTURE1);
+                glBindTexture (GL_TEXTURE_2D, this->data_tex);
+                glActiveTexture (GL_TEXTURE2);
+                glBindTexture (GL_TEXTURE_2D, this->lut_tex);
+                glActiveTexture (GL_TEXTURE0);
+                if (locs.data_tex != -1) { glUniform1i (locs.data_tex, 1); }
+                if (locs.lut_tex != -1) { glUniform1i (locs.lut_tex, 2); }
+                if (locs.data_scale != -1) { glUniform2f (locs.data_scale, this->data_tex_scale[0], this->data_tex_scale[1]); }
+                if (locs.data_zscale != -1) { glUniform2f (locs.data_zscale, this->data_tex_zscale[0], this->data_tex_zscale[1]); }
+                if (locs.data_spacing != -1) { glUniform2f (locs.data_spacing, this->data_tex_spacing[0], this->data_tex_spacing[1]); }
+            }
+
+            if constexpr (debug_render) {
+                std::cout << "VisualModel::render: scenematrix:\n" << scenematrix << std::endl;
+                std::cout << "VisualModel::render: model viewmatrix:\n" << viewmatrix << std::endl;
+            }
+
+            // Draw the triangles
+            if (this->instanced) {
+                glDrawElementsInstanced (GL_TRIANGLES, static_cast<unsigned int>(this->indices_uploaded), this->index_type, 0, static_cast<GLsizei>(this->numInstances()));
+            } else {
+                glDrawElements (GL_TRIANGLES, static_cast<unsigned int>(this->indices_uploaded), this->index_type, 0);
+            }
+            this->count_draw();
+
+            // Unbind the VAO
+            glBindVertexArray(0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
+
+        /*!
+         * Render the VisualTextModels of this model. If tprog_in_use is true, the caller has
+         * already made the text shader program current, and the text models leave it current.
+         */
+        void render_texts (bool tprog_in_use = false)
+        {
+            if (this->hide == true) { return; }
+            if (this->batch_texts && this->texts.size() > 1) {
+                if (this->text_batch == nullptr) { this->text_batch = std::make_unique<morph::VisualTextBatch<glver>>(); }
+                if (this->text_batch->render (this->texts, tprog_in_use)) {
+                    // The batch leaves out the updatable texts
+                    for (auto& t : this->texts) { if (t->updatable()) { t->render (tprog_in_use); } }
+                    return;
+                }
+            }
+            auto ti = this->texts.begin();
+            while (ti != this->texts.end()) { (*ti)->render (tprog_in_use); ti++; }
+        }
+
+        /*!
+         * If true, render all the texts of this model together from one vertex buffer (see
+         * morph::VisualTextBatch), with one draw call for each glyph atlas page, colour and alpha,
+         * rather than with a draw call for each text.
+         */
+        bool batch_texts = true;
+
+        /*!
+         * Add a text label to the model at location (within the model coordinates)
+         * toffset. Return the text geometry of the added label so caller can place
          * associated text correctly.  Control font size, resolution, colour and font
          * face with tfeatures.
          */
@@ -439,6 +1294,9 @@ namespace morph {
             if (this->get_shaderprogs(this->parentVis).tprog == 0) {
                 throw std::runtime_error ("No text shader prog. Did your VisualModel-derived class set it up?");
             }
+            if (this->async_build_thread()) {
+                throw std::runtime_error ("VisualModel::addLabel: Text can't be added during reinit_async(); add it in finish_async_build()");
+            }
 
             if (this->setContext != nullptr) { this->setContext (this->parentVis); } // For VisualTextModel
 
@@ -475,6 +1333,9 @@ namespace morph {
             if (this->get_shaderprogs(this->parentVis).tprog == 0) {
                 throw std::runtime_error ("No text shader prog. Did your VisualModel-derived class set it up?");
             }
+            if (this->async_build_thread()) {
+                throw std::runtime_error ("VisualModel::addLabel: Text can't be added during reinit_async(); add it in finish_async_build()");
+            }
 
             if (this->setContext != nullptr) { this->setContext (this->parentVis); } // For VisualTextModel
 
@@ -622,6 +1483,18 @@ namespace morph {
         void toggleHide() { this->hide = this->hide ? false : true; }
         float hidden() const { return this->hide; }
 
+        /*
+         * Read access to what the model draws, for code that copies a scene elsewhere (see
+         * morph/remote_view.h). The vertex arrays are empty while gpu_resident has freed them.
+         */
+        const std::vector<GLuint>& get_indices() const { return this->indices; }
+        const std::vector<float>& get_positions() const { return this->vertexPositions; }
+        const std::vector<float>& get_normals() const { return this->vertexNormals; }
+        const std::vector<float>& get_colours() const { return this->vertexColors; }
+        const mat44<float>& getViewMatrix() const { return this->viewmatrix; }
+        const mat44<float>& get_model_scaling() const { return this->model_scaling; }
+        const std::vector<std::unique_ptr<morph::VisualTextModel<glver>>>& get_texts() const { return this->texts; }
+
         /*
          * Methods used by Visual::savegltf()
          */
@@ -657,7 +1530,11 @@ namespace morph {
         {
             morph::vec<morph::range<float>, 3> axis_extents;
             for (unsigned int i = 0; i < 3; ++i) { axis_extents[i].search_init(); }
-            for (unsigned int j = 0; j < static_cast<unsigned int>(this->vertexPositions.size() - 2); j += 3) {
+            if (this->cpu_released) {
+                for (unsigned int i = 0; i < 3; ++i) { axis_extents[i].set (this->vpos_mins[i], this->vpos_maxes[i]); }
+                return axis_extents;
+            }
+            for (unsigned int j = 0; j + 2 < static_cast<unsigned int>(this->vertexPositions.size()); j += 3) {
                 for (unsigned int i = 0; i < 3; ++i) { axis_extents[i].update (this->vertexPositions[j+i]); }
             }
             return axis_extents;
@@ -681,10 +1558,9 @@ namespace morph {
                 throw std::runtime_error ("Expect vertexPositions, Colors and Normals vectors all to have same size");
             }
 
+            this->computeVertexPositionMaxMins();
+
             for (std::size_t i = 0u; i < this->vertexPositions.size(); i+=3u) {
-                vpos_maxes[0] =  (vertexPositions[i] > vpos_maxes[0]) ? vertexPositions[i] : vpos_maxes[0];
-                vpos_maxes[1] =  (vertexPositions[i+1] > vpos_maxes[1]) ? vertexPositions[i+1] : vpos_maxes[1];
-                vpos_maxes[2] =  (vertexPositions[i+2] > vpos_maxes[2]) ? vertexPositions[i+2] : vpos_maxes[2];
                 vcol_maxes[0] =  (vertexColors[i] > vcol_maxes[0]) ? vertexColors[i] : vcol_maxes[0];
                 vcol_maxes[1] =  (vertexColors[i+1] > vcol_maxes[1]) ? vertexColors[i+1] : vcol_maxes[1];
                 vcol_maxes[2] =  (vertexColors[i+2] > vcol_maxes[2]) ? vertexColors[i+2] : vcol_maxes[2];
@@ -692,9 +1568,6 @@ namespace morph {
                 vnorm_maxes[1] =  (vertexNormals[i+1] > vnorm_maxes[1]) ? vertexNormals[i+1] : vnorm_maxes[1];
                 vnorm_maxes[2] =  (vertexNormals[i+2] > vnorm_maxes[2]) ? vertexNormals[i+2] : vnorm_maxes[2];
 
-                vpos_mins[0] =  (vertexPositions[i] < vpos_mins[0]) ? vertexPositions[i] : vpos_mins[0];
-                vpos_mins[1] =  (vertexPositions[i+1] < vpos_mins[1]) ? vertexPositions[i+1] : vpos_mins[1];
-                vpos_mins[2] =  (vertexPositions[i+2] < vpos_mins[2]) ? vertexPositions[i+2] : vpos_mins[2];
                 vcol_mins[0] =  (vertexColors[i] < vcol_mins[0]) ? vertexColors[i] : vcol_mins[0];
                 vcol_mins[1] =  (vertexColors[i+1] < vcol_mins[1]) ? vertexColors[i+1] : vcol_mins[1];
                 vcol_mins[2] =  (vertexColors[i+2] < vcol_mins[2]) ? vertexColors[i+2] : vcol_mins[2];
@@ -704,6 +1577,76 @@ namespace morph {
             }
         }
 
+        //! Compute vpos_maxes and vpos_mins, the bounding box of vertexPositions
+        void computeVertexPositionMaxMins()
+        {
+            this->vpos_maxes = { _low, _low, _low };
+            this->vpos_mins = { _max, _max, _max };
+            for (std::size_t i = 0u; i < this->vertexPositions.size(); i+=3u) {
+                vpos_maxes[0] =  (vertexPositions[i] > vpos_maxes[0]) ? vertexPositions[i] : vpos_maxes[0];
+                vpos_maxes[1] =  (vertexPositions[i+1] > vpos_maxes[1]) ? vertexPositions[i+1] : vpos_maxes[1];
+                vpos_maxes[2] =  (vertexPositions[i+2] > vpos_maxes[2]) ? vertexPositions[i+2] : vpos_maxes[2];
+                vpos_mins[0] =  (vertexPositions[i] < vpos_mins[0]) ? vertexPositions[i] : vpos_mins[0];
+                vpos_mins[1] =  (vertexPositions[i+1] < vpos_mins[1]) ? vertexPositions[i+1] : vpos_mins[1];
+                vpos_mins[2] =  (vertexPositions[i+2] < vpos_mins[2]) ? vertexPositions[i+2] : vpos_mins[2];
+            }
+        }
+
+        /*!
+         * Compute bb_min and bb_max, the bounding box of the model in model coordinates. For an
+         * instanced model this encloses every instance of the mesh. Called whenever the vertex
+         * buffers are set up.
+         */
+        void computeBoundingBox()
+        {
+            // With the vertices freed, vpos_mins and vpos_maxes still hold the mesh's extents
+            if (!this->cpu_released) { this->computeVertexPositionMaxMins(); }
+            this->bb_min = this->vpos_mins;
+            this->bb_max = this->vpos_maxes;
+            this->displaceBoundingBox();
+            if (!this->instanced || this->vpos_mins[0] > this->vpos_maxes[0]) { return; }
+            // Any rotated, scaled vertex of the mesh lies within r * (largest scale) of the instance position
+            float r = std::max (this->vpos_mins.abs().length(), this->vpos_maxes.abs().length());
+            this->bb_min = { _max, _max, _max };
+            this->bb_max = { _low, _low, _low };
+            for (std::size_t i = 0u; i + instance_floats <= this->instanceData.size(); i += instance_floats) {
+                float ri = r * std::max ({ std::abs (this->instanceData[i+3]),
+                                           std::abs (this->instanceData[i+4]),
+                                           std::abs (this->instanceData[i+5]) });
+                for (unsigned int j = 0; j < 3; ++j) {
+                    this->bb_min[j] = std::min (this->bb_min[j], this->instanceData[i+j] - ri);
+                    this->bb_max[j] = std::max (this->bb_max[j], this->instanceData[i+j] + ri);
+                }
+            }
+        }
+
+        /*!
+         * Return true if the model's bounding box lies entirely outside the view frustum defined
+         * by the projection matrix (orthographic or perspective) and the current scene and model
+         * matrices. The test is conservative: a model that returns false may still be off screen.
+         */
+        bool outsideFrustum (const mat44<float>& projection) const
+        {
+            // No vertices, so nothing to cull
+            if (this->bb_min[0] > this->bb_max[0]) { return false; }
+            mat44<float> mvp = projection * this->scenematrix * (this->model_scaling * this->viewmatrix);
+            // Count the corners outside each of the six clip planes. If all eight are outside
+            // any one plane, the box is not visible.
+            std::array<unsigned int, 6> outside = { 0, 0, 0, 0, 0, 0 };
+            for (unsigned int c = 0; c < 8; ++c) {
+                vec<float, 4> corner = { (c & 1) ? this->bb_max[0] : this->bb_min[0],
+                                         (c & 2) ? this->bb_max[1] : this->bb_min[1],
+                                         (c & 4) ? this->bb_max[2] : this->bb_min[2], 1.0f };
+                vec<float, 4> cc = mvp * corner;
+                for (unsigned int j = 0; j < 3; ++j) {
+                    if (cc[j] < -cc[3]) { ++outside[2*j]; }
+                    if (cc[j] > cc[3]) { ++outside[2*j+1]; }
+                }
+            }
+            for (unsigned int p = 0; p < 6; ++p) { if (outside[p] == 8) { return true; } }
+            return false;
+        }
+
         std::size_t vpos_size() { return this->vertexPositions.size(); }
         std::string vpos_max() { return this->vpos_maxes.str_mat(); }
         std::string vpos_min() { return this->vpos_mins.str_mat(); }
@@ -760,6 +1703,108 @@ namespace morph {
         }
         // end Visual::savegltf() methods
 
+        /*
+         * Methods used by Visual::saveglb(). Each writes one of the vertex arrays to o as a
+         * GLB buffer view: the raw bytes of the array or, if quantised, the array as the
+         * smaller integer types of KHR_mesh_quantization. Quantised data is converted in blocks,
+         * so the arrays are never copied whole.
+         */
+
+        //! The number of bytes that write_indices() writes for indices (before padding)
+        std::size_t indices_bytes (const bool quantised) const
+        {
+            return this->indices.size() * (quantised && this->indices_fit_short() ? sizeof (std::uint16_t) : sizeof (GLuint));
+        }
+        //! If true, every index fits an unsigned short (65535 is the primitive restart value)
+        bool indices_fit_short() const { return this->vertexPositions.size() / 3 < 65535u; }
+        //! Write indices, as unsigned shorts if quantised and they fit
+        void write_indices (std::ostream& o, const bool quantised) const
+        {
+            if (!quantised || !this->indices_fit_short()) {
+                o.write (reinterpret_cast<const char*>(this->indices.data()), this->indices_bytes (false));
+                return;
+            }
+            VisualModel<glver>::write_blocks<std::uint16_t, 1> (o, this->indices.size(), [this](std::size_t i, std::uint16_t* q) {
+                q[0] = static_cast<std::uint16_t>(this->indices[i]);
+            });
+        }
+
+        //! The byte stride of one vertex written by write_vpos/vcol/vnorm()
+        static constexpr std::size_t vpos_stride (const bool quantised) { return quantised ? 4 * sizeof (std::int16_t) : 3 * sizeof (float); }
+        static constexpr std::size_t vcol_stride (const bool quantised) { return quantised ? 4 * sizeof (std::uint8_t) : 3 * sizeof (float); }
+        static constexpr std::size_t vnorm_stride (const bool quantised) { return quantised ? 4 * sizeof (std::int8_t) : 3 * sizeof (float); }
+
+        //! The largest magnitude of a quantised position component
+        static constexpr float vpos_qmax = 32767.0f;
+        //! The centre of the quantisation of vertexPositions. Call computeVertexMaxMins() first.
+        vec<float> vpos_qcentre() const { return (this->vpos_maxes + this->vpos_mins) * 0.5f; }
+        //! A quantised position times vpos_qscale() (plus vpos_qcentre()) is the position
+        float vpos_qscale() const
+        {
+            const float h = ((this->vpos_maxes - this->vpos_mins) * 0.5f).max();
+            return h > 0.0f ? h / VisualModel<glver>::vpos_qmax : 1.0f;
+        }
+        //! Quantise one vertex position
+        vec<std::int16_t, 3> vpos_quantise (const vec<float>& p) const
+        {
+            const vec<float> q = (p - this->vpos_qcentre()) / this->vpos_qscale();
+            vec<std::int16_t, 3> qi = {};
+            for (unsigned int j = 0; j < 3; ++j) {
+                qi[j] = static_cast<std::int16_t>(std::clamp (std::round (q[j]), -VisualModel<glver>::vpos_qmax, VisualModel<glver>::vpos_qmax));
+            }
+            return qi;
+        }
+        //! The quantised vpos_max/min, for the accessor of a quantised POSITION
+        std::string vpos_qmax_str() const { return this->vpos_quantise (this->vpos_maxes).str_mat(); }
+        std::string vpos_qmin_str() const { return this->vpos_quantise (this->vpos_mins).str_mat(); }
+
+        //! Write vertexPositions, as shorts (padded to 4 per vertex) if quantised
+        void write_vpos (std::ostream& o, const bool quantised) const
+        {
+            if (!quantised) {
+                o.write (reinterpret_cast<const char*>(this->vertexPositions.data()), this->vertexPositions.size() * sizeof (float));
+                return;
+            }
+            VisualModel<glver>::write_blocks<std::int16_t, 4> (o, this->vertexPositions.size() / 3, [this](std::size_t i, std::int16_t* q) {
+                const vec<std::int16_t, 3> qi = this->vpos_quantise ({ this->vertexPositions[3 * i],
+                                                                       this->vertexPositions[3 * i + 1],
+                                                                       this->vertexPositions[3 * i + 2] });
+                q[0] = qi[0];
+                q[1] = qi[1];
+                q[2] = qi[2];
+                q[3] = 0;
+            });
+        }
+        //! Write vertexColors, as normalized unsigned bytes (padded to 4 per vertex) if quantised
+        void write_vcol (std::ostream& o, const bool quantised) const
+        {
+            if (!quantised) {
+                o.write (reinterpret_cast<const char*>(this->vertexColors.data()), this->vertexColors.size() * sizeof (float));
+                return;
+            }
+            VisualModel<glver>::write_blocks<std::uint8_t, 4> (o, this->vertexColors.size() / 3, [this](std::size_t i, std::uint8_t* q) {
+                for (unsigned int j = 0; j < 3; ++j) {
+                    q[j] = static_cast<std::uint8_t>(std::round (std::clamp (this->vertexColors[3 * i + j], 0.0f, 1.0f) * 255.0f));
+                }
+                q[3] = 0;
+            });
+        }
+        //! Write vertexNormals, as normalized signed bytes (padded to 4 per vertex) if quantised
+        void write_vnorm (std::ostream& o, const bool quantised) const
+        {
+            if (!quantised) {
+                o.write (reinterpret_cast<const char*>(this->vertexNormals.data()), this->vertexNormals.size() * sizeof (float));
+                return;
+            }
+            VisualModel<glver>::write_blocks<std::int8_t, 4> (o, this->vertexNormals.size() / 3, [this](std::size_t i, std::int8_t* q) {
+                for (unsigned int j = 0; j < 3; ++j) {
+                    q[j] = static_cast<std::int8_t>(std::round (std::clamp (this->vertexNormals[3 * i + j], -1.0f, 1.0f) * 127.0f));
+                }
+                q[3] = 0;
+            });
+        }
+        // end Visual::saveglb() methods
+
         //! If true, then this VisualModel should always be viewed in a plane - it's a 2D model
         bool twodimensional = false;
 
@@ -835,105 +1880,919 @@ namespace morph {
 
         //! A vector of pointers to text models that should be rendered.
         std::vector<std::unique_ptr<morph::VisualTextModel<glver>>> texts;
+        //! Draws texts in one batch, if batch_texts is true. Created on first use.
+        std::unique_ptr<morph::VisualTextBatch<glver>> text_batch;
+
+        //! This enum contains the positions within the vbo array of the different
+        //! vertex buffer objects
+        enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, numVBO };
+
+        //! A unit vector in the x direction
+        morph::vec<float, 3> ux = { 1.0f, 0.0f, 0.0f };
+        //! A unit vector in the y direction
+        morph::vec<float, 3> uy = { 0.0f, 1.0f, 0.0f };
+        //! A unit vector in the z direction
+        morph::vec<float, 3> uz = { 0.0f, 0.0f, 1.0f };
+
+        /*
+         * Compute positions and colours of vertices for the hexes and store in these:
+         */
+
+        //! The OpenGL Vertex Array Object
+        GLuint vao;
+
+        //! Vertex Buffer Objects stored in an array
+        std::unique_ptr<GLuint[]> vbos;
+        //! The size in bytes of the storage allocated for the position, normal and colour VBOs
+        std::array<std::size_t, 3> vbo_bytes = { 0, 0, 0 };
+        //! The number of indices in the index buffer object
+        std::size_t indices_uploaded = 0;
+        //! True while the vertex arrays have been freed by release_vertices()
+        bool cpu_released = false;
+        //! The type of the uploaded indices; GL_UNSIGNED_SHORT if they were packed (see compact_vertices)
+        GLenum index_type = GL_UNSIGNED_INT;
+        //! True if the positions and packed normals were uploaded interleaved into vbos[posnVBO]
+        bool geometry_packed = false;
+        //! True if the colours were uploaded as 8 bit RGBA
+        bool colours_packed = false;
+        //! The bytes per vertex of interleaved positions and packed normals
+        static constexpr std::size_t packed_vertex_bytes = 3u * sizeof(float) + sizeof(std::uint32_t);
+        //! If share_geometry is in effect, the mesh buffers this model draws from, and their key
+        std::shared_ptr<shared_geometry> shared_geom;
+        shared_geometry_key shared_key;
+
+        //! The state of an asynchronous build (see reinit_async())
+        enum class build_status { idle, running, ready };
+        std::atomic<build_status> build_state = build_status::idle;
+        //! Guards the changes of build_state, and the vertex arrays between builds
+        std::mutex build_mutex;
+        std::condition_variable build_cv;
+        //! The worker running an asynchronous build's initializeVertices(), and what it threw
+        std::atomic<std::thread::id> build_thread = std::thread::id();
+        std::exception_ptr build_error = nullptr;
+        //! The CPU time of the last asynchronous build's initializeVertices(), in ms
+        double async_build_ms = 0.0;
+        //! True while lazy_finalize has held back the build and no prebuild has been queued
+        bool build_deferred = false;
+        /*!
+         * While a prebuild (see lazy_prebuild) is queued or running, the flag that whichever of
+         * it and claim_prebuild() sets first owns the build. It is shared with the job, so that
+         * a job that lost can return without touching a model that may have gone.
+         */
+        std::shared_ptr<std::atomic<bool>> prebuild_claim;
+
+        /*!
+         * Clear the vertex arrays and build them on the shared job_pool; with idle, queue the
+         * build with push_idle() as a prebuild. Waits for any build already running.
+         */
+        void queue_build (const bool idle)
+        {
+            // A prebuild that hasn't started is taken back, so as not to wait on the idle queue
+            this->claim_prebuild();
+            std::unique_lock<std::mutex> lk (this->build_mutex);
+            this->build_cv.wait (lk, [this] { return this->build_state != build_status::running; });
+            this->vertexPositions.clear();
+            this->vertexNormals.clear();
+            this->vertexColors.clear();
+            this->indices.clear();
+            this->idx = 0u;
+            this->build_error = nullptr;
+            this->build_state = build_status::running;
+            lk.unlock();
+            std::shared_ptr<std::atomic<bool>> claim;
+            if (idle) { claim = this->prebuild_claim = std::make_shared<std::atomic<bool>>(false); }
+            auto job = [this, claim] {
+                if (claim != nullptr && claim->exchange (true) == true) { return; } // Taken back
+                this->build_thread = std::this_thread::get_id();
+                const auto t0 = std::chrono::steady_clock::now();
+                try {
+                    // A prebuild is the first build, so it welds and uses the mesh cache as finalize() does
+                    if (claim != nullptr) { this->build_mesh(); } else { this->initializeVertices(); }
+                } catch (...) {
+                    this->build_error = std::current_exception();
+                }
+                this->build_thread = std::thread::id();
+                std::lock_guard<std::mutex> lk2 (this->build_mutex);
+                // build_ms is the render thread's, so this is added to it in collect_async_build()
+                this->async_build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                this->build_state = build_status::ready;
+                this->build_cv.notify_all();
+            };
+            if (idle) {
+                morph::job_pool::shared().push_idle (std::move (job));
+            } else {
+                morph::job_pool::shared().push (std::move (job));
+            }
+        }
+
+        /*!
+         * Take back a queued prebuild that has not started, so that the model is built when it
+         * is first drawn. Returns false if there was none, or it has started.
+         */
+        bool claim_prebuild()
+        {
+            if (this->prebuild_claim == nullptr) { return false; }
+            std::shared_ptr<std::atomic<bool>> claim = std::move (this->prebuild_claim);
+            this->prebuild_claim = nullptr;
+            if (claim->exchange (true) == true) { return false; }
+            std::lock_guard<std::mutex> lk (this->build_mutex);
+            this->build_state = build_status::idle;
+            this->build_cv.notify_all();
+            this->build_deferred = true;
+            return true;
+        }
+        //! The pair of timer queries used in turn by gpu_timer_begin(), and whether each is in flight
+        GLuint gpu_queries[2] = { 0, 0 };
+        bool gpu_query_issued[2] = { false, false };
+        unsigned int gpu_query_next = 0;
+        //! The range of vertices [dirty_first, dirty_end) recorded by markDirty()
+        std::size_t dirty_first = std::numeric_limits<std::size_t>::max();
+        std::size_t dirty_end = 0;
+
+        //! CPU-side data for indices
+        std::vector<GLuint> indices;
+        //! CPU-side data for vertex positions
+        std::vector<float> vertexPositions;
+        //! CPU-side data for vertex normals
+        std::vector<float> vertexNormals;
+        //! CPU-side data for vertex colours
+        std::vector<float> vertexColors;
+        //! CPU-side per-instance data: position (3), scale (3), rotation quaternion (w, x, y, z) and
+        //! colour (3) for each instance. Used if instanced is true.
+        std::vector<float> instanceData;
+        //! The buffer object for instanceData and its allocated size in bytes
+        GLuint instance_vbo = 0;
+        std::size_t instance_vbo_bytes = 0;
+        //! The shader program that ray casts sphere impostors, loaded on first use
+        GLuint impostor_prog = 0;
+
+        /*!
+         * Optional textures from which the default shaders colour some of the model's triangles.
+         * data_tex holds one float per texel. Vertices whose colour has a negative blue component
+         * take their colour from it: red and green are the texture coordinates, and the texel is
+         * scaled by data_tex_scale (as m * x + c) then looked up in the colour table lut_tex (a
+         * one row RGB texture). 0 if not in use. Owned (and deleted) by the VisualModel.
+         */
+        GLuint data_tex = 0;
+        GLuint lut_tex = 0;
+        morph::vec<float, 2> data_tex_scale = { 1.0f, 0.0f };
+        //! The size of data_tex (of its level 0) and its number of mipmap levels
+        morph::vec<unsigned int, 2> data_tex_dims = { 0, 0 };
+        unsigned int data_tex_levels = 0;
+
+        /*!
+         * If non-zero, data_tex is also a height map, from which the default vertex shader sets
+         * the z, normal and colour of vertices whose colour has a blue component of -2 (red and
+         * green being the integer coordinates of their texel). z is the texel scaled by
+         * data_tex_zscale (m * x + c), the normal is found by finite differences with the
+         * neighbouring texels, data_tex_spacing apart in x and y, and the colour is looked up in
+         * lut_tex as above. With 1, the texels are a rectangular grid; with 2 they are hexes,
+         * indexed by axial coordinates (texel x + 1 is the neighbour to the east, texel y + 1 the
+         * neighbour to the north east) and data_tex_spacing is the hex to hex distance and the
+         * row to row distance.
+         */
+        int data_tex_displace = 0;
+        morph::vec<float, 2> data_tex_zscale = { 1.0f, 0.0f };
+        morph::vec<float, 2> data_tex_spacing = { 1.0f, 1.0f };
+        //! The range of z to which data_tex_displace moves vertices, included in the bounding box
+        morph::vec<float, 2> data_tex_zrange = { 0.0f, 0.0f };
+
+        //! Extend the bounding box in z to data_tex_zrange, if data_tex_displace moves the vertices
+        void displaceBoundingBox()
+        {
+            if (this->data_tex_displace == 0 || this->vpos_mins[0] > this->vpos_maxes[0]) { return; }
+            this->bb_min[2] = std::min (this->vpos_mins[2], this->data_tex_zrange[0]);
+            this->bb_max[2] = std::max (this->vpos_maxes[2], this->data_tex_zrange[1]);
+        }
+
+        /*!
+         * Upload floats into the data texture data_tex, and the RGB colour table lut into
+         * lut_tex, creating them if necessary. levels[0] is w x h floats (row by row); any
+         * further entries are its mipmap levels, each half the size of the last (rounded down,
+         * but at least 1). The texture is re-allocated only if its size changes. The GL context
+         * must be current. Both textures use nearest neighbour sampling, which is always
+         * available for float textures; with more than one level, the mipmap level is chosen
+         * by nearest neighbour too.
+         */
+        void upload_data_texture (const std::vector<const float*>& levels, const unsigned int w, const unsigned int h,
+                                  const std::vector<float>& lut)
+        {
+            if (levels.empty()) { return; }
+            const auto t0 = std::chrono::steady_clock::now();
+            const unsigned int nlev = static_cast<unsigned int>(levels.size());
+            const GLsizei nlut = static_cast<GLsizei>(lut.size() / 3);
+            bool realloc = (this->data_tex == 0 || this->data_tex_dims[0] != w || this->data_tex_dims[1] != h
+                            || this->data_tex_levels != nlev);
+            const GLint min_filter = nlev > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            GLint maxsz = 0;
+            _glfn->GetIntegerv (GL_MAX_TEXTURE_SIZE, &maxsz);
+            if (w > static_cast<unsigned int>(maxsz) || h > static_cast<unsigned int>(maxsz)) {
+                throw std::runtime_error ("VisualModel::upload_data_texture: Data is larger than GL_MAX_TEXTURE_SIZE");
+            }
+            if (this->data_tex == 0) { _glfn->GenTextures (1, &this->data_tex); }
+            if (this->lut_tex == 0) { _glfn->GenTextures (1, &this->lut_tex); }
+            _glfn->BindTexture (GL_TEXTURE_2D, this->data_tex);
+            for (unsigned int l = 0; l < nlev; ++l) {
+                const GLsizei lw = static_cast<GLsizei>(std::max (1u, w >> l));
+                const GLsizei lh = static_cast<GLsizei>(std::max (1u, h >> l));
+                if (realloc) {
+                    _glfn->TexImage2D (GL_TEXTURE_2D, l, GL_R32F, lw, lh, 0, GL_RED, GL_FLOAT, levels[l]);
+                } else {
+                    _glfn->TexSubImage2D (GL_TEXTURE_2D, l, 0, 0, lw, lh, GL_RED, GL_FLOAT, levels[l]);
+                }
+            }
+            if (realloc) {
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(nlev - 1));
+            }
+            _glfn->BindTexture (GL_TEXTURE_2D, this->lut_tex);
+            _glfn->TexImage2D (GL_TEXTURE_2D, 0, GL_RGB32F, nlut, 1, 0, GL_RGB, GL_FLOAT, lut.data());
+            _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            _glfn->BindTexture (GL_TEXTURE_2D, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            GLint maxsz = 0;
+            glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxsz);
+            if (w > static_cast<unsigned int>(maxsz) || h > static_cast<unsigned int>(maxsz)) {
+                throw std::runtime_error ("VisualModel::upload_data_texture: Data is larger than GL_MAX_TEXTURE_SIZE");
+            }
+            if (this->data_tex == 0) { glGenTextures (1, &this->data_tex); }
+            if (this->lut_tex == 0) { glGenTextures (1, &this->lut_tex); }
+            glBindTexture (GL_TEXTURE_2D, this->data_tex);
+            for (unsigned int l = 0; l < nlev; ++l) {
+                const GLsizei lw = static_cast<GLsizei>(std::max (1u, w >> l));
+                const GLsizei lh = static_cast<GLsizei>(std::max (1u, h >> l));
+                if (realloc) {
+                    glTexImage2D (GL_TEXTURE_2D, l, GL_R32F, lw, lh, 0, GL_RED, GL_FLOAT, levels[l]);
+                } else {
+                    glTexSubImage2D (GL_TEXTURE_2D, l, 0, 0, lw, lh, GL_RED, GL_FLOAT, levels[l]);
+                }
+            }
+            if (realloc) {
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(nlev - 1));
+            }
+            glBindTexture (GL_TEXTURE_2D, this->lut_tex);
+            glTexImage2D (GL_TEXTURE_2D, 0, GL_RGB32F, nlut, 1, 0, GL_RGB, GL_FLOAT, lut.data());
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glBindTexture (GL_TEXTURE_2D, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            this->data_tex_dims = { w, h };
+            this->data_tex_levels = nlev;
+            std::size_t bytes = lut.size() * sizeof(float);
+            for (unsigned int l = 0; l < nlev; ++l) {
+                bytes += std::size_t{std::max (1u, w >> l)} * std::max (1u, h >> l) * sizeof(float);
+            }
+            this->count_upload (bytes, t0);
+        }
+
+        /*!
+         * Write n elements of N Ts each to o, a block of elements at a time. fill(i, q) writes
+         * element i into q[0] to q[N-1].
+         */
+        template <typename T, std::size_t N, typename F>
+        static void write_blocks (std::ostream& o, const std::size_t n, F fill)
+        {
+            constexpr std::size_t block = 16384;
+            std::vector<T> buf (std::min (n, block) * N);
+            for (std::size_t b = 0; b < n; b += block) {
+                const std::size_t nb = std::min (block, n - b);
+                for (std::size_t i = 0; i < nb; ++i) { fill (b + i, buf.data() + i * N); }
+                o.write (reinterpret_cast<const char*>(buf.data()), nb * N * sizeof (T));
+            }
+        }
+
+        static constexpr float _max = std::numeric_limits<float>::max();
+        static constexpr float _low = std::numeric_limits<float>::lowest();
+
+        // The max and min values in the next 8 attributes are only computed if gltf files are going
+        // to be output by Visual::savegltf()
+
+        //! The bounding box of the model (see computeBoundingBox). Empty until the buffers are set up.
+        morph::vec<float, 3> bb_min = { _max, _max, _max };
+        morph::vec<float, 3> bb_max = { _low, _low, _low };
+
+        //! Max values of 0th, 1st and 2nd coordinates in vertexPositions
+        morph::vec<float, 3> vpos_maxes = { _low, _low, _low };
+        //! Min values in vertexPositions
+        morph::vec<float, 3> vpos_mins = { _max, _max, _max };
+        morph::vec<float, 3> vcol_maxes = { _low, _low, _low };
+        morph::vec<float, 3> vcol_mins = { _max, _max, _max };
+        morph::vec<float, 3> vnorm_maxes = { _low, _low, _low };
+        morph::vec<float, 3> vnorm_mins = { _max, _max, _max };
+        //! Max value in indices
+        GLuint idx_max = 0u;
+        //! Min value in indices.
+        GLuint idx_min = std::numeric_limits<GLuint>::max();
+
+        //! A model-wide alpha value for the shader
+        float alpha = 1.0f;
+        //! If true, then calls to VisualModel::render should return
+        bool hide = false;
+
+        // The morph::VisualOwnable in which this model exists.
+        morph::VisualOwnable<glver>* parentVis = nullptr;
+
+        //! Push three floats onto the vector of floats \a vp
+        void vertex_push (const float& x, const float& y, const float& z, std::vector<float>& vp)
+        {
+            vec<float> vec = { x, y, z };
+            std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
+        }
+        //! Push array of 3 floats onto the vector of floats \a vp
+        void vertex_push (const std::array<float, 3>& arr, std::vector<float>& vp)
+        {
+            std::copy (arr.begin(), arr.end(), std::back_inserter (vp));
+        }
+        //! Push morph::vec of 3 floats onto the vector of floats \a vp
+        void vertex_push (const vec<float>& vec, std::vector<float>& vp)
+        {
+            std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
+        }
+
+        /*!
+         * Write the 3 floats of arr into vp at vp[i], vp[i+1] and vp[i+2]. vp must already be
+         * that large. Unlike vertex_push, threads may call this on disjoint ranges of one vector.
+         */
+        static void vertex_set (const std::array<float, 3>& arr, std::vector<float>& vp, const std::size_t i)
+        {
+            vp[i] = arr[0];
+            vp[i + 1] = arr[1];
+            vp[i + 2] = arr[2];
+        }
+        //! Write the 3 floats of vec into vp from element i
+        static void vertex_set (const vec<float>& vec, std::vector<float>& vp, const std::size_t i)
+        {
+            vp[i] = vec[0];
+            vp[i + 1] = vec[1];
+            vp[i + 2] = vec[2];
+        }
+
+        //! Add the upload of bytes bytes, begun at t0, to the profile counters
+        void count_upload (const std::size_t bytes, const std::chrono::steady_clock::time_point t0)
+        {
+            ++this->changes;
+            this->profile.upload_bytes += bytes;
+            this->profile.upload_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        }
+
+        //! Add a draw of the uploaded indices (for each instance) to the profile counters
+        void count_draw()
+        {
+            ++this->profile.draw_calls;
+            this->profile.vertices += this->indices_uploaded * (this->instanced ? this->numInstances() : std::size_t{1});
+        }
+
+        /*!
+         * Draw the instances as ray cast spheres with impostor_prog. The projection and the
+         * lighting are copied from the parent Visual's graphics program, which is current on
+         * entry and on return.
+         */
+        void render_impostors()
+        {
+            const GLuint gprog = this->get_gprog(this->parentVis);
+            const std::vector<morph::gl::ShaderInfo> shaders = {
+                {GL_VERTEX_SHADER, "VisImpostor.vert.glsl", morph::getImpostorVtxShader (glver), 0 },
+                {GL_FRAGMENT_SHADER, "VisImpostor.frag.glsl", morph::getImpostorFragShader (glver), 0 }
+            };
+            // The projection matrix, light colour, ambient intensity, light position and diffuse intensity
+            float p_matrix[16] = { 0.0f };
+            float light[8] = { 0.0f };
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            if (this->impostor_prog == 0) { this->impostor_prog = morph::gl::LoadShaders (shaders, _glfn); }
+            if (this->impostor_prog == 0) { return; }
+            _glfn->GetUniformfv (gprog, _glfn->GetUniformLocation (gprog, "p_matrix"), p_matrix);
+            _glfn->GetUniformfv (gprog, _glfn->GetUniformLocation (gprog, "light_colour"), light);
+            _glfn->GetUniformfv (gprog, _glfn->GetUniformLocation (gprog, "ambient_intensity"), light + 3);
+            _glfn->GetUniformfv (gprog, _glfn->GetUniformLocation (gprog, "diffuse_position"), light + 4);
+            _glfn->GetUniformfv (gprog, _glfn->GetUniformLocation (gprog, "diffuse_intensity"), light + 7);
+
+            _glfn->UseProgram (this->impostor_prog);
+            _glfn->Uniform1f (_glfn->GetUniformLocation (this->impostor_prog, "alpha"), this->alpha);
+            _glfn->UniformMatrix4fv (_glfn->GetUniformLocation (this->impostor_prog, "v_matrix"), 1, GL_FALSE, this->scenematrix.mat.data());
+            _glfn->UniformMatrix4fv (_glfn->GetUniformLocation (this->impostor_prog, "m_matrix"), 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+            _glfn->UniformMatrix4fv (_glfn->GetUniformLocation (this->impostor_prog, "p_matrix"), 1, GL_FALSE, p_matrix);
+            _glfn->Uniform3fv (_glfn->GetUniformLocation (this->impostor_prog, "light_colour"), 1, light);
+            _glfn->Uniform1f (_glfn->GetUniformLocation (this->impostor_prog, "ambient_intensity"), light[3]);
+            _glfn->Uniform3fv (_glfn->GetUniformLocation (this->impostor_prog, "diffuse_position"), 1, light + 4);
+            _glfn->Uniform1f (_glfn->GetUniformLocation (this->impostor_prog, "diffuse_intensity"), light[7]);
+
+            _glfn->BindVertexArray (this->vao);
+            _glfn->DrawElementsInstanced (GL_TRIANGLES, static_cast<unsigned int>(this->indices_uploaded), this->index_type, 0, static_cast<GLsizei>(this->numInstances()));
+            this->count_draw();
+            _glfn->BindVertexArray (0);
+            _glfn->UseProgram (gprog);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            if (this->impostor_prog == 0) { this->impostor_prog = morph::gl::LoadShaders (shaders); }
+            if (this->impostor_prog == 0) { return; }
+            glGetUniformfv (gprog, glGetUniformLocation (gprog, "p_matrix"), p_matrix);
+            glGetUniformfv (gprog, glGetUniformLocation (gprog, "light_colour"), light);
+            glGetUniformfv (gprog, glGetUniformLocation (gprog, "ambient_intensity"), light + 3);
+            glGetUniformfv (gprog, glGetUniformLocation (gprog, "diffuse_position"), light + 4);
+            glGetUniformfv (gprog, glGetUniformLocation (gprog, "diffuse_intensity"), light + 7);
+
+            glUseProgram (this->impostor_prog);
+            glUniform1f (glGetUniformLocation (this->impostor_prog, "alpha"), this->alpha);
+            glUniformMatrix4fv (glGetUniformLocation (this->impostor_prog, "v_matrix"), 1, GL_FALSE, this->scenematrix.mat.data());
+            glUniformMatrix4fv (glGetUniformLocation (this->impostor_prog, "m_matrix"), 1, GL_FALSE, (this->model_scaling * this->viewmatrix).mat.data());
+            glUniformMatrix4fv (glGetUniformLocation (this->impostor_prog, "p_matrix"), 1, GL_FALSE, p_matrix);
+            glUniform3fv (glGetUniformLocation (this->impostor_prog, "light_colour"), 1, light);
+            glUniform1f (glGetUniformLocation (this->impostor_prog, "ambient_intensity"), light[3]);
+            glUniform3fv (glGetUniformLocation (this->impostor_prog, "diffuse_position"), 1, light + 4);
+            glUniform1f (glGetUniformLocation (this->impostor_prog, "diffuse_intensity"), light[7]);
+
+            glBindVertexArray (this->vao);
+            glDrawElementsInstanced (GL_TRIANGLES, static_cast<unsigned int>(this->indices_uploaded), this->index_type, 0, static_cast<GLsizei>(this->numInstances()));
+            this->count_draw();
+            glBindVertexArray (0);
+            glUseProgram (gprog);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
+
+        //! Set up a vertex buffer object - bind, buffer and set vertex array object attribute
+        void setupVBO (GLuint& buf, std::vector<float>& dat, unsigned int bufferAttribPosition)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            std::size_t sz = dat.size() * sizeof(float);
+            // If the buffer already has storage of the right size, overwrite it rather than re-allocating
+            bool realloc = (bufferAttribPosition >= this->vbo_bytes.size() || this->vbo_bytes[bufferAttribPosition] != sz);
+            if (bufferAttribPosition < this->vbo_bytes.size()) { this->vbo_bytes[bufferAttribPosition] = sz; }
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, buf);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+            if (realloc) {
+                _glfn->BufferData (GL_ARRAY_BUFFER, sz, dat.data(), this->vbo_usage);
+            } else {
+                _glfn->BufferSubData (GL_ARRAY_BUFFER, 0, sz, dat.data());
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+            _glfn->VertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+            _glfn->EnableVertexAttribArray (bufferAttribPosition);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBuffer (GL_ARRAY_BUFFER, buf);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            if (realloc) {
+                glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), this->vbo_usage);
+            } else {
+                glBufferSubData (GL_ARRAY_BUFFER, 0, sz, dat.data());
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+            glEnableVertexAttribArray (bufferAttribPosition);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            this->count_upload (sz, t0);
+        }
+
+        //! Bind buf to the vertex attribute bufferAttribPosition without uploading anything
+        void bindVBO (const GLuint buf, unsigned int bufferAttribPosition)
+        {
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, buf);
+            _glfn->VertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            _glfn->EnableVertexAttribArray (bufferAttribPosition);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBuffer (GL_ARRAY_BUFFER, buf);
+            glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (bufferAttribPosition);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
 
-        //! This enum contains the positions within the vbo array of the different
-        //! vertex buffer objects
-        enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, numVBO };
+        //! A hash of indices, vertexPositions and vertexNormals
+        std::uint64_t geometry_hash() const
+        {
+            std::uint64_t h = 0x9e3779b97f4a7c15ull;
+            auto mix = [&h](const void* p, const std::size_t bytes)
+            {
+                const unsigned char* c = static_cast<const unsigned char*>(p);
+                std::size_t i = 0;
+                for (; i + 8 <= bytes; i += 8) {
+                    std::uint64_t w = 0;
+                    std::memcpy (&w, c + i, 8);
+                    h = (h ^ (w * 0xff51afd7ed558ccdull)) * 0xc4ceb9fe1a85ec53ull;
+                    h ^= h >> 29;
+                }
+                for (; i < bytes; ++i) { h = (h ^ c[i]) * 0x100000001b3ull; }
+            };
+            mix (this->indices.data(), this->indices.size() * sizeof(GLuint));
+            mix (this->vertexPositions.data(), this->vertexPositions.size() * sizeof(float));
+            mix (this->vertexNormals.data(), this->vertexNormals.size() * sizeof(float));
+            return h;
+        }
 
-        //! A unit vector in the x direction
-        morph::vec<float, 3> ux = { 1.0f, 0.0f, 0.0f };
-        //! A unit vector in the y direction
-        morph::vec<float, 3> uy = { 0.0f, 1.0f, 0.0f };
-        //! A unit vector in the z direction
-        morph::vec<float, 3> uz = { 0.0f, 0.0f, 1.0f };
+        //! The shared meshes that exist, for each glver. Entries expire when their last model goes.
+        static std::map<shared_geometry_key, std::weak_ptr<shared_geometry>>& geometry_registry()
+        {
+            static std::map<shared_geometry_key, std::weak_ptr<shared_geometry>> registry;
+            return registry;
+        }
+        static std::mutex& geometry_registry_mutex()
+        {
+            static std::mutex m;
+            return m;
+        }
 
-        /*
-         * Compute positions and colours of vertices for the hexes and store in these:
+        /*!
+         * Set up the index, position and normal buffers, for postVertexInit and reinit_buffers.
+         * The VAO must be bound. If share_geometry is true, then a model whose mesh is the same as
+         * that of another model in the same Visual (and with the same geometry_source()) draws from
+         * that model's buffers instead of uploading its own copy.
          */
+        void setupGeometryVBOs()
+        {
+            if (this->share_geometry && this->parentVis != nullptr) {
+                shared_geometry_key k = { this->parentVis, this->geometry_source(), this->vertexPositions.size(),
+                                          this->vertexNormals.size(), this->indices.size(), this->geometry_hash() };
+                if (this->shared_geom == nullptr || k != this->shared_key) {
+                    std::lock_guard<std::mutex> lk (geometry_registry_mutex());
+                    auto& registry = geometry_registry();
+                    std::erase_if (registry, [](const auto& e) { return e.second.expired(); });
+                    auto found = registry.find (k);
+                    std::shared_ptr<shared_geometry> sg = found != registry.end() ? found->second.lock() : nullptr;
+                    if (sg == nullptr) {
+                        sg = std::make_shared<shared_geometry>();
+                        const auto t0 = std::chrono::steady_clock::now();
+                        const std::size_t isz = this->indices.size() * sizeof(GLuint);
+                        const std::size_t psz = this->vertexPositions.size() * sizeof(float);
+                        const std::size_t nsz = this->vertexNormals.size() * sizeof(float);
+#ifdef GLAD_OPTION_GL_MX
+                        GladGLContext* _glfn = this->get_glfn(this->parentVis);
+                        _glfn->GenBuffers (3, sg->bufs.data());
+                        _glfn->BindBuffer (GL_ARRAY_BUFFER, sg->bufs[0]);
+                        _glfn->BufferData (GL_ARRAY_BUFFER, psz, this->vertexPositions.data(), GL_STATIC_DRAW);
+                        _glfn->BindBuffer (GL_ARRAY_BUFFER, sg->bufs[1]);
+                        _glfn->BufferData (GL_ARRAY_BUFFER, nsz, this->vertexNormals.data(), GL_STATIC_DRAW);
+                        _glfn->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, sg->bufs[2]);
+                        _glfn->BufferData (GL_ELEMENT_ARRAY_BUFFER, isz, this->indices.data(), GL_STATIC_DRAW);
+                        morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+                        sg->release = [_glfn](std::array<GLuint, 3>& b) { _glfn->DeleteBuffers (3, b.data()); };
+#else
+                        glGenBuffers (3, sg->bufs.data());
+                        glBindBuffer (GL_ARRAY_BUFFER, sg->bufs[0]);
+                        glBufferData (GL_ARRAY_BUFFER, psz, this->vertexPositions.data(), GL_STATIC_DRAW);
+                        glBindBuffer (GL_ARRAY_BUFFER, sg->bufs[1]);
+                        glBufferData (GL_ARRAY_BUFFER, nsz, this->vertexNormals.data(), GL_STATIC_DRAW);
+                        glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, sg->bufs[2]);
+                        glBufferData (GL_ELEMENT_ARRAY_BUFFER, isz, this->indices.data(), GL_STATIC_DRAW);
+                        morph::gl::Util::checkError (__FILE__, __LINE__);
+                        sg->release = [](std::array<GLuint, 3>& b) { glDeleteBuffers (3, b.data()); };
+#endif
+                        this->count_upload (isz + psz + nsz, t0);
+                        registry[k] = sg;
+                    }
+                    this->shared_geom = sg;
+                    this->shared_key = k;
+                }
+#ifdef GLAD_OPTION_GL_MX
+                this->get_glfn(this->parentVis)->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->shared_geom->bufs[2]);
+#else
+                glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->shared_geom->bufs[2]);
+#endif
+                this->bindVBO (this->shared_geom->bufs[0], visgl::posnLoc);
+                this->bindVBO (this->shared_geom->bufs[1], visgl::normLoc);
+                this->indices_uploaded = this->indices.size();
+                this->index_type = GL_UNSIGNED_INT;
+                this->geometry_packed = false;
+                // This model's own position and normal buffers are empty. Zero sizes make
+                // reinit_range() come back here, rather than write into them.
+                this->vbo_bytes[visgl::posnLoc] = 0;
+                this->vbo_bytes[visgl::normLoc] = 0;
+                return;
+            }
 
-        //! The OpenGL Vertex Array Object
-        GLuint vao;
+            // Not (or no longer) sharing. Upload this model's own buffers.
+            this->shared_geom.reset();
+            const bool pack = this->compact_vertices && this->vertexNormals.size() == this->vertexPositions.size();
+            const auto t0 = std::chrono::steady_clock::now();
+            std::vector<std::uint16_t> indices16;
+            const void* idat = this->indices.data();
+            std::size_t sz = this->indices.size() * sizeof(GLuint);
+            this->index_type = GL_UNSIGNED_INT;
+            if (pack && this->vertexPositions.size() / 3u <= std::size_t{65536}) {
+                indices16.assign (this->indices.begin(), this->indices.end());
+                idat = indices16.data();
+                sz = indices16.size() * sizeof(std::uint16_t);
+                this->index_type = GL_UNSIGNED_SHORT;
+            }
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
+            _glfn->BufferData (GL_ELEMENT_ARRAY_BUFFER, sz, idat, GL_STATIC_DRAW);
+#else
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->vbos[idxVBO]);
+            glBufferData (GL_ELEMENT_ARRAY_BUFFER, sz, idat, GL_STATIC_DRAW);
+#endif
+            this->indices_uploaded = this->indices.size();
+            this->count_upload (sz, t0);
+            if (pack) {
+                this->setupPackedGeometryVBO();
+            } else {
+                this->geometry_packed = false;
+                this->setupVBO (this->vbos[posnVBO], this->vertexPositions, visgl::posnLoc);
+                this->setupVBO (this->vbos[normVBO], this->vertexNormals, visgl::normLoc);
+            }
+        }
 
-        //! Vertex Buffer Objects stored in an array
-        std::unique_ptr<GLuint[]> vbos;
+        //! Pack a normal, with components in [-1, 1], into a GL_INT_2_10_10_10_REV
+        static std::uint32_t pack_normal (const float* n)
+        {
+            std::uint32_t p = 0u;
+            for (unsigned int j = 0; j < 3; ++j) {
+                const long i = std::lround (std::clamp (n[j], -1.0f, 1.0f) * 511.0f);
+                p |= (static_cast<std::uint32_t>(i) & 0x3ffu) << (10u * j);
+            }
+            return p;
+        }
 
-        //! CPU-side data for indices
-        std::vector<GLuint> indices;
-        //! CPU-side data for vertex positions
-        std::vector<float> vertexPositions;
-        //! CPU-side data for vertex normals
-        std::vector<float> vertexNormals;
-        //! CPU-side data for vertex colours
-        std::vector<float> vertexColors;
+        //! Unpack a normal packed by pack_normal into n
+        static void unpack_normal (const std::uint32_t p, float* n)
+        {
+            for (unsigned int j = 0; j < 3; ++j) {
+                int i = static_cast<int>((p >> (10u * j)) & 0x3ffu);
+                if (i & 0x200) { i -= 0x400; }
+                n[j] = std::max (static_cast<float>(i) / 511.0f, -1.0f);
+            }
+        }
 
-        static constexpr float _max = std::numeric_limits<float>::max();
-        static constexpr float _low = std::numeric_limits<float>::lowest();
+        //! Copy the first bytes of the buffer object buf into out. The GL context must be current.
+        void read_buffer (const GLuint buf, void* out, const std::size_t bytes)
+        {
+            if (bytes == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_COPY_READ_BUFFER, buf);
+            const void* p = _glfn->MapBufferRange (GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+            if (p != nullptr) { std::memcpy (out, p, bytes); }
+            _glfn->UnmapBuffer (GL_COPY_READ_BUFFER);
+            _glfn->BindBuffer (GL_COPY_READ_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBuffer (GL_COPY_READ_BUFFER, buf);
+            const void* p = glMapBufferRange (GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+            if (p != nullptr) { std::memcpy (out, p, bytes); }
+            glUnmapBuffer (GL_COPY_READ_BUFFER);
+            glBindBuffer (GL_COPY_READ_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            if (p == nullptr) { throw std::runtime_error ("VisualModel: failed to map a vertex buffer to read it back"); }
+        }
 
-        // The max and min values in the next 8 attributes are only computed if gltf files are going
-        // to be output by Visual::savegltf()
+        /*!
+         * For reinit_buffers: true if gpu_resident has freed the vertex arrays and they have
+         * not been rebuilt since, so that the buffers are already up to date.
+         */
+        bool skip_released_upload()
+        {
+            if (!this->cpu_released) { return false; }
+            if (this->vertexPositions.empty() && this->indices.empty()) { return true; }
+            this->cpu_released = false;
+            return false;
+        }
 
-        //! Max values of 0th, 1st and 2nd coordinates in vertexPositions
-        morph::vec<float, 3> vpos_maxes = { _low, _low, _low };
-        //! Min values in vertexPositions
-        morph::vec<float, 3> vpos_mins = { _max, _max, _max };
-        morph::vec<float, 3> vcol_maxes = { _low, _low, _low };
-        morph::vec<float, 3> vcol_mins = { _max, _max, _max };
-        morph::vec<float, 3> vnorm_maxes = { _low, _low, _low };
-        morph::vec<float, 3> vnorm_mins = { _max, _max, _max };
-        //! Max value in indices
-        GLuint idx_max = 0u;
-        //! Min value in indices.
-        GLuint idx_min = std::numeric_limits<GLuint>::max();
+        //! Interleave the positions and packed normals of vertices [first, first + count) into out
+        void pack_geometry (const std::size_t first, const std::size_t count, std::vector<std::uint32_t>& out) const
+        {
+            out.resize (4u * count);
+            for (std::size_t i = 0; i < count; ++i) {
+                std::memcpy (&out[4u * i], &this->vertexPositions[3u * (first + i)], 3u * sizeof(float));
+                out[4u * i + 3u] = pack_normal (&this->vertexNormals[3u * (first + i)]);
+            }
+        }
 
-        //! A model-wide alpha value for the shader
-        float alpha = 1.0f;
-        //! If true, then calls to VisualModel::render should return
-        bool hide = false;
+        //! True if the colours of vertices [first, first + count) can be packed into 8 bits
+        bool colours_packable (const std::size_t first, const std::size_t count) const
+        {
+            const std::size_t end = std::min (3u * (first + count), this->vertexColors.size());
+            for (std::size_t i = 3u * first; i < end; ++i) {
+                if (!(this->vertexColors[i] >= 0.0f && this->vertexColors[i] <= 1.0f)) { return false; }
+            }
+            return true;
+        }
 
-        // The morph::VisualOwnable in which this model exists.
-        morph::VisualOwnable<glver>* parentVis = nullptr;
+        //! Pack the colours of vertices [first, first + count) into out as 8 bit RGBA
+        void pack_colours (const std::size_t first, const std::size_t count, std::vector<std::uint8_t>& out) const
+        {
+            out.resize (4u * count);
+            for (std::size_t i = 0; i < count; ++i) {
+                for (unsigned int j = 0; j < 3; ++j) {
+                    out[4u * i + j] = static_cast<std::uint8_t>(std::lround (this->vertexColors[3u * (first + i) + j] * 255.0f));
+                }
+                out[4u * i + 3u] = 255u;
+            }
+        }
 
-        //! Push three floats onto the vector of floats \a vp
-        void vertex_push (const float& x, const float& y, const float& z, std::vector<float>& vp)
+        //! The size in bytes of the colour buffer for vertexColors in the layout in use
+        std::size_t colour_bytes() const
         {
-            vec<float> vec = { x, y, z };
-            std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
+            return this->colours_packed ? (this->vertexColors.size() / 3u) * 4u : this->vertexColors.size() * sizeof(float);
         }
-        //! Push array of 3 floats onto the vector of floats \a vp
-        void vertex_push (const std::array<float, 3>& arr, std::vector<float>& vp)
+
+        //! Upload the positions and packed normals, interleaved, into vbos[posnVBO]. The VAO must be bound.
+        void setupPackedGeometryVBO()
         {
-            std::copy (arr.begin(), arr.end(), std::back_inserter (vp));
+            const auto t0 = std::chrono::steady_clock::now();
+            std::vector<std::uint32_t> packed;
+            this->pack_geometry (0, this->vertexPositions.size() / 3u, packed);
+            const std::size_t sz = packed.size() * sizeof(std::uint32_t);
+            const bool realloc = (!this->geometry_packed || this->vbo_bytes[visgl::posnLoc] != sz);
+            constexpr GLsizei stride = static_cast<GLsizei>(packed_vertex_bytes);
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->vbos[posnVBO]);
+            if (realloc) {
+                _glfn->BufferData (GL_ARRAY_BUFFER, sz, packed.data(), this->vbo_usage);
+            } else {
+                _glfn->BufferSubData (GL_ARRAY_BUFFER, 0, sz, packed.data());
+            }
+            _glfn->VertexAttribPointer (visgl::posnLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(0));
+            _glfn->EnableVertexAttribArray (visgl::posnLoc);
+            _glfn->VertexAttribPointer (visgl::normLoc, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(3 * sizeof(float)));
+            _glfn->EnableVertexAttribArray (visgl::normLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[posnVBO]);
+            if (realloc) {
+                glBufferData (GL_ARRAY_BUFFER, sz, packed.data(), this->vbo_usage);
+            } else {
+                glBufferSubData (GL_ARRAY_BUFFER, 0, sz, packed.data());
+            }
+            glVertexAttribPointer (visgl::posnLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(0));
+            glEnableVertexAttribArray (visgl::posnLoc);
+            glVertexAttribPointer (visgl::normLoc, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray (visgl::normLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            this->vbo_bytes[visgl::posnLoc] = sz;
+            this->vbo_bytes[visgl::normLoc] = 0; // normVBO is not used
+            this->geometry_packed = true;
+            this->count_upload (sz, t0);
         }
-        //! Push morph::vec of 3 floats onto the vector of floats \a vp
-        void vertex_push (const vec<float>& vec, std::vector<float>& vp)
+
+        //! Upload vertexColors, packed to 8 bit RGBA if compact_vertices allows. The VAO must be bound.
+        void setupColourVBO()
         {
-            std::copy (vec.begin(), vec.end(), std::back_inserter (vp));
+            if (!this->compact_vertices || !this->colours_packable (0, this->vertexColors.size() / 3u)) {
+                this->colours_packed = false;
+                this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
+                return;
+            }
+            const auto t0 = std::chrono::steady_clock::now();
+            std::vector<std::uint8_t> packed;
+            this->pack_colours (0, this->vertexColors.size() / 3u, packed);
+            const std::size_t sz = packed.size();
+            const bool realloc = (!this->colours_packed || this->vbo_bytes[visgl::colLoc] != sz);
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->vbos[colVBO]);
+            if (realloc) {
+                _glfn->BufferData (GL_ARRAY_BUFFER, sz, packed.data(), this->vbo_usage);
+            } else {
+                _glfn->BufferSubData (GL_ARRAY_BUFFER, 0, sz, packed.data());
+            }
+            _glfn->VertexAttribPointer (visgl::colLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void*)(0));
+            _glfn->EnableVertexAttribArray (visgl::colLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[colVBO]);
+            if (realloc) {
+                glBufferData (GL_ARRAY_BUFFER, sz, packed.data(), this->vbo_usage);
+            } else {
+                glBufferSubData (GL_ARRAY_BUFFER, 0, sz, packed.data());
+            }
+            glVertexAttribPointer (visgl::colLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void*)(0));
+            glEnableVertexAttribArray (visgl::colLoc);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            this->vbo_bytes[visgl::colLoc] = sz;
+            this->colours_packed = true;
+            this->count_upload (sz, t0);
         }
 
-        //! Set up a vertex buffer object - bind, buffer and set vertex array object attribute
-        void setupVBO (GLuint& buf, std::vector<float>& dat, unsigned int bufferAttribPosition)
+        //! Overwrite sz bytes of the buffer buf, from offset, with the bytes at dat
+        void subdataBytes (const GLuint buf, const void* dat, const std::size_t offset, const std::size_t sz)
         {
-            std::size_t sz = dat.size() * sizeof(float);
+            const auto t0 = std::chrono::steady_clock::now();
 #ifdef GLAD_OPTION_GL_MX
             GladGLContext* _glfn = this->get_glfn(this->parentVis);
             _glfn->BindBuffer (GL_ARRAY_BUFFER, buf);
-            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
-            _glfn->BufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_STATIC_DRAW);
-            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
-            _glfn->VertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
-            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
-            _glfn->EnableVertexAttribArray (bufferAttribPosition);
+            _glfn->BufferSubData (GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(sz), dat);
             morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
 #else
             glBindBuffer (GL_ARRAY_BUFFER, buf);
+            glBufferSubData (GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(sz), dat);
             morph::gl::Util::checkError (__FILE__, __LINE__);
-            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_STATIC_DRAW);
-            morph::gl::Util::checkError (__FILE__, __LINE__);
-            glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+#endif
+            this->count_upload (sz, t0);
+        }
+
+        //! Overwrite the interleaved positions and normals of vertices [first, first + count)
+        void subdataPackedGeometry (const std::size_t first, const std::size_t count)
+        {
+            std::vector<std::uint32_t> packed;
+            this->pack_geometry (first, count, packed);
+            this->subdataBytes (this->vbos[posnVBO], packed.data(), first * packed_vertex_bytes, packed.size() * sizeof(std::uint32_t));
+        }
+
+        //! Overwrite the colours of vertices [first, first + count), in the layout in use
+        void subdataColours (const std::size_t first, const std::size_t count)
+        {
+            if (!this->colours_packed) {
+                this->subdataVBO (this->vbos[colVBO], this->vertexColors, first, count);
+                return;
+            }
+            std::vector<std::uint8_t> packed;
+            this->pack_colours (first, count, packed);
+            this->subdataBytes (this->vbos[colVBO], packed.data(), 4u * first, packed.size());
+        }
+
+        //! Overwrite vertices [first, first + count) in the existing buffer buf with data from dat
+        void subdataVBO (GLuint& buf, std::vector<float>& dat, std::size_t first, std::size_t count)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            GLintptr offset = static_cast<GLintptr>(3u * first * sizeof(float));
+            GLsizeiptr sz = static_cast<GLsizeiptr>(3u * count * sizeof(float));
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, buf);
+            _glfn->BufferSubData (GL_ARRAY_BUFFER, offset, sz, dat.data() + 3u * first);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindBuffer (GL_ARRAY_BUFFER, buf);
+            glBufferSubData (GL_ARRAY_BUFFER, offset, sz, dat.data() + 3u * first);
             morph::gl::Util::checkError (__FILE__, __LINE__);
-            glEnableVertexAttribArray (bufferAttribPosition);
+#endif
+            this->count_upload (static_cast<std::size_t>(sz), t0);
+        }
+
+        //! Buffer instanceData and set up the per-instance attributes. The VAO must be bound.
+        void setupInstanceVBO()
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            std::size_t sz = this->instanceData.size() * sizeof(float);
+            constexpr GLsizei stride = instance_floats * sizeof(float);
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->get_glfn(this->parentVis);
+            if (this->instance_vbo == 0) { _glfn->GenBuffers (1, &this->instance_vbo); }
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->instance_vbo);
+            if (sz != this->instance_vbo_bytes) {
+                _glfn->BufferData (GL_ARRAY_BUFFER, sz, this->instanceData.data(), GL_DYNAMIC_DRAW);
+            } else {
+                _glfn->BufferSubData (GL_ARRAY_BUFFER, 0, sz, this->instanceData.data());
+            }
+            _glfn->VertexAttribPointer (visgl::instPosnLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(0));
+            _glfn->VertexAttribPointer (visgl::instScaleLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+            _glfn->VertexAttribPointer (visgl::instRotnLoc, 4, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+            _glfn->VertexAttribPointer (visgl::instColLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(10 * sizeof(float)));
+            for (GLuint l = visgl::instPosnLoc; l <= visgl::instColLoc; ++l) {
+                _glfn->VertexAttribDivisor (l, 1);
+                _glfn->EnableVertexAttribArray (l);
+            }
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            if (this->instance_vbo == 0) { glGenBuffers (1, &this->instance_vbo); }
+            glBindBuffer (GL_ARRAY_BUFFER, this->instance_vbo);
+            if (sz != this->instance_vbo_bytes) {
+                glBufferData (GL_ARRAY_BUFFER, sz, this->instanceData.data(), GL_DYNAMIC_DRAW);
+            } else {
+                glBufferSubData (GL_ARRAY_BUFFER, 0, sz, this->instanceData.data());
+            }
+            glVertexAttribPointer (visgl::instPosnLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(0));
+            glVertexAttribPointer (visgl::instScaleLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+            glVertexAttribPointer (visgl::instRotnLoc, 4, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+            glVertexAttribPointer (visgl::instColLoc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(10 * sizeof(float)));
+            for (GLuint l = visgl::instPosnLoc; l <= visgl::instColLoc; ++l) {
+                glVertexAttribDivisor (l, 1);
+                glEnableVertexAttribArray (l);
+            }
             morph::gl::Util::checkError (__FILE__, __LINE__);
 #endif
+            this->instance_vbo_bytes = sz;
+            this->count_upload (sz, t0);
         }
 
         /*!
@@ -1645,25 +3504,9 @@ namespace morph {
                     throw std::runtime_error ("computeSphereGeo: This is an abitrary iterations limit (10 gives 20971520 faces)");
                 }
             }
-            // Note that we need double precision to compute higher iterations of the geodesic (iterations > 5)
-            morph::geometry::icosahedral_geodesic<F> geo = morph::geometry::make_icosahedral_geodesic<F> (iterations);
-
-            // Now essentially copy geo into vertex buffers
-            for (auto v : geo.poly.vertices) {
-                this->vertex_push (v.as_float() * r + so, this->vertexPositions);
-                this->vertex_push (v.as_float(), this->vertexNormals);
-                this->vertex_push (sc, this->vertexColors);
-            }
-            for (auto f : geo.poly.faces) {
-                this->indices.push_back (this->idx + f[0]);
-                this->indices.push_back (this->idx + f[1]);
-                this->indices.push_back (this->idx + f[2]);
-            }
-            // idx is the *vertex index* and should be incremented by the number of vertices in the polyhedron
-            int n_verts = static_cast<int>(geo.poly.vertices.size());
-            this->idx += n_verts;
-
-            return n_verts;
+            // Note that we need double precision to compute higher iterations of the geodesic
+            // (iterations > 5). The geodesic is computed once and cached for all models.
+            return this->computeSphereMesh (morph::unit_sphere::geodesic<F> (iterations), so, sc, r);
         }
 
         /*!
@@ -1697,14 +3540,15 @@ namespace morph {
                 }
             }
             // Note that we need double precision to compute higher iterations of the geodesic (iterations > 5)
-            morph::geometry::icosahedral_geodesic<F> geo = morph::geometry::make_icosahedral_geodesic<F> (iterations);
-            int n_faces = static_cast<int>(geo.poly.faces.size());
+            const morph::unit_sphere_mesh& geo = morph::unit_sphere::geodesic<F> (iterations);
+            int n_faces = static_cast<int>(geo.indices.size() / 3);
 
             for (int i = 0; i < n_faces; ++i) { // For each face in the geodesic...
                 morph::vec<F, 3> norm = { F{0}, F{0}, F{0} };
-                for (auto vtx : geo.poly.faces[i]) { // For each vertex in face...
+                for (int k = 0; k < 3; ++k) { // For each vertex in face...
+                    const int vtx = static_cast<int>(geo.indices[3 * i + k]);
                     norm += vtx; // Add to the face norm
-                    this->vertex_push (geo.poly.vertices[vtx].as_float() * r + so, this->vertexPositions);
+                    this->vertex_push (geo.vertices[vtx] * r + so, this->vertexPositions);
                 }
                 morph::vec<float, 3> nf = (norm / F{3}).as_float();
                 for (int j = 0; j < 3; ++j) { // Faces all have size 3
@@ -1752,6 +3596,50 @@ namespace morph {
             return n_verts;
         }
 
+        /*!
+         * Add the unit sphere mesh m (see morph::unit_sphere), scaled by r and offset by so, in
+         * the single colour sc.
+         *
+         * \return The number of vertices added
+         */
+        int computeSphereMesh (const morph::unit_sphere_mesh& m, vec<float> so, std::array<float, 3> sc, float r = 1.0f)
+        {
+            const std::size_t nv = m.vertices.size();
+            // Grow the arrays once, then fill them in
+            const std::size_t v0 = this->vertexPositions.size();
+            this->vertexPositions.resize (v0 + 3 * nv);
+            this->vertexNormals.resize (v0 + 3 * nv);
+            this->vertexColors.resize (v0 + 3 * nv);
+            for (std::size_t i = 0; i < nv; ++i) {
+                this->vertex_set (m.vertices[i] * r + so, this->vertexPositions, v0 + 3 * i);
+                this->vertex_set (m.vertices[i], this->vertexNormals, v0 + 3 * i);
+                this->vertex_set (sc, this->vertexColors, v0 + 3 * i);
+            }
+            const std::size_t i0 = this->indices.size();
+            this->indices.resize (i0 + m.indices.size());
+            for (std::size_t i = 0; i < m.indices.size(); ++i) { this->indices[i0 + i] = this->idx + m.indices[i]; }
+            this->idx += static_cast<GLuint>(nv);
+            return static_cast<int>(nv);
+        }
+
+        /*!
+         * The template mesh for sphere_impostors: one quad with corners at (+-1, +-1, 0), which
+         * the impostor vertex shader turns to face the eye and sizes to each instance's sphere.
+         *
+         * \param sc The colour of the quad (the spheres take the colours of their instances)
+         */
+        void computeImpostorQuad (std::array<float, 3> sc)
+        {
+            constexpr float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+            for (unsigned int i = 0; i < 4; ++i) {
+                this->vertex_push (corners[i][0], corners[i][1], 0.0f, this->vertexPositions);
+                this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
+                this->vertex_push (sc, this->vertexColors);
+            }
+            for (GLuint k : { 0u, 1u, 2u, 0u, 2u, 3u }) { this->indices.push_back (this->idx + k); }
+            this->idx += 4;
+        }
+
         /*!
          * Sphere, 1 colour version.
          *
@@ -1768,127 +3656,8 @@ namespace morph {
         void computeSphere (vec<float> so, std::array<float, 3> sc,
                             float r = 1.0f, int rings = 10, int segments = 12)
         {
-            // First cap, draw as a triangle fan, but record indices so that
-            // we only need a single call to glDrawElements.
-            float rings0 = -morph::mathconst<float>::pi_over_2;
-            float _z0  = std::sin(rings0);
-            float z0  = r * _z0;
-            float r0 =  std::cos(rings0);
-            float rings1 = morph::mathconst<float>::pi * (-0.5f + 1.0f / rings);
-            float _z1 = std::sin(rings1);
-            float z1 = r * _z1;
-            float r1 = std::cos(rings1);
-            // Push the central point
-            this->vertex_push (so[0]+0.0f, so[1]+0.0f, so[2]+z0, this->vertexPositions);
-            this->vertex_push (0.0f, 0.0f, -1.0f, this->vertexNormals);
-            this->vertex_push (sc, this->vertexColors);
-
-            GLuint capMiddle = this->idx++;
-            GLuint ringStartIdx = this->idx;
-            GLuint lastRingStartIdx = this->idx;
-
-            bool firstseg = true;
-            for (int j = 0; j < segments; j++) {
-                float segment = morph::mathconst<float>::two_pi * static_cast<float>(j) / segments;
-                float x = std::cos(segment);
-                float y = std::sin(segment);
-
-                float _x1 = x*r1;
-                float x1 = _x1*r;
-                float _y1 = y*r1;
-                float y1 = _y1*r;
-
-                this->vertex_push (so[0]+x1, so[1]+y1, so[2]+z1, this->vertexPositions);
-                this->vertex_push (_x1, _y1, _z1, this->vertexNormals);
-                this->vertex_push (sc, this->vertexColors);
-
-                if (!firstseg) {
-                    this->indices.push_back (capMiddle);
-                    this->indices.push_back (this->idx-1);
-                    this->indices.push_back (this->idx++);
-                } else {
-                    this->idx++;
-                    firstseg = false;
-                }
-            }
-            this->indices.push_back (capMiddle);
-            this->indices.push_back (this->idx-1);
-            this->indices.push_back (capMiddle+1);
-
-            // Now add the triangles around the rings
-            for (int i = 2; i < rings; i++) {
-
-                rings0 = morph::mathconst<float>::pi * (-0.5f + static_cast<float>(i) / rings);
-                _z0  = std::sin(rings0);
-                z0  = r * _z0;
-                r0 =  std::cos(rings0);
-
-                for (int j = 0; j < segments; j++) {
-
-                    // "current" segment
-                    float segment = morph::mathconst<float>::two_pi * static_cast<float>(j) / segments;
-                    float x = std::cos(segment);
-                    float y = std::sin(segment);
-
-                    // One vertex per segment
-                    float _x0 = x*r0;
-                    float x0 = _x0*r;
-                    float _y0 = y*r0;
-                    float y0 = _y0*r;
-
-                    // NB: Only add ONE vertex per segment. ALREADY have the first ring!
-                    this->vertex_push (so[0]+x0, so[1]+y0, so[2]+z0, this->vertexPositions);
-                    // The vertex normal of a vertex that makes up a sphere is
-                    // just a normal vector in the direction of the vertex.
-                    this->vertex_push (_x0, _y0, _z0, this->vertexNormals);
-                    this->vertex_push (sc, this->vertexColors);
-
-                    if (j == segments - 1) {
-                        // Last vertex is back to the start
-                        this->indices.push_back (ringStartIdx++);
-                        this->indices.push_back (this->idx);
-                        this->indices.push_back (lastRingStartIdx);
-                        this->indices.push_back (lastRingStartIdx);
-                        this->indices.push_back (this->idx++);
-                        this->indices.push_back (lastRingStartIdx+segments);
-                    } else {
-                        this->indices.push_back (ringStartIdx++);
-                        this->indices.push_back (this->idx);
-                        this->indices.push_back (ringStartIdx);
-                        this->indices.push_back (ringStartIdx);
-                        this->indices.push_back (this->idx++);
-                        this->indices.push_back (this->idx);
-                    }
-                }
-                lastRingStartIdx += segments;
-            }
-
-            // bottom cap
-            rings0 = morph::mathconst<float>::pi_over_2;
-            _z0  = std::sin(rings0);
-            z0  = r * _z0;
-            r0 =  std::cos(rings0);
-            // Push the central point of the bottom cap
-            this->vertex_push (so[0]+0.0f, so[1]+0.0f, so[2]+z0, this->vertexPositions);
-            this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-            this->vertex_push (sc, this->vertexColors);
-            capMiddle = this->idx++;
-            firstseg = true;
-            // No more vertices to push, just do the indices for the bottom cap
-            ringStartIdx = lastRingStartIdx;
-            for (int j = 0; j < segments; j++) {
-                if (j != segments - 1) {
-                    this->indices.push_back (capMiddle);
-                    this->indices.push_back (ringStartIdx++);
-                    this->indices.push_back (ringStartIdx);
-                } else {
-                    // Last segment
-                    this->indices.push_back (capMiddle);
-                    this->indices.push_back (ringStartIdx);
-                    this->indices.push_back (lastRingStartIdx);
-                }
-            }
-        } // end of sphere calculation
+            this->computeSphereMesh (morph::unit_sphere::uv (rings, segments), so, sc, r);
+        }
 
         /*!
          * Sphere, two colour version.
@@ -1906,127 +3675,13 @@ namespace morph {
         void computeSphere (vec<float> so, std::array<float, 3> sc, std::array<float, 3> sc2,
                             float r = 1.0f, int rings = 10, int segments = 12)
         {
-            // First cap, draw as a triangle fan, but record indices so that
-            // we only need a single call to glDrawElements.
-            float rings0 = -morph::mathconst<float>::pi_over_2;
-            float _z0  = std::sin(rings0);
-            float z0  = r * _z0;
-            float r0 =  std::cos(rings0);
-            float rings1 = morph::mathconst<float>::pi * (-0.5f + 1.0f / rings);
-            float _z1 = std::sin(rings1);
-            float z1 = r * _z1;
-            float r1 = std::cos(rings1);
-            // Push the central point
-            this->vertex_push (so[0]+0.0f, so[1]+0.0f, so[2]+z0, this->vertexPositions);
-            this->vertex_push (0.0f, 0.0f, -1.0f, this->vertexNormals);
-            this->vertex_push (sc2, this->vertexColors);
-
-            GLuint capMiddle = this->idx++;
-            GLuint ringStartIdx = this->idx;
-            GLuint lastRingStartIdx = this->idx;
-
-            bool firstseg = true;
-            for (int j = 0; j < segments; j++) {
-                float segment = morph::mathconst<float>::two_pi * static_cast<float>(j) / segments;
-                float x = std::cos(segment);
-                float y = std::sin(segment);
-
-                float _x1 = x*r1;
-                float x1 = _x1*r;
-                float _y1 = y*r1;
-                float y1 = _y1*r;
-
-                this->vertex_push (so[0]+x1, so[1]+y1, so[2]+z1, this->vertexPositions);
-                this->vertex_push (_x1, _y1, _z1, this->vertexNormals);
-                this->vertex_push (sc2, this->vertexColors);
-
-                if (!firstseg) {
-                    this->indices.push_back (capMiddle);
-                    this->indices.push_back (this->idx-1);
-                    this->indices.push_back (this->idx++);
-                } else {
-                    this->idx++;
-                    firstseg = false;
-                }
-            }
-            this->indices.push_back (capMiddle);
-            this->indices.push_back (this->idx-1);
-            this->indices.push_back (capMiddle+1);
-
-            // Now add the triangles around the rings
-            for (int i = 2; i < rings; i++) {
-
-                rings0 = morph::mathconst<float>::pi * (-0.5f + static_cast<float>(i) / rings);
-                _z0  = std::sin(rings0);
-                z0  = r * _z0;
-                r0 =  std::cos(rings0);
-
-                for (int j = 0; j < segments; j++) {
-
-                    // "current" segment
-                    float segment = morph::mathconst<float>::two_pi * static_cast<float>(j) / segments;
-                    float x = std::cos(segment);
-                    float y = std::sin(segment);
-
-                    // One vertex per segment
-                    float _x0 = x*r0;
-                    float x0 = _x0*r;
-                    float _y0 = y*r0;
-                    float y0 = _y0*r;
-
-                    // NB: Only add ONE vertex per segment. ALREADY have the first ring!
-                    this->vertex_push (so[0]+x0, so[1]+y0, so[2]+z0, this->vertexPositions);
-                    // The vertex normal of a vertex that makes up a sphere is
-                    // just a normal vector in the direction of the vertex.
-                    this->vertex_push (_x0, _y0, _z0, this->vertexNormals);
-                    if (i == 2 || i > (rings-2)) {
-                        this->vertex_push (sc2, this->vertexColors);
-                    } else {
-                        this->vertex_push (sc, this->vertexColors);
-                    }
-                    if (j == segments - 1) {
-                        // Last vertex is back to the start
-                        this->indices.push_back (ringStartIdx++);
-                        this->indices.push_back (this->idx);
-                        this->indices.push_back (lastRingStartIdx);
-                        this->indices.push_back (lastRingStartIdx);
-                        this->indices.push_back (this->idx++);
-                        this->indices.push_back (lastRingStartIdx+segments);
-                    } else {
-                        this->indices.push_back (ringStartIdx++);
-                        this->indices.push_back (this->idx);
-                        this->indices.push_back (ringStartIdx);
-                        this->indices.push_back (ringStartIdx);
-                        this->indices.push_back (this->idx++);
-                        this->indices.push_back (this->idx);
-                    }
-                }
-                lastRingStartIdx += segments;
-            }
-
-            // bottom cap
-            rings0 = morph::mathconst<float>::pi_over_2;
-            _z0  = std::sin(rings0);
-            z0  = r * _z0;
-            r0 =  std::cos(rings0);
-            // Push the central point of the bottom cap
-            this->vertex_push (so[0]+0.0f, so[1]+0.0f, so[2]+z0, this->vertexPositions);
-            this->vertex_push (0.0f, 0.0f, 1.0f, this->vertexNormals);
-            this->vertex_push (sc2, this->vertexColors);
-            capMiddle = this->idx++;
-            firstseg = true;
-            // No more vertices to push, just do the indices for the bottom cap
-            ringStartIdx = lastRingStartIdx;
-            for (int j = 0; j < segments; j++) {
-                if (j != segments - 1) {
-                    this->indices.push_back (capMiddle);
-                    this->indices.push_back (ringStartIdx++);
-                    this->indices.push_back (ringStartIdx);
-                } else {
-                    // Last segment
-                    this->indices.push_back (capMiddle);
-                    this->indices.push_back (ringStartIdx);
-                    this->indices.push_back (lastRingStartIdx);
+            const GLuint first = this->idx;
+            this->computeSphereMesh (morph::unit_sphere::uv (rings, segments), so, sc2, r);
+            // The caps, the first two rings and the last are in sc2; the rest in sc
+            for (int i = 3; i <= rings - 2; ++i) {
+                const int v0 = 1 + (i - 1) * segments;
+                for (int j = 0; j < segments; ++j) {
+                    this->vertex_set (sc, this->vertexColors, 3 * (first + v0 + j));
                 }
             }
         }
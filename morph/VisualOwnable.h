@@ -32,6 +32,7 @@
 
 #include <morph/gl/version.h>
 #include <morph/VisualModel.h>
+#include <morph/VisualBatch.h>
 #include <morph/TextFeatures.h>
 #include <morph/TextGeometry.h>
 #include <morph/VisualTextModel.h> // includes VisualResources.h
@@ -47,13 +48,28 @@
 #include <morph/mat44.h>
 #include <morph/vec.h>
 #include <morph/tools.h>
+#include <morph/trace.h>
+#include <morph/memory_usage.h>
+#include <morph/dynamic_resolution.h>
+#include <morph/fnv1a.h>
 
 #include <string>
 #include <array>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <functional>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
 
 #include <morph/VisualDefaultShaders.h>
 
@@ -61,6 +77,8 @@
 #define LODEPNG_NO_COMPILE_DECODER 1
 #define LODEPNG_NO_COMPILE_ANCILLARY_CHUNKS 1
 #include <morph/lodepng.h>
+#include <morph/png_writer.h>
+#include <morph/frame_sink.h>
 
 namespace morph {
 
@@ -113,23 +131,22 @@ namespace morph {
         //! Deconstruct gl memory/context
         void deconstructCommon()
         {
-            if (this->shaders.gprog) {
+            // Models built by reinit_async() must not be destroyed mid-build
+            for (auto& m : this->vm) { m->wait_async_build(); }
+            this->free_captures();
+            this->free_reduced_frame();
+            this->batch.reset();
+            // The shader programs belong to the share group and go with its last member
+            for (GLuint prog : morph::VisualResources<glver>::i().release_programs (this)) {
 #ifdef GLAD_OPTION_GL_MX
-                this->glfn->DeleteProgram (this->shaders.gprog);
+                if (this->glfn) { this->glfn->DeleteProgram (prog); }
 #else
-                glDeleteProgram (this->shaders.gprog);
+                glDeleteProgram (prog);
 #endif
-                this->shaders.gprog = 0;
-                this->active_gprog = morph::visgl::graphics_shader_type::none;
-            }
-            if (this->shaders.tprog) {
-#ifdef GLAD_OPTION_GL_MX
-                this->glfn->DeleteProgram (this->shaders.tprog);
-#else
-                glDeleteProgram (this->shaders.tprog);
-#endif
-                this->shaders.tprog = 0;
             }
+            this->shaders.gprog = 0;
+            this->shaders.tprog = 0;
+            this->active_gprog = morph::visgl::graphics_shader_type::none;
 #ifdef GLAD_OPTION_GL_MX
             this->free_gladgl_context (this->glfn);
 #endif
@@ -159,9 +176,24 @@ namespace morph {
             this->init_gl();
         }
 
+        /*!
+         * As init (ctx), for a context that was created to share objects with the context of
+         * \a _share_with (an already initialised VisualOwnable). The two then use the same shader
+         * programs and font textures.
+         */
+        void init (morph::win_t* ctx, morph::VisualOwnable<glver>* _share_with)
+        {
+            this->share_with = _share_with;
+            this->init (ctx);
+        }
+
     protected:
+        //! The VisualOwnable whose GL objects this one shares, if any (see VisualResources)
+        morph::VisualOwnable<glver>* share_with = nullptr;
+
         void freetype_init()
         {
+            morph::VisualResources<glver>::i().join_share_group (this, this->share_with);
             // Now make sure that Freetype is set up (we assume that caller code has set the correct OpenGL context)
 #ifdef GLAD_OPTION_GL_MX
             morph::VisualResources<glver>::i().freetype_init (this, this->glfn);
@@ -188,9 +220,12 @@ namespace morph {
         //! Stores the OpenGL function context version that was loaded
         int glfn_version = 0;
 
-        //! Take a screenshot of the window. Return vec containing width * height or {-1, -1} on
-        //! failure. Set transparent_bg to get a transparent background.
-        morph::vec<int, 2> saveImage (const std::string& img_filename, const bool transparent_bg = false)
+        /*!
+         * Read the current frame (the size of the viewport) into rgba as rows of RGBA bytes, top row
+         * first. Unless transparent_bg is true, the alpha channel is set opaque. Returns the width
+         * and height of the frame. Use this to stream frames to other code without writing files.
+         */
+        morph::vec<int, 2> readPixels (std::vector<unsigned char>& rgba, const bool transparent_bg = false)
         {
             this->setContext();
 
@@ -204,7 +239,7 @@ namespace morph {
             dims[0] = viewport[2];
             dims[1] = viewport[3];
             auto bits = std::make_unique<GLubyte[]>(dims.product() * 4);
-            auto rbits = std::make_unique<GLubyte[]>(dims.product() * 4);
+            rgba.resize (dims.product() * 4);
 #ifdef GLAD_OPTION_GL_MX
             this->glfn->Finish(); // finish all commands of OpenGL
             this->glfn->PixelStorei (GL_PACK_ALIGNMENT, 1);
@@ -225,15 +260,24 @@ namespace morph {
                 int for_line = i * 4 * dims[0];
                 if (transparent_bg) {
                     for (int j = 0; j < 4 * dims[0]; ++j) {
-                        rbits[rev_line + j] = bits[for_line + j];
+                        rgba[rev_line + j] = bits[for_line + j];
                     }
                 } else {
                     for (int j = 0; j < 4 * dims[0]; ++j) {
-                        rbits[rev_line + j] = (j % 4 == 3) ? 255 : bits[for_line + j];
+                        rgba[rev_line + j] = (j % 4 == 3) ? 255 : bits[for_line + j];
                     }
                 }
             }
-            unsigned int error = lodepng::encode (img_filename, rbits.get(), dims[0], dims[1]);
+            return dims;
+        }
+
+        //! Take a screenshot of the window. Return vec containing width * height or {-1, -1} on
+        //! failure. Set transparent_bg to get a transparent background.
+        morph::vec<int, 2> saveImage (const std::string& img_filename, const bool transparent_bg = false)
+        {
+            std::vector<unsigned char> rbits;
+            morph::vec<int, 2> dims = this->readPixels (rbits, transparent_bg);
+            unsigned int error = lodepng::encode (img_filename, rbits.data(), dims[0], dims[1]);
             if (error) {
                 std::cerr << "encoder error " << error << ": " << lodepng_error_text (error) << std::endl;
                 dims.set_from (-1);
@@ -242,6 +286,446 @@ namespace morph {
             return dims;
         }
 
+        /*!
+         * Save a screenshot of the window without waiting for it. The frame is read into one of
+         * a ring of n_capture_pbos pixel buffer objects and a fence is set; the pixels are only
+         * mapped once the GPU has passed the fence (usually after a frame or two), and the PNG is
+         * then encoded and written by a background thread. Saving a movie this way does not
+         * stall rendering on every frame. Call finishImageCaptures() to be sure that every file
+         * has been written. Returns the width and height of the frame that will be saved.
+         */
+        morph::vec<int, 2> saveImageAsync (const std::string& img_filename, const bool transparent_bg = false)
+        {
+            return this->start_capture (img_filename, transparent_bg, false);
+        }
+
+        /*!
+         * Send the current frame to framesink (a video encoder, for example), which must have
+         * been set. As for saveImageAsync(), the frame is read into a pixel buffer object and
+         * handed to the sink a frame or two later, so rendering does not wait on the GPU. Frames
+         * reach the sink in order. Call finishRecording() after the last frame.
+         */
+        morph::vec<int, 2> recordFrame()
+        {
+            if (this->framesink == nullptr) {
+                throw std::runtime_error ("VisualOwnable::recordFrame: Set framesink first");
+            }
+            return this->start_capture (std::string(""), false, true);
+        }
+
+        //! Send any pending frames to framesink, then finish and release the sink
+        void finishRecording()
+        {
+            this->finishImageCaptures();
+            if (this->framesink != nullptr) {
+                this->framesink->finish();
+                this->framesink.reset();
+            }
+        }
+
+        //! Where recordFrame() sends frames. See morph/frame_sink.h and morph/ffmpeg_sink.h
+        std::unique_ptr<morph::frame_sink> framesink;
+
+        //! Collect every pending saveImageAsync() frame and wait until all the files have been written
+        void finishImageCaptures()
+        {
+            for (unsigned int i = 0; i < n_capture_pbos; ++i) {
+                capture_t& ci = this->captures[(this->capture_next + i) % n_capture_pbos];
+                if (ci.fence == nullptr) { continue; }
+                this->setContext();
+                this->complete_capture (ci);
+            }
+            if (this->png_queue != nullptr) { this->png_queue->wait(); }
+        }
+
+        //! The number of pixel buffer objects in the ring used by saveImageAsync()
+        static constexpr unsigned int n_capture_pbos = 3;
+
+    protected:
+        //! A frame capture in progress in a pixel buffer object
+        struct capture_t
+        {
+            GLuint pbo = 0;
+            std::size_t bytes = 0;
+            //! Non-null while the capture is pending
+            GLsync fence = nullptr;
+            std::string filename;
+            morph::vec<int, 2> dims = { 0, 0 };
+            bool transparent_bg = false;
+            //! If true, the frame goes to framesink rather than to a PNG file
+            bool to_sink = false;
+        };
+        std::array<capture_t, n_capture_pbos> captures;
+        //! The index into captures of the next PBO to read into (and so the oldest pending capture)
+        unsigned int capture_next = 0;
+        //! The background PNG encoder, created on first use
+        std::unique_ptr<morph::png_writer> png_queue;
+        //! Frame buffer for recordFrame(), rows reordered top row first
+        std::vector<unsigned char> sink_frame;
+
+        //! Read the frame into the next PBO of the ring for saveImageAsync() or recordFrame()
+        morph::vec<int, 2> start_capture (const std::string& img_filename, const bool transparent_bg, const bool to_sink)
+        {
+            this->setContext();
+
+            GLint viewport[4];
+#ifdef GLAD_OPTION_GL_MX
+            this->glfn->GetIntegerv (GL_VIEWPORT, viewport);
+#else
+            glGetIntegerv (GL_VIEWPORT, viewport);
+#endif
+            morph::vec<int, 2> dims = { viewport[2], viewport[3] };
+            const std::size_t bytes = static_cast<std::size_t>(dims.product()) * 4;
+
+            // If the next PBO in the ring is still in use, its frame has to be collected first
+            capture_t& c = this->captures[this->capture_next];
+            if (c.fence != nullptr) { this->complete_capture (c); }
+
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            if (c.pbo == 0) { _glfn->GenBuffers (1, &c.pbo); }
+            _glfn->BindBuffer (GL_PIXEL_PACK_BUFFER, c.pbo);
+            if (c.bytes != bytes) {
+                _glfn->BufferData (GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+                c.bytes = bytes;
+            }
+            _glfn->PixelStorei (GL_PACK_ALIGNMENT, 1);
+            _glfn->PixelStorei (GL_PACK_ROW_LENGTH, 0);
+            _glfn->PixelStorei (GL_PACK_SKIP_ROWS, 0);
+            _glfn->PixelStorei (GL_PACK_SKIP_PIXELS, 0);
+            // With a pack buffer bound, ReadPixels returns at once; the copy happens on the GPU
+            _glfn->ReadPixels (0, 0, dims[0], dims[1], GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            c.fence = _glfn->FenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            _glfn->BindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            if (c.pbo == 0) { glGenBuffers (1, &c.pbo); }
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, c.pbo);
+            if (c.bytes != bytes) {
+                glBufferData (GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+                c.bytes = bytes;
+            }
+            glPixelStorei (GL_PACK_ALIGNMENT, 1);
+            glPixelStorei (GL_PACK_ROW_LENGTH, 0);
+            glPixelStorei (GL_PACK_SKIP_ROWS, 0);
+            glPixelStorei (GL_PACK_SKIP_PIXELS, 0);
+            // With a pack buffer bound, ReadPixels returns at once; the copy happens on the GPU
+            glReadPixels (0, 0, dims[0], dims[1], GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            c.fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            c.filename = img_filename;
+            c.dims = dims;
+            c.transparent_bg = transparent_bg;
+            c.to_sink = to_sink;
+            this->capture_next = (this->capture_next + 1) % n_capture_pbos;
+
+            // Collect, oldest first, any earlier captures that the GPU has already finished
+            for (unsigned int i = 0; i < n_capture_pbos - 1; ++i) {
+                capture_t& ci = this->captures[(this->capture_next + i) % n_capture_pbos];
+                if (ci.fence == nullptr) { continue; }
+                if (!this->complete_capture (ci, false)) { break; }
+            }
+            return dims;
+        }
+
+
+        /*!
+         * If the fence of capture c has been passed (waiting for it if wait is true), map the
+         * PBO, copy the pixels out and queue them to be written. Returns false if wait is false
+         * and the GPU has not yet finished the capture.
+         */
+        bool complete_capture (capture_t& c, const bool wait = true)
+        {
+            morph::png_writer::job j;
+            j.filename = c.filename;
+            j.width = c.dims[0];
+            j.height = c.dims[1];
+            j.bottom_up = true;
+            j.opaque = !c.transparent_bg;
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            GLenum status = _glfn->ClientWaitSync (c.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (wait && status == GL_TIMEOUT_EXPIRED) {
+                status = _glfn->ClientWaitSync (c.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            if (status == GL_TIMEOUT_EXPIRED) { return false; }
+            _glfn->DeleteSync (c.fence);
+            c.fence = nullptr;
+            _glfn->BindBuffer (GL_PIXEL_PACK_BUFFER, c.pbo);
+            void* p = _glfn->MapBufferRange (GL_PIXEL_PACK_BUFFER, 0, c.bytes, GL_MAP_READ_BIT);
+            if (p != nullptr) { this->copy_capture (c, static_cast<const unsigned char*>(p), j.rgba); }
+            _glfn->UnmapBuffer (GL_PIXEL_PACK_BUFFER);
+            _glfn->BindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+#else
+            GLenum status = glClientWaitSync (c.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (wait && status == GL_TIMEOUT_EXPIRED) {
+                status = glClientWaitSync (c.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            if (status == GL_TIMEOUT_EXPIRED) { return false; }
+            glDeleteSync (c.fence);
+            c.fence = nullptr;
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, c.pbo);
+            void* p = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, c.bytes, GL_MAP_READ_BIT);
+            if (p != nullptr) { this->copy_capture (c, static_cast<const unsigned char*>(p), j.rgba); }
+            glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+            glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+#endif
+            if (p == nullptr) {
+                std::cerr << "VisualOwnable: Failed to map the capture buffer for " << c.filename << std::endl;
+                return true;
+            }
+            if (c.to_sink) {
+                if (this->framesink != nullptr) {
+                    this->framesink->write_frame (this->sink_frame.data(), c.dims[0], c.dims[1]);
+                }
+                return true;
+            }
+            if (this->png_queue == nullptr) { this->png_queue = std::make_unique<morph::png_writer>(); }
+            this->png_queue->push (std::move (j));
+            return true;
+        }
+
+        /*!
+         * Copy the pixels of capture c out of the mapped PBO at p. PNG frames are copied as they
+         * are into rgba (the png_writer flips them). Frames for framesink are copied into
+         * sink_frame, top row first, as frame_sink::write_frame() expects.
+         */
+        void copy_capture (const capture_t& c, const unsigned char* p, std::vector<unsigned char>& rgba)
+        {
+            if (!c.to_sink) {
+                rgba.assign (p, p + c.bytes);
+                return;
+            }
+            const std::size_t rowbytes = 4 * static_cast<std::size_t>(c.dims[0]);
+            this->sink_frame.resize (c.bytes);
+            for (int r = 0; r < c.dims[1]; ++r) {
+                std::memcpy (this->sink_frame.data() + r * rowbytes, p + (c.dims[1] - r - 1) * rowbytes, rowbytes);
+            }
+        }
+
+        //! Collect outstanding captures, wait for their files and free the pixel buffer objects
+        void free_captures()
+        {
+            this->finishRecording();
+            for (capture_t& c : this->captures) {
+                if (c.pbo == 0) { continue; }
+#ifdef GLAD_OPTION_GL_MX
+                this->glfn->DeleteBuffers (1, &c.pbo);
+#else
+                glDeleteBuffers (1, &c.pbo);
+#endif
+                c.pbo = 0;
+                c.bytes = 0;
+            }
+            this->png_queue.reset();
+        }
+
+        //! The framebuffer object for frames drawn at reduced resolution, its attachments and size
+        GLuint reduced_fbo = 0;
+        GLuint reduced_tex = 0;
+        GLuint reduced_depth = 0;
+        //! An empty vertex array object, bound to draw the upsampling triangle
+        GLuint reduced_vao = 0;
+        morph::vec<int, 2> reduced_size = { 0, 0 };
+        //! The framebuffer that was bound when the reduced frame began, to which it is upsampled
+        GLint reduced_target = 0;
+        //! Stores the info required to load the shader that scales reduced frames up
+        std::vector<morph::gl::ShaderInfo> upsample_shader_progs;
+
+        /*!
+         * Bind a framebuffer of scale times the fb_w by fb_h window (creating or resizing it
+         * as needed) and set the viewport to it. Returns false, with the window's framebuffer
+         * still bound, if the framebuffer can't be completed.
+         */
+        bool begin_reduced_frame (const int fb_w, const int fb_h, const float scale)
+        {
+            const morph::vec<int, 2> sz = { std::max (1, static_cast<int>(fb_w * scale)), std::max (1, static_cast<int>(fb_h * scale)) };
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            _glfn->GetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &this->reduced_target);
+            if (this->reduced_fbo == 0) {
+                _glfn->GenFramebuffers (1, &this->reduced_fbo);
+                _glfn->GenTextures (1, &this->reduced_tex);
+                _glfn->GenRenderbuffers (1, &this->reduced_depth);
+                _glfn->GenVertexArrays (1, &this->reduced_vao);
+            }
+            _glfn->BindFramebuffer (GL_FRAMEBUFFER, this->reduced_fbo);
+            if (sz != this->reduced_size) {
+                _glfn->BindTexture (GL_TEXTURE_2D, this->reduced_tex);
+                _glfn->TexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, sz[0], sz[1], 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                _glfn->TexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                _glfn->BindTexture (GL_TEXTURE_2D, 0);
+                _glfn->BindRenderbuffer (GL_RENDERBUFFER, this->reduced_depth);
+                _glfn->RenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, sz[0], sz[1]);
+                _glfn->BindRenderbuffer (GL_RENDERBUFFER, 0);
+                _glfn->FramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->reduced_tex, 0);
+                _glfn->FramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->reduced_depth);
+                this->reduced_size = sz;
+            }
+            if (_glfn->CheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                _glfn->BindFramebuffer (GL_FRAMEBUFFER, this->reduced_target);
+                return false;
+            }
+            _glfn->Viewport (0, 0, sz[0], sz[1]);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glGetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &this->reduced_target);
+            if (this->reduced_fbo == 0) {
+                glGenFramebuffers (1, &this->reduced_fbo);
+                glGenTextures (1, &this->reduced_tex);
+                glGenRenderbuffers (1, &this->reduced_depth);
+                glGenVertexArrays (1, &this->reduced_vao);
+            }
+            glBindFramebuffer (GL_FRAMEBUFFER, this->reduced_fbo);
+            if (sz != this->reduced_size) {
+                glBindTexture (GL_TEXTURE_2D, this->reduced_tex);
+                glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, sz[0], sz[1], 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glBindTexture (GL_TEXTURE_2D, 0);
+                glBindRenderbuffer (GL_RENDERBUFFER, this->reduced_depth);
+                glRenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, sz[0], sz[1]);
+                glBindRenderbuffer (GL_RENDERBUFFER, 0);
+                glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->reduced_tex, 0);
+                glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->reduced_depth);
+                this->reduced_size = sz;
+            }
+            if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                glBindFramebuffer (GL_FRAMEBUFFER, this->reduced_target);
+                return false;
+            }
+            glViewport (0, 0, sz[0], sz[1]);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            return true;
+        }
+
+        //! Scale the reduced frame up to the fb_w by fb_h window's framebuffer, and bind that again
+        void end_reduced_frame (const int fb_w, const int fb_h)
+        {
+            if (this->upsample_shader_progs.empty()) {
+                this->upsample_shader_progs = {
+                    {GL_VERTEX_SHADER, "VisUpsample.vert.glsl", morph::getUpsampleVtxShader(glver), 0 },
+                    {GL_FRAGMENT_SHADER, "VisUpsample.frag.glsl", morph::getUpsampleFragShader(glver), 0 }
+                };
+            }
+            const GLuint prog = this->shared_program ("upsample", this->upsample_shader_progs);
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            _glfn->BindFramebuffer (GL_FRAMEBUFFER, this->reduced_target);
+            _glfn->Viewport (0, 0, fb_w, fb_h);
+            _glfn->Disable (GL_DEPTH_TEST);
+            _glfn->Disable (GL_BLEND);
+            _glfn->UseProgram (prog);
+            _glfn->ActiveTexture (GL_TEXTURE0);
+            _glfn->BindTexture (GL_TEXTURE_2D, this->reduced_tex);
+            _glfn->Uniform1i (_glfn->GetUniformLocation (prog, "frame"), 0);
+            _glfn->BindVertexArray (this->reduced_vao);
+            _glfn->DrawArrays (GL_TRIANGLES, 0, 3);
+            _glfn->BindVertexArray (0);
+            _glfn->BindTexture (GL_TEXTURE_2D, 0);
+            _glfn->Enable (GL_DEPTH_TEST);
+            _glfn->Enable (GL_BLEND);
+            _glfn->UseProgram (this->shaders.gprog);
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            glBindFramebuffer (GL_FRAMEBUFFER, this->reduced_target);
+            glViewport (0, 0, fb_w, fb_h);
+            glDisable (GL_DEPTH_TEST);
+            glDisable (GL_BLEND);
+            glUseProgram (prog);
+            glActiveTexture (GL_TEXTURE0);
+            glBindTexture (GL_TEXTURE_2D, this->reduced_tex);
+            glUniform1i (glGetUniformLocation (prog, "frame"), 0);
+            glBindVertexArray (this->reduced_vao);
+            glDrawArrays (GL_TRIANGLES, 0, 3);
+            glBindVertexArray (0);
+            glBindTexture (GL_TEXTURE_2D, 0);
+            glEnable (GL_DEPTH_TEST);
+            glEnable (GL_BLEND);
+            glUseProgram (this->shaders.gprog);
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+        }
+
+        //! The batch of static models, created when static_batching is first used
+        std::unique_ptr<morph::VisualBatch<glver>> batch;
+        //! Stores the info required to load the batch's shader
+        std::vector<morph::gl::ShaderInfo> batch_shader_progs;
+
+        /*!
+         * Draw the models added to the batch this frame with the batch's shader program, which
+         * gets the projection and lighting of the graphics program. The graphics program is
+         * current on entry and on return.
+         */
+        void render_batch (const morph::mat44<float>& sceneview)
+        {
+            if (this->batch_shader_progs.empty()) {
+                this->batch_shader_progs = {
+                    {GL_VERTEX_SHADER, "VisBatch.vert.glsl", morph::getStaticBatchVtxShader(glver), 0 },
+                    {GL_FRAGMENT_SHADER, "Visual.frag.glsl", morph::getDefaultFragShader(glver), 0 }
+                };
+            }
+            const GLuint prog = this->shared_program ("static_batch", this->batch_shader_progs);
+            if (prog == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            _glfn->UseProgram (prog);
+            _glfn->UniformMatrix4fv (_glfn->GetUniformLocation (prog, "p_matrix"), 1, GL_FALSE, this->projection.mat.data());
+            _glfn->UniformMatrix4fv (_glfn->GetUniformLocation (prog, "v_matrix"), 1, GL_FALSE, sceneview.mat.data());
+            _glfn->Uniform3fv (_glfn->GetUniformLocation (prog, "light_colour"), 1, this->light_colour.data());
+            _glfn->Uniform1f (_glfn->GetUniformLocation (prog, "ambient_intensity"), this->ambient_intensity);
+            _glfn->Uniform3fv (_glfn->GetUniformLocation (prog, "diffuse_position"), 1, this->diffuse_position.data());
+            _glfn->Uniform1f (_glfn->GetUniformLocation (prog, "diffuse_intensity"), this->diffuse_intensity);
+            _glfn->Uniform1i (_glfn->GetUniformLocation (prog, "data_texture"), 0);
+            this->batch->render (_glfn);
+            _glfn->UseProgram (this->shaders.gprog);
+#else
+            glUseProgram (prog);
+            glUniformMatrix4fv (glGetUniformLocation (prog, "p_matrix"), 1, GL_FALSE, this->projection.mat.data());
+            glUniformMatrix4fv (glGetUniformLocation (prog, "v_matrix"), 1, GL_FALSE, sceneview.mat.data());
+            glUniform3fv (glGetUniformLocation (prog, "light_colour"), 1, this->light_colour.data());
+            glUniform1f (glGetUniformLocation (prog, "ambient_intensity"), this->ambient_intensity);
+            glUniform3fv (glGetUniformLocation (prog, "diffuse_position"), 1, this->diffuse_position.data());
+            glUniform1f (glGetUniformLocation (prog, "diffuse_intensity"), this->diffuse_intensity);
+            glUniform1i (glGetUniformLocation (prog, "data_texture"), 0);
+            this->batch->render();
+            glUseProgram (this->shaders.gprog);
+#endif
+        }
+
+        //! Delete the reduced resolution framebuffer, which belongs to this Visual's context
+        void free_reduced_frame()
+        {
+            if (this->reduced_fbo == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            if (this->glfn) {
+                this->glfn->DeleteFramebuffers (1, &this->reduced_fbo);
+                this->glfn->DeleteTextures (1, &this->reduced_tex);
+                this->glfn->DeleteRenderbuffers (1, &this->reduced_depth);
+                this->glfn->DeleteVertexArrays (1, &this->reduced_vao);
+            }
+#else
+            glDeleteFramebuffers (1, &this->reduced_fbo);
+            glDeleteTextures (1, &this->reduced_tex);
+            glDeleteRenderbuffers (1, &this->reduced_depth);
+            glDeleteVertexArrays (1, &this->reduced_vao);
+#endif
+            this->reduced_fbo = 0;
+            this->reduced_tex = 0;
+            this->reduced_depth = 0;
+            this->reduced_vao = 0;
+            this->reduced_size = { 0, 0 };
+        }
+
+    public:
         /*!
          * Set up the passed-in VisualModel (or indeed, VisualTextModel) with functions that need access to Visual attributes.
          */
@@ -306,8 +790,16 @@ namespace morph {
          */
         morph::VisualModel<glver>* getVisualModel (unsigned int modelId) { return (this->vm[modelId].get()); }
 
+        //! The number of VisualModels in the scene
+        unsigned int numVisualModels() const { return static_cast<unsigned int>(this->vm.size()); }
+
         //! Remove the VisualModel with ID \a modelId from the scene.
-        void removeVisualModel (unsigned int modelId) { this->vm.erase (this->vm.begin() + modelId); }
+        void removeVisualModel (unsigned int modelId)
+        {
+            this->vm[modelId]->wait_async_build();
+            this->vm.erase (this->vm.begin() + modelId);
+            if (this->batch != nullptr) { this->batch->invalidate(); }
+        }
 
         //! Remove the VisualModel whose pointer matches the VisualModel* vmp
         void removeVisualModel (morph::VisualModel<glver>* vmp)
@@ -320,7 +812,11 @@ namespace morph {
                     break;
                 }
             }
-            if (found_model == true) { this->vm.erase (this->vm.begin() + modelId); }
+            if (found_model == true) {
+                this->vm[modelId]->wait_async_build();
+                this->vm.erase (this->vm.begin() + modelId);
+                if (this->batch != nullptr) { this->batch->invalidate(); }
+            }
         }
 
         //! Add a label _text to the scene at position _toffset. Font features are
@@ -381,8 +877,28 @@ namespace morph {
         //! Render the scene
         void render()
         {
+            MORPH_TRACE_SCOPE_CAT ("VisualOwnable::render", "render");
+            const auto t_frame = std::chrono::steady_clock::now();
             this->setContext();
 
+            // Upload the vertices of any asynchronous builds that have finished since the last
+            // frame, within upload_budget_ms. Those left over are first in line next frame.
+            bool uploaded = false;
+            for (std::size_t k = 0; k < this->vm.size(); ++k) {
+                const std::size_t i = (this->collect_next + k) % this->vm.size();
+                if (uploaded && this->upload_budget_ms > 0.0
+                    && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_frame).count() > this->upload_budget_ms) {
+                    this->collect_next = i;
+                    this->render_requested = true;
+                    break;
+                }
+                if (this->vm[i]->collect_async_build()) { uploaded = true; }
+            }
+
+            // With render_on_demand, a frame in which nothing has changed is not drawn at all
+            if (this->render_on_demand == true && this->needs_render() == false) { return; }
+            this->render_requested = false;
+
 #ifdef __OSX__
             // https://stackoverflow.com/questions/35715579/opengl-created-window-size-twice-as-large
             const double retinaScale = 2; // deals with quadrant issue on osx
@@ -391,25 +907,16 @@ namespace morph {
 #endif
             if (this->ptype == perspective_type::orthographic || this->ptype == perspective_type::perspective) {
                 if (this->active_gprog != morph::visgl::graphics_shader_type::projection2d) {
-#ifdef GLAD_OPTION_GL_MX
-                    if (this->shaders.gprog) { this->glfn->DeleteProgram (this->shaders.gprog); }
-                    this->shaders.gprog = morph::gl::LoadShaders (this->proj2d_shader_progs, this->glfn);
-#else
-                    if (this->shaders.gprog) { glDeleteProgram (this->shaders.gprog); }
-                    this->shaders.gprog = morph::gl::LoadShaders (this->proj2d_shader_progs);
-#endif
+                    // The programs stay resident in the share group, so switching back is cheap
+                    this->shaders.gprog = this->shared_program ("projection2d", this->proj2d_shader_progs);
                     this->active_gprog = morph::visgl::graphics_shader_type::projection2d;
+                    this->cacheUniformLocations();
                 }
             } else if (this->ptype == perspective_type::cylindrical) {
                 if (this->active_gprog != morph::visgl::graphics_shader_type::cylindrical) {
-#ifdef GLAD_OPTION_GL_MX
-                    if (this->shaders.gprog) { this->glfn->DeleteProgram (this->shaders.gprog); }
-                    this->shaders.gprog = morph::gl::LoadShaders (this->cyl_shader_progs, this->glfn);
-#else
-                    if (this->shaders.gprog) { glDeleteProgram (this->shaders.gprog); }
-                    this->shaders.gprog = morph::gl::LoadShaders (this->cyl_shader_progs);
-#endif
+                    this->shaders.gprog = this->shared_program ("cylindrical", this->cyl_shader_progs);
                     this->active_gprog = morph::visgl::graphics_shader_type::cylindrical;
+                    this->cacheUniformLocations();
                 }
             }
 
@@ -421,6 +928,15 @@ namespace morph {
             glUseProgram (this->shaders.gprog);
             glViewport (0, 0, this->window_w * retinaScale, this->window_h * retinaScale);
 #endif
+            // While the view moves, the frame may be drawn smaller and scaled up (see adaptive_resolution)
+            const int fb_w = static_cast<int>(this->window_w * retinaScale);
+            const int fb_h = static_cast<int>(this->window_h * retinaScale);
+            float res_scale = 1.0f;
+            if (this->adaptive_resolution.enabled) {
+                const std::uint64_t rev = this->adaptive_resolution.frame_budget_ms > 0.0 ? this->scene_revision() : 0u;
+                res_scale = this->adaptive_resolution.frame (this->rotateMode || this->translateMode, rev, t_frame);
+                if (res_scale < 1.0f && !this->begin_reduced_frame (fb_w, fb_h, res_scale)) { res_scale = 1.0f; }
+            }
             // Set the perspective
             if (this->ptype == perspective_type::orthographic) {
                 this->setOrthographic();
@@ -541,6 +1057,21 @@ namespace morph {
             morph::mat44<float> scenetransonly;
             scenetransonly.translate (this->scenetrans);
 
+            // Draw the models grouped by shader program, so that each program is made current just
+            // once. First the triangles of every model with the graphics program...
+#ifdef GLAD_OPTION_GL_MX
+            this->glfn->UseProgram (this->shaders.gprog);
+#else
+            glUseProgram (this->shaders.gprog);
+#endif
+            // Models whose bounding boxes are outside the view frustum are not drawn
+            const bool cull = this->frustum_culling
+            && (this->ptype == perspective_type::orthographic || this->ptype == perspective_type::perspective);
+            // Static models may be drawn together, after the others (see static_batching)
+            const bool batching = morph::VisualBatch<glver>::supported && this->static_batching
+            && (this->ptype == perspective_type::orthographic || this->ptype == perspective_type::perspective);
+            if (batching && this->batch == nullptr) { this->batch = std::make_unique<morph::VisualBatch<glver>>(); }
+            this->render_counts = render_count_t{};
             auto vmi = this->vm.begin();
             while (vmi != this->vm.end()) {
                 if ((*vmi)->twodimensional == true) {
@@ -549,9 +1080,35 @@ namespace morph {
                 } else {
                     (*vmi)->setSceneMatrix (sceneview);
                 }
-                (*vmi)->render();
+                const bool hidden = (*vmi)->hidden();
+                const bool culled = !hidden && cull && (*vmi)->outsideFrustum (this->projection);
+                if (hidden) {
+                    ++this->render_counts.hidden;
+                } else if (culled) {
+                    ++this->render_counts.culled;
+                }
+                // A batched model is added whether or not it is visible, so that the batch stays the same
+                if (batching && this->batch->add (vmi->get(), !hidden && !culled)) {
+                    if (!hidden && !culled) {
+                        ++this->render_counts.drawn;
+                        ++this->render_counts.batched;
+                    }
+                } else if (!hidden && !culled) {
+                    if (this->profiling) { (*vmi)->gpu_timer_begin(); }
+                    (*vmi)->render_geometry();
+                    if (this->profiling) { (*vmi)->gpu_timer_end(); }
+                    ++this->render_counts.drawn;
+                }
                 ++vmi;
             }
+            if (batching) { this->render_batch (sceneview); }
+            // ...then all of their text labels with the text program
+#ifdef GLAD_OPTION_GL_MX
+            this->glfn->UseProgram (this->shaders.tprog);
+#else
+            glUseProgram (this->shaders.tprog);
+#endif
+            for (auto& m : this->vm) { m->render_texts (true); }
 
             morph::vec<float, 3> v0 = this->textPosition ({-0.8f, 0.8f});
             if (this->showTitle == true) {
@@ -569,9 +1126,276 @@ namespace morph {
                 ++ti;
             }
 
+            if (this->profiling) {
+                this->collect_profile (t_frame);
+                if (this->show_profile) { this->render_profile_overlay(); }
+            }
+
+            if (res_scale < 1.0f) { this->end_reduced_frame (fb_w, fb_h); }
+            // A reduced frame is followed by a full one, once the view has come to rest
+            if (this->adaptive_resolution.reduced()) { this->render_requested = true; }
+
+            if (this->render_on_demand == true) { this->rendered_revision = this->scene_revision(); }
+
             this->swapBuffers();
         }
 
+        /*!
+         * If true, render() draws a frame only if something has changed since the last one it
+         * drew: the view (scene translation and rotation, projection, window size, lighting,
+         * background), the models (their uploads to OpenGL, visibility, alpha and view matrices;
+         * see VisualModel::render_revision), their texts, or work a model has pending (see
+         * VisualModel::render_pending). Otherwise render() returns at once, leaving the last
+         * frame on screen, so a static scene costs almost nothing to keep open. Changes that
+         * can't be seen from here, such as those made in a custom shader's uniforms, should be
+         * followed by a call to request_render().
+         */
+        bool render_on_demand = false;
+
+        /*!
+         * Ask for the next call to render() to draw a frame, even if render_on_demand is set and
+         * nothing appears to have changed. May be called from any thread. Visual also wakes its
+         * event loop, so that keepOpen() notices.
+         */
+        virtual void request_render() { this->render_requested = true; }
+
+        /*!
+         * True if render() would draw a frame: if a render has been requested, a model has
+         * work pending, or the scene has changed since the last frame was drawn.
+         */
+        bool needs_render() const
+        {
+            if (this->render_requested == true) { return true; }
+            for (const auto& m : this->vm) { if (m->render_pending()) { return true; } }
+            return this->scene_revision() != this->rendered_revision;
+        }
+
+        //! True if any model has an asynchronous build that has yet to be uploaded
+        bool builds_pending() const
+        {
+            for (const auto& m : this->vm) { if (m->build_pending()) { return true; } }
+            return false;
+        }
+
+        /*!
+         * If greater than 0, the time in ms that render() may spend uploading finished
+         * asynchronous builds (see VisualModel::reinit_async) at the start of a frame. Once
+         * it is used up, the remaining builds wait for the next frame, which render() requests,
+         * so that many big models finishing together don't make one long frame. At least one
+         * build is uploaded in each frame. With 0, all finished builds are uploaded at once.
+         */
+        double upload_budget_ms = 0.0;
+
+        /*!
+         * If true, VisualModels whose bounding boxes lie entirely outside the view frustum are
+         * skipped by render(). Applies to the orthographic and perspective projections. Their text
+         * labels are still drawn.
+         */
+        bool frustum_culling = true;
+
+        /*!
+         * If true, the models with VisualModel::static_batch set are drawn from shared buffers
+         * with one glMultiDrawElementsIndirect call (see VisualBatch), after the other models,
+         * rather than with a draw call each. This suits scenes of thousands of small models
+         * whose vertices don't change. Needs OpenGL 4.3 (glver of version_4_3 or later, not
+         * OpenGL ES), otherwise it is ignored; it applies to the orthographic and perspective
+         * projections.
+         */
+        bool static_batching = false;
+
+        /*!
+         * Dynamic resolution. With adaptive_resolution.enabled set, frames drawn while the user
+         * rotates, translates or zooms the scene (and, with a frame_budget_ms, frames of a
+         * changing scene that are slower than the budget) are drawn into an off screen
+         * framebuffer of a fraction of the window's size, without multisampling, and scaled up
+         * to the window. Once the view comes to rest, render() is asked for one more frame,
+         * which is drawn at full resolution with the window's multisampling. Frames saved with
+         * saveImage() while the view is moving may be reduced ones.
+         */
+        morph::dynamic_resolution adaptive_resolution;
+
+        //! The numbers of models drawn, culled and hidden in a call to render()
+        struct render_count_t
+        {
+            unsigned int drawn = 0;
+            unsigned int culled = 0;
+            unsigned int hidden = 0;
+            //! Of those drawn, the number drawn by the static batch
+            unsigned int batched = 0;
+        };
+        //! The counts for the most recent frame
+        render_count_t render_counts;
+
+        /*!
+         * If true, render() profiles each frame into frame_profile. Each VisualModel's drawing is
+         * timed on the GPU with a timer query (not available on OpenGL ES), and the counters in
+         * VisualModel::profile are collected and reset.
+         */
+        bool profiling = false;
+        //! If true (and profiling), render() shows a summary of the profile over the scene
+        bool show_profile = false;
+        //! Where to show the summary, in the same screen coordinates as coordArrowsOffset
+        morph::vec<float, 2> profile_offset = { -0.8f, 0.7f };
+
+        //! A profile of one frame, gathered by render() if profiling is true
+        struct frame_profile_t
+        {
+            //! CPU time in render(), up to the buffer swap, in ms
+            double frame_ms = 0.0;
+            //! Time from the start of the previous render() to the start of this one, in ms
+            double interval_ms = 0.0;
+            //! The sums of the models' counters. gpu_ms sums only the models that were drawn.
+            double gpu_ms = 0.0;
+            double build_ms = 0.0;
+            double upload_ms = 0.0;
+            unsigned int draw_calls = 0;
+            std::size_t vertices = 0;
+            std::size_t upload_bytes = 0;
+            //! The counters of each model in turn (gpu_ms is 0 for those that weren't drawn)
+            std::vector<typename morph::VisualModel<glver>::profile_counters> models;
+        };
+        //! The profile of the most recent frame
+        frame_profile_t frame_profile;
+
+    protected:
+        //! Set by request_render(); cleared when render() draws a frame
+        std::atomic<bool> render_requested = true;
+        //! The model that render() offers the first upload to (see upload_budget_ms)
+        std::size_t collect_next = 0;
+        //! The scene_revision() of the last frame drawn with render_on_demand set
+        std::uint64_t rendered_revision = 0;
+
+        //! A hash of everything outside the models' vertices that changes what render() draws
+        std::uint64_t scene_revision() const
+        {
+            // 64 bit FNV-1a
+            std::uint64_t h = morph::fnv1a_basis;
+            auto mix = [&h](const void* data, std::size_t n) { h = morph::fnv1a (data, n, h); };
+            const float view[9] = { this->scenetrans[0], this->scenetrans[1], this->scenetrans[2],
+                                    this->rotation.w, this->rotation.x, this->rotation.y, this->rotation.z,
+                                    this->text_z, this->fov };
+            mix (view, sizeof (view));
+            const float proj[6] = { this->zNear, this->zFar, this->ortho_lb[0], this->ortho_lb[1], this->ortho_rt[0], this->ortho_rt[1] };
+            mix (proj, sizeof (proj));
+            mix (this->bgcolour.data(), sizeof (this->bgcolour));
+            const float light[12] = { this->light_colour[0], this->light_colour[1], this->light_colour[2], this->ambient_intensity,
+                                      this->diffuse_position[0], this->diffuse_position[1], this->diffuse_position[2],
+                                      this->diffuse_intensity, this->cyl_radius, this->cyl_height,
+                                      this->coordArrowsOffset[0], this->coordArrowsOffset[1] };
+            mix (light, sizeof (light));
+            mix (this->cyl_cam_pos.data(), sizeof (float) * 4);
+            const int params[5] = { static_cast<int>(this->ptype), this->window_w, this->window_h,
+                                    static_cast<int>(this->vm.size()), static_cast<int>(this->texts.size()) };
+            mix (params, sizeof (params));
+            const unsigned int flags = (this->showCoordArrows ? 1u : 0u) | (this->coordArrowsInScene ? 2u : 0u)
+            | (this->showTitle ? 4u : 0u) | (this->frustum_culling ? 8u : 0u)
+            | (this->profiling ? 16u : 0u) | (this->show_profile ? 32u : 0u);
+            mix (&flags, sizeof (flags));
+            for (const auto& m : this->vm) {
+                const std::uint64_t r = m->render_revision();
+                mix (&r, sizeof (r));
+            }
+            if (this->coordArrows) {
+                const std::uint64_t r = this->coordArrows->render_revision();
+                mix (&r, sizeof (r));
+            }
+            if (this->textModel) {
+                const unsigned int c = this->textModel->get_changes();
+                mix (&c, sizeof (c));
+            }
+            for (const auto& t : this->texts) {
+                const unsigned int c = t->get_changes();
+                mix (&c, sizeof (c));
+            }
+            return h;
+        }
+
+    public:
+
+        //! A few lines of text summarising the profile p, as shown by show_profile
+        static std::string profile_summary (const frame_profile_t& p)
+        {
+            std::ostringstream ss;
+            ss << std::fixed << std::setprecision (2);
+            ss << "frame " << p.frame_ms << " ms CPU, " << p.gpu_ms << " ms GPU";
+            if (p.interval_ms > 0.0) { ss << ", " << std::setprecision (1) << 1000.0 / p.interval_ms << " fps"; }
+            ss << std::setprecision (2) << "\n";
+            ss << p.draw_calls << " draw calls, " << p.vertices << " vertices\n";
+            ss << "build " << p.build_ms << " ms, upload " << p.upload_ms << " ms (" << p.upload_bytes / 1024 << " kB)";
+            // The models that took longest on the GPU
+            std::vector<std::size_t> order (p.models.size());
+            for (std::size_t i = 0; i < order.size(); ++i) { order[i] = i; }
+            const std::size_t n = std::min (order.size(), std::size_t{3});
+            std::partial_sort (order.begin(), order.begin() + n, order.end(),
+                               [&p](std::size_t a, std::size_t b) { return p.models[a].gpu_ms > p.models[b].gpu_ms; });
+            for (std::size_t i = 0; i < n && p.models[order[i]].gpu_ms > 0.0; ++i) {
+                ss << (i == 0 ? "\nslowest: " : ", ") << "model " << order[i] << " " << p.models[order[i]].gpu_ms << " ms";
+            }
+            return ss.str();
+        }
+
+        /*!
+         * The memory held by the scene: by each model, the Visual's own texts and the fonts of
+         * its share group (shared with the other Visuals in the group, if any). Print str() of
+         * the result to find the models (or the duplicated CPU copies of their vertex data)
+         * that take the most.
+         */
+        morph::memory_usage memory_usage()
+        {
+            morph::memory_usage mu ("scene");
+            for (std::size_t k = 0; k < this->vm.size(); ++k) {
+                morph::memory_usage m = this->vm[k]->memory_usage();
+                m.name = "model " + std::to_string (k) + " (" + m.name + ")";
+                mu.add (std::move (m));
+            }
+            if (this->coordArrows) { mu.add (this->coordArrows->memory_usage()).name = "coordArrows"; }
+            if (this->textModel) { mu.add (this->textModel->memory_usage ("title")); }
+            for (std::size_t i = 0; i < this->texts.size(); ++i) {
+                mu.add (this->texts[i]->memory_usage ("text " + std::to_string (i)));
+            }
+            mu.add (morph::VisualResources<glver>::i().faces_memory_usage (this));
+            return mu;
+        }
+
+        //! Look up the locations of the per-model uniforms in the shader programs. Called whenever
+        //! a program is (re)loaded, so that VisualModel::render need not look them up by name.
+        void cacheUniformLocations()
+        {
+            auto lookup = [this](GLuint prog, morph::visgl::visual_shaderprogs::uniform_locations& locs)
+            {
+                if (prog == 0) { locs = morph::visgl::visual_shaderprogs::uniform_locations{}; return; }
+#ifdef GLAD_OPTION_GL_MX
+                locs.alpha = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("alpha"));
+                locs.v_matrix = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("v_matrix"));
+                locs.m_matrix = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("m_matrix"));
+                locs.instanced = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("instanced"));
+                locs.text_colour = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("textColor"));
+                locs.data_texture = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("data_texture"));
+                locs.data_tex = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("data_tex"));
+                locs.lut_tex = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("lut_tex"));
+                locs.data_scale = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("data_scale"));
+                locs.data_displace = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("data_displace"));
+                locs.data_zscale = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("data_zscale"));
+                locs.data_spacing = this->glfn->GetUniformLocation (prog, static_cast<const GLchar*>("data_spacing"));
+#else
+                locs.alpha = glGetUniformLocation (prog, static_cast<const GLchar*>("alpha"));
+                locs.v_matrix = glGetUniformLocation (prog, static_cast<const GLchar*>("v_matrix"));
+                locs.m_matrix = glGetUniformLocation (prog, static_cast<const GLchar*>("m_matrix"));
+                locs.instanced = glGetUniformLocation (prog, static_cast<const GLchar*>("instanced"));
+                locs.text_colour = glGetUniformLocation (prog, static_cast<const GLchar*>("textColor"));
+                locs.data_texture = glGetUniformLocation (prog, static_cast<const GLchar*>("data_texture"));
+                locs.data_tex = glGetUniformLocation (prog, static_cast<const GLchar*>("data_tex"));
+                locs.lut_tex = glGetUniformLocation (prog, static_cast<const GLchar*>("lut_tex"));
+                locs.data_scale = glGetUniformLocation (prog, static_cast<const GLchar*>("data_scale"));
+                locs.data_displace = glGetUniformLocation (prog, static_cast<const GLchar*>("data_displace"));
+                locs.data_zscale = glGetUniformLocation (prog, static_cast<const GLchar*>("data_zscale"));
+                locs.data_spacing = glGetUniformLocation (prog, static_cast<const GLchar*>("data_spacing"));
+#endif
+            };
+            lookup (this->shaders.gprog, this->shaders.gprog_locs);
+            lookup (this->shaders.tprog, this->shaders.tprog_locs);
+        }
+
         //! Compute a translation vector for text position, using Visual::text_z.
         morph::vec<float, 3> textPosition (const morph::vec<float, 2> p0_coord)
         {
@@ -755,138 +1579,274 @@ namespace morph {
             this->rotation_default = _rotn;
         }
 
+        //! The current scene translation and rotation, which the user may have changed with the mouse
+        const morph::vec<float, 3>& getSceneTrans() const { return this->scenetrans; }
+        const morph::quaternion<float>& getSceneRotation() const { return this->rotation; }
+
         void lightingEffects (const bool effects_on = true)
         {
             this->ambient_intensity = effects_on ? 0.4f : 1.0f;
             this->diffuse_intensity = effects_on ? 0.6f : 0.0f;
         }
 
-        //! Save all the VisualModels in this Visual out to a GLTF format file
-        virtual void savegltf (const std::string& gltf_file)
+        /*!
+         * For its lifetime, the vertex arrays of the models that gpu_resident has freed are read
+         * back from the GPU (for the glTF writers). They are freed again at its end.
+         */
+        struct restored_vertices
         {
-            std::ofstream fout;
-            fout.open (gltf_file, std::ios::out|std::ios::trunc);
-            if (!fout.is_open()) { throw std::runtime_error ("Visual::savegltf(): Failed to open file for writing"); }
-            fout << "{\n  \"scenes\" : [ { \"nodes\" : [ ";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                fout << vmi << (vmi < this->vm.size()-1 ? ", " : "");
+            std::vector<std::unique_ptr<morph::VisualModel<glver>>>& models;
+            restored_vertices (std::vector<std::unique_ptr<morph::VisualModel<glver>>>& _models) : models(_models)
+            {
+                for (auto& m : this->models) { m->restore_vertices(); }
             }
-            fout << " ] } ],\n";
+            ~restored_vertices() { for (auto& m : this->models) { m->release_vertices(); } }
+        };
 
-            fout << "  \"nodes\" : [\n";
-            // for loop over VisualModels "mesh" : 0, etc
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                fout << "    { \"mesh\" : " << vmi
-                     << ", \"translation\" : " << this->vm[vmi]->translation_str()
-                     << (vmi < this->vm.size()-1 ? " },\n" : " }\n");
+        /*!
+         * The layout of the glTF written by savegltf() and saveglb(). Each distinct vertex array
+         * (indices, positions, colours or normals) is written once, as one buffer view and one
+         * accessor, and the models whose four arrays are all the same share one mesh. Matches are
+         * found by hashing the arrays and then comparing them exactly, so a scene with no
+         * repeated geometry is written just as it would be without any sharing.
+         */
+        struct gltf_layout
+        {
+            //! Each array: which of indices, positions, colours, normals (0-3) and the model it is written from
+            std::vector<std::array<std::size_t, 2>> arrays;
+            //! The arrays (and so the accessors) of each mesh, in the order indices, positions, colours, normals
+            std::vector<std::array<std::size_t, 4>> meshes;
+            //! The models that draw each mesh
+            std::vector<std::vector<std::size_t>> mesh_models;
+            //! A node draws one model of a mesh or, if instanced, all of the models of its mesh
+            struct node { std::size_t mesh = 0; std::size_t model = 0; bool instanced = false; };
+            std::vector<node> nodes;
+            //! The number of instanced nodes. Their TRANSLATION accessors follow those of the arrays.
+            std::size_t n_instanced = 0;
+            //! The model that mesh mi's positions are written from, and so quantised by
+            std::size_t position_model (const std::size_t mi) const { return this->arrays[this->meshes[mi][1]][1]; }
+        };
+
+        /*!
+         * If true, savegltf() and saveglb() write the models that share a mesh as one node using
+         * the EXT_mesh_gpu_instancing extension, rather than as one node per model. This gives
+         * smaller files, but the extension is required to read them.
+         */
+        bool gltf_instancing = false;
+
+        //! Find the distinct arrays and meshes of the models (whose vertices must be restored)
+        gltf_layout make_gltf_layout() const
+        {
+            gltf_layout l;
+            const std::size_t nvm = this->vm.size();
+            auto bytes_of = [this](const std::size_t m, const std::size_t k) -> std::pair<const void*, std::size_t> {
+                const VisualModel<glver>& mdl = *this->vm[m];
+                if (k == 0) { return { mdl.get_indices().data(), mdl.get_indices().size() * sizeof (GLuint) }; }
+                const std::vector<float>& v = k == 1 ? mdl.get_positions() : (k == 2 ? mdl.get_colours() : mdl.get_normals());
+                return { v.data(), v.size() * sizeof (float) };
+            };
+            // For each kind of array, the arrays seen so far by hash
+            std::array<std::unordered_multimap<std::uint64_t, std::size_t>, 4> seen;
+            std::vector<std::size_t> mesh_of (nvm, 0u);
+            for (std::size_t vmi = 0u; vmi < nvm; ++vmi) {
+                std::array<std::size_t, 4> a = {};
+                for (std::size_t k = 0u; k < 4u; ++k) {
+                    const auto b = bytes_of (vmi, k);
+                    const std::uint64_t h = morph::mesh_cache::hash (b.first, b.second);
+                    a[k] = l.arrays.size();
+                    auto [first, last] = seen[k].equal_range (h);
+                    for (auto it = first; it != last; ++it) {
+                        const auto ob = bytes_of (l.arrays[it->second][1], k);
+                        if (ob.second == b.second && (b.second == 0u || std::memcmp (ob.first, b.first, b.second) == 0)) {
+                            a[k] = it->second;
+                            break;
+                        }
+                    }
+                    if (a[k] == l.arrays.size()) {
+                        seen[k].emplace (h, a[k]);
+                        l.arrays.push_back ({ k, vmi });
+                    }
+                }
+                auto mi = std::find (l.meshes.begin(), l.meshes.end(), a);
+                mesh_of[vmi] = static_cast<std::size_t>(mi - l.meshes.begin());
+                if (mi == l.meshes.end()) {
+                    l.meshes.push_back (a);
+                    l.mesh_models.emplace_back();
+                }
+                l.mesh_models[mesh_of[vmi]].push_back (vmi);
             }
-            fout << "  ],\n";
+            // The nodes keep the order of the models. An instanced node is placed at its first model.
+            std::vector<bool> placed (l.meshes.size(), false);
+            for (std::size_t vmi = 0u; vmi < nvm; ++vmi) {
+                const std::size_t mi = mesh_of[vmi];
+                const bool inst = this->gltf_instancing && l.mesh_models[mi].size() > 1u;
+                if (inst) {
+                    if (placed[mi]) { continue; }
+                    placed[mi] = true;
+                    ++l.n_instanced;
+                }
+                l.nodes.push_back ({ mi, vmi, inst });
+            }
+            return l;
+        }
 
-            fout << "  \"meshes\" : [\n";
-            // for each VisualModel:
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                fout << "    { \"primitives\" : [ { \"attributes\" : { \"POSITION\" : " << 1+vmi*4
-                     << ", \"COLOR_0\" : " << 2+vmi*4
-                     << ", \"NORMAL\" : " << 3+vmi*4 << " }, \"indices\" : " << vmi*4 << ", \"material\": 0 } ] }"
-                     << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+        /*!
+         * The instance translations of an instanced node. If quantised, these are in the units of
+         * the quantised positions, as the node is scaled by vpos_qscale() of the model that the
+         * positions were written from.
+         */
+        std::vector<float> gltf_instance_translations (const gltf_layout& l, const typename gltf_layout::node& n,
+                                                       const bool quantised) const
+        {
+            std::vector<float> t;
+            t.reserve (3u * l.mesh_models[n.mesh].size());
+            const VisualModel<glver>& pm = *this->vm[l.position_model (n.mesh)];
+            const float s = quantised ? pm.vpos_qscale() : 1.0f;
+            for (std::size_t vmi : l.mesh_models[n.mesh]) {
+                vec<float> o = this->vm[vmi]->get_mv_offset();
+                if (quantised) { o = (o + pm.vpos_qcentre()) / s; }
+                t.insert (t.end(), o.begin(), o.end());
+            }
+            return t;
+        }
+
+        //! Write the nodes of layout l as lines of a glTF "nodes" array
+        void gltf_write_nodes (std::ostream& fout, const gltf_layout& l) const
+        {
+            std::size_t tacc = l.arrays.size();
+            for (std::size_t ni = 0u; ni < l.nodes.size(); ++ni) {
+                const auto& n = l.nodes[ni];
+                fout << "    { \"mesh\" : " << n.mesh;
+                if (n.instanced) {
+                    fout << ", \"extensions\" : { \"EXT_mesh_gpu_instancing\" : { \"attributes\" : { \"TRANSLATION\" : "
+                         << tacc++ << " } } }";
+                } else {
+                    fout << ", \"translation\" : " << this->vm[n.model]->translation_str();
+                }
+                fout << (ni < l.nodes.size()-1 ? " },\n" : " }\n");
+            }
+        }
+
+        //! Write the meshes of layout l as lines of a glTF "meshes" array
+        void gltf_write_meshes (std::ostream& fout, const gltf_layout& l) const
+        {
+            for (std::size_t mi = 0u; mi < l.meshes.size(); ++mi) {
+                const std::array<std::size_t, 4>& a = l.meshes[mi];
+                fout << "    { \"primitives\" : [ { \"attributes\" : { \"POSITION\" : " << a[1]
+                     << ", \"COLOR_0\" : " << a[2]
+                     << ", \"NORMAL\" : " << a[3] << " }, \"indices\" : " << a[0] << ", \"material\": 0 } ] }"
+                     << (mi < l.meshes.size()-1 ? ",\n" : "\n");
+            }
+        }
+
+        //! Write the "buffers", "bufferViews" and "accessors" sections of glTF for layout l
+        void gltf_write_buffers (std::ostream& fout, const gltf_layout& l) const
+        {
+            const std::size_t na = l.arrays.size();
+            // The arrays' data (base64 encoded) and size in bytes, then each instanced node's translations
+            std::vector<std::pair<std::string, std::size_t>> data;
+            data.reserve (na + l.n_instanced);
+            for (const std::array<std::size_t, 2>& a : l.arrays) {
+                auto& m = this->vm[a[1]];
+                if (a[0] == 0) {
+                    data.emplace_back (m->indices_base64(), m->indices_bytes());
+                } else if (a[0] == 1) {
+                    m->computeVertexMaxMins();
+                    data.emplace_back (m->vpos_base64(), m->vpos_bytes());
+                } else if (a[0] == 2) {
+                    data.emplace_back (m->vcol_base64(), m->vcol_bytes());
+                } else {
+                    data.emplace_back (m->vnorm_base64(), m->vnorm_bytes());
+                }
+            }
+            for (const auto& n : l.nodes) {
+                if (!n.instanced) { continue; }
+                const std::vector<float> t = this->gltf_instance_translations (l, n, false);
+                std::vector<std::uint8_t> tb (t.size() * sizeof (float));
+                std::memcpy (tb.data(), t.data(), tb.size());
+                data.emplace_back (base64::encode (tb), tb.size());
             }
-            fout << "  ],\n";
 
             fout << "  \"buffers\" : [\n";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                // indices
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->indices_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->indices_bytes() << "},\n";
-                // pos
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vpos_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vpos_bytes() << "},\n";
-                // col
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vcol_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vcol_bytes() << "},\n";
-                // norm
-                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << this->vm[vmi]->vnorm_base64() << "\", "
-                     << "\"byteLength\" : " << this->vm[vmi]->vnorm_bytes() << "}";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+            for (std::size_t bi = 0u; bi < data.size(); ++bi) {
+                fout << "    {\"uri\" : \"data:application/octet-stream;base64," << data[bi].first << "\", "
+                     << "\"byteLength\" : " << data[bi].second << "}" << (bi < data.size()-1 ? ",\n" : "\n");
             }
             fout << "  ],\n";
 
             fout << "  \"bufferViews\" : [\n";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                // indices
+            for (std::size_t bi = 0u; bi < data.size(); ++bi) {
                 fout << "    { ";
-                fout << "\"buffer\" : " << vmi*4 << ", ";
+                fout << "\"buffer\" : " << bi << ", ";
                 fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->indices_bytes() << ", ";
-                fout << "\"target\" : 34963 ";
-                fout << " },\n";
-                // vpos
-                fout << "    { ";
-                fout << "\"buffer\" : " << 1+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vpos_bytes() << ", ";
-                fout << "\"target\" : 34962 ";
-                fout << " },\n";
-                // vcol
-                fout << "    { ";
-                fout << "\"buffer\" : " << 2+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vcol_bytes() << ", ";
-                fout << "\"target\" : 34962 ";
-                fout << " },\n";
-                // vnorm
-                fout << "    { ";
-                fout << "\"buffer\" : " << 3+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"byteLength\" : " << this->vm[vmi]->vnorm_bytes() << ", ";
-                fout << "\"target\" : 34962 ";
-                fout << " }";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+                fout << "\"byteLength\" : " << data[bi].second;
+                // Instance translations are not vertex attributes, so they have no target
+                if (bi < na) { fout << ", \"target\" : " << (l.arrays[bi][0] == 0 ? 34963 : 34962); }
+                fout << " }" << (bi < data.size()-1 ? ",\n" : "\n");
             }
             fout << "  ],\n";
 
             fout << "  \"accessors\" : [\n";
-            for (std::size_t vmi = 0u; vmi < this->vm.size(); ++vmi) {
-                this->vm[vmi]->computeVertexMaxMins();
-                // indices
-                fout << "    { ";
-                fout << "\"bufferView\" : " << vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                // 5123 unsigned short, 5121 unsigned byte, 5125 unsigned int, 5126 float:
-                fout << "\"componentType\" : 5125, ";
-                fout << "\"type\" : \"SCALAR\", ";
-                fout << "\"count\" : " << this->vm[vmi]->indices_size();
-                fout << "},\n";
-                // vpos
-                fout << "    { ";
-                fout << "\"bufferView\" : " << 1+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"componentType\" : 5126, ";
-                fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vpos_size()/3;
-                // vertex position requires max/min to be specified in the gltf format
-                fout << ", \"max\" : " << this->vm[vmi]->vpos_max() << ", ";
-                fout << "\"min\" : " << this->vm[vmi]->vpos_min();
-                fout << " },\n";
-                // vcol
-                fout << "    { ";
-                fout << "\"bufferView\" : " << 2+vmi*4 << ", ";
-                fout << "\"byteOffset\" : 0, ";
-                fout << "\"componentType\" : 5126, ";
-                fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vcol_size()/3;
-                fout << "},\n";
-                // vnorm
+            for (std::size_t bi = 0u; bi < data.size(); ++bi) {
                 fout << "    { ";
-                fout << "\"bufferView\" : " << 3+vmi*4 << ", ";
+                fout << "\"bufferView\" : " << bi << ", ";
                 fout << "\"byteOffset\" : 0, ";
-                fout << "\"componentType\" : 5126, ";
-                fout << "\"type\" : \"VEC3\", ";
-                fout << "\"count\" : " << this->vm[vmi]->vnorm_size()/3;
-                fout << "}";
-                fout << (vmi < this->vm.size()-1 ? ",\n" : "\n");
+                if (bi < na && l.arrays[bi][0] == 0) {
+                    // 5123 unsigned short, 5121 unsigned byte, 5125 unsigned int, 5126 float:
+                    fout << "\"componentType\" : 5125, ";
+                    fout << "\"type\" : \"SCALAR\", ";
+                    fout << "\"count\" : " << this->vm[l.arrays[bi][1]]->indices_size();
+                } else {
+                    fout << "\"componentType\" : 5126, ";
+                    fout << "\"type\" : \"VEC3\", ";
+                    fout << "\"count\" : " << data[bi].second / (3 * sizeof (float));
+                    // vertex position requires max/min to be specified in the gltf format
+                    if (bi < na && l.arrays[bi][0] == 1) {
+                        fout << ", \"max\" : " << this->vm[l.arrays[bi][1]]->vpos_max() << ", ";
+                        fout << "\"min\" : " << this->vm[l.arrays[bi][1]]->vpos_min();
+                    }
+                }
+                fout << " }" << (bi < data.size()-1 ? ",\n" : "\n");
+            }
+            fout << "  ],\n";
+        }
+
+        /*!
+         * Save all the VisualModels in this Visual out to a GLTF format file. If gltf_file ends
+         * in .glb, save a binary glTF file with saveglb() instead. Repeated geometry is written
+         * once (see gltf_layout and gltf_instancing).
+         */
+        virtual void savegltf (const std::string& gltf_file)
+        {
+            if (gltf_file.size() > 4 && gltf_file.compare (gltf_file.size() - 4, 4, ".glb") == 0) {
+                this->saveglb (gltf_file);
+                return;
+            }
+            restored_vertices rv (this->vm);
+            const gltf_layout l = this->make_gltf_layout();
+            std::ofstream fout;
+            fout.open (gltf_file, std::ios::out|std::ios::trunc);
+            if (!fout.is_open()) { throw std::runtime_error ("Visual::savegltf(): Failed to open file for writing"); }
+            fout << "{\n  \"scenes\" : [ { \"nodes\" : [ ";
+            for (std::size_t ni = 0u; ni < l.nodes.size(); ++ni) {
+                fout << ni << (ni < l.nodes.size()-1 ? ", " : "");
+            }
+            fout << " ] } ],\n";
+            if (l.n_instanced > 0u) {
+                fout << "  \"extensionsUsed\" : [ \"EXT_mesh_gpu_instancing\" ],\n"
+                     << "  \"extensionsRequired\" : [ \"EXT_mesh_gpu_instancing\" ],\n";
             }
+
+            fout << "  \"nodes\" : [\n";
+            this->gltf_write_nodes (fout, l);
+            fout << "  ],\n";
+
+            fout << "  \"meshes\" : [\n";
+            this->gltf_write_meshes (fout, l);
             fout << "  ],\n";
 
+            this->gltf_write_buffers (fout, l);
+
             // Default material is single sided, so make it double sided
             fout << "  \"materials\" : [ { \"doubleSided\" : true } ],\n";
 
@@ -899,6 +1859,193 @@ namespace morph {
             fout.close();
         }
 
+        /*!
+         * Save all the VisualModels in this Visual out to a binary glTF (GLB) file. The vertex
+         * arrays are streamed straight into the file's binary chunk, rather than base64
+         * encoded into the JSON as by savegltf(). Repeated geometry is written once, as by
+         * savegltf().
+         *
+         * If quantised, the models are written with the KHR_mesh_quantization extension:
+         * positions as shorts (the node's scale and translation restore them), normals as
+         * normalized bytes, colours as normalized unsigned bytes and, where they fit, indices
+         * as unsigned shorts. This about halves the file size for a small, bounded error: a
+         * position moves by at most 1/131068 of its model's largest extent.
+         */
+        virtual void saveglb (const std::string& glb_file, const bool quantised = false)
+        {
+            if constexpr (std::endian::native != std::endian::little) {
+                throw std::runtime_error ("Visual::saveglb(): GLB output is only implemented on little endian systems");
+            }
+            restored_vertices rv (this->vm);
+            const gltf_layout l = this->make_gltf_layout();
+            // Every buffer view starts on a 4 byte boundary
+            auto pad4 = [](const std::size_t n) { return (n + 3u) & ~std::size_t{3}; };
+            const std::size_t na = l.arrays.size();
+
+            // The translations of the instanced nodes
+            std::vector<std::vector<float>> tr;
+            for (const auto& n : l.nodes) {
+                if (n.instanced) { tr.push_back (this->gltf_instance_translations (l, n, quantised)); }
+            }
+            const std::size_t nbv = na + tr.size();
+
+            // Lay out the binary chunk: the arrays, then the instance translations
+            std::vector<std::size_t> vlen (nbv);
+            std::vector<std::size_t> voff (nbv);
+            std::size_t binlen = 0u;
+            for (std::size_t bi = 0u; bi < nbv; ++bi) {
+                if (bi < na) {
+                    const std::size_t k = l.arrays[bi][0];
+                    auto& m = this->vm[l.arrays[bi][1]];
+                    if (k == 1) { m->computeVertexMaxMins(); }
+                    const std::size_t nv = m->vpos_size() / 3;
+                    vlen[bi] = k == 0 ? m->indices_bytes (quantised)
+                    : nv * (k == 1 ? VisualModel<glver>::vpos_stride (quantised)
+                            : (k == 2 ? VisualModel<glver>::vcol_stride (quantised) : VisualModel<glver>::vnorm_stride (quantised)));
+                } else {
+                    vlen[bi] = tr[bi - na].size() * sizeof (float);
+                }
+                voff[bi] = binlen;
+                binlen += pad4 (vlen[bi]);
+            }
+
+            std::stringstream js;
+            js << "{\"scenes\":[{\"nodes\":[";
+            for (std::size_t ni = 0u; ni < l.nodes.size(); ++ni) { js << ni << (ni < l.nodes.size() - 1 ? "," : ""); }
+            js << "]}],";
+            if (quantised || !tr.empty()) {
+                std::string ext;
+                if (quantised) { ext += "\"KHR_mesh_quantization\""; }
+                if (!tr.empty()) { ext += (quantised ? ",\"EXT_mesh_gpu_instancing\"" : "\"EXT_mesh_gpu_instancing\""); }
+                js << "\"extensionsUsed\":[" << ext << "],\"extensionsRequired\":[" << ext << "],";
+            }
+
+            js << "\"nodes\":[";
+            std::size_t tacc = na;
+            for (std::size_t ni = 0u; ni < l.nodes.size(); ++ni) {
+                const auto& n = l.nodes[ni];
+                js << "{\"mesh\":" << n.mesh;
+                if (n.instanced) {
+                    js << ",\"extensions\":{\"EXT_mesh_gpu_instancing\":{\"attributes\":{\"TRANSLATION\":" << tacc++ << "}}}";
+                } else if (quantised) {
+                    const vec<float> qc = this->vm[l.position_model (n.mesh)]->vpos_qcentre();
+                    js << ",\"translation\":" << (this->vm[n.model]->get_mv_offset() + qc).str_mat();
+                } else {
+                    js << ",\"translation\":" << this->vm[n.model]->translation_str();
+                }
+                if (quantised) {
+                    // The positions of a shared mesh are those of (and quantised by) its position_model()
+                    const float s = this->vm[l.position_model (n.mesh)]->vpos_qscale();
+                    js << ",\"scale\":" << morph::vec<float>{ s, s, s }.str_mat();
+                }
+                js << "}" << (ni < l.nodes.size() - 1 ? "," : "");
+            }
+            js << "],";
+
+            js << "\"meshes\":[";
+            for (std::size_t mi = 0u; mi < l.meshes.size(); ++mi) {
+                const std::array<std::size_t, 4>& a = l.meshes[mi];
+                js << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << a[1] << ",\"COLOR_0\":" << a[2]
+                   << ",\"NORMAL\":" << a[3] << "},\"indices\":" << a[0] << ",\"material\":0}]}"
+                   << (mi < l.meshes.size() - 1 ? "," : "");
+            }
+            js << "],";
+
+            js << "\"buffers\":[{\"byteLength\":" << binlen << "}],";
+
+            js << "\"bufferViews\":[";
+            for (std::size_t bi = 0u; bi < nbv; ++bi) {
+                js << "{\"buffer\":0,\"byteOffset\":" << voff[bi] << ",\"byteLength\":" << vlen[bi];
+                // Instance translations are not vertex attributes, so they have no target
+                if (bi < na) {
+                    const std::size_t k = l.arrays[bi][0];
+                    // Quantised vertex attributes are padded, so they need a stride
+                    if (quantised && k > 0) {
+                        js << ",\"byteStride\":" << (k == 1 ? VisualModel<glver>::vpos_stride (true) : std::size_t{4});
+                    }
+                    js << ",\"target\":" << (k == 0 ? 34963 : 34962);
+                }
+                js << "}" << (bi < nbv - 1 ? "," : "");
+            }
+            js << "],";
+
+            js << "\"accessors\":[";
+            for (std::size_t bi = 0u; bi < nbv; ++bi) {
+                // 5120 byte, 5121 unsigned byte, 5122 short, 5123 unsigned short, 5125 unsigned int, 5126 float
+                if (bi >= na) {
+                    js << "{\"bufferView\":" << bi << ",\"componentType\":5126,\"type\":\"VEC3\",\"count\":" << tr[bi - na].size() / 3 << "}";
+                } else {
+                    const std::size_t k = l.arrays[bi][0];
+                    auto& m = this->vm[l.arrays[bi][1]];
+                    const std::size_t nv = m->vpos_size() / 3;
+                    if (k == 0) {
+                        const bool short_idx = quantised && m->indices_fit_short();
+                        js << "{\"bufferView\":" << bi << ",\"componentType\":" << (short_idx ? 5123 : 5125)
+                           << ",\"type\":\"SCALAR\",\"count\":" << m->indices_size() << "}";
+                    } else if (k == 1) {
+                        js << "{\"bufferView\":" << bi << ",\"componentType\":" << (quantised ? 5122 : 5126)
+                           << ",\"type\":\"VEC3\",\"count\":" << nv;
+                        // vertex position requires max/min to be specified in the gltf format
+                        if (quantised) {
+                            js << ",\"max\":" << m->vpos_qmax_str() << ",\"min\":" << m->vpos_qmin_str() << "}";
+                        } else {
+                            js << ",\"max\":" << m->vpos_max() << ",\"min\":" << m->vpos_min() << "}";
+                        }
+                    } else if (k == 2) {
+                        js << "{\"bufferView\":" << bi << ",\"componentType\":" << (quantised ? 5121 : 5126)
+                           << (quantised ? ",\"normalized\":true" : "") << ",\"type\":\"VEC3\",\"count\":" << nv << "}";
+                    } else {
+                        js << "{\"bufferView\":" << bi << ",\"componentType\":" << (quantised ? 5120 : 5126)
+                           << (quantised ? ",\"normalized\":true" : "") << ",\"type\":\"VEC3\",\"count\":" << nv << "}";
+                    }
+                }
+                js << (bi < nbv - 1 ? "," : "");
+            }
+            js << "],";
+
+            // Default material is single sided, so make it double sided
+            js << "\"materials\":[{\"doubleSided\":true}],";
+            js << "\"asset\":{\"generator\":\"https://github.com/ABRG-Models/morphologica: morph::Visual::saveglb() (ver "
+               << morph::version_string() << ")\",\"version\":\"2.0\"}}";
+
+            std::string json = js.str();
+            json.resize (pad4 (json.size()), ' ');
+            const std::size_t total = 12u + 8u + json.size() + 8u + binlen;
+            if (total > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error ("Visual::saveglb(): The scene is too large for a GLB file (4 GB)");
+            }
+
+            std::ofstream fout;
+            fout.open (glb_file, std::ios::out|std::ios::trunc|std::ios::binary);
+            if (!fout.is_open()) { throw std::runtime_error ("Visual::saveglb(): Failed to open file for writing"); }
+            auto put32 = [&fout](const std::uint32_t v) { fout.write (reinterpret_cast<const char*>(&v), sizeof (v)); };
+            put32 (0x46546C67u); // "glTF"
+            put32 (2u);
+            put32 (static_cast<std::uint32_t>(total));
+            put32 (static_cast<std::uint32_t>(json.size()));
+            put32 (0x4E4F534Au); // "JSON"
+            fout.write (json.data(), json.size());
+            put32 (static_cast<std::uint32_t>(binlen));
+            put32 (0x004E4942u); // "BIN"
+            const char zeros[4] = { 0, 0, 0, 0 };
+            for (std::size_t bi = 0u; bi < nbv; ++bi) {
+                if (bi >= na) {
+                    fout.write (reinterpret_cast<const char*>(tr[bi - na].data()), vlen[bi]);
+                } else {
+                    auto& m = this->vm[l.arrays[bi][1]];
+                    switch (l.arrays[bi][0]) {
+                    case 0: m->write_indices (fout, quantised); break;
+                    case 1: m->write_vpos (fout, quantised); break;
+                    case 2: m->write_vcol (fout, quantised); break;
+                    default: m->write_vnorm (fout, quantised); break;
+                    }
+                }
+                fout.write (zeros, pad4 (vlen[bi]) - vlen[bi]);
+            }
+            if (!fout) { throw std::runtime_error ("Visual::saveglb(): Failed to write the file"); }
+            fout.close();
+        }
+
         void set_winsize (int _w, int _h) { this->window_w = _w; this->window_h = _h; }
 
     protected:
@@ -974,6 +2121,25 @@ namespace morph {
 #endif
 
     protected:
+        /*!
+         * The shader program called \a name from this Visual's share group. The first member of
+         * the group to ask compiles it from \a progs (in its own context, which the others
+         * share), or loads its binary from morph::gl::program_cache_dir() if that is set.
+         */
+        GLuint shared_program (const std::string& name, const std::vector<morph::gl::ShaderInfo>& progs)
+        {
+            GLuint prog = morph::VisualResources<glver>::i().get_program (this, name);
+            if (prog == 0) {
+#ifdef GLAD_OPTION_GL_MX
+                prog = morph::gl::LoadShadersCached (progs, this->glfn);
+#else
+                prog = morph::gl::LoadShadersCached (progs);
+#endif
+                morph::VisualResources<glver>::i().set_program (this, name, prog);
+            }
+            return prog;
+        }
+
         // Initialize OpenGL shaders, set some flags (Alpha, Anti-aliasing), read in any external
         // state from json, and set up the coordinate arrows and any VisualTextModels that will be
         // required to render the Visual.
@@ -999,11 +2165,7 @@ namespace morph {
                 {GL_VERTEX_SHADER, "Visual.vert.glsl", morph::getDefaultVtxShader(glver), 0 },
                 {GL_FRAGMENT_SHADER, "Visual.frag.glsl", morph::getDefaultFragShader(glver), 0 }
             };
-            this->shaders.gprog = morph::gl::LoadShaders (this->proj2d_shader_progs
-#ifdef GLAD_OPTION_GL_MX
-                                                          , this->glfn
-#endif
-                );
+            this->shaders.gprog = this->shared_program ("projection2d", this->proj2d_shader_progs);
             this->active_gprog = morph::visgl::graphics_shader_type::projection2d;
 
             // Alternative cylindrical shader for possible later use. (NB: not loaded immediately)
@@ -1017,11 +2179,8 @@ namespace morph {
                 {GL_VERTEX_SHADER, "VisText.vert.glsl", morph::getDefaultTextVtxShader(glver), 0 },
                 {GL_FRAGMENT_SHADER, "VisText.frag.glsl" , morph::getDefaultTextFragShader(glver), 0 }
             };
-            this->shaders.tprog = morph::gl::LoadShaders (this->text_shader_progs
-#ifdef GLAD_OPTION_GL_MX
-                                                          , this->glfn
-#endif
-                );
+            this->shaders.tprog = this->shared_program ("text", this->text_shader_progs);
+            this->cacheUniformLocations();
 
             // OpenGL options
 #ifdef GLAD_OPTION_GL_MX
@@ -1085,6 +2244,88 @@ namespace morph {
         }
 
     protected:
+        //! Gather frame_profile from this frame, begun at t_frame, and reset the models' counters
+        void collect_profile (const std::chrono::steady_clock::time_point t_frame)
+        {
+            using ms = std::chrono::duration<double, std::milli>;
+            frame_profile_t& p = this->frame_profile;
+            p.frame_ms = ms (std::chrono::steady_clock::now() - t_frame).count();
+            p.interval_ms = this->profile_last_frame == std::chrono::steady_clock::time_point{} ? 0.0
+            : ms (t_frame - this->profile_last_frame).count();
+            this->profile_last_frame = t_frame;
+            p.gpu_ms = p.build_ms = p.upload_ms = 0.0;
+            p.draw_calls = 0;
+            p.vertices = p.upload_bytes = 0;
+            p.models.resize (this->vm.size());
+            for (std::size_t i = 0; i < this->vm.size(); ++i) {
+                typename morph::VisualModel<glver>::profile_counters& c = this->vm[i]->profile;
+                p.models[i] = c;
+                if (c.draw_calls == 0) { p.models[i].gpu_ms = 0.0; }
+                p.gpu_ms += p.models[i].gpu_ms;
+                p.build_ms += c.build_ms;
+                p.upload_ms += c.upload_ms;
+                p.draw_calls += c.draw_calls;
+                p.vertices += c.vertices;
+                p.upload_bytes += c.upload_bytes;
+                // The GPU time is kept until the next query result replaces it
+                const double gpu_ms = c.gpu_ms;
+                c = typename morph::VisualModel<glver>::profile_counters{};
+                c.gpu_ms = gpu_ms;
+            }
+            // Accumulate for the overlay, which shows the mean over profile_overlay_interval
+            frame_profile_t& a = this->profile_accum;
+            a.frame_ms += p.frame_ms;
+            a.interval_ms += p.interval_ms;
+            a.gpu_ms += p.gpu_ms;
+            a.build_ms += p.build_ms;
+            a.upload_ms += p.upload_ms;
+            a.draw_calls += p.draw_calls;
+            a.vertices += p.vertices;
+            a.upload_bytes += p.upload_bytes;
+            ++this->profile_accum_frames;
+        }
+
+        //! Draw the profile summary, refreshing its text every profile_overlay_interval. The text
+        //! shader program must be in use.
+        void render_profile_overlay()
+        {
+            if (this->profile_text == nullptr) {
+                this->profile_text = std::make_unique<morph::VisualTextModel<glver>> (morph::TextFeatures (0.015f, 32));
+                this->bindmodel (this->profile_text);
+                this->profile_text->setSceneTranslation ({0.0f, 0.0f, 0.0f});
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now - this->profile_text_time >= profile_overlay_interval && this->profile_accum_frames > 0) {
+                frame_profile_t mean = this->profile_accum;
+                const unsigned int n = this->profile_accum_frames;
+                mean.frame_ms /= n;
+                mean.interval_ms /= n;
+                mean.gpu_ms /= n;
+                mean.build_ms /= n;
+                mean.upload_ms /= n;
+                mean.draw_calls /= n;
+                mean.vertices /= n;
+                mean.upload_bytes /= n;
+                mean.models = this->frame_profile.models;
+                this->profile_text->setupText (profile_summary (mean));
+                this->profile_accum = frame_profile_t{};
+                this->profile_accum_frames = 0;
+                this->profile_text_time = now;
+            }
+            this->profile_text->setSceneTranslation (this->textPosition (this->profile_offset));
+            this->profile_text->setVisibleOn (this->bgcolour);
+            this->profile_text->render (true);
+        }
+
+        //! The text of the profile overlay, and its refresh interval
+        std::unique_ptr<morph::VisualTextModel<glver>> profile_text = nullptr;
+        static constexpr std::chrono::milliseconds profile_overlay_interval { 500 };
+        std::chrono::steady_clock::time_point profile_text_time = {};
+        //! The start of the last frame, and the sums of frame profiles since the overlay was refreshed
+        std::chrono::steady_clock::time_point profile_last_frame = {};
+        frame_profile_t profile_accum;
+        unsigned int profile_accum_frames = 0;
+
         //! The window (and OpenGL context) for this Visual
         morph::win_t* window = nullptr;
 
@@ -1400,6 +2641,7 @@ namespace morph {
 
             this->key_callback_extra (_key, scancode, action, mods);
 
+            if (needs_render) { this->adaptive_resolution.interacted(); }
             return needs_render;
         }
 
@@ -1514,6 +2756,7 @@ namespace morph {
                 needs_render = true; // updates viewproj; uses this->scenetrans
             }
 
+            if (needs_render) { this->adaptive_resolution.interacted(); }
             return needs_render;
         }
 
@@ -1593,6 +2836,7 @@ namespace morph {
                 sceneview_rotn.rotate (this->rotation);
                 this->cyl_cam_pos += sceneview_rotn * scroll_move_y;
             }
+            this->adaptive_resolution.interacted();
             return true; // needs_render
         }
 
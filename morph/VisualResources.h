@@ -4,6 +4,11 @@
  * Declares a VisualResource class to hold the information about Freetype and any other
  * one-per-program resources.
  *
+ * Resources are held per share group. A share group is one Visual, or several Visuals whose
+ * OpenGL contexts share objects (see the Visual constructor that takes a Visual to share
+ * with). The members of a group use the same font faces (and their glyph textures) and the same
+ * compiled shader programs. These are released when the group's last member is destroyed.
+ *
  * \author Seb James
  * \date November 2020
  */
@@ -13,11 +18,16 @@
 #include <iostream>
 #include <tuple>
 #include <set>
+#include <map>
+#include <string>
+#include <sstream>
+#include <vector>
 #include <stdexcept>
 #include <memory>
 #include <morph/gl/version.h>
 #include <morph/gl/util.h>
 #include <morph/VisualFace.h>
+#include <morph/memory_usage.h>
 #include <morph/VisualFont.h>
 // FreeType for text rendering
 #include <ft2build.h>
@@ -52,12 +62,35 @@ namespace morph {
 
         //! The collection of VisualFaces generated for this instance of the
         //! application. Create one VisualFace for each unique combination of VisualFont
-        //! and fontpixels (the texture resolution)
-        std::map<std::tuple<morph::VisualFont, unsigned int, morph::VisualOwnable<glver>*>,
+        //! and fontpixels (the texture resolution) in each share group
+        std::map<std::tuple<morph::VisualFont, unsigned int, unsigned int>,
                  std::unique_ptr<morph::visgl::VisualFace>> faces;
 
-        //! FreeType library object, public for access by client code?
-        std::map<morph::VisualOwnable<glver>*, FT_Library> freetypes;
+        //! FreeType library objects, one for each share group
+        std::map<unsigned int, FT_Library> freetypes;
+
+        //! The share group of each VisualOwnable. Groups are numbered from 1.
+        std::map<morph::VisualOwnable<glver>*, unsigned int> groups;
+        unsigned int next_group = 1;
+
+        //! The shader programs compiled in each share group, by name
+        std::map<unsigned int, std::map<std::string, GLuint>> programs;
+
+        //! The share group of _vis, or 0 if it has none
+        unsigned int group_of (morph::VisualOwnable<glver>* _vis) const
+        {
+            auto g = this->groups.find (_vis);
+            return g == this->groups.end() ? 0u : g->second;
+        }
+
+        //! True if _vis is the only remaining member of its share group
+        bool last_in_group (morph::VisualOwnable<glver>* _vis) const
+        {
+            const unsigned int g = this->group_of (_vis);
+            unsigned int n = 0;
+            for (const auto& m : this->groups) { n += m.second == g ? 1 : 0; }
+            return n == 1;
+        }
 
     public:
         VisualResources(const VisualResources<glver>&) = delete;
@@ -65,52 +98,116 @@ namespace morph {
         VisualResources(VisualResources<glver> &&) = delete;
         VisualResources & operator=(VisualResources<glver> &&) = delete;
 
+        /*!
+         * Add _vis to the share group of \a share_with (whose GL context must share objects with
+         * that of _vis) or, if \a share_with is nullptr, to a new group of its own. Call before
+         * freetype_init. A VisualOwnable that is already in a group is left where it is.
+         */
+        void join_share_group (morph::VisualOwnable<glver>* _vis, morph::VisualOwnable<glver>* share_with = nullptr)
+        {
+            if (this->group_of (_vis) != 0) { return; }
+            if (share_with == nullptr) {
+                this->groups[_vis] = this->next_group++;
+            } else {
+                const unsigned int g = this->group_of (share_with);
+                if (g == 0) { throw std::runtime_error ("VisualResources: The Visual to share with has no share group"); }
+                this->groups[_vis] = g;
+            }
+        }
+
+        //! True if _vis and _other are in the same share group
+        bool shares (morph::VisualOwnable<glver>* _vis, morph::VisualOwnable<glver>* _other) const
+        {
+            const unsigned int g = this->group_of (_vis);
+            return g != 0 && g == this->group_of (_other);
+        }
+
+        //! The shader program called \a name in the share group of \a _vis, or 0 if the group has
+        //! not yet compiled it
+        GLuint get_program (morph::VisualOwnable<glver>* _vis, const std::string& name) const
+        {
+            auto g = this->programs.find (this->group_of (_vis));
+            if (g == this->programs.end()) { return 0; }
+            auto p = g->second.find (name);
+            return p == g->second.end() ? 0 : p->second;
+        }
+
+        //! Record \a prog as the program called \a name for the share group of \a _vis
+        void set_program (morph::VisualOwnable<glver>* _vis, const std::string& name, const GLuint prog)
+        {
+            this->programs[this->group_of (_vis)][name] = prog;
+        }
+
+        /*!
+         * If _vis is the last member of its share group, forget the group's shader programs and
+         * return them, so that the caller can delete them in its GL context. Otherwise return
+         * nothing, as the other members still use them.
+         */
+        std::vector<GLuint> release_programs (morph::VisualOwnable<glver>* _vis)
+        {
+            std::vector<GLuint> rtn;
+            const unsigned int g = this->group_of (_vis);
+            if (g == 0 || !this->last_in_group (_vis)) { return rtn; }
+            auto gp = this->programs.find (g);
+            if (gp != this->programs.end()) {
+                for (auto p : gp->second) { if (p.second) { rtn.push_back (p.second); } }
+                this->programs.erase (gp);
+            }
+            return rtn;
+        }
+
         //! Initialize a freetype library instance and add to this->freetypes. I wanted
         //! to have only a single freetype library instance, but this didn't work, so I
         //! create one FT_Library for each OpenGL context (i.e. one for each morph::Visual
-        //! window). Thus, arguably, the FT_Library should be a member of morph::Visual,
-        //! but that's a task for the future, as I coded it this way under the false
-        //! assumption that I'd only need one FT_Library.
+        //! window), or rather for each share group of contexts. Thus, arguably, the
+        //! FT_Library should be a member of morph::Visual, but that's a task for the future,
+        //! as I coded it this way under the false assumption that I'd only need one
+        //! FT_Library. (If _vis has not joined a share group, it joins a group of its own.)
         void freetype_init (morph::VisualOwnable<glver>* _vis
 #ifdef GLAD_OPTION_GL_MX
                             , GladGLContext* glfn = nullptr
 #endif
             )
         {
-            FT_Library freetype = nullptr;
-            try {
-                freetype = this->freetypes.at (_vis);
-            } catch (const std::out_of_range&) {
-                // Use of gl calls here may make it neat to set up GL here in VisualResources?
+            this->join_share_group (_vis);
+            // Pixel storage is context state, so is set for every member of a group
 #ifdef GLAD_OPTION_GL_MX
-                glfn->PixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
-                morph::gl::Util::checkError (__FILE__, __LINE__, glfn);
+            glfn->PixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+            morph::gl::Util::checkError (__FILE__, __LINE__, glfn);
 #else
-                glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
-                morph::gl::Util::checkError (__FILE__, __LINE__);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+            morph::gl::Util::checkError (__FILE__, __LINE__);
 #endif
-
+            const unsigned int g = this->group_of (_vis);
+            if (this->freetypes.count (g) == 0) {
+                FT_Library freetype = nullptr;
                 if (FT_Init_FreeType (&freetype)) {
                     std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
                 } else {
                     // Successfully initialized freetype
-                    this->freetypes[_vis] = freetype;
+                    this->freetypes[g] = freetype;
                 }
             }
         }
 
-        //! When a morph::Visual goes out of scope, its freetype library instance should be
-        //! deinitialized.
+        //! When a morph::Visual goes out of scope, it leaves its share group. If it was the
+        //! last member, the group's faces and freetype library instance are deinitialized.
         void freetype_deinit (morph::VisualOwnable<glver>* _vis)
         {
-            // First clear the faces associated with VisualOwnable<>* _vis
-            this->clearVisualFaces (_vis);
-            // Second, clean up the FreeType library instance and erase from this->freetypes
-            auto freetype = this->freetypes.find (_vis);
-            if (freetype != this->freetypes.end()) {
-                FT_Done_FreeType (freetype->second);
-                this->freetypes.erase (freetype);
+            const unsigned int g = this->group_of (_vis);
+            if (g == 0) { return; }
+            if (this->last_in_group (_vis)) {
+                // First clear the faces associated with the group
+                this->clearVisualFaces (_vis);
+                // Second, clean up the FreeType library instance and erase from this->freetypes
+                auto freetype = this->freetypes.find (g);
+                if (freetype != this->freetypes.end()) {
+                    FT_Done_FreeType (freetype->second);
+                    this->freetypes.erase (freetype);
+                }
+                this->programs.erase (g);
             }
+            this->groups.erase (_vis);
         }
 
         //! The instance public function. Uses the very short name 'i' to keep code tidy.
@@ -125,7 +222,8 @@ namespace morph {
         void create() {}
 
         //! Return a pointer to a VisualFace for the given \a font at the given texture
-        //! resolution, \a fontpixels and the given window (i.e. OpenGL context) \a _win.
+        //! resolution, \a fontpixels and the share group of the given window (i.e. OpenGL
+        //! context) \a _vis.
         morph::visgl::VisualFace* getVisualFace (morph::VisualFont font, unsigned int fontpixels, morph::VisualOwnable<glver>* _vis
 #ifdef GLAD_OPTION_GL_MX
                                                  , GladGLContext* glfn
@@ -133,11 +231,12 @@ namespace morph {
             )
         {
             morph::visgl::VisualFace* rtn = nullptr;
-            auto key = std::make_tuple(font, fontpixels, _vis);
+            const unsigned int g = this->group_of (_vis);
+            auto key = std::make_tuple(font, fontpixels, g);
             try {
                 rtn = this->faces.at(key).get();
             } catch (const std::out_of_range&) {
-                this->faces[key] = std::make_unique<morph::visgl::VisualFace> (font, fontpixels, this->freetypes.at(_vis)
+                this->faces[key] = std::make_unique<morph::visgl::VisualFace> (font, fontpixels, this->freetypes.at(g)
 #ifdef GLAD_OPTION_GL_MX
                                                                                , glfn
 #endif
@@ -159,17 +258,33 @@ namespace morph {
         }
 #endif
 
-        //! Loop through this->faces clearing out those associated with the given morph::Visual
+        //! Loop through this->faces clearing out those associated with the share group of the
+        //! given morph::Visual
         void clearVisualFaces (morph::VisualOwnable<glver>* _vis)
         {
+            const unsigned int g = this->group_of (_vis);
             auto f = this->faces.begin();
             while (f != this->faces.end()) {
-                // f->first is a key. If its third, Visual<>* element == _vis, then delete and erase
-                if (std::get<morph::VisualOwnable<glver>*>(f->first) == _vis) {
+                // f->first is a key. If its third, group element == g, then delete and erase
+                if (std::get<2>(f->first) == g) {
                     f = this->faces.erase (f);
                 } else { f++; }
             }
         }
+
+        //! The memory held by the faces in the share group of _vis (which all its members use)
+        morph::memory_usage faces_memory_usage (morph::VisualOwnable<glver>* _vis) const
+        {
+            morph::memory_usage mu ("fonts");
+            const unsigned int g = this->group_of (_vis);
+            for (const auto& f : this->faces) {
+                if (std::get<2>(f.first) != g) { continue; }
+                std::stringstream ss;
+                ss << "font " << static_cast<int>(std::get<0>(f.first)) << " at " << std::get<1>(f.first) << " px";
+                mu.add (f.second->memory_usage (ss.str()));
+            }
+            return mu;
+        }
     };
 
 } // namespace morph
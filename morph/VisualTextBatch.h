@@ -0,0 +1,277 @@
+/*!
+ * \file
+ *
+ * Declares VisualTextBatch, which draws all the VisualTextModels of a VisualModel from one
+ * vertex buffer, with one draw call for each combination of glyph atlas page, colour and alpha.
+ *
+ * \author Seb James
+ * \date 2025
+ */
+
+#pragma once
+
+#if defined __gl3_h_ || defined __gl_h_
+// GL headers have been externally included
+#else
+# error "GL headers should have been included already"
+#endif
+
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/VisualCommon.h>
+#include <morph/VisualTextModel.h>
+#include <morph/mat44.h>
+#include <morph/vec.h>
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <tuple>
+#include <cstddef>
+
+namespace morph {
+
+    /*!
+     * A batch of the VisualTextModels that belong to one VisualModel.
+     *
+     * Each VisualTextModel has its own model view matrix. The batch transforms every glyph quad
+     * by its text's model view matrix on the CPU and puts them all in one vertex buffer, sorted so
+     * that the quads that share an atlas page texture, a colour and an alpha are contiguous. Only
+     * one draw call is then needed for each such group (typically just one for a whole graph's
+     * tick labels), in place of one or more per text.
+     *
+     * The batch is rebuilt when a text is added, removed, changed, moved, hidden or recoloured.
+     * Updatable texts (see VisualTextModel::reserve) change too often for that, so they are left
+     * out of the batch and their VisualModel renders them one by one.
+     * Batching needs all the texts to share a scene matrix, which they do when they are moved with
+     * their VisualModel. If they do not, render() returns false and the texts should be rendered
+     * one by one.
+     */
+    template <int glver = morph::gl::version_4_1>
+    class VisualTextBatch
+    {
+    public:
+        VisualTextBatch() {}
+
+        ~VisualTextBatch()
+        {
+            if (this->vbos[0] == 0) { return; }
+#ifdef GLAD_OPTION_GL_MX
+            if (this->glfn == nullptr) { return; }
+            this->glfn->DeleteBuffers (3, this->vbos.data());
+            this->glfn->DeleteVertexArrays (1, &this->vao);
+#else
+            glDeleteBuffers (3, this->vbos.data());
+            glDeleteVertexArrays (1, &this->vao);
+#endif
+        }
+
+        VisualTextBatch (const VisualTextBatch&) = delete;
+        VisualTextBatch& operator= (const VisualTextBatch&) = delete;
+
+        /*!
+         * Render texts as a batch. Returns false, having drawn nothing, if they cannot be batched.
+         * If tprog_in_use is true, the caller has already made the text shader program current.
+         */
+        bool render (const std::vector<std::unique_ptr<morph::VisualTextModel<glver>>>& texts, const bool tprog_in_use)
+        {
+            // Find the first visible text; all the visible texts must share its scene matrix
+            const morph::VisualTextModel<glver>* t0 = nullptr;
+            for (const auto& t : texts) {
+                if (t->hide || t->updatable()) { continue; }
+                if (t0 == nullptr) {
+                    t0 = t.get();
+                } else if (t->scenematrix.mat != t0->scenematrix.mat) {
+                    return false;
+                }
+            }
+            if (t0 == nullptr) { return true; } // Nothing to draw
+
+            if (this->stale (texts)) { this->rebuild (texts); }
+
+            GLint prev_shader = 0;
+            const morph::visgl::visual_shaderprogs::uniform_locations locs = t0->get_shaderprogs(t0->parentVis).tprog_locs;
+            // The quads are already in their texts' model view frames
+            morph::mat44<float> identity;
+#ifdef GLAD_OPTION_GL_MX
+            GladGLContext* _glfn = this->glfn;
+            if (!tprog_in_use) {
+                _glfn->GetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+                _glfn->UseProgram (t0->get_tprog (t0->parentVis));
+            }
+            if (locs.v_matrix != -1) { _glfn->UniformMatrix4fv (locs.v_matrix, 1, GL_FALSE, t0->scenematrix.mat.data()); }
+            if (locs.m_matrix != -1) { _glfn->UniformMatrix4fv (locs.m_matrix, 1, GL_FALSE, identity.mat.data()); }
+            _glfn->ActiveTexture (GL_TEXTURE0);
+            _glfn->BindVertexArray (this->vao);
+            for (const auto& g : this->groups) {
+                if (locs.text_colour != -1) { _glfn->Uniform3f (locs.text_colour, g.clr[0], g.clr[1], g.clr[2]); }
+                if (locs.alpha != -1) { _glfn->Uniform1f (locs.alpha, g.alpha); }
+                _glfn->BindTexture (GL_TEXTURE_2D, g.texture);
+                _glfn->DrawElements (GL_TRIANGLES, 6 * g.count, GL_UNSIGNED_INT, (void*)(6 * g.first * sizeof(GLuint)));
+            }
+            _glfn->BindVertexArray (0);
+            if (!tprog_in_use) { _glfn->UseProgram (prev_shader); }
+            morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
+#else
+            if (!tprog_in_use) {
+                glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+                glUseProgram (t0->get_tprog (t0->parentVis));
+            }
+            if (locs.v_matrix != -1) { glUniformMatrix4fv (locs.v_matrix, 1, GL_FALSE, t0->scenematrix.mat.data()); }
+            if (locs.m_matrix != -1) { glUniformMatrix4fv (locs.m_matrix, 1, GL_FALSE, identity.mat.data()); }
+            glActiveTexture (GL_TEXTURE0);
+            glBindVertexArray (this->vao);
+            for (const auto& g : this->groups) {
+                if (locs.text_colour != -1) { glUniform3f (locs.text_colour, g.clr[0], g.clr[1], g.clr[2]); }
+                if (locs.alpha != -1) { glUniform1f (locs.alpha, g.alpha); }
+                glBindTexture (GL_TEXTURE_2D, g.texture);
+                glDrawElements (GL_TRIANGLES, 6 * g.count, GL_UNSIGNED_INT, (void*)(6 * g.first * sizeof(GLuint)));
+            }
+            glBindVertexArray (0);
+            if (!tprog_in_use) { glUseProgram (prev_shader); }
+            morph::gl::Util::checkError (__FILE__, __LINE__);
+#endif
+            return true;
+        }
+
+        //! The number of draw calls that the last render() made
+        std::size_t num_draws() const { return this->groups.size(); }
+
+    protected:
+        //! The state of a text when the batch was built
+        struct text_state
+        {
+            const void* ptr = nullptr;
+            unsigned int changes = 0;
+            bool hide = false;
+            std::array<float, 3> clr = { 0.0f, 0.0f, 0.0f };
+            float alpha = 1.0f;
+        };
+        //! A contiguous run of quads in the batch that share texture, colour and alpha
+        struct group
+        {
+            unsigned int texture = 0;
+            std::array<float, 3> clr = { 0.0f, 0.0f, 0.0f };
+            float alpha = 1.0f;
+            unsigned int first = 0;
+            unsigned int count = 0;
+        };
+
+        static text_state state_of (const morph::VisualTextModel<glver>& t)
+        {
+            return text_state{ &t, t.changes, t.hide, t.clr_text, t.alpha };
+        }
+
+        //! Has anything changed since the batch was built?
+        bool stale (const std::vector<std::unique_ptr<morph::VisualTextModel<glver>>>& texts) const
+        {
+            if (this->vao == 0 || texts.size() != this->built.size()) { return true; }
+            for (std::size_t i = 0; i < texts.size(); ++i) {
+                if (texts[i]->updatable()) { continue; }
+                text_state ts = state_of (*texts[i]);
+                const text_state& b = this->built[i];
+                if (ts.ptr != b.ptr || ts.changes != b.changes || ts.hide != b.hide
+                    || ts.clr != b.clr || ts.alpha != b.alpha) { return true; }
+            }
+            return false;
+        }
+
+        //! Rebuild the vertex buffers and the draw groups from texts
+        void rebuild (const std::vector<std::unique_ptr<morph::VisualTextModel<glver>>>& texts)
+        {
+            this->built.clear();
+            // Every visible quad, as (text index, quad index), sorted by its draw state
+            std::vector<std::pair<unsigned int, unsigned int>> order;
+            for (unsigned int i = 0; i < texts.size(); ++i) {
+                this->built.push_back (state_of (*texts[i]));
+                if (texts[i]->hide || texts[i]->updatable()) { continue; }
+                for (unsigned int q = 0; q < texts[i]->quads.size(); ++q) { order.push_back ({i, q}); }
+            }
+            auto key = [&texts](const std::pair<unsigned int, unsigned int>& o) {
+                const morph::VisualTextModel<glver>& t = *texts[o.first];
+                return std::make_tuple (t.quad_ids[o.second], t.clr_text, t.alpha);
+            };
+            std::stable_sort (order.begin(), order.end(),
+                              [&key](const auto& a, const auto& b) { return key (a) < key (b); });
+
+            std::vector<float> posn;
+            std::vector<float> tex;
+            std::vector<GLuint> idx;
+            posn.reserve (order.size() * 12);
+            tex.reserve (order.size() * 12);
+            idx.reserve (order.size() * 6);
+            this->groups.clear();
+            for (unsigned int n = 0; n < order.size(); ++n) {
+                const morph::VisualTextModel<glver>& t = *texts[order[n].first];
+                const unsigned int q = order[n].second;
+                if (this->groups.empty() || key (order[n]) != key (order[n-1])) {
+                    this->groups.push_back ({ t.quad_ids[q], t.clr_text, t.alpha, n, 0 });
+                }
+                ++this->groups.back().count;
+                for (unsigned int v = 0; v < 4; ++v) {
+                    const std::size_t j = 12 * q + 3 * v;
+                    morph::vec<float, 4> p = t.viewmatrix * morph::vec<float, 3>{ t.vertexPositions[j],
+                                                                                  t.vertexPositions[j+1],
+                                                                                  t.vertexPositions[j+2] };
+                    posn.insert (posn.end(), { p[0], p[1], p[2] });
+                    tex.insert (tex.end(), { t.vertexTextures[j], t.vertexTextures[j+1], t.vertexTextures[j+2] });
+                }
+                // Two triangles per quad, as in VisualTextModel::initializeVertices
+                const GLuint ib = 4 * n;
+                idx.insert (idx.end(), { ib, ib + 1, ib + 2, ib + 2, ib + 3, ib });
+            }
+
+#ifdef GLAD_OPTION_GL_MX
+            this->glfn = texts[0]->get_glfn (texts[0]->parentVis);
+            GladGLContext* _glfn = this->glfn;
+            if (this->vao == 0) {
+                _glfn->GenVertexArrays (1, &this->vao);
+                _glfn->GenBuffers (3, this->vbos.data());
+            }
+            _glfn->BindVertexArray (this->vao);
+            _glfn->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->vbos[2]);
+            _glfn->BufferData (GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_DYNAMIC_DRAW);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->vbos[0]);
+            _glfn->BufferData (GL_ARRAY_BUFFER, posn.size() * sizeof(float), posn.data(), GL_DYNAMIC_DRAW);
+            _glfn->VertexAttribPointer (visgl::posnLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            _glfn->EnableVertexAttribArray (visgl::posnLoc);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->vbos[1]);
+            _glfn->BufferData (GL_ARRAY_BUFFER, tex.size() * sizeof(float), tex.data(), GL_DYNAMIC_DRAW);
+            _glfn->VertexAttribPointer (visgl::textureLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            _glfn->EnableVertexAttribArray (visgl::textureLoc);
+            _glfn->BindVertexArray (0);
+#else
+            if (this->vao == 0) {
+                glGenVertexArrays (1, &this->vao);
+                glGenBuffers (3, this->vbos.data());
+            }
+            glBindVertexArray (this->vao);
+            glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, this->vbos[2]);
+            glBufferData (GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLuint), idx.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[0]);
+            glBufferData (GL_ARRAY_BUFFER, posn.size() * sizeof(float), posn.data(), GL_DYNAMIC_DRAW);
+            glVertexAttribPointer (visgl::posnLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (visgl::posnLoc);
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[1]);
+            glBufferData (GL_ARRAY_BUFFER, tex.size() * sizeof(float), tex.data(), GL_DYNAMIC_DRAW);
+            glVertexAttribPointer (visgl::textureLoc, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
+            glEnableVertexAttribArray (visgl::textureLoc);
+            glBindVertexArray (0);
+#endif
+        }
+
+#ifdef GLAD_OPTION_GL_MX
+        //! The GL function context that the buffers were created in
+        GladGLContext* glfn = nullptr;
+#endif
+        //! The vertex array object of the batch
+        GLuint vao = 0;
+        //! Position, texture coordinate and index buffers
+        std::array<GLuint, 3> vbos = { 0, 0, 0 };
+        //! The draw groups, in vertex buffer order
+        std::vector<group> groups;
+        //! The state of each text when the batch was built
+        std::vector<text_state> built;
+    };
+
+} // namespace morph
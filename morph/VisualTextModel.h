@@ -29,11 +29,16 @@
 #include <morph/VisualFace.h>
 #include <morph/VisualResources.h>
 #include <morph/colour.h>
+#include <morph/trace.h>
+#include <morph/memory_usage.h>
 #include <vector>
 #include <array>
 #include <map>
 #include <limits>
 #include <memory>
+#include <string>
+#include <cstdio>
+#include <algorithm>
 
 namespace morph {
 
@@ -41,6 +46,10 @@ namespace morph {
     template <int>
     class VisualOwnable;
 
+    //! Forward declaration of VisualTextBatch, which reads the quads of VisualTextModels
+    template <int>
+    class VisualTextBatch;
+
     /*!
      * A separate data-containing model which is used to render text. It is intended
      * that this could comprise part of a morph::Visual or a morph::VisualModel. It has
@@ -49,6 +58,7 @@ namespace morph {
     template <int glver = morph::gl::version_4_1>
     class VisualTextModel
     {
+        friend class morph::VisualTextBatch<glver>;
     public:
         //! Pass just the TextFeatures. parentVis, tshader etc, accessed by callbacks
         VisualTextModel (morph::TextFeatures _tfeatures)
@@ -70,87 +80,76 @@ namespace morph {
             }
         }
 
-        //! Render the VisualTextModel
-        void render()
+        /*!
+         * Render the VisualTextModel. If tprog_in_use is true, the caller has already made the
+         * text shader program current; otherwise it is made current here and the previous program
+         * is restored afterwards.
+         */
+        void render (bool tprog_in_use = false)
         {
             if (this->hide == true) { return; }
 
-            GLint prev_shader;
-            GLuint tshaderprog = this->get_tprog (this->parentVis);
+            GLint prev_shader = 0;
+            // The uniform locations are looked up once, when the program is loaded
+            const morph::visgl::visual_shaderprogs::uniform_locations locs = this->get_shaderprogs(this->parentVis).tprog_locs;
 #ifdef GLAD_OPTION_GL_MX
             auto _glfn = this->get_glfn (this->parentVis);
 
-            _glfn->GetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-
-            // Ensure the correct program is in play for this VisualModel
-            _glfn->UseProgram (tshaderprog);
+            if (!tprog_in_use) {
+                _glfn->GetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+                // Ensure the correct program is in play for this VisualModel
+                _glfn->UseProgram (this->get_tprog (this->parentVis));
+            }
 
             // Set uniforms
-            GLint loc_tc = _glfn->GetUniformLocation (tshaderprog, static_cast<const GLchar*>("textColor"));
-            if (loc_tc != -1) { _glfn->Uniform3f (loc_tc, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
-            GLint loc_a = _glfn->GetUniformLocation (tshaderprog, static_cast<const GLchar*>("alpha"));
-            if (loc_a != -1) { _glfn->Uniform1f (loc_a, this->alpha); }
-            GLint loc_v = _glfn->GetUniformLocation (tshaderprog, static_cast<const GLchar*>("v_matrix"));
-            if (loc_v != -1) { _glfn->UniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
-            GLint loc_m = _glfn->GetUniformLocation (tshaderprog, static_cast<const GLchar*>("m_matrix"));
-            if (loc_m != -1) { _glfn->UniformMatrix4fv (loc_m, 1, GL_FALSE, this->viewmatrix.mat.data()); }
+            if (locs.text_colour != -1) { _glfn->Uniform3f (locs.text_colour, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
+            if (locs.alpha != -1) { _glfn->Uniform1f (locs.alpha, this->alpha); }
+            if (locs.v_matrix != -1) { _glfn->UniformMatrix4fv (locs.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            if (locs.m_matrix != -1) { _glfn->UniformMatrix4fv (locs.m_matrix, 1, GL_FALSE, this->viewmatrix.mat.data()); }
 
             _glfn->ActiveTexture (GL_TEXTURE0);
 
             // It is only necessary to bind the vertex array object before rendering
             _glfn->BindVertexArray (this->vao);
 
-            // We have a max of (2^32)-1 characters. Should be enough.
-            for (unsigned int i = 0U; i < quads.size(); ++i) {
-                // Bind the right texture for the quad.
-                _glfn->BindTexture (GL_TEXTURE_2D, this->quad_ids[i]);
-                // This is 'draw a subset of the elements from the vertex array
-                // object'. You say how many indices to draw and which base *vertex* you
-                // start from. In my scheme, I have 4 vertices for each two triangles
-                // that are constructed. Thus, I draw 6 indices, but increment the base
-                // vertex by 4 for each letter.
-                _glfn->DrawElementsBaseVertex (GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, 4*i);
+            // Glyphs come from atlas textures, so there is one draw for each run of quads on the
+            // same atlas page; usually just one draw for the whole text.
+            for (const auto& d : this->draws) {
+                _glfn->BindTexture (GL_TEXTURE_2D, d.texture);
+                _glfn->DrawElements (GL_TRIANGLES, 6 * d.count, GL_UNSIGNED_INT, (void*)(6 * d.first * sizeof(GLuint)));
             }
 
             _glfn->BindVertexArray(0);
-            _glfn->UseProgram (prev_shader);
+            if (!tprog_in_use) { _glfn->UseProgram (prev_shader); }
 
             morph::gl::Util::checkError (__FILE__, __LINE__, _glfn);
 #else
-            glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
-
-            // Ensure the correct program is in play for this VisualModel
-            glUseProgram (tshaderprog);
+            if (!tprog_in_use) {
+                glGetIntegerv (GL_CURRENT_PROGRAM, &prev_shader);
+                // Ensure the correct program is in play for this VisualModel
+                glUseProgram (this->get_tprog (this->parentVis));
+            }
 
             // Set uniforms
-            GLint loc_tc = glGetUniformLocation (tshaderprog, static_cast<const GLchar*>("textColor"));
-            if (loc_tc != -1) { glUniform3f (loc_tc, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
-            GLint loc_a = glGetUniformLocation (tshaderprog, static_cast<const GLchar*>("alpha"));
-            if (loc_a != -1) { glUniform1f (loc_a, this->alpha); }
-            GLint loc_v = glGetUniformLocation (tshaderprog, static_cast<const GLchar*>("v_matrix"));
-            if (loc_v != -1) { glUniformMatrix4fv (loc_v, 1, GL_FALSE, this->scenematrix.mat.data()); }
-            GLint loc_m = glGetUniformLocation (tshaderprog, static_cast<const GLchar*>("m_matrix"));
-            if (loc_m != -1) { glUniformMatrix4fv (loc_m, 1, GL_FALSE, this->viewmatrix.mat.data()); }
+            if (locs.text_colour != -1) { glUniform3f (locs.text_colour, this->clr_text[0], this->clr_text[1], this->clr_text[2]); }
+            if (locs.alpha != -1) { glUniform1f (locs.alpha, this->alpha); }
+            if (locs.v_matrix != -1) { glUniformMatrix4fv (locs.v_matrix, 1, GL_FALSE, this->scenematrix.mat.data()); }
+            if (locs.m_matrix != -1) { glUniformMatrix4fv (locs.m_matrix, 1, GL_FALSE, this->viewmatrix.mat.data()); }
 
             glActiveTexture (GL_TEXTURE0);
 
             // It is only necessary to bind the vertex array object before rendering
             glBindVertexArray (this->vao);
 
-            // We have a max of (2^32)-1 characters. Should be enough.
-            for (unsigned int i = 0U; i < quads.size(); ++i) {
-                // Bind the right texture for the quad.
-                glBindTexture (GL_TEXTURE_2D, this->quad_ids[i]);
-                // This is 'draw a subset of the elements from the vertex array
-                // object'. You say how many indices to draw and which base *vertex* you
-                // start from. In my scheme, I have 4 vertices for each two triangles
-                // that are constructed. Thus, I draw 6 indices, but increment the base
-                // vertex by 4 for each letter.
-                glDrawElementsBaseVertex (GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, 4*i);
+            // Glyphs come from atlas textures, so there is one draw for each run of quads on the
+            // same atlas page; usually just one draw for the whole text.
+            for (const auto& d : this->draws) {
+                glBindTexture (GL_TEXTURE_2D, d.texture);
+                glDrawElements (GL_TRIANGLES, 6 * d.count, GL_UNSIGNED_INT, (void*)(6 * d.first * sizeof(GLuint)));
             }
 
             glBindVertexArray(0);
-            glUseProgram (prev_shader);
+            if (!tprog_in_use) { glUseProgram (prev_shader); }
 
             morph::gl::Util::checkError (__FILE__, __LINE__);
 #endif
@@ -164,7 +163,36 @@ namespace morph {
         }
 
         //! Setter for VisualTextModel::viewmatrix, the model view
-        void setViewMatrix (const mat44<float>& mv) { this->viewmatrix = mv; }
+        void setViewMatrix (const mat44<float>& mv) { this->viewmatrix = mv; ++this->changes; }
+
+        //! The number of changes made to the quads or the model view matrix so far
+        unsigned int get_changes() const { return this->changes; }
+
+        //! The text, its features and its offset within the model, as given to setupText()
+        const std::basic_string<char32_t>& get_text() const { return this->txt; }
+        const morph::TextFeatures& get_features() const { return this->tfeatures; }
+        const vec<float>& get_offset() const { return this->mv_offset; }
+
+        /*!
+         * The memory held by the text's quads and vertex data, and by its vertex buffers. The
+         * glyph textures belong to the VisualFace, shared by all the texts that use it.
+         */
+        morph::memory_usage memory_usage (const std::string& name = "VisualTextModel") const
+        {
+            morph::memory_usage mu (name, 0, this->gpu_bytes);
+            const bool uploaded = this->vbos != nullptr;
+            mu.add ("quads", this->quads);
+            mu.add ("quad_ids", this->quad_ids);
+            mu.add ("quad_uvs", this->quad_uvs);
+            mu.add ("draws", this->draws);
+            mu.add ("txt", this->txt);
+            mu.add ("indices", this->indices, uploaded);
+            mu.add ("vertexPositions", this->vertexPositions, uploaded);
+            mu.add ("vertexNormals", this->vertexNormals, uploaded);
+            mu.add ("vertexColors", this->vertexColors, uploaded);
+            mu.add ("vertexTextures", this->vertexTextures, uploaded);
+            return mu;
+        }
 
         //! Setter for VisualTextModel::scenematrix, the scene view
         void setSceneMatrix (const mat44<float>& sv) { this->scenematrix = sv; }
@@ -210,6 +238,7 @@ namespace morph {
             this->viewmatrix.setToIdentity();
             this->viewmatrix.translate (this->mv_offset);
             this->viewmatrix.rotate (this->mv_rotation);
+            ++this->changes;
         }
 
         //! Add a translation to the model view matrix
@@ -217,6 +246,7 @@ namespace morph {
         {
             this->mv_offset += v0;
             this->viewmatrix.translate (v0);
+            ++this->changes;
         }
 
         //! Set a rotation (only) into the model view matrix
@@ -229,6 +259,7 @@ namespace morph {
             this->viewmatrix.translate (this->mv_offset);
             //std::cout << "VTM::setViewRotation: rotating mv_rotation " << mv_rotation << std::endl;
             this->viewmatrix.rotate (this->mv_rotation);
+            ++this->changes;
         }
 
         //! Apply a further rotation to the model view matrix
@@ -236,6 +267,7 @@ namespace morph {
         {
             this->mv_rotation.premultiply (r);
             this->viewmatrix.rotate (r);
+            ++this->changes;
         }
 
         //! Compute the geometry for a sample text.
@@ -326,6 +358,7 @@ namespace morph {
         //! With the given text and font size information, create the quads for the text.
         void setupText (const std::basic_string<char32_t>& _txt)
         {
+            MORPH_TRACE_SCOPE_CAT ("VisualTextModel::setupText", "text");
 #ifdef GLAD_OPTION_GL_MX
             if (this->face == nullptr) {
                 this->face = VisualResources<glver>::i().getVisualFace (this->tfeatures, this->parentVis,
@@ -340,6 +373,7 @@ namespace morph {
             // With glyph information from txt, set up this->quads.
             this->quads.clear();
             this->quad_ids.clear();
+            this->quad_uvs.clear();
             // Our string of letters starts at this location
             float letter_pos = 0.0f;
             float letter_y = 0.0f;
@@ -348,48 +382,28 @@ namespace morph {
 
                 if (*c == '\n') {
                     // Skip newline, but add a y offset and reset letter_pos
-                    letter_pos = 0.0f;
-                    morph::visgl::CharInfo ch = this->face->glchars['h'];
-                    letter_y += this->line_spacing * -ch.size.y() * this->fontscale;
+                    this->newline (letter_pos, letter_y);
                     continue;
                 }
 
                 // Add a quad to this->quads
-                morph::visgl::CharInfo ci = this->face->glchars[*c];
-
-                float xpos = letter_pos + ci.bearing.x() * this->fontscale;
-                float ypos = letter_y /*this->mv_offset[1]*/ - (ci.size.y() - ci.bearing.y()) * this->fontscale;
-                float w = ci.size.x() * this->fontscale;
-                float h = ci.size.y() * this->fontscale;
-
-                // Update extents
-                if (xpos < this->extents[0]) { this->extents[0] = xpos; } // left
-                if (xpos+w > this->extents[1]) { this->extents[1] = xpos+w; } // right
-                if (ypos < this->extents[2]) { this->extents[2] = ypos; } // bottom
-                if (ypos+h > this->extents[3]) { this->extents[3] = ypos+h; } // top
-
-                // What's the order of the vertices for the quads? It is:
-                // Bottom left, Top left, top right, bottom right.
-                std::array<float,12> tbox = { xpos,   ypos,     /*this->mv_offset[2]+*/text_epsilon,
-                                              xpos,   ypos+h,   text_epsilon,
-                                              xpos+w, ypos+h,   text_epsilon,
-                                              xpos+w, ypos,     text_epsilon };
-                text_epsilon -= 10.0f * std::numeric_limits<float>::epsilon();
+                const morph::visgl::CharInfo& ci = this->glyph (*c);
+                std::array<float,12> tbox = this->glyph_quad (ci, letter_pos, letter_y, text_epsilon);
                 if constexpr (debug_textquads == true) {
                     std::cout << "Text box added as quad from\n("
                               << tbox[0] << "," << tbox[1] << "," << tbox[2]
                               << ") to (" << tbox[3] << "," << tbox[4] << "," << tbox[5]
                               << ") to (" << tbox[6] << "," << tbox[7] << "," << tbox[8]
-                              << ") to (" << tbox[9] << "," << tbox[10] << "," << tbox[11]
-                              << "). w="<<w<<", h="<<h<<"\n";
+                              << ") to (" << tbox[9] << "," << tbox[10] << "," << tbox[11] << ")\n";
                     std::cout << "Texture ID for that character is: " << ci.textureID << std::endl;
                 }
                 this->quads.push_back (tbox);
                 this->quad_ids.push_back (ci.textureID);
-
-                // The value in ci.advance has to be divided by 64 to bring it into the
-                // same units as the ci.size and ci.bearing values.
-                letter_pos += ((ci.advance>>6)*this->fontscale);
+                this->quad_uvs.push_back (ci.uv);
+            }
+            // A text longer than the reserved capacity grows it
+            if (this->capacity > 0 && this->quads.size() > this->capacity) {
+                this->capacity = std::max (2 * this->capacity, static_cast<unsigned int>(this->quads.size()));
             }
 
             //std::cout << "After setupText, extents are: (LRBT): " << this->extents << std::endl;
@@ -404,38 +418,252 @@ namespace morph {
             this->initializeVertices();
 
             this->postVertexInit();
+            ++this->changes;
         }
 
         float width() const { return this->extents[1] - this->extents[0]; }
         float height() const { return this->extents[3] - this->extents[2]; }
 
+        /*!
+         * Make this an updatable text with room for n_glyphs glyphs. The next setupText() or
+         * updateText() allocates its vertex buffers for n_glyphs quads (so no GL context is
+         * needed here), after which updateText() rewrites only the quads of the glyphs that
+         * change, with sub-buffer updates, rather than rebuilding everything as setupText() does.
+         * Use this for labels that change every frame, such as a time or a frame rate. Updatable
+         * texts are left out of their VisualModel's VisualTextBatch, so that an update doesn't
+         * rebuild the batch.
+         */
+        void reserve (const unsigned int n_glyphs)
+        {
+            this->capacity = n_glyphs;
+            this->txt.reserve (n_glyphs);
+            this->utxt.reserve (n_glyphs);
+            this->quads.reserve (n_glyphs);
+            this->quad_ids.reserve (n_glyphs);
+            this->quad_uvs.reserve (n_glyphs);
+            this->draws.reserve (n_glyphs);
+        }
+
+        //! The number of glyphs that an updatable text has room for (0 if it is not updatable)
+        unsigned int get_capacity() const { return this->capacity; }
+
+        //! True if reserve() has made this an updatable text
+        bool updatable() const { return this->capacity > 0; }
+
+        //! Change the text of an updatable text. ASCII text is converted without allocating.
+        void updateText (const std::string& _txt)
+        {
+            this->utxt.clear();
+            for (char ch : _txt) {
+                if (static_cast<unsigned char>(ch) & 0x80) {
+                    this->updateText (morph::unicode::fromUtf8 (_txt));
+                    return;
+                }
+                this->utxt.push_back (static_cast<char32_t>(ch));
+            }
+            this->updateText (this->utxt);
+        }
+
+        /*!
+         * Change the text of an updatable text, keeping the position, rotation and colour. Only
+         * the quads of the glyphs that differ from the current text are rewritten, in runs, with
+         * glBufferSubData. Text that will not fit in the reserved capacity, or a text that is not
+         * updatable, is set up in full with setupText().
+         */
+        void updateText (const std::basic_string<char32_t>& _txt)
+        {
+            if (this->capacity == 0 || this->vbos == nullptr || this->face == nullptr
+                || this->buffer_quads < this->capacity || _txt.size() > this->capacity) {
+                if (this->capacity > 0) {
+                    this->capacity = std::max (2 * this->capacity, static_cast<unsigned int>(_txt.size()));
+                }
+                this->setupText (_txt);
+                return;
+            }
+            if (_txt == this->txt) { return; }
+            this->txt = _txt;
+
+            const unsigned int n_old = static_cast<unsigned int>(this->quads.size());
+            unsigned int nq = 0;
+            unsigned int run_first = 0;
+            bool in_run = false;
+            float letter_pos = 0.0f;
+            float letter_y = 0.0f;
+            float text_epsilon = 0.0f;
+            for (char32_t c : this->txt) {
+                if (c == '\n') {
+                    this->newline (letter_pos, letter_y);
+                    continue;
+                }
+                const morph::visgl::CharInfo& ci = this->glyph (c);
+                const std::array<float, 12> tbox = this->glyph_quad (ci, letter_pos, letter_y, text_epsilon);
+                if (nq >= n_old || tbox != this->quads[nq] || ci.textureID != this->quad_ids[nq] || ci.uv != this->quad_uvs[nq]) {
+                    if (nq < n_old) {
+                        this->quads[nq] = tbox;
+                        this->quad_ids[nq] = ci.textureID;
+                        this->quad_uvs[nq] = ci.uv;
+                    } else {
+                        this->quads.push_back (tbox);
+                        this->quad_ids.push_back (ci.textureID);
+                        this->quad_uvs.push_back (ci.uv);
+                    }
+                    this->set_quad_vertices (nq);
+                    if (!in_run) { run_first = nq; in_run = true; }
+                } else if (in_run) {
+                    this->upload_quads (run_first, nq - run_first);
+                    in_run = false;
+                }
+                ++nq;
+            }
+            if (in_run) { this->upload_quads (run_first, nq - run_first); }
+
+            // Quads left over from a longer text stay in the buffers, but are no longer drawn
+            this->quads.resize (nq);
+            this->quad_ids.resize (nq);
+            this->quad_uvs.resize (nq);
+            this->compute_draws();
+            ++this->changes;
+        }
+
+        /*!
+         * A fast path for numeric labels: set the text of an updatable text to value, with
+         * precision decimal places, right aligned in width characters. The number is formatted
+         * into a fixed buffer, so this doesn't allocate. With a font whose digits all have the
+         * same advance (as most fonts' digits do), a changing counter keeps its digits in place
+         * and only the quads of the digits that change are rewritten.
+         */
+        void updateNumber (const double value, const int precision = 0, const int width = 0)
+        {
+            std::array<char, 64> buf;
+            const int n = std::snprintf (buf.data(), buf.size(), "%*.*f", width, precision, value);
+            this->utxt.clear();
+            for (int i = 0; i < std::min (n, static_cast<int>(buf.size()) - 1); ++i) { this->utxt.push_back (static_cast<char32_t>(buf[i])); }
+            this->updateText (this->utxt);
+        }
+
     protected:
-        //! Initialize the vertices that will represent the Quads.
+        //! The glyph information for the character c, with a cache of pointers for ASCII
+        const morph::visgl::CharInfo& glyph (const char32_t c)
+        {
+            if (c < this->ascii_glyphs.size()) {
+                if (this->ascii_glyphs[c] == nullptr) { this->ascii_glyphs[c] = &this->face->glchars[c]; }
+                return *this->ascii_glyphs[c];
+            }
+            return this->face->glchars[c];
+        }
+
+        //! Move the pen (letter_pos, letter_y) to the start of the next line
+        void newline (float& letter_pos, float& letter_y)
+        {
+            letter_pos = 0.0f;
+            const morph::visgl::CharInfo& ch = this->glyph ('h');
+            letter_y += this->line_spacing * -ch.size.y() * this->fontscale;
+        }
+
+        /*!
+         * The quad for the glyph ci with the pen at (letter_pos, letter_y). Advances the pen and
+         * text_epsilon, and grows the extents to contain the quad.
+         */
+        std::array<float, 12> glyph_quad (const morph::visgl::CharInfo& ci, float& letter_pos,
+                                          const float letter_y, float& text_epsilon)
+        {
+            float xpos = letter_pos + ci.bearing.x() * this->fontscale;
+            float ypos = letter_y /*this->mv_offset[1]*/ - (ci.size.y() - ci.bearing.y()) * this->fontscale;
+            float w = ci.size.x() * this->fontscale;
+            float h = ci.size.y() * this->fontscale;
+
+            // Update extents
+            if (xpos < this->extents[0]) { this->extents[0] = xpos; } // left
+            if (xpos+w > this->extents[1]) { this->extents[1] = xpos+w; } // right
+            if (ypos < this->extents[2]) { this->extents[2] = ypos; } // bottom
+            if (ypos+h > this->extents[3]) { this->extents[3] = ypos+h; } // top
+
+            // What's the order of the vertices for the quads? It is:
+            // Bottom left, Top left, top right, bottom right.
+            std::array<float,12> tbox = { xpos,   ypos,     /*this->mv_offset[2]+*/text_epsilon,
+                                          xpos,   ypos+h,   text_epsilon,
+                                          xpos+w, ypos+h,   text_epsilon,
+                                          xpos+w, ypos,     text_epsilon };
+            text_epsilon -= 10.0f * std::numeric_limits<float>::epsilon();
+
+            // The value in ci.advance has to be divided by 64 to bring it into the
+            // same units as the ci.size and ci.bearing values.
+            letter_pos += ((ci.advance>>6)*this->fontscale);
+            return tbox;
+        }
+
+        //! Runs of consecutive quads whose glyphs are on the same atlas page
+        void compute_draws()
+        {
+            this->draws.clear();
+            for (unsigned int qi = 0; qi < this->quads.size(); ++qi) {
+                if (this->draws.empty() || this->draws.back().texture != this->quad_ids[qi]) {
+                    this->draws.push_back ({ this->quad_ids[qi], qi, 0 });
+                }
+                ++this->draws.back().count;
+            }
+        }
+
+        //! Write the positions and texture coordinates of quad qi into the CPU-side vertex data
+        void set_quad_vertices (const unsigned int qi)
+        {
+            std::copy (this->quads[qi].begin(), this->quads[qi].end(), this->vertexPositions.begin() + 12 * qi);
+            // Add the info for drawing the textures on the quads. The glyph's rectangle
+            // in its atlas page is uv = (u0, v0, u1, v1) with v0 at the top of the glyph.
+            const morph::vec<float, 4>& uv = this->quad_uvs[qi];
+            const std::array<float, 12> tc = { uv[0], uv[3], 0.0f,  uv[0], uv[1], 0.0f,
+                                               uv[2], uv[1], 0.0f,  uv[2], uv[3], 0.0f };
+            std::copy (tc.begin(), tc.end(), this->vertexTextures.begin() + 12 * qi);
+        }
+
+        //! Copy count quads from quad first of the CPU-side vertex data into the vertex buffers
+        void upload_quads (const unsigned int first, const unsigned int count)
+        {
+            const GLintptr offset = 12 * first * sizeof(float);
+            const GLsizeiptr sz = 12 * count * sizeof(float);
+#ifdef GLAD_OPTION_GL_MX
+            auto _glfn = this->get_glfn (this->parentVis);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->vbos[posnVBO]);
+            _glfn->BufferSubData (GL_ARRAY_BUFFER, offset, sz, this->vertexPositions.data() + 12 * first);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, this->vbos[textureVBO]);
+            _glfn->BufferSubData (GL_ARRAY_BUFFER, offset, sz, this->vertexTextures.data() + 12 * first);
+            _glfn->BindBuffer (GL_ARRAY_BUFFER, 0);
+#else
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[posnVBO]);
+            glBufferSubData (GL_ARRAY_BUFFER, offset, sz, this->vertexPositions.data() + 12 * first);
+            glBindBuffer (GL_ARRAY_BUFFER, this->vbos[textureVBO]);
+            glBufferSubData (GL_ARRAY_BUFFER, offset, sz, this->vertexTextures.data() + 12 * first);
+            glBindBuffer (GL_ARRAY_BUFFER, 0);
+#endif
+        }
+
+        /*!
+         * Initialize the vertices that will represent the Quads. An updatable text has vertices
+         * for all the quads of its capacity; those beyond the text are not drawn.
+         */
         void initializeVertices() {
 
             unsigned int nquads = static_cast<unsigned int>(this->quads.size());
+            const unsigned int n_alloc = std::max (nquads, this->capacity);
 
-            for (unsigned int qi = 0; qi < nquads; ++qi) {
-
-                std::array<float, 12> quad = this->quads[qi];
+            this->compute_draws();
 
-                if constexpr (debug_textquads == true) {
-                    std::cout << "Quad box from (" << quad[0] << "," << quad[1] << "," << quad[2]
-                              << ") to (" << quad[3] << "," << quad[4] << "," << quad[5]
-                              << ") to (" << quad[6] << "," << quad[7] << "," << quad[8]
-                              << ") to (" << quad[9] << "," << quad[10] << "," << quad[11] << ")" << std::endl;
-                }
+            this->buffer_quads = n_alloc;
+            this->vertexPositions.assign (12 * n_alloc, 0.0f);
+            this->vertexTextures.assign (12 * n_alloc, 0.0f);
 
-                this->vertex_push (quad[0], quad[1],  quad[2],  this->vertexPositions); //1
-                this->vertex_push (quad[3], quad[4],  quad[5],  this->vertexPositions); //2
-                this->vertex_push (quad[6], quad[7],  quad[8],  this->vertexPositions); //3
-                this->vertex_push (quad[9], quad[10], quad[11], this->vertexPositions); //4
+            for (unsigned int qi = 0; qi < n_alloc; ++qi) {
 
-                // Add the info for drawing the textures on the quads
-                this->vertex_push (0.0f, 1.0f, 0.0f, this->vertexTextures);
-                this->vertex_push (0.0f, 0.0f, 0.0f, this->vertexTextures);
-                this->vertex_push (1.0f, 0.0f, 0.0f, this->vertexTextures);
-                this->vertex_push (1.0f, 1.0f, 0.0f, this->vertexTextures);
+                if (qi < nquads) {
+                    if constexpr (debug_textquads == true) {
+                        const std::array<float, 12>& quad = this->quads[qi];
+                        std::cout << "Quad box from (" << quad[0] << "," << quad[1] << "," << quad[2]
+                                  << ") to (" << quad[3] << "," << quad[4] << "," << quad[5]
+                                  << ") to (" << quad[6] << "," << quad[7] << "," << quad[8]
+                                  << ") to (" << quad[9] << "," << quad[10] << "," << quad[11] << ")" << std::endl;
+                    }
+                    this->set_quad_vertices (qi);
+                }
 
                 // All same colours
                 this->vertex_push (this->clr_backing, this->vertexColors);
@@ -486,7 +714,7 @@ namespace morph {
 
             //std::cout << "indices.size(): " << this->indices.size() << std::endl;
             std::size_t sz = this->indices.size() * sizeof(GLuint);
-            _glfn->BufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
+            _glfn->BufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), this->buffer_usage());
 
             // Binds data from the "C++ world" to the OpenGL shader world for
             // "position", "normalin" and "color"
@@ -520,7 +748,7 @@ namespace morph {
 
             //std::cout << "indices.size(): " << this->indices.size() << std::endl;
             std::size_t sz = this->indices.size() * sizeof(GLuint);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sz, this->indices.data(), this->buffer_usage());
 
             // Binds data from the "C++ world" to the OpenGL shader world for
             // "position", "normalin" and "color"
@@ -530,6 +758,8 @@ namespace morph {
             this->setupVBO (this->vbos[colVBO], this->vertexColors, visgl::colLoc);
             this->setupVBO (this->vbos[textureVBO], this->vertexTextures, visgl::textureLoc);
 #endif
+            this->gpu_bytes = sz + (this->vertexPositions.size() + this->vertexNormals.size()
+                                    + this->vertexColors.size() + this->vertexTextures.size()) * sizeof(float);
         }
 
     public:
@@ -606,6 +836,14 @@ namespace morph {
 
         //! The text string stored for debugging
         std::basic_string<char32_t> txt;
+        //! Scratch space for the conversion of the text passed to updateText and updateNumber
+        std::basic_string<char32_t> utxt;
+        //! The number of glyph quads that the vertex buffers of an updatable text should have room for
+        unsigned int capacity = 0;
+        //! The number of glyph quads that the vertex buffers do have room for
+        unsigned int buffer_quads = 0;
+        //! The glyphs of the ASCII characters, found once from face->glchars
+        std::array<const morph::visgl::CharInfo*, 128> ascii_glyphs = {};
         //! The Quads that form the 'medium' for the text textures. 12 float = 4 corners
         std::vector<std::array<float,12>> quads;
         //! left, right, top and bottom extents of the text for this
@@ -614,6 +852,19 @@ namespace morph {
         vec<float, 4> extents = { 1e7, -1e7, 1e7, -1e7 };
         //! The texture ID for each quad - so that we draw the right texture image over each quad.
         std::vector<unsigned int> quad_ids;
+        //! The rectangle in its texture of the glyph for each quad
+        std::vector<morph::vec<float, 4>> quad_uvs;
+        //! A draw call: count quads from quad number first, all on the atlas page texture
+        struct draw_range
+        {
+            unsigned int texture = 0;
+            unsigned int first = 0;
+            unsigned int count = 0;
+        };
+        //! The draw calls needed to render the quads
+        std::vector<draw_range> draws;
+        //! Incremented whenever the quads or the model view matrix change (see VisualTextBatch)
+        unsigned int changes = 0;
         //! Position within vertex buffer object (if I use an array of VBO)
         enum VBOPos { posnVBO, normVBO, colVBO, idxVBO, textureVBO, numVBO };
         //! The OpenGL Vertex Array Object
@@ -622,6 +873,8 @@ namespace morph {
         GLuint vbo;
         //! Vertex Buffer Objects stored in an array
         std::unique_ptr<GLuint[]> vbos;
+        //! The bytes in the vertex buffers, as last set up by postVertexInit
+        std::size_t gpu_bytes = 0;
         //! CPU-side data for indices
         std::vector<GLuint> indices;
         //! CPU-side data for quad vertex positions
@@ -637,6 +890,9 @@ namespace morph {
         //! If true, then calls to VisualModel::render should return
         bool hide = false;
 
+        //! The usage hint for the vertex buffers. Updatable texts are rewritten often.
+        GLenum buffer_usage() const { return this->capacity > 0 ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW; }
+
         //! Set up a vertex buffer object - bind, buffer and set vertex array object attribute
         void setupVBO (GLuint& buf, std::vector<float>& dat, unsigned int bufferAttribPosition)
         {
@@ -644,12 +900,12 @@ namespace morph {
 #ifdef GLAD_OPTION_GL_MX
             auto _glfn = this->get_glfn (this->parentVis);
             _glfn->BindBuffer (GL_ARRAY_BUFFER, buf);
-            _glfn->BufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_STATIC_DRAW);
+            _glfn->BufferData (GL_ARRAY_BUFFER, sz, dat.data(), this->buffer_usage());
             _glfn->VertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
             _glfn->EnableVertexAttribArray (bufferAttribPosition);
 #else
             glBindBuffer (GL_ARRAY_BUFFER, buf);
-            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), GL_STATIC_DRAW);
+            glBufferData (GL_ARRAY_BUFFER, sz, dat.data(), this->buffer_usage());
             glVertexAttribPointer (bufferAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, (void*)(0));
             glEnableVertexAttribArray (bufferAttribPosition);
 #endif
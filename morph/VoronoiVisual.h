@@ -17,10 +17,12 @@
 #include <morph/vec.h>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <algorithm>
 #include <vector>
 #include <array>
-#include <map>
-#include <set>
 
 #define JC_VORONOI_IMPLEMENTATION
 #include <morph/jcvoronoi/jc_voronoi.h>
@@ -32,7 +34,7 @@ namespace morph {
     template <typename F, int glver = morph::gl::version_4_1>
     class VoronoiVisual : public VisualDataModel<F, glver>
     {
-        // Need a vec comparison function for a std::set of morph::vec or a std::map with a morph::vec key. See:
+        // Need a vec comparison function to sort morph::vecs (as for a std::set of morph::vec or a std::map with a morph::vec key). See:
         // https://abrg-models.github.io/morphologica/ref/coremaths/vvec/#using-morphvvec-as-a-key-in-stdmap-or-within-an-stdset
         struct veccmp
         {
@@ -101,7 +103,8 @@ namespace morph {
                 ry.update ((*this->dcoords_ptr)[i][1]);
             }
 
-            // Generate the 2D Voronoi diagram
+            // Generate the 2D Voronoi diagram. Its memory comes from this->pool, which keeps
+            // the blocks of the last diagram for reuse.
             jcv_diagram diagram;
             std::memset (&diagram, 0, sizeof(jcv_diagram));
 
@@ -109,141 +112,145 @@ namespace morph {
                 jcv_point{rx.min - this->border_width, ry.min - this->border_width, 0.0f},
                 jcv_point{rx.max + this->border_width, ry.max + this->border_width, 0.0f}
             };
-            jcv_diagram_generate (ncoords, this->dcoords_ptr->data(), &domain, 0, &diagram);
+            jcv_diagram_generate_useralloc (ncoords, this->dcoords_ptr->data(), &domain, 0, &this->pool,
+                                            block_pool::alloc, block_pool::release, &diagram);
 
             // We obtain access the the Voronoi cell sites:
             const jcv_site* sites = jcv_diagram_get_sites (&diagram);
 
-            // Now scan through the Voronoi cell 'sites' and 'edges' to re-assign z
-            // values in the edges. This is not going to be particularly efficient, but
-            // it will be fine for grids of the size that we generally visualize.
+            // Each edge of each site becomes one triangle. Count each site's triangles first,
+            // so that the sites can then be worked through in parallel.
+            const unsigned int nsites = static_cast<unsigned int>(diagram.numsites);
+            this->triangle_counts.assign (nsites, 0);
+            this->triangle_offsets.assign (nsites + 1, 0);
+            this->site_indices.assign (nsites, 0);
+            for (unsigned int i = 0; i < nsites; ++i) {
+                unsigned int site_triangles = 0;
+                for (const jcv_graphedge* e = sites[i].edges; e; e = e->next) { ++site_triangles; }
+                this->triangle_counts[i] = site_triangles;
+                this->triangle_offsets[i + 1] = this->triangle_offsets[i] + site_triangles;
+                this->site_indices[i] = sites[i].index;
+            }
+            this->triangle_count_sum = this->triangle_offsets[nsites];
+
+            // Now scan through the Voronoi cell 'sites' and 'edges' to re-assign z values in
+            // the edges.
             //
-            // For each site, we have a set of edges around that site. We examine each
-            // edge in turn, considering the sites that cluster around each end of the
-            // edge. We assign the mean z of the sites in the cluster to the edge's
-            // postion at that end of the edge.
+            // For each site, we have a set of edges around that site. We examine each edge in
+            // turn, considering the sites that cluster around each end of the edge. We assign
+            // the mean z of the sites in the cluster to the edge's postion at that end of the
+            // edge.
             //
-            // This is complicated by the fact that there may be multiple (2?) edges between pairs
-            // of sites. So, need a map of edge location to z_sums
-
-            // Mapping edge end-point locations to a container of adjacent cell centres
-            std::map<morph::vec<float, 3>, std::set<morph::vec<float, 3>, veccmp>, veccmp> edge_pos_centres;
-            // Mapping same edge end-point locations to the averate z value of the adjacent cell centres
-            std::map<morph::vec<float, 3>, float, veccmp> edge_end_zsums;
-
-            for (int i = 0; i < diagram.numsites; ++i) {
+            // This is complicated by the fact that there may be multiple (2?) edges between
+            // pairs of sites, and that the ends of edges which meet at one location may differ
+            // by a rounding error. So record each edge end with the sites around it, then sort
+            // the ends by location, so that all the ends at one location (as veccmp sees it)
+            // come together.
+            struct edge_end
+            {
+                morph::vec<float, 3> pos;
+                std::array<const jcv_site*, 4> s;
+            };
+            std::vector<edge_end> ends (2u * this->triangle_count_sum);
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int i = 0; i < static_cast<int>(nsites); ++i) {
 
                 // We have the current edge_1, the next edge_2 and the previous edge_0
-                const jcv_site* site = &sites[i];
-                jcv_graphedge* edge_first = site->edges; // The very first edge
-                jcv_graphedge* edge_1 = edge_first;
-                jcv_graphedge* edge_2 = edge_first;
+                jcv_graphedge* edge_first = sites[i].edges; // The very first edge
+                if (edge_first == nullptr) { continue; }
                 jcv_graphedge* edge_0 = edge_first;
                 while (edge_0->next) { edge_0 = edge_0->next; }
 
-                while (edge_1) {
-
+                std::size_t g = 2u * this->triangle_offsets[i];
+                for (jcv_graphedge* edge_1 = edge_first; edge_1; edge_1 = edge_1->next) {
                     // Set z to 0. Should be done in jcvoronoi, but haven't found out how
                     edge_1->pos[0][2] = jcv_real{0};
                     edge_1->pos[1][2] = jcv_real{0};
 
-                    edge_2 = edge_1->next ? edge_1->next : edge_first;
-                    // edge_0 already set
-
-                    // populate the edge_pos_centres map. Known issue: In some cases, outer edges
-                    // have only 1 site at 1 of their ends. This makes it a problem to
-                    // compute the correct z value for the end with no site. The
-                    // solution would be to modify the jcvoronoi algorithm to populate
-                    // both ends of all edges with additional logic.
-                    for (unsigned int j = 0; j < 2; ++j) {
-                        if (edge_1->edge->sites[j]) {
-                            edge_pos_centres[edge_1->pos[1]].insert (edge_1->edge->sites[j]->p);
-                            edge_pos_centres[edge_1->pos[0]].insert (edge_1->edge->sites[j]->p);
-                        }
-                        // By definition, cellcentres_1 also gets edge_2 sites...
-                        if (edge_2->edge->sites[j]) {
-                            edge_pos_centres[edge_1->pos[1]].insert (edge_2->edge->sites[j]->p);
-                        }
-                        // and cellcentres_0 gets edge_0 sites
-                        if (edge_0->edge->sites[j]) {
-                            edge_pos_centres[edge_1->pos[0]].insert (edge_0->edge->sites[j]->p);
-                        }
-                    }
-
+                    jcv_graphedge* edge_2 = edge_1->next ? edge_1->next : edge_first;
+
+                    // Known issue: In some cases, outer edges have only 1 site at 1 of their
+                    // ends. This makes it a problem to compute the correct z value for the end
+                    // with no site. The solution would be to modify the jcvoronoi algorithm to
+                    // populate both ends of all edges with additional logic.
+                    //
+                    // The start of edge_1 also gets edge_0's sites and its end gets edge_2's.
+                    ends[g++] = { edge_1->pos[0], { edge_1->edge->sites[0], edge_1->edge->sites[1],
+                                                    edge_0->edge->sites[0], edge_0->edge->sites[1] } };
+                    ends[g++] = { edge_1->pos[1], { edge_1->edge->sites[0], edge_1->edge->sites[1],
+                                                    edge_2->edge->sites[0], edge_2->edge->sites[1] } };
                     // Prepare for next loop
                     edge_0 = edge_1;
-                    edge_1 = edge_1->next;
                 }
-            } // finished reassignment of z values
+            }
 
-            // From edge_pos_centres, compute zsums for edge_end_zsums
-            for (auto epc : edge_pos_centres) {
+            std::vector<unsigned int> by_pos (ends.size());
+            for (unsigned int k = 0; k < by_pos.size(); ++k) { by_pos[k] = k; }
+            veccmp vc;
+            std::sort (by_pos.begin(), by_pos.end(),
+                       [&ends, &vc](unsigned int a, unsigned int b) { return vc (ends[a].pos, ends[b].pos); });
+
+            // The mean z of the distinct cell centres clustered around each location
+            std::vector<float> end_z (ends.size(), 0.0f);
+            std::vector<morph::vec<float, 3>> centres;
+            for (std::size_t k0 = 0; k0 < by_pos.size();) {
+                std::size_t k1 = k0 + 1;
+                while (k1 < by_pos.size() && !vc (ends[by_pos[k0]].pos, ends[by_pos[k1]].pos)) { ++k1; }
+                centres.clear();
+                for (std::size_t k = k0; k < k1; ++k) {
+                    for (const jcv_site* cs : ends[by_pos[k]].s) { if (cs) { centres.push_back (cs->p); } }
+                }
+                std::sort (centres.begin(), centres.end(), vc);
                 float zsum = 0.0f;
-                // cce: centres clustered-around edge
-                for (auto cce : epc.second) {
-                    zsum += cce[2];
+                unsigned int ncentres = 0;
+                for (std::size_t c = 0; c < centres.size(); ++c) {
+                    // cce: centres clustered-around edge
+                    if (c > 0 && !vc (centres[c - 1], centres[c])) { continue; }
+                    zsum += centres[c][2];
+                    ++ncentres;
                 }
-                edge_end_zsums[epc.first] = zsum / epc.second.size();
+                for (std::size_t k = k0; k < k1; ++k) { end_z[by_pos[k]] = zsum / ncentres; }
+                k0 = k1;
             }
 
-            // Now go through edge_end_zsums and edges and update z values
-            for (int i = 0; i < diagram.numsites; ++i) {
-                const jcv_site* site = &sites[i];
-                jcv_graphedge* edge_1 = site->edges; // The very first edge
-                while (edge_1) {
-                    // For each edge, set z from the map
-                    float zsum0 = edge_end_zsums[edge_1->pos[0]];
-                    float zsum1 = edge_end_zsums[edge_1->pos[1]];
-                    edge_1->pos[0][2] = zsum0;
-                    edge_1->pos[1][2] = zsum1;
-                    edge_1 = edge_1->next;
+            // Now go through the edges and update z values
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int i = 0; i < static_cast<int>(nsites); ++i) {
+                std::size_t g = 2u * this->triangle_offsets[i];
+                for (jcv_graphedge* edge_1 = sites[i].edges; edge_1; edge_1 = edge_1->next) {
+                    edge_1->pos[0][2] = end_z[g++];
+                    edge_1->pos[1][2] = end_z[g++];
                 }
             }
 
-            // To draw triangles iterate over the 'sites' and get the edges
-            this->triangle_counts.resize (ncoords, 0);
-            this->site_indices.resize (ncoords, 0);
-            this->triangle_count_sum = 0;
+            // NB: There are 3 each of pos/col/norm vertices (and 3 indices) per triangle. Could
+            // be reduced in principle. For a random map, it comes out as about about 17*4
+            // vertices per coordinate.
+            const std::size_t vtx0 = this->vertexPositions.size();
+            const std::size_t ind0 = this->indices.size();
+            const GLuint idx0 = this->idx;
+            this->vertexPositions.resize (vtx0 + 9u * this->triangle_count_sum);
+            this->vertexNormals.resize (vtx0 + 9u * this->triangle_count_sum);
+            this->vertexColors.resize (vtx0 + 9u * this->triangle_count_sum);
+            this->indices.resize (ind0 + 3u * this->triangle_count_sum);
+            for (std::size_t j = 0; j < 3u * this->triangle_count_sum; ++j) {
+                this->indices[ind0 + j] = idx0 + static_cast<GLuint>(j);
+            }
+            this->idx = idx0 + static_cast<GLuint>(3u * this->triangle_count_sum);
 
-            if (this->data_z_direction != this->uz) {
-                // inverse rotate
-                morph::vec<float> t0 = {0.0f};
-                morph::vec<float> t1 = {0.0f};
-                morph::vec<float> t2 = {0.0f};
-                morph::quaternion<float> rqinv = rq.invert();
-                for (int i = 0; i < diagram.numsites; ++i) {
-                    const jcv_site* site = &sites[i];
-                    const jcv_graphedge* e = site->edges;
-                    unsigned int site_triangles = 0;
-                    while (e) {
-                        // NB: There are 3 each of pos/col/norm vertices (and 3 indices) per
-                        // triangle. Could be reduced in principle. For a random map, it
-                        // comes out as about about 17*4 vertices per coordinate.
-                        t0 = rqinv * site->p;
-                        t1 = rqinv * e->pos[0];
-                        t2 = rqinv * e->pos[1];
-                        this->computeTriangle (t0, t1, t2, this->setColour(site->index));
-                        ++site_triangles;
-                        e = e->next;
-                    }
-                    this->triangle_counts[i] = site_triangles;
-                    this->site_indices[i] = site->index;
-                    this->triangle_count_sum += site_triangles;
-                }
-            } else {
-                // No need to inverse rotate
-                for (int i = 0; i < diagram.numsites; ++i) {
-                    const jcv_site* site = &sites[i];
-                    const jcv_graphedge* e = site->edges;
-                    unsigned int site_triangles = 0;
-                    while (e) {
-                        this->computeTriangle (site->p, e->pos[0], e->pos[1], this->setColour(site->index));
-                        ++site_triangles;
-                        e = e->next;
+            const bool rotated = this->data_z_direction != this->uz;
+            const morph::quaternion<float> rqinv = rotated ? rq.invert() : rq;
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int i = 0; i < static_cast<int>(nsites); ++i) {
+                const jcv_site* site = &sites[i];
+                const std::array<float, 3> clr = this->setColour (site->index);
+                std::size_t t = vtx0 + 9u * this->triangle_offsets[i];
+                for (const jcv_graphedge* e = site->edges; e; e = e->next, t += 9u) {
+                    if (rotated) {
+                        this->setTriangle (t, rqinv * site->p, rqinv * e->pos[0], rqinv * e->pos[1], clr);
+                    } else {
+                        this->setTriangle (t, site->p, e->pos[0], e->pos[1], clr);
                     }
-                    this->triangle_counts[i] = site_triangles;
-                    this->site_indices[i] = site->index;
-                    this->triangle_count_sum += site_triangles;
                 }
             }
             if (static_cast<unsigned int>(diagram.numsites) != ncoords) {
@@ -322,28 +329,51 @@ namespace morph {
                 }
             }
 
-            // At end free the Voronoi diagram memory
+            // At end free the Voronoi diagram memory (back to this->pool) and note the
+            // coordinates that it was made from
             jcv_diagram_free (&diagram);
+            this->coords_last = *this->dataCoords;
+            this->geometry_last = { this->data_z_direction[0], this->data_z_direction[1],
+                                    this->data_z_direction[2], this->zoom, this->border_width };
+        }
+
+        /*!
+         * Called by updateData. If the data coordinates (and zoom, border_width and
+         * data_z_direction) are those the model was last built from, then the Voronoi diagram
+         * is unchanged and only the colours are updated, with reinitColours(). Otherwise the
+         * model is rebuilt with reinit().
+         */
+        void scalarDataUpdated() override
+        {
+            if (this->geometry_unchanged() && this->scalarData != nullptr
+                && this->scalarData->size() == this->coords_last.size()) {
+                this->reinitColours();
+            } else {
+                this->reinit();
+            }
+        }
+
+        /*!
+         * True if the data coordinates, zoom, border_width and data_z_direction are those that
+         * the model was last built from.
+         */
+        bool geometry_unchanged() const
+        {
+            if (this->dataCoords == nullptr || this->triangle_offsets.empty()) { return false; }
+            const std::array<float, 5> g = { this->data_z_direction[0], this->data_z_direction[1],
+                                             this->data_z_direction[2], this->zoom, this->border_width };
+            return g == this->geometry_last && *this->dataCoords == this->coords_last;
         }
 
         void reinitColoursScalar()
         {
             if (this->colourScale.do_autoscale == true) { this->colourScale.reset(); }
-            this->dcolour.resize (this->scalarData->size());
-            this->colourScale.transform (*(this->scalarData), dcolour);
+            this->transformScalarData (this->colourScale, this->dcolour);
 
             // Replace elements of vertexColors
-            unsigned int tcounts = 0;
-            for (std::size_t i = 0u; i < this->triangle_counts.size(); ++i) {
-                auto c = this->cm.convert (this->dcolour[this->site_indices[i]]);
-                std::size_t d_idx = tcounts * 9; // 3 floats per vtx, 3 vtxs per tri
-                for (std::size_t j = 0; j < 3 * this->triangle_counts[i]; ++j) {
-                    // This is ONE colour vertex. Need 3 per triangle.
-                    this->vertexColors[d_idx + 3 * j]     = c[0];
-                    this->vertexColors[d_idx + 3 * j + 1] = c[1];
-                    this->vertexColors[d_idx + 3 * j + 2] = c[2];
-                }
-                tcounts += this->triangle_counts[i];
+#pragma omp parallel for
+            for (int i = 0; i < static_cast<int>(this->triangle_counts.size()); ++i) {
+                this->setSiteColour (i, this->cm.convert (this->dcolour[this->site_indices[i]]));
             }
 
             // Lastly, this call copies vertexColors (etc) into the OpenGL memory space
@@ -354,8 +384,8 @@ namespace morph {
         void reinitColoursVector()
         {
             if (this->colourScale.do_autoscale == true) { this->colourScale.reset(); }
-            if (this->colourScale2.do_autoscale == true) { this->colourScale.reset(); }
-            if (this->colourScale3.do_autoscale == true) { this->colourScale.reset(); }
+            if (this->colourScale2.do_autoscale == true) { this->colourScale2.reset(); }
+            if (this->colourScale3.do_autoscale == true) { this->colourScale3.reset(); }
 
             for (unsigned int i = 0; i < this->vectorData->size(); ++i) {
                 this->dcolour[i] = (*this->vectorData)[i][0];
@@ -369,17 +399,9 @@ namespace morph {
             } // else assume dcolour/dcolour2/dcolour3 are all in range 0->1 (or 0-255) already
 
             // Replace elements of vertexColors
-            unsigned int tcounts = 0;
-            for (std::size_t i = 0u; i < this->triangle_counts.size(); ++i) {
-                std::array<float, 3> c = this->setColour (this->site_indices[i]);
-                std::size_t d_idx = tcounts * 9; // 3 floats per vtx, 3 vtxs per tri
-                for (std::size_t j = 0; j < 3 * this->triangle_counts[i]; ++j) {
-                    // This is ONE colour vertex. Need 3 per triangle.
-                    this->vertexColors[d_idx + 3 * j]     = c[0];
-                    this->vertexColors[d_idx + 3 * j + 1] = c[1];
-                    this->vertexColors[d_idx + 3 * j + 2] = c[2];
-                }
-                tcounts += this->triangle_counts[i];
+#pragma omp parallel for
+            for (int i = 0; i < static_cast<int>(this->triangle_counts.size()); ++i) {
+                this->setSiteColour (i, this->setColour (this->site_indices[i]));
             }
 
             // Lastly, this call copies vertexColors (etc) into the OpenGL memory space
@@ -440,10 +462,8 @@ namespace morph {
                     throw std::runtime_error ("Error: scalarData size does not match n");
                 }
 
-                this->dcopy.resize (n);
-                this->zScale.transform (*(this->scalarData), dcopy);
-                this->dcolour.resize (n);
-                this->colourScale.transform (*(this->scalarData), dcolour);
+                this->transformScalarData (this->zScale, this->dcopy);
+                this->transformScalarData (this->colourScale, this->dcolour);
 
             } else if (this->vectorData != nullptr) {
 
@@ -504,8 +524,8 @@ namespace morph {
             return clr;
         }
 
-        //! Compute a triangle from 3 arbitrary corners
-        void computeTriangle (vec<float> c1, vec<float> c2, vec<float> c3, const std::array<float, 3>& colr)
+        //! Set the triangle whose vertices start at element t of vertexPositions from 3 arbitrary corners
+        void setTriangle (const std::size_t t, vec<float> c1, vec<float> c2, vec<float> c3, const std::array<float, 3>& colr)
         {
             c1 *= this->zoom;
             c2 *= this->zoom;
@@ -515,26 +535,89 @@ namespace morph {
             vec<float> u2 = c2-c3;
             vec<float> v = u1.cross(u2);
             v.renormalize();
-            // Push corner vertices
-            this->vertex_push (c1, this->vertexPositions);
-            this->vertex_push (c2, this->vertexPositions);
-            this->vertex_push (c3, this->vertexPositions);
-            // Colours/normals
+            // Corner vertices, then colours/normals
+            std::copy (c1.begin(), c1.end(), this->vertexPositions.begin() + t);
+            std::copy (c2.begin(), c2.end(), this->vertexPositions.begin() + t + 3);
+            std::copy (c3.begin(), c3.end(), this->vertexPositions.begin() + t + 6);
             for (unsigned int i = 0; i < 3U; ++i) {
-                this->vertex_push (colr, this->vertexColors);
-                this->vertex_push (v, this->vertexNormals);
+                std::copy (colr.begin(), colr.end(), this->vertexColors.begin() + t + 3 * i);
+                std::copy (v.begin(), v.end(), this->vertexNormals.begin() + t + 3 * i);
+            }
+        }
+
+        //! Set the colour of every vertex of the triangles of the ith Voronoi cell
+        void setSiteColour (const std::size_t i, const std::array<float, 3>& c)
+        {
+            // 3 floats per vtx, 3 vtxs per tri
+            auto vc = this->vertexColors.begin() + 9u * this->triangle_offsets[i];
+            for (std::size_t j = 0; j < 3 * this->triangle_counts[i]; ++j, vc += 3) {
+                std::copy (c.begin(), c.end(), vc);
             }
-            this->indices.push_back (this->idx++);
-            this->indices.push_back (this->idx++);
-            this->indices.push_back (this->idx++);
         }
 
+        /*!
+         * Recycles the memory blocks of one Voronoi diagram for the next, so that a model whose
+         * coordinates change every frame does not go back to the heap each time. The diagram
+         * allocates one block sized for its number of points and then any number of fixed size
+         * blocks (16 kB in jc_voronoi).
+         */
+        struct block_pool
+        {
+            block_pool() = default;
+            block_pool (const block_pool&) = delete;
+            block_pool& operator= (const block_pool&) = delete;
+            ~block_pool() { for (block_head* b : this->spare) { std::free (b); } }
+
+            //! Each block starts with its size, padded to keep the memory that follows aligned
+            struct alignas(std::max_align_t) block_head { std::size_t size; };
+            //! The blocks that are not in use
+            std::vector<block_head*> spare;
+
+            //! The alloc function for jcv_diagram_generate_useralloc; ctx is the block_pool
+            static void* alloc (void* ctx, std::size_t size)
+            {
+                block_pool* bp = static_cast<block_pool*>(ctx);
+                // The smallest spare block that is big enough
+                auto best = bp->spare.end();
+                for (auto b = bp->spare.begin(); b != bp->spare.end(); ++b) {
+                    if ((*b)->size >= size && (best == bp->spare.end() || (*b)->size < (*best)->size)) { best = b; }
+                }
+                block_head* h = nullptr;
+                if (best != bp->spare.end()) {
+                    h = *best;
+                    *best = bp->spare.back();
+                    bp->spare.pop_back();
+                } else {
+                    h = static_cast<block_head*>(std::malloc (sizeof (block_head) + size));
+                    if (h == nullptr) { throw std::bad_alloc(); }
+                    h->size = size;
+                }
+                return h + 1;
+            }
+
+            //! The free function for jcv_diagram_generate_useralloc
+            static void release (void* ctx, void* p)
+            {
+                if (p == nullptr) { return; }
+                static_cast<block_pool*>(ctx)->spare.push_back (static_cast<block_head*>(p) - 1);
+            }
+        };
+
         //! Have to record the number of triangles in each cell in order to update the colours
         morph::vvec<unsigned int> triangle_counts;
         //! Record the data index for each Voronoi cell index
         morph::vvec<unsigned int> site_indices;
+        //! The number of triangles in the Voronoi cells before each cell
+        morph::vvec<unsigned int> triangle_offsets;
         unsigned int triangle_count_sum = 0;
 
+        //! The memory for the Voronoi diagram
+        block_pool pool;
+        //! The dataCoords that the model was last built from
+        std::vector<morph::vec<float>> coords_last;
+        //! data_z_direction, zoom and border_width when the model was last built
+        std::array<float, 5> geometry_last = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
         //! A copy of the scalarData which can be transformed suitably to be the z value of the surface
         std::vector<float> dcopy;
         //! A copy of the scalarData (or first field of vectorData), scaled to be a colour value
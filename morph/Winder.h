@@ -10,25 +10,31 @@
 
 #pragma once
 
-#include <memory>
+#include <array>
+#include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <stdexcept>
-#include <morph/mathconst.h>
 #include <type_traits>
 #include <morph/trait_tests.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
 
 namespace morph {
 
-    const bool debug_mode = false;
-
     /*!
      * A winding number class
      *
-     * This class contains an algorithm to integrate the angle transected/traversed
-     * (what's the right word?) by a vector (think 'clock hand') drawn from a single
-     * coordinate to, in turn, each coordinate on a boundary path. If the single
-     * coordinate was inside the boundary, the integrated angle sum will be some
-     * multiple of +/-2pi. This gives the 'winding number'.
+     * This class computes the winding number of a closed boundary path about a coordinate:
+     * the number of times the path goes anticlockwise around the coordinate. If the
+     * coordinate is inside the boundary, the winding number is non-zero (+1 for an
+     * anticlockwise boundary, -1 for a clockwise one).
+     *
+     * The winding number is found without trigonometry by counting signed crossings. Each
+     * edge of the path that crosses the horizontal line through the coordinate, passing to
+     * the right of it, adds one if it goes upwards and subtracts one if it goes downwards.
+     * The path is closed with an edge from its last coordinate back to its first.
      *
      * To use, instantiate an object of this class passing the boundary of coordinates
      * that is your path. Then call Winder::wind(const T& coordinate) for some
@@ -50,6 +56,15 @@ namespace morph {
      *  int winding_number = w.wind (pixel);
      *\endcode
      *
+     * To test many points at once, pass them to Winder::contains (or Winder::winding),
+     * which works on a flattened copy of the boundary and vectorises across the points:
+     *
+     *\code{c++}
+     *  morph::vvec<morph::vec<float, 2>> pixels;
+     *  // Code which populates pixels goes here
+     *  morph::vvec<int> inside = w.contains (pixels); // 1 for each pixel inside the path, else 0
+     *\endcode
+     *
      * \tparam T the (2D) coordinate type (this might be cv::Point, morph::BezCoord,
      * morph::vvec, morph::vec, std::array or std::vector)
      *
@@ -69,147 +84,194 @@ namespace morph {
         Winder (const C& _boundary) : boundary(_boundary) {}
 
         //! Compute the winding number of the coordinate px with respect to the boundary.
-        int wind (const T& px) {
-            this->reset();
-            for (auto bp : this->boundary) {
-                this->wind (px, bp);
+        int wind (const T& px) const
+        {
+            if (this->boundary.empty()) { return 0; }
+            const std::array<double, 2> p = Winder<C>::xy (px);
+            const std::array<double, 2> first = Winder<C>::xy (this->boundary.front());
+            std::array<double, 2> p0 = first;
+            int wn = 0;
+            auto bi = this->boundary.begin();
+            for (++bi; bi != this->boundary.end(); ++bi) {
+                const std::array<double, 2> p1 = Winder<C>::xy (*bi);
+                wn += Winder<C>::crossing (p0[0], p0[1], p1[0], p1[1], p[0], p[1]);
+                p0 = p1;
             }
-            // Do first pixel again to complete the winding:
-            T firstpoint = this->boundary.front();
-            this->wind (px, firstpoint);
-            double winding_no_d = std::round (this->angle_sum/morph::mathconst<double>::two_pi);
-            if constexpr (debug_mode == true) { std::cout << "winding_no: " << winding_no_d << std::endl; }
-            int winding_no = static_cast<int>(winding_no_d);
-            return winding_no;
+            // The closing edge, back to the first point
+            wn += Winder<C>::crossing (p0[0], p0[1], first[0], first[1], p[0], p[1]);
+            return wn;
         }
 
-    private:
+        /*!
+         * The winding numbers of the boundary about each of the points \a pts. The boundary
+         * is flattened once per call; the points are then tested in blocks, each edge
+         * against a whole block at a time, so the compiler can vectorise across points.
+         *
+         * For a long boundary, the edges may also be bucketed into \a nbands horizontal
+         * bands, so that each point is tested only against the edges that span its band.
+         * With \a nbands of 0 (the default) the number of bands is chosen from the length
+         * of the boundary; pass 1 to test every point against every edge.
+         */
+        morph::vvec<int> winding (const morph::vvec<morph::vec<float, 2>>& pts, unsigned int nbands = 0) const
+        {
+            morph::vvec<int> wn (pts.size(), 0);
+            if (pts.empty() || this->boundary.empty()) { return wn; }
 
-        //! Convert two coordinate objects (whatever they may be) which define one
-        //! vector (pt) into an angle (using std::atan2) of type double so that the
-        //! method morph::Winder::wind (const double&) may be called.
-        void wind (const T& px, const T& bp) {
-            // Get angle from px to bp. First create pt, the vector pointing from px to
-            // bp whose angle we will calculate.
-            T pt;
-            if constexpr (array_access_possible<T>::value == true) {
-                // In this case, T is a vector or array like thing
-                if constexpr (has_resize_method<T>::value == true) {
-                    // If T has resize(), then we need to resize pt to have size 2
-                    if constexpr (debug_mode == true) { std::cout << "RESIZE\n"; }
-                    pt.resize(2);
-                }
-                if constexpr (has_subtraction<T>::value == true) {
-                    if constexpr (debug_mode == true) { std::cout << "subtraction operator\n"; }
-                    pt = bp - px;
-                } else {
-                    if constexpr (debug_mode == true) { std::cout << "subtracting array elements\n"; }
-                    pt[0] = bp[0] - px[0];
-                    pt[1] = bp[1] - px[1];
-                }
+            // Flatten the boundary into its edges, dropping horizontal ones (which cross nothing)
+            std::vector<float> ex0, ey0, ex1, ey1;
+            const std::array<double, 2> first = Winder<C>::xy (this->boundary.front());
+            std::array<double, 2> p0 = first;
+            auto add_edge = [&](const std::array<double, 2>& a, const std::array<double, 2>& b) {
+                if (static_cast<float>(a[1]) == static_cast<float>(b[1])) { return; }
+                ex0.push_back (static_cast<float>(a[0]));
+                ey0.push_back (static_cast<float>(a[1]));
+                ex1.push_back (static_cast<float>(b[0]));
+                ey1.push_back (static_cast<float>(b[1]));
+            };
+            auto bi = this->boundary.begin();
+            for (++bi; bi != this->boundary.end(); ++bi) {
+                const std::array<double, 2> p1 = Winder<C>::xy (*bi);
+                add_edge (p0, p1);
+                p0 = p1;
+            }
+            add_edge (p0, first);
+            const std::size_t ne = ex0.size();
+            if (ne == 0) { return wn; }
 
-            } else if constexpr (has_firstsecond_members<T>::value == true) {
-                // In this case, T is presumably a std::pair
-                pt.first = bp.first - px.first;
-                pt.second = bp.second - px.second;
+            if (nbands == 0) {
+                nbands = ne < Winder<C>::band_threshold ? 1u : static_cast<unsigned int>(std::sqrt (static_cast<double>(ne)));
+            }
+            const float ymin = std::min (*std::min_element (ey0.begin(), ey0.end()), *std::min_element (ey1.begin(), ey1.end()));
+            const float ymax = std::max (*std::max_element (ey0.begin(), ey0.end()), *std::max_element (ey1.begin(), ey1.end()));
+            const float bandh = (ymax - ymin) / static_cast<float>(nbands);
+            auto band_of = [ymin, bandh, nbands](const float y) {
+                if (!(bandh > 0.0f)) { return 0; }
+                const int b = static_cast<int>(std::floor ((y - ymin) / bandh));
+                return std::clamp (b, 0, static_cast<int>(nbands) - 1);
+            };
 
-            } else {
-                // cv::Point, morph::BezCoord should fall through here.
-                if constexpr (has_subtraction<T>::value == true) {
-                    if constexpr (debug_mode == true) { std::cout << "has subtraction\n"; }
-                    pt = bp - px;
-                } else if constexpr (has_xy_members<T>::value == true) {
-                    pt.x = bp.x - px.x;
-                    pt.y = bp.y - px.y;
-                } else {
-                    throw std::runtime_error ("Template code failed to find out how to subtract one coordinate from another.");
+            // Each band's edges, in the SoA layout the inner loop wants
+            struct band_edges { std::vector<float> x0, y0, x1, y1; };
+            std::vector<band_edges> bands (nbands);
+            for (std::size_t e = 0; e < ne; ++e) {
+                const int b0 = band_of (std::min (ey0[e], ey1[e]));
+                const int b1 = band_of (std::max (ey0[e], ey1[e]));
+                for (int b = b0; b <= b1; ++b) {
+                    bands[b].x0.push_back (ex0[e]);
+                    bands[b].y0.push_back (ey0[e]);
+                    bands[b].x1.push_back (ex1[e]);
+                    bands[b].y1.push_back (ey1[e]);
                 }
             }
 
-            // Now compute the angle of the vector pt using std::atan2. Multiple specializations here, too.
-            double raw_angle = 0.0;
-            if constexpr (has_xy_methods<T>::value == true) {
-                if constexpr (debug_mode == true) { std::cout << "It's a type with x() and y() functions\n"; }
-                raw_angle = std::atan2 (pt.y(), pt.x());
-            } else if constexpr (has_xy_members<T>::value == true) {
-                if constexpr (debug_mode == true) { std::cout << "It's a type with x and y member attributes\n"; }
-                raw_angle = std::atan2 (pt.y, pt.x);
-            } else if constexpr (has_firstsecond_members<T>::value == true) {
-                if constexpr (debug_mode == true) { std::cout << "It's a type with first and second member attributes\n"; }
-                raw_angle = std::atan2 (pt.second, pt.first);
-            } else if constexpr (array_access_possible<T>::value == true) {
-                if constexpr (debug_mode == true) { std::cout << "It's a type with array access\n"; }
-                raw_angle = std::atan2 (pt[1], pt[0]);
-            } else {
-                if constexpr (debug_mode == true) { std::cout << "Maybe it's a type that behaves like an array\n"; }
-                raw_angle = std::atan2 (pt[1], pt[0]);
+            // Group the points by band. Points above or below the boundary are outside.
+            std::vector<int> pband (pts.size(), -1);
+            std::vector<std::size_t> start (nbands + 1, 0);
+            for (std::size_t i = 0; i < pts.size(); ++i) {
+                const float y = pts[i][1];
+                if (y < ymin || y >= ymax) { continue; }
+                pband[i] = band_of (y);
+                ++start[pband[i] + 1];
+            }
+            for (unsigned int b = 0; b < nbands; ++b) { start[b + 1] += start[b]; }
+            std::vector<std::uint32_t> order (start[nbands]);
+            {
+                std::vector<std::size_t> fill (start.begin(), start.end() - 1);
+                for (std::size_t i = 0; i < pts.size(); ++i) {
+                    if (pband[i] >= 0) { order[fill[pband[i]]++] = static_cast<std::uint32_t>(i); }
+                }
             }
 
-            this->wind (raw_angle);
+            // Work through the blocks of each band in parallel
+            std::vector<std::pair<unsigned int, std::size_t>> blocks;
+            for (unsigned int b = 0; b < nbands; ++b) {
+                for (std::size_t s = start[b]; s < start[b + 1]; s += Winder<C>::block) { blocks.push_back ({ b, s }); }
+            }
+            const long long nblocks = static_cast<long long>(blocks.size());
+#pragma omp parallel for schedule(dynamic)
+            for (long long k = 0; k < nblocks; ++k) {
+                const band_edges& be = bands[blocks[k].first];
+                const std::size_t s = blocks[k].second;
+                const std::size_t n = std::min (Winder<C>::block, start[blocks[k].first + 1] - s);
+                float px[Winder<C>::block];
+                float py[Winder<C>::block];
+                int w[Winder<C>::block];
+                for (std::size_t j = 0; j < n; ++j) {
+                    px[j] = pts[order[s + j]][0];
+                    py[j] = pts[order[s + j]][1];
+                    w[j] = 0;
+                }
+                for (std::size_t e = 0; e < be.x0.size(); ++e) {
+                    const float x0 = be.x0[e];
+                    const float y0 = be.y0[e];
+                    const float dx = be.x1[e] - x0;
+                    const float dy = be.y1[e] - y0;
+                    const float y1 = be.y1[e];
+#pragma omp simd
+                    for (std::size_t j = 0; j < n; ++j) {
+                        const float l = dx * (py[j] - y0) - (px[j] - x0) * dy;
+                        const int up = (y0 <= py[j]) & (y1 > py[j]) & (l > 0.0f);
+                        const int down = (y1 <= py[j]) & (y0 > py[j]) & (l < 0.0f);
+                        w[j] += up - down;
+                    }
+                }
+                for (std::size_t j = 0; j < n; ++j) { wn[order[s + j]] = w[j]; }
+            }
+            return wn;
         }
 
-        //! Update this->angle, this->angle_last and this->angle_sum based on \a
-        //! raw_angle. Note that there is no template specialization in this method;
-        //! all the specialization is in morph::Winder::wind (const T&, const T&).
-        void wind (const double& raw_angle) {
+        //! For each of the points \a pts, 1 if the boundary winds around it, else 0. See winding().
+        morph::vvec<int> contains (const morph::vvec<morph::vec<float, 2>>& pts, unsigned int nbands = 0) const
+        {
+            morph::vvec<int> in = this->winding (pts, nbands);
+            for (int& i : in) { i = i != 0 ? 1 : 0; }
+            return in;
+        }
 
-            // Convert the raw angle which has range -pi -> 0 -> +pi into a tansformed angle with range 0->2pi:
-            this->angle = raw_angle >= 0 ? raw_angle : (morph::mathconst<double>::two_pi + raw_angle);
-            if constexpr (morph::debug_mode == true) { std::cout << "angle: " << this->angle << "\n"; }
+    private:
+        //! The number of points tested together against each edge in winding()
+        static constexpr std::size_t block = 256;
+        //! winding() buckets the edges of boundaries with at least this many edges by default
+        static constexpr std::size_t band_threshold = 64;
 
-            // Set the initial angle.
-            if (this->angle_last == double{-100.0}) {
-                this->angle_last = angle;
+        /*!
+         * The contribution to the winding number about (px,py) of the edge from (x0,y0) to
+         * (x1,y1): +1 if it crosses upwards to the right of the point, -1 if it crosses
+         * downwards to the right of it, else 0. An edge 'crosses' if py lies in [y0,y1)
+         * (or [y1,y0)), so a path passing through a vertex at the point's height is
+         * counted once.
+         */
+        static int crossing (const double x0, const double y0, const double x1, const double y1,
+                             const double px, const double py)
+        {
+            const double l = (x1 - x0) * (py - y0) - (px - x0) * (y1 - y0);
+            if (y0 <= py) {
+                if (y1 > py && l > 0.0) { return 1; }
+            } else if (y1 <= py && l < 0.0) {
+                return -1;
             }
+            return 0;
+        }
 
-            // Compute the change in angle, delta
-            double delta = double{0.0}; // delta is 'angle change'
-            if (this->angle == double{0.0}) {
-                // Special treatment
-                if (this->angle_last > morph::mathconst<double>::pi) {
-                    // Clockwise to 0
-                    delta = (morph::mathconst<double>::two_pi - this->angle_last);
-                } else if (this->angle_last < morph::mathconst<double>::pi) {
-                    // Anti-clockwise to 0
-                    delta = -this->angle_last;
-                } else { //angle_last must have been 0.0
-                    delta = double{0.0};
-                }
-
+        //! Get the x and y components of a coordinate, whatever its type
+        static std::array<double, 2> xy (const T& p)
+        {
+            if constexpr (has_xy_methods<T>::value == true) {
+                return { static_cast<double>(p.x()), static_cast<double>(p.y()) };
+            } else if constexpr (has_xy_members<T>::value == true) {
+                return { static_cast<double>(p.x), static_cast<double>(p.y) };
+            } else if constexpr (has_firstsecond_members<T>::value == true) {
+                return { static_cast<double>(p.first), static_cast<double>(p.second) };
+            } else if constexpr (array_access_possible<T>::value == true) {
+                return { static_cast<double>(p[0]), static_cast<double>(p[1]) };
             } else {
-
-                // Special treatment required ALSO if we crossed the 0 line without being on it.
-                if (this->angle_last > morph::mathconst<double>::pi && this->angle < morph::mathconst<double>::pi) {
-                    // crossed from 2pi side to 0 side: Clockwise
-                    delta = this->angle + (morph::mathconst<double>::two_pi - this->angle_last);
-                } else if (this->angle_last < morph::mathconst<double>::pi_over_2 && this->angle > morph::mathconst<double>::three_pi_over_2) {
-                    // crossed from 0 side to 2pi side: Anti-clockwise
-                    delta = - this->angle_last - (morph::mathconst<double>::two_pi - this->angle);
-                } else { // Both are > pi or both are < pi.
-                    delta = (this->angle - this->angle_last);
-                }
+                // Maybe it's a type that behaves like an array
+                return { static_cast<double>(p[0]), static_cast<double>(p[1]) };
             }
-
-            // Update angle_last and angle_sum
-            this->angle_last = this->angle;
-            this->angle_sum += delta;
-        }
-
-        //! Reset the angle member variables
-        void reset() {
-            this->angle_last = double{-100.0};
-            this->angle = double{0.0};
-            this->angle_sum = double{0.0};
         }
 
         //! Member reference to the boundary
         const C& boundary;
-        //! Current angle around a point
-        double angle;
-        //! The sum of angles
-        double angle_sum;
-        //! The angle of the last boundary point
-        double angle_last;
     };
 
 } // namespace morph
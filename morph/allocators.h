@@ -0,0 +1,185 @@
+/*!
+ * \file
+ * \brief Allocators to use with morph::vvec (or any std container).
+ *
+ * morph::aligned_allocator returns memory aligned to 64 bytes (by default), which is the width
+ * of an AVX-512 register and of a cache line on most current CPUs.
+ *
+ * morph::pool_allocator is for short-lived containers, such as the temporary vvecs made in inner
+ * loops. It keeps freed blocks in a per-thread cache and hands them out again, instead of going to
+ * the heap each time.
+ *
+ *\code{.cpp}
+ * morph::vvec<float, morph::aligned_allocator<float>> a (1000); // a.data() is 64 byte aligned
+ * morph::vvec<float, morph::pool_allocator<float>> tmp (1000);  // re-uses a cached block
+ *\endcode
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <new>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+namespace morph {
+
+    /*!
+     * An allocator that aligns its memory to Alignment bytes
+     *
+     * \tparam T The type to allocate
+     *
+     * \tparam Alignment The alignment in bytes. A power of two, at least alignof(T).
+     */
+    template <typename T, std::size_t Alignment = 64>
+    struct aligned_allocator
+    {
+        static_assert ((Alignment & (Alignment - 1)) == 0, "aligned_allocator: Alignment must be a power of two");
+        static_assert (Alignment >= alignof(T), "aligned_allocator: Alignment must be at least alignof(T)");
+
+        using value_type = T;
+        using is_always_equal = std::true_type;
+
+        template <typename U>
+        struct rebind { using other = aligned_allocator<U, Alignment>; };
+
+        aligned_allocator() noexcept = default;
+        template <typename U>
+        aligned_allocator (const aligned_allocator<U, Alignment>&) noexcept {}
+
+        T* allocate (const std::size_t n)
+        {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) { throw std::bad_array_new_length(); }
+            return static_cast<T*>(::operator new (n * sizeof(T), std::align_val_t{Alignment}));
+        }
+
+        void deallocate (T* p, const std::size_t) noexcept
+        {
+            ::operator delete (p, std::align_val_t{Alignment});
+        }
+
+        template <typename U>
+        bool operator== (const aligned_allocator<U, Alignment>&) const noexcept { return true; }
+        template <typename U>
+        bool operator!= (const aligned_allocator<U, Alignment>&) const noexcept { return false; }
+    };
+
+    /*!
+     * The per-thread cache of freed blocks used by pool_allocator. Blocks are kept in size classes
+     * of powers of two bytes, from 64 bytes (class 0) upwards, with at most max_blocks blocks per
+     * class. All blocks are 64 byte aligned. Blocks larger than the biggest class are not cached.
+     *
+     * A block may be freed by a different thread from the one that allocated it; it then goes
+     * into the cache of the thread that frees it.
+     */
+    struct block_pool
+    {
+        static constexpr std::size_t alignment = 64;
+        static constexpr std::size_t min_bytes = 64;
+        static constexpr unsigned int n_classes = 24; // up to 64 << 23 bytes = 512 MB
+        static constexpr std::size_t max_blocks = 16;
+
+        //! This thread's pool
+        static block_pool& i()
+        {
+            thread_local block_pool pool;
+            return pool;
+        }
+
+        ~block_pool()
+        {
+            for (auto& c : this->cache) {
+                for (void* p : c) { ::operator delete (p, std::align_val_t{alignment}); }
+            }
+        }
+
+        //! The size class for a block of nbytes, or n_classes if it is too big to cache
+        static unsigned int size_class (const std::size_t nbytes)
+        {
+            unsigned int c = 0;
+            std::size_t b = min_bytes;
+            while (b < nbytes && c < n_classes) { b <<= 1; ++c; }
+            return c;
+        }
+
+        void* get (const std::size_t nbytes)
+        {
+            const unsigned int c = block_pool::size_class (nbytes);
+            if (c >= n_classes) { return ::operator new (nbytes, std::align_val_t{alignment}); }
+            if (!this->cache[c].empty()) {
+                void* p = this->cache[c].back();
+                this->cache[c].pop_back();
+                return p;
+            }
+            return ::operator new (min_bytes << c, std::align_val_t{alignment});
+        }
+
+        void put (void* p, const std::size_t nbytes) noexcept
+        {
+            const unsigned int c = block_pool::size_class (nbytes);
+            if (c < n_classes && this->cache[c].size() < max_blocks) {
+                try {
+                    this->cache[c].push_back (p);
+                    return;
+                } catch (...) {} // Could not grow the cache; free the block instead
+            }
+            ::operator delete (p, std::align_val_t{alignment});
+        }
+
+        //! The number of blocks that are cached now, over all size classes
+        std::size_t cached() const
+        {
+            std::size_t n = 0;
+            for (const auto& c : this->cache) { n += c.size(); }
+            return n;
+        }
+
+        //! Free all the cached blocks
+        void clear()
+        {
+            for (auto& c : this->cache) {
+                for (void* p : c) { ::operator delete (p, std::align_val_t{alignment}); }
+                c.clear();
+            }
+        }
+
+    private:
+        std::array<std::vector<void*>, n_classes> cache;
+    };
+
+    /*!
+     * An allocator that takes its memory from the calling thread's block_pool. Freed memory is
+     * returned to the pool for re-use rather than to the heap. This suits containers that are
+     * repeatedly made and destroyed with similar sizes. The memory is 64 byte aligned.
+     */
+    template <typename T>
+    struct pool_allocator
+    {
+        static_assert (alignof(T) <= block_pool::alignment, "pool_allocator: type is over-aligned");
+
+        using value_type = T;
+        using is_always_equal = std::true_type;
+
+        pool_allocator() noexcept = default;
+        template <typename U>
+        pool_allocator (const pool_allocator<U>&) noexcept {}
+
+        T* allocate (const std::size_t n)
+        {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) { throw std::bad_array_new_length(); }
+            return static_cast<T*>(block_pool::i().get (n * sizeof(T)));
+        }
+
+        void deallocate (T* p, const std::size_t n) noexcept { block_pool::i().put (p, n * sizeof(T)); }
+
+        template <typename U>
+        bool operator== (const pool_allocator<U>&) const noexcept { return true; }
+        template <typename U>
+        bool operator!= (const pool_allocator<U>&) const noexcept { return false; }
+    };
+
+} // namespace morph
@@ -12,7 +12,14 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <morph/bn/Genome.h>
+#include <morph/bn/GeneNet.h>
 
 namespace morph {
     namespace bn {
@@ -45,7 +52,7 @@ namespace morph {
             //! maps of StateNodes.
             state_t id;
             //! The parents of the base node, which feed into it.
-            set<state_t> parents;
+            std::set<state_t> parents;
             //! the child StateNode
             state_t child;
         };
@@ -61,7 +68,6 @@ namespace morph {
              */
             void merge (const BasinOfAttraction& other)
             {
-                this->flags |= other.flags;
                 // merge other.nodes into this->nodes
                 typename std::map<state_t, StateNode>::iterator mi = this->nodes.begin();
                 // Add parents from other states to parents of this
@@ -74,30 +80,31 @@ namespace morph {
                     ++mi;
                 }
                 // THEN add any states in other.nodes that don't exist in this.
-                map<state_t, StateNode>::const_iterator cmi = other.nodes.begin();
+                std::map<state_t, StateNode>::const_iterator cmi = other.nodes.begin();
                 while (cmi != other.nodes.end()) {
                     // cmi->first is the state_t id of a node in the other basin of
                     // attraction.
                     if (this->nodes.count (cmi->first) == 0) {
-                        this->nodes.insert (make_pair(cmi->first, cmi->second));
+                        this->nodes.insert (std::make_pair(cmi->first, cmi->second));
                     }
                     ++cmi;
                 }
                 //DBGF ("After merge, this->nodes.size() = " << this->nodes.size());
             }
 
-            //! An "output for debugging" method
+            //! An "output for debugging" method, for states of N genes
+            template <std::size_t N=5>
             void debug() const
             {
                 std::cout << "----------------------Basin-output-begin---------------------------" << std::endl;
                 std::cout << "Basin of attraction with the attractor:" << std::endl;
                 std::set<state_t>::const_iterator si = this->limitCycle.begin();
                 while (si != this->limitCycle.end()) {
-                    std::cout << "  " << state_str (*si) << std::endl;
+                    std::cout << "  " << GeneNet<N,N>::state_str (*si) << std::endl;
                     si++;
                 }
                 std::cout << "Branches:" << std::endl;
-                map<state_t, StateNode>::const_iterator mi = this->nodes.begin();
+                std::map<state_t, StateNode>::const_iterator mi = this->nodes.begin();
                 while (mi != this->nodes.end()) {
                     if (mi->second.parents.empty()) {
                         // Then this is an "outer node" on the basin. Show
@@ -105,14 +112,14 @@ namespace morph {
                         state_t state = mi->first;
                         StateNode sn = mi->second;
                         while (this->limitCycle.count(state) == 0) {
-                            std::cout << " --> " << state_str (state) << "(" << (unsigned int)state << ")";
+                            std::cout << " --> " << GeneNet<N,N>::state_str (state) << "(" << (unsigned int)state << ")";
                             state = sn.child;
                             sn = this->nodes.at (state);
                         }
-                        set<state_t>::const_iterator si = this->limitCycle.begin();
+                        std::set<state_t>::const_iterator si = this->limitCycle.begin();
                         std::cout << " -->* ";
                         while (si != this->limitCycle.end()) {
-                            std::cout << state_str (*si) << "("<< (unsigned int)state << "):";
+                            std::cout << GeneNet<N,N>::state_str (*si) << "("<< (unsigned int)state << "):";
                             ++si;
                         }
                         std::cout << std::endl;
@@ -124,7 +131,7 @@ namespace morph {
                 std::cout << "Transitions in basin:" << std::endl;
                 mi = this->nodes.begin();
                 while (mi != this->nodes.end()) {
-                    std::cout << state_str(mi->second.id) << " --> " << state_str(mi->second.child) << std::endl;
+                    std::cout << GeneNet<N,N>::state_str(mi->second.id) << " --> " << GeneNet<N,N>::state_str(mi->second.child) << std::endl;
                     ++mi;
                 }
                 std::cout << "-----------------------Basin-output-end----------------------------" << std::endl;
@@ -168,6 +175,8 @@ namespace morph {
         template <std::size_t N=5, std::size_t K=N>
         struct AllBasins
         {
+            AllBasins() {}
+
             AllBasins (const Genome<N,K>& g)
             {
                 this->update (g);
@@ -179,7 +188,7 @@ namespace morph {
                 this->basins.clear();
                 this->attractorSizes.clear();
                 this->transitions.clear();
-                find_basins_of_attraction (this->genome, this->basins);
+                this->find_basins_of_attraction();
                 std::vector<BasinOfAttraction>::const_iterator i = this->basins.begin();
                 while (i != basins.end()) {
                     std::set<unsigned int> tset = i->getTransitionSet();
@@ -189,106 +198,64 @@ namespace morph {
                 }
             }
 
-            //! Find all the basins of attraction for the given genome.
+            /*!
+             * Find all the basins of attraction for the given genome.
+             *
+             * Every state is labelled with its basin as it is reached, in a flat table
+             * indexed by state. A trajectory stops as soon as it reaches a labelled state, so
+             * each state is stepped from exactly once and the whole job is O(2^N).
+             */
             void find_basins_of_attraction()
             {
-                for (state_t s = 0; s < (1<<N); ++s) {
-
-                    // First check if s is in any of the basins we already computed.
-                    bool s_encountered = false;
-                    typename std::vector<BasinOfAttraction>::iterator bi = this->basins.begin();
-                    while (bi != this->basins.end()) {
-                        if (bi->nodes.count(s) > 0) {
-                            s_encountered = true;
-                            break;
-                        }
-                        ++bi;
-                    }
-                    if (s_encountered == true) {
-                        continue; // on to next s
+                // Tabulate the next state of every state with one bit-sliced develop
+                const typename GeneNet<N,K>::transition_table next = GeneNet<N,K>::next_state_table (this->genome);
+
+                // label[s] is 1 + the index into basins of the basin containing s, 0 if s has
+                // not yet been reached, or on_path while s is on the current trajectory.
+                static constexpr std::uint32_t on_path = std::numeric_limits<std::uint32_t>::max();
+                std::vector<std::uint32_t> label (GeneNet<N,K>::n_states, 0);
+                std::vector<state_t> path;
+                path.reserve (GeneNet<N,K>::n_states);
+
+                for (unsigned int si = 0; si < GeneNet<N,K>::n_states; ++si) {
+                    if (label[si] != 0) { continue; } // s is in a basin we already found
+
+                    // Follow the trajectory from s until it reaches a labelled state
+                    path.clear();
+                    state_t st = static_cast<state_t>(si);
+                    while (label[st] == 0) {
+                        label[st] = on_path;
+                        path.push_back (st);
+                        st = next[st];
                     }
 
-                    // A new basin of attraction that we'll find.
-                    BasinOfAttraction basin;
-                    // A copy of starting point s.
-                    state_t st = s;
-                    state_t next_st = state_t_unset;
-                    state_t last_st = state_t_unset;
-
-                    unsigned int saw_flags = 0x0;
-
-                    for (;;) {
-                        // For the current state, st, compute what the next state will be.
-                        next_st = st;
-                        // Becomes.. GeneNet.develop()
-                        compute_next (genome, next_st);
-
-                        // Create state node
-                        StateNode stnode(st); // node for current state.
-                        stnode.child = next_st; // Mark the child state
-                        if (last_st != state_t_unset) {
-                            stnode.parents.insert (last_st);
-                        }
-
-                        if (basin.nodes.count (st) > 0) {
-                            // Already visited this state so it's in an attractor
-                            //DBG2 ("Repeat st " << state_str(st) << "!");
-                            if (st == last_st) {
-                                // It's a point attractor
-                                //DBGF("fixed point attractor");
-                                basin.endpoint = endpoint::point;
-                                // Which means it's its own parent. Set parent of the node that's ALREADY BEEN added to basin.
-                                basin.nodes.find(st)->second.parents.insert (st);
-                                basin.limitCycle.insert (st);
-                            } else {
-                                // It's a limit cycle.
-                                //DBGF("limit cycle attractor");
-                                // Go around the limit cycle to determine its identity, which is a set of states.
-                                basin.endpoint = endpoint::limit;
-                                // Update the parent of the copy of this state that's already in the basin object
-                                basin.nodes.find(st)->second.parents.insert (last_st);
-
-                                // Cycle around filling the limit cycle set in basin.limitCycle
-                                state_t lc = st;
-                                for (;;) {
-                                    basin.limitCycle.insert (lc);
-                                    state_t c = basin.nodes.find (lc)->second.child;
-                                    if (c == st) {
-                                        // We're back to the start
-                                        break;
-                                    } else {
-                                        lc = c;
-                                    }
-                                }
-                            }
-
-                            break;
-                        }
-
-                        // Insert it into basin
-                        basin.nodes.insert (make_pair (st, stnode));
-                        //DBG2 ("Inserting " << state_str (st));
-
-                        // Update last_st and st
-                        last_st = st;
-                        st = next_st;
+                    std::uint32_t bi = 0;
+                    if (label[st] == on_path) {
+                        // The trajectory came back on itself at st, so st is on a new attractor
+                        bi = static_cast<std::uint32_t>(this->basins.size());
+                        this->basins.emplace_back();
+                        BasinOfAttraction& basin = this->basins.back();
+                        basin.endpoint = next[st] == st ? endpoint::point : endpoint::limit;
+                        state_t lc = st;
+                        do {
+                            basin.limitCycle.insert (lc);
+                            lc = next[lc];
+                        } while (lc != st);
+                    } else {
+                        // The trajectory ran into a basin we already have
+                        bi = label[st] - 1;
                     }
 
-                    // Now see if our basin is already present in basins, and if not, simply push_back.
-                    bool found = false;
-                    bi = thish->basins.begin();
-                    while (bi != this->basins.end()) {
-                        // Nice thing with sets is that we can directly compare them.
-                        if (basin.limitCycle == bi->limitCycle) {
-                            // Merge basin into bi->second, because this limitCycle was already found.
-                            bi->merge (basin);
-                            found = true;
-                            break;
-                        }
-                        ++bi;
+                    // Add the trajectory's states to the basin, then link each to its child
+                    BasinOfAttraction& basin = this->basins[bi];
+                    for (state_t p : path) {
+                        label[p] = bi + 1;
+                        StateNode stnode (p);
+                        stnode.child = next[p];
+                        basin.nodes.insert (std::make_pair (p, stnode));
                     }
-                    if (!found) {
-                       this->basins.push_back (basin);
+                    for (state_t p : path) {
+                        basin.nodes.find (next[p])->second.parents.insert (p);
                     }
                 }
             }
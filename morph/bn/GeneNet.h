@@ -16,6 +16,7 @@
 #include <bitset>
 #include <list>
 #include <cstddef>
+#include <cstdint>
 #include <immintrin.h> // Using intrinsics for computing Hamming distances
 #include <morph/bn/Genome.h>
 
@@ -208,6 +209,107 @@ namespace morph {
                 }
             }
 
+            /*!
+             * A bit-sliced batch of 64 L states. planes[s] holds bit s of every state, one
+             * state per bit lane: lane j of the batch is bit (j % 64) of word j / 64. With L =
+             * 4, each plane is 256 bits and the loops over words vectorise to AVX2.
+             */
+            template <std::size_t L = 1>
+            using state_planes = std::array<std::array<std::uint64_t, L>, N>;
+
+            /*!
+             * Develop all 64 L states in planes at once; the bit-sliced equivalent of
+             * develop(). Gene i's next value is its genome section read as a truth table,
+             * indexed by its K inputs. Here the table is evaluated as a tree of 2^K - 1
+             * multiplexers, each of which selects, lane by lane, between two halves of the
+             * table according to one input plane. Input bit b of gene i is state bit (b - i)
+             * mod N (see setup_inputs()).
+             */
+            template <std::size_t L>
+            static void develop_sliced (state_planes<L>& planes, const Genome<N, K>& genome)
+            {
+                static_assert (K >= 1);
+                state_planes<L> next;
+                std::array<std::array<std::uint64_t, L>, (1 << (K - 1))> v;
+                for (unsigned int i = 0; i < N; ++i) {
+                    const genosect_t gs = genome[i];
+                    // The leaves are truth table bits j, all ones or all zeros; the first
+                    // level of muxes selects between pairs of them with input bit 0.
+                    const std::array<std::uint64_t, L>& x0 = planes[(N - i) % N];
+                    for (unsigned int m = 0; m < (1u << (K - 1)); ++m) {
+                        const std::uint64_t c0 = ((gs >> (2 * m)) & 0x1) ? ~std::uint64_t{0} : std::uint64_t{0};
+                        const std::uint64_t c1 = ((gs >> (2 * m + 1)) & 0x1) ? ~std::uint64_t{0} : std::uint64_t{0};
+                        for (std::size_t l = 0; l < L; ++l) { v[m][l] = c0 ^ (x0[l] & (c0 ^ c1)); }
+                    }
+                    for (unsigned int b = 1; b < K; ++b) {
+                        const std::array<std::uint64_t, L>& x = planes[(b + N - i) % N];
+                        for (unsigned int m = 0; m < (1u << (K - 1 - b)); ++m) {
+                            for (std::size_t l = 0; l < L; ++l) {
+                                v[m][l] = v[2 * m][l] ^ (x[l] & (v[2 * m][l] ^ v[2 * m + 1][l]));
+                            }
+                        }
+                    }
+                    next[N - i - 1] = v[0];
+                }
+                planes = next;
+            }
+
+            //! Pack the states in[0..n-1] (n <= 64 L) into the lanes of planes. Unused lanes are 0.
+            template <std::size_t L>
+            static void pack (const state_t* in, const std::size_t n, state_planes<L>& planes)
+            {
+                for (auto& p : planes) { p.fill (0); }
+                for (std::size_t j = 0; j < n; ++j) {
+                    for (unsigned int s = 0; s < N; ++s) {
+                        planes[s][j / 64] |= static_cast<std::uint64_t>((in[j] >> s) & 0x1) << (j % 64);
+                    }
+                }
+            }
+
+            //! Unpack lanes 0..n-1 of planes into the states out[0..n-1]
+            template <std::size_t L>
+            static void unpack (const state_planes<L>& planes, const std::size_t n, state_t* out)
+            {
+                for (std::size_t j = 0; j < n; ++j) {
+                    state_t st = 0;
+                    for (unsigned int s = 0; s < N; ++s) {
+                        st |= static_cast<state_t>(((planes[s][j / 64] >> (j % 64)) & 0x1) << s);
+                    }
+                    out[j] = st;
+                }
+            }
+
+            //! The number of possible states, 2^N
+            static constexpr std::size_t n_states = std::size_t{1} << N;
+
+            //! A next-state lookup table: table[s] is the state that s develops into
+            using transition_table = std::array<state_t, n_states>;
+
+            /*!
+             * Tabulate the next state of every one of the 2^N states for genome, with one
+             * bit-sliced develop. Then each developmental step is table[state], which is
+             * worthwhile whenever a genome is developed more than a few times.
+             */
+            static transition_table next_state_table (const Genome<N, K>& genome)
+            {
+                constexpr std::size_t L = (n_states + 63) / 64;
+                state_planes<L> planes;
+                // Lane j holds state j, so bit s of lane j is bit s of j
+                constexpr std::array<std::uint64_t, 6> counting = {
+                    0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+                    0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+                };
+                for (unsigned int s = 0; s < N; ++s) {
+                    for (std::size_t w = 0; w < L; ++w) {
+                        planes[s][w] = s < 6 ? counting[s] : (((w << 6) >> s) & 0x1 ? ~std::uint64_t{0} : std::uint64_t{0});
+                    }
+                }
+                GeneNet<N,K>::develop_sliced (planes, genome);
+                transition_table table;
+                GeneNet<N,K>::unpack (planes, n_states, table.data());
+                return table;
+            }
+
             //! Choose one gene out of N to update at random. Can't be static, uses RNG.
             void develop_async (const Genome<N, K>& genome, state_t& state)
             {
@@ -4,6 +4,9 @@
 #include <morph/bn/Genome.h>
 #include <morph/bn/GeneNet.h>
 #include <set>
+#include <bitset>
+#include <array>
+#include <cmath>
 #include <cstddef>
 
 namespace morph {
@@ -70,18 +73,24 @@ namespace morph {
              * Evaluates the fitness of one context (anterior or posterior in the
              * 2-context system).
              */
-            double evaluate_one (const Genome<N,K>& genome, state_t state, state_t target)
+            double evaluate_one (const Genome<N,K>& genome, state_t state, state_t target) const
+            {
+                return this->evaluate_one (GeneNet<N,K>::next_state_table (genome), state, target);
+            }
+
+            //! Evaluate the fitness of one context, given the genome's next_state_table()
+            double evaluate_one (const typename GeneNet<N,K>::transition_table& next, state_t state, state_t target) const
             {
                 double score = 0.0;
 
                 state_t state_last = GeneNet<N,K>::state_t_unset;
-                std::set<state_t> visited;
-                visited.insert (state); // insert starting state
+                std::bitset<GeneNet<N,K>::n_states> visited;
+                visited.set (state); // insert starting state
                 for (;;) {
                     state_last = state;
-                    GeneNet<N,K>::develop (state, genome);
+                    state = next[state];
 
-                    if (visited.count (state)) {
+                    if (visited.test (state)) {
 
                         // Already visited this state so it's a limit cycle or point attractor
 
@@ -92,29 +101,21 @@ namespace morph {
                         } else { // Limit cycle
 
                             // Determine the states in the limit cycle by going around it once more.
-                            std::set<state_t> lc;
+                            std::bitset<GeneNet<N,K>::n_states> lc;
                             unsigned int lc_len = 0;
-                            while (lc.count (state) == 0) {
-                                // Check if we have one or both target states on this limit cycle
-                                lc.insert (state);
-                                lc_len++;
-                                // DBGF ("Limit cycle contains: " << state_str (state));
-                                GeneNet<N,K>::develop (state, genome);
-                            }
-
-                            // Now have the set lc; can work out its score.
 
                             // For tabulating the scores
                             std::array<double, N> sc;
                             for (unsigned int j = 0; j < N; ++j) { sc[j] = 0.0; }
 
-                            std::set<state_t>::const_iterator i = lc.begin();
-                            while (i != lc.end()) {
-                                state_t a = ((*i) ^ ~target) & GeneNet<N,K>::state_mask;
+                            while (!lc.test (state)) {
+                                lc.set (state);
+                                lc_len++;
+                                state_t a = (state ^ ~target) & GeneNet<N,K>::state_mask;
                                 for (unsigned int j = 0; j < N; ++j) {
                                     sc[j] += static_cast<double>( (a >> j) & 0x1 );
                                 }
-                                ++i;
+                                state = next[state];
                             }
 
                             double expnt = N * -1.0;
@@ -125,7 +126,7 @@ namespace morph {
                         }
                         break;
                     }
-                    visited.insert (state);
+                    visited.set (state);
                 }
 
                 return score;
@@ -157,14 +158,16 @@ namespace morph {
              * Reports paper "Limit cycle dynamics can guide the evolution of gene
              * regulatory networks towards point attractors" (2019)
              */
-            double evaluate_fitness (const Genome<N,K>& genome)
+            double evaluate_fitness (const Genome<N,K>& genome) const
             {
                 if constexpr (debug == true) {
                     std::cout << "target_ant = " << static_cast<unsigned int>(target_ant) << std::endl;
                     std::cout << "target_pos = " << static_cast<unsigned int>(target_pos) << std::endl;
                 }
-                double ant_score = this->evaluate_one (genome, initial_ant, this->target_ant);
-                double pos_score = this->evaluate_one (genome, initial_pos, this->target_pos);
+                // One table serves both contexts
+                const typename GeneNet<N,K>::transition_table next = GeneNet<N,K>::next_state_table (genome);
+                double ant_score = this->evaluate_one (next, initial_ant, this->target_ant);
+                double pos_score = this->evaluate_one (next, initial_pos, this->target_pos);
                 if constexpr (debug == true) {
                     std::cout << "score ant = " << ant_score << std::endl;
                     std::cout << "score pos = " << pos_score << std::endl;
@@ -180,20 +183,23 @@ namespace morph {
             }
 
             //! Evolve a new genome by repeatedly mutating with bitflip probability p
-            Genome<N,K> evolve_new_genome (float p)
+            Genome<N,K> evolve_new_genome (float p) { return this->evolve_new_genome (p, *Random<N,K>::i()); }
+
+            //! Evolve a new genome, drawing the random numbers from rng
+            Genome<N,K> evolve_new_genome (float p, Random<N,K>& rng)
             {
                 // Holds the genome and a copy of it.
                 Genome<N,K> refg;
                 Genome<N,K> newg;
 
-                refg.randomize();
+                refg.randomize (rng);
                 double a = this->evaluate_fitness (refg);
 
                 unsigned int gen = 0;
                 // Test fitness to determine whether we should evolve.
                 while (a < 1.0) {
                     newg = refg;
-                    newg.mutate (p);
+                    newg.mutate (p, rng);
                     ++gen;
                     double b = this->evaluate_fitness (newg);
                     if (a > b) {
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <sstream>
 #include <cstddef>
+#include <cmath>
 #include <immintrin.h>
 #include <morph/tools.h>
 #include <morph/bn/Random.h>
@@ -215,44 +216,62 @@ namespace morph {
             static constexpr std::size_t width = N*(1<<K);
 
             //! Mutate this genome with bit flip probability p
-            void mutate (const float& p)
+            void mutate (const float& p) { this->mutate (p, *Random<N,K>::i()); }
+
+            /*!
+             * Mutate this genome with bit flip probability p, using the generators in rng.
+             *
+             * Rather than drawing a random number for each of the width bits, this draws the
+             * gaps between the bits that flip, which are geometrically distributed. That's one
+             * frng call per flip (plus one), so with p = 0.01 a 160 bit genome costs about 2
+             * calls, not 160.
+             */
+            void mutate (const float& p, Random<N,K>& rng)
             {
-                // Number of frng calls is N * 2^K (160 for N=5,K=5). That's a lot of
-                // randomness for each bit.
-                Random<N,K>* prng = Random<N,K>::i();
-                prng->fill_rnums();
-                typename std::array<float, width>::iterator riter = prng->rnums.begin();
-                for (unsigned int i = 0; i < N; ++i) {
-                    genosect_t gsect = (*this)[i];
-                    for (unsigned int j = 0; j < (1<<K); ++j) {
-                        if (*riter++ < p) {
-                            // Flip bit j
-                            gsect ^= (genosect_t{1} << j);
-                        }
-                    }
-                    (*this)[i] = gsect;
-                }
+                Genome<N,K>::for_each_flip (p, rng, [this](unsigned int i, unsigned int j) {
+                    (*this)[i] ^= (genosect_t{1} << j);
+                });
             }
 
             //! A version of mutate which adds to a count of the number of flips made in
             //! each genosect. For debugging.
             void mutate (const float& p, std::array<unsigned long long int, N>& flipcount)
             {
-                Random<N,K>::i()->fill_rnums();
-                std::size_t riter = 0;
-                for (unsigned int i = 0; i < N; ++i) {
-                    genosect_t gsect = (*this)[i];
-                    for (unsigned int j = 0; j < (1<<K); ++j) {
-                        if (Random<N,K>::i()->rnums[riter++] < p) {
-                            // Flip bit j
-                            ++flipcount[i];
-                            gsect ^= (genosect_t{1} << j);
-                        }
-                    }
-                    (*this)[i] = gsect;
+                Genome<N,K>::for_each_flip (p, *Random<N,K>::i(), [this, &flipcount](unsigned int i, unsigned int j) {
+                    ++flipcount[i];
+                    (*this)[i] ^= (genosect_t{1} << j);
+                });
+            }
+
+        private:
+            /*!
+             * Call flip(i, j) for each bit j of genosect i that is to flip, where each of the
+             * width bits flips independently with probability p. The number of bits skipped
+             * before the next flip is floor(log(u) / log(1-p)) for u uniform in (0,1].
+             */
+            template <typename F>
+            static void for_each_flip (const float& p, Random<N,K>& rng, F&& flip)
+            {
+                constexpr std::size_t gw = std::size_t{1} << K;
+                if (!(p > 0.0f)) { return; }
+                if (p >= 1.0f) {
+                    for (std::size_t b = 0; b < width; ++b) { flip (b / gw, b % gw); }
+                    return;
+                }
+                const double log1mp = std::log1p (-static_cast<double>(p));
+                std::size_t b = 0;
+                while (b < width) {
+                    const double u = 1.0 - static_cast<double>(rng.frng.get());
+                    if (u <= 0.0) { continue; } // frng can return 1.0f; draw again
+                    const double gap = std::floor (std::log (u) / log1mp);
+                    if (gap >= static_cast<double>(width - b)) { break; }
+                    b += static_cast<std::size_t>(gap);
+                    flip (static_cast<unsigned int>(b / gw), static_cast<unsigned int>(b % gw));
+                    ++b;
                 }
             }
 
+        public:
             //! Flip one bit in this genome at index sectidx within section sect
             void bitflip (unsigned int sect, unsigned int sectidx)
             {
@@ -379,10 +398,13 @@ namespace morph {
                 return (float)bits/(float)(N*(1<<N));
             }
 
-            void randomize()
+            void randomize() { this->randomize (*Random<N,K>::i()); }
+
+            //! Randomize the genome using the generators in rng
+            void randomize (Random<N,K>& rng)
             {
                 for (unsigned int i = 0; i < N; ++i) {
-                    (*this)[i] = Random<N,K>::i()->genosect_rng.get() & genosect_mask;
+                    (*this)[i] = rng.genosect_rng.get() & genosect_mask;
                 }
             }
 
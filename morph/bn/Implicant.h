@@ -5,75 +5,82 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <bit>
 #include <algorithm>
 
 namespace morph {
     namespace bn {
 
-        //! An implicant, as used in the Quine-McCluskey algorithm
+        /*!
+         * An implicant, as used in the Quine-McCluskey algorithm. This is a cube of
+         * minterms held as two bit words: the bits that are set in mask are 'don't care'
+         * and the other bits of the cube's minterms are the bits of implicant (whose mask
+         * bits are always 0).
+         */
         struct Implicant
         {
-            int implicant;
-            int mask;
+            unsigned int implicant;
+            unsigned int mask;
             int ones;
             int vars;
             bool used;
-            std::string minterms;
+            //! The cube as a string of 0, 1 and - with the most significant variable first
             std::string bits;
-            std::vector<int> mints;
 
-            Implicant(int i = 0,
-                      int _vars = 1,
-                      std::vector<int> min = std::vector<int>(),
-                      std::string t = "",
-                      int m = 0, bool
-                      u = false)
-                : implicant(i)
+            Implicant (unsigned int i = 0, int _vars = 1, unsigned int m = 0, bool u = false)
+                : implicant(i & ~m)
                 , mask(m)
-                , ones(0)
+                , ones(std::popcount (i & ~m))
                 , vars(_vars)
                 , used(u)
             {
-                if (t == "") {
-                    std::stringstream ss;
-                    ss << 'm' << i;
-                    minterms = ss.str();
-                } else {
-                    minterms = t;
-                }
-                if (min.empty()) {
-                    mints.push_back(i);
-                } else {
-                    mints = min;
-                }
-                int bit = 1 << vars;
+                unsigned int bit = 1u << vars;
                 while (bit >>= 1) {
-                    if (m & bit) {
-                        bits += '-';
-                    } else if (i & bit) {
-                        bits += '1'; ++ones;
+                    if (this->mask & bit) {
+                        this->bits += '-';
+                    } else if (this->implicant & bit) {
+                        this->bits += '1';
                     } else {
-                        bits += '0';
+                        this->bits += '0';
                     }
                 }
             }
 
             bool operator<(const Implicant& b) const { return ones < b.ones; }
 
-            std::vector<int> cat (const Implicant& b)
+            //! Does this cube contain minterm m?
+            bool covers (const unsigned int m) const { return ((m ^ this->implicant) & ~this->mask) == 0u; }
+
+            //! Does this cube contain all of cube b?
+            bool contains (const Implicant& b) const
+            {
+                return (b.mask & ~this->mask) == 0u && this->covers (b.implicant);
+            }
+
+            //! The number of minterms in the cube
+            unsigned int size() const { return 1u << std::popcount (this->mask); }
+
+            //! The minterms in the cube, in increasing order
+            std::vector<unsigned int> mints() const
             {
-                std::vector<int> v = mints;
-                v.insert (v.end(), b.mints.begin(), b.mints.end());
+                std::vector<unsigned int> v;
+                v.reserve (this->size());
+                unsigned int sub = 0;
+                do {
+                    v.push_back (this->implicant | sub);
+                    sub = (sub - this->mask) & this->mask; // next submask of mask
+                } while (sub != 0u);
                 return v;
             }
 
             // An output function. Takes two boolean args for formatting.
-            std::string str (const bool& pr, const bool& fin)
+            std::string str (const bool& pr, const bool& fin) const
             {
-                int bit = 1 << this->vars, lit = 0;
+                unsigned int bit = 1u << this->vars;
+                int lit = 0;
                 std::ostringstream ss;
                 if (fin) {
-                    ss << right << setw(16);
+                    ss << std::right << std::setw(16);
                 }
                 while (bit >>= 1) {
                     if (!(this->mask & bit)) {
@@ -82,7 +89,7 @@ namespace morph {
                     ++lit;
                 }
                 if (pr) {
-                    ss << '\t' << setw(16) << left << this->minterms << ' ' << this->bits << '\t' << this->ones;
+                    ss << '\t' << std::setw(16) << std::left << this->bits << '\t' << this->ones;
                 }
                 return ss.str();
             }
@@ -0,0 +1,209 @@
+/*!
+ * Exhaustive enumeration of the fitness landscape of a small Boolean gene network: every one
+ * of the 2^(N 2^K) genomes, with its next-state table and basins of attraction.
+ *
+ * The genomes are walked in Gray code order, so that each differs from the one before in a
+ * single bit. Flipping bit j of genosect i changes gene i's next value only in the states
+ * whose inputs to gene i read row j of its truth table (with K = N, just one state), so the
+ * next-state table is patched in place and only the basins that contain a changed state are
+ * searched again. The genome space is split into shards, which are walked concurrently.
+ */
+#pragma once
+
+#include <morph/bn/Genome.h>
+#include <morph/bn/GeneNet.h>
+#include <morph/bn/Basins.h>
+#include <array>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+    namespace bn {
+
+        template <std::size_t N=2, std::size_t K=N>
+        struct Landscape
+        {
+            //! The number of bits in a genome
+            static constexpr std::size_t width = Genome<N,K>::width;
+            static_assert (width < 48, "Landscape: Too many genomes to enumerate");
+            //! The number of genomes
+            static constexpr std::uint64_t n_genomes = std::uint64_t{1} << width;
+            static constexpr std::size_t n_states = GeneNet<N,K>::n_states;
+
+            //! A basin of attraction, in brief
+            struct Basin
+            {
+                //! The states of the attractor, in ascending order (as in a std::set)
+                std::vector<state_t> limitCycle;
+                morph::bn::endpoint endpoint = endpoint::unknown;
+                //! The number of states in the basin. 0 for an unused slot in basins.
+                unsigned int size = 0;
+            };
+
+            //! The genome, with bit b of code as bit b % 2^K of genosect b / 2^K
+            std::uint64_t code = 0;
+            Genome<N,K> genome;
+            //! The next state of each state
+            typename GeneNet<N,K>::transition_table next;
+            //! label[s] is 1 + the index into basins of the basin that contains state s
+            std::vector<std::uint32_t> label = std::vector<std::uint32_t>(n_states, 0);
+            //! The basins. Slots of basins that have gone have size 0; see num_basins().
+            std::vector<Basin> basins;
+
+            //! Set the genome to code and tabulate its next states and basins from scratch
+            void set (const std::uint64_t _code)
+            {
+                this->code = _code;
+                constexpr std::size_t gw = std::size_t{1} << K;
+                for (std::size_t i = 0; i < N; ++i) {
+                    this->genome[i] = static_cast<typename Genome<N,K>::genosect_t>((_code >> (i * gw)) & Genome<N,K>::genosect_mask);
+                }
+                this->next = GeneNet<N,K>::next_state_table (this->genome);
+                this->basins.clear();
+                this->free_slots.clear();
+                std::fill (this->label.begin(), this->label.end(), 0);
+                this->label_unlabelled();
+            }
+
+            //! Flip genome bit b, updating the next states and repairing the basins
+            void flip (const unsigned int b)
+            {
+                constexpr std::size_t gw = std::size_t{1} << K;
+                const unsigned int i = b / gw;
+                this->code ^= std::uint64_t{1} << b;
+                this->genome.bitflip (i, b % gw);
+                const state_t gene_bit = static_cast<state_t>(0x1 << (N - i - 1));
+                const std::vector<state_t>& changed = Landscape<N,K>::affected()[b];
+                for (state_t s : changed) { this->next[s] ^= gene_bit; }
+
+                // Unlabel the basins that hold a changed state. No other basin's trajectories
+                // pass through a changed state, so the rest stand.
+                bool any = false;
+                for (state_t s : changed) {
+                    Basin& basin = this->basins[this->label[s] - 1];
+                    if (basin.size > 0) {
+                        basin.size = 0;
+                        basin.limitCycle.clear();
+                        this->free_slots.push_back (this->label[s] - 1);
+                        any = true;
+                    }
+                }
+                if (!any) { return; }
+                for (std::size_t s = 0; s < n_states; ++s) {
+                    if (this->basins[this->label[s] - 1].size == 0) { this->label[s] = 0; }
+                }
+                this->label_unlabelled();
+            }
+
+            //! The number of basins of attraction
+            unsigned int num_basins() const
+            {
+                unsigned int n = 0;
+                for (const Basin& basin : this->basins) { n += basin.size > 0 ? 1 : 0; }
+                return n;
+            }
+
+            /*!
+             * Call f (landscape) for every genome, concurrently, where landscape is a const
+             * Landscape<N,K>& with code, genome, next and basins set. The genome space is
+             * split into 2^shard_bits shards by the top bits of code; each is walked in Gray
+             * code order by one thread, so f is called from several threads at once and must
+             * only write to per-genome storage (indexed by landscape.code, say).
+             */
+            template <typename F>
+            static void enumerate (F&& f, const unsigned int shard_bits = (width > 16 ? 8 : 0))
+            {
+                const unsigned int sb = shard_bits > width ? static_cast<unsigned int>(width) : shard_bits;
+                const unsigned int low_bits = static_cast<unsigned int>(width) - sb;
+                const std::uint64_t n_low = std::uint64_t{1} << low_bits;
+                const long long int n_shards = static_cast<long long int>(std::uint64_t{1} << sb);
+#pragma omp parallel for schedule(dynamic)
+                for (long long int sh = 0; sh < n_shards; ++sh) {
+                    Landscape<N,K> ls;
+                    ls.set (static_cast<std::uint64_t>(sh) << low_bits);
+                    f (static_cast<const Landscape<N,K>&>(ls));
+                    // From Gray code k-1 to k flips the bit at the number of trailing zeros of k
+                    for (std::uint64_t k = 1; k < n_low; ++k) {
+                        ls.flip (static_cast<unsigned int>(std::countr_zero (k)));
+                        f (static_cast<const Landscape<N,K>&>(ls));
+                    }
+                }
+            }
+
+            //! fitfn (landscape) for every genome, in a vector indexed by code
+            template <typename F>
+            static std::vector<double> fitnesses (F&& fitfn)
+            {
+                std::vector<double> fit (n_genomes, 0.0);
+                Landscape<N,K>::enumerate ([&fit, &fitfn](const Landscape<N,K>& ls) { fit[ls.code] = fitfn (ls); });
+                return fit;
+            }
+
+        private:
+            //! Indices into basins of the unused slots
+            std::vector<std::uint32_t> free_slots;
+
+            //! affected()[b] lists the states whose next state depends on genome bit b
+            static const std::array<std::vector<state_t>, width>& affected()
+            {
+                static const std::array<std::vector<state_t>, width> a = []() {
+                    std::array<std::vector<state_t>, width> _a;
+                    constexpr std::size_t gw = std::size_t{1} << K;
+                    for (std::size_t s = 0; s < n_states; ++s) {
+                        state_t st = static_cast<state_t>(s);
+                        std::array<state_t, N> inputs;
+                        GeneNet<N,K>::setup_inputs (st, inputs);
+                        for (std::size_t i = 0; i < N; ++i) { _a[i * gw + inputs[i]].push_back (static_cast<state_t>(s)); }
+                    }
+                    return _a;
+                }();
+                return a;
+            }
+
+            //! Find the basins of the unlabelled states, as AllBasins::find_basins_of_attraction does
+            void label_unlabelled()
+            {
+                static constexpr std::uint32_t on_path = std::numeric_limits<std::uint32_t>::max();
+                std::array<state_t, n_states> path;
+                for (std::size_t si = 0; si < n_states; ++si) {
+                    if (this->label[si] != 0) { continue; }
+                    std::size_t np = 0;
+                    state_t st = static_cast<state_t>(si);
+                    while (this->label[st] == 0) {
+                        this->label[st] = on_path;
+                        path[np++] = st;
+                        st = this->next[st];
+                    }
+                    std::uint32_t bi = 0;
+                    if (this->label[st] == on_path) {
+                        // A new attractor, through st
+                        if (this->free_slots.empty()) {
+                            bi = static_cast<std::uint32_t>(this->basins.size());
+                            this->basins.emplace_back();
+                        } else {
+                            bi = this->free_slots.back();
+                            this->free_slots.pop_back();
+                        }
+                        Basin& basin = this->basins[bi];
+                        basin.endpoint = this->next[st] == st ? endpoint::point : endpoint::limit;
+                        state_t lc = st;
+                        do {
+                            basin.limitCycle.push_back (lc);
+                            lc = this->next[lc];
+                        } while (lc != st);
+                        std::sort (basin.limitCycle.begin(), basin.limitCycle.end());
+                    } else {
+                        bi = this->label[st] - 1;
+                    }
+                    this->basins[bi].size += static_cast<unsigned int>(np);
+                    for (std::size_t p = 0; p < np; ++p) { this->label[path[p]] = bi + 1; }
+                }
+            }
+        };
+
+    } // namespace bn
+} // namespace morph
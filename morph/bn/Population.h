@@ -0,0 +1,137 @@
+/*!
+ * A population of Boolean network genomes whose fitnesses (and basins of attraction) are
+ * evaluated concurrently, and which can be evolved as many independent, concurrent walks.
+ *
+ * OpenMP provides the thread pool. Each walk draws its random numbers from its own
+ * bn::Random, seeded from a master seed and the walk's index, so the results are the same
+ * whatever the number of threads and however the walks are scheduled.
+ */
+#pragma once
+
+#include <morph/bn/Genome.h>
+#include <morph/bn/Basins.h>
+#include <morph/bn/Random.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+    namespace bn {
+
+        template <std::size_t N=5, std::size_t K=N>
+        struct Population
+        {
+            Population() {}
+            Population (const std::size_t n) { this->resize (n); }
+
+            void resize (const std::size_t n)
+            {
+                this->genomes.resize (n);
+                this->fitness.assign (n, 0.0);
+            }
+
+            std::size_t size() const { return this->genomes.size(); }
+
+            //! Randomize every genome, genome i from the generator seeded by stream_seed (seed, i)
+            void randomize (const std::uint64_t seed)
+            {
+                const long long int n = static_cast<long long int>(this->genomes.size());
+#pragma omp parallel for
+                for (long long int i = 0; i < n; ++i) {
+                    Random<N,K> rng (Population<N,K>::stream_seed (seed, static_cast<std::uint64_t>(i)));
+                    this->genomes[i].randomize (rng);
+                }
+            }
+
+            /*!
+             * Set fitness[i] = fitfn (genomes[i]) for every genome, concurrently. fitfn is
+             * called from several threads at once, so it must not modify shared state. The
+             * const evaluate_fitness of a GeneNetDual, for example, is safe to use:
+             *
+             *   pop.evaluate ([&gn](const Genome<5,5>& g) { return gn.evaluate_fitness (g); });
+             */
+            template <typename F>
+            void evaluate (F&& fitfn)
+            {
+                const long long int n = static_cast<long long int>(this->genomes.size());
+                this->fitness.resize (this->genomes.size());
+#pragma omp parallel for schedule(dynamic, 64)
+                for (long long int i = 0; i < n; ++i) {
+                    this->fitness[i] = fitfn (this->genomes[i]);
+                }
+            }
+
+            //! Find all the basins of attraction of every genome, concurrently
+            std::vector<AllBasins<N,K>> basins() const
+            {
+                std::vector<AllBasins<N,K>> ab (this->genomes.size());
+                const long long int n = static_cast<long long int>(this->genomes.size());
+#pragma omp parallel for schedule(dynamic)
+                for (long long int i = 0; i < n; ++i) {
+                    ab[i].update (this->genomes[i]);
+                }
+                return ab;
+            }
+
+            /*!
+             * Evolve nwalks genomes as independent walks, in parallel. Each walk starts from
+             * a random genome and repeatedly mutates it with bit flip probability p, keeping the
+             * mutant if its fitness is no less than that of the current genome (as
+             * GeneNetDual::evolve_new_genome does), until fitness reaches threshold or
+             * max_generations mutations have been tried. fitfn must be callable concurrently
+             * (see evaluate()).
+             *
+             * On return genomes and fitness hold the final genome and fitness of each walk.
+             * Returns the number of generations each walk took.
+             */
+            template <typename F>
+            std::vector<unsigned long long int> evolve (const std::size_t nwalks, const float p, F&& fitfn,
+                                                        const double threshold,
+                                                        const unsigned long long int max_generations,
+                                                        const std::uint64_t seed)
+            {
+                this->resize (nwalks);
+                std::vector<unsigned long long int> gens (nwalks, 0);
+                const long long int n = static_cast<long long int>(nwalks);
+#pragma omp parallel for schedule(dynamic)
+                for (long long int w = 0; w < n; ++w) {
+                    Random<N,K> rng (Population<N,K>::stream_seed (seed, static_cast<std::uint64_t>(w)));
+                    Genome<N,K> refg;
+                    refg.randomize (rng);
+                    double a = fitfn (refg);
+                    Genome<N,K> newg;
+                    unsigned long long int gen = 0;
+                    while (a < threshold && gen < max_generations) {
+                        newg = refg;
+                        newg.mutate (p, rng);
+                        ++gen;
+                        double b = fitfn (newg);
+                        if (b >= a) {
+                            a = b;
+                            refg = newg;
+                        }
+                    }
+                    this->genomes[w] = refg;
+                    this->fitness[w] = a;
+                    gens[w] = gen;
+                }
+                return gens;
+            }
+
+            //! A seed for stream (walk, genome) number stream from the master seed (splitmix64)
+            static unsigned int stream_seed (const std::uint64_t seed, const std::uint64_t stream)
+            {
+                std::uint64_t z = seed + (stream + 1) * 0x9e3779b97f4a7c15ULL;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                return static_cast<unsigned int>(z ^ (z >> 31));
+            }
+
+            //! The genomes
+            std::vector<Genome<N,K>> genomes;
+            //! The fitness of each genome, as last computed by evaluate() or evolve()
+            std::vector<double> fitness;
+        };
+
+    } // namespace bn
+} // namespace morph
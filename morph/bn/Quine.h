@@ -5,262 +5,482 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <unordered_set>
+#include <utility>
 #include <cstddef>
+#include <cstdint>
+#include <bit>
+#include <limits>
+#include <stdexcept>
 #include <algorithm>
 #include <morph/bn/Implicant.h>
 
 namespace morph {
     namespace bn {
 
-        //! Implements the Quine-McCluskey algorithm to find the minimal form for a
-        //! Boolean function.
+        /*!
+         * Implements the Quine-McCluskey algorithm to find the minimal form for a
+         * Boolean function, with an Espresso-style heuristic alternative for functions of
+         * many variables when a near-minimal form will do.
+         *
+         * Usage: add the function's minterms with addMinterm(), call go(), then read the
+         * result with min() and complexity().
+         */
         class Quine
         {
         public:
-            int combs;
+            //! How go() minimises the function
+            enum class mode
+            {
+                //! Find all the prime implicants and a smallest set of them covering the function
+                exact,
+                //! Expand, make irredundant and reduce covers of prime implicants repeatedly, as
+                //! Espresso does, keeping the smallest. Not guaranteed minimal, but fast.
+                heuristic
+            };
+
+            unsigned int combs;
             std::vector<int> minterms;
-            std::vector<Implicant> implicants;
             int vars;
-            bool pr = true;
-            bool fin = true;
-            //! Stores results of expression compression
-            std::vector<std::size_t> M0, M1;
-            //! Stores results of expression compression
+            mode method = mode::exact;
+            //! Some prime implicants of the function. In exact mode, all of them.
             std::vector<Implicant> primes;
+            //! The indices into primes of the implicants in the minimal form
+            std::vector<std::size_t> cover;
             //! The final complexity value.
             unsigned int cplexity = 0;
             unsigned int outof = 0;
-            std::size_t ind = 0;
+            //! The number of reduce/expand passes for mode::heuristic
+            unsigned int heuristic_passes = 8;
+            /*!
+             * The exact search can take exponential time on functions whose cover tables
+             * have large cyclic cores (dense random functions of 10 or more inputs). It gives
+             * up after this many search nodes (0 for no limit), keeping the best cover found.
+             */
+            std::size_t max_nodes = 10000;
+            //! After go(), true if the cover is known to be minimal
+            bool optimal = false;
 
             // Debugging
-            constexpr bool verboseout = false;
-
-            Quine (int _vars): vars(_vars) { combs = 1 << this->vars; }
+            static constexpr bool verboseout = false;
 
-            void addMinterm (int m)
+            Quine (int _vars, mode _method = mode::exact)
+                : vars(_vars)
+                , method(_method)
             {
-                minterms.push_back (m);
-                implicants.push_back (Implicant(m, vars));
+                // Per-minterm tables of 2^vars entries are used
+                if (this->vars < 1 || this->vars > 24) {
+                    throw std::runtime_error ("Quine: vars must be in the range [1, 24]");
+                }
+                this->combs = 1u << this->vars;
             }
 
-            int count1s (std::size_t x)
+            void addMinterm (int m)
             {
-                int o = 0;
-                while (x) {
-                    o += x % 2;
-                    x >>= 1;
+                if (m < 0 || static_cast<unsigned int>(m) >= this->combs) {
+                    throw std::runtime_error ("Quine: minterm out of range");
                 }
-                return o;
+                this->minterms.push_back (m);
             }
 
-            void mul (std::vector<std::size_t> &a, const std::vector<std::size_t> &b)
+            void go()
             {
-                std::vector<std::size_t> v;
-                for (std::size_t i = 0; i < a.size(); ++i) {
-                    for (std::size_t j = 0; j < b.size(); ++j) {
-                        v.push_back(a[i] | b[j]);
-                    }
+                std::sort (this->minterms.begin(), this->minterms.end());
+                this->minterms.erase (std::unique (this->minterms.begin(), this->minterms.end()), this->minterms.end());
+                this->primes.clear();
+                this->cover.clear();
+                this->optimal = this->method == mode::exact;
+                if (this->minterms.empty()) {
+                    if constexpr (verboseout) { std::cout << "\n\tF = 0\n"; }
+                    return;
                 }
-                sort (v.begin(), v.end());
-                v.erase (unique (v.begin(), v.end()), v.end());
-                for (std::size_t i = 0; i < v.size() - 1; ++i) {
-                    for (std::size_t j = v.size() - 1; j > i ; --j) {
-                        std::size_t z = v[i] & v[j];
-                        if ((z & v[i]) == v[i]) {
-                            v.erase (v.begin() + j);
-                        } else if ((z & v[j]) == v[j]) {
-                            std::size_t t = v[i];
-                            v[i] = v[j];
-                            v[j] = t;
-                            v.erase(v.begin() + j);
-                            j = v.size();
-                        }
-                    }
+                if (this->method == mode::exact) {
+                    this->find_primes();
+                    this->find_min_cover();
+                } else {
+                    this->espresso();
+                }
+                if constexpr (verboseout) {
+                    for (auto& p : this->primes) { std::cout << p.str (true, true) << std::endl; }
+                    std::cout << "-------------------------------------------------------\n";
+                    std::cout << this->min() << std::endl;
                 }
-                a = v;
             }
 
-            void go()
+            //! Run after go()
+            double complexity()
             {
-                if constexpr (verboseout) { if (!minterms.size()) { cout << "\n\tF = 0\n"; } }
-
-                sort (minterms.begin(), minterms.end());
-                minterms.erase( unique( minterms.begin(), minterms.end() ), minterms.end() );
+                this->outof = this->combs;
+                this->cplexity = static_cast<unsigned int>(this->cover.size());
+                return (double)this->cplexity/(double)this->outof;
+            }
 
-                sort (implicants.begin(), implicants.end());
-                if constexpr (verboseout) {
-                    for (std::size_t i = 0; i < implicants.size(); ++i) {
-                        cout << implicants[i].output(pr, fin) << endl;
-                    }
-                    cout << "-------------------------------------------------------\n";
+            //! Run after go()
+            std::string min() const
+            {
+                std::string s("F = ");
+                if (this->cover.empty()) { return s + "0"; }
+                bool f = false;
+                for (std::size_t i : this->cover) {
+                    if (f) { s += " + "; }
+                    f = true;
+                    s += this->primes[i].mask == this->combs - 1 ? std::string("1") : this->primes[i].str (false, false);
                 }
+                return s;
+            }
+
+        private:
+            //! Pack a cube into a hash key
+            static std::uint64_t key (const unsigned int value, const unsigned int mask)
+            {
+                return (static_cast<std::uint64_t>(mask) << 32) | value;
+            }
+
+            /*!
+             * Quine-McCluskey merging. Each round holds the cubes with the same number of
+             * don't cares, grouped by the popcount of their values. A cube merges with the
+             * cube one group up that differs from it in one bit, which is a hash lookup, so a
+             * round costs O(cubes * vars). Cubes that merge with none are prime.
+             */
+            void find_primes()
+            {
+                const unsigned int allbits = this->combs - 1;
+                std::vector<std::unordered_set<std::uint64_t>> groups (this->vars + 1);
+                for (int m : this->minterms) { groups[std::popcount (static_cast<unsigned int>(m))].insert (key (m, 0)); }
 
-                std::vector<Implicant> aux;
-                while (implicants.size() > 1) {
-                    for (std::size_t i = 0; i < implicants.size() - 1; ++i) {
-                        for (std::size_t j = implicants.size() - 1; j > i ; --j) {
-                            if (implicants[j].bits == implicants[i].bits) {
-                                implicants.erase (implicants.begin() + j);
+                bool any = true;
+                while (any) {
+                    any = false;
+                    std::vector<std::unordered_set<std::uint64_t>> next (this->vars + 1);
+                    std::unordered_set<std::uint64_t> used;
+                    for (int k = 0; k < this->vars; ++k) {
+                        for (std::uint64_t c : groups[k]) {
+                            const unsigned int value = static_cast<unsigned int>(c);
+                            const unsigned int mask = static_cast<unsigned int>(c >> 32);
+                            unsigned int free = ~(value | mask) & allbits;
+                            while (free) {
+                                const unsigned int b = free & (~free + 1u);
+                                free &= ~b;
+                                const std::uint64_t cu = key (value | b, mask);
+                                if (groups[k + 1].count (cu)) {
+                                    used.insert (c);
+                                    used.insert (cu);
+                                    next[k].insert (key (value, mask | b));
+                                    any = true;
+                                }
                             }
                         }
                     }
-                    aux.clear();
-                    for (std::size_t i = 0; i < implicants.size() - 1; ++i) {
-                        for (std::size_t j = i + 1; j < implicants.size(); ++ j) {
-                            if (implicants[j].ones == implicants[i].ones + 1 &&
-                                implicants[j].mask == implicants[i].mask &&
-                                count1s(implicants[i].implicant ^
-                                        implicants[j].implicant) == 1) {
-                                implicants[i].used = true;
-                                implicants[j].used = true;
-                                aux.push_back(Implicant(implicants[i].implicant,
-                                                        this->vars,
-                                                        implicants[i].cat(implicants[j]),
-                                                        implicants[i].minterms + ',' +
-                                                        implicants[j].minterms,
-                                                        (implicants[i].implicant ^
-                                                         implicants[j].implicant) | implicants[i].mask));
+                    for (auto& g : groups) {
+                        for (std::uint64_t c : g) {
+                            if (!used.count (c)) {
+                                this->primes.emplace_back (static_cast<unsigned int>(c), this->vars, static_cast<unsigned int>(c >> 32));
                             }
                         }
                     }
-                    for (std::size_t i = 0; i < implicants.size(); ++i) {
-                        if (!implicants[i].used) {
-                            primes.push_back(implicants[i]);
-                        }
-                    }
-                    implicants = aux;
-                    sort (implicants.begin(), implicants.end());
-                    if constexpr (verboseout) {
-                        for (std::size_t i = 0; i < implicants.size(); ++i) {
-                            cout << implicants[i].output(pr, fin) << endl;
-                        }
-                        cout << "-------------------------------------------------------\n";
+                    groups.swap (next);
+                }
+                // Hash order is not deterministic across platforms; sort for a stable result
+                std::sort (this->primes.begin(), this->primes.end(), [](const Implicant& a, const Implicant& b)
+                {
+                    return a.mask != b.mask ? a.mask > b.mask : a.implicant < b.implicant;
+                });
+            }
+
+            /*!
+             * Choose a smallest set of primes that covers every minterm, by branch and bound.
+             * Branches on the uncovered minterm with fewest covering primes (so essential
+             * primes are taken without branching) and prunes with a lower bound from a set of
+             * uncovered minterms no two of which share a prime. Starts from a greedy cover.
+             */
+            void find_min_cover()
+            {
+                const std::size_t nm = this->minterms.size();
+                std::vector<int> index (this->combs, -1);
+                for (std::size_t k = 0; k < nm; ++k) { index[this->minterms[k]] = static_cast<int>(k); }
+                this->rows.assign (this->primes.size(), {});
+                this->cols.assign (nm, {});
+                for (std::size_t i = 0; i < this->primes.size(); ++i) {
+                    for (unsigned int m : this->primes[i].mints()) {
+                        this->rows[i].push_back (static_cast<std::uint32_t>(index[m]));
+                        this->cols[index[m]].push_back (static_cast<std::uint32_t>(i));
                     }
                 }
-                for (std::size_t i = 0; i < implicants.size(); ++i) {
-                    primes.push_back (implicants[i]);
+                // Try the largest primes first
+                for (auto& c : this->cols) {
+                    std::sort (c.begin(), c.end(), [this](std::uint32_t a, std::uint32_t b) { return this->rows[a].size() > this->rows[b].size(); });
                 }
-                if constexpr (verboseout) {
-                    if (primes.back().mask == combs - 1) {
-                        cout << "\n\tF = 1\n";
+
+                // Greedy upper bound
+                this->ncov.assign (nm, 0);
+                std::size_t uncovered = nm;
+                while (uncovered) {
+                    std::size_t besti = 0;
+                    std::size_t bestn = 0;
+                    for (std::size_t i = 0; i < this->rows.size(); ++i) {
+                        std::size_t n = 0;
+                        for (std::uint32_t k : this->rows[i]) { n += this->ncov[k] == 0 ? 1 : 0; }
+                        if (n > bestn) { bestn = n; besti = i; }
                     }
+                    for (std::uint32_t k : this->rows[besti]) { if (this->ncov[k]++ == 0) { --uncovered; } }
+                    this->cover.push_back (besti);
                 }
-                this->pr = false;
-                bool table[primes.size()][minterms.size()];
-                for (std::size_t i = 0; i < primes.size(); ++i) {
-                    for (std::size_t k = 0; k < minterms.size(); ++k) {
-                        table[i][k] = false;
+
+                this->ncov.assign (nm, 0);
+                this->excl.assign (this->primes.size(), 0);
+                this->stamp.assign (nm, 0);
+                this->stampval = 0;
+                this->nodes = 0;
+                this->chosen.clear();
+                this->branch();
+                std::sort (this->cover.begin(), this->cover.end());
+            }
+
+            /*!
+             * Shrink the cover table: take essential primes, drop minterms whose primes
+             * include all those of another minterm (covering that one covers them) and drop
+             * primes whose uncovered minterms are all covered by another prime. Repeat until
+             * none apply. Returns false if some minterm can no longer be covered.
+             */
+            bool reduce_table()
+            {
+                const std::size_t nm = this->cols.size();
+                const std::size_t np = this->rows.size();
+                auto avail = [this](std::size_t k)
+                {
+                    std::vector<std::uint32_t> a;
+                    for (std::uint32_t i : this->cols[k]) { if (!this->excl[i]) { a.push_back (i); } }
+                    std::sort (a.begin(), a.end());
+                    return a;
+                };
+                auto live = [this](std::size_t i)
+                {
+                    std::vector<std::uint32_t> a;
+                    for (std::uint32_t k : this->rows[i]) { if (!this->ncov[k]) { a.push_back (k); } }
+                    return a; // rows are in increasing minterm order
+                };
+
+                bool changed = true;
+                while (changed) {
+                    changed = false;
+                    // Essential primes
+                    for (std::size_t k = 0; k < nm; ++k) {
+                        if (this->ncov[k]) { continue; }
+                        std::vector<std::uint32_t> a = avail (k);
+                        if (a.empty()) { return false; }
+                        if (a.size() == 1) {
+                            for (std::uint32_t k2 : this->rows[a[0]]) { ++this->ncov[k2]; }
+                            this->chosen.push_back (a[0]);
+                            changed = true;
+                        }
                     }
-                }
-                for (std::size_t i = 0; i < primes.size(); ++i) {
-                    for (std::size_t j = 0; j < primes[i].mints.size(); ++j) {
-                        for (std::size_t k = 0; k < minterms.size(); ++k) {
-                            if (primes[i].mints[j] == minterms[k]) {
-                                table[i][k] = true;
+                    // Dominated minterms. Marking them covered leaves them out of the search.
+                    std::vector<std::vector<std::uint32_t>> ak (nm);
+                    for (std::size_t k = 0; k < nm; ++k) { if (!this->ncov[k]) { ak[k] = avail (k); } }
+                    for (std::size_t k = 0; k < nm; ++k) {
+                        if (this->ncov[k]) { continue; }
+                        for (std::size_t k2 = 0; k2 < nm; ++k2) {
+                            if (k2 == k || this->ncov[k2] || ak[k2].size() > ak[k].size()) { continue; }
+                            if (ak[k2].size() == ak[k].size() && k2 > k) { continue; } // keep one of equals
+                            if (std::includes (ak[k].begin(), ak[k].end(), ak[k2].begin(), ak[k2].end())) {
+                                ++this->ncov[k];
+                                changed = true;
+                                break;
                             }
                         }
                     }
-                }
-                if constexpr (verboseout) {
-                    for (int k = 0; k < 18; ++k) { cout << " "; }
-                    for (std::size_t k = 0; k < minterms.size(); ++k) {
-                        cout << right << setw(2) << minterms[k] << ' ';
-                    }
-                    cout << endl;
-                    for (int k = 0; k < 18; ++k) { cout << " "; }
-                    for (std::size_t k = 0; k < minterms.size(); ++k) { cout << "---"; }
-                    cout << endl;
-                    for (std::size_t i = 0; i < primes.size(); ++i) {
-                        cout << primes[i].output (pr, fin) << " |";
-                        for (std::size_t k = 0; k < minterms.size(); ++k) {
-                            cout << (table[i][k] ? " X " : " ");
+                    // Dominated primes
+                    std::vector<std::vector<std::uint32_t>> li (np);
+                    for (std::size_t i = 0; i < np; ++i) { if (!this->excl[i]) { li[i] = live (i); } }
+                    for (std::size_t i = 0; i < np; ++i) {
+                        if (this->excl[i]) { continue; }
+                        if (li[i].empty()) { ++this->excl[i]; changed = true; continue; }
+                        for (std::size_t i2 = 0; i2 < np; ++i2) {
+                            if (i2 == i || this->excl[i2] || li[i2].size() < li[i].size()) { continue; }
+                            if (li[i2].size() == li[i].size() && i2 > i) { continue; }
+                            if (std::includes (li[i2].begin(), li[i2].end(), li[i].begin(), li[i].end())) {
+                                ++this->excl[i];
+                                changed = true;
+                                break;
+                            }
                         }
-                        cout << endl;
                     }
                 }
+                return true;
+            }
 
-                for (std::size_t i = 0; i < primes.size(); ++i) {
-                    if (table[i][0]) {
-                        M0.push_back(1 << i);
-                    }
+            void branch()
+            {
+                if (this->max_nodes > 0 && ++this->nodes > this->max_nodes) {
+                    this->optimal = false;
+                    return;
                 }
-                for (std::size_t k = 1; k < minterms.size(); ++k) {
-                    M1.clear();
-                    for (std::size_t i = 0; i < primes.size(); ++i) {
-                        if (table[i][k]) {
-                            M1.push_back(1 << i);
-                        }
-                    }
-                    this->mul (M0, M1);
+                // Reduce the table at this node, to be restored on the way out
+                const std::vector<unsigned int> ncov0 = this->ncov;
+                const std::vector<unsigned int> excl0 = this->excl;
+                const std::size_t nchosen = this->chosen.size();
+                if (this->reduce_table() && this->chosen.size() < this->cover.size()) { this->search(); }
+                this->ncov = ncov0;
+                this->excl = excl0;
+                this->chosen.resize (nchosen);
+            }
+
+            void search()
+            {
+                // The uncovered minterms, fewest available primes first
+                std::vector<std::pair<std::size_t, std::uint32_t>> unc;
+                for (std::size_t k = 0; k < this->ncov.size(); ++k) {
+                    if (this->ncov[k]) { continue; }
+                    std::size_t avail = 0;
+                    for (std::uint32_t i : this->cols[k]) { avail += this->excl[i] ? 0 : 1; }
+                    unc.emplace_back (avail, static_cast<std::uint32_t>(k));
                 }
-                int min = count1s(M0[0]);
-                this->ind = 0;
-                for (std::size_t i = 1; i < M0.size(); ++i) {
-                    if (min > count1s(M0[i])) {
-                        min = count1s(M0[i]);
-                        this->ind = i;
-                    }
+                if (unc.empty()) {
+                    if (this->chosen.size() < this->cover.size()) { this->cover = this->chosen; }
+                    return;
                 }
-                this->fin = false;
-                if constexpr (verboseout) {
-                    bool f;
-                    cout << "-------------------------------------------------------\n";
-                    for (std::size_t j = 0; j < M0.size(); ++j) {
-                        cout << "\tF = ";
-                        f = false;
-                        for (std::size_t i = 0; i < primes.size(); ++i)
-                            if (M0[j] & (1 << i)) {
-                                if (f) { cout << " + "; }
-                                f = true;
-                                cout << primes[i].output (this->pr, this->fin);
-                            }
-                        cout << endl;
-                    }
-                    cout << "-------------------------------------------------------\n";
+                std::sort (unc.begin(), unc.end());
+                const std::uint32_t hardest = unc[0].second;
 
-                    // minimal solution
-                    cout << "F = ";
-                    f = false;
-                    for (std::size_t i = 0; i < primes.size(); ++i) {
-                        if (M0[this->ind] & (1 << i)) {
-                            if (f) { cout << " + "; }
-                            f = true;
-                            cout << primes[i].output (this->pr, this->fin);
-                        }
+                // A lower bound on the primes still needed: the size of a set of uncovered
+                // minterms, no two of which share an available prime
+                ++this->stampval;
+                std::size_t lb = 0;
+                for (auto [avail, k] : unc) {
+                    if (this->stamp[k] == this->stampval) { continue; }
+                    ++lb;
+                    for (std::uint32_t i : this->cols[k]) {
+                        if (this->excl[i]) { continue; }
+                        for (std::uint32_t k2 : this->rows[i]) { this->stamp[k2] = this->stampval; }
                     }
-                    cout << endl;
+                }
+                if (this->chosen.size() + lb >= this->cover.size()) { return; }
+
+                // Branch on each available prime covering hardest, excluding those already
+                // tried from the later branches
+                for (std::uint32_t i : this->cols[hardest]) {
+                    if (this->excl[i]) { continue; }
+                    for (std::uint32_t k : this->rows[i]) { ++this->ncov[k]; }
+                    this->chosen.push_back (i);
+                    this->branch();
+                    this->chosen.pop_back();
+                    for (std::uint32_t k : this->rows[i]) { --this->ncov[k]; }
+                    ++this->excl[i];
                 }
             }
 
-            //! Run after go()
-            double complexity()
+            /*!
+             * The heuristic. Each pass expands every seed cube to a prime implicant, one
+             * variable at a time, always raising the variable that brings in the most
+             * minterms not yet covered; drops redundant primes; then reduces each prime to
+             * the smallest cube holding the minterms only it covers, to seed the next pass.
+             * The smallest cover found is kept.
+             */
+            void espresso()
             {
-                this->cplexity = 0;
+                std::vector<char> on (this->combs, 0);
+                for (int m : this->minterms) { on[m] = 1; }
+                std::vector<Implicant> seeds;
+                for (int m : this->minterms) { seeds.emplace_back (m, this->vars); }
+                std::vector<unsigned int> count (this->combs, 0);
+
+                for (unsigned int pass = 0; pass < this->heuristic_passes; ++pass) {
+                    // Expand
+                    std::fill (count.begin(), count.end(), 0u);
+                    std::stable_sort (seeds.begin(), seeds.end(), [](const Implicant& a, const Implicant& b) { return a.size() > b.size(); });
+                    std::vector<Implicant> cv;
+                    for (const Implicant& s : seeds) {
+                        bool allcovered = true;
+                        for (unsigned int m : s.mints()) { if (!count[m]) { allcovered = false; break; } }
+                        if (allcovered) { continue; }
+                        Implicant p = this->expand (s, on, count, pass);
+                        for (unsigned int m : p.mints()) { ++count[m]; }
+                        cv.push_back (p);
+                    }
+
+                    // Irredundant: drop primes whose minterms are all covered by others, smallest first
+                    std::stable_sort (cv.begin(), cv.end(), [](const Implicant& a, const Implicant& b) { return a.size() < b.size(); });
+                    std::vector<Implicant> irr;
+                    for (const Implicant& p : cv) {
+                        std::vector<unsigned int> pm = p.mints();
+                        if (std::all_of (pm.begin(), pm.end(), [&count](unsigned int m) { return count[m] > 1; })) {
+                            for (unsigned int m : pm) { --count[m]; }
+                        } else {
+                            irr.push_back (p);
+                        }
+                    }
 
-                this->outof = 1 << this->vars;
+                    if (this->primes.empty() || irr.size() < this->primes.size()) { this->primes = irr; }
 
-                for (std::size_t i = 0; i < primes.size(); ++i) {
-                    if (M0[this->ind] & (1 << i)) {
-                        this->cplexity++;
+                    // Reduce, one prime at a time so that the reduced cubes still cover the function
+                    seeds.clear();
+                    for (const Implicant& p : irr) {
+                        unsigned int first = 0;
+                        unsigned int diff = 0;
+                        bool have = false;
+                        std::vector<unsigned int> pm = p.mints();
+                        for (unsigned int m : pm) {
+                            if (count[m] != 1) { continue; }
+                            if (!have) { first = m; have = true; }
+                            diff |= m ^ first;
+                        }
+                        if (!have) {
+                            // Now covered by the reduced cubes and the rest
+                            for (unsigned int m : pm) { --count[m]; }
+                            continue;
+                        }
+                        seeds.emplace_back (first, this->vars, diff);
+                        for (unsigned int m : pm) { --count[m]; }
+                        for (unsigned int m : seeds.back().mints()) { ++count[m]; }
                     }
                 }
-                return (double)this->cplexity/(double)this->outof;
+
+                std::sort (this->primes.begin(), this->primes.end(), [](const Implicant& a, const Implicant& b)
+                {
+                    return a.mask != b.mask ? a.mask > b.mask : a.implicant < b.implicant;
+                });
+                this->cover.resize (this->primes.size());
+                for (std::size_t i = 0; i < this->cover.size(); ++i) { this->cover[i] = i; }
             }
 
-            //! Run after go()
-            string min()
+            //! Expand c until it is prime. Ties between variables are broken in an order that rotates with pass.
+            Implicant expand (Implicant c, const std::vector<char>& on, const std::vector<unsigned int>& count,
+                              const unsigned int pass) const
             {
-                string s("F = ");
-                bool f = false;
-                for (std::size_t i = 0; i < primes.size(); ++i) {
-                    if (M0[this->ind] & (1 << i)) {
-                        if (f) { s += " + "; }
-                        f = true;
-                        s += primes[i].output (this->pr, this->fin);
+                for (;;) {
+                    unsigned int bestb = 0;
+                    int bestgain = -1;
+                    for (int j = 0; j < this->vars; ++j) {
+                        const unsigned int b = 1u << ((j + pass) % this->vars);
+                        if (c.mask & b) { continue; }
+                        // Raising b adds the cube c with bit b flipped; it must lie in the on set
+                        const unsigned int flipped = c.implicant ^ b;
+                        int gain = 0;
+                        bool ok = true;
+                        unsigned int sub = 0;
+                        do {
+                            const unsigned int m = flipped | sub;
+                            if (!on[m]) { ok = false; break; }
+                            gain += count[m] == 0 ? 1 : 0;
+                            sub = (sub - c.mask) & c.mask;
+                        } while (sub != 0u);
+                        if (ok && gain > bestgain) { bestgain = gain; bestb = b; }
                     }
+                    if (bestgain < 0) { return c; }
+                    c = Implicant (c.implicant, this->vars, c.mask | bestb);
                 }
-                return s;
             }
+
+            //! The cover table: the minterm indices of each prime and the primes of each minterm
+            std::vector<std::vector<std::uint32_t>> rows;
+            std::vector<std::vector<std::uint32_t>> cols;
+            //! Branch and bound state
+            std::vector<unsigned int> ncov;
+            std::vector<unsigned int> excl;
+            std::vector<unsigned int> stamp;
+            unsigned int stampval = 0;
+            std::size_t nodes = 0;
+            std::vector<std::size_t> chosen;
         };
 
     } // namespace bn (Boolean Nets)
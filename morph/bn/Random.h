@@ -18,13 +18,22 @@ namespace morph {
         {
             using genosect_t = typename Genosect<K>::type;
 
-            //! Private constructor/destructor
+            //! Private constructor for the singleton
             Random() {};
-            ~Random() {};
             //! A pointer returned to the single instance of this class
             static Random<N,K>* pInstance;
 
         public:
+            /*!
+             * A generator of your own, separate from the singleton, seeded with seed. Give each
+             * thread (or better, each independent unit of work) its own to get results that do
+             * not depend on how the work is shared out; see bn::Population.
+             */
+            explicit Random (const unsigned int seed)
+                : genosect_rng (seed)
+                , frng (seed ^ 0x9e3779b9u) {}
+            ~Random() {};
+
             //! The instance public function. Uses the very short name 'i' to keep code tidy.
             static Random<N,K>* i()
             {
@@ -8,71 +8,154 @@
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <random>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
 #include <morph/vec.h>
 #include <morph/vvec.h>
+#include <morph/Random.h>
 
 namespace morph {
 
-    template <typename T>
+    /*!
+     * Bootstrap statistics for data of type T.
+     *
+     * error_of_mean, error_of_std and ttest_equalityofmeans do not store their resamples. Each
+     * resample's statistic is computed as its elements are drawn, so memory use is O(B) rather
+     * than O(B n), and the resamples are drawn in parallel. The resamples are made in blocks of
+     * resamples_per_stream, each block with its own generator seeded from (seed, block number),
+     * so for a given seed the result does not depend on the number of threads.
+     *
+     * Al is the allocator of the vvecs that resample_with_replacement() fills, when it is asked
+     * for them; morph::pool_allocator<T> (in morph/allocators.h) suits these short-lived vvecs.
+     */
+    template <typename T, typename Al = std::allocator<T>>
     struct bootstrap {
 
         static constexpr bool debug_bstrap = false;
 
-        // Resample B sets from data and place them in resamples
-        static void resample_with_replacement (const morph::vvec<T>& data,
-                                               std::vector<morph::vvec<T>>& resamples, const unsigned int B)
+        //! The number of resamples drawn from each random number stream
+        static constexpr unsigned int resamples_per_stream = 256;
+
+        //! A seed from std::random_device, used when the caller does not give one
+        static unsigned int random_seed()
+        {
+            std::random_device rd;
+            return rd();
+        }
+
+        //! The seed for the generator of block number blk. A splitmix64 hash of (seed, blk), so
+        //! that neighbouring blocks get unrelated seeds.
+        static unsigned int stream_seed (const unsigned int seed, const unsigned int blk)
+        {
+            std::uint64_t z = (static_cast<std::uint64_t>(seed) << 32 | blk) + 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return static_cast<unsigned int>(z ^ (z >> 31));
+        }
+
+        /*!
+         * Call f (i, ru) for each resample i in [0, B). ru is a morph::RandUniform<unsigned int>
+         * giving indices in [0, n-1], which f should call n times to draw resample i. The blocks
+         * of resamples are shared out between threads; f must only write to its own resample's
+         * outputs.
+         */
+        template <typename F>
+        static void for_each_resample (const unsigned int n, const unsigned int B, const unsigned int seed, F f)
+        {
+            if (n == 0 || B == 0) { return; }
+            const int nblocks = static_cast<int>((B + resamples_per_stream - 1) / resamples_per_stream);
+#pragma omp parallel for schedule(dynamic)
+            for (int blk = 0; blk < nblocks; ++blk) {
+                morph::RandUniform<unsigned int> ru (0, n - 1, bootstrap<T, Al>::stream_seed (seed, blk));
+                const unsigned int i0 = static_cast<unsigned int>(blk) * resamples_per_stream;
+                const unsigned int i1 = std::min (B, i0 + resamples_per_stream);
+                for (unsigned int i = i0; i < i1; ++i) { f (i, ru); }
+            }
+        }
+
+        //! Draw one resample of data with ru and return its (mean, variance). The variance has
+        //! the n-1 denominator, as in vvec::variance(). Uses Welford's update.
+        template <typename Ad>
+        static std::pair<T, T> resample_mean_var (const morph::vvec<T, Ad>& data, morph::RandUniform<unsigned int>& ru)
+        {
+            const unsigned int n = data.size();
+            T mean = T{0};
+            T m2 = T{0};
+            for (unsigned int j = 0; j < n; ++j) {
+                const T x = data[ru.get()];
+                const T d = x - mean;
+                mean += d / static_cast<T>(j + 1);
+                m2 += d * (x - mean);
+            }
+            return { mean, n > 1 ? m2 / static_cast<T>(n - 1) : T{0} };
+        }
+
+        // Resample B sets from data and place them in resamples. The resamples are re-used if
+        // resamples already has vvecs of the right size.
+        template <typename Ad, typename Ar>
+        static void resample_with_replacement (const morph::vvec<T, Ad>& data,
+                                               std::vector<morph::vvec<T, Ar>>& resamples, const unsigned int B,
+                                               const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
             unsigned int data_n = data.size();
             resamples.resize (B);
-            for (unsigned int i = 0; i < B; ++i) {
-                morph::vvec<T> resample (data_n);
-                morph::vvec<unsigned int> randindices (data_n);
-                randindices.randomize (0, data_n);
-                for (unsigned int j = 0; j < data_n; ++j) {
-                    resample[j] = data[randindices[j]];
-                }
-                resamples[i] = resample;
+            if (data_n == 0) {
+                for (auto& r : resamples) { r.clear(); }
+                return;
             }
+            for (auto& r : resamples) { r.resize (data_n); }
+            bootstrap<T, Al>::for_each_resample (data_n, B, seed, [&](unsigned int i, morph::RandUniform<unsigned int>& ru)
+            {
+                for (unsigned int j = 0; j < data_n; ++j) { resamples[i][j] = data[ru.get()]; }
+            });
         }
 
         // Compute a bootstapped standard error of the mean of the data with B resamples
-        static T error_of_mean (const morph::vvec<T>& data, const unsigned int B)
+        static T error_of_mean (const morph::vvec<T>& data, const unsigned int B,
+                                const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
-            std::vector<morph::vvec<T>> resamples;
-            morph::bootstrap<T>::resample_with_replacement (data, resamples, B);
             morph::vvec<T> r_mean (B, T{0});
-            for (unsigned int i = 0; i < B; ++i) {
-                r_mean[i] = resamples[i].mean();
-            }
+            bootstrap<T, Al>::for_each_resample (data.size(), B, seed, [&](unsigned int i, morph::RandUniform<unsigned int>& ru)
+            {
+                T s = T{0};
+                for (std::size_t j = 0; j < data.size(); ++j) { s += data[ru.get()]; }
+                r_mean[i] = s / static_cast<T>(data.size());
+            });
             // Standard error is the standard deviation of the resample means
             return r_mean.std();
         }
         // std::vector version of error_of_mean
-        static T error_of_mean (const std::vector<T>& data, const unsigned int B)
+        static T error_of_mean (const std::vector<T>& data, const unsigned int B,
+                                const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
             morph::vvec<T> vdata;
             vdata.set_from (data);
-            return bootstrap<T>::error_of_mean (vdata, B);
+            return bootstrap<T, Al>::error_of_mean (vdata, B, seed);
         }
 
         // Compute a bootstapped standard error of the SD of the data with B resamples
-        static T error_of_std (const morph::vvec<T>& data, const unsigned int B)
+        static T error_of_std (const morph::vvec<T>& data, const unsigned int B,
+                               const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
-            std::vector<morph::vvec<T>> resamples;
-            morph::bootstrap<T>::resample_with_replacement (data, resamples, B);
             morph::vvec<T> r_std (B, T{0});
-            for (unsigned int i = 0; i < B; ++i) {
-                r_std[i] = resamples[i].std();
-            }
+            bootstrap<T, Al>::for_each_resample (data.size(), B, seed, [&](unsigned int i, morph::RandUniform<unsigned int>& ru)
+            {
+                r_std[i] = std::sqrt (bootstrap<T, Al>::resample_mean_var (data, ru).second);
+            });
             // Standard error of the statistic is the standard deviation of the resampled statistic
             return r_std.std();
         }
         // std::vector version of error_of_std
-        static T error_of_std (const std::vector<T>& data, const unsigned int B)
+        static T error_of_std (const std::vector<T>& data, const unsigned int B,
+                               const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
             morph::vvec<T> vdata;
             vdata.set_from (data);
-            return bootstrap<T>::error_of_std (vdata, B);
+            return bootstrap<T, Al>::error_of_std (vdata, B, seed);
         }
 
         // Compute a bootstrapped two sample t statistic as per algorithm 16.2
@@ -98,7 +181,8 @@ namespace morph {
         // Cognitive and Developmental Systems, vol. 10, no. 3, pp. 823-836, Sept. 2018, doi:
         // 10.1109/TCDS.2018.2797426.
         static morph::vec<T, 2> ttest_equalityofmeans (const morph::vvec<T>& _zdata,
-                                                       const morph::vvec<T>& _ydata, const unsigned int B)
+                                                       const morph::vvec<T>& _ydata, const unsigned int B,
+                                                       const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
             // Ensure that the group which we name zdata is the larger one.
             morph::vvec<T> zdata = _zdata;
@@ -138,42 +222,24 @@ namespace morph {
                 std::cout << "ytilda mean: " << ytilda.mean() << std::endl;
             }
 
-            // Resample from the shifted (tilda) distributions:
-            std::vector<morph::vvec<T>> zstar;
-            bootstrap<T>::resample_with_replacement (ztilda, zstar, B);
-            if constexpr (debug_bstrap) {
-                std::cout << "zstar size after resample: " << zstar.size() << std::endl;
-            }
-            std::vector<morph::vvec<T>> ystar;
-            bootstrap<T>::resample_with_replacement (ytilda, ystar, B);
-
-            // Create vectors of the means of these resamples:
-            morph::vvec<T> zstarmeans (B, T{0});
-            morph::vvec<T> ystarmeans (B, T{0});
-
-            for (unsigned int i = 0; i < B; ++i) {
-                zstarmeans[i] = zstar[i].mean();
-                ystarmeans[i] = ystar[i].mean();
-            }
-
-            if constexpr (debug_bstrap) {
-                std::cout << "zstarmeans of size " << zstarmeans.size() << " and content: " << zstarmeans << std::endl;
-            }
-
-            // Compute the variances.
-            morph::vvec<T> zvariances (B, T{0});
-            morph::vvec<T> yvariances (B, T{0});
-            for (unsigned int i = 0; i < B; ++i) {
-                zvariances[i] = (zstar[i]-zstarmeans[i]).pow(2).sum() / (n-1);
-                yvariances[i] = (ystar[i]-ystarmeans[i]).pow(2).sum() / (m-1);
-            }
-            if constexpr (debug_bstrap) {
-                std::cout << "zvariances: " << zvariances << std::endl;
+            // Resample from the shifted (tilda) distributions, computing the studentized
+            // statistic of each pair of resamples as they are drawn. Each block of resamples has
+            // one stream for its z resamples and another for its y resamples.
+            morph::vvec<T> txstar (B, T{0});
+            const int nblocks = static_cast<int>((B + resamples_per_stream - 1) / resamples_per_stream);
+#pragma omp parallel for schedule(dynamic)
+            for (int blk = 0; blk < nblocks; ++blk) {
+                morph::RandUniform<unsigned int> ruz (0, n - 1, bootstrap<T, Al>::stream_seed (seed, 2 * blk));
+                morph::RandUniform<unsigned int> ruy (0, m - 1, bootstrap<T, Al>::stream_seed (seed, 2 * blk + 1));
+                const unsigned int i0 = static_cast<unsigned int>(blk) * resamples_per_stream;
+                const unsigned int i1 = std::min (B, i0 + resamples_per_stream);
+                for (unsigned int i = i0; i < i1; ++i) {
+                    auto [zstarmean, zvariance] = bootstrap<T, Al>::resample_mean_var (ztilda, ruz);
+                    auto [ystarmean, yvariance] = bootstrap<T, Al>::resample_mean_var (ytilda, ruy);
+                    txstar[i] = (zstarmean - ystarmean)
+                                / std::sqrt (yvariance / static_cast<T>(m) + zvariance / static_cast<T>(n));
+                }
             }
-
-            morph::vvec<T> top = zstarmeans - ystarmeans;
-            morph::vvec<T> bot = (yvariances/static_cast<T>(m) + zvariances/static_cast<T>(n)).sqrt();
-            morph::vvec<T> txstar = top / bot;
             if constexpr (debug_bstrap) {
                 std::cout << "txstar (compare with tobs=" << tobs << "): " << txstar << std::endl;
             }
@@ -191,13 +257,14 @@ namespace morph {
         }
         // std::vector version of ttest_equalityofmeans()
         static morph::vec<T, 2> ttest_equalityofmeans (const std::vector<T>& _zdata,
-                                                       const std::vector<T>& _ydata, const unsigned int B)
+                                                       const std::vector<T>& _ydata, const unsigned int B,
+                                                       const unsigned int seed = bootstrap<T, Al>::random_seed())
         {
             morph::vvec<T> vzdata;
             vzdata.set_from (_zdata);
             morph::vvec<T> vydata;
             vydata.set_from (_ydata);
-            return bootstrap<T>::ttest_equalityofmeans (vzdata, vydata, B);
+            return bootstrap<T, Al>::ttest_equalityofmeans (vzdata, vydata, B, seed);
         }
     };
 }
@@ -0,0 +1,185 @@
+/*!
+ * \file
+ *
+ * A uniform grid (or 'cell list') for finding the points within some radius of a location in
+ * time proportional to the number of points nearby, rather than to the number of points in
+ * total. Use it for short range interactions between agents, particles or axon branches, where
+ * a double loop over all pairs would be O(N^2).
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * A cell list over a set of N dimensional points. build() bins the points into square (cubic)
+     * cells of a given side, spanning the bounding box of the points. The points are stored again,
+     * cell by cell, so a query reads memory that is close together.
+     *
+     * Choose the cell side to be the interaction radius (or a little more); a query then visits
+     * 3^N cells. If the bounding box would need many more cells than there are points (because a
+     * few outliers stretch it), the cell side is increased, which keeps the memory in proportion to
+     * the number of points. Queries stay correct for any cell side; they just visit more points.
+     *
+     * The points are copied in build(), so a cell list is a snapshot. Rebuild it when the points
+     * move. build() is O(n) and queries are const, so many threads may query one cell list at once.
+     *
+     * \tparam F The floating point element type of the points
+     *
+     * \tparam N The number of dimensions
+     */
+    template <typename F, std::size_t N = 2>
+    struct cell_list
+    {
+        //! Bin points into cells of side cell_side
+        void build (const std::vector<morph::vec<F, N>>& points, const F cell_side)
+        {
+            if (!(cell_side > F{0})) { throw std::runtime_error ("cell_list: cell_side must be positive"); }
+            if (points.size() > static_cast<std::size_t>(std::numeric_limits<unsigned int>::max())) {
+                throw std::runtime_error ("cell_list: Too many points");
+            }
+            const unsigned int n = static_cast<unsigned int>(points.size());
+            this->side = cell_side;
+            this->lo.set_from (F{0});
+            this->dims.set_from (1u);
+            if (n > 0) {
+                this->lo = points[0];
+                morph::vec<F, N> hi = points[0];
+                for (const auto& p : points) {
+                    for (std::size_t d = 0; d < N; ++d) {
+                        if (!std::isfinite (p[d])) { throw std::runtime_error ("cell_list: Non-finite point"); }
+                        this->lo[d] = std::min (this->lo[d], p[d]);
+                        hi[d] = std::max (hi[d], p[d]);
+                    }
+                }
+                // Grow the cells until there are no more than about four per point
+                const double max_cells = 4.0 * static_cast<double>(n) + 64.0;
+                for (;;) {
+                    double total = 1.0;
+                    for (std::size_t d = 0; d < N; ++d) {
+                        total *= std::floor (static_cast<double>(hi[d] - this->lo[d]) / static_cast<double>(this->side)) + 1.0;
+                    }
+                    if (total <= max_cells) { break; }
+                    this->side *= F{2};
+                }
+                for (std::size_t d = 0; d < N; ++d) {
+                    this->dims[d] = static_cast<unsigned int>(std::floor ((hi[d] - this->lo[d]) / this->side)) + 1u;
+                }
+            }
+
+            // A counting sort of the point indices by cell. Within a cell, the indices are in
+            // ascending order.
+            const std::size_t ncells = this->num_cells();
+            this->cell_start.assign (ncells + 1, 0u);
+            std::vector<unsigned int> cell_of (n);
+            for (unsigned int i = 0; i < n; ++i) {
+                cell_of[i] = this->cell_index (this->cell_coords (points[i]));
+                ++this->cell_start[cell_of[i] + 1];
+            }
+            for (std::size_t c = 0; c < ncells; ++c) { this->cell_start[c + 1] += this->cell_start[c]; }
+            std::vector<unsigned int> fill (this->cell_start.begin(), this->cell_start.end() - 1);
+            this->index.resize (n);
+            this->pos.resize (n);
+            for (unsigned int i = 0; i < n; ++i) {
+                const unsigned int j = fill[cell_of[i]]++;
+                this->index[j] = i;
+                this->pos[j] = points[i];
+            }
+        }
+
+        /*!
+         * Call f (i, p) for each point i (an index into the points passed to build()), at
+         * location p, that lies within radius of x (distance <= radius). The points are visited
+         * cell by cell, so not in index order.
+         */
+        template <typename Fn>
+        void for_each_within (const morph::vec<F, N>& x, const F radius, Fn&& f) const
+        {
+            if (this->index.empty()) { return; }
+            morph::vec<unsigned int, N> c0 = this->cell_coords (x - radius);
+            morph::vec<unsigned int, N> c1 = this->cell_coords (x + radius);
+            const F r2 = radius * radius;
+            // Step through the block of cells from c0 to c1 like an odometer
+            morph::vec<unsigned int, N> c = c0;
+            for (;;) {
+                const unsigned int ci = this->cell_index (c);
+                for (unsigned int j = this->cell_start[ci]; j < this->cell_start[ci + 1]; ++j) {
+                    if ((this->pos[j] - x).sos() <= r2) { f (this->index[j], this->pos[j]); }
+                }
+                std::size_t d = 0;
+                for (; d < N; ++d) {
+                    if (c[d] < c1[d]) { ++c[d]; break; }
+                    c[d] = c0[d];
+                }
+                if (d == N) { break; }
+            }
+        }
+
+        /*!
+         * Place the indices of the points within radius of x into found, in ascending order.
+         * Being in index order, a sum over the neighbours made with found is made in the same
+         * order as a sum over all of the points, so it gives the same result.
+         */
+        void within (const morph::vec<F, N>& x, const F radius, std::vector<unsigned int>& found) const
+        {
+            found.clear();
+            this->for_each_within (x, radius, [&found](unsigned int i, const morph::vec<F, N>&) { found.push_back (i); });
+            std::sort (found.begin(), found.end());
+        }
+
+        //! The number of points given to build()
+        std::size_t size() const { return this->index.size(); }
+
+        //! The number of cells
+        std::size_t num_cells() const
+        {
+            std::size_t nc = 1;
+            for (std::size_t d = 0; d < N; ++d) { nc *= this->dims[d]; }
+            return nc;
+        }
+
+        //! The cell side in use (greater than the one passed to build() if the cells were grown)
+        F cell_side() const { return this->side; }
+
+    private:
+        //! The integer coordinates of the cell containing x, clamped to the grid
+        morph::vec<unsigned int, N> cell_coords (const morph::vec<F, N>& x) const
+        {
+            morph::vec<unsigned int, N> c;
+            for (std::size_t d = 0; d < N; ++d) {
+                const F f = std::floor ((x[d] - this->lo[d]) / this->side);
+                c[d] = f <= F{0} ? 0u : (f >= static_cast<F>(this->dims[d] - 1u) ? this->dims[d] - 1u : static_cast<unsigned int>(f));
+            }
+            return c;
+        }
+
+        //! The index of the cell at coordinates c (the first dimension varies fastest)
+        unsigned int cell_index (const morph::vec<unsigned int, N>& c) const
+        {
+            unsigned int ci = 0;
+            for (std::size_t d = N; d-- > 0;) { ci = ci * this->dims[d] + c[d]; }
+            return ci;
+        }
+
+        //! The cell side
+        F side = F{1};
+        //! The lowest corner of the grid
+        morph::vec<F, N> lo = {};
+        //! The number of cells in each dimension
+        morph::vec<unsigned int, N> dims = {};
+        //! The points in cell c are index[cell_start[c]] to index[cell_start[c + 1] - 1]
+        std::vector<unsigned int> cell_start;
+        //! The original indices of the points, cell by cell
+        std::vector<unsigned int> index;
+        //! The locations of the points, in the same order as index
+        std::vector<morph::vec<F, N>> pos;
+    };
+
+} // namespace morph
@@ -0,0 +1,582 @@
+/*!
+ * \file
+ * \brief A store of arrays, each a directory of separately compressed chunks.
+ *
+ * morph::chunkstore is an alternative to morph::HdfData with the same add_contained_vals,
+ * read_contained_vals, add_val, read_val and read_slice calls. It keeps each array in a
+ * directory that holds a JSON description, .zarray, and one file per chunk, named by the
+ * chunk's indices ("0.3" for the chunk in row 0, column 3 of the chunk grid). Groups are
+ * directories marked with a .zgroup file. This is the layout of version 2 of the Zarr format,
+ * so the arrays can be opened by zarr readers (such as zarr-python) as well.
+ *
+ * Since a chunk is written to its own file (through a temporary name and a rename), chunks
+ * of an array may be written at once from many threads or processes with write_chunk() after
+ * one of them has made the array with create_array(). add_contained_vals compresses its
+ * chunks in parallel, and read_contained_vals and read_slice read theirs in parallel. There
+ * is no library lock, and files on object storage can be fetched a chunk at a time.
+ *
+ * Chunks are compressed with zlib's format (Zarr's "zlib" compressor) by the deflate in
+ * lodepng, or by zlib itself if MORPH_CHUNKSTORE_ZLIB is defined (then link with zlib).
+ */
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <morph/threadpool.h>
+#include <morph/lodepng.h>
+#ifdef MORPH_CHUNKSTORE_ZLIB
+# include <zlib.h>
+#endif
+#include <string>
+#include <vector>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include <bit>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#if defined(__unix__) || defined(__APPLE__)
+# include <unistd.h>
+#endif
+
+namespace morph {
+
+    class chunkstore
+    {
+    public:
+        /*!
+         * Open the store in the directory root. If read_data is false, the directory is made if
+         * need be and arrays may be written; an array written over one that exists replaces it.
+         * Nothing else in root is removed.
+         */
+        chunkstore (const std::string& root, const bool read_data = false)
+            : root_dir (root), read_only (read_data)
+        {
+            if (this->read_only) {
+                if (!std::filesystem::is_directory (this->root_dir)) {
+                    throw std::runtime_error ("chunkstore: No store at '" + root + "'");
+                }
+            } else {
+                std::filesystem::create_directories (this->root_dir);
+                this->write_group_marker (this->root_dir);
+            }
+        }
+
+        //! If true, chunks are compressed (Zarr's zlib compressor); if false, stored raw
+        bool compress = true;
+        //! The zlib level, 0 to 9 (with MORPH_CHUNKSTORE_ZLIB; lodepng's deflate has one level)
+        int compression_level = 4;
+        /*!
+         * The chunk shape for the arrays that add_contained_vals writes, one entry per
+         * dimension. If empty, or of another rank, chunks span all but the first dimension
+         * and hold about chunk_elements values.
+         */
+        std::vector<std::size_t> chunk_dims;
+        //! The number of values in an automatically shaped chunk
+        std::size_t chunk_elements = std::size_t{1} << 18;
+
+        //! The description of an array, from its .zarray
+        struct array_info
+        {
+            std::vector<std::size_t> shape;
+            std::vector<std::size_t> chunks;
+            //! The NumPy style type string, such as "<f8"
+            std::string dtype;
+            bool compressed = false;
+            //! The number of values in the whole array and in one chunk
+            std::size_t size() const { return chunkstore::product (this->shape); }
+            std::size_t chunk_size() const { return chunkstore::product (this->chunks); }
+            //! The number of chunks along each dimension
+            std::vector<std::size_t> grid() const
+            {
+                std::vector<std::size_t> g (this->shape.size());
+                for (std::size_t d = 0; d < g.size(); ++d) { g[d] = (this->shape[d] + this->chunks[d] - 1) / this->chunks[d]; }
+                return g;
+            }
+        };
+
+        //! True if there is an array or a group at path
+        bool exists (const std::string& path) const
+        {
+            const std::filesystem::path p = this->fs_path (path);
+            return std::filesystem::exists (p / ".zarray") || std::filesystem::exists (p / ".zgroup");
+        }
+
+        //! The description of the array at path. Throws if there is none.
+        array_info info (const std::string& path) const
+        {
+            std::ifstream f (this->fs_path (path) / ".zarray");
+            if (!f.is_open()) { throw std::runtime_error ("chunkstore: No array " + path); }
+            nlohmann::json j;
+            f >> j;
+            array_info ai;
+            ai.shape = j.at ("shape").get<std::vector<std::size_t>>();
+            ai.chunks = j.at ("chunks").get<std::vector<std::size_t>>();
+            ai.dtype = j.at ("dtype").get<std::string>();
+            if (j.at ("order").get<std::string>() != "C") { throw std::runtime_error ("chunkstore: " + path + " is not in C order"); }
+            if (j.contains ("filters") && !j["filters"].is_null()) { throw std::runtime_error ("chunkstore: Filters on " + path + " are not supported"); }
+            if (j.contains ("compressor") && !j["compressor"].is_null()) {
+                const std::string id = j["compressor"].at ("id").get<std::string>();
+                if (id != "zlib") { throw std::runtime_error ("chunkstore: " + path + " is compressed with " + id + ", not zlib"); }
+                ai.compressed = true;
+            }
+            if (ai.shape.size() != ai.chunks.size() || ai.shape.empty()) {
+                throw std::runtime_error ("chunkstore: Bad shape in " + path);
+            }
+            for (auto c : ai.chunks) { if (c == 0) { throw std::runtime_error ("chunkstore: Bad chunks in " + path); } }
+            return ai;
+        }
+
+        /*!
+         * Make an empty array of T at path, of the given shape and chunk shape (automatic if
+         * chunks is empty), replacing any array there. Its chunks are then written with
+         * write_chunk(); any that are never written read as zeros.
+         */
+        template <typename T>
+        void create_array (const std::string& path, const std::vector<std::size_t>& shape, std::vector<std::size_t> chunks = {})
+        {
+            if (this->read_only) { throw std::runtime_error ("chunkstore: The store is read only"); }
+            if (shape.empty()) { throw std::runtime_error ("chunkstore: An array needs at least one dimension"); }
+            if (chunks.size() != shape.size()) { chunks = this->auto_chunks (shape); }
+            const std::filesystem::path p = this->fs_path (path);
+            // Make (and mark) the groups on the way
+            std::filesystem::path g = this->root_dir;
+            for (const auto& part : std::filesystem::path (path).relative_path().parent_path()) {
+                g /= part;
+                std::filesystem::create_directories (g);
+                this->write_group_marker (g);
+            }
+            std::filesystem::remove_all (p);
+            std::filesystem::create_directories (p);
+            nlohmann::json j;
+            j["zarr_format"] = 2;
+            j["shape"] = shape;
+            j["chunks"] = chunks;
+            j["dtype"] = chunkstore::dtype<T>();
+            if (this->compress) {
+                j["compressor"] = { { "id", "zlib" }, { "level", this->compression_level } };
+            } else {
+                j["compressor"] = nullptr;
+            }
+            j["fill_value"] = 0;
+            j["order"] = "C";
+            j["filters"] = nullptr;
+            std::ofstream f (p / ".zarray");
+            f << j.dump (4) << "\n";
+            if (!f.good()) { throw std::runtime_error ("chunkstore: Failed to write " + (p / ".zarray").string()); }
+        }
+
+        /*!
+         * Write the chunk of the array at path with indices idx in the chunk grid, from
+         * vals, which holds info().chunk_size() values in C order (those that fall beyond
+         * the edge of the array are stored but ignored). Safe to call from many threads (or
+         * processes) at once for different chunks.
+         */
+        template <typename T>
+        void write_chunk (const std::string& path, const std::vector<std::size_t>& idx, const T* vals) const
+        {
+            this->write_chunk (path, this->info (path), idx, vals);
+        }
+
+        /*!
+         * Read the chunk with indices idx of the array at path into vals, which must have
+         * room for info().chunk_size() values. A chunk that was never written reads as zeros.
+         */
+        template <typename T>
+        void read_chunk (const std::string& path, const std::vector<std::size_t>& idx, T* vals) const
+        {
+            this->read_chunk (path, this->info (path), idx, vals);
+        }
+
+        /*!
+         * Write the values in vals, a container (vector, vvec, deque...) of scalars or of
+         * fixed size arrays (std::array, morph::vec), as an array at path. Scalars make a 1D
+         * array; arrays of N make a 2D array of shape [n, N].
+         */
+        template <typename C>
+        void add_contained_vals (const std::string& path, const C& vals)
+        {
+            using E = typename C::value_type;
+            using T = typename chunkstore::element<E>::type;
+            constexpr std::size_t N = chunkstore::element<E>::n;
+            std::vector<T> flat;
+            flat.reserve (vals.size() * N);
+            for (const E& e : vals) {
+                if constexpr (N == 1 && std::is_arithmetic_v<E>) { flat.push_back (e); } else { for (const T& t : e) { flat.push_back (t); } }
+            }
+            std::vector<std::size_t> shape = { vals.size() };
+            if constexpr (!std::is_arithmetic_v<E>) { shape.push_back (N); }
+            this->write_array (path, shape, flat.data());
+        }
+
+        //! Write the array at path, of the given shape, from the values in C order in vals
+        template <typename T>
+        void write_array (const std::string& path, const std::vector<std::size_t>& shape, const T* vals)
+        {
+            this->create_array<T> (path, shape, this->chunk_dims);
+            const array_info ai = this->info (path);
+            const std::vector<std::size_t> grid = ai.grid();
+            const std::size_t nchunks = chunkstore::product (grid);
+            this->for_each_parallel (nchunks, [&](std::size_t c) {
+                const std::vector<std::size_t> idx = chunkstore::unravel (c, grid);
+                std::vector<T> buf (ai.chunk_size(), T{0});
+                chunkstore::copy_region<false> (ai, idx, buf.data(), vals, ai.shape, std::vector<std::size_t>(shape.size(), 0));
+                this->write_chunk (path, ai, idx, buf.data());
+            });
+        }
+
+        /*!
+         * Read the array at path into vals, resizing it, in the layouts that
+         * add_contained_vals writes. Values stored as another arithmetic type are converted.
+         */
+        template <typename C>
+        void read_contained_vals (const std::string& path, C& vals) const
+        {
+            using E = typename C::value_type;
+            using T = typename chunkstore::element<E>::type;
+            constexpr std::size_t N = chunkstore::element<E>::n;
+            const array_info ai = this->info (path);
+            if constexpr (!std::is_arithmetic_v<E>) {
+                if (ai.shape.size() != 2 || ai.shape[1] != N) {
+                    throw std::runtime_error ("chunkstore: " + path + " does not have " + std::to_string (N) + " columns");
+                }
+            }
+            std::vector<T> flat (ai.size());
+            this->read_region (path, ai, std::vector<std::size_t>(ai.shape.size(), 0), ai.shape, flat.data());
+            vals.resize (ai.shape[0]);
+            std::size_t i = 0;
+            for (E& e : vals) {
+                if constexpr (std::is_arithmetic_v<E>) { e = flat[i++]; } else { for (T& t : e) { t = flat[i++]; } }
+            }
+        }
+
+        /*!
+         * Read the region of the array at path that starts at start and has count elements in
+         * each dimension into vals (resized to the product of count), reading only the chunks
+         * that it touches.
+         */
+        template <typename T>
+        void read_slice (const std::string& path, const std::vector<std::size_t>& start,
+                         const std::vector<std::size_t>& count, std::vector<T>& vals) const
+        {
+            const array_info ai = this->info (path);
+            if (start.size() != ai.shape.size() || count.size() != ai.shape.size()) {
+                throw std::runtime_error ("chunkstore::read_slice: start and count must each have " + std::to_string (ai.shape.size()) + " elements");
+            }
+            for (std::size_t d = 0; d < start.size(); ++d) {
+                if (start[d] + count[d] > ai.shape[d]) { throw std::runtime_error ("chunkstore::read_slice: Selection lies outside " + path); }
+            }
+            vals.resize (chunkstore::product (count));
+            this->read_region (path, ai, start, count, vals.data());
+        }
+
+        //! Write a single value, as an array of shape [1]
+        template <typename T> requires std::is_arithmetic_v<T>
+        void add_val (const std::string& path, const T& val) { this->write_array (path, { 1 }, &val); }
+
+        //! Read a single value
+        template <typename T> requires std::is_arithmetic_v<T>
+        void read_val (const std::string& path, T& val) const
+        {
+            std::vector<T> v;
+            this->read_slice (path, { 0 }, { 1 }, v);
+            val = v[0];
+        }
+
+        //! The NumPy style type string for T in this machine's byte order
+        template <typename T>
+        static std::string dtype()
+        {
+            static_assert (std::is_arithmetic_v<T>, "chunkstore stores arithmetic types");
+            const char order = sizeof (T) == 1 ? '|' : (std::endian::native == std::endian::little ? '<' : '>');
+            const char kind = std::is_floating_point_v<T> ? 'f' : (std::is_same_v<T, bool> ? 'b' : (std::is_signed_v<T> ? 'i' : 'u'));
+            return std::string(1, order) + kind + std::to_string (sizeof (T));
+        }
+
+    private:
+        std::filesystem::path root_dir;
+        bool read_only = false;
+
+        //! The element type and count of a container's value_type E
+        template <typename E, typename = void>
+        struct element { using type = E; static constexpr std::size_t n = 1; };
+        template <typename E>
+        struct element<E, std::enable_if_t<!std::is_arithmetic_v<E>>>
+        {
+            using type = std::remove_cv_t<typename E::value_type>;
+            static constexpr std::size_t n = sizeof (E) / sizeof (type);
+            static_assert (std::is_arithmetic_v<type> && std::is_trivially_copyable_v<E>,
+                           "chunkstore: Containers hold scalars or fixed size arrays of scalars");
+        };
+
+        static std::size_t product (const std::vector<std::size_t>& v)
+        {
+            std::size_t n = 1;
+            for (auto x : v) { n *= x; }
+            return n;
+        }
+
+        //! The indices in grid of flat index c (C order)
+        static std::vector<std::size_t> unravel (std::size_t c, const std::vector<std::size_t>& grid)
+        {
+            std::vector<std::size_t> idx (grid.size(), 0);
+            for (std::size_t d = grid.size(); d-- > 0;) {
+                idx[d] = c % grid[d];
+                c /= grid[d];
+            }
+            return idx;
+        }
+
+        std::vector<std::size_t> auto_chunks (const std::vector<std::size_t>& shape) const
+        {
+            std::vector<std::size_t> c = shape;
+            std::size_t row = 1;
+            for (std::size_t d = 1; d < shape.size(); ++d) { row *= std::max (shape[d], std::size_t{1}); }
+            c[0] = std::clamp (this->chunk_elements / row, std::size_t{1}, std::max (shape[0], std::size_t{1}));
+            for (auto& x : c) { x = std::max (x, std::size_t{1}); }
+            return c;
+        }
+
+        std::filesystem::path fs_path (const std::string& path) const
+        {
+            return this->root_dir / std::filesystem::path (path).relative_path();
+        }
+
+        static std::string chunk_key (const std::vector<std::size_t>& idx)
+        {
+            std::string k;
+            for (std::size_t d = 0; d < idx.size(); ++d) { k += (d > 0 ? "." : "") + std::to_string (idx[d]); }
+            return k;
+        }
+
+        void write_group_marker (const std::filesystem::path& g) const
+        {
+            if (std::filesystem::exists (g / ".zgroup")) { return; }
+            std::ofstream f (g / ".zgroup");
+            f << "{\n    \"zarr_format\": 2\n}\n";
+        }
+
+        /*!
+         * Copy between the chunk idx of ai, held in chunk, and the region of a C order array
+         * of shape rshape whose first element is at rstart of ai: into the region from the
+         * chunk if to_region, else into the chunk from the region. Only the elements that are
+         * in both (and in the array) are copied.
+         */
+        template <bool to_region, typename T, typename R>
+        static void copy_region (const array_info& ai, const std::vector<std::size_t>& idx, T* chunk, R* region,
+                                 const std::vector<std::size_t>& rshape, const std::vector<std::size_t>& rstart)
+        {
+            const std::size_t nd = ai.shape.size();
+            // The overlap, in array coordinates
+            std::vector<std::size_t> lo (nd), hi (nd);
+            for (std::size_t d = 0; d < nd; ++d) {
+                lo[d] = std::max (idx[d] * ai.chunks[d], rstart[d]);
+                hi[d] = std::min ({ (idx[d] + 1) * ai.chunks[d], rstart[d] + rshape[d], ai.shape[d] });
+                if (lo[d] >= hi[d]) { return; }
+            }
+            // Walk the overlap a row (of the last dimension) at a time
+            std::vector<std::size_t> at = lo;
+            const std::size_t run = hi[nd - 1] - lo[nd - 1];
+            for (;;) {
+                std::size_t ci = 0, ri = 0;
+                for (std::size_t d = 0; d < nd; ++d) {
+                    ci = ci * ai.chunks[d] + (at[d] - idx[d] * ai.chunks[d]);
+                    ri = ri * rshape[d] + (at[d] - rstart[d]);
+                }
+                for (std::size_t k = 0; k < run; ++k) {
+                    if constexpr (to_region) { region[ri + k] = chunk[ci + k]; } else { chunk[ci + k] = region[ri + k]; }
+                }
+                std::size_t d = nd - 1;
+                while (d-- > 0) {
+                    if (++at[d] < hi[d]) { break; }
+                    at[d] = lo[d];
+                }
+                if (d == std::numeric_limits<std::size_t>::max()) { return; }
+            }
+        }
+
+        //! Call f (i) for i in [0, n) on the shared pool, passing on the first exception thrown
+        template <typename F>
+        static void for_each_parallel (const std::size_t n, F&& f)
+        {
+            std::exception_ptr err = nullptr;
+            std::mutex m;
+            morph::parallel_for (std::size_t{0}, n, [&](std::size_t i) {
+                try {
+                    f (i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk (m);
+                    if (!err) { err = std::current_exception(); }
+                }
+            }, 1);
+            if (err) { std::rethrow_exception (err); }
+        }
+
+        template <typename T>
+        void write_chunk (const std::string& path, const array_info& ai, const std::vector<std::size_t>& idx, const T* vals) const
+        {
+            if (this->read_only) { throw std::runtime_error ("chunkstore: The store is read only"); }
+            if (ai.dtype != chunkstore::dtype<T>()) {
+                throw std::runtime_error ("chunkstore: " + path + " holds " + ai.dtype + ", not " + chunkstore::dtype<T>());
+            }
+            const std::vector<std::size_t> grid = ai.grid();
+            for (std::size_t d = 0; d < grid.size(); ++d) {
+                if (idx.size() != grid.size() || idx[d] >= grid[d]) { throw std::runtime_error ("chunkstore: No such chunk in " + path); }
+            }
+            const unsigned char* raw = reinterpret_cast<const unsigned char*>(vals);
+            const std::size_t nbytes = ai.chunk_size() * sizeof (T);
+            std::vector<unsigned char> z;
+            if (ai.compressed) { z = this->deflate (raw, nbytes); }
+            const std::filesystem::path p = this->fs_path (path) / chunkstore::chunk_key (idx);
+            // A temporary name of the writer's own, then a rename, so readers never see part of a chunk
+            std::size_t writer = std::hash<std::thread::id>{} (std::this_thread::get_id());
+#if defined(__unix__) || defined(__APPLE__)
+            writer ^= static_cast<std::size_t>(::getpid()) << 1;
+#endif
+            const std::filesystem::path tmp = p.string() + "." + std::to_string (writer) + ".tmp";
+            {
+                std::ofstream f (tmp, std::ios::binary | std::ios::trunc);
+                if (ai.compressed) {
+                    f.write (reinterpret_cast<const char*>(z.data()), static_cast<std::streamsize>(z.size()));
+                } else {
+                    f.write (reinterpret_cast<const char*>(raw), static_cast<std::streamsize>(nbytes));
+                }
+                if (!f.good()) { throw std::runtime_error ("chunkstore: Failed to write " + tmp.string()); }
+            }
+            std::filesystem::rename (tmp, p);
+        }
+
+        template <typename T>
+        void read_chunk (const std::string& path, const array_info& ai, const std::vector<std::size_t>& idx, T* vals) const
+        {
+            const std::size_t n = ai.chunk_size();
+            const std::filesystem::path p = this->fs_path (path) / chunkstore::chunk_key (idx);
+            std::ifstream f (p, std::ios::binary | std::ios::ate);
+            if (!f.is_open()) {
+                std::fill (vals, vals + n, T{0});
+                return;
+            }
+            std::vector<unsigned char> in (static_cast<std::size_t>(f.tellg()));
+            f.seekg (0);
+            f.read (reinterpret_cast<char*>(in.data()), static_cast<std::streamsize>(in.size()));
+            const std::size_t isz = static_cast<std::size_t>(std::stoul (ai.dtype.substr (2)));
+            std::vector<unsigned char> out;
+            if (ai.compressed) { out = chunkstore::inflate (in, n * isz); } else { out.swap (in); }
+            if (out.size() != n * isz) { throw std::runtime_error ("chunkstore: Chunk " + p.string() + " has the wrong size"); }
+            chunkstore::convert (ai.dtype, out.data(), vals, n);
+        }
+
+        //! Convert n values of the type named by dt from bytes into vals
+        template <typename T>
+        static void convert (const std::string& dt, const unsigned char* bytes, T* vals, const std::size_t n)
+        {
+            const char order = std::endian::native == std::endian::little ? '<' : '>';
+            if (dt[0] != '|' && dt[0] != order) { throw std::runtime_error ("chunkstore: Can't read values of the other byte order"); }
+            auto from = [&]<typename S>(S) {
+                if constexpr (std::is_same_v<S, T>) {
+                    std::memcpy (vals, bytes, n * sizeof (T));
+                } else {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        S s;
+                        std::memcpy (&s, bytes + i * sizeof (S), sizeof (S));
+                        vals[i] = static_cast<T>(s);
+                    }
+                }
+            };
+            const std::string k = dt.substr (1);
+            if (k == "f8") { from (double{}); }
+            else if (k == "f4") { from (float{}); }
+            else if (k == "i8") { from (std::int64_t{}); }
+            else if (k == "i4") { from (std::int32_t{}); }
+            else if (k == "i2") { from (std::int16_t{}); }
+            else if (k == "i1") { from (std::int8_t{}); }
+            else if (k == "u8") { from (std::uint64_t{}); }
+            else if (k == "u4") { from (std::uint32_t{}); }
+            else if (k == "u2") { from (std::uint16_t{}); }
+            else if (k == "u1") { from (std::uint8_t{}); }
+            else if (k == "b1") { from (bool{}); }
+            else { throw std::runtime_error ("chunkstore: Unknown dtype " + dt); }
+        }
+
+        //! Read the region of shape count at start of the array at path into vals, a chunk per task
+        template <typename T>
+        void read_region (const std::string& path, const array_info& ai, const std::vector<std::size_t>& start,
+                          const std::vector<std::size_t>& count, T* vals) const
+        {
+            if (chunkstore::product (count) == 0) { return; }
+            // The range of chunks that the region touches
+            const std::size_t nd = ai.shape.size();
+            std::vector<std::size_t> c0 (nd), cn (nd);
+            for (std::size_t d = 0; d < nd; ++d) {
+                c0[d] = start[d] / ai.chunks[d];
+                cn[d] = (start[d] + count[d] - 1) / ai.chunks[d] - c0[d] + 1;
+            }
+            this->for_each_parallel (chunkstore::product (cn), [&](std::size_t c) {
+                std::vector<std::size_t> idx = chunkstore::unravel (c, cn);
+                for (std::size_t d = 0; d < nd; ++d) { idx[d] += c0[d]; }
+                std::vector<T> buf (ai.chunk_size());
+                this->read_chunk (path, ai, idx, buf.data());
+                chunkstore::copy_region<true> (ai, idx, buf.data(), vals, count, start);
+            });
+        }
+
+        std::vector<unsigned char> deflate (const unsigned char* in, const std::size_t n) const
+        {
+#ifdef MORPH_CHUNKSTORE_ZLIB
+            uLongf zn = compressBound (static_cast<uLong>(n));
+            std::vector<unsigned char> z (zn);
+            if (compress2 (z.data(), &zn, in, static_cast<uLong>(n), std::clamp (this->compression_level, 0, 9)) != Z_OK) {
+                throw std::runtime_error ("chunkstore: zlib failed to compress a chunk");
+            }
+            z.resize (zn);
+            return z;
+#else
+            unsigned char* out = nullptr;
+            std::size_t outsize = 0;
+            LodePNGCompressSettings s;
+            lodepng_compress_settings_init (&s);
+            const unsigned error = lodepng_zlib_compress (&out, &outsize, in, n, &s);
+            std::vector<unsigned char> z;
+            if (error == 0) { z.assign (out, out + outsize); }
+            lodepng_free (out);
+            if (error != 0) { throw std::runtime_error ("chunkstore: Failed to compress a chunk"); }
+            return z;
+#endif
+        }
+
+        static std::vector<unsigned char> inflate (const std::vector<unsigned char>& in, const std::size_t n)
+        {
+#ifdef MORPH_CHUNKSTORE_ZLIB
+            std::vector<unsigned char> out (n);
+            uLongf on = static_cast<uLongf>(n);
+            if (uncompress (out.data(), &on, in.data(), static_cast<uLong>(in.size())) != Z_OK) {
+                throw std::runtime_error ("chunkstore: zlib failed to decompress a chunk");
+            }
+            out.resize (on);
+            return out;
+#else
+            unsigned char* out = nullptr;
+            std::size_t outsize = 0;
+            LodePNGDecompressSettings s;
+            lodepng_decompress_settings_init (&s);
+            s.max_output_size = n;
+            const unsigned error = lodepng_zlib_decompress (&out, &outsize, in.data(), in.size(), &s);
+            std::vector<unsigned char> v;
+            if (error == 0) { v.assign (out, out + outsize); }
+            lodepng_free (out);
+            if (error != 0) { throw std::runtime_error ("chunkstore: Failed to decompress a chunk"); }
+            return v;
+#endif
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,151 @@
+/*!
+ * \file
+ *
+ * A read only, non-owning view of an array of data, which may be strided. VisualDataModel holds
+ * its scalar data through one of these, so a model can show a std::vector, a slice of a bigger
+ * buffer, one component of a vvec<vec<T, N>> or memory mapped from a file without a copy.
+ */
+#pragma once
+
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <morph/vec.h>
+
+namespace morph {
+
+    /*!
+     * A view of n elements of type T starting at ptr, with consecutive elements stride elements
+     * apart. Alternatively the view may refer to a std::vector, in which case its size and data
+     * are read from the vector each time they are needed, so the vector may be resized (and so
+     * reallocated) after the view was made. Either way the data is not copied, and must outlive
+     * the view.
+     *
+     *\code{.cpp}
+     * morph::vvec<morph::vec<float, 3>> v (100);
+     * morph::data_view<float> y = morph::data_view<float>::component (v, 1); // v[i][1]
+     * morph::data_view<float> half (std::span<const float>(buf).subspan (0, buf.size() / 2));
+     *\endcode
+     */
+    template <typename T>
+    class data_view
+    {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = const T&;
+        using const_reference = const T&;
+
+        //! A random access iterator over the view
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            const_iterator() = default;
+            const_iterator (const data_view<T>* _dv, std::size_t _i) : dv(_dv), i(_i) {}
+
+            reference operator*() const { return (*this->dv)[this->i]; }
+            pointer operator->() const { return &(*this->dv)[this->i]; }
+            reference operator[] (difference_type n) const { return (*this->dv)[this->i + n]; }
+
+            const_iterator& operator++() { ++this->i; return *this; }
+            const_iterator operator++ (int) { const_iterator t = *this; ++this->i; return t; }
+            const_iterator& operator--() { --this->i; return *this; }
+            const_iterator operator-- (int) { const_iterator t = *this; --this->i; return t; }
+            const_iterator& operator+= (difference_type n) { this->i += n; return *this; }
+            const_iterator& operator-= (difference_type n) { this->i -= n; return *this; }
+            const_iterator operator+ (difference_type n) const { return const_iterator (this->dv, this->i + n); }
+            const_iterator operator- (difference_type n) const { return const_iterator (this->dv, this->i - n); }
+            friend const_iterator operator+ (difference_type n, const const_iterator& it) { return it + n; }
+            difference_type operator- (const const_iterator& rhs) const
+            {
+                return static_cast<difference_type>(this->i) - static_cast<difference_type>(rhs.i);
+            }
+
+            bool operator== (const const_iterator& rhs) const { return this->i == rhs.i; }
+            bool operator!= (const const_iterator& rhs) const { return this->i != rhs.i; }
+            bool operator< (const const_iterator& rhs) const { return this->i < rhs.i; }
+            bool operator> (const const_iterator& rhs) const { return this->i > rhs.i; }
+            bool operator<= (const const_iterator& rhs) const { return this->i <= rhs.i; }
+            bool operator>= (const const_iterator& rhs) const { return this->i >= rhs.i; }
+
+        private:
+            const data_view<T>* dv = nullptr;
+            std::size_t i = 0;
+        };
+        using iterator = const_iterator;
+
+        //! An empty view
+        data_view() = default;
+
+        //! View the std::vector *_vec (or nothing, if _vec is nullptr)
+        data_view (const std::vector<T>* _vec) : source(_vec) {}
+
+        //! View a contiguous span of data
+        data_view (std::span<const T> _data) : ptr(_data.data()), n(_data.size()) {}
+
+        //! View _n elements from _ptr, _stride elements apart
+        data_view (const T* _ptr, const std::size_t _n, const std::size_t _stride = 1)
+            : ptr(_ptr), n(_n), stride(_stride)
+        {
+            if (_stride == 0) { throw std::runtime_error ("data_view: stride must be at least 1"); }
+        }
+
+        //! View component j of each element of a container of vec<T, N>
+        template <std::size_t N, typename Al>
+        static data_view<T> component (const std::vector<vec<T, N>, Al>& v, const std::size_t j)
+        {
+            static_assert (sizeof (vec<T, N>) == N * sizeof (T), "data_view: vec<T, N> must be packed");
+            if (j >= N) { throw std::runtime_error ("data_view::component: j must be less than N"); }
+            if (v.empty()) { return data_view<T>(); }
+            return data_view<T> (v[0].data() + j, v.size(), N);
+        }
+
+        //! False for a view of nothing, such as one made from a null pointer
+        bool bound() const { return this->source != nullptr || this->ptr != nullptr; }
+
+        std::size_t size() const { return this->source != nullptr ? this->source->size() : this->n; }
+        bool empty() const { return this->size() == 0; }
+
+        //! The distance, in elements of T, between consecutive elements of the view
+        std::size_t get_stride() const { return this->source != nullptr ? 1 : this->stride; }
+
+        //! True if the elements are adjacent in memory, in which case data() and span() may be used
+        bool contiguous() const { return this->get_stride() == 1; }
+
+        const T& operator[] (const std::size_t i) const
+        {
+            return this->source != nullptr ? (*this->source)[i] : this->ptr[i * this->stride];
+        }
+
+        //! The address of the first element. Consecutive elements are get_stride() apart.
+        const T* data() const { return this->source != nullptr ? this->source->data() : this->ptr; }
+
+        //! The view as a span. Only for a contiguous view.
+        std::span<const T> span() const
+        {
+            if (!this->contiguous()) { throw std::runtime_error ("data_view::span: the view is strided"); }
+            return std::span<const T> (this->data(), this->size());
+        }
+
+        const_iterator begin() const { return const_iterator (this, 0); }
+        const_iterator end() const { return const_iterator (this, this->size()); }
+
+    private:
+        //! If set, the vector that is viewed
+        const std::vector<T>* source = nullptr;
+        //! Otherwise, the first element, the number of elements and the stride
+        const T* ptr = nullptr;
+        std::size_t n = 0;
+        std::size_t stride = 1;
+    };
+
+} // namespace morph
@@ -0,0 +1,261 @@
+/*!
+ * \file
+ *
+ * Connected-component labelling of an identity map on a HexGrid. Each domain is a set of
+ * contiguous hexes sharing one identity value. The labels are found with a union-find over
+ * the grid's d_ne, d_nne and d_nnw vectors (which between them visit every pair of
+ * neighbours once), in parallel over blocks of hexes.
+ *
+ * update() re-labels incrementally. Hexes whose identity has not changed keep their domain
+ * unless their domain contains, or neighbours, a hex whose identity did change; only the
+ * hexes of those domains are revisited. When a pattern settles, as it does in a barrel field
+ * simulation, each analysis point costs little more than the comparison with the last one.
+ */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <morph/HexGrid.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+namespace morph {
+
+    template <typename Flt>
+    class dirichlet_labels
+    {
+    public:
+        //! One domain: its identity and its hexes (vector indices, ascending)
+        struct domain
+        {
+            Flt f = Flt{0};
+            std::vector<int> hexes;
+        };
+
+        explicit dirichlet_labels (const HexGrid& _hg)
+            : hg(&_hg)
+            , n(static_cast<int>(_hg.num()))
+        {
+            this->nb[0] = &_hg.d_ne;
+            this->nb[1] = &_hg.d_nne;
+            this->nb[2] = &_hg.d_nnw;
+            this->nb[3] = &_hg.d_nw;
+            this->nb[4] = &_hg.d_nsw;
+            this->nb[5] = &_hg.d_nse;
+        }
+
+        //! The domain of each hex, an index into domains
+        std::vector<int> label;
+
+        /*!
+         * The domains. A slot is reused by a later domain when its own domain goes; slots with no
+         * hexes are unused.
+         */
+        std::vector<domain> domains;
+
+        //! The hexes whose identity, or a neighbour's identity, changed in the last update()
+        std::vector<int> touched;
+
+        //! True if the last call re-labelled every hex
+        bool relabelled_all = true;
+
+        //! True if slot d was (re)filled by the last call, false if its domain is unchanged
+        bool fresh (const int d) const { return this->slot_fresh[d] != 0; }
+
+        //! The number of domains
+        unsigned int num_domains() const
+        {
+            unsigned int c = 0;
+            for (const domain& d : this->domains) { c += d.hexes.empty() ? 0 : 1; }
+            return c;
+        }
+
+        //! The area of domain d
+        Flt area (const int d) const { return this->hg->getHexArea() * static_cast<Flt>(this->domains[d].hexes.size()); }
+
+        const HexGrid* grid() const { return this->hg; }
+
+        //! Label the identity map f from scratch
+        void compute (const std::vector<Flt>& f)
+        {
+            this->check_size (f);
+            this->f_last = f;
+            this->parent.resize (this->n);
+
+            // Union within blocks in parallel, keeping the edges between blocks for later
+            std::vector<std::vector<std::pair<int, int>>> cross;
+#pragma omp parallel
+            {
+#ifdef _OPENMP
+                const int nt = omp_get_num_threads();
+                const int t = omp_get_thread_num();
+#else
+                const int nt = 1;
+                const int t = 0;
+#endif
+#pragma omp single
+                cross.resize (nt);
+                const int b = static_cast<int>((static_cast<long long>(this->n) * t) / nt);
+                const int e = static_cast<int>((static_cast<long long>(this->n) * (t + 1)) / nt);
+                for (int h = b; h < e; ++h) { this->parent[h] = h; }
+                for (int h = b; h < e; ++h) {
+                    for (int d = 0; d < 3; ++d) {
+                        const int j = (*this->nb[d])[h];
+                        if (j < 0 || f[j] != f[h]) { continue; }
+                        if (j >= b && j < e) {
+                            this->unite (h, j);
+                        } else {
+                            cross[t].push_back ({ h, j });
+                        }
+                    }
+                }
+            }
+            for (const auto& c : cross) {
+                for (const auto& hj : c) { this->unite (hj.first, hj.second); }
+            }
+
+            // Every root is its component's lowest index, so slots come in order of first hex
+            this->domains.clear();
+            this->free_slots.clear();
+            this->label.assign (this->n, -1);
+            for (int h = 0; h < this->n; ++h) {
+                const int r = this->find (h);
+                if (r == h) {
+                    this->label[h] = static_cast<int>(this->domains.size());
+                    this->domains.push_back ({ f[h], {} });
+                } else {
+                    this->label[h] = this->label[r];
+                }
+                this->domains[this->label[h]].hexes.push_back (h);
+            }
+            this->slot_fresh.assign (this->domains.size(), 1);
+            this->relabelled_all = true;
+            this->touched.resize (this->n);
+            for (int h = 0; h < this->n; ++h) { this->touched[h] = h; }
+        }
+
+        /*!
+         * Label the identity map f, revisiting only the domains that contain or neighbour a hex
+         * whose identity has changed since the last call. The first call labels everything, as
+         * does a call in which more than half the hexes would be revisited. Returns the number of
+         * hexes revisited.
+         */
+        unsigned int update (const std::vector<Flt>& f)
+        {
+            if (this->f_last.size() != f.size() || this->label.empty()) {
+                this->compute (f);
+                return this->n;
+            }
+            this->mark.assign (this->n, 0);
+            std::vector<char> dirty (this->domains.size(), 0);
+            this->touched.clear();
+            auto touch = [this, &dirty](const int h) {
+                if (this->mark[h] & 1) { return; }
+                this->mark[h] |= 1;
+                this->touched.push_back (h);
+                dirty[this->label[h]] = 1;
+            };
+            for (int h = 0; h < this->n; ++h) {
+                if (f[h] == this->f_last[h]) { continue; }
+                touch (h);
+                for (const std::vector<int>* v : this->nb) {
+                    if ((*v)[h] >= 0) { touch ((*v)[h]); }
+                }
+            }
+            std::vector<int> revisit;
+            for (std::size_t d = 0; d < this->domains.size(); ++d) {
+                if (dirty[d]) { revisit.insert (revisit.end(), this->domains[d].hexes.begin(), this->domains[d].hexes.end()); }
+            }
+            if (revisit.size() > static_cast<std::size_t>(this->n / 2)) {
+                this->compute (f);
+                return this->n;
+            }
+            std::sort (revisit.begin(), revisit.end());
+            std::sort (this->touched.begin(), this->touched.end());
+            for (int h : revisit) { this->f_last[h] = f[h]; }
+
+            // Free the dirty slots, then union over the revisited hexes alone. No hex outside
+            // them neighbours one inside with the same identity: the two would have shared a
+            // domain, dirty or clean, before the change.
+            this->slot_fresh.assign (this->domains.size(), 0);
+            for (std::size_t d = 0; d < this->domains.size(); ++d) {
+                if (dirty[d]) {
+                    this->domains[d].hexes.clear();
+                    this->free_slots.push_back (static_cast<int>(d));
+                }
+            }
+            for (int h : revisit) { this->parent[h] = h; this->mark[h] |= 2; }
+            for (int h : revisit) {
+                for (int d = 0; d < 3; ++d) {
+                    const int j = (*this->nb[d])[h];
+                    if (j >= 0 && (this->mark[j] & 2) && f[j] == f[h]) { this->unite (h, j); }
+                }
+            }
+            for (int h : revisit) {
+                const int r = this->find (h);
+                if (r == h) {
+                    int s = 0;
+                    if (this->free_slots.empty()) {
+                        s = static_cast<int>(this->domains.size());
+                        this->domains.push_back ({});
+                        this->slot_fresh.push_back (0);
+                    } else {
+                        s = this->free_slots.back();
+                        this->free_slots.pop_back();
+                    }
+                    this->domains[s].f = f[h];
+                    this->slot_fresh[s] = 1;
+                    this->label[h] = s;
+                } else {
+                    this->label[h] = this->label[r];
+                }
+                this->domains[this->label[h]].hexes.push_back (h);
+            }
+            this->relabelled_all = false;
+            return static_cast<unsigned int>(revisit.size());
+        }
+
+    protected:
+        const HexGrid* hg;
+        int n;
+        const std::vector<int>* nb[6];
+        //! The identity map of the last call
+        std::vector<Flt> f_last;
+        std::vector<int> parent;
+        std::vector<char> slot_fresh;
+        std::vector<int> free_slots;
+        std::vector<char> mark;
+
+        void check_size (const std::vector<Flt>& f) const
+        {
+            if (static_cast<int>(f.size()) != this->n) {
+                throw std::runtime_error ("dirichlet_labels: the identity map has the wrong size");
+            }
+        }
+
+        //! Find the root of h, halving the path as we go
+        int find (int h)
+        {
+            while (this->parent[h] != h) {
+                this->parent[h] = this->parent[this->parent[h]];
+                h = this->parent[h];
+            }
+            return h;
+        }
+
+        //! Join the sets of a and b under the lower of their roots
+        void unite (const int a, const int b)
+        {
+            const int ra = this->find (a);
+            const int rb = this->find (b);
+            if (ra < rb) {
+                this->parent[rb] = ra;
+            } else if (rb < ra) {
+                this->parent[ra] = rb;
+            }
+        }
+    };
+
+} // namespace morph
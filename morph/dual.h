@@ -0,0 +1,283 @@
+/*!
+ * \file
+ * \brief Dual numbers, for forward-mode automatic differentiation.
+ *
+ * A morph::dual<T, N> holds a value and N tangents: the partial derivatives of the value with
+ * respect to N independent variables. Arithmetic and the usual maths functions on duals apply
+ * the chain rule to the tangents as they compute the value, so a function written for a
+ * generic number type computes its exact gradient in the same pass as its value:
+ *
+ *\code{.cpp}
+ * auto f = [](const auto& x, const auto& y) { return x * x * morph::math::sin (y); };
+ * morph::dual<double, 2> x = morph::dual<double, 2>::variable (3.0, 0);
+ * morph::dual<double, 2> y = morph::dual<double, 2>::variable (0.5, 1);
+ * morph::dual<double, 2> r = f (x, y); // r.v = f(3, 0.5), r.d = { df/dx, df/dy }
+ *\endcode
+ *
+ * Duals are scalar for morph::vec and morph::vvec (see morph::is_scalar_like), so vec<dual>
+ * and vvec<dual> have the arithmetic, sum(), dot(), length() and elementwise maths functions
+ * of vec<T> and vvec<T>. The maths functions are found both as morph::math::f (as vec calls
+ * them) and, by argument dependent lookup, as unqualified f (so `using std::exp; exp (x);`
+ * works for T and for duals). mathconst<dual<T, N>> gives constants with zero tangents.
+ *
+ * morph::forward_gradient (in morph/lbfgs.h) computes the gradient of a function of a vvec of
+ * any length, N tangents at a time.
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <ostream>
+#include <limits>
+#include <cstddef>
+#include <type_traits>
+#include <morph/trait_tests.h>
+#include <morph/constexpr_math.h>
+
+namespace morph {
+
+    template <typename T, std::size_t N = 1>
+    struct dual
+    {
+        static_assert (std::is_floating_point_v<T>, "morph::dual is for floating point types");
+        using value_type = T;
+
+        //! The value
+        T v = T{0};
+        //! The tangents: the derivatives of v with respect to each of the N variables
+        std::array<T, N> d = {};
+
+        constexpr dual() = default;
+        //! A constant (all tangents zero). Implicit, so that T converts wherever a dual is expected.
+        constexpr dual (const T _v) : v(_v) {}
+        constexpr dual (const T _v, const std::array<T, N>& _d) : v(_v), d(_d) {}
+
+        //! Variable i (of the N), with value _v: its tangent i is 1 and the others 0
+        static constexpr dual variable (const T _v, const std::size_t i = 0)
+        {
+            dual r (_v);
+            r.d[i] = T{1};
+            return r;
+        }
+
+        constexpr dual& operator+= (const dual& b)
+        {
+            this->v += b.v;
+            for (std::size_t i = 0; i < N; ++i) { this->d[i] += b.d[i]; }
+            return *this;
+        }
+        constexpr dual& operator-= (const dual& b)
+        {
+            this->v -= b.v;
+            for (std::size_t i = 0; i < N; ++i) { this->d[i] -= b.d[i]; }
+            return *this;
+        }
+        constexpr dual& operator*= (const dual& b)
+        {
+            for (std::size_t i = 0; i < N; ++i) { this->d[i] = this->d[i] * b.v + this->v * b.d[i]; }
+            this->v *= b.v;
+            return *this;
+        }
+        constexpr dual& operator/= (const dual& b)
+        {
+            const T inv = T{1} / b.v;
+            this->v *= inv;
+            for (std::size_t i = 0; i < N; ++i) { this->d[i] = (this->d[i] - this->v * b.d[i]) * inv; }
+            return *this;
+        }
+        constexpr dual& operator+= (const T b) { this->v += b; return *this; }
+        constexpr dual& operator-= (const T b) { this->v -= b; return *this; }
+        constexpr dual& operator*= (const T b)
+        {
+            this->v *= b;
+            for (auto& di : this->d) { di *= b; }
+            return *this;
+        }
+        constexpr dual& operator/= (const T b) { return (*this) *= (T{1} / b); }
+
+        constexpr dual operator-() const
+        {
+            dual r (-this->v);
+            for (std::size_t i = 0; i < N; ++i) { r.d[i] = -this->d[i]; }
+            return r;
+        }
+        constexpr dual operator+() const { return *this; }
+
+        friend constexpr dual operator+ (dual a, const dual& b) { return a += b; }
+        friend constexpr dual operator- (dual a, const dual& b) { return a -= b; }
+        friend constexpr dual operator* (dual a, const dual& b) { return a *= b; }
+        friend constexpr dual operator/ (dual a, const dual& b) { return a /= b; }
+        friend constexpr dual operator+ (dual a, const T b) { return a += b; }
+        friend constexpr dual operator- (dual a, const T b) { return a -= b; }
+        friend constexpr dual operator* (dual a, const T b) { return a *= b; }
+        friend constexpr dual operator/ (dual a, const T b) { return a /= b; }
+        friend constexpr dual operator+ (const T a, dual b) { return b += a; }
+        friend constexpr dual operator- (const T a, const dual& b) { return (-b) += a; }
+        friend constexpr dual operator* (const T a, dual b) { return b *= a; }
+        friend constexpr dual operator/ (const T a, const dual& b)
+        {
+            // d(a/b) = -a b' / b^2
+            const T inv = T{1} / b.v;
+            dual r (a * inv);
+            for (std::size_t i = 0; i < N; ++i) { r.d[i] = -r.v * b.d[i] * inv; }
+            return r;
+        }
+
+        //! Comparisons are of the values only, so that branches in a function take the same path for a dual as for T
+        friend constexpr bool operator== (const dual& a, const dual& b) { return a.v == b.v; }
+        friend constexpr bool operator== (const dual& a, const T b) { return a.v == b; }
+        friend constexpr auto operator<=> (const dual& a, const dual& b) { return a.v <=> b.v; }
+        friend constexpr auto operator<=> (const dual& a, const T b) { return a.v <=> b; }
+
+        /*
+         * The maths functions. Each applies the derivative of the function of T to the
+         * tangents: f(v + d) = f(v) + f'(v) d.
+         */
+    private:
+        //! The dual of f(x) = fv, where f'(x) = dfdv
+        static dual chain (const dual& x, const T fv, const T dfdv)
+        {
+            dual r (fv);
+            for (std::size_t i = 0; i < N; ++i) { r.d[i] = dfdv * x.d[i]; }
+            return r;
+        }
+
+    public:
+        friend dual sqrt (const dual& x)
+        {
+            const T s = std::sqrt (x.v);
+            return chain (x, s, T{0.5} / s);
+        }
+        friend dual cbrt (const dual& x)
+        {
+            const T c = std::cbrt (x.v);
+            return chain (x, c, T{1} / (T{3} * c * c));
+        }
+        friend dual exp (const dual& x)
+        {
+            const T e = std::exp (x.v);
+            return chain (x, e, e);
+        }
+        friend dual exp2 (const dual& x)
+        {
+            const T e = std::exp2 (x.v);
+            return chain (x, e, e * morph::mathconst<T>::ln_2);
+        }
+        friend dual expm1 (const dual& x) { return chain (x, std::expm1 (x.v), std::exp (x.v)); }
+        friend dual log (const dual& x) { return chain (x, std::log (x.v), T{1} / x.v); }
+        friend dual log2 (const dual& x) { return chain (x, std::log2 (x.v), T{1} / (x.v * morph::mathconst<T>::ln_2)); }
+        friend dual log10 (const dual& x) { return chain (x, std::log10 (x.v), T{1} / (x.v * morph::mathconst<T>::ln_10)); }
+        friend dual log1p (const dual& x) { return chain (x, std::log1p (x.v), T{1} / (T{1} + x.v)); }
+        friend dual pow (const dual& x, const T p)
+        {
+            if (p == T{0}) { return dual (T{1}); }
+            return chain (x, std::pow (x.v, p), p * std::pow (x.v, p - T{1}));
+        }
+        friend dual pow (const T a, const dual& p)
+        {
+            const T r = std::pow (a, p.v);
+            return chain (p, r, r * std::log (a));
+        }
+        friend dual pow (const dual& x, const dual& p)
+        {
+            // d(x^p) = p x^(p-1) x' + x^p ln(x) p'
+            const T r = std::pow (x.v, p.v);
+            dual o (r);
+            const T dx = p.v == T{0} ? T{0} : p.v * std::pow (x.v, p.v - T{1});
+            const T dp = x.v > T{0} ? r * std::log (x.v) : T{0};
+            for (std::size_t i = 0; i < N; ++i) { o.d[i] = dx * x.d[i] + dp * p.d[i]; }
+            return o;
+        }
+        friend dual sin (const dual& x) { return chain (x, std::sin (x.v), std::cos (x.v)); }
+        friend dual cos (const dual& x) { return chain (x, std::cos (x.v), -std::sin (x.v)); }
+        friend dual tan (const dual& x)
+        {
+            const T t = std::tan (x.v);
+            return chain (x, t, T{1} + t * t);
+        }
+        friend dual asin (const dual& x) { return chain (x, std::asin (x.v), T{1} / std::sqrt (T{1} - x.v * x.v)); }
+        friend dual acos (const dual& x) { return chain (x, std::acos (x.v), T{-1} / std::sqrt (T{1} - x.v * x.v)); }
+        friend dual atan (const dual& x) { return chain (x, std::atan (x.v), T{1} / (T{1} + x.v * x.v)); }
+        friend dual atan2 (const dual& y, const dual& x)
+        {
+            // d atan2(y, x) = (x y' - y x') / (x^2 + y^2)
+            const T r2 = x.v * x.v + y.v * y.v;
+            dual o (std::atan2 (y.v, x.v));
+            for (std::size_t i = 0; i < N; ++i) { o.d[i] = (x.v * y.d[i] - y.v * x.d[i]) / r2; }
+            return o;
+        }
+        friend dual sinh (const dual& x) { return chain (x, std::sinh (x.v), std::cosh (x.v)); }
+        friend dual cosh (const dual& x) { return chain (x, std::cosh (x.v), std::sinh (x.v)); }
+        friend dual tanh (const dual& x)
+        {
+            const T t = std::tanh (x.v);
+            return chain (x, t, T{1} - t * t);
+        }
+        friend dual erf (const dual& x)
+        {
+            return chain (x, std::erf (x.v), T{1.1283791670955125738961589031215451716881} * std::exp (-x.v * x.v));
+        }
+        friend dual hypot (const dual& x, const dual& y)
+        {
+            const T h = std::hypot (x.v, y.v);
+            dual o (h);
+            for (std::size_t i = 0; i < N; ++i) { o.d[i] = h == T{0} ? T{0} : (x.v * x.d[i] + y.v * y.d[i]) / h; }
+            return o;
+        }
+        //! The derivative of |x| at 0 is taken as 0
+        friend dual abs (const dual& x) { return x.v < T{0} ? -x : (x.v > T{0} ? x : dual (x.v)); }
+        friend dual fabs (const dual& x) { return abs (x); }
+        friend dual fmax (const dual& a, const dual& b) { return a.v >= b.v ? a : b; }
+        friend dual fmin (const dual& a, const dual& b) { return a.v <= b.v ? a : b; }
+        //! The rounding functions are piecewise constant, so their tangents are zero
+        friend dual floor (const dual& x) { return dual (std::floor (x.v)); }
+        friend dual ceil (const dual& x) { return dual (std::ceil (x.v)); }
+        friend dual round (const dual& x) { return dual (std::round (x.v)); }
+        friend dual trunc (const dual& x) { return dual (std::trunc (x.v)); }
+        friend bool isnan (const dual& x) { return std::isnan (x.v); }
+        friend bool isinf (const dual& x) { return std::isinf (x.v); }
+        friend bool isfinite (const dual& x) { return std::isfinite (x.v); }
+
+        friend std::ostream& operator<< (std::ostream& os, const dual& x)
+        {
+            os << x.v << " [";
+            for (std::size_t i = 0; i < N; ++i) { os << (i ? ", " : "") << x.d[i]; }
+            os << "]";
+            return os;
+        }
+    };
+
+    template <typename T, std::size_t N>
+    struct is_scalar_like<morph::dual<T, N>> : std::true_type {};
+
+    /*
+     * The maths functions in morph::math (see morph/constexpr_math.h), for duals. morph::vec
+     * calls these, so they are declared before it (vec.h includes this file).
+     */
+    namespace math {
+        template <typename T, std::size_t N> dual<T, N> sqrt (const dual<T, N>& x) { return sqrt (x); }
+        template <typename T, std::size_t N> dual<T, N> cbrt (const dual<T, N>& x) { return cbrt (x); }
+        template <typename T, std::size_t N> dual<T, N> exp (const dual<T, N>& x) { return exp (x); }
+        template <typename T, std::size_t N> dual<T, N> log (const dual<T, N>& x) { return log (x); }
+        template <typename T, std::size_t N> dual<T, N> log10 (const dual<T, N>& x) { return log10 (x); }
+        template <typename T, std::size_t N> dual<T, N> pow (const dual<T, N>& x, const T p) { return pow (x, p); }
+        template <typename T, std::size_t N> dual<T, N> pow (const dual<T, N>& x, const dual<T, N>& p) { return pow (x, p); }
+        template <typename T, std::size_t N> dual<T, N> sin (const dual<T, N>& x) { return sin (x); }
+        template <typename T, std::size_t N> dual<T, N> cos (const dual<T, N>& x) { return cos (x); }
+        template <typename T, std::size_t N> dual<T, N> tan (const dual<T, N>& x) { return tan (x); }
+        template <typename T, std::size_t N> dual<T, N> asin (const dual<T, N>& x) { return asin (x); }
+        template <typename T, std::size_t N> dual<T, N> acos (const dual<T, N>& x) { return acos (x); }
+        template <typename T, std::size_t N> dual<T, N> atan (const dual<T, N>& x) { return atan (x); }
+        template <typename T, std::size_t N> dual<T, N> atan2 (const dual<T, N>& y, const dual<T, N>& x) { return atan2 (y, x); }
+        template <typename T, std::size_t N> dual<T, N> tanh (const dual<T, N>& x) { return tanh (x); }
+        template <typename T, std::size_t N> dual<T, N> abs (const dual<T, N>& x) { return abs (x); }
+        template <typename T, std::size_t N> dual<T, N> floor (const dual<T, N>& x) { return floor (x); }
+        template <typename T, std::size_t N> dual<T, N> ceil (const dual<T, N>& x) { return ceil (x); }
+        template <typename T, std::size_t N> dual<T, N> round (const dual<T, N>& x) { return round (x); }
+        template <typename T, std::size_t N> dual<T, N> trunc (const dual<T, N>& x) { return trunc (x); }
+        template <typename T, std::size_t N> bool isnan (const dual<T, N>& x) { return isnan (x); }
+        template <typename T, std::size_t N> bool isinf (const dual<T, N>& x) { return isinf (x); }
+    } // namespace math
+
+} // namespace morph
@@ -0,0 +1,111 @@
+/*!
+ * \file
+ * \brief Choosing the resolution at which morph::Visual renders each frame.
+ *
+ * While the user rotates, translates or zooms the scene, or while a changing scene takes
+ * longer than a time budget to draw, frames can be drawn at a fraction of the window's
+ * resolution and scaled up, which keeps the view responsive. Once the view has been at rest
+ * for settle_ms, frames are drawn at full resolution again. dynamic_resolution makes that
+ * choice; VisualOwnable does the drawing (see VisualOwnable::adaptive_resolution).
+ */
+
+#pragma once
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace morph {
+
+    struct dynamic_resolution
+    {
+        using clock = std::chrono::steady_clock;
+
+        //! If false, every frame is drawn at full resolution
+        bool enabled = false;
+        //! The fraction of the window's width and height at which the first reduced frame is drawn
+        float interaction_scale = 0.5f;
+        //! The fraction below which the resolution is never reduced
+        float min_scale = 0.25f;
+        /*!
+         * If greater than 0, a time in ms for each frame. The resolution of reduced frames is
+         * adjusted, from interaction_scale, so that frames come at about this interval, and a
+         * scene that changes on every frame but comes more slowly than this is drawn reduced
+         * even without user interaction. It should be longer than the display's refresh
+         * interval, as frames never come faster than that.
+         */
+        double frame_budget_ms = 0.0;
+        //! How long after the last interaction (in ms) the view is taken to be at rest
+        double settle_ms = 150.0;
+
+        //! Note that the user has just moved the view
+        void interacted (const clock::time_point t = clock::now()) { this->last_interaction = t; }
+
+        /*!
+         * The fraction of full resolution at which to draw the frame that starts at t. held is
+         * true while a mouse button is down on the scene; revision identifies the contents of
+         * the scene (only compared when frame_budget_ms is set). Returns 1 for a full
+         * resolution frame.
+         */
+        float frame (const bool held, const std::uint64_t revision, const clock::time_point t = clock::now())
+        {
+            const bool first = !this->started;
+            const double since_last = first ? this->settle_ms : ms (t - this->last_frame);
+            const bool changed = !first && revision != this->last_revision;
+            this->started = true;
+            this->last_frame = t;
+            this->last_revision = revision;
+
+            // A scene that changes on every frame, and comes too slowly, is over budget until it stops
+            if (this->frame_budget_ms > 0.0 && changed && since_last < this->settle_ms) {
+                if (since_last > this->frame_budget_ms) { this->over_budget = true; }
+            } else {
+                this->over_budget = false;
+            }
+            const bool moving = held || ms (t - this->last_interaction) < this->settle_ms;
+
+            if (!this->enabled || !(moving || this->over_budget)) { return this->full(); }
+
+            const float lo = std::clamp (this->min_scale, 0.01f, 1.0f);
+            if (!this->reduced_frame || since_last >= this->settle_ms) {
+                this->current = std::clamp (this->interaction_scale, lo, 1.0f);
+            } else if (this->frame_budget_ms > 0.0 && since_last > 0.0) {
+                // The time to draw a frame goes roughly with its area
+                const float f = static_cast<float>(std::sqrt (this->frame_budget_ms / since_last));
+                this->current = std::clamp (this->current * std::clamp (f, 0.8f, 1.25f), lo, 1.0f);
+            }
+            // A scene that is only over budget, and now fits in it at full size, is drawn in full
+            if (!moving && this->current >= 1.0f) {
+                this->over_budget = false;
+                return this->full();
+            }
+            this->reduced_frame = true;
+            return this->current;
+        }
+
+        //! True if the last frame was reduced, so that a full frame should follow once the view is at rest
+        bool reduced() const { return this->reduced_frame; }
+
+        //! The scale of the last frame
+        float scale() const { return this->reduced_frame ? this->current : 1.0f; }
+
+    private:
+        static double ms (const clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+        float full()
+        {
+            this->reduced_frame = false;
+            return 1.0f;
+        }
+
+        bool started = false;
+        bool reduced_frame = false;
+        bool over_budget = false;
+        float current = 1.0f;
+        std::uint64_t last_revision = 0;
+        clock::time_point last_frame = {};
+        clock::time_point last_interaction = {};
+    };
+
+} // namespace morph
@@ -0,0 +1,559 @@
+/*!
+ * \file
+ *
+ * A pseudo-spectral exponential time differencing integrator for reaction-diffusion systems
+ * on periodic grids:
+ *
+ *     du_s/dt = D_s Del^2 u_s + R_s u_s + N_s(t, u)
+ *
+ * On a fully periodic grid the Laplacian is diagonal in Fourier space, so the diffusion (and
+ * the optional linear rate R_s) is advanced exactly, mode by mode, by its exponential, and
+ * only the reaction terms N (the derivative function, evaluated in real space) are
+ * approximated. This is Cox and Matthews'
+ * fourth order ETD Runge-Kutta method (ETDRK4, J. Comp. Phys. 176, 2002) with the phi
+ * function coefficients computed by Kassam and Trefethen's contour integrals (SIAM J. Sci.
+ * Comput. 26, 2005), which avoids their cancellation error for the slow modes. The step size
+ * is limited by the accuracy with which the reactions are followed, not by the diffusive CFL
+ * condition of an explicit step, so a model that spends most of its time approaching a
+ * steady pattern can take steps many times longer than RD_Base's.
+ *
+ * The grid must be periodic in both directions, with its elements on a lattice that repeats:
+ *
+ * - a morph::Grid (or Gridct) with GridDomainWrap::Both;
+ * - a morph::HexGrid with a parallelogram boundary, after setParallelogramWrap (true, true)
+ *   and populate_d_neighbours(). Its elements lie on the skewed (r, g) lattice, which is
+ *   transformed along r and along g.
+ *
+ * The lattice need not have power of 2 dimensions (see morph::fft_plan).
+ *
+ * The derivative function has rk_integrator's signature
+ *
+ * \code
+ * void f (Flt t, const morph::etd_rk4<Flt>::state& y, morph::etd_rk4<Flt>::derivs& dydt);
+ * \endcode
+ *
+ * and must write into dydt[i] only the part of the derivative of field i that is not D_s Del^2
+ * u_s + R_s u_s. A stiff linear decay (such as the -(F + k) v of the Gray-Scott model) is
+ * better passed to add_field as R_s than left in f, where it limits the step size.
+ *
+ * laplacian_symbol::stencil (the default) diagonalises the same finite difference Laplacian
+ * as RD_Base::compute_laplace (the 7 point hexagonal stencil) or morph::stencils::laplace5,
+ * so that the patterns and steady states are those of an explicitly stepped model, only
+ * reached in fewer steps. laplacian_symbol::spectral uses the exact -|k|^2 of each mode.
+ *
+ * \code
+ * morph::etd_rk4<double> etd (grid);
+ * etd.add_field (A, D_A);
+ * etd.add_field (B, D_B);
+ * auto reactions = [&](double, const morph::etd_rk4<double>::state& y, morph::etd_rk4<double>::derivs& dydt) {
+ *     // dydt[0][i] = ...(*y[0])[i], (*y[1])[i]...
+ * };
+ * for (int i = 0; i < 100; ++i) { etd.step (reactions, 1.0); }
+ * \endcode
+ */
+
+#pragma once
+
+#include <morph/fft.h>
+#include <morph/stencil.h>
+#include <morph/GridFeatures.h>
+#include <morph/mathconst.h>
+#include <morph/memory_usage.h>
+#include <vector>
+#include <array>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+
+namespace morph {
+
+    //! The eigenvalues of the Laplacian used by etd_rk4
+    enum class laplacian_symbol {
+        //! The Fourier symbol of the grid's finite difference Laplacian (5 or 7 point)
+        stencil,
+        //! -|k|^2, the symbol of the continuous Laplacian
+        spectral
+    };
+
+    template <typename Flt>
+    class etd_rk4
+    {
+        static_assert (std::is_floating_point_v<Flt>, "etd_rk4: Flt must be a floating point type");
+    public:
+        //! The state passed to a derivative function: one pointer per registered field
+        using state = std::vector<const std::vector<Flt>*>;
+        //! The derivatives of each of the registered fields
+        using derivs = std::vector<std::vector<Flt>>;
+        using cplx = std::complex<Flt>;
+
+        /*!
+         * Set up the transforms for a doubly periodic Grid, Gridct or HexGrid. Throws
+         * if the grid's elements do not make up a periodic lattice.
+         */
+        template <typename G>
+        explicit etd_rk4 (const G& grid, const laplacian_symbol _sym = laplacian_symbol::stencil)
+            : sym(_sym)
+        {
+            if constexpr (stencil_detail::hex_grid<G>) {
+                const double d = static_cast<double>(grid.getd());
+                this->a0 = { d, 0.0 };
+                this->a1 = { d / 2.0, d * std::sqrt (3.0) / 2.0 };
+                this->hex = true;
+                this->find_lattice (grid.d_ne, grid.d_nne);
+                // The other four neighbours must be those of the sheared, wrapped lattice
+                this->check_links (grid.d_nw, -1, 0);
+                this->check_links (grid.d_nsw, 0, -1);
+                this->check_links (grid.d_nnw, -1, 1);
+                this->check_links (grid.d_nse, 1, -1);
+            } else if constexpr (stencil_detail::cart_grid<G>) {
+                static_assert (!stencil_detail::cart_grid<G>,
+                               "etd_rk4: a CartGrid only wraps horizontally; use a Grid with GridDomainWrap::Both");
+            } else if constexpr (stencil_detail::rectangular_grid<G>) {
+                if (grid.get_wrap() != GridDomainWrap::Both) {
+                    throw std::runtime_error ("etd_rk4: the Grid must wrap in both directions");
+                }
+                const auto dx = grid.get_dx();
+                this->a0 = { static_cast<double>(dx[0]), 0.0 };
+                this->a1 = { 0.0, static_cast<double>(dx[1]) };
+                const std::size_t n = static_cast<std::size_t>(grid.get_w()) * static_cast<std::size_t>(grid.get_h());
+                using I = std::remove_cvref_t<decltype(grid.get_w())>;
+                auto idx = [](const I j) { return j == std::numeric_limits<I>::max() ? -1 : static_cast<int>(j); };
+                std::array<std::vector<int>, 4> l;
+                for (auto& li : l) { li.resize (n); }
+                for (std::size_t i = 0; i < n; ++i) {
+                    const I ii = static_cast<I>(i);
+                    l[0][i] = idx (grid.index_ne (ii));
+                    l[1][i] = idx (grid.index_nn (ii));
+                    l[2][i] = idx (grid.index_nw (ii));
+                    l[3][i] = idx (grid.index_ns (ii));
+                }
+                this->find_lattice (l[0], l[1]);
+                this->check_links (l[2], -1, 0);
+                this->check_links (l[3], 0, -1);
+            } else {
+                static_assert (stencil_detail::rectangular_grid<G>, "etd_rk4: unsupported grid type");
+            }
+            this->plan0.init (this->n0);
+            this->plan1.init (this->n1);
+            this->compute_symbol();
+        }
+
+        /*!
+         * Register a field, which diffuses with coefficient _D (0 for a field that does not
+         * diffuse) and grows at the linear rate _R (< 0 for a decay), and return its index in
+         * the state. Only a reference is kept, so v must outlive the integrator (or
+         * clear_fields() must be called). v must have one value per grid element.
+         */
+        std::size_t add_field (std::vector<Flt>& v, const Flt _D, const Flt _R = Flt{0})
+        {
+            if (v.size() != this->size()) { throw std::runtime_error ("etd_rk4::add_field: the field must have one value per grid element"); }
+            this->fields.push_back (&v);
+            this->D.push_back (_D);
+            this->R.push_back (_R);
+            this->coeff_dt = Flt{0};
+            return this->fields.size() - 1;
+        }
+
+        //! Forget the registered fields
+        void clear_fields()
+        {
+            this->fields.clear();
+            this->D.clear();
+            this->R.clear();
+            this->coeff_dt = Flt{0};
+        }
+
+        //! The number of registered fields
+        std::size_t num_fields() const { return this->fields.size(); }
+
+        //! The number of grid elements
+        std::size_t size() const { return this->perm.size(); }
+
+        //! The dimensions of the lattice, along the grid's E and its N (or, on a HexGrid, NNE) direction
+        std::array<std::size_t, 2> dims() const { return { this->n0, this->n1 }; }
+
+        /*!
+         * The eigenvalue of the Laplacian for each Fourier mode (k0, k1), at index k0 + n0 k1
+         * (see dims()). Every one is <= 0 and the (0, 0) mode's is 0.
+         */
+        const std::vector<Flt>& symbol() const { return this->lambda; }
+
+        //! The simulation time, advanced by each step
+        Flt t = Flt{0};
+
+        //! The number of evaluations of the derivative function (four per step)
+        unsigned long long evaluations = 0;
+
+        //! The number of points on the contour integrals for the ETDRK4 coefficients
+        unsigned int contour_points = 32;
+
+        /*!
+         * Take one ETDRK4 step of size dt. The coefficients of the step are computed on the
+         * first step and again whenever dt (or the set of fields) changes, so a fixed dt is
+         * much cheaper than one that varies.
+         */
+        template <typename F>
+        void step (F&& f, const Flt dt)
+        {
+            if (this->fields.empty()) { throw std::runtime_error ("etd_rk4: no fields have been registered"); }
+            if (dt != this->coeff_dt) { this->compute_coefficients (dt); }
+            this->ensure_buffers();
+            const std::size_t nf = this->fields.size();
+            const long long nn = static_cast<long long>(this->size());
+            const Flt h = dt / Flt{2};
+
+            // The transforms of the state and of its reactions
+            for (std::size_t fi = 0; fi < nf; ++fi) { this->forward (*this->fields[fi], this->vhat[fi]); }
+            this->evaluate (f, this->t, this->yf);
+            for (std::size_t fi = 0; fi < nf; ++fi) { this->forward (this->dydt[fi], this->nv[fi]); }
+
+            // a = E2 v + Q Nv
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                const coefficients& c = this->coeffs[fi];
+                cplx* a = this->ahat[fi].data();
+                const cplx* v = this->vhat[fi].data();
+                const cplx* nu = this->nv[fi].data();
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nn; ++i) { a[i] = c.e2[i] * v[i] + c.q[i] * nu[i]; }
+                this->inverse (this->ahat[fi], this->ytmp[fi], this->buf);
+            }
+            this->evaluate (f, this->t + h, this->yt);
+            for (std::size_t fi = 0; fi < nf; ++fi) { this->forward (this->dydt[fi], this->na[fi]); }
+
+            // b = E2 v + Q Na
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                const coefficients& c = this->coeffs[fi];
+                cplx* b = this->buf.data();
+                const cplx* v = this->vhat[fi].data();
+                const cplx* nu = this->na[fi].data();
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nn; ++i) { b[i] = c.e2[i] * v[i] + c.q[i] * nu[i]; }
+                this->inverse (this->buf, this->ytmp[fi], this->buf);
+            }
+            this->evaluate (f, this->t + h, this->yt);
+            for (std::size_t fi = 0; fi < nf; ++fi) { this->forward (this->dydt[fi], this->nb[fi]); }
+
+            // c = E2 a + Q (2 Nb - Nv), written over a
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                const coefficients& c = this->coeffs[fi];
+                cplx* a = this->ahat[fi].data();
+                const cplx* nu = this->nv[fi].data();
+                const cplx* nub = this->nb[fi].data();
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nn; ++i) { a[i] = c.e2[i] * a[i] + c.q[i] * (Flt{2} * nub[i] - nu[i]); }
+                this->inverse (this->ahat[fi], this->ytmp[fi], this->buf);
+            }
+            this->evaluate (f, this->t + dt, this->yt);
+
+            // v = E v + f1 Nv + 2 f2 (Na + Nb) + f3 Nc
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                this->forward (this->dydt[fi], this->buf);
+                const coefficients& c = this->coeffs[fi];
+                cplx* v = this->vhat[fi].data();
+                const cplx* nu = this->nv[fi].data();
+                const cplx* nua = this->na[fi].data();
+                const cplx* nub = this->nb[fi].data();
+                const cplx* nuc = this->buf.data();
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nn; ++i) {
+                    v[i] = c.e[i] * v[i] + c.f1[i] * nu[i] + Flt{2} * c.f2[i] * (nua[i] + nub[i]) + c.f3[i] * nuc[i];
+                }
+                this->inverse (this->vhat[fi], *this->fields[fi], this->buf);
+            }
+            this->t += dt;
+        }
+
+        /*!
+         * The discrete Fourier transform of u (one value per grid element), with mode
+         * (k0, k1) at index k0 + n0 k1
+         */
+        void forward (const std::vector<Flt>& u, std::vector<cplx>& uhat) const
+        {
+            uhat.resize (this->size());
+            const long long nn = static_cast<long long>(this->size());
+#pragma omp parallel for schedule(static)
+            for (long long p = 0; p < nn; ++p) { uhat[p] = cplx (u[this->perm[p]], Flt{0}); }
+            this->transform2 (uhat, false);
+        }
+
+        /*!
+         * The real part of the inverse transform of uhat, into u. uhat is used as workspace
+         * and is overwritten.
+         */
+        void inverse (std::vector<cplx>& uhat, std::vector<Flt>& u) const
+        {
+            this->inverse (uhat, u, uhat);
+        }
+
+        //! The memory held by the transforms, coefficients and stage buffers
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("etd_rk4", sizeof (*this));
+            mu.add ("lattice", this->perm).cpu += morph::heap_bytes (this->pos) + morph::heap_bytes (this->lambda);
+            morph::memory_usage& cm = mu.add ("coefficients", this->coeffs);
+            for (const coefficients& c : this->coeffs) {
+                cm.cpu += morph::heap_bytes (c.e) + morph::heap_bytes (c.e2) + morph::heap_bytes (c.q)
+                + morph::heap_bytes (c.f1) + morph::heap_bytes (c.f2) + morph::heap_bytes (c.f3);
+            }
+            mu.add ("spectra", this->vhat).cpu += morph::heap_bytes (this->ahat) + morph::heap_bytes (this->nv)
+            + morph::heap_bytes (this->na) + morph::heap_bytes (this->nb) + morph::heap_bytes (this->buf);
+            mu.add ("stages", this->ytmp).cpu += morph::heap_bytes (this->dydt);
+            return mu;
+        }
+
+    protected:
+        //! The ETDRK4 coefficients of each mode of one field, for the current dt
+        struct coefficients
+        {
+            std::vector<Flt> e;
+            std::vector<Flt> e2;
+            std::vector<Flt> q;
+            std::vector<Flt> f1;
+            std::vector<Flt> f2;
+            std::vector<Flt> f3;
+        };
+
+        laplacian_symbol sym = laplacian_symbol::stencil;
+        //! True for the 7 point hexagonal lattice
+        bool hex = false;
+        //! The lattice vectors of a step along each axis
+        std::array<double, 2> a0 = { 1.0, 0.0 };
+        std::array<double, 2> a1 = { 0.0, 1.0 };
+        //! The lattice dimensions
+        std::size_t n0 = 0;
+        std::size_t n1 = 0;
+        //! perm[i0 + n0 i1] is the index of the grid element at lattice position (i0, i1)
+        std::vector<std::size_t> perm;
+        //! The lattice position i0 + n0 i1 of each grid element
+        std::vector<std::size_t> pos;
+        //! The eigenvalue of the Laplacian of each mode
+        std::vector<Flt> lambda;
+        fft_plan<Flt> plan0;
+        fft_plan<Flt> plan1;
+
+        //! The registered fields, their diffusion coefficients and their linear rates
+        std::vector<std::vector<Flt>*> fields;
+        std::vector<Flt> D;
+        std::vector<Flt> R;
+        //! The coefficients of each field, and the dt they were computed for
+        std::vector<coefficients> coeffs;
+        Flt coeff_dt = Flt{0};
+
+        //! The transforms of the state, of the first stage and of the reactions at the first three stages
+        std::vector<std::vector<cplx>> vhat;
+        std::vector<std::vector<cplx>> ahat;
+        std::vector<std::vector<cplx>> nv;
+        std::vector<std::vector<cplx>> na;
+        std::vector<std::vector<cplx>> nb;
+        std::vector<cplx> buf;
+        //! The state at a stage, and the reactions
+        derivs ytmp;
+        derivs dydt;
+        state yf;
+        state yt;
+
+        /*!
+         * Number the elements by their lattice positions, walking from element 0 along e0 (the
+         * step along axis 0) and e1 (axis 1), which must both wrap around.
+         */
+        void find_lattice (const std::vector<int>& e0, const std::vector<int>& e1)
+        {
+            const std::size_t n = e0.size();
+            if (n == 0 || e1.size() != n) { throw std::runtime_error ("etd_rk4: the grid is empty"); }
+            auto cycle = [n](const std::vector<int>& e) {
+                std::size_t len = 0;
+                int i = 0;
+                do {
+                    i = e[i];
+                    if (i < 0) { throw std::runtime_error ("etd_rk4: the grid is not periodic (an element is missing a neighbour)"); }
+                    ++len;
+                } while (i != 0 && len <= n);
+                return len;
+            };
+            this->n0 = cycle (e0);
+            this->n1 = cycle (e1);
+            if (this->n0 * this->n1 != n) {
+                throw std::runtime_error ("etd_rk4: the grid's elements do not make up a periodic lattice");
+            }
+            constexpr std::size_t unset = std::numeric_limits<std::size_t>::max();
+            this->perm.assign (n, unset);
+            this->pos.assign (n, unset);
+            int row = 0;
+            for (std::size_t i1 = 0; i1 < this->n1; ++i1) {
+                int el = row;
+                for (std::size_t i0 = 0; i0 < this->n0; ++i0) {
+                    if (el < 0 || this->pos[el] != unset) {
+                        throw std::runtime_error ("etd_rk4: the grid's elements do not make up a periodic lattice");
+                    }
+                    this->perm[i0 + this->n0 * i1] = static_cast<std::size_t>(el);
+                    this->pos[el] = i0 + this->n0 * i1;
+                    el = e0[el];
+                }
+                if (el != row) { throw std::runtime_error ("etd_rk4: the grid's rows are not all the same length"); }
+                row = e1[row];
+            }
+            this->check_links (e1, 0, 1);
+        }
+
+        //! Check that link l of each element goes to the element at lattice offset (d0, d1)
+        void check_links (const std::vector<int>& l, const int d0, const int d1) const
+        {
+            const long long m0 = static_cast<long long>(this->n0);
+            const long long m1 = static_cast<long long>(this->n1);
+            for (std::size_t el = 0; el < l.size(); ++el) {
+                const long long p = static_cast<long long>(this->pos[el]);
+                const long long i0 = ((p % m0) + d0 + m0) % m0;
+                const long long i1 = ((p / m0) + d1 + m1) % m1;
+                if (l[el] < 0 || this->perm[i0 + m0 * i1] != static_cast<std::size_t>(l[el])) {
+                    throw std::runtime_error ("etd_rk4: the grid's neighbour links are not those of a periodic lattice");
+                }
+            }
+        }
+
+        //! The eigenvalue of the Laplacian for each mode
+        void compute_symbol()
+        {
+            const double two_pi = morph::mathconst<double>::two_pi;
+            const double l00 = this->a0[0] * this->a0[0] + this->a0[1] * this->a0[1];
+            const double l01 = this->a0[0] * this->a1[0] + this->a0[1] * this->a1[1];
+            const double l11 = this->a1[0] * this->a1[0] + this->a1[1] * this->a1[1];
+            const double det = l00 * l11 - l01 * l01;
+            this->lambda.resize (this->n0 * this->n1);
+            for (std::size_t k1 = 0; k1 < this->n1; ++k1) {
+                for (std::size_t k0 = 0; k0 < this->n0; ++k0) {
+                    const double th0 = two_pi * double(k0) / double(this->n0);
+                    const double th1 = two_pi * double(k1) / double(this->n1);
+                    double l = 0.0;
+                    if (this->sym == laplacian_symbol::stencil) {
+                        if (this->hex) {
+                            // Neighbours at lattice offsets (+-1, 0), (0, +-1) and +-(-1, 1)
+                            l = 2.0 / (3.0 * l00) * (2.0 * std::cos (th0) + 2.0 * std::cos (th1) + 2.0 * std::cos (th1 - th0) - 6.0);
+                        } else {
+                            l = (2.0 * std::cos (th0) - 2.0) / l00 + (2.0 * std::cos (th1) - 2.0) / l11;
+                        }
+                    } else {
+                        // k.a0 = th0 and k.a1 = th1 make |k|^2 = th^T L^-1 th, where L is the
+                        // Gram matrix of the lattice vectors. Choose the alias of the mode with
+                        // the smallest |k|.
+                        double k2 = std::numeric_limits<double>::max();
+                        for (int s0 = -1; s0 <= 1; ++s0) {
+                            for (int s1 = -1; s1 <= 1; ++s1) {
+                                const double t0 = th0 + two_pi * s0;
+                                const double t1 = th1 + two_pi * s1;
+                                k2 = std::min (k2, (l11 * t0 * t0 - 2.0 * l01 * t0 * t1 + l00 * t1 * t1) / det);
+                            }
+                        }
+                        l = -k2;
+                    }
+                    this->lambda[k0 + this->n0 * k1] = static_cast<Flt>(l);
+                }
+            }
+        }
+
+        /*!
+         * The coefficients of each field's modes for a step of dt, by the mean of the phi
+         * functions over a circle of radius 1 about z = dt (D lambda + R) in the complex plane
+         */
+        void compute_coefficients (const Flt dt)
+        {
+            const std::size_t nf = this->fields.size();
+            const std::size_t nn = this->size();
+            const unsigned int M = std::max (this->contour_points, 4u);
+            std::vector<std::complex<double>> r (M);
+            for (unsigned int j = 0; j < M; ++j) {
+                const double a = morph::mathconst<double>::pi * (double(j) + 0.5) / double(M);
+                r[j] = std::exp (std::complex<double>(0.0, 2.0 * a));
+            }
+            const double h = static_cast<double>(dt);
+            this->coeffs.resize (nf);
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                coefficients& c = this->coeffs[fi];
+                for (std::vector<Flt>* v : { &c.e, &c.e2, &c.q, &c.f1, &c.f2, &c.f3 }) { v->resize (nn); }
+                const double Dh = static_cast<double>(this->D[fi]) * h;
+                const double Rh = static_cast<double>(this->R[fi]) * h;
+                const long long nnl = static_cast<long long>(nn);
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nnl; ++i) {
+                    const double z = Dh * static_cast<double>(this->lambda[i]) + Rh;
+                    std::complex<double> q = 0.0, f1 = 0.0, f2 = 0.0, f3 = 0.0;
+                    for (unsigned int j = 0; j < M; ++j) {
+                        const std::complex<double> lr = z + r[j];
+                        const std::complex<double> el = std::exp (lr);
+                        const std::complex<double> lr3 = lr * lr * lr;
+                        q += (std::exp (lr / 2.0) - 1.0) / lr;
+                        f1 += (-4.0 - lr + el * (4.0 - 3.0 * lr + lr * lr)) / lr3;
+                        f2 += (2.0 + lr + el * (lr - 2.0)) / lr3;
+                        f3 += (-4.0 - 3.0 * lr - lr * lr + el * (4.0 - lr)) / lr3;
+                    }
+                    c.e[i] = static_cast<Flt>(std::exp (z));
+                    c.e2[i] = static_cast<Flt>(std::exp (z / 2.0));
+                    c.q[i] = static_cast<Flt>(h * q.real() / M);
+                    c.f1[i] = static_cast<Flt>(h * f1.real() / M);
+                    c.f2[i] = static_cast<Flt>(h * f2.real() / M);
+                    c.f3[i] = static_cast<Flt>(h * f3.real() / M);
+                }
+            }
+            this->coeff_dt = dt;
+        }
+
+        //! Size the stage buffers to match the fields, allocating only on a change
+        void ensure_buffers()
+        {
+            const std::size_t nf = this->fields.size();
+            const std::size_t nn = this->size();
+            for (auto* s : { &this->vhat, &this->ahat, &this->nv, &this->na, &this->nb }) {
+                s->resize (nf);
+                for (auto& v : *s) { v.resize (nn); }
+            }
+            this->buf.resize (nn);
+            this->ytmp.resize (nf);
+            this->dydt.resize (nf);
+            this->yf.resize (nf);
+            this->yt.resize (nf);
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                this->ytmp[fi].resize (nn);
+                this->dydt[fi].resize (nn);
+                this->yf[fi] = this->fields[fi];
+                this->yt[fi] = &this->ytmp[fi];
+            }
+        }
+
+        template <typename F>
+        void evaluate (F& f, const Flt ts, const state& y)
+        {
+            f (ts, y, this->dydt);
+            ++this->evaluations;
+        }
+
+        //! The real part of the inverse transform of uhat, into u, using work (which may be uhat) as workspace
+        void inverse (const std::vector<cplx>& uhat, std::vector<Flt>& u, std::vector<cplx>& work) const
+        {
+            if (&work != &uhat) { std::copy (uhat.begin(), uhat.end(), work.begin()); }
+            this->transform2 (work, true);
+            u.resize (this->size());
+            const long long nn = static_cast<long long>(this->size());
+#pragma omp parallel for schedule(static)
+            for (long long p = 0; p < nn; ++p) { u[this->perm[p]] = work[p].real(); }
+        }
+
+        //! The 2D transform of the lattice ordered a: the n1 rows along axis 0, then the n0 columns
+        void transform2 (std::vector<cplx>& a, const bool inv) const
+        {
+            const long long m0 = static_cast<long long>(this->n0);
+            const long long m1 = static_cast<long long>(this->n1);
+#pragma omp parallel
+            {
+                std::vector<cplx> work;
+#pragma omp for schedule(static)
+                for (long long i1 = 0; i1 < m1; ++i1) { this->plan0.transform (a.data() + i1 * m0, inv, work, 1); }
+#pragma omp for schedule(static)
+                for (long long i0 = 0; i0 < m0; ++i0) { this->plan1.transform (a.data() + i0, inv, work, this->n0); }
+            }
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,136 @@
+/*
+ * Frame sinks that pipe raw frames into another program, with morph::Process.
+ */
+#pragma once
+
+#include <morph/frame_sink.h>
+#include <morph/Process.h>
+
+#include <list>
+#include <string>
+#include <iostream>
+extern "C" {
+#include <signal.h>
+}
+
+namespace morph {
+
+    /*!
+     * A frame_sink that writes each frame, as raw RGBA bytes, top row first, to the stdin of a
+     * program. The program is started on the first frame, when the frame size is known.
+     *
+     * Derived classes implement args() to choose the arguments given to the program.
+     *
+     * SIGPIPE is ignored once the program has been started, so that if it exits early the
+     * writes fail (and write_frame() returns false) rather than the signal ending this process.
+     */
+    struct process_sink : public frame_sink
+    {
+        //! program is the full path to the executable
+        process_sink (const std::string& _program) : program(_program) {}
+
+        ~process_sink() { this->finish(); }
+
+        bool write_frame (const unsigned char* rgba, const int width, const int height) override
+        {
+            if (this->failed) { return false; }
+            if (!this->started) {
+                this->width = width;
+                this->height = height;
+                signal (SIGPIPE, SIG_IGN);
+                if (this->proc.start (this->program, this->args (width, height)) == PROCESS_FAILURE
+                    || !this->proc.waitForStarted()) {
+                    std::cerr << "process_sink: Failed to start " << this->program << std::endl;
+                    this->failed = true;
+                    return false;
+                }
+                this->started = true;
+            }
+            if (width != this->width || height != this->height) {
+                std::cerr << "process_sink: Frame size changed from " << this->width << "x" << this->height
+                          << " to " << width << "x" << height << std::endl;
+                this->failed = true;
+                return false;
+            }
+            if (!this->proc.writeIn (rgba, static_cast<std::size_t>(width) * height * 4)) {
+                std::cerr << "process_sink: Failed to write a frame to " << this->program << std::endl;
+                this->failed = true;
+                return false;
+            }
+            ++this->frames;
+            return true;
+        }
+
+        //! Close the program's stdin and wait for it to exit
+        void finish() override
+        {
+            if (!this->started) { return; }
+            this->proc.closeIn();
+            this->exit_status = this->proc.waitForFinished();
+            this->started = false;
+        }
+
+        //! The arguments (args[0] being the program name) to start the program with, for frames of width by height
+        virtual std::list<std::string> args (const int width, const int height) = 0;
+
+        //! The number of frames written so far
+        unsigned int frames = 0;
+        //! The exit status of the program, set by finish()
+        int exit_status = -1;
+
+    protected:
+        std::string program;
+        morph::Process proc;
+        bool started = false;
+        bool failed = false;
+        int width = 0;
+        int height = 0;
+    };
+
+    /*!
+     * A frame_sink that encodes the frames into a video file with ffmpeg. This avoids writing a
+     * PNG file for each frame and encoding them afterwards.
+     *
+     * \code
+     * v.framesink = std::make_unique<morph::ffmpeg_sink> ("./movie.mp4", 30);
+     * while (...) {
+     *     // ...update models...
+     *     v.render();
+     *     v.recordFrame();
+     * }
+     * v.finishRecording();
+     * \endcode
+     */
+    struct ffmpeg_sink : public process_sink
+    {
+        ffmpeg_sink (const std::string& _filename, const int _fps = 30,
+                     const std::string& ffmpeg_path = "/usr/bin/ffmpeg")
+            : process_sink(ffmpeg_path)
+            , filename(_filename)
+            , fps(_fps) {}
+
+        std::list<std::string> args (const int width, const int height) override
+        {
+            std::list<std::string> a = {
+                "ffmpeg", "-y", "-loglevel", "error", "-nostats",
+                "-f", "rawvideo", "-pix_fmt", "rgba",
+                "-s", std::to_string (width) + "x" + std::to_string (height),
+                "-r", std::to_string (this->fps),
+                "-i", "-",
+                // yuv420p needs even dimensions
+                "-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2"
+            };
+            for (const auto& o : this->output_options) { a.push_back (o); }
+            a.push_back (this->filename);
+            return a;
+        }
+
+        //! The video file to write
+        std::string filename;
+        //! Frames per second of the video
+        int fps = 30;
+        //! Encoder options, placed before the output filename
+        std::list<std::string> output_options = { "-c:v", "libx264", "-pix_fmt", "yuv420p", "-crf", "18" };
+    };
+
+} // namespace morph
@@ -0,0 +1,258 @@
+/*!
+ * \file
+ * \brief A small radix-2 fast Fourier transform and an FFT (overlap-add) convolution.
+ *
+ * This is used by morph::vvec::convolve for wide kernels, where the direct O(N K) sum is slow.
+ * It has no dependencies beyond the standard library. morph::fft_plan transforms lengths that
+ * are not powers of 2 (as for the periodic grids of morph::etd_rk4).
+ *
+ *\code{.cpp}
+ * std::vector<std::complex<double>> a (1024); // size must be a power of 2
+ * morph::fft<double>::transform (a.data(), a.size(), false); // forward
+ * morph::fft<double>::transform (a.data(), a.size(), true);  // inverse (scaled by 1/n)
+ *\endcode
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <morph/mathconst.h>
+
+namespace morph {
+
+    //! Fast Fourier transforms and FFT convolution for floating point type F
+    template <typename F>
+    struct fft
+    {
+        static_assert (std::is_floating_point<F>::value, "morph::fft requires a floating point type");
+
+        //! The smallest power of 2 that is >= n
+        static std::size_t next_pow2 (const std::size_t n)
+        {
+            std::size_t p = 1;
+            while (p < n) { p <<= 1; }
+            return p;
+        }
+
+        //! The twiddle factors exp(-2 pi i k / n) for k in [0, n/2). Computed in double precision.
+        static std::vector<std::complex<F>> twiddles (const std::size_t n)
+        {
+            std::vector<std::complex<F>> w (n / 2);
+            for (std::size_t k = 0; k < n / 2; ++k) {
+                const double a = -morph::mathconst<double>::two_pi * double(k) / double(n);
+                w[k] = std::complex<F>(F(std::cos (a)), F(std::sin (a)));
+            }
+            return w;
+        }
+
+        //! In-place FFT of the n elements at a, using the twiddle factors w from twiddles(n). If
+        //! inverse is true, compute the inverse transform, including the 1/n scaling.
+        static void transform (std::complex<F>* a, const std::size_t n,
+                               const std::vector<std::complex<F>>& w, const bool inverse)
+        {
+            if (n < 2) { return; }
+            if ((n & (n - 1)) != 0) { throw std::runtime_error ("morph::fft: n must be a power of 2"); }
+            if (w.size() != n / 2) { throw std::runtime_error ("morph::fft: wrong number of twiddle factors"); }
+
+            // Bit reversal permutation
+            for (std::size_t i = 1, j = 0; i < n; ++i) {
+                std::size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1) { j ^= bit; }
+                j ^= bit;
+                if (i < j) { std::swap (a[i], a[j]); }
+            }
+
+            // Butterflies. The complex products are written out, as std::complex's operator* has
+            // to handle inf and NaN specially, which makes it slow.
+            const F wsign = inverse ? F{-1} : F{1};
+            for (std::size_t len = 2; len <= n; len <<= 1) {
+                const std::size_t half = len >> 1;
+                const std::size_t wstep = n / len;
+                for (std::size_t i = 0; i < n; i += len) {
+                    for (std::size_t k = 0; k < half; ++k) {
+                        const F wr = w[k * wstep].real();
+                        const F wi = wsign * w[k * wstep].imag();
+                        const F ar = a[i + k + half].real();
+                        const F ai = a[i + k + half].imag();
+                        const std::complex<F> v (ar * wr - ai * wi, ar * wi + ai * wr);
+                        const std::complex<F> u = a[i + k];
+                        a[i + k] = u + v;
+                        a[i + k + half] = u - v;
+                    }
+                }
+            }
+
+            if (inverse) {
+                const F oon = F{1} / F(n);
+                for (std::size_t i = 0; i < n; ++i) { a[i] *= oon; }
+            }
+        }
+
+        //! In-place FFT of the n elements at a (n a power of 2)
+        static void transform (std::complex<F>* a, const std::size_t n, const bool inverse)
+        {
+            morph::fft<F>::transform (a, n, morph::fft<F>::twiddles (n), inverse);
+        }
+
+        /*!
+         * Compute the 'valid' correlation of e (ne elements) with kernel k (nk elements):
+         *
+         *   out[i] = sum_j k[j] * e[i + j]   for i in [0, ne - nk]
+         *
+         * out must have room for ne - nk + 1 elements. This is computed as the convolution of e
+         * with the reversed kernel by the overlap-add method: e is cut into blocks which are
+         * transformed with an FFT of a few times the kernel length. As the kernel is real, two
+         * blocks are transformed at once, one in the real part and one in the imaginary part.
+         */
+        static void correlate (const F* e, const std::size_t ne, const F* k, const std::size_t nk, F* out)
+        {
+            if (nk == 0 || ne < nk) { throw std::runtime_error ("morph::fft::correlate: need 0 < nk <= ne"); }
+
+            // The full convolution has nc elements, of which we need [nk-1, ne)
+            const std::size_t nc = ne + nk - 1;
+            // FFT length: 4 kernel lengths (rounded up to a power of 2) but no longer than needed
+            // to do the whole convolution in one block.
+            const std::size_t L = std::min (morph::fft<F>::next_pow2 (4 * nk), morph::fft<F>::next_pow2 (nc));
+            const std::size_t B = L - nk + 1; // input block length
+            const std::vector<std::complex<F>> w = morph::fft<F>::twiddles (L);
+
+            // The transform of the reversed, zero-padded kernel
+            std::vector<std::complex<F>> K (L, std::complex<F>{});
+            for (std::size_t j = 0; j < nk; ++j) { K[j] = k[nk - 1 - j]; }
+            morph::fft<F>::transform (K.data(), L, w, false);
+
+            std::vector<F> c (nc, F{0});
+            std::vector<std::complex<F>> buf (L);
+            for (std::size_t s0 = 0; s0 < ne; s0 += 2 * B) {
+                const std::size_t s1 = s0 + B;
+                const std::size_t n0 = std::min (B, ne - s0);
+                const std::size_t n1 = s1 < ne ? std::min (B, ne - s1) : 0;
+                std::fill (buf.begin(), buf.end(), std::complex<F>{});
+                for (std::size_t i = 0; i < n0; ++i) { buf[i].real (e[s0 + i]); }
+                for (std::size_t i = 0; i < n1; ++i) { buf[i].imag (e[s1 + i]); }
+                morph::fft<F>::transform (buf.data(), L, w, false);
+                for (std::size_t i = 0; i < L; ++i) {
+                    const F br = buf[i].real();
+                    const F bi = buf[i].imag();
+                    buf[i] = std::complex<F>(br * K[i].real() - bi * K[i].imag(), br * K[i].imag() + bi * K[i].real());
+                }
+                morph::fft<F>::transform (buf.data(), L, w, true);
+                // Overlap-add the results of the two blocks (each n + nk - 1 long) into c
+                const std::size_t m0 = std::min (n0 + nk - 1, nc - s0);
+                for (std::size_t i = 0; i < m0; ++i) { c[s0 + i] += buf[i].real(); }
+                if (n1 > 0) {
+                    const std::size_t m1 = std::min (n1 + nk - 1, nc - s1);
+                    for (std::size_t i = 0; i < m1; ++i) { c[s1 + i] += buf[i].imag(); }
+                }
+            }
+
+            std::copy (c.begin() + (nk - 1), c.begin() + ne, out);
+        }
+    };
+
+    /*!
+     * The FFT of a fixed length n, which need not be a power of 2. A power of 2 length uses
+     * fft::transform directly; any other length is done by Bluestein's algorithm, which writes
+     * the transform as a convolution with the 'chirp' exp(-i pi j^2 / n) and computes that
+     * with power of 2 FFTs of length m >= 2n - 1. That is still O(n log n), though a few times
+     * slower than a power of 2 transform of about the same length.
+     *
+     * The plan holds only constant tables, so one plan may be used by several threads at once,
+     * each passing its own work buffer.
+     */
+    template <typename F>
+    struct fft_plan
+    {
+        static_assert (std::is_floating_point<F>::value, "morph::fft_plan requires a floating point type");
+
+        fft_plan() = default;
+        explicit fft_plan (const std::size_t _n) { this->init (_n); }
+
+        void init (const std::size_t _n)
+        {
+            this->n = _n;
+            this->m = (_n & (_n - 1)) == 0 ? _n : morph::fft<F>::next_pow2 (2 * _n - 1);
+            this->w = morph::fft<F>::twiddles (this->m);
+            this->chirp.clear();
+            this->bchirp.clear();
+            if (this->bluestein()) {
+                // exp(-i pi j^2 / n), with j^2 taken mod 2n so that the angle stays accurate
+                this->chirp.resize (_n);
+                for (std::size_t j = 0; j < _n; ++j) {
+                    const std::size_t j2 = (j * j) % (2 * _n);
+                    const double a = -morph::mathconst<double>::pi * double(j2) / double(_n);
+                    this->chirp[j] = std::complex<F>(F(std::cos (a)), F(std::sin (a)));
+                }
+                // The transform of the conjugate chirp, wrapped so that it holds lags -(n-1) to n-1
+                this->bchirp.assign (this->m, std::complex<F>{});
+                for (std::size_t j = 0; j < _n; ++j) {
+                    this->bchirp[j] = std::conj (this->chirp[j]);
+                    if (j > 0) { this->bchirp[this->m - j] = std::conj (this->chirp[j]); }
+                }
+                morph::fft<F>::transform (this->bchirp.data(), this->m, this->w, false);
+            }
+        }
+
+        //! The transform length
+        std::size_t size() const { return this->n; }
+
+        //! True if this length is transformed by Bluestein's algorithm
+        bool bluestein() const { return this->m != this->n; }
+
+        /*!
+         * Transform the n elements a[0], a[stride], a[2 stride]... in place. If inverse is
+         * true, compute the inverse transform, including the 1/n scaling. work is resized as
+         * required.
+         */
+        void transform (std::complex<F>* a, const bool inverse, std::vector<std::complex<F>>& work,
+                        const std::size_t stride = 1) const
+        {
+            if (this->n < 2) { return; }
+            if (!this->bluestein()) {
+                if (stride == 1) {
+                    morph::fft<F>::transform (a, this->n, this->w, inverse);
+                } else {
+                    work.resize (this->n);
+                    for (std::size_t j = 0; j < this->n; ++j) { work[j] = a[j * stride]; }
+                    morph::fft<F>::transform (work.data(), this->n, this->w, inverse);
+                    for (std::size_t j = 0; j < this->n; ++j) { a[j * stride] = work[j]; }
+                }
+                return;
+            }
+
+            // The inverse transform is the conjugate of the forward transform of the conjugate
+            work.assign (this->m, std::complex<F>{});
+            for (std::size_t j = 0; j < this->n; ++j) {
+                const std::complex<F> x = inverse ? std::conj (a[j * stride]) : a[j * stride];
+                work[j] = x * this->chirp[j];
+            }
+            morph::fft<F>::transform (work.data(), this->m, this->w, false);
+            for (std::size_t j = 0; j < this->m; ++j) { work[j] *= this->bchirp[j]; }
+            morph::fft<F>::transform (work.data(), this->m, this->w, true);
+            const F scale = inverse ? F{1} / F(this->n) : F{1};
+            for (std::size_t k = 0; k < this->n; ++k) {
+                const std::complex<F> y = work[k] * this->chirp[k];
+                a[k * stride] = inverse ? std::conj (y) * scale : y;
+            }
+        }
+
+    private:
+        //! The transform length and the (power of 2) length of the FFTs that compute it
+        std::size_t n = 0;
+        std::size_t m = 0;
+        //! The twiddle factors for length m
+        std::vector<std::complex<F>> w;
+        //! The chirp exp(-i pi j^2 / n) and the transform of its (wrapped) conjugate
+        std::vector<std::complex<F>> chirp;
+        std::vector<std::complex<F>> bchirp;
+    };
+
+} // namespace morph
@@ -0,0 +1,28 @@
+/*!
+ * \file
+ * \brief The 64 bit FNV-1a hash.
+ *
+ * Used for the keys of the HexGrid, GridMap, mesh and shader program caches and for the
+ * revision hashes that decide whether a Visual needs redrawing. A hash of several pieces of
+ * data is made by passing each call's result as the seed of the next.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace morph {
+
+    //! The FNV-1a offset basis, with which a new hash starts
+    constexpr std::uint64_t fnv1a_basis = 14695981039346656037ull;
+
+    //! A 64 bit FNV-1a hash of the n bytes at data, continuing from seed
+    inline std::uint64_t fnv1a (const void* data, const std::size_t n, std::uint64_t seed = fnv1a_basis)
+    {
+        const unsigned char* c = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < n; ++i) { seed = (seed ^ c[i]) * 1099511628211ull; }
+        return seed;
+    }
+
+} // namespace morph
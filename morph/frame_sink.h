@@ -0,0 +1,28 @@
+/*
+ * An interface for code that consumes a stream of rendered frames, such as a video encoder.
+ */
+#pragma once
+
+namespace morph {
+
+    /*!
+     * A destination for frames from VisualOwnable::recordFrame(). Derive from this and implement
+     * write_frame(). See morph::ffmpeg_sink in morph/ffmpeg_sink.h for a sink that encodes a
+     * video file.
+     */
+    struct frame_sink
+    {
+        virtual ~frame_sink() {}
+
+        /*!
+         * Consume one frame of width * height RGBA pixels, 4 bytes each, top row first. rgba is
+         * only valid during the call. Return false on failure; no more frames are sent to a sink
+         * after it has failed.
+         */
+        virtual bool write_frame (const unsigned char* rgba, const int width, const int height) = 0;
+
+        //! Called after the last frame. Complete the output (e.g. wait for the encoder to finish).
+        virtual void finish() {}
+    };
+
+} // namespace morph
@@ -0,0 +1,179 @@
+/*!
+ * \file
+ * \brief General matrix multiplication, C = alpha op(A) op(B) + beta C, on row-major arrays.
+ *
+ * By default this is a built-in, cache-blocked and OpenMP-parallel implementation. Define
+ * USE_CBLAS when compiling (and link a CBLAS such as OpenBLAS) to have float and double
+ * multiplications passed to cblas_sgemm/cblas_dgemm instead.
+ *
+ *\code{.cpp}
+ * // C (M x N) = A (M x K) * B (K x N), all row-major and contiguous
+ * morph::gemm<float>::compute (false, false, M, N, K, 1.0f, A, K, B, N, 0.0f, C, N);
+ *\endcode
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#ifdef USE_CBLAS
+# include <cblas.h>
+#endif
+
+namespace morph {
+
+    //! Matrix multiplication for element type T
+    template <typename T>
+    struct gemm
+    {
+        //! Tile sizes of the built-in implementation
+        static constexpr std::size_t mc = 64;
+        static constexpr std::size_t kc = 256;
+        static constexpr std::size_t nc = 512;
+        //! Below this many multiply-adds, the built-in implementation runs on one thread
+        static constexpr std::size_t parallel_threshold = 1u << 18;
+
+        /*!
+         * C = alpha op(A) op(B) + beta C, where op(X) is X or its transpose. op(A) is M x K, op(B)
+         * is K x N and C is M x N. All are row-major; lda, ldb and ldc are the row strides of A,
+         * B and C as stored (so lda >= K if A is not transposed, lda >= M if it is). If beta is
+         * 0, C need not be initialised.
+         */
+        static void compute (const bool transA, const bool transB,
+                             const std::size_t M, const std::size_t N, const std::size_t K,
+                             const T alpha, const T* A, const std::size_t lda,
+                             const T* B, const std::size_t ldb,
+                             const T beta, T* C, const std::size_t ldc)
+        {
+            if (M == 0 || N == 0) { return; }
+#ifdef USE_CBLAS
+            if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+                const CBLAS_TRANSPOSE ta = transA ? CblasTrans : CblasNoTrans;
+                const CBLAS_TRANSPOSE tb = transB ? CblasTrans : CblasNoTrans;
+                if constexpr (std::is_same<T, float>::value) {
+                    cblas_sgemm (CblasRowMajor, ta, tb, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+                } else {
+                    cblas_dgemm (CblasRowMajor, ta, tb, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+                }
+                return;
+            }
+#endif
+            // C = beta C. With beta 0, C is overwritten so that any NaNs in it don't propagate.
+            for (std::size_t i = 0; i < M; ++i) {
+                T* Ci = C + i * ldc;
+                if (beta == T{0}) {
+                    std::fill (Ci, Ci + N, T{0});
+                } else if (beta != T{1}) {
+                    for (std::size_t j = 0; j < N; ++j) { Ci[j] *= beta; }
+                }
+            }
+            if (K == 0 || alpha == T{0}) { return; }
+
+            if (transA && transB) {
+                // Rare; make A^T and use the transposed-B kernel
+                std::vector<T> At (M * K);
+                for (std::size_t k = 0; k < K; ++k) {
+                    for (std::size_t i = 0; i < M; ++i) { At[i * K + k] = A[k * lda + i]; }
+                }
+                morph::gemm<T>::kernel_nt (M, N, K, alpha, At.data(), K, B, ldb, C, ldc);
+            } else if (transB) {
+                morph::gemm<T>::kernel_nt (M, N, K, alpha, A, lda, B, ldb, C, ldc);
+            } else {
+                morph::gemm<T>::kernel_nn (transA, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+            }
+        }
+
+    private:
+        /*!
+         * C += alpha op(A) B. Tiles of C are shared out over threads. Within a tile, elements of
+         * op(A) multiply contiguous runs of rows of B into a row of C, which vectorises.
+         * op(A)(i,k) is A[i*lda+k], or A[k*lda+i] if transA.
+         */
+        static void kernel_nn (const bool transA, const std::size_t M, const std::size_t N, const std::size_t K,
+                               const T alpha, const T* A, const std::size_t lda,
+                               const T* B, const std::size_t ldb, T* C, const std::size_t ldc)
+        {
+            const long long nib = static_cast<long long>((M + mc - 1) / mc);
+            const long long njb = static_cast<long long>((N + nc - 1) / nc);
+            const bool par = M * N * K >= parallel_threshold && nib * njb > 1;
+#pragma omp parallel for collapse(2) schedule(static) if(par)
+            for (long long ib = 0; ib < nib; ++ib) {
+                for (long long jb = 0; jb < njb; ++jb) {
+                    const std::size_t i0 = ib * mc;
+                    const std::size_t i1 = std::min (M, i0 + mc);
+                    const std::size_t j0 = jb * nc;
+                    const std::size_t j1 = std::min (N, j0 + nc);
+                    for (std::size_t k0 = 0; k0 < K; k0 += kc) {
+                        const std::size_t k1 = std::min (K, k0 + kc);
+                        for (std::size_t i = i0; i < i1; ++i) {
+                            T* Ci = C + i * ldc;
+                            std::size_t k = k0;
+                            // Four rows of B at a time, to load and store each run of Ci less often
+                            for (; k + 4 <= k1; k += 4) {
+                                const T a0 = alpha * (transA ? A[k * lda + i] : A[i * lda + k]);
+                                const T a1 = alpha * (transA ? A[(k + 1) * lda + i] : A[i * lda + k + 1]);
+                                const T a2 = alpha * (transA ? A[(k + 2) * lda + i] : A[i * lda + k + 2]);
+                                const T a3 = alpha * (transA ? A[(k + 3) * lda + i] : A[i * lda + k + 3]);
+                                const T* B0 = B + k * ldb;
+                                const T* B1 = B0 + ldb;
+                                const T* B2 = B1 + ldb;
+                                const T* B3 = B2 + ldb;
+#pragma omp simd
+                                for (std::size_t j = j0; j < j1; ++j) {
+                                    Ci[j] += a0 * B0[j] + a1 * B1[j] + a2 * B2[j] + a3 * B3[j];
+                                }
+                            }
+                            for (; k < k1; ++k) {
+                                const T a = alpha * (transA ? A[k * lda + i] : A[i * lda + k]);
+                                const T* Bk = B + k * ldb;
+#pragma omp simd
+                                for (std::size_t j = j0; j < j1; ++j) { Ci[j] += a * Bk[j]; }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /*!
+         * C += alpha A B^T, with A M x K and B N x K. Each element of C is the dot product of a
+         * row of A with a row of B, both contiguous.
+         */
+        static void kernel_nt (const std::size_t M, const std::size_t N, const std::size_t K,
+                               const T alpha, const T* A, const std::size_t lda,
+                               const T* B, const std::size_t ldb, T* C, const std::size_t ldc)
+        {
+            const long long nib = static_cast<long long>((M + mc - 1) / mc);
+            const long long njb = static_cast<long long>((N + mc - 1) / mc);
+            const bool par = M * N * K >= parallel_threshold && nib * njb > 1;
+#pragma omp parallel for collapse(2) schedule(static) if(par)
+            for (long long ib = 0; ib < nib; ++ib) {
+                for (long long jb = 0; jb < njb; ++jb) {
+                    const std::size_t i0 = ib * mc;
+                    const std::size_t i1 = std::min (M, i0 + mc);
+                    const std::size_t j0 = jb * mc;
+                    const std::size_t j1 = std::min (N, j0 + mc);
+                    for (std::size_t k0 = 0; k0 < K; k0 += kc) {
+                        const std::size_t k1 = std::min (K, k0 + kc);
+                        for (std::size_t i = i0; i < i1; ++i) {
+                            const T* Ai = A + i * lda;
+                            T* Ci = C + i * ldc;
+                            for (std::size_t j = j0; j < j1; ++j) {
+                                const T* Bj = B + j * ldb;
+                                T s = T{0};
+#pragma omp simd reduction(+:s)
+                                for (std::size_t k = k0; k < k1; ++k) { s += Ai[k] * Bj[k]; }
+                                Ci[j] += alpha * s;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+} // namespace morph
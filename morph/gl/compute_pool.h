@@ -0,0 +1,299 @@
+/*
+ * A pool of headless GL compute contexts, one (or more) per GPU, with a job queue. Each context
+ * is owned by a worker thread that keeps it current, so a job runs GL compute code directly:
+ *
+ *   morph::gl::compute_pool<morph::gl::version_3_1_es> pool;
+ *   for (auto p : params) {
+ *       pool.push ([p](morph::gl::compute_context<morph::gl::version_3_1_es>& ctx) {
+ *           run_model_on_gpu (p); // GL calls go to ctx
+ *       });
+ *   }
+ *   pool.wait();
+ *
+ * The GPUs are found with EGL_EXT_device_enumeration. Jobs are taken from the queue by whichever
+ * context is free, so a sweep of many runs keeps every GPU busy from one process.
+ *
+ * As for compute_manager_cli, you have to include the GL headers for your target version
+ * BEFORE including this file. Linux (EGL) only.
+ */
+#pragma once
+
+#include <morph/gl/version.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdexcept>
+#include <iostream>
+#include <exception>
+#include <cstring>
+
+namespace morph {
+    namespace gl {
+
+        //! A GPU that EGL can make headless contexts on
+        struct egl_device
+        {
+            //! The EGL device, or nullptr for the default display
+            EGLDeviceEXT device = nullptr;
+            //! The device's DRM render node (or device file) if the driver reports it
+            std::string name;
+        };
+
+        /*!
+         * The GPUs that EGL can see, through EGL_EXT_device_enumeration. Software rasterisers are
+         * skipped if there is any other device. Without the extension, the default display is
+         * returned as the only device.
+         */
+        inline std::vector<egl_device> egl_devices()
+        {
+            std::vector<egl_device> devs;
+            auto query_devices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress ("eglQueryDevicesEXT"));
+            auto query_string = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(eglGetProcAddress ("eglQueryDeviceStringEXT"));
+            EGLint n = 0;
+            if (query_devices == nullptr || query_devices (0, nullptr, &n) == EGL_FALSE || n <= 0) {
+                devs.push_back (egl_device{});
+                return devs;
+            }
+            std::vector<EGLDeviceEXT> all (n);
+            query_devices (n, all.data(), &n);
+            std::vector<egl_device> software;
+            for (EGLint i = 0; i < n; ++i) {
+                egl_device d;
+                d.device = all[i];
+                const char* exts = query_string ? query_string (all[i], EGL_EXTENSIONS) : nullptr;
+                const char* file = nullptr;
+                if (query_string && exts && std::strstr (exts, "EGL_EXT_device_drm_render_node")) {
+                    file = query_string (all[i], EGL_DRM_RENDER_NODE_FILE_EXT);
+                }
+                if (file == nullptr && query_string && exts && std::strstr (exts, "EGL_EXT_device_drm")) {
+                    file = query_string (all[i], EGL_DRM_DEVICE_FILE_EXT);
+                }
+                if (file != nullptr) { d.name = file; }
+                // Devices with neither are software renderers (Mesa's llvmpipe, for example)
+                if (file == nullptr) { software.push_back (d); } else { devs.push_back (d); }
+            }
+            if (devs.empty()) { devs = software; }
+            return devs;
+        }
+
+        /*!
+         * A headless (surfaceless) GL context on one device. OpenGL ES for ES versions, otherwise
+         * a core profile desktop OpenGL context.
+         */
+        template <int glver = morph::gl::version_4_5>
+        struct compute_context
+        {
+            compute_context (EGLDisplay _dpy, const unsigned int _device_index, const std::string& _device_name)
+                : dpy (_dpy), device_index (_device_index), device_name (_device_name)
+            {
+                constexpr bool es = morph::gl::version::gles (glver);
+                // No surface type: the context is surfaceless, and device displays may have no
+                // window configs (the default surface type)
+                const EGLint config_attribs[] = {
+                    EGL_SURFACE_TYPE, 0,
+                    EGL_RENDERABLE_TYPE, es ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_BIT,
+                    EGL_NONE
+                };
+                EGLConfig cfg;
+                EGLint count = 0;
+                if (eglChooseConfig (this->dpy, config_attribs, &cfg, 1, &count) == EGL_FALSE || count < 1) {
+                    throw std::runtime_error ("compute_context: eglChooseConfig failed on " + this->device_name);
+                }
+                if (eglBindAPI (es ? EGL_OPENGL_ES_API : EGL_OPENGL_API) == EGL_FALSE) {
+                    throw std::runtime_error ("compute_context: eglBindAPI failed");
+                }
+                const EGLint ctx_attribs[] = {
+                    EGL_CONTEXT_MAJOR_VERSION, morph::gl::version::major (glver),
+                    EGL_CONTEXT_MINOR_VERSION, morph::gl::version::minor (glver),
+                    es ? EGL_NONE : EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                    EGL_NONE
+                };
+                this->ctx = eglCreateContext (this->dpy, cfg, EGL_NO_CONTEXT, ctx_attribs);
+                if (this->ctx == EGL_NO_CONTEXT) {
+                    throw std::runtime_error ("compute_context: eglCreateContext failed on " + this->device_name);
+                }
+            }
+            ~compute_context() { if (this->ctx != EGL_NO_CONTEXT) { eglDestroyContext (this->dpy, this->ctx); } }
+            compute_context (const compute_context&) = delete;
+            compute_context& operator= (const compute_context&) = delete;
+
+            //! Make this context current on the calling thread
+            void make_current()
+            {
+                // The API binding is per thread
+                eglBindAPI (morph::gl::version::gles (glver) ? EGL_OPENGL_ES_API : EGL_OPENGL_API);
+                if (eglMakeCurrent (this->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, this->ctx) == EGL_FALSE) {
+                    throw std::runtime_error ("compute_context: eglMakeCurrent failed on " + this->device_name);
+                }
+            }
+            //! Release this context from the calling thread
+            void release() { eglMakeCurrent (this->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT); }
+
+            EGLDisplay dpy = EGL_NO_DISPLAY;
+            EGLContext ctx = EGL_NO_CONTEXT;
+            //! The index of this context's device in the pool's device list
+            unsigned int device_index = 0;
+            //! The device's name (its DRM node), if known
+            std::string device_name;
+        };
+
+        /*!
+         * Worker threads, each owning one compute_context, that run queued jobs first in, first
+         * out, in the manner of morph::job_pool. A job is given the context it runs on, and
+         * should leave no GL state behind that the next job on that context would trip over.
+         */
+        template <int glver = morph::gl::version_4_5>
+        class compute_pool
+        {
+        public:
+            /*!
+             * Create \a contexts_per_device contexts on each device from egl_devices() (or on as
+             * many of them as will make one), and a worker thread for each. More than one context
+             * per device can hide the CPU-side work of one run behind the GPU work of another.
+             */
+            explicit compute_pool (const unsigned int contexts_per_device = 1)
+                : compute_pool (egl_devices(), contexts_per_device) {}
+
+            //! Create contexts on the given devices
+            compute_pool (const std::vector<egl_device>& devices, const unsigned int contexts_per_device)
+            {
+                auto platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress ("eglGetPlatformDisplayEXT"));
+                for (auto d : devices) {
+                    EGLDisplay dpy = EGL_NO_DISPLAY;
+                    if (d.device != nullptr && platform_display != nullptr) {
+                        dpy = platform_display (EGL_PLATFORM_DEVICE_EXT, d.device, nullptr);
+                    } else if (d.device == nullptr) {
+                        dpy = eglGetDisplay (EGL_DEFAULT_DISPLAY);
+                    }
+                    if (dpy == EGL_NO_DISPLAY || eglInitialize (dpy, nullptr, nullptr) == EGL_FALSE) {
+                        std::cerr << "compute_pool: can't initialise EGL on device " << d.name << std::endl;
+                        continue;
+                    }
+                    const char* exts = eglQueryString (dpy, EGL_EXTENSIONS);
+                    if (exts == nullptr || std::strstr (exts, "EGL_KHR_surfaceless_context") == nullptr) {
+                        std::cerr << "compute_pool: device " << d.name << " lacks EGL_KHR_surfaceless_context\n";
+                        eglTerminate (dpy);
+                        continue;
+                    }
+                    const unsigned int di = static_cast<unsigned int>(this->displays.size());
+                    bool made_one = false;
+                    for (unsigned int c = 0; c < contexts_per_device; ++c) {
+                        try {
+                            this->contexts.push_back (std::make_unique<compute_context<glver>> (dpy, di, d.name));
+                            made_one = true;
+                        } catch (const std::exception& e) {
+                            std::cerr << e.what() << std::endl;
+                            break;
+                        }
+                    }
+                    if (made_one) { this->displays.push_back (dpy); } else { eglTerminate (dpy); }
+                }
+                if (this->contexts.empty()) { throw std::runtime_error ("compute_pool: could not create any GL compute context"); }
+                this->live = this->size();
+                for (auto& c : this->contexts) { this->workers.emplace_back (&compute_pool::run, this, c.get()); }
+            }
+
+            //! Finish the jobs already queued, then stop the workers and destroy the contexts
+            ~compute_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lk (this->m);
+                    this->stopping = true;
+                }
+                this->cv_work.notify_all();
+                for (auto& w : this->workers) { if (w.joinable()) { w.join(); } }
+                this->contexts.clear();
+                for (auto dpy : this->displays) { eglTerminate (dpy); }
+            }
+
+            compute_pool (const compute_pool&) = delete;
+            compute_pool& operator= (const compute_pool&) = delete;
+
+            /*!
+             * Queue the job j. Jobs should catch their own exceptions; one that escapes is reported
+             * on std::cerr and dropped.
+             */
+            void push (std::function<void(compute_context<glver>&)>&& j)
+            {
+                {
+                    std::lock_guard<std::mutex> lk (this->m);
+                    this->jobs.push_back (std::move (j));
+                }
+                this->cv_work.notify_one();
+            }
+
+            //! Block until every job pushed so far has finished
+            void wait()
+            {
+                std::unique_lock<std::mutex> lk (this->m);
+                this->cv_idle.wait (lk, [this] { return (this->jobs.empty() && this->busy == 0) || this->live == 0; });
+            }
+
+            //! The number of contexts (and worker threads)
+            unsigned int size() const { return static_cast<unsigned int>(this->contexts.size()); }
+            //! The number of devices with at least one context
+            unsigned int num_devices() const { return static_cast<unsigned int>(this->displays.size()); }
+
+        private:
+            void run (compute_context<glver>* c)
+            {
+                try {
+                    c->make_current();
+                } catch (const std::exception& e) {
+                    // This worker can't run anything; leave the jobs to the others
+                    std::cerr << e.what() << std::endl;
+                    std::lock_guard<std::mutex> lk (this->m);
+                    if (--this->live == 0) {
+                        // No worker is left, so nothing queued can ever run
+                        this->jobs.clear();
+                        this->cv_idle.notify_all();
+                    }
+                    return;
+                }
+                std::unique_lock<std::mutex> lk (this->m);
+                for (;;) {
+                    this->cv_work.wait (lk, [this] { return this->stopping || !this->jobs.empty(); });
+                    if (this->jobs.empty()) { break; } // stopping, and nothing is left to do
+                    std::function<void(compute_context<glver>&)> j = std::move (this->jobs.front());
+                    this->jobs.pop_front();
+                    ++this->busy;
+                    lk.unlock();
+
+                    try {
+                        j (*c);
+                    } catch (const std::exception& e) {
+                        std::cerr << "compute_pool: a job threw: " << e.what() << std::endl;
+                    }
+
+                    lk.lock();
+                    --this->busy;
+                    if (this->jobs.empty() && this->busy == 0) { this->cv_idle.notify_all(); }
+                }
+                lk.unlock();
+                c->release();
+            }
+
+            std::vector<EGLDisplay> displays;
+            std::vector<std::unique_ptr<compute_context<glver>>> contexts;
+            std::deque<std::function<void(compute_context<glver>&)>> jobs;
+            unsigned int busy = 0;
+            // The number of workers whose context could be made current
+            unsigned int live = 0;
+            bool stopping = false;
+            std::mutex m;
+            std::condition_variable cv_work;
+            std::condition_variable cv_idle;
+            std::vector<std::thread> workers;
+        };
+
+    } // namespace gl
+} // namespace morph
@@ -8,6 +8,7 @@
 #include <morph/gl/util.h>
 #include <morph/vec.h>
 #include <morph/vvec.h>
+#include <morph/trace.h>
 
 namespace morph {
     namespace gl {
@@ -34,6 +35,9 @@ namespace morph {
 
             ~compute_shaderprog()
             {
+#if defined MORPH_TRACE && MORPH_TRACE
+                this->gpu_trace.release();
+#endif
                 if (this->prog_id) {
                     glDeleteProgram (this->prog_id);
                     this->prog_id = 0;
@@ -47,12 +51,42 @@ namespace morph {
 
             void use() const { glUseProgram (this->prog_id); }
 
-            // Convenience wrapper for dispatch
-            void dispatch (GLuint ngrps_x, GLuint ngrps_y, GLuint ngrps_z) const
+            /*
+             * Convenience wrapper for dispatch, followed by glMemoryBarrier (barriers). The default
+             * waits on every kind of access, which is always correct but serialises the pipeline.
+             * Pass only the bits for the way the shader's output is used next, for example
+             * GL_SHADER_STORAGE_BARRIER_BIT when another dispatch reads an SSBO that this one
+             * wrote, or GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT when an
+             * image is written and then drawn as a texture. Pass 0 for no barrier (the readback
+             * functions in ssbo.h issue their own).
+             *
+             * With MORPH_TRACE, a recording trace gets the dispatch's CPU time and, on a GPU track,
+             * the GPU time between timestamps written before and after it (see trace_collect()).
+             */
+            void dispatch (GLuint ngrps_x, GLuint ngrps_y, GLuint ngrps_z, GLbitfield barriers = GL_ALL_BARRIER_BITS) const
             {
+#if defined MORPH_TRACE && MORPH_TRACE
+                MORPH_TRACE_SCOPE_CAT ("compute_shaderprog::dispatch", "compute");
+                const bool gpu_timed = morph::trace::recording() && this->gpu_trace.begin();
+#endif
                 glDispatchCompute (ngrps_x, ngrps_y, ngrps_z);
-                // Choices of GL_SHADER_IMAGE_ACCESS_BARRIER_BIT, GL_SHADER_STORAGE_BARRIER_BIT or GL_ALL_BARRIER_BITS (or others).
-                glMemoryBarrier (GL_ALL_BARRIER_BITS);
+                if (barriers != 0) { glMemoryBarrier (barriers); }
+#if defined MORPH_TRACE && MORPH_TRACE
+                if (gpu_timed) { this->gpu_trace.end(); }
+#endif
+            }
+
+            /*!
+             * Pass the GPU times of earlier dispatches that are ready to morph::trace. dispatch()
+             * does this as it goes; call this (after a glFinish() to be sure of them all) before
+             * morph::trace::write_json() to collect the last dispatches' times. Does nothing
+             * without MORPH_TRACE.
+             */
+            void trace_collect() const
+            {
+#if defined MORPH_TRACE && MORPH_TRACE
+                this->gpu_trace.collect();
+#endif
             }
 
             // Set a uniform variable into the OpenGL context associated with this shader program
@@ -90,6 +124,74 @@ namespace morph {
             }
 
         private:
+#if defined MORPH_TRACE && MORPH_TRACE
+            /*
+             * GL_TIMESTAMP queries on either side of the most recent dispatches. Results are read
+             * only once they are available, so the CPU never waits; a dispatch made while all the
+             * pairs are still in flight is not timed on the GPU. Not on OpenGL ES.
+             */
+            struct gpu_timestamps
+            {
+                static constexpr unsigned int npairs = 8;
+                GLuint queries[2 * npairs] = {};
+                bool issued[npairs] = {};
+                unsigned int next = 0;
+
+                bool begin()
+                {
+                    if constexpr (morph::gl::version::gles (glver) == false) {
+                        if (this->queries[0] == 0) {
+                            glGenQueries (2 * npairs, this->queries);
+                            GLint64 gpu_now = 0;
+                            glGetInteger64v (GL_TIMESTAMP, &gpu_now);
+                            morph::trace::tracer::get().gpu_calibrate (static_cast<std::int64_t>(gpu_now));
+                        }
+                        this->collect();
+                        if (this->issued[this->next]) { return false; }
+                        glQueryCounter (this->queries[2 * this->next], GL_TIMESTAMP);
+                        return true;
+                    } else {
+                        return false;
+                    }
+                }
+
+                void end()
+                {
+                    if constexpr (morph::gl::version::gles (glver) == false) {
+                        glQueryCounter (this->queries[2 * this->next + 1], GL_TIMESTAMP);
+                        this->issued[this->next] = true;
+                        this->next = (this->next + 1) % npairs;
+                    }
+                }
+
+                void collect()
+                {
+                    if constexpr (morph::gl::version::gles (glver) == false) {
+                        for (unsigned int i = 0; i < npairs; ++i) {
+                            if (!this->issued[i]) { continue; }
+                            GLint ready = 0;
+                            glGetQueryObjectiv (this->queries[2 * i + 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+                            if (!ready) { continue; }
+                            GLuint64 t0 = 0;
+                            GLuint64 t1 = 0;
+                            glGetQueryObjectui64v (this->queries[2 * i], GL_QUERY_RESULT, &t0);
+                            glGetQueryObjectui64v (this->queries[2 * i + 1], GL_QUERY_RESULT, &t1);
+                            morph::trace::tracer::get().gpu_event ("compute_shaderprog::dispatch",
+                                                                   static_cast<std::int64_t>(t0), static_cast<std::int64_t>(t1));
+                            this->issued[i] = false;
+                        }
+                    }
+                }
+
+                void release()
+                {
+                    if (this->queries[0] != 0) { glDeleteQueries (2 * npairs, this->queries); }
+                    this->queries[0] = 0;
+                }
+            };
+            mutable gpu_timestamps gpu_trace;
+#endif
+
             // Runtime check on a uniform location. If -1 throw exception. This is useful because
             // any uniform variable in a GLSL program which is not used may be compiled out and thus
             // be not 'active'. In this case, glGetUniformLocation will return -1. Our programmer
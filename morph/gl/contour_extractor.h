@@ -0,0 +1,402 @@
+#pragma once
+
+/*
+ * Contours of a scalar field, as line segments, extracted in a compute shader.
+ *
+ * On a HexGrid a contour is drawn along the hex edges: one segment for each pair of
+ * neighbouring hexes of which one is at or above the threshold and the other below. This is
+ * the boundary of the hexes that ShapeAnalysis::get_contours() finds (the hexes above the
+ * threshold that have a neighbour below it), as lines rather than as lists of hexes. On a
+ * Grid or a CartGrid the contour is found by marching squares: each square cell between four
+ * element centres gives up to two segments, whose ends are interpolated linearly along the
+ * cell's sides, and a saddle cell is resolved with the mean of its corners.
+ *
+ * The field is read from an SSBO at offset + i * stride for element i, so it can be the output
+ * of another compute shader (such as a field of morph::gl::rd_batch's state or the output of
+ * morph::gl::image_resampler) that never leaves the GPU. The segments are written to
+ * vertices(), 3 floats (x, y, z) per vertex and 2 vertices per segment, which can be bound as
+ * the vertex buffer of a GL_LINES draw. command() holds a DrawArraysIndirectCommand whose
+ * count is the number of vertices written, so the draw needs no readback either:
+ *
+ *   morph::gl::contour_extractor<morph::gl::version_4_5> ce;
+ *   ce.set_hexgrid (hg);
+ *   ce.dispatch (0.5f, batch.state_buffer(), m * nfields + f, ninst * nfields);
+ *   // In a GL_LINES draw
+ *   glBindBuffer (GL_ARRAY_BUFFER, ce.vertices());
+ *   glVertexAttribPointer (posLoc, 3, GL_FLOAT, GL_FALSE, 0, 0);
+ *   glBindBuffer (GL_DRAW_INDIRECT_BUFFER, ce.command());
+ *   glDrawArraysIndirect (GL_LINES, 0);
+ *
+ * The threshold is absolute. get_contours() normalises its fields to [0, 1] first; for the
+ * same contour pass fmin + threshold * (fmax - fmin).
+ *
+ * Note: You have to include a header like gl3.h or glext.h etc for the GL types and
+ * functions BEFORE including this file. OpenGL 4.3 or OpenGL 3.1 ES is required. The
+ * vertices and command buffers belong to the GL context that is current when set_hexgrid()
+ * or set_grid() is called, and it must be current whenever a member function is called,
+ * including the destructor.
+ */
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <morph/HexGrid.h>
+#include <morph/stencil.h>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+
+namespace morph {
+    namespace gl {
+
+        template <int glver>
+        struct contour_extractor
+        {
+            static_assert (morph::gl::version::gles (glver) ? morph::gl::version::minor (glver) >= 1
+                           : (morph::gl::version::major (glver) > 4
+                              || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 3)),
+                           "contour_extractor needs compute shaders: OpenGL 4.3 or OpenGL 3.1 ES or later");
+
+            //! Work group size. OpenGL ES 3.1 only guarantees 128 invocations per work group.
+            static constexpr unsigned int wg = morph::gl::version::gles (glver) ? 128u : 256u;
+
+            //! The z coordinate given to every vertex
+            float z = 0.0f;
+
+            contour_extractor() {}
+            ~contour_extractor() { this->free_buffers(); }
+            contour_extractor (const contour_extractor&) = delete;
+            contour_extractor& operator= (const contour_extractor&) = delete;
+
+            /*!
+             * Extract contours on hg. Each hex is linked to its neighbours to the east, north
+             * east and north west (so that each pair of neighbours is tested once); links that
+             * wrap round the grid are left out, as they would cross the whole domain.
+             */
+            void set_hexgrid (const morph::HexGrid& hg)
+            {
+                this->n = static_cast<unsigned int>(hg.num());
+                if (hg.d_ne.size() != this->n) { throw std::runtime_error ("contour_extractor: the HexGrid's d_ vectors must be populated"); }
+                const float d = hg.getd();
+                std::vector<float> xy (2 * this->n);
+                for (unsigned int i = 0; i < this->n; ++i) {
+                    xy[2 * i] = hg.d_x[i];
+                    xy[2 * i + 1] = hg.d_y[i];
+                }
+                const std::vector<int>* nb[3] = { &hg.d_ne, &hg.d_nne, &hg.d_nnw };
+                std::vector<int> links (3 * this->n, -1);
+                for (unsigned int i = 0; i < this->n; ++i) {
+                    for (unsigned int l = 0; l < 3; ++l) {
+                        const int j = (*nb[l])[i];
+                        if (j < 0) { continue; }
+                        const float dx = hg.d_x[j] - hg.d_x[i];
+                        const float dy = hg.d_y[j] - hg.d_y[i];
+                        if (dx * dx + dy * dy < 2.25f * d * d) { links[3 * i + l] = j; }
+                    }
+                }
+                this->hex = true;
+                // An edge of a hex is d / sqrt(3) long
+                this->half_edge = 0.5f * d / std::sqrt (3.0f);
+                this->upload (xy, links, 3 * this->n);
+            }
+
+            /*!
+             * Extract contours on a Grid or a CartGrid, by marching squares. Each element with
+             * neighbours to the east, north east and north is the lower left corner of a cell;
+             * cells that wrap round the grid are left out.
+             */
+            template <typename G>
+            void set_grid (const G& g)
+            {
+                std::vector<float> xy;
+                std::vector<int> cells;
+                if constexpr (morph::stencil_detail::rectangular_grid<G>) {
+                    using I = std::decay_t<decltype (g.get_w())>;
+                    this->n = static_cast<unsigned int>(g.n());
+                    xy.resize (2 * this->n);
+                    for (unsigned int i = 0; i < this->n; ++i) {
+                        xy[2 * i] = static_cast<float>(g[static_cast<I>(i)][0]);
+                        xy[2 * i + 1] = static_cast<float>(g[static_cast<I>(i)][1]);
+                    }
+                    constexpr I none = std::numeric_limits<I>::max();
+                    auto idx = [none](const I j) { return j == none ? -1 : static_cast<int>(j); };
+                    for (unsigned int i = 0; i < this->n; ++i) {
+                        contour_extractor<glver>::add_cell (cells, xy, static_cast<int>(i), idx (g.index_ne (static_cast<I>(i))),
+                                                            idx (g.index_nne (static_cast<I>(i))), idx (g.index_nn (static_cast<I>(i))));
+                    }
+                } else if constexpr (morph::stencil_detail::cart_grid<G>) {
+                    this->n = static_cast<unsigned int>(g.num());
+                    xy.resize (2 * this->n);
+                    for (unsigned int i = 0; i < this->n; ++i) {
+                        xy[2 * i] = g.d_x[i];
+                        xy[2 * i + 1] = g.d_y[i];
+                    }
+                    for (unsigned int i = 0; i < this->n; ++i) {
+                        contour_extractor<glver>::add_cell (cells, xy, static_cast<int>(i), g.d_ne[i], g.d_nne[i], g.d_nn[i]);
+                    }
+                } else {
+                    []<bool flag = false>() { static_assert (flag, "contour_extractor::set_grid: needs a morph::Grid or a morph::CartGrid"); }();
+                }
+                this->hex = false;
+                // At most two segments per cell
+                this->upload (xy, cells, 2 * static_cast<unsigned int>(cells.size() / 4));
+            }
+
+            //! Upload the n values of f and extract its contour at threshold
+            template <typename C> requires requires (const C& c) { c.size(); c.begin(); }
+            void dispatch (const float threshold, const C& f)
+            {
+                if (f.size() != this->n) { throw std::runtime_error ("contour_extractor::dispatch: need one value per element"); }
+                std::vector<float> v (f.begin(), f.end());
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->field_ssbo);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, v.size() * sizeof (float), v.data(), GL_DYNAMIC_DRAW);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                this->dispatch (threshold, this->field_ssbo);
+            }
+
+            /*!
+             * Extract the contour at threshold of the field whose value for element i is
+             * element offset + i * stride of the float SSBO field_buf. Nothing is read back;
+             * the last barrier makes vertices() and command() ready for a draw.
+             */
+            void dispatch (const float threshold, const GLuint field_buf, const unsigned int offset = 0, const unsigned int stride = 1)
+            {
+                if (this->n == 0) { throw std::runtime_error ("contour_extractor::dispatch: call set_hexgrid() or set_grid() first"); }
+                morph::gl::compute_shaderprog<glver>& prog = this->hex ? this->hex_prog : this->square_prog;
+                if (prog.prog_id == 0) { this->load_shaders(); }
+
+                // count = 0 vertices, 1 instance, from vertex 0
+                const GLuint cmd[4] = { 0u, 1u, 0u, 0u };
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->cmd_ssbo);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, sizeof (cmd), cmd);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+                const unsigned int nitems = this->hex ? this->n : this->ncells;
+                if (nitems > 0) {
+                    prog.use();
+                    prog.set_uniform ("nitems", nitems);
+                    prog.set_uniform ("threshold", threshold);
+                    prog.set_uniform ("offset", offset);
+                    prog.set_uniform ("stride", stride);
+                    prog.set_uniform ("z", this->z);
+                    if (this->hex) { prog.set_uniform ("half_edge", this->half_edge); }
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, field_buf);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->centres_ssbo);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->topo_ssbo);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->verts_ssbo);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, this->cmd_ssbo);
+                    // The outputs are next read as vertices and as an indirect command (or mapped)
+                    prog.dispatch ((nitems + wg - 1) / wg, 1, 1, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT
+                                   | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+                }
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! Read back the segments of the last dispatch, two vertices each
+            morph::vvec<morph::vec<float, 3>> segments() const
+            {
+                morph::vvec<morph::vec<float, 3>> rtn;
+                GLuint cmd[4] = { 0u, 0u, 0u, 0u };
+                contour_extractor<glver>::read_buffer (this->cmd_ssbo, sizeof (cmd), cmd);
+                rtn.resize (cmd[0]);
+                if (cmd[0] > 0) { contour_extractor<glver>::read_buffer (this->verts_ssbo, cmd[0] * 3 * sizeof (float), rtn.data()); }
+                return rtn;
+            }
+
+            //! The name of the buffer of vertices (3 floats each, in pairs for GL_LINES)
+            GLuint vertices() const { return this->verts_ssbo; }
+            //! The name of the buffer holding the DrawArraysIndirectCommand for vertices()
+            GLuint command() const { return this->cmd_ssbo; }
+            //! The most vertices a dispatch can write (the size of vertices())
+            unsigned int capacity() const { return this->max_vertices; }
+            //! The number of elements of the grid
+            unsigned int size() const { return this->n; }
+
+        private:
+            // Add the cell with corners i (lower left), e, ne and nn, if they all exist and it does not wrap
+            static void add_cell (std::vector<int>& cells, const std::vector<float>& xy, const int i, const int e, const int ne, const int nn)
+            {
+                if (e < 0 || ne < 0 || nn < 0) { return; }
+                if (xy[2 * e] <= xy[2 * i] || xy[2 * nn + 1] <= xy[2 * i + 1]) { return; }
+                if (xy[2 * ne] <= xy[2 * nn] || xy[2 * ne + 1] <= xy[2 * e + 1]) { return; }
+                cells.insert (cells.end(), { i, e, ne, nn });
+            }
+
+            void upload (const std::vector<float>& xy, const std::vector<int>& topo, const unsigned int max_segments)
+            {
+                this->free_buffers();
+                this->ncells = this->hex ? 0u : static_cast<unsigned int>(topo.size() / 4);
+                this->max_vertices = 2 * max_segments;
+                this->centres_ssbo = contour_extractor<glver>::make_buffer (xy.size() * sizeof (float), xy.data());
+                this->topo_ssbo = contour_extractor<glver>::make_buffer (topo.size() * sizeof (int), topo.data());
+                this->verts_ssbo = contour_extractor<glver>::make_buffer (this->max_vertices * 3 * sizeof (float), nullptr);
+                this->cmd_ssbo = contour_extractor<glver>::make_buffer (4 * sizeof (GLuint), nullptr);
+                this->field_ssbo = contour_extractor<glver>::make_buffer (this->n * sizeof (float), nullptr);
+            }
+
+            void free_buffers()
+            {
+                GLuint bufs[5] = { this->centres_ssbo, this->topo_ssbo, this->verts_ssbo, this->cmd_ssbo, this->field_ssbo };
+                if (bufs[0] != 0) { glDeleteBuffers (5, bufs); }
+                this->centres_ssbo = this->topo_ssbo = this->verts_ssbo = this->cmd_ssbo = this->field_ssbo = 0;
+            }
+
+            static GLuint make_buffer (const std::size_t bytes, const void* data)
+            {
+                GLuint name = 0;
+                glGenBuffers (1, &name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, std::max (bytes, sizeof (float)), data, GL_DYNAMIC_COPY);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                return name;
+            }
+
+            static void read_buffer (const GLuint name, const std::size_t bytes, void* dst)
+            {
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                const void* gpu = glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                if (gpu != nullptr) { std::copy_n (static_cast<const unsigned char*>(gpu), bytes, static_cast<unsigned char*>(dst)); }
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            static void load (morph::gl::compute_shaderprog<glver>& prog, const std::string& src)
+            {
+                // No file name, so that the compiled-in source is always used
+                std::vector<morph::gl::ShaderInfo> shaders = { {GL_COMPUTE_SHADER, "", src, 0 } };
+                prog.load_shaders (shaders);
+                if (prog.prog_id == 0) { throw std::runtime_error ("contour_extractor: failed to build a compute shader"); }
+            }
+
+            void load_shaders()
+            {
+                std::string h = morph::gl::version::shaderpreamble (glver);
+                if constexpr (morph::gl::version::gles (glver)) { h += "precision highp float;\nprecision highp int;\n"; }
+                h += "layout (local_size_x = " + std::to_string (wg) + ", local_size_y = 1, local_size_z = 1) in;\n"
+                "uniform uint nitems;\n"
+                "uniform float threshold;\n"
+                "uniform uint offset;\n"
+                "uniform uint stride;\n"
+                "uniform float z;\n"
+                "layout (std430, binding = 0) readonly buffer Field { float field[]; };\n"
+                "layout (std430, binding = 1) readonly buffer Centres { vec2 centres[]; };\n"
+                "layout (std430, binding = 2) readonly buffer Topo { int topo[]; };\n"
+                "layout (std430, binding = 3) writeonly buffer Verts { float verts[]; };\n"
+                "layout (std430, binding = 4) buffer Cmd { uint count; uint instances; uint first; uint reserved; };\n"
+                "float value (int i) { return field[offset + uint(i) * stride]; }\n"
+                "void emit (vec2 a, vec2 b)\n"
+                "{\n"
+                "    uint v = atomicAdd (count, 2u) * 3u;\n"
+                "    verts[v] = a.x; verts[v + 1u] = a.y; verts[v + 2u] = z;\n"
+                "    verts[v + 3u] = b.x; verts[v + 4u] = b.y; verts[v + 5u] = z;\n"
+                "}\n";
+
+                if (this->hex && this->hex_prog.prog_id == 0) {
+                    // One invocation per hex, testing its links to the east, north east and north west
+                    contour_extractor<glver>::load (this->hex_prog, h
+                        + "uniform float half_edge;\n"
+                        "void main()\n"
+                        "{\n"
+                        "    uint i = gl_GlobalInvocationID.x;\n"
+                        "    if (i >= nitems) { return; }\n"
+                        "    bool above = value (int(i)) >= threshold;\n"
+                        "    for (uint l = 0u; l < 3u; ++l) {\n"
+                        "        int j = topo[3u * i + l];\n"
+                        "        if (j < 0 || (value (j) >= threshold) == above) { continue; }\n"
+                        "        vec2 c = centres[i];\n"
+                        "        vec2 dir = normalize (centres[j] - c);\n"
+                        "        vec2 mid = 0.5 * (c + centres[j]);\n"
+                        "        vec2 along = half_edge * vec2 (-dir.y, dir.x);\n"
+                        "        emit (mid - along, mid + along);\n"
+                        "    }\n"
+                        "}\n");
+                }
+
+                if (!this->hex && this->square_prog.prog_id == 0) {
+                    // One invocation per cell. The corners are 0 (lower left), 1, 2, 3 anticlockwise
+                    // and side s runs from corner s to corner s + 1.
+                    contour_extractor<glver>::load (this->square_prog, h
+                        + "vec2 cross_side (int s, int c[4], float v[4])\n"
+                        "{\n"
+                        "    // From the corner with the lower index, so that the cells on either side of a\n"
+                        "    // side compute the same point\n"
+                        "    int a = s;\n"
+                        "    int b = (s + 1) % 4;\n"
+                        "    if (c[b] < c[a]) { a = b; b = s; }\n"
+                        "    float t = clamp ((threshold - v[a]) / (v[b] - v[a]), 0.0, 1.0);\n"
+                        "    return mix (centres[c[a]], centres[c[b]], t);\n"
+                        "}\n"
+                        "void main()\n"
+                        "{\n"
+                        "    uint i = gl_GlobalInvocationID.x;\n"
+                        "    if (i >= nitems) { return; }\n"
+                        "    int c[4];\n"
+                        "    float v[4];\n"
+                        "    int k = 0;\n"
+                        "    for (int q = 0; q < 4; ++q) {\n"
+                        "        c[q] = topo[4u * i + uint(q)];\n"
+                        "        v[q] = value (c[q]);\n"
+                        "        if (v[q] >= threshold) { k |= 1 << q; }\n"
+                        "    }\n"
+                        "    if (k == 0 || k == 15) { return; }\n"
+                        "    if (k == 5 || k == 10) {\n"
+                        "        // A saddle. If the centre is on the side of corners 0 and 2 the contour cuts\n"
+                        "        // off corners 1 and 3; otherwise it cuts off 0 and 2.\n"
+                        "        bool centre_above = 0.25 * (v[0] + v[1] + v[2] + v[3]) >= threshold;\n"
+                        "        if (centre_above == (k == 5)) {\n"
+                        "            emit (cross_side (0, c, v), cross_side (1, c, v));\n"
+                        "            emit (cross_side (2, c, v), cross_side (3, c, v));\n"
+                        "        } else {\n"
+                        "            emit (cross_side (3, c, v), cross_side (0, c, v));\n"
+                        "            emit (cross_side (1, c, v), cross_side (2, c, v));\n"
+                        "        }\n"
+                        "        return;\n"
+                        "    }\n"
+                        "    // Otherwise the corners above (or below) are one run; the contour crosses the\n"
+                        "    // two sides where the run starts and ends\n"
+                        "    int s0 = -1;\n"
+                        "    int s1 = -1;\n"
+                        "    for (int s = 0; s < 4; ++s) {\n"
+                        "        if (((k >> s) & 1) != ((k >> ((s + 1) % 4)) & 1)) {\n"
+                        "            if (s0 < 0) { s0 = s; } else { s1 = s; }\n"
+                        "        }\n"
+                        "    }\n"
+                        "    emit (cross_side (s0, c, v), cross_side (s1, c, v));\n"
+                        "}\n");
+                }
+            }
+
+            //! The number of elements, and of marching squares cells
+            unsigned int n = 0;
+            unsigned int ncells = 0;
+            unsigned int max_vertices = 0;
+            //! True for a HexGrid, false for marching squares
+            bool hex = true;
+            float half_edge = 0.0f;
+
+            //! Element centres (vec2), the hex links or cell corners, the output and its draw command
+            GLuint centres_ssbo = 0;
+            GLuint topo_ssbo = 0;
+            GLuint verts_ssbo = 0;
+            GLuint cmd_ssbo = 0;
+            //! The field, when it is uploaded by dispatch (threshold, f)
+            GLuint field_ssbo = 0;
+
+            morph::gl::compute_shaderprog<glver> hex_prog;
+            morph::gl::compute_shaderprog<glver> square_prog;
+        };
+
+    } // namespace gl
+} // namespace morph
@@ -0,0 +1,356 @@
+#pragma once
+
+/*
+ * Gaussian resampling of an image onto a set of points, such as the centres of the hexes of a
+ * HexGrid or the elements of a Grid, in a compute shader.
+ *
+ * This is the computation of HexGrid::resampleImage and Grid::resample_image: each point gets
+ * the sum of the image pixels within 3 sigma of it, weighted by a separable 2D Gaussian whose
+ * sigma is the pixel spacing, and the result is divided by its maximum. The image is uploaded
+ * as a single channel float texture, the points as an SSBO (once), and both passes (the
+ * weighted sums, with the maximum found by atomics, then the division) run on the GPU. The
+ * result stays in an SSBO (output()), ready for a GPU reaction-diffusion step or for a
+ * HexGridVisual or CartGridVisual coloured from a GL buffer; resample() also reads it back.
+ *
+ *   morph::gl::image_resampler<morph::gl::version_4_5> rs;
+ *   rs.set_centres (hg.d_x, hg.d_y);
+ *   auto geom = morph::gl::resample_geometry::hexgrid ({img_w, img_h}, image_scale, image_offset);
+ *   morph::vvec<float> hex_data = rs.resample (image_data, img_w, geom);
+ *
+ * Note: You have to include a header like gl3.h or glext.h etc for the GL types and
+ * functions BEFORE including this file. OpenGL 4.3 or OpenGL 3.1 ES is required, and a GL
+ * context must be current whenever a member function is called, including the destructor.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+
+namespace morph {
+    namespace gl {
+
+        /*!
+         * Where the image pixels lie in the coordinates of the points: pixel (i, j) is at
+         * origin + dist_per_pix * (i, j). dist_per_pix is also the sigma of the Gaussian.
+         */
+        struct resample_geometry
+        {
+            morph::vec<float, 2> dist_per_pix = { 1.0f, 1.0f };
+            morph::vec<float, 2> origin = { 0.0f, 0.0f };
+
+            //! The geometry of HexGrid::resampleImage, for an image of image_pixelsz pixels
+            static resample_geometry hexgrid (const morph::vec<unsigned int, 2>& image_pixelsz,
+                                              const morph::vec<float, 2>& image_scale,
+                                              const morph::vec<float, 2>& image_offset)
+            {
+                resample_geometry g;
+                g.dist_per_pix = image_scale / (image_pixelsz[0] - 1u);
+                g.origin = image_offset - g.dist_per_pix * image_pixelsz * 0.5f;
+                return g;
+            }
+
+            //! The geometry of Grid::resample_image, for a Grid of width grid_width
+            static resample_geometry grid (const morph::vec<unsigned int, 2>& image_pixelsz,
+                                           const morph::vec<float, 2>& image_scale,
+                                           const morph::vec<float, 2>& image_offset,
+                                           const float grid_width)
+            {
+                morph::vec<float, 2> image_dims = { 1.0f, 0.0f };
+                image_dims[1] = 1.0f / (image_pixelsz[0] - 1u) * (image_pixelsz[1] - 1u);
+                image_dims *= grid_width;
+                image_dims *= image_scale;
+                resample_geometry g;
+                g.dist_per_pix = image_dims / (image_pixelsz - 1u);
+                g.origin = image_offset;
+                return g;
+            }
+        };
+
+        //! Resample images onto a fixed set of points on the GPU
+        template <int glver>
+        struct image_resampler
+        {
+            static_assert (morph::gl::version::gles (glver) ? morph::gl::version::minor (glver) >= 1
+                           : (morph::gl::version::major (glver) > 4
+                              || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 3)),
+                           "image_resampler needs compute shaders: OpenGL 4.3 or OpenGL 3.1 ES or later");
+
+            //! Work group size. OpenGL ES 3.1 only guarantees 128 invocations per work group.
+            static constexpr unsigned int wg = morph::gl::version::gles (glver) ? 128u : 256u;
+
+            //! The image is read through this texture unit
+            unsigned int texture_unit = 0;
+
+            image_resampler() {}
+            ~image_resampler()
+            {
+                GLuint bufs[3] = { this->centres_ssbo, this->out_ssbo, this->max_ssbo };
+                glDeleteBuffers (3, bufs);
+                if (this->texture != 0) { glDeleteTextures (1, &this->texture); }
+            }
+            image_resampler (const image_resampler&) = delete;
+            image_resampler& operator= (const image_resampler&) = delete;
+
+            //! Set the points from separate x and y coordinates (such as HexGrid::d_x and d_y)
+            template <typename Cx, typename Cy>
+            void set_centres (const Cx& x, const Cy& y)
+            {
+                if (x.size() != y.size()) { throw std::runtime_error ("image_resampler::set_centres: x and y differ in size"); }
+                std::vector<float> xy (2 * x.size());
+                for (std::size_t i = 0; i < x.size(); ++i) {
+                    xy[2 * i] = static_cast<float>(x[i]);
+                    xy[2 * i + 1] = static_cast<float>(y[i]);
+                }
+                this->upload_centres (xy);
+            }
+
+            //! Set the points from a container of 2D coordinates (such as Grid::v_c)
+            template <typename C>
+            void set_centres (const morph::vvec<morph::vec<C, 2>>& c)
+            {
+                std::vector<float> xy (2 * c.size());
+                for (std::size_t i = 0; i < c.size(); ++i) {
+                    xy[2 * i] = static_cast<float>(c[i][0]);
+                    xy[2 * i + 1] = static_cast<float>(c[i][1]);
+                }
+                this->upload_centres (xy);
+            }
+
+            //! Upload a monochrome image, image_pixelwidth wide, running from bottom left to top right
+            template <typename Ai>
+            void set_image (const morph::vvec<float, Ai>& image_data, const unsigned int image_pixelwidth)
+            {
+                if (image_pixelwidth < 2 || image_data.size() % image_pixelwidth != 0 || image_data.size() / image_pixelwidth < 2) {
+                    throw std::runtime_error ("image_resampler::set_image: image must be at least 2x2 and a whole number of rows");
+                }
+                const morph::vec<unsigned int, 2> sz = { image_pixelwidth, static_cast<unsigned int>(image_data.size() / image_pixelwidth) };
+                glActiveTexture (GL_TEXTURE0 + this->texture_unit);
+                if (this->texture == 0 || sz != this->image_pixelsz) {
+                    // Immutable storage, so that the same code works on OpenGL ES
+                    if (this->texture != 0) { glDeleteTextures (1, &this->texture); }
+                    glGenTextures (1, &this->texture);
+                    glBindTexture (GL_TEXTURE_2D, this->texture);
+                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                    glTexStorage2D (GL_TEXTURE_2D, 1, GL_R32F, sz[0], sz[1]);
+                    this->image_pixelsz = sz;
+                } else {
+                    glBindTexture (GL_TEXTURE_2D, this->texture);
+                }
+                glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+                glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, sz[0], sz[1], GL_RED, GL_FLOAT, image_data.data());
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+
+                // A flat image resamples to itself, unnormalised, as on the CPU
+                const float i0 = image_data[0];
+                this->flat = std::all_of (image_data.begin(), image_data.end(), [i0](float v) { return v == i0; });
+                this->flat_value = i0;
+            }
+
+            /*!
+             * Resample the current image onto the points with geometry g, leaving the result in
+             * output(). Nothing is read back, so this can be followed directly by other
+             * dispatches that read output(); the last barrier is GL_SHADER_STORAGE_BARRIER_BIT.
+             */
+            void dispatch (const resample_geometry& g)
+            {
+                if (this->n == 0) { throw std::runtime_error ("image_resampler::dispatch: call set_centres() first"); }
+                if (this->texture == 0) { throw std::runtime_error ("image_resampler::dispatch: call set_image() first"); }
+                if (this->resample_prog.prog_id == 0) { this->load_shaders(); }
+                const unsigned int ngrps = (this->n + wg - 1) / wg;
+
+                if (!this->flat) {
+                    // Reset the maximum to the smallest ordered value
+                    const GLuint zero = 0u;
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->max_ssbo);
+                    glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, sizeof (GLuint), &zero);
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+                    this->resample_prog.use();
+                    this->resample_prog.set_uniform ("n", this->n);
+                    this->resample_prog.set_uniform ("pixsz", morph::vec<int, 2>{ static_cast<int>(this->image_pixelsz[0]),
+                                                                                   static_cast<int>(this->image_pixelsz[1]) });
+                    this->resample_prog.set_uniform ("dpp", g.dist_per_pix);
+                    this->resample_prog.set_uniform ("origin", g.origin);
+                    this->resample_prog.set_uniform ("img", static_cast<int>(this->texture_unit));
+                    glActiveTexture (GL_TEXTURE0 + this->texture_unit);
+                    glBindTexture (GL_TEXTURE_2D, this->texture);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->centres_ssbo);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->out_ssbo);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->max_ssbo);
+                    this->resample_prog.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+
+                this->normalise_prog.use();
+                this->normalise_prog.set_uniform ("n", this->n);
+                this->normalise_prog.set_uniform ("flat_value", this->flat_value);
+                this->normalise_prog.set_uniform ("is_flat", this->flat ? 1u : 0u);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->out_ssbo);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->max_ssbo);
+                this->normalise_prog.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! Upload image_data, resample it with geometry g and read the result back
+            template <typename Ao = std::allocator<float>, typename Ai = std::allocator<float>>
+            morph::vvec<float, Ao> resample (const morph::vvec<float, Ai>& image_data, const unsigned int image_pixelwidth,
+                                             const resample_geometry& g)
+            {
+                this->set_image (image_data, image_pixelwidth);
+                this->dispatch (g);
+                morph::vvec<float, Ao> rtn (this->n, 0.0f);
+                this->read_output (rtn.data());
+                return rtn;
+            }
+
+            //! Copy the n results in output() into dst
+            void read_output (float* dst) const
+            {
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->out_ssbo);
+                const float* gpu = static_cast<const float*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, this->n * sizeof(float), GL_MAP_READ_BIT));
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                if (gpu != nullptr) { std::copy (gpu, gpu + this->n, dst); }
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! The name of the SSBO of n floats that holds the result, in the order of the points
+            GLuint output() const { return this->out_ssbo; }
+            //! The name of the image texture
+            GLuint image_texture() const { return this->texture; }
+            //! The number of points
+            unsigned int size() const { return this->n; }
+
+        private:
+            void upload_centres (const std::vector<float>& xy)
+            {
+                this->n = static_cast<unsigned int>(xy.size() / 2);
+                GLuint bufs[3] = { this->centres_ssbo, this->out_ssbo, this->max_ssbo };
+                glDeleteBuffers (3, bufs);
+                this->centres_ssbo = image_resampler<glver>::make_buffer (xy.size() * sizeof(float), xy.data());
+                this->out_ssbo = image_resampler<glver>::make_buffer (this->n * sizeof(float), nullptr);
+                this->max_ssbo = image_resampler<glver>::make_buffer (sizeof(GLuint), nullptr);
+            }
+
+            static GLuint make_buffer (const std::size_t bytes, const void* data)
+            {
+                GLuint name = 0;
+                glGenBuffers (1, &name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, std::max (bytes, sizeof(float)), data, GL_DYNAMIC_COPY);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                return name;
+            }
+
+            static void load (morph::gl::compute_shaderprog<glver>& prog, const std::string& src)
+            {
+                // No file name, so that the compiled-in source is always used
+                std::vector<morph::gl::ShaderInfo> shaders = { {GL_COMPUTE_SHADER, "", src, 0 } };
+                prog.load_shaders (shaders);
+                if (prog.prog_id == 0) { throw std::runtime_error ("image_resampler: failed to build a compute shader"); }
+            }
+
+            void load_shaders()
+            {
+                std::string h = morph::gl::version::shaderpreamble (glver);
+                if constexpr (morph::gl::version::gles (glver)) { h += "precision highp float;\nprecision highp int;\n"; }
+                h += "layout (local_size_x = " + std::to_string (wg) + ", local_size_y = 1, local_size_z = 1) in;\n"
+                "uniform uint n;\n"
+                "layout (std430, binding = 1) buffer Out { float outv[]; };\n"
+                "layout (std430, binding = 2) buffer Max { uint maxbits; };\n";
+
+                // The sums over the pixels within 3 sigma, in separable windows of at most 7
+                // pixels in each dimension, as in HexGrid::resampleImage. The maximum is kept
+                // as an order-preserving uint, so that atomicMax finds it.
+                image_resampler<glver>::load (this->resample_prog, h
+                    + "uniform int pixsz[2];\n"
+                    "uniform float dpp[2];\n"
+                    "uniform float origin[2];\n"
+                    "uniform highp sampler2D img;\n"
+                    "layout (std430, binding = 0) readonly buffer Centres { vec2 centres[]; };\n"
+                    "shared uint group_max;\n"
+                    "uint ordered (float f) { uint b = floatBitsToUint (f); return (b & 0x80000000u) != 0u ? ~b : (b | 0x80000000u); }\n"
+                    "int window (float p, int dim, out float wt[8])\n"
+                    "{\n"
+                    "    float pj = (p - origin[dim]) / dpp[dim];\n"
+                    "    int first = max (0, int (ceil (pj - 3.0)));\n"
+                    "    int last = min (pixsz[dim] - 1, int (floor (pj + 3.0)));\n"
+                    "    float param = 1.0 / (2.0 * dpp[dim] * dpp[dim]);\n"
+                    "    for (int k = 0; k < 8; ++k) {\n"
+                    "        int j = first + k;\n"
+                    "        float d = p - (dpp[dim] * float (j) + origin[dim]);\n"
+                    "        wt[k] = (j <= last && abs (d) < 3.0 * dpp[dim]) ? exp (-param * d * d) : 0.0;\n"
+                    "    }\n"
+                    "    return first;\n"
+                    "}\n"
+                    "void main()\n"
+                    "{\n"
+                    "    if (gl_LocalInvocationIndex == 0u) { group_max = 0u; }\n"
+                    "    barrier();\n"
+                    "    uint i = gl_GlobalInvocationID.x;\n"
+                    "    if (i < n) {\n"
+                    "        vec2 c = centres[i];\n"
+                    "        float wx[8];\n"
+                    "        float wy[8];\n"
+                    "        int x0 = window (c.x, 0, wx);\n"
+                    "        int y0 = window (c.y, 1, wy);\n"
+                    "        float expr = 0.0;\n"
+                    "        for (int b = 0; b < 8; ++b) {\n"
+                    "            if (wy[b] == 0.0) { continue; }\n"
+                    "            float rowsum = 0.0;\n"
+                    "            for (int a = 0; a < 8; ++a) {\n"
+                    "                if (wx[a] != 0.0) { rowsum += wx[a] * texelFetch (img, ivec2 (x0 + a, y0 + b), 0).r; }\n"
+                    "            }\n"
+                    "            expr += wy[b] * rowsum;\n"
+                    "        }\n"
+                    "        outv[i] = expr;\n"
+                    "        atomicMax (group_max, ordered (expr));\n"
+                    "    }\n"
+                    "    barrier();\n"
+                    "    if (gl_LocalInvocationIndex == 0u) { atomicMax (maxbits, group_max); }\n"
+                    "}\n");
+
+                image_resampler<glver>::load (this->normalise_prog, h
+                    + "uniform float flat_value;\n"
+                    "uniform uint is_flat;\n"
+                    "float unordered (uint u) { return uintBitsToFloat ((u & 0x80000000u) != 0u ? (u & 0x7fffffffu) : ~u); }\n"
+                    "void main()\n"
+                    "{\n"
+                    "    uint i = gl_GlobalInvocationID.x;\n"
+                    "    if (i >= n) { return; }\n"
+                    "    outv[i] = is_flat != 0u ? flat_value : outv[i] / unordered (maxbits);\n"
+                    "}\n");
+            }
+
+            //! The number of points
+            unsigned int n = 0;
+            //! The points (n vec2), the result (n floats) and its maximum (one ordered uint)
+            GLuint centres_ssbo = 0;
+            GLuint out_ssbo = 0;
+            GLuint max_ssbo = 0;
+            //! The image texture and its size
+            GLuint texture = 0;
+            morph::vec<unsigned int, 2> image_pixelsz = { 0u, 0u };
+            //! True if every pixel of the current image has the value flat_value
+            bool flat = false;
+            float flat_value = 0.0f;
+
+            morph::gl::compute_shaderprog<glver> resample_prog;
+            morph::gl::compute_shaderprog<glver> normalise_prog;
+        };
+
+    } // namespace gl
+} // namespace morph
@@ -0,0 +1,658 @@
+#pragma once
+
+/*
+ * Parallel building blocks for GL compute: prefix scan, reductions, radix sort and histogram.
+ *
+ * Each operation works on SSBOs that client code already has (it takes their GL names) and
+ * leaves its results in GPU memory, except for the reductions, which return a single value.
+ * The compute programs are compiled on first use and kept for the lifetime of the primitives
+ * object, as are the scratch buffers that the multi-pass operations need.
+ *
+ * Note: You have to include a header like gl3.h or glext.h etc for the GL types and
+ * functions BEFORE including this file. OpenGL 4.3 or OpenGL 3.1 ES is required.
+ */
+
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <morph/range.h>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+
+namespace morph {
+    namespace gl {
+
+        /*!
+         * GPU scan, reduce, sort and histogram on existing SSBOs.
+         *
+         *   morph::gl::primitives<morph::gl::version_4_5> prim;
+         *   prim.exclusive_scan<unsigned int> (counts_ssbo, offsets_ssbo, n);
+         *   float total = prim.sum<float> (data_ssbo, n);
+         *   prim.sort (cell_ids_ssbo, n, particle_idx_ssbo);
+         *
+         * The scan is Blelloch's work-efficient up-sweep/down-sweep scan within each work group,
+         * with the block sums scanned recursively. The sort is a least significant digit radix
+         * sort, four bits per pass. The histogram accumulates in shared memory with atomics and
+         * then adds each work group's counts into the output.
+         *
+         * Data are float, int or unsigned int (sort keys and values are unsigned int). One
+         * dispatch covers at most 65535 work groups, so scans and reductions take up to
+         * 2 * wg * 65535 elements and sort up to wg * 65535. A GL context must be current whenever
+         * a member function is called, including the destructor.
+         */
+        template <int glver>
+        struct primitives
+        {
+            //! Work group size. OpenGL ES 3.1 only guarantees 128 invocations per work group.
+            static constexpr unsigned int wg = morph::gl::version::gles (glver) ? 128u : 256u;
+            //! The largest number of bins that histogram() counts in shared memory
+            static constexpr unsigned int max_shared_bins = 1024u;
+
+            primitives() {}
+            ~primitives()
+            {
+                for (auto& b : this->scratch_bufs) { glDeleteBuffers (1, &b.second.first); }
+            }
+            primitives (const primitives&) = delete;
+            primitives& operator= (const primitives&) = delete;
+
+            //! out[i] = in[0] + ... + in[i-1], out[0] = 0. \a in and \a out may be the same buffer.
+            template <typename T>
+            void exclusive_scan (const GLuint in, const GLuint out, const unsigned int n)
+            {
+                this->scan<T> (in, out, n, false, 0);
+            }
+
+            //! out[i] = in[0] + ... + in[i]. \a in and \a out may be the same buffer.
+            template <typename T>
+            void inclusive_scan (const GLuint in, const GLuint out, const unsigned int n)
+            {
+                this->scan<T> (in, out, n, true, 0);
+            }
+
+            //! The sum of the first n elements of the buffer \a data
+            template <typename T>
+            T sum (const GLuint data, const unsigned int n)
+            {
+                if (n == 0) { return T{0}; }
+                return this->reduce<T> ("sum", data, n);
+            }
+
+            //! The minimum of the first n elements of \a data
+            template <typename T>
+            T min (const GLuint data, const unsigned int n)
+            {
+                if (n == 0) { throw std::runtime_error ("morph::gl::primitives::min: no data"); }
+                return this->reduce<T> ("min", data, n);
+            }
+
+            //! The maximum of the first n elements of \a data
+            template <typename T>
+            T max (const GLuint data, const unsigned int n)
+            {
+                if (n == 0) { throw std::runtime_error ("morph::gl::primitives::max: no data"); }
+                return this->reduce<T> ("max", data, n);
+            }
+
+            //! The index of the (first) maximum of the first n elements of \a data
+            template <typename T>
+            unsigned int argmax (const GLuint data, const unsigned int n)
+            {
+                if (n == 0) { throw std::runtime_error ("morph::gl::primitives::argmax: no data"); }
+                GLuint src = data;
+                unsigned int m = n;
+                bool first = true;
+                int slot = slot_reduce;
+                while (first || m > 1u) {
+                    const unsigned int ngrps = this->groups (m, 2u * wg);
+                    const GLuint dst = this->scratch (slot, ngrps * 2u * sizeof (unsigned int));
+                    compute_shaderprog<glver>& p = this->program<T> (first ? "argmax_first" : "argmax");
+                    p.use();
+                    p.template set_uniform<unsigned int> ("n", m);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, src);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, dst);
+                    p.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                    src = dst;
+                    m = ngrps;
+                    first = false;
+                    slot = (slot == slot_reduce ? slot_reduce + 1 : slot_reduce);
+                }
+                // The buffer holds (value, index) pairs; the index is the second word
+                unsigned int pair[2] = { 0u, 0u };
+                this->read_back (src, pair, sizeof (pair));
+                return pair[1];
+            }
+
+            /*!
+             * Sort the first n unsigned int keys in the buffer \a keys into ascending order. If
+             * \a values is not 0, it is a buffer of n unsigned ints (such as indices) that are
+             * moved along with the keys. The sort is stable. Sorting with values uses five
+             * storage blocks in one program, which some OpenGL ES devices lack.
+             */
+            void sort (const GLuint keys, const unsigned int n, const GLuint values = 0)
+            {
+                if (n < 2u) { return; }
+                const unsigned int ngrps = this->groups (n, wg);
+                const unsigned int ncounts = 16u * ngrps;
+                const GLuint counts = this->scratch (slot_sort_counts, ncounts * sizeof (unsigned int));
+                GLuint k_src = keys;
+                GLuint k_dst = this->scratch (slot_sort_keys, n * sizeof (unsigned int));
+                GLuint v_src = values;
+                GLuint v_dst = values ? this->scratch (slot_sort_values, n * sizeof (unsigned int)) : 0;
+                compute_shaderprog<glver>& hist = this->program<unsigned int> ("radix_count");
+                compute_shaderprog<glver>& scat = this->program<unsigned int> (values ? "radix_scatter_kv" : "radix_scatter");
+                // Eight passes, so the result ends up back in keys (and values)
+                for (unsigned int shift = 0u; shift < 32u; shift += 4u) {
+                    hist.use();
+                    hist.template set_uniform<unsigned int> ("n", n);
+                    hist.template set_uniform<unsigned int> ("shift", shift);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, k_src);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, counts);
+                    hist.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+
+                    // counts is digit-major, so its exclusive scan gives each (digit, group) its
+                    // first place in the output
+                    this->scan<unsigned int> (counts, counts, ncounts, false, 0);
+
+                    scat.use();
+                    scat.template set_uniform<unsigned int> ("n", n);
+                    scat.template set_uniform<unsigned int> ("shift", shift);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, k_src);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, k_dst);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, counts);
+                    if (values) {
+                        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, v_src);
+                        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, v_dst);
+                    }
+                    scat.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                    std::swap (k_src, k_dst);
+                    std::swap (v_src, v_dst);
+                }
+            }
+
+            /*!
+             * Count the first n floats of \a data into \a nbins equal bins spanning \a datarange,
+             * writing nbins unsigned ints to the buffer \a bins. As in morph::histo, a value equal
+             * to datarange.max goes in the last bin; values outside datarange are not counted. If
+             * \a accumulate, the counts are added to those already in \a bins.
+             */
+            void histogram (const GLuint data, const unsigned int n, const GLuint bins, const unsigned int nbins,
+                            const morph::range<float>& datarange, const bool accumulate = false)
+            {
+                if (nbins == 0u) { return; }
+                if (!accumulate) {
+                    std::vector<unsigned int> zeros (nbins, 0u);
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, bins);
+                    glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, nbins * sizeof (unsigned int), zeros.data());
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                }
+                if (n == 0u) { return; }
+                // A bounded number of work groups, each striding through the data, so that the
+                // per-group counts are flushed to the output only a few times
+                const unsigned int ngrps = std::min (this->groups (n, wg), 256u);
+                compute_shaderprog<glver>& p = this->program<float> (nbins <= max_shared_bins ? "histogram" : "histogram_global");
+                p.use();
+                p.template set_uniform<unsigned int> ("n", n);
+                p.template set_uniform<unsigned int> ("nbins", nbins);
+                p.template set_uniform<float> ("dmin", datarange.min);
+                p.template set_uniform<float> ("dspan", datarange.span());
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, data);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, bins);
+                p.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+
+        private:
+            // Scratch buffer slots. Each level of a scan has its own slot from slot_scan upwards.
+            static constexpr int slot_scan = 0;
+            static constexpr int slot_reduce = 32;
+            static constexpr int slot_sort_counts = 40;
+            static constexpr int slot_sort_keys = 41;
+            static constexpr int slot_sort_values = 42;
+
+            // The GLSL name of T
+            template <typename T>
+            static constexpr const char* glsl_type()
+            {
+                if constexpr (std::is_same_v<T, float>) {
+                    return "float";
+                } else if constexpr (std::is_same_v<T, int>) {
+                    return "int";
+                } else if constexpr (std::is_same_v<T, unsigned int>) {
+                    return "uint";
+                } else {
+                    []<bool flag = false>() { static_assert(flag, "morph::gl::primitives supports float, int and unsigned int"); }();
+                    return "";
+                }
+            }
+
+            // The number of work groups to cover n elements with per_group elements each
+            unsigned int groups (const unsigned int n, const unsigned int per_group) const
+            {
+                const unsigned int g = (n + per_group - 1u) / per_group;
+                // The minimum of GL_MAX_COMPUTE_WORK_GROUP_COUNT in x
+                if (g > 65535u) { throw std::runtime_error ("morph::gl::primitives: too many elements for one dispatch"); }
+                return g;
+            }
+
+            // A scratch buffer of at least sz bytes in the given slot
+            GLuint scratch (const int slot, const std::size_t sz)
+            {
+                std::pair<GLuint, std::size_t>& b = this->scratch_bufs[slot];
+                if (b.first == 0) { glGenBuffers (1, &b.first); }
+                if (b.second < sz) {
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, b.first);
+                    glBufferData (GL_SHADER_STORAGE_BUFFER, sz, nullptr, GL_DYNAMIC_COPY);
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                    b.second = sz;
+                }
+                return b.first;
+            }
+
+            // Copy sz bytes from the start of buf to dst
+            void read_back (const GLuint buf, void* dst, const std::size_t sz)
+            {
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, buf);
+                const void* p = glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, sz, GL_MAP_READ_BIT);
+                if (p != nullptr) { std::memcpy (dst, p, sz); }
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            // Scan level: scan blocks of 2wg elements, then (recursively) scan the block sums and
+            // add them back to each block
+            template <typename T>
+            void scan (const GLuint in, const GLuint out, const unsigned int n, const bool inclusive, const int level)
+            {
+                if (n == 0u) { return; }
+                const unsigned int nblocks = this->groups (n, 2u * wg);
+                const GLuint sums = this->scratch (slot_scan + level, nblocks * sizeof (T));
+                compute_shaderprog<glver>& p = this->program<T> (inclusive ? "scan_inclusive" : "scan_exclusive");
+                p.use();
+                p.template set_uniform<unsigned int> ("n", n);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, in);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, out);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, sums);
+                p.dispatch (nblocks, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                if (nblocks > 1u) {
+                    this->scan<T> (sums, sums, nblocks, false, level + 1);
+                    compute_shaderprog<glver>& a = this->program<T> ("scan_add");
+                    a.use();
+                    a.template set_uniform<unsigned int> ("n", n);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, out);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, sums);
+                    a.dispatch (this->groups (n, wg), 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+            }
+
+            // Tree reduction, one value per block of 2wg elements per pass, until one is left
+            template <typename T>
+            T reduce (const std::string& op, const GLuint data, const unsigned int n)
+            {
+                compute_shaderprog<glver>& p = this->program<T> (op);
+                GLuint src = data;
+                unsigned int m = n;
+                int slot = slot_reduce;
+                bool first = true;
+                while (first || m > 1u) {
+                    const unsigned int ngrps = this->groups (m, 2u * wg);
+                    const GLuint dst = this->scratch (slot, ngrps * sizeof (T));
+                    p.use();
+                    p.template set_uniform<unsigned int> ("n", m);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, src);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, dst);
+                    p.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                    src = dst;
+                    m = ngrps;
+                    first = false;
+                    slot = (slot == slot_reduce ? slot_reduce + 1 : slot_reduce);
+                }
+                T result = T{0};
+                this->read_back (src, &result, sizeof (T));
+                return result;
+            }
+
+            // The program for kernel for type T, compiled on first use
+            template <typename T>
+            compute_shaderprog<glver>& program (const std::string& kernel)
+            {
+                const std::string key = kernel + "_" + glsl_type<T>();
+                auto pi = this->programs.find (key);
+                if (pi != this->programs.end()) { return *pi->second; }
+
+                std::string src = morph::gl::version::shaderpreamble (glver);
+                src += "precision highp float;\nprecision highp int;\n";
+                src += "#define WG " + std::to_string (wg) + "\n";
+                src += "#define WGU " + std::to_string (wg) + "u\n";
+                src += "#define MAX_SHARED_BINS " + std::to_string (max_shared_bins) + "\n";
+                src += std::string ("#define T ") + glsl_type<T>() + "\n";
+                if constexpr (std::is_same_v<T, float>) {
+                    src += "#define T_LOWEST uintBitsToFloat(0xff800000u)\n#define T_HIGHEST uintBitsToFloat(0x7f800000u)\n";
+                } else if constexpr (std::is_same_v<T, int>) {
+                    src += "#define T_LOWEST (-2147483647 - 1)\n#define T_HIGHEST 2147483647\n";
+                } else {
+                    src += "#define T_LOWEST 0u\n#define T_HIGHEST 0xffffffffu\n";
+                }
+                if (kernel == "scan_exclusive") {
+                    src += scan_shader;
+                } else if (kernel == "scan_inclusive") {
+                    src += "#define INCLUSIVE 1\n";
+                    src += scan_shader;
+                } else if (kernel == "scan_add") {
+                    src += scan_add_shader;
+                } else if (kernel == "sum") {
+                    src += "#define OP(a, b) ((a) + (b))\n#define IDENTITY T(0)\n";
+                    src += reduce_shader;
+                } else if (kernel == "min") {
+                    src += "#define OP(a, b) min((a), (b))\n#define IDENTITY T_HIGHEST\n";
+                    src += reduce_shader;
+                } else if (kernel == "max") {
+                    src += "#define OP(a, b) max((a), (b))\n#define IDENTITY T_LOWEST\n";
+                    src += reduce_shader;
+                } else if (kernel == "argmax_first") {
+                    src += "#define FIRST_PASS 1\n";
+                    src += argmax_shader;
+                } else if (kernel == "argmax") {
+                    src += argmax_shader;
+                } else if (kernel == "radix_count") {
+                    src += radix_count_shader;
+                } else if (kernel == "radix_scatter") {
+                    src += radix_scatter_shader;
+                } else if (kernel == "radix_scatter_kv") {
+                    src += "#define WITH_VALUES 1\n";
+                    src += radix_scatter_shader;
+                } else if (kernel == "histogram") {
+                    src += histogram_shader;
+                } else if (kernel == "histogram_global") {
+                    src += "#define GLOBAL_BINS 1\n";
+                    src += histogram_shader;
+                } else {
+                    throw std::runtime_error ("morph::gl::primitives: unknown kernel " + kernel);
+                }
+
+                std::vector<morph::gl::ShaderInfo> shaders = { {GL_COMPUTE_SHADER, "", src, 0 } };
+                auto p = std::make_unique<compute_shaderprog<glver>> (shaders);
+                compute_shaderprog<glver>& rtn = *p;
+                this->programs[key] = std::move (p);
+                return rtn;
+            }
+
+            // Blelloch scan of one block of 2WG elements per work group into data_out. The block
+            // totals go to block_sums.
+            static constexpr const char* scan_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "layout (std430, binding = 0) buffer InBlock { T data_in[]; };\n"
+            "layout (std430, binding = 1) buffer OutBlock { T data_out[]; };\n"
+            "layout (std430, binding = 2) buffer SumBlock { T block_sums[]; };\n"
+            "uniform uint n;\n"
+            "shared T temp[2 * WG];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    uint base = gl_WorkGroupID.x * 2u * WGU;\n"
+            "    uint ai = t;\n"
+            "    uint bi = t + WGU;\n"
+            "    T xa = (base + ai < n) ? data_in[base + ai] : T(0);\n"
+            "    T xb = (base + bi < n) ? data_in[base + bi] : T(0);\n"
+            "    temp[ai] = xa;\n"
+            "    temp[bi] = xb;\n"
+            "    uint offset = 1u;\n"
+            "    for (uint d = WGU; d > 0u; d >>= 1u) {\n" // up-sweep
+            "        memoryBarrierShared(); barrier();\n"
+            "        if (t < d) {\n"
+            "            uint a = offset * (2u * t + 1u) - 1u;\n"
+            "            uint b = offset * (2u * t + 2u) - 1u;\n"
+            "            temp[b] += temp[a];\n"
+            "        }\n"
+            "        offset <<= 1u;\n"
+            "    }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "    if (t == 0u) {\n"
+            "        block_sums[gl_WorkGroupID.x] = temp[2u * WGU - 1u];\n"
+            "        temp[2u * WGU - 1u] = T(0);\n"
+            "    }\n"
+            "    for (uint d = 1u; d < 2u * WGU; d <<= 1u) {\n" // down-sweep
+            "        offset >>= 1u;\n"
+            "        memoryBarrierShared(); barrier();\n"
+            "        if (t < d) {\n"
+            "            uint a = offset * (2u * t + 1u) - 1u;\n"
+            "            uint b = offset * (2u * t + 2u) - 1u;\n"
+            "            T x = temp[a];\n"
+            "            temp[a] = temp[b];\n"
+            "            temp[b] += x;\n"
+            "        }\n"
+            "    }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "#ifdef INCLUSIVE\n"
+            "    if (base + ai < n) { data_out[base + ai] = temp[ai] + xa; }\n"
+            "    if (base + bi < n) { data_out[base + bi] = temp[bi] + xb; }\n"
+            "#else\n"
+            "    if (base + ai < n) { data_out[base + ai] = temp[ai]; }\n"
+            "    if (base + bi < n) { data_out[base + bi] = temp[bi]; }\n"
+            "#endif\n"
+            "}\n";
+
+            // Add the scanned block sums to each element of their blocks
+            static constexpr const char* scan_add_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "layout (std430, binding = 1) buffer OutBlock { T data_out[]; };\n"
+            "layout (std430, binding = 2) readonly buffer SumBlock { T block_sums[]; };\n"
+            "uniform uint n;\n"
+            "void main()\n"
+            "{\n"
+            "    uint i = gl_GlobalInvocationID.x;\n"
+            "    if (i < n) { data_out[i] += block_sums[i / (2u * WGU)]; }\n"
+            "}\n";
+
+            // Reduce each block of 2WG elements to one with OP
+            static constexpr const char* reduce_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "layout (std430, binding = 0) readonly buffer InBlock { T data_in[]; };\n"
+            "layout (std430, binding = 1) writeonly buffer OutBlock { T data_out[]; };\n"
+            "uniform uint n;\n"
+            "shared T part[WG];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    uint i = gl_WorkGroupID.x * 2u * WGU + t;\n"
+            "    T a = (i < n) ? data_in[i] : IDENTITY;\n"
+            "    T b = (i + WGU < n) ? data_in[i + WGU] : IDENTITY;\n"
+            "    part[t] = OP(a, b);\n"
+            "    for (uint s = WGU / 2u; s > 0u; s >>= 1u) {\n"
+            "        memoryBarrierShared(); barrier();\n"
+            "        if (t < s) { part[t] = OP(part[t], part[t + s]); }\n"
+            "    }\n"
+            "    if (t == 0u) { data_out[gl_WorkGroupID.x] = part[0]; }\n"
+            "}\n";
+
+            // Reduce to (value, index) pairs of the first maximum in each block of 2WG
+            static constexpr const char* argmax_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "struct Pair { T v; uint i; };\n"
+            "#ifdef FIRST_PASS\n"
+            "layout (std430, binding = 0) readonly buffer InBlock { T data_in[]; };\n"
+            "#else\n"
+            "layout (std430, binding = 0) readonly buffer InBlock { Pair pairs_in[]; };\n"
+            "#endif\n"
+            "layout (std430, binding = 1) writeonly buffer OutBlock { Pair pairs_out[]; };\n"
+            "uniform uint n;\n"
+            "shared T sv[WG];\n"
+            "shared uint si[WG];\n"
+            "void load (uint j, out T v, out uint idx)\n"
+            "{\n"
+            "    v = T_LOWEST;\n"
+            "    idx = 0xffffffffu;\n"
+            "    if (j < n) {\n"
+            "#ifdef FIRST_PASS\n"
+            "        v = data_in[j];\n"
+            "        idx = j;\n"
+            "#else\n"
+            "        v = pairs_in[j].v;\n"
+            "        idx = pairs_in[j].i;\n"
+            "#endif\n"
+            "    }\n"
+            "}\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    uint j = gl_WorkGroupID.x * 2u * WGU + t;\n"
+            "    T va; uint ia; T vb; uint ib;\n"
+            "    load (j, va, ia);\n"
+            "    load (j + WGU, vb, ib);\n"
+            "    if (vb > va || (vb == va && ib < ia)) { va = vb; ia = ib; }\n"
+            "    sv[t] = va;\n"
+            "    si[t] = ia;\n"
+            "    for (uint s = WGU / 2u; s > 0u; s >>= 1u) {\n"
+            "        memoryBarrierShared(); barrier();\n"
+            "        if (t < s) {\n"
+            "            T v2 = sv[t + s];\n"
+            "            uint i2 = si[t + s];\n"
+            "            if (v2 > sv[t] || (v2 == sv[t] && i2 < si[t])) { sv[t] = v2; si[t] = i2; }\n"
+            "        }\n"
+            "    }\n"
+            "    if (t == 0u) { pairs_out[gl_WorkGroupID.x].v = sv[0]; pairs_out[gl_WorkGroupID.x].i = si[0]; }\n"
+            "}\n";
+
+            // Count the 4 bit digits at shift in each block of WG keys. The counts are written
+            // digit-major: counts[digit * groups + group].
+            static constexpr const char* radix_count_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "layout (std430, binding = 0) readonly buffer KeyBlock { uint keys_in[]; };\n"
+            "layout (std430, binding = 2) writeonly buffer CountBlock { uint counts[]; };\n"
+            "uniform uint n;\n"
+            "uniform uint shift;\n"
+            "shared uint local_counts[16];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    if (t < 16u) { local_counts[t] = 0u; }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "    uint i = gl_GlobalInvocationID.x;\n"
+            "    if (i < n) { atomicAdd (local_counts[(keys_in[i] >> shift) & 15u], 1u); }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "    if (t < 16u) { counts[t * gl_NumWorkGroups.x + gl_WorkGroupID.x] = local_counts[t]; }\n"
+            "}\n";
+
+            // Sort each block of WG keys by their digit at shift (four stable one bit splits), then
+            // write each key to its scanned offset plus its rank among the block's keys with the
+            // same digit. Padding keys are all ones, so they sort to the end of the last block.
+            static constexpr const char* radix_scatter_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "layout (std430, binding = 0) readonly buffer KeyInBlock { uint keys_in[]; };\n"
+            "layout (std430, binding = 1) writeonly buffer KeyOutBlock { uint keys_out[]; };\n"
+            "layout (std430, binding = 2) readonly buffer OffsetBlock { uint offsets[]; };\n"
+            "#ifdef WITH_VALUES\n"
+            "layout (std430, binding = 3) readonly buffer ValInBlock { uint vals_in[]; };\n"
+            "layout (std430, binding = 4) writeonly buffer ValOutBlock { uint vals_out[]; };\n"
+            "#endif\n"
+            "uniform uint n;\n"
+            "uniform uint shift;\n"
+            "shared uint sk[WG];\n"
+            "#ifdef WITH_VALUES\n"
+            "shared uint sv[WG];\n"
+            "#endif\n"
+            "shared uint zeros[WG];\n"
+            "shared uint digit_start[16];\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "    uint base = gl_WorkGroupID.x * WGU;\n"
+            "    uint nvalid = min (WGU, n - base);\n"
+            "    uint key = (t < nvalid) ? keys_in[base + t] : 0xffffffffu;\n"
+            "#ifdef WITH_VALUES\n"
+            "    uint val = (t < nvalid) ? vals_in[base + t] : 0u;\n"
+            "#endif\n"
+            "    for (uint b = 0u; b < 4u; ++b) {\n"
+            "        uint bit = (key >> (shift + b)) & 1u;\n"
+            "        zeros[t] = 1u - bit;\n"
+            "        memoryBarrierShared(); barrier();\n"
+            "        for (uint off = 1u; off < WGU; off <<= 1u) {\n" // inclusive scan of zeros
+            "            uint x = (t >= off) ? zeros[t - off] : 0u;\n"
+            "            memoryBarrierShared(); barrier();\n"
+            "            zeros[t] += x;\n"
+            "            memoryBarrierShared(); barrier();\n"
+            "        }\n"
+            "        uint zeros_to_t = zeros[t];\n"
+            "        uint total_zeros = zeros[WGU - 1u];\n"
+            "        uint pos = (bit == 0u) ? zeros_to_t - 1u : total_zeros + t - zeros_to_t;\n"
+            "        sk[pos] = key;\n"
+            "#ifdef WITH_VALUES\n"
+            "        sv[pos] = val;\n"
+            "#endif\n"
+            "        memoryBarrierShared(); barrier();\n"
+            "        key = sk[t];\n"
+            "#ifdef WITH_VALUES\n"
+            "        val = sv[t];\n"
+            "#endif\n"
+            "        memoryBarrierShared(); barrier();\n"
+            "    }\n"
+            "    uint digit = (key >> shift) & 15u;\n"
+            "    if (t < 16u) { digit_start[t] = 0u; }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "    if (t == 0u || digit != ((sk[t - 1u] >> shift) & 15u)) { digit_start[digit] = t; }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "    if (t < nvalid) {\n"
+            "        uint dst = offsets[digit * gl_NumWorkGroups.x + gl_WorkGroupID.x] + t - digit_start[digit];\n"
+            "        keys_out[dst] = key;\n"
+            "#ifdef WITH_VALUES\n"
+            "        vals_out[dst] = val;\n"
+            "#endif\n"
+            "    }\n"
+            "}\n";
+
+            // Bin floats into nbins bins over [dmin, dmin + dspan], counting in shared memory
+            // (unless GLOBAL_BINS) and adding each group's counts to bins at the end
+            static constexpr const char* histogram_shader =
+            "layout (local_size_x = WG, local_size_y = 1, local_size_z = 1) in;\n"
+            "layout (std430, binding = 0) readonly buffer DataBlock { float data[]; };\n"
+            "layout (std430, binding = 1) buffer BinBlock { uint bins[]; };\n"
+            "uniform uint n;\n"
+            "uniform uint nbins;\n"
+            "uniform float dmin;\n"
+            "uniform float dspan;\n"
+            "#ifndef GLOBAL_BINS\n"
+            "shared uint local_bins[MAX_SHARED_BINS];\n"
+            "#endif\n"
+            "void main()\n"
+            "{\n"
+            "    uint t = gl_LocalInvocationID.x;\n"
+            "#ifndef GLOBAL_BINS\n"
+            "    for (uint b = t; b < nbins; b += WGU) { local_bins[b] = 0u; }\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "#endif\n"
+            "    for (uint i = gl_GlobalInvocationID.x; i < n; i += gl_NumWorkGroups.x * WGU) {\n"
+            "        float p = (data[i] - dmin) / dspan;\n"
+            "        if (p >= 0.0 && p <= 1.0) {\n"
+            "            uint b = min (uint (floor (p * float (nbins))), nbins - 1u);\n"
+            "#ifdef GLOBAL_BINS\n"
+            "            atomicAdd (bins[b], 1u);\n"
+            "#else\n"
+            "            atomicAdd (local_bins[b], 1u);\n"
+            "#endif\n"
+            "        }\n"
+            "    }\n"
+            "#ifndef GLOBAL_BINS\n"
+            "    memoryBarrierShared(); barrier();\n"
+            "    for (uint b = t; b < nbins; b += WGU) {\n"
+            "        if (local_bins[b] > 0u) { atomicAdd (bins[b], local_bins[b]); }\n"
+            "    }\n"
+            "#endif\n"
+            "}\n";
+
+            // Compiled programs by kernel and type
+            std::map<std::string, std::unique_ptr<compute_shaderprog<glver>>> programs;
+            // Scratch buffers by slot: GL name and size in bytes
+            std::map<int, std::pair<GLuint, std::size_t>> scratch_bufs;
+        };
+
+    } // namespace gl
+} // namespace morph
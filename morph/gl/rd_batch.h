@@ -0,0 +1,405 @@
+#pragma once
+
+/*
+ * Many small reaction-diffusion models stepped together in one compute shader.
+ *
+ * A parameter sweep often runs hundreds or thousands of instances of the same RD system on
+ * the same small HexGrid, each with its own parameters. One dispatch (or one process) per
+ * model leaves most of a GPU idle; here all the instances share the grid's neighbour SSBO
+ * and are advanced together, one invocation per hex per instance, in a single dispatch per
+ * timestep. The state is interleaved by instance, (hex, instance, field), so that adjacent
+ * invocations (the same hex in neighbouring instances) read adjacent memory, for their own
+ * values and for their neighbours'. Each instance's parameters are a row of nparams floats.
+ *
+ * The client supplies the reaction terms as a GLSL function
+ *
+ *   void derivs (uint m, float u[NF], float lap[NF], out float du[NF]);
+ *
+ * which sets du/dt for instance m from the values u of the NF fields in one hex and their
+ * Laplacians lap, including the diffusion terms. param (m, i) returns instance m's i-th
+ * parameter. Boundary hexes use the ghost stencil (a missing neighbour is the hex itself),
+ * so there is no flux through the edge.
+ *
+ * rd_batch steps with forward Euler, one dispatch per timestep, unlike the CPU RD_Base models
+ * (RD_Schnakenberg and the like), which integrate with RK4. Euler is first order, and for
+ * the diffusion terms it is stable only for dt < d^2 / (3 D) with D the largest diffusion
+ * constant, so choose a smaller dt than the CPU model would use and do not expect results
+ * to match it step for step. Use morph::gl::rd_compute (rd_compute.h) to step one model
+ * with RK4 on the GPU.
+ *
+ * When step() checks (as it does by default) the largest |du/dt| of each instance over its
+ * last timestep is reduced with atomics and read back: ninst uints, not the state. An
+ * instance whose rate has fallen below tolerance is marked converged, and one whose rate is
+ * not finite is marked diverged; both are then frozen and cost only a copy per step.
+ *
+ *   morph::gl::rd_batch<morph::gl::version_4_5> b (hg, 1000, 2, 6);
+ *   b.reaction = "void derivs (uint m, float u[NF], float lap[NF], out float du[NF]) {...}";
+ *   for (unsigned int m = 0; m < 1000; ++m) { b.param (m, 5) = 10.0f + 0.02f * m; }
+ *   b.set_field (m, 0, initial_a); ...
+ *   b.init();         // with a GL context current
+ *   while (b.num_running() > 0 && b.steps < max_steps) { b.step (500); }
+ *   morph::vvec<float> a = b.field (17, 0);
+ *
+ * Note: You have to include a header like gl3.h or glext.h etc for the GL types and
+ * functions BEFORE including this file. OpenGL 4.3 or OpenGL 3.1 ES is required, and a GL
+ * context must be current when init(), step(), fetch() and the destructor are called.
+ */
+
+#include <string>
+#include <vector>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <morph/vvec.h>
+#include <morph/HexGrid.h>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+
+namespace morph {
+    namespace gl {
+
+        //! The state of one instance of an rd_batch
+        enum class rd_status : unsigned int { running = 0, converged = 1, diverged = 2 };
+
+        template <int glver>
+        struct rd_batch
+        {
+            static_assert (morph::gl::version::gles (glver) ? morph::gl::version::minor (glver) >= 1
+                           : (morph::gl::version::major (glver) > 4
+                              || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 3)),
+                           "rd_batch needs compute shaders: OpenGL 4.3 or OpenGL 3.1 ES or later");
+
+            //! Work group size. OpenGL ES 3.1 only guarantees 128 invocations per work group.
+            static constexpr unsigned int wg = morph::gl::version::gles (glver) ? 128u : 256u;
+            //! The most work groups in x of one dispatch that every implementation allows
+            static constexpr unsigned int max_groups_x = 65535u;
+
+            //! The GLSL derivs() function (and anything it needs). Set before init().
+            std::string reaction;
+            //! The timestep
+            float dt = 0.001f;
+            //! An instance is converged when the largest |du/dt| over its hexes and fields falls below this
+            float tolerance = 1e-5f;
+
+            //! Parameters, nparams for each instance, instance by instance
+            morph::vvec<float> params;
+            //! The CPU-side copy of the state, indexed by ((h * ninst) + m) * nfields + f
+            morph::vvec<float> state;
+            //! Each instance's status, from the last check
+            std::vector<rd_status> status;
+            //! The largest |du/dt| of each instance at the last check
+            morph::vvec<float> rate;
+            //! The number of steps taken when each instance converged or diverged (0 while running)
+            std::vector<unsigned long long> settled_at;
+            //! Steps taken since init()
+            unsigned long long steps = 0;
+
+            /*!
+             * Set up ninst instances of an RD system of nfields fields and nparams parameters
+             * on the HexGrid hg. Only CPU-side memory is allocated; no GL context is needed
+             * until init().
+             */
+            rd_batch (const morph::HexGrid& hg, const unsigned int _ninst, const unsigned int _nfields, const unsigned int _nparams)
+                : ninst(_ninst), nfields(_nfields), nparams(_nparams), nhex(static_cast<unsigned int>(hg.num()))
+            {
+                if (this->ninst == 0 || this->nfields == 0) { throw std::runtime_error ("rd_batch: need at least one instance and one field"); }
+                if (hg.d_ne.size() != this->nhex) { throw std::runtime_error ("rd_batch: the HexGrid's d_ vectors must be populated"); }
+                const float d = hg.getd();
+                this->lapnorm = 2.0f / (3.0f * d * d);
+                // The ghost stencil, in the order ne, nne, nnw, nw, nsw, nse of RD_Base
+                const std::vector<int>* nb[6] = { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse };
+                this->nbr.resize (6 * this->nhex);
+                for (unsigned int h = 0; h < this->nhex; ++h) {
+                    for (unsigned int l = 0; l < 6; ++l) {
+                        const int j = (*nb[l])[h];
+                        this->nbr[6 * h + l] = j < 0 ? static_cast<int>(h) : j;
+                    }
+                }
+                this->params.resize (this->ninst * this->nparams, 0.0f);
+                this->state.resize (static_cast<std::size_t>(this->nhex) * this->ninst * this->nfields, 0.0f);
+                this->status.assign (this->ninst, rd_status::running);
+                this->rate.resize (this->ninst, 0.0f);
+                this->settled_at.assign (this->ninst, 0);
+            }
+
+            ~rd_batch()
+            {
+                GLuint bufs[6] = { this->nbr_ssbo, this->state_ssbo[0], this->state_ssbo[1],
+                                   this->param_ssbo, this->status_ssbo, this->rate_ssbo };
+                if (bufs[0] != 0) { glDeleteBuffers (6, bufs); }
+            }
+            rd_batch (const rd_batch&) = delete;
+            rd_batch& operator= (const rd_batch&) = delete;
+
+            //! Instance m's parameter i
+            float& param (const unsigned int m, const unsigned int i) { return this->params[m * this->nparams + i]; }
+
+            //! The CPU-side value of field f of instance m in hex h
+            float& value (const unsigned int m, const unsigned int f, const unsigned int h)
+            {
+                return this->state[(static_cast<std::size_t>(h) * this->ninst + m) * this->nfields + f];
+            }
+
+            //! Set field f of instance m from the nhex values v (before init(), or followed by upload())
+            template <typename C>
+            void set_field (const unsigned int m, const unsigned int f, const C& v)
+            {
+                if (v.size() != this->nhex) { throw std::runtime_error ("rd_batch::set_field: need one value per hex"); }
+                for (unsigned int h = 0; h < this->nhex; ++h) { this->value (m, f, h) = static_cast<float>(v[h]); }
+            }
+
+            //! Field f of instance m, fetched from the GPU if it has stepped since the last fetch
+            morph::vvec<float> field (const unsigned int m, const unsigned int f)
+            {
+                this->fetch();
+                morph::vvec<float> v (this->nhex);
+                for (unsigned int h = 0; h < this->nhex; ++h) { v[h] = this->value (m, f, h); }
+                return v;
+            }
+
+            //! Build the shader and copy the grid, parameters and state to the GPU. Needs a GL context.
+            void init()
+            {
+                if (this->reaction.empty()) { throw std::runtime_error ("rd_batch::init: set the reaction GLSL first"); }
+                if (this->nbr_ssbo == 0) {
+                    this->nbr_ssbo = rd_batch<glver>::make_buffer (this->nbr.size() * sizeof (int), this->nbr.data());
+                    this->state_ssbo[0] = rd_batch<glver>::make_buffer (this->state.size() * sizeof (float), nullptr);
+                    this->state_ssbo[1] = rd_batch<glver>::make_buffer (this->state.size() * sizeof (float), nullptr);
+                    this->param_ssbo = rd_batch<glver>::make_buffer (std::max (this->params.size(), std::size_t{1}) * sizeof (float), nullptr);
+                    this->status_ssbo = rd_batch<glver>::make_buffer (this->ninst * sizeof (GLuint), nullptr);
+                    this->rate_ssbo = rd_batch<glver>::make_buffer (this->ninst * sizeof (GLuint), nullptr);
+                }
+                this->load_shader();
+                this->status.assign (this->ninst, rd_status::running);
+                this->settled_at.assign (this->ninst, 0);
+                this->steps = 0;
+                this->upload();
+            }
+
+            //! Copy params, state and status from the CPU to the GPU
+            void upload()
+            {
+                this->cur = 0;
+                rd_batch<glver>::write_buffer (this->state_ssbo[0], this->state.size() * sizeof (float), this->state.data());
+                if (!this->params.empty()) {
+                    rd_batch<glver>::write_buffer (this->param_ssbo, this->params.size() * sizeof (float), this->params.data());
+                }
+                this->upload_status();
+                this->state_valid = true;
+            }
+
+            /*!
+             * Advance all the running instances by n timesteps, one dispatch each. If check is
+             * true, the last step measures each instance's largest rate, which is read back
+             * (waiting for the GPU) to update status; otherwise nothing is read back.
+             */
+            void step (const unsigned int n, const bool check = true)
+            {
+                if (this->prog.prog_id == 0) { throw std::runtime_error ("rd_batch::step: call init() first"); }
+                if (n == 0) { return; }
+                const unsigned int ngrps = (this->nhex * this->ninst + wg - 1) / wg;
+                const unsigned int ngx = std::min (ngrps, max_groups_x);
+                const unsigned int ngy = (ngrps + ngx - 1) / ngx;
+
+                if (check) {
+                    const std::vector<GLuint> zero (this->ninst, 0u);
+                    rd_batch<glver>::write_buffer (this->rate_ssbo, this->ninst * sizeof (GLuint), zero.data());
+                }
+                this->prog.use();
+                this->prog.set_uniform ("dt", this->dt);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->nbr_ssbo);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->param_ssbo);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, this->status_ssbo);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 5, this->rate_ssbo);
+                for (unsigned int i = 0; i < n; ++i) {
+                    this->prog.set_uniform ("measure", (check && i == n - 1) ? 1u : 0u);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->state_ssbo[this->cur]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->state_ssbo[1 - this->cur]);
+                    // The next step reads, as an SSBO, the state that this one writes
+                    this->prog.dispatch (ngx, ngy, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+                    this->cur = 1 - this->cur;
+                }
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                this->steps += n;
+                this->state_valid = false;
+                if (check) { this->update_status(); }
+            }
+
+            //! Copy the current state back from the GPU, if it has changed since the last fetch
+            void fetch()
+            {
+                if (this->state_valid) { return; }
+                rd_batch<glver>::read_buffer (this->state_ssbo[this->cur], this->state.size() * sizeof (float), this->state.data());
+                this->state_valid = true;
+            }
+
+            //! The number of instances still running
+            unsigned int num_running() const
+            {
+                return static_cast<unsigned int>(std::count (this->status.begin(), this->status.end(), rd_status::running));
+            }
+
+            //! Set every instance running again (for example after changing tolerance)
+            void resume_all()
+            {
+                this->status.assign (this->ninst, rd_status::running);
+                this->settled_at.assign (this->ninst, 0);
+                this->upload_status();
+            }
+
+            unsigned int num_instances() const { return this->ninst; }
+            unsigned int num_fields() const { return this->nfields; }
+            unsigned int num_params() const { return this->nparams; }
+            unsigned int num_hexes() const { return this->nhex; }
+
+            //! The name of the SSBO that holds the current state (interleaved as state)
+            GLuint state_buffer() const { return this->state_ssbo[this->cur]; }
+
+        private:
+            //! Read back the rates measured by the last step and settle the instances that have stopped changing
+            void update_status()
+            {
+                std::vector<GLuint> bits (this->ninst, 0u);
+                rd_batch<glver>::read_buffer (this->rate_ssbo, this->ninst * sizeof (GLuint), bits.data());
+                bool changed = false;
+                for (unsigned int m = 0; m < this->ninst; ++m) {
+                    if (this->status[m] != rd_status::running) { continue; }
+                    // The rates are non-negative, or NaN, so their bits order as uints
+                    this->rate[m] = std::bit_cast<float> (bits[m]);
+                    if (!std::isfinite (this->rate[m])) {
+                        this->status[m] = rd_status::diverged;
+                    } else if (this->rate[m] < this->tolerance) {
+                        this->status[m] = rd_status::converged;
+                    } else {
+                        continue;
+                    }
+                    this->settled_at[m] = this->steps;
+                    changed = true;
+                }
+                if (changed) { this->upload_status(); }
+            }
+
+            void upload_status()
+            {
+                std::vector<GLuint> s (this->ninst);
+                for (unsigned int m = 0; m < this->ninst; ++m) { s[m] = static_cast<GLuint>(this->status[m]); }
+                rd_batch<glver>::write_buffer (this->status_ssbo, this->ninst * sizeof (GLuint), s.data());
+            }
+
+            static GLuint make_buffer (const std::size_t bytes, const void* data)
+            {
+                GLuint name = 0;
+                glGenBuffers (1, &name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_COPY);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                return name;
+            }
+
+            static void write_buffer (const GLuint name, const std::size_t bytes, const void* data)
+            {
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, bytes, data);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            static void read_buffer (const GLuint name, const std::size_t bytes, void* dst)
+            {
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                const void* gpu = glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                if (gpu != nullptr) { std::copy_n (static_cast<const unsigned char*>(gpu), bytes, static_cast<unsigned char*>(dst)); }
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            void load_shader()
+            {
+                std::string src = morph::gl::version::shaderpreamble (glver);
+                if constexpr (morph::gl::version::gles (glver)) { src += "precision highp float;\nprecision highp int;\n"; }
+                src += "layout (local_size_x = " + std::to_string (wg) + ", local_size_y = 1, local_size_z = 1) in;\n"
+                "#define NF " + std::to_string (this->nfields) + "\n"
+                "#define NP " + std::to_string (std::max (this->nparams, 1u)) + "u\n"
+                "uniform uint ninst;\n"
+                "uniform uint nhex;\n"
+                "uniform float dt;\n"
+                "uniform float lapnorm;\n"
+                "uniform uint measure;\n"
+                "layout (std430, binding = 0) readonly buffer Nbr { int nbr[]; };\n"
+                "layout (std430, binding = 1) readonly buffer StateIn { float u_in[]; };\n"
+                "layout (std430, binding = 2) writeonly buffer StateOut { float u_out[]; };\n"
+                "layout (std430, binding = 3) readonly buffer Params { float params[]; };\n"
+                "layout (std430, binding = 4) readonly buffer Status { uint status[]; };\n"
+                "layout (std430, binding = 5) buffer Rate { uint rate[]; };\n"
+                "float param (uint m, uint i) { return params[m * NP + i]; }\n"
+                + this->reaction + "\n"
+                "void main()\n"
+                "{\n"
+                "    uint gid = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x;\n"
+                "    if (gid >= ninst * nhex) { return; }\n"
+                "    uint m = gid % ninst;\n"
+                "    uint h = gid / ninst;\n"
+                "    uint o = gid * uint(NF);\n"
+                "    if (status[m] != 0u) {\n"
+                "        for (int f = 0; f < NF; ++f) { u_out[o + uint(f)] = u_in[o + uint(f)]; }\n"
+                "        return;\n"
+                "    }\n"
+                "    float u[NF];\n"
+                "    float lap[NF];\n"
+                "    for (int f = 0; f < NF; ++f) { u[f] = u_in[o + uint(f)]; lap[f] = -6.0 * u[f]; }\n"
+                "    for (uint l = 0u; l < 6u; ++l) {\n"
+                "        uint on = (uint(nbr[6u * h + l]) * ninst + m) * uint(NF);\n"
+                "        for (int f = 0; f < NF; ++f) { lap[f] += u_in[on + uint(f)]; }\n"
+                "    }\n"
+                "    for (int f = 0; f < NF; ++f) { lap[f] *= lapnorm; }\n"
+                "    float du[NF];\n"
+                "    derivs (m, u, lap, du);\n"
+                "    float r = 0.0;\n"
+                "    for (int f = 0; f < NF; ++f) {\n"
+                "        u_out[o + uint(f)] = u[f] + dt * du[f];\n"
+                "        r = max (r, abs (du[f]));\n"
+                "        if (isnan (du[f]) || isinf (du[f])) { r = uintBitsToFloat (0x7fc00000u); }\n"
+                "    }\n"
+                "    if (measure != 0u) { atomicMax (rate[m], floatBitsToUint (r)); }\n"
+                "}\n";
+
+                // No file name, so that the compiled-in source is always used
+                std::vector<morph::gl::ShaderInfo> shaders = { {GL_COMPUTE_SHADER, "", src, 0 } };
+                this->prog.load_shaders (shaders);
+                if (this->prog.prog_id == 0) { throw std::runtime_error ("rd_batch: failed to build the compute shader"); }
+                this->prog.use();
+                this->prog.set_uniform ("ninst", this->ninst);
+                this->prog.set_uniform ("nhex", this->nhex);
+                this->prog.set_uniform ("lapnorm", this->lapnorm);
+            }
+
+            unsigned int ninst = 0;
+            unsigned int nfields = 0;
+            unsigned int nparams = 0;
+            unsigned int nhex = 0;
+            //! 2 / (3 d^2) for hex to hex distance d
+            float lapnorm = 0.0f;
+            //! The ghost stencil neighbour indices, 6 per hex
+            std::vector<int> nbr;
+
+            GLuint nbr_ssbo = 0;
+            //! state_ssbo[cur] holds the current state
+            GLuint state_ssbo[2] = { 0, 0 };
+            GLuint param_ssbo = 0;
+            GLuint status_ssbo = 0;
+            GLuint rate_ssbo = 0;
+            unsigned int cur = 0;
+            bool state_valid = true;
+            morph::gl::compute_shaderprog<glver> prog;
+        };
+
+    } // namespace gl
+} // namespace morph
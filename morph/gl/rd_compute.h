@@ -0,0 +1,342 @@
+#pragma once
+
+/*
+ * A GPU backend for reaction-diffusion models of the RD_Base kind: the fields of one model on
+ * a HexGrid, stepped in compute shaders.
+ *
+ * The grid's ghost stencil neighbour indices (from the d_ vectors), the state fields and the
+ * parameters are uploaded to SSBOs once, by init(). step (n) then advances the model n
+ * timesteps without any transfer between CPU and GPU; the state is read back only when
+ * fetch() or field() is called, to save or to render it. State is stored field by field, each
+ * field in hex order, as in the d_ vectors of the HexGrid.
+ *
+ * The client supplies the reaction terms as a GLSL function
+ *
+ *   void derivs (float u[NF], float lap[NF], out float du[NF]);
+ *
+ * which sets du/dt from the values u of the NF fields in one hex and their Laplacians lap,
+ * including the diffusion terms. param (i) returns the i-th parameter. As in RD_Base,
+ * boundary hexes use the ghost stencil (a missing neighbour is the hex itself), so there is
+ * no flux through the edge.
+ *
+ * By default a step is the classical 4th order Runge-Kutta step of RD_Base::step_rk4, as
+ * taken by models such as RD_Schnakenberg. Each RK4 stage needs the previous stage's values
+ * in the neighbouring hexes, so each stage is a dispatch of its own, separated from the next
+ * by a shader storage barrier: four dispatches per step, with the stage sums kept on the GPU.
+ * method = rd_method::euler takes one forward Euler dispatch per step instead, as rd_batch
+ * does, which is four times cheaper per step but first order and stable only for smaller dt.
+ *
+ *   morph::gl::rd_compute<morph::gl::version_4_5> rd (hg, 2, 6);
+ *   rd.reaction = "void derivs (float u[NF], float lap[NF], out float du[NF]) {...}";
+ *   rd.params = { 1.0f, 1.0f, ... };
+ *   rd.set_field (0, initial_a); ...
+ *   rd.init();         // with a GL context current
+ *   for (unsigned int i = 0; i < nsaves; ++i) { rd.step (1000); save (rd.field (0)); }
+ *
+ * Note: You have to include a header like gl3.h or glext.h etc for the GL types and
+ * functions BEFORE including this file. OpenGL 4.3 or OpenGL 3.1 ES is required, and a GL
+ * context must be current when init(), step(), fetch() and the destructor are called.
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <morph/vvec.h>
+#include <morph/HexGrid.h>
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+
+namespace morph {
+    namespace gl {
+
+        //! How rd_compute takes a timestep
+        enum class rd_method { rk4, euler };
+
+        template <int glver>
+        struct rd_compute
+        {
+            static_assert (morph::gl::version::gles (glver) ? morph::gl::version::minor (glver) >= 1
+                           : (morph::gl::version::major (glver) > 4
+                              || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 3)),
+                           "rd_compute needs compute shaders: OpenGL 4.3 or OpenGL 3.1 ES or later");
+
+            //! Work group size. OpenGL ES 3.1 only guarantees 128 invocations per work group.
+            static constexpr unsigned int wg = morph::gl::version::gles (glver) ? 128u : 256u;
+
+            //! The GLSL derivs() function (and anything it needs). Set before init().
+            std::string reaction;
+            //! The timestep
+            float dt = 0.001f;
+            //! The integration method
+            rd_method method = rd_method::rk4;
+
+            //! The parameters, read in the shader with param (i)
+            morph::vvec<float> params;
+            //! The CPU-side copy of the state, indexed by f * nhex + h
+            morph::vvec<float> state;
+            //! Steps taken since init()
+            unsigned long long steps = 0;
+
+            /*!
+             * Set up a model of nfields fields and nparams parameters on the HexGrid hg. Only
+             * CPU-side memory is allocated; no GL context is needed until init().
+             */
+            rd_compute (const morph::HexGrid& hg, const unsigned int _nfields, const unsigned int _nparams)
+                : nfields(_nfields), nparams(_nparams), nhex(static_cast<unsigned int>(hg.num()))
+            {
+                if (this->nfields == 0) { throw std::runtime_error ("rd_compute: need at least one field"); }
+                if (hg.d_ne.size() != this->nhex) { throw std::runtime_error ("rd_compute: the HexGrid's d_ vectors must be populated"); }
+                const float d = hg.getd();
+                this->lapnorm = 2.0f / (3.0f * d * d);
+                // The ghost stencil, in the order ne, nne, nnw, nw, nsw, nse of RD_Base
+                const std::vector<int>* nb[6] = { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse };
+                this->nbr.resize (6 * this->nhex);
+                for (unsigned int h = 0; h < this->nhex; ++h) {
+                    for (unsigned int l = 0; l < 6; ++l) {
+                        const int j = (*nb[l])[h];
+                        this->nbr[6 * h + l] = j < 0 ? static_cast<int>(h) : j;
+                    }
+                }
+                this->params.resize (this->nparams, 0.0f);
+                this->state.resize (static_cast<std::size_t>(this->nhex) * this->nfields, 0.0f);
+            }
+
+            ~rd_compute()
+            {
+                GLuint bufs[6] = { this->nbr_ssbo, this->state_ssbo[0], this->state_ssbo[1], this->state_ssbo[2],
+                                   this->k_ssbo, this->param_ssbo };
+                if (bufs[0] != 0) { glDeleteBuffers (6, bufs); }
+            }
+            rd_compute (const rd_compute&) = delete;
+            rd_compute& operator= (const rd_compute&) = delete;
+
+            //! The CPU-side value of field f in hex h
+            float& value (const unsigned int f, const unsigned int h)
+            {
+                return this->state[static_cast<std::size_t>(f) * this->nhex + h];
+            }
+
+            //! Set field f from the nhex values v (before init(), or followed by upload())
+            template <typename C>
+            void set_field (const unsigned int f, const C& v)
+            {
+                if (v.size() != this->nhex) { throw std::runtime_error ("rd_compute::set_field: need one value per hex"); }
+                for (unsigned int h = 0; h < this->nhex; ++h) { this->value (f, h) = static_cast<float>(v[h]); }
+            }
+
+            //! Field f, fetched from the GPU if the model has stepped since the last fetch
+            morph::vvec<float> field (const unsigned int f)
+            {
+                this->fetch();
+                morph::vvec<float> v (this->nhex);
+                std::copy_n (this->state.begin() + static_cast<std::size_t>(f) * this->nhex, this->nhex, v.begin());
+                return v;
+            }
+
+            //! Build the shader and copy the grid, parameters and state to the GPU. Needs a GL context.
+            void init()
+            {
+                if (this->reaction.empty()) { throw std::runtime_error ("rd_compute::init: set the reaction GLSL first"); }
+                if (this->params.size() != this->nparams) { throw std::runtime_error ("rd_compute::init: params must have nparams elements"); }
+                if (this->nbr_ssbo == 0) {
+                    const std::size_t bytes = this->state.size() * sizeof (float);
+                    this->nbr_ssbo = rd_compute<glver>::make_buffer (this->nbr.size() * sizeof (int), this->nbr.data());
+                    for (unsigned int i = 0; i < 3; ++i) { this->state_ssbo[i] = rd_compute<glver>::make_buffer (bytes, nullptr); }
+                    this->k_ssbo = rd_compute<glver>::make_buffer (bytes, nullptr);
+                    this->param_ssbo = rd_compute<glver>::make_buffer (std::max (this->params.size(), std::size_t{1}) * sizeof (float), nullptr);
+                }
+                this->load_shader();
+                this->steps = 0;
+                this->upload();
+            }
+
+            //! Copy params and state from the CPU to the GPU
+            void upload()
+            {
+                this->cur = 0;
+                rd_compute<glver>::write_buffer (this->state_ssbo[0], this->state.size() * sizeof (float), this->state.data());
+                if (!this->params.empty()) {
+                    rd_compute<glver>::write_buffer (this->param_ssbo, this->params.size() * sizeof (float), this->params.data());
+                }
+                this->state_valid = true;
+            }
+
+            //! Advance the model by n timesteps. Nothing is read back.
+            void step (const unsigned int n)
+            {
+                if (this->prog.prog_id == 0) { throw std::runtime_error ("rd_compute::step: call init() first"); }
+                if (n == 0) { return; }
+                const unsigned int ngrps = (this->nhex + wg - 1) / wg;
+                this->prog.use();
+                this->prog.set_uniform ("dt", this->dt);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->nbr_ssbo);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, this->k_ssbo);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 5, this->param_ssbo);
+                for (unsigned int i = 0; i < n; ++i) {
+                    if (this->method == rd_method::euler) {
+                        // Stage 0 writes y + dt f(y) to a spare buffer, which becomes the state
+                        const unsigned int nxt = (this->cur + 1) % 3;
+                        this->stage (0, this->cur, nxt, ngrps);
+                        this->cur = nxt;
+                    } else {
+                        // The stage inputs ping-pong between the two spare buffers. The last
+                        // stage updates the state in place, as each hex writes only its own values.
+                        const unsigned int t0 = (this->cur + 1) % 3;
+                        const unsigned int t1 = (this->cur + 2) % 3;
+                        this->stage (1, this->cur, t0, ngrps);
+                        this->stage (2, t0, t1, ngrps);
+                        this->stage (3, t1, t0, ngrps);
+                        this->stage (4, t0, t1, ngrps);
+                    }
+                }
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                this->steps += n;
+                this->state_valid = false;
+            }
+
+            //! Copy the current state back from the GPU, if it has changed since the last fetch
+            void fetch()
+            {
+                if (this->state_valid) { return; }
+                rd_compute<glver>::read_buffer (this->state_ssbo[this->cur], this->state.size() * sizeof (float), this->state.data());
+                this->state_valid = true;
+            }
+
+            unsigned int num_fields() const { return this->nfields; }
+            unsigned int num_params() const { return this->nparams; }
+            unsigned int num_hexes() const { return this->nhex; }
+
+            //! The name of the SSBO that holds the current state (laid out as state)
+            GLuint state_buffer() const { return this->state_ssbo[this->cur]; }
+
+        private:
+            //! One dispatch: derivatives at the values in buffer in, combined with the state into buffer out
+            void stage (const unsigned int s, const unsigned int in, const unsigned int out, const unsigned int ngrps)
+            {
+                this->prog.set_uniform ("stage", s);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->state_ssbo[in]);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->state_ssbo[this->cur]);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->state_ssbo[out]);
+                // The next stage reads, as an SSBO, the values that this one writes
+                this->prog.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+
+            static GLuint make_buffer (const std::size_t bytes, const void* data)
+            {
+                GLuint name = 0;
+                glGenBuffers (1, &name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_COPY);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                return name;
+            }
+
+            static void write_buffer (const GLuint name, const std::size_t bytes, const void* data)
+            {
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, bytes, data);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            static void read_buffer (const GLuint name, const std::size_t bytes, void* dst)
+            {
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                const void* gpu = glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                if (gpu != nullptr) { std::copy_n (static_cast<const unsigned char*>(gpu), bytes, static_cast<unsigned char*>(dst)); }
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            void load_shader()
+            {
+                std::string src = morph::gl::version::shaderpreamble (glver);
+                if constexpr (morph::gl::version::gles (glver)) { src += "precision highp float;\nprecision highp int;\n"; }
+                src += "layout (local_size_x = " + std::to_string (wg) + ", local_size_y = 1, local_size_z = 1) in;\n"
+                "#define NF " + std::to_string (this->nfields) + "\n"
+                "uniform uint nhex;\n"
+                "uniform float dt;\n"
+                "uniform float lapnorm;\n"
+                "uniform uint stage;\n"
+                "layout (std430, binding = 0) readonly buffer Nbr { int nbr[]; };\n"
+                // The values at which to evaluate the derivatives
+                "layout (std430, binding = 1) readonly buffer StageIn { float y_in[]; };\n"
+                // The state at the start of the step
+                "layout (std430, binding = 2) buffer State { float y[]; };\n"
+                "layout (std430, binding = 3) writeonly buffer StageOut { float y_out[]; };\n"
+                // The weighted sum of the RK4 stage derivatives so far
+                "layout (std430, binding = 4) buffer K { float k[]; };\n"
+                "layout (std430, binding = 5) readonly buffer Params { float params[]; };\n"
+                "float param (uint i) { return params[i]; }\n"
+                + this->reaction + "\n"
+                "void main()\n"
+                "{\n"
+                "    uint h = gl_GlobalInvocationID.x;\n"
+                "    if (h >= nhex) { return; }\n"
+                "    float u[NF];\n"
+                "    float lap[NF];\n"
+                "    for (int f = 0; f < NF; ++f) { u[f] = y_in[uint(f) * nhex + h]; lap[f] = -6.0 * u[f]; }\n"
+                "    for (uint l = 0u; l < 6u; ++l) {\n"
+                "        uint hn = uint(nbr[6u * h + l]);\n"
+                "        for (int f = 0; f < NF; ++f) { lap[f] += y_in[uint(f) * nhex + hn]; }\n"
+                "    }\n"
+                "    for (int f = 0; f < NF; ++f) { lap[f] *= lapnorm; }\n"
+                "    float du[NF];\n"
+                "    derivs (u, lap, du);\n"
+                "    for (int f = 0; f < NF; ++f) {\n"
+                "        uint i = uint(f) * nhex + h;\n"
+                "        if (stage == 0u) {\n"
+                "            y_out[i] = y[i] + dt * du[f];\n"
+                "        } else if (stage == 1u) {\n"
+                "            k[i] = du[f];\n"
+                "            y_out[i] = y[i] + 0.5 * dt * du[f];\n"
+                "        } else if (stage == 2u) {\n"
+                "            k[i] += 2.0 * du[f];\n"
+                "            y_out[i] = y[i] + 0.5 * dt * du[f];\n"
+                "        } else if (stage == 3u) {\n"
+                "            k[i] += 2.0 * du[f];\n"
+                "            y_out[i] = y[i] + dt * du[f];\n"
+                "        } else {\n"
+                "            y[i] += (dt / 6.0) * (k[i] + du[f]);\n"
+                "        }\n"
+                "    }\n"
+                "}\n";
+
+                // No file name, so that the compiled-in source is always used
+                std::vector<morph::gl::ShaderInfo> shaders = { {GL_COMPUTE_SHADER, "", src, 0 } };
+                this->prog.load_shaders (shaders);
+                if (this->prog.prog_id == 0) { throw std::runtime_error ("rd_compute: failed to build the compute shader"); }
+                this->prog.use();
+                this->prog.set_uniform ("nhex", this->nhex);
+                this->prog.set_uniform ("lapnorm", this->lapnorm);
+            }
+
+            unsigned int nfields = 0;
+            unsigned int nparams = 0;
+            unsigned int nhex = 0;
+            //! 2 / (3 d^2) for hex to hex distance d
+            float lapnorm = 0.0f;
+            //! The ghost stencil neighbour indices, 6 per hex
+            std::vector<int> nbr;
+
+            GLuint nbr_ssbo = 0;
+            //! state_ssbo[cur] holds the current state; the other two hold RK4 stage values
+            GLuint state_ssbo[3] = { 0, 0, 0 };
+            //! The sum of the RK4 stage derivatives
+            GLuint k_ssbo = 0;
+            GLuint param_ssbo = 0;
+            unsigned int cur = 0;
+            bool state_valid = true;
+            morph::gl::compute_shaderprog<glver> prog;
+        };
+
+    } // namespace gl
+} // namespace morph
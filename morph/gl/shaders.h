@@ -10,12 +10,18 @@
  */
 
 #include <morph/tools.h>
+#include <morph/fnv1a.h>
 #include <vector>
 #include <iostream>
 #include <cstring>
 #include <string>
 #include <memory>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdlib>
 
 namespace morph {
 
@@ -96,11 +102,13 @@ namespace morph {
             return type;
         }
 
-        //! Shader loading code.
+        //! Shader loading code. If \a retrievable, the program is linked so that its binary can
+        //! be read back with glGetProgramBinary (see LoadShadersCached).
         GLuint LoadShaders (const std::vector<morph::gl::ShaderInfo>& shader_info
 #ifdef GLAD_OPTION_GL_MX
                             , GladGLContext* glfn
 #endif
+                            , [[maybe_unused]] const bool retrievable = false
             )
         {
             if (shader_info.empty()) { return 0; }
@@ -224,6 +232,19 @@ namespace morph {
             }
 
             GLint linked = 0;
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+            if (retrievable) {
+# ifdef GLAD_OPTION_GL_MX
+                if (glfn->ProgramParameteri) { glfn->ProgramParameteri (program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+# else
+#  ifdef GLAD_GL
+                if (glad_glProgramParameteri) { glProgramParameteri (program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+#  else
+                glProgramParameteri (program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#  endif
+# endif
+            }
+#endif
 #ifdef GLAD_OPTION_GL_MX
             glfn->LinkProgram (program);
             glfn->GetProgramiv (program, GL_LINK_STATUS, &linked);
@@ -255,5 +276,166 @@ namespace morph {
 
             return program;
         }
+
+        /*!
+         * The directory in which LoadShadersCached keeps linked program binaries. Empty disables
+         * the cache. It is initialised from the environment variable MORPH_SHADER_CACHE_DIR and
+         * may be set by client code before the first Visual is created.
+         */
+        inline std::string& program_cache_dir()
+        {
+            static std::string dir = std::getenv ("MORPH_SHADER_CACHE_DIR") ? std::getenv ("MORPH_SHADER_CACHE_DIR") : "";
+            return dir;
+        }
+
+        /*!
+         * The key for a cached program binary: a 64 bit FNV-1a hash of the type and source of
+         * each shader in \a shader_info (read from file or compiled in, as LoadShaders would)
+         * and of the GL vendor, renderer and version strings. A binary is only valid for the
+         * driver that made it, so a driver update changes every key.
+         */
+        inline std::uint64_t program_cache_key (const std::vector<morph::gl::ShaderInfo>& shader_info
+#ifdef GLAD_OPTION_GL_MX
+                                                , GladGLContext* glfn
+#endif
+            )
+        {
+            std::uint64_t h = morph::fnv1a_basis;
+            auto mix = [&h](const void* data, std::size_t n) { h = morph::fnv1a (data, n, h); };
+            for (auto entry : shader_info) {
+                mix (&entry.type, sizeof (entry.type));
+                std::unique_ptr<GLchar[]> source = morph::tools::fileExists (entry.filename)
+                ? morph::gl::ReadShader (entry.filename) : morph::gl::ReadDefaultShader (entry.compiledIn);
+                if (source != nullptr) { mix (source.get(), strlen (source.get())); }
+            }
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+#ifdef GLAD_OPTION_GL_MX
+                const GLubyte* str = glfn->GetString (name);
+#else
+                const GLubyte* str = glGetString (name);
+#endif
+                if (str != nullptr) { mix (str, strlen (reinterpret_cast<const char*>(str))); }
+            }
+            return h;
+        }
+
+        /*!
+         * As LoadShaders, but first look in program_cache_dir() for a program binary made from
+         * the same sources by the same driver. On a miss (or if the driver rejects the binary)
+         * the program is compiled and linked as usual, and its binary is written to the cache
+         * for next time. Without glGetProgramBinary support (GL 4.1, GL ES 3.0), or with an
+         * empty cache directory, this is just LoadShaders.
+         */
+        inline GLuint LoadShadersCached (const std::vector<morph::gl::ShaderInfo>& shader_info
+#ifdef GLAD_OPTION_GL_MX
+                                         , GladGLContext* glfn
+#endif
+            )
+        {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+# ifdef GLAD_OPTION_GL_MX
+            const bool have_binaries = glfn->GetProgramBinary != nullptr && glfn->ProgramBinary != nullptr;
+# elif defined GLAD_GL
+            const bool have_binaries = glad_glGetProgramBinary != nullptr && glad_glProgramBinary != nullptr;
+# else
+            // With the system GL headers the functions are linked directly
+            constexpr bool have_binaries = true;
+# endif
+            const std::string dir = program_cache_dir();
+            if (shader_info.empty() || dir.empty() || !have_binaries) {
+#endif
+#ifdef GLAD_OPTION_GL_MX
+                return LoadShaders (shader_info, glfn);
+#else
+                return LoadShaders (shader_info);
+#endif
+#ifdef GL_PROGRAM_BINARY_LENGTH
+            }
+
+            // The file holds a magic string, the key, the binary format and the binary
+            constexpr char magic[8] = { 'm', 'o', 'r', 'p', 'h', 'p', 'b', '1' };
+# ifdef GLAD_OPTION_GL_MX
+            const std::uint64_t key = program_cache_key (shader_info, glfn);
+# else
+            const std::uint64_t key = program_cache_key (shader_info);
+# endif
+            std::stringstream fname;
+            fname << std::hex << std::setw (16) << std::setfill ('0') << key << ".glbin";
+            const std::filesystem::path path = std::filesystem::path (dir) / fname.str();
+
+            std::ifstream fin (path, std::ios::binary);
+            if (fin.is_open()) {
+                char m[8] = {};
+                std::uint64_t k = 0;
+                std::uint32_t format = 0;
+                std::uint32_t len = 0;
+                fin.read (m, 8);
+                fin.read (reinterpret_cast<char*>(&k), sizeof k);
+                fin.read (reinterpret_cast<char*>(&format), sizeof format);
+                fin.read (reinterpret_cast<char*>(&len), sizeof len);
+                std::vector<char> bin (fin.good() ? len : 0);
+                if (!bin.empty()) { fin.read (bin.data(), len); }
+                if (fin.good() && std::memcmp (m, magic, 8) == 0 && k == key && len > 0) {
+                    GLint linked = GL_FALSE;
+# ifdef GLAD_OPTION_GL_MX
+                    GLuint program = glfn->CreateProgram();
+                    glfn->ProgramBinary (program, format, bin.data(), len);
+                    glfn->GetProgramiv (program, GL_LINK_STATUS, &linked);
+                    if (linked) { return program; }
+                    glfn->DeleteProgram (program);
+                    while (glfn->GetError() != GL_NO_ERROR) {}
+# else
+                    GLuint program = glCreateProgram();
+                    glProgramBinary (program, format, bin.data(), len);
+                    glGetProgramiv (program, GL_LINK_STATUS, &linked);
+                    if (linked) { return program; }
+                    glDeleteProgram (program);
+                    while (glGetError() != GL_NO_ERROR) {}
+# endif
+                }
+                // A stale or corrupt binary; it is replaced below
+            }
+
+            GLint len = 0;
+# ifdef GLAD_OPTION_GL_MX
+            GLuint program = LoadShaders (shader_info, glfn, true);
+            glfn->GetProgramiv (program, GL_PROGRAM_BINARY_LENGTH, &len);
+# else
+            GLuint program = LoadShaders (shader_info, true);
+            glGetProgramiv (program, GL_PROGRAM_BINARY_LENGTH, &len);
+# endif
+            if (program == 0 || len <= 0) { return program; }
+            std::vector<char> bin (len);
+            GLenum format = 0;
+            GLsizei got = 0;
+# ifdef GLAD_OPTION_GL_MX
+            glfn->GetProgramBinary (program, len, &got, &format, bin.data());
+# else
+            glGetProgramBinary (program, len, &got, &format, bin.data());
+# endif
+            if (got <= 0) { return program; }
+
+            // Write to a temporary file and rename it, so that a concurrent reader never sees a
+            // partial binary. Failure to write the cache is not an error.
+            std::error_code ec;
+            std::filesystem::create_directories (dir, ec);
+            const std::filesystem::path tmp = path.string() + ".tmp";
+            {
+                std::ofstream fout (tmp, std::ios::binary | std::ios::trunc);
+                if (!fout.is_open()) { return program; }
+                const std::uint32_t f32 = format;
+                const std::uint32_t l32 = static_cast<std::uint32_t>(got);
+                fout.write (magic, 8);
+                fout.write (reinterpret_cast<const char*>(&key), sizeof key);
+                fout.write (reinterpret_cast<const char*>(&f32), sizeof f32);
+                fout.write (reinterpret_cast<const char*>(&l32), sizeof l32);
+                fout.write (bin.data(), got);
+                if (!fout.good()) { fout.close(); std::filesystem::remove (tmp, ec); return program; }
+            }
+            std::filesystem::rename (tmp, path, ec);
+            if (ec) { std::filesystem::remove (tmp, ec); }
+            return program;
+#endif
+        }
     } // namespace gl
 } // namespace
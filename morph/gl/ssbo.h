@@ -10,10 +10,15 @@
  */
 
 #include <cstddef>
+#include <array>
+#include <vector>
+#include <span>
+#include <stdexcept>
 #include <morph/vec.h>
 #include <morph/vvec.h>
 #include <morph/range.h>
 #include <morph/gl/util.h>
+#include <morph/gl/version.h>
 
 namespace morph {
     namespace gl {
@@ -51,12 +56,14 @@ namespace morph {
                 morph::gl::Util::checkError (__FILE__, __LINE__);
             }
 
-            // Map the GPU memory to CPU space, then copy the values into this->data. NB: it's a
+            // Map the GPU memory to CPU space, then copy the values into this->data. This waits
+            // for the GPU to finish; see readback_ring for an asynchronous alternative. NB: it's a
             // performance hit to *copy* to the mapped data to our morph::vec, because the data is
             // *already in CPU accessible memory* after glMapBufferRange().
             // However, in case you need it, here it is.
             void copy_from_gpu()
             {
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
                 glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->name);
                 morph::gl::Util::checkError (__FILE__, __LINE__);
                 T* cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N*sizeof(T), GL_MAP_READ_BIT));
@@ -76,6 +83,7 @@ namespace morph {
             {
                 morph::range<T> r;
                 r.search_init();
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
                 glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->name);
                 morph::gl::Util::checkError (__FILE__, __LINE__);
                 T* cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, N*sizeof(T), GL_MAP_READ_BIT));
@@ -141,6 +149,7 @@ namespace morph {
         template <typename T>
         void ssbo_copy_to_vvec (const unsigned int ssbo_idx, const unsigned int ssbo_name, morph::vvec<T>& cpu_side)
         {
+            glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, ssbo_idx, ssbo_name);
             // Really, it's crazy to *copy* because the data is *already in CPU
             // accessible memory* after glMapBufferRange. BUT here's the copy:
@@ -154,6 +163,7 @@ namespace morph {
         template <typename T, unsigned int N>
         void ssbo_copy_to_vec (const unsigned int ssbo_idx, const unsigned int ssbo_name, morph::vec<T, N>& cpu_side)
         {
+            glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, ssbo_idx, ssbo_name);
             // Really, it's crazy to *copy* because the data is *already in CPU
             // accessible memory* after glMapBufferRange. BUT here's the copy:
@@ -174,6 +184,7 @@ namespace morph {
         {
             morph::range<T> r;
             r.search_init();
+            glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
             glBindBufferBase (GL_SHADER_STORAGE_BUFFER, ssbo_idx, ssbo_name);
             T* cpuptr = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, ssbo_num_elements*sizeof(T), GL_MAP_READ_BIT));
             for (unsigned int i = 0; i < ssbo_num_elements; ++i) { r.update (cpuptr[i]); }
@@ -183,5 +194,301 @@ namespace morph {
             return r;
         }
 
+        /*!
+         * Wait on a fence made with glFenceSync, then delete it. Throws if the wait fails.
+         */
+        inline void fence_wait (GLsync& fence)
+        {
+            if (fence == nullptr) { return; }
+            GLenum rtn = GL_TIMEOUT_EXPIRED;
+            GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            while (rtn == GL_TIMEOUT_EXPIRED) {
+                rtn = glClientWaitSync (fence, flags, 1000000000); // 1 s per wait
+                flags = 0;
+            }
+            glDeleteSync (fence);
+            fence = nullptr;
+            if (rtn == GL_WAIT_FAILED) { throw std::runtime_error ("morph::gl::fence_wait: glClientWaitSync failed"); }
+        }
+
+        //! True if \a fence has been reached (or is null). Does not block.
+        inline bool fence_reached (GLsync fence)
+        {
+            if (fence == nullptr) { return true; }
+            GLenum rtn = glClientWaitSync (fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            return rtn == GL_ALREADY_SIGNALED || rtn == GL_CONDITION_SATISFIED;
+        }
+
+        /*!
+         * Asynchronous GPU to CPU readback through K staging buffers of n elements of T.
+         *
+         * request() queues a GPU-side copy from an SSBO into the next free staging buffer and
+         * places a fence after it, without waiting for anything. The compute pipeline carries
+         * on, while the CPU collects finished readbacks in the order they were requested:
+         *
+         *   rb.request (out_ssbo);            // after the dispatch that wrote out_ssbo
+         *   ...more dispatches...
+         *   if (rb.ready()) {                 // or rb.front() to block
+         *       std::span<const float> d = rb.front();
+         *       use (d);
+         *       rb.pop();
+         *   }
+         *
+         * With OpenGL 4.4 the staging buffers are persistently mapped, so front() is only a
+         * fence wait. Otherwise (4.3, ES 3.1) each staging buffer is mapped in front(), once its
+         * copy has finished, so the map itself does not stall.
+         *
+         * \tparam glver The morph::gl::version of the context
+         * \tparam T The element type
+         * \tparam K The number of readbacks that may be in flight at once
+         */
+        template <int glver, typename T, unsigned int K = 3>
+        struct readback_ring
+        {
+            static_assert (K > 0, "readback_ring needs at least one staging buffer");
+
+#ifdef GL_MAP_PERSISTENT_BIT
+            static constexpr bool persistent = !morph::gl::version::gles (glver)
+            && (morph::gl::version::major (glver) > 4
+                || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 4));
+#else
+            static constexpr bool persistent = false;
+#endif
+
+            readback_ring() {}
+            ~readback_ring() { this->deinit(); }
+            readback_ring (const readback_ring&) = delete;
+            readback_ring& operator= (const readback_ring&) = delete;
+
+            //! Create the staging buffers, each holding \a _n elements. Needs a current GL context.
+            void init (const std::size_t _n)
+            {
+                this->deinit();
+                this->n = _n;
+                glGenBuffers (K, this->names.data());
+                for (unsigned int k = 0; k < K; ++k) {
+                    glBindBuffer (GL_COPY_WRITE_BUFFER, this->names[k]);
+#ifdef GL_MAP_PERSISTENT_BIT
+                    if constexpr (persistent) {
+                        constexpr GLbitfield fl = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                        glBufferStorage (GL_COPY_WRITE_BUFFER, this->bytes(), nullptr, fl | GL_CLIENT_STORAGE_BIT);
+                        this->mapped[k] = static_cast<const T*>(glMapBufferRange (GL_COPY_WRITE_BUFFER, 0, this->bytes(), fl));
+                    } else
+#endif
+                    {
+                        glBufferData (GL_COPY_WRITE_BUFFER, this->bytes(), nullptr, GL_STREAM_READ);
+                    }
+                }
+                glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! Delete the staging buffers and any fences. Needs the GL context.
+            void deinit()
+            {
+                if (this->names[0] == 0) { return; }
+                for (unsigned int k = 0; k < K; ++k) {
+                    if (this->fences[k] != nullptr) { glDeleteSync (this->fences[k]); this->fences[k] = nullptr; }
+                    if (this->mapped[k] != nullptr) {
+                        glBindBuffer (GL_COPY_WRITE_BUFFER, this->names[k]);
+                        glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+                        this->mapped[k] = nullptr;
+                    }
+                }
+                glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                glDeleteBuffers (K, this->names.data());
+                this->names.fill (0);
+                this->head = 0;
+                this->count = 0;
+            }
+
+            /*!
+             * Queue a copy of n elements, starting at element \a offset, of the buffer \a src_name
+             * (written by earlier dispatches) into the next staging buffer. Returns false, and
+             * queues nothing, if K readbacks are already waiting to be popped.
+             */
+            bool request (const GLuint src_name, const std::size_t offset = 0)
+            {
+                if (this->count == K) { return false; }
+                const unsigned int k = (this->head + this->count) % K;
+                // Shader writes must land before the copy reads them
+                glMemoryBarrier (GL_BUFFER_UPDATE_BARRIER_BIT);
+                glBindBuffer (GL_COPY_READ_BUFFER, src_name);
+                glBindBuffer (GL_COPY_WRITE_BUFFER, this->names[k]);
+                glCopyBufferSubData (GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset * sizeof (T), 0, this->bytes());
+                glBindBuffer (GL_COPY_READ_BUFFER, 0);
+                glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                this->fences[k] = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                ++this->count;
+                return true;
+            }
+
+            //! The number of readbacks that have been requested and not yet popped
+            unsigned int pending() const { return this->count; }
+
+            //! True if the oldest pending readback has arrived, so front() will not block
+            bool ready() const { return this->count > 0 && fence_reached (this->fences[this->head]); }
+
+            /*!
+             * The data of the oldest pending readback, waiting for it if necessary. The span is
+             * valid until pop().
+             */
+            std::span<const T> front()
+            {
+                if (this->count == 0) { throw std::runtime_error ("readback_ring::front: no readback was requested"); }
+                const unsigned int k = this->head;
+                fence_wait (this->fences[k]);
+                if (this->mapped[k] == nullptr) {
+                    glBindBuffer (GL_COPY_WRITE_BUFFER, this->names[k]);
+                    this->mapped[k] = static_cast<const T*>(glMapBufferRange (GL_COPY_WRITE_BUFFER, 0, this->bytes(), GL_MAP_READ_BIT));
+                    glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                    morph::gl::Util::checkError (__FILE__, __LINE__);
+                }
+                return std::span<const T> (this->mapped[k], this->n);
+            }
+
+            //! Release the oldest pending readback so that its staging buffer can be reused
+            void pop()
+            {
+                if (this->count == 0) { return; }
+                const unsigned int k = this->head;
+                if (this->fences[k] != nullptr) { glDeleteSync (this->fences[k]); this->fences[k] = nullptr; }
+                if constexpr (!persistent) {
+                    if (this->mapped[k] != nullptr) {
+                        glBindBuffer (GL_COPY_WRITE_BUFFER, this->names[k]);
+                        glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+                        glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+                        this->mapped[k] = nullptr;
+                    }
+                }
+                this->head = (this->head + 1) % K;
+                --this->count;
+            }
+
+            //! The number of elements in each readback
+            std::size_t size() const { return this->n; }
+
+        private:
+            GLsizeiptr bytes() const { return static_cast<GLsizeiptr>(this->n * sizeof (T)); }
+
+            std::size_t n = 0;
+            std::array<GLuint, K> names = {};
+            std::array<GLsync, K> fences = {};
+            std::array<const T*, K> mapped = {};
+            // The slot of the oldest pending readback and the number pending
+            unsigned int head = 0;
+            unsigned int count = 0;
+        };
+
+        /*!
+         * K SSBOs of n elements of T, used in turn, so that the CPU can fill the next set of
+         * input while the GPU is still reading the previous ones:
+         *
+         *   std::span<float> in = ring.acquire(); // waits only if the GPU still has this slot
+         *   fill (in);
+         *   ring.submit (1);                      // make it visible and bind it at index 1
+         *   prog.dispatch (ngrps, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+         *   ring.retire();                        // fence the slot's use and move to the next
+         *
+         * With OpenGL 4.4 the buffers are persistently mapped for writing, so acquire() hands out
+         * GPU-visible memory directly. Otherwise acquire() hands out a CPU-side copy that
+         * submit() uploads with glBufferSubData.
+         */
+        template <int glver, typename T, unsigned int K = 3>
+        struct ssbo_ring
+        {
+            static_assert (K > 0, "ssbo_ring needs at least one buffer");
+            static constexpr bool persistent = readback_ring<glver, T, K>::persistent;
+
+            ssbo_ring() {}
+            ~ssbo_ring() { this->deinit(); }
+            ssbo_ring (const ssbo_ring&) = delete;
+            ssbo_ring& operator= (const ssbo_ring&) = delete;
+
+            //! Create the K buffers, each of \a _n elements. Needs a current GL context.
+            void init (const std::size_t _n)
+            {
+                this->deinit();
+                this->n = _n;
+                glGenBuffers (K, this->names.data());
+                for (unsigned int k = 0; k < K; ++k) {
+                    glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->names[k]);
+#ifdef GL_MAP_PERSISTENT_BIT
+                    if constexpr (persistent) {
+                        constexpr GLbitfield fl = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                        glBufferStorage (GL_SHADER_STORAGE_BUFFER, this->bytes(), nullptr, fl);
+                        this->mapped[k] = static_cast<T*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, this->bytes(), fl));
+                    } else
+#endif
+                    {
+                        glBufferData (GL_SHADER_STORAGE_BUFFER, this->bytes(), nullptr, GL_STREAM_DRAW);
+                    }
+                }
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                if constexpr (!persistent) { this->staging.resize (this->n); }
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! Delete the buffers and any fences. Needs the GL context.
+            void deinit()
+            {
+                if (this->names[0] == 0) { return; }
+                for (unsigned int k = 0; k < K; ++k) {
+                    if (this->fences[k] != nullptr) { glDeleteSync (this->fences[k]); this->fences[k] = nullptr; }
+                    if (this->mapped[k] != nullptr) {
+                        glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->names[k]);
+                        glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                        this->mapped[k] = nullptr;
+                    }
+                }
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                glDeleteBuffers (K, this->names.data());
+                this->names.fill (0);
+                this->cur = 0;
+            }
+
+            //! Memory for the current slot's data. Waits until the GPU has finished with the slot.
+            std::span<T> acquire()
+            {
+                fence_wait (this->fences[this->cur]);
+                if constexpr (persistent) { return std::span<T> (this->mapped[this->cur], this->n); }
+                return std::span<T> (this->staging.data(), this->n);
+            }
+
+            //! Make the current slot's data visible to the GPU and bind it at SSBO binding \a index
+            void submit (const GLuint index)
+            {
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, index, this->names[this->cur]);
+                if constexpr (!persistent) {
+                    glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, this->bytes(), this->staging.data());
+                }
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! Fence the work issued since submit() and move on to the next slot
+            void retire()
+            {
+                this->fences[this->cur] = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                this->cur = (this->cur + 1) % K;
+            }
+
+            //! The GL name of the current slot's buffer
+            GLuint name() const { return this->names[this->cur]; }
+            //! The number of elements in each buffer
+            std::size_t size() const { return this->n; }
+
+        private:
+            GLsizeiptr bytes() const { return static_cast<GLsizeiptr>(this->n * sizeof (T)); }
+
+            std::size_t n = 0;
+            std::array<GLuint, K> names = {};
+            std::array<GLsync, K> fences = {};
+            std::array<T*, K> mapped = {};
+            // The CPU-side copy used when the buffers cannot be persistently mapped
+            std::vector<T> staging;
+            unsigned int cur = 0;
+        };
+
     } // gl
 } // morph
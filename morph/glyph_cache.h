@@ -0,0 +1,282 @@
+/*!
+ * \file
+ *
+ * A process-wide cache of rasterised font glyphs, packed into atlas pages, for morph::visgl::VisualFace.
+ *
+ * With the cache, each combination of font, pixel size and atlas page size is rasterised by
+ * FreeType only once per process, however many windows (OpenGL contexts) use it. Each context
+ * only has to upload the atlas pages to its own textures. If glyph_cache::cache_dir is set, the
+ * atlases are also saved to disk, so that later runs of the program need not rasterise at all.
+ *
+ * This header has no OpenGL or FreeType dependency.
+ *
+ * \author Seb James
+ * \date 2025
+ */
+
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/VisualFont.h>
+
+#include <map>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+namespace morph {
+
+    /*!
+     * Glyph bitmaps packed, row by row, into square pages of page_size pixels (the last page may
+     * be less tall), with the metrics of each glyph. The pages are single channel, one byte per
+     * pixel, top row first.
+     */
+    struct glyph_atlas
+    {
+        //! The metrics of one glyph and where it is in the atlas
+        struct glyph
+        {
+            //! Index of the page the glyph is on
+            unsigned int page = 0;
+            //! Size of glyph bitmap in pixels
+            morph::vec<int, 2> size = { 0, 0 };
+            //! Offset from baseline to left/top of glyph
+            morph::vec<int, 2> bearing = { 0, 0 };
+            //! Offset to advance to next glyph, in 1/64 pixels
+            unsigned int advance = 0;
+            //! The glyph's rectangle in its page as (u0, v0, u1, v1). v0 is the top row.
+            morph::vec<float, 4> uv = { 0.0f, 0.0f, 0.0f, 0.0f };
+        };
+
+        glyph_atlas (const unsigned int _page_size = 2048) : page_size(_page_size) {}
+
+        //! Empty pixels around each glyph, so that linear filtering does not pick up its neighbours
+        static constexpr unsigned int pad = 2;
+
+        //! Width (and maximum height) of a page
+        unsigned int page_size = 2048;
+        //! The pages, each page_size * page_heights[i] bytes
+        std::vector<std::vector<unsigned char>> pages;
+        std::vector<unsigned int> page_heights;
+        //! The glyphs, by Unicode code point
+        std::map<char32_t, glyph> glyphs;
+
+        /*!
+         * Pack a glyph bitmap of width by rows pixels, whose rows are pitch bytes apart in buf,
+         * into the atlas. Returns false if the glyph is larger than a page.
+         */
+        bool add (const char32_t c, const unsigned char* buf, const unsigned int width, const unsigned int rows,
+                  const int pitch, const morph::vec<int, 2>& bearing, const unsigned int advance)
+        {
+            if (width + 2 * pad > this->page_size || rows + 2 * pad > this->page_size) { return false; }
+            if (this->pages.empty()) { this->new_page(); }
+            // Start a new row, or a new page, if the glyph does not fit in this one
+            if (this->pen_x + width + pad > this->page_size) {
+                this->pen_x = pad;
+                this->pen_y += this->row_h + pad;
+                this->row_h = 0;
+            }
+            if (this->pen_y + rows + pad > this->page_size) {
+                this->end_page();
+                this->new_page();
+            }
+            std::vector<unsigned char>& pg = this->pages.back();
+            for (unsigned int r = 0; r < rows; ++r) {
+                std::copy (buf + r * pitch, buf + r * pitch + width,
+                           pg.begin() + (this->pen_y + r) * this->page_size + this->pen_x);
+            }
+            glyph g;
+            g.page = static_cast<unsigned int>(this->pages.size() - 1);
+            g.size = { static_cast<int>(width), static_cast<int>(rows) };
+            g.bearing = bearing;
+            g.advance = advance;
+            // uv is in pixels until finish()
+            g.uv = { static_cast<float>(this->pen_x), static_cast<float>(this->pen_y),
+                     static_cast<float>(this->pen_x + width), static_cast<float>(this->pen_y + rows) };
+            this->glyphs[c] = g;
+            this->pen_x += width + pad;
+            this->row_h = std::max (this->row_h, rows);
+            return true;
+        }
+
+        //! Call after the last add(). Trims the last page and converts the glyph rectangles to uv.
+        void finish()
+        {
+            if (this->pages.empty()) { return; }
+            this->end_page();
+            for (auto& g : this->glyphs) {
+                const float w = static_cast<float>(this->page_size);
+                const float h = static_cast<float>(this->page_heights[g.second.page]);
+                g.second.uv[0] /= w;
+                g.second.uv[2] /= w;
+                g.second.uv[1] /= h;
+                g.second.uv[3] /= h;
+            }
+        }
+
+        //! Magic number and format version of the files written by save()
+        static constexpr std::uint32_t file_magic = 0x4d474c43; // "MGLC"
+        static constexpr std::uint32_t file_version = 1;
+
+        /*!
+         * Write the (finished) atlas to a binary file. tag is stored too, and load() fails unless
+         * it is given the same tag; use it to identify the font data that the atlas was made from.
+         */
+        bool save (const std::string& path, const std::uint64_t tag) const
+        {
+            std::ofstream f (path, std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!f.is_open()) { return false; }
+            auto put = [&f](const auto& v) { f.write (reinterpret_cast<const char*>(&v), sizeof v); };
+            put (file_magic);
+            put (file_version);
+            put (tag);
+            put (this->page_size);
+            put (static_cast<std::uint32_t>(this->pages.size()));
+            for (std::size_t p = 0; p < this->pages.size(); ++p) {
+                put (this->page_heights[p]);
+                f.write (reinterpret_cast<const char*>(this->pages[p].data()), this->pages[p].size());
+            }
+            put (static_cast<std::uint32_t>(this->glyphs.size()));
+            for (const auto& g : this->glyphs) { put (g.first); put (g.second); }
+            return f.good();
+        }
+
+        //! Read an atlas written by save() with the same tag. Returns false (leaving this atlas empty) on failure.
+        bool load (const std::string& path, const std::uint64_t tag)
+        {
+            *this = glyph_atlas (this->page_size);
+            std::ifstream f (path, std::ios::in | std::ios::binary);
+            if (!f.is_open()) { return false; }
+            auto get = [&f](auto& v) { f.read (reinterpret_cast<char*>(&v), sizeof v); return f.good(); };
+            std::uint32_t magic = 0, version = 0, npages = 0, nglyphs = 0;
+            std::uint64_t file_tag = 0;
+            unsigned int psz = 0;
+            if (!get (magic) || magic != file_magic || !get (version) || version != file_version
+                || !get (file_tag) || file_tag != tag || !get (psz) || !get (npages)) { return false; }
+            glyph_atlas a (psz);
+            for (std::uint32_t p = 0; p < npages; ++p) {
+                unsigned int h = 0;
+                if (!get (h) || h > psz) { return false; }
+                a.page_heights.push_back (h);
+                a.pages.emplace_back (static_cast<std::size_t>(psz) * h);
+                f.read (reinterpret_cast<char*>(a.pages.back().data()), a.pages.back().size());
+            }
+            if (!get (nglyphs)) { return false; }
+            for (std::uint32_t i = 0; i < nglyphs; ++i) {
+                char32_t c = 0;
+                glyph g;
+                if (!get (c) || !get (g) || g.page >= npages) { return false; }
+                a.glyphs[c] = g;
+            }
+            *this = std::move (a);
+            return true;
+        }
+
+    private:
+        void new_page()
+        {
+            this->pages.emplace_back (static_cast<std::size_t>(this->page_size) * this->page_size, 0);
+            this->pen_x = pad;
+            this->pen_y = pad;
+            this->row_h = 0;
+        }
+        //! Record the height of the current (last) page and trim it to that height
+        void end_page()
+        {
+            unsigned int h = std::min (this->pen_y + this->row_h + pad, this->page_size);
+            this->pages.back().resize (static_cast<std::size_t>(this->page_size) * h);
+            this->page_heights.push_back (h);
+        }
+        // The packing position in the current page
+        unsigned int pen_x = pad;
+        unsigned int pen_y = pad;
+        unsigned int row_h = 0;
+    };
+
+    /*!
+     * The process-wide glyph atlas cache. Thread safe. Atlases are shared (read only) by all the
+     * VisualFaces, in every OpenGL context, that use the same font, pixel size and page size.
+     */
+    class glyph_cache
+    {
+    public:
+        //! The instance. This relies on C++11 magic statics (N2660).
+        static glyph_cache& i()
+        {
+            static glyph_cache instance;
+            return instance;
+        }
+
+        glyph_cache (const glyph_cache&) = delete;
+        glyph_cache& operator= (const glyph_cache&) = delete;
+
+        /*!
+         * Get the atlas for font at fontpixels with pages of page_size. If it is not in memory,
+         * it is loaded from cache_dir (if that is set and holds a file made with the same tag)
+         * or else made by calling build, and then saved to cache_dir. tag should identify the
+         * font data (its size in bytes, for example) so that a stale file is not used.
+         */
+        std::shared_ptr<const glyph_atlas> get (const morph::VisualFont font, const unsigned int fontpixels,
+                                                const unsigned int page_size, const std::uint64_t tag,
+                                                const std::function<glyph_atlas()>& build)
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            auto key = std::make_tuple (font, fontpixels, page_size);
+            auto a = this->atlases.find (key);
+            if (a != this->atlases.end()) { return a->second; }
+
+            auto atlas = std::make_shared<glyph_atlas> (page_size);
+            const std::string path = this->filename (font, fontpixels, page_size);
+            if (path.empty() || !atlas->load (path, tag)) {
+                *atlas = build();
+                ++this->builds;
+                if (!path.empty()) { atlas->save (path, tag); }
+            }
+            this->atlases[key] = atlas;
+            return atlas;
+        }
+
+        //! Drop all atlases from memory (files in cache_dir are kept)
+        void clear()
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            this->atlases.clear();
+        }
+
+        //! The file that the atlas for font, fontpixels and page_size is kept in, or "" if cache_dir is not set
+        std::string filename (const morph::VisualFont font, const unsigned int fontpixels, const unsigned int page_size) const
+        {
+            if (this->cache_dir.empty()) { return std::string(""); }
+            return this->cache_dir + "/morph_glyphs_" + std::to_string (static_cast<int>(font)) + "_"
+            + std::to_string (fontpixels) + "_" + std::to_string (page_size) + ".bin";
+        }
+
+        /*!
+         * A directory in which to keep atlases between runs. Off (empty) by default; it is
+         * initialised from the environment variable MORPH_GLYPH_CACHE_DIR if that is set.
+         */
+        std::string cache_dir;
+
+        //! The number of atlases that had to be made by rasterising with FreeType
+        unsigned int builds = 0;
+
+    private:
+        glyph_cache()
+        {
+            const char* d = std::getenv ("MORPH_GLYPH_CACHE_DIR");
+            if (d != nullptr) { this->cache_dir = std::string (d); }
+        }
+
+        std::mutex m;
+        std::map<std::tuple<morph::VisualFont, unsigned int, unsigned int>, std::shared_ptr<glyph_atlas>> atlases;
+    };
+
+} // namespace morph
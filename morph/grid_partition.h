@@ -0,0 +1,213 @@
+/*!
+ * \file
+ *
+ * Domain decomposition of a HexGrid or CartGrid for runs that split a model across
+ * processes (with MPI, say, using morph/mpi_halo.h).
+ *
+ * make_grid_part() cuts the grid's elements, in index order, into nparts contiguous
+ * ranges of (nearly) equal size. Put a HexGrid in HexGridOrder::hilbert order first, so
+ * that each range is a compact patch of the domain with a short boundary; a CartGrid's
+ * ranges are bands of rows. Each grid_part knows the elements it owns, the ghost elements
+ * (owned by other parts) that its owned elements neighbour, and which of its owned
+ * elements its neighbouring parts need in return.
+ *
+ * Within a part, elements are numbered locally: the owned elements 0 to num_owned() - 1
+ * (global indices begin to end - 1), then the ghosts, num_owned() onwards. A field on a
+ * part holds only the owned values; a halo_exchange delivers the ghost values separately.
+ */
+
+#pragma once
+
+#include <morph/stencil.h>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace morph {
+
+    //! One part of a partitioned grid, made by make_grid_part()
+    struct grid_part
+    {
+        //! Which part this is, and the number of parts
+        int index = 0;
+        int num_parts = 1;
+        //! The global indices owned by this part are begin to end - 1
+        int begin = 0;
+        int end = 0;
+        //! The number of elements in the whole grid
+        int num_global = 0;
+
+        //! The global indices of the ghost elements, ascending (and so grouped by owner)
+        std::vector<int> ghosts;
+
+        /*!
+         * The neighbour relations in local numbering, one vector per direction (in the
+         * same order as the grid's d_ne, d_nne, ... vectors), each of num_owned()
+         * elements. -1 means there is no neighbour.
+         */
+        std::vector<std::vector<int>> links;
+
+        //! Owned elements all of whose neighbours are owned, and those with ghost neighbours
+        std::vector<int> interior;
+        std::vector<int> boundary;
+
+        //! The ghosts that come from part peer are ghosts[offset] to ghosts[offset + count - 1]
+        struct recv_range { int peer; int offset; int count; };
+        std::vector<recv_range> recv;
+        //! The owned elements (local indices, in the order the peer expects) to send to part peer
+        struct send_list { int peer; std::vector<int> local; };
+        std::vector<send_list> send;
+
+        int num_owned() const { return this->end - this->begin; }
+        int num_ghosts() const { return static_cast<int>(this->ghosts.size()); }
+        bool owns (const int global) const { return global >= this->begin && global < this->end; }
+
+        //! The owner of global index gi when num_global elements are split into num_parts ranges
+        int owner (const int gi) const { return grid_part::owner_of (gi, this->num_global, this->num_parts); }
+
+        //! Copy this part's values out of a field on the whole grid
+        template <typename T>
+        void scatter (const std::vector<T>& global, std::vector<T>& local) const
+        {
+            if (static_cast<int>(global.size()) != this->num_global) {
+                throw std::runtime_error ("grid_part::scatter: the global field has the wrong size");
+            }
+            local.assign (global.begin() + this->begin, global.begin() + this->end);
+        }
+
+        //! Copy this part's values into a field on the whole grid
+        template <typename T>
+        void gather (const std::vector<T>& local, std::vector<T>& global) const
+        {
+            if (static_cast<int>(local.size()) != this->num_owned()) {
+                throw std::runtime_error ("grid_part::gather: the local field has the wrong size");
+            }
+            global.resize (this->num_global);
+            std::copy (local.begin(), local.end(), global.begin() + this->begin);
+        }
+
+        //! The first global index of part p when n elements are split into np ranges
+        static int range_begin (const int p, const int n, const int np)
+        {
+            return static_cast<int>((static_cast<long long>(n) * p) / np);
+        }
+
+        static int owner_of (const int gi, const int n, const int np)
+        {
+            // range_begin is monotonic, so the owner is the last part that begins at or before gi
+            int p = static_cast<int>((static_cast<long long>(gi) * np) / n);
+            while (p + 1 < np && grid_part::range_begin (p + 1, n, np) <= gi) { ++p; }
+            while (p > 0 && grid_part::range_begin (p, n, np) > gi) { --p; }
+            return p;
+        }
+    };
+
+    /*!
+     * A halo exchange delivers the values of a part's ghost elements, which other parts
+     * own. start() begins sending the owned values of a field that the neighbouring parts
+     * need and receiving this part's ghosts; finish() waits for the ghosts to arrive and
+     * returns them, in the order of grid_part::ghosts. Between the two, compute on the
+     * part's interior elements to hide the communication.
+     */
+    template <typename T>
+    class halo_exchange
+    {
+    public:
+        virtual ~halo_exchange() {}
+        virtual void start (const std::vector<T>& owned) = 0;
+        virtual const std::vector<T>& finish() = 0;
+    };
+
+    /*!
+     * Make part \a index of \a nparts of a HexGrid or a CartGrid. Any symmetric neighbour
+     * relation will do; pass its direction vectors (with -1 for no neighbour) to the
+     * overload below. Only this part's data is computed, so each process can make its own
+     * part without holding the others.
+     */
+    inline grid_part make_grid_part (const std::vector<const std::vector<int>*>& d_links, const int nparts, const int index)
+    {
+        if (d_links.empty()) { throw std::runtime_error ("make_grid_part: no neighbour relations"); }
+        const int n = static_cast<int>(d_links[0]->size());
+        if (nparts < 1 || nparts > n || index < 0 || index >= nparts) {
+            throw std::runtime_error ("make_grid_part: need 0 <= index < nparts <= " + std::to_string (n));
+        }
+        grid_part p;
+        p.index = index;
+        p.num_parts = nparts;
+        p.num_global = n;
+        p.begin = grid_part::range_begin (index, n, nparts);
+        p.end = grid_part::range_begin (index + 1, n, nparts);
+
+        // The ghosts are the neighbours of owned elements that are not themselves owned
+        for (const std::vector<int>* l : d_links) {
+            for (int i = p.begin; i < p.end; ++i) {
+                const int j = (*l)[i];
+                if (j >= 0 && !p.owns (j)) { p.ghosts.push_back (j); }
+            }
+        }
+        std::sort (p.ghosts.begin(), p.ghosts.end());
+        p.ghosts.erase (std::unique (p.ghosts.begin(), p.ghosts.end()), p.ghosts.end());
+
+        auto local = [&p](const int j) {
+            if (j < 0) { return -1; }
+            if (p.owns (j)) { return j - p.begin; }
+            return p.num_owned() + static_cast<int>(std::lower_bound (p.ghosts.begin(), p.ghosts.end(), j) - p.ghosts.begin());
+        };
+        p.links.resize (d_links.size());
+        std::vector<char> has_ghost (p.num_owned(), 0);
+        for (std::size_t d = 0; d < d_links.size(); ++d) {
+            p.links[d].resize (p.num_owned());
+            for (int i = p.begin; i < p.end; ++i) {
+                const int li = local ((*d_links[d])[i]);
+                p.links[d][i - p.begin] = li;
+                if (li >= p.num_owned()) { has_ghost[i - p.begin] = 1; }
+            }
+        }
+        for (int i = 0; i < p.num_owned(); ++i) { (has_ghost[i] ? p.boundary : p.interior).push_back (i); }
+
+        // The ghosts are ascending, so each owner's ghosts are contiguous
+        for (int g = 0; g < p.num_ghosts();) {
+            const int peer = p.owner (p.ghosts[g]);
+            int e = g;
+            while (e < p.num_ghosts() && p.owner (p.ghosts[e]) == peer) { ++e; }
+            p.recv.push_back ({ peer, g, e - g });
+            g = e;
+        }
+
+        /*
+         * As the neighbour relation is symmetric, part q's ghosts owned here are the owned
+         * elements with a neighbour in q. q holds them ascending, and so will we.
+         */
+        std::vector<std::vector<int>> to_peer (nparts);
+        for (int i : p.boundary) {
+            for (std::size_t d = 0; d < p.links.size(); ++d) {
+                const int li = p.links[d][i];
+                if (li < p.num_owned()) { continue; }
+                std::vector<int>& tp = to_peer[p.owner (p.ghosts[li - p.num_owned()])];
+                if (tp.empty() || tp.back() != i) { tp.push_back (i); }
+            }
+        }
+        for (int q = 0; q < nparts; ++q) {
+            if (to_peer[q].empty()) { continue; }
+            std::sort (to_peer[q].begin(), to_peer[q].end());
+            to_peer[q].erase (std::unique (to_peer[q].begin(), to_peer[q].end()), to_peer[q].end());
+            p.send.push_back ({ q, std::move (to_peer[q]) });
+        }
+        return p;
+    }
+
+    template <typename G>
+    grid_part make_grid_part (const G& grid, const int nparts, const int index)
+    {
+        if constexpr (stencil_detail::hex_grid<G>) {
+            return make_grid_part ({ &grid.d_ne, &grid.d_nne, &grid.d_nnw, &grid.d_nw, &grid.d_nsw, &grid.d_nse }, nparts, index);
+        } else if constexpr (stencil_detail::cart_grid<G>) {
+            return make_grid_part ({ &grid.d_ne, &grid.d_nne, &grid.d_nn, &grid.d_nnw,
+                                     &grid.d_nw, &grid.d_nsw, &grid.d_ns, &grid.d_nse }, nparts, index);
+        } else {
+            static_assert (stencil_detail::hex_grid<G>, "make_grid_part: needs a HexGrid or a CartGrid");
+        }
+    }
+
+} // namespace morph
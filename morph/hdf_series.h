@@ -0,0 +1,204 @@
+/*
+ * Compact storage for a time series of state vectors that change slowly from frame to
+ * frame. Frames are stored as occasional keyframes plus, in between, the change since the
+ * previous frame quantised to a chosen tolerance, which compresses to a few bits a value.
+ */
+#pragma once
+
+#include <morph/HdfData.h>
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+namespace morph {
+
+    /*!
+     * Reads a series written by hdf_series_writer. Frame f is rebuilt from the keyframe at
+     * or before it and the deltas after that, so reading the frames in order costs one row
+     * read per frame.
+     */
+    template <typename T = double>
+    struct hdf_series_reader
+    {
+        hdf_series_reader (HdfData& _data, const std::string& _path) : data(_data), path(_path)
+        {
+            if (!this->data.exists (this->path + "/index")) {
+                throw std::runtime_error ("hdf_series_reader: There is no series at " + this->path);
+            }
+            this->data.read_val ((this->path + "/tolerance").c_str(), this->tol);
+            this->data.read_contained_vals ((this->path + "/index").c_str(), this->index);
+            if (!this->index.empty() && this->index[0][0] != 0) {
+                throw std::runtime_error ("hdf_series_reader: The series at " + this->path + " does not start with a keyframe");
+            }
+        }
+
+        //! The number of frames in the series
+        std::size_t frames() const { return this->index.size(); }
+
+        //! The largest difference between a value as written and as read back
+        T tolerance() const { return this->tol; }
+
+        //! True if frame f was stored whole, rather than as a change from frame f-1
+        bool is_keyframe (const std::size_t f) const { return this->index.at (f)[0] == 0; }
+
+        //! Read frame f into out
+        void read (const std::size_t f, std::vector<T>& out)
+        {
+            if (f >= this->index.size()) { throw std::out_of_range ("hdf_series_reader: No such frame"); }
+            std::size_t k = f;
+            while (this->index[k][0] != 0) { --k; }
+            std::size_t from = k + 1;
+            if (this->current != npos && this->current >= k && this->current <= f) {
+                // Carry on from the frame already rebuilt
+                from = this->current + 1;
+            } else {
+                this->data.read_slice ((this->path + "/keyframes").c_str(), { static_cast<hsize_t>(this->index[k][1]), 0 },
+                                       { 1, this->row_length ("/keyframes") }, this->recon);
+            }
+            const T step = T{2} * this->tol;
+            for (std::size_t i = from; i <= f; ++i) {
+                this->data.read_slice ((this->path + "/deltas").c_str(), { static_cast<hsize_t>(this->index[i][1]), 0 },
+                                       { 1, static_cast<hsize_t>(this->recon.size()) }, this->q);
+                // Exactly as hdf_series_writer::append rebuilds it
+                for (std::size_t j = 0; j < this->recon.size(); ++j) { this->recon[j] += static_cast<T>(this->q[j]) * step; }
+            }
+            this->current = f;
+            out = this->recon;
+        }
+
+    private:
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        hsize_t row_length (const std::string& ds) const
+        {
+            std::vector<hsize_t> d = this->data.get_dims ((this->path + ds).c_str());
+            return d.size() == 2 ? d[1] : 0;
+        }
+
+        HdfData& data;
+        std::string path;
+        T tol = T{0};
+        //! For each frame, {0, keyframe row} or {1, delta row}
+        std::vector<std::array<unsigned long long, 2>> index;
+        //! The frame read last, and its values
+        std::size_t current = npos;
+        std::vector<T> recon;
+        std::vector<short> q;
+    };
+
+    /*!
+     * Writes a time series of equal length vectors of T (a floating point type) into the
+     * group path of an HDF5 file, so that each value is read back to within tolerance:
+     *
+     *\code{.cpp}
+     * morph::hdf_series_writer<float> w ("/frames/A", 1e-4f);
+     * morph::HdfData data ("run.h5");
+     * for (...) { step(); w.append (data, A); }
+     *\endcode
+     *
+     * Frame 0, and every keyframe_interval-th frame after it, is stored whole in
+     * path/keyframes. Another frame is stored as its difference from the previous frame as
+     * it will be read back (not as it was given, so the errors don't add up), divided by
+     * twice the tolerance and rounded to a 16 bit integer, in path/deltas. A frame with a
+     * change too large for that is stored as a keyframe. The datasets are compressed with the
+     * HdfData's compression, or Gzip if it has none; the small integers of a slowly changing
+     * field compress well.
+     *
+     * Appending to a file that already holds the series (after a restart, say) carries it on.
+     */
+    template <typename T = double>
+    struct hdf_series_writer
+    {
+        hdf_series_writer (const std::string& _path, const T _tolerance, const unsigned int _keyframe_interval = 32)
+            : path(_path), tolerance(_tolerance), keyframe_interval(std::max (1u, _keyframe_interval))
+        {
+            if (!(this->tolerance > T{0})) { throw std::invalid_argument ("hdf_series_writer: tolerance must be positive"); }
+        }
+
+        /*!
+         * Add frame to the end of the series in data. Every frame must have the same length.
+         *
+         * \return the index of the frame
+         */
+        std::size_t append (HdfData& data, const std::vector<T>& frame)
+        {
+            if (this->nframes == 0) { this->resume (data); }
+
+            bool key = this->recon.empty() || this->since_key + 1 >= this->keyframe_interval
+                       || this->recon.size() != frame.size();
+            const T step = T{2} * this->tolerance;
+            if (!key) {
+                this->q.resize (frame.size());
+                for (std::size_t i = 0; i < frame.size(); ++i) {
+                    const T d = std::round ((frame[i] - this->recon[i]) / step);
+                    // This is also false for a NaN difference
+                    if (!(std::abs (d) <= T{32767})) { key = true; break; }
+                    this->q[i] = static_cast<short>(d);
+                }
+            }
+
+            const Compression c = data.compression;
+            if (c == Compression::None) { data.compression = Compression::Gzip; }
+            try {
+                if (this->nframes == 0) { data.add_val ((this->path + "/tolerance").c_str(), this->tolerance); }
+                std::vector<unsigned long long> idx = { key ? 0ull : 1ull, 0ull };
+                if (key) {
+                    idx[1] = data.append_vals ((this->path + "/keyframes").c_str(), frame);
+                    this->recon = frame;
+                    this->since_key = 0;
+                } else {
+                    idx[1] = data.append_vals ((this->path + "/deltas").c_str(), this->q);
+                    for (std::size_t i = 0; i < frame.size(); ++i) { this->recon[i] += static_cast<T>(this->q[i]) * step; }
+                    ++this->since_key;
+                }
+                data.append_vals ((this->path + "/index").c_str(), idx);
+            } catch (...) {
+                data.compression = c;
+                throw;
+            }
+            data.compression = c;
+            return this->nframes++;
+        }
+
+        //! The number of frames in the series
+        std::size_t frames() const { return this->nframes; }
+
+        //! The last frame appended, as it will be read back
+        const std::vector<T>& last() const { return this->recon; }
+
+        //! The group holding the series
+        const std::string& get_path() const { return this->path; }
+
+    private:
+        //! If data already holds this series, carry on from its last frame
+        void resume (HdfData& data)
+        {
+            if (!data.exists (this->path + "/index")) { return; }
+            hdf_series_reader<T> r (data, this->path);
+            if (r.frames() == 0) { return; }
+            if (r.tolerance() != this->tolerance) {
+                throw std::runtime_error ("hdf_series_writer: The series at " + this->path + " has a different tolerance");
+            }
+            this->nframes = r.frames();
+            r.read (this->nframes - 1, this->recon);
+            this->since_key = 0;
+            for (std::size_t f = this->nframes - 1; !r.is_keyframe (f); --f) { ++this->since_key; }
+        }
+
+        std::string path;
+        T tolerance;
+        unsigned int keyframe_interval;
+        std::size_t nframes = 0;
+        //! The number of frames stored as deltas since the last keyframe
+        unsigned int since_key = 0;
+        std::vector<T> recon;
+        std::vector<short> q;
+    };
+
+} // namespace morph
@@ -0,0 +1,232 @@
+/*
+ * A background thread that writes simulation snapshots to HDF5 files, so that the
+ * simulation does not wait on the disk (or the network filesystem) each time it saves.
+ */
+#pragma once
+
+#include <morph/HdfData.h>
+#include <morph/hdf_series.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <iostream>
+#include <utility>
+#include <cstddef>
+
+namespace morph {
+
+    /*!
+     * A queue of snapshots, each a set of named vectors of T, written to HDF5 by one worker
+     * thread.
+     *
+     * Fill a job with the state vectors to save, moving them in if the simulation has
+     * finished with them or copying them if not, and push() it. push() returns as soon as
+     * the job is queued. The queued jobs hold at most max_bytes of vector data (though
+     * one job is always accepted); push() blocks while a new job would exceed that, so a
+     * slow disk applies backpressure to the simulation rather than using up all the
+     * memory. wait() blocks until everything pushed so far is written and the files are
+     * closed. The destructor writes any jobs that are still queued before it returns.
+     *
+     * The HDF5 library is usually built without thread safety, so while a writer has work
+     * queued, don't make HDF5 calls from other threads.
+     */
+    template <typename T = double>
+    struct hdf_writer
+    {
+        //! One snapshot to save
+        struct job
+        {
+            //! The HDF5 file to write
+            std::string filename;
+            /*!
+             * If false, filename is truncated and each dataset written with
+             * HdfData::add_contained_vals. If true, each dataset is appended as a new row of
+             * an extendible dataset with HdfData::append_vals, so that a whole run's frames
+             * go into one file, which is created if it does not exist.
+             */
+            bool append = false;
+            //! The compression for the datasets that are created
+            Compression compression = Compression::None;
+            /*!
+             * If positive (and append is set), each dataset is a series written by
+             * hdf_series_writer, which stores the frames to within this tolerance in a
+             * fraction of the space. Read it back with hdf_series_reader.
+             */
+            T tolerance = T{0};
+            //! With a tolerance, the number of frames from one whole (key) frame to the next
+            unsigned int keyframe_interval = 32;
+            //! Dataset paths and the values to write to them
+            std::vector<std::pair<std::string, std::vector<T>>> datasets;
+
+            //! Add a dataset, moving its values in
+            void add (const std::string& path, std::vector<T>&& vals) { this->datasets.emplace_back (path, std::move (vals)); }
+            //! Add a dataset, copying its values
+            void add (const std::string& path, const std::vector<T>& vals) { this->datasets.emplace_back (path, vals); }
+
+            //! The number of bytes of values held
+            std::size_t bytes() const
+            {
+                std::size_t b = 0;
+                for (auto& d : this->datasets) { b += d.second.size() * sizeof (T); }
+                return b;
+            }
+        };
+
+        hdf_writer (const std::size_t _max_bytes = std::size_t{256} << 20) : max_bytes(_max_bytes)
+        {
+            this->worker = std::thread (&hdf_writer<T>::run, this);
+        }
+
+        ~hdf_writer()
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->stopping = true;
+            }
+            this->cv_work.notify_one();
+            if (this->worker.joinable()) { this->worker.join(); }
+        }
+
+        hdf_writer (const hdf_writer&) = delete;
+        hdf_writer& operator= (const hdf_writer&) = delete;
+
+        //! Queue a snapshot to be written. Blocks while the queue is too full to take it.
+        void push (job&& j)
+        {
+            const std::size_t jb = j.bytes();
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_space.wait (lk, [this, jb] { return this->jobs.empty() || this->queued_bytes + jb <= this->max_bytes; });
+            this->queued_bytes += jb;
+            this->jobs.push_back (std::move (j));
+            lk.unlock();
+            this->cv_work.notify_one();
+        }
+
+        //! Block until every snapshot pushed so far has been written and its file closed
+        void wait()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_idle.wait (lk, [this] { return this->jobs.empty() && !this->busy; });
+        }
+
+        //! The number of snapshots waiting to be written (not counting the one being written now)
+        std::size_t queued()
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            return this->jobs.size();
+        }
+
+        //! The number of snapshots that failed to write
+        std::size_t errors()
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            return this->nerrors;
+        }
+
+    private:
+        //! Write one job. In append mode, the file is kept open for the jobs that follow.
+        void write (const job& j)
+        {
+            if (!j.append || (this->appendfile && this->appendname != j.filename)) { this->appendfile.reset(); }
+            if (j.append) {
+                if (!this->appendfile) {
+                    FileAccess fa = std::filesystem::exists (j.filename) ? FileAccess::ReadWrite : FileAccess::TruncateWrite;
+                    this->appendfile = std::make_unique<HdfData> (j.filename, fa);
+                    this->appendname = j.filename;
+                }
+                this->appendfile->compression = j.compression;
+                for (auto& d : j.datasets) {
+                    if (j.tolerance > T{0}) {
+                        this->series_for (j, d.first).append (*this->appendfile, d.second);
+                    } else {
+                        this->appendfile->append_vals (d.first.c_str(), d.second);
+                    }
+                }
+            } else {
+                HdfData data (j.filename, FileAccess::TruncateWrite);
+                data.compression = j.compression;
+                for (auto& d : j.datasets) { data.add_contained_vals (d.first.c_str(), d.second); }
+            }
+        }
+
+        //! The series writer for dataset dpath of the file being appended to, made on first use
+        hdf_series_writer<T>& series_for (const job& j, const std::string& dpath)
+        {
+            if (this->seriesname != j.filename) {
+                this->series.clear();
+                this->seriesname = j.filename;
+            }
+            auto si = this->series.find (dpath);
+            if (si == this->series.end()) {
+                si = this->series.emplace (dpath, hdf_series_writer<T>(dpath, j.tolerance, j.keyframe_interval)).first;
+            }
+            return si->second;
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            for (;;) {
+                this->cv_work.wait (lk, [this] { return this->stopping || !this->jobs.empty(); });
+                if (this->jobs.empty()) { break; } // stopping, and nothing is left to write
+                job j = std::move (this->jobs.front());
+                this->jobs.pop_front();
+                this->busy = true;
+                lk.unlock();
+
+                bool failed = false;
+                try {
+                    this->write (j);
+                } catch (const std::exception& e) {
+                    std::cerr << "hdf_writer: failed to write " << j.filename << ": " << e.what() << std::endl;
+                    this->appendfile.reset();
+                    // A series may be part written, so pick it up again from the file
+                    this->series.clear();
+                    failed = true;
+                }
+
+                lk.lock();
+                // The job's memory is released only now, so count it until here
+                this->queued_bytes -= j.bytes();
+                if (failed) { ++this->nerrors; }
+                if (this->jobs.empty()) {
+                    // Idle, so close any file left open for appending
+                    lk.unlock();
+                    this->appendfile.reset();
+                    lk.lock();
+                    this->busy = false;
+                    this->cv_idle.notify_all();
+                }
+                this->cv_space.notify_one();
+            }
+            this->appendfile.reset();
+        }
+
+        std::size_t max_bytes = std::size_t{256} << 20;
+        std::size_t queued_bytes = 0;
+        std::deque<job> jobs;
+        bool busy = false;
+        bool stopping = false;
+        std::size_t nerrors = 0;
+        //! Only the worker thread touches these
+        std::unique_ptr<HdfData> appendfile;
+        std::string appendname;
+        //! The series being appended to in the file seriesname, by dataset path
+        std::map<std::string, hdf_series_writer<T>> series;
+        std::string seriesname;
+        std::mutex m;
+        std::condition_variable cv_work;
+        std::condition_variable cv_space;
+        std::condition_variable cv_idle;
+        std::thread worker;
+    };
+
+} // namespace morph
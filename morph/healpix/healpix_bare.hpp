@@ -28,6 +28,11 @@
 #include <cstdint>
 #include <cassert>
 #include <algorithm>
+#include <array>
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <stdexcept>
 #include <morph/mathconst.h>
 
 // The healpix namespace contains code from the HEALPix C library, slightly modified.
@@ -431,4 +436,462 @@ namespace hp {
         return hp::loc2vec (hp::hpd2loc (nside, hp::nest2hpd (nside, ipix)));
     }
 
+    /*
+     * Batch conversions. These convert a whole span of pixels (or angles) in one call. The
+     * branches of the scalar code above are replaced by selects and small table lookups, so
+     * that the loops vectorise across pixels, and spans of at least batch_parallel_min
+     * elements are shared between threads when OpenMP is enabled. nside must be a power of
+     * 2 and the output span must be the same size as the input span. The batch RING
+     * conversions use a ring_table, which holds the per-ring quantities that the scalar code
+     * recomputes for every pixel; build it once for an nside and reuse it. (The RING to NEST
+     * and RING to angle loops only vectorise with -fno-math-errno, because of the sqrt that
+     * finds a pixel's ring.)
+     */
+
+    //! Spans shorter than this are converted on the calling thread
+    constexpr std::size_t batch_parallel_min = 1 << 15;
+
+    namespace batch_detail {
+
+        inline int ilog2 (int64_t nside)
+        {
+            if (nside < 1 || (nside & (nside - 1)) != 0) { throw std::runtime_error ("hp: nside must be a power of 2"); }
+            int lg = 0;
+            while ((int64_t{1} << lg) < nside) { ++lg; }
+            return lg;
+        }
+
+        inline void check_sizes (std::size_t n_in, std::size_t n_out)
+        {
+            if (n_in != n_out) { throw std::runtime_error ("hp: batch input and output spans differ in size"); }
+        }
+
+        // jrll[f] and jpll[f], computed rather than looked up
+        inline int64_t jrll_of (int64_t f) { return 2 + (f >> 2); }
+        inline int64_t jpll_of (int64_t f) { return 2 * (f & 3) + 1 - ((f >> 2) & 1); }
+
+        // isqrt with its corrections done by selects, so that it is exact for any v
+        inline int64_t isqrt_bf (int64_t v)
+        {
+            int64_t res = static_cast<int64_t>(std::sqrt (std::fabs (static_cast<double>(v) + 0.5)));
+            res -= (res * res > v) ? 1 : 0;
+            res += ((res + 1) * (res + 1) <= v) ? 1 : 0;
+            return res;
+        }
+
+        // loc2hpd (nside, ang2loc (theta, phi)) without branches. This does the same floating
+        // point operations as the scalar code, so the pixels agree exactly.
+        inline t_hpd ang2hpd (int64_t nside, double theta, double phi)
+        {
+            const double z = std::cos (theta);
+            double s = std::sin (theta);
+            phi += s < 0.0 ? morph::mathconst<double>::pi : 0.0;
+            s = std::fabs (s);
+            const double za = std::fabs (z);
+            double x = phi * morph::mathconst<double>::one_over_two_pi;
+            x -= std::floor (x);
+            const double tt = 4.0 * x;
+            // Equatorial region
+            const double temp1 = 0.5 + tt;
+            const double temp2 = z * 0.75;
+            const double ejp = temp1 - temp2;
+            const double ejm = temp1 + temp2;
+            const int32_t ifp = static_cast<int32_t>(ejp);
+            const int32_t ifm = static_cast<int32_t>(ejm);
+            const double ex = ejm - ifm;
+            const double ey = 1 + ifp - ejp;
+            const int32_t ef = (ifp == ifm) ? (ifp | 4) : ((ifp < ifm) ? ifp : (ifm + 8));
+            // Polar caps
+            int32_t ntt = static_cast<int32_t>(tt);
+            ntt = ntt >= 4 ? 3 : ntt;
+            const double tp = tt - ntt;
+            const double tmp = s / std::sqrt ((1.0 + za) / 3.0);
+            const double pjp = std::min (tp * tmp, 1.0);
+            const double pjm = std::min ((1.0 - tp) * tmp, 1.0);
+            const bool north = z >= 0;
+            const double px = north ? 1.0 - pjm : pjp;
+            const double py = north ? 1.0 - pjp : pjm;
+            const int32_t pf = north ? ntt : ntt + 8;
+
+            const bool eq = za <= 2.0 / 3.0;
+            return t_hpd{ static_cast<int64_t>((eq ? ex : px) * nside), static_cast<int64_t>((eq ? ey : py) * nside), eq ? ef : pf };
+        }
+
+        // hpd2nest, with nside = 1 << lg
+        inline int64_t hpd2nest (int lg, int64_t x, int64_t y, int64_t f)
+        {
+            return (f << (2 * lg)) + hp::spread_bits (x) + (hp::spread_bits (y) << 1);
+        }
+
+        // The ring number (1 to 4 nside - 1) and the 1-based position within the ring of
+        // pixel (x, y, f), as in hpd2ring
+        inline void hpd2ringpos (int64_t nside, int64_t x, int64_t y, int64_t f, int64_t& jr, int64_t& jp)
+        {
+            const int64_t nl4 = 4 * nside;
+            jr = (jrll_of (f) * nside) - x - y - 1;
+            const bool north = jr < nside;
+            const bool south = jr > 3 * nside;
+            const int64_t nr = north ? jr : (south ? nl4 - jr : nside);
+            const int64_t kshift = (north || south) ? 0 : ((jr - nside) & 1);
+            jp = (jpll_of (f) * nr + x - y + 1 + kshift) / 2;
+            jp = (jp > nl4) ? jp - nl4 : ((jp < 1) ? jp + nl4 : jp);
+        }
+
+        // The ring number (1 to 4 nside - 1, counted from the North pole) of RING pixel pix
+        inline int64_t ring_of (int64_t nside, int lg, int64_t pix)
+        {
+            const int64_t ncap = 2 * nside * (nside - 1);
+            const int64_t npix = 12 * nside * nside;
+            const bool north = pix < ncap;
+            const bool south = pix >= npix - ncap;
+            // The South cap mirrors the North cap
+            const int64_t pc = south ? npix - 1 - pix : pix;
+            const int64_t icap = (1 + isqrt_bf (1 + 2 * pc)) >> 1;
+            const int64_t ieq = ((pix - ncap) >> (lg + 2)) + nside;
+            return north ? icap : (south ? 4 * nside - icap : ieq);
+        }
+
+        // The pixel offsets of the 8 neighbours, in the order SW, W, NW, N, NE, E, SE, S
+        static const int xoffset[] = { -1,-1, 0, 1, 1, 1, 0,-1 };
+        static const int yoffset[] = {  0, 1, 1, 1, 0,-1,-1,-1 };
+        // The face of the neighbour, by which of the 9 faces around face f (SW to NE, in
+        // steps of 1 in x and 3 in y) it falls in. -1 where there is no pixel.
+        static const int facearray[][12] =
+        { {  8, 9,10,11,-1,-1,-1,-1,10,11, 8, 9 },   // S
+          {  5, 6, 7, 4, 8, 9,10,11, 9,10,11, 8 },   // SE
+          { -1,-1,-1,-1, 5, 6, 7, 4,-1,-1,-1,-1 },   // E
+          {  4, 5, 6, 7,11, 8, 9,10,11, 8, 9,10 },   // SW
+          {  0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11 },   // centre
+          {  1, 2, 3, 0, 0, 1, 2, 3, 5, 6, 7, 4 },   // NE
+          { -1,-1,-1,-1, 7, 4, 5, 6,-1,-1,-1,-1 },   // W
+          {  3, 0, 1, 2, 3, 0, 1, 2, 4, 5, 6, 7 },   // NW
+          {  2, 3, 0, 1,-1,-1,-1,-1, 0, 1, 2, 3 } }; // N
+        // How (x, y) transform on crossing into the neighbouring face, by the row of f (f/4):
+        // bit 1 flips x, bit 2 flips y and bit 4 swaps x and y
+        static const int swaparray[][3] =
+        { { 0,0,3 },   // S
+          { 0,0,6 },   // SE
+          { 0,0,0 },   // E
+          { 0,0,5 },   // SW
+          { 0,0,0 },   // centre
+          { 5,0,0 },   // NE
+          { 0,0,0 },   // W
+          { 6,0,0 },   // NW
+          { 3,0,0 } }; // N
+
+        // The NEST neighbour of (ix, iy, f) in direction d
+        inline int64_t neighbour (int64_t nside, int lg, int64_t ix, int64_t iy, int f, int d)
+        {
+            int64_t x = ix + xoffset[d];
+            int64_t y = iy + yoffset[d];
+            const int nbnum = 4 - (x < 0 ? 1 : 0) + (x >= nside ? 1 : 0) - (y < 0 ? 3 : 0) + (y >= nside ? 3 : 0);
+            // x and y are in [-1, nside], so the mask wraps them into the neighbouring face
+            x &= nside - 1;
+            y &= nside - 1;
+            const int nf = facearray[nbnum][f];
+            const int bits = swaparray[nbnum][f >> 2];
+            x = (bits & 1) ? nside - x - 1 : x;
+            y = (bits & 2) ? nside - y - 1 : y;
+            const int64_t sx = (bits & 4) ? y : x;
+            const int64_t sy = (bits & 4) ? x : y;
+            return nf < 0 ? -1 : hpd2nest (lg, sx, sy, nf);
+        }
+    } // namespace batch_detail
+
+    /*!
+     * Per-ring tables for the RING scheme at resolution nside, indexed by ring number - 1.
+     * Rings are numbered from 1 at the North pole to 4 nside - 1 at the South pole.
+     */
+    struct ring_table
+    {
+        explicit ring_table (int64_t _nside)
+            : nside (_nside)
+            , lg (batch_detail::ilog2 (_nside))
+        {
+            const int64_t n_rings = 4 * nside - 1;
+            this->startpix.resize (n_rings);
+            this->nr.resize (n_rings);
+            this->theta.resize (n_rings);
+            this->z.resize (n_rings);
+            this->phi0.resize (n_rings);
+            this->dphi.resize (n_rings);
+            const int64_t ncap = 2 * nside * (nside - 1);
+            const int64_t npix = 12 * nside * nside;
+            const double fact = 1.0 / (3.0 * nside * nside);
+            for (int64_t i = 1; i <= n_rings; ++i) {
+                const int64_t r = i - 1;
+                double zz = 0.0;
+                double ss = 0.0;
+                if (i < nside || i > 3 * nside) { // Polar caps
+                    const int64_t q = i < nside ? i : 4 * nside - i;
+                    const double tmp = q * q * fact;
+                    zz = i < nside ? 1.0 - tmp : tmp - 1.0;
+                    ss = std::sqrt (tmp * (2.0 - tmp));
+                    this->nr[r] = q;
+                    this->startpix[r] = i < nside ? 2 * q * (q - 1) : npix - 2 * q * (q + 1);
+                    this->phi0[r] = morph::mathconst<double>::pi_over_4 / q;
+                } else { // Equatorial region
+                    zz = (2 * nside - i) * 2.0 / (3.0 * nside);
+                    ss = std::sqrt ((1.0 + zz) * (1.0 - zz));
+                    this->nr[r] = nside;
+                    this->startpix[r] = ncap + (i - nside) * 4 * nside;
+                    this->phi0[r] = ((i + nside) & 1) ? 0.0 : morph::mathconst<double>::pi_over_4 / nside;
+                }
+                this->z[r] = zz;
+                this->theta[r] = std::atan2 (ss, zz);
+                this->dphi[r] = morph::mathconst<double>::pi_over_2 / this->nr[r];
+            }
+        }
+
+        int64_t nside = 0;
+        //! log2 (nside)
+        int lg = 0;
+        //! The RING index of the first pixel in each ring
+        std::vector<int64_t> startpix;
+        //! The number of pixels in each quarter of each ring (there are 4 * nr pixels in a ring)
+        std::vector<int64_t> nr;
+        //! The co-latitude and the cos of the co-latitude of each ring
+        std::vector<double> theta;
+        std::vector<double> z;
+        //! The azimuth of the first pixel in each ring and the azimuth between neighbouring pixels
+        std::vector<double> phi0;
+        std::vector<double> dphi;
+    };
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch nest2ring.
+     */
+    inline void nest2ring (const ring_table& rt, std::span<const int64_t> ipnest, std::span<int64_t> ipring)
+    {
+        batch_detail::check_sizes (ipnest.size(), ipring.size());
+        const int64_t nside = rt.nside;
+        const int lg = rt.lg;
+        const int64_t* start = rt.startpix.data();
+        const int64_t mask = (int64_t{1} << (2 * lg)) - 1;
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipnest.size());
+#pragma omp parallel for simd schedule(static) if(parallel: ipnest.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t p = ipnest[i];
+            const int64_t p2 = p & mask;
+            int64_t jr = 0;
+            int64_t jp = 0;
+            batch_detail::hpd2ringpos (nside, hp::compress_bits (p2), hp::compress_bits (p2 >> 1), p >> (2 * lg), jr, jp);
+            ipring[i] = start[jr - 1] + jp - 1;
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch ring2nest.
+     */
+    inline void ring2nest (const ring_table& rt, std::span<const int64_t> ipring, std::span<int64_t> ipnest)
+    {
+        batch_detail::check_sizes (ipring.size(), ipnest.size());
+        const int64_t nside = rt.nside;
+        const int lg = rt.lg;
+        const int64_t* start = rt.startpix.data();
+        const int64_t* nrs = rt.nr.data();
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipring.size());
+#pragma omp parallel for simd schedule(static) if(parallel: ipring.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t p = ipring[i];
+            const int64_t iring = batch_detail::ring_of (nside, lg, p);
+            const int64_t iphi = p - start[iring - 1] + 1;
+            const int64_t nr = nrs[iring - 1];
+            const bool north = iring < nside;
+            const bool cap = north | (iring > 3 * nside);
+            // In the caps, the face is the quarter of the ring that the pixel lies in
+            const int64_t q = iphi - 1;
+            const int64_t cface = (q >= nr ? 1 : 0) + (q >= 2 * nr ? 1 : 0) + (q >= 3 * nr ? 1 : 0) + (north ? 0 : 8);
+            // In the equatorial region, it is found from the edge lines through the pixel. ire
+            // and irm are positive there, so they are halved with shifts.
+            const int64_t ire = iring - nside + 1;
+            const int64_t irm = 2 * nside + 2 - ire;
+            const int64_t ifm = (iphi - (ire >> 1) + nside - 1) >> lg;
+            const int64_t ifp = (iphi - (irm >> 1) + nside - 1) >> lg;
+            const int64_t eface = (ifp == ifm) ? (ifp | 4) : ((ifp < ifm) ? ifp : (ifm + 8));
+            const int64_t face = cap ? cface : eface;
+            const int64_t kshift = cap ? 0 : ((iring + nside) & 1);
+            const int64_t irt = iring - (batch_detail::jrll_of (face) * nside) + 1;
+            int64_t ipt = 2 * iphi - batch_detail::jpll_of (face) * nr - kshift - 1;
+            ipt -= (ipt >= 2 * nside) ? 8 * nside : 0;
+            ipnest[i] = batch_detail::hpd2nest (lg, (ipt - irt) >> 1, (-(ipt + irt)) >> 1, face);
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch ang2ring. The pixels are the same as those from the scalar ang2ring.
+     */
+    inline void ang2ring (const ring_table& rt, std::span<const t_ang> ang, std::span<int64_t> ipring)
+    {
+        batch_detail::check_sizes (ang.size(), ipring.size());
+        const int64_t nside = rt.nside;
+        const int64_t* start = rt.startpix.data();
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ang.size());
+#pragma omp parallel for schedule(static) if(ang.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const t_hpd h = batch_detail::ang2hpd (nside, ang[i].theta, ang[i].phi);
+            int64_t jr = 0;
+            int64_t jp = 0;
+            batch_detail::hpd2ringpos (nside, h.x, h.y, h.f, jr, jp);
+            ipring[i] = start[jr - 1] + jp - 1;
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch ang2nest. The pixels are the same as those from the scalar ang2nest.
+     */
+    inline void ang2nest (int64_t nside, std::span<const t_ang> ang, std::span<int64_t> ipnest)
+    {
+        batch_detail::check_sizes (ang.size(), ipnest.size());
+        const int lg = batch_detail::ilog2 (nside);
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ang.size());
+#pragma omp parallel for schedule(static) if(ang.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const t_hpd h = batch_detail::ang2hpd (nside, ang[i].theta, ang[i].phi);
+            ipnest[i] = batch_detail::hpd2nest (lg, h.x, h.y, h.f);
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch ring2ang. The centres are looked up from the ring table, so they agree with
+     * the scalar ring2ang to a few ulp, but with phi always in [0, 2pi).
+     */
+    inline void ring2ang (const ring_table& rt, std::span<const int64_t> ipring, std::span<t_ang> ang)
+    {
+        batch_detail::check_sizes (ipring.size(), ang.size());
+        const int64_t nside = rt.nside;
+        const int lg = rt.lg;
+        const int64_t* start = rt.startpix.data();
+        const double* th = rt.theta.data();
+        const double* p0 = rt.phi0.data();
+        const double* dp = rt.dphi.data();
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipring.size());
+#pragma omp parallel for simd schedule(static) if(parallel: ipring.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t r = batch_detail::ring_of (nside, lg, ipring[i]) - 1;
+            ang[i].theta = th[r];
+            ang[i].phi = p0[r] + static_cast<double>(ipring[i] - start[r]) * dp[r];
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch nest2ang, with the centres looked up from the ring table as for the batch
+     * ring2ang.
+     */
+    inline void nest2ang (const ring_table& rt, std::span<const int64_t> ipnest, std::span<t_ang> ang)
+    {
+        batch_detail::check_sizes (ipnest.size(), ang.size());
+        const int64_t nside = rt.nside;
+        const int lg = rt.lg;
+        const double* th = rt.theta.data();
+        const double* p0 = rt.phi0.data();
+        const double* dp = rt.dphi.data();
+        const int64_t mask = (int64_t{1} << (2 * lg)) - 1;
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipnest.size());
+#pragma omp parallel for simd schedule(static) if(parallel: ipnest.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t p = ipnest[i];
+            const int64_t p2 = p & mask;
+            int64_t jr = 0;
+            int64_t jp = 0;
+            batch_detail::hpd2ringpos (nside, hp::compress_bits (p2), hp::compress_bits (p2 >> 1), p >> (2 * lg), jr, jp);
+            ang[i].theta = th[jr - 1];
+            ang[i].phi = p0[jr - 1] + static_cast<double>(jp - 1) * dp[jr - 1];
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch ring2vec, giving the same normalized 3-vectors as ring2vec.
+     */
+    inline void ring2vec (const ring_table& rt, std::span<const int64_t> ipring, std::span<t_vec> vec)
+    {
+        batch_detail::check_sizes (ipring.size(), vec.size());
+        const int64_t nside = rt.nside;
+        const int lg = rt.lg;
+        const int64_t* start = rt.startpix.data();
+        const double* zs = rt.z.data();
+        const double* th = rt.theta.data();
+        const double* p0 = rt.phi0.data();
+        const double* dp = rt.dphi.data();
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipring.size());
+#pragma omp parallel for schedule(static) if(ipring.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t r = batch_detail::ring_of (nside, lg, ipring[i]) - 1;
+            const double phi = p0[r] + static_cast<double>(ipring[i] - start[r]) * dp[r];
+            const double s = std::sin (th[r]);
+            vec[i] = t_vec{ s * std::cos (phi), s * std::sin (phi), zs[r] };
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch nest2vec, giving the same normalized 3-vectors as nest2vec.
+     */
+    inline void nest2vec (const ring_table& rt, std::span<const int64_t> ipnest, std::span<t_vec> vec)
+    {
+        batch_detail::check_sizes (ipnest.size(), vec.size());
+        const int64_t nside = rt.nside;
+        const int lg = rt.lg;
+        const double* zs = rt.z.data();
+        const double* th = rt.theta.data();
+        const double* p0 = rt.phi0.data();
+        const double* dp = rt.dphi.data();
+        const int64_t mask = (int64_t{1} << (2 * lg)) - 1;
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipnest.size());
+#pragma omp parallel for schedule(static) if(ipnest.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t p = ipnest[i];
+            const int64_t p2 = p & mask;
+            int64_t jr = 0;
+            int64_t jp = 0;
+            batch_detail::hpd2ringpos (nside, hp::compress_bits (p2), hp::compress_bits (p2 >> 1), p >> (2 * lg), jr, jp);
+            const double phi = p0[jr - 1] + static_cast<double>(jp - 1) * dp[jr - 1];
+            const double s = std::sin (th[jr - 1]);
+            vec[i] = t_vec{ s * std::cos (phi), s * std::sin (phi), zs[jr - 1] };
+        }
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Returns the 8 neighbours of NEST pixel \a ipnest at resolution \a nside, in the order
+     * SW, W, NW, N, NE, E, SE, S. At the 8 corners where only three base faces meet, the
+     * pixels beside the corner have one neighbour fewer, which is given as -1.
+     */
+    inline std::array<int64_t, 8> neighbours (int64_t nside, int64_t ipnest)
+    {
+        const int lg = batch_detail::ilog2 (nside);
+        const t_hpd h = hp::nest2hpd (nside, ipnest);
+        std::array<int64_t, 8> nb;
+        for (int d = 0; d < 8; ++d) { nb[d] = batch_detail::neighbour (nside, lg, h.x, h.y, h.f, d); }
+        return nb;
+    }
+
+    /*!
+     * PUBLIC INTERFACE
+     * Batch neighbours, with 8 neighbours per NEST pixel in the same order as neighbours().
+     */
+    inline void neighbours (int64_t nside, std::span<const int64_t> ipnest, std::span<std::array<int64_t, 8>> nb)
+    {
+        batch_detail::check_sizes (ipnest.size(), nb.size());
+        const int lg = batch_detail::ilog2 (nside);
+        const int64_t mask = (int64_t{1} << (2 * lg)) - 1;
+        const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(ipnest.size());
+#pragma omp parallel for schedule(static) if(ipnest.size() >= batch_parallel_min)
+        for (std::ptrdiff_t i = 0; i < n; ++i) {
+            const int64_t p = ipnest[i];
+            const int64_t p2 = p & mask;
+            const int64_t x = hp::compress_bits (p2);
+            const int64_t y = hp::compress_bits (p2 >> 1);
+            const int f = static_cast<int>(p >> (2 * lg));
+            for (int d = 0; d < 8; ++d) { nb[i][d] = batch_detail::neighbour (nside, lg, x, y, f, d); }
+        }
+    }
+
 } // namespace hp (for healpix)
@@ -7,6 +7,8 @@
 #include <morph/vvec.h>
 #include <morph/HexGrid.h>
 #include <utility>
+#include <vector>
+#include <limits>
 
 namespace morph {
 
@@ -15,32 +17,56 @@ namespace morph {
     {
         // Data is a vvec of coordinates. data[2] is ignored. hg is a hex grid, assumed to be in
         // same coordinate frame as data.
-        hexyhisto (const morph::vvec<morph::vec<T>>& data, HexGrid* hg)
+        hexyhisto (const morph::vvec<morph::vec<T>>& data, HexGrid* hg) : hexyhisto (hg)
         {
-            unsigned int n = hg->num();
-            this->counts.resize(n, 0);
+            this->add (data);
+            // Now just plot hexyhisto::proportions on your HexGrid. Simples.
+        }
+
+        // An empty histogram on hg. Add data to it with add().
+        hexyhisto (HexGrid* _hg) : hg(_hg)
+        {
+            unsigned int n = this->hg->num();
+            this->counts.resize(n, T{0});
             this->proportions.resize(n, T{0});
+        }
 
-            // For each coordinate, add it to a hex
-            for (const morph::vec<T, 3>& datum : data) {
-                if (datum[2] < 0.0f) { continue; }
-                // if datum is in a hex hi, then counts[hi->vg] += T{1};
-                auto hi = hg->findHexNearest (datum.less_one_dim());
+        // Add the coordinates in data to the histogram and recompute proportions. Coordinates with
+        // data[2] < 0 are skipped, as are those further than HexGrid::getv() from the nearest
+        // hex. The nearest hexes are found in parallel, using the HexGrid's spatial index.
+        void add (const morph::vvec<morph::vec<T>>& data)
+        {
+            if (data.empty() || this->counts.empty()) { return; }
+            const int nd = static_cast<int>(data.size());
+            const T v = static_cast<T>(this->hg->getv());
+            constexpr unsigned int no_hex = std::numeric_limits<unsigned int>::max();
+            std::vector<unsigned int> hex_of (data.size(), no_hex);
 
+            // The first lookup builds the HexGrid's index, which the parallel loop then only reads
+            this->hg->findHexNearest (data[0].less_one_dim().template as<float>());
+#pragma omp parallel for
+            for (int i = 0; i < nd; ++i) {
+                const morph::vec<T>& datum = data[i];
+                if (datum[2] < T{0}) { continue; }
+                // if datum is in a hex hi, then counts[hi->vi] += T{1};
+                auto hi = this->hg->findHexNearest (datum.less_one_dim().template as<float>());
                 // dist from hi to datum:
-                morph::vec<T> hipos = { hi->x, hi->y, 0 };
+                morph::vec<T> hipos = { static_cast<T>(hi->x), static_cast<T>(hi->y), T{0} };
                 T _d = (hipos - datum).length();
-                if (_d <= hg->getv()) {
-                    counts[hi->vi] += T{1};
-                    //std::cout << "crossing at " << datum << " has nearest hex: " << hi->outputXY() << " for which count = " << counts[hi->vi] << std::endl;
-                    this->datacount++;
-                }
+                if (_d <= v) { hex_of[i] = hi->vi; }
+            }
+
+            for (unsigned int hvi : hex_of) {
+                if (hvi == no_hex) { continue; }
+                this->counts[hvi] += T{1};
+                this->datacount++;
+            }
+            if (this->datacount > T{0}) {
+                this->proportions = this->counts / this->datacount;
             }
-            this->proportions = counts.as_float();
-            this->proportions /= this->datacount;
-            // Now just plot hexyhisto::proportions on your HexGrid. Simples.
         }
 
+        HexGrid* hg = nullptr;
         T datacount = T{0}; // how many elements were there in data?
         morph::vvec<T> counts;
         morph::vvec<T> proportions;
@@ -8,6 +8,13 @@
 #include <morph/range.h>
 #include <morph/MathAlgo.h>
 #include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
 
 namespace morph {
 
@@ -76,6 +83,20 @@ namespace morph {
             this->init (data, n, manual_datarange);
         }
 
+        /*!
+         * Constructor for an empty histogram with a fixed data range, to which data are added,
+         * perhaps as they arrive, with add().
+         *
+         * \param n The number of bins to sort the data values into
+         *
+         * \param manual_datarange The range of the data. Data outside this range can't be added.
+         */
+        histo (std::size_t n, const morph::range<H>& manual_datarange)
+        {
+            this->datarange = manual_datarange;
+            this->setup_bins (n);
+        }
+
         /*!
          * Histogram computation common to both constructors
          *
@@ -97,11 +118,6 @@ namespace morph {
         template < template <typename, typename> typename Container, typename Allocator=std::allocator<H> >
         void init (const Container<H, Allocator>& data, std::size_t n, const morph::range<H>& manual_datarange)
         {
-            this->bins.resize (n, T{0});
-            this->binedges.resize (n + 1U, T{0});
-            this->counts.resize (n, 0u);
-            this->proportions.resize (n, T{0});
-            this->datacount = static_cast<T>(data.size());
             // Compute bin widths from range of data and n.
             if (manual_datarange.min == std::numeric_limits<H>::max()
                 && manual_datarange.max == std::numeric_limits<H>::max()) {
@@ -114,37 +130,86 @@ namespace morph {
                 }
                 this->datarange = manual_datarange;
             }
-            if (this->datarange.span() == H{0}) {
-                throw std::runtime_error ("morph::histo: range span is 0, can't make a histogram");
-            }
-            T d_span = static_cast<T>(this->datarange.span());
-            this->binwidth = d_span / static_cast<T>(n);
-            for (std::size_t i = 0; i < n; ++i) {
-                // bins[i] = min + i*bw + bw/2 but do the additions after the loop
-                this->bins[i] = i * this->binwidth;
-                this->binedges[i + 1U] = (i + 1U) * this->binwidth;
-            }
-            this->bins += (this->datarange.min + (this->binwidth/T{2}));
-            this->binedges += this->datarange.min;
-
-            // Compute counts
-            for (auto datum : data) {
-                T bin_proportion = static_cast<T>(datum - this->datarange.min) / d_span;
-                if (std::abs(bin_proportion - T{1}) < std::numeric_limits<T>::epsilon()) {
-                    // Edge case, right on t'limit. Place in last bin.
-                    this->counts[n-1] += 1u;
+            this->setup_bins (n);
+            this->add (data);
+        }
 
-                } else if (bin_proportion > T{1}) {
-                    throw std::runtime_error ("morph::histo: shouldn't see proportion > 1");
+        /*!
+         * Add the values in data to the histogram, without changing the bins. All of data must
+         * lie within datarange (else a runtime_error is thrown and the histogram is not changed),
+         * so this is for use with the (n, manual_datarange) constructor, or the data constructor
+         * with a manual_datarange.
+         *
+         * For large, random access containers, the values are binned by several threads, each
+         * into its own set of counts, and the counts are summed at the end.
+         */
+        template < template <typename, typename> typename Container, typename Allocator=std::allocator<H> >
+        void add (const Container<H, Allocator>& data)
+        {
+            const std::size_t n = this->counts.size();
+            std::vector<std::size_t> batch_counts (n, 0u);
+            bool outside = false;
 
+            using iter_cat = typename std::iterator_traits<typename Container<H, Allocator>::const_iterator>::iterator_category;
+            if constexpr (std::is_base_of<std::random_access_iterator_tag, iter_cat>::value) {
+                const std::size_t dsz = data.size();
+                if (dsz >= histo<H, T>::parallel_threshold) {
+#pragma omp parallel
+                    {
+                        std::vector<std::size_t> local_counts (n, 0u);
+                        bool local_outside = false;
+#pragma omp for nowait
+                        for (std::size_t i = 0; i < dsz; ++i) {
+                            const std::size_t idx = this->bin_index (data[i]);
+                            if (idx < n) { local_counts[idx] += 1u; } else { local_outside = true; }
+                        }
+#pragma omp critical
+                        {
+                            for (std::size_t j = 0; j < n; ++j) { batch_counts[j] += local_counts[j]; }
+                            outside = outside || local_outside;
+                        }
+                    }
                 } else {
-                    std::size_t idx = static_cast<std::size_t>(std::floor(bin_proportion * n));
-                    this->counts[idx] += 1u;
+                    for (auto datum : data) {
+                        const std::size_t idx = this->bin_index (datum);
+                        if (idx < n) { batch_counts[idx] += 1u; } else { outside = true; }
+                    }
+                }
+            } else {
+                for (auto datum : data) {
+                    const std::size_t idx = this->bin_index (datum);
+                    if (idx < n) { batch_counts[idx] += 1u; } else { outside = true; }
                 }
             }
-            this->proportions = counts.as<T>()/this->datacount;
+
+            if (outside) {
+                throw std::runtime_error ("morph::histo: data lies outside the histogram's datarange");
+            }
+            for (std::size_t j = 0; j < n; ++j) { this->counts[j] += batch_counts[j]; }
+            this->datacount += data.size();
+            if (this->datacount > 0u) {
+                this->proportions = this->counts.template as<T>() / static_cast<T>(this->datacount);
+            }
         }
 
+        //! \return the bin for datum, or the number of bins if datum is outside datarange
+        std::size_t bin_index (const H datum) const
+        {
+            const std::size_t n = this->counts.size();
+            const T d_span = static_cast<T>(this->datarange.span());
+            T bin_proportion = static_cast<T>(datum - this->datarange.min) / d_span;
+            if (std::abs(bin_proportion - T{1}) < std::numeric_limits<T>::epsilon()) {
+                // Edge case, right on t'limit. Place in last bin.
+                return n - 1;
+            } else if (bin_proportion > T{1} || bin_proportion < T{0} || !std::isfinite (bin_proportion)) {
+                return n;
+            }
+            return std::min (static_cast<std::size_t>(std::floor(bin_proportion * n)), n - 1);
+        }
+
+        //! The number of data values at which add() bins in parallel
+        static constexpr std::size_t parallel_threshold = 65536;
+
         //! The max and min of the histogram data. Computed in constructor.
         morph::range<H> datarange;
         //! how many elements were there in data?
@@ -161,5 +226,30 @@ namespace morph {
         morph::vvec<std::size_t> counts;
         //! The counts as proportions for each bin. n elements.
         morph::vvec<T> proportions;
+
+    private:
+        //! Size the containers for n bins, zero the counts and compute the bin centres and edges
+        //! from datarange
+        void setup_bins (std::size_t n)
+        {
+            if (n == 0u) { throw std::runtime_error ("morph::histo: need at least one bin"); }
+            if (this->datarange.span() == H{0}) {
+                throw std::runtime_error ("morph::histo: range span is 0, can't make a histogram");
+            }
+            this->bins.assign (n, T{0});
+            this->binedges.assign (n + 1U, T{0});
+            this->counts.assign (n, 0u);
+            this->proportions.assign (n, T{0});
+            this->datacount = 0u;
+            T d_span = static_cast<T>(this->datarange.span());
+            this->binwidth = d_span / static_cast<T>(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                // bins[i] = min + i*bw + bw/2 but do the additions after the loop
+                this->bins[i] = i * this->binwidth;
+                this->binedges[i + 1U] = (i + 1U) * this->binwidth;
+            }
+            this->bins += (this->datarange.min + (this->binwidth/T{2}));
+            this->binedges += this->datarange.min;
+        }
     };
 }
@@ -0,0 +1,359 @@
+/*!
+ * \file
+ *
+ * \brief Zero-copy access to IDX format data files, such as those of the MNIST database.
+ *
+ * An IDX file is a big-endian header followed by a dense array. The header is a 4 byte magic
+ * number, 0x00 0x00 [type code] [number of dimensions], followed by one 32 bit size per
+ * dimension. Type codes are 0x08 (unsigned byte), 0x09 (signed byte), 0x0B (16 bit int), 0x0C
+ * (32 bit int), 0x0D (float) and 0x0E (double). The first dimension counts the items (images,
+ * labels, ...).
+ *
+ * morph::idx_file memory-maps a file (on Windows, where there is no mmap, it reads it into
+ * memory) and gives the items as spans of the mapped bytes. morph::idx_dataset pairs an images
+ * file with a labels file, visits the items through an index permutation (so shuffling moves no
+ * image data) and converts to float only when a mini-batch is requested.
+ *
+ *\code{.cpp}
+ * morph::idx_dataset train ("mnist/train-images-idx3-ubyte", "mnist/train-labels-idx1-ubyte");
+ * train.shuffle (seed);
+ * std::vector<float> x (train.item_size() * nb);
+ * std::vector<float> y (10 * nb);
+ * for (std::size_t b0 = 0; b0 + nb <= train.size(); b0 += nb) {
+ *     train.get_batch (b0, nb, x.data(), y.data(), 10);
+ *     // ...
+ * }
+ *\endcode
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <span>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace morph {
+
+    //! A read-only, memory-mapped IDX file
+    struct idx_file
+    {
+        //! The IDX element type codes
+        static constexpr std::uint8_t type_ubyte = 0x08;
+        static constexpr std::uint8_t type_sbyte = 0x09;
+        static constexpr std::uint8_t type_short = 0x0b;
+        static constexpr std::uint8_t type_int = 0x0c;
+        static constexpr std::uint8_t type_float = 0x0d;
+        static constexpr std::uint8_t type_double = 0x0e;
+
+        idx_file() {}
+        //! Open and map the IDX file at path
+        idx_file (const std::string& path) { this->open (path); }
+        ~idx_file() { this->close(); }
+
+        idx_file (const idx_file&) = delete;
+        idx_file& operator= (const idx_file&) = delete;
+        idx_file (idx_file&& other) noexcept { this->take (other); }
+        idx_file& operator= (idx_file&& other) noexcept
+        {
+            if (this != &other) {
+                this->close();
+                this->take (other);
+            }
+            return *this;
+        }
+
+        //! Open and map the IDX file at path and check its header against its size
+        void open (const std::string& path)
+        {
+            this->close();
+#ifndef _WIN32
+            int fd = ::open (path.c_str(), O_RDONLY);
+            if (fd < 0) { throw std::runtime_error ("idx_file: failed to open " + path); }
+            struct stat st;
+            if (fstat (fd, &st) != 0) {
+                ::close (fd);
+                throw std::runtime_error ("idx_file: failed to stat " + path);
+            }
+            this->len = static_cast<std::size_t>(st.st_size);
+            if (this->len > 0) {
+                void* p = mmap (nullptr, this->len, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    ::close (fd);
+                    throw std::runtime_error ("idx_file: failed to mmap " + path);
+                }
+                this->mapped = static_cast<const std::uint8_t*>(p);
+            }
+            ::close (fd); // The mapping holds its own reference to the file
+#else
+            std::ifstream f (path, std::ios::in | std::ios::binary | std::ios::ate);
+            if (!f.is_open()) { throw std::runtime_error ("idx_file: failed to open " + path); }
+            this->len = static_cast<std::size_t>(f.tellg());
+            this->buf.resize (this->len);
+            f.seekg (0);
+            f.read (reinterpret_cast<char*>(this->buf.data()), this->len);
+            this->mapped = this->buf.data();
+#endif
+            try {
+                this->parse_header (path);
+            } catch (const std::runtime_error&) {
+                this->close();
+                throw;
+            }
+        }
+
+        //! Unmap the file
+        void close()
+        {
+#ifndef _WIN32
+            if (this->mapped != nullptr) { munmap (const_cast<std::uint8_t*>(this->mapped), this->len); }
+#else
+            this->buf.clear();
+#endif
+            this->mapped = nullptr;
+            this->payload = nullptr;
+            this->len = 0;
+            this->dims.clear();
+            this->type = 0;
+        }
+
+        //! The sizes of the dimensions, outermost first. dims[0] is the number of items.
+        std::vector<std::uint32_t> dims;
+        //! The element type code
+        std::uint8_t type = 0;
+
+        //! The number of items
+        std::size_t size() const { return this->dims.empty() ? 0 : this->dims[0]; }
+        //! The number of elements in each item (the product of the dimensions after the first)
+        std::size_t item_size() const
+        {
+            std::size_t n = 1;
+            for (std::size_t d = 1; d < this->dims.size(); ++d) { n *= this->dims[d]; }
+            return n;
+        }
+        //! The size in bytes of one element
+        std::size_t element_bytes() const { return idx_file::type_bytes (this->type); }
+
+        //! The bytes of item i, which are in the mapped file: no copy is made
+        std::span<const std::uint8_t> item (const std::size_t i) const
+        {
+            const std::size_t ib = this->item_size() * this->element_bytes();
+            return std::span<const std::uint8_t> (this->payload + i * ib, ib);
+        }
+
+        /*!
+         * Element j of item i as a double, for any element type. The IDX payload is big-endian;
+         * for unsigned byte files, item() gives the values directly.
+         */
+        double value (const std::size_t i, const std::size_t j) const
+        {
+            const std::size_t eb = this->element_bytes();
+            const std::uint8_t* p = this->payload + (i * this->item_size() + j) * eb;
+            std::uint64_t u = 0;
+            for (std::size_t k = 0; k < eb; ++k) { u = (u << 8) | p[k]; }
+            switch (this->type) {
+            case type_ubyte: return static_cast<double>(static_cast<std::uint8_t>(u));
+            case type_sbyte: return static_cast<double>(static_cast<std::int8_t>(u));
+            case type_short: return static_cast<double>(static_cast<std::int16_t>(u));
+            case type_int: return static_cast<double>(static_cast<std::int32_t>(u));
+            case type_float:
+            {
+                const std::uint32_t u32 = static_cast<std::uint32_t>(u);
+                float f;
+                std::memcpy (&f, &u32, sizeof f);
+                return static_cast<double>(f);
+            }
+            case type_double:
+            {
+                double d;
+                std::memcpy (&d, &u, sizeof d);
+                return d;
+            }
+            default: return 0.0;
+            }
+        }
+
+    private:
+        static std::size_t type_bytes (const std::uint8_t t)
+        {
+            switch (t) {
+            case type_ubyte:
+            case type_sbyte: return 1;
+            case type_short: return 2;
+            case type_int:
+            case type_float: return 4;
+            case type_double: return 8;
+            default: return 0;
+            }
+        }
+
+        static std::uint32_t be32 (const std::uint8_t* p)
+        {
+            return static_cast<std::uint32_t>(p[0]) << 24 | static_cast<std::uint32_t>(p[1]) << 16
+            | static_cast<std::uint32_t>(p[2]) << 8 | static_cast<std::uint32_t>(p[3]);
+        }
+
+        void parse_header (const std::string& path)
+        {
+            if (this->len < 4 || this->mapped[0] != 0 || this->mapped[1] != 0) {
+                throw std::runtime_error ("idx_file: " + path + " is not an IDX file (bad magic number)");
+            }
+            this->type = this->mapped[2];
+            if (idx_file::type_bytes (this->type) == 0) {
+                throw std::runtime_error ("idx_file: " + path + " has an unknown element type");
+            }
+            const std::size_t nd = this->mapped[3];
+            const std::size_t hdr = 4 + 4 * nd;
+            if (nd == 0 || this->len < hdr) {
+                throw std::runtime_error ("idx_file: " + path + " has a truncated header");
+            }
+            for (std::size_t d = 0; d < nd; ++d) { this->dims.push_back (idx_file::be32 (this->mapped + 4 + 4 * d)); }
+            if (this->len < hdr + this->size() * this->item_size() * this->element_bytes()) {
+                throw std::runtime_error ("idx_file: " + path + " is shorter than its header says");
+            }
+            this->payload = this->mapped + hdr;
+        }
+
+        void take (idx_file& other)
+        {
+            this->dims = std::move (other.dims);
+            this->type = other.type;
+            this->len = other.len;
+#ifdef _WIN32
+            this->buf = std::move (other.buf);
+#endif
+            this->mapped = other.mapped;
+            this->payload = other.payload;
+            other.mapped = nullptr;
+            other.payload = nullptr;
+            other.len = 0;
+            other.type = 0;
+        }
+
+        //! The whole file, header included, and its length
+        const std::uint8_t* mapped = nullptr;
+        std::size_t len = 0;
+        //! The start of the data after the header
+        const std::uint8_t* payload = nullptr;
+#ifdef _WIN32
+        std::vector<std::uint8_t> buf;
+#endif
+    };
+
+    /*!
+     * An unsigned byte IDX images file with its labels file, as in the MNIST database (and
+     * Fashion-MNIST, EMNIST, KMNIST...). Items are visited in the order given by the index
+     * permutation order, and are converted to float (pixel value times scale) as they are copied
+     * into a batch.
+     */
+    struct idx_dataset
+    {
+        idx_dataset (const std::string& images_path, const std::string& labels_path)
+            : images(images_path), labels(labels_path)
+        {
+            if (this->images.type != idx_file::type_ubyte || this->labels.type != idx_file::type_ubyte) {
+                throw std::runtime_error ("idx_dataset: images and labels must be unsigned byte IDX files");
+            }
+            if (this->labels.item_size() != 1) {
+                throw std::runtime_error ("idx_dataset: the labels file must hold one label per item");
+            }
+            if (this->images.size() != this->labels.size()) {
+                throw std::runtime_error ("idx_dataset: num labels != num images");
+            }
+            this->order.resize (this->size());
+            std::iota (this->order.begin(), this->order.end(), 0U);
+        }
+
+        //! Number of items
+        std::size_t size() const { return this->images.size(); }
+        //! Number of pixels in each image
+        std::size_t item_size() const { return this->images.item_size(); }
+        //! Image rows and columns (for 3 dimensional image files)
+        std::size_t rows() const { return this->images.dims.size() > 1 ? this->images.dims[1] : 1; }
+        std::size_t cols() const { return this->images.dims.size() > 2 ? this->images.dims[2] : this->item_size(); }
+
+        //! The pixels of image i (in file order, not permuted), in the mapped file
+        std::span<const std::uint8_t> image (const std::size_t i) const { return this->images.item (i); }
+        //! The label of image i (in file order)
+        std::uint8_t label (const std::size_t i) const { return this->labels.item (i)[0]; }
+
+        //! Shuffle the permutation with std::shuffle and a std::mt19937 seeded with seed
+        void shuffle (const std::uint32_t seed)
+        {
+            std::mt19937 rng (seed);
+            std::shuffle (this->order.begin(), this->order.end(), rng);
+        }
+        //! Put the permutation back to file order
+        void unshuffle() { std::iota (this->order.begin(), this->order.end(), 0U); }
+
+        //! Image number i in the permuted order, as floats scaled by scale, into dst (item_size() long)
+        void get_item (const std::size_t i, float* dst) const { this->normalise (this->image (this->order[i]), dst, 1); }
+
+        /*!
+         * Copy the nb items order[b0..b0+nb-1] into x as floats. If column_major is false, x is
+         * (nb x item_size()) with an image per row. If true, x is (item_size() x nb) with an
+         * image per column, as in FeedForwardNet::setBatchSize(). If y is not null, it receives
+         * the labels one-hot encoded over nclasses, in the same layout.
+         */
+        void get_batch (const std::size_t b0, const std::size_t nb, float* x,
+                        float* y = nullptr, const std::size_t nclasses = 10, const bool column_major = false) const
+        {
+            if (b0 + nb > this->size()) { throw std::runtime_error ("idx_dataset::get_batch: batch runs off the end of the data"); }
+            const std::size_t m = this->item_size();
+            for (std::size_t s = 0; s < nb; ++s) {
+                const std::size_t i = this->order[b0 + s];
+                if (column_major) {
+                    this->normalise (this->image (i), x + s, nb);
+                } else {
+                    this->normalise (this->image (i), x + s * m, 1);
+                }
+                if (y != nullptr) {
+                    const std::size_t lbl = this->label (i);
+                    for (std::size_t c = 0; c < nclasses; ++c) {
+                        y[column_major ? c * nb + s : s * nclasses + c] = c == lbl ? 1.0f : 0.0f;
+                    }
+                }
+            }
+        }
+
+        //! The images and labels files
+        idx_file images;
+        idx_file labels;
+        //! The visiting order of the items
+        std::vector<unsigned int> order;
+        //! Pixel values are multiplied by scale. The default matches morph::Mnist.
+        float scale = 1.0f / 256.0f;
+        //! If true, the rows of each image are reversed (bottom row first, as morph::Mnist
+        //! stores them for display on a Grid)
+        bool flip_rows = false;
+
+    private:
+        //! Convert px to float into dst[0], dst[stride], dst[2*stride]...
+        void normalise (std::span<const std::uint8_t> px, float* dst, const std::size_t stride) const
+        {
+            const std::size_t nr = this->rows();
+            const std::size_t nc = px.size() / nr;
+            for (std::size_t r = 0; r < nr; ++r) {
+                const std::uint8_t* src = px.data() + (this->flip_rows ? nr - r - 1 : r) * nc;
+                float* d = dst + r * nc * stride;
+                for (std::size_t c = 0; c < nc; ++c) { d[c * stride] = static_cast<float>(src[c]) * this->scale; }
+            }
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,223 @@
+/*!
+ * \file
+ *
+ * A source of image frames for programs that show (or simulate on) a sequence of PNG images.
+ * image_stream loads and resamples the frames ahead of time on its own threads, so that the
+ * loop that uses them doesn't wait on loadpng and Grid::resample_image.
+ */
+#pragma once
+
+#include <morph/loadpng.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+namespace morph {
+
+    /*!
+     * Streams the PNG files filenames, in order, as monochrome vvec<float> frames (see loadpng).
+     * Worker threads load the frames that come next into a ring of depth buffers; next() hands
+     * over one that is ready, waiting only if none is. The buffer given to next() is swapped
+     * into the ring to be filled again, so a loop that reuses its frame doesn't allocate.
+     *
+     * If transform is set, it is applied to each frame after loading, on the worker thread.
+     * Use it to resample the image onto a grid:
+     *
+     *\code{.cpp}
+     * morph::image_stream s (filenames);
+     * s.transform = [&g](const morph::vvec<float>& img, const morph::vec<unsigned int, 2>& dims) {
+     *     return g.resample_image (img, dims[0], { 1.0f, 1.0f }, { 0.0f, 0.0f });
+     * };
+     * morph::vvec<float> frame;
+     * while (s.next (frame)) { gv->updateData (&frame); v.render(); }
+     *\endcode
+     *
+     * Set the public members before the first call to next() or try_next(), which starts the
+     * workers. An error in loading or transforming a frame is thrown from the next() that would
+     * have returned it.
+     */
+    class image_stream
+    {
+    public:
+        using transform_func = std::function<morph::vvec<float>(const morph::vvec<float>&, const morph::vec<unsigned int, 2>&)>;
+
+        explicit image_stream (const std::vector<std::string>& _filenames) : filenames(_filenames) {}
+
+        image_stream (const image_stream&) = delete;
+        image_stream& operator= (const image_stream&) = delete;
+
+        ~image_stream() { this->stop(); }
+
+        //! Applied to each frame after it is loaded. If empty, frames are given as loaded.
+        transform_func transform;
+        //! The number of frames held ready (or being loaded) at once
+        unsigned int depth = 4;
+        //! The number of worker threads. With 0, use one fewer than the hardware threads, but no more than depth.
+        unsigned int threads = 0;
+        //! The flips passed to loadpng
+        morph::vec<bool, 2> flip = { false, true };
+        //! If true, start again from the first file after the last, forever
+        bool loop = false;
+
+        /*!
+         * Swap the next frame into frame, waiting for it if it is not ready. Returns false when
+         * there are no more frames.
+         */
+        bool next (morph::vvec<float>& frame) { return this->take (frame, true); }
+
+        /*!
+         * Swap the next frame into frame if it is ready and return true. Otherwise return false
+         * straight away, leaving frame as it was; check finished() to tell whether more frames
+         * are to come.
+         */
+        bool try_next (morph::vvec<float>& frame) { return this->take (frame, false); }
+
+        //! True once every frame has been handed out (never, if loop is set)
+        bool finished() const
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            return this->end_of_stream (this->next_read);
+        }
+
+        //! The index (in filenames) of the frame most recently returned by next() or try_next()
+        std::size_t frame_index() const { return this->last_file; }
+
+        //! The dimensions of the frame most recently returned, as loaded (before any transform)
+        morph::vec<unsigned int, 2> frame_dims() const { return this->last_dims; }
+
+        //! Stop the workers. Frames that are not yet loaded won't be.
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->stopping = true;
+            }
+            this->cv_work.notify_all();
+            this->cv_ready.notify_all();
+            for (auto& w : this->workers) { if (w.joinable()) { w.join(); } }
+            this->workers.clear();
+        }
+
+    private:
+        enum class slot_state { empty, loading, ready };
+
+        //! One buffer of the ring
+        struct slot
+        {
+            slot_state state = slot_state::empty;
+            //! The stream position of the frame held
+            std::size_t pos = 0;
+            morph::vvec<float> data;
+            morph::vec<unsigned int, 2> dims = { 0u, 0u };
+            std::exception_ptr error;
+        };
+
+        bool end_of_stream (const std::size_t pos) const
+        {
+            return this->filenames.empty() || (!this->loop && pos >= this->filenames.size());
+        }
+
+        void start()
+        {
+            if (this->started) { return; }
+            this->started = true;
+            this->depth = std::max (1u, this->depth);
+            this->ring.resize (this->depth);
+            unsigned int n = this->threads;
+            if (n == 0) { n = std::min (this->depth, std::max (1u, std::thread::hardware_concurrency() - 1u)); }
+            for (unsigned int i = 0; i < n; ++i) { this->workers.emplace_back (&image_stream::run, this); }
+        }
+
+        bool take (morph::vvec<float>& frame, const bool block)
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->start();
+            const std::size_t pos = this->next_read;
+            if (this->end_of_stream (pos)) { return false; }
+            slot& s = this->ring[pos % this->depth];
+            auto ready = [&s, pos] { return s.state == slot_state::ready && s.pos == pos; };
+            if (block) { this->cv_ready.wait (lk, [this, &ready] { return ready() || this->stopping; }); }
+            if (!ready()) { return false; }
+            std::exception_ptr err = s.error;
+            s.error = nullptr;
+            frame.swap (s.data);
+            this->last_file = pos % this->filenames.size();
+            this->last_dims = s.dims;
+            s.state = slot_state::empty;
+            ++this->next_read;
+            lk.unlock();
+            this->cv_work.notify_all();
+            if (err) { std::rethrow_exception (err); }
+            return true;
+        }
+
+        void run()
+        {
+#ifdef _OPENMP
+            // loadpng's conversion is parallel; on these threads, it should not be
+            omp_set_num_threads (1);
+#endif
+            morph::vvec<float> img; // reused for each frame
+            std::unique_lock<std::mutex> lk (this->m);
+            for (;;) {
+                // Frames are loaded in order, into the slot that will be read next but one (etc).
+                this->cv_work.wait (lk, [this] {
+                    return this->stopping || (!this->end_of_stream (this->next_load)
+                                              && this->ring[this->next_load % this->depth].state == slot_state::empty);
+                });
+                if (this->stopping) { break; }
+                const std::size_t pos = this->next_load++;
+                slot& s = this->ring[pos % this->depth];
+                s.state = slot_state::loading;
+                s.pos = pos;
+                const std::string& fn = this->filenames[pos % this->filenames.size()];
+                lk.unlock();
+
+                std::exception_ptr err;
+                morph::vec<unsigned int, 2> dims = { 0u, 0u };
+                try {
+                    if (this->transform) {
+                        dims = morph::loadpng (fn, img, this->flip);
+                        s.data = this->transform (img, dims);
+                    } else {
+                        dims = morph::loadpng (fn, s.data, this->flip);
+                    }
+                } catch (...) {
+                    err = std::current_exception();
+                }
+
+                lk.lock();
+                s.dims = dims;
+                s.error = err;
+                s.state = slot_state::ready;
+                this->cv_ready.notify_all();
+            }
+        }
+
+        std::vector<std::string> filenames;
+        std::vector<slot> ring;
+        //! The stream positions of the next frame to hand out and the next to load
+        std::size_t next_read = 0;
+        std::size_t next_load = 0;
+        std::size_t last_file = 0;
+        morph::vec<unsigned int, 2> last_dims = { 0u, 0u };
+        bool started = false;
+        bool stopping = false;
+        mutable std::mutex m;
+        std::condition_variable cv_work;
+        std::condition_variable cv_ready;
+        std::vector<std::thread> workers;
+    };
+
+} // namespace morph
@@ -0,0 +1,600 @@
+/*!
+ * \file
+ *
+ * Solvers for implicit (backward Euler) diffusion steps on morph's grids. A backward Euler
+ * step of du/dt = D Del^2 u solves
+ *
+ *     (I - D dt Del^2) u_new = u_old
+ *
+ * which is stable for any dt, so stiff diffusion no longer limits the time step to the
+ * explicit CFL bound of about d^2 / (4 D) (or, on a HexGrid, d^2 / (3 D)).
+ *
+ * morph::diffusion_cg is a Jacobi preconditioned conjugate gradient solver built from a
+ * grid's neighbour relations. It works on HexGrid and CartGrid (via their d_ neighbour
+ * vectors, so on domains of any shape) and on Grid and Gridct.
+ *
+ * morph::diffusion_multigrid is a geometric multigrid V-cycle solver for rectangular
+ * domains (Grid, Gridct and rectangular CartGrids), which converges in a number of cycles
+ * that barely grows with the size of the grid.
+ *
+ * Both apply the same zero-flux boundary condition as morph::apply_stencil() and
+ * RD_Base::compute_laplace(): there is no flux across a link to a missing neighbour.
+ *
+ * \code
+ * morph::diffusion_cg<float> solver (*hg);
+ * solver.diffuse (A, D_A, dt); // A <- (I - D_A dt Del^2)^-1 A
+ * \endcode
+ */
+
+#pragma once
+
+#include <morph/stencil.h>
+#include <morph/memory_usage.h>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * A Jacobi preconditioned conjugate gradient solver for (I - alpha Del^2) x = b, where
+     * Del^2 is the finite volume Laplacian of a grid: the sum over each element's links to
+     * its neighbours of w (x_j - x_i), with w = 1/d^2 on a Cartesian grid and 2/(3d^2) on a
+     * HexGrid. The matrix is symmetric and positive definite for alpha >= 0.
+     *
+     * \tparam T The number type (float or double)
+     */
+    template <typename T>
+    class diffusion_cg
+    {
+    public:
+        //! Build the solver from the neighbour relations of a HexGrid, CartGrid, Grid or Gridct
+        template <typename G>
+        explicit diffusion_cg (const G& grid)
+        {
+            if constexpr (stencil_detail::hex_grid<G>) {
+                const T d = static_cast<T>(grid.getd());
+                const T w = T{2} / (T{3} * d * d);
+                this->n = grid.d_ne.size();
+                for (const std::vector<int>* l : { &grid.d_ne, &grid.d_nne, &grid.d_nnw, &grid.d_nw, &grid.d_nsw, &grid.d_nse }) {
+                    this->add_link (*l, w);
+                }
+            } else if constexpr (stencil_detail::cart_grid<G>) {
+                const T d = static_cast<T>(grid.getd());
+                const T v = static_cast<T>(grid.getv());
+                this->n = grid.d_ne.size();
+                this->add_link (grid.d_ne, T{1} / (d * d));
+                this->add_link (grid.d_nw, T{1} / (d * d));
+                this->add_link (grid.d_nn, T{1} / (v * v));
+                this->add_link (grid.d_ns, T{1} / (v * v));
+            } else if constexpr (stencil_detail::rectangular_grid<G>) {
+                this->n = static_cast<std::size_t>(grid.get_w()) * static_cast<std::size_t>(grid.get_h());
+                const auto dx = grid.get_dx();
+                const T wx = T{1} / static_cast<T>(dx[0] * dx[0]);
+                const T wy = T{1} / static_cast<T>(dx[1] * dx[1]);
+                std::array<std::vector<int>, 4> l;
+                for (auto& li : l) { li.resize (this->n); }
+                using I = std::remove_cvref_t<decltype(grid.get_w())>;
+                auto idx = [](const I j) { return j == std::numeric_limits<I>::max() ? -1 : static_cast<int>(j); };
+                for (std::size_t i = 0; i < this->n; ++i) {
+                    const I ii = static_cast<I>(i);
+                    l[0][i] = idx (grid.index_ne (ii));
+                    l[1][i] = idx (grid.index_nw (ii));
+                    l[2][i] = idx (grid.index_nn (ii));
+                    l[3][i] = idx (grid.index_ns (ii));
+                }
+                this->add_link (l[0], wx);
+                this->add_link (l[1], wx);
+                this->add_link (l[2], wy);
+                this->add_link (l[3], wy);
+            } else {
+                static_assert (stencil_detail::rectangular_grid<G>, "diffusion_cg: unsupported grid type");
+            }
+        }
+
+        //! Stop when the residual norm falls below tolerance times the norm of b
+        T tolerance = T{1e-6};
+        //! Give up after this many iterations
+        unsigned int max_iterations = 1000;
+        //! The number of iterations taken by the last solve
+        unsigned int iterations = 0;
+        //! The relative residual norm at the end of the last solve
+        T residual = T{0};
+
+        //! The number of elements
+        std::size_t size() const { return this->n; }
+
+        //! The memory held by the operator and the work vectors
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("diffusion_cg");
+            mu.add ("nbr", this->nbr);
+            mu.add ("wt", this->wt);
+            mu.add ("wsum", this->wsum);
+            morph::memory_usage& w = mu.add (morph::memory_usage ("work vectors"));
+            w.cpu = morph::heap_bytes (this->r) + morph::heap_bytes (this->z) + morph::heap_bytes (this->p)
+            + morph::heap_bytes (this->q) + morph::heap_bytes (this->rhs);
+            return mu;
+        }
+
+        //! y = (I - alpha Del^2) x
+        void apply (const std::vector<T>& x, std::vector<T>& y, const T alpha) const
+        {
+            y.resize (this->n);
+            const long long nn = static_cast<long long>(this->n);
+            const unsigned int nl = static_cast<unsigned int>(this->wt.size());
+#pragma omp parallel for schedule(static)
+            for (long long i = 0; i < nn; ++i) {
+                T s = this->wsum[i] * x[i];
+                for (unsigned int l = 0; l < nl; ++l) {
+                    const int j = this->nbr[l * this->n + i];
+                    if (j >= 0) { s -= this->wt[l] * x[j]; }
+                }
+                y[i] = x[i] + alpha * s;
+            }
+        }
+
+        /*!
+         * Solve (I - alpha Del^2) x = b for x, starting from the values in x. Returns the
+         * number of iterations.
+         */
+        unsigned int solve (std::vector<T>& x, const std::vector<T>& b, const T alpha)
+        {
+            if (b.size() != this->n) { throw std::runtime_error ("diffusion_cg::solve: b has the wrong size"); }
+            x.resize (this->n);
+            this->iterations = 0;
+            this->residual = T{0};
+            const double bnorm = std::sqrt (diffusion_cg<T>::dot (b, b));
+            if (bnorm == 0.0) { std::fill (x.begin(), x.end(), T{0}); return 0; }
+
+            this->r.resize (this->n);
+            this->z.resize (this->n);
+            this->p.resize (this->n);
+            this->apply (x, this->q, alpha);
+            const long long nn = static_cast<long long>(this->n);
+#pragma omp parallel for schedule(static)
+            for (long long i = 0; i < nn; ++i) {
+                this->r[i] = b[i] - this->q[i];
+                this->z[i] = this->r[i] / (T{1} + alpha * this->wsum[i]);
+                this->p[i] = this->z[i];
+            }
+            double rz = diffusion_cg<T>::dot (this->r, this->z);
+            double rnorm = std::sqrt (diffusion_cg<T>::dot (this->r, this->r));
+            while (rnorm > static_cast<double>(this->tolerance) * bnorm && this->iterations < this->max_iterations) {
+                this->apply (this->p, this->q, alpha);
+                const T a = static_cast<T>(rz / diffusion_cg<T>::dot (this->p, this->q));
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nn; ++i) {
+                    x[i] += a * this->p[i];
+                    this->r[i] -= a * this->q[i];
+                    this->z[i] = this->r[i] / (T{1} + alpha * this->wsum[i]);
+                }
+                const double rz_new = diffusion_cg<T>::dot (this->r, this->z);
+                const T beta = static_cast<T>(rz_new / rz);
+                rz = rz_new;
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < nn; ++i) { this->p[i] = this->z[i] + beta * this->p[i]; }
+                rnorm = std::sqrt (diffusion_cg<T>::dot (this->r, this->r));
+                ++this->iterations;
+            }
+            this->residual = static_cast<T>(rnorm / bnorm);
+            return this->iterations;
+        }
+
+        //! Take one backward Euler step of du/dt = D Del^2 u of length dt. Returns the
+        //! number of iterations.
+        unsigned int diffuse (std::vector<T>& u, const T D, const T dt)
+        {
+            this->rhs = u;
+            return this->solve (u, this->rhs, D * dt);
+        }
+
+    protected:
+        //! The number of elements
+        std::size_t n = 0;
+        //! The neighbour on each link of each element (or -1), link by link: nbr[l * n + i]
+        std::vector<int> nbr;
+        //! The weight of each link
+        std::vector<T> wt;
+        //! The sum of the weights of each element's links to neighbours that exist
+        std::vector<T> wsum;
+        //! Work vectors
+        std::vector<T> r, z, p, q, rhs;
+
+        void add_link (const std::vector<int>& l, const T w)
+        {
+            if (l.size() != this->n) { throw std::runtime_error ("diffusion_cg: neighbour vectors have the wrong size"); }
+            this->nbr.insert (this->nbr.end(), l.begin(), l.end());
+            this->wt.push_back (w);
+            this->wsum.resize (this->n, T{0});
+            for (std::size_t i = 0; i < this->n; ++i) { if (l[i] >= 0) { this->wsum[i] += w; } }
+        }
+
+        static double dot (const std::vector<T>& a, const std::vector<T>& b)
+        {
+            double s = 0.0;
+            const long long nn = static_cast<long long>(a.size());
+#pragma omp parallel for reduction(+:s) schedule(static)
+            for (long long i = 0; i < nn; ++i) { s += static_cast<double>(a[i]) * static_cast<double>(b[i]); }
+            return s;
+        }
+    };
+
+    /*!
+     * A geometric multigrid solver for (I - alpha Del^2) x = b on a rectangular grid, with
+     * the 5 point Laplacian. Each V-cycle smooths with red-black Gauss-Seidel, restricts the
+     * residual to a grid of half the resolution, recurses, and interpolates the correction
+     * back linearly.
+     *
+     * The coarse levels are finite volume discretisations on the merged cells. Where a
+     * dimension is odd, its last coarse cell holds a single fine cell and so is narrower than
+     * the others; the coarse operator, restriction and interpolation all account for the
+     * cell widths, so any grid size (wrapping or not) coarsens all the way down.
+     *
+     * \tparam T The number type (float or double)
+     */
+    template <typename T>
+    class diffusion_multigrid
+    {
+    public:
+        //! Build the solver for a Grid, a Gridct or a CartGrid with GridDomainShape::Rectangle
+        template <typename G>
+        explicit diffusion_multigrid (const G& grid)
+        {
+            if constexpr (stencil_detail::cart_grid<G>) {
+                if (grid.domainShape != GridDomainShape::Rectangle || grid.w_px <= 0
+                    || static_cast<std::size_t>(grid.w_px) * static_cast<std::size_t>(grid.h_px) != grid.d_ne.size()) {
+                    throw std::runtime_error ("diffusion_multigrid: needs a rectangular CartGrid (use diffusion_cg for other shapes)");
+                }
+                const stencil_detail::rect_layout l = stencil_detail::make_layout (grid.w_px, grid.h_px, grid.domainWrap,
+                                                                                   GridOrder::bottomleft_to_topright);
+                this->init (l.na, l.nb, static_cast<T>(grid.getd()), static_cast<T>(grid.getv()), l.wrap_a, l.wrap_b);
+            } else if constexpr (stencil_detail::rectangular_grid<G>) {
+                const stencil_detail::rect_layout l = stencil_detail::make_layout (grid.get_w(), grid.get_h(), grid.get_wrap(), grid.get_order());
+                const auto dx = grid.get_dx();
+                // In storage order, a runs along rows for row-major grids, along columns otherwise
+                const T ha = static_cast<T>(l.colmaj ? dx[1] : dx[0]);
+                const T hb = static_cast<T>(l.colmaj ? dx[0] : dx[1]);
+                this->init (l.na, l.nb, ha, hb, l.wrap_a, l.wrap_b);
+            } else {
+                static_assert (stencil_detail::rectangular_grid<G>, "diffusion_multigrid: unsupported grid type");
+            }
+        }
+
+        //! Build the solver for a grid stored as nb rows of na elements, with spacings ha and hb
+        diffusion_multigrid (const long long na, const long long nb, const T ha, const T hb,
+                             const bool wrap_a = false, const bool wrap_b = false)
+        {
+            this->init (na, nb, ha, hb, wrap_a, wrap_b);
+        }
+
+        //! Stop when the residual norm falls below tolerance times the norm of b
+        T tolerance = T{1e-6};
+        //! Give up after this many V-cycles
+        unsigned int max_cycles = 50;
+        //! Gauss-Seidel sweeps before and after the coarse grid correction
+        unsigned int pre_smooth = 2;
+        unsigned int post_smooth = 2;
+        //! The number of V-cycles taken by the last solve
+        unsigned int cycles = 0;
+        //! The relative residual norm at the end of the last solve
+        T residual = T{0};
+
+        //! The number of elements
+        std::size_t size() const { return this->levels[0].u.size(); }
+        //! The number of levels in the hierarchy
+        std::size_t num_levels() const { return this->levels.size(); }
+
+        /*!
+         * Solve (I - alpha Del^2) x = b for x, starting from the values in x. Returns the
+         * number of V-cycles.
+         */
+        unsigned int solve (std::vector<T>& x, const std::vector<T>& b, const T alpha)
+        {
+            level& l0 = this->levels[0];
+            if (b.size() != l0.u.size()) { throw std::runtime_error ("diffusion_multigrid::solve: b has the wrong size"); }
+            if (x.size() != l0.u.size()) { x.assign (l0.u.size(), T{0}); }
+            std::copy (x.begin(), x.end(), l0.u.begin());
+            std::copy (b.begin(), b.end(), l0.f.begin());
+            double bnorm = 0.0;
+            for (auto bi : b) { bnorm += static_cast<double>(bi) * static_cast<double>(bi); }
+            bnorm = std::sqrt (bnorm);
+            this->cycles = 0;
+            double rnorm = std::sqrt (this->compute_residual (0, alpha));
+            while (rnorm > static_cast<double>(this->tolerance) * bnorm && this->cycles < this->max_cycles) {
+                this->vcycle (0, alpha);
+                rnorm = std::sqrt (this->compute_residual (0, alpha));
+                ++this->cycles;
+            }
+            this->residual = bnorm > 0.0 ? static_cast<T>(rnorm / bnorm) : T{0};
+            std::copy (l0.u.begin(), l0.u.end(), x.begin());
+            return this->cycles;
+        }
+
+        //! Take one backward Euler step of du/dt = D Del^2 u of length dt. Returns the
+        //! number of V-cycles.
+        unsigned int diffuse (std::vector<T>& u, const T D, const T dt)
+        {
+            this->rhs = u;
+            return this->solve (u, this->rhs, D * dt);
+        }
+
+    protected:
+        //! The cells along one dimension of a level, and their relation to the next coarser level
+        struct axis
+        {
+            long long n = 0;
+            bool wrap = false;
+            std::vector<T> width;
+            //! Neighbours below and above each cell (-1 if none) and the coefficients of the
+            //! links to them, 1 / (width * distance between the centres)
+            std::vector<long long> nlo, nhi;
+            std::vector<T> clo, chi;
+            //! Whether the next level merges pairs of cells
+            bool coarsened = false;
+            //! The coarse cell containing each cell, and the fraction of its width this cell is
+            std::vector<long long> parent;
+            std::vector<T> frac;
+            //! Linear interpolation from the coarse level: parent weight and other coarse cell
+            std::vector<long long> other;
+            std::vector<T> w_other;
+
+            void set_links()
+            {
+                this->nlo.assign (this->n, -1);
+                this->nhi.assign (this->n, -1);
+                this->clo.assign (this->n, T{0});
+                this->chi.assign (this->n, T{0});
+                for (long long i = 0; i < this->n; ++i) {
+                    long long lo = i - 1;
+                    long long hi = i + 1;
+                    if (this->wrap && this->n > 1) {
+                        if (lo < 0) { lo = this->n - 1; }
+                        if (hi >= this->n) { hi = 0; }
+                    }
+                    if (lo >= 0) {
+                        this->nlo[i] = lo;
+                        this->clo[i] = T{2} / (this->width[i] * (this->width[i] + this->width[lo]));
+                    }
+                    if (hi < this->n) {
+                        this->nhi[i] = hi;
+                        this->chi[i] = T{2} / (this->width[i] * (this->width[i] + this->width[hi]));
+                    }
+                }
+            }
+
+            //! Make the next coarser axis, filling in this axis's parent, frac and interpolation
+            axis coarsen()
+            {
+                axis c;
+                c.wrap = this->wrap;
+                this->coarsened = this->n > 2;
+                c.n = this->coarsened ? (this->n + 1) / 2 : this->n;
+                c.width.assign (c.n, T{0});
+                this->parent.resize (this->n);
+                for (long long i = 0; i < this->n; ++i) {
+                    this->parent[i] = this->coarsened ? i / 2 : i;
+                    c.width[this->parent[i]] += this->width[i];
+                }
+                c.set_links();
+                this->frac.resize (this->n);
+                this->other.resize (this->n);
+                this->w_other.resize (this->n);
+                for (long long i = 0; i < this->n; ++i) {
+                    const long long p = this->parent[i];
+                    this->frac[i] = this->width[i] / c.width[p];
+                    // The offset of this cell's centre from its parent's centre
+                    const T left = (this->coarsened && i % 2 == 1) ? this->width[i - 1] : T{0};
+                    const T off = left + this->width[i] / T{2} - c.width[p] / T{2};
+                    const long long o = off < T{0} ? c.nlo[p] : c.nhi[p];
+                    const bool interpolate = this->coarsened && o >= 0 && std::abs (off) > T{0};
+                    this->other[i] = interpolate ? o : p;
+                    this->w_other[i] = interpolate ? std::abs (off) * T{2} / (c.width[p] + c.width[o]) : T{0};
+                }
+                return c;
+            }
+        };
+
+        struct level
+        {
+            axis a;
+            axis b;
+            std::vector<T> u;
+            std::vector<T> f;
+            std::vector<T> r;
+        };
+        std::vector<level> levels;
+        std::vector<T> rhs;
+
+        void init (const long long na, const long long nb, const T ha, const T hb, const bool wrap_a, const bool wrap_b)
+        {
+            if (na < 1 || nb < 1 || !(ha > T{0}) || !(hb > T{0})) {
+                throw std::runtime_error ("diffusion_multigrid: the grid must have positive dimensions and spacings");
+            }
+            level l;
+            l.a.n = na;
+            l.a.wrap = wrap_a;
+            l.a.width.assign (na, ha);
+            l.a.set_links();
+            l.b.n = nb;
+            l.b.wrap = wrap_b;
+            l.b.width.assign (nb, hb);
+            l.b.set_links();
+            this->levels.clear();
+            for (;;) {
+                const std::size_t sz = static_cast<std::size_t>(l.a.n * l.b.n);
+                l.u.assign (sz, T{0});
+                l.f.assign (sz, T{0});
+                l.r.assign (sz, T{0});
+                if (l.a.n <= 2 && l.b.n <= 2) {
+                    this->levels.push_back (l);
+                    break;
+                }
+                level c;
+                c.a = l.a.coarsen();
+                c.b = l.b.coarsen();
+                this->levels.push_back (l);
+                l = std::move (c);
+            }
+        }
+
+        //! alpha times the sum over the neighbours j of element (a, b) of c_j u_j, and one plus
+        //! alpha times the sum of the c_j: the off-diagonal and diagonal parts of the operator
+        static T neighbour_sum (const level& lv, const std::vector<T>& u, const long long a, const long long b, const T alpha, T& diag)
+        {
+            const long long na = lv.a.n;
+            T s = T{0};
+            T c = T{0};
+            if (lv.a.nlo[a] >= 0) { s += lv.a.clo[a] * u[b * na + lv.a.nlo[a]]; c += lv.a.clo[a]; }
+            if (lv.a.nhi[a] >= 0) { s += lv.a.chi[a] * u[b * na + lv.a.nhi[a]]; c += lv.a.chi[a]; }
+            if (lv.b.nlo[b] >= 0) { s += lv.b.clo[b] * u[lv.b.nlo[b] * na + a]; c += lv.b.clo[b]; }
+            if (lv.b.nhi[b] >= 0) { s += lv.b.chi[b] * u[lv.b.nhi[b] * na + a]; c += lv.b.chi[b]; }
+            diag = T{1} + alpha * c;
+            return alpha * s;
+        }
+
+        //! Red-black Gauss-Seidel sweeps on level li
+        void smooth (const std::size_t li, const T alpha, const unsigned int sweeps)
+        {
+            level& lv = this->levels[li];
+            // Red-black ordering only decouples the colours if no wrapping dimension is odd
+            const bool par = !(lv.a.wrap && lv.a.n % 2) && !(lv.b.wrap && lv.b.n % 2);
+            const long long na = lv.a.n;
+            const long long nb = lv.b.n;
+            for (unsigned int s = 0; s < sweeps; ++s) {
+                for (long long colour = 0; colour < 2; ++colour) {
+#pragma omp parallel for schedule(static) if (par)
+                    for (long long b = 0; b < nb; ++b) {
+                        for (long long a = (b + colour) % 2; a < na; a += 2) {
+                            T diag = T{1};
+                            const T ns = diffusion_multigrid<T>::neighbour_sum (lv, lv.u, a, b, alpha, diag);
+                            const long long i = b * na + a;
+                            lv.u[i] = (lv.f[i] + ns) / diag;
+                        }
+                    }
+                }
+            }
+        }
+
+        //! r = f - A u on level li. Returns the sum of the squared residuals.
+        double compute_residual (const std::size_t li, const T alpha)
+        {
+            level& lv = this->levels[li];
+            const long long na = lv.a.n;
+            const long long nb = lv.b.n;
+            double ss = 0.0;
+#pragma omp parallel for reduction(+:ss) schedule(static)
+            for (long long b = 0; b < nb; ++b) {
+                for (long long a = 0; a < na; ++a) {
+                    T diag = T{1};
+                    const T ns = diffusion_multigrid<T>::neighbour_sum (lv, lv.u, a, b, alpha, diag);
+                    const long long i = b * na + a;
+                    const T ri = lv.f[i] - (diag * lv.u[i] - ns);
+                    lv.r[i] = ri;
+                    ss += static_cast<double>(ri) * static_cast<double>(ri);
+                }
+            }
+            return ss;
+        }
+
+        //! Restrict the residual of level li to the right hand side of level li + 1, as the
+        //! area weighted mean over each coarse cell
+        void restrict_residual (const std::size_t li)
+        {
+            const level& lf = this->levels[li];
+            level& lc = this->levels[li + 1];
+            std::fill (lc.f.begin(), lc.f.end(), T{0});
+            const long long na = lf.a.n;
+            const long long nb = lf.b.n;
+            // Serial, as several fine cells add to each coarse cell
+            for (long long b = 0; b < nb; ++b) {
+                const long long B = lf.b.parent[b];
+                for (long long a = 0; a < na; ++a) {
+                    lc.f[B * lc.a.n + lf.a.parent[a]] += lf.b.frac[b] * lf.a.frac[a] * lf.r[b * na + a];
+                }
+            }
+        }
+
+        //! Interpolate the correction on level li + 1 and add it to the solution on level li
+        void prolong_add (const std::size_t li)
+        {
+            level& lf = this->levels[li];
+            const level& lc = this->levels[li + 1];
+            const long long na = lf.a.n;
+            const long long nb = lf.b.n;
+            const long long nca = lc.a.n;
+#pragma omp parallel for schedule(static)
+            for (long long b = 0; b < nb; ++b) {
+                const long long B0 = lf.b.parent[b];
+                const long long B1 = lf.b.other[b];
+                const T wb1 = lf.b.w_other[b];
+                for (long long a = 0; a < na; ++a) {
+                    const long long A0 = lf.a.parent[a];
+                    const long long A1 = lf.a.other[a];
+                    const T wa1 = lf.a.w_other[a];
+                    const T e0 = (T{1} - wa1) * lc.u[B0 * nca + A0] + wa1 * lc.u[B0 * nca + A1];
+                    const T e1 = (T{1} - wa1) * lc.u[B1 * nca + A0] + wa1 * lc.u[B1 * nca + A1];
+                    lf.u[b * na + a] += (T{1} - wb1) * e0 + wb1 * e1;
+                }
+            }
+        }
+
+        //! Solve exactly on the coarsest level, which has at most 4 elements
+        void coarse_solve (const std::size_t li, const T alpha)
+        {
+            level& lv = this->levels[li];
+            const long long na = lv.a.n;
+            const long long m = na * lv.b.n;
+            std::array<std::array<double, 5>, 4> A{}; // the matrix, with the right hand side in column 4
+            auto link = [&A, alpha](const long long i, const long long j, const T c) {
+                if (j < 0) { return; }
+                A[i][i] += static_cast<double>(alpha * c);
+                A[i][j] -= static_cast<double>(alpha * c);
+            };
+            for (long long b = 0; b < lv.b.n; ++b) {
+                for (long long a = 0; a < na; ++a) {
+                    const long long i = b * na + a;
+                    A[i][i] += 1.0;
+                    A[i][4] = static_cast<double>(lv.f[i]);
+                    link (i, lv.a.nlo[a] < 0 ? -1 : b * na + lv.a.nlo[a], lv.a.clo[a]);
+                    link (i, lv.a.nhi[a] < 0 ? -1 : b * na + lv.a.nhi[a], lv.a.chi[a]);
+                    link (i, lv.b.nlo[b] < 0 ? -1 : lv.b.nlo[b] * na + a, lv.b.clo[b]);
+                    link (i, lv.b.nhi[b] < 0 ? -1 : lv.b.nhi[b] * na + a, lv.b.chi[b]);
+                }
+            }
+            // The matrix is symmetric positive definite, so eliminate without pivoting
+            for (long long k = 0; k < m; ++k) {
+                for (long long i = k + 1; i < m; ++i) {
+                    const double f = A[i][k] / A[k][k];
+                    for (long long j = k; j < m; ++j) { A[i][j] -= f * A[k][j]; }
+                    A[i][4] -= f * A[k][4];
+                }
+            }
+            for (long long k = m - 1; k >= 0; --k) {
+                double s = A[k][4];
+                for (long long j = k + 1; j < m; ++j) { s -= A[k][j] * static_cast<double>(lv.u[j]); }
+                lv.u[k] = static_cast<T>(s / A[k][k]);
+            }
+        }
+
+        void vcycle (const std::size_t li, const T alpha)
+        {
+            if (li + 1 == this->levels.size()) {
+                this->coarse_solve (li, alpha);
+                return;
+            }
+            this->smooth (li, alpha, this->pre_smooth);
+            this->compute_residual (li, alpha);
+            this->restrict_residual (li);
+            std::fill (this->levels[li + 1].u.begin(), this->levels[li + 1].u.end(), T{0});
+            this->vcycle (li + 1, alpha);
+            this->prolong_add (li);
+            this->smooth (li, alpha, this->post_smooth);
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,122 @@
+/*!
+ * \file
+ *
+ * A small pool of worker threads that run queued jobs, first in, first out. VisualModel uses
+ * the shared pool to build vertices off the render thread (see VisualModel::reinit_async()).
+ * Jobs pushed with push_idle() run only when no other job is waiting (see
+ * VisualModel::lazy_prebuild).
+ */
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <exception>
+
+namespace morph {
+
+    class job_pool
+    {
+    public:
+        //! Start n worker threads. With n of 0, start one fewer than there are hardware threads (but at least one).
+        explicit job_pool (unsigned int n = 0)
+        {
+            if (n == 0) { n = std::max (1u, std::thread::hardware_concurrency() - 1u); }
+            for (unsigned int i = 0; i < n; ++i) { this->workers.emplace_back (&job_pool::run, this); }
+        }
+
+        //! Finish the jobs already queued, then stop the workers
+        ~job_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->stopping = true;
+            }
+            this->cv_work.notify_all();
+            for (auto& w : this->workers) { if (w.joinable()) { w.join(); } }
+        }
+
+        job_pool (const job_pool&) = delete;
+        job_pool& operator= (const job_pool&) = delete;
+
+        //! The pool shared by everything in the program. Its threads start on first use.
+        static job_pool& shared()
+        {
+            static job_pool p;
+            return p;
+        }
+
+        /*!
+         * Queue the job j. Jobs should catch their own exceptions; one that escapes is reported
+         * on std::cerr and dropped.
+         */
+        void push (std::function<void()>&& j)
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->jobs.push_back (std::move (j));
+            }
+            this->cv_work.notify_one();
+        }
+
+        //! Queue the job j to run when no job queued by push() is waiting
+        void push_idle (std::function<void()>&& j)
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->idle_jobs.push_back (std::move (j));
+            }
+            this->cv_work.notify_one();
+        }
+
+        //! Block until every job pushed so far has finished
+        void wait()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_idle.wait (lk, [this] { return this->jobs.empty() && this->idle_jobs.empty() && this->busy == 0; });
+        }
+
+        //! The number of worker threads
+        unsigned int size() const { return static_cast<unsigned int>(this->workers.size()); }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            for (;;) {
+                this->cv_work.wait (lk, [this] { return this->stopping || !this->jobs.empty() || !this->idle_jobs.empty(); });
+                if (this->jobs.empty() && this->idle_jobs.empty()) { break; } // stopping, and nothing is left to do
+                std::deque<std::function<void()>>& q = this->jobs.empty() ? this->idle_jobs : this->jobs;
+                std::function<void()> j = std::move (q.front());
+                q.pop_front();
+                ++this->busy;
+                lk.unlock();
+
+                try {
+                    j();
+                } catch (const std::exception& e) {
+                    std::cerr << "job_pool: a job threw: " << e.what() << std::endl;
+                }
+
+                lk.lock();
+                --this->busy;
+                if (this->jobs.empty() && this->idle_jobs.empty() && this->busy == 0) { this->cv_idle.notify_all(); }
+            }
+        }
+
+        std::deque<std::function<void()>> jobs;
+        std::deque<std::function<void()>> idle_jobs;
+        unsigned int busy = 0;
+        bool stopping = false;
+        std::mutex m;
+        std::condition_variable cv_work;
+        std::condition_variable cv_idle;
+        std::vector<std::thread> workers;
+    };
+
+} // namespace morph
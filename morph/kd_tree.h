@@ -0,0 +1,155 @@
+/*!
+ * \file
+ *
+ * A k-d tree for finding the nearest of a set of points to a location in time that grows with
+ * the logarithm of the number of points. HexGrid and CartGrid use one to find the distance from
+ * each element to the nearest boundary element, which was a loop over all pairs, and GridMap
+ * uses one to find the source elements near each destination.
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * A balanced k-d tree over a set of N dimensional points. build() sorts a copy of the points
+     * into an implicit tree: the node for the range [b, e) is the point at (b + e) / 2, which
+     * splits the range on the axis along which the range's points are most spread out.
+     *
+     * nearest() is exact. It descends to the point's own leaf first, then backs out, visiting
+     * the far side of a split only if the splitting plane is no further away than the best
+     * point found so far. Queries are const, so many threads may query one tree at once.
+     *
+     * \tparam F The floating point element type of the points
+     *
+     * \tparam N The number of dimensions
+     */
+    template <typename F, std::size_t N = 2>
+    struct kd_tree
+    {
+        //! The index returned by nearest() when the tree is empty
+        static constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+
+        //! Build the tree from points
+        void build (const std::vector<morph::vec<F, N>>& points)
+        {
+            if (points.size() >= static_cast<std::size_t>(none)) { throw std::runtime_error ("kd_tree: Too many points"); }
+            const unsigned int n = static_cast<unsigned int>(points.size());
+            this->index.resize (n);
+            for (unsigned int i = 0; i < n; ++i) { this->index[i] = i; }
+            this->axis.assign (n, 0u);
+            this->split (points, 0u, n);
+            this->pos.resize (n);
+            for (unsigned int j = 0; j < n; ++j) { this->pos[j] = points[this->index[j]]; }
+        }
+
+        /*!
+         * The index (into the points passed to build()) of the point nearest to x, or none if
+         * the tree is empty. Of several points at the same distance, the lowest index is
+         * returned. If dist2 is given, the squared distance to the point is written to it.
+         */
+        unsigned int nearest (const morph::vec<F, N>& x, F* dist2 = nullptr) const
+        {
+            best_point best;
+            this->search (x, 0u, static_cast<unsigned int>(this->pos.size()), best);
+            if (dist2 != nullptr) { *dist2 = best.d2; }
+            return best.i;
+        }
+
+        /*!
+         * Append to found the indices (into the points passed to build()) of the points no
+         * further than r from x, in no particular order.
+         */
+        void within (const morph::vec<F, N>& x, const F r, std::vector<unsigned int>& found) const
+        {
+            this->search_within (x, r * r, 0u, static_cast<unsigned int>(this->pos.size()), found);
+        }
+
+        //! The number of points given to build()
+        std::size_t size() const { return this->index.size(); }
+
+    private:
+        struct best_point
+        {
+            unsigned int i = none;
+            F d2 = std::numeric_limits<F>::max();
+        };
+
+        //! Make the node for the range [b, e) of index and recurse into each side of it
+        void split (const std::vector<morph::vec<F, N>>& points, const unsigned int b, const unsigned int e)
+        {
+            if (e - b < 2u) { return; }
+            morph::vec<F, N> lo = points[this->index[b]];
+            morph::vec<F, N> hi = lo;
+            for (unsigned int j = b + 1u; j < e; ++j) {
+                const morph::vec<F, N>& p = points[this->index[j]];
+                for (std::size_t d = 0; d < N; ++d) {
+                    lo[d] = std::min (lo[d], p[d]);
+                    hi[d] = std::max (hi[d], p[d]);
+                }
+            }
+            unsigned char a = 0u;
+            for (std::size_t d = 1; d < N; ++d) {
+                if (hi[d] - lo[d] > hi[a] - lo[a]) { a = static_cast<unsigned char>(d); }
+            }
+            const unsigned int m = b + (e - b) / 2u;
+            std::nth_element (this->index.begin() + b, this->index.begin() + m, this->index.begin() + e,
+                              [&points, a](const unsigned int i, const unsigned int j) {
+                                  return points[i][a] < points[j][a] || (points[i][a] == points[j][a] && i < j);
+                              });
+            this->axis[m] = a;
+            this->split (points, b, m);
+            this->split (points, m + 1u, e);
+        }
+
+        //! Search the range [b, e) for a point nearer to x than best
+        void search (const morph::vec<F, N>& x, const unsigned int b, const unsigned int e, best_point& best) const
+        {
+            if (b >= e) { return; }
+            const unsigned int m = b + (e - b) / 2u;
+            const F d2 = (this->pos[m] - x).sos();
+            if (d2 < best.d2 || (d2 == best.d2 && this->index[m] < best.i)) {
+                best.d2 = d2;
+                best.i = this->index[m];
+            }
+            if (e - b == 1u) { return; }
+            const F delta = x[this->axis[m]] - this->pos[m][this->axis[m]];
+            // Points on the splitting plane may lie on either side, so the far side is searched
+            // when the plane is at the best distance, too
+            if (delta < F{0}) {
+                this->search (x, b, m, best);
+                if (delta * delta <= best.d2) { this->search (x, m + 1u, e, best); }
+            } else {
+                this->search (x, m + 1u, e, best);
+                if (delta * delta <= best.d2) { this->search (x, b, m, best); }
+            }
+        }
+
+        //! Append the points in the range [b, e) that are within sqrt(r2) of x to found
+        void search_within (const morph::vec<F, N>& x, const F r2, const unsigned int b, const unsigned int e,
+                            std::vector<unsigned int>& found) const
+        {
+            if (b >= e) { return; }
+            const unsigned int m = b + (e - b) / 2u;
+            if ((this->pos[m] - x).sos() <= r2) { found.push_back (this->index[m]); }
+            if (e - b == 1u) { return; }
+            const F delta = x[this->axis[m]] - this->pos[m][this->axis[m]];
+            if (delta <= F{0} || delta * delta <= r2) { this->search_within (x, r2, b, m, found); }
+            if (delta >= F{0} || delta * delta <= r2) { this->search_within (x, r2, m + 1u, e, found); }
+        }
+
+        //! The original indices of the points, in tree order
+        std::vector<unsigned int> index;
+        //! The axis on which each node splits its range
+        std::vector<unsigned char> axis;
+        //! The locations of the points, in tree order
+        std::vector<morph::vec<F, N>> pos;
+    };
+
+} // namespace morph
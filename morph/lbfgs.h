@@ -0,0 +1,358 @@
+/*!
+ * \file
+ * \brief Limited memory BFGS minimisation, for smooth objectives whose gradient is available.
+ *
+ * morph::lbfgs minimises an objective that returns its gradient along with its value. For a
+ * smooth objective it needs far fewer evaluations than NM_Simplex or Anneal, especially in
+ * more than a few dimensions. The gradient can come from morph::dual numbers: write the
+ * objective for a generic number type and pass it to set_dual_objective(), which computes the
+ * exact gradient by forward-mode differentiation (see forward_gradient()):
+ *
+ *\code{.cpp}
+ * morph::lbfgs<double> opt;
+ * opt.set_dual_objective ([](const auto& p) { // p is a morph::vvec of duals
+ *     auto a = 1.0 - p[0];
+ *     auto b = p[1] - p[0] * p[0];
+ *     return a * a + 100.0 * b * b;
+ * });
+ * opt.reset ({ -1.2, 1.0 });
+ * opt.run(); // opt.x is the minimum, opt.f the value there
+ *\endcode
+ *
+ * Each iteration chooses a direction from the last m steps and their changes of gradient,
+ * then searches along it for a step that satisfies the strong Wolfe conditions.
+ */
+
+#pragma once
+
+#include <morph/vvec.h>
+#include <morph/dual.h>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+
+    /*!
+     * The value of f at x, with its gradient written into grad, by forward-mode automatic
+     * differentiation. f takes a morph::vvec<morph::dual<T, N>> and returns a morph::dual<T, N>
+     * (a generic lambda, written as for vvec<T>, will do). Each call of f gives N components of
+     * the gradient, so f is called ceil(x.size() / N) times.
+     */
+    template <std::size_t N = 8, typename T, typename F>
+    T forward_gradient (F&& f, const morph::vvec<T>& x, morph::vvec<T>& grad)
+    {
+        using D = morph::dual<T, N>;
+        const std::size_t n = x.size();
+        grad.resize (n);
+        morph::vvec<D> xd (n);
+        for (std::size_t i = 0; i < n; ++i) { xd[i] = D (x[i]); }
+        if (n == 0) { return static_cast<D>(f (xd)).v; }
+        T val = T{0};
+        for (std::size_t c = 0; c < n; c += N) {
+            const std::size_t nc = std::min (N, n - c);
+            for (std::size_t k = 0; k < nc; ++k) { xd[c + k].d[k] = T{1}; }
+            const D r = f (xd);
+            val = r.v;
+            for (std::size_t k = 0; k < nc; ++k) {
+                grad[c + k] = r.d[k];
+                xd[c + k].d[k] = T{0};
+            }
+        }
+        return val;
+    }
+
+    //! Why an lbfgs stopped
+    enum class lbfgs_stop_reason : std::uint32_t
+    {
+        None,              // Not stopped
+        GradientTolerance, // The gradient is within gradient_tolerance of zero: the normal reason
+        ObjectiveTolerance,// An iteration reduced the objective by less than objective_tolerance
+        TooManyIterations, // max_iterations were made
+        LineSearchFailed,  // No step along the search direction reduced the objective
+        NoObjective        // objective was not set
+    };
+
+    template <typename T>
+    class lbfgs
+    {
+    public:
+        //! The number of recent steps from which the search direction is found
+        unsigned int m = 8U;
+        //! Stop when the largest component of the gradient is below this (times the largest of 1 and |x|)
+        T gradient_tolerance = T{1e-6};
+        //! Stop when an iteration reduces the objective by less than this fraction of it
+        T objective_tolerance = T{1e-12};
+        //! Stop after this many iterations
+        unsigned int max_iterations = 1000U;
+        //! The most objective evaluations in one line search
+        unsigned int max_line_search = 40U;
+        //! The sufficient decrease (c1) and curvature (c2) parameters of the strong Wolfe conditions
+        T c1 = T{1e-4};
+        T c2 = T{0.9};
+
+        /*!
+         * The objective. It returns its value at x and writes its gradient at x into grad (which
+         * has x's size). Set it directly, or with set_dual_objective().
+         */
+        std::function<T(const morph::vvec<T>& x, morph::vvec<T>& grad)> objective = {};
+
+        //! The current point, the objective there and its gradient
+        morph::vvec<T> x;
+        T f = std::numeric_limits<T>::max();
+        morph::vvec<T> g;
+
+        //! Counts since reset()
+        unsigned int iterations = 0U;
+        unsigned long long int evaluations = 0ULL;
+
+        lbfgs_stop_reason stop_reason = lbfgs_stop_reason::None;
+
+        /*!
+         * Set the objective to f, which is written for a generic number type: it takes a
+         * morph::vvec of morph::dual<T, N> and returns a dual. Its gradient is computed by
+         * forward_gradient<N>().
+         */
+        template <std::size_t N = 8, typename F>
+        void set_dual_objective (F f)
+        {
+            this->objective = [f](const morph::vvec<T>& _x, morph::vvec<T>& grad) { return forward_gradient<N> (f, _x, grad); };
+        }
+
+        //! Start from x0. The objective must be set.
+        void reset (const morph::vvec<T>& x0)
+        {
+            this->x = x0;
+            this->iterations = 0U;
+            this->evaluations = 0ULL;
+            this->s.clear();
+            this->y.clear();
+            this->rho.clear();
+            this->stop_reason = lbfgs_stop_reason::None;
+            if (!this->objective) {
+                this->stop_reason = lbfgs_stop_reason::NoObjective;
+                return;
+            }
+            this->f = this->evaluate (this->x, this->g);
+            this->converged();
+        }
+
+        //! True once the search has stopped (see stop_reason)
+        bool stopped() const { return this->stop_reason != lbfgs_stop_reason::None; }
+
+        //! Make one iteration. Returns false once the search has stopped.
+        bool step()
+        {
+            if (this->stopped()) { return false; }
+            if (this->iterations >= this->max_iterations) {
+                this->stop_reason = lbfgs_stop_reason::TooManyIterations;
+                return false;
+            }
+            morph::vvec<T> d = this->direction();
+            T dphi0 = this->g.dot (d);
+            if (!(dphi0 < T{0})) {
+                // Not a descent direction (the curvature information is poor): start again from steepest descent
+                this->s.clear();
+                this->y.clear();
+                this->rho.clear();
+                d = -this->g;
+                dphi0 = this->g.dot (d);
+            }
+            // With no history, the first step is scaled to a unit move
+            const T a0 = this->s.empty() ? std::min (T{1}, T{1} / std::sqrt (-dphi0)) : T{1};
+
+            morph::vvec<T> x1, g1;
+            T f1 = T{0};
+            if (!this->line_search (d, dphi0, a0, x1, f1, g1)) {
+                this->stop_reason = lbfgs_stop_reason::LineSearchFailed;
+                return false;
+            }
+            ++this->iterations;
+
+            morph::vvec<T> sk = x1 - this->x;
+            morph::vvec<T> yk = g1 - this->g;
+            const T sy = sk.dot (yk);
+            // Keep the pair only if it has positive curvature, so that the implied Hessian stays positive definite
+            if (sy > std::numeric_limits<T>::epsilon() * yk.sos()) {
+                this->s.push_back (std::move (sk));
+                this->y.push_back (std::move (yk));
+                this->rho.push_back (T{1} / sy);
+                if (this->s.size() > this->m) {
+                    this->s.pop_front();
+                    this->y.pop_front();
+                    this->rho.pop_front();
+                }
+            }
+            const T f0 = this->f;
+            this->x.swap (x1);
+            this->g.swap (g1);
+            this->f = f1;
+            if (this->converged()) { return false; }
+            const T scale = std::max ({ std::abs (f0), std::abs (this->f), T{1} });
+            if ((f0 - this->f) <= this->objective_tolerance * scale) {
+                this->stop_reason = lbfgs_stop_reason::ObjectiveTolerance;
+                return false;
+            }
+            return true;
+        }
+
+        //! Iterate until the search stops. Returns false if the objective was not set.
+        bool run()
+        {
+            if (!this->objective) {
+                this->stop_reason = lbfgs_stop_reason::NoObjective;
+                return false;
+            }
+            while (this->step()) {}
+            return true;
+        }
+
+    private:
+        //! The recent steps s, changes of gradient y and 1/(s.y)
+        std::deque<morph::vvec<T>> s;
+        std::deque<morph::vvec<T>> y;
+        std::deque<T> rho;
+
+        T evaluate (const morph::vvec<T>& at, morph::vvec<T>& grad)
+        {
+            grad.resize (at.size());
+            ++this->evaluations;
+            return this->objective (at, grad);
+        }
+
+        //! Set stop_reason if the gradient is small enough
+        bool converged()
+        {
+            T gmax = T{0};
+            for (const T gi : this->g) { gmax = std::max (gmax, std::abs (gi)); }
+            T xmax = T{1};
+            for (const T xi : this->x) { xmax = std::max (xmax, std::abs (xi)); }
+            if (gmax <= this->gradient_tolerance * xmax) {
+                this->stop_reason = lbfgs_stop_reason::GradientTolerance;
+                return true;
+            }
+            return false;
+        }
+
+        //! -H g, for the approximate inverse Hessian H of the recent steps (the two loop recursion)
+        morph::vvec<T> direction() const
+        {
+            morph::vvec<T> q = -this->g;
+            const std::size_t k = this->s.size();
+            if (k == 0) { return q; }
+            std::vector<T> alpha (k);
+            for (std::size_t i = k; i-- > 0;) {
+                alpha[i] = this->rho[i] * this->s[i].dot (q);
+                q -= this->y[i] * alpha[i];
+            }
+            // Scale by s.y / y.y of the latest step, an estimate of the size of the inverse Hessian
+            q *= (T{1} / this->rho[k - 1]) / this->y[k - 1].sos();
+            for (std::size_t i = 0; i < k; ++i) {
+                const T beta = this->rho[i] * this->y[i].dot (q);
+                q += this->s[i] * (alpha[i] - beta);
+            }
+            return q;
+        }
+
+        //! A trial point along d: its step length, objective, gradient and directional derivative
+        struct trial
+        {
+            T a = T{0};
+            T f = T{0};
+            T dphi = T{0};
+            morph::vvec<T> x;
+            morph::vvec<T> g;
+        };
+
+        void try_step (const morph::vvec<T>& d, trial& t)
+        {
+            t.x = this->x + d * t.a;
+            t.f = this->evaluate (t.x, t.g);
+            t.dphi = t.g.dot (d);
+        }
+
+        /*!
+         * Find a step along d that satisfies the strong Wolfe conditions (Nocedal and Wright,
+         * Numerical Optimization, algorithms 3.5 and 3.6). Returns false if none was found that
+         * even reduced the objective.
+         */
+        bool line_search (const morph::vvec<T>& d, const T dphi0, const T a0,
+                          morph::vvec<T>& x1, T& f1, morph::vvec<T>& g1)
+        {
+            const T f0 = this->f;
+            trial lo;
+            lo.a = T{0};
+            lo.f = f0;
+            lo.dphi = dphi0;
+            trial hi;
+            trial t;
+            t.a = a0;
+            bool bracketed = false;
+            // The best point found with sufficient decrease, in case the search runs out of evaluations
+            trial best = lo;
+            auto accept = [&](trial& r) {
+                x1.swap (r.x);
+                g1.swap (r.g);
+                f1 = r.f;
+                return true;
+            };
+            for (unsigned int i = 0; i < this->max_line_search; ++i) {
+                if (bracketed) {
+                    // Interpolate between lo and hi, keeping away from the ends
+                    const T w = hi.a - lo.a;
+                    T a = this->cubic_min (lo, hi);
+                    if (!std::isfinite (a) || (a - lo.a) / w < T{0.1} || (a - lo.a) / w > T{0.9}) { a = lo.a + T{0.5} * w; }
+                    t.a = a;
+                }
+                this->try_step (d, t);
+                if (!std::isfinite (t.f)) {
+                    // Too far: the objective is undefined there
+                    hi = t;
+                    hi.f = std::numeric_limits<T>::max();
+                    hi.dphi = std::numeric_limits<T>::quiet_NaN();
+                    bracketed = true;
+                    continue;
+                }
+                const bool sufficient = t.f <= f0 + this->c1 * t.a * dphi0;
+                if (sufficient && t.f < best.f) { best = t; }
+                if (!sufficient || t.f >= lo.f) {
+                    hi = t;
+                    bracketed = true;
+                } else {
+                    if (std::abs (t.dphi) <= -this->c2 * dphi0) { return accept (t); }
+                    if (t.dphi * (hi.a - lo.a) >= T{0} && bracketed) {
+                        hi = lo;
+                    } else if (!bracketed && t.dphi >= T{0}) {
+                        hi = lo;
+                        bracketed = true;
+                    }
+                    lo = t;
+                    if (!bracketed) { t.a = T{2} * t.a; }
+                }
+            }
+            if (best.a > T{0}) { return accept (best); }
+            return false;
+        }
+
+        //! The minimiser of the cubic through the values and slopes at a.a and b.a
+        static T cubic_min (const trial& a, const trial& b)
+        {
+            if (!std::isfinite (b.dphi) || b.f == std::numeric_limits<T>::max()) {
+                // Only the quadratic through a's value and slope and b's value
+                const T h = b.a - a.a;
+                const T denom = T{2} * (b.f - a.f - a.dphi * h);
+                return denom > T{0} ? a.a - a.dphi * h * h / denom : std::numeric_limits<T>::quiet_NaN();
+            }
+            const T d1 = a.dphi + b.dphi - T{3} * (a.f - b.f) / (a.a - b.a);
+            const T disc = d1 * d1 - a.dphi * b.dphi;
+            if (disc < T{0}) { return std::numeric_limits<T>::quiet_NaN(); }
+            const T d2 = std::copysign (std::sqrt (disc), b.a - a.a);
+            return b.a - (b.a - a.a) * (b.dphi + d2 - d1) / (b.dphi - a.dphi + T{2} * d2);
+        }
+    };
+
+} // namespace morph
@@ -4,20 +4,154 @@
  * Helper to load PNG images into morph::vvec<morph::vec<float>> format and similar.
  *
  * Note: You have to #include this before morph/Visual.h
+ *
+ * Define MORPH_PNG_ZLIB (and link with zlib, or with zlib-ng in its zlib compatible mode) to
+ * have lodepng inflate the image data, and check its CRCs, with zlib, which is faster than
+ * lodepng's own code.
  */
 #define LODEPNG_NO_COMPILE_ANCILLARY_CHUNKS 1
 #include <morph/lodepng.h>
+#ifdef MORPH_PNG_ZLIB
+# include <zlib.h>
+# include <cstdlib>
+# include <limits>
+#endif
 
 #include <type_traits>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstddef>
 #include <stdexcept>
+#include <exception>
 #include <morph/vec.h>
 #include <morph/vvec.h>
 
 namespace morph {
 
+    namespace loadpng_internal
+    {
+        //! An RGBA, 8 bit image as decoded by lodepng, in the buffer that lodepng allocated
+        struct decoded
+        {
+            decoded() = default;
+            decoded (const decoded&) = delete;
+            decoded& operator= (const decoded&) = delete;
+            ~decoded() { lodepng_free (this->data); }
+            unsigned char* data = nullptr;
+            unsigned int w = 0;
+            unsigned int h = 0;
+        };
+
+#ifdef MORPH_PNG_ZLIB
+        //! A custom_zlib for lodepng that inflates with zlib, appending to *out as lodepng expects
+        static unsigned zlib_decompress (unsigned char** out, size_t* outsize, const unsigned char* in,
+                                         size_t insize, const LodePNGDecompressSettings* settings)
+        {
+            if (insize > std::numeric_limits<uInt>::max()) { return 1; }
+            z_stream zs = {};
+            if (inflateInit (&zs) != Z_OK) { return 2; }
+            zs.next_in = const_cast<Bytef*>(in);
+            zs.avail_in = static_cast<uInt>(insize);
+            // Image data usually inflates to a few times its compressed size
+            std::size_t cap = *outsize + 4 * insize + 1024;
+            int zr = Z_OK;
+            unsigned error = 0;
+            while (zr == Z_OK) {
+                unsigned char* grown = static_cast<unsigned char*>(lodepng_realloc (*out, cap));
+                if (grown == nullptr) { error = 83; break; }
+                *out = grown;
+                zs.next_out = *out + *outsize;
+                zs.avail_out = static_cast<uInt>(std::min (cap - *outsize, std::size_t{std::numeric_limits<uInt>::max()}));
+                uInt before = zs.avail_out;
+                zr = inflate (&zs, Z_NO_FLUSH);
+                *outsize += before - zs.avail_out;
+                if (settings->max_output_size && *outsize > settings->max_output_size) { error = 109; break; }
+                if (zr == Z_OK && zs.avail_out == 0) { cap *= 2; }
+                else if (zr == Z_OK && zs.avail_in == 0) { error = 3; break; } // truncated stream
+            }
+            if (error == 0 && zr != Z_STREAM_END) { error = 4; }
+            inflateEnd (&zs);
+            return error;
+        }
+
+        /*!
+         * Check the CRC of each chunk of the PNG file with zlib's crc32, which is much faster
+         * than lodepng's. Returns lodepng's error code for a bad CRC (57), or 0. A truncated
+         * file is left for lodepng to report.
+         */
+        static unsigned check_crcs (const std::vector<unsigned char>& file)
+        {
+            std::size_t pos = 8; // after the signature
+            while (pos + 12 <= file.size()) {
+                const unsigned char* c = file.data() + pos;
+                const std::size_t len = (std::size_t(c[0]) << 24) | (std::size_t(c[1]) << 16) | (std::size_t(c[2]) << 8) | c[3];
+                if (len > std::numeric_limits<uInt>::max() - 4u || pos + 12 + len > file.size()) { break; }
+                const unsigned long stored = (static_cast<unsigned long>(c[8 + len]) << 24) | (static_cast<unsigned long>(c[9 + len]) << 16)
+                | (static_cast<unsigned long>(c[10 + len]) << 8) | c[11 + len];
+                if (crc32 (0L, c + 4, static_cast<uInt>(len + 4)) != stored) { return 57; }
+                if (c[4] == 'I' && c[5] == 'E' && c[6] == 'N' && c[7] == 'D') { break; }
+                pos += 12 + len;
+            }
+            return 0;
+        }
+#endif
+
+        //! Decode filename into img. The caller's name goes into any error message.
+        static void decode (const std::string& filename, decoded& img, const std::string& caller)
+        {
+            std::vector<unsigned char> file;
+            unsigned lprtn = lodepng::load_file (file, filename);
+            if (lprtn == 0) {
+                lodepng::State state;
+                // Assume RGBA and bit depth of 8
+                state.info_raw.colortype = LCT_RGBA;
+                state.info_raw.bitdepth = 8;
+#ifdef MORPH_PNG_ZLIB
+                // Inflate and check CRCs with zlib
+                state.decoder.zlibsettings.custom_zlib = zlib_decompress;
+                lprtn = check_crcs (file);
+                state.decoder.ignore_crc = 1;
+#endif
+                if (lprtn == 0) { lprtn = lodepng_decode (&img.data, &img.w, &img.h, &state, file.data(), file.size()); }
+            }
+            if (lprtn != 0) {
+                std::string err = "morph::" + caller + ": lodepng::decode returned error code "
+                + std::to_string(lprtn) + std::string(": ") + std::string(lodepng_error_text (lprtn));
+                throw std::runtime_error (err);
+            }
+        }
+
+        template <typename T>
+        constexpr bool is_unit = std::is_same<std::decay_t<T>, float>::value || std::is_same<std::decay_t<T>, double>::value;
+        template <typename T>
+        constexpr bool is_byte = std::is_same<std::decay_t<T>, unsigned int>::value || std::is_same<std::decay_t<T>, unsigned char>::value;
+
+        /*!
+         * Convert the pixels of img into out, which holds C elements per pixel, applying
+         * px (const unsigned char* rgba, E* out_pixel) to each. The flips are made row by row,
+         * so the inner loops are branch free and can be vectorised.
+         */
+        template <std::size_t C, typename E, typename F>
+        static void convert (const decoded& img, E* out, const morph::vec<bool,2> flip, F px)
+        {
+            const int w = static_cast<int>(img.w);
+            const int h = static_cast<int>(img.h);
+#pragma omp parallel for
+            for (int c = 0; c < h; ++c) {
+                const unsigned char* src = img.data + 4 * std::size_t(w) * c;
+                E* dst = out + C * std::size_t(w) * (flip[1] ? h - c - 1 : c);
+                if (flip[0]) {
+#pragma omp simd
+                    for (int r = 0; r < w; ++r) { px (src + 4 * r, dst + C * (w - r - 1)); }
+                } else {
+#pragma omp simd
+                    for (int r = 0; r < w; ++r) { px (src + 4 * r, dst + C * r); }
+                }
+            }
+        }
+    } // namespace loadpng_internal
+
     /*
      * Wrap lodepng::decode to load a PNG from file, placing the data into the
      * image_data array. Figure out based on the type of T, how to scale the numbers.
@@ -37,69 +171,31 @@ namespace morph {
     static morph::vec<unsigned int, 2> loadpng (const std::string& filename, morph::vvec<T>& image_data,
                                                 const morph::vec<bool,2> flip = {false, true})
     {
-        std::vector<unsigned char> png;
-        unsigned int w = 0;
-        unsigned int h = 0;
-        // Assume RGBA and bit depth of 8
-        unsigned lprtn = lodepng::decode (png, w, h, filename, LCT_RGBA, 8);
-        if (lprtn != 0) {
-            std::string err = "morph::loadpng: lodepng::decode returned error code "
-            + std::to_string(lprtn) + std::string(": ") + std::string(lodepng_error_text (lprtn));
-            throw std::runtime_error (err);
-        }
+        loadpng_internal::decoded png;
+        loadpng_internal::decode (filename, png, "loadpng");
         // For return:
-        morph::vec<unsigned int, 2> dims = {w, h};
+        morph::vec<unsigned int, 2> dims = {png.w, png.h};
 
         // Now convert out into a value placed in image_data
         // If T is float or double, then get mean RGB, convert to range 0 to 1
         // If T is of integer type, then get mean and encode in range 0-255
-
-        unsigned int vsz = png.size();
-        if (vsz % 4 != 0) {
-            throw std::runtime_error ("morph::loadpng: Expect png vector to have size divisible by 4.");
-        }
-
-        image_data.resize (vsz/4);
-
-        for (unsigned int c = 0; c < dims[1]; ++c) {
-            for (unsigned int r = 0; r < dims[0]; ++r) {
-                // Offset into png
-                unsigned int i = 4*r + 4*dims[0]*c;
-                // Offset into image_data depends on what flips the caller wants
-                unsigned int idx = flip[0] == true ?
-                (flip[1]==true ? ((dims[0]-r-1) + dims[0]*(dims[1]-c-1)) : ((dims[0]-r-1) + dims[0]*c))
-                : (flip[1]==true ? (r + dims[0]*(dims[1]-c-1)) : (r + dims[0]*c));
-
-                // The above unpacks as:
-
-                // flip[0]==false and flip[1]==false: (no flipping)
-                // idx = r + dims[0]*c
-
-                // flip[0]==false and flip[1]==true: (vertical flip)
-                // idx = (r + dims[0]*(dims[1]-c-1))
-
-                // flip[0]==true and flip[1]==false: (horizontal flip)
-                // ((dims[0]-r-1) + dims[0]*c))
-
-                // flip[0]==true and flip[1]==true:  (v-h flip)
-                // ((dims[0]-r-1) + dims[0]*(dims[1]-c-1))
-
-                if constexpr (std::is_same<std::decay_t<T>, float>::value == true
-                              || std::is_same<std::decay_t<T>, double>::value == true) {
-                    // monochrome 0-1 values
-                    image_data[idx] = (static_cast<T>(png[i] + png[i+1] + png[i+2]))/T{765}; // 3*255
-
-                } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true
-                                     || std::is_same<std::decay_t<T>, unsigned char>::value == true) {
-                    // monochrome, 0-255 values
-                    image_data[idx] = (static_cast<T>(png[i] + png[i+1] + png[i+2]))/T{3};
-
-                } else {
-                    // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
-                    //[]<bool flag = false>() { static_assert(flag, "no match"); }();
-                    throw std::runtime_error ("morph::loadpng: type failure");
-                }
-            }
+        image_data.resize (std::size_t(png.w) * png.h);
+
+        if constexpr (loadpng_internal::is_unit<T>) {
+            // monochrome 0-1 values
+            loadpng_internal::convert<1> (png, image_data.data(), flip, [](const unsigned char* p, T* o) {
+                *o = (static_cast<T>(p[0] + p[1] + p[2]))/T{765}; // 3*255
+            });
+        } else if constexpr (loadpng_internal::is_byte<T>) {
+            // monochrome, 0-255 values
+            loadpng_internal::convert<1> (png, image_data.data(), flip, [](const unsigned char* p, T* o) {
+                // Divide before the cast, so that the sum can't overflow an unsigned char
+                *o = static_cast<T>((p[0] + p[1] + p[2]) / 3);
+            });
+        } else {
+            // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
+            //[]<bool flag = false>() { static_assert(flag, "no match"); }();
+            throw std::runtime_error ("morph::loadpng: type failure");
         }
 
         return dims;
@@ -119,78 +215,29 @@ namespace morph {
                                                 morph::vvec<morph::vec<T, N>>& image_data,
                                                 const morph::vec<bool,2> flip = {false, true})
     {
-        std::vector<unsigned char> png;
-        unsigned int w = 0;
-        unsigned int h = 0;
-        // Assume RGBA and bit depth of 8
-        unsigned lprtn = lodepng::decode (png, w, h, filename, LCT_RGBA, 8);
-        if (lprtn != 0) {
-            std::string err = "morph::loadpng: lodepng::decode returned error code "
-            + std::to_string(lprtn) + std::string(": ") + std::string(lodepng_error_text (lprtn));
-            throw std::runtime_error (err);
-        }
+        loadpng_internal::decoded png;
+        loadpng_internal::decode (filename, png, "loadpng");
         // For return:
-        morph::vec<unsigned int, 2> dims = {w, h};
-
-        // Now convert out into a value placed in image_data
-        // If T is float or double, then get mean RGB, convert to range 0 to 1
-        // If T is of integer type, then get mean and encode in range 0-255
-
-        unsigned int vsz = png.size();
-        if (vsz % 4 != 0) {
-            throw std::runtime_error ("morph::loadpng: Expect png vector to have size divisible by 4.");
-        }
-
-        image_data.resize (vsz/4);
-
-        for (unsigned int c = 0; c < dims[1]; ++c) {
-            for (unsigned int r = 0; r < dims[0]; ++r) {
-
-                // Offset into png
-                unsigned int i = 4*r + 4*dims[0]*c;
-                // Offset into image_data depends on what flips the caller wants
-                unsigned int idx = flip[0] == true ?
-                (flip[1]==true ? ((dims[0]-r-1) + dims[0]*(dims[1]-c-1)) : ((dims[0]-r-1) + dims[0]*c))
-                : (flip[1]==true ? (r + dims[0]*(dims[1]-c-1)) : (r + dims[0]*c));
-
-                if constexpr ((std::is_same<std::decay_t<T>, float>::value == true
-                               || std::is_same<std::decay_t<T>, double>::value == true) && N==3) {
-                    // RGB, 0-1 values
-                    unsigned char p0 = png[i];
-                    unsigned char p1 = png[i+1];
-                    unsigned char p2 = png[i+2];
-                    image_data[idx] = { static_cast<T>(p0), static_cast<T>(p1), static_cast<T>(p2) };
-                    image_data[idx] /= T{255};
-
-                } else if constexpr ((std::is_same<std::decay_t<T>, float>::value == true
-                                      || std::is_same<std::decay_t<T>, double>::value == true) && N==4) {
-                    // RGBA 0-1 values
-                    image_data[idx][0] = static_cast<T>(png[i]) / T{255};
-                    image_data[idx][1] = static_cast<T>(png[i+1]) / T{255};
-                    image_data[idx][2] = static_cast<T>(png[i+2]) / T{255};
-                    image_data[idx][3] = static_cast<T>(png[i+3]) / T{255};
-
-                } else if constexpr ((std::is_same<std::decay_t<T>, unsigned char>::value == true
-                                      || std::is_same<std::decay_t<T>, unsigned int>::value == true) && N==3) {
-                    // RGB, 0-255 values
-                    image_data[idx][0] = static_cast<T>(png[i]);
-                    image_data[idx][1] = static_cast<T>(png[i+1]);
-                    image_data[idx][2] = static_cast<T>(png[i+2]);
-
-                } else if constexpr ((std::is_same<std::decay_t<T>, unsigned char>::value == true
-                                      || std::is_same<std::decay_t<T>, unsigned int>::value == true) && N==4) {
-                    // RGBA, 0-255 values
-                    image_data[idx][0] = static_cast<T>(png[i]);
-                    image_data[idx][1] = static_cast<T>(png[i+1]);
-                    image_data[idx][2] = static_cast<T>(png[i+2]);
-                    image_data[idx][3] = static_cast<T>(png[i+3]);
-
-                } else {
-                    // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
-                    //[]<bool flag = false>() { static_assert(flag, "no match"); }();
-                    throw std::runtime_error ("morph::loadpng: type failure (or N is not 3 or 4)");
-                }
-            }
+        morph::vec<unsigned int, 2> dims = {png.w, png.h};
+
+        // If T is float or double, then convert RGB(A) to range 0 to 1
+        // If T is of integer type, then copy RGB(A) in range 0-255
+        image_data.resize (std::size_t(png.w) * png.h);
+
+        if constexpr (loadpng_internal::is_unit<T> && (N == 3 || N == 4)) {
+            // RGB(A), 0-1 values
+            loadpng_internal::convert<1> (png, image_data.data(), flip, [](const unsigned char* p, morph::vec<T, N>* o) {
+                for (std::size_t j = 0; j < N; ++j) { (*o)[j] = static_cast<T>(p[j]) / T{255}; }
+            });
+        } else if constexpr (loadpng_internal::is_byte<T> && (N == 3 || N == 4)) {
+            // RGB(A), 0-255 values
+            loadpng_internal::convert<1> (png, image_data.data(), flip, [](const unsigned char* p, morph::vec<T, N>* o) {
+                for (std::size_t j = 0; j < N; ++j) { (*o)[j] = static_cast<T>(p[j]); }
+            });
+        } else {
+            // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
+            //[]<bool flag = false>() { static_assert(flag, "no match"); }();
+            throw std::runtime_error ("morph::loadpng: type failure (or N is not 3 or 4)");
         }
 
         return dims;
@@ -201,131 +248,76 @@ namespace morph {
     static morph::vec<unsigned int, 2> loadpng_rgb (const std::string& filename, morph::vvec<T>& image_data,
                                                     const morph::vec<bool,2> flip = {false, true})
     {
-        std::vector<unsigned char> png;
-        unsigned int w = 0;
-        unsigned int h = 0;
-        // Assume RGBA and bit depth of 8
-        unsigned lprtn = lodepng::decode (png, w, h, filename, LCT_RGBA, 8);
-        if (lprtn != 0) {
-            std::string err = "morph::loadpng_rgb: lodepng::decode returned error code "
-            + std::to_string(lprtn) + std::string(": ") + std::string(lodepng_error_text (lprtn));
-            throw std::runtime_error (err);
-        }
+        loadpng_internal::decoded png;
+        loadpng_internal::decode (filename, png, "loadpng_rgb");
         // For return:
-        morph::vec<unsigned int, 2> dims = {w, h};
+        morph::vec<unsigned int, 2> dims = {png.w, png.h};
 
         // Now convert out into a value placed in image_data
         // If T is float or double, then for each in RGB, convert to range 0 to 1
         // If T is of integer type, then for each in RGB encode in range 0-255
-
-        unsigned int vsz = png.size();
-        if (vsz % 4 != 0) {
-            throw std::runtime_error ("morph::loadpng_rgb: Expect png vector to have size divisible by 4.");
+        image_data.resize (3 * std::size_t(png.w) * png.h);
+
+        if constexpr (loadpng_internal::is_unit<T>) {
+            loadpng_internal::convert<3> (png, image_data.data(), flip, [](const unsigned char* p, T* o) {
+                o[0] = static_cast<T>(p[0])/T{255};
+                o[1] = static_cast<T>(p[1])/T{255};
+                o[2] = static_cast<T>(p[2])/T{255};
+            });
+        } else if constexpr (loadpng_internal::is_byte<T>) {
+            // Copy RGB, 0-255 values
+            loadpng_internal::convert<3> (png, image_data.data(), flip, [](const unsigned char* p, T* o) {
+                o[0] = static_cast<T>(p[0]);
+                o[1] = static_cast<T>(p[1]);
+                o[2] = static_cast<T>(p[2]);
+            });
+        } else {
+            // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
+            //[]<bool flag = false>() { static_assert(flag, "no match"); }();
+            throw std::runtime_error ("morph::loadpng_rgb: type failure");
         }
 
-        image_data.resize (3*vsz/4);
-
-        for (unsigned int c = 0; c < dims[1]; ++c) {
-            for (unsigned int r = 0; r < dims[0]; ++r) {
-                // Offset into png
-                unsigned int i = 4*r + 4*dims[0]*c;
-                // Offset into image_data depends on what flips the caller wants
-                unsigned int idx_r = flip[0] == true ?
-                (flip[1]==true ? ((dims[0]-r-1) + dims[0]*(dims[1]-c-1)) : ((dims[0]-r-1) + dims[0]*c))
-                : (flip[1]==true ? (r + dims[0]*(dims[1]-c-1)) : (r + dims[0]*c));
-                idx_r *= 3; // Because our output is rgbrgb...
-                unsigned int idx_g = flip[0] == true ? idx_r-1 : idx_r+1;
-                unsigned int idx_b = flip[0] == true ? idx_r-2 : idx_r+2;
-
-                if constexpr (std::is_same<std::decay_t<T>, float>::value == true
-                              || std::is_same<std::decay_t<T>, double>::value == true) {
-                    image_data[idx_r] = static_cast<T>(png[i])/T{255};
-                    image_data[idx_g] = static_cast<T>(png[i+1])/T{255};
-                    image_data[idx_b] = static_cast<T>(png[i+2])/T{255};
-
-                } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true
-                                     || std::is_same<std::decay_t<T>, unsigned char>::value == true) {
-                    // Copy RGB, 0-255 values
-                    image_data[idx_r] = static_cast<T>(png[i]);
-                    image_data[idx_g] = static_cast<T>(png[i+1]);
-                    image_data[idx_b] = static_cast<T>(png[i+2]);
+        return dims;
+    }
 
-                } else {
-                    // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
-                    //[]<bool flag = false>() { static_assert(flag, "no match"); }();
-                    throw std::runtime_error ("morph::loadpng_rgb: type failure");
-                }
+    namespace loadpng_internal
+    {
+        //! Convert img into the RGBARGBA... out, scaled as for T
+        template <typename T>
+        static void convert_rgba (const decoded& img, T* out, const morph::vec<bool,2> flip, const std::string& caller)
+        {
+            if constexpr (is_unit<T>) {
+                convert<4> (img, out, flip, [](const unsigned char* p, T* o) {
+                    o[0] = static_cast<T>(p[0])/T{255};
+                    o[1] = static_cast<T>(p[1])/T{255};
+                    o[2] = static_cast<T>(p[2])/T{255};
+                    o[3] = static_cast<T>(p[3])/T{255};
+                });
+            } else if constexpr (is_byte<T>) {
+                // Copy RGBA, 0-255 values
+                convert<4> (img, out, flip, [](const unsigned char* p, T* o) {
+                    o[0] = static_cast<T>(p[0]);
+                    o[1] = static_cast<T>(p[1]);
+                    o[2] = static_cast<T>(p[2]);
+                    o[3] = static_cast<T>(p[3]);
+                });
+            } else {
+                throw std::runtime_error ("morph::" + caller + ": type failure");
             }
         }
-
-        return dims;
-    }
+    } // namespace loadpng_internal
 
     // Load a colour PNG and return a vector of type T with elements ordered as RGBARGBARGBA...
     template <typename T>
     static morph::vec<unsigned int, 2> loadpng_rgba (const std::string& filename, morph::vvec<T>& image_data,
                                                      const morph::vec<bool,2> flip = {false, true})
     {
-        std::vector<unsigned char> png;
-        unsigned int w = 0;
-        unsigned int h = 0;
-        // Assume RGBA and bit depth of 8
-        unsigned lprtn = lodepng::decode (png, w, h, filename, LCT_RGBA, 8);
-        if (lprtn != 0) {
-            std::string err = "morph::loadpng_rgba: lodepng::decode returned error code "
-            + std::to_string(lprtn) + std::string(": ") + std::string(lodepng_error_text(lprtn));
-            throw std::runtime_error (err);
-        }
+        loadpng_internal::decoded png;
+        loadpng_internal::decode (filename, png, "loadpng_rgba");
         // For return:
-        morph::vec<unsigned int, 2> dims = {w, h};
-
-        // Now convert out into a value placed in image_data
-        // If T is float or double, then get mean RGB, convert to range 0 to 1
-        // If T is of integer type, then get mean and encode in range 0-255
-
-        unsigned int vsz = png.size();
-        if (vsz % 4 != 0) {
-            throw std::runtime_error ("morph::loadpng_rgba: Expect png vector to have size divisible by 4.");
-        }
-
-        image_data.resize (vsz);
-
-        for (unsigned int c = 0; c < dims[1]; ++c) {
-            for (unsigned int r = 0; r < dims[0]; ++r) {
-                // Offset into png
-                unsigned int i = 4*r + 4*dims[0]*c;
-                // Offset into image_data depends on what flips the caller wants
-                unsigned int idx_r = flip[0] == true ?
-                (flip[1]==true ? ((dims[0]-r-1) + dims[0]*(dims[1]-c-1)) : ((dims[0]-r-1) + dims[0]*c))
-                : (flip[1]==true ? (r + dims[0]*(dims[1]-c-1)) : (r + dims[0]*c));
-                idx_r *= 4; // Because our output is rgbargba...
-                unsigned int idx_g = flip[0] == true ? idx_r-1 : idx_r+1;
-                unsigned int idx_b = flip[0] == true ? idx_r-2 : idx_r+2;
-                unsigned int idx_a = flip[0] == true ? idx_r-3 : idx_r+3;
-
-                if constexpr (std::is_same<std::decay_t<T>, float>::value == true
-                              || std::is_same<std::decay_t<T>, double>::value == true) {
-                    image_data[idx_r] = static_cast<T>(png[i])/T{255};
-                    image_data[idx_g] = static_cast<T>(png[i+1])/T{255};
-                    image_data[idx_b] = static_cast<T>(png[i+2])/T{255};
-                    image_data[idx_a] = static_cast<T>(png[i+3])/T{255};
-
-                } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true
-                                     || std::is_same<std::decay_t<T>, unsigned char>::value == true) {
-                    // Copy RGB, 0-255 values
-                    image_data[idx_r] = static_cast<T>(png[i]);
-                    image_data[idx_g] = static_cast<T>(png[i+1]);
-                    image_data[idx_b] = static_cast<T>(png[i+2]);
-                    image_data[idx_a] = static_cast<T>(png[i+3]);
-
-                } else {
-                    // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
-                    //[]<bool flag = false>() { static_assert(flag, "no match"); }();
-                    throw std::runtime_error ("morph::loadpng_rgba: type failure");
-                }
-            }
-        }
-
+        morph::vec<unsigned int, 2> dims = {png.w, png.h};
+        image_data.resize (4 * std::size_t(png.w) * png.h);
+        loadpng_internal::convert_rgba (png, image_data.data(), flip, "loadpng_rgba");
         return dims;
     }
 
@@ -334,67 +326,43 @@ namespace morph {
     static morph::vec<unsigned int, 2> loadpng_rgba (const std::string& filename, morph::vec<T, 4*im_w*im_h>& image_data,
                                                      const morph::vec<bool,2> flip = {false, true})
     {
-        std::vector<unsigned char> png;
-        unsigned int w = 0;
-        unsigned int h = 0;
-        // Assume RGBA and bit depth of 8
-        unsigned lprtn = lodepng::decode (png, w, h, filename, LCT_RGBA, 8);
-        if (lprtn != 0) {
-            std::string err = "morph::loadpng_rgba: lodepng::decode returned error code "
-            + std::to_string(lprtn) + std::string(": ") + std::string(lodepng_error_text(lprtn));
-            throw std::runtime_error (err);
-        }
+        loadpng_internal::decoded png;
+        loadpng_internal::decode (filename, png, "loadpng_rgba");
         // For return:
-        morph::vec<unsigned int, 2> dims = {w, h};
-        if (w != im_w || h != im_h) {
+        morph::vec<unsigned int, 2> dims = {png.w, png.h};
+        if (png.w != im_w || png.h != im_h) {
             throw std::runtime_error ("morph::loadpng_rgba: Expect png to be the size specified in the template args.");
         }
+        loadpng_internal::convert_rgba (png, image_data.data(), flip, "loadpng_rgba");
+        return dims;
+    }
 
-        // Now convert out into a value placed in image_data
-        // If T is float or double, then get mean RGB, convert to range 0 to 1
-        // If T is of integer type, then get mean and encode in range 0-255
-
-        unsigned int vsz = png.size();
-        if (vsz % 4 != 0) {
-            throw std::runtime_error ("morph::loadpng_rgba: Expect png vector to have size divisible by 4.");
-        }
-
-        for (unsigned int c = 0; c < dims[1]; ++c) {
-            for (unsigned int r = 0; r < dims[0]; ++r) {
-                // Offset into png
-                unsigned int i = 4*r + 4*dims[0]*c;
-                // Offset into image_data depends on what flips the caller wants
-                unsigned int idx_r = flip[0] == true ?
-                (flip[1]==true ? ((dims[0]-r-1) + dims[0]*(dims[1]-c-1)) : ((dims[0]-r-1) + dims[0]*c))
-                : (flip[1]==true ? (r + dims[0]*(dims[1]-c-1)) : (r + dims[0]*c));
-                idx_r *= 4; // Because our output is rgbargba...
-                unsigned int idx_g = flip[0] == true ? idx_r-1 : idx_r+1;
-                unsigned int idx_b = flip[0] == true ? idx_r-2 : idx_r+2;
-                unsigned int idx_a = flip[0] == true ? idx_r-3 : idx_r+3;
-
-                if constexpr (std::is_same<std::decay_t<T>, float>::value == true
-                              || std::is_same<std::decay_t<T>, double>::value == true) {
-                    image_data[idx_r] = static_cast<T>(png[i])/T{255};
-                    image_data[idx_g] = static_cast<T>(png[i+1])/T{255};
-                    image_data[idx_b] = static_cast<T>(png[i+2])/T{255};
-                    image_data[idx_a] = static_cast<T>(png[i+3])/T{255};
-
-                } else if constexpr (std::is_same<std::decay_t<T>, unsigned int>::value == true
-                                     || std::is_same<std::decay_t<T>, unsigned char>::value == true) {
-                    // Copy RGB, 0-255 values
-                    image_data[idx_r] = static_cast<T>(png[i]);
-                    image_data[idx_g] = static_cast<T>(png[i+1]);
-                    image_data[idx_b] = static_cast<T>(png[i+2]);
-                    image_data[idx_a] = static_cast<T>(png[i+3]);
-
-                } else {
-                    // C++-20 mechanism to trigger a compiler error for the else case. Not user friendly!
-                    //[]<bool flag = false>() { static_assert(flag, "no match"); }();
-                    throw std::runtime_error ("morph::loadpng_rgba: type failure");
-                }
+    /*
+     * Load each of filenames into the corresponding element of images (which is resized to
+     * match) with loadpng, decoding the files in parallel with OpenMP. Returns the dimensions
+     * of each image. If any file fails to load, the others are still loaded, then the error
+     * of the first that failed is thrown.
+     *
+     * T is as for loadpng: float, double, unsigned char/int or morph::vec<float, 3> etc.
+     */
+    template <typename T>
+    static std::vector<morph::vec<unsigned int, 2>> loadpng_batch (const std::vector<std::string>& filenames,
+                                                                   std::vector<morph::vvec<T>>& images,
+                                                                   const morph::vec<bool,2> flip = {false, true})
+    {
+        const int n = static_cast<int>(filenames.size());
+        images.resize (filenames.size());
+        std::vector<morph::vec<unsigned int, 2>> dims (filenames.size(), morph::vec<unsigned int, 2>{0u, 0u});
+        std::vector<std::exception_ptr> errors (filenames.size());
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n; ++i) {
+            try {
+                dims[i] = morph::loadpng (filenames[i], images[i], flip);
+            } catch (...) {
+                errors[i] = std::current_exception();
             }
         }
-
+        for (const auto& e : errors) { if (e) { std::rethrow_exception (e); } }
         return dims;
     }
 
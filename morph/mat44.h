@@ -12,10 +12,14 @@
 #include <morph/quaternion.h>
 #include <morph/vec.h>
 #include <morph/constexpr_math.h>
+#include <morph/simd4.h>
 #include <array>
+#include <span>
+#include <type_traits>
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <stdexcept>
 
 namespace morph {
 
@@ -448,9 +452,21 @@ namespace morph {
          * 1. Compute determinant of this->mat (if 0, then there's no inverse)
          * 2. Obtain the adjugate matrix
          * 3. Get the inverse by multiplying 1/determinant by the adjugate
+         *
+         * At runtime, mat44<float> is instead inverted blockwise in SIMD registers (see
+         * simd4::mat44_inverse), which agrees with this to within rounding.
          */
         constexpr mat44<F> invert()
         {
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    mat44<F> rtn;
+                    if (!morph::simd4::mat44_inverse (this->mat.data(), rtn.mat.data())) { rtn.mat.fill (F{0}); }
+                    return rtn;
+                }
+            }
+#endif
             F det = this->determinant();
             mat44<F> rtn;
             if (det == F{0}) {
@@ -504,6 +520,15 @@ namespace morph {
             m[14] = T{0};
             m[15] = T{1};
 
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float> && std::is_same_v<T, float>) {
+                if (!std::is_constant_evaluated()) {
+                    // m is a pure rotation, so only three columns of this->mat change
+                    morph::simd4::mat44_mul_rotation (this->mat.data(), m.data());
+                    return;
+                }
+            }
+#endif
             *this *= m;
         }
 
@@ -525,6 +550,14 @@ namespace morph {
         //! Right-multiply this->mat with m2.
         constexpr void operator*= (const std::array<F, 16>& m2)
         {
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mul (this->mat.data(), m2.data(), this->mat.data());
+                    return;
+                }
+            }
+#endif
             std::array<F, 16> result;
             // Top row
             result[0] = this->mat[0] * m2[0]
@@ -604,6 +637,14 @@ namespace morph {
         //! Right-multiply this->mat with m2.mat.
         constexpr void operator*= (const mat44<F>& m2)
         {
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mul (this->mat.data(), m2.mat.data(), this->mat.data());
+                    return;
+                }
+            }
+#endif
             std::array<F, 16> result;
             // Top row
             result[0] = this->mat[0] * m2.mat[0]
@@ -683,6 +724,14 @@ namespace morph {
         constexpr mat44<F> operator* (const std::array<F, 16>& m2) const
         {
             mat44<F> result;
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mul (this->mat.data(), m2.data(), result.mat.data());
+                    return result;
+                }
+            }
+#endif
             // Top row
             result.mat[0] = this->mat[0] * m2[0]
                 + this->mat[4] * m2[1]
@@ -762,6 +811,14 @@ namespace morph {
         constexpr mat44<F> operator* (const mat44<F>& m2) const
         {
             mat44<F> result;
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mul (this->mat.data(), m2.mat.data(), result.mat.data());
+                    return result;
+                }
+            }
+#endif
             // Top row
             result.mat[0] = this->mat[0] * m2.mat[0]
                 + this->mat[4] * m2.mat[1]
@@ -841,6 +898,14 @@ namespace morph {
         constexpr std::array<F, 4> operator* (const std::array<F, 4>& v1) const
         {
             std::array<F, 4> v;
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mulv (this->mat.data(), v1.data(), v.data());
+                    return v;
+                }
+            }
+#endif
             v[0] = this->mat[0] * v1[0]
                 + this->mat[4] * v1[1]
                 + this->mat[8] * v1[2]
@@ -864,6 +929,14 @@ namespace morph {
         constexpr vec<F, 4> operator* (const vec<F, 4>& v1) const
         {
             vec<F, 4> v;
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mulv (this->mat.data(), v1.data(), v.data());
+                    return v;
+                }
+            }
+#endif
             v[0] = this->mat[0] * v1.x()
                 + this->mat[4] * v1.y()
                 + this->mat[8] * v1.z()
@@ -887,6 +960,14 @@ namespace morph {
         constexpr vec<F, 4> operator* (const vec<F, 3>& v1) const
         {
             vec<F, 4> v;
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mat44_mulv3 (this->mat.data(), v1.data(), v.data());
+                    return v;
+                }
+            }
+#endif
             v[0] = this->mat[0] * v1.x()
                 + this->mat[4] * v1.y()
                 + this->mat[8] * v1.z()
@@ -906,6 +987,21 @@ namespace morph {
             return v;
         }
 
+        /*!
+         * Transform the 3D points \a in (as if each had w = 1) by this matrix into \a out, keeping
+         * x, y and z of each result. \a out must be as long as \a in and may be the same memory.
+         */
+        void transform_points (std::span<const vec<F, 3>> in, std::span<vec<F, 3>> out) const
+        {
+            this->transform3 (in, out, true);
+        }
+
+        //! Transform the 3D directions \a in (w = 0, so no translation) into \a out
+        void transform_directions (std::span<const vec<F, 3>> in, std::span<vec<F, 3>> out) const
+        {
+            this->transform3 (in, out, false);
+        }
+
         //! *= operator for a scalar value.
         template <typename T=F>
         constexpr void operator*= (const T& f)
@@ -1057,6 +1153,29 @@ namespace morph {
 
         //! Overload the stream output operator
         friend std::ostream& operator<< <F> (std::ostream& os, const mat44<F>& tm);
+
+    private:
+        void transform3 (std::span<const vec<F, 3>> in, std::span<vec<F, 3>> out, const bool points) const
+        {
+            if (out.size() != in.size()) {
+                throw std::runtime_error ("mat44::transform3: Ensure in.size()==out.size()");
+            }
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<F, float>) {
+                static_assert (sizeof (vec<F, 3>) == 3 * sizeof (F));
+                morph::simd4::mat44_transform3 (this->mat.data(), reinterpret_cast<const float*>(in.data()),
+                                                reinterpret_cast<float*>(out.data()), in.size(), points);
+                return;
+            }
+#endif
+            for (std::size_t i = 0; i < in.size(); ++i) {
+                const vec<F, 3> v = in[i];
+                for (unsigned int j = 0; j < 3; ++j) {
+                    out[i][j] = this->mat[j] * v[0] + this->mat[4 + j] * v[1] + this->mat[8 + j] * v[2]
+                        + (points ? this->mat[12 + j] : F{0});
+                }
+            }
+        }
     };
 
     template <typename F>
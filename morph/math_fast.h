@@ -0,0 +1,446 @@
+/*!
+ * \file
+ * \brief Fast, vectorisable approximations of exp, log, sigmoid, tanh, sin and cos.
+ *
+ * The functions in morph::math::fast are polynomial (or, for log, rational) approximations
+ * with the range reductions done by bit manipulation rather than calls into libm. They have
+ * no data dependent branches, so a loop over an array of them vectorises (the overloads that
+ * take a pointer and a size are such loops). Each takes a target accuracy, in units in the
+ * last place (ulp), as its template parameter, and uses the lowest order polynomial that
+ * meets it:
+ *
+ *\code{.cpp}
+ * float y = morph::math::fast::exp (x);         // within 4 ulp of std::exp
+ * float z = morph::math::fast::exp<256> (x);    // within 256 ulp, and quicker
+ *\endcode
+ *
+ * The targets hold for finite arguments giving normal results. exp, sigmoid and tanh are
+ * correct to the limits of the type (overflow to inf, underflow to 0); log returns NaN for
+ * negative arguments and -inf for 0. sin and cos reduce the argument accurately for
+ * |x| < fast::trig_fast_range and hand larger arguments to std::sin and std::cos.
+ *
+ * vvec uses these in its *_fast element functions, such as vvec::exp_fast<ulp>().
+ *
+ * Over an array, with AVX2 and FMA (-march=native on a recent x86), the float functions are 2
+ * to 3 times as fast as libm's and the double ones about twice as fast. With only the SSE2 of
+ * the x86-64 baseline the float versions gain less, and the double versions nothing.
+ */
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <morph/math.h>
+
+namespace morph {
+    namespace math {
+        namespace fast {
+
+            //! The largest |x| for which sin and cos reduce x without libm
+            template <typename T>
+            constexpr T trig_fast_range = T{524288}; // 2^19
+
+            namespace internal
+            {
+                // Bit layout of the floating point types
+                template <typename T> struct fp;
+                template <> struct fp<float>
+                {
+                    using I = std::int32_t;
+                    using U = std::uint32_t;
+                    static constexpr int mant_bits = 23;
+                    static constexpr I bias = 127;
+                    static constexpr float exp_hi = 88.72283935546875f; // exp(x) overflows above...
+                    static constexpr float exp_lo = -103.97208404541015625f; // ...and is 0 below
+                    static constexpr float tanh_sat = 9.1f; // tanh(x) rounds to 1 above
+                };
+                template <> struct fp<double>
+                {
+                    using I = std::int64_t;
+                    using U = std::uint64_t;
+                    static constexpr int mant_bits = 52;
+                    static constexpr I bias = 1023;
+                    static constexpr double exp_hi = 709.782712893383973096;
+                    static constexpr double exp_lo = -745.1332191019412076235;
+                    static constexpr double tanh_sat = 19.1;
+                };
+
+                /*
+                 * Conditions are worked out on the bit patterns, as integers, and results chosen with
+                 * bitwise selects. A comparison of floating point values and a ?: would do the same,
+                 * but gcc will not vectorise those unless floating point traps are switched off.
+                 */
+                template <typename T>
+                using bits_t = typename fp<T>::I;
+                template <typename T>
+                using ubits_t = typename fp<T>::U;
+
+                template <typename T>
+                bits_t<T> bits (const T x) { return std::bit_cast<bits_t<T>>(x); }
+
+                //! The bits of |x|, which order as |x| does, with NaNs above infinity
+                template <typename T>
+                bits_t<T> abs_bits (const T x) { return bits (x) & std::numeric_limits<bits_t<T>>::max(); }
+
+                // The masks are made from sign bits with a logical shift, which (unlike an arithmetic
+                // shift or a comparison of 64 bit integers) SSE2 can do on vectors of doubles.
+
+                //! All ones where the integer a is negative
+                template <typename T>
+                bits_t<T> neg_mask (const bits_t<T> a)
+                {
+                    return -static_cast<bits_t<T>>(static_cast<ubits_t<T>>(a) >> (8 * sizeof(T) - 1));
+                }
+
+                //! All ones where a < b, for a and b not NaN
+                template <typename T>
+                bits_t<T> lt (const T a, const T b) { return neg_mask<T>(bits (T(a - b))); }
+
+                //! All ones where a < b, for integers a and b in [0, 2^(bits - 2))
+                template <typename T>
+                bits_t<T> lt_bits (const bits_t<T> a, const bits_t<T> b) { return neg_mask<T>(a - b); }
+
+                //! All ones where x is NaN
+                template <typename T>
+                bits_t<T> nan_mask (const T x) { return lt_bits<T>(bits (std::numeric_limits<T>::infinity()), abs_bits (x)); }
+
+                //! a where m is all ones, b where it is zero
+                template <typename T>
+                T select (const bits_t<T> m, const T a, const T b) { return std::bit_cast<T>((m & bits (a)) | (~m & bits (b))); }
+
+                //! 2^k for k in the range of normal exponents
+                template <typename T>
+                T pow2 (const typename fp<T>::I k)
+                {
+                    using F = fp<T>;
+                    return std::bit_cast<T>(static_cast<typename F::U>(k + F::bias) << F::mant_bits);
+                }
+
+                /*
+                 * Round x (|x| < 2^(mant_bits-1)) to the nearest integer by adding and subtracting
+                 * 1.5 * 2^mant_bits, which vectorises where std::nearbyint and conversions to 64 bit
+                 * integers may not. The integer is left in the low bits of the sum and is returned in
+                 * ki. This relies on the compiler keeping to IEEE arithmetic (no -ffast-math).
+                 */
+                template <typename T>
+                T round_int (const T x, typename fp<T>::I& ki)
+                {
+                    using F = fp<T>;
+                    constexpr T shift = T{1.5} * static_cast<T>(typename F::U{1} << F::mant_bits);
+                    const T y = x + shift;
+                    ki = std::bit_cast<typename F::I>(y) - std::bit_cast<typename F::I>(shift);
+                    return y - shift;
+                }
+
+                //! The integer k (|k| < 2^(mant_bits-1)) as a T, the inverse of round_int
+                template <typename T>
+                T to_real (const typename fp<T>::I k)
+                {
+                    using F = fp<T>;
+                    constexpr T shift = T{1.5} * static_cast<T>(typename F::U{1} << F::mant_bits);
+                    return std::bit_cast<T>(std::bit_cast<typename F::I>(shift) + k) - shift;
+                }
+
+                //! The N polynomial coefficients c[n] = cf(n), computed at compile time in long double
+                template <typename T, int N, typename CF>
+                constexpr std::array<T, N> coeffs (CF cf)
+                {
+                    std::array<T, N> c = {};
+                    for (int n = 0; n < N; ++n) { c[n] = static_cast<T>(cf (n)); }
+                    return c;
+                }
+
+                //! Evaluate c[0] + c[1] x + c[2] x^2 + ... by Horner's method
+                template <typename T, std::size_t N>
+                T horner (const T x, const std::array<T, N>& c)
+                {
+                    T p = c[N - 1];
+                    for (std::size_t n = N - 1; n > 0; --n) { p = p * x + c[n - 1]; }
+                    return p;
+                }
+
+                constexpr long double inv_factorial (const int n) { return 1.0L / morph::math::factorial<long double, int>(n); }
+
+                /*
+                 * exp(x) = 2^k exp(r) with x = k ln2 + r and |r| <= ln2/2. exp(r) - 1 is a Taylor
+                 * polynomial of degree D. The scaling by 2^k is done in two halves so that results
+                 * down to the subnormals are right. Returns exp(x) - 1 if Em1 is true.
+                 */
+                template <typename T, int D, bool Em1 = false>
+                inline T exp_d (const T x)
+                {
+                    using F = fp<T>;
+                    using I = typename F::I;
+                    constexpr T log2e = T{1.44269504088896340736L};
+                    constexpr T ln2_hi = T{0.693145751953125L}; // ln2 to 16 bits, so k * ln2_hi is exact
+                    constexpr T ln2_lo = T{1.42860682030941723212e-6L};
+                    // (exp(r) - 1) / r = 1 + r/2! + r^2/3! + ...
+                    static constexpr std::array<T, D> c = coeffs<T, D> ([](int n) { return inv_factorial (n + 1); });
+                    const bits_t<T> nan = nan_mask (x);
+                    const bits_t<T> over = lt (F::exp_hi, x);
+                    const bits_t<T> under = lt (x, F::exp_lo);
+                    const T xc = select<T> (nan | over | under, select<T> (over, F::exp_hi, F::exp_lo), x);
+                    I ki = 0;
+                    const T k = round_int (xc * log2e, ki);
+                    const T r = (xc - k * ln2_hi) - k * ln2_lo;
+                    const T q = r * horner (r, c);
+                    const I k1 = ki >> 1;
+                    T y;
+                    if constexpr (Em1) {
+                        // 2^k (1 + q) - 1 = (2^k - 1) + 2^k q, exact for k == 0 where it matters
+                        const T s = pow2<T>(k1) * pow2<T>(ki - k1);
+                        y = select<T> (under, T{-1}, (s - T{1}) + s * q);
+                    } else {
+                        y = select<T> (under, T{0}, ((T{1} + q) * pow2<T>(k1)) * pow2<T>(ki - k1));
+                    }
+                    y = select<T> (over, std::numeric_limits<T>::infinity(), y);
+                    return select<T> (nan, x, y);
+                }
+
+                /*
+                 * log(x) = e ln2 + log(1 + f) with 1 + f in [sqrt(1/2), sqrt(2)). With s = f / (2 + f),
+                 * log(1 + f) = 2 atanh(s) = f - f^2/2 + s (f^2/2 + R(s^2)), R being a polynomial of
+                 * degree D in s^2 (the arrangement of fdlibm's log).
+                 */
+                template <typename T, int D>
+                inline T log_d (const T x)
+                {
+                    using F = fp<T>;
+                    using I = typename F::I;
+                    using U = typename F::U;
+                    constexpr T ln2_hi = T{0.693145751953125L};
+                    constexpr T ln2_lo = T{1.42860682030941723212e-6L};
+                    constexpr T sqrt2 = T{1.41421356237309504880L};
+                    // R(z) / z = 2/3 + 2z/5 + 2z^2/7 + ...
+                    static constexpr std::array<T, D> c = coeffs<T, D> ([](int n) { return 2.0L / (2 * n + 3); });
+                    // Scale subnormals into the normal range
+                    const bits_t<T> sub = lt_bits<T>(abs_bits (x), bits (std::numeric_limits<T>::min()));
+                    const T xs = select<T> (sub, x * pow2<T>(F::mant_bits + 1), x);
+                    const U ubits = std::bit_cast<U>(xs);
+                    I e = static_cast<I>(ubits >> F::mant_bits) - F::bias - (sub & (F::mant_bits + 1));
+                    T m = std::bit_cast<T>((ubits & ((U{1} << F::mant_bits) - 1)) | (static_cast<U>(F::bias) << F::mant_bits));
+                    const bits_t<T> big = lt_bits<T>(bits (sqrt2), bits (m));
+                    m = select<T> (big, m * T{0.5}, m);
+                    e -= big;
+                    const T f = m - T{1};
+                    const T s = f / (T{2} + f);
+                    const T z = s * s;
+                    const T R = z * horner (z, c);
+                    const T hf = T{0.5} * f * f;
+                    const T de = to_real<T>(e);
+                    T y = de * ln2_hi - ((hf - (s * (hf + R) + de * ln2_lo)) - f);
+                    // log(+-0) = -inf, log(inf) = inf, log(NaN) = NaN and log(x < 0) = NaN
+                    const bits_t<T> zero = lt_bits<T>(abs_bits (x), 1);
+                    y = select<T> (zero, -std::numeric_limits<T>::infinity(), y);
+                    y = select<T> (~lt_bits<T>(abs_bits (x), bits (std::numeric_limits<T>::infinity())), x, y);
+                    return select<T> (neg_mask<T>(bits (x)) & ~zero, std::numeric_limits<T>::quiet_NaN(), y);
+                }
+
+                /*
+                 * sin(x) or cos(x) for |x| < trig_fast_range. x is reduced to r = x - k pi/2,
+                 * |r| <= pi/4, with pi/2 split in three, the first two parts with 33 significant bits
+                 * so that their products with k are exact. floats are reduced in double precision.
+                 * sin(r) and cos(r) are Taylor polynomials with D terms beyond the first.
+                 */
+                template <typename T, int D, bool Cos>
+                inline T sincos_reduced (const T x)
+                {
+                    constexpr double pio2_1 = 1.57079632673412561417e+00;
+                    constexpr double pio2_2 = 6.07710050630396597660e-11;
+                    constexpr double pio2_3 = 2.02226624871116645580e-21;
+                    constexpr double pio2_3t = 8.47842766036889956997e-32;
+                    constexpr double twoopi = 6.36619772367581382433e-01;
+                    // (sin(r) - r) / r^3 and (cos(r) - 1 + r^2/2) / r^4 as polynomials in r^2
+                    static constexpr std::array<T, D> cs = coeffs<T, D> ([](int n) { return (n % 2 ? 1.0L : -1.0L) * inv_factorial (2 * n + 3); });
+                    static constexpr std::array<T, D - 1> cc = coeffs<T, D - 1> ([](int n) { return (n % 2 ? -1.0L : 1.0L) * inv_factorial (2 * n + 4); });
+
+                    const double xd = static_cast<double>(x);
+                    bits_t<T> k = 0;
+                    double kd;
+                    T r;
+                    if constexpr (std::is_same_v<T, float>) {
+                        // k in single precision keeps the loop in 32 bit lanes
+                        kd = static_cast<double>(round_int (x * static_cast<float>(twoopi), k));
+                        r = static_cast<float>((xd - kd * pio2_1) - kd * pio2_2);
+                    } else {
+                        kd = round_int (xd * twoopi, k);
+                        const double r1 = (xd - kd * pio2_1) - kd * pio2_2;
+                        r = (r1 - kd * pio2_3) - kd * pio2_3t;
+                    }
+                    const T z = r * r;
+                    const T s = r + r * z * horner (z, cs);
+                    const T c = T{1} - T{0.5} * z + z * z * horner (z, cc);
+                    // sin(r + k pi/2) and cos(r + k pi/2) repeat with k mod 4
+                    const bits_t<T> q = Cos ? k + 1 : k;
+                    const T y = select<T> (-(q & 1), c, s);
+                    return select<T> (-((q >> 1) & 1), -y, y);
+                }
+
+                template <typename T, int D, bool Cos>
+                T sincos_d (const T x)
+                {
+                    if (std::abs (x) < trig_fast_range<T>) { return sincos_reduced<T, D, Cos> (x); }
+                    return Cos ? std::cos (x) : std::sin (x);
+                }
+
+                //! sin or cos of the n elements at p, in a vectorisable loop and a pass for any large ones
+                template <typename T, int D, bool Cos>
+                inline void sincos_array (T* p, const std::size_t n)
+                {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const T x = p[i];
+                        const bits_t<T> small = lt_bits<T>(abs_bits (x), bits (trig_fast_range<T>));
+                        p[i] = select<T> (small, sincos_reduced<T, D, Cos> (select<T> (small, x, T{0})), x);
+                    }
+                    for (std::size_t i = 0; i < n; ++i) {
+                        if (abs_bits (p[i]) > bits (T{1})) { p[i] = Cos ? std::cos (p[i]) : std::sin (p[i]); }
+                    }
+                }
+
+                /*
+                 * The polynomial degrees for each accuracy target. Each degree is used for targets
+                 * above about 1.5 times the largest error measured with it, over millions of
+                 * arguments (see tests/testmath_fast.cpp).
+                 */
+                template <typename T>
+                constexpr int exp_degree (const unsigned int ulp)
+                {
+                    if constexpr (std::is_same_v<T, float>) {
+                        return ulp >= 16384 ? 3 : ulp >= 1024 ? 4 : ulp >= 64 ? 5 : ulp >= 8 ? 6 : 7;
+                    } else {
+                        return ulp >= (1u << 27) ? 7 : ulp >= (1u << 22) ? 8 : ulp >= (1u << 17) ? 9
+                        : ulp >= 4096 ? 10 : ulp >= 128 ? 11 : ulp >= 4 ? 12 : 13;
+                    }
+                }
+                // expm1's errors are about four times exp's for the same degree
+                template <typename T>
+                constexpr int expm1_degree (const unsigned int ulp) { return exp_degree<T> (ulp / 4); }
+                template <typename T>
+                constexpr int log_degree (const unsigned int ulp)
+                {
+                    if constexpr (std::is_same_v<T, float>) {
+                        return ulp >= 4096 ? 1 : ulp >= 64 ? 2 : ulp >= 4 ? 3 : 4;
+                    } else {
+                        return ulp >= (1u << 30) ? 3 : ulp >= (1u << 25) ? 4 : ulp >= (1u << 19) ? 5
+                        : ulp >= 16384 ? 6 : ulp >= 512 ? 7 : ulp >= 16 ? 8 : 9;
+                    }
+                }
+                template <typename T>
+                constexpr int trig_degree (const unsigned int ulp)
+                {
+                    if constexpr (std::is_same_v<T, float>) {
+                        return ulp >= 16384 ? 2 : ulp >= 256 ? 3 : 4;
+                    } else {
+                        return ulp >= (1u << 28) ? 4 : ulp >= (1u << 21) ? 5 : ulp >= 8192 ? 6 : ulp >= 32 ? 7 : 8;
+                    }
+                }
+
+                template <typename T>
+                void check_type()
+                {
+                    static_assert (std::is_same_v<T, float> || std::is_same_v<T, double>,
+                                   "morph::math::fast functions are for float and double");
+                }
+            } // namespace internal
+
+            //! The smallest accuracy target, in ulp, that the functions accept
+            constexpr unsigned int min_ulp = 4;
+
+            //! e^x, within ulp units in the last place
+            template <unsigned int ulp = 4, typename T>
+            T exp (const T x)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                return internal::exp_d<T, internal::exp_degree<T>(ulp)> (x);
+            }
+
+            //! e^x - 1, accurate (within ulp) for small x too
+            template <unsigned int ulp = 4, typename T>
+            T expm1 (const T x)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                return internal::exp_d<T, internal::expm1_degree<T>(ulp), true> (x);
+            }
+
+            //! The natural logarithm, within ulp
+            template <unsigned int ulp = 4, typename T>
+            T log (const T x)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                return internal::log_d<T, internal::log_degree<T>(ulp)> (x);
+            }
+
+            //! The logistic function 1 / (1 + e^-x), within 2 ulp + 2
+            template <unsigned int ulp = 4, typename T>
+            T sigmoid (const T x) { return T{1} / (T{1} + morph::math::fast::exp<ulp> (-x)); }
+
+            //! The hyperbolic tangent, within 2 ulp + 2
+            template <unsigned int ulp = 4, typename T>
+            T tanh (const T x)
+            {
+                // tanh |x| = em / (em + 2) with em = e^(2|x|) - 1, and 1 where that rounds to 1
+                using namespace internal;
+                const T ax = std::abs (x);
+                const bits_t<T> sat = ~lt (ax, fp<T>::tanh_sat);
+                const T em = morph::math::fast::expm1<ulp> (T{2} * select<T> (sat, T{0}, ax));
+                const T t = select<T> (sat, T{1}, em / (em + T{2}));
+                // with the sign of x, and NaN for NaN
+                return select<T> (nan_mask (x), x, std::copysign (t, x));
+            }
+
+            //! sin(x), within ulp for |x| < trig_fast_range
+            template <unsigned int ulp = 4, typename T>
+            T sin (const T x)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                return internal::sincos_d<T, internal::trig_degree<T>(ulp), false> (x);
+            }
+
+            //! cos(x), within ulp for |x| < trig_fast_range
+            template <unsigned int ulp = 4, typename T>
+            T cos (const T x)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                return internal::sincos_d<T, internal::trig_degree<T>(ulp), true> (x);
+            }
+
+            /*
+             * The same, in place on the n elements at p, in loops that the compiler can vectorise
+             */
+            template <unsigned int ulp = 4, typename T>
+            void exp (T* p, const std::size_t n) { for (std::size_t i = 0; i < n; ++i) { p[i] = morph::math::fast::exp<ulp>(p[i]); } }
+            template <unsigned int ulp = 4, typename T>
+            void expm1 (T* p, const std::size_t n) { for (std::size_t i = 0; i < n; ++i) { p[i] = morph::math::fast::expm1<ulp>(p[i]); } }
+            template <unsigned int ulp = 4, typename T>
+            void log (T* p, const std::size_t n) { for (std::size_t i = 0; i < n; ++i) { p[i] = morph::math::fast::log<ulp>(p[i]); } }
+            template <unsigned int ulp = 4, typename T>
+            void sigmoid (T* p, const std::size_t n) { for (std::size_t i = 0; i < n; ++i) { p[i] = morph::math::fast::sigmoid<ulp>(p[i]); } }
+            template <unsigned int ulp = 4, typename T>
+            void tanh (T* p, const std::size_t n) { for (std::size_t i = 0; i < n; ++i) { p[i] = morph::math::fast::tanh<ulp>(p[i]); } }
+            template <unsigned int ulp = 4, typename T>
+            void sin (T* p, const std::size_t n)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                internal::sincos_array<T, internal::trig_degree<T>(ulp), false> (p, n);
+            }
+            template <unsigned int ulp = 4, typename T>
+            void cos (T* p, const std::size_t n)
+            {
+                internal::check_type<T>();
+                static_assert (ulp >= min_ulp, "morph::math::fast: the accuracy target must be at least min_ulp");
+                internal::sincos_array<T, internal::trig_degree<T>(ulp), true> (p, n);
+            }
+
+        } // namespace fast
+    } // namespace math
+} // namespace morph
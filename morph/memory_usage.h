@@ -0,0 +1,161 @@
+/*!
+ * \file
+ *
+ * A report of the memory held by a component of a program, broken down into its parts, for
+ * finding out which component it is that fills a node's memory. HexGrid, CartGrid,
+ * VisualModel, VisualTextModel, VisualFace, FeedForwardNet and RD_Base each have a
+ * memory_usage() that returns one of these; VisualOwnable::memory_usage() reports a whole
+ * scene.
+ *
+ *\code{.cpp}
+ * std::cout << hg.memory_usage().str();
+ *\endcode
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <sstream>
+#include <iomanip>
+#include <cstddef>
+#include <utility>
+#include <tuple>
+
+namespace morph {
+
+    //! A container that allocates its elements on the heap (a std::vector, std::list, vvec...)
+    template <typename T>
+    concept heap_container = requires (const T& t) {
+        typename T::allocator_type;
+        typename T::value_type;
+        t.size();
+        t.begin();
+    };
+
+    /*!
+     * The heap memory held by t, in bytes: the storage of a container and, in turn, of any
+     * containers in it. A vector counts its capacity; a node based container (std::list,
+     * std::map...) its size, with two pointers per node on top of each element, which is an
+     * estimate. Anything else (including a std::array of scalars) holds nothing on the heap.
+     */
+    template <typename T>
+    std::size_t heap_bytes (const T& t)
+    {
+        if constexpr (heap_container<T>) {
+            using V = typename T::value_type;
+            std::size_t b = 0;
+            if constexpr (requires { t.capacity(); }) {
+                b = t.capacity() * sizeof (V);
+            } else {
+                b = t.size() * (sizeof (V) + 2 * sizeof (void*));
+            }
+            if constexpr (heap_container<V> || requires { std::tuple_size<V>::value; }) {
+                for (const auto& e : t) { b += heap_bytes (e); }
+            }
+            return b;
+        } else if constexpr (requires { std::tuple_size<T>::value; t.begin(); }) {
+            std::size_t b = 0;
+            for (const auto& e : t) { b += heap_bytes (e); }
+            return b;
+        } else {
+            return 0;
+        }
+    }
+
+    //! The memory held by a component and, as a tree, by its parts
+    struct memory_usage
+    {
+        std::string name;
+        //! Bytes of CPU (heap) memory held directly, not counting those of parts
+        std::size_t cpu = 0;
+        //! Bytes of GPU memory (buffers and textures) held directly
+        std::size_t gpu = 0;
+        //! Of cpu, the bytes that hold a copy of data already uploaded to the GPU
+        std::size_t duplicated = 0;
+        std::vector<memory_usage> parts;
+
+        memory_usage() = default;
+        explicit memory_usage (const std::string& _name, const std::size_t _cpu = 0, const std::size_t _gpu = 0)
+            : name(_name), cpu(_cpu), gpu(_gpu) {}
+
+        /*!
+         * Add a part holding the heap memory of c. If on_gpu, c is a CPU copy of data that has
+         * been uploaded to the GPU, and its bytes are counted as duplicated.
+         */
+        template <typename C>
+        memory_usage& add (const std::string& part_name, const C& c, const bool on_gpu = false)
+        {
+            memory_usage p (part_name, heap_bytes (c));
+            if (on_gpu) { p.duplicated = p.cpu; }
+            this->parts.push_back (std::move (p));
+            return this->parts.back();
+        }
+
+        //! Add a part. Returns it, for adding its own parts.
+        memory_usage& add (memory_usage&& part)
+        {
+            this->parts.push_back (std::move (part));
+            return this->parts.back();
+        }
+
+        std::size_t total_cpu() const
+        {
+            std::size_t b = this->cpu;
+            for (const auto& p : this->parts) { b += p.total_cpu(); }
+            return b;
+        }
+        std::size_t total_gpu() const
+        {
+            std::size_t b = this->gpu;
+            for (const auto& p : this->parts) { b += p.total_gpu(); }
+            return b;
+        }
+        std::size_t total_duplicated() const
+        {
+            std::size_t b = this->duplicated;
+            for (const auto& p : this->parts) { b += p.total_duplicated(); }
+            return b;
+        }
+
+        /*!
+         * The tree as an indented table of CPU and GPU totals, down to max_depth levels of
+         * parts. Parts with under min_bytes in all are left out.
+         */
+        std::string str (const unsigned int max_depth = 3, const std::size_t min_bytes = 0) const
+        {
+            std::stringstream ss;
+            ss << std::left << std::setw (40) << "component" << std::right << std::setw (12) << "CPU"
+               << std::setw (12) << "GPU" << std::setw (12) << "duplicated" << "\n";
+            this->write (ss, 0, max_depth, min_bytes);
+            return ss.str();
+        }
+
+        //! n bytes in B, KB, MB or GB
+        static std::string bytes_str (const std::size_t n)
+        {
+            constexpr const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+            double v = static_cast<double>(n);
+            int u = 0;
+            while (v >= 1024.0 && u < 4) { v /= 1024.0; ++u; }
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision (u == 0 ? 0 : 1) << v << " " << units[u];
+            return ss.str();
+        }
+
+    private:
+        void write (std::stringstream& ss, const unsigned int depth, const unsigned int max_depth, const std::size_t min_bytes) const
+        {
+            const std::size_t c = this->total_cpu();
+            const std::size_t g = this->total_gpu();
+            if (depth > 0 && c + g < min_bytes) { return; }
+            const std::string label = std::string (2 * depth, ' ') + this->name;
+            ss << std::left << std::setw (40) << label << std::right << std::setw (12) << bytes_str (c)
+               << std::setw (12) << bytes_str (g) << std::setw (12) << bytes_str (this->total_duplicated()) << "\n";
+            if (depth < max_depth) {
+                for (const auto& p : this->parts) { p.write (ss, depth + 1, max_depth, min_bytes); }
+            }
+        }
+    };
+
+} // namespace morph
@@ -0,0 +1,223 @@
+/*!
+ * \file
+ * \brief An on-disk cache of the meshes built by VisualModels.
+ *
+ * A model that sets VisualModel::mesh_cache_key has its indices and vertex arrays written to
+ * a file in dir() after they are first built. On later builds with the same key (in this run
+ * or the next), the file is memory mapped and the arrays copied straight out of it, so that
+ * initializeVertices() is not called at all. The key must identify everything that the mesh
+ * depends on, such as a hash of the grid and the options of the visual.
+ *
+ * Each file holds a magic string, the length and the text of the key (with the morphologica
+ * version, so that meshes built by another version are not used), the sizes of the arrays
+ * and the arrays. A file whose key or size does not match is ignored and replaced.
+ */
+
+#pragma once
+
+#include <morph/version.h>
+#include <morph/fnv1a.h>
+#include <string>
+#include <vector>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <system_error>
+#include <thread>
+#include <functional>
+#include <type_traits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#if defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+namespace morph::mesh_cache {
+
+    /*!
+     * The directory in which the meshes are kept. Empty disables the cache. It is initialised
+     * from the environment variable MORPH_MESH_CACHE_DIR and may be set by client code before
+     * the models are built.
+     */
+    inline std::string& dir()
+    {
+        static std::string d = std::getenv ("MORPH_MESH_CACHE_DIR") ? std::getenv ("MORPH_MESH_CACHE_DIR") : "";
+        return d;
+    }
+
+    //! A 64 bit FNV-1a hash of n bytes, continuing from h
+    inline std::uint64_t hash (const void* data, const std::size_t n, const std::uint64_t h = morph::fnv1a_basis)
+    {
+        return morph::fnv1a (data, n, h);
+    }
+
+    //! The hash of the elements of v, for building a key from the data a mesh is made from
+    template <typename T>
+    std::uint64_t hash (const std::vector<T>& v, const std::uint64_t h = morph::fnv1a_basis)
+    {
+        static_assert (std::is_trivially_copyable_v<T>, "mesh_cache::hash hashes the bytes of the elements");
+        return hash (v.data(), v.size() * sizeof (T), h);
+    }
+
+    //! The arrays of a mesh, as held by VisualModel
+    struct arrays
+    {
+        std::vector<std::uint32_t>* indices = nullptr;
+        std::vector<float>* positions = nullptr;
+        std::vector<float>* normals = nullptr;
+        std::vector<float>* colours = nullptr;
+        std::vector<float>* instances = nullptr;
+    };
+
+    namespace detail {
+        constexpr char magic[8] = { 'm', 'o', 'r', 'p', 'h', 'm', 'c', '1' };
+
+        //! The key as stored: the caller's key with the library version
+        inline std::string full_key (const std::string& key)
+        {
+            return std::to_string (morph::version_major) + "." + std::to_string (morph::version_minor) + " " + key;
+        }
+
+        inline std::filesystem::path path (const std::string& fkey)
+        {
+            std::stringstream fname;
+            fname << std::hex << std::setw (16) << std::setfill ('0') << hash (fkey.data(), fkey.size()) << ".mesh";
+            return std::filesystem::path (dir()) / fname.str();
+        }
+
+        //! The key padded to a multiple of 4 bytes, so that the arrays that follow are aligned
+        inline std::size_t padded (const std::size_t n) { return (n + 3u) / 4u * 4u; }
+
+        //! The layout after the magic: key length, then the five array sizes (in elements)
+        using header = std::array<std::uint64_t, 6>;
+
+        //! Fill a from the file image d of n bytes. Returns false if it is not a mesh for fkey.
+        inline bool parse (const char* d, const std::size_t n, const std::string& fkey, arrays& a)
+        {
+            const std::size_t hsz = sizeof (magic) + sizeof (header);
+            if (n < hsz || std::memcmp (d, magic, sizeof (magic)) != 0) { return false; }
+            header h;
+            std::memcpy (h.data(), d + sizeof (magic), sizeof (header));
+            if (h[0] != fkey.size() || n < hsz + padded (h[0])) { return false; }
+            if (std::memcmp (d + hsz, fkey.data(), fkey.size()) != 0) { return false; }
+            // Guard against sizes that would overflow before comparing with the file size
+            for (std::size_t i = 1; i < h.size(); ++i) { if (h[i] > n) { return false; } }
+            std::size_t off = hsz + padded (h[0]);
+            if (off + 4u * (h[1] + h[2] + h[3] + h[4] + h[5]) != n) { return false; }
+            auto take = [d, &off](auto* v, const std::uint64_t count) {
+                using T = typename std::remove_pointer_t<decltype(v)>::value_type;
+                if (v != nullptr) {
+                    v->resize (count);
+                    if (count > 0) { std::memcpy (v->data(), d + off, count * sizeof (T)); }
+                }
+                off += count * sizeof (T);
+            };
+            take (a.indices, h[1]);
+            take (a.positions, h[2]);
+            take (a.normals, h[3]);
+            take (a.colours, h[4]);
+            take (a.instances, h[5]);
+            return true;
+        }
+    } // namespace detail
+
+    /*!
+     * Fill the arrays in a from the cached mesh with this key. Returns false (leaving the
+     * arrays untouched) if the cache is disabled or holds no such mesh.
+     */
+    inline bool load (const std::string& key, arrays a)
+    {
+        if (dir().empty() || key.empty()) { return false; }
+        const std::string fkey = detail::full_key (key);
+        const std::filesystem::path p = detail::path (fkey);
+        // Parse into scratch arrays, so that a bad file leaves a untouched
+        std::vector<std::uint32_t> i;
+        std::vector<float> ps, ns, cs, is;
+        arrays s = { a.indices ? &i : nullptr, a.positions ? &ps : nullptr, a.normals ? &ns : nullptr,
+                     a.colours ? &cs : nullptr, a.instances ? &is : nullptr };
+        bool ok = false;
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = ::open (p.c_str(), O_RDONLY);
+        if (fd < 0) { return false; }
+        struct stat st;
+        if (::fstat (fd, &st) == 0 && st.st_size > 0) {
+            const std::size_t n = static_cast<std::size_t>(st.st_size);
+            void* m = ::mmap (nullptr, n, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                ::madvise (m, n, MADV_SEQUENTIAL);
+                ok = detail::parse (static_cast<const char*>(m), n, fkey, s);
+                ::munmap (m, n);
+            }
+        }
+        ::close (fd);
+#else
+        std::ifstream fin (p, std::ios::binary | std::ios::ate);
+        if (!fin.is_open()) { return false; }
+        std::vector<char> d (static_cast<std::size_t>(fin.tellg()));
+        fin.seekg (0);
+        fin.read (d.data(), d.size());
+        ok = fin.good() && detail::parse (d.data(), d.size(), fkey, s);
+#endif
+        if (!ok) { return false; }
+        if (a.indices) { a.indices->swap (i); }
+        if (a.positions) { a.positions->swap (ps); }
+        if (a.normals) { a.normals->swap (ns); }
+        if (a.colours) { a.colours->swap (cs); }
+        if (a.instances) { a.instances->swap (is); }
+        return true;
+    }
+
+    /*!
+     * Write the arrays in a to the cache under key. The file is written to a temporary name
+     * and renamed, so that a concurrent reader never sees a partial mesh. Returns false if the
+     * cache is disabled or the file could not be written, which is not an error.
+     */
+    inline bool store (const std::string& key, const arrays a)
+    {
+        if (dir().empty() || key.empty()) { return false; }
+        const std::string fkey = detail::full_key (key);
+        const std::filesystem::path p = detail::path (fkey);
+        auto count = [](const auto* v) -> std::uint64_t { return v == nullptr ? 0u : v->size(); };
+        const detail::header h = { fkey.size(), count (a.indices), count (a.positions), count (a.normals),
+                                   count (a.colours), count (a.instances) };
+        std::error_code ec;
+        std::filesystem::create_directories (dir(), ec);
+        // A temporary name of the writer's own, as models may be built on several threads
+        std::size_t writer = std::hash<std::thread::id>{} (std::this_thread::get_id());
+#if defined(__unix__) || defined(__APPLE__)
+        writer ^= static_cast<std::size_t>(::getpid()) << 1;
+#endif
+        const std::filesystem::path tmp = p.string() + "." + std::to_string (writer) + ".tmp";
+        {
+            std::ofstream fout (tmp, std::ios::binary | std::ios::trunc);
+            if (!fout.is_open()) { return false; }
+            fout.write (detail::magic, sizeof (detail::magic));
+            fout.write (reinterpret_cast<const char*>(h.data()), sizeof (h));
+            fout.write (fkey.data(), fkey.size());
+            const char pad[4] = { 0, 0, 0, 0 };
+            fout.write (pad, detail::padded (fkey.size()) - fkey.size());
+            auto put = [&fout](const auto* v) {
+                if (v != nullptr && !v->empty()) {
+                    fout.write (reinterpret_cast<const char*>(v->data()), v->size() * sizeof (v->front()));
+                }
+            };
+            put (a.indices);
+            put (a.positions);
+            put (a.normals);
+            put (a.colours);
+            put (a.instances);
+            if (!fout.good()) { fout.close(); std::filesystem::remove (tmp, ec); return false; }
+        }
+        std::filesystem::rename (tmp, p, ec);
+        if (ec) { std::filesystem::remove (tmp, ec); return false; }
+        return true;
+    }
+
+} // namespace morph::mesh_cache
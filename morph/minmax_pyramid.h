@@ -0,0 +1,144 @@
+/*
+ * A min/max pyramid for level-of-detail reduction of long data series.
+ */
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * A min/max pyramid over a series of data values. Level k of the pyramid holds the indices of
+     * the minimum and maximum values in each block of 2^(k+1) consecutive data values. With it,
+     * the locations of the min and max in any index range can be found in O(log n) time.
+     *
+     * Its main use is envelope(), which reduces a long series (such as a time series with
+     * millions of samples) to the min and max of each of a number of bins. Drawn as a line, the
+     * envelope looks the same as the full series when there are about as many bins as pixels.
+     *
+     * The pyramid holds only indices, so the data container must be passed again to the query
+     * functions and must not have changed since init().
+     */
+    struct minmax_pyramid
+    {
+        minmax_pyramid() {}
+
+        //! Construct and build the pyramid for data
+        template <typename Container>
+        minmax_pyramid (const Container& data) { this->init (data); }
+
+        //! Build the pyramid for data
+        template <typename Container>
+        void init (const Container& data)
+        {
+            if (data.size() > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error ("minmax_pyramid: Too many data values");
+            }
+            this->n = data.size();
+            this->argmin.clear();
+            this->argmax.clear();
+            std::size_t nblk = this->n / 2;
+            if (nblk == 0) { return; }
+            // Level 0 from the data
+            this->argmin.emplace_back (nblk);
+            this->argmax.emplace_back (nblk);
+            for (std::size_t b = 0; b < nblk; ++b) {
+                uint32_t i = static_cast<uint32_t>(2 * b);
+                this->argmin[0][b] = data[i+1] < data[i] ? i + 1 : i;
+                this->argmax[0][b] = data[i+1] > data[i] ? i + 1 : i;
+            }
+            // Higher levels from the level below
+            for (std::size_t k = 1; (nblk = this->n >> (k + 1)) > 0; ++k) {
+                this->argmin.emplace_back (nblk);
+                this->argmax.emplace_back (nblk);
+                for (std::size_t b = 0; b < nblk; ++b) {
+                    uint32_t m0 = this->argmin[k-1][2*b];
+                    uint32_t m1 = this->argmin[k-1][2*b+1];
+                    this->argmin[k][b] = data[m1] < data[m0] ? m1 : m0;
+                    m0 = this->argmax[k-1][2*b];
+                    m1 = this->argmax[k-1][2*b+1];
+                    this->argmax[k][b] = data[m1] > data[m0] ? m1 : m0;
+                }
+            }
+        }
+
+        /*!
+         * Find the indices of the minimum and maximum of data in the index range [a, b), which
+         * must not be empty. Returned as { index_of_min, index_of_max }. Ties go to the lowest index.
+         */
+        template <typename Container>
+        std::array<std::size_t, 2> minmax_in (const Container& data, std::size_t a, std::size_t b) const
+        {
+            if (a >= b || b > this->n) { throw std::runtime_error ("minmax_pyramid::minmax_in: Bad range"); }
+            std::size_t imin = a;
+            std::size_t imax = a;
+            while (a < b) {
+                // Find the largest aligned block starting at a that fits within [a, b)
+                std::size_t k = 0;
+                while (k < this->argmin.size()
+                       && a % (std::size_t{2} << k) == 0 && a + (std::size_t{2} << k) <= b) { ++k; }
+                if (k == 0) {
+                    if (data[a] < data[imin]) { imin = a; }
+                    if (data[a] > data[imax]) { imax = a; }
+                    ++a;
+                } else {
+                    std::size_t blk = a >> k;
+                    std::size_t bmin = this->argmin[k-1][blk];
+                    std::size_t bmax = this->argmax[k-1][blk];
+                    if (data[bmin] < data[imin]) { imin = bmin; }
+                    if (data[bmax] > data[imax]) { imax = bmax; }
+                    a += std::size_t{1} << k;
+                }
+            }
+            return { imin, imax };
+        }
+
+        /*!
+         * Reduce the index range [i0, i1) to its min/max envelope over nbins bins of
+         * (nearly) equal numbers of samples. Returns the ascending indices of the
+         * samples to keep: the first and last sample of the range plus the min and max
+         * of each bin. There are at most 2 * nbins + 2 of them.
+         */
+        template <typename Container>
+        std::vector<std::size_t> envelope (const Container& data, std::size_t i0, std::size_t i1, std::size_t nbins) const
+        {
+            std::vector<std::size_t> keep;
+            if (i1 > this->n) { i1 = this->n; }
+            if (i0 >= i1) { return keep; }
+            std::size_t len = i1 - i0;
+            if (nbins == 0 || len <= 2 * nbins + 2) {
+                for (std::size_t i = i0; i < i1; ++i) { keep.push_back (i); }
+                return keep;
+            }
+            keep.reserve (2 * nbins + 2);
+            keep.push_back (i0);
+            for (std::size_t j = 0; j < nbins; ++j) {
+                std::size_t a = i0 + (len * j) / nbins;
+                std::size_t b = i0 + (len * (j + 1)) / nbins;
+                std::array<std::size_t, 2> mm = this->minmax_in (data, a, b);
+                std::size_t first = mm[0] < mm[1] ? mm[0] : mm[1];
+                std::size_t second = mm[0] < mm[1] ? mm[1] : mm[0];
+                if (first > keep.back()) { keep.push_back (first); }
+                if (second > keep.back()) { keep.push_back (second); }
+            }
+            if (i1 - 1 > keep.back()) { keep.push_back (i1 - 1); }
+            return keep;
+        }
+
+        //! The number of data values in the series
+        std::size_t size() const { return this->n; }
+
+    private:
+        std::size_t n = 0;
+        //! argmin[k][b] is the index of the min of the data in block b of size 2^(k+1)
+        std::vector<std::vector<uint32_t>> argmin;
+        //! argmax[k][b] is the index of the max of the data in block b of size 2^(k+1)
+        std::vector<std::vector<uint32_t>> argmax;
+    };
+
+} // namespace morph
@@ -0,0 +1,106 @@
+/*!
+ * \file
+ *
+ * A halo_exchange (see morph/grid_partition.h) over MPI. Each process holds one
+ * grid_part, whose index is its rank in the communicator. Non-blocking sends and
+ * receives let the caller compute on the part's interior while the ghosts arrive:
+ *
+ * \code
+ * morph::grid_part p = morph::make_grid_part (hg, nranks, rank);
+ * morph::mpi_halo_exchange<float> halo (p, MPI_COMM_WORLD);
+ * halo.start (u);
+ * // ...work on p.interior...
+ * const std::vector<float>& ghosts = halo.finish();
+ * // ...work on p.boundary, reading neighbour li >= p.num_owned() from ghosts[li - p.num_owned()]
+ * \endcode
+ *
+ * This header needs MPI (link MPI::MPI_CXX); nothing else in morphologica includes it.
+ */
+
+#pragma once
+
+#include <mpi.h>
+#include <morph/grid_partition.h>
+#include <vector>
+#include <type_traits>
+#include <stdexcept>
+
+namespace morph {
+
+    template <typename T>
+    class mpi_halo_exchange : public halo_exchange<T>
+    {
+    public:
+        //! Exchange the halos of part p with the other ranks of comm. Messages use the given tag.
+        mpi_halo_exchange (const grid_part& p, MPI_Comm _comm, const int _tag = 0x6d68)
+            : part(p), comm(_comm), tag(_tag)
+        {
+            int rank = 0;
+            int size = 0;
+            MPI_Comm_rank (this->comm, &rank);
+            MPI_Comm_size (this->comm, &size);
+            if (rank != p.index || size != p.num_parts) {
+                throw std::runtime_error ("mpi_halo_exchange: the part's index and count must be the rank and size of the communicator");
+            }
+            this->ghost.resize (p.num_ghosts());
+            std::size_t nsend = 0;
+            for (const auto& s : p.send) { this->send_offset.push_back (nsend); nsend += s.local.size(); }
+            this->sendbuf.resize (nsend);
+            this->requests.resize (p.recv.size() + p.send.size());
+        }
+
+        ~mpi_halo_exchange() { if (this->active) { this->finish(); } }
+
+        void start (const std::vector<T>& owned) override
+        {
+            if (this->active) { throw std::runtime_error ("mpi_halo_exchange::start: the last exchange has not finished"); }
+            if (static_cast<int>(owned.size()) != this->part.num_owned()) {
+                throw std::runtime_error ("mpi_halo_exchange::start: the field has the wrong size");
+            }
+            std::size_t r = 0;
+            for (const auto& rr : this->part.recv) {
+                MPI_Irecv (this->ghost.data() + rr.offset, rr.count, mpi_halo_exchange<T>::mpi_type(),
+                           rr.peer, this->tag, this->comm, &this->requests[r++]);
+            }
+            for (std::size_t s = 0; s < this->part.send.size(); ++s) {
+                const auto& sl = this->part.send[s];
+                T* buf = this->sendbuf.data() + this->send_offset[s];
+                for (std::size_t i = 0; i < sl.local.size(); ++i) { buf[i] = owned[sl.local[i]]; }
+                MPI_Isend (buf, static_cast<int>(sl.local.size()), mpi_halo_exchange<T>::mpi_type(),
+                           sl.peer, this->tag, this->comm, &this->requests[r++]);
+            }
+            this->active = true;
+        }
+
+        const std::vector<T>& finish() override
+        {
+            if (this->active) {
+                MPI_Waitall (static_cast<int>(this->requests.size()), this->requests.data(), MPI_STATUSES_IGNORE);
+                this->active = false;
+            }
+            return this->ghost;
+        }
+
+    protected:
+        static MPI_Datatype mpi_type()
+        {
+            if constexpr (std::is_same_v<T, float>) {
+                return MPI_FLOAT;
+            } else if constexpr (std::is_same_v<T, double>) {
+                return MPI_DOUBLE;
+            } else {
+                static_assert (std::is_same_v<T, float>, "mpi_halo_exchange: T must be float or double");
+            }
+        }
+
+        const grid_part& part;
+        MPI_Comm comm;
+        int tag;
+        bool active = false;
+        std::vector<T> ghost;
+        std::vector<T> sendbuf;
+        std::vector<std::size_t> send_offset;
+        std::vector<MPI_Request> requests;
+    };
+
+} // namespace morph
@@ -14,8 +14,13 @@
 #include <list>
 #include <sstream>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 #include <morph/vvec.h>
+#include <morph/gemm.h>
 #include <morph/nn/FeedForwardConn.h>
+#include <morph/nn/transfer.h>
 
 namespace morph {
     namespace nn {
@@ -176,15 +181,18 @@ namespace morph {
             //! Compute the cost (and delta_out) for the current input and desired output
             T computeCost()
             {
-                // Here is where we compute delta_out:
-                this->delta_out = (this->neurons.back()-desiredOutput) * (this->connections.back().sigmoid_prime_z_lplus1());
-                // And the cost:
-                morph::vvec<T> prediction = this->neurons.back();
-                // Want the prediction error, which is either correct or incorrect.
-                for (auto& p : prediction) {
-                    p = p > T{0.5} ? T{1} : T{0};
-                }
-                T e = (desiredOutput-prediction).length();
+                // Here is where we compute delta_out, and the cost, in one loop that allocates
+                // nothing (after the first call). The prediction error uses the binary
+                // prediction, which is either correct or incorrect.
+                const morph::vvec<T>& y = this->neurons.back();
+                this->delta_out.resize (y.size());
+                T sos = T{0};
+                for (std::size_t j = 0; j < y.size(); ++j) {
+                    this->delta_out[j] = (y[j] - this->desiredOutput[j]) * morph::nn::sigmoid<T>::df (y[j]);
+                    const T pe = this->desiredOutput[j] - (y[j] > T{0.5} ? T{1} : T{0});
+                    sos += pe * pe;
+                }
+                T e = std::sqrt (sos);
                 // Elman seems to use '0.5 * binary error squared' for the cost:
                 this->cost = morph::nn::ElmanNet<T>::costKernel (e);
                 return this->cost;
@@ -193,6 +201,179 @@ namespace morph {
             //! A static cost kernel to allow external code to compute an error using the same method as ElmantNet::computeCost.
             static T costKernel (T& binary_error) { return T{0.5} * binary_error * binary_error; }
 
+            /*!
+             * Set up truncated backpropagation through time (BPTT) over the last \a window time
+             * steps, for \a nb sequences at once. Every buffer that step() and backprop_bptt()
+             * use is allocated here: a ring of \a window frames, each holding the activations
+             * and the context of every layer for one time step, and the error vectors. So the
+             * memory doesn't grow with the length of a sequence, and nothing is allocated while
+             * training.
+             *
+             * In each frame, a layer of n neurons is an (n x nb) row-major matrix in which
+             * column s is sequence s (as in FeedForwardNet's batch mode). With nb = 1, these
+             * are just the layers' vectors.
+             */
+            void setBPTT (const unsigned int window, const unsigned int nb = 1)
+            {
+                if (window == 0 || nb == 0) { throw std::runtime_error ("ElmanNet::setBPTT: window and nb must be > 0"); }
+                this->bptt_window = window;
+                this->bptt_batch = nb;
+                this->bptt_frames.assign (window, bptt_frame{});
+                for (auto& f : this->bptt_frames) {
+                    for (auto& n : this->neurons) { f.a.emplace_back (n.size() * nb, T{0}); }
+                    for (auto& cn : this->contextNeurons) { f.ctx.emplace_back (cn.size() * nb, T{0}); }
+                    f.target.resize (this->neurons.back().size() * nb, T{0});
+                }
+                this->bptt_delta.clear();
+                for (auto& n : this->neurons) { this->bptt_delta.emplace_back (n.size() * nb, T{0}); }
+                this->bptt_dnext.clear();
+                this->bptt_dcarry.clear();
+                for (auto& cn : this->contextNeurons) {
+                    this->bptt_dnext.emplace_back (cn.size() * nb, T{0});
+                    this->bptt_dcarry.emplace_back (cn.size() * nb, T{0});
+                }
+                this->resetBPTT();
+            }
+
+            //! Start new sequences: forget the stored time steps and set the context to 0.5 (as
+            //! setInput() does)
+            void resetBPTT()
+            {
+                this->bptt_head = 0;
+                this->bptt_count = 0;
+            }
+
+            /*!
+             * Advance the sequences by one time step. \a input is the (n_in x nb) input and \a
+             * target the (n_out x nb) desired output. The context of each hidden layer is its
+             * activation at the previous step (or 0.5 after resetBPTT()). The step is stored in
+             * the ring, replacing the oldest once there are \a window of them. \return the cost,
+             * 0.5 |output - target|^2, averaged over the sequences.
+             */
+            T step (const morph::vvec<T>& input, const morph::vvec<T>& target)
+            {
+                if (this->bptt_window == 0) { throw std::runtime_error ("ElmanNet::step: call setBPTT() first"); }
+                bptt_frame& f = this->bptt_frames[this->bptt_head];
+                if (input.size() != f.a.front().size() || target.size() != f.target.size()) {
+                    throw std::runtime_error ("ElmanNet::step: wrong input or target size");
+                }
+                // The context first, because with a window of 1, the previous frame is this one
+                const std::size_t nl = f.a.size();
+                if (this->bptt_count == 0) {
+                    for (auto& c : f.ctx) { std::fill (c.begin(), c.end(), T{0.5}); }
+                } else {
+                    const bptt_frame& prev = this->bptt_frames[(this->bptt_head + this->bptt_window - 1) % this->bptt_window];
+                    for (std::size_t h = 0; h + 2 < nl; ++h) { std::copy (prev.a[h + 1].begin(), prev.a[h + 1].end(), f.ctx[h].begin()); }
+                }
+                std::copy (input.begin(), input.end(), f.a.front().begin());
+                std::copy (target.begin(), target.end(), f.target.begin());
+
+                // Feed forward. Z = W_0 A_l-1 + W_1 Ctx_l + b for a hidden layer l, with no W_1
+                // for the output layer.
+                const std::size_t nb = this->bptt_batch;
+                std::size_t l = 1;
+                for (auto& c : this->connections) {
+                    const std::size_t n = c.N;
+                    const std::size_t m = f.a[l - 1].size() / nb;
+                    T* z = f.a[l].data();
+                    morph::gemm<T>::compute (false, false, n, nb, m, T{1}, c.ws[0].data(), m, f.a[l - 1].data(), nb, T{0}, z, nb);
+                    if (l + 1 < nl) {
+                        morph::gemm<T>::compute (false, false, n, nb, n, T{1}, c.ws[1].data(), n, f.ctx[l - 1].data(), nb, T{1}, z, nb);
+                    }
+                    for (std::size_t j = 0; j < n; ++j) {
+                        const T bj = c.b[j];
+                        for (std::size_t s = 0; s < nb; ++s) { z[j * nb + s] = morph::nn::sigmoid<T>::f (z[j * nb + s] + bj); }
+                    }
+                    ++l;
+                }
+
+                this->bptt_head = (this->bptt_head + 1) % this->bptt_window;
+                this->bptt_count = std::min (this->bptt_count + 1, this->bptt_window);
+
+                T sos = T{0};
+                const morph::vvec<T>& y = f.a.back();
+                for (std::size_t k = 0; k < y.size(); ++k) { sos += (y[k] - f.target[k]) * (y[k] - f.target[k]); }
+                this->cost = T{0.5} * sos / static_cast<T>(nb);
+                return this->cost;
+            }
+
+            //! The (n_out x nb) output of the last step()
+            const morph::vvec<T>& outputBPTT() const
+            {
+                if (this->bptt_count == 0) { throw std::runtime_error ("ElmanNet::outputBPTT: no steps yet"); }
+                return this->bptt_frames[(this->bptt_head + this->bptt_window - 1) % this->bptt_window].a.back();
+            }
+
+            /*!
+             * Backpropagate through the stored time steps (up to \a window of them), from the
+             * latest back to the oldest. The connections' nabla_ws and nabla_b are set to the
+             * gradient of the sum of the steps' costs, averaged over the sequences; the errors
+             * are not propagated beyond the oldest stored step. Calling this (and sgd_step())
+             * every \a window steps is the usual truncated BPTT, in which each step's error
+             * contributes once.
+             */
+            void backprop_bptt()
+            {
+                const std::size_t nb = this->bptt_batch;
+                const T oob = T{1} / static_cast<T>(nb);
+                for (auto& c : this->connections) {
+                    for (auto& nw : c.nabla_ws) { nw.zero(); }
+                    c.nabla_b.zero();
+                }
+                for (auto& d : this->bptt_dnext) { d.zero(); }
+
+                const std::size_t nl = this->bptt_delta.size();
+                for (unsigned int i = 0; i < this->bptt_count; ++i) {
+                    const bptt_frame& f = this->bptt_frames[(this->bptt_head + 2 * this->bptt_window - 1 - i) % this->bptt_window];
+                    // The output error
+                    {
+                        const morph::vvec<T>& y = f.a.back();
+                        morph::vvec<T>& d = this->bptt_delta.back();
+                        for (std::size_t k = 0; k < y.size(); ++k) { d[k] = (y[k] - f.target[k]) * morph::nn::sigmoid<T>::df (y[k]); }
+                    }
+                    // Back through the layers at this time step
+                    std::size_t l = nl - 1;
+                    for (auto c = this->connections.rbegin(); c != this->connections.rend(); ++c, --l) {
+                        const std::size_t n = c->N;
+                        const std::size_t m = f.a[l - 1].size() / nb;
+                        const T* d = this->bptt_delta[l].data();
+                        for (std::size_t j = 0; j < n; ++j) {
+                            T sum = T{0};
+                            for (std::size_t s = 0; s < nb; ++s) { sum += d[j * nb + s]; }
+                            c->nabla_b[j] += sum * oob;
+                        }
+                        morph::gemm<T>::compute (false, true, n, m, nb, oob, d, nb, f.a[l - 1].data(), nb, T{1}, c->nabla_ws[0].data(), m);
+                        if (l + 1 < nl) {
+                            // The context weights, and the error carried back to the previous step
+                            morph::gemm<T>::compute (false, true, n, n, nb, oob, d, nb, f.ctx[l - 1].data(), nb, T{1}, c->nabla_ws[1].data(), n);
+                            morph::gemm<T>::compute (true, false, n, nb, n, T{1}, c->ws[1].data(), n, d, nb, T{0}, this->bptt_dcarry[l - 1].data(), nb);
+                        }
+                        if (l > 1) {
+                            // The error in hidden layer l-1 comes from this layer and from the next step
+                            T* dm = this->bptt_delta[l - 1].data();
+                            morph::gemm<T>::compute (true, false, m, nb, n, T{1}, c->ws[0].data(), m, d, nb, T{0}, dm, nb);
+                            const T* dn = this->bptt_dnext[l - 2].data();
+                            const T* a = f.a[l - 1].data();
+                            for (std::size_t k = 0; k < m * nb; ++k) { dm[k] = (dm[k] + dn[k]) * morph::nn::sigmoid<T>::df (a[k]); }
+                        }
+                    }
+                    std::swap (this->bptt_dnext, this->bptt_dcarry);
+                }
+            }
+
+            //! A gradient descent step using the connections' nabla_ws and nabla_b: v -> v - eta nabla
+            void sgd_step (const T eta)
+            {
+                for (auto& c : this->connections) {
+                    for (unsigned int i = 0; i < c.ws.size(); ++i) {
+                        T* w = c.ws[i].data();
+                        const T* nw = c.nabla_ws[i].data();
+                        for (std::size_t k = 0; k < c.ws[i].size(); ++k) { w[k] -= eta * nw[k]; }
+                    }
+                    for (std::size_t j = 0; j < c.b.size(); ++j) { c.b[j] -= eta * c.nabla_b[j]; }
+                }
+            }
+
             //! What's the cost function of the current output? Computed in computeCost()
             T cost = T{0};
 
@@ -213,6 +394,28 @@ namespace morph {
 
             //! The desired output of the network
             morph::vvec<T> desiredOutput;
+
+            //! One time step for BPTT: the activations of every layer (a[0] is the input), the
+            //! context of every hidden layer and the target output
+            struct bptt_frame
+            {
+                std::vector<morph::vvec<T>> a;
+                std::vector<morph::vvec<T>> ctx;
+                morph::vvec<T> target;
+            };
+            //! The BPTT window length and the number of sequences (0 until setBPTT())
+            unsigned int bptt_window = 0;
+            unsigned int bptt_batch = 0;
+            //! The ring of time steps. bptt_head is the slot for the next step, and bptt_count
+            //! of the slots before it hold stored steps.
+            std::vector<bptt_frame> bptt_frames;
+            unsigned int bptt_head = 0;
+            unsigned int bptt_count = 0;
+            //! The errors in each layer at the current step of backprop_bptt()
+            std::vector<morph::vvec<T>> bptt_delta;
+            //! The errors in each hidden layer carried back from the next step, and to the previous one
+            std::vector<morph::vvec<T>> bptt_dnext;
+            std::vector<morph::vvec<T>> bptt_dcarry;
         };
 
         template <typename T>
@@ -10,10 +10,15 @@
 #pragma once
 
 #include <morph/vvec.h>
+#include <morph/gemm.h>
+#include <morph/nn/transfer.h>
+#include <morph/memory_usage.h>
 #include <iostream>
 #include <sstream>
 #include <ostream>
 #include <vector>
+#include <cmath>
+#include <stdexcept>
 
 namespace morph {
     namespace nn {
@@ -21,13 +26,14 @@ namespace morph {
         /*!
          * A connection between neuron layers in a feed forward neural network. This
          * connects any number of input neuron populations to a single output
-         * population.
+         * population. Al is the allocator of the vvecs (see morph/allocators.h). Tf is the
+         * transfer function of the neurons, one of those in morph/nn/transfer.h.
          */
-        template <typename T>
+        template <typename T, typename Al = std::allocator<T>, typename Tf = morph::nn::sigmoid<T>>
         struct FeedForwardConn
         {
             //! Construct for connection from single input layer to single output layer
-            FeedForwardConn (morph::vvec<T>* _in, morph::vvec<T>* _out)
+            FeedForwardConn (morph::vvec<T, Al>* _in, morph::vvec<T, Al>* _out)
             {
                 this->ins.resize(1);
                 this->ins[0] = _in;
@@ -35,14 +41,14 @@ namespace morph {
             }
 
             //! Construct for connection from many input layers to single output layer
-            FeedForwardConn (std::vector<morph::vvec<T>*> _ins, morph::vvec<T>* _out)
+            FeedForwardConn (std::vector<morph::vvec<T, Al>*> _ins, morph::vvec<T, Al>* _out)
             {
                 this->ins = _ins;
                 this->commonInit (_out);
             }
 
             //! Init common to all constructors
-            void commonInit (morph::vvec<T>* _out)
+            void commonInit (morph::vvec<T, Al>* _out)
             {
                 this->out = _out;
                 this->N = this->out->size();
@@ -68,31 +74,50 @@ namespace morph {
                 this->nabla_b.zero();
                 this->z.resize (N, T{0});
                 this->z.zero();
+
+                // Working memory for backprop, allocated once here
+                this->w_times_deltas.resize (this->ins.size());
+                for (unsigned int i = 0; i < this->ins.size(); ++i) {
+                    this->w_times_deltas[i].resize (this->ins[i]->size(), T{0});
+                }
             }
 
             //! Input layer has total size M = m1 + m2 +... etc where m1, m2 are the
             //! lengths of the elements of ins. Each vvec<T> element of the outer
             //! std::vector is a connection from a separate population(or layer) of
             //! neurons.
-            std::vector<morph::vvec<T>*> ins;
+            std::vector<morph::vvec<T, Al>*> ins;
             //! Pointer to output layer. Size N.
-            morph::vvec<T>* out;
+            morph::vvec<T, Al>* out;
             //! The size (i.e. number of neurons) in out.
             unsigned int N = 0U;
             //! The errors in the input layer of neurons. Size M = m1 + m2 +...
-            std::vector<morph::vvec<T>> deltas;
+            std::vector<morph::vvec<T, Al>> deltas;
             //! Weights.
             //! Order of weights: w_11, w_12,.., w_1M, w_21, w_22, w_2M, etc. Size M by N = m1xN + m2xN +...
-            std::vector<morph::vvec<T>> ws;
+            std::vector<morph::vvec<T, Al>> ws;
             //! Biases. Size N.
-            morph::vvec<T> b;
+            morph::vvec<T, Al> b;
             //! The gradients of cost vs. weights. Size M by N = m1xN + m2xN +...
-            std::vector<morph::vvec<T>> nabla_ws;
+            std::vector<morph::vvec<T, Al>> nabla_ws;
             //! The gradients of cost vs. biases. Size N.
-            morph::vvec<T> nabla_b;
+            morph::vvec<T, Al> nabla_b;
             //! Activation of the output neurons. Computed in feedforward, used in backprop
-            //! z = sum(w.in) + b. Final output written into *out is the sigmoid(z). Size N.
-            morph::vvec<T> z;
+            //! z = sum(w.in) + b. Final output written into *out is Tf::f(z). Size N.
+            morph::vvec<T, Al> z;
+            //! Working memory for backprop: the weights times the next layer's deltas. Size M.
+            std::vector<morph::vvec<T, Al>> w_times_deltas;
+
+            //! Mini-batch mode. The number of samples in a batch (0 if batch mode is not set up)
+            unsigned int batch = 0U;
+            //! Batch inputs. Each is an (m x batch) row-major matrix; column s is sample s.
+            std::vector<morph::vvec<T, Al>*> ins_b;
+            //! Batch output. (N x batch)
+            morph::vvec<T, Al>* out_b = nullptr;
+            //! Batch activations. (N x batch)
+            morph::vvec<T, Al> z_b;
+            //! Batch errors in the input layers. Each is (m x batch)
+            std::vector<morph::vvec<T, Al>> deltas_b;
 
             //! Output as a string
             std::string str() const
@@ -120,6 +145,24 @@ namespace morph {
                 return ss.str();
             }
 
+            //! The memory held by the connection's weights, gradients and working memory
+            morph::memory_usage memory_usage (const std::string& name = "FeedForwardConn") const
+            {
+                morph::memory_usage mu (name);
+                mu.add ("ws", this->ws);
+                mu.add ("b", this->b);
+                mu.add ("nabla_ws", this->nabla_ws);
+                mu.add ("nabla_b", this->nabla_b);
+                mu.add ("z", this->z);
+                mu.add ("deltas", this->deltas);
+                mu.add ("w_times_deltas", this->w_times_deltas);
+                if (this->batch > 0) {
+                    mu.add ("z_b", this->z_b);
+                    mu.add ("deltas_b", this->deltas_b);
+                }
+                return mu;
+            }
+
             //! Randomize the weights and biases
             void randomize()
             {
@@ -136,20 +179,16 @@ namespace morph {
 
                 // Loop over input populations:
                 for (unsigned int i = 0; i < this->ins.size(); ++i) {
-                    // A morph::vvec for a 'part of w'
-                    morph::vvec<T>* _in = this->ins[i];
-                    unsigned int m = _in->size();// Size m[i]
-                    morph::vvec<T> wpart(m);
-                    // Get weights, outputs and biases iterators
-                    auto witer = this->ws[i].begin();
-                    // Carry out an N sized for loop computing each output
+                    const T* _in = this->ins[i]->data();
+                    unsigned int m = this->ins[i]->size();// Size m[i]
+                    // Each output is the dot product of a row of the weight matrix with the input
+                    const T* wrow = this->ws[i].data();
                     for (unsigned int j = 0; j < this->N; ++j) { // Each output
-                        // Copy part of weights to wpart (M elements):
-                        std::copy (witer, witer+m, wpart.begin());
-                        // Compute/accumulate dot product with input
-                        this->z[j] += wpart.dot (*ins[i]);
-                        // Move to the next part of the weight matrix for the next loop
-                        witer += m;
+                        T d = T{0};
+                        for (unsigned int k = 0; k < m; ++k) { d += wrow[k] * _in[k]; }
+                        this->z[j] += d;
+                        // Move to the next row of the weight matrix for the next loop
+                        wrow += m;
                     }
                 }
 
@@ -157,26 +196,79 @@ namespace morph {
                 this->applyTransfer();
             }
 
-            //! For each activation, z, add the bias, then apply the sigmoid transfer function
+            /*!
+             * Set up mini-batch mode. _ins_b must correspond to ins, with each input matrix
+             * sized (ins[i]->size() x _batch); _out_b is (N x _batch).
+             */
+            void setBatch (std::vector<morph::vvec<T, Al>*> _ins_b, morph::vvec<T, Al>* _out_b, const unsigned int _batch)
+            {
+                if (_ins_b.size() != this->ins.size()) {
+                    throw std::runtime_error ("FeedForwardConn::setBatch: wrong number of batch inputs");
+                }
+                this->ins_b = _ins_b;
+                this->out_b = _out_b;
+                this->batch = _batch;
+                this->z_b.resize (this->N * this->batch, T{0});
+                this->deltas_b.resize (this->ins.size());
+                for (unsigned int i = 0; i < this->ins.size(); ++i) {
+                    this->deltas_b[i].resize (this->ins[i]->size() * this->batch, T{0});
+                }
+            }
+
+            /*!
+             * Feed-forward compute for a whole mini-batch. Z = sum_i W_i In_i + b, where W_i is
+             * the (N x m) weight matrix ws[i] and In_i is the (m x batch) input matrix. The
+             * products are GEMMs (see morph/gemm.h).
+             */
+            void feedforward_batch()
+            {
+                for (unsigned int i = 0; i < this->ins_b.size(); ++i) {
+                    const unsigned int m = this->ins[i]->size();
+                    morph::gemm<T>::compute (false, false, this->N, this->batch, m,
+                                             T{1}, this->ws[i].data(), m, this->ins_b[i]->data(), this->batch,
+                                             (i == 0 ? T{0} : T{1}), this->z_b.data(), this->batch);
+                }
+                // Add the biases and apply the transfer function
+                T* zp = this->z_b.data();
+                T* op = this->out_b->data();
+                for (unsigned int j = 0; j < this->N; ++j) {
+                    const T bj = this->b[j];
+                    for (unsigned int s = 0; s < this->batch; ++s) {
+                        const std::size_t js = static_cast<std::size_t>(j) * this->batch + s;
+                        zp[js] += bj;
+                        op[js] = Tf::f (zp[js]);
+                    }
+                }
+            }
+
+            //! For each activation, z, add the bias, then apply the transfer function
             void applyTransfer()
             {
-                auto oiter = this->out->begin();
-                auto biter = this->b.begin();
+                T* op = this->out->data();
+                T* zp = this->z.data();
+                const T* bp = this->b.data();
                 for (unsigned int j = 0; j < this->N; ++j) {
-                    this->z[j] += *biter++;
-                    *oiter++ = T{1} / (T{1} + std::exp(-z[j])); // out = sigmoid(z+bias)
+                    zp[j] += bp[j];
+                    op[j] = Tf::f (zp[j]); // out = f(z+bias)
                 }
             }
 
-            //! The content of *FeedForwardConn::out is sigmoid(z^l+1). \return has size N
-            morph::vvec<T> sigmoid_prime_z_lplus1() { return (*out) * (-(*out)+T{1}); }
+            //! The content of *FeedForwardConn::out is f(z^l+1). \return f'(z^l+1), size N. (The
+            //! name is historical; this is the derivative of whichever transfer function Tf is.)
+            morph::vvec<T, Al> sigmoid_prime_z_lplus1()
+            {
+                morph::vvec<T, Al> rtn (this->N);
+                for (unsigned int j = 0; j < this->N; ++j) { rtn[j] = Tf::df ((*out)[j]); }
+                return rtn;
+            }
 
-            //! The content of *FeedForwardConn::in is sigmoid(z^l). \return has size M = m1 + m2 +...
-            std::vector<morph::vvec<T>> sigmoid_prime_z_l()
+            //! The content of *FeedForwardConn::in is f(z^l). \return f'(z^l), size M = m1 + m2 +...
+            std::vector<morph::vvec<T, Al>> sigmoid_prime_z_l()
             {
-                std::vector<morph::vvec<T>> rtn (this->ins.size());
+                std::vector<morph::vvec<T, Al>> rtn (this->ins.size());
                 for (unsigned int i = 0; i < this->ins.size(); ++i) {
-                    rtn[i] = (*ins[i]) * (-(*ins[i])+T{1});
+                    rtn[i].resize (this->ins[i]->size());
+                    for (std::size_t k = 0; k < rtn[i].size(); ++k) { rtn[i][k] = Tf::df ((*ins[i])[k]); }
                 }
                 return rtn;
             }
@@ -204,7 +296,7 @@ namespace morph {
              * Compute this->delta using the values computed in FeedForwardConn::feedforward
              * (which must have been executed beforehand).
              */
-            void backprop (const morph::vvec<T>& delta_l_nxt) // delta_l_nxt has size N.
+            void backprop (const morph::vvec<T, Al>& delta_l_nxt) // delta_l_nxt has size N.
             {
                 // Check sum of sizes in delta_l_nxt
                 if (delta_l_nxt.size() != this->out->size()) {
@@ -214,52 +306,102 @@ namespace morph {
                     throw std::runtime_error (ee.str());
                 }
 
-                // we have to do weights * delta_l_nxt to give a morph::vvec<T>
-                // result. This is the equivalent of the matrix multiplication:
-                std::vector<morph::vvec<T>> w_times_deltas(this->ins.size());
+                // we have to do weights * delta_l_nxt to give a morph::vvec<T, Al>
+                // result. This is the equivalent of the matrix multiplication. The loops run
+                // along the rows of the weight matrix. Nothing is allocated here.
                 for (unsigned int idx = 0; idx < this->ins.size(); ++idx) {
                     unsigned int m = this->ins[idx]->size();
-                    w_times_deltas[idx].resize(m);
-                    w_times_deltas[idx].zero();
-                    for (unsigned int i = 0; i < m; ++i) { // Each input
-                        for (unsigned int j = 0; j < this->N; ++j) { // Each output
-                            // For each weight fanning into neuron j in l_nxt, sum up:
-                            w_times_deltas[idx][i] += this->ws[idx][i+(m*j)] * delta_l_nxt[j];
-                        }
+                    T* wtd = this->w_times_deltas[idx].data();
+                    std::fill (wtd, wtd + m, T{0});
+                    const T* wrow = this->ws[idx].data();
+                    for (unsigned int j = 0; j < this->N; ++j) { // Each output
+                        const T dj = delta_l_nxt[j];
+                        // For each weight fanning into neuron j in l_nxt, sum up:
+                        for (unsigned int i = 0; i < m; ++i) { wtd[i] += wrow[i] * dj; }
+                        wrow += m;
                     }
-                }
-
-                 // spzl has size M; deriv of input
-                std::vector<morph::vvec<T>> spzl = this->sigmoid_prime_z_l();
-
-                if (spzl.size() < this->deltas.size()) {
-                    throw std::runtime_error ("Sizes error (spzl and deltas)");
-                }
-
-                for (unsigned int idx = 0; idx < this->deltas.size(); ++idx) {
-                    this->deltas[idx] = w_times_deltas[idx] * spzl[idx];
+                    // The deltas are the Hadamard product with the derivative of the input
+                    // layer's transfer function
+                    const T* a = this->ins[idx]->data();
+                    T* d = this->deltas[idx].data();
+                    for (unsigned int i = 0; i < m; ++i) { d[i] = wtd[i] * Tf::df (a[i]); }
                 }
 
                 // NB: In a given connection, we compute nabla_b and nabla_w relating to the
                 // *output* neurons and the weights also related to the output neurons.
 
-                this->nabla_b = delta_l_nxt; // Size is N
+                std::copy (delta_l_nxt.begin(), delta_l_nxt.end(), this->nabla_b.begin()); // Size is N
 
                 for (unsigned int idx = 0; idx < this->ins.size(); ++idx) {
                     unsigned int m = this->ins[idx]->size();
-                    for (unsigned int i = 0; i < m; ++i) { // Each input
-                        for (unsigned int j = 0; j < this->N; ++j) { // Each output
-                            // nabla_w is a_in * delta_out:
-                            this->nabla_ws[idx][i+(m*j)] = (*(ins[idx]))[i] * delta_l_nxt[j];
-                        }
+                    const T* a = this->ins[idx]->data();
+                    T* nwrow = this->nabla_ws[idx].data();
+                    for (unsigned int j = 0; j < this->N; ++j) { // Each output
+                        const T dj = delta_l_nxt[j];
+                        // nabla_w is a_in * delta_out:
+                        for (unsigned int i = 0; i < m; ++i) { nwrow[i] = a[i] * dj; }
+                        nwrow += m;
+                    }
+                }
+            }
+
+            //! Batch backprop, finding this connection's output in conn_nxt's inputs
+            void backprop_batch (const FeedForwardConn& conn_nxt)
+            {
+                unsigned int idx = 0;
+                for (unsigned int i = 0; i < conn_nxt.ins_b.size(); ++i) {
+                    if (conn_nxt.ins_b[i] == this->out_b) {
+                        idx = i;
+                        break;
                     }
                 }
+                this->backprop_batch (conn_nxt.deltas_b[idx]);
+            }
+
+            /*!
+             * Batch backprop. delta_l_nxt is the (N x batch) error in the output layer. Computes
+             * deltas_b[i] = (W_i^T delta_l_nxt) * f'(In_i) and sets nabla_ws and nabla_b to
+             * the means of the gradients over the batch: nabla_w_i = delta_l_nxt In_i^T / batch.
+             */
+            void backprop_batch (const morph::vvec<T, Al>& delta_l_nxt)
+            {
+                if (delta_l_nxt.size() != static_cast<std::size_t>(this->N) * this->batch) {
+                    std::stringstream ee;
+                    ee << "backprop_batch: Mismatched size. delta_l_nxt size: "
+                       << delta_l_nxt.size() << ", expected N x batch = " << this->N * this->batch;
+                    throw std::runtime_error (ee.str());
+                }
+                const T oob = T{1} / static_cast<T>(this->batch);
+
+                for (unsigned int idx = 0; idx < this->ins_b.size(); ++idx) {
+                    const unsigned int m = this->ins[idx]->size();
+                    // deltas_b = W^T delta_l_nxt, then the Hadamard product with f'(in)
+                    morph::gemm<T>::compute (true, false, m, this->batch, this->N,
+                                             T{1}, this->ws[idx].data(), m, delta_l_nxt.data(), this->batch,
+                                             T{0}, this->deltas_b[idx].data(), this->batch);
+                    const T* a = this->ins_b[idx]->data();
+                    T* d = this->deltas_b[idx].data();
+                    const std::size_t mb = static_cast<std::size_t>(m) * this->batch;
+                    for (std::size_t k = 0; k < mb; ++k) { d[k] *= Tf::df (a[k]); }
+
+                    // nabla_w = delta_l_nxt In^T / batch, summing over the batch in the GEMM
+                    morph::gemm<T>::compute (false, true, this->N, m, this->batch,
+                                             oob, delta_l_nxt.data(), this->batch, a, this->batch,
+                                             T{0}, this->nabla_ws[idx].data(), m);
+                }
+
+                for (unsigned int j = 0; j < this->N; ++j) {
+                    const T* dj = delta_l_nxt.data() + static_cast<std::size_t>(j) * this->batch;
+                    T sum = T{0};
+                    for (unsigned int s = 0; s < this->batch; ++s) { sum += dj[s]; }
+                    this->nabla_b[j] = sum * oob;
+                }
             }
         };
 
         //! Stream operator
-        template <typename T>
-        std::ostream& operator<< (std::ostream& os, const FeedForwardConn<T>& c)
+        template <typename T, typename Al, typename Tf>
+        std::ostream& operator<< (std::ostream& os, const FeedForwardConn<T, Al, Tf>& c)
         {
             os << c.str();
             return os;
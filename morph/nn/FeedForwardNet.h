@@ -18,6 +18,12 @@
 #include <ostream>
 #include <map>
 #include <limits>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 namespace morph {
     namespace nn {
@@ -26,8 +32,12 @@ namespace morph {
          * A feedforward network class which holds a runtime-selectable set of neuron
          * layers and the connections between the layers. Note that in this class, the
          * connections are always between adjacent layers; from layer l to layer l+1.
+         *
+         * Al is the allocator for the vvecs of neurons, weights and so on; to align them for
+         * SIMD, use morph::aligned_allocator<T> from morph/allocators.h. Tf is the neurons'
+         * transfer function, from morph/nn/transfer.h (sigmoid, tanh, relu or fast_sigmoid).
          */
-        template <typename T>
+        template <typename T, typename Al = std::allocator<T>, typename Tf = morph::nn::sigmoid<T>>
         struct FeedForwardNet
         {
             //! Constructor takes a vector specifying the number of neurons in each layer (\a
@@ -37,7 +47,7 @@ namespace morph {
                 // Set up initial conditions
                 for (auto nn : layer_spec) {
                     // Create, and zero, a layer containing nn neurons:
-                    morph::vvec<T> lyr(nn);
+                    morph::vvec<T, Al> lyr(nn);
                     lyr.zero();
                     unsigned int lastLayerSize = 0U;
                     if (!this->neurons.empty()) { // Set lastLayerSize
@@ -51,11 +61,16 @@ namespace morph {
                         --l;
                         auto lm1 = l;
                         --lm1;
-                        morph::nn::FeedForwardConn<T> c(&*lm1, &*l);
+                        morph::nn::FeedForwardConn<T, Al, Tf> c(&*lm1, &*l);
                         c.randomize();
                         this->connections.push_back (c);
                     }
                 }
+                // Allocate the output error and target now, so that training doesn't have to
+                if (!this->neurons.empty()) {
+                    this->delta_out.resize (this->neurons.back().size(), T{0});
+                    this->desiredOutput.resize (this->neurons.back().size(), T{0});
+                }
             }
 
             //! Output the network as a string
@@ -76,6 +91,27 @@ namespace morph {
                 return ss.str();
             }
 
+            //! The memory held by the network: its layers, its connections, the batch layers
+            //! and the replicas used by train_parallel
+            morph::memory_usage memory_usage (const std::string& name = "FeedForwardNet") const
+            {
+                morph::memory_usage mu (name);
+                mu.add ("neurons", this->neurons);
+                unsigned int i = 0;
+                for (const auto& c : this->connections) { mu.add (c.memory_usage ("connection " + std::to_string (i++))); }
+                mu.add ("delta_out", this->delta_out);
+                mu.add ("desiredOutput", this->desiredOutput);
+                mu.add ("neurons_b", this->neurons_b);
+                mu.add ("delta_out_b", this->delta_out_b);
+                mu.add ("desiredOutput_b", this->desiredOutput_b);
+                if (!this->replicas.empty()) {
+                    morph::memory_usage& r = mu.add (morph::memory_usage ("replicas", this->replicas.capacity() * sizeof (this->replicas[0])));
+                    i = 0;
+                    for (const auto& rp : this->replicas) { r.add (rp->memory_usage ("replica " + std::to_string (i++))); }
+                }
+                return mu;
+            }
+
             //! Update the network's outputs from its inputs
             void feedforward()
             {
@@ -144,7 +180,7 @@ namespace morph {
                 // delta^l = w^l+1 . delta^l+1 0 sigma_prime (z^l)
                 //
                 // (where 0 signifies hadamard product, as implemented by vvec's operator*)
-                // delta = dC_x/da() * sigmoid_prime(z_out)
+                // delta = dC_x/da() * f'(z_out)
                 auto citer = this->connections.end();
                 --citer; // Now points at output layer
                 citer->backprop (this->delta_out); // Layer L delta computed
@@ -156,21 +192,213 @@ namespace morph {
                 }
             }
 
+            /*!
+             * Set up mini-batch training with nb samples per batch. Each layer gets an
+             * (nb x layer size) matrix in neurons_b, with one sample per column, and the
+             * connections are pointed at these. Then use setBatchInput(), feedforward_batch(),
+             * computeCost_batch() and backprop_batch(), after which each connection's nabla_ws
+             * and nabla_b hold the mean gradients over the batch.
+             */
+            void setBatchSize (const unsigned int nb)
+            {
+                this->batch = nb;
+                this->neurons_b.clear();
+                for (auto& n : this->neurons) { this->neurons_b.emplace_back (n.size() * nb, T{0}); }
+                auto nbi = this->neurons_b.begin();
+                for (auto& c : this->connections) {
+                    auto nbi_in = nbi++;
+                    c.setBatch ({&*nbi_in}, &*nbi, nb);
+                }
+                this->delta_out_b.resize (this->neurons.back().size() * nb, T{0});
+                this->desiredOutput_b.resize (this->neurons.back().size() * nb, T{0});
+            }
+
+            //! Copy a batch of inputs and desired outputs into the columns of the first and the
+            //! desiredOutput_b matrices. There must be as many as the batch size.
+            template <typename Ai, typename Ao>
+            void setBatchInput (const std::vector<morph::vvec<T, Ai>>& theInputs,
+                                const std::vector<morph::vvec<T, Ao>>& theOutputs)
+            {
+                if (theInputs.size() != this->batch || theOutputs.size() != this->batch) {
+                    throw std::runtime_error ("FeedForwardNet::setBatchInput: need batch inputs and outputs");
+                }
+                this->setBatchInput (theInputs.data(), theOutputs.data());
+            }
+
+            //! Copy the batch inputs and desired outputs from the arrays theInputs and theOutputs,
+            //! which must each hold at least batch vvecs
+            template <typename Ai, typename Ao>
+            void setBatchInput (const morph::vvec<T, Ai>* theInputs, const morph::vvec<T, Ao>* theOutputs)
+            {
+                morph::vvec<T, Al>& in_b = this->neurons_b.front();
+                const std::size_t m = this->neurons.front().size();
+                const std::size_t n = this->neurons.back().size();
+                for (unsigned int s = 0; s < this->batch; ++s) {
+                    if (theInputs[s].size() != m || theOutputs[s].size() != n) {
+                        throw std::runtime_error ("FeedForwardNet::setBatchInput: wrong sample size");
+                    }
+                    for (std::size_t i = 0; i < m; ++i) { in_b[i * this->batch + s] = theInputs[s][i]; }
+                    for (std::size_t i = 0; i < n; ++i) { this->desiredOutput_b[i * this->batch + s] = theOutputs[s][i]; }
+                }
+            }
+
+            //! Update the batch outputs from the batch inputs
+            void feedforward_batch()
+            {
+                for (auto& c : this->connections) { c.feedforward_batch(); }
+            }
+
+            //! Compute delta_out_b and return the mean cost over the batch
+            T computeCost_batch()
+            {
+                const morph::vvec<T, Al>& a = this->neurons_b.back();
+                T sos = T{0};
+                for (std::size_t k = 0; k < a.size(); ++k) {
+                    const T d = a[k] - this->desiredOutput_b[k];
+                    this->delta_out_b[k] = d * Tf::df (a[k]);
+                    sos += d * d;
+                }
+                this->cost = T{0.5} * sos / static_cast<T>(this->batch);
+                return this->cost;
+            }
+
+            //! Backpropagate the batch errors. Call computeCost_batch() first.
+            void backprop_batch()
+            {
+                auto citer = this->connections.end();
+                --citer;
+                citer->backprop_batch (this->delta_out_b);
+                for (;citer != this->connections.begin();) {
+                    auto citer_closertooutput = citer--;
+                    citer->backprop_batch (citer_closertooutput->deltas_b[0]);
+                }
+            }
+
+            //! A gradient descent step using the connections' nabla_ws and nabla_b: v -> v - eta nabla
+            void sgd_step (const T eta)
+            {
+                for (auto& c : this->connections) {
+                    for (unsigned int i = 0; i < c.ws.size(); ++i) { c.ws[i] -= c.nabla_ws[i] * eta; }
+                    c.b -= c.nabla_b * eta;
+                }
+            }
+
+            /*!
+             * Train for one epoch on the samples (theInputs, theOutputs), taken in order in
+             * mini-batches of nb, with learning rate eta, on all the OpenMP threads. Returns the
+             * mean cost of the samples (each computed before the update that it contributes to).
+             *
+             * Each thread has a replica of the network (see replicas). In the default,
+             * data-parallel mode, each batch is split into one slice per thread. Each replica
+             * copies the weights and biases, runs its slice through the batch forward and
+             * backward passes, and at the end of the batch the slices' gradients are reduced into
+             * the mean gradient, which updates ws and b. The result does not depend on the number
+             * of threads, other than by floating point rounding.
+             *
+             * If hogwild is true, whole batches are instead dealt out to the threads, which run
+             * without synchronising: each thread reads the current weights, computes the
+             * gradient for its batch and subtracts eta times it from ws and b with atomic updates
+             * (Niu et al., "Hogwild!", NIPS 2011). The weights a thread reads may be part way
+             * through another thread's update, so results vary from run to run.
+             */
+            template <typename Ai, typename Ao>
+            T train_parallel (const std::vector<morph::vvec<T, Ai>>& theInputs,
+                              const std::vector<morph::vvec<T, Ao>>& theOutputs,
+                              const unsigned int nb, const T eta, const bool hogwild = false)
+            {
+                if (theInputs.size() != theOutputs.size()) {
+                    throw std::runtime_error ("FeedForwardNet::train_parallel: different numbers of inputs and outputs");
+                }
+                if (nb == 0) { throw std::runtime_error ("FeedForwardNet::train_parallel: batch size must be > 0"); }
+                const std::size_t m = this->neurons.front().size();
+                const std::size_t n = this->neurons.back().size();
+                for (std::size_t s = 0; s < theInputs.size(); ++s) {
+                    if (theInputs[s].size() != m || theOutputs[s].size() != n) {
+                        throw std::runtime_error ("FeedForwardNet::train_parallel: wrong sample size");
+                    }
+                }
+                const std::size_t ns = theInputs.size();
+                if (ns == 0) { return T{0}; }
+                const long long nbatches = static_cast<long long>((ns + nb - 1) / nb);
+                this->makeReplicas();
+                const unsigned int nt = static_cast<unsigned int>(this->replicas.size());
+                T costsum = T{0};
+
+                if (hogwild) {
+#pragma omp parallel reduction(+:costsum)
+                    {
+                        FeedForwardNet<T, Al, Tf>& rep = *this->replicas[FeedForwardNet<T, Al, Tf>::thread_num()];
+#pragma omp for schedule(dynamic)
+                        for (long long bi = 0; bi < nbatches; ++bi) {
+                            const std::size_t s0 = bi * nb;
+                            const unsigned int bn = static_cast<unsigned int>(std::min (ns - s0, std::size_t{nb}));
+                            rep.copyParams (*this, true);
+                            if (rep.batch != bn) { rep.setBatchSize (bn); }
+                            rep.setBatchInput (theInputs.data() + s0, theOutputs.data() + s0);
+                            rep.feedforward_batch();
+                            costsum += rep.computeCost_batch() * bn;
+                            rep.backprop_batch();
+                            this->applyGradients (rep, eta, true);
+                        }
+                    }
+                    return costsum / static_cast<T>(ns);
+                }
+
+                std::vector<T> slice_cost (nt, T{0});
+                std::vector<unsigned int> slice_n (nt, 0U);
+                for (long long bi = 0; bi < nbatches; ++bi) {
+                    const std::size_t s0 = bi * nb;
+                    const unsigned int bn = static_cast<unsigned int>(std::min (ns - s0, std::size_t{nb}));
+#pragma omp parallel
+                    {
+                        const unsigned int t = FeedForwardNet<T, Al, Tf>::thread_num();
+                        // Slice t of the batch; the first bn % nt slices get one extra sample
+                        const unsigned int q = bn / nt;
+                        const unsigned int r = bn % nt;
+                        const unsigned int t0 = t * q + std::min (t, r);
+                        const unsigned int tn = q + (t < r ? 1U : 0U);
+                        slice_n[t] = tn;
+                        slice_cost[t] = T{0};
+                        if (tn > 0) {
+                            FeedForwardNet<T, Al, Tf>& rep = *this->replicas[t];
+                            rep.copyParams (*this, false);
+                            if (rep.batch != tn) { rep.setBatchSize (tn); }
+                            rep.setBatchInput (theInputs.data() + s0 + t0, theOutputs.data() + s0 + t0);
+                            rep.feedforward_batch();
+                            slice_cost[t] = rep.computeCost_batch() * tn;
+                            rep.backprop_batch();
+                        }
+                    }
+                    // Reduce the slices' mean gradients into the batch mean gradient and update
+                    this->reduceGradients (slice_n, bn);
+                    this->sgd_step (eta);
+                    for (unsigned int t = 0; t < nt; ++t) { costsum += slice_cost[t]; }
+                }
+                return costsum / static_cast<T>(ns);
+            }
+
             //! Set up an input along with desired output
-            void setInput (const morph::vvec<T>& theInput, const morph::vvec<T>& theOutput)
+            template <typename Ai, typename Ao>
+            void setInput (const morph::vvec<T, Ai>& theInput, const morph::vvec<T, Ao>& theOutput)
             {
-                *(this->neurons.begin()) = theInput;
-                this->desiredOutput = theOutput;
+                this->neurons.begin()->assign (theInput.begin(), theInput.end());
+                this->desiredOutput.assign (theOutput.begin(), theOutput.end());
             }
 
             //! Compute the cost for one input and one desired output
             T computeCost()
             {
-                // Here is where we compute delta_out:
-                this->delta_out = (this->neurons.back()-desiredOutput) * (this->connections.back().sigmoid_prime_z_lplus1());
-                // And the cost:
-                T l = (desiredOutput-this->neurons.back()).length();
-                this->cost = T{0.5} * l * l;
+                // Here is where we compute delta_out = (a - y) * f'(z), and the cost, without
+                // allocating any temporaries:
+                const morph::vvec<T, Al>& a = this->neurons.back();
+                this->delta_out.resize (a.size());
+                T sos = T{0};
+                for (std::size_t k = 0; k < a.size(); ++k) {
+                    const T d = a[k] - this->desiredOutput[k];
+                    this->delta_out[k] = d * Tf::df (a[k]);
+                    sos += d * d;
+                }
+                this->cost = T{0.5} * sos;
                 return this->cost;
             }
 
@@ -194,21 +422,151 @@ namespace morph {
                 return max;
             }
 
+            //! This thread's number in an OpenMP parallel region (0 without OpenMP)
+            static unsigned int thread_num()
+            {
+#ifdef _OPENMP
+                return static_cast<unsigned int>(omp_get_thread_num());
+#else
+                return 0U;
+#endif
+            }
+
+            //! Make one replica of this network per OpenMP thread, if they are not already there
+            void makeReplicas()
+            {
+#ifdef _OPENMP
+                const unsigned int nt = static_cast<unsigned int>(omp_get_max_threads());
+#else
+                const unsigned int nt = 1U;
+#endif
+                if (this->replicas.size() == nt) { return; }
+                std::vector<unsigned int> layer_spec;
+                for (auto& n : this->neurons) { layer_spec.push_back (n.size()); }
+                this->replicas.clear();
+                for (unsigned int t = 0; t < nt; ++t) {
+                    this->replicas.push_back (std::make_unique<FeedForwardNet<T, Al, Tf>>(layer_spec));
+                }
+            }
+
+            //! Copy the weights and biases of src into this network. If atomic, read each element
+            //! of src atomically, as other threads may be writing to it.
+            void copyParams (const FeedForwardNet<T, Al, Tf>& src, const bool atomic)
+            {
+                auto si = src.connections.begin();
+                for (auto& c : this->connections) {
+                    for (unsigned int i = 0; i < c.ws.size(); ++i) {
+                        FeedForwardNet<T, Al, Tf>::copy_elements (si->ws[i], c.ws[i], atomic);
+                    }
+                    FeedForwardNet<T, Al, Tf>::copy_elements (si->b, c.b, atomic);
+                    ++si;
+                }
+            }
+
+            static void copy_elements (const morph::vvec<T, Al>& from, morph::vvec<T, Al>& to, const bool atomic)
+            {
+                if (!atomic) {
+                    std::copy (from.begin(), from.end(), to.begin());
+                    return;
+                }
+                const T* f = from.data();
+                T* d = to.data();
+                for (std::size_t k = 0; k < from.size(); ++k) {
+                    T v;
+#pragma omp atomic read
+                    v = f[k];
+                    d[k] = v;
+                }
+            }
+
+            //! Subtract eta times rep's gradients from the weights and biases. If atomic, each
+            //! element is updated atomically, as in the Hogwild scheme.
+            void applyGradients (const FeedForwardNet<T, Al, Tf>& rep, const T eta, const bool atomic)
+            {
+                auto ri = rep.connections.begin();
+                for (auto& c : this->connections) {
+                    for (unsigned int i = 0; i < c.ws.size(); ++i) {
+                        FeedForwardNet<T, Al, Tf>::sub_scaled (ri->nabla_ws[i], eta, c.ws[i], atomic);
+                    }
+                    FeedForwardNet<T, Al, Tf>::sub_scaled (ri->nabla_b, eta, c.b, atomic);
+                    ++ri;
+                }
+            }
+
+            static void sub_scaled (const morph::vvec<T, Al>& g, const T eta, morph::vvec<T, Al>& v, const bool atomic)
+            {
+                const T* gp = g.data();
+                T* vp = v.data();
+                if (atomic) {
+                    for (std::size_t k = 0; k < g.size(); ++k) {
+                        const T dv = eta * gp[k];
+#pragma omp atomic update
+                        vp[k] -= dv;
+                    }
+                } else {
+                    for (std::size_t k = 0; k < g.size(); ++k) { vp[k] -= eta * gp[k]; }
+                }
+            }
+
+            /*!
+             * Set this network's nabla_ws and nabla_b to the mean gradient over a batch of bn
+             * samples, from the replicas' mean gradients over slices of slice_n[t] samples.
+             */
+            void reduceGradients (const std::vector<unsigned int>& slice_n, const unsigned int bn)
+            {
+                std::vector<typename std::list<morph::nn::FeedForwardConn<T, Al, Tf>>::const_iterator> rci;
+                std::vector<T> wt;
+                for (unsigned int t = 0; t < this->replicas.size(); ++t) {
+                    if (slice_n[t] == 0) { continue; }
+                    rci.push_back (this->replicas[t]->connections.begin());
+                    wt.push_back (static_cast<T>(slice_n[t]) / static_cast<T>(bn));
+                }
+                for (auto& c : this->connections) {
+                    for (unsigned int i = 0; i < c.nabla_ws.size(); ++i) {
+                        T* nw = c.nabla_ws[i].data();
+                        const long long nel = static_cast<long long>(c.nabla_ws[i].size());
+#pragma omp parallel for
+                        for (long long k = 0; k < nel; ++k) {
+                            T sum = T{0};
+                            for (unsigned int r = 0; r < rci.size(); ++r) { sum += wt[r] * rci[r]->nabla_ws[i][k]; }
+                            nw[k] = sum;
+                        }
+                    }
+                    for (std::size_t j = 0; j < c.nabla_b.size(); ++j) {
+                        T sum = T{0};
+                        for (unsigned int r = 0; r < rci.size(); ++r) { sum += wt[r] * rci[r]->nabla_b[j]; }
+                        c.nabla_b[j] = sum;
+                    }
+                    for (auto& ri : rci) { ++ri; }
+                }
+            }
+
             //! What's the cost function of the current output? Computed in computeCost()
             T cost = T{0};
 
             //! A variable number of neuron layers, each of variable size.
-            std::list<morph::vvec<T>> neurons;
+            std::list<morph::vvec<T, Al>> neurons;
             //! Connections. There should be neurons.size()-1 connection layers:
-            std::list<morph::nn::FeedForwardConn<T>> connections;
+            std::list<morph::nn::FeedForwardConn<T, Al, Tf>> connections;
             //! The error (dC/dz) of the output layer
-            morph::vvec<T> delta_out;
+            morph::vvec<T, Al> delta_out;
             //! The desired output of the network
-            morph::vvec<T> desiredOutput;
+            morph::vvec<T, Al> desiredOutput;
+
+            //! The mini-batch size set with setBatchSize()
+            unsigned int batch = 0U;
+            //! The batch neuron layers. Each is (layer size x batch), sample s in column s.
+            std::list<morph::vvec<T, Al>> neurons_b;
+            //! The batch error of the output layer
+            morph::vvec<T, Al> delta_out_b;
+            //! The batch desired output
+            morph::vvec<T, Al> desiredOutput_b;
+            //! Per-thread copies of this network, used by train_parallel()
+            std::vector<std::unique_ptr<FeedForwardNet<T, Al, Tf>>> replicas;
         };
 
-        template <typename T>
-        std::ostream& operator<< (std::ostream& os, const morph::nn::FeedForwardNet<T>& ff)
+        template <typename T, typename Al, typename Tf>
+        std::ostream& operator<< (std::ostream& os, const morph::nn::FeedForwardNet<T, Al, Tf>& ff)
         {
             os << ff.str();
             return os;
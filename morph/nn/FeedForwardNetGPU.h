@@ -0,0 +1,583 @@
+/*!
+ * \file
+ *
+ * A GL compute shader backend for morph::nn::FeedForwardNet<float>. The weights, biases,
+ * activations, errors and gradients of the network live in shader storage buffer objects (SSBOs)
+ * on the GPU, and mini-batch training runs there as a sequence of per-layer compute dispatches:
+ * a gather of the batch from the training set, a tiled matmul + transfer function for each layer
+ * going forwards, the output error, a tiled transposed matmul for each layer's error going
+ * backwards, the weight and bias gradients and the gradient descent step. Nothing is copied
+ * between CPU and GPU during an epoch, other than the sample order.
+ *
+ * The computations are those of FeedForwardNet::feedforward_batch(), computeCost_batch(),
+ * backprop_batch() and sgd_step(), with the same matrix layouts.
+ *
+ * As with morph/gl/compute_manager.h, you have to include the right GL headers (GL3/gl3.h and
+ * GL/glext.h for OpenGL 4.3+, or GLES3/gl31.h for OpenGL 3.1 ES) before including this file, and
+ * there must be a current GL context (for example, from a morph::gl::compute_manager_cli) when a
+ * FeedForwardNetGPU is constructed and used.
+ *
+ *\code{.cpp}
+ * morph::nn::FeedForwardNet<float> net ({784, 30, 10});
+ * morph::nn::FeedForwardNetGPU<morph::gl::version_3_1_es> gpu (net, 10); // batches of 10
+ * gpu.set_training_data (inputs, outputs);
+ * for (unsigned int ep = 0; ep < 30; ++ep) { float cost = gpu.train_epoch (3.0f, shuffled_order); }
+ * gpu.download_params(); // now net has the trained weights
+ *\endcode
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <morph/gl/version.h>
+#include <morph/gl/util.h>
+#include <morph/gl/shaders.h>
+#include <morph/gl/compute_shaderprog.h>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/nn/transfer.h>
+#include <morph/vvec.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace morph {
+    namespace nn {
+
+        /*!
+         * Train and evaluate a FeedForwardNet<float, Al, Tf> on the GPU. glver is the OpenGL
+         * version of the current context, which must support compute shaders (4.3+ or 3.1 ES+).
+         */
+        template <int glver, typename Al = std::allocator<float>, typename Tf = morph::nn::sigmoid<float>>
+        struct FeedForwardNetGPU
+        {
+            static_assert (morph::gl::version::gles (glver) ? morph::gl::version::minor (glver) >= 1
+                           : (morph::gl::version::major (glver) > 4
+                              || (morph::gl::version::major (glver) == 4 && morph::gl::version::minor (glver) >= 3)),
+                           "FeedForwardNetGPU needs compute shaders: OpenGL 4.3 or OpenGL 3.1 ES or later");
+
+            //! Side of the square work groups of the matmul kernels
+            static constexpr unsigned int tile = 16;
+            //! Work group size of the element-wise kernels
+            static constexpr unsigned int local_size = 64;
+
+            /*!
+             * Allocate the SSBOs for net, for mini-batches of up to nb samples, and upload its
+             * weights and biases. A GL context must be current.
+             */
+            FeedForwardNetGPU (morph::nn::FeedForwardNet<float, Al, Tf>& _net, const unsigned int nb)
+                : net(_net), batch(nb)
+            {
+                if (this->batch == 0) { throw std::runtime_error ("FeedForwardNetGPU: batch size must be > 0"); }
+                if (this->net.connections.empty()) { throw std::runtime_error ("FeedForwardNetGPU: net has no connections"); }
+                for (auto& n : this->net.neurons) { this->sizes.push_back (static_cast<unsigned int>(n.size())); }
+
+                this->load_shaders();
+
+                for (unsigned int sz : this->sizes) {
+                    this->act.push_back (FeedForwardNetGPU<glver, Al, Tf>::make_buffer (sz * this->batch));
+                    this->delta.push_back (FeedForwardNetGPU<glver, Al, Tf>::make_buffer (sz * this->batch));
+                }
+                for (unsigned int l = 0; l + 1 < this->sizes.size(); ++l) {
+                    const unsigned int nw = this->sizes[l] * this->sizes[l + 1];
+                    this->w.push_back (FeedForwardNetGPU<glver, Al, Tf>::make_buffer (nw));
+                    this->b.push_back (FeedForwardNetGPU<glver, Al, Tf>::make_buffer (this->sizes[l + 1]));
+                    this->nabla_w.push_back (FeedForwardNetGPU<glver, Al, Tf>::make_buffer (nw));
+                    this->nabla_b.push_back (FeedForwardNetGPU<glver, Al, Tf>::make_buffer (this->sizes[l + 1]));
+                }
+                this->target = FeedForwardNetGPU<glver, Al, Tf>::make_buffer (this->sizes.back() * this->batch);
+                this->sqerr = FeedForwardNetGPU<glver, Al, Tf>::make_buffer (this->sizes.back() * this->batch);
+                this->upload_params();
+            }
+
+            ~FeedForwardNetGPU()
+            {
+                auto del = [](std::vector<GLuint>& v) { if (!v.empty()) { glDeleteBuffers (v.size(), v.data()); } };
+                del (this->act);
+                del (this->delta);
+                del (this->w);
+                del (this->b);
+                del (this->nabla_w);
+                del (this->nabla_b);
+                GLuint others[5] = { this->target, this->sqerr, this->data_in, this->data_out, this->order };
+                glDeleteBuffers (5, others);
+            }
+
+            FeedForwardNetGPU (const FeedForwardNetGPU<glver, Al, Tf>&) = delete;
+            FeedForwardNetGPU<glver, Al, Tf>& operator= (const FeedForwardNetGPU<glver, Al, Tf>&) = delete;
+
+            //! Copy the weights and biases of net to the GPU
+            void upload_params()
+            {
+                unsigned int l = 0;
+                for (auto& c : this->net.connections) {
+                    FeedForwardNetGPU<glver, Al, Tf>::write_buffer (this->w[l], c.ws[0].size(), c.ws[0].data());
+                    FeedForwardNetGPU<glver, Al, Tf>::write_buffer (this->b[l], c.b.size(), c.b.data());
+                    ++l;
+                }
+            }
+
+            //! Copy the weights and biases (and the gradients of the last batch) from the GPU into net
+            void download_params()
+            {
+                unsigned int l = 0;
+                for (auto& c : this->net.connections) {
+                    FeedForwardNetGPU<glver, Al, Tf>::read_buffer (this->w[l], c.ws[0].size(), c.ws[0].data());
+                    FeedForwardNetGPU<glver, Al, Tf>::read_buffer (this->b[l], c.b.size(), c.b.data());
+                    FeedForwardNetGPU<glver, Al, Tf>::read_buffer (this->nabla_w[l], c.nabla_ws[0].size(), c.nabla_ws[0].data());
+                    FeedForwardNetGPU<glver, Al, Tf>::read_buffer (this->nabla_b[l], c.nabla_b.size(), c.nabla_b.data());
+                    ++l;
+                }
+            }
+
+            /*!
+             * Upload a training set into GPU memory, where it stays. Sample s is theInputs[s],
+             * with desired output theOutputs[s]. Replaces any previous training set.
+             */
+            template <typename Ai, typename Ao>
+            void set_training_data (const std::vector<morph::vvec<float, Ai>>& theInputs,
+                                    const std::vector<morph::vvec<float, Ao>>& theOutputs)
+            {
+                if (theInputs.size() != theOutputs.size()) {
+                    throw std::runtime_error ("FeedForwardNetGPU::set_training_data: different numbers of inputs and outputs");
+                }
+                const unsigned int m = this->sizes.front();
+                const unsigned int n = this->sizes.back();
+                this->nsamples = static_cast<unsigned int>(theInputs.size());
+                morph::vvec<float> ins (static_cast<std::size_t>(this->nsamples) * m);
+                morph::vvec<float> outs (static_cast<std::size_t>(this->nsamples) * n);
+                for (unsigned int s = 0; s < this->nsamples; ++s) {
+                    if (theInputs[s].size() != m || theOutputs[s].size() != n) {
+                        throw std::runtime_error ("FeedForwardNetGPU::set_training_data: wrong sample size");
+                    }
+                    std::copy (theInputs[s].begin(), theInputs[s].end(), ins.begin() + static_cast<std::size_t>(s) * m);
+                    std::copy (theOutputs[s].begin(), theOutputs[s].end(), outs.begin() + static_cast<std::size_t>(s) * n);
+                }
+                GLuint old[3] = { this->data_in, this->data_out, this->order };
+                glDeleteBuffers (3, old);
+                this->data_in = FeedForwardNetGPU<glver, Al, Tf>::make_buffer (ins.size(), ins.data());
+                this->data_out = FeedForwardNetGPU<glver, Al, Tf>::make_buffer (outs.size(), outs.data());
+                glGenBuffers (1, &this->order);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->order);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, std::max (this->nsamples, 1U) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            /*!
+             * One epoch of mini-batch gradient descent with learning rate eta through the
+             * training set, taking the samples in the order given by sample_order (a permutation
+             * of 0..nsamples-1 for a shuffled epoch). The last batch may be short. Returns the
+             * mean cost of the samples, each computed before the update that it contributes to.
+             */
+            float train_epoch (const float eta, const std::vector<unsigned int>& sample_order)
+            {
+                if (sample_order.size() != this->nsamples) {
+                    throw std::runtime_error ("FeedForwardNetGPU::train_epoch: sample_order must have one entry per sample");
+                }
+                if (this->nsamples == 0) { return 0.0f; }
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, this->order);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, this->nsamples * sizeof(GLuint), sample_order.data());
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                // The squared errors are summed over the epoch on the GPU
+                morph::vvec<float> zeros (this->sizes.back() * this->batch, 0.0f);
+                FeedForwardNetGPU<glver, Al, Tf>::write_buffer (this->sqerr, zeros.size(), zeros.data());
+
+                for (unsigned int s0 = 0; s0 < this->nsamples; s0 += this->batch) {
+                    const unsigned int bn = std::min (this->batch, this->nsamples - s0);
+                    this->gather (s0, bn);
+                    this->feedforward (bn);
+                    this->output_error (bn);
+                    this->backprop_and_step (bn, eta);
+                }
+
+                morph::vvec<float> se (zeros.size());
+                FeedForwardNetGPU<glver, Al, Tf>::read_buffer (this->sqerr, se.size(), se.data());
+                return se.sum() / static_cast<float>(this->nsamples);
+            }
+
+            //! One epoch through the training set in sample order
+            float train_epoch (const float eta)
+            {
+                std::vector<unsigned int> sample_order (this->nsamples);
+                std::iota (sample_order.begin(), sample_order.end(), 0U);
+                return this->train_epoch (eta, sample_order);
+            }
+
+            //! Compute the network outputs for theInputs on the GPU, writing them into theOutputs
+            template <typename Ai>
+            void compute_outputs (const std::vector<morph::vvec<float, Ai>>& theInputs,
+                                  std::vector<morph::vvec<float>>& theOutputs)
+            {
+                const unsigned int m = this->sizes.front();
+                const unsigned int n = this->sizes.back();
+                theOutputs.resize (theInputs.size());
+                morph::vvec<float> in_b (m * this->batch);
+                morph::vvec<float> out_b (n * this->batch);
+                for (std::size_t s0 = 0; s0 < theInputs.size(); s0 += this->batch) {
+                    const unsigned int bn = static_cast<unsigned int>(std::min (std::size_t{this->batch}, theInputs.size() - s0));
+                    // Column s of the (m x bn) input matrix is sample s0 + s
+                    for (unsigned int s = 0; s < bn; ++s) {
+                        if (theInputs[s0 + s].size() != m) {
+                            throw std::runtime_error ("FeedForwardNetGPU::compute_outputs: wrong input size");
+                        }
+                        for (unsigned int i = 0; i < m; ++i) { in_b[i * bn + s] = theInputs[s0 + s][i]; }
+                    }
+                    FeedForwardNetGPU<glver, Al, Tf>::write_buffer (this->act.front(), m * bn, in_b.data());
+                    this->feedforward (bn);
+                    FeedForwardNetGPU<glver, Al, Tf>::read_buffer (this->act.back(), n * bn, out_b.data());
+                    for (unsigned int s = 0; s < bn; ++s) {
+                        theOutputs[s0 + s].resize (n);
+                        for (unsigned int j = 0; j < n; ++j) { theOutputs[s0 + s][j] = out_b[j * bn + s]; }
+                    }
+                }
+            }
+
+            //! The CPU-side network
+            morph::nn::FeedForwardNet<float, Al, Tf>& net;
+            //! The largest number of samples in a batch
+            unsigned int batch = 0;
+            //! The number of samples in the training set
+            unsigned int nsamples = 0;
+
+        private:
+            //! Copy the bn samples order[s0..s0+bn-1] of the training set into the columns of the
+            //! input layer and the target matrix
+            void gather (const unsigned int s0, const unsigned int bn)
+            {
+                this->gather_prog.use();
+                this->gather_prog.set_uniform ("M", this->sizes.front());
+                this->gather_prog.set_uniform ("N", this->sizes.back());
+                this->gather_prog.set_uniform ("nb", bn);
+                this->gather_prog.set_uniform ("s0", s0);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->data_in);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->data_out);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->order);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->act.front());
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, this->target);
+                const unsigned int nel = std::max (this->sizes.front(), this->sizes.back()) * bn;
+                this->gather_prog.dispatch ((nel + local_size - 1) / local_size, 1, 1);
+            }
+
+            //! act[l+1] = f(W_l act[l] + b_l) for each layer, on (size x bn) matrices
+            void feedforward (const unsigned int bn)
+            {
+                this->forward_prog.use();
+                for (unsigned int l = 0; l + 1 < this->sizes.size(); ++l) {
+                    this->set_dims (this->forward_prog, this->sizes[l], this->sizes[l + 1], bn);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->w[l]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->act[l]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->act[l + 1]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->b[l]);
+                    this->forward_prog.dispatch ((bn + tile - 1) / tile, (this->sizes[l + 1] + tile - 1) / tile, 1);
+                }
+            }
+
+            //! delta of the output layer, (a - y) f'(a), and the sum of the squared errors
+            void output_error (const unsigned int bn)
+            {
+                this->output_prog.use();
+                this->output_prog.set_uniform ("N", this->sizes.back());
+                this->output_prog.set_uniform ("nb", bn);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->act.back());
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->target);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->delta.back());
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->sqerr);
+                this->output_prog.dispatch ((this->sizes.back() * bn + local_size - 1) / local_size, 1, 1);
+            }
+
+            /*!
+             * From the output layer backwards: the mean weight and bias gradients over the batch,
+             * the errors of the layer below (using the weights before they are updated) and then
+             * the gradient descent step for the layer.
+             */
+            void backprop_and_step (const unsigned int bn, const float eta)
+            {
+                for (unsigned int l = static_cast<unsigned int>(this->w.size()); l-- > 0;) {
+                    const unsigned int m = this->sizes[l];
+                    const unsigned int n = this->sizes[l + 1];
+                    // nabla_w = delta act[l]^T / bn
+                    this->wgrad_prog.use();
+                    this->set_dims (this->wgrad_prog, m, n, bn);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->delta[l + 1]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->act[l]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->nabla_w[l]);
+                    this->wgrad_prog.dispatch ((m + tile - 1) / tile, (n + tile - 1) / tile, 1);
+                    // nabla_b = delta 1 / bn
+                    this->bgrad_prog.use();
+                    this->bgrad_prog.set_uniform ("N", n);
+                    this->bgrad_prog.set_uniform ("nb", bn);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->delta[l + 1]);
+                    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->nabla_b[l]);
+                    this->bgrad_prog.dispatch ((n + local_size - 1) / local_size, 1, 1);
+                    // delta[l] = (W^T delta[l+1]) f'(act[l]); not needed for the input layer
+                    if (l > 0) {
+                        this->backward_prog.use();
+                        this->set_dims (this->backward_prog, m, n, bn);
+                        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, this->w[l]);
+                        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, this->delta[l + 1]);
+                        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, this->act[l]);
+                        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, this->delta[l]);
+                        this->backward_prog.dispatch ((bn + tile - 1) / tile, (m + tile - 1) / tile, 1);
+                    }
+                    this->sgd (this->w[l], this->nabla_w[l], m * n, eta);
+                    this->sgd (this->b[l], this->nabla_b[l], n, eta);
+                }
+            }
+
+            //! v -= eta g for the nel elements of buffer v
+            void sgd (const GLuint v, const GLuint g, const unsigned int nel, const float eta)
+            {
+                this->sgd_prog.use();
+                this->sgd_prog.set_uniform ("nel", nel);
+                this->sgd_prog.set_uniform ("eta", eta);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 0, v);
+                glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 1, g);
+                this->sgd_prog.dispatch ((nel + local_size - 1) / local_size, 1, 1);
+            }
+
+            //! Set the layer dimension uniforms of a matmul program: input size M, output size N, batch nb
+            static void set_dims (morph::gl::compute_shaderprog<glver>& prog,
+                                  const unsigned int M, const unsigned int N, const unsigned int nb)
+            {
+                prog.set_uniform ("M", M);
+                prog.set_uniform ("N", N);
+                prog.set_uniform ("nb", nb);
+            }
+
+            //! Make an SSBO of n floats, copying in data if it is not null
+            static GLuint make_buffer (const std::size_t n, const float* data = nullptr)
+            {
+                GLuint name = 0;
+                glGenBuffers (1, &name);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferData (GL_SHADER_STORAGE_BUFFER, std::max (n, std::size_t{1}) * sizeof(float), data, GL_DYNAMIC_COPY);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                return name;
+            }
+
+            //! Copy n floats from src into the start of buffer name
+            static void write_buffer (const GLuint name, const std::size_t n, const float* src)
+            {
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, n * sizeof(float), src);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! Copy the first n floats of buffer name into dst
+            static void read_buffer (const GLuint name, const std::size_t n, float* dst)
+            {
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, name);
+                const float* gpu = static_cast<const float*>(glMapBufferRange (GL_SHADER_STORAGE_BUFFER, 0, n * sizeof(float), GL_MAP_READ_BIT));
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+                if (gpu != nullptr) { std::copy (gpu, gpu + n, dst); }
+                glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+                glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+                morph::gl::Util::checkError (__FILE__, __LINE__);
+            }
+
+            //! The GLSL functions tf(z) and dtf(a) for the transfer function Tf
+            static std::string transfer_glsl()
+            {
+                if constexpr (std::is_same<Tf, morph::nn::sigmoid<float>>::value) {
+                    return "float tf (float z) { return 1.0 / (1.0 + exp (-z)); }\n"
+                    "float dtf (float a) { return a * (1.0 - a); }\n";
+                } else if constexpr (std::is_same<Tf, morph::nn::tanh<float>>::value) {
+                    return "float tf (float z) { return tanh (z); }\n"
+                    "float dtf (float a) { return 1.0 - a * a; }\n";
+                } else if constexpr (std::is_same<Tf, morph::nn::relu<float>>::value) {
+                    return "float tf (float z) { return max (z, 0.0); }\n"
+                    "float dtf (float a) { return a > 0.0 ? 1.0 : 0.0; }\n";
+                } else if constexpr (std::is_same<Tf, morph::nn::fast_sigmoid<float>>::value) {
+                    return "float tf (float z) { return 0.5 * z / (1.0 + abs (z)) + 0.5; }\n"
+                    "float dtf (float a) { float oms = 1.0 - abs (2.0 * a - 1.0); return 0.5 * oms * oms; }\n";
+                } else {
+                    []<bool flag = false>() { static_assert(flag, "FeedForwardNetGPU has no GLSL version of this transfer function"); }();
+                }
+            }
+
+            /*!
+             * The body of a tiled matmul kernel. Each work group computes a tile x tile block of
+             * C = A B for (R x K) A and (K x C) B, staging tiles of A and B in shared memory. The
+             * including shader defines R, C, K, A(r,k), B(k,c) and RESULT(r,c,v).
+             */
+            static std::string matmul_glsl()
+            {
+                return "shared float As[TILE][TILE];\n"
+                "shared float Bs[TILE][TILE];\n"
+                "void main()\n"
+                "{\n"
+                "    uint c = gl_GlobalInvocationID.x;\n"
+                "    uint r = gl_GlobalInvocationID.y;\n"
+                "    uint tx = gl_LocalInvocationID.x;\n"
+                "    uint ty = gl_LocalInvocationID.y;\n"
+                "    float acc = 0.0;\n"
+                "    for (uint k0 = 0u; k0 < K; k0 += TILE) {\n"
+                "        uint ka = k0 + tx;\n"
+                "        uint kb = k0 + ty;\n"
+                "        As[ty][tx] = (r < R && ka < K) ? A(r, ka) : 0.0;\n"
+                "        Bs[ty][tx] = (kb < K && c < C) ? B(kb, c) : 0.0;\n"
+                "        barrier();\n"
+                "        for (uint kk = 0u; kk < TILE; ++kk) { acc += As[ty][kk] * Bs[kk][tx]; }\n"
+                "        barrier();\n"
+                "    }\n"
+                "    if (r < R && c < C) { RESULT(r, c, acc); }\n"
+                "}\n";
+            }
+
+            //! The start of every shader: version, precision, work group size and transfer function
+            static std::string header_glsl (const bool two_d)
+            {
+                std::string h = morph::gl::version::shaderpreamble (glver);
+                if constexpr (morph::gl::version::gles (glver)) { h += "precision highp float;\nprecision highp int;\n"; }
+                h += "#define TILE " + std::to_string (tile) + "u\n";
+                if (two_d) {
+                    h += "layout (local_size_x = " + std::to_string (tile) + ", local_size_y = " + std::to_string (tile) + ", local_size_z = 1) in;\n";
+                } else {
+                    h += "layout (local_size_x = " + std::to_string (local_size) + ", local_size_y = 1, local_size_z = 1) in;\n";
+                }
+                h += "uniform uint M;\nuniform uint N;\nuniform uint nb;\n";
+                h += FeedForwardNetGPU<glver, Al, Tf>::transfer_glsl();
+                return h;
+            }
+
+            static void load (morph::gl::compute_shaderprog<glver>& prog, const std::string& src)
+            {
+                // No file name, so that the compiled-in source is always used
+                std::vector<morph::gl::ShaderInfo> shaders = { {GL_COMPUTE_SHADER, "", src, 0 } };
+                prog.load_shaders (shaders);
+                if (prog.prog_id == 0) { throw std::runtime_error ("FeedForwardNetGPU: failed to build a compute shader"); }
+            }
+
+            void load_shaders()
+            {
+                using G = FeedForwardNetGPU<glver, Al, Tf>;
+                // In all the layer kernels, W is (N x M), activations and errors are (size x nb)
+                // with one sample per column.
+                G::load (this->gather_prog, G::header_glsl (false)
+                         + "uniform uint s0;\n"
+                         "layout (std430, binding = 0) readonly buffer DataIn { float data_in[]; };\n"
+                         "layout (std430, binding = 1) readonly buffer DataOut { float data_out[]; };\n"
+                         "layout (std430, binding = 2) readonly buffer Order { uint order[]; };\n"
+                         "layout (std430, binding = 3) writeonly buffer In { float act_in[]; };\n"
+                         "layout (std430, binding = 4) writeonly buffer Target { float target[]; };\n"
+                         "void main()\n"
+                         "{\n"
+                         "    uint i = gl_GlobalInvocationID.x;\n"
+                         "    uint s = i % nb;\n"
+                         "    uint k = i / nb;\n"
+                         "    uint si = order[s0 + s];\n"
+                         "    if (k < M) { act_in[k * nb + s] = data_in[si * M + k]; }\n"
+                         "    if (k < N) { target[k * nb + s] = data_out[si * N + k]; }\n"
+                         "}\n");
+
+                G::load (this->forward_prog, G::header_glsl (true)
+                         + "layout (std430, binding = 0) readonly buffer W { float w[]; };\n"
+                         "layout (std430, binding = 1) readonly buffer In { float act_in[]; };\n"
+                         "layout (std430, binding = 2) writeonly buffer Out { float act_out[]; };\n"
+                         "layout (std430, binding = 3) readonly buffer Bias { float bias[]; };\n"
+                         "#define R N\n#define C nb\n#define K M\n"
+                         "#define A(r, k) w[(r) * M + (k)]\n"
+                         "#define B(k, c) act_in[(k) * nb + (c)]\n"
+                         "#define RESULT(r, c, v) act_out[(r) * nb + (c)] = tf ((v) + bias[r])\n"
+                         + G::matmul_glsl());
+
+                G::load (this->output_prog, G::header_glsl (false)
+                         + "layout (std430, binding = 0) readonly buffer Out { float act_out[]; };\n"
+                         "layout (std430, binding = 1) readonly buffer Target { float target[]; };\n"
+                         "layout (std430, binding = 2) writeonly buffer Delta { float delta[]; };\n"
+                         "layout (std430, binding = 3) buffer SqErr { float sqerr[]; };\n"
+                         "void main()\n"
+                         "{\n"
+                         "    uint i = gl_GlobalInvocationID.x;\n"
+                         "    if (i >= N * nb) { return; }\n"
+                         "    float a = act_out[i];\n"
+                         "    float d = a - target[i];\n"
+                         "    delta[i] = d * dtf (a);\n"
+                         "    sqerr[i] += 0.5 * d * d;\n"
+                         "}\n");
+
+                G::load (this->backward_prog, G::header_glsl (true)
+                         + "layout (std430, binding = 0) readonly buffer W { float w[]; };\n"
+                         "layout (std430, binding = 1) readonly buffer DeltaOut { float delta_out[]; };\n"
+                         "layout (std430, binding = 2) readonly buffer In { float act_in[]; };\n"
+                         "layout (std430, binding = 3) writeonly buffer DeltaIn { float delta_in[]; };\n"
+                         "#define R M\n#define C nb\n#define K N\n"
+                         "#define A(r, k) w[(k) * M + (r)]\n"
+                         "#define B(k, c) delta_out[(k) * nb + (c)]\n"
+                         "#define RESULT(r, c, v) delta_in[(r) * nb + (c)] = (v) * dtf (act_in[(r) * nb + (c)])\n"
+                         + G::matmul_glsl());
+
+                G::load (this->wgrad_prog, G::header_glsl (true)
+                         + "layout (std430, binding = 0) readonly buffer DeltaOut { float delta_out[]; };\n"
+                         "layout (std430, binding = 1) readonly buffer In { float act_in[]; };\n"
+                         "layout (std430, binding = 2) writeonly buffer NablaW { float nabla_w[]; };\n"
+                         "#define R N\n#define C M\n#define K nb\n"
+                         "#define A(r, k) delta_out[(r) * nb + (k)]\n"
+                         "#define B(k, c) act_in[(c) * nb + (k)]\n"
+                         "#define RESULT(r, c, v) nabla_w[(r) * M + (c)] = (v) / float(nb)\n"
+                         + G::matmul_glsl());
+
+                G::load (this->bgrad_prog, G::header_glsl (false)
+                         + "layout (std430, binding = 0) readonly buffer DeltaOut { float delta_out[]; };\n"
+                         "layout (std430, binding = 1) writeonly buffer NablaB { float nabla_b[]; };\n"
+                         "void main()\n"
+                         "{\n"
+                         "    uint j = gl_GlobalInvocationID.x;\n"
+                         "    if (j >= N) { return; }\n"
+                         "    float s = 0.0;\n"
+                         "    for (uint k = 0u; k < nb; ++k) { s += delta_out[j * nb + k]; }\n"
+                         "    nabla_b[j] = s / float(nb);\n"
+                         "}\n");
+
+                // sgd doesn't use the layer dimensions, so it has its own header
+                std::string sh = morph::gl::version::shaderpreamble (glver);
+                if constexpr (morph::gl::version::gles (glver)) { sh += "precision highp float;\nprecision highp int;\n"; }
+                G::load (this->sgd_prog, sh
+                         + "layout (local_size_x = " + std::to_string (local_size) + ", local_size_y = 1, local_size_z = 1) in;\n"
+                         "uniform uint nel;\n"
+                         "uniform float eta;\n"
+                         "layout (std430, binding = 0) buffer V { float v[]; };\n"
+                         "layout (std430, binding = 1) readonly buffer G { float g[]; };\n"
+                         "void main()\n"
+                         "{\n"
+                         "    uint i = gl_GlobalInvocationID.x;\n"
+                         "    if (i < nel) { v[i] -= eta * g[i]; }\n"
+                         "}\n");
+            }
+
+            //! Layer sizes of net
+            std::vector<unsigned int> sizes;
+            //! SSBO names. act[l] and delta[l] are the (sizes[l] x batch) activations and errors of
+            //! layer l; w[l], b[l], nabla_w[l] and nabla_b[l] belong to connection l.
+            std::vector<GLuint> act;
+            std::vector<GLuint> delta;
+            std::vector<GLuint> w;
+            std::vector<GLuint> b;
+            std::vector<GLuint> nabla_w;
+            std::vector<GLuint> nabla_b;
+            //! Desired outputs of the batch and the running sum of the squared output errors
+            GLuint target = 0;
+            GLuint sqerr = 0;
+            //! The training set (one sample per row) and the order to take it in
+            GLuint data_in = 0;
+            GLuint data_out = 0;
+            GLuint order = 0;
+
+            morph::gl::compute_shaderprog<glver> gather_prog;
+            morph::gl::compute_shaderprog<glver> forward_prog;
+            morph::gl::compute_shaderprog<glver> output_prog;
+            morph::gl::compute_shaderprog<glver> backward_prog;
+            morph::gl::compute_shaderprog<glver> wgrad_prog;
+            morph::gl::compute_shaderprog<glver> bgrad_prog;
+            morph::gl::compute_shaderprog<glver> sgd_prog;
+        };
+
+    } // namespace nn
+} // namespace morph
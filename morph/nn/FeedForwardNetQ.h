@@ -0,0 +1,268 @@
+/*!
+ * \file
+ *
+ * A quantised, inference-only copy of a trained morph::nn::FeedForwardNet. The weights of each
+ * layer are stored either as int8 with a float scale per output neuron (symmetric, max|w|/127)
+ * or as IEEE half precision (fp16) bit patterns; the biases stay in full precision. There are no
+ * backprop buffers, just a pair of activation vectors, and each layer is computed by one fused
+ * kernel: the dot product of each weight row with the input, the scale, the bias and the
+ * transfer function.
+ *
+ * In int8 mode, the input to each layer is quantised to int8 too (with a scale of max|x|/127,
+ * computed for each input vector), so that the dot products are int8 x int8 sums in int32, which
+ * compilers vectorise well. The int32 sums cannot overflow for layers of fewer than 133152 inputs.
+ * In fp16 mode, the dot products are computed in T from the weights as they are converted. Either
+ * way the weights take a quarter (int8) or a half (fp16) of the memory of float weights, which is
+ * what limits the speed of inference for large layers.
+ *
+ *\code{.cpp}
+ * morph::nn::FeedForwardNet<float> net ({784, 30, 10});
+ * // ...train net...
+ * morph::nn::FeedForwardNetQ<float> qnet (net); // int8, or (net, morph::nn::quantisation::fp16)
+ * const morph::vvec<float>& out = qnet.compute (image);
+ *\endcode
+ */
+#pragma once
+
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/nn/transfer.h>
+#include <morph/vvec.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <cstdint>
+#include <bit>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+namespace morph {
+    namespace nn {
+
+        //! The weight formats of FeedForwardNetQ
+        enum class quantisation { int8, fp16 };
+
+        //! Conversions between float and the bits of an IEEE 754 binary16 (half precision) number
+        namespace fp16 {
+
+            //! Round x to the nearest half (ties to even), returning its bits
+            inline std::uint16_t from_float (const float x)
+            {
+                std::uint32_t f = std::bit_cast<std::uint32_t>(x);
+                const std::uint32_t sign = f & 0x80000000u;
+                f ^= sign;
+                std::uint32_t o = 0u;
+                if (f >= 0x47800000u) {
+                    // Too large for a half: infinity, or NaN
+                    o = f > 0x7f800000u ? 0x7e00u : 0x7c00u;
+                } else if (f < 0x38800000u) {
+                    // Subnormal half, or zero. Adding 0.5 lines the subnormal's bits up at the
+                    // bottom of the mantissa, with the FPU doing the rounding.
+                    const float denorm_magic = std::bit_cast<float>(0x3f000000u);
+                    o = std::bit_cast<std::uint32_t>(std::bit_cast<float>(f) + denorm_magic) - 0x3f000000u;
+                } else {
+                    // Normal half. Rebias the exponent and round the mantissa to nearest even.
+                    const std::uint32_t mant_odd = (f >> 13) & 1u;
+                    f += 0xc8000fffu; // ((15 - 127) << 23) + 0xfff, mod 2^32
+                    f += mant_odd;
+                    o = f >> 13;
+                }
+                return static_cast<std::uint16_t>(o | (sign >> 16));
+            }
+
+            //! The float of the half bits h. Branch free, with the special cases as bit masks.
+            inline float to_float (const std::uint16_t h)
+            {
+                constexpr std::uint32_t shifted_exp = 0x7c00u << 13;
+                const std::uint32_t hu = h;
+                std::uint32_t o = (hu & 0x7fffu) << 13;
+                const std::uint32_t e = o & shifted_exp;
+                o += (127u - 15u) << 23;
+                // Inf and NaN need the rest of the exponent change
+                const std::uint32_t infnan = 0u - static_cast<std::uint32_t>(e == shifted_exp);
+                o += infnan & ((128u - 16u) << 23);
+                // Zero and subnormals are renormalised with a float subtraction
+                const std::uint32_t sub = 0u - static_cast<std::uint32_t>(e == 0u);
+                const float renorm = std::bit_cast<float>(o + (1u << 23)) - std::bit_cast<float>(113u << 23);
+                o = (sub & std::bit_cast<std::uint32_t>(renorm)) | (~sub & o);
+                return std::bit_cast<float>(o | ((hu & 0x8000u) << 16));
+            }
+
+        } // namespace fp16
+
+        /*!
+         * An inference-only FeedForwardNet with quantised weights. Construct it from a trained
+         * FeedForwardNet<T, Al, Tf>; it holds its own copy of the (quantised) parameters, so it
+         * doesn't change if the FeedForwardNet is trained further. Call compile() again to
+         * requantise.
+         */
+        template <typename T = float, typename Tf = morph::nn::sigmoid<T>>
+        struct FeedForwardNetQ
+        {
+            static_assert (std::is_floating_point_v<T>, "FeedForwardNetQ: T must be a floating point type");
+
+            template <typename Al>
+            explicit FeedForwardNetQ (const FeedForwardNet<T, Al, Tf>& net, const quantisation q = quantisation::int8)
+            {
+                this->compile (net, q);
+            }
+
+            //! Quantise the parameters of net into this
+            template <typename Al>
+            void compile (const FeedForwardNet<T, Al, Tf>& net, const quantisation q = quantisation::int8)
+            {
+                if (net.neurons.empty()) { throw std::runtime_error ("FeedForwardNetQ: the network has no layers"); }
+                this->format = q;
+                this->layers.clear();
+                this->n_in = static_cast<unsigned int>(net.neurons.front().size());
+                unsigned int maxsz = this->n_in;
+                for (const auto& c : net.connections) {
+                    if (c.ins.size() != 1u) {
+                        throw std::runtime_error ("FeedForwardNetQ: connections must have a single input layer");
+                    }
+                    layer l;
+                    l.m = static_cast<unsigned int>(c.ins[0]->size());
+                    l.n = c.N;
+                    l.b.resize (l.n);
+                    for (unsigned int j = 0; j < l.n; ++j) { l.b[j] = c.b[j]; }
+                    const morph::vvec<T, Al>& w = c.ws[0];
+                    if (q == quantisation::int8) {
+                        l.wq.resize (static_cast<std::size_t>(l.n) * l.m);
+                        l.scale.resize (l.n);
+                        for (unsigned int j = 0; j < l.n; ++j) {
+                            const T* wr = w.data() + static_cast<std::size_t>(j) * l.m;
+                            T maxabs = T{0};
+                            for (unsigned int k = 0; k < l.m; ++k) { maxabs = std::max (maxabs, std::abs (wr[k])); }
+                            l.scale[j] = maxabs / T{127};
+                            const T inv = maxabs > T{0} ? T{127} / maxabs : T{0};
+                            std::int8_t* qr = l.wq.data() + static_cast<std::size_t>(j) * l.m;
+                            for (unsigned int k = 0; k < l.m; ++k) {
+                                qr[k] = static_cast<std::int8_t>(std::clamp (std::lround (wr[k] * inv), -127L, 127L));
+                            }
+                        }
+                    } else {
+                        l.wh.resize (w.size());
+                        for (std::size_t k = 0; k < w.size(); ++k) { l.wh[k] = fp16::from_float (static_cast<float>(w[k])); }
+                    }
+                    maxsz = std::max (maxsz, l.n);
+                    this->layers.push_back (std::move (l));
+                }
+                this->n_out = this->layers.empty() ? this->n_in : this->layers.back().n;
+                this->act[0].resize (maxsz, T{0});
+                this->act[1].resize (maxsz, T{0});
+                this->xq.resize (maxsz, 0);
+                this->output.resize (this->n_out, T{0});
+            }
+
+            //! Compute the network's output for n_in inputs at in, writing n_out outputs to out
+            void compute (const T* in, T* out)
+            {
+                if (this->layers.empty()) { std::copy (in, in + this->n_in, out); return; }
+                const T* x = in;
+                for (std::size_t i = 0; i < this->layers.size(); ++i) {
+                    T* y = (i + 1 == this->layers.size()) ? out : this->act[i % 2].data();
+                    if (this->format == quantisation::int8) {
+                        this->layer_int8 (this->layers[i], x, y);
+                    } else {
+                        this->layer_fp16 (this->layers[i], x, y);
+                    }
+                    x = y;
+                }
+            }
+
+            //! Compute the network's output for input, which must have n_in elements
+            template <typename C>
+            const morph::vvec<T>& compute (const C& input)
+            {
+                if (input.size() != this->n_in) { throw std::runtime_error ("FeedForwardNetQ::compute: wrong input size"); }
+                this->compute (input.data(), this->output.data());
+                return this->output;
+            }
+
+            //! The number of bytes taken by the weights and their scales
+            std::size_t weight_bytes() const
+            {
+                std::size_t nb = 0;
+                for (const auto& l : this->layers) {
+                    nb += l.wq.size() * sizeof (std::int8_t) + l.wh.size() * sizeof (std::uint16_t)
+                    + l.scale.size() * sizeof (T);
+                }
+                return nb;
+            }
+
+            //! Output the layer sizes and the weight format as a string
+            std::string str() const
+            {
+                std::stringstream ss;
+                ss << "FeedForwardNetQ (" << (this->format == quantisation::int8 ? "int8" : "fp16") << "): " << this->n_in;
+                for (const auto& l : this->layers) { ss << " -> " << l.n; }
+                ss << " (" << this->weight_bytes() << " bytes of weights)";
+                return ss.str();
+            }
+
+            //! The parameters of one layer; the weights are an (n x m) row-major matrix
+            struct layer
+            {
+                unsigned int m = 0;
+                unsigned int n = 0;
+                //! int8 weights and the scale of each row (int8 mode)
+                std::vector<std::int8_t> wq;
+                morph::vvec<T> scale;
+                //! Half precision weights (fp16 mode)
+                std::vector<std::uint16_t> wh;
+                //! The biases
+                morph::vvec<T> b;
+            };
+
+            quantisation format = quantisation::int8;
+            unsigned int n_in = 0;
+            unsigned int n_out = 0;
+            std::vector<layer> layers;
+
+        private:
+            //! y = Tf::f (scale * (wq . quantised x) + b)
+            void layer_int8 (const layer& l, const T* x, T* y)
+            {
+                // Quantise the input
+                T maxabs = T{0};
+                for (unsigned int k = 0; k < l.m; ++k) { maxabs = std::max (maxabs, std::abs (x[k])); }
+                const T xs = maxabs / T{127};
+                const T inv = maxabs > T{0} ? T{127} / maxabs : T{0};
+                std::int8_t* q = this->xq.data();
+                for (unsigned int k = 0; k < l.m; ++k) { q[k] = static_cast<std::int8_t>(std::lround (x[k] * inv)); }
+
+                const std::int8_t* wr = l.wq.data();
+                for (unsigned int j = 0; j < l.n; ++j) {
+                    std::int32_t d = 0;
+                    for (unsigned int k = 0; k < l.m; ++k) {
+                        d += static_cast<std::int32_t>(wr[k]) * static_cast<std::int32_t>(q[k]);
+                    }
+                    y[j] = Tf::f (static_cast<T>(d) * (l.scale[j] * xs) + l.b[j]);
+                    wr += l.m;
+                }
+            }
+
+            //! y = Tf::f (w . x + b) with w converted from half precision
+            void layer_fp16 (const layer& l, const T* x, T* y)
+            {
+                const std::uint16_t* wr = l.wh.data();
+                for (unsigned int j = 0; j < l.n; ++j) {
+                    T d = T{0};
+                    for (unsigned int k = 0; k < l.m; ++k) { d += static_cast<T>(fp16::to_float (wr[k])) * x[k]; }
+                    y[j] = Tf::f (d + l.b[j]);
+                    wr += l.m;
+                }
+            }
+
+            //! Ping-pong activations between the layers
+            morph::vvec<T> act[2];
+            //! The quantised input of the current layer
+            std::vector<std::int8_t> xq;
+            //! The output of compute (const C&)
+            morph::vvec<T> output;
+        };
+
+    } // namespace nn
+} // namespace morph
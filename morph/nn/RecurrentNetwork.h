@@ -7,8 +7,12 @@
  * \date 2020
  */
 
+#pragma once
+
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include <morph/rngd.h> // for morph::randDouble()
 
 namespace morph {
@@ -43,6 +47,18 @@ namespace morph {
              *    P.addBias();
              *    P.setNet();
              *    ****
+             *
+             * or, equivalently, pass the connectivity list to the constructor:
+             *
+             *    ****
+             *    RecurrentNetwork P (N,dt,tauW,tauX,tauY,divergenceThreshold,maxConvergenceSteps,pre,post);
+             *    ****
+             *
+             * The weights are stored sparsely, one per connection, so memory and time scale with
+             * the number of connections rather than N^2. setNet() builds two compressed sparse
+             * row (CSR) indices into W: the connections into each node (used by forward()) and
+             * the connections out of each node (used by backward()). With these, each node's sum
+             * is a gather over its own connections, so the passes run in parallel.
              */
             class RecurrentNetwork {
 
@@ -59,6 +75,7 @@ namespace morph {
                 // Wbest - keep track of the current best weights (those yielding minimum reconstruction error)
                 // Y - vector of node activation values (backward pass)
                 // F - stores the feed-forward activity (after squahsing - sigmoid)
+                // Xpre, Ypre - working memory for convergeForward and convergeBackward: X and Y before each step
                 // V - stores the backward-pass activity
                 // Fprime - stores the derivative of the sigmoid
                 // J - stores error term used in backward pass
@@ -70,14 +87,17 @@ namespace morph {
                 // Post - vector of post-synaptic node identities (should be same length as Pre)
                 // zero - useful for resetting the matrix of pointers Wptr
                 // divergenceThreshold - threshold below which time-differences in total error signal convergence to a (point) attractor state
-                // Wptr - pointers into the weight vector W, useful for efficiently constructing an N x N sparse weight matrix, for convenient inspection / saving
+                // Wptr - pointers into the weight vector W, useful for efficiently constructing an N x N sparse weight matrix, for convenient inspection / saving. Only filled by setWeightPointers(), as it has Nplus1^2 elements
+                // inStart, inW - CSR index of the connections into each node: those into node i are W[inW[inStart[i]]] to W[inW[inStart[i+1]-1]]
+                // outStart, outW - CSR index of the connections out of each node (including the bias node N, if there is one)
 
                 int N, Nweight, Nplus1, maxConvergenceSteps;
-                std::vector<double> W, X, Input, U, Wbest, Y, F, V, Fprime, J;
+                std::vector<double> W, X, Input, U, Wbest, Y, F, V, Fprime, J, Xpre, Ypre;
                 double dt, dtOverTauX, dtOverTauY, dtOverTauW;
                 std::vector<int> Pre, Post;
                 double zero, divergenceThreshold;
                 std::vector<double*> Wptr;
+                std::vector<int> inStart, inW, outStart, outW;
 
                 RecurrentNetwork(void){
 
@@ -87,6 +107,16 @@ namespace morph {
                     init(N, dt, tauW, tauX, tauY, divergenceThreshold, maxConvergenceSteps);
                 }
 
+                //! Construct with the connectivity list (pre[i] -> post[i]), optionally adding a bias
+                //! node, and call setNet(). The network is then ready to use.
+                RecurrentNetwork(int N, double dt, double tauW, double tauX, double tauY, double divergenceThreshold, int maxConvergenceSteps,
+                                 const std::vector<int>& pre, const std::vector<int>& post, bool bias = true){
+                    init(N, dt, tauW, tauX, tauY, divergenceThreshold, maxConvergenceSteps);
+                    connect(pre, post);
+                    if(bias){ addBias(); }
+                    setNet();
+                }
+
                 void init(int N, double dt, double tauW, double tauX, double tauY, double divergenceThreshold, int maxConvergenceSteps){
 
                     this->N=N;
@@ -96,6 +126,8 @@ namespace morph {
                     F.resize(N,0.);
                     J.resize(N,0.);
                     Fprime.resize(N,0.);
+                    Xpre.resize(N,0.);
+                    Ypre.resize(N,0.);
                     Nplus1 = N; // overwrite if bias
                     this->divergenceThreshold= divergenceThreshold * N;
                     this->maxConvergenceSteps= maxConvergenceSteps;
@@ -137,25 +169,65 @@ namespace morph {
                     Post.push_back(post);
                 }
 
+                //! adds 0-weight connections from pre[i] to post[i] for each i
+                void connect(const std::vector<int>& pre, const std::vector<int>& post){
+
+                    if(pre.size()!=post.size()){ throw std::runtime_error("RecurrentNetwork::connect: pre and post differ in size"); }
+                    W.reserve(W.size()+pre.size());
+                    Pre.reserve(Pre.size()+pre.size());
+                    Post.reserve(Post.size()+post.size());
+                    for(size_t i=0;i<pre.size();i++){ connect(pre[i],post[i]); }
+                }
+
                 //! set all network weights to random values from a uniform disribution in
                 //! the range weightMin -- weightMax
                 void randomizeWeights(double weightMin, double weightMax){
 
                     double weightRange = weightMax-weightMin;
-                    for(int i=0;i<W.size();i++){
+                    for(size_t i=0;i<W.size();i++){
                         W[i] = morph::randDouble()*weightRange+weightMin;
                     }
                 }
 
-                //! Register the number of connection weights and obtain pointers to them
-                //! once all connections have been set.
+                //! Register the number of connection weights and build the sparse indices into
+                //! them once all connections have been set.
                 void setNet(void){
 
                     Nweight = W.size();
                     Wbest = W;
-                    Wptr.resize(Nplus1*Nplus1,&zero);
+                    V.resize(Nplus1,0.);
+                    Input.resize(Nplus1,0.);
+                    for(int k=0;k<Nweight;k++){
+                        if(Post[k]<0 || Post[k]>=N || Pre[k]<0 || Pre[k]>=Nplus1){
+                            throw std::runtime_error("RecurrentNetwork::setNet: connection to or from a node that doesn't exist");
+                        }
+                    }
+                    buildIndex(Post, N, inStart, inW);
+                    buildIndex(Pre, Nplus1, outStart, outW);
+                    Wptr.clear();
+                }
+
+                //! Make a CSR index of the connections grouped by node[k] (Pre or Post) with n
+                //! nodes. Within each node, the connections stay in the order they were made, so
+                //! sums over them are the same as in a loop over all k.
+                static void buildIndex(const std::vector<int>& node, int n, std::vector<int>& start, std::vector<int>& idx){
+
+                    start.assign(n+1,0);
+                    for(size_t k=0;k<node.size();k++){ start[node[k]+1]++; }
+                    for(int i=0;i<n;i++){ start[i+1] += start[i]; }
+                    idx.resize(node.size());
+                    std::vector<int> fill(start.begin(),start.end()-1);
+                    for(size_t k=0;k<node.size();k++){ idx[fill[node[k]]++] = static_cast<int>(k); }
+                }
+
+                //! Fill Wptr with pointers into W for the full Nplus1 x Nplus1 matrix (zero where
+                //! there is no connection). This needs Nplus1^2 pointers, so for large, sparse
+                //! networks prefer W with Pre and Post.
+                void setWeightPointers(void){
+
+                    Wptr.assign(static_cast<size_t>(Nplus1)*Nplus1,&zero);
                     for(int i=0;i<Nweight;i++){
-                        Wptr[Pre[i]*Nplus1+Post[i]] = &W[i];
+                        Wptr[static_cast<size_t>(Pre[i])*Nplus1+Post[i]] = &W[i];
                     }
                 }
 
@@ -180,18 +252,21 @@ namespace morph {
                 //! external input to input nodes.
                 void forward(void){
 
-                    std::fill(U.begin(),U.end(),0.);
-
-                    // Don't OMP this loop - buggy!
-                    for(int k=0;k<Nweight;k++){
-                        U[Post[k]] += X[Pre[k]] * W[k];
-                    }
-                    //#pragma omp parallel for
+                    // Each node gathers over its incoming connections (a scatter over all the
+                    // connections, U[Post[k]] += ..., can't be run in parallel)
+#pragma omp parallel for
                     for(int i=0;i<N;i++){
-                        F[i] = 1./(1.+exp(-U[i]));
+                        double u = 0.;
+                        for(int c=inStart[i];c<inStart[i+1];c++){
+                            int k = inW[c];
+                            u += X[Pre[k]] * W[k];
+                        }
+                        U[i] = u;
+                        F[i] = 1./(1.+std::exp(-u));
                     }
 
-                    //#pragma omp parallel for
+                    // X is only updated once all of the U have been computed from it
+#pragma omp parallel for
                     for(int i=0;i<N;i++){
                         X[i] +=dtOverTauX* ( -X[i] + F[i] + Input[i] );
                     }
@@ -204,7 +279,7 @@ namespace morph {
                 void setError(std::vector<int> oID, std::vector<double> targetOutput){
 
                     std::fill(J.begin(),J.end(),0.);
-                    for(int i=0;i<oID.size();i++){
+                    for(size_t i=0;i<oID.size();i++){
                         J[oID[i]] = targetOutput[i]-X[oID[i]];
                     }
                 }
@@ -214,19 +289,23 @@ namespace morph {
                 //! sigmoid, and J_i=target_i-x_i is the discrepancy to be minimised
                 void backward(void){
 
-                    //#pragma omp parallel for
+#pragma omp parallel for
                     for(int i=0;i<N;i++){
                         Fprime[i] = F[i]*(1.0-F[i]);
                     }
 
-                    std::fill(V.begin(), V.end()-1,0.);
-
-                    //#pragma omp parallel for
-                    for(int k=0;k<Nweight;k++){
-                        V[Pre[k]] += Fprime[Post[k]] * W[k] * Y[Post[k]];
+                    // Each node gathers over its outgoing connections
+#pragma omp parallel for
+                    for(int i=0;i<N;i++){
+                        double v = 0.;
+                        for(int c=outStart[i];c<outStart[i+1];c++){
+                            int k = outW[c];
+                            v += Fprime[Post[k]] * W[k] * Y[Post[k]];
+                        }
+                        V[i] = v;
                     }
 
-                    //#pragma omp parallel for
+#pragma omp parallel for
                     for(int i=0;i<N;i++){
                         Y[i] +=dtOverTauY * (V[i] - Y[i] + J[i]);
                     }
@@ -242,10 +321,10 @@ namespace morph {
                  */
                 void weightUpdate(void){
 
-                    //#pragma omp parallel for
-                    double delta;
+                    // An outer product over the connections only
+#pragma omp parallel for
                     for(int k=0;k<Nweight;k++){
-                        delta = (X[Pre[k]] * Y[Post[k]] * Fprime[Post[k]]);
+                        double delta = (X[Pre[k]] * Y[Post[k]] * Fprime[Post[k]]);
                         if(delta<-1.0){
                             W[k] -= dtOverTauW;
                         } else if (delta>1.0) {
@@ -271,9 +350,9 @@ namespace morph {
                 //! flattened NxN weight matrix
                 std::vector<double> getWeightMatrix(void){
 
-                    std::vector<double> flatweightmat(Wptr.size());
-                    for(int i=0;i<Wptr.size();i++){
-                        flatweightmat[i] = *Wptr[i];
+                    std::vector<double> flatweightmat(static_cast<size_t>(Nplus1)*Nplus1,0.);
+                    for(int k=0;k<Nweight;k++){
+                        flatweightmat[static_cast<size_t>(Pre[k])*Nplus1+Post[k]] = W[k];
                     }
                     return flatweightmat;
                 }
@@ -285,11 +364,10 @@ namespace morph {
                 //! converged=true, else if ii) return converged=false
                 bool convergeForward(void){
 
-                    std::vector<double> Xpre(N,0.);
                     double total = N;
                     for(int t=0;t<maxConvergenceSteps;t++){
                         if(total>divergenceThreshold){
-                            Xpre=X;
+                            std::copy(X.begin(),X.begin()+N,Xpre.begin());
                             forward();
                             total = 0.0;
                             for(int i=0;i<N;i++){ total +=(X[i]-Xpre[i])*(X[i]-Xpre[i]); }
@@ -306,11 +384,10 @@ namespace morph {
                 //! converged=true, else if ii) return converged=false
                 bool convergeBackward(void){
 
-                    std::vector<double> Ypre(N,0.);
                     double total = N;
                     for(int t=0;t<maxConvergenceSteps;t++){
                         if(total>divergenceThreshold){
-                            Ypre=Y;
+                            std::copy(Y.begin(),Y.begin()+N,Ypre.begin());
                             backward();
                             total = 0.0;
                             for(int i=0;i<N;i++){ total +=(Y[i]-Ypre[i])*(Y[i]-Ypre[i]); }
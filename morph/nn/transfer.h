@@ -0,0 +1,60 @@
+/*!
+ * \file
+ *
+ * Transfer (activation) functions for the neurons in morph::nn networks. Each is a struct with two
+ * static functions: f(z), the output for activation z, and df(a), the derivative df/dz expressed
+ * in terms of the output a = f(z), which is what backpropagation has to hand. They are template
+ * parameters of FeedForwardConn and FeedForwardNet, so the calls inline into the layer loops.
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <cmath>
+
+namespace morph {
+    namespace nn {
+
+        //! The logistic sigmoid, 1/(1+exp(-z)). f' = a(1-a).
+        template <typename T>
+        struct sigmoid
+        {
+            static T f (const T z) { return T{1} / (T{1} + std::exp (-z)); }
+            static T df (const T a) { return a * (T{1} - a); }
+        };
+
+        //! Hyperbolic tangent. Outputs in (-1,1). f' = 1-a^2.
+        template <typename T>
+        struct tanh
+        {
+            static T f (const T z) { return std::tanh (z); }
+            static T df (const T a) { return T{1} - a * a; }
+        };
+
+        //! The rectified linear unit, max(0,z). f' is 1 for z > 0, else 0.
+        template <typename T>
+        struct relu
+        {
+            static T f (const T z) { return z > T{0} ? z : T{0}; }
+            static T df (const T a) { return a > T{0} ? T{1} : T{0}; }
+        };
+
+        /*!
+         * A fast rational approximation to the sigmoid, 0.5 z/(1+|z|) + 0.5, which has the same
+         * range, value and slope ordering as the logistic function but needs no exp(), so it
+         * vectorises well. With s = 2a-1 = z/(1+|z|), f' = 0.5 (1-|s|)^2.
+         */
+        template <typename T>
+        struct fast_sigmoid
+        {
+            static T f (const T z) { return T{0.5} * z / (T{1} + std::abs (z)) + T{0.5}; }
+            static T df (const T a)
+            {
+                const T oms = T{1} - std::abs (T{2} * a - T{1});
+                return T{0.5} * oms * oms;
+            }
+        };
+
+    } // namespace nn
+} // namespace morph
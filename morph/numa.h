@@ -0,0 +1,151 @@
+/*!
+ * \file
+ *
+ * Placement of large vectors in the memory of a multi-socket (NUMA) machine.
+ *
+ * Linux places each page of memory on the node of the thread that first writes to it. A
+ * vector that is sized (and so zeroed) by one thread lands entirely on that thread's node,
+ * and the parallel loops that later work on it read remote memory from every other node.
+ * morph::numa::resize() sizes an empty vector and then writes its elements in parallel,
+ * with the same schedule(static) division of the indices as the loops of RD_Base and
+ * rk_integrator, so that each thread's share of the vector is on its own node. The
+ * interleave policy instead spreads the pages over all of the nodes, which suits vectors
+ * that are read by every thread.
+ *
+ * First touch placement holds only while each thread stays on its node: call pin_threads()
+ * (or set OMP_PROC_BIND) before the vectors are sized. On a machine with one node, or on
+ * another operating system, the placement has no effect beyond the parallel fill.
+ */
+#pragma once
+
+#include <morph/threadpool.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#ifdef __linux__
+# include <sched.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <linux/mempolicy.h>
+#endif
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+namespace morph::numa {
+
+    //! How resize() places the pages of a new vector
+    enum class policy
+    {
+        serial,      //!< Sized by the calling thread, as std::vector::resize does
+        first_touch, //!< Each page on the node of the thread whose share of the indices it holds
+        interleave   //!< Pages spread round robin over all of the nodes
+    };
+
+    //! The online NUMA nodes, from /sys/devices/system/node/online (just node 0 if that can't be read)
+    inline std::vector<unsigned int> nodes()
+    {
+        std::vector<unsigned int> ns;
+        std::ifstream f ("/sys/devices/system/node/online");
+        std::string list;
+        if (f && std::getline (f, list)) {
+            // A list of ranges such as "0-1,4"
+            std::stringstream ss (list);
+            std::string range;
+            while (std::getline (ss, range, ',')) {
+                try {
+                    const std::size_t dash = range.find ('-');
+                    const unsigned long a = std::stoul (range.substr (0, dash));
+                    const unsigned long b = dash == std::string::npos ? a : std::stoul (range.substr (dash + 1));
+                    for (unsigned long n = a; n <= b; ++n) { ns.push_back (static_cast<unsigned int>(n)); }
+                } catch (const std::exception&) {
+                    ns.clear();
+                    break;
+                }
+            }
+        }
+        if (ns.empty()) { ns.push_back (0u); }
+        return ns;
+    }
+
+    /*!
+     * Pin each OpenMP thread to one of the CPUs that the process may run on, thread t to the
+     * t-th CPU (round robin), so that threads keep their share of first touched vectors on
+     * their own node. Returns false if pinning is not available or failed.
+     */
+    inline bool pin_threads()
+    {
+#ifdef __linux__
+        // The CPUs allowed before any pinning (afterwards the calling thread has just one)
+        static const std::vector<int> cpus = [] {
+            std::vector<int> c;
+            cpu_set_t allowed;
+            CPU_ZERO (&allowed);
+            if (sched_getaffinity (0, sizeof (allowed), &allowed) == 0) {
+                for (int i = 0; i < CPU_SETSIZE; ++i) { if (CPU_ISSET (i, &allowed)) { c.push_back (i); } }
+            }
+            return c;
+        }();
+        if (cpus.empty()) { return false; }
+        std::atomic<bool> ok = true;
+#pragma omp parallel
+        {
+#ifdef _OPENMP
+            const std::size_t t = static_cast<std::size_t>(omp_get_thread_num());
+#else
+            const std::size_t t = 0;
+#endif
+            cpu_set_t one;
+            CPU_ZERO (&one);
+            CPU_SET (cpus[t % cpus.size()], &one);
+            if (sched_setaffinity (0, sizeof (one), &one) != 0) { ok = false; }
+        }
+        return ok;
+#else
+        return false;
+#endif
+    }
+
+    /*!
+     * Resize v to n elements of value. An empty v is placed according to p and filled in
+     * parallel; a v that already has elements is resized by std::vector::resize, keeping
+     * its contents and its placement.
+     */
+    template <typename T>
+    void resize (std::vector<T>& v, const std::size_t n, const T& value, const policy p = policy::first_touch)
+    {
+        static_assert (std::is_trivially_copyable_v<T>, "morph::numa::resize places vectors of trivially copyable elements");
+        if (p == policy::serial || !v.empty() || n == 0) {
+            v.resize (n, value);
+            return;
+        }
+        v.resize (n, value);
+#ifdef __linux__
+        // Give the whole pages of the new buffer back to the kernel. They read as zero until
+        // they are next written, which is when they are placed.
+        const std::uintptr_t pg = static_cast<std::uintptr_t>(sysconf (_SC_PAGESIZE));
+        const std::uintptr_t b = (reinterpret_cast<std::uintptr_t>(v.data()) + pg - 1) / pg * pg;
+        const std::uintptr_t e = reinterpret_cast<std::uintptr_t>(v.data() + n) / pg * pg;
+        if (e > b && madvise (reinterpret_cast<void*>(b), e - b, MADV_DONTNEED) == 0 && p == policy::interleave) {
+            std::vector<unsigned long> mask (1, 0ul);
+            constexpr unsigned int bits = 8 * sizeof (unsigned long);
+            for (unsigned int nd : nodes()) {
+                if (nd / bits >= mask.size()) { mask.resize (nd / bits + 1, 0ul); }
+                mask[nd / bits] |= 1ul << (nd % bits);
+            }
+            // Failure (as on a kernel without NUMA support) leaves first touch placement
+            syscall (SYS_mbind, b, e - b, MPOL_INTERLEAVE, mask.data(), mask.size() * bits + 1, 0u);
+        }
+#endif
+        T* d = v.data();
+        morph::parallel_for (std::size_t{0}, n, [d, &value](std::size_t i) { d[i] = value; });
+    }
+
+} // namespace morph::numa
@@ -0,0 +1,308 @@
+/*
+ * A cache of objective function evaluations for the optimisers (Anneal and NM_Simplex),
+ * with a surrogate model of the objective that can screen out candidates that are
+ * predicted to be much worse than the best found so far.
+ */
+#pragma once
+
+#include <morph/vvec.h>
+#include <morph/vec.h>
+
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * Records every objective function value computed through evaluate(), keyed by the
+     * parameters quantised to the step sizes in quantum. Parameters that quantise to the
+     * same key as an earlier evaluation return its value without calling the objective
+     * again. The records are held in a k-d tree on the keys, which also gives the nearest
+     * earlier evaluations to a new point for the surrogate.
+     *
+     * The built-in surrogate is a Gaussian kernel (radial basis function) weighted mean of
+     * the nearest surrogate_neighbours evaluations. Set surrogate to use another model, such
+     * as a Gaussian process fitted to the history (nearest(), point() and value() give access
+     * to it). If screen_margin is set and the surrogate predicts that a candidate is worse than
+     * the caller's best value by more than screen_margin, evaluate() returns the prediction
+     * instead of calling the objective.
+     *
+     * evaluate() may be called from several threads at once; the objective is called
+     * without the cache's lock held.
+     *
+     * \tparam T The type of the parameters and objective values (float or double)
+     */
+    template <typename T>
+    class objective_cache
+    {
+    public:
+        //! Construct with the quantisation step for each parameter. Distances for the
+        //! surrogate are measured in the parameters' own units unless length_scale is changed.
+        objective_cache (const morph::vvec<T>& _quantum)
+            : quantum (_quantum), length_scale (_quantum.size(), T{1})
+        {
+            if (this->quantum.empty() || this->quantum.min() <= T{0}) {
+                throw std::runtime_error ("objective_cache: quantum must hold a positive step for each parameter");
+            }
+        }
+
+        //! Construct from the parameter ranges (as given to Anneal). Each parameter is
+        //! quantised to resolution times its range and surrogate distances are measured
+        //! in units of the range.
+        objective_cache (const morph::vvec<morph::vec<T, 2>>& param_ranges, const T resolution = T{1e-6})
+        {
+            for (auto pr : param_ranges) {
+                const T width = std::abs (pr[1] - pr[0]);
+                this->quantum.push_back (width * resolution);
+                this->length_scale.push_back (width);
+            }
+            if (this->quantum.empty() || this->quantum.min() <= T{0}) {
+                throw std::runtime_error ("objective_cache: parameter ranges must have non-zero width");
+            }
+        }
+
+        //! The quantisation step for each parameter
+        morph::vvec<T> quantum;
+        //! The scale of each parameter for the surrogate's distances
+        morph::vvec<T> length_scale;
+        //! The width of the surrogate's Gaussian kernel, in units of length_scale. A point
+        //! with no earlier evaluation within this distance gets no prediction.
+        T kernel_width = T{0.05};
+        //! How many of the nearest evaluations the built-in surrogate uses
+        unsigned int surrogate_neighbours = 8;
+        //! The surrogate is not used until the cache holds this many evaluations
+        unsigned int min_history = 16;
+        //! Screen out a candidate whose prediction is worse than the best value by more than
+        //! this. The default, infinity, means never screen.
+        T screen_margin = std::numeric_limits<T>::infinity();
+        //! An optional replacement for the built-in surrogate. It should set the prediction
+        //! for the point and return true, or return false if it has no confident prediction.
+        //! It is called with the cache's lock held, so it may use nearest(), point() and value().
+        std::function<bool(const morph::vvec<T>&, T&)> surrogate;
+
+        //! The number of evaluate() calls answered from the cache
+        unsigned long long int hits = 0;
+        //! The number of calls made to the objective
+        unsigned long long int evaluations = 0;
+        //! The number of candidates screened out by the surrogate
+        unsigned long long int screened = 0;
+
+        //! Return the objective value for x, from the cache if possible
+        template <typename F>
+        T evaluate (const morph::vvec<T>& x, const F& objective)
+        {
+            return this->evaluate_impl (x, objective, false, T{0}, true);
+        }
+
+        /*!
+         * Return the objective value for x, from the cache if possible. If not, and the
+         * surrogate predicts that x is worse than f_best by more than screen_margin, the
+         * prediction is returned (and not recorded). downhill says whether lower values are
+         * better.
+         */
+        template <typename F>
+        T evaluate (const morph::vvec<T>& x, const F& objective, const T f_best, const bool downhill = true)
+        {
+            return this->evaluate_impl (x, objective, true, f_best, downhill);
+        }
+
+        //! Make a function that evaluates objective through the cache (with no screening)
+        //! that can be set as NM_Simplex::objective, for example.
+        template <typename F>
+        std::function<T(const morph::vvec<T>&)> wrap (F objective)
+        {
+            return [this, objective](const morph::vvec<T>& x) { return this->evaluate (x, objective); };
+        }
+
+        //! The built-in surrogate's prediction for x. Returns false if there is no earlier
+        //! evaluation within kernel_width of x (or fewer than min_history in all)
+        bool predict (const morph::vvec<T>& x, T& prediction) const
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            return this->kernel_predict (x, prediction);
+        }
+
+        //! The indices of the (up to) k evaluations nearest to x, nearest first, measuring
+        //! distance in units of length_scale. Not locked, for use within a surrogate.
+        std::vector<unsigned int> nearest (const morph::vvec<T>& x, const unsigned int k) const
+        {
+            std::vector<unsigned int> rtn;
+            if (this->nodes.empty() || k == 0) { return rtn; }
+            std::priority_queue<std::pair<T, unsigned int>> best; // max-heap on distance squared
+            this->knn (0, x, k, best);
+            rtn.resize (best.size());
+            for (std::size_t i = rtn.size(); i > 0; --i) { rtn[i - 1] = best.top().second; best.pop(); }
+            return rtn;
+        }
+
+        //! The parameters of evaluation i
+        const morph::vvec<T>& point (const unsigned int i) const { return this->nodes[i].x; }
+        //! The objective value of evaluation i
+        T value (const unsigned int i) const { return this->nodes[i].f; }
+        //! The number of evaluations held
+        std::size_t size() const { return this->nodes.size(); }
+        //! The distance, in units of length_scale, between x and y
+        T distance (const morph::vvec<T>& x, const morph::vvec<T>& y) const
+        {
+            return std::sqrt (this->distance_sq (x, y));
+        }
+
+        //! Forget every evaluation
+        void clear()
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            this->nodes.clear();
+            this->hits = 0;
+            this->evaluations = 0;
+            this->screened = 0;
+        }
+
+    protected:
+        //! A k-d tree node. The split dimension is the depth modulo the number of parameters.
+        struct node
+        {
+            std::vector<std::int64_t> key;
+            morph::vvec<T> x;
+            T f = T{0};
+            int left = -1;
+            int right = -1;
+        };
+        //! The tree. Node 0 is the root.
+        std::vector<node> nodes;
+        //! Guards nodes and the counts
+        mutable std::mutex m;
+
+        std::vector<std::int64_t> make_key (const morph::vvec<T>& x) const
+        {
+            if (x.size() != this->quantum.size()) {
+                throw std::runtime_error ("objective_cache: parameters have the wrong number of dimensions");
+            }
+            std::vector<std::int64_t> key (x.size());
+            for (std::size_t i = 0; i < x.size(); ++i) {
+                key[i] = static_cast<std::int64_t>(std::llround (x[i] / this->quantum[i]));
+            }
+            return key;
+        }
+
+        //! The index of the node with this key, or -1. Equal keys always take the same
+        //! (right hand) branch, so a key can only be found on its insertion path.
+        int find (const std::vector<std::int64_t>& key) const
+        {
+            int i = this->nodes.empty() ? -1 : 0;
+            std::size_t d = 0;
+            while (i >= 0) {
+                const node& nd = this->nodes[i];
+                if (nd.key == key) { return i; }
+                i = key[d] < nd.key[d] ? nd.left : nd.right;
+                d = (d + 1) % key.size();
+            }
+            return -1;
+        }
+
+        void insert (std::vector<std::int64_t>&& key, const morph::vvec<T>& x, const T f)
+        {
+            const int ni = static_cast<int>(this->nodes.size());
+            if (ni > 0) {
+                int i = 0;
+                std::size_t d = 0;
+                for (;;) {
+                    int& child = key[d] < this->nodes[i].key[d] ? this->nodes[i].left : this->nodes[i].right;
+                    if (child < 0) { child = ni; break; }
+                    i = child;
+                    d = (d + 1) % key.size();
+                }
+            }
+            this->nodes.push_back ({ std::move (key), x, f, -1, -1 });
+        }
+
+        T distance_sq (const morph::vvec<T>& x, const morph::vvec<T>& y) const
+        {
+            T d2 = T{0};
+            for (std::size_t i = 0; i < x.size(); ++i) {
+                const T d = (x[i] - y[i]) / this->length_scale[i];
+                d2 += d * d;
+            }
+            return d2;
+        }
+
+        //! Add the nearest neighbours of x in the subtree at node i to best
+        void knn (const int i, const morph::vvec<T>& x, const unsigned int k,
+                  std::priority_queue<std::pair<T, unsigned int>>& best, const std::size_t d = 0) const
+        {
+            if (i < 0) { return; }
+            const node& nd = this->nodes[i];
+            const T d2 = this->distance_sq (x, nd.x);
+            if (best.size() < k) {
+                best.push ({ d2, static_cast<unsigned int>(i) });
+            } else if (d2 < best.top().first) {
+                best.pop();
+                best.push ({ d2, static_cast<unsigned int>(i) });
+            }
+            // Keys below nd.key[d] go left, so the splitting plane lies half a quantum
+            // below the node's quantised coordinate
+            const T split = (static_cast<T>(nd.key[d]) - T{0.5}) * this->quantum[d];
+            const bool go_left = x[d] < split;
+            const std::size_t dn = (d + 1) % x.size();
+            this->knn (go_left ? nd.left : nd.right, x, k, best, dn);
+            const T plane = (x[d] - split) / this->length_scale[d];
+            if (best.size() < k || plane * plane < best.top().first) {
+                this->knn (go_left ? nd.right : nd.left, x, k, best, dn);
+            }
+        }
+
+        //! The Gaussian kernel weighted mean of the nearest evaluations
+        bool kernel_predict (const morph::vvec<T>& x, T& prediction) const
+        {
+            if (this->nodes.size() < this->min_history) { return false; }
+            std::vector<unsigned int> nn = this->nearest (x, this->surrogate_neighbours);
+            if (nn.empty() || this->distance (x, this->nodes[nn[0]].x) > this->kernel_width) { return false; }
+            const T two_h2 = T{2} * this->kernel_width * this->kernel_width;
+            T wsum = T{0};
+            T fsum = T{0};
+            for (unsigned int i : nn) {
+                const T w = std::exp (-this->distance_sq (x, this->nodes[i].x) / two_h2);
+                wsum += w;
+                fsum += w * this->nodes[i].f;
+            }
+            if (!(wsum > T{0})) { return false; }
+            prediction = fsum / wsum;
+            return true;
+        }
+
+        template <typename F>
+        T evaluate_impl (const morph::vvec<T>& x, const F& objective, const bool screen, const T f_best, const bool downhill)
+        {
+            std::vector<std::int64_t> key = this->make_key (x);
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                const int i = this->find (key);
+                if (i >= 0) {
+                    ++this->hits;
+                    return this->nodes[i].f;
+                }
+                if (screen && std::isfinite (this->screen_margin)) {
+                    T pred = T{0};
+                    const bool have = this->surrogate ? this->surrogate (x, pred) : this->kernel_predict (x, pred);
+                    if (have && (downhill ? pred > f_best + this->screen_margin : pred < f_best - this->screen_margin)) {
+                        ++this->screened;
+                        return pred;
+                    }
+                }
+            }
+            const T f = objective (x);
+            std::lock_guard<std::mutex> lk (this->m);
+            ++this->evaluations;
+            // Another thread may have computed the same key meanwhile
+            if (this->find (key) < 0) { this->insert (std::move (key), x, f); }
+            return f;
+        }
+    };
+
+} // namespace morph
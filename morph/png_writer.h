@@ -0,0 +1,149 @@
+/*
+ * A background thread that encodes and writes PNG files, so that the thread which
+ * produces the images (usually a rendering thread) does not wait on PNG compression.
+ */
+#pragma once
+
+#include <morph/lodepng.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <utility>
+#include <cstddef>
+
+namespace morph {
+
+    /*!
+     * A queue of images to save as PNG, serviced by one worker thread.
+     *
+     * push() an image and it is written out in the background. The queue holds at most
+     * max_queued images; push() blocks while it is full, so that a slow disk cannot use up
+     * all the memory. wait() blocks until everything pushed so far has been written. The
+     * destructor writes any images that are still queued before it returns.
+     */
+    struct png_writer
+    {
+        //! One image to save
+        struct job
+        {
+            std::string filename;
+            unsigned int width = 0;
+            unsigned int height = 0;
+            //! RGBA bytes, 4 * width * height of them
+            std::vector<unsigned char> rgba;
+            //! If true, rows are bottom row first (as from glReadPixels) and are flipped before encoding
+            bool bottom_up = false;
+            //! If true, the alpha channel is set to 255 before encoding
+            bool opaque = false;
+        };
+
+        png_writer (const std::size_t _max_queued = 8) : max_queued(_max_queued)
+        {
+            this->worker = std::thread (&png_writer::run, this);
+        }
+
+        ~png_writer()
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                this->stopping = true;
+            }
+            this->cv_work.notify_one();
+            if (this->worker.joinable()) { this->worker.join(); }
+        }
+
+        png_writer (const png_writer&) = delete;
+        png_writer& operator= (const png_writer&) = delete;
+
+        //! Queue an image to be written. Blocks while max_queued images are already queued.
+        void push (job&& j)
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_space.wait (lk, [this] { return this->jobs.size() < this->max_queued; });
+            this->jobs.push_back (std::move (j));
+            lk.unlock();
+            this->cv_work.notify_one();
+        }
+
+        //! Block until every image pushed so far has been written
+        void wait()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            this->cv_idle.wait (lk, [this] { return this->jobs.empty() && !this->busy; });
+        }
+
+        //! The number of images waiting to be written (not counting the one being written now)
+        std::size_t queued()
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            return this->jobs.size();
+        }
+
+        //! The number of images that failed to encode or write
+        std::size_t errors()
+        {
+            std::lock_guard<std::mutex> lk (this->m);
+            return this->nerrors;
+        }
+
+        //! Flip and/or make opaque as j requests, then encode and write j to its file. Returns the lodepng error code.
+        static unsigned int write (job& j)
+        {
+            const std::size_t rowbytes = 4 * static_cast<std::size_t>(j.width);
+            if (j.opaque) {
+                for (std::size_t i = 3; i < j.rgba.size(); i += 4) { j.rgba[i] = 255; }
+            }
+            if (j.bottom_up) {
+                for (unsigned int r = 0; r < j.height / 2; ++r) {
+                    std::swap_ranges (j.rgba.begin() + r * rowbytes, j.rgba.begin() + (r + 1) * rowbytes,
+                                      j.rgba.begin() + (j.height - r - 1) * rowbytes);
+                }
+                j.bottom_up = false;
+            }
+            return lodepng::encode (j.filename, j.rgba.data(), j.width, j.height);
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lk (this->m);
+            for (;;) {
+                this->cv_work.wait (lk, [this] { return this->stopping || !this->jobs.empty(); });
+                if (this->jobs.empty()) { break; } // stopping, and nothing is left to write
+                job j = std::move (this->jobs.front());
+                this->jobs.pop_front();
+                this->busy = true;
+                lk.unlock();
+                this->cv_space.notify_one();
+
+                unsigned int error = png_writer::write (j);
+                if (error) {
+                    std::cerr << "encoder error " << error << ": " << lodepng_error_text (error) << std::endl;
+                }
+
+                lk.lock();
+                if (error) { ++this->nerrors; }
+                this->busy = false;
+                if (this->jobs.empty()) { this->cv_idle.notify_all(); }
+            }
+        }
+
+        std::size_t max_queued = 8;
+        std::deque<job> jobs;
+        bool busy = false;
+        bool stopping = false;
+        std::size_t nerrors = 0;
+        std::mutex m;
+        std::condition_variable cv_work;
+        std::condition_variable cv_space;
+        std::condition_variable cv_idle;
+        std::thread worker;
+    };
+
+} // namespace morph
@@ -0,0 +1,85 @@
+/*!
+ * \file
+ * \brief Binning points into a 2D histogram, for the density mode of ScatterVisual.
+ *
+ * The points are binned by their x and y coordinates into a grid of bins covering a
+ * rectangular window. The points are shared out in chunks, each binned into its own
+ * histogram, and the histograms are then summed, so that millions of points are binned in
+ * parallel with no atomics.
+ */
+
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/threadpool.h>
+#include <vector>
+#include <array>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph::point_density {
+
+    //! The lowest and highest x and y of the points p (both zero if p is empty)
+    inline std::array<morph::vec<float, 2>, 2> extent (const std::vector<morph::vec<float, 3>>& p)
+    {
+        if (p.empty()) { return { morph::vec<float, 2>{ 0.0f, 0.0f }, morph::vec<float, 2>{ 0.0f, 0.0f } }; }
+        morph::vec<float, 2> lo = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        morph::vec<float, 2> hi = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        for (const morph::vec<float, 3>& q : p) {
+            lo[0] = std::min (lo[0], q[0]);
+            lo[1] = std::min (lo[1], q[1]);
+            hi[0] = std::max (hi[0], q[0]);
+            hi[1] = std::max (hi[1], q[1]);
+        }
+        return { lo, hi };
+    }
+
+    /*!
+     * The number of points p in each of nbins[0] by nbins[1] bins covering the window from
+     * lo to hi. Bin (i, j) is element j * nbins[0] + i. Points outside the window (and NaNs)
+     * are not counted; a point on the upper edge of the window is counted in the last bin.
+     */
+    inline std::vector<std::uint32_t> histogram (const std::vector<morph::vec<float, 3>>& p,
+                                                 const morph::vec<unsigned int, 2>& nbins,
+                                                 const morph::vec<float, 2>& lo, const morph::vec<float, 2>& hi)
+    {
+        const std::size_t nb = static_cast<std::size_t>(nbins[0]) * nbins[1];
+        std::vector<std::uint32_t> h (nb, 0u);
+        if (p.empty() || nb == 0 || !(hi[0] > lo[0]) || !(hi[1] > lo[1])) { return h; }
+
+        const float nx = static_cast<float>(nbins[0]);
+        const float ny = static_cast<float>(nbins[1]);
+        const float sx = nx / (hi[0] - lo[0]);
+        const float sy = ny / (hi[1] - lo[1]);
+
+        // One chunk per thread, but none smaller than 64k points
+        constexpr std::size_t min_chunk = 65536;
+        const std::size_t nthreads = std::max (1u, std::thread::hardware_concurrency());
+        const std::size_t nchunks = std::max (std::size_t{1}, std::min (nthreads, p.size() / min_chunk));
+        std::vector<std::vector<std::uint32_t>> part (nchunks - 1);
+        morph::parallel_for (std::size_t{0}, nchunks, [&](std::size_t c) {
+            std::vector<std::uint32_t>& hc = c == 0 ? h : part[c - 1];
+            if (c > 0) { hc.assign (nb, 0u); }
+            const std::size_t b = p.size() * c / nchunks;
+            const std::size_t e = p.size() * (c + 1) / nchunks;
+            for (std::size_t i = b; i < e; ++i) {
+                const float x = (p[i][0] - lo[0]) * sx;
+                const float y = (p[i][1] - lo[1]) * sy;
+                if (!(x >= 0.0f && x <= nx && y >= 0.0f && y <= ny)) { continue; }
+                const std::size_t ix = std::min (static_cast<std::size_t>(x), static_cast<std::size_t>(nbins[0] - 1));
+                const std::size_t iy = std::min (static_cast<std::size_t>(y), static_cast<std::size_t>(nbins[1] - 1));
+                ++hc[iy * nbins[0] + ix];
+            }
+        }, 1);
+        if (!part.empty()) {
+            morph::parallel_for (std::size_t{0}, nb, [&](std::size_t k) {
+                for (const std::vector<std::uint32_t>& hc : part) { h[k] += hc[k]; }
+            });
+        }
+        return h;
+    }
+
+} // namespace morph::point_density
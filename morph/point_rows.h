@@ -0,0 +1,82 @@
+/*!
+ * \file
+ * \brief Stitching rows of points together into triangles, for PointRowsVisual and
+ * PointRowsMeshVisual.
+ *
+ * The points are arranged in rows, each row a run of points with the same coordinate on
+ * one axis. Rows are listed in slice order and the points in each row are in order along
+ * the row. Each adjacent pair of rows is stitched independently of the others, so the
+ * pairs can be stitched in parallel.
+ */
+
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/MathAlgo.h>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph::point_rows {
+
+    //! The first and last indices into p of each row, where a row is a run of points with the same p[][pa]
+    inline std::vector<std::array<std::size_t, 2>> find_rows (const std::vector<morph::vec<float, 3>>& p, const unsigned int pa)
+    {
+        std::vector<std::array<std::size_t, 2>> rows;
+        std::size_t r = 0;
+        while (r < p.size()) {
+            std::size_t e = r;
+            while (e + 1 < p.size() && p[e + 1][pa] == p[r][pa]) { ++e; }
+            rows.push_back ({ r, e });
+            r = e + 1;
+        }
+        return rows;
+    }
+
+    /*!
+     * Stitch row a to row b. The first triangle edge joins a[0] to b[0]. Each step then makes
+     * the triangle that advances along row a (a 1 in the returned steps) or along row b (a
+     * 0), whichever makes the smaller angle at the far vertex. Once one row has reached its
+     * end, one last step is made along the other row, and the stitching stops. The number of
+     * triangles is the number of steps.
+     */
+    inline std::vector<std::uint8_t> stitch (const std::vector<morph::vec<float, 3>>& p,
+                                             const std::array<std::size_t, 2>& a, const std::array<std::size_t, 2>& b)
+    {
+        std::vector<std::uint8_t> steps;
+        std::size_t r1 = a[0];
+        std::size_t r2 = b[0];
+        for (;;) {
+            const std::size_t r1n = r1 + 1;
+            const std::size_t r2n = r2 + 1;
+            if (r1n > a[1] && r2n > b[1]) { break; }
+
+            bool along_a = false;
+            bool last = false;
+            if (r1n > a[1]) {
+                last = true;
+            } else if (r2n > b[1]) {
+                along_a = true;
+                last = true;
+            } else {
+                // Compare the angles at r1 of the triangles (r1, r2, r1n) and (r1, r2, r2n)
+                const float asq = MathAlgo::distance_sq<float, 3> (p[r1], p[r2]);
+                const float r1_to_r1n_sq = MathAlgo::distance_sq<float, 3> (p[r1], p[r1n]);
+                const float r1_to_r2n_sq = MathAlgo::distance_sq<float, 3> (p[r1], p[r2n]);
+                const float r2_to_r1n_sq = MathAlgo::distance_sq<float, 3> (p[r2], p[r1n]);
+                const float r2_to_r2n_sq = MathAlgo::distance_sq<float, 3> (p[r2], p[r2n]);
+                const float alpha1 = std::acos ((r2_to_r1n_sq + r1_to_r1n_sq - asq) / (2 * std::sqrt (r2_to_r1n_sq) * std::sqrt (r1_to_r1n_sq)));
+                const float alpha2 = std::acos ((r2_to_r2n_sq + r1_to_r2n_sq - asq) / (2 * std::sqrt (r2_to_r2n_sq) * std::sqrt (r1_to_r2n_sq)));
+                along_a = alpha2 < alpha1;
+            }
+
+            steps.push_back (along_a ? 1 : 0);
+            if (along_a) { r1 = r1n; } else { r2 = r2n; }
+            if (last) { break; }
+        }
+        return steps;
+    }
+
+} // namespace morph::point_rows
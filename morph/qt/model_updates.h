@@ -0,0 +1,158 @@
+/*!
+ * \file
+ *
+ * The new VisualModels and model rebuilds that morph::qt::viswidget and viswidget_mx work
+ * through at the start of each paintGL(), a frame's worth at a time.
+ */
+#pragma once
+
+#include <morph/VisualModel.h>
+#include <vector>
+#include <memory>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+
+namespace morph {
+    namespace qt {
+
+        template <int glver>
+        struct model_updates
+        {
+            // In your Qt code, build VisualModels that should be added to the scene and add them
+            // to this. Use from the GUI thread only; from other threads, use add_visual_model().
+            std::vector<std::unique_ptr<morph::VisualModel<glver>>> newvisualmodels;
+            // The models that have been added to the scene, in the order they were added
+            std::vector<morph::VisualModel<glver>*> model_ptrs;
+
+            // if >-1, then that model needs a reinit. Kept for older code; prefer set_model_needs_reinit().
+            int needs_reinit = -1;
+
+            /*!
+             * If true, the vertices of new models and of models marked for reinit are built on
+             * the shared morph::job_pool (see VisualModel::reinit_async) and paintGL only
+             * uploads them. A model keeps drawing its old geometry until its new vertices are
+             * ready. The data a model's initializeVertices() reads must then not change while
+             * its build_pending() is true, and models must not add text in initializeVertices()
+             * (see VisualModel::finish_async_build).
+             */
+            bool async_builds = false;
+
+            /*!
+             * The time in ms that one paintGL may spend on new models and rebuilds (and, with
+             * async_builds, on uploading finished builds; see VisualOwnable::upload_budget_ms).
+             * Work left over is done in the following frames. At least one model is dealt with
+             * each frame. 0 means no limit.
+             */
+            double frame_budget_ms = 8.0;
+
+            virtual ~model_updates() = default;
+
+            //! Add a model to the scene at the next paint. May be called from any thread.
+            void add_visual_model (std::unique_ptr<morph::VisualModel<glver>> model)
+            {
+                {
+                    std::lock_guard<std::mutex> lk (this->updates_mutex);
+                    this->queued_models.push_back (std::move (model));
+                }
+                this->schedule_paint();
+            }
+
+            /*!
+             * Rebuild the model model_ptrs[model_idx] at the next paint. Any number of models
+             * may be marked between paints; a model marked several times is rebuilt once. May be
+             * called from any thread.
+             */
+            void set_model_needs_reinit (int model_idx, bool reinit_required = true)
+            {
+                {
+                    std::lock_guard<std::mutex> lk (this->updates_mutex);
+                    if (reinit_required) {
+                        this->dirty_models.insert (model_idx);
+                    } else {
+                        this->dirty_models.erase (model_idx);
+                    }
+                }
+                if (reinit_required) { this->schedule_paint(); }
+            }
+
+        protected:
+            //! Ask for paintGL to be called soon. Called from any thread.
+            virtual void schedule_paint() = 0;
+
+            /*!
+             * Add new models to the Visual v and rebuild the marked ones, within
+             * frame_budget_ms. Call at the start of paintGL, with the context current. Returns
+             * true if there is work left, so that another frame should be painted.
+             */
+            template <typename V>
+            bool apply_updates (V& v)
+            {
+                using sc = std::chrono::steady_clock;
+                const sc::time_point t0 = sc::now();
+                bool worked = false;
+                auto over_budget = [this, t0, &worked]() {
+                    return worked && this->frame_budget_ms > 0.0
+                    && std::chrono::duration<double, std::milli>(sc::now() - t0).count() > this->frame_budget_ms;
+                };
+
+                std::set<int> dirty;
+                {
+                    std::lock_guard<std::mutex> lk (this->updates_mutex);
+                    for (auto& m : this->queued_models) { this->newvisualmodels.push_back (std::move (m)); }
+                    this->queued_models.clear();
+                    dirty.swap (this->dirty_models);
+                }
+                if (this->needs_reinit > -1) {
+                    dirty.insert (this->needs_reinit);
+                    this->needs_reinit = -1;
+                }
+
+                // New models, in the order they were given
+                std::size_t n_added = 0;
+                for (; n_added < this->newvisualmodels.size() && !over_budget(); ++n_added) {
+                    if (this->async_builds) {
+                        morph::VisualModel<glver>* mp = v.addVisualModel (this->newvisualmodels[n_added]);
+                        mp->reinit_async();
+                        this->model_ptrs.push_back (mp);
+                    } else {
+                        this->newvisualmodels[n_added]->finalize();
+                        this->model_ptrs.push_back (v.addVisualModel (this->newvisualmodels[n_added]));
+                        worked = true;
+                    }
+                }
+                this->newvisualmodels.erase (this->newvisualmodels.begin(), this->newvisualmodels.begin() + n_added);
+
+                // Rebuilds. A model that hasn't been added yet will be built from its current data anyway.
+                for (auto it = dirty.begin(); it != dirty.end() && !over_budget();) {
+                    if (*it < 0 || static_cast<std::size_t>(*it) >= this->model_ptrs.size()) { it = dirty.erase (it); continue; }
+                    morph::VisualModel<glver>* mp = this->model_ptrs[*it];
+                    // A model whose last build is yet to be uploaded is rebuilt after the upload
+                    if (mp->build_pending()) { ++it; continue; }
+                    if (this->async_builds) {
+                        mp->reinit_async();
+                    } else {
+                        mp->reinit();
+                        worked = true;
+                    }
+                    it = dirty.erase (it);
+                }
+                if (!dirty.empty()) {
+                    std::lock_guard<std::mutex> lk (this->updates_mutex);
+                    this->dirty_models.insert (dirty.begin(), dirty.end());
+                }
+
+                v.upload_budget_ms = this->frame_budget_ms;
+                return !this->newvisualmodels.empty() || !dirty.empty() || v.builds_pending();
+            }
+
+        private:
+            std::mutex updates_mutex;
+            // Models from add_visual_model() and indices from set_model_needs_reinit(), under updates_mutex
+            std::vector<std::unique_ptr<morph::VisualModel<glver>>> queued_models;
+            std::set<int> dirty_models;
+        };
+
+    } // qt
+} // morph
@@ -15,6 +15,7 @@ namespace morph { using win_t = QOpenGLWidget; }
 #include <morph/VisualOwnable.h>
 // We need to be able to convert from Qt keycodes to morph keycodes
 #include <morph/qt/keycodes.h>
+#include <morph/qt/model_updates.h>
 
 namespace morph {
     namespace qt {
@@ -23,22 +24,14 @@ namespace morph {
         constexpr int gl_version = morph::gl::version_4_1;
 
         // A morph::VisualOwnable-based widget
-        struct viswidget : public QOpenGLWidget, protected QOpenGLFunctions_4_1_Core
+        struct viswidget : public QOpenGLWidget, protected QOpenGLFunctions_4_1_Core, public morph::qt::model_updates<gl_version>
         {
             // Unlike the GLFW or morph-in-a-QWindow schemes, we hold the morph::VisualOwnable
             // inside the widget.
             morph::VisualOwnable<gl_version> v;
 
-            // In your Qt code, build VisualModels that should be added to the scene and add them to this.
-            std::vector<std::unique_ptr<morph::VisualModel<gl_version>>> newvisualmodels;
-            std::vector<morph::VisualModel<gl_version>*> model_ptrs;
-
-            // if >-1, then that model needs a reinit.
-            int needs_reinit = -1;
-            void set_model_needs_reinit (int model_idx, bool reinit_required = true)
-            {
-                this->needs_reinit = reinit_required ? model_idx : -1;
-            }
+            // newvisualmodels, model_ptrs, add_visual_model() and set_model_needs_reinit() come
+            // from morph::qt::model_updates.
 
             viswidget (QWidget* parent = 0) : QOpenGLWidget(parent)
             {
@@ -76,21 +69,16 @@ namespace morph {
 
             void paintGL() override
             {
-                if (!this->newvisualmodels.empty()) {
-                    // Now we iterate through newvisualmodels, finalize them and add them to morph::Visual
-                    for (unsigned int i = 0; i < newvisualmodels.size(); ++i) {
-                        this->newvisualmodels[i]->finalize();
-                        this->model_ptrs.push_back (this->v.addVisualModel (this->newvisualmodels[i]));
-                    }
-                    this->newvisualmodels.clear();
-                }
-                if (this->needs_reinit > -1) {
-                    this->model_ptrs[this->needs_reinit]->reinit();
-                    this->needs_reinit = -1;
-                }
+                // Add new models and rebuild changed ones, as much as fits in frame_budget_ms
+                const bool more = this->apply_updates (this->v);
                 v.render();
+                // Come back for the rest, and to upload asynchronous builds as they finish
+                if (more) { this->update(); }
             }
 
+            // Thread-safe: update() is called on the GUI thread
+            void schedule_paint() override { QMetaObject::invokeMethod (this, "update", Qt::QueuedConnection); }
+
             void mousePressEvent (QMouseEvent* event) override
             {
                 v.set_cursorpos (event->x(), event->y());
@@ -0,0 +1,248 @@
+/*!
+ * \file
+ * \brief Watching the scene of a (headless) morph::Visual from another process or machine.
+ *
+ * A remote_sender publishes the models of a Visual over TCP, using morph::scene_stream: each
+ * viewer is sent a model's mesh once, and after that only what has changed, which for most
+ * simulations is the vertex colours. A remote_receiver, in the viewer, connects to it and keeps
+ * one remote_model in its own Visual for each model of the sender's scene. The viewer renders
+ * locally, so it can be rotated and zoomed without the simulation drawing anything.
+ *
+ * What is sent of each model is its triangles, vertex colours, view matrix, model scaling,
+ * alpha, visibility and labels. Instanced models, models whose vertices gpu_resident has freed
+ * and models not yet built (see VisualModel::lazy_finalize) are not sent, and the scene's own
+ * labels (Visual::addLabel) are not sent. Colours that look up a data texture (see
+ * VisualModel::data_tex) arrive as the texture coordinates they hold.
+ */
+
+#pragma once
+
+#include <morph/scene_stream.h>
+#include <morph/VisualModel.h>
+#include <morph/VisualOwnable.h>
+#include <morph/TextFeatures.h>
+#include <morph/unicode.h>
+#include <morph/quaternion.h>
+#include <morph/vec.h>
+#include <morph/mat44.h>
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace morph {
+
+#if defined(__unix__) || defined(__APPLE__)
+    /*!
+     * Publishes the scene of a Visual to remote viewers. Call publish() once per frame (or as
+     * often as the viewers should be updated), after the models have been updated.
+     */
+    template <int glver = morph::gl::version_4_1>
+    struct remote_sender
+    {
+        //! Listen for viewers on port of bind_address (use "0.0.0.0" to accept viewers from other machines)
+        remote_sender (const unsigned short port, const std::string& bind_address = "127.0.0.1")
+            : srv (port, bind_address) {}
+
+        //! Send what has changed in v's scene to each viewer. Copies nothing while no viewer is connected.
+        void publish (morph::VisualOwnable<glver>& v)
+        {
+            this->srv.accept();
+            if (this->srv.clients() == 0) { return; }
+            scene_stream::frame f;
+            std::set<const morph::VisualModel<glver>*> present;
+            for (unsigned int i = 0; i < v.numVisualModels(); ++i) {
+                const morph::VisualModel<glver>* m = v.getVisualModel (i);
+                if (m->instanced) { continue; }
+                auto [ci, fresh] = this->models.try_emplace (m);
+                copied& c = ci->second;
+                if (fresh) { c.id = ++this->last_id; }
+                // A model being built, or with freed vertices, keeps the copy last made of it
+                const bool readable = !m->build_running() && !m->vertices_released() && !m->build_deferred_until_shown();
+                const std::uint64_t rev = m->render_revision();
+                if (readable && (!c.valid || rev != c.revision)) {
+                    this->copy (*m, c.state);
+                    c.revision = rev;
+                    c.valid = true;
+                }
+                if (!c.valid) { continue; }
+                present.insert (m);
+                f.add (c.id, c.state);
+            }
+            for (auto mi = this->models.begin(); mi != this->models.end();) {
+                mi = present.count (mi->first) == 0 ? this->models.erase (mi) : std::next (mi);
+            }
+            const morph::vec<float, 3>& t = v.getSceneTrans();
+            const morph::quaternion<float>& r = v.getSceneRotation();
+            f.view.trans = { t[0], t[1], t[2] };
+            f.view.rotation = { r.w, r.x, r.y, r.z };
+            f.view.bgcolour = v.bgcolour;
+            this->srv.publish (f);
+        }
+
+        //! The number of connected viewers
+        std::size_t viewers() const { return this->srv.clients(); }
+
+        //! The port listened on
+        unsigned short port() const { return this->srv.port(); }
+
+    private:
+        static void copy (const morph::VisualModel<glver>& m, scene_stream::model_state& s)
+        {
+            s.indices.assign (m.get_indices().begin(), m.get_indices().end());
+            s.positions = m.get_positions();
+            s.normals = m.get_normals();
+            s.colours = m.get_colours();
+            s.viewmatrix = m.getViewMatrix().mat;
+            s.model_scaling = m.get_model_scaling().mat;
+            s.alpha = m.getAlpha();
+            s.hide = m.hidden();
+            s.labels.clear();
+            for (const auto& t : m.get_texts()) {
+                scene_stream::label l;
+                l.text = t->get_text();
+                const morph::vec<float>& o = t->get_offset();
+                l.offset = { o[0], o[1], o[2] };
+                const morph::TextFeatures& tf = t->get_features();
+                l.fontsize = tf.fontsize;
+                l.fontres = tf.fontres;
+                l.colour = tf.colour;
+                l.font = static_cast<std::int32_t>(tf.font);
+                s.labels.push_back (l);
+            }
+        }
+
+        struct copied
+        {
+            std::uint32_t id = 0;
+            std::uint64_t revision = 0;
+            bool valid = false;
+            scene_stream::model_state state;
+        };
+
+        scene_stream::server srv;
+        std::map<const morph::VisualModel<glver>*, copied> models;
+        std::uint32_t last_id = 0;
+    };
+#endif
+
+    //! A model drawn from a scene_stream::model_state, which it holds a pointer to
+    template <int glver = morph::gl::version_4_1>
+    class remote_model : public VisualModel<glver>
+    {
+    public:
+        remote_model (const scene_stream::model_state* _state) : state(_state) {}
+
+        void initializeVertices()
+        {
+            this->indices.assign (this->state->indices.begin(), this->state->indices.end());
+            this->vertexPositions = this->state->positions;
+            this->vertexNormals = this->state->normals;
+            this->vertexColors = this->state->colours;
+        }
+
+        //! Upload the state's colours, which have changed
+        void update_colours()
+        {
+            this->vertexColors = this->state->colours;
+            this->reinit_colour_buffer();
+        }
+
+        //! Take the state's matrices, alpha and visibility
+        void update_state()
+        {
+            this->viewmatrix.mat = this->state->viewmatrix;
+            this->model_scaling.mat = this->state->model_scaling;
+            this->alpha = this->state->alpha;
+            this->hide = this->state->hide;
+        }
+
+        //! Replace the labels with the state's
+        void update_labels()
+        {
+            this->clearTexts();
+            for (const scene_stream::label& l : this->state->labels) {
+                std::string u8;
+                for (const char32_t c : l.text) { morph::unicode::append (u8, c); }
+                morph::TextFeatures tf (l.fontsize, static_cast<int>(l.fontres), false, l.colour, static_cast<morph::VisualFont>(l.font));
+                this->addLabel (u8, { l.offset[0], l.offset[1], l.offset[2] }, tf);
+            }
+        }
+
+    private:
+        const scene_stream::model_state* state;
+    };
+
+#if defined(__unix__) || defined(__APPLE__)
+    /*!
+     * Shows the scene of a remote_sender in a local Visual. Call update() in the render loop,
+     * in place of (or before) waiting for events.
+     */
+    template <int glver = morph::gl::version_4_1>
+    struct remote_receiver
+    {
+        remote_receiver (const std::string& host, const unsigned short port) : cli (host, port) {}
+
+        //! If true, the scene view follows the sender's whenever it changes
+        bool follow_view = true;
+
+        /*!
+         * Apply what has arrived to the models of v, waiting up to timeout_ms for it. Returns
+         * true if the scene changed. V is morph::Visual (or another VisualOwnable with bindmodel()).
+         */
+        template <typename V>
+        bool update (V& v, const int timeout_ms = 0)
+        {
+            const std::vector<scene_stream::change> changes = this->cli.poll (timeout_ms);
+            const scene_stream::scene& s = this->cli.state();
+            for (const scene_stream::change& c : changes) {
+                if (c.type == scene_stream::message::scene) {
+                    if (this->follow_view) {
+                        v.setSceneTrans (morph::vec<float, 3>{ s.view.trans[0], s.view.trans[1], s.view.trans[2] });
+                        const auto& r = s.view.rotation;
+                        v.setSceneRotation (morph::quaternion<float>(r[0], r[1], r[2], r[3]));
+                    }
+                    v.bgcolour = s.view.bgcolour;
+                    continue;
+                }
+                auto mi = this->models.find (c.id);
+                auto si = s.models.find (c.id);
+                if (c.type == scene_stream::message::remove || si == s.models.end()) {
+                    if (mi != this->models.end()) {
+                        v.removeVisualModel (mi->second);
+                        this->models.erase (mi);
+                    }
+                    continue;
+                }
+                if (mi == this->models.end()) {
+                    // A new model is built from all of its state, whatever the message was
+                    auto rm = std::make_unique<morph::remote_model<glver>>(&si->second);
+                    v.bindmodel (rm);
+                    rm->update_state();
+                    rm->finalize();
+                    rm->update_labels();
+                    this->models[c.id] = v.addVisualModel (rm);
+                    continue;
+                }
+                switch (c.type) {
+                case scene_stream::message::geometry: { mi->second->reinit(); break; }
+                case scene_stream::message::colours: { mi->second->update_colours(); break; }
+                case scene_stream::message::state: { mi->second->update_state(); break; }
+                case scene_stream::message::labels: { mi->second->update_labels(); break; }
+                default: { break; }
+                }
+            }
+            return !changes.empty();
+        }
+
+        //! False once the sender has gone
+        bool connected() const { return this->cli.connected(); }
+
+    private:
+        scene_stream::client cli;
+        std::map<std::uint32_t, morph::remote_model<glver>*> models;
+    };
+#endif
+
+} // namespace morph
@@ -0,0 +1,303 @@
+/*!
+ * \file
+ *
+ * Time integrators for systems of fields, such as the state vectors of an RD_Base model.
+ * The fields are registered once with add_field(); the stage buffers are allocated on the
+ * first step and reused for every step after that.
+ *
+ * Each integrator takes a derivative function with the signature
+ *
+ * \code
+ * void f (Flt t, const morph::rk_integrator<Flt>::state& y, morph::rk_integrator<Flt>::derivs& dydt);
+ * \endcode
+ *
+ * which writes into dydt[i] the time derivative of field i, evaluated at the state in which
+ * field i holds *y[i]. y points either at the registered fields themselves or at a stage
+ * buffer; f must not assume which.
+ *
+ * rk4() is the classical fixed step 4th order Runge-Kutta method. rk45() is the
+ * Dormand-Prince 5(4) embedded pair with error control, which chooses the step size to
+ * meet a tolerance. imex() is a Strang splitting which treats diffusion implicitly (with a
+ * diffusion_cg or diffusion_multigrid solver) and the rest of the derivative with rk4(), so
+ * that the step size is not limited by the diffusive CFL condition. The backward Euler
+ * diffusion steps are only first order accurate, but they damp the stiff, short wavelength
+ * modes at any step size rather than letting them oscillate.
+ */
+
+#pragma once
+
+#include <morph/memory_usage.h>
+#include <morph/numa.h>
+#include <vector>
+#include <array>
+#include <initializer_list>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace morph {
+
+    template <typename Flt>
+    class rk_integrator
+    {
+    public:
+        //! The state passed to a derivative function: one pointer per registered field
+        using state = std::vector<const std::vector<Flt>*>;
+        //! The derivatives of each of the registered fields
+        using derivs = std::vector<std::vector<Flt>>;
+
+        /*!
+         * Register a field to be integrated and return its index in the state. Only a
+         * reference is kept, so v must outlive the integrator (or clear_fields() must be
+         * called). The fields may have different sizes, but must not change size between
+         * steps.
+         */
+        std::size_t add_field (std::vector<Flt>& v)
+        {
+            this->fields.push_back (&v);
+            return this->fields.size() - 1;
+        }
+
+        //! Forget the registered fields
+        void clear_fields() { this->fields.clear(); }
+
+        //! The number of registered fields
+        std::size_t num_fields() const { return this->fields.size(); }
+
+        //! The memory held by the stage buffers (the registered fields belong to their owner)
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("rk_integrator");
+            mu.add ("k", this->k);
+            mu.add ("ytmp", this->ytmp);
+            mu.cpu = morph::heap_bytes (this->fields) + morph::heap_bytes (this->yf) + morph::heap_bytes (this->yt);
+            return mu;
+        }
+
+        //! The simulation time, advanced by each step
+        Flt t = Flt{0};
+
+        //! How the stage buffers are placed in memory when they are first allocated (see morph::numa)
+        morph::numa::policy memory_policy = morph::numa::policy::first_touch;
+
+        /*
+         * Error control for rk45(). A step is accepted if the RMS over all elements of
+         * err / (atol + rtol * |y|) is no more than 1.
+         */
+        Flt atol = Flt{1e-6};
+        Flt rtol = Flt{1e-4};
+        //! The factor by which the step size is kept below its estimated optimum
+        Flt safety = Flt{0.9};
+        //! The limits on the step size that rk45() may choose. It throws if it needs a smaller step than dt_min.
+        Flt dt_min = Flt{0};
+        Flt dt_max = std::numeric_limits<Flt>::max();
+
+        //! Counts of the steps accepted and rejected by rk45() and of all derivative evaluations
+        unsigned long long accepted = 0;
+        unsigned long long rejected = 0;
+        unsigned long long evaluations = 0;
+
+        //! Take one classical 4th order Runge-Kutta step of size dt
+        template <typename F>
+        void rk4 (F&& f, const Flt dt)
+        {
+            this->ensure_buffers (4);
+            const Flt h = dt / Flt{2};
+            this->evaluate (f, this->t, this->yf, this->k[0]);
+            this->combine (this->ytmp, h, { Flt{1} });
+            this->evaluate (f, this->t + h, this->yt, this->k[1]);
+            this->combine (this->ytmp, h, { Flt{0}, Flt{1} });
+            this->evaluate (f, this->t + h, this->yt, this->k[2]);
+            this->combine (this->ytmp, dt, { Flt{0}, Flt{0}, Flt{1} });
+            this->evaluate (f, this->t + dt, this->yt, this->k[3]);
+            this->combine_into_fields (dt / Flt{6}, { Flt{1}, Flt{2}, Flt{2}, Flt{1} });
+            this->t += dt;
+        }
+
+        /*!
+         * Take one step of the Dormand-Prince 5(4) method, starting with a step of size dt
+         * and shrinking it until the error estimate meets the tolerance. On return, dt
+         * holds the suggested size of the next step. Returns the size of the step taken.
+         */
+        template <typename F>
+        Flt rk45 (F&& f, Flt& dt)
+        {
+            this->ensure_buffers (7);
+            // The Butcher tableau; row s holds the coefficients of stage s
+            static constexpr double c[7] = { 0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0 };
+            static constexpr double a[6][6] = {
+                { 1.0 / 5.0 },
+                { 3.0 / 40.0, 9.0 / 40.0 },
+                { 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0 },
+                { 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0 },
+                { 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0 },
+                { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 }
+            };
+            // The 5th order weights less the embedded 4th order weights
+            static constexpr double e[7] = { 71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0,
+                                             -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0 };
+
+            this->evaluate (f, this->t, this->yf, this->k[0]);
+            for (;;) {
+                for (unsigned int s = 1; s < 7; ++s) {
+                    std::array<Flt, 7> w{};
+                    for (unsigned int j = 0; j < s; ++j) { w[j] = static_cast<Flt>(a[s - 1][j]); }
+                    this->combine (this->ytmp, dt, w, s);
+                    this->evaluate (f, this->t + static_cast<Flt>(c[s]) * dt, this->yt, this->k[s]);
+                }
+                // ytmp now holds the 5th order solution and k[6] its derivative
+                std::array<Flt, 7> we{};
+                for (unsigned int j = 0; j < 7; ++j) { we[j] = static_cast<Flt>(e[j]); }
+                const double err = this->error_norm (dt, we);
+                if (err <= 1.0) {
+                    for (std::size_t fi = 0; fi < this->fields.size(); ++fi) {
+                        std::copy (this->ytmp[fi].begin(), this->ytmp[fi].end(), this->fields[fi]->begin());
+                    }
+                    this->t += dt;
+                    const Flt taken = dt;
+                    const double grow = err > 0.0 ? static_cast<double>(this->safety) * std::pow (err, -0.2) : 5.0;
+                    dt = std::min (dt * static_cast<Flt>(std::clamp (grow, 0.2, 5.0)), this->dt_max);
+                    ++this->accepted;
+                    return taken;
+                }
+                ++this->rejected;
+                const double shrink = static_cast<double>(this->safety) * std::pow (err, -0.25);
+                dt *= static_cast<Flt>(std::max (shrink, 0.2));
+                if (!(dt > this->dt_min)) {
+                    throw std::runtime_error ("rk_integrator::rk45: the step size fell below dt_min");
+                }
+            }
+        }
+
+        /*!
+         * Take one step of size dt of the Strang splitting: half a step of implicit diffusion,
+         * a full rk4() step of f (which should leave out the diffusion term), then another half
+         * step of diffusion. Field i diffuses with coefficient D[i] (0 for a field that does not
+         * diffuse) by solver.diffuse(), the interface of morph::diffusion_cg and
+         * morph::diffusion_multigrid, which takes a backward Euler step.
+         */
+        template <typename F, typename S>
+        void imex (F&& f, S& solver, const std::vector<Flt>& D, const Flt dt)
+        {
+            if (D.size() != this->fields.size()) {
+                throw std::runtime_error ("rk_integrator::imex: need one diffusion coefficient per field");
+            }
+            const Flt h = dt / Flt{2};
+            for (std::size_t fi = 0; fi < this->fields.size(); ++fi) {
+                if (D[fi] != Flt{0}) { solver.diffuse (*this->fields[fi], D[fi], h); }
+            }
+            this->rk4 (f, dt);
+            for (std::size_t fi = 0; fi < this->fields.size(); ++fi) {
+                if (D[fi] != Flt{0}) { solver.diffuse (*this->fields[fi], D[fi], h); }
+            }
+        }
+
+    protected:
+        //! The registered fields
+        std::vector<std::vector<Flt>*> fields;
+        //! The stage derivatives
+        std::vector<derivs> k;
+        //! The state at which a stage is evaluated
+        derivs ytmp;
+        //! Pointers to the fields and to ytmp, to pass to the derivative function
+        state yf;
+        state yt;
+
+        //! Size the stage buffers to match the fields, allocating only on a change
+        void ensure_buffers (const std::size_t nstages)
+        {
+            if (this->fields.empty()) { throw std::runtime_error ("rk_integrator: no fields have been registered"); }
+            if (this->k.size() < nstages) { this->k.resize (nstages); }
+            const std::size_t nf = this->fields.size();
+            this->ytmp.resize (nf);
+            this->yf.resize (nf);
+            this->yt.resize (nf);
+            for (auto& ks : this->k) { ks.resize (nf); }
+            for (std::size_t fi = 0; fi < nf; ++fi) {
+                const std::size_t n = this->fields[fi]->size();
+                morph::numa::resize (this->ytmp[fi], n, Flt{0}, this->memory_policy);
+                for (auto& ks : this->k) { morph::numa::resize (ks[fi], n, Flt{0}, this->memory_policy); }
+                this->yf[fi] = this->fields[fi];
+                this->yt[fi] = &this->ytmp[fi];
+            }
+        }
+
+        template <typename F>
+        void evaluate (F& f, const Flt ts, const state& y, derivs& dydt)
+        {
+            f (ts, y, dydt);
+            ++this->evaluations;
+        }
+
+        //! dst = y + dt * sum over the first nk stages of w[j] k[j]
+        template <std::size_t N>
+        void combine (derivs& dst, const Flt dt, const std::array<Flt, N>& w, const std::size_t nk = N)
+        {
+            for (std::size_t fi = 0; fi < this->fields.size(); ++fi) {
+                const Flt* y = this->fields[fi]->data();
+                Flt* d = dst[fi].data();
+                const long long n = static_cast<long long>(dst[fi].size());
+                std::array<const Flt*, N> kp{};
+                for (std::size_t j = 0; j < nk; ++j) { kp[j] = this->k[j][fi].data(); }
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < n; ++i) {
+                    Flt s = Flt{0};
+                    for (std::size_t j = 0; j < nk; ++j) { s += w[j] * kp[j][i]; }
+                    d[i] = y[i] + dt * s;
+                }
+            }
+        }
+        void combine (derivs& dst, const Flt dt, const std::initializer_list<Flt> w)
+        {
+            std::array<Flt, 4> wa{};
+            std::copy (w.begin(), w.end(), wa.begin());
+            this->combine (dst, dt, wa, w.size());
+        }
+
+        //! y += dt * sum of w[j] k[j], in place in the registered fields
+        void combine_into_fields (const Flt dt, const std::array<Flt, 4>& w)
+        {
+            for (std::size_t fi = 0; fi < this->fields.size(); ++fi) {
+                Flt* y = this->fields[fi]->data();
+                const Flt* k0 = this->k[0][fi].data();
+                const Flt* k1 = this->k[1][fi].data();
+                const Flt* k2 = this->k[2][fi].data();
+                const Flt* k3 = this->k[3][fi].data();
+                const long long n = static_cast<long long>(this->fields[fi]->size());
+#pragma omp parallel for schedule(static)
+                for (long long i = 0; i < n; ++i) {
+                    y[i] += dt * (w[0] * k0[i] + w[1] * k1[i] + w[2] * k2[i] + w[3] * k3[i]);
+                }
+            }
+        }
+
+        //! The RMS over all elements of the scaled error estimate dt * sum of w[j] k[j]
+        double error_norm (const Flt dt, const std::array<Flt, 7>& w)
+        {
+            double ss = 0.0;
+            std::size_t count = 0;
+            for (std::size_t fi = 0; fi < this->fields.size(); ++fi) {
+                const Flt* y = this->fields[fi]->data();
+                const Flt* yn = this->ytmp[fi].data();
+                std::array<const Flt*, 7> kp{};
+                for (std::size_t j = 0; j < 7; ++j) { kp[j] = this->k[j][fi].data(); }
+                const long long n = static_cast<long long>(this->ytmp[fi].size());
+                const Flt at = this->atol;
+                const Flt rt = this->rtol;
+#pragma omp parallel for reduction(+:ss) schedule(static)
+                for (long long i = 0; i < n; ++i) {
+                    Flt s = Flt{0};
+                    for (std::size_t j = 0; j < 7; ++j) { s += w[j] * kp[j][i]; }
+                    const double sc = static_cast<double>(at + rt * std::max (std::abs (y[i]), std::abs (yn[i])));
+                    const double ei = static_cast<double>(dt * s) / sc;
+                    ss += ei * ei;
+                }
+                count += static_cast<std::size_t>(n);
+            }
+            return count != 0 ? std::sqrt (ss / static_cast<double>(count)) : 0.0;
+        }
+    };
+
+} // namespace morph
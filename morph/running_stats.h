@@ -0,0 +1,465 @@
+/*!
+ * \file
+ * \brief One pass, mergeable statistics accumulators
+ *
+ * These accumulate statistics of a stream of values without keeping the values, so that, for
+ * example, the time averaged statistics of a reaction-diffusion field can be gathered step by
+ * step without storing its history:
+ *
+ *\code{.cpp}
+ * morph::running_field_stats<float> st;
+ * for (unsigned int t = 0; t < steps; ++t) {
+ *     rd.step();
+ *     st.add (rd.a[0]); // per element mean, variance, min and max over time
+ * }
+ * morph::vvec<float> a_mean = st.mean();
+ *\endcode
+ *
+ * Each accumulator (bar p2_quantile) can be merged with another of the same kind with
+ * operator+=, giving the statistics of the combined data, so that separate threads or
+ * processes can each accumulate a part of the data.
+ *
+ * running_stats      Count, mean, variance, min and max (Welford's algorithm)
+ * running_moments    As running_stats, plus the third and fourth moments (skewness, kurtosis)
+ * running_covariance Means, variances and covariance of pairs (x, y), and the regression line
+ * running_field_stats Element-wise running_stats of a sequence of equally sized fields
+ * p2_quantile        An estimate of one quantile, by the P^2 algorithm of Jain & Chlamtac (1985)
+ *
+ * The merges use the pairwise formulae of Chan, Golub & LeVeque (1979) and Pebay (2008).
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace morph {
+
+    /*!
+     * Running count, mean, variance, min and max of a stream of values, by Welford's algorithm,
+     * which is numerically stable where the sum-of-squares method is not.
+     *
+     * \tparam T A floating point type
+     */
+    template <typename T>
+    struct running_stats
+    {
+        static_assert (std::is_floating_point_v<T>, "running_stats: T must be a floating point type");
+
+        //! Add one value
+        void add (const T x)
+        {
+            ++this->n;
+            const T d = x - this->_mean;
+            this->_mean += d / static_cast<T>(this->n);
+            this->m2 += d * (x - this->_mean);
+            this->_min = std::min (this->_min, x);
+            this->_max = std::max (this->_max, x);
+        }
+
+        //! Add each value from a container
+        template <typename C>
+        void add_all (const C& c) { for (const auto& x : c) { this->add (static_cast<T>(x)); } }
+
+        //! Merge in the statistics another accumulator has gathered
+        running_stats& operator+= (const running_stats& o)
+        {
+            if (o.n == 0) { return *this; }
+            if (this->n == 0) { *this = o; return *this; }
+            const T na = static_cast<T>(this->n);
+            const T nb = static_cast<T>(o.n);
+            const T nn = na + nb;
+            const T d = o._mean - this->_mean;
+            this->_mean += d * nb / nn;
+            this->m2 += o.m2 + d * d * na * nb / nn;
+            this->n += o.n;
+            this->_min = std::min (this->_min, o._min);
+            this->_max = std::max (this->_max, o._max);
+            return *this;
+        }
+
+        void reset() { *this = running_stats<T>{}; }
+
+        std::size_t count() const { return this->n; }
+        T mean() const { return this->_mean; }
+        //! The sample variance (dividing by n - 1, as vvec::variance does)
+        T variance() const { return this->n > 1 ? this->m2 / static_cast<T>(this->n - 1) : T{0}; }
+        //! The population variance (dividing by n)
+        T variance_population() const { return this->n > 0 ? this->m2 / static_cast<T>(this->n) : T{0}; }
+        T std() const { return std::sqrt (this->variance()); }
+        //! The smallest and largest values added. (max, lowest) if none have been.
+        T min() const { return this->_min; }
+        T max() const { return this->_max; }
+        //! The sum of the values
+        T sum() const { return this->_mean * static_cast<T>(this->n); }
+
+    protected:
+        template <typename> friend struct running_field_stats;
+
+        std::size_t n = 0;
+        T _mean = T{0};
+        T m2 = T{0}; // The sum of squared deviations from the mean
+        T _min = std::numeric_limits<T>::max();
+        T _max = std::numeric_limits<T>::lowest();
+    };
+
+    /*!
+     * running_stats with the third and fourth central moments too, for skewness and kurtosis
+     * (the single value updates of Terriberry, the merges of Pebay).
+     */
+    template <typename T>
+    struct running_moments : public running_stats<T>
+    {
+        void add (const T x)
+        {
+            const T n1 = static_cast<T>(this->n);
+            ++this->n;
+            const T nn = static_cast<T>(this->n);
+            const T d = x - this->_mean;
+            const T dn = d / nn;
+            const T dn2 = dn * dn;
+            const T t1 = d * dn * n1;
+            this->_mean += dn;
+            this->m4 += t1 * dn2 * (nn * nn - T{3} * nn + T{3}) + T{6} * dn2 * this->m2 - T{4} * dn * this->m3;
+            this->m3 += t1 * dn * (nn - T{2}) - T{3} * dn * this->m2;
+            this->m2 += t1;
+            this->_min = std::min (this->_min, x);
+            this->_max = std::max (this->_max, x);
+        }
+
+        template <typename C>
+        void add_all (const C& c) { for (const auto& x : c) { this->add (static_cast<T>(x)); } }
+
+        running_moments& operator+= (const running_moments& o)
+        {
+            if (o.n == 0) { return *this; }
+            if (this->n == 0) { *this = o; return *this; }
+            const T na = static_cast<T>(this->n);
+            const T nb = static_cast<T>(o.n);
+            const T nn = na + nb;
+            const T d = o._mean - this->_mean;
+            const T d2 = d * d;
+            const T m2a = this->m2;
+            const T m3a = this->m3;
+            this->m4 += o.m4 + d2 * d2 * na * nb * (na * na - na * nb + nb * nb) / (nn * nn * nn)
+                        + T{6} * d2 * (na * na * o.m2 + nb * nb * m2a) / (nn * nn)
+                        + T{4} * d * (na * o.m3 - nb * m3a) / nn;
+            this->m3 += o.m3 + d2 * d * na * nb * (na - nb) / (nn * nn) + T{3} * d * (na * o.m2 - nb * m2a) / nn;
+            this->running_stats<T>::operator+= (o); // n, mean, m2, min and max
+            return *this;
+        }
+
+        void reset() { *this = running_moments<T>{}; }
+
+        //! The (population) skewness, m3 / m2^(3/2) of the central moments
+        T skewness() const
+        {
+            if (this->m2 == T{0}) { return T{0}; }
+            return std::sqrt (static_cast<T>(this->n)) * this->m3 / std::pow (this->m2, T{1.5});
+        }
+        //! The excess kurtosis, m4 / m2^2 - 3, which is 0 for a normal distribution
+        T kurtosis() const
+        {
+            if (this->m2 == T{0}) { return T{0}; }
+            return static_cast<T>(this->n) * this->m4 / (this->m2 * this->m2) - T{3};
+        }
+
+    protected:
+        T m3 = T{0};
+        T m4 = T{0};
+    };
+
+    /*!
+     * Running means, variances and covariance of pairs of values (x, y), and the least squares
+     * line through them, which is what MathAlgo::linregr finds from whole containers.
+     */
+    template <typename T>
+    struct running_covariance
+    {
+        static_assert (std::is_floating_point_v<T>, "running_covariance: T must be a floating point type");
+
+        void add (const T x, const T y)
+        {
+            ++this->n;
+            const T nn = static_cast<T>(this->n);
+            const T dx = x - this->mx;
+            const T dy = y - this->my;
+            this->mx += dx / nn;
+            this->my += dy / nn;
+            this->cxy += dx * (y - this->my);
+            this->m2x += dx * (x - this->mx);
+            this->m2y += dy * (y - this->my);
+        }
+
+        //! Add pairs from two containers of the same size
+        template <typename C>
+        void add_all (const C& x, const C& y)
+        {
+            if (x.size() != y.size()) { throw std::runtime_error ("running_covariance::add_all: x and y differ in size"); }
+            auto yi = y.begin();
+            for (const auto& xi : x) { this->add (static_cast<T>(xi), static_cast<T>(*yi++)); }
+        }
+
+        running_covariance& operator+= (const running_covariance& o)
+        {
+            if (o.n == 0) { return *this; }
+            if (this->n == 0) { *this = o; return *this; }
+            const T na = static_cast<T>(this->n);
+            const T nb = static_cast<T>(o.n);
+            const T nn = na + nb;
+            const T dx = o.mx - this->mx;
+            const T dy = o.my - this->my;
+            const T f = na * nb / nn;
+            this->cxy += o.cxy + dx * dy * f;
+            this->m2x += o.m2x + dx * dx * f;
+            this->m2y += o.m2y + dy * dy * f;
+            this->mx += dx * nb / nn;
+            this->my += dy * nb / nn;
+            this->n += o.n;
+            return *this;
+        }
+
+        void reset() { *this = running_covariance<T>{}; }
+
+        std::size_t count() const { return this->n; }
+        T mean_x() const { return this->mx; }
+        T mean_y() const { return this->my; }
+        //! Sample variances and covariance (dividing by n - 1)
+        T variance_x() const { return this->n > 1 ? this->m2x / static_cast<T>(this->n - 1) : T{0}; }
+        T variance_y() const { return this->n > 1 ? this->m2y / static_cast<T>(this->n - 1) : T{0}; }
+        T covariance() const { return this->n > 1 ? this->cxy / static_cast<T>(this->n - 1) : T{0}; }
+        //! Pearson's correlation coefficient
+        T correlation() const
+        {
+            const T d = std::sqrt (this->m2x * this->m2y);
+            return d > T{0} ? this->cxy / d : T{0};
+        }
+        //! The least squares line y = mx + c, returned as (m, c), like MathAlgo::linregr
+        morph::vec<T, 2> linregr() const
+        {
+            const T m = this->m2x > T{0} ? this->cxy / this->m2x : T{0};
+            return morph::vec<T, 2>{ m, this->my - m * this->mx };
+        }
+
+    private:
+        std::size_t n = 0;
+        T mx = T{0};
+        T my = T{0};
+        T m2x = T{0};
+        T m2y = T{0};
+        T cxy = T{0};
+    };
+
+    /*!
+     * Element-wise running_stats of a sequence of fields (vvecs) of equal size: the mean,
+     * variance, min and max of each element over the fields added. Each add() is a single
+     * vectorisable pass over the field.
+     */
+    template <typename T>
+    struct running_field_stats
+    {
+        static_assert (std::is_floating_point_v<T>, "running_field_stats: T must be a floating point type");
+
+        //! Add a field. The first sets the size; later ones must match it.
+        template <typename C>
+        void add (const C& field)
+        {
+            if (this->n == 0) { this->init (field.size()); }
+            if (field.size() != this->_mean.size()) { throw std::runtime_error ("running_field_stats::add: field size differs"); }
+            ++this->n;
+            const T inv_n = T{1} / static_cast<T>(this->n);
+            const std::size_t sz = this->_mean.size();
+            T* __restrict__ pm = this->_mean.data();
+            T* __restrict__ p2 = this->m2.data();
+            T* __restrict__ pmin = this->_min.data();
+            T* __restrict__ pmax = this->_max.data();
+            auto fi = field.begin();
+            for (std::size_t i = 0; i < sz; ++i) {
+                const T x = static_cast<T>(*fi++);
+                const T d = x - pm[i];
+                pm[i] += d * inv_n;
+                p2[i] += d * (x - pm[i]);
+                pmin[i] = std::min (pmin[i], x);
+                pmax[i] = std::max (pmax[i], x);
+            }
+        }
+
+        running_field_stats& operator+= (const running_field_stats& o)
+        {
+            if (o.n == 0) { return *this; }
+            if (this->n == 0) { *this = o; return *this; }
+            if (o._mean.size() != this->_mean.size()) { throw std::runtime_error ("running_field_stats::operator+=: field size differs"); }
+            const T na = static_cast<T>(this->n);
+            const T nb = static_cast<T>(o.n);
+            const T nn = na + nb;
+            for (std::size_t i = 0; i < this->_mean.size(); ++i) {
+                const T d = o._mean[i] - this->_mean[i];
+                this->_mean[i] += d * nb / nn;
+                this->m2[i] += o.m2[i] + d * d * na * nb / nn;
+                this->_min[i] = std::min (this->_min[i], o._min[i]);
+                this->_max[i] = std::max (this->_max[i], o._max[i]);
+            }
+            this->n += o.n;
+            return *this;
+        }
+
+        void reset() { *this = running_field_stats<T>{}; }
+
+        //! The number of fields added
+        std::size_t count() const { return this->n; }
+        //! The number of elements in each field
+        std::size_t size() const { return this->_mean.size(); }
+        const morph::vvec<T>& mean() const { return this->_mean; }
+        //! The sample variance of each element (dividing by n - 1)
+        morph::vvec<T> variance() const
+        {
+            if (this->n < 2) { return morph::vvec<T>(this->_mean.size(), T{0}); }
+            return this->m2 / static_cast<T>(this->n - 1);
+        }
+        morph::vvec<T> std() const { return this->variance().sqrt(); }
+        const morph::vvec<T>& min() const { return this->_min; }
+        const morph::vvec<T>& max() const { return this->_max; }
+        //! The statistics of element i alone
+        running_stats<T> at (const std::size_t i) const
+        {
+            running_stats<T> r;
+            r.n = this->n;
+            r._mean = this->_mean.at (i);
+            r.m2 = this->m2.at (i);
+            r._min = this->_min.at (i);
+            r._max = this->_max.at (i);
+            return r;
+        }
+
+    private:
+        void init (const std::size_t sz)
+        {
+            this->_mean.assign (sz, T{0});
+            this->m2.assign (sz, T{0});
+            this->_min.assign (sz, std::numeric_limits<T>::max());
+            this->_max.assign (sz, std::numeric_limits<T>::lowest());
+        }
+
+        std::size_t n = 0;
+        morph::vvec<T> _mean;
+        morph::vvec<T> m2;
+        morph::vvec<T> _min;
+        morph::vvec<T> _max;
+    };
+
+    /*!
+     * A running estimate of the p quantile (0 < p < 1) of a stream of values in constant memory,
+     * by the P^2 algorithm (Jain & Chlamtac, Commun. ACM 28, 1985). Five markers track the min,
+     * the p/2, p and (1+p)/2 quantiles and the max, their heights adjusted by piecewise
+     * parabolic interpolation. Until five values have been added the quantile is exact.
+     *
+     * P^2 estimates can not be merged exactly, so unlike the other accumulators here this has
+     * no operator+=.
+     */
+    template <typename T>
+    struct p2_quantile
+    {
+        static_assert (std::is_floating_point_v<T>, "p2_quantile: T must be a floating point type");
+
+        explicit p2_quantile (const T _p = T{0.5}) : p(_p)
+        {
+            if (!(p > T{0} && p < T{1})) { throw std::invalid_argument ("p2_quantile: p must be in (0, 1)"); }
+            this->reset();
+        }
+
+        void reset()
+        {
+            this->n = 0;
+            this->dn = { T{0}, this->p / T{2}, this->p, (T{1} + this->p) / T{2}, T{1} };
+            for (int i = 0; i < 5; ++i) {
+                this->pos[i] = static_cast<T>(i + 1);
+                this->want[i] = T{1} + T{4} * this->dn[i];
+            }
+        }
+
+        void add (const T x)
+        {
+            if (this->n < 5) {
+                this->q[this->n++] = x;
+                if (this->n == 5) { std::sort (this->q.begin(), this->q.end()); }
+                return;
+            }
+            ++this->n;
+            // Find the cell k containing x, extending the extreme markers if need be
+            int k = 0;
+            if (x < this->q[0]) {
+                this->q[0] = x;
+                k = 0;
+            } else if (x >= this->q[4]) {
+                this->q[4] = x;
+                k = 3;
+            } else {
+                while (k < 3 && x >= this->q[k + 1]) { ++k; }
+            }
+            for (int i = k + 1; i < 5; ++i) { this->pos[i] += T{1}; }
+            for (int i = 0; i < 5; ++i) { this->want[i] += this->dn[i]; }
+            // Move the middle markers that are off their desired positions by one or more
+            for (int i = 1; i < 4; ++i) {
+                const T d = this->want[i] - this->pos[i];
+                if ((d >= T{1} && this->pos[i + 1] - this->pos[i] > T{1})
+                    || (d <= T{-1} && this->pos[i - 1] - this->pos[i] < T{-1})) {
+                    const T s = d >= T{0} ? T{1} : T{-1};
+                    const T qp = this->parabolic (i, s);
+                    this->q[i] = (this->q[i - 1] < qp && qp < this->q[i + 1]) ? qp : this->linear (i, s);
+                    this->pos[i] += s;
+                }
+            }
+        }
+
+        template <typename C>
+        void add_all (const C& c) { for (const auto& x : c) { this->add (static_cast<T>(x)); } }
+
+        std::size_t count() const { return this->n; }
+        T quantile_p() const { return this->p; }
+
+        //! The current estimate of the p quantile (NaN if no values have been added)
+        T get() const
+        {
+            if (this->n == 0) { return std::numeric_limits<T>::quiet_NaN(); }
+            if (this->n < 5) {
+                // Exact, interpolating between the sorted values
+                std::array<T, 5> s = this->q;
+                std::sort (s.begin(), s.begin() + this->n);
+                const T r = this->p * static_cast<T>(this->n - 1);
+                const std::size_t i = static_cast<std::size_t>(r);
+                if (i + 1 >= this->n) { return s[this->n - 1]; }
+                return s[i] + (r - static_cast<T>(i)) * (s[i + 1] - s[i]);
+            }
+            return this->q[2];
+        }
+
+    private:
+        T parabolic (const int i, const T s) const
+        {
+            const T np = this->pos[i + 1];
+            const T ni = this->pos[i];
+            const T nm = this->pos[i - 1];
+            return this->q[i] + s / (np - nm) * ((ni - nm + s) * (this->q[i + 1] - this->q[i]) / (np - ni)
+                                                 + (np - ni - s) * (this->q[i] - this->q[i - 1]) / (ni - nm));
+        }
+        T linear (const int i, const T s) const
+        {
+            const int j = i + static_cast<int>(s);
+            return this->q[i] + s * (this->q[j] - this->q[i]) / (this->pos[j] - this->pos[i]);
+        }
+
+        T p;
+        std::size_t n = 0;
+        std::array<T, 5> q = {};    // marker heights
+        std::array<T, 5> pos = {};  // marker positions (1 based, whole numbers)
+        std::array<T, 5> want = {}; // desired marker positions
+        std::array<T, 5> dn = {};   // increments of the desired positions
+    };
+
+} // namespace morph
@@ -41,8 +41,13 @@
 #include <stdexcept>
 #include <cmath>
 #include <cstddef>
+#include <limits>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <span>
+#include <ranges>
+#include <type_traits>
 #include <morph/MathAlgo.h>
 #include <morph/trait_tests.h>
 #include <morph/vvec.h>
@@ -163,9 +168,42 @@ namespace morph {
             } else if (this->do_autoscale == false && !this->ready()) {
                 throw std::runtime_error ("scale_impl_base::transform(): Params are not set and do_autoscale is set false. Can't transform.");
             }
-            typename Container::const_iterator di = data.begin();
-            typename OContainer::iterator oi = output.begin();
-            while (di != data.end()) { *oi++ = this->transform_one (*di++); }
+            if constexpr (std::ranges::contiguous_range<Container> && std::ranges::contiguous_range<OContainer>
+                          && std::is_same_v<typename Container::value_type, T>
+                          && std::is_same_v<typename OContainer::value_type, S>) {
+                // Contiguous containers go through the batch kernel
+                this->transform_n (std::ranges::data (data), std::ranges::data (output), dsize);
+            } else {
+                typename Container::const_iterator di = data.begin();
+                typename OContainer::iterator oi = output.begin();
+                while (di != data.end()) { *oi++ = this->transform_one (*di++); }
+            }
+        }
+
+        /*!
+         * \brief Transform a contiguous span of scalars or vectors in one call.
+         *
+         * This makes one virtual call for the whole span, rather than one per datum. For scalar
+         * scales the linear and logarithmic transforms run as omp simd loops, so rescaling a large
+         * dataset is limited by memory bandwidth. \a output may alias \a data.
+         */
+        void transform (std::span<const T> data, std::span<S> output)
+        {
+            if (output.size() != data.size()) {
+                throw std::runtime_error ("scale_impl_base::transform(): Ensure data.size()==output.size()");
+            }
+            if (this->do_autoscale == true && !this->ready()) {
+                this->compute_scaling_from_data (data);
+            } else if (this->do_autoscale == false && !this->ready()) {
+                throw std::runtime_error ("scale_impl_base::transform(): Params are not set and do_autoscale is set false. Can't transform.");
+            }
+            this->transform_n (data.data(), output.data(), data.size());
+        }
+
+        //! Transform \a data in place, without allocating. Available when T and S are the same.
+        void transform_inplace (std::span<T> data) requires std::is_same_v<T, S>
+        {
+            this->transform (std::span<const T>(data), data);
         }
 
         /*!
@@ -230,6 +268,25 @@ namespace morph {
             this->compute_scaling (mm.min, mm.max);
         }
 
+        //! Compute the scaling function from a span of data
+        void compute_scaling_from_data (std::span<const T> data)
+        {
+            if constexpr (std::is_arithmetic_v<T>) {
+                // As MathImpl<1>::maxmin, as a simd reduction
+                T mx = std::numeric_limits<T>::lowest();
+                T mn = std::numeric_limits<T>::max();
+#pragma omp simd reduction(max:mx) reduction(min:mn)
+                for (std::size_t i = 0; i < data.size(); ++i) {
+                    mx = data[i] > mx ? data[i] : mx;
+                    mn = data[i] < mn ? data[i] : mn;
+                }
+                this->compute_scaling (mn, mx);
+            } else {
+                // Vector maxmin compares lengths; this copy is made only when autoscaling
+                this->compute_scaling_from_data (std::vector<T>(data.begin(), data.end()));
+            }
+        }
+
         //! Set to true to make the scale object compute autoscaling when data is available, i.e. on
         //! the first call to #transform.
         bool do_autoscale = false;
@@ -261,6 +318,13 @@ namespace morph {
         virtual void reset() = 0;
 
     protected:
+        //! Transform n data into output (which may alias data). The default calls transform_one
+        //! for each datum; scale_impl<1> overrides this with simd kernels.
+        virtual void transform_n (const T* data, S* output, const std::size_t n) const
+        {
+            for (std::size_t i = 0; i < n; ++i) { output[i] = this->transform_one (data[i]); }
+        }
+
         /*!
          * What type of scaling function is in use? Intended for future implementations when scale
          * could carry out logarithmic (or other) scalings, in addition to linear transforms.
@@ -586,6 +650,32 @@ namespace morph {
         void reset() { this->params.clear(); }
 
     protected:
+        //! Batch transform for scalar types. Each datum is computed exactly as transform_one
+        //! would, but the loop is not interrupted by a virtual call per datum.
+        virtual void transform_n (const T* data, S* output, const std::size_t n) const
+        {
+            if constexpr (std::is_arithmetic_v<T> && std::is_arithmetic_v<S>) {
+                if (this->params.size() < 2) { throw std::runtime_error ("scale_impl<1=scalar>::transform_n(): (scalar) scaling params not set"); }
+                const S m = this->params[0];
+                const S c = this->params[1];
+                if (this->type == scaling_function::Logarithmic) {
+#pragma omp simd
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const T ln_d = std::log (data[i]);
+                        output[i] = ln_d * m + c;
+                    }
+                } else if (this->type == scaling_function::Linear) {
+#pragma omp simd
+                    for (std::size_t i = 0; i < n; ++i) { output[i] = data[i] * m + c; }
+                } else {
+                    throw std::runtime_error ("scale_impl<1=scalar>::transform_n(): Unknown scaling");
+                }
+            } else {
+                // e.g. complex scalars in scale_impl<2>
+                scale_impl_base<T, S>::transform_n (data, output, n);
+            }
+        }
+
         //! Linear transform for scalar type; y = mx + c
         S transform_one_linear (const T& datum) const
         {
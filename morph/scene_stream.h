@@ -0,0 +1,629 @@
+/*!
+ * \file
+ * \brief Streaming the contents of a scene over a socket, so that a headless run can be watched
+ * from another machine.
+ *
+ * The sending side describes each model of its scene as a model_state (its triangles, vertex
+ * colours, view matrices, alpha, visibility and labels) and publishes a frame of them with a
+ * scene_view. Each client of a server has its own encoder, which remembers what that client has
+ * been sent: a model's geometry goes once, when the client first sees the model (or when its
+ * mesh changes), and after that only the parts that changed, which for a typical simulation are
+ * the colours. A client that connects late therefore starts with a full keyframe, and a client
+ * that falls behind skips to the latest state rather than queueing every frame.
+ *
+ * The receiving side feeds the bytes to a decoder, which rebuilds the scene and reports which
+ * of its models changed. morph/remote_view.h joins both ends to morph::Visual; the classes here
+ * need no OpenGL.
+ *
+ * Each message is a header (the payload length, a message type and a model id) followed by its
+ * payload. Numbers are sent in the sender's byte order, so both ends must share it (all the
+ * platforms morphologica builds on are little endian).
+ */
+
+#pragma once
+
+#include <morph/mesh_cache.h>
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#if defined(__unix__) || defined(__APPLE__)
+# include <cerrno>
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+namespace morph::scene_stream {
+
+    //! The kinds of message
+    enum class message : std::uint8_t
+    {
+        geometry = 1, // indices, positions, normals and colours of a model
+        colours = 2,  // vertex colours only
+        state = 3,    // view matrix, model scaling, alpha and hide
+        labels = 4,   // the model's text labels
+        remove = 5,   // the model has left the scene
+        scene = 6     // the scene view (model id unused)
+    };
+
+    //! A text label of a model. offset is where the text was placed, after any centring.
+    struct label
+    {
+        std::u32string text;
+        std::array<float, 3> offset = { 0.0f, 0.0f, 0.0f };
+        float fontsize = 0.1f;
+        std::int32_t fontres = 24;
+        std::array<float, 3> colour = { 0.0f, 0.0f, 0.0f };
+        std::int32_t font = 0;
+    };
+
+    //! What is drawn of one model. Matrices are column major, as in morph::mat44.
+    struct model_state
+    {
+        std::vector<std::uint32_t> indices;
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> colours;
+        std::array<float, 16> viewmatrix = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        std::array<float, 16> model_scaling = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        float alpha = 1.0f;
+        bool hide = false;
+        std::vector<label> labels;
+    };
+
+    //! The view of the whole scene
+    struct scene_view
+    {
+        std::array<float, 3> trans = { 0.0f, 0.0f, -5.0f };
+        //! The scene rotation quaternion as w, x, y, z
+        std::array<float, 4> rotation = { 1.0f, 0.0f, 0.0f, 0.0f };
+        std::array<float, 4> bgcolour = { 1.0f, 1.0f, 1.0f, 0.5f };
+    };
+
+    //! A decoded scene: the models by id, and the view
+    struct scene
+    {
+        std::map<std::uint32_t, model_state> models;
+        scene_view view;
+    };
+
+    namespace detail {
+        //! The header before each payload: its length, the message type (in the low byte) and the model id
+        using header = std::array<std::uint32_t, 3>;
+
+        //! Reject payloads (and array lengths) above this size, so that a corrupt stream can't exhaust memory
+        constexpr std::uint64_t max_payload = std::uint64_t{1} << 32;
+
+        struct writer
+        {
+            std::string& out;
+            template <typename T>
+            void put (const T& v)
+            {
+                static_assert (std::is_trivially_copyable_v<T>);
+                this->out.append (reinterpret_cast<const char*>(&v), sizeof (T));
+            }
+            template <typename T>
+            void put (const std::vector<T>& v)
+            {
+                this->put (static_cast<std::uint64_t>(v.size()));
+                this->out.append (reinterpret_cast<const char*>(v.data()), v.size() * sizeof (T));
+            }
+            void put (const std::u32string& s)
+            {
+                this->put (static_cast<std::uint64_t>(s.size()));
+                this->out.append (reinterpret_cast<const char*>(s.data()), s.size() * sizeof (char32_t));
+            }
+            void put (const label& l)
+            {
+                this->put (l.text);
+                this->put (l.offset);
+                this->put (l.fontsize);
+                this->put (l.fontres);
+                this->put (l.colour);
+                this->put (l.font);
+            }
+        };
+
+        struct reader
+        {
+            const char* p;
+            const char* end;
+            void need (const std::uint64_t n) const
+            {
+                if (n > static_cast<std::uint64_t>(this->end - this->p)) {
+                    throw std::runtime_error ("scene_stream: truncated message");
+                }
+            }
+            template <typename T>
+            void get (T& v)
+            {
+                static_assert (std::is_trivially_copyable_v<T>);
+                this->need (sizeof (T));
+                std::memcpy (&v, this->p, sizeof (T));
+                this->p += sizeof (T);
+            }
+            //! Get a length and check that n elements of size sz remain
+            std::size_t count (const std::size_t sz)
+            {
+                std::uint64_t n = 0;
+                this->get (n);
+                if (n > max_payload / sz) { throw std::runtime_error ("scene_stream: bad array length"); }
+                this->need (n * sz);
+                return static_cast<std::size_t>(n);
+            }
+            template <typename T>
+            void get (std::vector<T>& v)
+            {
+                v.resize (this->count (sizeof (T)));
+                if (!v.empty()) { std::memcpy (v.data(), this->p, v.size() * sizeof (T)); }
+                this->p += v.size() * sizeof (T);
+            }
+            void get (std::u32string& s)
+            {
+                s.resize (this->count (sizeof (char32_t)));
+                if (!s.empty()) { std::memcpy (s.data(), this->p, s.size() * sizeof (char32_t)); }
+                this->p += s.size() * sizeof (char32_t);
+            }
+            void get (label& l)
+            {
+                this->get (l.text);
+                this->get (l.offset);
+                this->get (l.fontsize);
+                this->get (l.fontres);
+                this->get (l.colour);
+                this->get (l.font);
+            }
+        };
+
+        //! Append a message to out. body writes the payload.
+        template <typename F>
+        void append (std::string& out, const message m, const std::uint32_t id, F body)
+        {
+            const std::size_t at = out.size();
+            out.resize (at + sizeof (header));
+            writer w { out };
+            body (w);
+            const header h = { static_cast<std::uint32_t>(out.size() - at - sizeof (header)), static_cast<std::uint32_t>(m), id };
+            std::memcpy (out.data() + at, h.data(), sizeof (header));
+        }
+    } // namespace detail
+
+    /*!
+     * The models of a scene, ready to be encoded for any number of clients. The hashes of each
+     * model's parts are computed once, as it is added, so that each encoder only compares them.
+     * A frame holds pointers to the model_states, which must outlive it.
+     */
+    struct frame
+    {
+        struct hashes
+        {
+            std::uint64_t geometry = 0;
+            std::uint64_t colours = 0;
+            std::uint64_t state = 0;
+            std::uint64_t labels = 0;
+        };
+        struct entry
+        {
+            std::uint32_t id = 0;
+            const model_state* model = nullptr;
+            hashes h;
+        };
+
+        std::vector<entry> entries;
+        scene_view view;
+
+        void add (const std::uint32_t id, const model_state& m)
+        {
+            namespace mc = morph::mesh_cache;
+            entry e { id, &m, {} };
+            e.h.geometry = mc::hash (m.normals, mc::hash (m.positions, mc::hash (m.indices)));
+            const std::uint64_t sz = m.positions.size();
+            e.h.geometry = mc::hash (&sz, sizeof (sz), e.h.geometry);
+            e.h.colours = mc::hash (m.colours);
+            const std::uint8_t hd = m.hide ? 1 : 0;
+            e.h.state = mc::hash (m.viewmatrix.data(), sizeof (m.viewmatrix));
+            e.h.state = mc::hash (m.model_scaling.data(), sizeof (m.model_scaling), e.h.state);
+            e.h.state = mc::hash (&m.alpha, sizeof (m.alpha), e.h.state);
+            e.h.state = mc::hash (&hd, 1, e.h.state);
+            std::string l;
+            detail::writer w { l };
+            w.put (static_cast<std::uint64_t>(m.labels.size()));
+            for (const auto& lb : m.labels) { w.put (lb); }
+            e.h.labels = mc::hash (l.data(), l.size());
+            this->entries.push_back (e);
+        }
+    };
+
+    /*!
+     * Encodes frames for one receiver. The first frame is a keyframe (everything); later ones
+     * hold only what changed since the last frame encoded.
+     */
+    struct encoder
+    {
+        //! Append the messages that bring the receiver up to date with f to out
+        void encode (const frame& f, std::string& out)
+        {
+            std::set<std::uint32_t> present;
+            for (const frame::entry& e : f.entries) {
+                present.insert (e.id);
+                const model_state& m = *e.model;
+                auto known = this->sent.find (e.id);
+                const bool fresh = known == this->sent.end();
+                frame::hashes& s = this->sent[e.id];
+                if (fresh || s.geometry != e.h.geometry) {
+                    detail::append (out, message::geometry, e.id, [&m](detail::writer& w) {
+                        w.put (m.indices);
+                        w.put (m.positions);
+                        w.put (m.normals);
+                        w.put (m.colours);
+                    });
+                    s.colours = e.h.colours;
+                } else if (s.colours != e.h.colours) {
+                    detail::append (out, message::colours, e.id, [&m](detail::writer& w) { w.put (m.colours); });
+                    s.colours = e.h.colours;
+                }
+                if (fresh || s.state != e.h.state) {
+                    detail::append (out, message::state, e.id, [&m](detail::writer& w) {
+                        w.put (m.viewmatrix);
+                        w.put (m.model_scaling);
+                        w.put (m.alpha);
+                        w.put (static_cast<std::uint8_t>(m.hide));
+                    });
+                }
+                if (fresh || s.labels != e.h.labels) {
+                    detail::append (out, message::labels, e.id, [&m](detail::writer& w) {
+                        w.put (static_cast<std::uint64_t>(m.labels.size()));
+                        for (const auto& l : m.labels) { w.put (l); }
+                    });
+                }
+                s.geometry = e.h.geometry;
+                s.state = e.h.state;
+                s.labels = e.h.labels;
+            }
+            for (auto si = this->sent.begin(); si != this->sent.end();) {
+                if (present.count (si->first) == 0) {
+                    detail::append (out, message::remove, si->first, [](detail::writer&) {});
+                    si = this->sent.erase (si);
+                } else {
+                    ++si;
+                }
+            }
+            const std::uint64_t vh = morph::mesh_cache::hash (&f.view, sizeof (f.view));
+            if (!this->view_sent || vh != this->view_hash) {
+                detail::append (out, message::scene, 0, [&f](detail::writer& w) {
+                    w.put (f.view.trans);
+                    w.put (f.view.rotation);
+                    w.put (f.view.bgcolour);
+                });
+                this->view_sent = true;
+                this->view_hash = vh;
+            }
+        }
+
+        //! Forget what was sent, so that the next frame is a keyframe
+        void reset()
+        {
+            this->sent.clear();
+            this->view_sent = false;
+        }
+
+    private:
+        std::map<std::uint32_t, frame::hashes> sent;
+        bool view_sent = false;
+        std::uint64_t view_hash = 0;
+    };
+
+    //! One change to the decoded scene
+    struct change
+    {
+        message type;
+        std::uint32_t id;
+    };
+
+    /*!
+     * Rebuilds a scene from the bytes of a stream, which may arrive in pieces of any size.
+     * Throws std::runtime_error on a malformed message.
+     */
+    struct decoder
+    {
+        scene current;
+
+        //! Add n received bytes
+        void feed (const char* data, const std::size_t n) { this->buf.append (data, n); }
+
+        //! Apply every complete message received so far to current, returning what changed, in order
+        std::vector<change> apply()
+        {
+            std::vector<change> changes;
+            std::size_t at = 0;
+            while (this->buf.size() - at >= sizeof (detail::header)) {
+                detail::header h;
+                std::memcpy (h.data(), this->buf.data() + at, sizeof (h));
+                if (this->buf.size() - at - sizeof (h) < h[0]) { break; }
+                const char* p = this->buf.data() + at + sizeof (h);
+                detail::reader r { p, p + h[0] };
+                const message m = static_cast<message>(h[1] & 0xff);
+                const std::uint32_t id = h[2];
+                this->apply_one (m, id, r);
+                changes.push_back ({ m, id });
+                at += sizeof (h) + h[0];
+            }
+            this->buf.erase (0, at);
+            return changes;
+        }
+
+    private:
+        void apply_one (const message m, const std::uint32_t id, detail::reader& r)
+        {
+            switch (m) {
+            case message::geometry:
+            {
+                model_state& s = this->current.models[id];
+                r.get (s.indices);
+                r.get (s.positions);
+                r.get (s.normals);
+                r.get (s.colours);
+                break;
+            }
+            case message::colours:
+            {
+                model_state& s = this->model (id);
+                r.get (s.colours);
+                break;
+            }
+            case message::state:
+            {
+                model_state& s = this->model (id);
+                r.get (s.viewmatrix);
+                r.get (s.model_scaling);
+                r.get (s.alpha);
+                std::uint8_t hd = 0;
+                r.get (hd);
+                s.hide = hd != 0;
+                break;
+            }
+            case message::labels:
+            {
+                model_state& s = this->model (id);
+                s.labels.resize (r.count (1));
+                for (auto& l : s.labels) { r.get (l); }
+                break;
+            }
+            case message::remove:
+            {
+                this->current.models.erase (id);
+                break;
+            }
+            case message::scene:
+            {
+                r.get (this->current.view.trans);
+                r.get (this->current.view.rotation);
+                r.get (this->current.view.bgcolour);
+                break;
+            }
+            default:
+            {
+                throw std::runtime_error ("scene_stream: unknown message type");
+            }
+            }
+        }
+
+        //! A model that must already have been sent
+        model_state& model (const std::uint32_t id)
+        {
+            auto mi = this->current.models.find (id);
+            if (mi == this->current.models.end()) { throw std::runtime_error ("scene_stream: update for an unknown model"); }
+            return mi->second;
+        }
+
+        std::string buf;
+    };
+
+#if defined(__unix__) || defined(__APPLE__)
+    /*!
+     * A TCP server that publishes frames to every connected client. It never blocks: clients
+     * are accepted, and bytes sent, as far as the sockets allow on each call to publish(). A
+     * client whose socket has not taken the previous frame is not sent the next one; it is sent
+     * the changes since its last frame once it has caught up.
+     */
+    struct server
+    {
+        //! Listen on port (0 for any free port, see port()) of the address bind_address
+        server (const unsigned short _port, const std::string& bind_address = "127.0.0.1")
+        {
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+            addrinfo* ai = nullptr;
+            const std::string p = std::to_string (_port);
+            if (::getaddrinfo (bind_address.empty() ? nullptr : bind_address.c_str(), p.c_str(), &hints, &ai) != 0 || ai == nullptr) {
+                throw std::runtime_error ("scene_stream::server: can't resolve " + bind_address);
+            }
+            this->fd = ::socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            const int one = 1;
+            const bool ok = this->fd >= 0
+            && ::setsockopt (this->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one)) == 0
+            && ::bind (this->fd, ai->ai_addr, ai->ai_addrlen) == 0
+            && ::listen (this->fd, 8) == 0
+            && ::fcntl (this->fd, F_SETFL, O_NONBLOCK) == 0;
+            ::freeaddrinfo (ai);
+            if (!ok) {
+                if (this->fd >= 0) { ::close (this->fd); }
+                throw std::runtime_error ("scene_stream::server: can't listen on port " + p + ": " + std::strerror (errno));
+            }
+            sockaddr_storage a = {};
+            socklen_t alen = sizeof (a);
+            if (::getsockname (this->fd, reinterpret_cast<sockaddr*>(&a), &alen) == 0) {
+                if (a.ss_family == AF_INET) {
+                    this->bound_port = ntohs (reinterpret_cast<sockaddr_in*>(&a)->sin_port);
+                } else if (a.ss_family == AF_INET6) {
+                    this->bound_port = ntohs (reinterpret_cast<sockaddr_in6*>(&a)->sin6_port);
+                }
+            }
+        }
+        server (const server&) = delete;
+        server& operator= (const server&) = delete;
+        ~server()
+        {
+            for (auto& c : this->conns) { ::close (c.fd); }
+            ::close (this->fd);
+        }
+
+        //! The port listened on
+        unsigned short port() const { return this->bound_port; }
+
+        //! The number of connected clients (as of the last call to publish() or accept())
+        std::size_t clients() const { return this->conns.size(); }
+
+        //! Accept any waiting clients
+        void accept()
+        {
+            for (;;) {
+                const int c = ::accept (this->fd, nullptr, nullptr);
+                if (c < 0) { break; }
+                const int one = 1;
+                ::setsockopt (c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+#ifdef SO_NOSIGPIPE
+                ::setsockopt (c, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof (one));
+#endif
+                ::fcntl (c, F_SETFL, O_NONBLOCK);
+                this->conns.push_back ({ c, {}, {} });
+            }
+        }
+
+        //! Send f (or what has changed since the last frame each client took) to every client
+        void publish (const frame& f)
+        {
+            this->accept();
+            for (auto ci = this->conns.begin(); ci != this->conns.end();) {
+                bool ok = this->flush (*ci);
+                if (ok && ci->pending.empty()) {
+                    ci->enc.encode (f, ci->pending);
+                    ok = this->flush (*ci);
+                }
+                if (ok) {
+                    ++ci;
+                } else {
+                    ::close (ci->fd);
+                    ci = this->conns.erase (ci);
+                }
+            }
+        }
+
+    private:
+        struct connection
+        {
+            int fd;
+            encoder enc;
+            std::string pending;
+        };
+
+        //! Send what the socket will take of c.pending. False if the client has gone.
+        static bool flush (connection& c)
+        {
+#ifdef MSG_NOSIGNAL
+            constexpr int flags = MSG_NOSIGNAL;
+#else
+            constexpr int flags = 0;
+#endif
+            std::size_t sent = 0;
+            while (sent < c.pending.size()) {
+                const ssize_t n = ::send (c.fd, c.pending.data() + sent, c.pending.size() - sent, flags);
+                if (n > 0) {
+                    sent += static_cast<std::size_t>(n);
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else {
+                    return false;
+                }
+            }
+            c.pending.erase (0, sent);
+            return true;
+        }
+
+        int fd = -1;
+        unsigned short bound_port = 0;
+        std::vector<connection> conns;
+    };
+
+    //! A client of a server, which decodes the stream into a scene
+    struct client
+    {
+        //! Connect to the server at host:port
+        client (const std::string& host, const unsigned short port)
+        {
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_NUMERICSERV;
+            addrinfo* ai = nullptr;
+            const std::string p = std::to_string (port);
+            if (::getaddrinfo (host.c_str(), p.c_str(), &hints, &ai) != 0 || ai == nullptr) {
+                throw std::runtime_error ("scene_stream::client: can't resolve " + host);
+            }
+            for (addrinfo* a = ai; a != nullptr && this->fd < 0; a = a->ai_next) {
+                this->fd = ::socket (a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (this->fd >= 0 && ::connect (this->fd, a->ai_addr, a->ai_addrlen) != 0) {
+                    ::close (this->fd);
+                    this->fd = -1;
+                }
+            }
+            ::freeaddrinfo (ai);
+            if (this->fd < 0) { throw std::runtime_error ("scene_stream::client: can't connect to " + host + ":" + p); }
+        }
+        client (const client&) = delete;
+        client& operator= (const client&) = delete;
+        ~client() { if (this->fd >= 0) { ::close (this->fd); } }
+
+        //! False once the server has closed the connection
+        bool connected() const { return this->fd >= 0; }
+
+        /*!
+         * Read what has arrived, waiting up to timeout_ms for the first bytes (0 to not wait,
+         * -1 to wait indefinitely), and return the changes it made to state().
+         */
+        std::vector<change> poll (const int timeout_ms = 0)
+        {
+            if (this->fd < 0) { return {}; }
+            pollfd pf = { this->fd, POLLIN, 0 };
+            int wait = timeout_ms;
+            char b[65536];
+            while (::poll (&pf, 1, wait) > 0) {
+                const ssize_t n = ::recv (this->fd, b, sizeof (b), 0);
+                if (n <= 0) {
+                    if (n < 0 && errno == EINTR) { continue; }
+                    ::close (this->fd);
+                    this->fd = -1;
+                    break;
+                }
+                this->dec.feed (b, static_cast<std::size_t>(n));
+                wait = 0;
+            }
+            return this->dec.apply();
+        }
+
+        //! The scene as received so far
+        const scene& state() const { return this->dec.current; }
+
+    private:
+        int fd = -1;
+        decoder dec;
+    };
+#endif
+
+} // namespace morph::scene_stream
@@ -0,0 +1,135 @@
+/*!
+ * \file
+ *
+ * A precomputed, sparse linear map that shifts data on a grid. HexGrid::shiftOperator() and
+ * CartGrid::shiftOperatorByMetric() make one for a given shift, which can then be applied to
+ * any number of data vectors without working out the shift again.
+ */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <morph/vvec.h>
+
+namespace morph {
+
+    /*!
+     * A table of (source, destination, weight) entries over n grid elements. apply() sets each
+     * destination element to the weighted sum of its source elements, so the entries are held
+     * grouped by destination and each output element is written by one thread. Within a group,
+     * the entries keep the order in which they were given to the constructor, so the sums are
+     * made in the same order as a serial loop that scatters the sources in that order.
+     *
+     * \tparam F The type of the weights
+     */
+    template <typename F = float>
+    struct shift_operator
+    {
+        //! One contribution of element src to element dst
+        struct entry
+        {
+            unsigned int src = 0;
+            unsigned int dst = 0;
+            F w = F{1};
+        };
+
+        //! An empty operator. valid() is false.
+        shift_operator() = default;
+
+        //! Make the operator with entries over _n elements. Entries with zero weight are dropped.
+        shift_operator (const std::size_t _n, const std::vector<entry>& entries)
+        {
+            if (_n >= static_cast<std::size_t>(std::numeric_limits<unsigned int>::max())) {
+                throw std::runtime_error ("shift_operator: Too many elements");
+            }
+            this->n = _n;
+            this->dst_start.assign (_n + 1, 0u);
+            this->src_start.assign (_n + 1, 0u);
+            std::size_t ne = 0;
+            for (const auto& e : entries) {
+                if (e.src >= _n || e.dst >= _n) { throw std::runtime_error ("shift_operator: Entry out of range"); }
+                if (e.w == F{0}) { continue; }
+                ++this->dst_start[e.dst + 1];
+                ++this->src_start[e.src + 1];
+                ++ne;
+            }
+            for (std::size_t i = 0; i < _n; ++i) {
+                this->dst_start[i + 1] += this->dst_start[i];
+                this->src_start[i + 1] += this->src_start[i];
+            }
+            // Counting sorts by destination and by source, both stable
+            this->src.resize (ne);
+            this->weight.resize (ne);
+            this->dst.resize (ne);
+            std::vector<unsigned int> dfill (this->dst_start.begin(), this->dst_start.end() - 1);
+            std::vector<unsigned int> sfill (this->src_start.begin(), this->src_start.end() - 1);
+            for (const auto& e : entries) {
+                if (e.w == F{0}) { continue; }
+                const unsigned int j = dfill[e.dst]++;
+                this->src[j] = e.src;
+                this->weight[j] = e.w;
+                this->dst[sfill[e.src]++] = e.dst;
+            }
+        }
+
+        //! False for an empty operator, such as one for a shift that could not be computed
+        bool valid() const { return !this->dst_start.empty(); }
+
+        //! The number of grid elements that the operator maps from and to
+        std::size_t size() const { return this->n; }
+
+        //! The number of non-zero entries
+        std::size_t num_entries() const { return this->src.size(); }
+
+        /*!
+         * Write the shifted in to out, which is resized to size() if necessary (so a buffer that
+         * is reused does not allocate). in and out must not be the same vector.
+         */
+        template <typename T>
+        void apply (const std::vector<T>& in, std::vector<T>& out) const
+        {
+            if (in.size() < this->n) { throw std::runtime_error ("shift_operator::apply: in is too small"); }
+            if (&in == &out) { throw std::runtime_error ("shift_operator::apply: in and out must differ"); }
+            out.resize (this->n);
+            const int nn = static_cast<int>(this->n);
+#pragma omp parallel for
+            for (int i = 0; i < nn; ++i) {
+                T acc = T{0};
+                for (unsigned int j = this->dst_start[i]; j < this->dst_start[i + 1]; ++j) {
+                    acc += this->weight[j] * in[this->src[j]];
+                }
+                out[i] = acc;
+            }
+        }
+
+        /*!
+         * The elements that the elements inds are shifted to. Each of inds gives its
+         * destinations in order; elements that are shifted off the grid give none.
+         */
+        morph::vvec<int> shift_indices (const std::vector<int>& inds) const
+        {
+            morph::vvec<int> shifted;
+            for (const int i : inds) {
+                if (i < 0 || static_cast<std::size_t>(i) >= this->n) { continue; }
+                for (unsigned int j = this->src_start[i]; j < this->src_start[i + 1]; ++j) {
+                    shifted.push_back (static_cast<int>(this->dst[j]));
+                }
+            }
+            return shifted;
+        }
+
+    private:
+        std::size_t n = 0;
+        //! The entries for destination i are src[dst_start[i]] to src[dst_start[i + 1] - 1]
+        std::vector<unsigned int> dst_start;
+        std::vector<unsigned int> src;
+        std::vector<F> weight;
+        //! The destinations of source i are dst[src_start[i]] to dst[src_start[i + 1] - 1]
+        std::vector<unsigned int> src_start;
+        std::vector<unsigned int> dst;
+    };
+
+} // namespace morph
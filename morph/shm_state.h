@@ -0,0 +1,553 @@
+/*!
+ * \file
+ *
+ * Live simulation state in POSIX shared memory. A shm_publisher in the simulation writes named
+ * fields into a ring of frames in a shared memory object; a shm_reader in any other process
+ * (such as a viewer built on morph::Visual) maps the same object and reads the latest frame in
+ * place, without copies or disk I/O. The simulation never waits for its readers.
+ */
+#pragma once
+
+#ifndef __WIN__
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <string>
+#include <span>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <stdexcept>
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+}
+
+namespace morph {
+
+    namespace shm_internal
+    {
+        static_assert (std::atomic<std::uint64_t>::is_always_lock_free, "shm_state needs lock free 64 bit atomics");
+        static_assert (std::atomic<std::uint32_t>::is_always_lock_free, "shm_state needs lock free 32 bit atomics");
+
+        constexpr std::array<char, 8> magic = { 'm', 'o', 'r', 'p', 'h', 's', 'h', 'm' };
+        constexpr std::uint32_t version = 1;
+        constexpr std::size_t align = 64;
+        constexpr std::size_t max_name = 56;
+
+        //! The state of the object, in the header
+        enum : std::uint32_t { initializing = 0, open = 1, closed = 2 };
+
+        //! The element types that a field may have
+        enum class type_code : std::uint32_t { f32 = 1, f64 = 2, i32 = 3, u32 = 4 };
+
+        template <typename T>
+        constexpr type_code code_of()
+        {
+            if constexpr (std::is_same_v<T, float>) { return type_code::f32; }
+            else if constexpr (std::is_same_v<T, double>) { return type_code::f64; }
+            else if constexpr (std::is_same_v<T, std::int32_t>) { return type_code::i32; }
+            else if constexpr (std::is_same_v<T, std::uint32_t>) { return type_code::u32; }
+            else { static_assert (!sizeof(T), "shm_state fields are float, double, int32_t or uint32_t"); }
+        }
+
+        constexpr std::size_t size_of (const type_code t) { return (t == type_code::f64) ? 8 : 4; }
+
+        constexpr std::size_t round_up (const std::size_t n) { return (n + align - 1) / align * align; }
+
+        /*!
+         * The start of the object. Followed by nfields field descriptors, then metadata_bytes of
+         * metadata text, then the constant fields, then nslots frames of slot_bytes each.
+         */
+        struct header
+        {
+            std::array<char, 8> magic;
+            std::uint32_t version;
+            std::atomic<std::uint32_t> state;
+            std::uint32_t nfields;
+            std::uint32_t nslots;
+            std::uint64_t metadata_bytes;
+            std::uint64_t metadata_offset;
+            std::uint64_t constants_offset;
+            std::uint64_t slots_offset;
+            std::uint64_t slot_bytes;
+            std::uint64_t total_bytes;
+            //! The number of the latest complete frame, counting from 1. 0 before the first.
+            std::atomic<std::uint64_t> latest;
+        };
+
+        struct field_desc
+        {
+            char name[max_name];
+            type_code type;
+            //! 1 for a constant field, written once, 0 for a field written in each frame
+            std::uint32_t constant;
+            std::uint64_t count;
+            //! From the start of the object for a constant; from the start of a slot otherwise
+            std::uint64_t offset;
+        };
+
+        //! The start of each slot of the ring
+        struct slot_header
+        {
+            //! Odd while the slot is being written; 2n once it holds complete frame n
+            std::atomic<std::uint64_t> seq;
+            std::uint64_t step;
+            double time;
+        };
+    } // namespace shm_internal
+
+    //! The description of one field, as given by shm_reader::fields()
+    struct shm_field
+    {
+        std::string name;
+        std::size_t count = 0;
+        bool constant = false;
+        //! The size of one element in bytes: 8 for double, 4 for the others
+        std::size_t elem_bytes = 0;
+    };
+
+    /*!
+     * Writes the state of a running simulation to the POSIX shared memory object name (which
+     * should start with '/'). Declare the fields, set any metadata, open(), then for each frame
+     * set() the fields and commit():
+     *
+     *\code{.cpp}
+     * morph::shm_publisher pub ("/my_model");
+     * pub.add_constant ("x", hg.d_x);
+     * pub.add_field<float> ("u", n);
+     * pub.metadata = R"({"d": 0.01})";
+     * pub.open();
+     * for (;;) {
+     *     model.step();
+     *     pub.set ("u", model.u);
+     *     pub.commit (model.stepCount);
+     * }
+     *\endcode
+     *
+     * The frames are held in a ring of nslots. commit() makes the frame just written the
+     * latest; a reader that is using an older frame can tell, with shm_reader::valid(), if it
+     * has since been overwritten. Writing never blocks.
+     */
+    class shm_publisher
+    {
+    public:
+        explicit shm_publisher (const std::string& _name) : name(_name) {}
+        shm_publisher (const shm_publisher&) = delete;
+        shm_publisher& operator= (const shm_publisher&) = delete;
+        ~shm_publisher() { this->close(); }
+
+        //! Declare a field of count elements that is written in each frame
+        template <typename T>
+        void add_field (const std::string& field, const std::size_t count)
+        {
+            this->declare (field, shm_internal::code_of<T>(), count, false, nullptr);
+        }
+
+        //! Declare a field that is written once, at open(), such as the positions of grid elements
+        template <typename T>
+        void add_constant (const std::string& field, const std::vector<T>& values)
+        {
+            this->declare (field, shm_internal::code_of<T>(), values.size(), true, values.data());
+        }
+
+        //! Text (JSON, say) describing the grid and the run, for readers. Set before open().
+        std::string metadata;
+        //! The number of frames in the ring. Set before open(); at least 2.
+        unsigned int nslots = 3;
+        //! If true, the object is removed by close(). Readers that have mapped it keep their view.
+        bool unlink_on_close = true;
+
+        //! Create (replacing any old object of the same name) and map the object
+        void open()
+        {
+            namespace si = shm_internal;
+            if (this->base != nullptr) { throw std::runtime_error ("shm_publisher: already open"); }
+            if (this->nslots < 2) { throw std::runtime_error ("shm_publisher: nslots must be at least 2"); }
+
+            si::header h = {};
+            h.magic = si::magic;
+            h.version = si::version;
+            h.nfields = static_cast<std::uint32_t>(this->descs.size());
+            h.nslots = this->nslots;
+            h.metadata_offset = si::round_up (sizeof (si::header)) + this->descs.size() * sizeof (si::field_desc);
+            h.metadata_bytes = this->metadata.size();
+            std::size_t off = si::round_up (h.metadata_offset + h.metadata_bytes);
+            h.constants_offset = off;
+            std::size_t slot_off = si::round_up (sizeof (si::slot_header));
+            for (auto& d : this->descs) {
+                const std::size_t bytes = si::round_up (d.count * si::size_of (d.type));
+                if (d.constant) {
+                    d.offset = off;
+                    off += bytes;
+                } else {
+                    d.offset = slot_off;
+                    slot_off += bytes;
+                }
+            }
+            h.slots_offset = off;
+            h.slot_bytes = slot_off;
+            h.total_bytes = off + h.slot_bytes * this->nslots;
+
+            shm_unlink (this->name.c_str()); // a leftover from a run that didn't close
+            this->fd = shm_open (this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (this->fd < 0) { throw std::runtime_error ("shm_publisher: shm_open failed for " + this->name + ": " + std::strerror (errno)); }
+            if (ftruncate (this->fd, static_cast<off_t>(h.total_bytes)) != 0) {
+                this->close();
+                throw std::runtime_error ("shm_publisher: ftruncate failed for " + this->name);
+            }
+            void* p = mmap (nullptr, h.total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+            if (p == MAP_FAILED) {
+                this->close();
+                throw std::runtime_error ("shm_publisher: mmap failed for " + this->name);
+            }
+            this->base = static_cast<unsigned char*>(p);
+            this->bytes = h.total_bytes;
+
+            // The new object is zero filled, so state reads as initializing until the end
+            si::header* hp = this->hdr();
+            hp->magic = h.magic;
+            hp->version = h.version;
+            hp->nfields = h.nfields;
+            hp->nslots = h.nslots;
+            hp->metadata_bytes = h.metadata_bytes;
+            hp->metadata_offset = h.metadata_offset;
+            hp->constants_offset = h.constants_offset;
+            hp->slots_offset = h.slots_offset;
+            hp->slot_bytes = h.slot_bytes;
+            hp->total_bytes = h.total_bytes;
+            std::memcpy (this->base + si::round_up (sizeof (si::header)), this->descs.data(), this->descs.size() * sizeof (si::field_desc));
+            std::memcpy (this->base + h.metadata_offset, this->metadata.data(), this->metadata.size());
+            for (std::size_t i = 0; i < this->descs.size(); ++i) {
+                if (this->descs[i].constant) {
+                    std::memcpy (this->base + this->descs[i].offset, this->constants[i].data(), this->constants[i].size());
+                }
+            }
+            this->constants.clear();
+            hp->state.store (si::open, std::memory_order_release);
+        }
+
+        //! Copy data into field of the frame being written. data must have the field's size and type.
+        template <typename T>
+        void set (const std::string& field, const std::vector<T>& data) { this->set (field, data.data(), data.size()); }
+
+        //! Copy n elements from data into field of the frame being written
+        template <typename T>
+        void set (const std::string& field, const T* data, const std::size_t n)
+        {
+            namespace si = shm_internal;
+            const si::field_desc& d = this->find (field);
+            if (d.constant) { throw std::runtime_error ("shm_publisher: " + field + " is constant"); }
+            if (d.type != si::code_of<T>() || d.count != n) {
+                throw std::runtime_error ("shm_publisher: " + field + " has a different type or size");
+            }
+            si::slot_header* s = this->begin_frame();
+            std::memcpy (reinterpret_cast<unsigned char*>(s) + d.offset, data, n * sizeof (T));
+        }
+
+        /*!
+         * Complete the frame that set() has been writing, labelling it with the simulation's
+         * step and time, and make it the latest. Fields that were not set in this frame hold
+         * whatever they held when the slot was last used.
+         */
+        void commit (const std::uint64_t step = 0, const double time = 0.0)
+        {
+            namespace si = shm_internal;
+            si::slot_header* s = this->begin_frame();
+            s->step = step;
+            s->time = time;
+            s->seq.store (2 * this->frame, std::memory_order_release);
+            this->hdr()->latest.store (this->frame, std::memory_order_release);
+            this->writing = false;
+        }
+
+        //! The number of frames committed so far
+        std::uint64_t frames() const { return this->writing ? this->frame - 1 : this->frame; }
+
+        //! True between open() and close()
+        bool is_open() const { return this->base != nullptr; }
+
+        //! Mark the object closed, for readers, and unmap it
+        void close()
+        {
+            if (this->base != nullptr) {
+                this->hdr()->state.store (shm_internal::closed, std::memory_order_release);
+                munmap (this->base, this->bytes);
+                this->base = nullptr;
+            }
+            if (this->fd >= 0) {
+                ::close (this->fd);
+                this->fd = -1;
+                if (this->unlink_on_close) { shm_unlink (this->name.c_str()); }
+            }
+        }
+
+    private:
+        shm_internal::header* hdr() { return reinterpret_cast<shm_internal::header*>(this->base); }
+
+        void declare (const std::string& field, const shm_internal::type_code t, const std::size_t count,
+                      const bool constant, const void* values)
+        {
+            if (this->base != nullptr) { throw std::runtime_error ("shm_publisher: declare fields before open()"); }
+            if (field.empty() || field.size() >= shm_internal::max_name) { throw std::runtime_error ("shm_publisher: bad field name '" + field + "'"); }
+            if (this->index.count (field)) { throw std::runtime_error ("shm_publisher: field " + field + " declared twice"); }
+            shm_internal::field_desc d = {};
+            std::memcpy (d.name, field.data(), field.size());
+            d.type = t;
+            d.constant = constant ? 1 : 0;
+            d.count = count;
+            this->index[field] = this->descs.size();
+            this->descs.push_back (d);
+            std::vector<unsigned char> c;
+            if (constant) {
+                const unsigned char* v = static_cast<const unsigned char*>(values);
+                c.assign (v, v + count * shm_internal::size_of (t));
+            }
+            this->constants.push_back (std::move (c));
+        }
+
+        const shm_internal::field_desc& find (const std::string& field) const
+        {
+            auto i = this->index.find (field);
+            if (i == this->index.end()) { throw std::runtime_error ("shm_publisher: no field " + field); }
+            return this->descs[i->second];
+        }
+
+        //! The slot for the frame being written, marking it as being written if it isn't yet
+        shm_internal::slot_header* begin_frame()
+        {
+            if (this->base == nullptr) { throw std::runtime_error ("shm_publisher: not open"); }
+            shm_internal::header* hp = this->hdr();
+            if (!this->writing) {
+                ++this->frame;
+                this->writing = true;
+            }
+            auto* s = reinterpret_cast<shm_internal::slot_header*>(this->base + hp->slots_offset
+                                                                    + ((this->frame - 1) % hp->nslots) * hp->slot_bytes);
+            const std::uint64_t odd = 2 * this->frame - 1;
+            if (s->seq.load (std::memory_order_relaxed) != odd) {
+                s->seq.store (odd, std::memory_order_relaxed);
+                // Readers that see the new data must also see the odd seq
+                std::atomic_thread_fence (std::memory_order_release);
+            }
+            return s;
+        }
+
+        std::string name;
+        int fd = -1;
+        unsigned char* base = nullptr;
+        std::size_t bytes = 0;
+        std::vector<shm_internal::field_desc> descs;
+        //! The values of the constant fields, until open()
+        std::vector<std::vector<unsigned char>> constants;
+        std::map<std::string, std::size_t> index;
+        //! The number of the frame being (or last) written
+        std::uint64_t frame = 0;
+        bool writing = false;
+    };
+
+    /*!
+     * Maps the object written by a shm_publisher, read only, and gives views of its frames.
+     *
+     *\code{.cpp}
+     * morph::shm_reader rd ("/my_model");
+     * while (!rd.open()) { sleep (1); } // wait for the simulation to start
+     * std::span<const float> x = rd.constant<float> ("x");
+     * morph::shm_reader::frame f;
+     * while (!rd.closed()) {
+     *     if (rd.latest (f)) {
+     *         gv->updateData (rd.view<float> (f, "u")); // If !rd.valid (f) now, it was torn; show the next
+     *     }
+     *     v.render();
+     * }
+     *\endcode
+     */
+    class shm_reader
+    {
+    public:
+        //! A frame found by latest(). Its views stay usable while valid() is true.
+        struct frame
+        {
+            std::uint64_t number = 0;
+            std::uint64_t step = 0;
+            double time = 0.0;
+            const shm_internal::slot_header* slot = nullptr;
+        };
+
+        explicit shm_reader (const std::string& _name) : name(_name) {}
+        shm_reader (const shm_reader&) = delete;
+        shm_reader& operator= (const shm_reader&) = delete;
+        ~shm_reader() { this->close(); }
+
+        /*!
+         * Map the object. Returns false if it does not exist yet or is still being set up, so
+         * call again later. Throws if it is not a shm_publisher object of this version.
+         */
+        bool open()
+        {
+            namespace si = shm_internal;
+            if (this->base != nullptr) { return true; }
+            int fd = shm_open (this->name.c_str(), O_RDONLY, 0);
+            if (fd < 0) { return false; }
+            struct stat st;
+            if (fstat (fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof (si::header)) { ::close (fd); return false; }
+            void* p = mmap (nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close (fd);
+            if (p == MAP_FAILED) { return false; }
+            this->base = static_cast<const unsigned char*>(p);
+            this->bytes = st.st_size;
+
+            const si::header* h = this->hdr();
+            if (h->state.load (std::memory_order_acquire) == si::initializing) { this->close(); return false; }
+            if (h->magic != si::magic || h->version != si::version || h->total_bytes > this->bytes
+                || h->slots_offset + std::uint64_t{h->nslots} * h->slot_bytes > h->total_bytes
+                || h->metadata_offset + h->metadata_bytes > h->total_bytes || h->nslots == 0
+                || si::round_up (sizeof (si::header)) + std::uint64_t{h->nfields} * sizeof (si::field_desc) > h->metadata_offset) {
+                this->close();
+                throw std::runtime_error ("shm_reader: " + this->name + " is not a shm_publisher object of this version");
+            }
+            const auto* d = reinterpret_cast<const si::field_desc*>(this->base + si::round_up (sizeof (si::header)));
+            for (std::uint32_t i = 0; i < h->nfields; ++i) {
+                const std::uint64_t end = d[i].offset + d[i].count * si::size_of (d[i].type);
+                if (d[i].constant ? end > h->slots_offset : end > h->slot_bytes) { this->close(); throw std::runtime_error ("shm_reader: bad field"); }
+                this->index[std::string (d[i].name, strnlen (d[i].name, si::max_name))] = &d[i];
+            }
+            return true;
+        }
+
+        //! True once the publisher has closed the object (the last frame can still be read)
+        bool closed() const
+        {
+            return this->base != nullptr && this->hdr()->state.load (std::memory_order_acquire) == shm_internal::closed;
+        }
+
+        //! The fields, in the order they were declared
+        std::vector<shm_field> fields() const
+        {
+            std::vector<shm_field> f;
+            if (this->base == nullptr) { return f; }
+            const auto* d = reinterpret_cast<const shm_internal::field_desc*>(this->base + shm_internal::round_up (sizeof (shm_internal::header)));
+            for (std::uint32_t i = 0; i < this->hdr()->nfields; ++i) {
+                f.push_back ({ std::string (d[i].name, strnlen (d[i].name, shm_internal::max_name)), d[i].count, d[i].constant != 0,
+                              shm_internal::size_of (d[i].type) });
+            }
+            return f;
+        }
+
+        //! The publisher's metadata text
+        std::string metadata() const
+        {
+            if (this->base == nullptr) { return {}; }
+            const shm_internal::header* h = this->hdr();
+            return std::string (reinterpret_cast<const char*>(this->base + h->metadata_offset), h->metadata_bytes);
+        }
+
+        //! A view of the constant field
+        template <typename T>
+        std::span<const T> constant (const std::string& field) const
+        {
+            const shm_internal::field_desc* d = this->find<T> (field, true);
+            return std::span<const T>(reinterpret_cast<const T*>(this->base + d->offset), d->count);
+        }
+
+        /*!
+         * Find the latest complete frame. Returns false if there is none yet, or if it is the
+         * frame already in f (so f is left as it is, and the caller has nothing new to show).
+         */
+        bool latest (frame& f) const
+        {
+            if (this->base == nullptr) { return false; }
+            const shm_internal::header* h = this->hdr();
+            for (;;) {
+                const std::uint64_t n = h->latest.load (std::memory_order_acquire);
+                if (n == 0 || n == f.number) { return false; }
+                const auto* s = this->slot_of (n);
+                const std::uint64_t seq = s->seq.load (std::memory_order_acquire);
+                const std::uint64_t step = s->step;
+                const double time = s->time;
+                std::atomic_thread_fence (std::memory_order_acquire);
+                // If the slot has moved on since latest was read, look again
+                if (seq == 2 * n && s->seq.load (std::memory_order_relaxed) == 2 * n) {
+                    f.number = n;
+                    f.step = step;
+                    f.time = time;
+                    f.slot = s;
+                    return true;
+                }
+            }
+        }
+
+        //! A view, in place in shared memory, of field in frame f
+        template <typename T>
+        std::span<const T> view (const frame& f, const std::string& field) const
+        {
+            const shm_internal::field_desc* d = this->find<T> (field, false);
+            if (f.slot == nullptr) { throw std::runtime_error ("shm_reader: no frame"); }
+            return std::span<const T>(reinterpret_cast<const T*>(reinterpret_cast<const unsigned char*>(f.slot) + d->offset), d->count);
+        }
+
+        /*!
+         * True if frame f has not been overwritten, so that what was read from its views since
+         * latest() returned it is intact. Check after using the views.
+         */
+        bool valid (const frame& f) const
+        {
+            if (f.slot == nullptr) { return false; }
+            std::atomic_thread_fence (std::memory_order_acquire);
+            return f.slot->seq.load (std::memory_order_relaxed) == 2 * f.number;
+        }
+
+        //! Copy field of frame f into out. Returns false (and the copy may be torn) if f was overwritten meanwhile.
+        template <typename T>
+        bool copy (const frame& f, const std::string& field, std::vector<T>& out) const
+        {
+            std::span<const T> v = this->view<T> (f, field);
+            out.assign (v.begin(), v.end());
+            return this->valid (f);
+        }
+
+        void close()
+        {
+            if (this->base != nullptr) {
+                munmap (const_cast<unsigned char*>(this->base), this->bytes);
+                this->base = nullptr;
+            }
+            this->index.clear();
+        }
+
+    private:
+        const shm_internal::header* hdr() const { return reinterpret_cast<const shm_internal::header*>(this->base); }
+
+        const shm_internal::slot_header* slot_of (const std::uint64_t n) const
+        {
+            const shm_internal::header* h = this->hdr();
+            return reinterpret_cast<const shm_internal::slot_header*>(this->base + h->slots_offset + ((n - 1) % h->nslots) * h->slot_bytes);
+        }
+
+        template <typename T>
+        const shm_internal::field_desc* find (const std::string& field, const bool constant) const
+        {
+            auto i = this->index.find (field);
+            if (i == this->index.end()) { throw std::runtime_error ("shm_reader: no field " + field); }
+            const shm_internal::field_desc* d = i->second;
+            if (d->type != shm_internal::code_of<T>() || (d->constant != 0) != constant) {
+                throw std::runtime_error ("shm_reader: field " + field + " has a different type, or is (or isn't) constant");
+            }
+            return d;
+        }
+
+        std::string name;
+        const unsigned char* base = nullptr;
+        std::size_t bytes = 0;
+        std::map<std::string, const shm_internal::field_desc*> index;
+    };
+
+} // namespace morph
+
+#endif // __WIN__
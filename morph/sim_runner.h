@@ -0,0 +1,301 @@
+/*!
+ * \file
+ *
+ * A simulation that runs in its own thread at full speed while the program's main thread
+ * renders it. The simulation publishes snapshots of its state through a triple buffer and the
+ * renderer takes the latest one when it is ready to draw a frame, so neither waits for the
+ * other (unless asked to, see sim_backpressure).
+ *
+ *\code{.cpp}
+ * morph::sim_runner<morph::vvec<float>> runner;
+ * runner.publish_interval = 1.0 / 60.0; // no more snapshots than the display can show
+ * runner.start ([&model]() { model.step(); return true; },
+ *               [&model](morph::vvec<float>& snap) { snap = model.u; });
+ * while (!v.readyToFinish()) {
+ *     v.poll();
+ *     if (const morph::vvec<float>* u = runner.latest()) {
+ *         // copy *u into the data a VisualModel shows and reinit it
+ *     }
+ *     v.render();
+ * }
+ * runner.stop();
+ *\endcode
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <exception>
+#include <array>
+#include <stdexcept>
+#include <cstdint>
+
+namespace morph {
+
+    /*!
+     * A lock free, single producer, single consumer triple buffer. The producer fills back(),
+     * then publish() swaps it with the middle buffer. The consumer's acquire() swaps the
+     * middle buffer, if it holds something new, with front(). Both sides always have a buffer
+     * of their own, so neither ever blocks; a snapshot published before the consumer took
+     * the previous one replaces it.
+     */
+    template <typename T>
+    class triple_buffer
+    {
+    public:
+        //! The buffer that the producer is filling
+        T& back() { return this->buf[this->back_i]; }
+
+        //! Make the back buffer the one the consumer takes next
+        void publish()
+        {
+            const std::uint8_t prev = this->middle.exchange (this->back_i | fresh, std::memory_order_acq_rel);
+            this->back_i = prev & index_mask;
+        }
+
+        /*!
+         * Take the latest published buffer, if there is one that hasn't been taken yet, as
+         * front(). Returns true if front() changed.
+         */
+        bool acquire()
+        {
+            if ((this->middle.load (std::memory_order_relaxed) & fresh) == 0) { return false; }
+            const std::uint8_t prev = this->middle.exchange (this->front_i, std::memory_order_acq_rel);
+            this->front_i = prev & index_mask;
+            return true;
+        }
+
+        //! The consumer's buffer, the latest one acquired
+        const T& front() const { return this->buf[this->front_i]; }
+
+        //! True if a buffer has been published that the consumer has not yet taken. Either side may ask.
+        bool pending() const { return (this->middle.load (std::memory_order_acquire) & fresh) != 0; }
+
+    private:
+        static constexpr std::uint8_t index_mask = 0x3;
+        static constexpr std::uint8_t fresh = 0x4;
+        std::array<T, 3> buf = {};
+        // The producer's and the consumer's indices into buf, and the middle one with the fresh bit
+        std::uint8_t back_i = 0;
+        std::uint8_t front_i = 1;
+        std::atomic<std::uint8_t> middle = 2;
+    };
+
+    //! What sim_runner does when a snapshot is due but the renderer hasn't taken the last one
+    enum class sim_backpressure
+    {
+        overwrite, // Publish anyway; the renderer only ever sees the latest snapshot
+        skip,      // Don't write the snapshot (saving the copy) and carry on stepping
+        block      // Wait for the renderer to take the last snapshot, so it sees every one
+    };
+
+    /*!
+     * Runs a simulation on its own thread and hands snapshots of its state (of type S) to
+     * the thread that renders it.
+     *
+     * The simulation is given as a step function, called repeatedly (it returns false to
+     * end the run), and a snapshot function that writes the current state into an S. A
+     * snapshot is due every publish_every steps, and no sooner than publish_interval seconds
+     * after the last one. Each S is reused, so the snapshot function can assign into it
+     * without allocating once it has reached its size.
+     */
+    template <typename S>
+    class sim_runner
+    {
+    public:
+        //! Publish a snapshot every this many steps (at least 1)
+        unsigned int publish_every = 1;
+        //! ...but no more often than this, in seconds. 0 for no limit.
+        double publish_interval = 0.0;
+        //! What to do when the renderer falls behind
+        sim_backpressure backpressure = sim_backpressure::overwrite;
+        //! If greater than 0, the run ends after this many steps
+        std::uint64_t max_steps = 0;
+
+        sim_runner() = default;
+        sim_runner (const sim_runner&) = delete;
+        sim_runner& operator= (const sim_runner&) = delete;
+        ~sim_runner()
+        {
+            this->halt();
+            if (this->worker.joinable()) { this->worker.join(); }
+        }
+
+        /*!
+         * Start the simulation thread. step() is called until it returns false, max_steps is
+         * reached or stop() is called; snapshot (S&) writes the state into a snapshot, and is
+         * called once before the first step and then as publish_every and publish_interval
+         * allow, and after the last step. Both run on the simulation thread. Set the
+         * publishing parameters before calling this.
+         */
+        template <typename StepFn, typename SnapFn>
+        void start (StepFn step, SnapFn snapshot)
+        {
+            if (this->worker.joinable()) { throw std::runtime_error ("sim_runner: already started"); }
+            if (this->publish_every == 0) { throw std::runtime_error ("sim_runner: publish_every must be at least 1"); }
+            this->stop_flag = false;
+            this->finished = false;
+            this->error = nullptr;
+            this->worker = std::thread ([this, step, snapshot]() mutable { this->run (step, snapshot); });
+        }
+
+        /*!
+         * The latest snapshot, if one has been published since the last call, or nullptr. The
+         * snapshot stays valid, and is not written to, until the next call. Rethrows an
+         * exception that ended the simulation. Call from one thread only.
+         */
+        const S* latest()
+        {
+            if (!this->snapshots.acquire()) {
+                // error is written before finished is set
+                if (this->finished.load (std::memory_order_acquire) && this->error) { std::rethrow_exception (this->error); }
+                return nullptr;
+            }
+            this->wake();
+            return &this->snapshots.front().state;
+        }
+
+        //! The snapshot last returned by latest()
+        const S& current() const { return this->snapshots.front().state; }
+
+        //! The step number (the number of steps completed) of the snapshot last returned by latest()
+        std::uint64_t current_step() const { return this->snapshots.front().step; }
+
+        //! The number of steps the simulation has completed
+        std::uint64_t steps() const { return this->step_count.load (std::memory_order_relaxed); }
+
+        //! The number of snapshots published
+        std::uint64_t published() const { return this->publish_count.load (std::memory_order_relaxed); }
+
+        //! True once start() has been called and until the simulation ends
+        bool running() const { return this->worker.joinable() && !this->finished.load (std::memory_order_acquire); }
+
+        //! Pause or resume stepping. A paused simulation sleeps, after publishing the state it paused in.
+        void pause (const bool p = true)
+        {
+            this->paused = p;
+            this->paused.notify_all();
+        }
+        bool is_paused() const { return this->paused.load(); }
+
+        /*!
+         * End the simulation after its current step and join its thread. Rethrows an exception
+         * that ended the simulation. A snapshot of the final state may still be taken with
+         * latest().
+         */
+        void stop()
+        {
+            this->halt();
+            if (this->worker.joinable()) { this->worker.join(); }
+            if (this->error) {
+                std::exception_ptr e = this->error;
+                this->error = nullptr;
+                std::rethrow_exception (e);
+            }
+        }
+
+    private:
+        //! A snapshot and the step at which it was taken
+        struct slot
+        {
+            S state = {};
+            std::uint64_t step = 0;
+        };
+
+        template <typename StepFn, typename SnapFn>
+        void run (StepFn& step, SnapFn& snapshot)
+        {
+            using sc = std::chrono::steady_clock;
+            try {
+                sc::time_point last_pub = sc::now();
+                this->publish (snapshot, 0);
+                std::uint64_t n = 0;
+                std::uint64_t last_n = 0;
+                // The last step at which a snapshot was due, published or not
+                std::uint64_t last_due = 0;
+                while (!this->stop_flag.load (std::memory_order_relaxed)) {
+                    if (this->paused.load (std::memory_order_relaxed)) {
+                        if (last_n != n) { this->publish (snapshot, n); last_n = n; }
+                        this->paused.wait (true);
+                        continue;
+                    }
+                    if (this->max_steps > 0 && n >= this->max_steps) { break; }
+                    const bool more = step();
+                    this->step_count.store (++n, std::memory_order_relaxed);
+                    if (!more) { break; }
+                    if (n - last_due < this->publish_every) { continue; }
+                    last_due = n;
+                    if (this->publish_interval > 0.0) {
+                        const sc::time_point t = sc::now();
+                        if (std::chrono::duration<double>(t - last_pub).count() < this->publish_interval) { continue; }
+                        last_pub = t;
+                    }
+                    if (this->snapshots.pending()) {
+                        if (this->backpressure == sim_backpressure::skip) { continue; }
+                        if (this->backpressure == sim_backpressure::block) { this->wait_taken(); }
+                    }
+                    this->publish (snapshot, n);
+                    last_n = n;
+                }
+                // The final state, unless it was just published
+                if (last_n != n) {
+                    if (this->backpressure == sim_backpressure::block) { this->wait_taken(); }
+                    this->publish (snapshot, n);
+                }
+            } catch (...) {
+                this->error = std::current_exception();
+            }
+            this->finished.store (true, std::memory_order_release);
+        }
+
+        template <typename SnapFn>
+        void publish (SnapFn& snapshot, const std::uint64_t n)
+        {
+            slot& b = this->snapshots.back();
+            snapshot (b.state);
+            b.step = n;
+            this->snapshots.publish();
+            this->publish_count.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        //! Wait (for sim_backpressure::block) until the renderer has taken the last snapshot, or stop()
+        void wait_taken()
+        {
+            std::uint32_t t = this->taken.load (std::memory_order_acquire);
+            while (this->snapshots.pending() && !this->stop_flag.load (std::memory_order_relaxed)) {
+                this->taken.wait (t);
+                t = this->taken.load (std::memory_order_acquire);
+            }
+        }
+
+        //! Tell the simulation thread to end, waking it if it waits
+        void halt()
+        {
+            this->stop_flag = true;
+            this->pause (false);
+            this->wake();
+        }
+
+        //! Wake the simulation thread if it is waiting for a snapshot to be taken
+        void wake()
+        {
+            this->taken.fetch_add (1, std::memory_order_release);
+            this->taken.notify_one();
+        }
+
+        triple_buffer<slot> snapshots;
+        std::thread worker;
+        std::atomic<bool> stop_flag = false;
+        std::atomic<bool> paused = false;
+        std::atomic<bool> finished = false;
+        std::atomic<std::uint64_t> step_count = 0;
+        std::atomic<std::uint64_t> publish_count = 0;
+        //! Bumped by the renderer each time it takes a snapshot (the futex for wait_taken)
+        std::atomic<std::uint32_t> taken = 0;
+        //! Set by the simulation thread before finished
+        std::exception_ptr error = nullptr;
+    };
+
+} // namespace morph
@@ -0,0 +1,232 @@
+/*!
+ * \file
+ *
+ * Four-lane float kernels (SSE or NEON) for morph::vec<float, 4> and morph::mat44<float>. These
+ * are the runtime paths behind the small fixed size vector and matrix operations that run for
+ * every model transform. The callers in vec.h and mat44.h use them only when
+ * std::is_constant_evaluated() is false, so the constexpr code remains the compile time path.
+ *
+ * MORPH_SIMD4 is defined when a four-lane float instruction set is available (SSE on x86, NEON on
+ * AArch64). Define MORPH_NO_SIMD before including any morphologica header to use the generic
+ * code everywhere.
+ *
+ * Matrices are 16 floats in column major order, as in morph::mat44::mat. Each function is written
+ * in terms of a handful of lane primitives, so the SSE and NEON builds share the kernels.
+ */
+#pragma once
+
+#include <cstddef>
+
+#if !defined(MORPH_NO_SIMD)
+# if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  include <xmmintrin.h>
+#  define MORPH_SIMD4 1
+#  define MORPH_SIMD4_SSE 1
+# elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define MORPH_SIMD4 1
+#  define MORPH_SIMD4_NEON 1
+# endif
+#endif
+
+#ifdef MORPH_SIMD4
+
+namespace morph::simd4 {
+
+#ifdef MORPH_SIMD4_SSE
+    using f4 = __m128;
+    inline f4 load (const float* p) { return _mm_loadu_ps (p); }
+    inline void store (float* p, const f4 a) { _mm_storeu_ps (p, a); }
+    inline f4 set1 (const float f) { return _mm_set1_ps (f); }
+    inline f4 set (const float a, const float b, const float c, const float d) { return _mm_setr_ps (a, b, c, d); }
+    inline f4 add (const f4 a, const f4 b) { return _mm_add_ps (a, b); }
+    inline f4 sub (const f4 a, const f4 b) { return _mm_sub_ps (a, b); }
+    inline f4 mul (const f4 a, const f4 b) { return _mm_mul_ps (a, b); }
+    inline f4 div (const f4 a, const f4 b) { return _mm_div_ps (a, b); }
+    inline float lane0 (const f4 a) { return _mm_cvtss_f32 (a); }
+    //! Lanes x and y of a, then lanes z and w of b (as _mm_shuffle_ps)
+    template <int x, int y, int z, int w>
+    inline f4 shuffle (const f4 a, const f4 b) { return _mm_shuffle_ps (a, b, _MM_SHUFFLE (w, z, y, x)); }
+#else // NEON
+    using f4 = float32x4_t;
+    inline f4 load (const float* p) { return vld1q_f32 (p); }
+    inline void store (float* p, const f4 a) { vst1q_f32 (p, a); }
+    inline f4 set1 (const float f) { return vdupq_n_f32 (f); }
+    inline f4 set (const float a, const float b, const float c, const float d)
+    {
+        const float v[4] = { a, b, c, d };
+        return vld1q_f32 (v);
+    }
+    inline f4 add (const f4 a, const f4 b) { return vaddq_f32 (a, b); }
+    inline f4 sub (const f4 a, const f4 b) { return vsubq_f32 (a, b); }
+    inline f4 mul (const f4 a, const f4 b) { return vmulq_f32 (a, b); }
+    inline f4 div (const f4 a, const f4 b) { return vdivq_f32 (a, b); }
+    inline float lane0 (const f4 a) { return vgetq_lane_f32 (a, 0); }
+    //! Lanes x and y of a, then lanes z and w of b (as _mm_shuffle_ps)
+    template <int x, int y, int z, int w>
+    inline f4 shuffle (const f4 a, const f4 b)
+    {
+        const float32x2_t lo = vset_lane_f32 (vgetq_lane_f32 (a, y), vdup_n_f32 (vgetq_lane_f32 (a, x)), 1);
+        const float32x2_t hi = vset_lane_f32 (vgetq_lane_f32 (b, w), vdup_n_f32 (vgetq_lane_f32 (b, z)), 1);
+        return vcombine_f32 (lo, hi);
+    }
+#endif
+
+    template <int x, int y, int z, int w>
+    inline f4 swizzle (const f4 a) { return shuffle<x, y, z, w> (a, a); }
+
+    //! r = a + b, r = a - b and r = a * b for four floats. r may alias a or b.
+    inline void add4 (const float* a, const float* b, float* r) { store (r, add (load (a), load (b))); }
+    inline void sub4 (const float* a, const float* b, float* r) { store (r, sub (load (a), load (b))); }
+    inline void mul4 (const float* a, const float* b, float* r) { store (r, mul (load (a), load (b))); }
+    inline void mul4 (const float* a, const float s, float* r) { store (r, mul (load (a), set1 (s))); }
+
+    //! 4x4 matrix product r = a * b. The sums are made in the same order as mat44's scalar code.
+    //! r may alias a or b.
+    inline void mat44_mul (const float* a, const float* b, float* r)
+    {
+        const f4 c0 = load (a);
+        const f4 c1 = load (a + 4);
+        const f4 c2 = load (a + 8);
+        const f4 c3 = load (a + 12);
+        for (int j = 0; j < 4; ++j) {
+            const float* bj = b + 4 * j;
+            const f4 b0 = set1 (bj[0]);
+            const f4 b1 = set1 (bj[1]);
+            const f4 b2 = set1 (bj[2]);
+            const f4 b3 = set1 (bj[3]);
+            store (r + 4 * j, add (add (add (mul (c0, b0), mul (c1, b1)), mul (c2, b2)), mul (c3, b3)));
+        }
+    }
+
+    //! a = a * b where b is a pure rotation (its last row and column are those of the identity),
+    //! so only the first three columns of a change.
+    inline void mat44_mul_rotation (float* a, const float* b)
+    {
+        const f4 c0 = load (a);
+        const f4 c1 = load (a + 4);
+        const f4 c2 = load (a + 8);
+        f4 r[3];
+        for (int j = 0; j < 3; ++j) {
+            const float* bj = b + 4 * j;
+            r[j] = add (add (mul (c0, set1 (bj[0])), mul (c1, set1 (bj[1]))), mul (c2, set1 (bj[2])));
+        }
+        for (int j = 0; j < 3; ++j) { store (a + 4 * j, r[j]); }
+    }
+
+    //! r = m * v for a 4 element v. r may alias v.
+    inline void mat44_mulv (const float* m, const float* v, float* r)
+    {
+        const f4 v0 = set1 (v[0]);
+        const f4 v1 = set1 (v[1]);
+        const f4 v2 = set1 (v[2]);
+        const f4 v3 = set1 (v[3]);
+        store (r, add (add (add (mul (load (m), v0), mul (load (m + 4), v1)), mul (load (m + 8), v2)), mul (load (m + 12), v3)));
+    }
+
+    //! r = m * (v, 1) for a 3 element v, giving 4 elements in r.
+    inline void mat44_mulv3 (const float* m, const float* v, float* r)
+    {
+        const f4 v0 = set1 (v[0]);
+        const f4 v1 = set1 (v[1]);
+        const f4 v2 = set1 (v[2]);
+        store (r, add (add (add (mul (load (m), v0), mul (load (m + 4), v1)), mul (load (m + 8), v2)), load (m + 12)));
+    }
+
+    /*!
+     * Apply m to n 3D points (w = 1) or, if \a points is false, to n 3D directions (w = 0),
+     * writing the x, y and z of each result. in and out hold 3n floats and may be the same
+     * array. The w component of m * v is discarded (there is no perspective divide).
+     */
+    inline void mat44_transform3 (const float* m, const float* in, float* out, const std::size_t n, const bool points)
+    {
+        const f4 c0 = load (m);
+        const f4 c1 = load (m + 4);
+        const f4 c2 = load (m + 8);
+        const f4 c3 = points ? load (m + 12) : set1 (0.0f);
+        alignas(16) float r[4];
+        for (std::size_t i = 0; i < n; ++i) {
+            const float* v = in + 3 * i;
+            store (r, add (add (add (mul (c0, set1 (v[0])), mul (c1, set1 (v[1]))), mul (c2, set1 (v[2]))), c3));
+            float* o = out + 3 * i;
+            o[0] = r[0];
+            o[1] = r[1];
+            o[2] = r[2];
+        }
+    }
+
+    namespace detail {
+        // 2x2 matrices held in one f4 as [a b c d] = | a b ; c d |
+        inline f4 mat2_mul (const f4 v1, const f4 v2)
+        {
+            return add (mul (v1, swizzle<0, 3, 0, 3> (v2)), mul (swizzle<1, 0, 3, 2> (v1), swizzle<2, 1, 2, 1> (v2)));
+        }
+        // adj(v1) * v2
+        inline f4 mat2_adjmul (const f4 v1, const f4 v2)
+        {
+            return sub (mul (swizzle<3, 3, 0, 0> (v1), v2), mul (swizzle<1, 1, 2, 2> (v1), swizzle<2, 3, 0, 1> (v2)));
+        }
+        // v1 * adj(v2)
+        inline f4 mat2_muladj (const f4 v1, const f4 v2)
+        {
+            return sub (mul (v1, swizzle<3, 0, 3, 0> (v2)), mul (swizzle<1, 0, 3, 2> (v1), swizzle<2, 1, 2, 1> (v2)));
+        }
+    }
+
+    /*!
+     * Invert the 4x4 matrix m into r by blockwise inversion of its 2x2 sub-matrices. Returns
+     * false, leaving r untouched, if the determinant is 0. Because the inverse of the transpose
+     * is the transpose of the inverse, the same code serves row or column major storage. r may
+     * alias m.
+     */
+    inline bool mat44_inverse (const float* m, float* r)
+    {
+        using namespace detail;
+        const f4 r0 = load (m);
+        const f4 r1 = load (m + 4);
+        const f4 r2 = load (m + 8);
+        const f4 r3 = load (m + 12);
+
+        const f4 A = shuffle<0, 1, 0, 1> (r0, r1);
+        const f4 B = shuffle<2, 3, 2, 3> (r0, r1);
+        const f4 C = shuffle<0, 1, 0, 1> (r2, r3);
+        const f4 D = shuffle<2, 3, 2, 3> (r2, r3);
+
+        // The determinants of A, B, C and D in lanes 0 to 3
+        const f4 det_sub = sub (mul (shuffle<0, 2, 0, 2> (r0, r2), shuffle<1, 3, 1, 3> (r1, r3)),
+                                mul (shuffle<1, 3, 1, 3> (r0, r2), shuffle<0, 2, 0, 2> (r1, r3)));
+        const f4 det_a = swizzle<0, 0, 0, 0> (det_sub);
+        const f4 det_b = swizzle<1, 1, 1, 1> (det_sub);
+        const f4 det_c = swizzle<2, 2, 2, 2> (det_sub);
+        const f4 det_d = swizzle<3, 3, 3, 3> (det_sub);
+
+        const f4 d_c = mat2_adjmul (D, C);
+        const f4 a_b = mat2_adjmul (A, B);
+        f4 X = sub (mul (det_d, A), mat2_mul (B, d_c));
+        f4 W = sub (mul (det_a, D), mat2_mul (C, a_b));
+        f4 Y = sub (mul (det_b, C), mat2_muladj (D, a_b));
+        f4 Z = sub (mul (det_c, B), mat2_muladj (A, d_c));
+
+        // |M| = |A||D| + |B||C| - tr((A# B)(D# C))
+        f4 tr = mul (a_b, swizzle<0, 2, 1, 3> (d_c));
+        tr = add (tr, swizzle<2, 3, 0, 1> (tr));
+        tr = add (tr, swizzle<1, 0, 3, 2> (tr));
+        const f4 det_m = sub (add (mul (det_a, det_d), mul (det_b, det_c)), tr);
+        if (lane0 (det_m) == 0.0f) { return false; }
+
+        const f4 r_det_m = div (set (1.0f, -1.0f, -1.0f, 1.0f), det_m);
+        X = mul (X, r_det_m);
+        Y = mul (Y, r_det_m);
+        Z = mul (Z, r_det_m);
+        W = mul (W, r_det_m);
+
+        store (r, shuffle<3, 1, 3, 1> (X, Y));
+        store (r + 4, shuffle<2, 0, 2, 0> (X, Y));
+        store (r + 8, shuffle<3, 1, 3, 1> (Z, W));
+        store (r + 12, shuffle<2, 0, 2, 0> (Z, W));
+        return true;
+    }
+
+} // namespace morph::simd4
+
+#endif // MORPH_SIMD4
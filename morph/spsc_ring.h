@@ -0,0 +1,116 @@
+/*!
+ * \file
+ *
+ * A lock free ring buffer for one producer thread and one consumer thread. GraphVisual uses
+ * these so that other threads can push data into a graph without holding the OpenGL context
+ * (see GraphVisual::push).
+ */
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * A bounded queue of T, lock free for one producer and one consumer. push() and pop()
+     * never block: push() returns false when the ring is full, pop() when it is empty. The
+     * consumer can take everything queued at once with pop_all(), which is the cheap way to
+     * drain it. T should be cheap to copy.
+     */
+    template <typename T>
+    class spsc_ring
+    {
+    public:
+        //! A ring for at least capacity elements (rounded up to a power of 2)
+        explicit spsc_ring (const std::size_t capacity)
+        {
+            if (capacity == 0) { throw std::runtime_error ("spsc_ring: capacity must be at least 1"); }
+            std::size_t n = 1;
+            while (n < capacity) { n <<= 1; }
+            this->buf.resize (n);
+            this->mask = n - 1;
+        }
+        spsc_ring (const spsc_ring&) = delete;
+        spsc_ring& operator= (const spsc_ring&) = delete;
+
+        //! Producer: add x. Returns false, dropping x, if the ring is full.
+        bool push (const T& x)
+        {
+            const std::size_t t = this->tail.load (std::memory_order_relaxed);
+            if (t - this->head_cache == this->buf.size()) {
+                this->head_cache = this->head.load (std::memory_order_acquire);
+                if (t - this->head_cache == this->buf.size()) { return false; }
+            }
+            this->buf[t & this->mask] = x;
+            this->tail.store (t + 1, std::memory_order_release);
+            return true;
+        }
+
+        //! Producer: add as many of xs as fit (from the front). Returns the number added.
+        std::size_t push (std::span<const T> xs)
+        {
+            const std::size_t t = this->tail.load (std::memory_order_relaxed);
+            if (t - this->head_cache + xs.size() > this->buf.size()) { this->head_cache = this->head.load (std::memory_order_acquire); }
+            const std::size_t n = std::min (xs.size(), this->buf.size() - (t - this->head_cache));
+            for (std::size_t i = 0; i < n; ++i) { this->buf[(t + i) & this->mask] = xs[i]; }
+            this->tail.store (t + n, std::memory_order_release);
+            return n;
+        }
+
+        //! Consumer: take the oldest element into x. Returns false if the ring is empty.
+        bool pop (T& x)
+        {
+            const std::size_t h = this->head.load (std::memory_order_relaxed);
+            if (h == this->tail_cache) {
+                this->tail_cache = this->tail.load (std::memory_order_acquire);
+                if (h == this->tail_cache) { return false; }
+            }
+            x = this->buf[h & this->mask];
+            this->head.store (h + 1, std::memory_order_release);
+            return true;
+        }
+
+        //! Consumer: append everything queued to out, in order. Returns the number taken.
+        std::size_t pop_all (std::vector<T>& out)
+        {
+            const std::size_t h = this->head.load (std::memory_order_relaxed);
+            this->tail_cache = this->tail.load (std::memory_order_acquire);
+            const std::size_t n = this->tail_cache - h;
+            out.reserve (out.size() + n);
+            for (std::size_t i = 0; i < n; ++i) { out.push_back (this->buf[(h + i) & this->mask]); }
+            this->head.store (h + n, std::memory_order_release);
+            return n;
+        }
+
+        //! The number of elements queued. Exact on either thread when the other is idle.
+        std::size_t size() const
+        {
+            // head first: tail can only have moved on since, so this can't go negative
+            const std::size_t h = this->head.load (std::memory_order_acquire);
+            return this->tail.load (std::memory_order_acquire) - h;
+        }
+
+        bool empty() const { return this->size() == 0; }
+
+        std::size_t capacity() const { return this->buf.size(); }
+
+    private:
+        // A cache line (std::hardware_destructive_interference_size warns in GCC headers)
+        static constexpr std::size_t line = 64;
+        std::vector<T> buf;
+        std::size_t mask = 0;
+        // The consumer's position and its copy of the producer's, then the producer's and its
+        // copy of the consumer's, each pair on its own cache line
+        alignas(line) std::atomic<std::size_t> head = 0;
+        std::size_t tail_cache = 0;
+        alignas(line) std::atomic<std::size_t> tail = 0;
+        std::size_t head_cache = 0;
+    };
+
+} // namespace morph
@@ -0,0 +1,411 @@
+/*!
+ * \file
+ *
+ * A compile-time stencil description and an engine that applies stencils to fields
+ * defined on morph::Grid, morph::Gridct, morph::CartGrid and morph::HexGrid.
+ *
+ * The rectangular grids are processed in cache-sized tiles, in parallel with OpenMP. In
+ * the interior of the grid, each output is a fixed, unrolled sum over constant index
+ * offsets with no bounds or wrap tests. Only the strips within the stencil's radius of
+ * an edge take the slow path. Grids with arbitrary boundaries (HexGrid, and CartGrid with
+ * GridDomainShape::Boundary) are processed as a gather over their d_ neighbour vectors.
+ *
+ * \code
+ * // A Laplacian on a Grid (whose dx[0] == dx[1] == d)
+ * morph::apply_stencil<morph::stencils::laplace5<float>> (grid, F, lapF, 1.0f / (d * d));
+ *
+ * // A fused update of two fields, A and B, of a reaction diffusion model on a HexGrid.
+ * // The lambda gets the stencil sum for each field at hex h.
+ * constexpr auto lap = morph::stencils::hex_laplace<float>;
+ * const float norm = 2.0f / (3.0f * d * d);
+ * morph::apply_stencil_fused<lap> (*hg, [&](std::size_t h, const std::array<float, 2>& s) {
+ *     dA[h] = DA * norm * s[0] + f_A (A[h], B[h]);
+ *     dB[h] = DB * norm * s[1] + f_B (A[h], B[h]);
+ * }, A, B);
+ * \endcode
+ */
+
+#pragma once
+
+#include <morph/GridFeatures.h>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace morph {
+
+    /*!
+     * One term of a stencil: weight times the field value dc elements to the east and dr
+     * elements to the north. On a HexGrid, (dc, dr) are steps along the ri and gi axes, so
+     * that (1,0) is the neighbour east, (0,1) north-east, (-1,1) north-west, (-1,0) west,
+     * (0,-1) south-west and (1,-1) south-east.
+     */
+    template <typename T>
+    struct stencil_tap
+    {
+        int dc = 0;
+        int dr = 0;
+        T weight = T{0};
+    };
+
+    /*!
+     * A stencil of N taps. It is a structural type, so a constexpr stencil can be passed
+     * as a template argument to apply_stencil(), which unrolls the sum over the taps and
+     * treats the weights as constants.
+     *
+     * Where a tap falls off an edge of a rectangular grid that does not wrap there, the
+     * field is reflected in that edge, so a tap one element beyond the edge takes the value
+     * of the element on the edge. For the Laplacians, this is a zero-flux boundary
+     * condition. On a HexGrid (and a CartGrid with a boundary), a missing neighbour takes
+     * the value of the centre element, as in RD_Base::compute_laplace().
+     */
+    template <typename T, std::size_t N>
+    struct stencil
+    {
+        using value_type = T;
+        std::array<stencil_tap<T>, N> taps;
+
+        //! The largest offset, in either direction, of any tap
+        constexpr int radius() const
+        {
+            int r = 0;
+            for (auto t : this->taps) {
+                r = std::max (r, std::max (t.dc < 0 ? -t.dc : t.dc, t.dr < 0 ? -t.dr : t.dr));
+            }
+            return r;
+        }
+
+        //! True if every tap is the centre or one of its 6 neighbours on a HexGrid
+        constexpr bool hex_compatible() const
+        {
+            for (auto t : this->taps) { if (stencil::hex_direction (t.dc, t.dr) < 0) { return false; } }
+            return true;
+        }
+
+        //! The HexGrid direction of offset (dc, dr): 0 for the centre, then 1 to 6 for
+        //! ne, nne, nnw, nw, nsw, nse. -1 if (dc, dr) is not a hex neighbour.
+        static constexpr int hex_direction (const int dc, const int dr)
+        {
+            if (dc == 0 && dr == 0) { return 0; }
+            if (dc == 1 && dr == 0) { return 1; }
+            if (dc == 0 && dr == 1) { return 2; }
+            if (dc == -1 && dr == 1) { return 3; }
+            if (dc == -1 && dr == 0) { return 4; }
+            if (dc == 0 && dr == -1) { return 5; }
+            if (dc == 1 && dr == -1) { return 6; }
+            return -1;
+        }
+
+        //! The CartGrid direction of offset (dc, dr): 0 for the centre, then 1 to 8 for
+        //! ne, nne, nn, nnw, nw, nsw, ns, nse. -1 if (dc, dr) is not an immediate neighbour.
+        static constexpr int cart_direction (const int dc, const int dr)
+        {
+            if (dc < -1 || dc > 1 || dr < -1 || dr > 1) { return -1; }
+            constexpr int dirs[3][3] = { { 6, 7, 8 },   // dr = -1: nsw, ns, nse
+                                         { 5, 0, 1 },   // dr = 0:  nw, centre, ne
+                                         { 4, 3, 2 } }; // dr = 1:  nnw, nn, nne
+            return dirs[dr + 1][dc + 1];
+        }
+    };
+
+    //! Some commonly used stencils. The caller supplies the scale that accounts for the grid spacing.
+    namespace stencils {
+        //! The 5 point Laplacian. Scale by 1/dx^2.
+        template <typename T>
+        constexpr stencil<T, 5> laplace5 = { { { { 0, 0, T{-4} }, { 1, 0, T{1} }, { -1, 0, T{1} }, { 0, 1, T{1} }, { 0, -1, T{1} } } } };
+
+        //! The 9 point isotropic Laplacian. Scale by 1/dx^2.
+        template <typename T>
+        constexpr stencil<T, 9> laplace9 = { { { { 0, 0, T{-20} / T{6} },
+                                                 { 1, 0, T{4} / T{6} }, { -1, 0, T{4} / T{6} }, { 0, 1, T{4} / T{6} }, { 0, -1, T{4} / T{6} },
+                                                 { 1, 1, T{1} / T{6} }, { -1, 1, T{1} / T{6} }, { -1, -1, T{1} / T{6} }, { 1, -1, T{1} / T{6} } } } };
+
+        //! The 7 point hexagonal Laplacian used by RD_Base::compute_laplace(). Scale by 2/(3d^2).
+        template <typename T>
+        constexpr stencil<T, 7> hex_laplace = { { { { 0, 0, T{-6} }, { 1, 0, T{1} }, { 0, 1, T{1} }, { -1, 1, T{1} },
+                                                    { -1, 0, T{1} }, { 0, -1, T{1} }, { 1, -1, T{1} } } } };
+
+        //! Central difference in x. Scale by 1/dx.
+        template <typename T>
+        constexpr stencil<T, 2> ddx = { { { { 1, 0, T{0.5} }, { -1, 0, T{-0.5} } } } };
+
+        //! Central difference in y. Scale by 1/dy.
+        template <typename T>
+        constexpr stencil<T, 2> ddy = { { { { 0, 1, T{0.5} }, { 0, -1, T{-0.5} } } } };
+    }
+
+    namespace stencil_detail {
+
+        //! The storage layout of a rectangular grid: element (a, b) is at index b * na + a
+        struct rect_layout
+        {
+            long long na = 0;
+            long long nb = 0;
+            bool wrap_a = false;
+            bool wrap_b = false;
+            //! Map a tap's (dc, dr) onto (da, db)
+            bool colmaj = false;
+            bool north_is_minus_b = false;
+            constexpr std::array<long long, 2> map (const int dc, const int dr) const
+            {
+                const long long dy = this->north_is_minus_b ? -dr : dr;
+                return this->colmaj ? std::array<long long, 2>{ dy, dc } : std::array<long long, 2>{ dc, dy };
+            }
+        };
+
+        //! Grid and Gridct both provide these getters
+        template <typename G>
+        concept rectangular_grid = requires (const G& g) { g.get_w(); g.get_h(); g.get_wrap(); g.get_order(); };
+
+        //! CartGrid
+        template <typename G>
+        concept cart_grid = requires (const G& g) { g.d_nn; g.d_nne; g.w_px; g.h_px; g.domainShape; g.domainWrap; };
+
+        //! HexGrid (which, unlike CartGrid, has no north neighbours)
+        template <typename G>
+        concept hex_grid = requires (const G& g) { g.d_ne; g.d_nne; g.d_nnw; g.d_nsw; } && !cart_grid<G>;
+
+        constexpr rect_layout make_layout (const long long w, const long long h, const GridDomainWrap wrap, const GridOrder order)
+        {
+            rect_layout l;
+            l.colmaj = (order == GridOrder::bottomleft_to_topright_colmaj || order == GridOrder::topleft_to_bottomright_colmaj);
+            l.north_is_minus_b = (order == GridOrder::topleft_to_bottomright || order == GridOrder::topleft_to_bottomright_colmaj);
+            const bool wrap_h = (wrap == GridDomainWrap::Horizontal || wrap == GridDomainWrap::Both);
+            const bool wrap_v = (wrap == GridDomainWrap::Vertical || wrap == GridDomainWrap::Both);
+            l.na = l.colmaj ? h : w;
+            l.nb = l.colmaj ? w : h;
+            l.wrap_a = l.colmaj ? wrap_v : wrap_h;
+            l.wrap_b = l.colmaj ? wrap_h : wrap_v;
+            return l;
+        }
+
+        //! The index offset of each of S's taps from an interior element of layout l
+        template <auto S>
+        constexpr std::array<long long, S.taps.size()> tap_offsets (const rect_layout& l)
+        {
+            std::array<long long, S.taps.size()> off{};
+            for (std::size_t k = 0; k < S.taps.size(); ++k) {
+                const std::array<long long, 2> d = l.map (S.taps[k].dc, S.taps[k].dr);
+                off[k] = d[1] * l.na + d[0];
+            }
+            return off;
+        }
+
+        // The unrolled interior sum over the taps
+        template <auto S, typename T, std::size_t... k>
+        inline T tap_sum (const T* f, const long long i, const long long* off, std::index_sequence<k...>)
+        {
+            return ((S.taps[k].weight * f[i + off[k]]) + ...);
+        }
+
+        // The unrolled interior sum with compile-time offsets, which become immediate operands
+        template <auto S, auto off, typename T, std::size_t... k>
+        inline T tap_sum_ct (const T* f, const long long i, std::index_sequence<k...>)
+        {
+            return ((S.taps[k].weight * f[i + off[k]]) + ...);
+        }
+
+        constexpr rect_layout as_layout (std::nullptr_t) { return rect_layout{}; }
+        constexpr rect_layout as_layout (const rect_layout& l) { return l; }
+
+        /*!
+         * Apply S to the K fields on a rectangular layout, calling update (i, sums) for each
+         * element i. The tiles are tile_a elements along the contiguous dimension by tile_b.
+         *
+         * If CtL is a rect_layout (equal to l) rather than nullptr, the grid dimensions and
+         * the tap offsets are compile-time constants.
+         */
+        template <auto S, std::size_t K, typename T, typename F, auto CtL = nullptr>
+        void rect_apply (const rect_layout& l, const std::array<const T*, K>& fields, F& update)
+        {
+            constexpr std::size_t N = S.taps.size();
+            constexpr long long rad = S.radius();
+            constexpr long long tile_a = 1024;
+            constexpr long long tile_b = 32;
+            constexpr bool ct = !std::is_same_v<std::remove_cvref_t<decltype(CtL)>, std::nullptr_t>;
+            static constexpr rect_layout cl = stencil_detail::as_layout (CtL);
+            static constexpr std::array<long long, N> off_ct = stencil_detail::tap_offsets<S> (cl);
+
+            std::array<std::array<long long, 2>, N> d;
+            for (std::size_t k = 0; k < N; ++k) { d[k] = l.map (S.taps[k].dc, S.taps[k].dr); }
+            const std::array<long long, N> off = stencil_detail::tap_offsets<S> (l);
+
+            const long long na = ct ? cl.na : l.na;
+            const long long nb = ct ? cl.nb : l.nb;
+            // Wrap or reflect a coordinate that has fallen off the grid
+            auto fold = [](long long x, const long long len, const bool wrap) {
+                if (x >= 0 && x < len) { return x; }
+                if (wrap) { return ((x % len) + len) % len; }
+                x = x < 0 ? -1 - x : 2 * len - 1 - x;
+                return std::clamp (x, 0LL, len - 1);
+            };
+            // The slow path, testing each tap
+            auto border = [&](const long long a, const long long b) {
+                std::array<long long, N> idx;
+                for (std::size_t k = 0; k < N; ++k) {
+                    idx[k] = fold (b + d[k][1], nb, l.wrap_b) * na + fold (a + d[k][0], na, l.wrap_a);
+                }
+                std::array<T, K> s;
+                for (std::size_t f = 0; f < K; ++f) {
+                    T sum = T{0};
+                    for (std::size_t k = 0; k < N; ++k) { sum += S.taps[k].weight * fields[f][idx[k]]; }
+                    s[f] = sum;
+                }
+                update (static_cast<std::size_t>(b * na + a), s);
+            };
+
+            const long long nta = (na + tile_a - 1) / tile_a;
+            const long long ntb = (nb + tile_b - 1) / tile_b;
+#pragma omp parallel for collapse(2) schedule(static)
+            for (long long tb = 0; tb < ntb; ++tb) {
+                for (long long ta = 0; ta < nta; ++ta) {
+                    const long long a0 = ta * tile_a;
+                    const long long a1 = std::min (na, a0 + tile_a);
+                    const long long b1 = std::min (nb, (tb + 1) * tile_b);
+                    for (long long b = tb * tile_b; b < b1; ++b) {
+                        // The range of a in this tile for which every tap is on the grid
+                        const bool b_interior = b >= rad && b < nb - rad;
+                        const long long ai0 = b_interior ? std::min (std::max (a0, rad), a1) : a1;
+                        const long long ai1 = std::max (ai0, std::min (a1, na - rad));
+                        for (long long a = a0; a < ai0; ++a) { border (a, b); }
+                        for (long long i = b * na + ai0; i < b * na + ai1; ++i) {
+                            std::array<T, K> s;
+                            for (std::size_t f = 0; f < K; ++f) {
+                                if constexpr (ct) {
+                                    s[f] = stencil_detail::tap_sum_ct<S, off_ct> (fields[f], i, std::make_index_sequence<N>{});
+                                } else {
+                                    s[f] = stencil_detail::tap_sum<S> (fields[f], i, off.data(), std::make_index_sequence<N>{});
+                                }
+                            }
+                            update (static_cast<std::size_t>(i), s);
+                        }
+                        for (long long a = ai1; a < a1; ++a) { border (a, b); }
+                    }
+                }
+            }
+        }
+
+        /*!
+         * Apply S to the K fields by gathering through neighbour index vectors (with -1
+         * for a missing neighbour). nbr[k] is the neighbour vector for tap k, or nullptr for
+         * the centre.
+         */
+        template <auto S, std::size_t K, typename T, typename F>
+        void gather_apply (const std::size_t n, const std::array<const int*, S.taps.size()>& nbr,
+                           const std::array<const T*, K>& fields, F& update)
+        {
+            constexpr std::size_t N = S.taps.size();
+            const long long nn = static_cast<long long>(n);
+#pragma omp parallel for schedule(static)
+            for (long long i = 0; i < nn; ++i) {
+                std::array<long long, N> idx;
+                for (std::size_t k = 0; k < N; ++k) {
+                    idx[k] = (nbr[k] == nullptr || nbr[k][i] < 0) ? i : static_cast<long long>(nbr[k][i]);
+                }
+                std::array<T, K> s;
+                for (std::size_t f = 0; f < K; ++f) {
+                    T sum = T{0};
+                    for (std::size_t k = 0; k < N; ++k) { sum += S.taps[k].weight * fields[f][idx[k]]; }
+                    s[f] = sum;
+                }
+                update (static_cast<std::size_t>(i), s);
+            }
+        }
+
+        //! The number of elements in the grid
+        template <typename G>
+        std::size_t grid_size (const G& grid)
+        {
+            if constexpr (rectangular_grid<G>) {
+                return static_cast<std::size_t>(grid.get_w()) * static_cast<std::size_t>(grid.get_h());
+            } else if constexpr (cart_grid<G> || hex_grid<G>) {
+                return grid.d_ne.size();
+            } else {
+                static_assert (rectangular_grid<G>, "apply_stencil: unsupported grid type");
+                return 0;
+            }
+        }
+    } // namespace stencil_detail
+
+    /*!
+     * Apply the stencil S at every element of grid to each of the fields (vectors of S's
+     * value_type, one element per grid element), and call update (i, sums) with the
+     * stencil sums for element i, sums[f] being the sum for fields[f]. update is called
+     * once for each element, from several threads at once. It must not write to any of the
+     * fields, but it may read them and write elsewhere (for example, into derivative
+     * vectors), so that a multi-field model step makes a single pass over memory.
+     *
+     * \tparam S A constexpr morph::stencil. On a HexGrid, it may only have taps on the
+     * centre and its 6 neighbours; on a CartGrid with an arbitrary boundary, only on the
+     * centre and its 8 neighbours.
+     */
+    template <auto S, typename G, typename F, typename... V>
+    void apply_stencil_fused (const G& grid, F update, const V&... fields)
+    {
+        using T = typename std::remove_cvref_t<decltype(S)>::value_type;
+        constexpr std::size_t K = sizeof...(V);
+        static_assert (K > 0, "apply_stencil_fused: supply at least one field");
+        static_assert ((std::is_same_v<typename V::value_type, T> && ...),
+                       "apply_stencil_fused: the fields must have the stencil's value_type");
+        const std::size_t n = stencil_detail::grid_size (grid);
+        if (((fields.size() != n) || ...)) {
+            throw std::runtime_error ("apply_stencil_fused: each field must have one value per grid element");
+        }
+        const std::array<const T*, K> fp = { fields.data()... };
+        constexpr std::size_t N = S.taps.size();
+
+        if constexpr (requires { G::stencil_layout; }) {
+            // Gridct, whose layout is known at compile time
+            stencil_detail::rect_apply<S, K, T, F, G::stencil_layout> (G::stencil_layout, fp, update);
+
+        } else if constexpr (stencil_detail::rectangular_grid<G>) {
+            stencil_detail::rect_layout l = stencil_detail::make_layout (grid.get_w(), grid.get_h(), grid.get_wrap(), grid.get_order());
+            stencil_detail::rect_apply<S, K, T> (l, fp, update);
+
+        } else if constexpr (stencil_detail::cart_grid<G>) {
+            if (grid.domainShape == GridDomainShape::Rectangle && grid.w_px > 0
+                && static_cast<std::size_t>(grid.w_px) * static_cast<std::size_t>(grid.h_px) == n) {
+                stencil_detail::rect_layout l = stencil_detail::make_layout (grid.w_px, grid.h_px, grid.domainWrap,
+                                                                             GridOrder::bottomleft_to_topright);
+                stencil_detail::rect_apply<S, K, T> (l, fp, update);
+            } else {
+                if (S.radius() > 1) {
+                    throw std::runtime_error ("apply_stencil_fused: on a CartGrid with a boundary, stencils may only reach immediate neighbours");
+                }
+                const std::array<const int*, 9> dirs = { nullptr, grid.d_ne.data(), grid.d_nne.data(), grid.d_nn.data(),
+                                                         grid.d_nnw.data(), grid.d_nw.data(), grid.d_nsw.data(),
+                                                         grid.d_ns.data(), grid.d_nse.data() };
+                std::array<const int*, N> nbr;
+                for (std::size_t k = 0; k < N; ++k) {
+                    nbr[k] = dirs[std::remove_cvref_t<decltype(S)>::cart_direction (S.taps[k].dc, S.taps[k].dr)];
+                }
+                stencil_detail::gather_apply<S, K, T> (n, nbr, fp, update);
+            }
+
+        } else if constexpr (stencil_detail::hex_grid<G>) {
+            static_assert (S.hex_compatible(), "apply_stencil_fused: HexGrid stencils may only have taps on the centre and its 6 neighbours");
+            const std::array<const int*, 7> dirs = { nullptr, grid.d_ne.data(), grid.d_nne.data(), grid.d_nnw.data(),
+                                                     grid.d_nw.data(), grid.d_nsw.data(), grid.d_nse.data() };
+            std::array<const int*, N> nbr;
+            for (std::size_t k = 0; k < N; ++k) {
+                nbr[k] = dirs[std::remove_cvref_t<decltype(S)>::hex_direction (S.taps[k].dc, S.taps[k].dr)];
+            }
+            stencil_detail::gather_apply<S, K, T> (n, nbr, fp, update);
+        }
+    }
+
+    //! Apply the stencil S to the field in, writing scale times the stencil sum into out
+    template <auto S, typename G, typename T>
+    void apply_stencil (const G& grid, const std::vector<T>& in, std::vector<T>& out, const T scale = T{1})
+    {
+        if (&in == &out) { throw std::runtime_error ("apply_stencil: in and out must be different vectors"); }
+        out.resize (in.size());
+        T* o = out.data();
+        morph::apply_stencil_fused<S> (grid, [o, scale](const std::size_t i, const std::array<T, 1>& s) { o[i] = scale * s[0]; }, in);
+    }
+
+} // namespace morph
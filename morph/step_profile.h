@@ -0,0 +1,249 @@
+/*!
+ * \file
+ *
+ * Timers for the named parts of a simulation step, and counters, with statistics of each over
+ * the steps of a run. RD_Base has one (RD_Base::profile), which times its own Laplacian,
+ * gradient, noise and save functions; a model adds its own sections in step():
+ *
+ *\code{.cpp}
+ * void step()
+ * {
+ *     { auto t = this->profile.time ("reaction"); this->compute_reaction(); }
+ *     this->compute_laplace (this->u, this->lapu); // timed as "compute_laplace"
+ * }
+ * ...
+ * rd.profile.enabled = true;
+ * for (unsigned int i = 0; i < steps; ++i) { rd.step_profiled(); } // ends each profiled step
+ * conf.set ("profile", rd.profile.to_json()); // goes into the log that conf.write() saves
+ *\endcode
+ *
+ * A disabled profile costs a test of a bool for each timer and counter and reads no clocks.
+ * A step_profile is not thread safe: time a parallel loop from outside it, on the thread
+ * that steps the model.
+ */
+#pragma once
+
+#include <morph/running_stats.h>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+
+    class step_profile
+    {
+        using clock = std::chrono::steady_clock;
+
+    public:
+        //! Set true to time and count. Timers and counters do nothing while it is false.
+        bool enabled = false;
+
+        //! A named section of the step, with the statistics of its duration per step
+        struct section
+        {
+            std::string name;
+            //! The number of times the section was timed
+            std::uint64_t calls = 0;
+            //! Time per step in ms, over the steps in which the section ran
+            morph::running_stats<double> ms;
+            morph::p2_quantile<double> p50 = morph::p2_quantile<double>(0.5);
+            morph::p2_quantile<double> p90 = morph::p2_quantile<double>(0.9);
+            morph::p2_quantile<double> p99 = morph::p2_quantile<double>(0.99);
+            //! The time so far in the current step
+            double step_ms = 0.0;
+            bool ran = false;
+            // The pointer that time() was last given for this name, checked before the name itself
+            const char* key = nullptr;
+        };
+
+        //! A named count (of hexes updated, bytes saved and so on), with its statistics per step
+        struct counter
+        {
+            std::string name;
+            double total = 0.0;
+            //! The count per step, over the steps in which the counter was incremented
+            morph::running_stats<double> per_step;
+            double step_count = 0.0;
+            bool ran = false;
+            const char* key = nullptr;
+        };
+
+        //! Times from its construction to its destruction (or stop()) as part of a section
+        class scope
+        {
+        public:
+            scope() = default;
+            scope (step_profile* _prof, const std::size_t _idx) : prof(_prof), idx(_idx), t0(clock::now()) {}
+            scope (scope&& other) noexcept : prof(other.prof), idx(other.idx), t0(other.t0) { other.prof = nullptr; }
+            scope (const scope&) = delete;
+            scope& operator= (const scope&) = delete;
+            scope& operator= (scope&&) = delete;
+            ~scope() { this->stop(); }
+
+            //! End the timing before the end of the scope
+            void stop()
+            {
+                if (this->prof == nullptr) { return; }
+                section& s = this->prof->secs[this->idx];
+                s.step_ms += std::chrono::duration<double, std::milli>(clock::now() - this->t0).count();
+                s.ran = true;
+                ++s.calls;
+                this->prof = nullptr;
+            }
+
+        private:
+            step_profile* prof = nullptr;
+            std::size_t idx = 0;
+            clock::time_point t0;
+        };
+
+        /*!
+         * Time the rest of the enclosing block as part of the section called name. A section
+         * may be timed any number of times in a step, and sections may nest (the time of the
+         * inner is then counted in both). Pass a string literal, which is matched by its
+         * address before its contents.
+         */
+        [[nodiscard]] scope time (const char* name)
+        {
+            if (!this->enabled) { return scope(); }
+            return scope (this, step_profile::find (this->secs, name));
+        }
+
+        //! Add amount to the counter called name
+        void count (const char* name, const double amount = 1.0)
+        {
+            if (!this->enabled) { return; }
+            counter& c = this->ctrs[step_profile::find (this->ctrs, name)];
+            c.step_count += amount;
+            c.total += amount;
+            c.ran = true;
+        }
+
+        //! End a step: add each section's time, and each counter's count, in this step to its statistics
+        void end_step()
+        {
+            if (!this->enabled) { return; }
+            for (section& s : this->secs) {
+                if (!s.ran) { continue; }
+                s.ms.add (s.step_ms);
+                s.p50.add (s.step_ms);
+                s.p90.add (s.step_ms);
+                s.p99.add (s.step_ms);
+                s.step_ms = 0.0;
+                s.ran = false;
+            }
+            for (counter& c : this->ctrs) {
+                if (!c.ran) { continue; }
+                c.per_step.add (c.step_count);
+                c.step_count = 0.0;
+                c.ran = false;
+            }
+            ++this->nsteps;
+        }
+
+        //! Forget all the sections, counters and steps
+        void reset()
+        {
+            this->secs.clear();
+            this->ctrs.clear();
+            this->nsteps = 0;
+        }
+
+        //! The number of steps ended with end_step()
+        std::uint64_t steps() const { return this->nsteps; }
+
+        //! The sections, in the order they were first timed
+        const std::vector<section>& sections() const { return this->secs; }
+
+        //! The counters, in the order they were first incremented
+        const std::vector<counter>& counters() const { return this->ctrs; }
+
+        /*!
+         * The statistics as json: {"steps": n, "sections": {name: {"calls", "steps", "mean_ms",
+         * "std_ms", "min_ms", "max_ms", "p50_ms", "p90_ms", "p99_ms", "total_ms"}},
+         * "counters": {name: {"total", "steps", "mean_per_step", "min_per_step",
+         * "max_per_step"}}}. Set it into a morph::Config to save it with the run's parameters.
+         */
+        nlohmann::json to_json() const
+        {
+            nlohmann::json j;
+            j["steps"] = this->nsteps;
+            j["sections"] = nlohmann::json::object();
+            for (const section& s : this->secs) {
+                nlohmann::json js;
+                js["calls"] = s.calls;
+                js["steps"] = s.ms.count();
+                js["mean_ms"] = s.ms.mean();
+                js["std_ms"] = s.ms.std();
+                js["min_ms"] = s.ms.count() > 0 ? s.ms.min() : 0.0;
+                js["max_ms"] = s.ms.count() > 0 ? s.ms.max() : 0.0;
+                js["p50_ms"] = s.p50.get();
+                js["p90_ms"] = s.p90.get();
+                js["p99_ms"] = s.p99.get();
+                js["total_ms"] = s.ms.sum();
+                j["sections"][s.name] = js;
+            }
+            j["counters"] = nlohmann::json::object();
+            for (const counter& c : this->ctrs) {
+                nlohmann::json jc;
+                jc["total"] = c.total;
+                jc["steps"] = c.per_step.count();
+                jc["mean_per_step"] = c.per_step.mean();
+                jc["min_per_step"] = c.per_step.count() > 0 ? c.per_step.min() : 0.0;
+                jc["max_per_step"] = c.per_step.count() > 0 ? c.per_step.max() : 0.0;
+                j["counters"][c.name] = jc;
+            }
+            return j;
+        }
+
+        //! A table of the sections' and counters' statistics, for the terminal
+        std::string summary() const
+        {
+            std::stringstream ss;
+            ss << "Profile of " << this->nsteps << " steps\n" << std::fixed << std::setprecision (3);
+            ss << std::left << std::setw (24) << "section" << std::right
+               << std::setw (10) << "mean ms" << std::setw (10) << "min" << std::setw (10) << "max"
+               << std::setw (10) << "p50" << std::setw (10) << "p90" << std::setw (10) << "p99" << "\n";
+            for (const section& s : this->secs) {
+                if (s.ms.count() == 0) { continue; }
+                ss << std::left << std::setw (24) << s.name << std::right
+                   << std::setw (10) << s.ms.mean() << std::setw (10) << s.ms.min() << std::setw (10) << s.ms.max()
+                   << std::setw (10) << s.p50.get() << std::setw (10) << s.p90.get() << std::setw (10) << s.p99.get() << "\n";
+            }
+            for (const counter& c : this->ctrs) {
+                ss << std::left << std::setw (24) << c.name << std::right << std::setw (10) << c.per_step.mean()
+                   << " per step, " << c.total << " in all\n";
+            }
+            return ss.str();
+        }
+
+    private:
+        //! The index of the element of v called name, which is added if there is none
+        template <typename E>
+        static std::size_t find (std::vector<E>& v, const char* name)
+        {
+            for (std::size_t i = 0; i < v.size(); ++i) { if (v[i].key == name) { return i; } }
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                if (v[i].name == std::string_view(name)) {
+                    v[i].key = name;
+                    return i;
+                }
+            }
+            v.emplace_back();
+            v.back().name = name;
+            v.back().key = name;
+            return v.size() - 1;
+        }
+
+        std::vector<section> secs;
+        std::vector<counter> ctrs;
+        std::uint64_t nsteps = 0;
+    };
+
+} // namespace morph
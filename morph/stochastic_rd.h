@@ -0,0 +1,503 @@
+/*!
+ * \file
+ *
+ * morph::stochastic_rd, a spatial stochastic reaction-diffusion engine for models in which
+ * the molecules are few enough that their discreteness matters. Each element of a HexGrid (or
+ * Grid) holds a whole number of molecules of each species; the reactions fire at random, with
+ * mass action propensities, and the molecules hop at random between neighbouring elements.
+ * This is the reaction-diffusion master equation, as simulated by Gillespie's algorithm on
+ * each element, but advanced a time step tau at a time:
+ *
+ * - Reactions. Where tau covers many reaction events, the number of firings of each reaction
+ *   within tau is drawn from a Poisson distribution with the reaction's propensity times tau
+ *   (tau-leaping; Gillespie, J. Chem. Phys. 115, 2001). Where it covers only a few (fewer
+ *   than ssa_threshold), or where a leap would make a count negative, the element's reactions
+ *   are simulated event by event with the exact stochastic simulation algorithm instead, so
+ *   that the low copy number elements, where leaping is least accurate, are exact.
+ * - Diffusion. In a step, each molecule hops along each link of its element with probability
+ *   D tau w, where w is the weight of the link in the grid's finite volume Laplacian
+ *   (2 / (3 d^2) on a HexGrid, as in RD_Base::compute_laplace). The number that leave an
+ *   element is binomial, and they are shared out among its links by a multinomial draw. The
+ *   probability is the same in both directions of a link, so the molecules' mean obeys an
+ *   explicit step of the diffusion equation (as RD_Base's does) and their mean squared
+ *   displacement grows at exactly 4 D per unit time. As in RD_Base, there is no flux across
+ *   a link to a missing neighbour; a molecule that would have hopped along it stays put.
+ *   D tau times the sum of an element's link weights must not exceed 1.
+ *
+ * suggest_tau() chooses a tau by the bound of Cao, Gillespie and Petzold (J. Chem. Phys. 124,
+ * 2006) on the relative change of the propensities in a step.
+ *
+ * The random numbers for each element, in each step and phase, come from their own block of
+ * a counter-based morph::philox4x32 stream (the stream is the element's index), so the
+ * elements are updated in parallel and the results depend only on the seed, and not on the
+ * number of threads.
+ *
+ *\code{.cpp}
+ * morph::stochastic_rd<double> srd (*hg, 42);
+ * unsigned int A = srd.add_species (0.01, 10); // D = 0.01, 10 molecules per hex
+ * srd.add_reaction (5.0, {}, { A });  // 0 -> A at 5 per unit time in each hex
+ * srd.add_reaction (0.5, { A }, {});  // A -> 0 at 0.5 per molecule
+ * for (int i = 0; i < 1000; ++i) { srd.step (srd.suggest_tau()); }
+ * // srd.counts[A] holds the number of A molecules in each hex
+ *\endcode
+ */
+#pragma once
+
+#include <morph/Random.h>
+#include <morph/stencil.h>
+#include <morph/memory_usage.h>
+#include <vector>
+#include <array>
+#include <initializer_list>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+
+namespace morph {
+
+    template <typename T = double>
+    class stochastic_rd
+    {
+        static_assert (std::is_floating_point_v<T>, "stochastic_rd: T must be a floating point type");
+    public:
+        //! A mass action reaction
+        struct reaction
+        {
+            /*!
+             * The stochastic rate constant: the propensity is rate times the number of
+             * distinct combinations of the reactants in an element (x for A, x_A x_B for A + B,
+             * x (x - 1) / 2 for 2A...). A reaction with no reactants fires at rate in each
+             * element.
+             */
+            T rate = T{0};
+            //! The reactant species, repeated for a higher order (2A -> B has reactants { A, A })
+            std::vector<unsigned int> reactants;
+            //! The product species, repeated likewise
+            std::vector<unsigned int> products;
+            //! If not empty, a factor for the rate in each element, so that it can vary in space
+            std::vector<T> rate_map;
+            //! The net change of each species changed by one firing
+            std::vector<std::pair<unsigned int, int>> change;
+        };
+
+        /*!
+         * Set up for a HexGrid or a Grid (of any GridDomainWrap), with the random streams
+         * seeded by _seed.
+         */
+        template <typename G>
+        explicit stochastic_rd (const G& grid, const std::uint64_t _seed = morph::philox4x32::default_seed)
+            : seed(_seed)
+        {
+            if constexpr (stencil_detail::hex_grid<G>) {
+                const T d = static_cast<T>(grid.getd());
+                this->links = 6;
+                this->n = grid.d_ne.size();
+                this->wl.assign (6, T{2} / (T{3} * d * d));
+                // In the order of RD_Base's ghost stencil
+                this->add_links ({ &grid.d_ne, &grid.d_nne, &grid.d_nnw, &grid.d_nw, &grid.d_nsw, &grid.d_nse });
+            } else if constexpr (stencil_detail::rectangular_grid<G>) {
+                this->links = 4;
+                this->n = static_cast<std::size_t>(grid.get_w()) * static_cast<std::size_t>(grid.get_h());
+                const auto dx = grid.get_dx();
+                const T wx = T{1} / static_cast<T>(dx[0] * dx[0]);
+                const T wy = T{1} / static_cast<T>(dx[1] * dx[1]);
+                this->wl = { wx, wy, wx, wy };
+                std::array<std::vector<int>, 4> l;
+                for (auto& li : l) { li.resize (this->n); }
+                using I = std::remove_cvref_t<decltype(grid.get_w())>;
+                auto idx = [](const I j) { return j == std::numeric_limits<I>::max() ? -1 : static_cast<int>(j); };
+                for (std::size_t i = 0; i < this->n; ++i) {
+                    const I ii = static_cast<I>(i);
+                    l[0][i] = idx (grid.index_ne (ii));
+                    l[1][i] = idx (grid.index_nn (ii));
+                    l[2][i] = idx (grid.index_nw (ii));
+                    l[3][i] = idx (grid.index_ns (ii));
+                }
+                this->add_links ({ &l[0], &l[1], &l[2], &l[3] });
+            } else {
+                static_assert (stencil_detail::rectangular_grid<G>, "stochastic_rd: unsupported grid type");
+            }
+            this->find_back_links();
+        }
+
+        //! The number of molecules of each species in each element: counts[species][element]
+        std::vector<std::vector<std::uint32_t>> counts;
+        //! The reactions
+        std::vector<reaction> reactions;
+        //! The diffusion coefficient of each species
+        std::vector<T> D;
+
+        //! The simulation time and the number of steps taken
+        T t = T{0};
+        std::uint64_t steps = 0;
+
+        /*!
+         * An element whose expected number of reaction events in a step is below this has its
+         * reactions simulated exactly, event by event, rather than leapt. 0 leaps everywhere
+         * (except where a leap would go negative); a very large value gives the exact
+         * algorithm everywhere.
+         */
+        T ssa_threshold = T{10};
+
+        //! Counts of the element updates made by leaping and by the exact algorithm, and of the
+        //! exact algorithm's events, since construction
+        unsigned long long leaped = 0;
+        unsigned long long exact = 0;
+        unsigned long long exact_events = 0;
+        //! The number of leaps abandoned (and simulated exactly) because a count would have gone negative
+        unsigned long long negative_leaps = 0;
+
+        //! The number of elements
+        std::size_t size() const { return this->n; }
+        std::size_t num_species() const { return this->counts.size(); }
+
+        //! Add a species, which diffuses with coefficient _D, starting with initial molecules in every element
+        unsigned int add_species (const T _D, const std::uint32_t initial = 0)
+        {
+            this->counts.emplace_back (this->n, initial);
+            this->D.push_back (_D);
+            return static_cast<unsigned int>(this->counts.size() - 1);
+        }
+
+        //! Add a reaction (see stochastic_rd::reaction), returning its index in reactions
+        std::size_t add_reaction (const T rate, const std::vector<unsigned int>& reactants, const std::vector<unsigned int>& products)
+        {
+            reaction r;
+            r.rate = rate;
+            r.reactants = reactants;
+            r.products = products;
+            std::sort (r.reactants.begin(), r.reactants.end());
+            for (unsigned int s : r.reactants) { this->add_change (r, s, -1); }
+            for (unsigned int s : r.products) { this->add_change (r, s, 1); }
+            for (const std::pair<unsigned int, int>& c : r.change) {
+                if (c.first >= this->counts.size()) { throw std::runtime_error ("stochastic_rd::add_reaction: no such species"); }
+            }
+            this->reactions.push_back (r);
+            return this->reactions.size() - 1;
+        }
+
+        //! The propensity of reaction j in element h
+        T propensity (const std::size_t j, const std::size_t h) const
+        {
+            const reaction& r = this->reactions[j];
+            T a = r.rate_map.empty() ? r.rate : r.rate * r.rate_map[h];
+            // The reactants are sorted, so each species' repeats are together
+            std::size_t k = 0;
+            while (k < r.reactants.size() && a > T{0}) {
+                const unsigned int s = r.reactants[k];
+                const T x = static_cast<T>(this->counts[s][h]);
+                unsigned int m = 0;
+                T comb = T{1};
+                while (k < r.reactants.size() && r.reactants[k] == s) {
+                    comb *= (x - static_cast<T>(m)) / static_cast<T>(m + 1);
+                    ++m;
+                    ++k;
+                }
+                a *= std::max (comb, T{0});
+            }
+            return a;
+        }
+
+        //! Advance by tau: the reactions in each element, then a diffusion step
+        void step (const T tau)
+        {
+            if (!(tau > T{0})) { throw std::runtime_error ("stochastic_rd::step: tau must be > 0"); }
+            T wsum = T{0};
+            for (T w : this->wl) { wsum += w; }
+            for (unsigned int s = 0; s < this->counts.size(); ++s) {
+                if (this->D[s] * tau * wsum > T{1}) {
+                    throw std::runtime_error ("stochastic_rd::step: D tau sum(w) > 1; a molecule can hop at most once in a step");
+                }
+            }
+            if (!this->reactions.empty()) { this->react (tau); }
+            for (unsigned int s = 0; s < this->counts.size(); ++s) {
+                if (this->D[s] > T{0}) { this->diffuse (s, tau); }
+            }
+            this->t += tau;
+            ++this->steps;
+        }
+
+        /*!
+         * A step size such that the expected relative change in each propensity in a step is
+         * about eps (Cao, Gillespie and Petzold's bound), and no more than max_hop of the
+         * molecules of an element leave it in a step (a smaller max_hop follows the diffusion
+         * more closely).
+         */
+        T suggest_tau (const T eps = T{0.03}, const T max_hop = T{0.2}) const
+        {
+            const std::size_t ns = this->counts.size();
+            // The highest order of the reactions that consume each species
+            std::vector<unsigned int> hor (ns, 0);
+            std::vector<bool> self2 (ns, false);
+            for (const reaction& r : this->reactions) {
+                const unsigned int order = static_cast<unsigned int>(r.reactants.size());
+                for (std::size_t k = 0; k < r.reactants.size(); ++k) {
+                    const unsigned int s = r.reactants[k];
+                    hor[s] = std::max (hor[s], order);
+                    if (k > 0 && r.reactants[k - 1] == s) { self2[s] = true; }
+                }
+            }
+            T tau = std::numeric_limits<T>::max();
+            const long long nn = static_cast<long long>(this->n);
+#pragma omp parallel
+            {
+                std::vector<T> a (this->reactions.size());
+                std::vector<T> mu (ns), sig2 (ns);
+                T tau_t = std::numeric_limits<T>::max();
+#pragma omp for schedule(static)
+                for (long long h = 0; h < nn; ++h) {
+                    std::fill (mu.begin(), mu.end(), T{0});
+                    std::fill (sig2.begin(), sig2.end(), T{0});
+                    for (std::size_t j = 0; j < this->reactions.size(); ++j) {
+                        const T aj = this->propensity (j, h);
+                        for (const std::pair<unsigned int, int>& c : this->reactions[j].change) {
+                            mu[c.first] += static_cast<T>(c.second) * aj;
+                            sig2[c.first] += static_cast<T>(c.second * c.second) * aj;
+                        }
+                    }
+                    for (std::size_t s = 0; s < ns; ++s) {
+                        if (hor[s] == 0) { continue; }
+                        const T x = static_cast<T>(this->counts[s][h]);
+                        T g = static_cast<T>(hor[s]);
+                        if (self2[s] && x > T{1}) { g += T{1} / (x - T{1}); }
+                        const T b = std::max (eps * x / g, T{1});
+                        if (mu[s] != T{0}) { tau_t = std::min (tau_t, b / std::abs (mu[s])); }
+                        if (sig2[s] != T{0}) { tau_t = std::min (tau_t, b * b / sig2[s]); }
+                    }
+                }
+#pragma omp critical
+                tau = std::min (tau, tau_t);
+            }
+            // Diffusion: D sum(w) tau <= max_hop
+            T wsum = T{0};
+            for (T w : this->wl) { wsum += w; }
+            for (std::size_t s = 0; s < ns; ++s) {
+                if (this->D[s] > T{0}) { tau = std::min (tau, max_hop / (this->D[s] * wsum)); }
+            }
+            return tau;
+        }
+
+        //! The total number of molecules of species s
+        std::uint64_t total (const unsigned int s) const
+        {
+            std::uint64_t sum = 0;
+            for (std::uint32_t c : this->counts[s]) { sum += c; }
+            return sum;
+        }
+
+        //! The memory held by the counts, the neighbour tables and the diffusion buffer
+        morph::memory_usage memory_usage() const
+        {
+            morph::memory_usage mu ("stochastic_rd", sizeof (*this));
+            mu.add ("counts", this->counts);
+            mu.add ("neighbours", this->nbr).cpu += morph::heap_bytes (this->back);
+            mu.add ("hops", this->out);
+            return mu;
+        }
+
+    protected:
+        //! The number of elements and of links (neighbour slots) per element
+        std::size_t n = 0;
+        unsigned int links = 0;
+        //! The weight of each link, as in the grid's Laplacian
+        std::vector<T> wl;
+        //! nbr[h * links + k] is element h's neighbour on link k, or -1
+        std::vector<int> nbr;
+        //! back[h * links + k] is the slot (j * links + k') of the link from that neighbour j back to h
+        std::vector<int> back;
+        //! The molecules that hop along each link in a diffusion step
+        std::vector<std::uint32_t> out;
+        std::uint64_t seed = morph::philox4x32::default_seed;
+
+        static void add_change (reaction& r, const unsigned int s, const int dn)
+        {
+            for (std::pair<unsigned int, int>& c : r.change) {
+                if (c.first == s) { c.second += dn; return; }
+            }
+            r.change.emplace_back (s, dn);
+        }
+
+        void add_links (std::initializer_list<const std::vector<int>*> l)
+        {
+            this->nbr.resize (this->n * this->links);
+            unsigned int k = 0;
+            for (const std::vector<int>* lk : l) {
+                for (std::size_t h = 0; h < this->n; ++h) { this->nbr[h * this->links + k] = (*lk)[h]; }
+                ++k;
+            }
+        }
+
+        void find_back_links()
+        {
+            this->back.assign (this->nbr.size(), -1);
+            for (std::size_t h = 0; h < this->n; ++h) {
+                for (unsigned int k = 0; k < this->links; ++k) {
+                    const int j = this->nbr[h * this->links + k];
+                    if (j < 0) { continue; }
+                    for (unsigned int kb = 0; kb < this->links; ++kb) {
+                        if (this->nbr[j * this->links + kb] == static_cast<int>(h)) {
+                            this->back[h * this->links + k] = static_cast<int>(j * this->links + kb);
+                            break;
+                        }
+                    }
+                    if (this->back[h * this->links + k] < 0) {
+                        throw std::runtime_error ("stochastic_rd: the grid's neighbour links are not symmetric");
+                    }
+                }
+            }
+        }
+
+        //! The random stream of element h for phase p (0 for the reactions, 1 + s for the diffusion of species s) of this step
+        morph::philox4x32 engine (const std::size_t h, const std::uint64_t p) const
+        {
+            morph::philox4x32 e (this->seed, h);
+            const std::uint64_t phases = 1 + this->counts.size();
+            e.set_counter ((this->steps * phases + p) << 32);
+            return e;
+        }
+
+        static T uniform (morph::philox4x32& e)
+        {
+            const std::uint64_t x = static_cast<std::uint64_t>(e()) << 32 | e();
+            return morph::philox4x32::to_unit<T> (x);
+        }
+
+        //! The reactions of every element over tau
+        void react (const T tau)
+        {
+            const std::size_t ns = this->counts.size();
+            const std::size_t nr = this->reactions.size();
+            const long long nn = static_cast<long long>(this->n);
+            unsigned long long n_leaped = 0, n_exact = 0, n_events = 0, n_negative = 0;
+#pragma omp parallel reduction(+:n_leaped, n_exact, n_events, n_negative)
+            {
+                std::vector<T> a (nr);
+                std::vector<long long> x (ns);
+#pragma omp for schedule(dynamic, 64)
+                for (long long h = 0; h < nn; ++h) {
+                    morph::philox4x32 e = this->engine (h, 0);
+                    T a0 = T{0};
+                    for (std::size_t j = 0; j < nr; ++j) {
+                        a[j] = this->propensity (j, h);
+                        a0 += a[j];
+                    }
+                    if (a0 == T{0}) { continue; }
+                    bool leap = a0 * tau >= this->ssa_threshold;
+                    if (leap) {
+                        for (std::size_t s = 0; s < ns; ++s) { x[s] = this->counts[s][h]; }
+                        for (std::size_t j = 0; j < nr; ++j) {
+                            if (a[j] == T{0}) { continue; }
+                            std::poisson_distribution<long long> pd (static_cast<double>(a[j] * tau));
+                            const long long k = pd (e);
+                            for (const std::pair<unsigned int, int>& c : this->reactions[j].change) { x[c.first] += k * c.second; }
+                        }
+                        bool ok = true;
+                        for (std::size_t s = 0; s < ns; ++s) {
+                            if (x[s] < 0 || x[s] > static_cast<long long>(std::numeric_limits<std::uint32_t>::max())) { ok = false; }
+                        }
+                        if (ok) {
+                            for (std::size_t s = 0; s < ns; ++s) { this->counts[s][h] = static_cast<std::uint32_t>(x[s]); }
+                            ++n_leaped;
+                        } else {
+                            ++n_negative;
+                            leap = false;
+                        }
+                    }
+                    if (!leap) {
+                        n_events += this->simulate_exactly (h, tau, a, e);
+                        ++n_exact;
+                    }
+                }
+            }
+            this->leaped += n_leaped;
+            this->exact += n_exact;
+            this->exact_events += n_events;
+            this->negative_leaps += n_negative;
+        }
+
+        //! Gillespie's direct method in element h for a time tau. a holds the propensities on entry.
+        unsigned long long simulate_exactly (const std::size_t h, const T tau, std::vector<T>& a, morph::philox4x32& e)
+        {
+            const std::size_t nr = this->reactions.size();
+            unsigned long long events = 0;
+            T ts = T{0};
+            for (;;) {
+                T a0 = T{0};
+                for (std::size_t j = 0; j < nr; ++j) { a0 += a[j]; }
+                if (!(a0 > T{0})) { break; }
+                // 1 - u is in (0, 1], so the log is finite
+                ts += -std::log (T{1} - stochastic_rd<T>::uniform (e)) / a0;
+                if (ts > tau) { break; }
+                const T target = stochastic_rd<T>::uniform (e) * a0;
+                std::size_t j = 0;
+                T cum = a[0];
+                while (cum <= target && j + 1 < nr) { cum += a[++j]; }
+                // Rounding could pick a reaction with zero propensity; step back to one that can fire
+                while (a[j] == T{0} && j > 0) { --j; }
+                for (const std::pair<unsigned int, int>& c : this->reactions[j].change) {
+                    this->counts[c.first][h] = static_cast<std::uint32_t>(static_cast<long long>(this->counts[c.first][h]) + c.second);
+                }
+                ++events;
+                for (std::size_t jj = 0; jj < nr; ++jj) { a[jj] = this->propensity (jj, h); }
+            }
+            return events;
+        }
+
+        //! Binomial hops of species s along the links over tau
+        void diffuse (const unsigned int s, const T tau)
+        {
+            const unsigned int L = this->links;
+            this->out.assign (this->n * L, 0u);
+            std::vector<std::uint32_t>& x = this->counts[s];
+            const long long nn = static_cast<long long>(this->n);
+            const T Ds = this->D[s];
+#pragma omp parallel for schedule(static)
+            for (long long h = 0; h < nn; ++h) {
+                if (x[h] == 0) { continue; }
+                T wsum = T{0};
+                unsigned int klast = L;
+                for (unsigned int k = 0; k < L; ++k) {
+                    if (this->nbr[h * L + k] >= 0) {
+                        wsum += this->wl[k];
+                        klast = k;
+                    }
+                }
+                if (klast == L) { continue; }
+                morph::philox4x32 e = this->engine (h, 1 + s);
+                // Each molecule leaves with probability D tau sum(w)...
+                const double pleave = std::min (static_cast<double>(Ds * tau * wsum), 1.0);
+                std::binomial_distribution<std::uint32_t> bd (x[h], pleave);
+                std::uint32_t left = bd (e);
+                // ...along link k with probability w_k / sum(w)
+                T wrem = wsum;
+                for (unsigned int k = 0; k < L && left > 0; ++k) {
+                    if (this->nbr[h * L + k] < 0) { continue; }
+                    std::uint32_t nk = left;
+                    if (k != klast) {
+                        std::binomial_distribution<std::uint32_t> bk (left, static_cast<double>(this->wl[k] / wrem));
+                        nk = bk (e);
+                    }
+                    this->out[h * L + k] = nk;
+                    left -= nk;
+                    wrem -= this->wl[k];
+                }
+            }
+#pragma omp parallel for schedule(static)
+            for (long long h = 0; h < nn; ++h) {
+                long long xn = x[h];
+                for (unsigned int k = 0; k < L; ++k) {
+                    const int b = this->back[h * L + k];
+                    if (b < 0) { continue; }
+                    xn += static_cast<long long>(this->out[b]) - static_cast<long long>(this->out[h * L + k]);
+                }
+                x[h] = static_cast<std::uint32_t>(xn);
+            }
+        }
+    };
+
+} // namespace morph
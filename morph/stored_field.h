@@ -0,0 +1,270 @@
+/*!
+ * \file
+ *
+ * Reduced precision storage for the state of a model. A field whose values do not need full
+ * precision can be held as 16 bit bfloat16 or float16 (or as float when the model computes in
+ * double), halving its memory and the bandwidth of every sweep over it, while the arithmetic is
+ * still done in the model's Flt. The values are converted as they are loaded and stored, so a
+ * stencil kernel (such as RD_Base::compute_laplace) reads the narrow type directly.
+ *
+ * bfloat16 keeps float's exponent range with an 8 bit significand (a relative rounding error
+ * of at most 2^-8); float16 has an 11 bit significand (2^-11) but holds normal values only
+ * from about 6e-5 to 65504, with less precision below. Both round to the nearest value, ties
+ * to even. Where the F16C instructions are available (-mf16c, or -march=native on most x86
+ * machines) float16 conversions use them, unless MORPH_NO_SIMD is defined.
+ *
+ * Each write through store() or update() measures the rounding error that it made, and counts
+ * the values whose change was lost altogether, so that a model can check that the narrow
+ * storage is good enough for its fields. A state updated by small increments (a short dt) is
+ * the usual trouble: an increment below half the storage's resolution is rounded away.
+ *
+ *\code{.cpp}
+ * morph::stored_field<morph::bfloat16> u (nhex, 0.0f);
+ * std::vector<float> lapu (nhex);
+ * // In step(). compute_laplace reads the bfloat16s
+ * this->compute_laplace (u, lapu);
+ * u.update ([&](std::size_t h, float x) { return x + dt * (D * lapu[h] + f (x)); });
+ * if (u.last_error.stalled > nhex / 100) { ... } // the increments are too small for bfloat16
+ *\endcode
+ */
+#pragma once
+
+#include <vector>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+#if defined(__F16C__) && !defined(MORPH_NO_SIMD)
+# include <immintrin.h>
+# define MORPH_F16C 1
+#endif
+
+namespace morph {
+
+    //! A 16 bit float with float's 8 bit exponent and a 7 bit mantissa (Google's 'brain float')
+    struct bfloat16
+    {
+        std::uint16_t bits = 0;
+
+        bfloat16() = default;
+        explicit bfloat16 (const float f) : bits(bfloat16::from_float (f)) {}
+        explicit operator float() const { return std::bit_cast<float> (static_cast<std::uint32_t>(this->bits) << 16); }
+
+        //! The bits of f rounded to the nearest bfloat16, ties to even
+        static std::uint16_t from_float (const float f)
+        {
+            const std::uint32_t u = std::bit_cast<std::uint32_t> (f);
+            // A NaN stays a (quiet) NaN rather than rounding to infinity
+            if ((u & 0x7fffffffu) > 0x7f800000u) { return static_cast<std::uint16_t>((u >> 16) | 0x40u); }
+            return static_cast<std::uint16_t>((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+        }
+    };
+
+    //! The IEEE 754 binary16 'half precision' float, with a 5 bit exponent and a 10 bit mantissa
+    struct float16
+    {
+        std::uint16_t bits = 0;
+
+        float16() = default;
+        explicit float16 (const float f) : bits(float16::from_float (f)) {}
+        explicit operator float() const { return float16::to_float (this->bits); }
+
+        //! The largest finite float16
+        static constexpr float max() { return 65504.0f; }
+
+        //! The bits of f rounded to the nearest float16, ties to even. Too large a magnitude gives infinity.
+        static std::uint16_t from_float (const float f)
+        {
+#ifdef MORPH_F16C
+            return static_cast<std::uint16_t>(_cvtss_sh (f, _MM_FROUND_TO_NEAREST_INT));
+#else
+            std::uint32_t u = std::bit_cast<std::uint32_t> (f);
+            const std::uint32_t sign = u & 0x80000000u;
+            u ^= sign;
+            std::uint32_t o = 0;
+            if (u >= (127u + 16u) << 23) {
+                // Overflow, infinity or NaN
+                o = u > 0x7f800000u ? 0x7e00u : 0x7c00u;
+            } else if (u < (127u - 14u) << 23) {
+                // A subnormal float16 (or zero). Adding 0.5 lines the float16 subnormal's bits
+                // up with the bottom of the float's mantissa, and the addition rounds.
+                constexpr std::uint32_t magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+                const float r = std::bit_cast<float> (u) + std::bit_cast<float> (magic);
+                o = std::bit_cast<std::uint32_t> (r) - magic;
+            } else {
+                // Rebias the exponent and round the mantissa to 10 bits
+                const std::uint32_t odd = (u >> 13) & 1u;
+                u += (static_cast<std::uint32_t>(15 - 127) << 23) + 0xfffu + odd;
+                o = u >> 13;
+            }
+            return static_cast<std::uint16_t>(o | (sign >> 16));
+#endif
+        }
+
+        static float to_float (const std::uint16_t h)
+        {
+#ifdef MORPH_F16C
+            return _cvtsh_ss (h);
+#else
+            constexpr std::uint32_t shifted_exp = 0x7c00u << 13;
+            std::uint32_t o = (static_cast<std::uint32_t>(h) & 0x7fffu) << 13;
+            const std::uint32_t e = o & shifted_exp;
+            o += (127u - 15u) << 23;
+            if (e == shifted_exp) {
+                o += (128u - 16u) << 23; // infinity or NaN
+            } else if (e == 0) {
+                // Subnormal: renormalise with a float subtraction
+                constexpr std::uint32_t magic = 113u << 23;
+                o += 1u << 23;
+                o = std::bit_cast<std::uint32_t> (std::bit_cast<float> (o) - std::bit_cast<float> (magic));
+            }
+            return std::bit_cast<float> (o | ((static_cast<std::uint32_t>(h) & 0x8000u) << 16));
+#endif
+        }
+    };
+
+    //! Conversions between a storage type S and the compute type Flt
+    template <typename S>
+    struct storage_conv
+    {
+        static_assert (std::is_arithmetic_v<S>, "storage_conv: unsupported storage type");
+        template <typename Flt>
+        static Flt load (const S s) { return static_cast<Flt>(s); }
+        template <typename Flt>
+        static S store (const Flt f) { return static_cast<S>(f); }
+    };
+    template <>
+    struct storage_conv<bfloat16>
+    {
+        template <typename Flt>
+        static Flt load (const bfloat16 s) { return static_cast<Flt>(static_cast<float>(s)); }
+        template <typename Flt>
+        static bfloat16 store (const Flt f) { return bfloat16 (static_cast<float>(f)); }
+    };
+    template <>
+    struct storage_conv<float16>
+    {
+        template <typename Flt>
+        static Flt load (const float16 s) { return static_cast<Flt>(static_cast<float>(s)); }
+        template <typename Flt>
+        static float16 store (const Flt f) { return float16 (static_cast<float>(f)); }
+    };
+
+    /*!
+     * A field of n values computed in Flt and stored as S (bfloat16, float16, float...). Read
+     * with get() or load(); write with set(), or with store() or update(), which also record
+     * the rounding error of the write in last_error (and the worst so far in worst_error).
+     */
+    template <typename S, typename Flt = float>
+    struct stored_field
+    {
+        static_assert (std::is_floating_point_v<Flt>, "stored_field: the compute type must be floating point");
+        using value_type = Flt;
+        using storage_type = S;
+
+        //! The rounding error of a write, relative to the values written
+        struct rounding_error
+        {
+            //! The largest |written - stored|
+            Flt max_abs = Flt{0};
+            //! The largest |written - stored| / |written|, over the non-zero values written
+            Flt max_rel = Flt{0};
+            //! The root mean square of written - stored
+            Flt rms = Flt{0};
+            /*!
+             * The number of values that update() changed in Flt but which rounded back to the
+             * value already stored, so that the change was lost. Many stalled values mean that
+             * the increments of a step are below the storage's resolution (a shorter dt makes
+             * it worse) and that S is too narrow for the field.
+             */
+            std::size_t stalled = 0;
+        };
+
+        //! The stored values
+        std::vector<S> data;
+        //! The rounding error of the last store() or update()
+        rounding_error last_error;
+        //! The largest errors of the store()s and update()s since construction or reset_error()
+        rounding_error worst_error;
+
+        stored_field() = default;
+        explicit stored_field (const std::size_t n, const Flt v = Flt{0}) { this->resize (n, v); }
+
+        std::size_t size() const { return this->data.size(); }
+        void resize (const std::size_t n, const Flt v = Flt{0}) { this->data.resize (n, storage_conv<S>::store (v)); }
+
+        Flt get (const std::size_t i) const { return storage_conv<S>::template load<Flt> (this->data[i]); }
+        Flt operator[] (const std::size_t i) const { return this->get (i); }
+        //! Write one value, with no error monitoring
+        void set (const std::size_t i, const Flt v) { this->data[i] = storage_conv<S>::store (v); }
+
+        //! All the values, in Flt
+        void load (std::vector<Flt>& out) const
+        {
+            out.resize (this->size());
+            const long long int n = static_cast<long long int>(this->size());
+#pragma omp parallel for schedule(static)
+            for (long long int i = 0; i < n; ++i) { out[i] = this->get (i); }
+        }
+        std::vector<Flt> load() const
+        {
+            std::vector<Flt> out;
+            this->load (out);
+            return out;
+        }
+
+        //! Store all of in (resizing to match), measuring the rounding error
+        void store (const std::vector<Flt>& in)
+        {
+            this->data.resize (in.size());
+            this->update ([&in](std::size_t i, Flt) { return in[i]; });
+        }
+
+        /*!
+         * Replace each value x_i with f (i, x_i), computed in Flt, measuring the rounding
+         * error of the writes. The calls are made concurrently.
+         */
+        template <typename F>
+        void update (F&& f)
+        {
+            const long long int n = static_cast<long long int>(this->size());
+            Flt max_abs = Flt{0};
+            Flt max_rel = Flt{0};
+            double sse = 0.0;
+            std::size_t stalled = 0;
+#pragma omp parallel for schedule(static) reduction(max:max_abs, max_rel) reduction(+:sse, stalled)
+            for (long long int i = 0; i < n; ++i) {
+                const Flt x = this->get (i);
+                const Flt v = f (static_cast<std::size_t>(i), x);
+                this->data[i] = storage_conv<S>::store (v);
+                const Flt stored = this->get (i);
+                const Flt e = std::abs (v - stored);
+                max_abs = std::max (max_abs, e);
+                if (v != Flt{0}) { max_rel = std::max (max_rel, e / std::abs (v)); }
+                sse += static_cast<double>(e) * static_cast<double>(e);
+                if (v != x && stored == x) { ++stalled; }
+            }
+            this->last_error.max_abs = max_abs;
+            this->last_error.max_rel = max_rel;
+            this->last_error.rms = n > 0 ? static_cast<Flt>(std::sqrt (sse / static_cast<double>(n))) : Flt{0};
+            this->last_error.stalled = stalled;
+            this->worst_error.max_abs = std::max (this->worst_error.max_abs, this->last_error.max_abs);
+            this->worst_error.max_rel = std::max (this->worst_error.max_rel, this->last_error.max_rel);
+            this->worst_error.rms = std::max (this->worst_error.rms, this->last_error.rms);
+            this->worst_error.stalled = std::max (this->worst_error.stalled, this->last_error.stalled);
+        }
+
+        void reset_error()
+        {
+            this->last_error = rounding_error{};
+            this->worst_error = rounding_error{};
+        }
+
+        //! The bytes of storage held
+        std::size_t bytes() const { return this->data.capacity() * sizeof (S); }
+    };
+
+} // namespace morph
@@ -0,0 +1,314 @@
+/*!
+ * \file
+ *
+ * A persistent pool of worker threads with work-stealing deques, task groups and a
+ * parallel_for with grain-size control.
+ *
+ * Each worker owns a deque of tasks. A worker pushes the tasks that it makes onto the back of
+ * its own deque and takes its next task from there too; an idle worker steals from the front
+ * of the other deques. Tasks submitted from outside the pool go onto a shared injection
+ * queue. A thread that waits on a task group runs queued tasks until the group is done, so
+ * nested parallel loops do not deadlock and do not start any more threads.
+ *
+ * The library's parallel loops are written with the free function morph::parallel_for. By
+ * default it is an OpenMP loop. Define MORPH_THREADPOOL to run them on threadpool::shared()
+ * instead, which a host application can replace with its own pool (set_shared), or size with
+ * the environment variable MORPH_NUM_THREADS, to cap and share the threads used by
+ * morphologica and by the application.
+ */
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstddef>
+
+namespace morph {
+
+    class threadpool
+    {
+    public:
+        //! Start default_size() worker threads
+        threadpool() : threadpool (default_size()) {}
+
+        /*!
+         * Start n worker threads. The thread that waits on the pool's work also runs tasks,
+         * so with n of 0 all the work is done by the waiting thread.
+         */
+        explicit threadpool (unsigned int n)
+        {
+            // One deque per worker, then the injection queue
+            for (unsigned int i = 0; i <= n; ++i) { this->queues.push_back (std::make_unique<task_queue>()); }
+            for (unsigned int i = 0; i < n; ++i) { this->workers.emplace_back (&threadpool::run, this, i); }
+        }
+
+        //! Finish the tasks already queued, then stop the workers
+        ~threadpool()
+        {
+            {
+                std::lock_guard<std::mutex> lk (this->sleep_m);
+                this->stopping = true;
+            }
+            this->cv_work.notify_all();
+            for (auto& w : this->workers) { if (w.joinable()) { w.join(); } }
+            if (shared_override.load() == this) { shared_override.store (nullptr); }
+        }
+
+        threadpool (const threadpool&) = delete;
+        threadpool& operator= (const threadpool&) = delete;
+
+        /*!
+         * The number of worker threads for a default pool: one fewer than the value of
+         * MORPH_NUM_THREADS, if that is set, or than the number of hardware threads. The
+         * thread that waits makes up the number.
+         */
+        static unsigned int default_size()
+        {
+            unsigned int n = std::thread::hardware_concurrency();
+            if (const char* e = std::getenv ("MORPH_NUM_THREADS")) {
+                try {
+                    n = static_cast<unsigned int>(std::stoul (e));
+                } catch (const std::exception&) {
+                    std::cerr << "threadpool: ignoring MORPH_NUM_THREADS=" << e << std::endl;
+                }
+            }
+            return n > 1u ? n - 1u : 0u;
+        }
+
+        /*!
+         * The pool shared by everything in the program: the one passed to set_shared(), or
+         * else a default pool whose threads start on first use.
+         */
+        static threadpool& shared()
+        {
+            if (threadpool* p = shared_override.load()) { return *p; }
+            static threadpool p;
+            return p;
+        }
+
+        /*!
+         * Make p the shared pool, so that morphologica's parallel loops use the host
+         * application's threads. p must outlive its use; pass nullptr to return to the
+         * default pool.
+         */
+        static void set_shared (threadpool* p) { shared_override.store (p); }
+
+        //! The number of worker threads
+        unsigned int size() const { return static_cast<unsigned int>(this->workers.size()); }
+
+        /*!
+         * Queue the task t. From one of this pool's workers, t goes onto the back of its own
+         * deque; from any other thread, onto the injection queue. A task that throws is
+         * reported on std::cerr; use a task_group to get its exception back.
+         */
+        void submit (std::function<void()>&& t)
+        {
+            const std::size_t qi = (tl_pool == this) ? tl_index : this->workers.size();
+            {
+                std::lock_guard<std::mutex> lk (this->queues[qi]->m);
+                this->queues[qi]->q.push_back (std::move (t));
+            }
+            ++this->queued;
+            // Taking sleep_m orders this with a worker's check of queued before it sleeps
+            { std::lock_guard<std::mutex> lk (this->sleep_m); }
+            this->cv_work.notify_one();
+        }
+
+        /*!
+         * Run one queued task, if there is one: from the back of this thread's own deque,
+         * else from the front of the injection queue, else stolen from the front of another
+         * worker's deque. Returns false if no task was run.
+         */
+        bool try_run_one()
+        {
+            std::function<void()> t;
+            if (!this->take (t)) { return false; }
+            try {
+                t();
+            } catch (const std::exception& e) {
+                std::cerr << "threadpool: a task threw: " << e.what() << std::endl;
+            }
+            return true;
+        }
+
+        /*!
+         * Call f (i) for each i in [begin, end), in chunks of grain indices, on the pool's
+         * threads and the calling thread. With grain of 0, the range is cut into about eight
+         * chunks per thread. A range of one chunk runs in the calling thread. Returns once
+         * every call has been made; the first exception thrown by f is rethrown.
+         */
+        template <typename I, typename F>
+        void parallel_for (I begin, I end, F&& f, std::size_t grain = 0);
+
+    private:
+        struct task_queue
+        {
+            std::mutex m;
+            std::deque<std::function<void()>> q;
+        };
+
+        bool take (std::function<void()>& t)
+        {
+            if (this->queued.load() == 0) { return false; }
+            const std::size_t nw = this->workers.size();
+            const bool own = (tl_pool == this);
+            if (own && this->pop (*this->queues[tl_index], t, true)) { return true; }
+            if (this->pop (*this->queues[nw], t, false)) { return true; }
+            const std::size_t start = own ? tl_index + 1 : 0;
+            for (std::size_t k = 0; k < nw; ++k) {
+                const std::size_t qi = (start + k) % nw;
+                if (own && qi == tl_index) { continue; }
+                if (this->pop (*this->queues[qi], t, false)) { return true; }
+            }
+            return false;
+        }
+
+        bool pop (task_queue& tq, std::function<void()>& t, bool back)
+        {
+            std::lock_guard<std::mutex> lk (tq.m);
+            if (tq.q.empty()) { return false; }
+            if (back) {
+                t = std::move (tq.q.back());
+                tq.q.pop_back();
+            } else {
+                t = std::move (tq.q.front());
+                tq.q.pop_front();
+            }
+            --this->queued;
+            return true;
+        }
+
+        void run (unsigned int i)
+        {
+            tl_pool = this;
+            tl_index = i;
+            for (;;) {
+                if (this->try_run_one()) { continue; }
+                std::unique_lock<std::mutex> lk (this->sleep_m);
+                this->cv_work.wait (lk, [this] { return this->stopping || this->queued.load() > 0; });
+                if (this->stopping && this->queued.load() == 0) { break; }
+            }
+        }
+
+        //! The pool (if any) that this thread works for, and its deque in that pool
+        static inline thread_local const threadpool* tl_pool = nullptr;
+        static inline thread_local std::size_t tl_index = 0;
+        static inline std::atomic<threadpool*> shared_override = nullptr;
+
+        std::vector<std::unique_ptr<task_queue>> queues;
+        std::atomic<std::size_t> queued = 0;
+        bool stopping = false;
+        std::mutex sleep_m;
+        std::condition_variable cv_work;
+        std::vector<std::thread> workers;
+    };
+
+    /*!
+     * A set of tasks run on a threadpool, which can be waited on together. wait() helps to
+     * run the pool's tasks until all of the group's tasks are done, then rethrows the first
+     * exception that any of them threw.
+     */
+    class task_group
+    {
+    public:
+        explicit task_group (threadpool& p = threadpool::shared()) : pool (p) {}
+
+        //! Wait for the tasks still running. Their exceptions are dropped; call wait() to see them.
+        ~task_group()
+        {
+            try { this->wait(); } catch (...) {}
+        }
+
+        task_group (const task_group&) = delete;
+        task_group& operator= (const task_group&) = delete;
+
+        //! Run f on the pool as a task of this group
+        template <typename F>
+        void run (F&& f)
+        {
+            ++this->pending;
+            this->pool.submit ([this, f = std::forward<F>(f)]() mutable {
+                try {
+                    f();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk (this->err_m);
+                    if (!this->err) { this->err = std::current_exception(); }
+                }
+                // The group may be gone as soon as pending reaches 0
+                --this->pending;
+            });
+        }
+
+        //! Run queued tasks until the group's tasks are done, then rethrow the first exception
+        void wait()
+        {
+            while (this->pending.load() > 0) {
+                if (!this->pool.try_run_one()) { std::this_thread::yield(); }
+            }
+            std::exception_ptr e;
+            {
+                std::lock_guard<std::mutex> lk (this->err_m);
+                std::swap (e, this->err);
+            }
+            if (e) { std::rethrow_exception (e); }
+        }
+
+    private:
+        threadpool& pool;
+        std::atomic<std::size_t> pending = 0;
+        std::mutex err_m;
+        std::exception_ptr err;
+    };
+
+    template <typename I, typename F>
+    void threadpool::parallel_for (I begin, I end, F&& f, std::size_t grain)
+    {
+        if (!(begin < end)) { return; }
+        const std::size_t n = static_cast<std::size_t>(end - begin);
+        if (grain == 0) { grain = std::max (std::size_t{1}, n / (8 * (this->workers.size() + 1))); }
+        if (this->workers.empty() || n <= grain) {
+            for (I i = begin; i < end; ++i) { f (i); }
+            return;
+        }
+        task_group g (*this);
+        for (std::size_t s = 0; s < n; s += grain) {
+            const I b = static_cast<I>(begin + static_cast<I>(s));
+            const I e = static_cast<I>(begin + static_cast<I>(std::min (n, s + grain)));
+            g.run ([&f, b, e] { for (I i = b; i < e; ++i) { f (i); } });
+        }
+        g.wait();
+    }
+
+    /*!
+     * Call f (i) for each i in [begin, end) in parallel. The calls must be independent. With
+     * a grain above 0, indices are handed out grain at a time (for uneven work), else the
+     * range is divided evenly. With MORPH_THREADPOOL defined, this runs on
+     * threadpool::shared(); otherwise it is an OpenMP loop.
+     */
+    template <typename I, typename F>
+    void parallel_for (I begin, I end, F&& f, std::size_t grain = 0)
+    {
+#ifdef MORPH_THREADPOOL
+        threadpool::shared().parallel_for (begin, end, std::forward<F>(f), grain);
+#else
+        if (grain == 0) {
+#pragma omp parallel for schedule(static)
+            for (I i = begin; i < end; ++i) { f (i); }
+        } else {
+#pragma omp parallel for schedule(dynamic, static_cast<int>(grain))
+            for (I i = begin; i < end; ++i) { f (i); }
+        }
+#endif
+    }
+
+} // namespace morph
@@ -0,0 +1,341 @@
+/*!
+ * \file
+ *
+ * Timeline tracing across morphologica: rendering, buffer uploads, HDF5 I/O, text setup and
+ * compute shader dispatches (with their GPU times), written as Chrome trace event JSON, which
+ * chrome://tracing and the Perfetto UI (ui.perfetto.dev) open.
+ *
+ * The MORPH_TRACE_* macros compile to nothing unless MORPH_TRACE is defined (to 1) for the whole
+ * build, so ordinary builds carry no cost. With it defined, recording is still off until
+ * morph::trace::start():
+ *
+ *\code{.cpp}
+ * // build with -DMORPH_TRACE=1
+ * morph::trace::start();
+ * for (...) {
+ *     MORPH_TRACE_SCOPE ("my step"); // times the rest of the block
+ *     ...
+ * }
+ * morph::trace::stop();
+ * morph::trace::write_json ("trace.json");
+ *\endcode
+ *
+ * Each thread records into its own buffer without locks (a mutex is taken only the first time
+ * a thread records). The names given to the macros must be string literals (or otherwise live
+ * until the trace is written).
+ */
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+namespace morph {
+    namespace trace {
+
+        //! One trace event; the phases are those of the Chrome trace event format
+        struct event
+        {
+            const char* name = nullptr;
+            const char* cat = nullptr;
+            //! ns since the trace clock's epoch
+            std::int64_t ts = 0;
+            //! ns, for complete ('X') events; the value of a counter ('C') event
+            std::int64_t dur = 0;
+            //! 'X' complete, 'i' instant, 'C' counter
+            char ph = 'X';
+        };
+
+        /*!
+         * The events of one thread. Only the owning thread appends; write_json() may read on
+         * another thread at the same time. Events go into fixed size chunks, each published to
+         * readers with a release store of its count, so no lock is needed.
+         */
+        class thread_buffer
+        {
+        public:
+            static constexpr std::size_t chunk_events = 4096;
+
+            struct chunk
+            {
+                std::array<event, chunk_events> events;
+                std::atomic<std::size_t> n = 0;
+                std::atomic<chunk*> next = nullptr;
+            };
+
+            explicit thread_buffer (const std::uint32_t _tid) : tid(_tid)
+            {
+                this->head = new chunk;
+                this->tail = this->head;
+            }
+            thread_buffer (const thread_buffer&) = delete;
+            thread_buffer& operator= (const thread_buffer&) = delete;
+            ~thread_buffer()
+            {
+                chunk* c = this->head;
+                while (c != nullptr) {
+                    chunk* nx = c->next.load (std::memory_order_relaxed);
+                    delete c;
+                    c = nx;
+                }
+            }
+
+            //! Append e. Owning thread only.
+            void record (const event& e)
+            {
+                std::size_t n = this->tail->n.load (std::memory_order_relaxed);
+                if (n == chunk_events) {
+                    chunk* c = new chunk;
+                    this->tail->next.store (c, std::memory_order_release);
+                    this->tail = c;
+                    n = 0;
+                }
+                this->tail->events[n] = e;
+                this->tail->n.store (n + 1, std::memory_order_release);
+            }
+
+            //! Call f for each event recorded so far, oldest first. Any thread.
+            template <typename F>
+            void for_each (F&& f) const
+            {
+                for (const chunk* c = this->head; c != nullptr; c = c->next.load (std::memory_order_acquire)) {
+                    const std::size_t n = c->n.load (std::memory_order_acquire);
+                    for (std::size_t i = 0; i < n; ++i) { f (c->events[i]); }
+                }
+            }
+
+            //! Drop everything but the first chunk, emptied. Only while nothing records.
+            void clear()
+            {
+                chunk* c = this->head->next.exchange (nullptr, std::memory_order_relaxed);
+                while (c != nullptr) {
+                    chunk* nx = c->next.load (std::memory_order_relaxed);
+                    delete c;
+                    c = nx;
+                }
+                this->head->n.store (0, std::memory_order_relaxed);
+                this->tail = this->head;
+            }
+
+            //! The thread's number in the trace
+            const std::uint32_t tid;
+
+        private:
+            chunk* head = nullptr;
+            chunk* tail = nullptr;
+        };
+
+        //! The events of all threads, and whether they are being recorded
+        class tracer
+        {
+        public:
+            static tracer& get()
+            {
+                static tracer t;
+                return t;
+            }
+
+            //! The thread track for GPU events (see gpu_event())
+            static constexpr std::uint32_t gpu_tid = 0;
+
+            std::atomic<bool> recording = false;
+
+            //! ns since the trace epoch (the first use of the tracer)
+            std::int64_t now() const
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->epoch).count();
+            }
+
+            //! This thread's buffer, made and registered on first use
+            thread_buffer& local()
+            {
+                thread_local std::shared_ptr<thread_buffer> tb;
+                if (!tb) {
+                    std::lock_guard<std::mutex> lk (this->m);
+                    tb = std::make_shared<thread_buffer> (static_cast<std::uint32_t>(this->buffers.size() + 1));
+                    this->buffers.push_back (tb);
+                }
+                return *tb;
+            }
+
+            /*!
+             * Record a span from the GPU's timeline. begin_ns and end_ns are GL_TIMESTAMP
+             * values, which are placed on the trace clock with the offset set by
+             * gpu_calibrate(). Any thread.
+             */
+            void gpu_event (const char* name, const std::int64_t begin_ns, const std::int64_t end_ns)
+            {
+                std::lock_guard<std::mutex> lk (this->gpu_m);
+                const std::int64_t off = this->gpu_offset.load (std::memory_order_relaxed);
+                this->gpu_events.push_back (event{ name, "gpu", begin_ns + off, end_ns - begin_ns, 'X' });
+            }
+
+            //! Relate the GPU clock to the trace clock: gpu_now_ns is a GL_TIMESTAMP read now
+            void gpu_calibrate (const std::int64_t gpu_now_ns)
+            {
+                this->gpu_offset.store (this->now() - gpu_now_ns, std::memory_order_relaxed);
+                this->gpu_calibrated.store (true, std::memory_order_relaxed);
+            }
+            bool is_gpu_calibrated() const { return this->gpu_calibrated.load (std::memory_order_relaxed); }
+
+            //! Write every event recorded (so far) as Chrome trace event JSON
+            void write_json (const std::string& path)
+            {
+                std::ofstream f (path, std::ios::out | std::ios::trunc);
+                if (!f.is_open()) { throw std::runtime_error ("morph::trace::write_json: can't open " + path); }
+                std::vector<std::shared_ptr<thread_buffer>> bufs;
+                {
+                    std::lock_guard<std::mutex> lk (this->m);
+                    bufs = this->buffers;
+                }
+                f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+                bool first = true;
+                auto sep = [&f, &first]() { if (!first) { f << ",\n"; } first = false; };
+                auto write = [&f, &sep](const event& e, const std::uint32_t tid) {
+                    sep();
+                    f << "{\"name\":\"";
+                    tracer::escape (f, e.name);
+                    f << "\",\"cat\":\"";
+                    tracer::escape (f, e.cat);
+                    f << "\",\"ph\":\"" << e.ph << "\",\"ts\":" << tracer::us (e.ts) << ",\"pid\":1,\"tid\":" << tid;
+                    if (e.ph == 'X') {
+                        f << ",\"dur\":" << tracer::us (e.dur);
+                    } else if (e.ph == 'C') {
+                        f << ",\"args\":{\"value\":" << e.dur << "}";
+                    } else if (e.ph == 'i') {
+                        f << ",\"s\":\"t\"";
+                    }
+                    f << "}";
+                };
+                // Name the tracks
+                sep();
+                f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpu_tid << ",\"args\":{\"name\":\"GPU\"}}";
+                for (const auto& b : bufs) {
+                    sep();
+                    f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+                      << ",\"args\":{\"name\":\"thread " << b->tid << "\"}}";
+                }
+                for (const auto& b : bufs) { b->for_each ([&write, &b](const event& e) { write (e, b->tid); }); }
+                {
+                    std::lock_guard<std::mutex> lk (this->gpu_m);
+                    for (const event& e : this->gpu_events) { write (e, gpu_tid); }
+                }
+                f << "\n]}\n";
+                if (!f.good()) { throw std::runtime_error ("morph::trace::write_json: failed to write " + path); }
+            }
+
+            //! Forget the events recorded. Only while no thread records (after stop()).
+            void clear()
+            {
+                std::lock_guard<std::mutex> lk (this->m);
+                for (auto& b : this->buffers) { b->clear(); }
+                std::lock_guard<std::mutex> lkg (this->gpu_m);
+                this->gpu_events.clear();
+            }
+
+        private:
+            tracer() : epoch(std::chrono::steady_clock::now()) {}
+
+            static double us (const std::int64_t ns) { return static_cast<double>(ns) * 1e-3; }
+
+            static void escape (std::ofstream& f, const char* s)
+            {
+                if (s == nullptr) { return; }
+                for (; *s != '\0'; ++s) {
+                    if (*s == '"' || *s == '\\') {
+                        f << '\\' << *s;
+                    } else if (static_cast<unsigned char>(*s) < 0x20) {
+                        f << ' ';
+                    } else {
+                        f << *s;
+                    }
+                }
+            }
+
+            const std::chrono::steady_clock::time_point epoch;
+            std::mutex m;
+            std::vector<std::shared_ptr<thread_buffer>> buffers;
+            // GPU events arrive rarely (a few per frame), so a mutex is fine here
+            std::mutex gpu_m;
+            std::vector<event> gpu_events;
+            std::atomic<std::int64_t> gpu_offset = 0;
+            std::atomic<bool> gpu_calibrated = false;
+        };
+
+        //! Start recording (on all threads)
+        inline void start() { tracer::get().recording.store (true, std::memory_order_relaxed); }
+        //! Stop recording. Scopes open now are still recorded when they close.
+        inline void stop() { tracer::get().recording.store (false, std::memory_order_relaxed); }
+        inline bool recording() { return tracer::get().recording.load (std::memory_order_relaxed); }
+        //! Write the trace to path as Chrome trace event JSON
+        inline void write_json (const std::string& path) { tracer::get().write_json (path); }
+        //! Forget the events recorded so far. Call after stop(), once no thread is recording.
+        inline void clear() { tracer::get().clear(); }
+
+        //! Record a complete event for its lifetime, if recording when made
+        class scope
+        {
+        public:
+            scope (const char* _name, const char* _cat) : name(_name), cat(_cat)
+            {
+                if (recording()) { this->t0 = tracer::get().now(); }
+            }
+            scope (const scope&) = delete;
+            scope& operator= (const scope&) = delete;
+            ~scope()
+            {
+                if (this->t0 < 0) { return; }
+                tracer& t = tracer::get();
+                t.local().record (event{ this->name, this->cat, this->t0, t.now() - this->t0, 'X' });
+            }
+        private:
+            const char* name;
+            const char* cat;
+            std::int64_t t0 = -1;
+        };
+
+        //! Record an instant event
+        inline void instant (const char* name, const char* cat)
+        {
+            if (!recording()) { return; }
+            tracer& t = tracer::get();
+            t.local().record (event{ name, cat, t.now(), 0, 'i' });
+        }
+
+        //! Record the value of a counter, which is drawn as a graph over time
+        inline void counter (const char* name, const std::int64_t value)
+        {
+            if (!recording()) { return; }
+            tracer& t = tracer::get();
+            t.local().record (event{ name, "counter", t.now(), value, 'C' });
+        }
+
+    } // namespace trace
+} // namespace morph
+
+#define MORPH_TRACE_CONCAT2(a, b) a##b
+#define MORPH_TRACE_CONCAT(a, b) MORPH_TRACE_CONCAT2(a, b)
+
+#if defined MORPH_TRACE && MORPH_TRACE
+//! Time the rest of the enclosing block as name
+# define MORPH_TRACE_SCOPE(name) morph::trace::scope MORPH_TRACE_CONCAT(morph_trace_scope_, __LINE__) (name, "morph")
+//! Time the rest of the enclosing block as name, in category cat
+# define MORPH_TRACE_SCOPE_CAT(name, cat) morph::trace::scope MORPH_TRACE_CONCAT(morph_trace_scope_, __LINE__) (name, cat)
+//! Mark a moment
+# define MORPH_TRACE_INSTANT(name) morph::trace::instant (name, "morph")
+//! Record the value of a counter
+# define MORPH_TRACE_COUNTER(name, value) morph::trace::counter (name, static_cast<std::int64_t>(value))
+#else
+# define MORPH_TRACE_SCOPE(name)
+# define MORPH_TRACE_SCOPE_CAT(name, cat)
+# define MORPH_TRACE_INSTANT(name)
+# define MORPH_TRACE_COUNTER(name, value)
+#endif
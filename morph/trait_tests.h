@@ -178,6 +178,13 @@ namespace morph {
     // morph::value_type_t<std::array<float, 2>> is also float.
     template <class T> using value_type_t = typename morph::value_type<T>::type;
 
+    /*!
+     * True for the types that morph::vec and morph::vvec treat as scalars: the std::is_scalar
+     * types, and number types (such as morph::dual) that specialise it.
+     */
+    template <typename T>
+    struct is_scalar_like : std::is_scalar<T> {};
+
     /*! \brief A class to distinguish between scalars and vectors
      *
      * From the typename T, set a #value attribute which says whether T is a scalar (like
@@ -0,0 +1,131 @@
+/*!
+ * \file
+ *
+ * Cached meshes of the unit sphere. A scene of many spheres (a scatter graph, say) would otherwise
+ * recompute the same sines and cosines, or the same geodesic subdivision, for every one. Each mesh
+ * is made once per resolution, on first use, and shared by every VisualModel that draws spheres
+ * (see VisualModel::computeSphere and VisualModel::computeSphereGeo).
+ */
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <type_traits>
+#include <morph/vec.h>
+#include <morph/mathconst.h>
+#include <morph/geometry.h>
+
+namespace morph {
+
+    //! A sphere of radius 1 about the origin. Each vertex is also its own normal.
+    struct unit_sphere_mesh
+    {
+        std::vector<morph::vec<float, 3>> vertices;
+        //! Three vertex indices for each triangle
+        std::vector<unsigned int> indices;
+    };
+
+    struct unit_sphere
+    {
+        /*!
+         * The UV sphere with rings rings and segments segments, with vertices and triangles in the
+         * order that VisualModel::computeSphere has always made them: the cap at -z, each ring of
+         * segments vertices working up in z, then the cap at +z.
+         */
+        static const unit_sphere_mesh& uv (const int rings, const int segments)
+        {
+            return unit_sphere::cached (0, rings, segments, [rings, segments]() { return unit_sphere::make_uv (rings, segments); });
+        }
+
+        /*!
+         * The icosahedral geodesic of \a iterations iterations, computed in precision F (see
+         * morph::geometry::make_icosahedral_geodesic).
+         */
+        template <typename F = float>
+        static const unit_sphere_mesh& geodesic (const int iterations)
+        {
+            constexpr int kind = std::is_same<std::decay_t<F>, float>::value ? 1 : 2;
+            return unit_sphere::cached (kind, iterations, 0, [iterations]() {
+                morph::geometry::icosahedral_geodesic<F> geo = morph::geometry::make_icosahedral_geodesic<F> (iterations);
+                unit_sphere_mesh m;
+                m.vertices.reserve (geo.poly.vertices.size());
+                for (auto v : geo.poly.vertices) { m.vertices.push_back (v.as_float()); }
+                m.indices.reserve (3 * geo.poly.faces.size());
+                for (auto f : geo.poly.faces) {
+                    for (int j = 0; j < 3; ++j) { m.indices.push_back (static_cast<unsigned int>(f[j])); }
+                }
+                return m;
+            });
+        }
+
+    private:
+        //! Return the mesh for key (kind, a, b), calling make to create it if it isn't there yet
+        template <typename Make>
+        static const unit_sphere_mesh& cached (const int kind, const int a, const int b, Make make)
+        {
+            static std::mutex m;
+            static std::map<std::tuple<int, int, int>, std::unique_ptr<const unit_sphere_mesh>> meshes;
+            std::lock_guard<std::mutex> lk (m);
+            auto& p = meshes[{ kind, a, b }];
+            if (!p) { p = std::make_unique<const unit_sphere_mesh> (make()); }
+            return *p;
+        }
+
+        static unit_sphere_mesh make_uv (const int rings, const int segments)
+        {
+            using mc = morph::mathconst<float>;
+            unit_sphere_mesh m;
+            m.vertices.reserve (2 + (rings > 1 ? rings - 1 : 0) * segments);
+
+            // The cap at -z, fanned out to the first ring
+            m.vertices.push_back ({ 0.0f, 0.0f, std::sin (-mc::pi_over_2) });
+            float rings1 = mc::pi * (-0.5f + 1.0f / rings);
+            float z1 = std::sin (rings1);
+            float r1 = std::cos (rings1);
+            for (int j = 0; j < segments; j++) {
+                float segment = mc::two_pi * static_cast<float>(j) / segments;
+                m.vertices.push_back ({ std::cos (segment) * r1, std::sin (segment) * r1, z1 });
+                if (j > 0) {
+                    m.indices.insert (m.indices.end(), { 0u, static_cast<unsigned int>(j), static_cast<unsigned int>(j + 1) });
+                }
+            }
+            m.indices.insert (m.indices.end(), { 0u, static_cast<unsigned int>(segments), 1u });
+
+            // Each further ring, joined to the one below it
+            unsigned int ring_start = 1;
+            for (int i = 2; i < rings; i++) {
+                float rings0 = mc::pi * (-0.5f + static_cast<float>(i) / rings);
+                float z0 = std::sin (rings0);
+                float r0 = std::cos (rings0);
+                const unsigned int below = ring_start;
+                const unsigned int here = ring_start + segments;
+                for (int j = 0; j < segments; j++) {
+                    float segment = mc::two_pi * static_cast<float>(j) / segments;
+                    m.vertices.push_back ({ std::cos (segment) * r0, std::sin (segment) * r0, z0 });
+                    const unsigned int b0 = below + j;
+                    const unsigned int h0 = here + j;
+                    // The last segment joins back to the start of the rings
+                    const unsigned int b1 = j == segments - 1 ? below : b0 + 1;
+                    const unsigned int h1 = j == segments - 1 ? here : h0 + 1;
+                    m.indices.insert (m.indices.end(), { b0, h0, b1, b1, h0, h1 });
+                }
+                ring_start = here;
+            }
+
+            // The cap at +z, fanned in from the last ring
+            const unsigned int cap = static_cast<unsigned int>(m.vertices.size());
+            m.vertices.push_back ({ 0.0f, 0.0f, std::sin (mc::pi_over_2) });
+            for (int j = 0; j < segments; j++) {
+                const unsigned int r0 = ring_start + j;
+                const unsigned int r1 = j == segments - 1 ? ring_start : r0 + 1;
+                m.indices.insert (m.indices.end(), { cap, r0, r1 });
+            }
+            return m;
+        }
+    };
+
+} // namespace morph
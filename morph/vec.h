@@ -21,6 +21,9 @@
 #include <functional>
 #include <cstddef>
 #include <morph/constexpr_math.h>
+#include <morph/trait_tests.h>
+#include <morph/dual.h> // for the morph::math functions of vec<dual>
+#include <morph/simd4.h>
 #include <morph/Random.h>
 #include <morph/range.h>
 
@@ -527,8 +530,8 @@ namespace morph {
         constexpr _S length_sq() const
         {
             _S _sos = _S{0};
-            if constexpr (std::is_scalar<std::decay_t<S>>::value) {
-                if constexpr (std::is_scalar<std::decay_t<_S>>::value) {
+            if constexpr (morph::is_scalar_like<std::decay_t<S>>::value) {
+                if constexpr (morph::is_scalar_like<std::decay_t<_S>>::value) {
                     // Return type is also scalar
                     _sos = this->sos<_S>();
                 } else {
@@ -541,7 +544,7 @@ namespace morph {
                 }
             } else {
                 // S is a vector so i is a vector.
-                if constexpr (std::is_scalar<std::decay_t<_S>>::value) {
+                if constexpr (morph::is_scalar_like<std::decay_t<_S>>::value) {
                     // Return type _S is a scalar
                     for (auto& i : *this) { _sos += i.template sos<_S>(); }
                 } else {
@@ -585,7 +588,7 @@ namespace morph {
         constexpr std::size_t arglongest() const
         {
             std::size_t idx = 0;
-            if constexpr (std::is_scalar<std::decay_t<S>>::value) {
+            if constexpr (morph::is_scalar_like<std::decay_t<S>>::value) {
                 auto abs_compare = [](S a, S b) { return (morph::math::abs(a) < morph::math::abs(b)); };
                 auto thelongest = std::max_element (this->begin(), this->end(), abs_compare);
                 idx = (thelongest - this->begin());
@@ -611,7 +614,7 @@ namespace morph {
         {
             std::size_t idx = 0;
             // Check on the type S. If S is a vec thing, then abs_compare needs to be different.
-            if constexpr (std::is_scalar<std::decay_t<S>>::value) {
+            if constexpr (morph::is_scalar_like<std::decay_t<S>>::value) {
                 auto abs_compare = [](S a, S b) { return (morph::math::abs(a) > morph::math::abs(b)); };
                 auto theshortest = std::max_element (this->begin(), this->end(), abs_compare);
                 idx = (theshortest - this->begin());
@@ -1190,10 +1193,18 @@ namespace morph {
          * This function will only be defined if typename _S is a
          * scalar type. Multiplies this vec<S, N> by s, element-wise.
          */
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr vec<S, N> operator* (const _S& s) const
         {
             vec<S, N> rtn{};
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mul4 (this->data(), s, rtn.data());
+                    return rtn;
+                }
+            }
+#endif
             auto mult_by_s = [s](S elmnt) { return elmnt * s; };
             std::transform (this->begin(), this->end(), rtn.begin(), mult_by_s);
             return rtn;
@@ -1211,6 +1222,14 @@ namespace morph {
         constexpr vec<S, N> operator* (const vec<_S, N>& v) const
         {
             vec<S, N> rtn = {};
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mul4 (this->data(), v.data(), rtn.data());
+                    return rtn;
+                }
+            }
+#endif
             auto vi = v.begin();
             auto mult_by_s = [vi](S lhs) mutable -> S { return lhs * static_cast<S>(*vi++); };
             std::transform (this->begin(), this->end(), rtn.begin(), mult_by_s);
@@ -1223,7 +1242,7 @@ namespace morph {
          * This function will only be defined if typename _S is a
          * scalar type. Multiplies this vec<S, N> by s, element-wise.
          */
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr void operator*= (const _S& s)
         {
             auto mult_by_s = [s](S elmnt) { return elmnt * s; };
@@ -1238,13 +1257,21 @@ namespace morph {
         template <typename _S=S>
         constexpr void operator*= (const vec<_S, N>& v)
         {
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::mul4 (this->data(), v.data(), this->data());
+                    return;
+                }
+            }
+#endif
             auto vi = v.begin();
             auto mult_by_s = [vi](S lhs) mutable -> S { return lhs * static_cast<S>(*vi++); };
             std::transform (this->begin(), this->end(), this->begin(), mult_by_s);
         }
 
         //! Scalar divide by s
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr vec<S, N> operator/ (const _S& s) const
         {
             vec<S, N> rtn;
@@ -1270,7 +1297,7 @@ namespace morph {
         }
 
         //! Scalar divide by s
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr void operator/= (const _S& s)
         {
             auto div_by_s = [s](S elmnt) { return elmnt / s; };
@@ -1289,7 +1316,7 @@ namespace morph {
         }
 
         //! Scalar addition
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr vec<S, N> operator+ (const _S& s) const
         {
             vec<S, N> rtn{};
@@ -1312,6 +1339,14 @@ namespace morph {
         constexpr vec<S, N> operator+ (const vec<_S, N>& v) const
         {
             vec<S, N> vrtn{};
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::add4 (this->data(), v.data(), vrtn.data());
+                    return vrtn;
+                }
+            }
+#endif
             auto vi = v.begin();
             auto add_v = [vi](S a) mutable { return a + (*vi++); };
             std::transform (this->begin(), this->end(), vrtn.begin(), add_v);
@@ -1319,7 +1354,7 @@ namespace morph {
         }
 
         //! Scalar addition
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr void operator+= (const _S& s)
         {
             auto add_s = [s](S elmnt) { return elmnt + s; };
@@ -1337,13 +1372,21 @@ namespace morph {
         template<typename _S=S>
         constexpr void operator+= (const vec<_S, N>& v)
         {
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::add4 (this->data(), v.data(), this->data());
+                    return;
+                }
+            }
+#endif
             auto vi = v.begin();
             auto add_v = [vi](S a) mutable { return a + (*vi++); };
             std::transform (this->begin(), this->end(), this->begin(), add_v);
         }
 
         //! Scalar subtraction
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr vec<S, N> operator- (const _S& s) const
         {
             vec<S, N> rtn{};
@@ -1372,6 +1415,14 @@ namespace morph {
         constexpr vec<S, N> operator- (const vec<_S, N>& v) const
         {
             vec<S, N> vrtn{};
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::sub4 (this->data(), v.data(), vrtn.data());
+                    return vrtn;
+                }
+            }
+#endif
             auto vi = v.begin();
             auto subtract_v = [vi](S a) mutable { return a - (*vi++); };
             std::transform (this->begin(), this->end(), vrtn.begin(), subtract_v);
@@ -1384,7 +1435,7 @@ namespace morph {
 #endif
 
         //! Scalar subtraction
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         constexpr void operator-= (const _S& s)
         {
             auto subtract_s = [s](S elmnt) { return elmnt - s; };
@@ -1402,6 +1453,14 @@ namespace morph {
         template<typename _S=S>
         constexpr void operator-= (const vec<_S, N>& v)
         {
+#ifdef MORPH_SIMD4
+            if constexpr (std::is_same_v<S, float> && std::is_same_v<_S, float> && N == 4) {
+                if (!std::is_constant_evaluated()) {
+                    morph::simd4::sub4 (this->data(), v.data(), this->data());
+                    return;
+                }
+            }
+#endif
             auto vi = v.begin();
             auto subtract_v = [vi](S a) mutable { return a - (*vi++); };
             std::transform (this->begin(), this->end(), this->begin(), subtract_v);
@@ -0,0 +1,195 @@
+/*!
+ * \file
+ * \brief Expression templates for lazy, fused element-wise arithmetic on morph::vvec.
+ *
+ * An expression such as a * b + c * d - e on morph::vvec makes a temporary vvec for each of the
+ * four operations. Starting the expression with vvec::lazy() instead builds a tree of
+ * lightweight expression objects which is evaluated in a single loop when it is assigned to (or
+ * used to construct) a vvec:
+ *
+ *\code{.cpp}
+ * morph::vvec<float> a, b, c, d, e; // all of the same size
+ * morph::vvec<float> r = a.lazy() * b + c * d - e; // one loop, one allocation (for r)
+ * r = r.lazy() * 0.5f + a;                          // no allocation at all
+ * r += a.lazy() * b;
+ *\endcode
+ *
+ * Once an operand is lazy, any vvec, std::vector or scalar combined with it becomes part of the
+ * expression. The expression objects refer to the data of the vvecs in it, so evaluate an
+ * expression before any of those vvecs go out of scope, change size or are destroyed (don't keep
+ * one in an auto variable for later).
+ *
+ * \author Seb James
+ * \date 2025
+ */
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace morph {
+
+    // vvec is declared in vvec.h, which includes this file
+    template <typename S, typename Al> struct vvec;
+
+    //! The base of all the vexpr types, used to identify them
+    struct vexpr_base {};
+
+    //! True if E is a vexpr type
+    template <typename E>
+    struct is_vexpr : std::is_base_of<vexpr_base, std::decay_t<E>> {};
+
+    //! An expression leaf that reads the elements of a contiguous container (a vvec or std::vector)
+    template <typename S>
+    struct vexpr_leaf : public vexpr_base
+    {
+        using value_type = S;
+        static constexpr bool is_scalar = false;
+
+        vexpr_leaf (const S* _p, const std::size_t _n) : p(_p), n(_n) {}
+
+        S operator[] (const std::size_t i) const { return this->p[i]; }
+        std::size_t size() const { return this->n; }
+
+        const S* p = nullptr;
+        std::size_t n = 0;
+    };
+
+    //! An expression leaf that has the same value for every element
+    template <typename S>
+    struct vexpr_scalar : public vexpr_base
+    {
+        using value_type = S;
+        static constexpr bool is_scalar = true;
+
+        vexpr_scalar (const S _s) : s(_s) {}
+
+        S operator[] (const std::size_t) const { return this->s; }
+        std::size_t size() const { return 0; }
+
+        S s;
+    };
+
+    //! An element-wise binary operation Op on expressions L and R
+    template <typename Op, typename L, typename R>
+    struct vexpr_binary : public vexpr_base
+    {
+        using value_type = std::decay_t<decltype(Op{}(std::declval<typename L::value_type>(),
+                                                       std::declval<typename R::value_type>()))>;
+        static constexpr bool is_scalar = L::is_scalar && R::is_scalar;
+
+        vexpr_binary (const L& _l, const R& _r) : l(_l), r(_r)
+        {
+            if constexpr (!L::is_scalar && !R::is_scalar) {
+                if (this->l.size() != this->r.size()) {
+                    throw std::runtime_error ("vexpr: element-wise operation on vvecs of different dimensionality");
+                }
+            }
+        }
+
+        value_type operator[] (const std::size_t i) const { return Op{}(this->l[i], this->r[i]); }
+        std::size_t size() const { return L::is_scalar ? this->r.size() : this->l.size(); }
+
+        L l;
+        R r;
+    };
+
+    //! Element-wise negation of expression E
+    template <typename E>
+    struct vexpr_negate : public vexpr_base
+    {
+        using value_type = typename E::value_type;
+        static constexpr bool is_scalar = E::is_scalar;
+
+        vexpr_negate (const E& _e) : e(_e) {}
+
+        value_type operator[] (const std::size_t i) const { return -this->e[i]; }
+        std::size_t size() const { return this->e.size(); }
+
+        E e;
+    };
+
+    namespace vexpr_impl {
+
+        //! Make the expression node for operand T of an operation whose other operand has element type S
+        template <typename S, typename T>
+        auto operand (const T& t)
+        {
+            if constexpr (is_vexpr<T>::value) {
+                return t;
+            } else if constexpr (std::is_arithmetic<std::decay_t<T>>::value) {
+                // Scalars take the element type of the expression so that, as for vvec's own
+                // operators, vvec<float> * 2.0 has float elements
+                return vexpr_scalar<S> (static_cast<S>(t));
+            } else {
+                return vexpr_leaf<typename T::value_type> (t.data(), t.size());
+            }
+        }
+
+        //! The element type of operand T (void for scalars)
+        template <typename T, typename = void>
+        struct elem { using type = void; };
+        template <typename T>
+        struct elem<T, std::enable_if_t<is_vexpr<T>::value || !std::is_arithmetic<std::decay_t<T>>::value>>
+        {
+            using type = typename std::decay_t<T>::value_type;
+        };
+
+        //! True if T can be an operand of a vexpr operation: a vexpr, a scalar, a vvec or a std::vector
+        template <typename T>
+        struct is_operand : std::false_type {};
+        template <typename S, typename Al>
+        struct is_operand<morph::vvec<S, Al>> : std::true_type {};
+        template <typename S, typename Al>
+        struct is_operand<std::vector<S, Al>> : std::true_type {};
+
+        //! Operations are defined when at least one side is a vexpr and the other is an operand
+        template <typename L, typename R>
+        constexpr bool enable = (is_vexpr<L>::value || is_vexpr<R>::value)
+        && (is_vexpr<L>::value || std::is_arithmetic<std::decay_t<L>>::value || is_operand<std::decay_t<L>>::value)
+        && (is_vexpr<R>::value || std::is_arithmetic<std::decay_t<R>>::value || is_operand<std::decay_t<R>>::value);
+
+        template <typename Op, typename L, typename R>
+        auto make (const L& l, const R& r)
+        {
+            // A scalar takes the element type of the other side
+            using Sl = typename elem<L>::type;
+            using Sr = typename elem<R>::type;
+            using lS = std::conditional_t<std::is_void_v<Sl>, Sr, Sl>;
+            using rS = std::conditional_t<std::is_void_v<Sr>, Sl, Sr>;
+            auto le = operand<lS> (l);
+            auto re = operand<rS> (r);
+            return vexpr_binary<Op, decltype(le), decltype(re)> (le, re);
+        }
+
+        //! Write the elements of expression e into out, which has room for e.size() elements
+        template <typename S, typename E>
+        void assign (S* out, const E& e)
+        {
+            const std::size_t n = e.size();
+#pragma omp simd
+            for (std::size_t i = 0; i < n; ++i) { out[i] = static_cast<S>(e[i]); }
+        }
+
+    } // namespace vexpr_impl
+
+    template <typename L, typename R, std::enable_if_t<vexpr_impl::enable<L, R>, int> = 0>
+    auto operator+ (const L& l, const R& r) { return vexpr_impl::make<std::plus<>> (l, r); }
+
+    template <typename L, typename R, std::enable_if_t<vexpr_impl::enable<L, R>, int> = 0>
+    auto operator- (const L& l, const R& r) { return vexpr_impl::make<std::minus<>> (l, r); }
+
+    template <typename L, typename R, std::enable_if_t<vexpr_impl::enable<L, R>, int> = 0>
+    auto operator* (const L& l, const R& r) { return vexpr_impl::make<std::multiplies<>> (l, r); }
+
+    template <typename L, typename R, std::enable_if_t<vexpr_impl::enable<L, R>, int> = 0>
+    auto operator/ (const L& l, const R& r) { return vexpr_impl::make<std::divides<>> (l, r); }
+
+    template <typename E, std::enable_if_t<is_vexpr<E>::value, int> = 0>
+    auto operator- (const E& e) { return vexpr_negate<E> (e); }
+
+} // namespace morph
@@ -23,9 +23,28 @@
 #include <morph/Random.h>
 #include <morph/range.h>
 #include <morph/trait_tests.h>
+#include <morph/vexpr.h>
+#include <morph/vvec_par.h>
+#include <morph/math_fast.h>
+#include <morph/fft.h>
 
 namespace morph {
 
+    /*
+     * The maths functions that vvec applies to its elements: std's for the arithmetic types and,
+     * for other number types (such as morph::dual), those found by argument dependent lookup.
+     */
+    namespace vvec_math {
+        template <typename S> auto sqrt (const S& x) { using std::sqrt; return sqrt (x); }
+        template <typename S> auto abs (const S& x) { using std::abs; return abs (x); }
+        template <typename S, typename P> auto pow (const S& x, const P& p) { using std::pow; return pow (x, p); }
+        template <typename S> auto log (const S& x) { using std::log; return log (x); }
+        template <typename S> auto log10 (const S& x) { using std::log10; return log10 (x); }
+        template <typename S> auto sin (const S& x) { using std::sin; return sin (x); }
+        template <typename S> auto cos (const S& x) { using std::cos; return cos (x); }
+        template <typename S> auto exp (const S& x) { using std::exp; return exp (x); }
+    }
+
     /*!
      * \brief N-D vector class deriving from std::vector
      *
@@ -66,6 +85,56 @@ namespace morph {
         //! We inherit std::vector's constructors like this:
         using std::vector<S, Al>::vector;
 
+        //! Construct from a vexpr, evaluating it in one loop
+        template <typename E, std::enable_if_t<morph::is_vexpr<E>::value, int> = 0>
+        vvec (const E& e) : std::vector<S, Al>(e.size()) { morph::vexpr_impl::assign (this->data(), e); }
+
+        //! The vexpr constructor would otherwise suppress the default constructor
+        vvec() = default;
+
+        /*!
+         * Assign from a vexpr. The expression is evaluated in one loop and no temporary vvecs are
+         * made. *this may appear in the expression (r = r.lazy() * k + a is fine).
+         */
+        template <typename E, std::enable_if_t<morph::is_vexpr<E>::value, int> = 0>
+        vvec& operator= (const E& e)
+        {
+            if constexpr (E::is_scalar) {
+                std::fill (this->begin(), this->end(), static_cast<S>(e[0]));
+            } else {
+                if (e.size() != this->size()) { this->resize (e.size()); }
+                morph::vexpr_impl::assign (this->data(), e);
+            }
+            return *this;
+        }
+
+        /*!
+         * Begin a lazy expression with *this. Arithmetic with the returned object makes
+         * expression objects rather than vvecs; see morph/vexpr.h.
+         */
+        morph::vexpr_leaf<S> lazy() const { return morph::vexpr_leaf<S> (this->data(), this->size()); }
+
+        /*!
+         * The bulk operations of *this, run in parallel if it has at least min_n elements:
+         * v.par().sum(), v.par().exp_inplace(), r.par() = a.lazy() * b; see morph/vvec_par.h.
+         */
+        morph::vvec_par<vvec<S, Al>> par (const std::size_t min_n = std::size_t{1} << 16)
+        {
+            return morph::vvec_par<vvec<S, Al>> (*this, min_n);
+        }
+        morph::vvec_par<const vvec<S, Al>> par (const std::size_t min_n = std::size_t{1} << 16) const
+        {
+            return morph::vvec_par<const vvec<S, Al>> (*this, min_n);
+        }
+
+        //! Add the vexpr e to *this, element-wise, in one loop
+        template <typename E, std::enable_if_t<morph::is_vexpr<E>::value, int> = 0>
+        void operator+= (const E& e) { *this = this->lazy() + e; }
+
+        //! Subtract the vexpr e from *this, element-wise, in one loop
+        template <typename E, std::enable_if_t<morph::is_vexpr<E>::value, int> = 0>
+        void operator-= (const E& e) { *this = this->lazy() - e; }
+
         //! Used in functions for which wrapping is important
         enum class wrapdata { none, wrap };
 
@@ -327,7 +396,7 @@ namespace morph {
         void renormalize()
         {
             auto add_squared = [](_S a, _S b) { return a + b * b; };
-            const _S denom = std::sqrt (std::accumulate (this->begin(), this->end(), _S{0}, add_squared));
+            const _S denom = vvec_math::sqrt (std::accumulate (this->begin(), this->end(), _S{0}, add_squared));
             if (denom != _S{0}) {
                 _S oneovermag = _S{1} / denom;
                 auto x_oneovermag = [oneovermag](_S f) { return f * oneovermag; };
@@ -382,12 +451,17 @@ namespace morph {
          * numbers drawn from a uniform distribution between 0 and 1 if S is a
          * floating point type or to integers between std::numeric_limits<S>::min()
          * and std::numeric_limits<S>::max() if S is an integral type (See
-         * morph::RandUniform for details).
+         * morph::RandUniform for details). The numbers come from this thread's
+         * morph::default_rng engine; call morph::default_rng::seed() for a repeatable
+         * sequence.
          */
         void randomize()
         {
-            RandUniform<S> ru;
-            for (auto& i : *this) { i = ru.get(); }
+            if constexpr (std::is_integral<std::decay_t<S>>::value) {
+                this->randomize (std::numeric_limits<S>::min(), std::numeric_limits<S>::max());
+            } else {
+                this->randomize (S{0}, S{1});
+            }
         }
 
         /*!
@@ -396,48 +470,77 @@ namespace morph {
          * Randomly set the elements of the vector. Elements are set to random
          * numbers drawn from a uniform distribution between \a min and \a
          * max. Strictly, the range is [min, max) (including min, not including max)
+         * for floating point S and [min, max] for integral S. Floating point elements
+         * are computed in parallel (see morph::philox_fill_uniform).
          */
         void randomize (S min, S max)
         {
-            RandUniform<S> ru (min, max);
-            for (auto& i : *this) { i = ru.get(); }
+            if constexpr (std::is_integral<std::decay_t<S>>::value) {
+                std::uniform_int_distribution<S> dist (min, max);
+                morph::philox4x32& e = morph::default_rng::engine();
+                for (auto& i : *this) { i = dist (e); }
+            } else {
+                morph::philox_fill_uniform (morph::default_rng::engine(), *this, min, max);
+            }
         }
 
         /*!
          * Randomize the vector from a Gaussian distribution
          *
-         * Randomly set the elements of the vector. Elements are set to random
-         * numbers drawn from a uniform distribution between \a min and \a
-         * max. Strictly, the range is [min, max)
+         * Randomly set the elements of the vector. Elements are set to random numbers
+         * drawn from a normal distribution of mean \a _mean and standard deviation \a
+         * _sd, computed in parallel from this thread's morph::default_rng engine.
          */
         void randomizeN (S _mean, S _sd)
         {
-            RandNormal<S> rn (_mean, _sd);
-            for (auto& i : *this) { i = rn.get(); }
+            morph::philox_fill_normal (morph::default_rng::engine(), *this, _mean, _sd);
+        }
+
+        /*!
+         * Randomize the vector from a caller-owned generator, such as a morph::RandUniform,
+         * RandNormal, RandLogNormal or RandPoisson. The generator keeps its engine state from
+         * call to call, so this is cheap on small vectors and repeatable from a fixed seed. If
+         * the generator has a bulk get() for containers, that is used.
+         */
+        template <typename R> requires requires (R& r) { { r.get() } -> std::convertible_to<S>; }
+        void randomize (R& rng)
+        {
+            if constexpr (requires (R& r, vvec<S, Al>& v) { r.get (v); }) {
+                rng.get (*this);
+            } else {
+                for (auto& i : *this) { i = rng.get(); }
+            }
         }
 
         /*!
          * Re-order the elements in the vvec - shuffle it up. Don't duplicate any
          * entries, so that summary statistics such as mean() and variance() should
          * return the same value on the returned, jumbled vvec. This just randomizes the
-         * order of the elements. Uses std::shuffle with a selected RNG.
+         * order of the elements. Uses std::shuffle with this thread's morph::default_rng
+         * engine.
          */
-        void shuffle()
-        {
-            std::random_device rd; // we have access to these via #include <morph/Random.h>
-            std::mt19937 generator(rd());
-            std::shuffle (this->begin(), this->end(), generator);
-        }
+        void shuffle() { std::shuffle (this->begin(), this->end(), morph::default_rng::engine()); }
+
+        //! Shuffle with the caller's engine g (any UniformRandomBitGenerator)
+        template <typename G> requires std::uniform_random_bit_generator<std::remove_reference_t<G>>
+        void shuffle (G&& g) { std::shuffle (this->begin(), this->end(), g); }
 
         /*!
          * As shuffle() but return the shuffled vvec
          */
         morph::vvec<S> shuffled()
         {
-            morph::vvec<S> rtn (*this);
-            std::random_device rd; // we have access to these via #include <morph/Random.h>
-            std::mt19937 generator(rd());
-            std::shuffle (rtn.begin(), rtn.end(), generator);
+            morph::vvec<S> rtn (this->begin(), this->end());
+            rtn.shuffle();
+            return rtn;
+        }
+
+        //! As shuffle(G&&) but return the shuffled vvec
+        template <typename G> requires std::uniform_random_bit_generator<std::remove_reference_t<G>>
+        morph::vvec<S> shuffled (G&& g)
+        {
+            morph::vvec<S> rtn (this->begin(), this->end());
+            rtn.shuffle (g);
             return rtn;
         }
 
@@ -520,7 +623,7 @@ namespace morph {
 
             auto subtract_squared = [](S a, S b) { return a - b * b; };
             const S metric = std::accumulate (this->begin(), this->end(), S{1}, subtract_squared);
-            if (std::abs(metric) > unitThresh) {
+            if (vvec_math::abs(metric) > unitThresh) {
                 return false;
             }
             return true;
@@ -537,9 +640,9 @@ namespace morph {
             auto add_squared = [](_S a, S b) { return a + b * b; };
             // Add check on whether return type _S is integral or float. If integral, then std::round then cast the result of std::sqrt()
             if constexpr (std::is_integral<std::decay_t<_S>>::value == true) {
-                return static_cast<_S>(std::round(std::sqrt(std::accumulate(this->begin(), this->end(), _S{0}, add_squared))));
+                return static_cast<_S>(std::round(vvec_math::sqrt(std::accumulate(this->begin(), this->end(), _S{0}, add_squared))));
             } else {
-                return std::sqrt(std::accumulate(this->begin(), this->end(), _S{0}, add_squared));
+                return vvec_math::sqrt(std::accumulate(this->begin(), this->end(), _S{0}, add_squared));
             }
         }
 
@@ -590,8 +693,8 @@ namespace morph {
         _S length_sq() const
         {
             _S _sos = _S{0};
-            if constexpr (std::is_scalar<std::decay_t<S>>::value) {
-                if constexpr (std::is_scalar<std::decay_t<_S>>::value) {
+            if constexpr (morph::is_scalar_like<std::decay_t<S>>::value) {
+                if constexpr (morph::is_scalar_like<std::decay_t<_S>>::value) {
                     // Return type is also scalar
                     _sos = this->sos<_S>();
                 } else {
@@ -605,7 +708,7 @@ namespace morph {
                 }
             } else {
                 // S is a vector so i is a vector.
-                if constexpr (std::is_scalar<std::decay_t<_S>>::value) {
+                if constexpr (morph::is_scalar_like<std::decay_t<_S>>::value) {
                     // Return type _S is a scalar
                     for (auto& i : *this) { _sos += i.template sos<_S>(); }
                 } else {
@@ -632,15 +735,19 @@ namespace morph {
         template <typename _S=S>
         _S sos() const
         {
-            auto add_squared = [](_S a, S b) { return a + b * b; };
-            return std::accumulate (this->begin(), this->end(), _S{0}, add_squared);
+            if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                return vvec<S, Al>::pairwise_dot (this->data(), this->data(), this->size());
+            } else {
+                auto add_squared = [](_S a, S b) { return a + b * b; };
+                return std::accumulate (this->begin(), this->end(), _S{0}, add_squared);
+            }
         }
 
         //! \return the value of the longest component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         S longest() const
         {
-            auto abs_compare = [](S a, S b) { return (std::abs(a) < std::abs(b)); };
+            auto abs_compare = [](S a, S b) { return (vvec_math::abs(a) < vvec_math::abs(b)); };
             auto thelongest = std::max_element (this->begin(), this->end(), abs_compare);
             S rtn = *thelongest;
             return rtn;
@@ -651,12 +758,12 @@ namespace morph {
         S longest() const { return this->max(); }
 
         //! \return the index of the longest component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         std::size_t arglongest() const
         {
             std::size_t idx = 0;
-            if constexpr (std::is_scalar<std::decay_t<S>>::value) {
-                auto abs_compare = [](S a, S b) { return (std::abs(a) < std::abs(b)); };
+            if constexpr (morph::is_scalar_like<std::decay_t<S>>::value) {
+                auto abs_compare = [](S a, S b) { return (vvec_math::abs(a) < vvec_math::abs(b)); };
                 auto thelongest = std::max_element (this->begin(), this->end(), abs_compare);
                 idx = (thelongest - this->begin());
             } else {
@@ -672,10 +779,10 @@ namespace morph {
         std::size_t arglongest() const { return this->argmax(); }
 
         //! \return the value of the shortest component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         S shortest() const
         {
-            auto abs_compare = [](S a, S b) { return (std::abs(a) > std::abs(b)); };
+            auto abs_compare = [](S a, S b) { return (vvec_math::abs(a) > vvec_math::abs(b)); };
             auto theshortest = std::max_element (this->begin(), this->end(), abs_compare);
             S rtn = *theshortest;
             return rtn;
@@ -695,7 +802,7 @@ namespace morph {
          * \return The shortest non-zero element, or if there are NO non-zero elements in this vvec,
          * return S{0}
          */
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         S shortest_nonzero() const
         {
             // We need to find the first non-zero element in *this, else max_element will wrongly
@@ -707,7 +814,7 @@ namespace morph {
             // Return value of 0 means there were no non-zero elements in the vvec
             if (nonzero_start == this->end()) { return S{0}; }
 
-            auto abs_compare_nonz = [](S a, S b) { return (std::abs(a) > std::abs(b) && b != S{0}); };
+            auto abs_compare_nonz = [](S a, S b) { return (vvec_math::abs(a) > vvec_math::abs(b) && b != S{0}); };
             auto theshortest = std::max_element (nonzero_start, this->end(), abs_compare_nonz);
             S rtn = *theshortest;
             return rtn;
@@ -740,13 +847,13 @@ namespace morph {
          * \return the index of the shortest component of the vector. If this is a vector
          * of vectors, then return the index of the shortest vector.
          */
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         std::size_t argshortest() const
         {
             std::size_t idx = 0;
             // Check on the type S. If S is a vector thing, then abs_compare needs to be different.
-            if constexpr (std::is_scalar<std::decay_t<S>>::value) {
-                auto abs_compare = [](S a, S b) { return (std::abs(a) > std::abs(b)); };
+            if constexpr (morph::is_scalar_like<std::decay_t<S>>::value) {
+                auto abs_compare = [](S a, S b) { return (vvec_math::abs(a) > vvec_math::abs(b)); };
                 auto theshortest = std::max_element (this->begin(), this->end(), abs_compare);
                 idx = (theshortest - this->begin());
             } else {
@@ -767,11 +874,23 @@ namespace morph {
         }
 
         //! \return the value of the maximum (most positive) component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         S max() const
         {
-            auto themax = std::max_element (this->begin(), this->end());
-            return themax == this->end() ? S{0} : *themax;
+            if constexpr (vvec<S, Al>::template simd_ok<S>) {
+                // A max reduction that the compiler can vectorise. If there are NaNs in *this, the
+                // result is as undefined as it is for std::max_element; test with has_nan().
+                if (this->empty()) { return S{0}; }
+                const S* p = this->data();
+                const std::size_t n = this->size();
+                S m = p[0];
+#pragma omp simd reduction(max:m)
+                for (std::size_t i = 1; i < n; ++i) { m = p[i] > m ? p[i] : m; }
+                return m;
+            } else {
+                auto themax = std::max_element (this->begin(), this->end());
+                return themax == this->end() ? S{0} : *themax;
+            }
         }
 
         //! \return the max lengthed element of the vvec. Intended for use with a vvec of vecs
@@ -785,7 +904,7 @@ namespace morph {
         }
 
         //! \return the index of the maximum (most positive) component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         std::size_t argmax() const
         {
             auto themax = std::max_element (this->begin(), this->end());
@@ -803,7 +922,7 @@ namespace morph {
         }
 
         //! \return the value of the minimum (smallest or most negative) component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         S min() const
         {
             auto themin = std::min_element (this->begin(), this->end());
@@ -815,7 +934,7 @@ namespace morph {
         S min() const { return this->shortest(); }
 
         //! \return the index of the minimum (smallest or most negative) component of the vector.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         std::size_t argmin() const
         {
             auto themin = std::min_element (this->begin(), this->end());
@@ -827,6 +946,24 @@ namespace morph {
         template <typename _S=S, std::enable_if_t<morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         std::size_t argmin() const { return this->argshortest(); }
 
+        //! \return the indices that would sort the vector lo to hi (or hi to lo if descending is
+        //! true). Equal elements keep their original order. See also MathAlgo::argsort, top_k and
+        //! argsort_partial, which have parallel versions.
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
+        vvec<std::size_t> argsort (const bool descending = false) const
+        {
+            vvec<std::size_t> indices (this->size());
+            std::iota (indices.begin(), indices.end(), std::size_t{0});
+            if (descending) {
+                std::stable_sort (indices.begin(), indices.end(),
+                                  [this](std::size_t a, std::size_t b) { return (*this)[b] < (*this)[a]; });
+            } else {
+                std::stable_sort (indices.begin(), indices.end(),
+                                  [this](std::size_t a, std::size_t b) { return (*this)[a] < (*this)[b]; });
+            }
+            return indices;
+        }
+
         //! \return the min and max values of the vvec, ignoring any not-a-number elements. If you
         //! pass 'true' as the template arg, then you can test for nans, and return the min/max of
         //! the rest of the numbers
@@ -836,7 +973,7 @@ namespace morph {
         //! \return the range of values in the vvec (the min and max values). If you pass 'true' as
         //! the template arg, then you can test for nans, and return the min/max of the rest of the
         //! numbers
-        template<bool test_for_nans = false, typename _S = S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template<bool test_for_nans = false, typename _S = S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         morph::range<S> range() const
         {
             morph::range<S> r;
@@ -875,7 +1012,7 @@ namespace morph {
         }
 
         // The extent if S is scalar is just the same as range; a morph::range<S> is returned.
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value, int> = 0 >
         morph::range<S> extent() const { return this->range(); }
 
         /*!
@@ -1069,7 +1206,7 @@ namespace morph {
         template<typename _S=S>
         _S mean() const
         {
-            const _S sum = std::accumulate (this->begin(), this->end(), _S{0});
+            const _S sum = this->template sum<_S>();
             return sum / this->size();
         }
 
@@ -1092,7 +1229,7 @@ namespace morph {
         _S std() const
         {
             if (this->empty()) { return _S{0}; }
-            return std::sqrt (this->variance<_S>());
+            return vvec_math::sqrt (this->variance<_S>());
         }
 
         //! \return the sum of the elements. If elements are of a constrained type, you can call this something like:
@@ -1101,7 +1238,11 @@ namespace morph {
         template<typename _S=S>
         _S sum() const
         {
-            return std::accumulate (this->begin(), this->end(), _S{0});
+            if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                return vvec<S, Al>::pairwise_sum (this->data(), this->size());
+            } else {
+                return std::accumulate (this->begin(), this->end(), _S{0});
+            }
         }
 
         //! \return the product of the elements. If elements are of a constrained type, you can call
@@ -1124,12 +1265,12 @@ namespace morph {
         vvec<_S> pow (const S& p) const
         {
             vvec<_S> rtn(this->size());
-            auto raise_to_p = [p](S elmnt) { return std::pow(elmnt, p); };
+            auto raise_to_p = [p](S elmnt) { return vvec_math::pow(elmnt, p); };
             std::transform (this->begin(), this->end(), rtn.begin(), raise_to_p);
             return rtn;
         }
         //! Raise each element to the power p
-        void pow_inplace (const S& p) { for (auto& i : *this) { i = std::pow (i, p); } }
+        void pow_inplace (const S& p) { for (auto& i : *this) { i = vvec_math::pow (i, p); } }
 
         //! Element-wise power
         template<typename _S=S>
@@ -1140,7 +1281,7 @@ namespace morph {
             }
             auto pi = p.begin();
             vvec<S> rtn(this->size());
-            auto raise_to_p = [pi](S elmnt) mutable { return std::pow(elmnt, static_cast<S>(*pi++)); };
+            auto raise_to_p = [pi](S elmnt) mutable { return vvec_math::pow(elmnt, static_cast<S>(*pi++)); };
             std::transform (this->begin(), this->end(), rtn.begin(), raise_to_p);
             return rtn;
         }
@@ -1152,7 +1293,7 @@ namespace morph {
                 throw std::runtime_error ("element-wise power: p dims should equal vvec's dims");
             }
             auto pi = p.begin();
-            for (auto& i : *this) { i = std::pow (i, static_cast<S>(*pi++)); }
+            for (auto& i : *this) { i = vvec_math::pow (i, static_cast<S>(*pi++)); }
         }
 
         //! \return the signum of the vvec, with signum(0)==0
@@ -1267,12 +1408,12 @@ namespace morph {
         vvec<S> sqrt() const
         {
             vvec<S> rtn(this->size());
-            auto sqrt_element = [](S elmnt) { return static_cast<S>(std::sqrt(elmnt)); };
+            auto sqrt_element = [](S elmnt) { return static_cast<S>(vvec_math::sqrt(elmnt)); };
             std::transform (this->begin(), this->end(), rtn.begin(), sqrt_element);
             return rtn;
         }
         //! Replace each element with its own square root
-        void sqrt_inplace() { for (auto& i : *this) { i = static_cast<S>(std::sqrt (i)); } }
+        void sqrt_inplace() { for (auto& i : *this) { i = static_cast<S>(vvec_math::sqrt (i)); } }
 
         /*!
          * Compute the element-wise square of the vector
@@ -1282,7 +1423,7 @@ namespace morph {
         vvec<S> sq() const
         {
             vvec<S> rtn(this->size());
-            auto sq_element = [](S elmnt) { return std::pow(elmnt, 2); };
+            auto sq_element = [](S elmnt) { return vvec_math::pow(elmnt, 2); };
             std::transform (this->begin(), this->end(), rtn.begin(), sq_element);
             return rtn;
         }
@@ -1297,12 +1438,12 @@ namespace morph {
         vvec<S> log() const
         {
             vvec<S> rtn(this->size());
-            auto log_element = [](S elmnt) { return std::log(elmnt); };
+            auto log_element = [](S elmnt) { return vvec_math::log(elmnt); };
             std::transform (this->begin(), this->end(), rtn.begin(), log_element);
             return rtn;
         }
         //! Replace each element with its own log
-        void log_inplace() { for (auto& i : *this) { i = std::log(i); } }
+        void log_inplace() { for (auto& i : *this) { i = vvec_math::log(i); } }
 
         /*!
          * Compute the element-wise logarithm-to-base-10 of the vector
@@ -1312,34 +1453,34 @@ namespace morph {
         vvec<S> log10() const
         {
             vvec<S> rtn(this->size());
-            auto log_element = [](S elmnt) { return std::log10(elmnt); };
+            auto log_element = [](S elmnt) { return vvec_math::log10(elmnt); };
             std::transform (this->begin(), this->end(), rtn.begin(), log_element);
             return rtn;
         }
         //! Replace each element with its own log
-        void log10_inplace() { for (auto& i : *this) { i = std::log10(i); } }
+        void log10_inplace() { for (auto& i : *this) { i = vvec_math::log10(i); } }
 
         //! Sine
         vvec<S> sin() const
         {
             vvec<S> rtn(this->size());
-            auto sin_element = [](S elmnt) { return std::sin(elmnt); };
+            auto sin_element = [](S elmnt) { return vvec_math::sin(elmnt); };
             std::transform (this->begin(), this->end(), rtn.begin(), sin_element);
             return rtn;
         }
         //! Replace each element with its own sine
-        void sin_inplace() { for (auto& i : *this) { i = std::sin(i); } }
+        void sin_inplace() { for (auto& i : *this) { i = vvec_math::sin(i); } }
 
         //! Cosine
         vvec<S> cos() const
         {
             vvec<S> rtn(this->size());
-            auto cos_element = [](S elmnt) { return std::cos(elmnt); };
+            auto cos_element = [](S elmnt) { return vvec_math::cos(elmnt); };
             std::transform (this->begin(), this->end(), rtn.begin(), cos_element);
             return rtn;
         }
         //! Replace each element with its own cosine
-        void cos_inplace() { for (auto& i : *this) { i = std::cos(i); } }
+        void cos_inplace() { for (auto& i : *this) { i = vvec_math::cos(i); } }
 
         /*!
          * Compute the element-wise natural exponential of the vector
@@ -1349,12 +1490,12 @@ namespace morph {
         vvec<S> exp() const
         {
             vvec<S> rtn(this->size());
-            auto exp_element = [](S elmnt) { return std::exp(elmnt); };
+            auto exp_element = [](S elmnt) { return vvec_math::exp(elmnt); };
             std::transform (this->begin(), this->end(), rtn.begin(), exp_element);
             return rtn;
         }
         //! Replace each element with its own exp
-        void exp_inplace() { for (auto& i : *this) { i = std::exp(i); } }
+        void exp_inplace() { for (auto& i : *this) { i = vvec_math::exp(i); } }
 
         /*!
          * Compute the element-wise absolute values of the vector
@@ -1364,24 +1505,24 @@ namespace morph {
         vvec<S> abs() const
         {
             vvec<S> rtn(this->size());
-            auto abs_element = [](S elmnt) { return std::abs(elmnt); };
+            auto abs_element = [](S elmnt) { return vvec_math::abs(elmnt); };
             std::transform (this->begin(), this->end(), rtn.begin(), abs_element);
             return rtn;
         }
         //! Replace each element with its absolute value
-        void abs_inplace() { for (auto& i : *this) { i = std::abs(i); } }
+        void abs_inplace() { for (auto& i : *this) { i = vvec_math::abs(i); } }
 
         //! Compute the symmetric Gaussian function
         vvec<S> gauss (const S sigma) const
         {
             vvec<S> rtn(this->size());
-            auto _element = [sigma](S i) { return std::exp (i*i/(S{-2}*sigma*sigma)); };
+            auto _element = [sigma](S i) { return vvec_math::exp (i*i/(S{-2}*sigma*sigma)); };
             std::transform (this->begin(), this->end(), rtn.begin(), _element);
             return rtn;
         }
         void gauss_inplace (const S sigma)
         {
-            for (auto& i : *this) { i = std::exp (i*i/(S{-2}*sigma*sigma)); }
+            for (auto& i : *this) { i = vvec_math::exp (i*i/(S{-2}*sigma*sigma)); }
         }
 
         //! \return a vvec containing the generalised logistic function of this vvec:
@@ -1389,7 +1530,7 @@ namespace morph {
         vvec<S> logistic (const S k = S{1}, const S x0 = S{0}) const
         {
             vvec<S> rtn(this->size());
-            auto _logisticfn = [k, x0](S _x) { return S{1} / (S{1} + std::exp (k*(x0 - _x))); };
+            auto _logisticfn = [k, x0](S _x) { return S{1} / (S{1} + vvec_math::exp (k*(x0 - _x))); };
             std::transform (this->begin(), this->end(), rtn.begin(), _logisticfn);
             return rtn;
         }
@@ -1397,7 +1538,63 @@ namespace morph {
         //! f(x) = 1 / [ 1 + exp(-k*(x - x0)) ]
         void logistic_inplace (const S k = S{1}, const S x0 = S{0})
         {
-            for (auto& _x : *this) { _x = S{1} / (S{1} + std::exp (k*(x0 - _x))); }
+            for (auto& _x : *this) { _x = S{1} / (S{1} + vvec_math::exp (k*(x0 - _x))); }
+        }
+
+        /*
+         * Fast versions of the element functions, using the vectorisable approximations in
+         * morph::math::fast (see morph/math_fast.h). Each result is within ulp units in the last
+         * place of the libm one (within 2 ulp + 2 for gauss, logistic and tanh).
+         */
+
+        //! exp, within ulp
+        template <unsigned int ulp = 4>
+        vvec<S> exp_fast() const { vvec<S> rtn = *this; rtn.template exp_fast_inplace<ulp>(); return rtn; }
+        template <unsigned int ulp = 4>
+        void exp_fast_inplace() { morph::math::fast::exp<ulp> (this->data(), this->size()); }
+        //! log, within ulp
+        template <unsigned int ulp = 4>
+        vvec<S> log_fast() const { vvec<S> rtn = *this; rtn.template log_fast_inplace<ulp>(); return rtn; }
+        template <unsigned int ulp = 4>
+        void log_fast_inplace() { morph::math::fast::log<ulp> (this->data(), this->size()); }
+        //! sin, within ulp
+        template <unsigned int ulp = 4>
+        vvec<S> sin_fast() const { vvec<S> rtn = *this; rtn.template sin_fast_inplace<ulp>(); return rtn; }
+        template <unsigned int ulp = 4>
+        void sin_fast_inplace() { morph::math::fast::sin<ulp> (this->data(), this->size()); }
+        //! cos, within ulp
+        template <unsigned int ulp = 4>
+        vvec<S> cos_fast() const { vvec<S> rtn = *this; rtn.template cos_fast_inplace<ulp>(); return rtn; }
+        template <unsigned int ulp = 4>
+        void cos_fast_inplace() { morph::math::fast::cos<ulp> (this->data(), this->size()); }
+        //! tanh
+        template <unsigned int ulp = 4>
+        vvec<S> tanh_fast() const { vvec<S> rtn = *this; rtn.template tanh_fast_inplace<ulp>(); return rtn; }
+        template <unsigned int ulp = 4>
+        void tanh_fast_inplace() { morph::math::fast::tanh<ulp> (this->data(), this->size()); }
+        //! The symmetric Gaussian function, as gauss()
+        template <unsigned int ulp = 4>
+        vvec<S> gauss_fast (const S sigma) const { vvec<S> rtn = *this; rtn.template gauss_fast_inplace<ulp>(sigma); return rtn; }
+        template <unsigned int ulp = 4>
+        void gauss_fast_inplace (const S sigma)
+        {
+            const S m = S{-1} / (S{2} * sigma * sigma);
+            for (auto& x : *this) { x = x * x * m; }
+            morph::math::fast::exp<ulp> (this->data(), this->size());
+        }
+        //! The generalised logistic function, as logistic()
+        template <unsigned int ulp = 4>
+        vvec<S> logistic_fast (const S k = S{1}, const S x0 = S{0}) const
+        {
+            vvec<S> rtn = *this;
+            rtn.template logistic_fast_inplace<ulp>(k, x0);
+            return rtn;
+        }
+        template <unsigned int ulp = 4>
+        void logistic_fast_inplace (const S k = S{1}, const S x0 = S{0})
+        {
+            for (auto& x : *this) { x = k * (x - x0); }
+            morph::math::fast::sigmoid<ulp> (this->data(), this->size());
         }
 
         //! Smooth the vector by convolving with a gaussian filter with Gaussian width
@@ -1424,9 +1621,22 @@ namespace morph {
             this->convolve_inplace (filter, wrap);
         }
 
-        //! Do 1-D convolution of *this with the presented kernel and return the result
+        /*!
+         * Kernels with at least this many elements are convolved by FFT (overlap-add) rather than
+         * by the direct sum, when S is floating point. The result is the same to within rounding.
+         */
+        static constexpr std::size_t convolve_fft_threshold = 64;
+
+        //! Do 1-D convolution of *this with the presented kernel and return the result. For
+        //! floating point S and kernels of convolve_fft_threshold or more elements, this uses an
+        //! FFT, which is O(N log K) rather than O(N K).
         vvec<S> convolve (const vvec<S>& kernel, const wrapdata wrap = wrapdata::none) const
         {
+            if constexpr (std::is_floating_point<std::decay_t<S>>::value) {
+                if (kernel.size() >= convolve_fft_threshold && !this->empty()) {
+                    return this->convolve_fft (kernel, wrap);
+                }
+            }
             int _n = this->size();
             vvec<S> rtn(_n);
             int kw = kernel.size(); // kernel width
@@ -1451,6 +1661,13 @@ namespace morph {
         }
         void convolve_inplace (const vvec<S>& kernel, const wrapdata wrap = wrapdata::none)
         {
+            if constexpr (std::is_floating_point<std::decay_t<S>>::value) {
+                if (kernel.size() >= convolve_fft_threshold && !this->empty()) {
+                    vvec<S> c = this->convolve_fft (kernel, wrap);
+                    std::copy (c.begin(), c.end(), this->begin());
+                    return;
+                }
+            }
             int _n = this->size();
             vvec<S> d(_n); // We make a copy of *this
             std::copy (this->begin(), this->end(), d.begin());
@@ -1474,6 +1691,29 @@ namespace morph {
             }
         }
 
+        //! The FFT path for convolve(). The data are padded by the kernel width with zeros (or,
+        //! for wrapdata::wrap, with the data from the other end) so that the result matches the
+        //! direct sum, then correlated with the kernel by morph::fft::correlate.
+        vvec<S> convolve_fft (const vvec<S>& kernel, const wrapdata wrap = wrapdata::none) const
+        {
+            const int _n = this->size();
+            const int kw = kernel.size();
+            vvec<S> rtn (_n, S{0});
+            if (_n == 0 || kw == 0) { return rtn; }
+            const int zki = kw%2 ? kw/2 : kw/2-1; // zero of the kernel index
+            // e[k] is the datum that the direct sum would multiply with kernel[k - i] for output i
+            std::vector<S> e (_n + kw - 1, S{0});
+            for (int k = 0; k < _n + kw - 1; ++k) {
+                int ii = k - zki;
+                ii += ii < 0 && wrap==wrapdata::wrap ? _n : 0;
+                ii -= ii >= _n && wrap==wrapdata::wrap ? _n : 0;
+                if (ii < 0 || ii >= _n) { continue; }
+                e[k] = (*this)[ii];
+            }
+            morph::fft<S>::correlate (e.data(), e.size(), kernel.data(), kernel.size(), rtn.data());
+            return rtn;
+        }
+
         //! \return the discrete differential, computed as the mean difference between a
         //! datum and its adjacent neighbours.
         vvec<S> diff (const wrapdata wrap = wrapdata::none)
@@ -1773,16 +2013,20 @@ namespace morph {
          *
          * \return scalar product
          */
-        template<typename _S=S>
-        S dot (const vvec<_S>& v) const
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        S dot (const vvec<_S, _Al>& v) const
         {
             if (this->size() != v.size()) {
                 throw std::runtime_error ("vvec::dot(): vectors must have equal size");
             }
-            auto vi = v.begin();
-            auto dot_product = [vi](S a, _S b) mutable -> S { return a + static_cast<S>(b) * static_cast<S>(*vi++); };
-            const S rtn = std::accumulate (this->begin(), this->end(), S{0}, dot_product);
-            return rtn;
+            if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                return vvec<S, Al>::pairwise_dot (this->data(), v.data(), this->size());
+            } else {
+                auto vi = v.begin();
+                auto dot_product = [vi](S a, _S b) mutable -> S { return a + static_cast<S>(b) * static_cast<S>(*vi++); };
+                const S rtn = std::accumulate (this->begin(), this->end(), S{0}, dot_product);
+                return rtn;
+            }
         }
 
         /*!
@@ -1792,8 +2036,8 @@ namespace morph {
          * higher dimensions, its more complicated to define what the cross product is,
          * and I'm unlikely to need anything other than the plain old 3D cross product.
          */
-        template<typename _S=S>
-        vvec<S, Al> cross (const vvec<_S>& v) const
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        vvec<S, Al> cross (const vvec<_S, _Al>& v) const
         {
             vvec<S, Al> vrtn;
             if (this->size() == 3 && v.size() == 3) {
@@ -1813,10 +2057,18 @@ namespace morph {
          * This function will only be defined if typename _S is a
          * scalar type or a fixed size vector. Multiplies this vvec<S> by s, element-wise.
          */
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         vvec<S> operator* (const _S& s) const
         {
             vvec<S> rtn(this->size());
+            if constexpr (std::is_floating_point<std::decay_t<S>>::value && std::is_arithmetic<std::decay_t<_S>>::value) {
+                const S* p = this->data();
+                S* r = rtn.data();
+                const std::size_t n = this->size();
+#pragma omp simd
+                for (std::size_t i = 0; i < n; ++i) { r[i] = p[i] * s; }
+                return rtn;
+            }
             auto mult_by_s = [s](S elmnt) -> S { return elmnt * s; };
             std::transform (this->begin(), this->end(), rtn.begin(), mult_by_s);
             return rtn;
@@ -1830,13 +2082,22 @@ namespace morph {
          *
          * \return Hadamard product of left hand size (*this) and right hand size (\a v)
          */
-        template<typename _S=S>
-        vvec<S, Al> operator* (const vvec<_S>& v) const
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        vvec<S, Al> operator* (const vvec<_S, _Al>& v) const
         {
             if (v.size() != this->size()) {
                 throw std::runtime_error ("vvec::operator*: Hadamard product is defined here for vectors of same dimensionality only");
             }
             vvec<S, Al> rtn(this->size(), S{0});
+            if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                const S* p = this->data();
+                const S* q = v.data();
+                S* r = rtn.data();
+                const std::size_t n = this->size();
+#pragma omp simd
+                for (std::size_t i = 0; i < n; ++i) { r[i] = p[i] * q[i]; }
+                return rtn;
+            }
             auto vi = v.begin();
             // Visual Studio may complain about there being no static_cast<S> of (*vi++), here
             auto mult_by_s = [vi](S lhs) mutable -> S { return lhs * (*vi++); };
@@ -1850,9 +2111,16 @@ namespace morph {
          * This function will only be defined if typename _S is a
          * scalar type or a fixed size vec. Multiplies this vvec<S> by s, element-wise.
          */
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         void operator*= (const _S& s)
         {
+            if constexpr (std::is_floating_point<std::decay_t<S>>::value && std::is_arithmetic<std::decay_t<_S>>::value) {
+                S* p = this->data();
+                const std::size_t n = this->size();
+#pragma omp simd
+                for (std::size_t i = 0; i < n; ++i) { p[i] *= s; }
+                return;
+            }
             auto mult_by_s = [s](S elmnt) -> S { return elmnt * s; };
             std::transform (this->begin(), this->end(), this->begin(), mult_by_s);
         }
@@ -1863,10 +2131,18 @@ namespace morph {
          * Hadamard product. Multiply *this vector with \a v, elementwise. If \a v has a
          * different number of elements to *this, then an exception is thrown.
          */
-        template <typename _S=S>
-        void operator*= (const vvec<_S>& v)
+        template <typename _S=S, typename _Al=std::allocator<_S>>
+        void operator*= (const vvec<_S, _Al>& v)
         {
             if (v.size() == this->size()) {
+                if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                    S* p = this->data();
+                    const S* q = v.data();
+                    const std::size_t n = this->size();
+#pragma omp simd
+                    for (std::size_t i = 0; i < n; ++i) { p[i] *= q[i]; }
+                    return;
+                }
                 auto vi = v.begin();
                 auto mult_by_s = [vi](S lhs) mutable -> S { return lhs * (*vi++); };
                 std::transform (this->begin(), this->end(), this->begin(), mult_by_s);
@@ -1876,7 +2152,7 @@ namespace morph {
         }
 
         //! Scalar/fixed size vec divide by s
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         vvec<S> operator/ (const _S& s) const
         {
             vvec<S> rtn(this->size());
@@ -1893,8 +2169,8 @@ namespace morph {
          *
          * \return Hadamard division of left hand size (*this) by right hand size (\a v)
          */
-        template<typename _S=S>
-        vvec<S, Al> operator/ (const vvec<_S>& v) const
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        vvec<S, Al> operator/ (const vvec<_S, _Al>& v) const
         {
             if (v.size() != this->size()) {
                 throw std::runtime_error ("vvec::operator/: Hadamard division is defined here for vectors of same dimensionality only");
@@ -1907,7 +2183,7 @@ namespace morph {
         }
 
         //! Scalar divide/fixed size vec by s
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         void operator/= (const _S& s)
         {
             auto div_by_s = [s](S elmnt) -> S { return elmnt / s; };
@@ -1920,8 +2196,8 @@ namespace morph {
          * Hadamard division. Divide *this vector by \a v, elementwise. If \a v has a
          * different number of elements to *this, then an exception is thrown.
          */
-        template <typename _S=S>
-        void operator/= (const vvec<_S>& v)
+        template <typename _S=S, typename _Al=std::allocator<_S>>
+        void operator/= (const vvec<_S, _Al>& v)
         {
             if (v.size() == this->size()) {
                 auto vi = v.begin();
@@ -1933,7 +2209,7 @@ namespace morph {
         }
 
         //! Scalar addition with a thing that is of a different type to S (but must be scalar or fixed size vec/array)
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         vvec<S> operator+ (const _S& s) const
         {
             vvec<S> rtn(this->size());
@@ -1952,13 +2228,22 @@ namespace morph {
         }
 
         //! vvec addition operator
-        template<typename _S=S>
-        vvec<S> operator+ (const vvec<_S>& v) const
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        vvec<S, Al> operator+ (const vvec<_S, _Al>& v) const
         {
             if (v.size() != this->size()) {
                 throw std::runtime_error ("vvec::operator+: adding vvecs of different dimensionality is suppressed");
             }
-            vvec<S> vrtn(this->size());
+            vvec<S, Al> vrtn(this->size());
+            if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                const S* p = this->data();
+                const S* q = v.data();
+                S* r = vrtn.data();
+                const std::size_t n = this->size();
+#pragma omp simd
+                for (std::size_t i = 0; i < n; ++i) { r[i] = p[i] + q[i]; }
+                return vrtn;
+            }
             auto vi = v.begin();
             // Static cast is encouraged by Visual Studio, but it prevents addition of vvec of vecs and vvec of scalars
             auto add_v = [vi](S a) mutable -> S { return a + /* static_cast<S> */(*vi++); };
@@ -1967,7 +2252,7 @@ namespace morph {
         }
 
         //! Scalar addition
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         void operator+= (const _S& s)
         {
             auto add_s = [s](S elmnt) -> S { return elmnt + s; };
@@ -1975,10 +2260,18 @@ namespace morph {
         }
 
         //! vvec addition operator
-        template<typename _S=S>
-        void operator+= (const vvec<_S>& v)
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        void operator+= (const vvec<_S, _Al>& v)
         {
             if (v.size() == this->size()) {
+                if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                    S* p = this->data();
+                    const S* q = v.data();
+                    const std::size_t n = this->size();
+#pragma omp simd
+                    for (std::size_t i = 0; i < n; ++i) { p[i] += q[i]; }
+                    return;
+                }
                 auto vi = v.begin();
                 auto add_v = [vi](S a) mutable -> S { return a + /* static_cast<S> */(*vi++); };
                 std::transform (this->begin(), this->end(), this->begin(), add_v);
@@ -1995,7 +2288,7 @@ namespace morph {
         }
 
         //! Scalar subtraction with a thing that is of a different type to S (but must be scalar or fixed size vec/array)
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         vvec<S> operator- (const _S& s) const
         {
             vvec<S> rtn(this->size());
@@ -2014,13 +2307,22 @@ namespace morph {
         }
 
         //! A vvec subtraction operator
-        template<typename _S=S>
-        vvec<S> operator- (const vvec<_S>& v) const
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        vvec<S, Al> operator- (const vvec<_S, _Al>& v) const
         {
             if (v.size() != this->size()) {
                 throw std::runtime_error ("vvec::operator-: subtracting vvecs of different dimensionality is suppressed");
             }
-            vvec<S> vrtn(this->size());
+            vvec<S, Al> vrtn(this->size());
+            if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                const S* p = this->data();
+                const S* q = v.data();
+                S* r = vrtn.data();
+                const std::size_t n = this->size();
+#pragma omp simd
+                for (std::size_t i = 0; i < n; ++i) { r[i] = p[i] - q[i]; }
+                return vrtn;
+            }
             auto vi = v.begin();
             auto subtract_v = [vi](S a) mutable -> S { return a - (*vi++); };
             std::transform (this->begin(), this->end(), vrtn.begin(), subtract_v);
@@ -2028,7 +2330,7 @@ namespace morph {
         }
 
         //! Scalar subtraction
-        template <typename _S=S, std::enable_if_t<std::is_scalar<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
+        template <typename _S=S, std::enable_if_t<morph::is_scalar_like<std::decay_t<_S>>::value || morph::is_copyable_fixedsize<std::decay_t<_S>>::value, int> = 0 >
         void operator-= (const _S& s)
         {
             auto subtract_s = [s](S elmnt) -> S { return elmnt - s; };
@@ -2036,10 +2338,18 @@ namespace morph {
         }
 
         //! A vvec subtraction operator
-        template<typename _S=S>
-        void operator-= (const vvec<_S>& v)
+        template<typename _S=S, typename _Al=std::allocator<_S>>
+        void operator-= (const vvec<_S, _Al>& v)
         {
             if (v.size() == this->size()) {
+                if constexpr (vvec<S, Al>::template simd_ok<_S>) {
+                    S* p = this->data();
+                    const S* q = v.data();
+                    const std::size_t n = this->size();
+#pragma omp simd
+                    for (std::size_t i = 0; i < n; ++i) { p[i] -= q[i]; }
+                    return;
+                }
                 auto vi = v.begin();
                 auto subtract_v = [vi](S a) mutable -> S { return a - (*vi++); };
                 std::transform (this->begin(), this->end(), this->begin(), subtract_v);
@@ -2065,6 +2375,65 @@ namespace morph {
             std::copy (a.begin(), a.end(), iter);
         }
 
+        /*
+         * Kernels for the arithmetic and reductions of floating point vvecs. These are plain loops
+         * over the data, marked with omp simd so that the compiler vectorises them for the target
+         * instruction set (build with -march=native, or similar, to get AVX2, AVX-512 or
+         * NEON). The sums are pairwise: blocks of pairwise_block elements are summed in vector
+         * lanes and the block sums are added in a binary tree, so the rounding error grows as
+         * log(n) rather than n.
+         */
+
+        //! True if S is floating point and _S is the same type, so that the kernels may be used
+        template <typename _S>
+        static constexpr bool simd_ok = std::is_floating_point<std::decay_t<S>>::value
+                                        && std::is_same<std::decay_t<S>, std::decay_t<_S>>::value;
+
+        //! True if the target has a fused multiply-add instruction for S
+#if defined FP_FAST_FMA && defined FP_FAST_FMAF
+        static constexpr bool fast_fma = std::is_floating_point<std::decay_t<S>>::value;
+#elif defined FP_FAST_FMAF
+        static constexpr bool fast_fma = std::is_same<std::decay_t<S>, float>::value;
+#elif defined FP_FAST_FMA
+        static constexpr bool fast_fma = std::is_same<std::decay_t<S>, double>::value;
+#else
+        static constexpr bool fast_fma = false;
+#endif
+
+        //! The number of elements summed in one vectorised loop at the leaves of the pairwise sums
+        static constexpr std::size_t pairwise_block = 128;
+
+        //! Pairwise sum of the n elements at p
+        static S pairwise_sum (const S* p, const std::size_t n)
+        {
+            if (n <= pairwise_block) {
+                S s = S{0};
+#pragma omp simd reduction(+:s)
+                for (std::size_t i = 0; i < n; ++i) { s += p[i]; }
+                return s;
+            }
+            const std::size_t h = n / 2;
+            return vvec<S, Al>::pairwise_sum (p, h) + vvec<S, Al>::pairwise_sum (p + h, n - h);
+        }
+
+        //! Pairwise sum of the n products p[i] * q[i], with fused multiply-adds if the target has them
+        static S pairwise_dot (const S* p, const S* q, const std::size_t n)
+        {
+            if (n <= pairwise_block) {
+                S s = S{0};
+                if constexpr (vvec<S, Al>::fast_fma) {
+#pragma omp simd reduction(+:s)
+                    for (std::size_t i = 0; i < n; ++i) { s = std::fma (p[i], q[i], s); }
+                } else {
+#pragma omp simd reduction(+:s)
+                    for (std::size_t i = 0; i < n; ++i) { s += p[i] * q[i]; }
+                }
+                return s;
+            }
+            const std::size_t h = n / 2;
+            return vvec<S, Al>::pairwise_dot (p, q, h) + vvec<S, Al>::pairwise_dot (p + h, q + h, n - h);
+        }
+
         //! Overload the stream output operator
         friend std::ostream& operator<< <S> (std::ostream& os, const vvec<S>& v);
     };
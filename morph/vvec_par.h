@@ -0,0 +1,366 @@
+/*!
+ * \file
+ * \brief Parallel (OpenMP) versions of the bulk operations of morph::vvec.
+ *
+ * vvec's methods run on one thread. For a vvec of millions of elements, v.par() gives an object
+ * with the same methods which share the work among OpenMP's pool of threads:
+ *
+ *\code{.cpp}
+ * morph::vvec<float> a (100'000'000), b (100'000'000);
+ * float s = a.par().sum();
+ * b.par() = a.lazy() * 2.0f + b;  // a vexpr, evaluated in parallel
+ * a.par().exp_inplace();
+ * morph::vvec<float> c = a.par() * b;
+ *\endcode
+ *
+ * The results are the same as those of vvec's own methods, whatever the number of threads: the
+ * element-wise operations are independent and the sums follow the same pairwise tree as
+ * vvec::sum(), with its top levels computed in parallel. Vectors of fewer than min_n elements
+ * (the argument of par(), 2^16 by default) and vvecs of non-arithmetic elements are processed
+ * by the serial methods, so small vectors pay only for a size comparison. Built without
+ * OpenMP, everything runs serially.
+ *
+ * As with lazy(), don't keep the object that par() returns; use it in the expression that
+ * makes it.
+ */
+#pragma once
+
+#include <morph/range.h>
+#include <morph/vexpr.h>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+
+namespace morph {
+
+    // vvec is declared in vvec.h, which includes this file
+    template <typename S, typename Al> struct vvec;
+
+    //! The parallel face of vvec V (a vvec or a const vvec); made by vvec::par()
+    template <typename V>
+    struct vvec_par
+    {
+        using vv = std::remove_const_t<V>;
+        using S = typename vv::value_type;
+        //! The type returned by the operations that make a new vvec, as for vvec's own
+        using svv = vvec<S, std::allocator<S>>;
+        //! The number of levels of vvec::pairwise_sum's tree that are shared between threads
+        static constexpr unsigned int max_levels = 6;
+
+        vvec_par (V& _v, const std::size_t _min_n) : v(_v), min_n(_min_n) {}
+
+        //! True if the work will be shared between threads
+        bool parallel() const { return std::is_arithmetic_v<S> && this->v.size() >= this->min_n && this->v.size() > 1; }
+
+        /*
+         * Reductions
+         */
+
+        //! The sum of the elements; the same as vvec::sum()
+        template <typename _S=S>
+        _S sum() const
+        {
+            if constexpr (vv::template simd_ok<_S>) {
+                if (this->parallel()) { return vvec_par<V>::tree_sum (this->v.data(), nullptr, this->v.size()); }
+            }
+            return this->v.template sum<_S>();
+        }
+
+        //! The mean of the elements
+        template <typename _S=S>
+        _S mean() const { return this->template sum<_S>() / this->v.size(); }
+
+        //! The sum of the squares of the elements; the same as vvec::sos()
+        template <typename _S=S>
+        _S sos() const
+        {
+            if constexpr (vv::template simd_ok<_S>) {
+                if (this->parallel()) { return vvec_par<V>::tree_sum (this->v.data(), this->v.data(), this->v.size()); }
+            }
+            return this->v.template sos<_S>();
+        }
+
+        //! The scalar product with w; the same as vvec::dot()
+        template <typename _S=S, typename _Al=std::allocator<_S>>
+        S dot (const vvec<_S, _Al>& w) const
+        {
+            if constexpr (vv::template simd_ok<_S>) {
+                if (this->parallel() && w.size() == this->v.size()) {
+                    return vvec_par<V>::tree_sum (this->v.data(), w.data(), this->v.size());
+                }
+            }
+            return this->v.dot (w);
+        }
+
+        //! The largest element. As for vvec::max(), the result is undefined if there are NaNs.
+        S max() const
+        {
+            if constexpr (std::is_arithmetic_v<S>) {
+                if (this->parallel()) {
+                    const S* p = this->v.data();
+                    const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(this->v.size());
+                    S m = p[0];
+#pragma omp parallel for simd schedule(static) reduction(max:m)
+                    for (std::ptrdiff_t i = 1; i < n; ++i) { m = p[i] > m ? p[i] : m; }
+                    return m;
+                }
+            }
+            return this->v.max();
+        }
+
+        //! The smallest element
+        S min() const
+        {
+            if constexpr (std::is_arithmetic_v<S>) {
+                if (this->parallel()) {
+                    const S* p = this->v.data();
+                    const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(this->v.size());
+                    S m = p[0];
+#pragma omp parallel for simd schedule(static) reduction(min:m)
+                    for (std::ptrdiff_t i = 1; i < n; ++i) { m = p[i] < m ? p[i] : m; }
+                    return m;
+                }
+            }
+            return this->v.min();
+        }
+
+        //! The range (min and max) of the elements, found in one pass. NaNs are not tested for.
+        morph::range<S> range() const
+        {
+            if constexpr (std::is_arithmetic_v<S>) {
+                if (this->parallel()) {
+                    const S* p = this->v.data();
+                    const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(this->v.size());
+                    S lo = p[0];
+                    S hi = p[0];
+#pragma omp parallel for simd schedule(static) reduction(min:lo) reduction(max:hi)
+                    for (std::ptrdiff_t i = 1; i < n; ++i) {
+                        lo = p[i] < lo ? p[i] : lo;
+                        hi = p[i] > hi ? p[i] : hi;
+                    }
+                    return morph::range<S>(lo, hi);
+                }
+            }
+            return this->v.range();
+        }
+
+        /*
+         * Element-wise functions, returning a new vvec or changing the elements in place
+         */
+
+        //! A vvec of f applied to each element
+        template <typename F>
+        svv apply (F&& f) const
+        {
+            svv rtn (this->v.size());
+            const S* p = this->v.data();
+            S* r = rtn.data();
+            const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(this->v.size());
+            if (this->parallel()) {
+#pragma omp parallel for simd schedule(static)
+                for (std::ptrdiff_t i = 0; i < n; ++i) { r[i] = f (p[i]); }
+            } else {
+                for (std::ptrdiff_t i = 0; i < n; ++i) { r[i] = f (p[i]); }
+            }
+            return rtn;
+        }
+
+        //! Replace each element x with f(x)
+        template <typename F>
+        void apply_inplace (F&& f)
+        {
+            static_assert (!std::is_const_v<V>, "vvec_par: can't change a const vvec");
+            S* p = this->v.data();
+            const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(this->v.size());
+            if (this->parallel()) {
+#pragma omp parallel for simd schedule(static)
+                for (std::ptrdiff_t i = 0; i < n; ++i) { p[i] = f (p[i]); }
+            } else {
+                for (std::ptrdiff_t i = 0; i < n; ++i) { p[i] = f (p[i]); }
+            }
+        }
+
+        svv sqrt() const { return this->apply ([](S x) { return static_cast<S>(std::sqrt (x)); }); }
+        void sqrt_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(std::sqrt (x)); }); }
+        svv sq() const { return this->apply ([](S x) { return static_cast<S>(x * x); }); }
+        void sq_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(x * x); }); }
+        svv exp() const { return this->apply ([](S x) { return static_cast<S>(std::exp (x)); }); }
+        void exp_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(std::exp (x)); }); }
+        svv log() const { return this->apply ([](S x) { return static_cast<S>(std::log (x)); }); }
+        void log_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(std::log (x)); }); }
+        svv abs() const { return this->apply ([](S x) { return static_cast<S>(std::abs (x)); }); }
+        void abs_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(std::abs (x)); }); }
+        svv sin() const { return this->apply ([](S x) { return static_cast<S>(std::sin (x)); }); }
+        void sin_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(std::sin (x)); }); }
+        svv cos() const { return this->apply ([](S x) { return static_cast<S>(std::cos (x)); }); }
+        void cos_inplace() { this->apply_inplace ([](S x) { return static_cast<S>(std::cos (x)); }); }
+        svv pow (const S e) const { return this->apply ([e](S x) { return static_cast<S>(std::pow (x, e)); }); }
+        void pow_inplace (const S e) { this->apply_inplace ([e](S x) { return static_cast<S>(std::pow (x, e)); }); }
+
+        //! A vvec with the elements limited to the range [lower, upper]
+        svv threshold (const S lower, const S upper) const
+        {
+            return this->apply ([lower, upper](S x) { return (x <= lower ? lower : (x >= upper ? upper : x)); });
+        }
+        //! Limit the elements to the range [lower, upper]
+        void threshold_inplace (const S lower, const S upper)
+        {
+            this->apply_inplace ([lower, upper](S x) { return (x <= lower ? lower : (x >= upper ? upper : x)); });
+        }
+
+        //! Rescale the elements to lie in the range 0 to 1; the same as vvec::rescale()
+        void rescale()
+        {
+            if (!this->parallel()) { this->v.rescale(); return; }
+            const morph::range<S> r = this->range();
+            const S m = r.max - r.min;
+            const S g = r.min;
+            this->apply_inplace ([m, g](S x) { return (x - g) / m; });
+        }
+        //! Rescale the elements to lie in the range -1 to 0
+        void rescale_neg()
+        {
+            if (!this->parallel()) { this->v.rescale_neg(); return; }
+            const morph::range<S> r = this->range();
+            const S m = r.max - r.min;
+            const S g = r.max;
+            this->apply_inplace ([m, g](S x) { return (x - g) / m; });
+        }
+        //! Rescale the elements symmetrically about 0 to lie in the range -1 to 1
+        void rescale_sym()
+        {
+            if (!this->parallel()) { this->v.rescale_sym(); return; }
+            const morph::range<S> r = this->range();
+            const S m = (r.max - r.min) / S{2};
+            const S g = (r.max + r.min) / S{2};
+            this->apply_inplace ([m, g](S x) { return (x - g) / m; });
+        }
+
+        /*
+         * Arithmetic with a scalar or (element-wise) with a vvec of the same size
+         */
+
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        svv operator+ (const _S s) const { return this->apply ([s](S x) { return static_cast<S>(x + s); }); }
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        svv operator- (const _S s) const { return this->apply ([s](S x) { return static_cast<S>(x - s); }); }
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        svv operator* (const _S s) const { return this->apply ([s](S x) { return static_cast<S>(x * s); }); }
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        svv operator/ (const _S s) const { return this->apply ([s](S x) { return static_cast<S>(x / s); }); }
+
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        void operator+= (const _S s) { this->apply_inplace ([s](S x) { return static_cast<S>(x + s); }); }
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        void operator-= (const _S s) { this->apply_inplace ([s](S x) { return static_cast<S>(x - s); }); }
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        void operator*= (const _S s) { this->apply_inplace ([s](S x) { return static_cast<S>(x * s); }); }
+        template <typename _S, std::enable_if_t<std::is_arithmetic_v<_S>, int> = 0>
+        void operator/= (const _S s) { this->apply_inplace ([s](S x) { return static_cast<S>(x / s); }); }
+
+        template <typename _S, typename _Al>
+        vvec<S, typename vv::allocator_type> operator+ (const vvec<_S, _Al>& w) const { return this->eval (this->v.lazy() + w); }
+        template <typename _S, typename _Al>
+        vvec<S, typename vv::allocator_type> operator- (const vvec<_S, _Al>& w) const { return this->eval (this->v.lazy() - w); }
+        template <typename _S, typename _Al>
+        vvec<S, typename vv::allocator_type> operator* (const vvec<_S, _Al>& w) const { return this->eval (this->v.lazy() * w); }
+        template <typename _S, typename _Al>
+        vvec<S, typename vv::allocator_type> operator/ (const vvec<_S, _Al>& w) const { return this->eval (this->v.lazy() / w); }
+
+        template <typename _S, typename _Al>
+        void operator+= (const vvec<_S, _Al>& w) { *this = this->v.lazy() + w; }
+        template <typename _S, typename _Al>
+        void operator-= (const vvec<_S, _Al>& w) { *this = this->v.lazy() - w; }
+        template <typename _S, typename _Al>
+        void operator*= (const vvec<_S, _Al>& w) { *this = this->v.lazy() * w; }
+        template <typename _S, typename _Al>
+        void operator/= (const vvec<_S, _Al>& w) { *this = this->v.lazy() / w; }
+
+        /*!
+         * Evaluate the vexpr e into the vvec, in parallel. As for vvec::operator=, the vvec may
+         * appear in e, and is resized to fit e if necessary.
+         */
+        template <typename E, std::enable_if_t<morph::is_vexpr<E>::value, int> = 0>
+        vvec_par& operator= (const E& e)
+        {
+            static_assert (!std::is_const_v<V>, "vvec_par: can't assign to a const vvec");
+            if constexpr (E::is_scalar) {
+                this->v = e;
+            } else {
+                if (e.size() != this->v.size()) { this->v.resize (e.size()); }
+                vvec_par<V>::assign (this->v.data(), e, this->parallel());
+            }
+            return *this;
+        }
+
+        //! Evaluate the vexpr e into a new vvec, in parallel
+        template <typename E, std::enable_if_t<morph::is_vexpr<E>::value, int> = 0>
+        vvec<S, typename vv::allocator_type> eval (const E& e) const
+        {
+            vvec<S, typename vv::allocator_type> rtn (e.size());
+            vvec_par<V>::assign (rtn.data(), e, std::is_arithmetic_v<S> && e.size() >= this->min_n);
+            return rtn;
+        }
+
+    private:
+        //! Write e into out, in parallel if par
+        template <typename E>
+        static void assign (S* out, const E& e, const bool par)
+        {
+            const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(e.size());
+            if (par) {
+#pragma omp parallel for simd schedule(static)
+                for (std::ptrdiff_t i = 0; i < n; ++i) { out[i] = static_cast<S>(e[i]); }
+            } else {
+                morph::vexpr_impl::assign (out, e);
+            }
+        }
+
+        /*!
+         * vvec::pairwise_sum (or, if q is not null, pairwise_dot) of the n elements at p, with
+         * the nodes at the top levels levels of the tree summed in parallel. The split into
+         * halves is the same as in pairwise_sum, so the result is too.
+         */
+        static S tree_sum (const S* p, const S* q, const std::size_t n)
+        {
+            // Go down as many levels as the serial sum would (each node split has more than
+            // pairwise_block elements), to at most max_levels, giving 2^levels leaves
+            unsigned int levels = 0;
+            while (levels < max_levels && (n >> levels) > vv::pairwise_block) { ++levels; }
+            if (levels == 0) { return q == nullptr ? vv::pairwise_sum (p, n) : vv::pairwise_dot (p, q, n); }
+
+            std::vector<std::size_t> off = { 0, n };
+            for (unsigned int l = 0; l < levels; ++l) {
+                std::vector<std::size_t> next;
+                next.reserve (2 * off.size());
+                for (std::size_t i = 0; i + 1 < off.size(); ++i) {
+                    next.push_back (off[i]);
+                    next.push_back (off[i] + (off[i + 1] - off[i]) / 2);
+                }
+                next.push_back (n);
+                off.swap (next);
+            }
+            const std::ptrdiff_t nleaves = static_cast<std::ptrdiff_t>(off.size() - 1);
+            std::vector<S> s (nleaves);
+#pragma omp parallel for schedule(static)
+            for (std::ptrdiff_t i = 0; i < nleaves; ++i) {
+                const std::size_t a = off[i];
+                const std::size_t len = off[i + 1] - a;
+                s[i] = q == nullptr ? vv::pairwise_sum (p + a, len) : vv::pairwise_dot (p + a, q + a, len);
+            }
+            // Add up the leaves, left + right, level by level
+            for (std::size_t m = s.size(); m > 1; m /= 2) {
+                for (std::size_t i = 0; i < m / 2; ++i) { s[i] = s[2 * i] + s[2 * i + 1]; }
+            }
+            return s[0];
+        }
+
+        V& v;
+        std::size_t min_n;
+    };
+
+} // namespace morph
@@ -0,0 +1,390 @@
+/*!
+ * \file
+ * \brief A vvec-like vector with inline storage for a few elements, morph::vvec_small.
+ *
+ * Every morph::vvec is a heap allocation, because vvec is a std::vector. Where many small,
+ * short lived vectors are made in an inner loop (the activations of a ten neuron layer, the
+ * indices of a few nearest neighbours, the control points of a curve), the allocations can
+ * cost more than the arithmetic. vvec_small<S, Cap> holds up to Cap elements inside the object
+ * itself and only goes to the heap when it grows beyond that:
+ *
+ *\code{.cpp}
+ * morph::vvec_small<float, 16> a = { 1.0f, 2.0f, 3.0f }; // no allocation
+ * morph::vvec_small<float, 16> b = a * 2.0f + a;         // nor here
+ * float d = a.dot (b);
+ * b.resize (100);                                        // now on the heap
+ *\endcode
+ *
+ * It has the container interface of std::vector (without insert and erase) and the commonly
+ * used arithmetic and reductions of vvec, which give the same results. as_vvec() makes a vvec
+ * for anything else.
+ */
+#pragma once
+
+#include <morph/vvec.h>
+#include <morph/range.h>
+#include <array>
+#include <vector>
+#include <initializer_list>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace morph {
+
+    template <typename S, std::size_t Cap = 16>
+    struct vvec_small
+    {
+        static_assert (std::is_trivially_copyable_v<S>, "vvec_small: elements must be trivially copyable");
+        static_assert (Cap > 0, "vvec_small: Cap must be at least 1");
+
+        using value_type = S;
+        using size_type = std::size_t;
+        using iterator = S*;
+        using const_iterator = const S*;
+        using reference = S&;
+        using const_reference = const S&;
+
+        //! The number of elements held without a heap allocation
+        static constexpr std::size_t inline_capacity = Cap;
+
+        vvec_small() = default;
+        explicit vvec_small (const std::size_t _n) { this->resize (_n); }
+        vvec_small (const std::size_t _n, const S& val) { this->assign (_n, val); }
+        vvec_small (std::initializer_list<S> il) { this->assign (il.begin(), il.end()); }
+        template <typename It, std::enable_if_t<!std::is_integral_v<It>, int> = 0>
+        vvec_small (It first, It last) { this->assign (first, last); }
+        //! Copy the elements of a std::vector or vvec
+        template <typename Al>
+        explicit vvec_small (const std::vector<S, Al>& v) { this->assign (v.begin(), v.end()); }
+
+        vvec_small (const vvec_small& other) { this->assign (other.begin(), other.end()); }
+        vvec_small (vvec_small&& other) noexcept { this->take (other); }
+        ~vvec_small() { this->release(); }
+
+        vvec_small& operator= (const vvec_small& other)
+        {
+            if (this != &other) { this->assign (other.begin(), other.end()); }
+            return *this;
+        }
+        vvec_small& operator= (vvec_small&& other) noexcept
+        {
+            if (this != &other) {
+                this->release();
+                this->take (other);
+            }
+            return *this;
+        }
+        vvec_small& operator= (std::initializer_list<S> il)
+        {
+            this->assign (il.begin(), il.end());
+            return *this;
+        }
+
+        /*
+         * The container interface
+         */
+
+        std::size_t size() const { return this->n; }
+        bool empty() const { return this->n == 0; }
+        std::size_t capacity() const { return this->cap; }
+        //! True if the elements have outgrown the inline storage
+        bool on_heap() const { return this->p != this->inline_buf.data(); }
+
+        S* data() { return this->p; }
+        const S* data() const { return this->p; }
+        S* begin() { return this->p; }
+        S* end() { return this->p + this->n; }
+        const S* begin() const { return this->p; }
+        const S* end() const { return this->p + this->n; }
+        const S* cbegin() const { return this->p; }
+        const S* cend() const { return this->p + this->n; }
+
+        S& operator[] (const std::size_t i) { return this->p[i]; }
+        const S& operator[] (const std::size_t i) const { return this->p[i]; }
+        S& at (const std::size_t i)
+        {
+            if (i >= this->n) { throw std::out_of_range ("vvec_small::at: index out of range"); }
+            return this->p[i];
+        }
+        const S& at (const std::size_t i) const
+        {
+            if (i >= this->n) { throw std::out_of_range ("vvec_small::at: index out of range"); }
+            return this->p[i];
+        }
+        S& front() { return this->p[0]; }
+        const S& front() const { return this->p[0]; }
+        S& back() { return this->p[this->n - 1]; }
+        const S& back() const { return this->p[this->n - 1]; }
+
+        //! Make room for at least c elements
+        void reserve (const std::size_t c)
+        {
+            if (c <= this->cap) { return; }
+            S* q = new S[c];
+            std::copy (this->p, this->p + this->n, q);
+            const std::size_t _n = this->n;
+            this->release();
+            this->p = q;
+            this->n = _n;
+            this->cap = c;
+        }
+
+        //! Resize, value-initialising any new elements
+        void resize (const std::size_t _n) { this->resize (_n, S{}); }
+        void resize (const std::size_t _n, const S& val)
+        {
+            if (_n > this->cap) { this->reserve (std::max (_n, 2 * this->cap)); }
+            if (_n > this->n) { std::fill (this->p + this->n, this->p + _n, val); }
+            this->n = _n;
+        }
+
+        void assign (const std::size_t _n, const S& val)
+        {
+            this->n = 0;
+            this->resize (_n, val);
+        }
+        template <typename It>
+        void assign (It first, It last)
+        {
+            const std::size_t _n = static_cast<std::size_t>(std::distance (first, last));
+            this->n = 0;
+            this->reserve (_n);
+            std::copy (first, last, this->p);
+            this->n = _n;
+        }
+
+        void push_back (const S& val)
+        {
+            if (this->n == this->cap) { this->reserve (2 * this->cap); }
+            this->p[this->n++] = val;
+        }
+        template <typename... Args>
+        S& emplace_back (Args&&... args)
+        {
+            if (this->n == this->cap) { this->reserve (2 * this->cap); }
+            this->p[this->n] = S(std::forward<Args>(args)...);
+            return this->p[this->n++];
+        }
+        void pop_back() { if (this->n > 0) { --this->n; } }
+        //! Remove the elements. The capacity (and any heap storage) is kept for reuse.
+        void clear() { this->n = 0; }
+
+        void swap (vvec_small& other)
+        {
+            vvec_small t (std::move (other));
+            other = std::move (*this);
+            *this = std::move (t);
+        }
+
+        //! The elements as a vvec
+        morph::vvec<S> as_vvec() const
+        {
+            morph::vvec<S> v (this->n);
+            std::copy (this->begin(), this->end(), v.begin());
+            return v;
+        }
+
+        //! Set from a container of the same size, as vvec::set_from
+        template <typename C>
+        void set_from (const C& c)
+        {
+            if (c.size() != this->n) { throw std::runtime_error ("vvec_small::set_from: sizes differ"); }
+            std::copy (c.begin(), c.end(), this->p);
+        }
+
+        void zero() { std::fill (this->begin(), this->end(), S{0}); }
+
+        bool operator== (const vvec_small& rhs) const { return this->n == rhs.n && std::equal (this->begin(), this->end(), rhs.begin()); }
+        bool operator!= (const vvec_small& rhs) const { return !(*this == rhs); }
+
+        std::string str() const
+        {
+            std::stringstream ss;
+            ss << "(";
+            for (std::size_t i = 0; i < this->n; ++i) { ss << (i > 0 ? "," : "") << this->p[i]; }
+            ss << ")";
+            return ss.str();
+        }
+
+        /*
+         * Reductions, giving the same results as vvec's
+         */
+
+        template <typename _S=S>
+        _S sum() const
+        {
+            if constexpr (morph::vvec<S>::template simd_ok<_S>) {
+                return morph::vvec<S>::pairwise_sum (this->p, this->n);
+            } else {
+                _S s = _S{0};
+                for (std::size_t i = 0; i < this->n; ++i) { s += this->p[i]; }
+                return s;
+            }
+        }
+        template <typename _S=S>
+        _S mean() const { return this->template sum<_S>() / this->n; }
+
+        template <typename _S=S>
+        _S sos() const
+        {
+            if constexpr (morph::vvec<S>::template simd_ok<_S>) {
+                return morph::vvec<S>::pairwise_dot (this->p, this->p, this->n);
+            } else {
+                _S s = _S{0};
+                for (std::size_t i = 0; i < this->n; ++i) { s += this->p[i] * this->p[i]; }
+                return s;
+            }
+        }
+        template <typename _S=S>
+        _S length_sq() const { return this->template sos<_S>(); }
+        template <typename _S=S>
+        _S length() const { return std::sqrt (this->template sos<_S>()); }
+
+        S dot (const vvec_small& w) const
+        {
+            this->check_size (w.n, "dot");
+            if constexpr (morph::vvec<S>::template simd_ok<S>) {
+                return morph::vvec<S>::pairwise_dot (this->p, w.p, this->n);
+            } else {
+                S s = S{0};
+                for (std::size_t i = 0; i < this->n; ++i) { s += this->p[i] * w.p[i]; }
+                return s;
+            }
+        }
+
+        S max() const { return this->n == 0 ? S{0} : *std::max_element (this->begin(), this->end()); }
+        S min() const { return this->n == 0 ? S{0} : *std::min_element (this->begin(), this->end()); }
+        std::size_t argmax() const { return static_cast<std::size_t>(std::max_element (this->begin(), this->end()) - this->begin()); }
+        std::size_t argmin() const { return static_cast<std::size_t>(std::min_element (this->begin(), this->end()) - this->begin()); }
+        morph::range<S> range() const
+        {
+            if (this->n == 0) { return morph::range<S>(S{0}, S{0}); }
+            auto mm = std::minmax_element (this->begin(), this->end());
+            return morph::range<S>(*mm.first, *mm.second);
+        }
+
+        //! Scale to length 1 (unless the length is 0)
+        void renormalize()
+        {
+            const S l = this->length();
+            if (l != S{0}) { *this *= S{1} / l; }
+        }
+        //! Rescale the elements to lie in the range 0 to 1
+        void rescale()
+        {
+            const morph::range<S> r = this->range();
+            const S m = r.max - r.min;
+            for (auto& x : *this) { x = (x - r.min) / m; }
+        }
+
+        /*
+         * Element-wise functions
+         */
+
+        vvec_small abs() const { vvec_small r = *this; for (auto& x : r) { x = std::abs (x); } return r; }
+        vvec_small sqrt() const { vvec_small r = *this; for (auto& x : r) { x = std::sqrt (x); } return r; }
+        vvec_small sq() const { vvec_small r = *this; for (auto& x : r) { x = x * x; } return r; }
+        vvec_small exp() const { vvec_small r = *this; for (auto& x : r) { x = std::exp (x); } return r; }
+        vvec_small log() const { vvec_small r = *this; for (auto& x : r) { x = std::log (x); } return r; }
+        void abs_inplace() { for (auto& x : *this) { x = std::abs (x); } }
+        void sqrt_inplace() { for (auto& x : *this) { x = std::sqrt (x); } }
+        void sq_inplace() { for (auto& x : *this) { x = x * x; } }
+        void exp_inplace() { for (auto& x : *this) { x = std::exp (x); } }
+        void log_inplace() { for (auto& x : *this) { x = std::log (x); } }
+        void threshold_inplace (const S lower, const S upper)
+        {
+            for (auto& x : *this) { x = (x <= lower ? lower : (x >= upper ? upper : x)); }
+        }
+
+        /*
+         * Arithmetic, with a scalar or element-wise with another vvec_small of the same size
+         */
+
+        vvec_small& operator+= (const S s) { for (auto& x : *this) { x += s; } return *this; }
+        vvec_small& operator-= (const S s) { for (auto& x : *this) { x -= s; } return *this; }
+        vvec_small& operator*= (const S s) { for (auto& x : *this) { x *= s; } return *this; }
+        vvec_small& operator/= (const S s) { for (auto& x : *this) { x /= s; } return *this; }
+
+        vvec_small& operator+= (const vvec_small& w) { return this->combine (w, "operator+=", [](S a, S b) { return a + b; }); }
+        vvec_small& operator-= (const vvec_small& w) { return this->combine (w, "operator-=", [](S a, S b) { return a - b; }); }
+        //! The Hadamard (element-wise) product
+        vvec_small& operator*= (const vvec_small& w) { return this->combine (w, "operator*=", [](S a, S b) { return a * b; }); }
+        vvec_small& operator/= (const vvec_small& w) { return this->combine (w, "operator/=", [](S a, S b) { return a / b; }); }
+
+        template <typename R>
+        vvec_small operator+ (const R& r) const { vvec_small a = *this; a += r; return a; }
+        template <typename R>
+        vvec_small operator- (const R& r) const { vvec_small a = *this; a -= r; return a; }
+        template <typename R>
+        vvec_small operator* (const R& r) const { vvec_small a = *this; a *= r; return a; }
+        template <typename R>
+        vvec_small operator/ (const R& r) const { vvec_small a = *this; a /= r; return a; }
+        vvec_small operator-() const { vvec_small a = *this; for (auto& x : a) { x = -x; } return a; }
+
+    private:
+        void check_size (const std::size_t m, const char* what) const
+        {
+            if (m != this->n) {
+                throw std::runtime_error (std::string("vvec_small::") + what + ": vectors must have the same size");
+            }
+        }
+
+        template <typename F>
+        vvec_small& combine (const vvec_small& w, const char* what, F f)
+        {
+            this->check_size (w.n, what);
+            for (std::size_t i = 0; i < this->n; ++i) { this->p[i] = f (this->p[i], w.p[i]); }
+            return *this;
+        }
+
+        //! Free any heap storage, returning to the inline storage (with no elements)
+        void release()
+        {
+            if (this->on_heap()) { delete[] this->p; }
+            this->p = this->inline_buf.data();
+            this->cap = Cap;
+            this->n = 0;
+        }
+
+        //! Take other's elements, leaving it empty. *this must have no heap storage.
+        void take (vvec_small& other)
+        {
+            if (other.on_heap()) {
+                this->p = other.p;
+                this->cap = other.cap;
+                this->n = other.n;
+                other.p = other.inline_buf.data();
+                other.cap = Cap;
+                other.n = 0;
+            } else {
+                std::copy (other.begin(), other.end(), this->inline_buf.begin());
+                this->n = other.n;
+                other.n = 0;
+            }
+        }
+
+        std::array<S, Cap> inline_buf;
+        S* p = inline_buf.data();
+        std::size_t n = 0;
+        std::size_t cap = Cap;
+    };
+
+    template <typename S, std::size_t Cap>
+    vvec_small<S, Cap> operator* (const S s, const vvec_small<S, Cap>& v) { return v * s; }
+    template <typename S, std::size_t Cap>
+    vvec_small<S, Cap> operator+ (const S s, const vvec_small<S, Cap>& v) { return v + s; }
+
+    template <typename S, std::size_t Cap>
+    std::ostream& operator<< (std::ostream& os, const vvec_small<S, Cap>& v)
+    {
+        os << v.str();
+        return os;
+    }
+
+} // namespace morph
@@ -0,0 +1,355 @@
+/*!
+ * \file
+ * \brief A structure-of-arrays container of N-vectors, morph::vvec_soa.
+ *
+ * A vvec<vec<T, N>> holds its vectors one after the other (x0 y0 z0 x1 y1 z1...), so an
+ * operation on each vector, such as finding its length, can't be vectorised well. vvec_soa
+ * holds the same vectors as N arrays, one per component (x0 x1... y0 y1... z0 z1...), so that
+ * such operations are plain loops over contiguous arrays of T, which the compiler vectorises.
+ *
+ *\code{.cpp}
+ * morph::vvec<morph::vec<float, 3>> field = ...;
+ * morph::vvec_soa<float, 3> f (field);
+ * morph::vvec<float> len = f.lengths();
+ * f.renormalize();
+ * f *= morph::vec<float, 3>{ 1.0f, 1.0f, 0.5f };
+ * field = f.to_vvec();
+ *\endcode
+ */
+#pragma once
+
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <vector>
+#include <span>
+#include <string>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+
+namespace morph {
+
+    /*!
+     * n vectors of N components of type T, stored component by component in one contiguous
+     * array: component k of all the vectors is at data() + k * size(). Each component is
+     * available as a std::span (to give to a VisualDataModel, say, through data_view), and
+     * the whole array can be uploaded to a GL buffer as it is, with attribute k at offset
+     * k * size() * sizeof(T).
+     */
+    template <typename T, std::size_t N>
+    struct vvec_soa
+    {
+        static_assert (N > 0, "vvec_soa: N must be at least 1");
+
+        vvec_soa() = default;
+
+        //! n vectors, each with all components set to init
+        explicit vvec_soa (const std::size_t _n, const T init = T{0}) : n(_n), store(N * _n, init) {}
+
+        //! The vectors of a vvec<vec<T, N>> (or std::vector of them)
+        vvec_soa (const std::vector<morph::vec<T, N>>& aos) { this->set_from (aos); }
+
+        //! The number of vectors
+        std::size_t size() const { return this->n; }
+        bool empty() const { return this->n == 0; }
+
+        //! Change the number of vectors, keeping the first min(n, _n) and setting new ones to init
+        void resize (const std::size_t _n, const T init = T{0})
+        {
+            if (_n == this->n) { return; }
+            morph::vvec<T> s (N * _n, init);
+            const std::size_t keep = std::min (_n, this->n);
+            for (std::size_t k = 0; k < N; ++k) {
+                std::copy (this->store.begin() + k * this->n, this->store.begin() + k * this->n + keep, s.begin() + k * _n);
+            }
+            this->store.swap (s);
+            this->n = _n;
+        }
+
+        //! Set from vectors stored one after the other
+        void set_from (const std::vector<morph::vec<T, N>>& aos)
+        {
+            this->n = aos.size();
+            this->store.resize (N * this->n);
+            for (std::size_t k = 0; k < N; ++k) {
+                T* c = this->store.data() + k * this->n;
+                for (std::size_t i = 0; i < this->n; ++i) { c[i] = aos[i][k]; }
+            }
+        }
+
+        //! Write the vectors into aos, one after the other, resizing it to fit
+        void to (std::vector<morph::vec<T, N>>& aos) const
+        {
+            aos.resize (this->n);
+            for (std::size_t k = 0; k < N; ++k) {
+                const T* c = this->store.data() + k * this->n;
+                for (std::size_t i = 0; i < this->n; ++i) { aos[i][k] = c[i]; }
+            }
+        }
+
+        //! The vectors as a vvec<vec<T, N>>
+        morph::vvec<morph::vec<T, N>> to_vvec() const
+        {
+            morph::vvec<morph::vec<T, N>> aos;
+            this->to (aos);
+            return aos;
+        }
+
+        //! A copy of vector i
+        morph::vec<T, N> operator[] (const std::size_t i) const
+        {
+            morph::vec<T, N> v;
+            for (std::size_t k = 0; k < N; ++k) { v[k] = this->store[k * this->n + i]; }
+            return v;
+        }
+
+        //! A copy of vector i, checking that i is in range
+        morph::vec<T, N> at (const std::size_t i) const
+        {
+            if (i >= this->n) { throw std::out_of_range ("vvec_soa::at: index out of range"); }
+            return (*this)[i];
+        }
+
+        //! Set vector i to v
+        void set (const std::size_t i, const morph::vec<T, N>& v)
+        {
+            for (std::size_t k = 0; k < N; ++k) { this->store[k * this->n + i] = v[k]; }
+        }
+
+        //! Component k of every vector
+        std::span<T> component (const std::size_t k) { return std::span<T>(this->store.data() + k * this->n, this->n); }
+        std::span<const T> component (const std::size_t k) const { return std::span<const T>(this->store.data() + k * this->n, this->n); }
+
+        //! All of the components, component 0 first
+        T* data() { return this->store.data(); }
+        const T* data() const { return this->store.data(); }
+
+        //! Set every component of every vector to 0
+        void zero() { std::fill (this->store.begin(), this->store.end(), T{0}); }
+
+        /*
+         * Per-vector kernels
+         */
+
+        //! The squared length of each vector
+        morph::vvec<T> lengths_sq() const
+        {
+            morph::vvec<T> l (this->n, T{0});
+            T* r = l.data();
+            const std::size_t _n = this->n;
+            for (std::size_t k = 0; k < N; ++k) {
+                const T* c = this->store.data() + k * _n;
+#pragma omp simd
+                for (std::size_t i = 0; i < _n; ++i) { r[i] += c[i] * c[i]; }
+            }
+            return l;
+        }
+
+        //! The length of each vector
+        morph::vvec<T> lengths() const
+        {
+            morph::vvec<T> l = this->lengths_sq();
+            T* r = l.data();
+            const std::size_t _n = this->n;
+#pragma omp simd
+            for (std::size_t i = 0; i < _n; ++i) { r[i] = std::sqrt (r[i]); }
+            return l;
+        }
+
+        //! The scalar product of each vector with the one at the same index in w
+        morph::vvec<T> dot (const vvec_soa<T, N>& w) const
+        {
+            this->check_size (w, "dot");
+            morph::vvec<T> d (this->n, T{0});
+            T* r = d.data();
+            const std::size_t _n = this->n;
+            for (std::size_t k = 0; k < N; ++k) {
+                const T* a = this->store.data() + k * _n;
+                const T* b = w.store.data() + k * _n;
+#pragma omp simd
+                for (std::size_t i = 0; i < _n; ++i) { r[i] += a[i] * b[i]; }
+            }
+            return d;
+        }
+
+        //! The scalar product of each vector with v
+        morph::vvec<T> dot (const morph::vec<T, N>& v) const
+        {
+            morph::vvec<T> d (this->n, T{0});
+            T* r = d.data();
+            const std::size_t _n = this->n;
+            for (std::size_t k = 0; k < N; ++k) {
+                const T* a = this->store.data() + k * _n;
+                const T vk = v[k];
+#pragma omp simd
+                for (std::size_t i = 0; i < _n; ++i) { r[i] += a[i] * vk; }
+            }
+            return d;
+        }
+
+        //! The cross product of each vector with the one at the same index in w (for N == 3)
+        template <std::size_t _N = N, std::enable_if_t<(_N == 3), int> = 0>
+        vvec_soa<T, N> cross (const vvec_soa<T, N>& w) const
+        {
+            this->check_size (w, "cross");
+            const std::size_t _n = this->n;
+            vvec_soa<T, N> c (_n);
+            const T* ax = this->store.data();
+            const T* ay = ax + _n;
+            const T* az = ay + _n;
+            const T* bx = w.store.data();
+            const T* by = bx + _n;
+            const T* bz = by + _n;
+            T* cx = c.store.data();
+            T* cy = cx + _n;
+            T* cz = cy + _n;
+#pragma omp simd
+            for (std::size_t i = 0; i < _n; ++i) {
+                cx[i] = ay[i] * bz[i] - az[i] * by[i];
+                cy[i] = az[i] * bx[i] - ax[i] * bz[i];
+                cz[i] = ax[i] * by[i] - ay[i] * bx[i];
+            }
+            return c;
+        }
+
+        //! Scale each vector to length 1. Vectors of length 0 are left as they are.
+        template <typename _T = T, std::enable_if_t<std::is_floating_point_v<_T>, int> = 0>
+        void renormalize()
+        {
+            morph::vvec<T> inv = this->lengths();
+            T* r = inv.data();
+            const std::size_t _n = this->n;
+#pragma omp simd
+            for (std::size_t i = 0; i < _n; ++i) { r[i] = r[i] == T{0} ? T{1} : T{1} / r[i]; }
+            for (std::size_t k = 0; k < N; ++k) {
+                T* c = this->store.data() + k * _n;
+#pragma omp simd
+                for (std::size_t i = 0; i < _n; ++i) { c[i] *= r[i]; }
+            }
+        }
+
+        //! The index of the longest vector (0 if there are none)
+        std::size_t arglongest() const
+        {
+            if (this->n == 0) { return 0; }
+            morph::vvec<T> l = this->lengths_sq();
+            return static_cast<std::size_t>(std::max_element (l.begin(), l.end()) - l.begin());
+        }
+        //! The longest vector, as vvec<vec<T, N>>::max() gives (a zero vector if there are none)
+        morph::vec<T, N> longest() const
+        {
+            return this->n == 0 ? morph::vec<T, N>{} : (*this)[this->arglongest()];
+        }
+        //! The index of the shortest vector (0 if there are none)
+        std::size_t argshortest() const
+        {
+            if (this->n == 0) { return 0; }
+            morph::vvec<T> l = this->lengths_sq();
+            return static_cast<std::size_t>(std::min_element (l.begin(), l.end()) - l.begin());
+        }
+        //! The shortest vector (a zero vector if there are none)
+        morph::vec<T, N> shortest() const
+        {
+            return this->n == 0 ? morph::vec<T, N>{} : (*this)[this->argshortest()];
+        }
+
+        //! The sum of the vectors
+        morph::vec<T, N> sum() const
+        {
+            morph::vec<T, N> s;
+            for (std::size_t k = 0; k < N; ++k) { s[k] = morph::vvec<T>::pairwise_sum (this->store.data() + k * this->n, this->n); }
+            return s;
+        }
+        //! The mean of the vectors
+        morph::vec<T, N> mean() const { return this->n == 0 ? morph::vec<T, N>{} : this->sum() / static_cast<T>(this->n); }
+
+        /*
+         * Arithmetic, element-wise with another vvec_soa of the same size, component-wise
+         * with a vec<T, N> (adding, or scaling by, the same vector for every element) or with
+         * a scalar
+         */
+
+        vvec_soa<T, N>& operator+= (const vvec_soa<T, N>& w) { return this->combine (w, "operator+=", [](T a, T b) { return a + b; }); }
+        vvec_soa<T, N>& operator-= (const vvec_soa<T, N>& w) { return this->combine (w, "operator-=", [](T a, T b) { return a - b; }); }
+        //! Multiply the components by those of the vector at the same index in w (the Hadamard product)
+        vvec_soa<T, N>& operator*= (const vvec_soa<T, N>& w) { return this->combine (w, "operator*=", [](T a, T b) { return a * b; }); }
+        vvec_soa<T, N>& operator/= (const vvec_soa<T, N>& w) { return this->combine (w, "operator/=", [](T a, T b) { return a / b; }); }
+
+        vvec_soa<T, N>& operator+= (const morph::vec<T, N>& v) { return this->each_component (v, [](T a, T b) { return a + b; }); }
+        vvec_soa<T, N>& operator-= (const morph::vec<T, N>& v) { return this->each_component (v, [](T a, T b) { return a - b; }); }
+        vvec_soa<T, N>& operator*= (const morph::vec<T, N>& v) { return this->each_component (v, [](T a, T b) { return a * b; }); }
+        vvec_soa<T, N>& operator/= (const morph::vec<T, N>& v) { return this->each_component (v, [](T a, T b) { return a / b; }); }
+
+        vvec_soa<T, N>& operator*= (const T s) { this->store *= s; return *this; }
+        vvec_soa<T, N>& operator/= (const T s) { this->store /= s; return *this; }
+
+        //! Scale each vector by the value at the same index in s
+        vvec_soa<T, N>& operator*= (const std::vector<T>& s)
+        {
+            if (s.size() != this->n) { throw std::runtime_error ("vvec_soa::operator*=: one scale per vector is needed"); }
+            const std::size_t _n = this->n;
+            for (std::size_t k = 0; k < N; ++k) {
+                T* c = this->store.data() + k * _n;
+#pragma omp simd
+                for (std::size_t i = 0; i < _n; ++i) { c[i] *= s[i]; }
+            }
+            return *this;
+        }
+
+        template <typename R>
+        vvec_soa<T, N> operator+ (const R& r) const { vvec_soa<T, N> a = *this; a += r; return a; }
+        template <typename R>
+        vvec_soa<T, N> operator- (const R& r) const { vvec_soa<T, N> a = *this; a -= r; return a; }
+        template <typename R>
+        vvec_soa<T, N> operator* (const R& r) const { vvec_soa<T, N> a = *this; a *= r; return a; }
+        template <typename R>
+        vvec_soa<T, N> operator/ (const R& r) const { vvec_soa<T, N> a = *this; a /= r; return a; }
+
+        vvec_soa<T, N> operator-() const { vvec_soa<T, N> a = *this; a.store *= T{-1}; return a; }
+
+        bool operator== (const vvec_soa<T, N>& w) const { return this->n == w.n && this->store == w.store; }
+        bool operator!= (const vvec_soa<T, N>& w) const { return !(*this == w); }
+
+    private:
+        void check_size (const vvec_soa<T, N>& w, const char* what) const
+        {
+            if (w.n != this->n) {
+                throw std::runtime_error (std::string("vvec_soa::") + what + ": vvec_soas must have the same size");
+            }
+        }
+
+        template <typename F>
+        vvec_soa<T, N>& combine (const vvec_soa<T, N>& w, const char* what, F f)
+        {
+            this->check_size (w, what);
+            T* a = this->store.data();
+            const T* b = w.store.data();
+            const std::size_t m = this->store.size();
+#pragma omp simd
+            for (std::size_t i = 0; i < m; ++i) { a[i] = f (a[i], b[i]); }
+            return *this;
+        }
+
+        template <typename F>
+        vvec_soa<T, N>& each_component (const morph::vec<T, N>& v, F f)
+        {
+            const std::size_t _n = this->n;
+            for (std::size_t k = 0; k < N; ++k) {
+                T* c = this->store.data() + k * _n;
+                const T vk = v[k];
+#pragma omp simd
+                for (std::size_t i = 0; i < _n; ++i) { c[i] = f (c[i], vk); }
+            }
+            return *this;
+        }
+
+        //! The number of vectors
+        std::size_t n = 0;
+        //! The components, component 0 of every vector first
+        morph::vvec<T> store;
+    };
+
+} // namespace morph
@@ -0,0 +1,34 @@
+// Static batch vertex shader, see VisualOwnable::static_batching and morph::VisualBatch
+#version 430
+uniform mat4 v_matrix; // scene view matrix
+uniform mat4 p_matrix; // projection matrix
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 normalin;
+layout(location = 2) in vec3 color;
+// Which model of the batch this vertex belongs to. One value per draw (an attribute divisor
+// of 1, with each draw's base instance set to its model's index).
+layout(location = 8) in uint draw_id;
+
+struct batch_model
+{
+    mat4 m_matrix; // model_scaling * viewmatrix of the model
+    vec4 params;   // alpha, then padding
+};
+layout(std430, binding = 0) readonly buffer batch_models { batch_model models[]; };
+
+out VERTEX
+{
+    vec4 normal;
+    vec4 color;
+    vec3 fragpos;
+} vertex;
+
+void main (void)
+{
+    mat4 m_matrix = models[draw_id].m_matrix;
+    gl_Position = (p_matrix * v_matrix * m_matrix * position);
+    vertex.color = vec4(color, models[draw_id].params.x);
+    vertex.fragpos = vec3(m_matrix * position);
+    vertex.normal = normalin;
+}
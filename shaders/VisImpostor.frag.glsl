@@ -0,0 +1,32 @@
+// Sphere impostor fragment shader, see VisualModel::sphere_impostors
+#version 410
+precision highp float;
+uniform mat4 p_matrix;
+uniform vec3 light_colour;
+uniform float ambient_intensity;
+uniform float diffuse_intensity;
+in vec3 imp_viewpos;
+flat in vec3 imp_centre;
+flat in float imp_radius;
+flat in vec4 imp_color;
+flat in vec3 imp_light;
+out vec4 finalcolor;
+void main()
+{
+    // The ray through this fragment, from the quad, which is in front of the sphere
+    vec3 rd = p_matrix[3][3] != 0.0 ? vec3(0.0, 0.0, -1.0) : normalize (imp_viewpos);
+    vec3 oc = imp_viewpos - imp_centre;
+    float b = dot (oc, rd);
+    float h = b * b - dot (oc, oc) + imp_radius * imp_radius;
+    if (h < 0.0) { discard; }
+    vec3 hit = imp_viewpos + (-b - sqrt (h)) * rd;
+    vec4 clip = p_matrix * vec4(hit, 1.0);
+    float ndc_z = clip.z / clip.w;
+    gl_FragDepth = 0.5 * (gl_DepthRange.diff * ndc_z + gl_DepthRange.near + gl_DepthRange.far);
+    vec3 norm = (hit - imp_centre) / imp_radius;
+    vec3 light_dirn = normalize (imp_light - hit);
+    float effective_diffuse = max (dot (norm, light_dirn), 0.0);
+    vec3 diffuse = diffuse_intensity * effective_diffuse * light_colour;
+    vec3 ambient = ambient_intensity * light_colour;
+    finalcolor = vec4((ambient + diffuse) * imp_color.rgb, imp_color.a);
+}
@@ -0,0 +1,34 @@
+// Sphere impostor vertex shader, see VisualModel::sphere_impostors
+#version 410
+precision highp float;
+uniform mat4 m_matrix;
+uniform mat4 v_matrix;
+uniform mat4 p_matrix;
+uniform float alpha;
+uniform vec3 diffuse_position;
+layout(location = 0) in vec4 position;
+layout(location = 4) in vec3 inst_posn;
+layout(location = 5) in vec3 inst_scale;
+layout(location = 7) in vec3 inst_color;
+out vec3 imp_viewpos;
+flat out vec3 imp_centre;
+flat out float imp_radius;
+flat out vec4 imp_color;
+flat out vec3 imp_light;
+void main()
+{
+    mat4 mv = v_matrix * m_matrix;
+    vec3 c = vec3(mv * vec4(inst_posn, 1.0));
+    float r = inst_scale.x * length (vec3(mv[0]));
+    // From the centre towards the eye (at the origin, or at infinity for an orthographic projection)
+    vec3 dirn = p_matrix[3][3] != 0.0 ? vec3(0.0, 0.0, 1.0) : normalize (-c);
+    vec3 u = normalize (cross (abs (dirn.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), dirn));
+    vec3 w = cross (dirn, u);
+    vec3 v = c + r * (dirn + position.x * u + position.y * w);
+    imp_viewpos = v;
+    imp_centre = c;
+    imp_radius = r;
+    imp_color = vec4(inst_color, alpha);
+    imp_light = vec3(v_matrix * vec4(diffuse_position, 1.0));
+    gl_Position = p_matrix * vec4(v, 1.0);
+}
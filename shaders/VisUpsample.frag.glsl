@@ -0,0 +1,9 @@
+// Scales a reduced resolution frame up to the window, see VisualOwnable::adaptive_resolution
+#version 410
+uniform sampler2D frame;
+in vec2 uv;
+out vec4 finalcolor;
+void main()
+{
+    finalcolor = texture (frame, uv);
+}
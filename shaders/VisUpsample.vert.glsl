@@ -0,0 +1,9 @@
+// Scales a reduced resolution frame up to the window, see VisualOwnable::adaptive_resolution
+#version 410
+out vec2 uv;
+void main()
+{
+    vec2 p = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    uv = 0.5 * p + 0.5;
+    gl_Position = vec4(p, 0.0, 1.0);
+}
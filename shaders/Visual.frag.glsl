@@ -16,6 +16,15 @@ uniform float ambient_intensity; // Ambient intensity
 uniform vec3 diffuse_position;   // Positioned light
 uniform float diffuse_intensity; // Diffuse light intensity
 
+// If data_texture is non-zero, vertices with a negative blue colour component are coloured from
+// data_tex instead: their red and green components are its texture coordinates. The datum is
+// scaled by data_scale (as m * x + c) and looked up in the colour map table lut_tex. See
+// GridVisMode::Texture.
+uniform int data_texture;
+uniform highp sampler2D data_tex;
+uniform sampler2D lut_tex;
+uniform vec2 data_scale;
+
 //uniform mat4 lv_matrix; // 'light' scene view matrix
 //uniform mat4 p_matrix; // projection matrix
 
@@ -23,6 +32,13 @@ out vec4 finalcolor;
 
 void main()
 {
+    vec4 colr = vertex.color;
+    if (data_texture != 0 && colr.z < 0.0) {
+        float s = clamp (data_scale.x * texture (data_tex, colr.xy).r + data_scale.y, 0.0, 1.0);
+        // Sample the centre of the nearest table entry
+        float n = float(textureSize (lut_tex, 0).x);
+        colr.rgb = texture (lut_tex, vec2((s * (n - 1.0) + 0.5) / n, 0.5)).rgb;
+    }
     vec3 norm = normalize(vec3(vertex.normal));
     //vec3 dpos_trans = vec3(p_matrix * lv_matrix * vec4(diffuse_position, 1));
     //vec3 light_dirn = normalize(dpos_trans - vertex.fragpos);
@@ -30,8 +46,8 @@ void main()
     float effective_diffuse = max(dot(norm, light_dirn), 0.0);
     vec3 diffuse = diffuse_intensity * effective_diffuse * light_colour;
     vec3 ambient = ambient_intensity * light_colour;
-    vec3 result = (ambient+diffuse) * vec3(vertex.color);
-    finalcolor = vec4(result, vertex.color.w);
+    vec3 result = (ambient+diffuse) * colr.rgb;
+    finalcolor = vec4(result, colr.w);
     // Compared with simple shader:
     // finalcolor = vertex.color;
 }
@@ -10,11 +10,28 @@ uniform mat4 v_matrix; // scene view matrix
 uniform mat4 p_matrix; // projection matrix
 // alpha - to make a model see-through
 uniform float alpha;
+// Non-zero if the model is drawn instanced (see VisualModel::instanced)
+uniform int instanced;
+// Non-zero if the model is drawn as a height map from its data texture (see
+// VisualModel::data_tex_displace): 1 for a rectangular grid of texels, 2 for hexes
+uniform int data_displace;
+uniform highp sampler2D data_tex;
+uniform sampler2D lut_tex;
+uniform vec2 data_scale;   // data to colour map position, as m * x + c
+uniform vec2 data_zscale;  // data to z, as m * x + c
+uniform vec2 data_spacing; // The distances between texels in x and y
 
 layout(location = 0) in vec4 position; // Attrib location 0
 layout(location = 1) in vec4 normalin; // Attrib location 1
 layout(location = 2) in vec3 color;    // Attrib location 2
 
+// Per-instance attributes. The model's vertices are scaled, rotated and then translated
+// by these, and the instance colour replaces the vertex colour.
+layout(location = 4) in vec3 inst_posn;
+layout(location = 5) in vec3 inst_scale;
+layout(location = 6) in vec4 inst_rotn;  // A rotation quaternion (w, x, y, z)
+layout(location = 7) in vec3 inst_color;
+
 out VERTEX
 {
     vec4 normal;
@@ -22,13 +39,59 @@ out VERTEX
     vec3 fragpos; // fragment position
 } vertex;
 
+// Rotate v by the unit quaternion q
+vec3 qrotate (vec4 q, vec3 v)
+{
+    return v + 2.0 * cross (q.yzw, cross (q.yzw, v) + q.x * v);
+}
+
+// The height at texel t of the data texture, or at the nearest texel on its edge
+float data_z (ivec2 t)
+{
+    t = clamp (t, ivec2(0), textureSize (data_tex, 0) - 1);
+    return data_zscale.x * texelFetch (data_tex, t, 0).r + data_zscale.y;
+}
+
 void main (void)
 {
-    gl_Position = (p_matrix * v_matrix * m_matrix * position);
-    vertex.color = vec4(color, alpha);
-    vertex.fragpos = vec3(m_matrix * position);
+    vec4 p = position;
+    vec4 n = normalin;
+    vec3 c = color;
+    if (instanced != 0) {
+        p = vec4(qrotate (inst_rotn, position.xyz * inst_scale) + inst_posn, 1.0);
+        // The inverse transpose of the scaling, for the normals
+        n = vec4(normalize (qrotate (inst_rotn, normalin.xyz / inst_scale)), 0.0);
+        c = inst_color;
+    } else if (data_displace != 0 && color.z < -1.5) {
+        // A height map vertex, whose colour holds the coordinates of its texel
+        ivec2 t = ivec2(color.xy);
+        float h = texelFetch (data_tex, t, 0).r;
+        p.z = data_zscale.x * h + data_zscale.y;
+        vec2 g; // The gradient of z, by finite differences
+        if (data_displace == 1) {
+            g.x = (data_z (t + ivec2(1, 0)) - data_z (t - ivec2(1, 0))) / (2.0 * data_spacing.x);
+            g.y = (data_z (t + ivec2(0, 1)) - data_z (t - ivec2(0, 1))) / (2.0 * data_spacing.y);
+        } else {
+            // Texels are hexes by axial coordinates. A least squares fit to the six neighbours.
+            float e = data_z (t + ivec2(1, 0));
+            float w = data_z (t + ivec2(-1, 0));
+            float ne = data_z (t + ivec2(0, 1));
+            float nw = data_z (t + ivec2(-1, 1));
+            float sw = data_z (t + ivec2(0, -1));
+            float se = data_z (t + ivec2(1, -1));
+            g.x = (2.0 * (e - w) + ne - nw - sw + se) / (6.0 * data_spacing.x);
+            g.y = (ne + nw - sw - se) / (4.0 * data_spacing.y);
+        }
+        n = vec4(normalize (vec3(-g, 1.0)), 0.0);
+        float s = clamp (data_scale.x * h + data_scale.y, 0.0, 1.0);
+        float nl = float(textureSize (lut_tex, 0).x);
+        c = texture (lut_tex, vec2((s * (nl - 1.0) + 0.5) / nl, 0.5)).rgb;
+    }
+    gl_Position = (p_matrix * v_matrix * m_matrix * p);
+    vertex.color = vec4(c, alpha);
+    vertex.fragpos = vec3(m_matrix * p);
     // Normals are all automatically computed, so there's no need for
     // this line and the cube program doesn't bother to pass in the
     // normals. Maybe required only for lighting?
-    vertex.normal = normalin;
+    vertex.normal = n;
 }
@@ -0,0 +1,86 @@
+/*
+ * Profile the vvec arithmetic and reductions against the equivalent std algorithms. Build with
+ * -march=native (or similar) to let the compiler use the widest vector instructions available.
+ */
+
+#include <morph/vvec.h>
+#include <numeric>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+
+template <typename F>
+long long int time_us (F f, const int reps)
+{
+    using sc = std::chrono::steady_clock;
+    sc::time_point t0 = sc::now();
+    for (int r = 0; r < reps; ++r) { f(); }
+    sc::time_point t1 = sc::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+}
+
+template <typename S>
+void profile (const char* tname)
+{
+    constexpr std::size_t N = 1000000;
+    constexpr int reps = 100;
+
+    morph::vvec<S> a (N);
+    morph::vvec<S> b (N);
+    a.randomize();
+    b.randomize();
+    morph::vvec<S> c (N);
+    volatile S sink = S{0};
+
+    std::cout << "\nvvec<" << tname << ">, " << N << " elements, " << reps << " repetitions\n------------------------------\n";
+
+    long long int t_std = time_us ([&]() { sink = std::accumulate (a.begin(), a.end(), S{0}); }, reps);
+    long long int t_vv = time_us ([&]() { sink = a.sum(); }, reps);
+    std::cout << "sum:        std::accumulate " << t_std << " us; vvec::sum " << t_vv << " us\n";
+
+    t_std = time_us ([&]() { sink = std::inner_product (a.begin(), a.end(), b.begin(), S{0}); }, reps);
+    t_vv = time_us ([&]() { sink = a.dot (b); }, reps);
+    std::cout << "dot:        std::inner_product " << t_std << " us; vvec::dot " << t_vv << " us\n";
+
+    t_std = time_us ([&]() { sink = std::inner_product (a.begin(), a.end(), a.begin(), S{0}); }, reps);
+    t_vv = time_us ([&]() { sink = a.sos(); }, reps);
+    std::cout << "sos:        std::inner_product " << t_std << " us; vvec::sos " << t_vv << " us\n";
+
+    t_std = time_us ([&]() { sink = *std::max_element (a.begin(), a.end()); }, reps);
+    t_vv = time_us ([&]() { sink = a.max(); }, reps);
+    std::cout << "max:        std::max_element " << t_std << " us; vvec::max " << t_vv << " us\n";
+
+    t_std = time_us ([&]() { std::transform (a.begin(), a.end(), b.begin(), c.begin(), std::plus<S>()); }, reps);
+    t_vv = time_us ([&]() { c = a + b; }, reps);
+    std::cout << "a + b:      std::transform " << t_std << " us; vvec::operator+ (allocates its result) " << t_vv << " us\n";
+
+    t_std = time_us ([&]() { std::transform (a.begin(), a.end(), b.begin(), c.begin(), std::multiplies<S>()); }, reps);
+    t_vv = time_us ([&]() { c = a * b; }, reps);
+    std::cout << "a * b:      std::transform " << t_std << " us; vvec::operator* (allocates its result) " << t_vv << " us\n";
+
+    t_vv = time_us ([&]() { c += a; }, reps);
+    std::cout << "c += a:     vvec::operator+= " << t_vv << " us\n";
+
+    morph::vvec<S> d (N);
+    morph::vvec<S> e (N);
+    d.randomize();
+    e.randomize();
+    t_std = time_us ([&]() { c = a * b + d * e - a; }, reps);
+    t_vv = time_us ([&]() { c = a.lazy() * b + d * e - a; }, reps);
+    std::cout << "a*b+d*e-a:  with temporaries " << t_std << " us; lazy (fused) " << t_vv << " us\n";
+
+    // Accuracy of the sum. All elements are 0.1, so the exact sum is N * 0.1.
+    morph::vvec<S> tenths (N, S{0.1});
+    const double exact = static_cast<double>(S{0.1}) * N;
+    std::cout << "sum of " << N << " x 0.1: std::accumulate error "
+              << std::abs (static_cast<double>(std::accumulate (tenths.begin(), tenths.end(), S{0})) - exact)
+              << "; vvec::sum error " << std::abs (static_cast<double>(tenths.sum()) - exact) << std::endl;
+    (void)sink;
+}
+
+int main()
+{
+    profile<float> ("float");
+    profile<double> ("double");
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Test morph::bn::Landscape: for every genome of some small networks, the next-state table
+// and basins found along the Gray code walk match GeneNet::next_state_table and AllBasins
+#include <iostream>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <morph/bn/Genome.h>
+#include <morph/bn/Basins.h>
+#include <morph/bn/Landscape.h>
+
+// Each basin as (attractor, number of states), sorted for comparison regardless of basin order
+using basin_summary = std::vector<std::pair<std::vector<morph::bn::state_t>, unsigned int>>;
+
+// The summary of a Landscape's basins, or nothing if they don't cover every state
+template <std::size_t N, std::size_t K>
+std::optional<basin_summary> summary (const morph::bn::Landscape<N,K>& ls)
+{
+    basin_summary m;
+    unsigned int total = 0;
+    for (const auto& b : ls.basins) {
+        if (b.size > 0) { m.emplace_back (b.limitCycle, b.size); total += b.size; }
+    }
+    if (total != ls.n_states) { return std::nullopt; }
+    std::sort (m.begin(), m.end());
+    return m;
+}
+
+template <std::size_t N, std::size_t K>
+std::optional<basin_summary> summary (const morph::bn::AllBasins<N,K>& ab)
+{
+    basin_summary m;
+    for (const auto& b : ab.basins) {
+        m.emplace_back (std::vector<morph::bn::state_t>(b.limitCycle.begin(), b.limitCycle.end()),
+                        static_cast<unsigned int>(b.nodes.size()));
+    }
+    std::sort (m.begin(), m.end());
+    return m;
+}
+
+template <std::size_t N, std::size_t K>
+int check (const unsigned int shard_bits)
+{
+    using ls_t = morph::bn::Landscape<N,K>;
+    std::vector<int> ok (ls_t::n_genomes, 0);
+    std::vector<int> visits (ls_t::n_genomes, 0);
+    ls_t::enumerate ([&](const ls_t& ls) {
+        ++visits[ls.code];
+        morph::bn::Genome<N,K> g = ls.genome;
+        if (ls.next != morph::bn::GeneNet<N,K>::next_state_table (g)) { return; }
+        morph::bn::AllBasins<N,K> ab (g);
+        const std::optional<basin_summary> sl = summary (ls);
+        if (!sl || *sl != *summary (ab) || ls.num_basins() != ab.basins.size()) { return; }
+        for (std::size_t s = 0; s < ls.n_states; ++s) {
+            const auto& b = ls.basins[ls.label[s] - 1];
+            for (const auto& abb : ab.basins) {
+                if (abb.nodes.count (static_cast<morph::bn::state_t>(s)) && std::vector<morph::bn::state_t>(abb.limitCycle.begin(), abb.limitCycle.end()) != b.limitCycle) {
+                    return;
+                }
+            }
+        }
+        ok[ls.code] = 1;
+    }, shard_bits);
+
+    int rtn = 0;
+    for (std::uint64_t c = 0; c < ls_t::n_genomes; ++c) {
+        if (visits[c] != 1) { std::cerr << "N=" << N << " K=" << K << ": genome " << c << " visited " << visits[c] << " times\n"; return -1; }
+        if (!ok[c]) { std::cerr << "N=" << N << " K=" << K << ": genome " << c << " differs from AllBasins\n"; return -1; }
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    rtn += check<2, 1> (0);
+    rtn += check<2, 2> (0);
+    rtn += check<2, 2> (3);
+    rtn += check<3, 1> (2);
+    rtn += check<3, 2> (4);
+
+    // A fitness over the whole landscape: the number of genomes of N=K=2 with one point attractor
+    using ls22 = morph::bn::Landscape<2, 2>;
+    std::vector<double> f = ls22::fitnesses ([](const ls22& ls) {
+        return (ls.num_basins() == 1 && ls.basins[ls.label[0] - 1].endpoint == morph::bn::endpoint::point) ? 1.0 : 0.0;
+    });
+    double n1 = 0.0;
+    for (std::uint64_t c = 0; c < ls22::n_genomes; ++c) {
+        morph::bn::Genome<2, 2> g;
+        g[0] = static_cast<morph::bn::Genome<2, 2>::genosect_t>(c & 0xf);
+        g[1] = static_cast<morph::bn::Genome<2, 2>::genosect_t>((c >> 4) & 0xf);
+        morph::bn::AllBasins<2, 2> ab (g);
+        const double expect = (ab.basins.size() == 1 && ab.basins[0].endpoint == morph::bn::endpoint::point) ? 1.0 : 0.0;
+        if (f[c] != expect) { std::cerr << "fitnesses differ at " << c << "\n"; --rtn; break; }
+        n1 += f[c];
+    }
+    if (rtn == 0) { std::cout << "Landscape tests passed. " << n1 << " of 256 N=K=2 genomes have a single fixed point\n"; }
+    return rtn;
+}
@@ -0,0 +1,91 @@
+// Test morph::bn::Population: concurrent fitness and basin evaluation against serial, and
+// evolution results that do not depend on the number of threads
+#include <iostream>
+#include <vector>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+#include <morph/bn/Genome.h>
+#include <morph/bn/GeneNetDual.h>
+#include <morph/bn/Basins.h>
+#include <morph/bn/Population.h>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::bn::GeneNetDual<5, 5> gn;
+    gn.target_ant = 0x15;
+    gn.target_pos = 0xa;
+    auto fitfn = [&gn](const morph::bn::Genome<5, 5>& g) { return gn.evaluate_fitness (g); };
+
+    // Parallel evaluation matches serial evaluation
+    morph::bn::Population<5, 5> pop (5000);
+    pop.randomize (1234);
+    pop.evaluate (fitfn);
+    for (std::size_t i = 0; i < pop.size(); ++i) {
+        if (pop.fitness[i] != gn.evaluate_fitness (pop.genomes[i])) {
+            std::cerr << "Parallel fitness " << i << " differs from serial\n";
+            --rtn;
+            break;
+        }
+    }
+
+    // Randomizing with the same seed gives the same genomes, with another, others
+    morph::bn::Population<5, 5> pop2 (pop.size());
+    pop2.randomize (1234);
+    if (pop2.genomes != pop.genomes) {
+        std::cerr << "Same seed gave different genomes\n";
+        --rtn;
+    }
+    pop2.randomize (1235);
+    if (pop2.genomes == pop.genomes) {
+        std::cerr << "Different seeds gave the same genomes\n";
+        --rtn;
+    }
+
+    // Basins
+    pop.resize (200);
+    pop.randomize (99);
+    std::vector<morph::bn::AllBasins<5, 5>> ab = pop.basins();
+    for (std::size_t i = 0; i < pop.size(); ++i) {
+        morph::bn::AllBasins<5, 5> ref (pop.genomes[i]);
+        if (ab[i].transitions != ref.transitions || ab[i].attractorSizes != ref.attractorSizes) {
+            std::cerr << "Parallel basins " << i << " differ from serial\n";
+            --rtn;
+            break;
+        }
+    }
+
+    // Evolution with one thread and with several gives identical walks
+#ifdef _OPENMP
+    omp_set_num_threads (1);
+#endif
+    std::vector<unsigned long long int> g1 = pop.evolve (16, 0.05f, fitfn, 1.0, 200000, 42);
+    std::vector<morph::bn::Genome<5, 5>> genomes1 = pop.genomes;
+    std::vector<double> fit1 = pop.fitness;
+#ifdef _OPENMP
+    omp_set_num_threads (4);
+#endif
+    std::vector<unsigned long long int> g4 = pop.evolve (16, 0.05f, fitfn, 1.0, 200000, 42);
+    if (g1 != g4 || genomes1 != pop.genomes || fit1 != pop.fitness) {
+        std::cerr << "Evolution results depend on the number of threads\n";
+        --rtn;
+    }
+    unsigned int nfit = 0;
+    for (std::size_t w = 0; w < pop.size(); ++w) {
+        if (pop.fitness[w] != gn.evaluate_fitness (pop.genomes[w])) {
+            std::cerr << "Stored fitness of walk " << w << " is wrong\n";
+            --rtn;
+        }
+        if (pop.fitness[w] == 1.0) { ++nfit; }
+    }
+    // With p=0.05 a walk reaches F=1 within a few thousand generations
+    if (nfit < pop.size() / 2) {
+        std::cerr << "Only " << nfit << " of " << pop.size() << " walks reached F=1\n";
+        --rtn;
+    }
+
+    std::cout << "testBnPopulation " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
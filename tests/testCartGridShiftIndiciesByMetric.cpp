@@ -1,6 +1,8 @@
 #include <morph/CartGrid.h>
 #include <morph/vvec.h>
 #include <iostream>
+#include <vector>
+#include <utility>
 
 int main()
 {
@@ -96,6 +98,29 @@ int main()
         std::cout << "Expected result " << expected_result << " not equal to actual " << actual_result  << std::endl;
     }
     }
+    {
+    // A precomputed shift operator gives the same indices, and shifts data to match
+    const std::vector<std::pair<float, float>> shifts = { {-4, 2}, {2, 4}, {-8, -2}, {0, 6}, {-4, -4}, {2, -4}, {4, 2} };
+    morph::vvec<float> shifted_vals;
+    for (auto [xs, ys] : shifts) {
+        morph::shift_operator<float> op = cg.shiftOperatorByMetric (xs, ys);
+        if (cg.shiftIndiciesByMetric (orig, op) != cg.shiftIndiciesByMetric (orig, xs, ys)) {
+            rtn -= 1;
+            std::cout << "Shift operator indices for shift (" << xs << "," << ys << ") differ" << std::endl;
+        }
+        op.apply (vals, shifted_vals);
+        morph::vvec<float> expected_vals (vals.size(), 0.0f);
+        for (int i = 0; i < static_cast<int>(vals.size()); ++i) {
+            morph::vvec<int> one = { i };
+            morph::vvec<int> to = cg.shiftIndiciesByMetric (one, xs, ys);
+            if (!to.empty()) { expected_vals[to[0]] = vals[i]; }
+        }
+        if (shifted_vals != expected_vals) {
+            rtn -= 1;
+            std::cout << "Shift operator data for shift (" << xs << "," << ys << ") is " << shifted_vals << ", not " << expected_vals << std::endl;
+        }
+    }
+    }
     std::cout << "At end rtn is " << rtn << std::endl;
     return rtn;
 }
@@ -0,0 +1,70 @@
+// Test that morph::ColourMapCt gives the same colours as morph::ColourMap
+#include <vector>
+#include <array>
+#include <limits>
+#include <iostream>
+#include "morph/ColourMapCt.h"
+#include "morph/vvec.h"
+
+// Conversion of table-based maps happens at compile time
+constexpr std::array<float, 3> plasma_mid = morph::ColourMapCt<morph::ColourMapType::Plasma>::convert (0.5f);
+static_assert (plasma_mid[0] == morph::cm_plasma[128][0]);
+
+template <morph::ColourMapType cmt, typename T>
+int compare (const std::vector<T>& data)
+{
+    morph::ColourMap<T> cm (cmt);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        std::array<float, 3> c = cm.convert (data[i]);
+        std::array<float, 3> cct = morph::ColourMapCt<cmt, T>::convert (data[i]);
+        if (c != cct) {
+            std::cout << morph::ColourMap<T>::colourMapTypeToStr (cmt) << ": mismatch for datum "
+                      << static_cast<double>(data[i]) << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main ()
+{
+    int rtn = 0;
+
+    morph::vvec<float> data;
+    data.linspace (-0.1f, 1.1f, 10001);
+    data.push_back (0.0f);
+    data.push_back (std::numeric_limits<float>::quiet_NaN());
+
+    rtn += compare<morph::ColourMapType::Jet> (data);
+    rtn += compare<morph::ColourMapType::Plasma> (data);
+    rtn += compare<morph::ColourMapType::Viridis> (data);
+    rtn += compare<morph::ColourMapType::Batlow> (data);
+    rtn += compare<morph::ColourMapType::CET_L02> (data);
+    rtn += compare<morph::ColourMapType::Fire> (data);
+    rtn += compare<morph::ColourMapType::CyclicSix> (data);
+    rtn += compare<morph::ColourMapType::Greyscale> (data);
+    rtn += compare<morph::ColourMapType::RainbowZeroWhite> (data);
+    rtn += compare<morph::ColourMapType::MonovalGreen> (data);
+
+    morph::vvec<double> ddata = data.as_double();
+    rtn += compare<morph::ColourMapType::Magma> (ddata);
+
+    std::vector<unsigned char> cdata (256);
+    for (unsigned int i = 0; i < 256; ++i) { cdata[i] = static_cast<unsigned char>(i); }
+    rtn += compare<morph::ColourMapType::Devon> (cdata);
+
+    // The batch form matches the single datum form
+    std::vector<float> rgb (3 * data.size());
+    morph::ColourMapCt<morph::ColourMapType::Lapaz>::convert (data, rgb.data());
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        std::array<float, 3> c = morph::ColourMapCt<morph::ColourMapType::Lapaz>::convert (data[i]);
+        if (c[0] != rgb[3*i] || c[1] != rgb[3*i+1] || c[2] != rgb[3*i+2]) {
+            std::cout << "Batch convert mismatch at " << i << std::endl;
+            --rtn;
+            break;
+        }
+    }
+
+    std::cout << (rtn == 0 ? "PASS\n" : "FAIL\n");
+    return rtn;
+}
@@ -0,0 +1,84 @@
+// Test ColourMap::convert_batch, with and without a lookup table
+#include <vector>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include "morph/ColourMap.h"
+#include "morph/vvec.h"
+
+int main ()
+{
+    int rtn = 0;
+
+    morph::vvec<float> data;
+    data.linspace (-0.1f, 1.1f, 1001);
+    data.push_back (std::numeric_limits<float>::quiet_NaN());
+    std::vector<float> rgb (3 * data.size(), -1.0f);
+
+    // Without a table, convert_batch is the same as convert
+    morph::ColourMap<float> cm (morph::ColourMapType::Plasma);
+    cm.convert_batch (data, rgb.data());
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        std::array<float, 3> c = cm.convert (data[i]);
+        if (c[0] != rgb[3*i] || c[1] != rgb[3*i+1] || c[2] != rgb[3*i+2]) {
+            std::cout << "No table: mismatch at " << i << std::endl;
+            --rtn;
+            break;
+        }
+    }
+
+    // Plasma is a table of 256 colours, so with a 256 entry lookup table the result is the same
+    cm.setLutSize (256);
+    cm.convert_batch (data, rgb.data());
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        std::array<float, 3> c = cm.convert (data[i]);
+        if (c[0] != rgb[3*i] || c[1] != rgb[3*i+1] || c[2] != rgb[3*i+2]) {
+            std::cout << "Plasma table: mismatch at " << i << " datum " << data[i] << std::endl;
+            --rtn;
+            break;
+        }
+    }
+
+    // The table is re-made when the map changes. A computed map is close to convert's result.
+    cm.setType (morph::ColourMapType::Monochrome);
+    cm.setHue (0.3f);
+    cm.setLutSize (4096);
+    cm.convert_batch (data, rgb.data());
+    float maxerr = 0.0f;
+    for (std::size_t i = 0; i + 1 < data.size(); ++i) {
+        std::array<float, 3> c = cm.convert (data[i]);
+        for (int j = 0; j < 3; ++j) { maxerr = std::max (maxerr, std::abs (c[j] - rgb[3*i+j])); }
+    }
+    std::cout << "Monochrome with 4096 entry table: max error " << maxerr << std::endl;
+    if (maxerr > 1e-3f) { --rtn; }
+
+    // Changing the hue alone also re-makes the table
+    cm.setHue (0.6f);
+    cm.convert_batch (data, rgb.data());
+    std::array<float, 3> c1 = cm.convert (1.0f);
+    std::size_t i1 = data.size() - 2; // datum 1.1, clamped to 1
+    if (std::abs (c1[0] - rgb[3*i1]) > 1e-3f || std::abs (c1[2] - rgb[3*i1+2]) > 1e-3f) {
+        std::cout << "Table was not re-made after setHue\n";
+        --rtn;
+    }
+
+    // NaN gives the nan colour
+    std::array<float, 3> nc = morph::ColourMap<float>::nanColour (cm.getType());
+    std::size_t in = data.size() - 1;
+    if (rgb[3*in] != nc[0] || rgb[3*in+1] != nc[1] || rgb[3*in+2] != nc[2]) {
+        std::cout << "NaN colour mismatch\n";
+        --rtn;
+    }
+
+    // Two dimensional maps are refused
+    morph::ColourMap<float> cm2 (morph::ColourMapType::Duochrome);
+    try {
+        cm2.convert_batch (data, rgb.data());
+        std::cout << "Expected an exception for a 2D map\n";
+        --rtn;
+    } catch (const std::exception&) {}
+
+    std::cout << (rtn == 0 ? "PASS\n" : "FAIL\n");
+    return rtn;
+}
@@ -0,0 +1,94 @@
+// Test morph::ConfigBinding: snapshots of bound parameters, validation and change reports
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "morph/Config.h"
+#include "morph/range.h"
+#include "morph/vec.h"
+#include "morph/vvec.h"
+
+struct params
+{
+    bool flag = false;
+    int steps = 0;
+    float alpha = 0.0f;
+    double beta = 0.0;
+    std::string name;
+    morph::vec<float, 3> offset = { 0.0f, 0.0f, 0.0f };
+    morph::vvec<int> sizes;
+};
+
+static void write_json (const std::string& path, const std::string& body)
+{
+    std::ofstream f (path, std::ios::out | std::ios::trunc);
+    f << body;
+}
+
+int main()
+{
+    int rtn = 0;
+    const std::string jsonfile ("./testConfigBinding.json");
+    write_json (jsonfile, "{ \"flag\" : true, \"steps\" : 27, \"alpha\" : 0.25, \"name\" : \"run\","
+                          " \"offset\" : [1, 2, 3], \"sizes\" : [4, 5] }\n");
+
+    morph::ConfigBinding<params> pb;
+    pb.bind ("flag", &params::flag, false)
+        .bind ("steps", &params::steps, 1000, morph::range<int>{ 1, 100 })
+        .bind ("alpha", &params::alpha, 0.5f, morph::range<float>{ 0.0f, 1.0f })
+        .bind ("beta", &params::beta, 1.5)
+        .bind ("name", &params::name, std::string("default"))
+        .bind ("offset", &params::offset, morph::vec<float, 3>{ 0.0f, 0.0f, 0.0f })
+        .bind ("sizes", &params::sizes, morph::vvec<int>{});
+    if (pb.keys().size() != 7) { std::cout << "Wrong number of keys\n"; --rtn; }
+
+    morph::Config conf (jsonfile);
+    params p = pb.snapshot (conf);
+    if (!p.flag || p.steps != 27 || p.alpha != 0.25f || p.beta != 1.5 || p.name != "run"
+        || p.offset != morph::vec<float, 3>{ 1.0f, 2.0f, 3.0f } || p.sizes != morph::vvec<int>{ 4, 5 }) {
+        std::cout << "Snapshot values are wrong\n";
+        --rtn;
+    }
+
+    // Command line style overrides apply
+    conf.config_overrides["steps"] = "42";
+    if (pb.snapshot (conf).steps != 42) { std::cout << "Override was not applied\n"; --rtn; }
+    conf.config_overrides.clear();
+
+    // update() reports what changed and calls on_change
+    std::vector<std::string> notified;
+    pb.on_change = [&notified](const params&, const std::vector<std::string>& keys) { notified = keys; };
+    write_json (jsonfile, "{ \"flag\" : true, \"steps\" : 30, \"alpha\" : 0.25, \"name\" : \"run2\","
+                          " \"offset\" : [1, 2, 3], \"sizes\" : [4, 5] }\n");
+    conf.init (jsonfile);
+    std::vector<std::string> changed = pb.update (conf, p);
+    if (changed != std::vector<std::string>{ "steps", "name" } || notified != changed || p.steps != 30 || p.name != "run2") {
+        std::cout << "update() did not report the changes\n";
+        --rtn;
+    }
+    if (!pb.update (conf, p).empty()) { std::cout << "A second update() reported changes\n"; --rtn; }
+
+    // Out of range and mistyped values are reported, and leave the struct alone
+    write_json (jsonfile, "{ \"steps\" : 500, \"alpha\" : \"high\" }\n");
+    conf.init (jsonfile);
+    bool threw = false;
+    try {
+        pb.update (conf, p);
+    } catch (const std::runtime_error& e) {
+        threw = true;
+        const std::string msg = e.what();
+        std::cout << "Expected error: " << msg << std::endl;
+        if (msg.find ("'steps'") == std::string::npos || msg.find ("'alpha'") == std::string::npos) { --rtn; }
+    }
+    if (!threw || p.steps != 30) { std::cout << "Invalid values were not rejected\n"; --rtn; }
+
+    // find() gives the JSON without a copy
+    if (conf.find ("steps") == nullptr || conf.find ("steps")->get<int>() != 500 || conf.find ("nothing") != nullptr) {
+        std::cout << "find() failed\n";
+        --rtn;
+    }
+
+    return rtn;
+}
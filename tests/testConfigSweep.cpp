@@ -0,0 +1,100 @@
+// Test morph::ConfigSweep: the variants, their runs, their logs and resuming a sweep
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <filesystem>
+
+#include "morph/Config.h"
+#include "morph/ConfigSweep.h"
+
+// A stand in for a model: records its arguments in its output directory, and fails for x=3, y=1
+static void write_script (const std::string& path, const std::string& marker)
+{
+    std::ofstream f (path, std::ios::out | std::ios::trunc);
+    f << "#!/bin/sh\n"
+      << "out=''\n"
+      << "for a in \"$@\"; do case \"$a\" in -co:output_dir=*) out=\"${a#-co:output_dir=}\";; esac; done\n"
+      << "echo \"$@\" > \"$out/args.txt\"\n"
+      << "echo " << marker << "\n"
+      << "echo to stderr 1>&2\n"
+      << "case \"$*\" in *-co:x=3*-co:y=1*) exit 3;; esac\n"
+      << "exit 0\n";
+    f.close();
+    std::filesystem::permissions (path, std::filesystem::perms::owner_all);
+}
+
+static std::string slurp (const std::string& path)
+{
+    std::ifstream f (path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+int main()
+{
+    int rtn = 0;
+    const std::string outdir = "./testConfigSweep_out";
+    std::filesystem::remove_all (outdir);
+    std::filesystem::create_directories (outdir);
+    const std::string script = std::filesystem::absolute (outdir + "/model.sh").string();
+    write_script (script, "first");
+
+    morph::Config base;
+    base.set ("a", 1);
+    base.config_overrides["z"] = "9";
+
+    morph::ConfigSweep sweep (script, base, outdir);
+    sweep.add_values ("x", { "1", "2", "3" });
+    sweep.add_range ("y", 0, 1, 1);
+    sweep.max_workers = 2;
+
+    auto vars = sweep.variants();
+    if (vars.size() != 6 || vars[0].at("x") != "1" || vars[0].at("y") != "0" || vars[1].at("y") != "1"
+        || vars[5].at("x") != "3" || vars[3].at("z") != "9") {
+        std::cout << "Variants are wrong\n";
+        --rtn;
+    }
+
+    unsigned int finished = 0;
+    sweep.on_finished = [&finished](const morph::ConfigSweep::result&) { ++finished; };
+    auto results = sweep.run();
+    if (results.size() != 6 || finished != 6) { std::cout << "Expected 6 runs\n"; --rtn; }
+    for (const auto& r : results) {
+        const int expected = r.index == 5 ? 3 : 0;
+        if (r.status != expected) { std::cout << "Run " << r.index << " exited " << r.status << ", not " << expected << "\n"; --rtn; }
+        const std::string args = slurp (r.output_dir + "/args.txt");
+        if (args.find ("base_config.json") == std::string::npos || args.find ("-co:x=" + r.overrides.at("x")) == std::string::npos
+            || args.find ("-co:z=9") == std::string::npos) {
+            std::cout << "Run " << r.index << " had arguments " << args;
+            --rtn;
+        }
+        const std::string log = slurp (r.output_dir + "/log.txt");
+        if (log.find ("first") == std::string::npos || log.find ("to stderr") == std::string::npos) {
+            std::cout << "Run " << r.index << " log is '" << log << "'\n";
+            --rtn;
+        }
+    }
+    morph::Config written (outdir + "/base_config.json");
+    if (written.getInt ("a", 0) != 1) { std::cout << "The base config was not written\n"; --rtn; }
+
+    // Resume: only the failed run goes again
+    write_script (script, "second");
+    morph::ConfigSweep again (script, base, outdir);
+    again.add_values ("x", { "1", "2", "3" });
+    again.add_range ("y", 0, 1, 1);
+    finished = 0;
+    again.on_finished = [&finished](const morph::ConfigSweep::result&) { ++finished; };
+    results = again.run();
+    if (finished != 1 || results[5].status != 3 || results[0].status != 0) { std::cout << "Resume re-ran " << finished << " runs\n"; --rtn; }
+    if (slurp (results[0].output_dir + "/log.txt").find ("first") == std::string::npos
+        || slurp (results[5].output_dir + "/log.txt").find ("second") == std::string::npos) {
+        std::cout << "Resume ran the wrong variants\n";
+        --rtn;
+    }
+
+    std::filesystem::remove_all (outdir);
+    return rtn;
+}
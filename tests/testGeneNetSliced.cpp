@@ -0,0 +1,206 @@
+// Test the bit-sliced GeneNet::develop_sliced(), the next-state table and their use in
+// GeneNetDual::evaluate_fitness() and AllBasins, against the one-state-at-a-time develop()
+#include <iostream>
+#include <random>
+#include <set>
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <morph/bn/Genome.h>
+#include <morph/bn/GeneNet.h>
+#include <morph/bn/GeneNetDual.h>
+#include <morph/bn/Basins.h>
+
+using morph::bn::state_t;
+
+template <std::size_t N, std::size_t K>
+morph::bn::Genome<N, K> random_genome (std::mt19937_64& rng)
+{
+    morph::bn::Genome<N, K> g;
+    for (auto& gs : g) { gs = static_cast<typename morph::bn::Genome<N, K>::genosect_t>(rng()) & g.genosect_mask; }
+    return g;
+}
+
+// The fitness of one context as GeneNetDual::evaluate_one computed it before it used the
+// next-state table, with develop() and std::sets
+template <std::size_t N, std::size_t K>
+double reference_evaluate_one (const morph::bn::Genome<N, K>& genome, state_t state, state_t target)
+{
+    using GN = morph::bn::GeneNet<N, K>;
+    double score = 0.0;
+    state_t state_last = GN::state_t_unset;
+    std::set<state_t> visited;
+    visited.insert (state);
+    for (;;) {
+        state_last = state;
+        GN::develop (state, genome);
+        if (visited.count (state)) {
+            if (state == state_last) {
+                score = (state == target) ? 1.0 : score;
+            } else {
+                std::set<state_t> lc;
+                unsigned int lc_len = 0;
+                while (lc.count (state) == 0) {
+                    lc.insert (state);
+                    lc_len++;
+                    GN::develop (state, genome);
+                }
+                std::array<double, N> sc;
+                sc.fill (0.0);
+                for (state_t s : lc) {
+                    state_t a = (s ^ ~target) & GN::state_mask;
+                    for (unsigned int j = 0; j < N; ++j) { sc[j] += static_cast<double>((a >> j) & 0x1); }
+                }
+                score = std::pow (static_cast<double>(lc_len), N * -1.0);
+                for (unsigned int j = 0; j < N; ++j) { score *= sc[j]; }
+            }
+            break;
+        }
+        visited.insert (state);
+    }
+    return score;
+}
+
+template <std::size_t N, std::size_t K>
+int check (std::mt19937_64& rng, const unsigned int ngenomes)
+{
+    using GN = morph::bn::GeneNet<N, K>;
+    int rtn = 0;
+    for (unsigned int gi = 0; gi < ngenomes; ++gi) {
+        morph::bn::Genome<N, K> g = random_genome<N, K> (rng);
+
+        // The table against develop() for every state
+        typename GN::transition_table t = GN::next_state_table (g);
+        for (std::size_t s = 0; s < GN::n_states; ++s) {
+            state_t st = static_cast<state_t>(s);
+            GN::develop (st, g);
+            if (t[s] != st) {
+                std::cerr << "N=" << N << " K=" << K << ": table[" << s << "] wrong for genome " << g << "\n";
+                return -1;
+            }
+        }
+
+        // 256 random states at once, developed twice
+        std::array<state_t, 256> in;
+        for (auto& s : in) { s = static_cast<state_t>(rng() & GN::state_mask); }
+        typename GN::template state_planes<4> planes;
+        GN::pack (in.data(), in.size(), planes);
+        GN::develop_sliced (planes, g);
+        GN::develop_sliced (planes, g);
+        std::array<state_t, 256> out;
+        GN::unpack (planes, out.size(), out.data());
+        for (std::size_t j = 0; j < in.size(); ++j) {
+            state_t st = in[j];
+            GN::develop (st, g);
+            GN::develop (st, g);
+            if (out[j] != st) {
+                std::cerr << "N=" << N << " K=" << K << ": sliced lane " << j << " wrong\n";
+                return -1;
+            }
+        }
+
+        // Every state is in exactly one basin and every transition is a development step
+        morph::bn::AllBasins<N, K> ab (g);
+        std::size_t nnodes = 0;
+        for (auto& b : ab.basins) { nnodes += b.nodes.size(); }
+        if (nnodes != GN::n_states || ab.transitions.size() != GN::n_states) {
+            std::cerr << "N=" << N << " K=" << K << ": basins cover " << nnodes << " states and "
+                      << ab.transitions.size() << " transitions\n";
+            --rtn;
+        }
+        for (unsigned int tr : ab.transitions) {
+            state_t st = static_cast<state_t>(tr >> 16);
+            GN::develop (st, g);
+            if (st != static_cast<state_t>(tr & 0xff)) {
+                std::cerr << "N=" << N << " K=" << K << ": wrong basin transition\n";
+                --rtn;
+                break;
+            }
+        }
+        // The parents of each node are exactly the states that develop into it
+        std::array<std::set<state_t>, GN::n_states> pre;
+        for (std::size_t s = 0; s < GN::n_states; ++s) { pre[t[s]].insert (static_cast<state_t>(s)); }
+        for (auto& b : ab.basins) {
+            for (auto& nd : b.nodes) {
+                if (nd.second.parents != pre[nd.first] || nd.second.child != t[nd.first]) {
+                    std::cerr << "N=" << N << " K=" << K << ": wrong parents or child of a basin node\n";
+                    return -1;
+                }
+            }
+            if (b.limitCycle.empty() || (b.limitCycle.size() == 1) != (b.endpoint == morph::bn::endpoint::point)) {
+                std::cerr << "N=" << N << " K=" << K << ": wrong attractor\n";
+                return -1;
+            }
+        }
+    }
+    return rtn;
+}
+
+template <std::size_t N, std::size_t K>
+int check_fitness (std::mt19937_64& rng, const unsigned int ngenomes)
+{
+    morph::bn::GeneNetDual<N, K> gn;
+    gn.target_ant = 0x15 & morph::bn::GeneNet<N, K>::state_mask;
+    gn.target_pos = 0xa & morph::bn::GeneNet<N, K>::state_mask;
+    for (unsigned int gi = 0; gi < ngenomes; ++gi) {
+        morph::bn::Genome<N, K> g = random_genome<N, K> (rng);
+        double f = gn.evaluate_fitness (g);
+        double fr = reference_evaluate_one<N, K> (g, gn.initial_ant, gn.target_ant)
+        * reference_evaluate_one<N, K> (g, gn.initial_pos, gn.target_pos);
+        if (f != fr) {
+            std::cerr << "N=" << N << " K=" << K << ": fitness " << f << " != reference " << fr << " for " << g << "\n";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+    std::mt19937_64 rng (2718);
+
+    rtn += check<5, 5> (rng, 200);
+    rtn += check<5, 4> (rng, 200);
+    rtn += check<4, 2> (rng, 200);
+    rtn += check<6, 6> (rng, 100);
+    rtn += check<7, 5> (rng, 50);
+    rtn += check<3, 1> (rng, 50);
+
+    rtn += check_fitness<5, 5> (rng, 20000);
+    rtn += check_fitness<5, 4> (rng, 20000);
+    rtn += check_fitness<6, 6> (rng, 5000);
+
+    // The selected genome is fully fit
+    morph::bn::GeneNetDual<5, 5> gn;
+    gn.target_ant = 0x15;
+    gn.target_pos = 0xa;
+    morph::bn::Genome<5, 5> sel;
+    gn.set_selected (sel);
+    if (gn.evaluate_fitness (sel) != 1.0) {
+        std::cerr << "Selected genome does not have fitness 1\n";
+        --rtn;
+    }
+
+    // Timing, for information: fitness of many genomes, table path against the reference
+    std::vector<morph::bn::Genome<5, 5>> gs (100000);
+    for (auto& g : gs) { g = random_genome<5, 5> (rng); }
+    using sc = std::chrono::steady_clock;
+    sc::time_point t0 = sc::now();
+    double s1 = 0.0;
+    for (auto& g : gs) { s1 += gn.evaluate_fitness (g); }
+    sc::time_point t1 = sc::now();
+    double s0 = 0.0;
+    for (auto& g : gs) {
+        s0 += reference_evaluate_one<5, 5> (g, gn.initial_ant, gn.target_ant)
+        * reference_evaluate_one<5, 5> (g, gn.initial_pos, gn.target_pos);
+    }
+    sc::time_point t2 = sc::now();
+    if (s0 != s1) { --rtn; }
+    std::cout << "evaluate_fitness: " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+              << " ms (reference " << std::chrono::duration<double, std::milli>(t2 - t1).count()
+              << " ms) for " << gs.size() << " genomes\n";
+
+    std::cout << "testGeneNetSliced " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
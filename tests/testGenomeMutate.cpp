@@ -0,0 +1,67 @@
+// Test morph::bn::Genome::mutate: no flips with p = 0, every bit with p = 1, and in between a
+// flip rate of p that is the same for each bit position
+#include <iostream>
+#include <array>
+#include <cmath>
+#include <bitset>
+#include <morph/bn/Genome.h>
+#include <morph/bn/Random.h>
+
+int main()
+{
+    int rtn = 0;
+    constexpr std::size_t n = 5;
+    constexpr std::size_t k = 5;
+    constexpr std::size_t gw = std::size_t{1} << k;
+    using genome = morph::bn::Genome<n, k>;
+    morph::bn::Random<n, k> rng (42);
+
+    genome g;
+    g.zero();
+    g.mutate (0.0f, rng);
+    for (std::size_t i = 0; i < n; ++i) { if (g[i] != 0) { std::cerr << "Flips with p = 0\n"; --rtn; break; } }
+    g.mutate (1.0f, rng);
+    for (std::size_t i = 0; i < n; ++i) { if (g[i] != genome::genosect_mask) { std::cerr << "p = 1 left bits\n"; --rtn; break; } }
+
+    for (const float p : { 0.001f, 0.01f, 0.07f, 0.5f, 0.9f }) {
+        constexpr unsigned int trials = 20000;
+        std::array<unsigned int, genome::width> perbit = {};
+        unsigned long long int total = 0;
+        for (unsigned int t = 0; t < trials; ++t) {
+            g.zero();
+            g.mutate (p, rng);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j < gw; ++j) {
+                    if ((g[i] >> j) & 1u) { ++perbit[i * gw + j]; ++total; }
+                }
+            }
+        }
+        // The overall rate within 5 standard errors of p
+        const double nbits = static_cast<double>(trials) * genome::width;
+        const double rate = static_cast<double>(total) / nbits;
+        const double se = std::sqrt (p * (1.0 - p) / nbits);
+        if (std::abs (rate - p) > 5.0 * se) { std::cerr << "p = " << p << ": flip rate " << rate << "\n"; --rtn; }
+        // Each bit within 6 standard errors, so that no position is favoured (as the last
+        // can be if the gaps run off the end wrongly)
+        const double se1 = std::sqrt (p * (1.0 - p) / trials);
+        for (std::size_t b = 0; b < genome::width; ++b) {
+            const double r1 = static_cast<double>(perbit[b]) / trials;
+            if (std::abs (r1 - p) > 6.0 * se1) {
+                std::cerr << "p = " << p << ": bit " << b << " flip rate " << r1 << "\n"; --rtn; break;
+            }
+        }
+    }
+
+    // Mutations from one seed are repeatable
+    morph::bn::Random<n, k> r1 (7);
+    morph::bn::Random<n, k> r2 (7);
+    genome g1;
+    genome g2;
+    g1.zero();
+    g2.zero();
+    for (int i = 0; i < 100; ++i) { g1.mutate (0.05f, r1); g2.mutate (0.05f, r2); }
+    if (g1 != g2) { std::cerr << "Same seed, different mutations\n"; --rtn; }
+
+    if (rtn == 0) { std::cout << "Genome::mutate tests passed\n"; }
+    return rtn;
+}
@@ -0,0 +1,98 @@
+/*
+ * Test morph::GeodesicGrid: the counts of elements and of five-neighbour elements, symmetric
+ * neighbours, areas that cover the sphere, the Laplacian of constant and l = 1, 2 fields, and
+ * that diffusion conserves a field's integral.
+ */
+#include <morph/GeodesicGrid.h>
+#include <morph/mathconst.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+    const double r = 2.0;
+    morph::GeodesicGrid<double> gg (4, r);
+    if (gg.n() != 10 * 256 + 2) { std::cerr << "n = " << gg.n() << "\n"; --rtn; }
+    if (gg.faces.size() != 20 * 256) { std::cerr << "faces = " << gg.faces.size() << "\n"; --rtn; }
+
+    // 12 elements have five neighbours and the rest six; each neighbour lists the other
+    unsigned int n5 = 0;
+    for (std::size_t i = 0; i < gg.n(); ++i) {
+        const unsigned int nn = gg.num_neighbours (i);
+        if (nn == 5) { ++n5; } else if (nn != 6) { std::cerr << "element " << i << " has " << nn << " neighbours\n"; --rtn; break; }
+        for (std::uint32_t j = gg.nbr_start[i]; j < gg.nbr_start[i + 1]; ++j) {
+            const std::uint32_t k = gg.nbr[j];
+            bool found = false;
+            for (std::uint32_t l = gg.nbr_start[k]; l < gg.nbr_start[k + 1]; ++l) {
+                if (gg.nbr[l] == i) { found = true; if (std::abs (gg.nbr_w[l] - gg.nbr_w[j]) > 1e-12) { --rtn; } }
+            }
+            if (!found) { std::cerr << "asymmetric neighbours " << i << ", " << k << "\n"; --rtn; }
+            if (!(gg.nbr_w[j] > 0.0)) { std::cerr << "non-positive weight\n"; --rtn; }
+        }
+        if (std::abs (gg.coord (i).length() - r) > 1e-12) { std::cerr << "element off the sphere\n"; --rtn; break; }
+    }
+    if (n5 != 12) { std::cerr << n5 << " five-neighbour elements\n"; --rtn; }
+
+    // The neighbours go anticlockwise about the outward normal
+    for (std::size_t i = 0; i < gg.n(); ++i) {
+        const morph::vec<double, 3> c = gg.coord (i);
+        for (std::uint32_t j = gg.nbr_start[i]; j < gg.nbr_start[i + 1]; ++j) {
+            const std::uint32_t j1 = j + 1 < gg.nbr_start[i + 1] ? j + 1 : gg.nbr_start[i];
+            const morph::vec<double, 3> a = gg.coord (gg.nbr[j]) - c;
+            const morph::vec<double, 3> b = gg.coord (gg.nbr[j1]) - c;
+            if (a.cross (b).dot (c) <= 0.0) { std::cerr << "neighbours of " << i << " are out of order\n"; --rtn; i = gg.n() - 1; break; }
+        }
+    }
+
+    // The areas cover the sphere
+    const double four_pi_r2 = 4.0 * morph::mathconst<double>::pi * r * r;
+    std::vector<double> one (gg.n(), 1.0);
+    if (std::abs (gg.integral (one) - four_pi_r2) > 1e-9) { std::cerr << "area sum " << gg.integral (one) << "\n"; --rtn; }
+
+    // Constants have zero Laplacian; z and xy are spherical harmonics with l = 1 and 2, so
+    // their Laplacians are -l(l+1)/r^2 times themselves
+    std::vector<double> lap;
+    gg.laplacian (one, lap);
+    for (double l : lap) { if (std::abs (l) > 1e-9) { std::cerr << "laplacian of 1 = " << l << "\n"; --rtn; break; } }
+    for (int deg = 1; deg <= 2; ++deg) {
+        std::vector<double> u (gg.n());
+        for (std::size_t i = 0; i < gg.n(); ++i) {
+            const morph::vec<double, 3> c = gg.coord (i);
+            u[i] = deg == 1 ? c[2] : c[0] * c[1];
+        }
+        gg.laplacian (u, lap);
+        const double ev = -deg * (deg + 1) / (r * r);
+        double maxerr = 0.0, sse = 0.0, maxu = 0.0;
+        for (std::size_t i = 0; i < gg.n(); ++i) {
+            const double e = std::abs (lap[i] - ev * u[i]);
+            maxerr = std::max (maxerr, e);
+            sse += e * e;
+            maxu = std::max (maxu, std::abs (ev * u[i]));
+        }
+        const double rmserr = std::sqrt (sse / gg.n());
+        std::cout << "l = " << deg << ": relative error of the Laplacian, max " << maxerr / maxu << ", rms " << rmserr / maxu << "\n";
+        // Along the edges of the original icosahedron the error does not fall with refinement
+        // (a property of the bisected geodesic), but elsewhere it does
+        if (maxerr / maxu > 0.04 || rmserr / maxu > 0.004) { std::cerr << "laplacian of the l = " << deg << " harmonic is inaccurate\n"; --rtn; }
+    }
+
+    // Diffusion conserves the integral
+    std::vector<double> u (gg.n());
+    for (std::size_t i = 0; i < gg.n(); ++i) { u[i] = std::exp (-10.0 * (gg.coord (i) - morph::vec<double, 3>{ 0.0, 0.0, r }).sos()); }
+    const double integral0 = gg.integral (u);
+    for (int s = 0; s < 100; ++s) {
+        gg.laplacian (u, lap);
+        for (std::size_t i = 0; i < gg.n(); ++i) { u[i] += 0.0005 * lap[i]; }
+    }
+    if (std::abs (gg.integral (u) - integral0) > 1e-10 * integral0) { std::cerr << "diffusion changed the integral\n"; --rtn; }
+
+    // Float coordinates have the same connectivity
+    morph::GeodesicGrid<float> ggf (2);
+    if (ggf.n() != 162 || ggf.nbr != std::vector<std::uint32_t>(morph::GeodesicGrid<double>(2).nbr)) { std::cerr << "float grid differs\n"; --rtn; }
+
+    std::cout << "testGeodesicGrid " << (rtn ? "failed" : "passed") << std::endl;
+    return rtn;
+}
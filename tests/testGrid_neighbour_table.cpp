@@ -0,0 +1,105 @@
+/*
+ * Test Grid::compute_neighbour_table against the computed neighbour relationships, and
+ * Grid::indices_in_radius against a breadth first search over the neighbours, for every
+ * order and wrapping.
+ */
+#include "morph/Grid.h"
+#include <iostream>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+using grid_t = morph::Grid<unsigned int, float>;
+
+// The breadth first search that indices_in_radius used to do
+void bfs_in_radius (const grid_t& g, const morph::vec<float, 2> loc, const float radius, std::vector<unsigned int>& inds)
+{
+    std::set<unsigned int> seen;
+    std::vector<unsigned int> ring = { g.index_lookup (loc) };
+    inds.push_back (ring[0]);
+    seen.insert (ring[0]);
+    while (!ring.empty()) {
+        morph::vvec<unsigned int> prev (ring.begin(), ring.end());
+        morph::vvec<unsigned int> nn;
+        g.find_nearest_neighbours (prev, nn);
+        ring.clear();
+        for (auto n : nn) {
+            if (!seen.count (n) && (g.coord_lookup (n) - loc).length() < radius) { ring.push_back (n); }
+            seen.insert (n);
+        }
+        inds.insert (inds.end(), ring.begin(), ring.end());
+    }
+}
+
+int main()
+{
+    int rtn = 0;
+
+    const morph::GridOrder orders[] = { morph::GridOrder::bottomleft_to_topright, morph::GridOrder::topleft_to_bottomright,
+                                        morph::GridOrder::bottomleft_to_topright_colmaj, morph::GridOrder::topleft_to_bottomright_colmaj };
+    const morph::GridDomainWrap wraps[] = { morph::GridDomainWrap::None, morph::GridDomainWrap::Horizontal,
+                                            morph::GridDomainWrap::Vertical, morph::GridDomainWrap::Both };
+
+    for (auto o : orders) {
+        for (auto wr : wraps) {
+            grid_t g (23, 17, { 0.1f, 0.15f }, { -1.0f, 0.5f }, wr, o);
+            const unsigned int n = g.n();
+            std::vector<unsigned int> computed;
+            for (unsigned int i = 0; i < n; ++i) {
+                unsigned int nb[8] = { g.index_ne (i), g.index_nne (i), g.index_nn (i), g.index_nnw (i),
+                                       g.index_nw (i), g.index_nsw (i), g.index_ns (i), g.index_nse (i) };
+                computed.insert (computed.end(), nb, nb + 8);
+            }
+            g.compute_neighbour_table();
+            if (!g.has_neighbour_table()) { std::cerr << "No table\n"; --rtn; }
+            for (unsigned int i = 0; i < n; ++i) {
+                const unsigned int* t = g.neighbours (i);
+                unsigned int nb[8] = { g.index_ne (i), g.index_nne (i), g.index_nn (i), g.index_nnw (i),
+                                       g.index_nw (i), g.index_nsw (i), g.index_ns (i), g.index_nse (i) };
+                for (unsigned int d = 0; d < 8; ++d) {
+                    if (t[d] != computed[8 * i + d] || nb[d] != computed[8 * i + d]) {
+                        std::cerr << "Neighbour " << d << " of " << i << " differs\n";
+                        --rtn;
+                    }
+                }
+                if (g.has_nne (i) != (g.index_nne (i) != std::numeric_limits<unsigned int>::max())) { --rtn; }
+            }
+            if (g.index_ne (n) != std::numeric_limits<unsigned int>::max()) { std::cerr << "Off-grid lookup\n"; --rtn; }
+
+            // The table follows a change of size
+            g.set_w (11);
+            std::vector<unsigned int> after (g.neighbours (0), g.neighbours (0) + 8 * g.n());
+            g.clear_neighbour_table();
+            if (g.has_neighbour_table()) { std::cerr << "Table not cleared\n"; --rtn; }
+            for (unsigned int i = 0; i < g.n(); ++i) {
+                if (after[8 * i + grid_t::nbr_ne] != g.index_ne (i) || after[8 * i + grid_t::nbr_nsw] != g.index_nsw (i)) {
+                    std::cerr << "Table not rebuilt by set_w\n";
+                    --rtn;
+                    break;
+                }
+            }
+            g.compute_neighbour_table();
+
+            // Circles of various sizes and places, some overhanging the edges
+            for (float rad : { 0.01f, 0.1f, 0.149f, 0.3f, 0.77f, 3.0f }) {
+                for (unsigned int i = 0; i < g.n(); i += 13) {
+                    morph::vec<float, 2> loc = g[i] + morph::vec<float, 2>{ 0.021f, -0.033f };
+                    std::vector<unsigned int> ref;
+                    bfs_in_radius (g, loc, rad, ref);
+                    morph::vvec<unsigned int> got;
+                    g.indices_in_radius (loc, rad, got);
+                    if (got.empty() || got[0] != ref[0]) { std::cerr << "Centre differs\n"; --rtn; continue; }
+                    if (!std::is_sorted (got.begin() + 1, got.end())) { std::cerr << "Not in index order\n"; --rtn; }
+                    std::sort (ref.begin() + 1, ref.end());
+                    if (std::vector<unsigned int>(got.begin(), got.end()) != ref) {
+                        std::cerr << "indices_in_radius differs at radius " << rad << " around " << i << "\n";
+                        --rtn;
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
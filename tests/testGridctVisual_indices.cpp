@@ -0,0 +1,126 @@
+/*
+ * Test that the index tables GridctVisual computes at compile time (tri_indices and
+ * rect_indices) are those that the element by element loops build, for a few grid sizes and
+ * both triangulated element orders. No GL context is needed.
+ */
+#define GLAD_GL_IMPLEMENTATION // GL types for the GridctVisual headers, as in VisualOwnable.h
+#include <morph/glad/gl.h>
+#include <morph/GridctVisual.h>
+#include <morph/Gridct.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <vector>
+#include <array>
+
+// Exposes the protected index tables of a GridctVisual
+template <unsigned int w, unsigned int h, morph::GridOrder order>
+struct indices_probe : public morph::GridctVisual<float, unsigned int, float, w, h, morph::vec<float, 2>{ 1.0f, 1.0f },
+                                                  morph::vec<float, 2>{ 0.0f, 0.0f }, true,
+                                                  morph::GridDomainWrap::None, order>
+{
+    using base = morph::GridctVisual<float, unsigned int, float, w, h, morph::vec<float, 2>{ 1.0f, 1.0f },
+                                     morph::vec<float, 2>{ 0.0f, 0.0f }, true, morph::GridDomainWrap::None, order>;
+    using base::tri_indices;
+    using base::rect_indices;
+    using base::rodata_indices;
+};
+
+// The indices of GridVisMode::Triangles, as initializeVerticesTris() builds them at runtime
+std::vector<GLuint> loop_tri_indices (const unsigned int w, const unsigned int h, const morph::GridOrder order)
+{
+    std::vector<GLuint> indices;
+    for (unsigned int ri = 0; ri < h-1; ++ri) {
+        for (unsigned int ci = 0; ci < w-1; ++ci) {
+            unsigned int ii = ri * w + ci;
+            if (order == morph::GridOrder::bottomleft_to_topright) {
+                indices.push_back (ii);
+                indices.push_back (ii + w + 1);
+                indices.push_back (ii + 1);
+                indices.push_back (ii);
+                indices.push_back (ii + w);
+                indices.push_back (ii + w + 1);
+            } else {
+                indices.push_back (ii);
+                indices.push_back (ii + 1);
+                indices.push_back (ii + w + 1);
+                indices.push_back (ii);
+                indices.push_back (ii + w + 1);
+                indices.push_back (ii + w);
+            }
+        }
+    }
+    return indices;
+}
+
+// The indices of GridVisMode::RectInterp, as initializeVerticesRectsInterpolated() builds them
+std::vector<GLuint> loop_rect_indices (const unsigned int w, const unsigned int h)
+{
+    std::vector<GLuint> indices;
+    unsigned int idx = 0;
+    for (unsigned int ri = 0; ri < w * h; ++ri) {
+        indices.push_back (idx+1);
+        indices.push_back (idx);
+        indices.push_back (idx+2);
+
+        indices.push_back (idx+2);
+        indices.push_back (idx);
+        indices.push_back (idx+3);
+
+        indices.push_back (idx+3);
+        indices.push_back (idx);
+        indices.push_back (idx+4);
+
+        indices.push_back (idx+4);
+        indices.push_back (idx);
+        indices.push_back (idx+1);
+        idx += 5;
+    }
+    return indices;
+}
+
+template <unsigned int w, unsigned int h, morph::GridOrder order>
+int check_tables()
+{
+    using probe = indices_probe<w, h, order>;
+    static_assert (probe::rodata_indices, "grid too large for compile-time index tables");
+    static_assert (probe::tri_indices.size() == 6u * (w - 1) * (h - 1));
+    static_assert (probe::rect_indices.size() == 12u * w * h);
+
+    int rtn = 0;
+    const std::vector<GLuint> tri (probe::tri_indices.begin(), probe::tri_indices.end());
+    if (tri != loop_tri_indices (w, h, order)) {
+        std::cout << "tri_indices differ from the loop for " << w << "x" << h << std::endl;
+        --rtn;
+    }
+    const std::vector<GLuint> rect (probe::rect_indices.begin(), probe::rect_indices.end());
+    if (rect != loop_rect_indices (w, h)) {
+        std::cout << "rect_indices differ from the loop for " << w << "x" << h << std::endl;
+        --rtn;
+    }
+    return rtn;
+}
+
+// A few entries, worked out by hand, for a 3x2 grid
+using probe32 = indices_probe<3, 2, morph::GridOrder::bottomleft_to_topright>;
+static_assert (probe32::tri_indices[0] == 0 && probe32::tri_indices[1] == 4 && probe32::tri_indices[2] == 1);
+static_assert (probe32::tri_indices[3] == 0 && probe32::tri_indices[4] == 3 && probe32::tri_indices[5] == 4);
+static_assert (probe32::tri_indices[6] == 1 && probe32::tri_indices[11] == 5);
+static_assert (probe32::rect_indices[0] == 1 && probe32::rect_indices[1] == 0 && probe32::rect_indices[11] == 1);
+static_assert (probe32::rect_indices[12] == 6 && probe32::rect_indices[13] == 5 && probe32::rect_indices[71] == 26);
+using probe32tl = indices_probe<3, 2, morph::GridOrder::topleft_to_bottomright>;
+static_assert (probe32tl::tri_indices[1] == 1 && probe32tl::tri_indices[2] == 4 && probe32tl::tri_indices[5] == 3);
+
+int main()
+{
+    int rtn = 0;
+    rtn += check_tables<2, 2, morph::GridOrder::bottomleft_to_topright>();
+    rtn += check_tables<3, 2, morph::GridOrder::bottomleft_to_topright>();
+    rtn += check_tables<7, 5, morph::GridOrder::bottomleft_to_topright>();
+    rtn += check_tables<64, 64, morph::GridOrder::bottomleft_to_topright>();
+    rtn += check_tables<2, 2, morph::GridOrder::topleft_to_bottomright>();
+    rtn += check_tables<5, 9, morph::GridOrder::topleft_to_bottomright>();
+    rtn += check_tables<100, 40, morph::GridOrder::topleft_to_bottomright>();
+
+    std::cout << "testGridctVisual_indices " << (rtn == 0 ? "passed" : "FAILED") << std::endl;
+    return rtn;
+}
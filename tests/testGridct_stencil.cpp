@@ -0,0 +1,105 @@
+/*
+ * Test Gridct's compile-time neighbour offsets and its stencil application, which must
+ * give the same results as the runtime path for the equivalent morph::Grid.
+ */
+#include "morph/Gridct.h"
+#include "morph/Grid.h"
+#include "morph/stencil.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+constexpr morph::stencil<float, 6> lopsided = { { { { 0, 0, 1.0f }, { 2, 0, 0.5f }, { -1, 0, -0.25f },
+                                                    { 0, 2, 2.0f }, { 1, -1, 0.125f }, { -2, -2, -1.0f } } } };
+
+float maxdiff (const std::vector<float>& a, const std::vector<float>& b)
+{
+    float m = 0.0f;
+    for (std::size_t i = 0; i < a.size(); ++i) { m = std::max (m, std::abs (a[i] - b[i])); }
+    return a.size() == b.size() ? m : 1e9f;
+}
+
+template <morph::GridDomainWrap wrap, morph::GridOrder order>
+int test_one (morph::RandUniform<float>& rng)
+{
+    int rtn = 0;
+    constexpr unsigned int w = 1030;
+    constexpr unsigned int h = 41;
+    using gct_t = morph::Gridct<unsigned int, float, w, h, morph::vec<float, 2>{ 1.0f, 1.0f },
+                                morph::vec<float, 2>{ 0.0f, 0.0f }, false, wrap, order>;
+    gct_t gct;
+    morph::Grid<unsigned int, float> g (w, h, { 1.0f, 1.0f }, { 0.0f, 0.0f }, wrap, order);
+
+    // The neighbour offsets agree with the neighbour functions away from the edges
+    for (unsigned int i = 0; i < gct_t::n; ++i) {
+        if (!gct_t::interior (i)) { continue; }
+        const unsigned int nb[8] = { gct.index_ne (i), gct.index_nne (i), gct.index_nn (i), gct.index_nnw (i),
+                                     gct.index_nw (i), gct.index_nsw (i), gct.index_ns (i), gct.index_nse (i) };
+        for (unsigned int k = 0; k < 8; ++k) {
+            if (static_cast<long long>(i) + gct_t::nbr_offset[k] != static_cast<long long>(nb[k])) { --rtn; }
+        }
+    }
+    if (gct_t::interior (0) || gct_t::interior (w - 1) || !gct_t::interior (w + 1) || gct_t::interior (w + 1, 2)
+        || gct_t::interior (gct_t::n)) {
+        std::cerr << "interior() is wrong\n";
+        --rtn;
+    }
+
+    std::vector<float> f = rng.get (gct_t::n);
+    std::vector<float> ct_out, rt_out;
+    gct.template apply_stencil<lopsided> (f, ct_out);
+    morph::apply_stencil<lopsided> (g, f, rt_out);
+    if (maxdiff (ct_out, rt_out) > 1e-5f) { std::cerr << "Gridct stencil differs from Grid\n"; --rtn; }
+    gct.template apply_stencil<morph::stencils::laplace9<float>> (f, ct_out, 0.5f);
+    morph::apply_stencil<morph::stencils::laplace9<float>> (g, f, rt_out, 0.5f);
+    if (maxdiff (ct_out, rt_out) > 1e-5f) { std::cerr << "Gridct laplace9 differs from Grid\n"; --rtn; }
+
+    if (rtn) { std::cerr << "Failed for wrap " << int(wrap) << ", order " << int(order) << "\n"; }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    morph::RandUniform<float> rng (-1.0f, 1.0f, 7);
+
+    rtn += test_one<morph::GridDomainWrap::None, morph::GridOrder::bottomleft_to_topright> (rng);
+    rtn += test_one<morph::GridDomainWrap::Both, morph::GridOrder::bottomleft_to_topright> (rng);
+    rtn += test_one<morph::GridDomainWrap::Horizontal, morph::GridOrder::topleft_to_bottomright> (rng);
+    rtn += test_one<morph::GridDomainWrap::Vertical, morph::GridOrder::topleft_to_bottomright> (rng);
+
+    // Time a fused two-field Laplacian on a Gridct and on the equivalent Grid
+    {
+        constexpr unsigned int w = 1024;
+        using gct_t = morph::Gridct<unsigned int, float, w, w, morph::vec<float, 2>{ 1.0f, 1.0f },
+                                    morph::vec<float, 2>{ 0.0f, 0.0f }, false>;
+        gct_t gct;
+        morph::Grid<unsigned int, float> g (w, w);
+        std::vector<float> A = rng.get (gct_t::n);
+        std::vector<float> B = rng.get (gct_t::n);
+        std::vector<float> dA (gct_t::n), dB (gct_t::n), dA2 (gct_t::n), dB2 (gct_t::n);
+        constexpr auto lap = morph::stencils::laplace5<float>;
+        auto upd = [&](std::vector<float>& a, std::vector<float>& b) {
+            return [&](std::size_t i, const std::array<float, 2>& s) {
+                a[i] = 0.1f * s[0] - A[i] * B[i] * B[i];
+                b[i] = 0.05f * s[1] + A[i] * B[i] * B[i];
+            };
+        };
+        using sc = std::chrono::steady_clock;
+        constexpr int reps = 20;
+        sc::time_point t0 = sc::now();
+        for (int r = 0; r < reps; ++r) { gct.apply_stencil_fused<lap> (upd (dA, dB), A, B); }
+        sc::time_point t1 = sc::now();
+        for (int r = 0; r < reps; ++r) { morph::apply_stencil_fused<lap> (g, upd (dA2, dB2), A, B); }
+        sc::time_point t2 = sc::now();
+        std::cout << "Fused Laplacians on " << w << "x" << w << ": Gridct "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() / reps << " ms, Grid "
+                  << std::chrono::duration<double, std::milli>(t2 - t1).count() / reps << " ms\n";
+        if (maxdiff (dA, dA2) > 1e-5f || maxdiff (dB, dB2) > 1e-5f) { std::cerr << "Fused results differ\n"; --rtn; }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -147,5 +147,29 @@ int main()
     if (vedges != -vedges_exp) { --rtn; }
     if (hedges != -hedges_exp) { --rtn; }
 
+    // argsort, argsort_partial and top_k. Ties keep their original order.
+    std::vector<int> sv = { 5, 1, 4, 1, 9, 2, 6 };
+    std::vector<unsigned int> as_exp = { 1, 3, 5, 2, 0, 6, 4 };
+    if (MathAlgo::argsort (sv) != as_exp) { cout << "argsort failed\n"; --rtn; }
+    std::vector<unsigned int> asd_exp = { 4, 6, 0, 2, 5, 1, 3 };
+    if (MathAlgo::argsort (sv, true) != asd_exp) { cout << "argsort descending failed\n"; --rtn; }
+    if (MathAlgo::argsort_partial (sv, 3) != std::vector<unsigned int>({ 1, 3, 5 })) { --rtn; }
+    if (MathAlgo::top_k (sv, 2) != std::vector<unsigned int>({ 4, 6 })) { cout << "top_k failed\n"; --rtn; }
+    if (MathAlgo::top_k (sv, 3, false) != std::vector<unsigned int>({ 1, 3, 5 })) { --rtn; }
+    if (MathAlgo::top_k (sv, 100).size() != sv.size()) { --rtn; }
+
+    // The bubble sort index functions give the same (stable) order on a large data set
+    morph::vvec<float> big (20000);
+    big.randomize (0.0f, 100.0f);
+    for (auto& b : big) { b = std::floor (b); } // plenty of ties
+    std::vector<unsigned int> bidx (big.size());
+    MathAlgo::bubble_sort_hi_to_lo<float> (big, bidx);
+    morph::vvec<std::size_t> vidx = big.argsort (true);
+    for (std::size_t i = 0; i < big.size(); ++i) {
+        if (bidx[i] != vidx[i]) { cout << "argsort orders differ at " << i << "\n"; --rtn; break; }
+        if (i > 0 && big[bidx[i]] > big[bidx[i-1]]) { cout << "hi to lo order wrong\n"; --rtn; break; }
+        if (i > 0 && big[bidx[i]] == big[bidx[i-1]] && bidx[i] < bidx[i-1]) { cout << "not stable\n"; --rtn; break; }
+    }
+
     return rtn;
 }
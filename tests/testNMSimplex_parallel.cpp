@@ -0,0 +1,90 @@
+/*
+ * Test NM_Simplex's parallel mode, which proposes the reflected, expanded and contracted
+ * points as one batch. It must follow the same path as the serial algorithm while needing
+ * fewer rounds of objective computation.
+ */
+#include "morph/NM_Simplex.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+int main()
+{
+    int rtn = 0;
+    morph::vvec<morph::vvec<double>> i_vertices = {
+        { 0.7, 0.0 },
+        { 0.0, 0.6 },
+        { -0.6, -1.0 }
+    };
+    std::atomic<unsigned int> calls = 0;
+    auto banana = [&calls](const morph::vvec<double>& point) {
+        ++calls;
+        double x = point[0];
+        double y = point[1];
+        return ((1.0 - x) * (1.0 - x)) + (100.0 * (y - (x * x)) * (y - (x * x)));
+    };
+
+    // The serial algorithm, counting the rounds of computation that the client would do
+    morph::NM_Simplex<double> serial (i_vertices);
+    serial.objective = banana;
+    serial.termination_threshold = std::numeric_limits<double>::epsilon();
+    unsigned int serial_rounds = 0;
+    while (serial.state != morph::NM_Simplex_State::ReadyToStop) {
+        if (serial.state != morph::NM_Simplex_State::NeedToOrder) { ++serial_rounds; }
+        serial.step();
+    }
+    unsigned int serial_calls = calls;
+
+    // The parallel variant, driven by the client through the batch protocol
+    calls = 0;
+    morph::NM_Simplex<double> par (i_vertices);
+    par.parallel = true;
+    par.termination_threshold = std::numeric_limits<double>::epsilon();
+    unsigned int par_rounds = 0;
+    while (par.state != morph::NM_Simplex_State::ReadyToStop) {
+        if (par.state == morph::NM_Simplex_State::NeedToComputeThenOrder) {
+            for (unsigned int i = 0; i <= par.n; ++i) { par.values[i] = banana (par.vertices[i]); }
+            par.order();
+            ++par_rounds;
+        } else if (par.state == morph::NM_Simplex_State::NeedToOrder) {
+            par.order();
+        } else if (par.state == morph::NM_Simplex_State::NeedToComputeBatch) {
+            if (par.batch.size() != 3) { std::cerr << "Expected a batch of 3 points\n"; return -1; }
+            morph::vvec<double> vals (par.batch.size());
+            for (unsigned int i = 0; i < par.batch.size(); ++i) { vals[i] = banana (par.batch[i]); }
+            par.apply_batch (vals);
+            ++par_rounds;
+        } else {
+            std::cerr << "Unexpected state in parallel mode\n";
+            return -1;
+        }
+    }
+
+    unsigned int par_calls = calls;
+
+    // And with step() computing the batches concurrently
+    morph::NM_Simplex<double> par2 (i_vertices);
+    par2.parallel = true;
+    par2.objective = banana;
+    par2.termination_threshold = std::numeric_limits<double>::epsilon();
+    par2.run();
+
+    std::cout << "Serial: " << serial_rounds << " rounds, " << serial_calls << " calls. Parallel: "
+              << par_rounds << " rounds, " << par_calls << " calls. Best: " << par.best_vertex()
+              << " = " << par.best_value() << std::endl;
+    if (par.best_vertex() != serial.best_vertex() || par.operation_count != serial.operation_count
+        || par2.best_vertex() != serial.best_vertex()) {
+        std::cerr << "The parallel variant took a different path\n";
+        --rtn;
+    }
+    if (par_rounds >= serial_rounds) { std::cerr << "The parallel variant did not need fewer rounds\n"; --rtn; }
+    if (std::abs (par.best_vertex()[0] - 1.0) > 1e-3 || std::abs (par.best_vertex()[1] - 1.0) > 1e-3) {
+        std::cerr << "Did not find the minimum\n";
+        --rtn;
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
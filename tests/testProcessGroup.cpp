@@ -0,0 +1,64 @@
+/*
+ * Test morph::ProcessGroup by running several shells at once, each of which writes to its
+ * stdout and stderr and exits with its own status.
+ */
+#include <morph/ProcessGroup.h>
+#include <iostream>
+#include <string>
+#include <map>
+
+int main()
+{
+    int rtn = 0;
+
+    constexpr unsigned int nproc = 8;
+    std::map<unsigned int, std::string> out;
+    std::map<unsigned int, std::string> err;
+    std::map<unsigned int, int> status;
+
+    morph::ProcessGroup g;
+    g.on_stdout = [&out](unsigned int id, const std::string& s) { out[id] += s; };
+    g.on_stderr = [&err](unsigned int id, const std::string& s) { err[id] += s; };
+    g.on_finished = [&status](unsigned int id, int st) { status[id] = st; };
+
+    std::map<unsigned int, unsigned int> which; // id to i
+    for (unsigned int i = 0; i < nproc; ++i) {
+        // Each child prints more than a pipe's worth, so the group must read as it goes
+        const std::string script = "i=0; while [ $i -lt 2000 ]; do echo " + std::to_string (i)
+        + "_0123456789012345678901234567890123456789; i=$((i+1)); done; echo err" + std::to_string (i)
+        + " 1>&2; exit " + std::to_string (i);
+        which[g.start ("/bin/sh", { "sh", "-c", script })] = i;
+    }
+    if (g.size() != nproc) { --rtn; }
+
+    g.wait_all();
+    if (g.size() != 0u) { --rtn; }
+
+    const std::string line_end = "_0123456789012345678901234567890123456789\n";
+    for (const auto& [id, i] : which) {
+        if (status.count (id) == 0 || status[id] != static_cast<int>(i)) {
+            std::cout << "Child " << i << " has wrong status\n";
+            --rtn;
+        }
+        const std::string line = std::to_string (i) + line_end;
+        if (out[id].size() != 2000u * line.size()) {
+            std::cout << "Child " << i << " gave " << out[id].size() << " bytes of stdout\n";
+            --rtn;
+        } else if (out[id].compare (0, line.size(), line) != 0) {
+            --rtn;
+        }
+        if (err[id] != "err" + std::to_string (i) + "\n") {
+            std::cout << "Child " << i << " gave stderr '" << err[id] << "'\n";
+            --rtn;
+        }
+    }
+
+    // A program that doesn't exist can't be started
+    try {
+        g.start ("/no/such/program", { "program" });
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,148 @@
+/*
+ * Test morph::QuadGrid: the Laplacian on uniform and locally refined meshes, neighbour
+ * symmetry, 2:1 balance, and that refinement, coarsening and diffusion conserve a field's
+ * integral.
+ */
+#include <morph/QuadGrid.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+    using qg_t = morph::QuadGrid<double>;
+    qg_t qg (16, 16, { 0.1, 0.1 }, { 0.0, 0.0 }, 3);
+    if (qg.n() != 256) { std::cerr << "n != 256\n"; --rtn; }
+
+    // On the uniform grid, the Laplacian of x^2 + y^2 is 4 away from the boundary
+    std::vector<double> u (qg.n());
+    for (std::size_t i = 0; i < qg.n(); ++i) { const auto c = qg.coord (i); u[i] = c[0] * c[0] + c[1] * c[1]; }
+    std::vector<double> lap;
+    qg.laplacian (u, lap);
+    for (std::size_t i = 0; i < qg.n(); ++i) {
+        if (qg.nbr_start[i + 1] - qg.nbr_start[i] == 4 && std::abs (lap[i] - 4.0) > 1e-9) {
+            std::cerr << "uniform laplacian " << lap[i] << "\n"; --rtn; break;
+        }
+    }
+
+    // Refine about a disc, three times over; the mesh must stay balanced
+    std::vector<double> field (qg.n());
+    for (std::size_t i = 0; i < qg.n(); ++i) { field[i] = std::sin (qg.coord(i)[0] * 3.0) + 2.0; }
+    const double integral0 = qg.integral (field);
+    auto disc = [&qg]() {
+        std::vector<double> ind (qg.n(), 0.0);
+        for (std::size_t i = 0; i < qg.n(); ++i) {
+            const morph::vec<double, 2> d = qg.coord (i) - morph::vec<double, 2>{ 0.6, 0.6 };
+            ind[i] = d.length() < 0.3 ? 1.0 : 0.0;
+        }
+        return ind;
+    };
+    for (int r = 0; r < 3; ++r) {
+        if (!qg.adapt (disc(), 0.5, -1.0, { &field })) { std::cerr << "adapt made no change\n"; --rtn; }
+    }
+    unsigned int maxl = 0;
+    for (std::size_t i = 0; i < qg.n(); ++i) { maxl = std::max (maxl, qg.level (i)); }
+    if (maxl != 3) { std::cerr << "max level " << maxl << "\n"; --rtn; }
+    // Balancing may have brought new, coarser cells into the disc; refinement then stops at max_level
+    int more = 0;
+    while (qg.adapt (disc(), 0.5, -1.0, { &field }) && more < 10) { ++more; }
+    if (more >= 10) { std::cerr << "adapt did not stop at max_level\n"; --rtn; }
+    for (std::size_t i = 0; i < qg.n(); ++i) { maxl = std::max (maxl, qg.level (i)); }
+    if (maxl != 3) { std::cerr << "refined past max_level\n"; --rtn; }
+    if (field.size() != qg.n()) { std::cerr << "field not resized\n"; --rtn; }
+    if (std::abs (qg.integral (field) - integral0) > 1e-9) { std::cerr << "refinement is not conservative\n"; --rtn; }
+
+    // Neighbours are mutual, with the same weights, and at most one level apart
+    for (std::size_t i = 0; i < qg.n() && rtn == 0; ++i) {
+        for (std::uint32_t j = qg.nbr_start[i]; j < qg.nbr_start[i + 1]; ++j) {
+            const std::uint32_t k = qg.nbr[j];
+            bool found = false;
+            for (std::uint32_t m = qg.nbr_start[k]; m < qg.nbr_start[k + 1]; ++m) {
+                if (qg.nbr[m] == i && qg.nbr_w[m] == qg.nbr_w[j]) { found = true; }
+            }
+            if (!found) { std::cerr << "neighbours " << i << ", " << k << " not mutual\n"; --rtn; break; }
+            if (std::abs (static_cast<int>(qg.level (i)) - static_cast<int>(qg.level (k))) > 1) { std::cerr << "unbalanced\n"; --rtn; break; }
+        }
+    }
+
+    // The total area is unchanged and index_of finds the leaf about a point
+    double area = 0.0;
+    for (std::size_t i = 0; i < qg.n(); ++i) { area += qg.area (i); }
+    if (std::abs (area - 1.6 * 1.6) > 1e-9) { std::cerr << "area " << area << "\n"; --rtn; }
+    for (std::size_t i = 0; i < qg.n(); i += 7) {
+        if (qg.index_of (qg.coord (i)) != i) { std::cerr << "index_of " << i << "\n"; --rtn; break; }
+    }
+
+    // On the refined mesh, the fluxes sum to zero, and the Laplacians of x and of y are 0 away
+    // from the boundary, including across the level boundaries
+    qg.laplacian (field, lap);
+    if (std::abs (qg.integral (lap)) > 1e-9) { std::cerr << "laplacian is not conservative " << qg.integral (lap) << "\n"; --rtn; }
+    for (unsigned int ax = 0; ax < 2; ++ax) {
+        std::vector<double> x (qg.n());
+        for (std::size_t i = 0; i < qg.n(); ++i) { x[i] = qg.coord(i)[ax]; }
+        qg.laplacian (x, lap);
+        for (std::size_t i = 0; i < qg.n(); ++i) {
+            const auto c = qg.coord (i);
+            if (c[0] > 0.2 && c[0] < 1.4 && c[1] > 0.2 && c[1] < 1.4 && std::abs (lap[i]) > 1e-9) {
+                std::cerr << "laplacian of " << (ax ? "y" : "x") << " at " << c << " is " << lap[i] << "\n"; --rtn; break;
+            }
+        }
+    }
+
+    // Diffusion conserves the integral
+    const double integral1 = qg.integral (field);
+    for (int t = 0; t < 100; ++t) {
+        qg.laplacian (field, lap);
+        for (std::size_t i = 0; i < qg.n(); ++i) { field[i] += 1e-6 * lap[i]; }
+    }
+    if (std::abs (qg.integral (field) - integral1) > 1e-9) { std::cerr << "diffusion is not conservative\n"; --rtn; }
+
+    // Coarsening everywhere returns to the root cells, conservatively
+    const double integral2 = qg.integral (field);
+    std::vector<double> zero;
+    for (int r = 0; r < 5; ++r) {
+        zero.assign (qg.n(), 0.0);
+        qg.adapt (zero, 1.0, 0.5, { &field });
+    }
+    if (qg.n() != 256) { std::cerr << "coarsened to " << qg.n() << " cells\n"; --rtn; }
+    if (std::abs (qg.integral (field) - integral2) > 1e-9) { std::cerr << "coarsening is not conservative\n"; --rtn; }
+
+    // Refinement driven by the gradient of a step
+    morph::QuadGrid<float> qf (32, 32, { 1.0f / 32, 1.0f / 32 }, { 0.0f, 0.0f }, 2);
+    std::vector<float> step (qf.n());
+    for (int r = 0; r < 2; ++r) {
+        for (std::size_t i = 0; i < qf.n(); ++i) { step[i] = qf.coord(i)[0] < 0.5f ? 0.0f : 1.0f; }
+        qf.adapt (qf.gradient (step), 10.0f, 1.0f, { &step });
+    }
+    std::size_t nfine = 0;
+    for (std::size_t i = 0; i < qf.n(); ++i) {
+        if (qf.level (i) == 2) {
+            ++nfine;
+            if (std::abs (qf.coord(i)[0] - 0.5f) > 0.1f) { std::cerr << "refined far from the step\n"; --rtn; break; }
+        }
+    }
+    if (nfine == 0) { std::cerr << "gradient refinement refined nothing\n"; --rtn; }
+
+    // Rectangular cells: the Laplacian of x^2 + 3y^2 is 8 in the interior, across level boundaries too
+    qg_t qa (12, 8, { 0.1, 0.05 }, { 0.0, 0.0 }, 2);
+    for (int r = 0; r < 2; ++r) {
+        std::vector<double> ind (qa.n(), 0.0);
+        for (std::size_t i = 0; i < qa.n(); ++i) { ind[i] = qa.coord(i)[0] < 0.5 ? 1.0 : 0.0; }
+        qa.adapt (ind, 0.5, -1.0);
+    }
+    std::vector<double> q2 (qa.n());
+    for (std::size_t i = 0; i < qa.n(); ++i) { const auto c = qa.coord (i); q2[i] = c[0] * c[0] + 3.0 * c[1] * c[1]; }
+    qa.laplacian (q2, lap);
+    for (std::size_t i = 0; i < qa.n(); ++i) {
+        const auto c = qa.coord (i);
+        const bool interior = c[0] > 0.1 && c[0] < 1.0 && c[1] > 0.05 && c[1] < 0.3;
+        // Where the level changes, the approximation is first order
+        const double tol = std::abs (c[0] - 0.5) < 0.1 ? 1.0 : 1e-6;
+        if (interior && std::abs (lap[i] - 8.0) > tol) { std::cerr << "rectangular laplacian at " << c << " is " << lap[i] << "\n"; --rtn; break; }
+    }
+
+    if (rtn == 0) { std::cout << "QuadGrid tests passed; " << qg.memory_usage().str(); }
+    return rtn;
+}
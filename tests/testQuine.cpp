@@ -0,0 +1,197 @@
+// Test bn::Quine, exact and heuristic, against brute force minimisation of small functions
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+#include <morph/bn/Quine.h>
+
+// Does the cover of q hold exactly the minterms in on?
+bool cover_is_exact (const morph::bn::Quine& q, const std::vector<char>& on)
+{
+    std::vector<char> got (on.size(), 0);
+    for (std::size_t i : q.cover) {
+        for (unsigned int m : q.primes[i].mints()) {
+            if (!on[m]) { return false; }
+            got[m] = 1;
+        }
+    }
+    return got == on;
+}
+
+// Is every implicant in q's cover prime (no variable can be dropped)?
+bool cover_is_prime (const morph::bn::Quine& q, const std::vector<char>& on)
+{
+    for (std::size_t i : q.cover) {
+        const morph::bn::Implicant& p = q.primes[i];
+        for (int j = 0; j < q.vars; ++j) {
+            const unsigned int b = 1u << j;
+            if (p.mask & b) { continue; }
+            morph::bn::Implicant bigger (p.implicant, q.vars, p.mask | b);
+            bool inside = true;
+            for (unsigned int m : bigger.mints()) { if (!on[m]) { inside = false; break; } }
+            if (inside) { return false; }
+        }
+    }
+    return true;
+}
+
+// The smallest number of q's primes that cover on, by trying every combination in turn
+bool covers_with (const morph::bn::Quine& q, const std::vector<char>& on, std::size_t k, std::size_t from, std::vector<int>& cnt)
+{
+    if (k == 0) {
+        for (std::size_t m = 0; m < on.size(); ++m) { if (on[m] && !cnt[m]) { return false; } }
+        return true;
+    }
+    for (std::size_t i = from; i < q.primes.size(); ++i) {
+        for (unsigned int m : q.primes[i].mints()) { ++cnt[m]; }
+        bool ok = covers_with (q, on, k - 1, i + 1, cnt);
+        for (unsigned int m : q.primes[i].mints()) { --cnt[m]; }
+        if (ok) { return true; }
+    }
+    return false;
+}
+
+std::size_t brute_min (const morph::bn::Quine& q, const std::vector<char>& on)
+{
+    std::vector<int> cnt (on.size(), 0);
+    for (std::size_t k = 1; k <= q.primes.size(); ++k) {
+        if (covers_with (q, on, k, 0, cnt)) { return k; }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+    std::mt19937 rng (31);
+
+    // A textbook example: F = sum m(4,8,10,11,12,15) has minimal form BC'D' + AB'D' + ACD
+    {
+        morph::bn::Quine q (4);
+        for (int m : {4, 8, 10, 11, 12, 15}) { q.addMinterm (m); }
+        q.go();
+        if (q.primes.size() != 5 || q.cover.size() != 3) {
+            std::cerr << "Textbook example: " << q.primes.size() << " primes, " << q.min() << "\n";
+            --rtn;
+        }
+        q.complexity();
+        if (q.cplexity != 3 || q.outof != 16) { --rtn; }
+    }
+
+    // Constant functions
+    {
+        morph::bn::Quine q0 (3);
+        q0.go();
+        morph::bn::Quine q1 (3);
+        for (int m = 0; m < 8; ++m) { q1.addMinterm (m); }
+        q1.go();
+        if (q0.min() != "F = 0" || q1.min() != "F = 1") {
+            std::cerr << "Constant functions gave " << q0.min() << " and " << q1.min() << "\n";
+            --rtn;
+        }
+    }
+
+    // Random small functions: exact mode finds a smallest cover of primes
+    for (int vars = 2; vars <= 5; ++vars) {
+        for (int t = 0; t < 200; ++t) {
+            std::vector<char> on (1u << vars, 0);
+            morph::bn::Quine q (vars);
+            for (unsigned int m = 0; m < on.size(); ++m) {
+                if (rng() & 1) { on[m] = 1; q.addMinterm (m); }
+            }
+            q.go();
+            if (!cover_is_exact (q, on) || !cover_is_prime (q, on) || !q.optimal) {
+                std::cerr << vars << " vars: exact cover is wrong: " << q.min() << "\n";
+                --rtn;
+                break;
+            }
+            if (q.primes.size() <= 20 && q.cover.size() != brute_min (q, on)) {
+                std::cerr << vars << " vars: exact cover of " << q.cover.size() << " is not minimal\n";
+                --rtn;
+                break;
+            }
+            morph::bn::Quine h (vars, morph::bn::Quine::mode::heuristic);
+            h.minterms = q.minterms;
+            h.go();
+            if (!cover_is_exact (h, on) || !cover_is_prime (h, on) || h.cover.size() < q.cover.size()) {
+                std::cerr << vars << " vars: heuristic cover is wrong: " << h.min() << "\n";
+                --rtn;
+                break;
+            }
+        }
+    }
+
+    // Larger functions: both modes must be right, and the heuristic close to exact
+    using sc = std::chrono::steady_clock;
+    for (int vars : {8, 10}) {
+        std::vector<char> on (1u << vars, 0);
+        morph::bn::Quine q (vars);
+        morph::bn::Quine h (vars, morph::bn::Quine::mode::heuristic);
+        for (unsigned int m = 0; m < on.size(); ++m) {
+            // Mostly structured (like a gene network's logic), with some noise
+            bool v = ((m & 0x3) == 0x3) || ((m >> 2 & 0x5) == 0x4) || (rng() % 16 == 0);
+            if (v) { on[m] = 1; q.addMinterm (m); h.addMinterm (m); }
+        }
+        sc::time_point t0 = sc::now();
+        q.go();
+        sc::time_point t1 = sc::now();
+        h.go();
+        sc::time_point t2 = sc::now();
+        if (!cover_is_exact (q, on) || !cover_is_exact (h, on) || h.cover.size() < q.cover.size()
+            || h.cover.size() > q.cover.size() + q.cover.size() / 4 + 1) {
+            std::cerr << vars << " vars: exact " << q.cover.size() << ", heuristic " << h.cover.size() << "\n";
+            --rtn;
+        }
+        std::cout << vars << " vars: exact " << q.cover.size() << " terms from " << q.primes.size() << " primes in "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms; heuristic "
+                  << h.cover.size() << " terms in " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms\n";
+    }
+
+    // A dense random function of 10 inputs has a large cyclic core. The search stops at
+    // max_nodes with a cover that is correct, if perhaps not minimal.
+    {
+        const int vars = 10;
+        std::vector<char> on (1u << vars, 0);
+        morph::bn::Quine q (vars);
+        q.max_nodes = 200;
+        for (unsigned int m = 0; m < on.size(); ++m) {
+            if (rng() & 1) { on[m] = 1; q.addMinterm (m); }
+        }
+        q.go();
+        if (!cover_is_exact (q, on) || q.optimal) {
+            std::cerr << "Node-limited exact cover is wrong\n";
+            --rtn;
+        }
+    }
+
+    // The heuristic on a function of 16 inputs
+    {
+        const int vars = 16;
+        std::vector<char> on (1u << vars, 0);
+        morph::bn::Quine h (vars, morph::bn::Quine::mode::heuristic);
+        for (unsigned int m = 0; m < on.size(); ++m) {
+            bool v = ((m & 0x7) == 0x5) || ((m >> 4 & 0x33) == 0x21) || ((m >> 9) == 0x7f) || (rng() % 64 == 0);
+            if (v) { on[m] = 1; h.addMinterm (m); }
+        }
+        sc::time_point t0 = sc::now();
+        h.go();
+        sc::time_point t1 = sc::now();
+        if (!cover_is_exact (h, on) || !cover_is_prime (h, on)) {
+            std::cerr << "16 vars: heuristic cover is wrong\n";
+            --rtn;
+        }
+        std::cout << "16 vars: heuristic " << h.cover.size() << " terms in "
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+    }
+
+    try {
+        morph::bn::Quine q (4);
+        q.addMinterm (16);
+        std::cerr << "Expected an exception for an out of range minterm\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "testQuine " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
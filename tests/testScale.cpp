@@ -8,6 +8,7 @@ using std::array;
 #include <iostream>
 using std::cout;
 using std::endl;
+#include <span>
 #include "morph/scale.h"
 using morph::scale;
 #include <cmath>
@@ -259,6 +260,32 @@ int main () {
     std::cout << "input 8(int) transforms to float: " << sif.transform_one (8) << std::endl;
     if (sif.transform_one (8) != 4.5f) { --rtn; }
 
+    // The batch (span) and in-place transforms must match transform_one exactly, for linear and
+    // log scalings, including int to float
+    vector<float> big (10007);
+    for (unsigned int i = 0; i < big.size(); ++i) { big[i] = 0.5f + 0.013f * i; }
+    vector<float> bigout (big.size(), 0.0f);
+    for (int lg = 0; lg < 2; ++lg) {
+        scale<float> sb;
+        if (lg) { sb.setlog(); }
+        sb.do_autoscale = true;
+        sb.transform (std::span<const float>(big), std::span<float>(bigout));
+        vector<float> bigin (big);
+        sb.transform_inplace (bigin);
+        for (unsigned int i = 0; i < big.size(); ++i) {
+            if (bigout[i] != sb.transform_one (big[i]) || bigin[i] != bigout[i]) {
+                std::cout << "batch transform differs at " << i << std::endl;
+                --rtn;
+                break;
+            }
+        }
+        if (bigout.front() != 0.0f || std::abs (bigout.back() - 1.0f) > 1e-6f) { --rtn; }
+    }
+    vector<int> vib = { -10, -3, 0, 4, 8, 10 };
+    vector<float> vibout (vib.size());
+    sif.transform (vib, vibout);
+    for (unsigned int i = 0; i < vib.size(); ++i) { if (vibout[i] != sif.transform_one (vib[i])) { --rtn; } }
+
     std::cout << "testScale " << (rtn == 0 ? "Passed" : "Failed") << std::endl;
     return rtn;
 }
@@ -0,0 +1,51 @@
+/*
+ * Test that morph::Visual skips models that are outside the view frustum and counts
+ * them in Visual::render_counts.
+ */
+#include <morph/Visual.h>
+#include <morph/ScatterVisual.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <vector>
+#include <memory>
+
+int main()
+{
+    int rtn = -1;
+
+    morph::Visual v(1024, 768, "Frustum culling");
+
+    std::vector<morph::vec<float, 3>> points = { {0,0,0}, {0.2,0.1,0}, {0.4,0.3,0} };
+    std::vector<float> data = { 0.1f, 0.5f, 0.9f };
+
+    // Two models in view, one far off to the side
+    std::vector<morph::vec<float, 3>> offsets = { {0,0,0}, {-0.5,0,0}, {1000,0,0} };
+    morph::ScatterVisual<float>* hidden = nullptr;
+    for (auto off : offsets) {
+        auto sv = std::make_unique<morph::ScatterVisual<float>> (off);
+        v.bindmodel (sv);
+        sv->setDataCoords (&points);
+        sv->setScalarData (&data);
+        sv->finalize();
+        hidden = v.addVisualModel (sv);
+    }
+
+    v.render();
+    std::cout << "Drawn: " << v.render_counts.drawn << ", culled: " << v.render_counts.culled
+              << ", hidden: " << v.render_counts.hidden << std::endl;
+    if (v.render_counts.drawn == 2 && v.render_counts.culled == 1) { rtn = 0; }
+
+    // Hiding the far model takes it out of the culled count
+    hidden->setHide();
+    v.render();
+    if (v.render_counts.culled != 0 || v.render_counts.hidden != 1) { rtn = -1; }
+
+    // With culling off, the far model is drawn
+    hidden->setHide (false);
+    v.frustum_culling = false;
+    v.render();
+    if (v.render_counts.drawn != 3) { rtn = -1; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,234 @@
+/*
+ * Test the glTF layout of Visual::savegltf() and saveglb(): identical arrays are written once,
+ * repeated models share one mesh, a scene with no repeats keeps one accessor per array of each
+ * model in model order, EXT_mesh_gpu_instancing nodes get TRANSLATION accessors after those
+ * of the arrays, quantised GLB nodes of shared meshes land where their models are and
+ * VisualCompoundRay's node list counts its camera nodes.
+ */
+#include <morph/Visual.h>
+#include <morph/VisualCompoundRay.h>
+#include <morph/SphereVisual.h>
+#include <morph/RodVisual.h>
+#include <morph/TriangleVisual.h>
+#include <morph/base64.h>
+#include <morph/vec.h>
+#include <nlohmann/json.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <array>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <filesystem>
+
+// Finalize the model m, add it to v and return it
+template <typename V, typename M>
+morph::VisualModel<morph::gl::version_4_1>* add_model (V& v, std::unique_ptr<M> m)
+{
+    v.bindmodel (m);
+    m->finalize();
+    return v.addVisualModel (m);
+}
+
+// Add a triangle with corners at the origin, (1, 0, 0) and (0, 1, 0), so not centred on the origin, to v
+template <typename V>
+morph::VisualModel<morph::gl::version_4_1>* add_triangle (V& v, const morph::vec<float> offset, const std::array<float, 3> col)
+{
+    return add_model (v, std::make_unique<morph::TriangleVisual<>>(offset, morph::vec<float>{ 0, 0, 0 }, morph::vec<float>{ 1, 0, 0 },
+                                                                   morph::vec<float>{ 0, 1, 0 }, col));
+}
+
+// Add a sphere to v and return it
+template <typename V>
+morph::VisualModel<morph::gl::version_4_1>* add_sphere (V& v, const morph::vec<float> offset, const float r,
+                                                       const std::array<float, 3> col)
+{
+    return add_model (v, std::make_unique<morph::SphereVisual<>>(offset, r, col));
+}
+
+nlohmann::json read_json (const std::string& fname)
+{
+    std::ifstream f (fname);
+    return nlohmann::json::parse (f);
+}
+
+// Read a GLB file's JSON and binary chunks
+nlohmann::json read_glb (const std::string& fname, std::vector<char>& bin)
+{
+    std::ifstream f (fname, std::ios::binary);
+    std::vector<char> b ((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    auto get32 = [&b](const std::size_t at) { std::uint32_t v = 0; std::memcpy (&v, b.data() + at, 4); return v; };
+    const std::uint32_t jlen = get32 (12);
+    const std::uint32_t blen = get32 (20 + jlen);
+    bin.assign (b.begin() + 28 + jlen, b.begin() + 28 + jlen + blen);
+    return nlohmann::json::parse (std::string (b.data() + 20, jlen));
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Four triangles, of which 0, 1 and 3 are the same triangle in different places. Triangle 2
+    // is green; its mesh shares the indices, positions and normals of the others.
+    {
+        morph::Visual v (640, 480, "glTF layout");
+        const std::vector<morph::vec<float>> offsets = { { 0, 0, 0 }, { 2, 0, 0 }, { 0, 0, 0 }, { 0, 3, 1 } };
+        std::vector<morph::VisualModel<morph::gl::version_4_1>*> models;
+        for (unsigned int i = 0; i < 4; ++i) {
+            models.push_back (add_triangle (v, offsets[i], i == 2 ? std::array<float, 3>{ 0, 1, 0 } : std::array<float, 3>{ 1, 0, 0 }));
+        }
+
+        auto l = v.make_gltf_layout();
+        if (l.arrays.size() != 5u || l.meshes.size() != 2u || l.nodes.size() != 4u || l.n_instanced != 0u) {
+            std::cout << "Repeated models: " << l.arrays.size() << " arrays, " << l.meshes.size() << " meshes\n";
+            --rtn;
+        }
+        if (l.meshes.size() == 2u
+            && (l.meshes[0] != std::array<std::size_t, 4>{ 0, 1, 2, 3 } || l.meshes[1] != std::array<std::size_t, 4>{ 0, 1, 4, 3 })) {
+            std::cout << "Wrong arrays shared between the meshes\n";
+            --rtn;
+        }
+        if (l.mesh_models.size() != 2u || l.mesh_models[0] != std::vector<std::size_t>{ 0, 1, 3 }
+            || l.mesh_models[1] != std::vector<std::size_t>{ 2 }) {
+            std::cout << "Wrong models sharing the meshes\n";
+            --rtn;
+        }
+
+        v.savegltf ("./testVisGltf.gltf");
+        nlohmann::json j = read_json ("./testVisGltf.gltf");
+        if (j["accessors"].size() != 5u || j["bufferViews"].size() != 5u || j["buffers"].size() != 5u
+            || j["meshes"].size() != 2u || j["nodes"].size() != 4u) {
+            std::cout << "savegltf wrote " << j["accessors"].size() << " accessors, " << j["bufferViews"].size() << " bufferViews\n";
+            --rtn;
+        }
+        const std::array<int, 4> node_mesh = { 0, 0, 1, 0 };
+        for (unsigned int i = 0; i < 4; ++i) {
+            if (j["nodes"][i]["mesh"] != node_mesh[i]) { --rtn; }
+            if (j["nodes"][i]["translation"].get<std::vector<float>>() != std::vector<float>(offsets[i].begin(), offsets[i].end())) {
+                std::cout << "Node " << i << " is in the wrong place\n";
+                --rtn;
+            }
+        }
+
+        // In a quantised GLB, each node's translation and scale undo the quantisation of the
+        // positions that its mesh was written with (model 0's, for every node here)
+        std::vector<char> bin;
+        v.saveglb ("./testVisGltf.glb", true);
+        j = read_glb ("./testVisGltf.glb", bin);
+        const morph::vec<float> qc = models[0]->vpos_qcentre();
+        if (j["accessors"].size() != 5u || j["nodes"].size() != 4u || qc.length() < 0.1f) { --rtn; }
+        for (unsigned int i = 0; i < 4; ++i) {
+            const std::vector<float> nt = j["nodes"][i]["translation"];
+            const float s = j["nodes"][i]["scale"][0];
+            // The triangle's corner at the origin is quantised to -qc/s
+            const morph::vec<float> corner = { nt[0] - qc[0], nt[1] - qc[1], nt[2] - qc[2] };
+            if ((corner - offsets[i]).length() > 1e-5f || std::abs (s - models[0]->vpos_qscale()) > 1e-6f) {
+                std::cout << "Quantised node " << i << " is at " << corner << ", not " << offsets[i] << "\n";
+                --rtn;
+            }
+        }
+
+        // With instancing, models 0, 1 and 3 are one node whose translations are accessor 5
+        v.gltf_instancing = true;
+        l = v.make_gltf_layout();
+        if (l.nodes.size() != 2u || l.n_instanced != 1u || !l.nodes[0].instanced || l.nodes[1].instanced) {
+            std::cout << "Instanced layout has " << l.nodes.size() << " nodes\n";
+            --rtn;
+        }
+        v.savegltf ("./testVisGltf.gltf");
+        j = read_json ("./testVisGltf.gltf");
+        if (j["accessors"].size() != 6u || j["bufferViews"].size() != 6u || j["nodes"].size() != 2u
+            || j["extensionsRequired"][0] != "EXT_mesh_gpu_instancing") {
+            std::cout << "Instanced savegltf wrote " << j["accessors"].size() << " accessors\n";
+            --rtn;
+        }
+        if (j["nodes"][0]["extensions"]["EXT_mesh_gpu_instancing"]["attributes"]["TRANSLATION"] != 5
+            || j["accessors"][5]["count"] != 3 || j["bufferViews"][5].contains ("target")) {
+            std::cout << "Wrong TRANSLATION accessor\n";
+            --rtn;
+        }
+        const std::string uri = j["buffers"][5]["uri"];
+        const std::vector<std::uint8_t> tb = base64::decode (uri.substr (uri.find (',') + 1));
+        std::vector<float> t (tb.size() / sizeof (float));
+        std::memcpy (t.data(), tb.data(), tb.size());
+        const std::vector<float> expected = { 0, 0, 0, 2, 0, 0, 0, 3, 1 };
+        if (t != expected) { std::cout << "Wrong instance translations\n"; --rtn; }
+
+        // A quantised GLB scales each node, so the translations are in quantised units
+        v.saveglb ("./testVisGltf.glb", true);
+        j = read_glb ("./testVisGltf.glb", bin);
+        if (j["accessors"].size() != 6u || j["bufferViews"].size() != 6u) { --rtn; }
+        const std::size_t bv = j["accessors"][5]["bufferView"];
+        const std::size_t off = j["bufferViews"][bv]["byteOffset"];
+        std::vector<float> qt (9);
+        std::memcpy (qt.data(), bin.data() + off, 9 * sizeof (float));
+        const float s = j["nodes"][0]["scale"][0];
+        if (std::abs (s - models[0]->vpos_qscale()) > 1e-6f) { --rtn; }
+        for (unsigned int i = 0; i < 3; ++i) {
+            // The triangle's corner at the origin is quantised to -qc/s, and the node scales it with its instance translation
+            const morph::vec<float> centre = { s * qt[3*i] - qc[0], s * qt[3*i+1] - qc[1], s * qt[3*i+2] - qc[2] };
+            const morph::vec<float> want = offsets[i == 2 ? 3 : i];
+            if ((centre - want).length() > 1e-5f) {
+                std::cout << "Quantised instance " << i << " is at " << centre << ", not " << want << "\n";
+                --rtn;
+            }
+        }
+    }
+
+    // With no repeated arrays, model m's arrays are accessors 4m to 4m+3, as before sharing
+    {
+        morph::Visual v (640, 480, "glTF layout, no repeats");
+        add_sphere (v, { 0, 0, 0 }, 0.2f, { 1, 0, 0 });
+        add_model (v, std::make_unique<morph::RodVisual<>>(morph::vec<float>{ 1, 0, 0 }, morph::vec<float>{ 0, 0, 0 },
+                                                            morph::vec<float>{ 0, 1, 0 }, 0.05f, std::array<float, 3>{ 0, 1, 0 }));
+        add_model (v, std::make_unique<morph::TriangleVisual<>>(morph::vec<float>{ 2, 0, 0 }, morph::vec<float>{ 0, 0, 0 },
+                                                                 morph::vec<float>{ 1, 0, 0 }, morph::vec<float>{ 0, 1, 0 },
+                                                                 std::array<float, 3>{ 0, 0, 1 }));
+        v.gltf_instancing = true;
+        const auto l = v.make_gltf_layout();
+        if (l.arrays.size() != 12u || l.meshes.size() != 3u || l.n_instanced != 0u) { --rtn; }
+        v.savegltf ("./testVisGltf.gltf");
+        const nlohmann::json j = read_json ("./testVisGltf.gltf");
+        if (j["accessors"].size() != 12u || j["meshes"].size() != 3u || j.contains ("extensionsUsed")) { --rtn; }
+        for (unsigned int m = 0; m < 3; ++m) {
+            const std::array<std::size_t, 4> a = { 4 * m, 4 * m + 1, 4 * m + 2, 4 * m + 3 };
+            if (l.meshes[m] != a) { std::cout << "Accessors of model " << m << " renumbered\n"; --rtn; }
+            const auto& p = j["meshes"][m]["primitives"][0];
+            if (p["indices"] != a[0] || p["attributes"]["POSITION"] != a[1]
+                || p["attributes"]["COLOR_0"] != a[2] || p["attributes"]["NORMAL"] != a[3]) { --rtn; }
+            if (j["nodes"][m]["mesh"] != m) { --rtn; }
+        }
+    }
+
+    // VisualCompoundRay puts its four camera nodes first; the scene lists the root cameras, then the models
+    {
+        morph::VisualCompoundRay<> v (640, 480, "glTF layout, compound-ray");
+        add_sphere (v, { 0, 0, 0 }, 0.2f, { 1, 0, 0 });
+        add_sphere (v, { 1, 0, 0 }, 0.2f, { 1, 0, 0 });
+        add_sphere (v, { 2, 0, 0 }, 0.4f, { 1, 0, 0 });
+        v.savegltf ("./testVisGltf.gltf");
+        nlohmann::json j = read_json ("./testVisGltf.gltf");
+        if (j["scenes"][0]["nodes"].get<std::vector<int>>() != std::vector<int>{ 1, 3, 4, 5, 6 }
+            || j["nodes"].size() != 7u || j["nodes"][4]["mesh"] != 0 || j["nodes"][5]["mesh"] != 0 || j["nodes"][6]["mesh"] != 1) {
+            std::cout << "Wrong VisualCompoundRay nodes\n";
+            --rtn;
+        }
+        v.gltf_instancing = true;
+        v.savegltf ("./testVisGltf.gltf");
+        j = read_json ("./testVisGltf.gltf");
+        if (j["scenes"][0]["nodes"].get<std::vector<int>>() != std::vector<int>{ 1, 3, 4, 5 } || j["nodes"].size() != 6u
+            || j["nodes"][4]["extensions"]["EXT_mesh_gpu_instancing"]["attributes"]["TRANSLATION"] != 5) {
+            std::cout << "Wrong instanced VisualCompoundRay nodes\n";
+            --rtn;
+        }
+    }
+
+    std::filesystem::remove ("./testVisGltf.gltf");
+    std::filesystem::remove ("./testVisGltf.glb");
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,62 @@
+/*
+ * Test that HexGridVisuals of one HexGrid with share_geometry set upload their positions,
+ * normals and indices once between them, and that a model whose mesh differs keeps its own.
+ */
+#include <morph/Visual.h>
+#include <morph/HexGridVisual.h>
+#include <morph/HexGrid.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <memory>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::Visual v(1024, 768, "Shared geometry");
+
+    morph::HexGrid hg(0.02f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+
+    // Four flat fields of the same grid, and one with z from its data
+    std::vector<std::vector<float>> fields (5, std::vector<float>(hg.num()));
+    for (unsigned int f = 0; f < fields.size(); ++f) {
+        for (unsigned int i = 0; i < hg.num(); ++i) { fields[f][i] = std::sin ((f + 1) * 10.0f * hg.d_x[i]); }
+    }
+    std::vector<morph::HexGridVisual<float>*> models;
+    for (unsigned int f = 0; f < fields.size(); ++f) {
+        auto hgv = std::make_unique<morph::HexGridVisual<float>>(&hg, morph::vec<float>{ 1.5f * f, 0.0f, 0.0f });
+        v.bindmodel (hgv);
+        hgv->share_geometry = true;
+        if (f < 4) { hgv->zScale.setParams (0.0f, 0.0f); }
+        hgv->setScalarData (&fields[f]);
+        hgv->finalize();
+        models.push_back (v.addVisualModel (hgv));
+    }
+
+    v.render();
+
+    // The colours alone are 3 floats per hex
+    const std::size_t colour_bytes = 3u * sizeof(float) * hg.num();
+    for (unsigned int f = 0; f < models.size(); ++f) {
+        std::cout << "Model " << f << " uploaded " << models[f]->profile.upload_bytes << " bytes\n";
+    }
+    // The first flat model uploads the shared mesh, the next three only their colours
+    if (models[0]->profile.upload_bytes <= colour_bytes) { --rtn; }
+    for (unsigned int f = 1; f < 4; ++f) {
+        if (models[f]->profile.upload_bytes != colour_bytes) { --rtn; }
+    }
+    // The model with a different z has a different mesh, which it uploads itself
+    if (models[4]->profile.upload_bytes <= colour_bytes) { --rtn; }
+
+    // Updating the data of a flat model keeps it on the shared mesh
+    for (auto& d : fields[1]) { d = -d; }
+    models[1]->profile = {};
+    models[1]->updateData (&fields[1]);
+    if (models[1]->profile.upload_bytes != colour_bytes) { --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
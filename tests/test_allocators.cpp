@@ -0,0 +1,83 @@
+// Test the aligned and pooled allocators with vvec and the classes that use vvec
+
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <morph/vvec.h>
+#include <morph/allocators.h>
+#include <morph/bootstrap.h>
+#include <morph/Random.h>
+#include <morph/nn/FeedForwardNet.h>
+
+int main()
+{
+    int rtn = 0;
+
+    // aligned_allocator gives 64 byte aligned data
+    for (unsigned int n = 1; n < 100; n += 7) {
+        morph::vvec<float, morph::aligned_allocator<float>> a (n, 1.0f);
+        if (reinterpret_cast<std::uintptr_t>(a.data()) % 64 != 0) {
+            std::cerr << "aligned_allocator: data not 64 byte aligned for n = " << n << "\n";
+            --rtn;
+        }
+    }
+
+    // pool_allocator re-uses freed blocks
+    morph::block_pool::i().clear();
+    const float* first = nullptr;
+    {
+        morph::vvec<float, morph::pool_allocator<float>> t (1000, 2.0f);
+        first = t.data();
+        if (reinterpret_cast<std::uintptr_t>(first) % 64 != 0) { --rtn; }
+    }
+    if (morph::block_pool::i().cached() != 1) {
+        std::cerr << "pool_allocator: expected one cached block, got " << morph::block_pool::i().cached() << "\n";
+        --rtn;
+    }
+    {
+        morph::vvec<float, morph::pool_allocator<float>> t (900, 3.0f); // same size class
+        if (t.data() != first) {
+            std::cerr << "pool_allocator: block was not re-used\n";
+            --rtn;
+        }
+        if (morph::block_pool::i().cached() != 0) { --rtn; }
+    }
+    morph::block_pool::i().clear();
+    if (morph::block_pool::i().cached() != 0) { --rtn; }
+
+    // Arithmetic between vvecs with different allocators
+    morph::vvec<double, morph::aligned_allocator<double>> va = { 1.0, 2.0, 3.0 };
+    morph::vvec<double> vb = { 4.0, 5.0, 6.0 };
+    if (va.dot (vb) != 32.0) { std::cerr << "dot failed\n"; --rtn; }
+    morph::vvec<double, morph::aligned_allocator<double>> vsum = va + vb;
+    if (vsum != morph::vvec<double, morph::aligned_allocator<double>>{ 5.0, 7.0, 9.0 }) { std::cerr << "+ failed\n"; --rtn; }
+    auto vprod = va * vb;
+    if (vprod[2] != 18.0) { std::cerr << "* failed\n"; --rtn; }
+    va -= vb;
+    if (va[0] != -3.0) { std::cerr << "-= failed\n"; --rtn; }
+
+    // bootstrap with a pool_allocator for its resamples
+    morph::RandNormal<double, std::mt19937_64> rnorm (5, 1);
+    morph::vvec<double> nd;
+    nd.set_from (rnorm.get (1000));
+    double eom = morph::bootstrap<double, morph::pool_allocator<double>>::error_of_mean (nd, 256);
+    double expected = nd.std() / std::sqrt (nd.size());
+    std::cout << "Bootstrapped error of mean " << eom << " cf. " << expected << std::endl;
+    if (std::abs (eom - expected) > 0.2 * expected) {
+        std::cerr << "bootstrap with pool_allocator failed\n";
+        --rtn;
+    }
+
+    // A FeedForwardNet with aligned vvecs, fed from default vvecs
+    morph::nn::FeedForwardNet<float, morph::aligned_allocator<float>> ff ({2, 3, 1});
+    morph::vvec<float> in = { 0.5f, 0.25f };
+    morph::vvec<float> out = { 1.0f };
+    ff.setInput (in, out);
+    ff.feedforward();
+    float cost = ff.computeCost();
+    if (!std::isfinite (cost) || cost < 0.0f) { std::cerr << "FeedForwardNet cost " << cost << "\n"; --rtn; }
+    if (reinterpret_cast<std::uintptr_t>(ff.neurons.back().data()) % 64 != 0) { --rtn; }
+
+    std::cout << "test_allocators " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,58 @@
+/*
+ * Test morph::data_view over a std::vector, a span and a strided component of a vvec of vecs,
+ * and scaling a strided view with morph::scale.
+ */
+#include "morph/data_view.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include "morph/scale.h"
+#include <iostream>
+#include <vector>
+#include <span>
+
+int main()
+{
+    int rtn = 0;
+
+    // A view of a vector follows the vector when it is resized
+    std::vector<float> v = { 1.0f, 2.0f, 3.0f };
+    morph::data_view<float> dv (&v);
+    if (!dv.bound() || dv.size() != 3 || !dv.contiguous() || dv[2] != 3.0f) { --rtn; }
+    v.resize (1000, 4.0f);
+    if (dv.size() != 1000 || dv[999] != 4.0f || dv.data() != v.data()) { --rtn; }
+
+    // A view of nothing
+    morph::data_view<float> dn (static_cast<const std::vector<float>*>(nullptr));
+    if (dn.bound() || !dn.empty()) { --rtn; }
+
+    // A slice of a larger buffer
+    morph::data_view<float> ds (std::span<const float>(v).subspan (1, 5));
+    if (ds.size() != 5 || ds.data() != v.data() + 1 || ds.span().size() != 5) { --rtn; }
+
+    // One component of a vvec of vecs is strided
+    morph::vvec<morph::vec<float, 3>> vv (10);
+    for (unsigned int i = 0; i < vv.size(); ++i) { vv[i] = { float(i), 10.0f * i, 100.0f * i }; }
+    morph::data_view<float> dy = morph::data_view<float>::component (vv, 1);
+    if (dy.size() != 10 || dy.contiguous() || dy.get_stride() != 3) { --rtn; }
+    for (unsigned int i = 0; i < dy.size(); ++i) { if (dy[i] != 10.0f * i) { --rtn; } }
+
+    // Iteration
+    float sum = 0.0f;
+    for (auto y : dy) { sum += y; }
+    if (sum != 450.0f || dy.end() - dy.begin() != 10) { --rtn; }
+
+    bool threw = false;
+    try { [[maybe_unused]] auto sp = dy.span(); } catch (const std::runtime_error&) { threw = true; }
+    if (!threw) { --rtn; }
+
+    // A strided view can be autoscaled and transformed like a container
+    morph::scale<float> s;
+    s.do_autoscale = true;
+    std::vector<float> out (dy.size());
+    s.transform (dy, out);
+    if (out[0] != 0.0f || out[9] != 1.0f) { --rtn; }
+    for (unsigned int i = 1; i < out.size(); ++i) { if (!(out[i] > out[i-1])) { --rtn; } }
+
+    std::cout << "test_data_view " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
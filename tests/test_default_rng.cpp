@@ -0,0 +1,82 @@
+// Test morph::default_rng and the vvec::randomize/randomizeN/shuffle overloads that use it or
+// take a caller's generator
+
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <random>
+#include <morph/Random.h>
+#include <morph/vvec.h>
+
+int main()
+{
+    int rtn = 0;
+
+    // After seed(), the same calls give the same numbers
+    morph::vvec<float> a (1001);
+    morph::vvec<float> b (1001);
+    morph::vvec<double> na (2000);
+    morph::vvec<double> nb (2000);
+    morph::vvec<int> ia (50);
+    morph::vvec<int> ib (50);
+    morph::vvec<int> sa = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    morph::vvec<int> sb = sa;
+    morph::default_rng::seed (42);
+    a.randomize();
+    na.randomizeN (2.0, 0.5);
+    ia.randomize (-3, 3);
+    sa.shuffle();
+    morph::default_rng::seed (42);
+    b.randomize();
+    nb.randomizeN (2.0, 0.5);
+    ib.randomize (-3, 3);
+    sb.shuffle();
+    if (a != b || na != nb || ia != ib || sa != sb) {
+        std::cerr << "Reseeding did not repeat the sequence\n";
+        --rtn;
+    }
+    if (a.min() < 0.0f || a.max() >= 1.0f || std::abs (a.mean() - 0.5f) > 0.05f) {
+        std::cerr << "randomize() gave bad numbers: " << a.range() << " mean " << a.mean() << std::endl;
+        --rtn;
+    }
+    if (ia.min() < -3 || ia.max() > 3) { std::cerr << "randomize (-3, 3) out of range\n"; --rtn; }
+    if (std::abs (na.mean() - 2.0) > 0.05 || std::abs (na.std() - 0.5) > 0.05) {
+        std::cerr << "randomizeN gave mean " << na.mean() << " sd " << na.std() << std::endl;
+        --rtn;
+    }
+    if (sa.sum() != 55) { std::cerr << "shuffle lost elements\n"; --rtn; }
+
+    // The next call continues the sequence rather than repeating it
+    b.randomize();
+    if (a == b) { std::cerr << "Second randomize() repeated the first\n"; --rtn; }
+
+    // Another thread takes its own stream
+    morph::default_rng::seed (42);
+    a.randomize();
+    std::thread t ([&b]() { b.randomize(); });
+    t.join();
+    if (a == b) { std::cerr << "A second thread repeated the first thread's numbers\n"; --rtn; }
+
+    // Caller-owned generators, which repeat from a fixed seed
+    morph::RandUniform<float> ru1 (-1.0f, 1.0f, 7);
+    morph::RandUniform<float> ru2 (-1.0f, 1.0f, 7);
+    a.randomize (ru1);
+    b.randomize (ru2);
+    if (a != b || a.min() < -1.0f || a.max() >= 1.0f) { std::cerr << "randomize (RandUniform&) failed\n"; --rtn; }
+    morph::RandNormal<double, morph::philox4x32> rn (0.0, 1.0, 3);
+    na.randomize (rn);
+    if (std::abs (na.mean()) > 0.1) { std::cerr << "randomize (RandNormal&) mean " << na.mean() << std::endl; --rtn; }
+    morph::RandPoisson<int> rp (4, 11);
+    ia.randomize (rp);
+    if (ia.min() < 0) { std::cerr << "randomize (RandPoisson&) gave a negative\n"; --rtn; }
+    std::mt19937 g1 (5);
+    std::mt19937 g2 (5);
+    if (sa.shuffled (g1) != sa.shuffled (g2)) { std::cerr << "shuffled (g) not repeatable\n"; --rtn; }
+
+    morph::default_rng::seed_from_device();
+    a.randomize();
+    if (a.min() < 0.0f || a.max() >= 1.0f) { std::cerr << "randomize() after seed_from_device out of range\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,152 @@
+// Test ElmanNet's truncated backpropagation through time: the gradients against finite
+// differences, the batched sequences against single ones, and that the steady state doesn't
+// allocate.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <morph/nn/ElmanNet.h>
+#include <morph/vvec.h>
+#include <morph/Random.h>
+
+// Count the allocations made while counting is on, by replacing the global operator new. (gcc
+// can't see that the replaced operator delete matches it.)
+#if defined( __GNUC__ ) && !defined( __clang__ )
+# pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static bool counting = false;
+static std::size_t n_allocs = 0;
+void* operator new (std::size_t sz)
+{
+    if (counting) { ++n_allocs; }
+    if (void* p = std::malloc (sz == 0 ? 1 : sz)) { return p; }
+    throw std::bad_alloc();
+}
+void operator delete (void* p) noexcept { std::free (p); }
+void operator delete (void* p, std::size_t) noexcept { std::free (p); }
+
+using net_t = morph::nn::ElmanNet<double>;
+
+// The summed cost of running the sequence (ins, outs) from the start
+double sequence_cost (net_t& el, const std::vector<morph::vvec<double>>& ins, const std::vector<morph::vvec<double>>& outs)
+{
+    el.resetBPTT();
+    double c = 0.0;
+    for (std::size_t t = 0; t < ins.size(); ++t) { c += el.step (ins[t], outs[t]); }
+    return c;
+}
+
+int main()
+{
+    int rtn = 0;
+    const unsigned int K = 5;
+    morph::RandUniform<double> rng (0.0, 1.0, 7);
+
+    // Two hidden layers, so the errors go back through two context layers
+    net_t el ({3, 4, 3, 2});
+    std::vector<morph::vvec<double>> ins (K);
+    std::vector<morph::vvec<double>> outs (K);
+    for (unsigned int t = 0; t < K; ++t) { ins[t].set_from (rng.get (3)); outs[t].set_from (rng.get (2)); }
+
+    // BPTT gradients against finite differences of the summed cost over the window
+    el.setBPTT (K);
+    const double c1 = sequence_cost (el, ins, outs);
+    el.backprop_bptt();
+    std::vector<std::vector<morph::vvec<double>>> nw;
+    std::vector<morph::vvec<double>> nb;
+    for (auto& c : el.connections) { nw.push_back (c.nabla_ws); nb.push_back (c.nabla_b); }
+    const double h = 1e-6;
+    double maxerr = 0.0;
+    std::size_t ci = 0;
+    for (auto& c : el.connections) {
+        for (std::size_t i = 0; i < c.ws.size(); ++i) {
+            for (std::size_t k = 0; k < c.ws[i].size(); ++k) {
+                const double w0 = c.ws[i][k];
+                c.ws[i][k] = w0 + h;
+                const double cp = sequence_cost (el, ins, outs);
+                c.ws[i][k] = w0 - h;
+                const double cm = sequence_cost (el, ins, outs);
+                c.ws[i][k] = w0;
+                maxerr = std::max (maxerr, std::abs ((cp - cm) / (2.0 * h) - nw[ci][i][k]));
+            }
+        }
+        for (std::size_t j = 0; j < c.b.size(); ++j) {
+            const double b0 = c.b[j];
+            c.b[j] = b0 + h;
+            const double cp = sequence_cost (el, ins, outs);
+            c.b[j] = b0 - h;
+            const double cm = sequence_cost (el, ins, outs);
+            c.b[j] = b0;
+            maxerr = std::max (maxerr, std::abs ((cp - cm) / (2.0 * h) - nb[ci][j]));
+        }
+        ++ci;
+    }
+    if (maxerr > 1e-7) { std::cout << "BPTT gradients differ from finite differences by " << maxerr << "\n"; --rtn; }
+
+    // Two sequences in a batch give the mean of their gradients
+    std::vector<morph::vvec<double>> ins2 (K);
+    std::vector<morph::vvec<double>> outs2 (K);
+    for (unsigned int t = 0; t < K; ++t) { ins2[t].set_from (rng.get (3)); outs2[t].set_from (rng.get (2)); }
+    el.setBPTT (K);
+    const double c2 = sequence_cost (el, ins2, outs2);
+    el.backprop_bptt();
+    std::vector<std::vector<morph::vvec<double>>> nw2;
+    for (auto& c : el.connections) { nw2.push_back (c.nabla_ws); }
+    el.setBPTT (K, 2);
+    std::vector<morph::vvec<double>> insb (K);
+    std::vector<morph::vvec<double>> outsb (K);
+    for (unsigned int t = 0; t < K; ++t) {
+        // Interleave the two sequences, as the columns of (n x 2) matrices
+        insb[t].resize (6);
+        outsb[t].resize (4);
+        for (unsigned int k = 0; k < 3; ++k) { insb[t][2 * k] = ins[t][k]; insb[t][2 * k + 1] = ins2[t][k]; }
+        for (unsigned int k = 0; k < 2; ++k) { outsb[t][2 * k] = outs[t][k]; outsb[t][2 * k + 1] = outs2[t][k]; }
+    }
+    double cb = 0.0;
+    for (unsigned int t = 0; t < K; ++t) { cb += el.step (insb[t], outsb[t]); }
+    el.backprop_bptt();
+    double maxbatch = 0.0;
+    ci = 0;
+    for (auto& c : el.connections) {
+        for (std::size_t i = 0; i < c.ws.size(); ++i) {
+            maxbatch = std::max (maxbatch, (c.nabla_ws[i] - (nw[ci][i] + nw2[ci][i]) * 0.5).abs().max());
+        }
+        ++ci;
+    }
+    if (maxbatch > 1e-12 || std::abs (cb - 0.5 * (c1 + c2)) > 1e-12) {
+        std::cout << "batched BPTT differs from single sequences by " << maxbatch << "\n"; --rtn;
+    }
+
+    // Truncated BPTT training on a long sequence, with a window of 4: learn to output the
+    // input of two steps ago. After the first windows, nothing is allocated.
+    net_t ed ({1, 8, 1});
+    ed.setBPTT (4);
+    morph::RandUniform<double> bits (0.0, 1.0, 3);
+    morph::vvec<double> in (1, 0.0);
+    morph::vvec<double> out (1, 0.0);
+    std::vector<morph::vvec<double>> hist (3, morph::vvec<double>(1, 0.0));
+    double early = 0.0;
+    double late = 0.0;
+    const unsigned int n_steps = 40000;
+    for (unsigned int t = 0; t < n_steps; ++t) {
+        if (t == 400) { counting = true; }
+        in[0] = bits.get() > 0.5 ? 1.0 : 0.0;
+        hist[t % 3][0] = in[0];
+        out[0] = hist[(t + 1) % 3][0];
+        const double c = ed.step (in, out);
+        if (t < 2000) { early += c; }
+        if (t >= n_steps - 2000) { late += c; }
+        if ((t + 1) % 4 == 0) {
+            ed.backprop_bptt();
+            ed.sgd_step (0.5);
+        }
+    }
+    counting = false;
+    if (n_allocs != 0) { std::cout << "BPTT training made " << n_allocs << " allocations\n"; --rtn; }
+    if (!(late < 0.25 * early)) { std::cout << "BPTT didn't learn the delay: cost " << early << " then " << late << "\n"; --rtn; }
+
+    std::cout << "test_elman_bptt " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
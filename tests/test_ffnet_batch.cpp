@@ -0,0 +1,117 @@
+// Test that FeedForwardNet's mini-batch (GEMM) path gives the same outputs, cost and mean
+// gradients as the one-sample-at-a-time path.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/vvec.h>
+#include <morph/Random.h>
+
+int main()
+{
+    int rtn = 0;
+
+    constexpr unsigned int nb = 8;
+    morph::nn::FeedForwardNet<double> ff ({20, 15, 7});
+    morph::RandUniform<double> rng (0.0, 1.0, 99);
+    std::vector<morph::vvec<double>> ins (nb);
+    std::vector<morph::vvec<double>> outs (nb);
+    for (unsigned int s = 0; s < nb; ++s) {
+        ins[s].set_from (rng.get (20));
+        outs[s].resize (7, 0.0);
+        outs[s][s % 7] = 1.0;
+    }
+
+    // One sample at a time, accumulating the mean gradients
+    std::vector<morph::vvec<double>> mean_nw;
+    std::vector<morph::vvec<double>> mean_nb;
+    for (auto& c : ff.connections) {
+        mean_nw.emplace_back (c.nabla_ws[0].size(), 0.0);
+        mean_nb.emplace_back (c.nabla_b.size(), 0.0);
+    }
+    double cost = 0.0;
+    std::vector<morph::vvec<double>> results (nb);
+    for (unsigned int s = 0; s < nb; ++s) {
+        ff.setInput (ins[s], outs[s]);
+        ff.feedforward();
+        cost += ff.computeCost();
+        ff.backprop();
+        results[s] = ff.neurons.back();
+        unsigned int i = 0;
+        for (auto& c : ff.connections) {
+            mean_nw[i] += c.nabla_ws[0] / static_cast<double>(nb);
+            mean_nb[i] += c.nabla_b / static_cast<double>(nb);
+            ++i;
+        }
+    }
+    cost /= nb;
+
+    // The batch path
+    ff.setBatchSize (nb);
+    ff.setBatchInput (ins, outs);
+    ff.feedforward_batch();
+    double cost_b = ff.computeCost_batch();
+    ff.backprop_batch();
+
+    if (std::abs (cost - cost_b) > 1e-12) {
+        std::cerr << "Batch cost " << cost_b << " differs from " << cost << "\n";
+        --rtn;
+    }
+    const morph::vvec<double>& out_b = ff.neurons_b.back();
+    for (unsigned int s = 0; s < nb; ++s) {
+        for (unsigned int j = 0; j < 7; ++j) {
+            if (std::abs (out_b[j * nb + s] - results[s][j]) > 1e-12) { --rtn; }
+        }
+    }
+    unsigned int i = 0;
+    for (auto& c : ff.connections) {
+        if ((c.nabla_ws[0] - mean_nw[i]).abs().max() > 1e-12 || (c.nabla_b - mean_nb[i]).abs().max() > 1e-12) {
+            std::cerr << "Batch gradients differ for connection " << i << "\n";
+            --rtn;
+        }
+        ++i;
+    }
+
+    // A gradient descent step with the mean gradients should reduce the cost
+    ff.sgd_step (0.5);
+    ff.feedforward_batch();
+    double cost_after = ff.computeCost_batch();
+    if (!(cost_after < cost_b)) {
+        std::cerr << "sgd_step did not reduce the cost (" << cost_b << " -> " << cost_after << ")\n";
+        --rtn;
+    }
+
+    // Time an MNIST-sized net both ways
+    constexpr unsigned int nbm = 64;
+    morph::nn::FeedForwardNet<float> ffm ({784, 30, 10});
+    morph::RandUniform<float> frng (0.0f, 1.0f, 7);
+    std::vector<morph::vvec<float>> mins (nbm);
+    std::vector<morph::vvec<float>> mouts (nbm, morph::vvec<float>(10, 0.0f));
+    for (unsigned int s = 0; s < nbm; ++s) { mins[s].set_from (frng.get (784)); mouts[s][s % 10] = 1.0f; }
+    auto t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < 10; ++rep) {
+        for (unsigned int s = 0; s < nbm; ++s) {
+            ffm.setInput (mins[s], mouts[s]);
+            ffm.feedforward();
+            ffm.computeCost();
+            ffm.backprop();
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    ffm.setBatchSize (nbm);
+    for (int rep = 0; rep < 10; ++rep) {
+        ffm.setBatchInput (mins, mouts);
+        ffm.feedforward_batch();
+        ffm.computeCost_batch();
+        ffm.backprop_batch();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    std::cout << "784-30-10, 10 batches of " << nbm << ": per-sample "
+              << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us, batch "
+              << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us\n";
+
+    std::cout << "test_ffnet_batch " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,113 @@
+// Test FeedForwardNet::train_parallel in its data-parallel and Hogwild modes
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/vvec.h>
+#include <morph/Random.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+// Copy the weights and biases of one net into another of the same shape
+template <typename Net>
+void copy_net (const Net& from, Net& to)
+{
+    auto fi = from.connections.begin();
+    for (auto& c : to.connections) {
+        c.ws = fi->ws;
+        c.b = fi->b;
+        ++fi;
+    }
+}
+
+template <typename Net>
+double max_weight_diff (const Net& a, const Net& b)
+{
+    double d = 0.0;
+    auto bi = b.connections.begin();
+    for (auto& c : a.connections) {
+        d = std::max (d, static_cast<double>((c.ws[0] - bi->ws[0]).abs().max()));
+        d = std::max (d, static_cast<double>((c.b - bi->b).abs().max()));
+        ++bi;
+    }
+    return d;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // A toy classification problem: 16 inputs, whose first half or second half has the larger
+    // sum, to be mapped to one of 2 outputs.
+    morph::RandUniform<double> rng (0.0, 1.0, 5);
+    const unsigned int ns = 1000;
+    std::vector<morph::vvec<double>> ins (ns);
+    std::vector<morph::vvec<double>> outs (ns, morph::vvec<double>(2, 0.0));
+    for (unsigned int s = 0; s < ns; ++s) {
+        ins[s].set_from (rng.get (16));
+        double lo = 0.0, hi = 0.0;
+        for (unsigned int i = 0; i < 8; ++i) { lo += ins[s][i]; hi += ins[s][i + 8]; }
+        outs[s][lo > hi ? 0 : 1] = 1.0;
+    }
+
+    const unsigned int nb = 20;
+    const double eta = 2.0;
+
+    // Reference: the serial batch path, batch by batch
+    morph::nn::FeedForwardNet<double> ref ({16, 12, 2});
+    morph::nn::FeedForwardNet<double> dp ({16, 12, 2});
+    copy_net (ref, dp);
+    ref.setBatchSize (nb);
+    for (unsigned int b0 = 0; b0 < ns; b0 += nb) {
+        ref.setBatchInput (ins.data() + b0, outs.data() + b0);
+        ref.feedforward_batch();
+        ref.computeCost_batch();
+        ref.backprop_batch();
+        ref.sgd_step (eta);
+    }
+
+    // Data-parallel, with 3 threads where possible; should match the reference to rounding
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
+    omp_set_num_threads (3);
+#endif
+    double cost0 = dp.train_parallel (ins, outs, nb, eta);
+#ifdef _OPENMP
+    omp_set_num_threads (nthreads);
+#endif
+    double d = max_weight_diff (ref, dp);
+    std::cout << "Data-parallel epoch: cost " << cost0 << ", max weight difference from serial: " << d << "\n";
+    if (d > 1e-10) {
+        std::cerr << "Data-parallel training differs from the serial batch path\n";
+        --rtn;
+    }
+
+    // Further epochs should reduce the cost
+    double cost = cost0;
+    for (int ep = 0; ep < 20; ++ep) { cost = dp.train_parallel (ins, outs, nb, eta); }
+    std::cout << "Data-parallel cost after 21 epochs: " << cost << "\n";
+    if (!(cost < 0.5 * cost0)) {
+        std::cerr << "Data-parallel training did not reduce the cost\n";
+        --rtn;
+    }
+
+    // A final partial batch (1000 is not a multiple of 33) works
+    double cost_pb = dp.train_parallel (ins, outs, 33, eta);
+    if (!std::isfinite (cost_pb)) { --rtn; }
+
+    // Hogwild
+    morph::nn::FeedForwardNet<double> hw ({16, 12, 2});
+    double hcost0 = hw.train_parallel (ins, outs, nb, eta, true);
+    double hcost = hcost0;
+    for (int ep = 0; ep < 20; ++ep) { hcost = hw.train_parallel (ins, outs, nb, eta, true); }
+    std::cout << "Hogwild cost: " << hcost0 << " -> " << hcost << "\n";
+    if (!(hcost < 0.5 * hcost0)) {
+        std::cerr << "Hogwild training did not reduce the cost\n";
+        --rtn;
+    }
+
+    std::cout << "test_ffnet_parallel " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
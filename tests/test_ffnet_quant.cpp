@@ -0,0 +1,105 @@
+// Test FeedForwardNetQ, the int8 and fp16 quantised inference network, against the float
+// FeedForwardNet that it was made from, and test the fp16 conversions.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/nn/FeedForwardNetQ.h>
+#include <morph/nn/transfer.h>
+#include <morph/vvec.h>
+#include <morph/Random.h>
+
+int test_fp16()
+{
+    int rtn = 0;
+    namespace h = morph::nn::fp16;
+    // Exactly representable values round trip
+    for (float x : { 0.0f, -0.0f, 1.0f, -2.5f, 65504.0f, 0.000061035156f, 5.9604645e-8f, 1.0009765625f }) {
+        if (h::to_float (h::from_float (x)) != x || std::signbit (h::to_float (h::from_float (x))) != std::signbit (x)) {
+            std::cout << "fp16 round trip of " << x << " failed: " << h::to_float (h::from_float (x)) << "\n"; --rtn;
+        }
+    }
+    if (h::from_float (1.0f) != 0x3c00u || h::from_float (-2.0f) != 0xc000u) { std::cout << "fp16 bits wrong\n"; --rtn; }
+    // Ties round to even: 1 + 2^-11 lies halfway between 1 and 1 + 2^-10
+    if (h::from_float (1.0f + std::ldexp (1.0f, -11)) != 0x3c00u) { std::cout << "fp16 tie not to even\n"; --rtn; }
+    if (h::from_float (1.0f + 3.0f * std::ldexp (1.0f, -11)) != 0x3c02u) { std::cout << "fp16 tie (odd) not to even\n"; --rtn; }
+    // Overflow, infinity and NaN
+    if (h::to_float (h::from_float (1e6f)) != std::numeric_limits<float>::infinity()) { std::cout << "fp16 overflow wrong\n"; --rtn; }
+    if (!std::isnan (h::to_float (h::from_float (std::numeric_limits<float>::quiet_NaN())))) { std::cout << "fp16 NaN wrong\n"; --rtn; }
+    // Every half converts to float and back to itself (apart from the NaNs, which stay NaN)
+    for (std::uint32_t b = 0; b < 0x10000u; ++b) {
+        const std::uint16_t hb = static_cast<std::uint16_t>(b);
+        const float f = h::to_float (hb);
+        if (std::isnan (f) ? (hb & 0x7c00u) != 0x7c00u : h::from_float (f) != hb) {
+            std::cout << "fp16 bits " << b << " don't round trip\n"; --rtn; break;
+        }
+    }
+    // Relative rounding error of normal halves is at most 2^-11
+    morph::RandUniform<float> rng (-100.0f, 100.0f, 3);
+    float maxrel = 0.0f;
+    for (float x : rng.get (10000)) { maxrel = std::max (maxrel, std::abs (h::to_float (h::from_float (x)) - x) / std::abs (x)); }
+    if (maxrel > std::ldexp (1.0f, -11)) { std::cout << "fp16 rounding error " << maxrel << " too large\n"; --rtn; }
+    return rtn;
+}
+
+template <typename T, typename Tf>
+int test_net (const char* name)
+{
+    int rtn = 0;
+    morph::nn::FeedForwardNet<T, std::allocator<T>, Tf> ff ({64, 32, 16, 10});
+    // Weights scaled as by a typical initialisation, N(0, 1/m)
+    for (auto& c : ff.connections) { c.ws[0] /= std::sqrt (static_cast<T>(c.ins[0]->size())); }
+    morph::RandUniform<T> rng (T{0}, T{1}, 17);
+    std::vector<morph::vvec<T>> inputs (50);
+    for (auto& in : inputs) { in.set_from (rng.get (64)); }
+
+    morph::nn::FeedForwardNetQ<T, Tf> q8 (ff);
+    morph::nn::FeedForwardNetQ<T, Tf> q16 (ff, morph::nn::quantisation::fp16);
+    if (q8.n_in != 64 || q8.n_out != 10 || q8.layers.size() != 3) { std::cout << name << ": wrong sizes\n"; --rtn; }
+    const std::size_t n_w = 64 * 32 + 32 * 16 + 16 * 10;
+    if (q8.weight_bytes() != n_w + (32 + 16 + 10) * sizeof (T) || q16.weight_bytes() != 2 * n_w) {
+        std::cout << name << ": weight_bytes wrong\n"; --rtn;
+    }
+
+    T err8 = T{0};
+    T err16 = T{0};
+    for (const auto& in : inputs) {
+        ff.neurons.front() = in;
+        ff.feedforward();
+        const morph::vvec<T>& ref = ff.neurons.back();
+        err8 = std::max (err8, (q8.compute (in) - ref).abs().max());
+        err16 = std::max (err16, (q16.compute (in) - ref).abs().max());
+    }
+    // The int8 error is a few quantisation steps through the layers; fp16 is much closer
+    if (err8 > T{0.03} || err16 > T{2e-3}) {
+        std::cout << name << ": quantised output differs from float by " << err8 << " (int8), " << err16 << " (fp16)\n"; --rtn;
+    }
+
+    // The raw pointer interface gives the same result
+    morph::vvec<T> out (10, T{0});
+    q8.compute (inputs[0].data(), out.data());
+    if (out != q8.compute (inputs[0])) { std::cout << name << ": pointer compute differs\n"; --rtn; }
+
+    // The wrong input size is an error
+    try {
+        morph::vvec<T> bad (5, T{0});
+        q8.compute (bad);
+        std::cout << name << ": expected an exception\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = test_fp16();
+    rtn += test_net<float, morph::nn::sigmoid<float>> ("sigmoid float");
+    rtn += test_net<double, morph::nn::sigmoid<double>> ("sigmoid double");
+    rtn += test_net<float, morph::nn::tanh<float>> ("tanh float");
+    rtn += test_net<float, morph::nn::relu<float>> ("relu float");
+    std::cout << "test_ffnet_quant " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
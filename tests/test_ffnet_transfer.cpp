@@ -0,0 +1,123 @@
+// Test the FeedForwardNet transfer function policies: check the backprop gradients against
+// finite differences for each, and check that the training loops do not allocate.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <morph/nn/FeedForwardNet.h>
+#include <morph/nn/transfer.h>
+#include <morph/vvec.h>
+#include <morph/Random.h>
+
+// An allocator that counts its allocations while counting is on
+static bool counting = false;
+static std::size_t n_allocs = 0;
+template <typename T>
+struct counting_allocator
+{
+    using value_type = T;
+    counting_allocator() noexcept = default;
+    template <typename U>
+    counting_allocator (const counting_allocator<U>&) noexcept {}
+    T* allocate (const std::size_t n)
+    {
+        if (counting) { ++n_allocs; }
+        return std::allocator<T>().allocate (n);
+    }
+    void deallocate (T* p, const std::size_t n) noexcept { std::allocator<T>().deallocate (p, n); }
+    template <typename U>
+    bool operator== (const counting_allocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!= (const counting_allocator<U>&) const noexcept { return false; }
+};
+
+template <typename Tf>
+int gradient_check (const char* name)
+{
+    int rtn = 0;
+    morph::nn::FeedForwardNet<double, std::allocator<double>, Tf> ff ({5, 4, 3});
+    // Small weights so that no unit saturates and (for relu) the signs of the z don't change
+    morph::RandUniform<double> rng (-0.5, 0.5, 11);
+    for (auto& c : ff.connections) {
+        c.ws[0].set_from (rng.get (c.ws[0].size()));
+        c.b.set_from (rng.get (c.b.size()));
+        c.b += 0.3; // keeps relu units active
+    }
+    morph::vvec<double> in = { 0.9, 0.2, 0.5, 0.7, 0.1 };
+    morph::vvec<double> out = { 0.2, 0.8, 0.4 };
+    ff.setInput (in, out);
+    ff.feedforward();
+    ff.computeCost();
+    ff.backprop();
+
+    const double h = 1e-6;
+    double maxerr = 0.0;
+    for (auto& c : ff.connections) {
+        for (std::size_t k = 0; k < c.ws[0].size(); ++k) {
+            const double w0 = c.ws[0][k];
+            c.ws[0][k] = w0 + h;
+            ff.feedforward();
+            const double cp = ff.computeCost();
+            c.ws[0][k] = w0 - h;
+            ff.feedforward();
+            const double cm = ff.computeCost();
+            c.ws[0][k] = w0;
+            maxerr = std::max (maxerr, std::abs ((cp - cm) / (2.0 * h) - c.nabla_ws[0][k]));
+        }
+    }
+    std::cout << name << ": max |numerical - backprop| gradient = " << maxerr << "\n";
+    if (maxerr > 1e-7) {
+        std::cerr << name << ": backprop gradient does not match finite differences\n";
+        --rtn;
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    rtn += gradient_check<morph::nn::sigmoid<double>> ("sigmoid");
+    rtn += gradient_check<morph::nn::tanh<double>> ("tanh");
+    rtn += gradient_check<morph::nn::relu<double>> ("relu");
+    rtn += gradient_check<morph::nn::fast_sigmoid<double>> ("fast_sigmoid");
+
+    // Transfer function values
+    if (std::abs (morph::nn::fast_sigmoid<float>::f (0.0f) - 0.5f) > 1e-7f
+        || morph::nn::fast_sigmoid<float>::f (-100.0f) < 0.0f || morph::nn::fast_sigmoid<float>::f (100.0f) > 1.0f) {
+        std::cerr << "fast_sigmoid has the wrong range\n";
+        --rtn;
+    }
+
+    // The steady state per-sample and batch training loops should make no vvec allocations
+    morph::nn::FeedForwardNet<float, counting_allocator<float>> ff ({20, 10, 4});
+    morph::vvec<float> in (20, 0.3f);
+    morph::vvec<float> out (4, 0.0f);
+    out[1] = 1.0f;
+    ff.setInput (in, out);
+    ff.setBatchSize (5);
+    std::vector<morph::vvec<float>> bins (5, in);
+    std::vector<morph::vvec<float>> bouts (5, out);
+    counting = true;
+    for (int i = 0; i < 10; ++i) {
+        ff.setInput (in, out);
+        ff.feedforward();
+        ff.computeCost();
+        ff.backprop();
+        ff.setBatchInput (bins, bouts);
+        ff.feedforward_batch();
+        ff.computeCost_batch();
+        ff.backprop_batch();
+        ff.sgd_step (0.1f);
+    }
+    counting = false;
+    std::cout << "Heap allocations in the training loop: " << n_allocs << "\n";
+    if (n_allocs != 0) {
+        std::cerr << "The training loop allocated memory\n";
+        --rtn;
+    }
+
+    std::cout << "test_ffnet_transfer " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
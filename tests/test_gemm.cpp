@@ -0,0 +1,67 @@
+// Test morph::gemm against a naive triple loop, for each combination of transposes
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <morph/gemm.h>
+#include <morph/Random.h>
+
+template <typename T>
+int check (const std::size_t M, const std::size_t N, const std::size_t K, bool tA, bool tB, T alpha, T beta)
+{
+    morph::RandUniform<T> rng (T{-1}, T{1}, 1234);
+    // Stored shapes (with some row padding, to test the leading dimensions)
+    const std::size_t lda = (tA ? M : K) + 3;
+    const std::size_t ldb = (tB ? K : N) + 1;
+    const std::size_t ldc = N + 2;
+    std::vector<T> A = rng.get ((tA ? K : M) * lda);
+    std::vector<T> B = rng.get ((tB ? N : K) * ldb);
+    std::vector<T> C = rng.get (M * ldc);
+    std::vector<T> Cref = C;
+
+    for (std::size_t i = 0; i < M; ++i) {
+        for (std::size_t j = 0; j < N; ++j) {
+            T s = T{0};
+            for (std::size_t k = 0; k < K; ++k) {
+                const T a = tA ? A[k * lda + i] : A[i * lda + k];
+                const T b = tB ? B[j * ldb + k] : B[k * ldb + j];
+                s += a * b;
+            }
+            Cref[i * ldc + j] = alpha * s + (beta == T{0} ? T{0} : beta * Cref[i * ldc + j]);
+        }
+    }
+    morph::gemm<T>::compute (tA, tB, M, N, K, alpha, A.data(), lda, B.data(), ldb, beta, C.data(), ldc);
+
+    T maxerr = T{0};
+    for (std::size_t i = 0; i < M; ++i) {
+        for (std::size_t j = 0; j < N; ++j) {
+            maxerr = std::max (maxerr, std::abs (C[i * ldc + j] - Cref[i * ldc + j]));
+        }
+    }
+    const T tol = std::is_same<T, float>::value ? T{1e-4} * K : T{1e-12} * K;
+    if (maxerr > tol) {
+        std::cerr << "gemm " << M << "x" << N << "x" << K << " tA=" << tA << " tB=" << tB
+                  << " alpha=" << alpha << " beta=" << beta << ": max error " << maxerr << "\n";
+        return -1;
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+    for (bool tA : { false, true }) {
+        for (bool tB : { false, true }) {
+            rtn += check<float> (1, 1, 1, tA, tB, 1.0f, 0.0f);
+            rtn += check<float> (7, 5, 3, tA, tB, 2.0f, 0.5f);
+            rtn += check<double> (130, 70, 300, tA, tB, 1.0, 1.0);
+            rtn += check<double> (65, 600, 257, tA, tB, -0.5, 0.0);
+            rtn += check<float> (200, 64, 784, tA, tB, 1.0f, 0.0f);
+        }
+    }
+    // K = 0 just scales C
+    rtn += check<double> (4, 4, 0, false, false, 1.0, 3.0);
+
+    std::cout << "test_gemm " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,105 @@
+/*
+ * Test morph::glyph_atlas packing and persistence, and the process-wide morph::glyph_cache.
+ */
+#include <morph/glyph_cache.h>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+
+// A fake glyph bitmap of w x h pixels with a pitch of w + 1 bytes. Pixel (x, y) has value code + x + y.
+std::vector<unsigned char> fake_bitmap (char32_t code, unsigned int w, unsigned int h)
+{
+    std::vector<unsigned char> bm ((w + 1) * h, 0);
+    for (unsigned int y = 0; y < h; ++y) {
+        for (unsigned int x = 0; x < w; ++x) { bm[y * (w + 1) + x] = static_cast<unsigned char>(code + x + y); }
+    }
+    return bm;
+}
+
+// A small atlas with pages of 32 pixels, so that the glyphs need several pages
+morph::glyph_atlas make_atlas (unsigned int& calls)
+{
+    ++calls;
+    morph::glyph_atlas a (32);
+    for (char32_t c = 'a'; c <= 'z'; ++c) {
+        unsigned int w = 3 + c % 5;
+        unsigned int h = 4 + c % 7;
+        std::vector<unsigned char> bm = fake_bitmap (c, w, h);
+        a.add (c, bm.data(), w, h, static_cast<int>(w + 1), {1, static_cast<int>(h)}, 64 * (w + 1));
+    }
+    a.finish();
+    return a;
+}
+
+// Check that each glyph's pixels are where its uv says they are
+int check_atlas (const morph::glyph_atlas& a)
+{
+    int rtn = 0;
+    if (a.glyphs.size() != 26) { --rtn; }
+    for (const auto& g : a.glyphs) {
+        const morph::glyph_atlas::glyph& gl = g.second;
+        if (gl.page >= a.pages.size()) { --rtn; continue; }
+        const unsigned int ph = a.page_heights[gl.page];
+        if (a.pages[gl.page].size() != a.page_size * ph) { --rtn; }
+        int x0 = static_cast<int>(gl.uv[0] * a.page_size + 0.5f);
+        int y0 = static_cast<int>(gl.uv[1] * ph + 0.5f);
+        int x1 = static_cast<int>(gl.uv[2] * a.page_size + 0.5f);
+        int y1 = static_cast<int>(gl.uv[3] * ph + 0.5f);
+        if (x1 - x0 != gl.size[0] || y1 - y0 != gl.size[1]) { --rtn; continue; }
+        for (int y = 0; y < gl.size[1]; ++y) {
+            for (int x = 0; x < gl.size[0]; ++x) {
+                if (a.pages[gl.page][(y0 + y) * a.page_size + x0 + x] != static_cast<unsigned char>(g.first + x + y)) { --rtn; }
+            }
+        }
+        if (gl.advance != 64 * static_cast<unsigned int>(gl.size[0] + 1)) { --rtn; }
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    unsigned int calls = 0;
+    morph::glyph_atlas a = make_atlas (calls);
+    if (a.pages.size() < 2) {
+        std::cout << "Expected the glyphs to need more than one page\n";
+        --rtn;
+    }
+    rtn += check_atlas (a);
+
+    // Save and load
+    const std::string path = "../test_glyph_cache.bin";
+    if (!a.save (path, 1234)) { --rtn; }
+    morph::glyph_atlas b;
+    if (!b.load (path, 1234)) { --rtn; }
+    rtn += check_atlas (b);
+    if (b.pages != a.pages || b.page_size != a.page_size) { --rtn; }
+    // A different tag means a different font, so the file must not be used
+    morph::glyph_atlas c;
+    if (c.load (path, 4321)) { --rtn; }
+    if (!c.glyphs.empty()) { --rtn; }
+
+    // The cache builds each atlas once
+    morph::glyph_cache& gc = morph::glyph_cache::i();
+    gc.cache_dir = "..";
+    std::remove (gc.filename (morph::VisualFont::Vera, 24, 32).c_str());
+    std::remove (gc.filename (morph::VisualFont::Vera, 48, 32).c_str());
+    auto build = [&calls]() { return make_atlas (calls); };
+    calls = 0;
+    auto a1 = gc.get (morph::VisualFont::Vera, 24, 32, 99, build);
+    auto a2 = gc.get (morph::VisualFont::Vera, 24, 32, 99, build);
+    if (calls != 1 || a1 != a2) { --rtn; }
+    rtn += check_atlas (*a1);
+    // A different size is a different atlas
+    auto a3 = gc.get (morph::VisualFont::Vera, 48, 32, 99, build);
+    if (calls != 2 || a3 == a1) { --rtn; }
+    // After clearing memory, the atlas comes from the file in cache_dir, not from build
+    gc.clear();
+    auto a4 = gc.get (morph::VisualFont::Vera, 24, 32, 99, build);
+    if (calls != 2) { --rtn; }
+    rtn += check_atlas (*a4);
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
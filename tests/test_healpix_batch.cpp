@@ -0,0 +1,133 @@
+// Test the batch HEALPix conversions in healpix_bare.hpp against the scalar ones, and test
+// the neighbours.
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <morph/healpix/healpix_bare.hpp>
+#include <morph/mathconst.h>
+#include <morph/Random.h>
+
+// The difference between two azimuths, wrapped into [-pi, pi)
+double dphi (double a, double b)
+{
+    constexpr double twopi = morph::mathconst<double>::two_pi;
+    double d = std::fmod (a - b, twopi);
+    if (d >= morph::mathconst<double>::pi) { d -= twopi; }
+    if (d < -morph::mathconst<double>::pi) { d += twopi; }
+    return d;
+}
+
+int test_nside (int64_t nside)
+{
+    int rtn = 0;
+    const int64_t npix = hp::nside2npix (nside);
+    const hp::ring_table rt (nside);
+    std::vector<int64_t> pix (npix);
+    std::iota (pix.begin(), pix.end(), int64_t{0});
+
+    // nest <-> ring
+    std::vector<int64_t> ring (npix);
+    std::vector<int64_t> nest (npix);
+    hp::nest2ring (rt, pix, ring);
+    hp::ring2nest (rt, pix, nest);
+    for (int64_t p = 0; p < npix; ++p) {
+        if (ring[p] != hp::nest2ring (nside, p) || nest[p] != hp::ring2nest (nside, p)) {
+            std::cout << "nside " << nside << ": batch nest/ring conversion of " << p << " differs\n"; --rtn; break;
+        }
+    }
+
+    // pix -> ang and pix -> vec
+    std::vector<hp::t_ang> angr (npix);
+    std::vector<hp::t_ang> angn (npix);
+    std::vector<hp::t_vec> vecn (npix);
+    std::vector<hp::t_vec> vecr (npix);
+    hp::ring2ang (rt, pix, angr);
+    hp::nest2ang (rt, pix, angn);
+    hp::ring2vec (rt, pix, vecr);
+    hp::nest2vec (rt, pix, vecn);
+    double maxerr = 0.0;
+    for (int64_t p = 0; p < npix; ++p) {
+        const hp::t_ang ar = hp::ring2ang (nside, p);
+        const hp::t_ang an = hp::nest2ang (nside, p);
+        maxerr = std::max (maxerr, std::abs (angr[p].theta - ar.theta));
+        maxerr = std::max (maxerr, std::abs (angn[p].theta - an.theta));
+        maxerr = std::max (maxerr, std::abs (dphi (angr[p].phi, ar.phi)));
+        maxerr = std::max (maxerr, std::abs (dphi (angn[p].phi, an.phi)));
+        const hp::t_vec v = hp::nest2vec (nside, p);
+        const hp::t_vec w = hp::ring2vec (nside, p);
+        maxerr = std::max ({ maxerr, std::abs (vecn[p].x - v.x), std::abs (vecn[p].y - v.y), std::abs (vecn[p].z - v.z) });
+        maxerr = std::max ({ maxerr, std::abs (vecr[p].x - w.x), std::abs (vecr[p].y - w.y), std::abs (vecr[p].z - w.z) });
+        if (angr[p].phi < 0.0 || angn[p].phi >= morph::mathconst<double>::two_pi) {
+            std::cout << "nside " << nside << ": batch phi out of range\n"; --rtn; break;
+        }
+    }
+    if (maxerr > 1e-13) { std::cout << "nside " << nside << ": batch pixel centres differ by " << maxerr << "\n"; --rtn; }
+
+    // ang -> pix on random directions (including some negative phi) and on the pixel centres
+    morph::RandUniform<double> rz (-1.0, 1.0, 11);
+    morph::RandUniform<double> rp (-morph::mathconst<double>::pi, morph::mathconst<double>::two_pi, 13);
+    std::vector<hp::t_ang> angs (20000);
+    for (auto& a : angs) { a = hp::t_ang{ std::acos (rz.get()), rp.get() }; }
+    angs.insert (angs.end(), angr.begin(), angr.end());
+    std::vector<int64_t> ar (angs.size());
+    std::vector<int64_t> an (angs.size());
+    hp::ang2ring (rt, angs, ar);
+    hp::ang2nest (nside, angs, an);
+    for (std::size_t i = 0; i < angs.size(); ++i) {
+        if (ar[i] != hp::ang2ring (nside, angs[i]) || an[i] != hp::ang2nest (nside, angs[i])) {
+            std::cout << "nside " << nside << ": batch ang2pix differs at " << i << "\n"; --rtn; break;
+        }
+    }
+    // The centres come back to their own pixels
+    for (int64_t p = 0; p < npix; ++p) {
+        if (ar[angs.size() - npix + p] != p) { std::cout << "nside " << nside << ": ring centre " << p << " not in its pixel\n"; --rtn; break; }
+    }
+
+    // Neighbours are mutual, distinct and nearby, and 24 pixels have just 7 of them
+    std::vector<std::array<int64_t, 8>> nb (npix);
+    hp::neighbours (nside, pix, nb);
+    int n_missing = 0;
+    // Neighbouring centres are never more than about 2.2 pixel sizes apart
+    const double maxd = 2.2 * std::sqrt (4.0 * morph::mathconst<double>::pi / npix);
+    for (int64_t p = 0; p < npix && rtn == 0; ++p) {
+        if (nb[p] != hp::neighbours (nside, p)) { std::cout << "nside " << nside << ": batch neighbours differ\n"; --rtn; }
+        for (int d = 0; d < 8; ++d) {
+            const int64_t q = nb[p][d];
+            if (q < 0) { ++n_missing; continue; }
+            if (q == p || std::count (nb[p].begin(), nb[p].end(), q) != 1
+                || std::count (nb[q].begin(), nb[q].end(), p) != 1
+                || hp::vec_angle (hp::nest2vec (nside, p), hp::nest2vec (nside, q)) > maxd) {
+                std::cout << "nside " << nside << ": bad neighbour " << q << " of " << p << "\n"; --rtn; break;
+            }
+        }
+    }
+    if (rtn == 0 && n_missing != 24) { std::cout << "nside " << nside << ": " << n_missing << " missing neighbours, not 24\n"; --rtn; }
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    for (int64_t nside : { 2, 4, 8, 32, 256 }) { rtn += test_nside (nside); }
+
+    // The input and output spans must match and nside must be a power of 2
+    try {
+        std::vector<int64_t> in (4, 0);
+        std::vector<int64_t> out (3, 0);
+        hp::nest2ring (hp::ring_table (4), in, out);
+        std::cout << "expected an exception for mismatched spans\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+    try {
+        hp::ring_table rt (6);
+        std::cout << "expected an exception for nside 6\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "test_healpix_batch " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,53 @@
+// Test morph::hexyhisto, and that adding data in batches gives the same histogram
+
+#include <morph/hexyhisto.h>
+#include <morph/HexGrid.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg (0.02f, 1.0f, 0.0f);
+    hg.setCircularBoundary (0.4f);
+
+    // Random coordinates in a square that is larger than the boundary
+    morph::vvec<morph::vec<float>> data (20000);
+    morph::vvec<float> rx (data.size());
+    morph::vvec<float> ry (data.size());
+    rx.randomize (-0.5f, 0.5f);
+    ry.randomize (-0.5f, 0.5f);
+    for (std::size_t i = 0; i < data.size(); ++i) { data[i] = { rx[i], ry[i], 0.0f }; }
+    data[0][2] = -1.0f; // coordinates with z < 0 are skipped
+
+    morph::hexyhisto<float> hh (data, &hg);
+
+    // Count directly, with the exhaustive nearest-hex search
+    morph::vvec<float> expected (hg.num(), 0.0f);
+    for (std::size_t i = 1; i < data.size(); ++i) {
+        float dmin = std::numeric_limits<float>::max();
+        const morph::Hex* best = nullptr;
+        for (const auto& h : hg.hexen) {
+            float dd = std::sqrt ((h.x - data[i][0]) * (h.x - data[i][0]) + (h.y - data[i][1]) * (h.y - data[i][1]));
+            if (dd < dmin) { dmin = dd; best = &h; }
+        }
+        if (dmin <= hg.getv()) { expected[best->vi] += 1.0f; }
+    }
+    std::cout << "hexyhisto counted " << hh.datacount << " of " << data.size() << " coordinates\n";
+    if (hh.counts != expected) { std::cout << "Counts differ from direct computation\n"; --rtn; }
+    if (hh.datacount != expected.sum()) { --rtn; }
+    if (std::abs (hh.proportions.sum() - 1.0f) > 1e-4f) { --rtn; }
+
+    // The same, in batches
+    morph::hexyhisto<float> hh2 (&hg);
+    for (std::size_t i = 0; i < data.size(); i += 5000) {
+        hh2.add (morph::vvec<morph::vec<float>>(data.begin() + i, data.begin() + i + 5000));
+    }
+    if (hh2.counts != hh.counts) { std::cout << "Batched counts differ\n"; --rtn; }
+
+    std::cout << "test_hexyhisto " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -1,4 +1,5 @@
 #include <morph/histo.h>
+#include <cmath>
 
 int main()
 {
@@ -34,5 +35,28 @@ int main()
     morph::vvec<float> _proportions = h.proportions;
     std::cout << "Proportions are: " << _proportions << std::endl;
 
+    // A large data set is binned in parallel. Check against a histogram built up from small
+    // batches with add(), which are binned serially.
+    morph::vvec<double> big (1000000);
+    big.randomize();
+    morph::range<double> r01 (0.0, 1.0);
+    morph::histo<double, float> hbig (big, 50, r01);
+    morph::histo<double, float> hstream (50, r01);
+    for (std::size_t i = 0; i < big.size(); i += 1000) {
+        morph::vvec<double> batch (big.begin() + i, big.begin() + i + 1000);
+        hstream.add (batch);
+    }
+    if (hbig.counts != hstream.counts) { std::cout << "Parallel and streamed counts differ\n"; --rtn; }
+    if (hbig.counts.sum() != big.size() || hstream.datacount != big.size()) { --rtn; }
+    if (std::abs (hstream.proportions.sum() - 1.0f) > 1e-4f) { --rtn; }
+
+    // Data outside the range is rejected, and the histogram is left as it was
+    try {
+        hstream.add (morph::vvec<double>{ 0.5, 1.5 });
+        std::cout << "add() accepted data outside the range\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+    if (hstream.counts != hbig.counts) { --rtn; }
+
     return rtn;
 }
@@ -0,0 +1,182 @@
+// Test the memory-mapped IDX file reader and idx_dataset in morph/idx.h
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <filesystem>
+#include <morph/idx.h>
+#include <morph/Mnist.h>
+
+// Write an IDX file with type code t, dimensions dims and payload bytes
+void write_idx (const std::string& path, std::uint8_t t, const std::vector<std::uint32_t>& dims,
+                const std::vector<std::uint8_t>& bytes)
+{
+    std::ofstream f (path, std::ios::out | std::ios::binary | std::ios::trunc);
+    const char hdr[4] = { 0, 0, static_cast<char>(t), static_cast<char>(dims.size()) };
+    f.write (hdr, 4);
+    for (auto d : dims) {
+        const char be[4] = { static_cast<char>(d >> 24), static_cast<char>(d >> 16), static_cast<char>(d >> 8), static_cast<char>(d) };
+        f.write (be, 4);
+    }
+    f.write (reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // 5 images of 2 rows x 3 cols. Pixel k of image i is 10 i + k.
+    const std::string imgs = "../test_idx_images.idx";
+    const std::string lbls = "../test_idx_labels.idx";
+    std::vector<std::uint8_t> px;
+    for (std::uint8_t i = 0; i < 5; ++i) { for (std::uint8_t k = 0; k < 6; ++k) { px.push_back (10 * i + k); } }
+    write_idx (imgs, morph::idx_file::type_ubyte, {5, 2, 3}, px);
+    write_idx (lbls, morph::idx_file::type_ubyte, {5}, {3, 1, 4, 1, 5});
+
+    {
+        morph::idx_file f (imgs);
+        if (f.size() != 5 || f.item_size() != 6 || f.dims.size() != 3 || f.dims[1] != 2) {
+            std::cerr << "Wrong IDX dimensions\n";
+            --rtn;
+        }
+        auto it = f.item (3);
+        if (it.size() != 6 || it[0] != 30 || it[5] != 35 || f.value (3, 5) != 35.0) {
+            std::cerr << "Wrong IDX item contents\n";
+            --rtn;
+        }
+        // Moving keeps the mapping
+        morph::idx_file g = std::move (f);
+        if (g.item (4)[2] != 42 || f.size() != 0) {
+            std::cerr << "Move of idx_file failed\n";
+            --rtn;
+        }
+    }
+
+    {
+        morph::idx_dataset ds (imgs, lbls);
+        ds.scale = 1.0f;
+        if (ds.size() != 5 || ds.rows() != 2 || ds.cols() != 3 || ds.label (2) != 4) {
+            std::cerr << "Wrong idx_dataset sizes or labels\n";
+            --rtn;
+        }
+        // Row-major batch of images 1 and 2 with one-hot labels
+        std::vector<float> x (12, -1.0f);
+        std::vector<float> y (12, -1.0f);
+        ds.get_batch (1, 2, x.data(), y.data(), 6);
+        if (x[0] != 10.0f || x[5] != 15.0f || x[6] != 20.0f || x[11] != 25.0f
+            || y[1] != 1.0f || y[0] != 0.0f || y[6 + 4] != 1.0f || std::count (y.begin(), y.end(), 1.0f) != 2) {
+            std::cerr << "Wrong row-major batch\n";
+            --rtn;
+        }
+        // Column-major: pixel k of sample s at k * nb + s
+        ds.get_batch (1, 2, x.data(), y.data(), 6, true);
+        if (x[0] != 10.0f || x[1] != 20.0f || x[2 * 5] != 15.0f || x[2 * 5 + 1] != 25.0f
+            || y[1 * 2 + 0] != 1.0f || y[4 * 2 + 1] != 1.0f) {
+            std::cerr << "Wrong column-major batch\n";
+            --rtn;
+        }
+        // Flipped rows
+        ds.flip_rows = true;
+        std::vector<float> one (6);
+        ds.get_item (0, one.data());
+        if (one[0] != 3.0f || one[3] != 0.0f) {
+            std::cerr << "Wrong flipped image\n";
+            --rtn;
+        }
+        ds.flip_rows = false;
+        // Shuffling permutes the order, not the images
+        ds.shuffle (17);
+        std::vector<unsigned int> o = ds.order;
+        std::sort (o.begin(), o.end());
+        if (o != std::vector<unsigned int>{0, 1, 2, 3, 4}) {
+            std::cerr << "Shuffled order is not a permutation\n";
+            --rtn;
+        }
+        for (std::size_t i = 0; i < ds.size(); ++i) {
+            ds.get_item (i, one.data());
+            if (one[0] != 10.0f * ds.order[i]) {
+                std::cerr << "Shuffled item " << i << " is wrong\n";
+                --rtn;
+            }
+        }
+        try {
+            ds.get_batch (4, 2, x.data());
+            std::cerr << "Expected an exception for a batch past the end\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+    }
+
+    // Other element types are big-endian in the file
+    const std::string shorts = "../test_idx_shorts.idx";
+    write_idx (shorts, morph::idx_file::type_short, {2, 2}, {0x00, 0x07, 0xff, 0xfe, 0x01, 0x00, 0x80, 0x00});
+    {
+        morph::idx_file f (shorts);
+        if (f.value (0, 0) != 7.0 || f.value (0, 1) != -2.0 || f.value (1, 0) != 256.0 || f.value (1, 1) != -32768.0) {
+            std::cerr << "Wrong 16 bit values\n";
+            --rtn;
+        }
+    }
+    const std::string floats = "../test_idx_floats.idx";
+    write_idx (floats, morph::idx_file::type_float, {1, 1}, {0x3f, 0xc0, 0x00, 0x00}); // 1.5f
+    {
+        morph::idx_file f (floats);
+        if (f.value (0, 0) != 1.5) {
+            std::cerr << "Wrong float value\n";
+            --rtn;
+        }
+    }
+
+    // Bad files throw
+    const std::string bad = "../test_idx_bad.idx";
+    write_idx (bad, morph::idx_file::type_ubyte, {5, 2, 3}, {1, 2, 3}); // truncated payload
+    try {
+        morph::idx_file f (bad);
+        std::cerr << "Expected an exception for a truncated file\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+    {
+        std::ofstream f (bad, std::ios::out | std::ios::binary | std::ios::trunc);
+        f << "not an idx file";
+    }
+    try {
+        morph::idx_file f (bad);
+        std::cerr << "Expected an exception for a bad magic number\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+    try {
+        morph::idx_file f ("../no/such/file.idx");
+        std::cerr << "Expected an exception for a missing file\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    for (auto p : { imgs, lbls, shorts, floats, bad }) { std::filesystem::remove (p); }
+
+    // If the MNIST test set is here, it should match morph::Mnist's loading of it
+    const std::string mpath = "../../standalone_examples/neuralnet/mnist/";
+    if (std::filesystem::exists (mpath + "t10k-images-idx3-ubyte")) {
+        morph::idx_dataset ds (mpath + "t10k-images-idx3-ubyte", mpath + "t10k-labels-idx1-ubyte");
+        ds.flip_rows = true;
+        morph::Mnist m (mpath);
+        if (ds.size() != m.test_f.size()) {
+            std::cerr << "idx_dataset and Mnist hold different numbers of test images\n";
+            --rtn;
+        }
+        std::vector<float> img (ds.item_size());
+        unsigned int mismatches = 0;
+        for (auto& t : m.test_f) {
+            const int id = t.second.first;
+            ds.get_item (id, img.data());
+            if (ds.label (id) != t.first || !std::equal (img.begin(), img.end(), t.second.second.begin())) { ++mismatches; }
+        }
+        if (mismatches > 0) {
+            std::cerr << mismatches << " MNIST test images differ between idx_dataset and Mnist\n";
+            --rtn;
+        }
+    }
+
+    std::cout << "test_idx " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,99 @@
+/*
+ * Test morph::nn::IzhikevichPopulation against the scalar update of examples/izhikevich.cpp,
+ * and check that spikes are propagated through the connections.
+ */
+#include <morph/nn/IzhikevichPopulation.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+// The single neuron step from examples/izhikevich.cpp
+struct izhi
+{
+    float I = 0.0f;
+    float u = -10.0f;
+    float v = -70.0f;
+    float a = 0.03f;
+    float b = 0.193f;
+    float c = -65.0f;
+    float d = 0.05f;
+    float A = 0.032f;
+    float B = 4.0f;
+    float C = 113.147f;
+    float T = 0.4f;
+    float SI = 5.0f;
+    float vpeak = 30.0f;
+    float dv (const float _u, const float _v) { return (A*T) * _v * _v + (B*T) * _v + (C*T) - _u * T + I * (T/SI); }
+    float du (const float _u, const float _v) { return a * T * (b * _v - _u); }
+    void step()
+    {
+        bool spike = (v > vpeak);
+        float _du = this->du (u, v);
+        v = spike ? c       : (v + this->dv (u, v));
+        u = spike ? (u + d) : (u + _du);
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+
+    // Unconnected neurons with a range of input currents follow the scalar model. The compiler
+    // may fuse multiply-adds differently in the two loops, so allow for rounding.
+    constexpr unsigned int N = 257;
+    morph::nn::IzhikevichPopulation<float> pop (N);
+    std::vector<izhi> ref (N);
+    for (unsigned int i = 0; i < N; ++i) {
+        pop.Iext[i] = 0.1f * static_cast<float>(i);
+        ref[i].I = pop.Iext[i];
+    }
+    // Step by step for a while, then by the number of spikes each neuron makes, because the
+    // rounding differences shift the spike times a little over a long run.
+    std::vector<unsigned int> popcount (N, 0u);
+    std::vector<unsigned int> refcount (N, 0u);
+    unsigned int nspikes = 0;
+    for (unsigned int t = 0; t < 2000 && rtn == 0; ++t) {
+        pop.step();
+        for (unsigned int j : pop.spikes) { ++popcount[j]; }
+        for (unsigned int i = 0; i < N; ++i) {
+            if (ref[i].v > ref[i].vpeak) { ++refcount[i]; }
+            ref[i].step();
+            if (t < 10 && (std::abs (pop.v[i] - ref[i].v) > 1e-3f || std::abs (pop.u[i] - ref[i].u) > 1e-3f)) {
+                std::cout << "neuron " << i << " differs at step " << t << std::endl;
+                --rtn;
+                break;
+            }
+        }
+        nspikes += pop.spikes.size();
+    }
+    for (unsigned int i = 0; i < N && rtn == 0; ++i) {
+        const unsigned int slack = 1u + refcount[i] / 10u;
+        if (popcount[i] + slack < refcount[i] || refcount[i] + slack < popcount[i]) {
+            std::cout << "neuron " << i << " spiked " << popcount[i] << " times, not " << refcount[i] << std::endl;
+            --rtn;
+        }
+    }
+    if (nspikes == 0) { std::cout << "No neuron spiked\n"; --rtn; }
+
+    // A spike from neuron 0 reaches 1 and 2, weighted, on the next step, but not 3
+    morph::nn::IzhikevichPopulation<float> net (4);
+    net.connect (0, 1, 2.0f);
+    net.connect (0, 2, -1.0f);
+    net.connect (0, 2, 0.5f);
+    net.connect (3, 0, 7.0f);
+    net.setNet();
+    if (net.num_connections() != 4) { std::cout << "wrong number of connections\n"; --rtn; }
+    net.v[0] = 40.0f; // above vpeak, so it fires (and resets) in the first step
+    net.step();
+    if (net.spikes != std::vector<unsigned int>{0}) { std::cout << "expected neuron 0 to spike\n"; --rtn; }
+    if (net.v[0] != net.c) { std::cout << "neuron 0 did not reset\n"; --rtn; }
+    if (net.Isyn[0] != 0.0f || net.Isyn[1] != 2.0f || net.Isyn[2] != -0.5f || net.Isyn[3] != 0.0f) {
+        std::cout << "Isyn is wrong: " << net.Isyn << std::endl;
+        --rtn;
+    }
+    net.step();
+    if (!net.spikes.empty() || net.Isyn.sum() != 0.0f) { std::cout << "Isyn should clear when nothing fires\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
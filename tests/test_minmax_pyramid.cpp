@@ -0,0 +1,55 @@
+/*
+ * Test the min/max pyramid used for level-of-detail reduction of long data series
+ */
+#include <morph/minmax_pyramid.h>
+#include <morph/Random.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <cstddef>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::RandUniform<float> rng;
+    morph::vvec<float> data (100003);
+    for (auto& d : data) { d = rng.get(); }
+
+    morph::minmax_pyramid p (data);
+
+    // Compare minmax_in with a simple search for some awkward ranges
+    std::size_t ranges[][2] = { {0, 1}, {0, 2}, {1, 2}, {3, 17}, {0, 100003}, {12345, 98765}, {99999, 100003} };
+    for (auto r : ranges) {
+        std::size_t imin = r[0];
+        std::size_t imax = r[0];
+        for (std::size_t i = r[0]; i < r[1]; ++i) {
+            if (data[i] < data[imin]) { imin = i; }
+            if (data[i] > data[imax]) { imax = i; }
+        }
+        std::array<std::size_t, 2> mm = p.minmax_in (data, r[0], r[1]);
+        if (mm[0] != imin || mm[1] != imax) {
+            std::cout << "minmax_in wrong for range [" << r[0] << "," << r[1] << ")\n";
+            --rtn;
+        }
+    }
+
+    // The envelope must be bounded in size, ascending, include the end points and keep the extremes
+    std::vector<std::size_t> env = p.envelope (data, 0, data.size(), 1000);
+    std::cout << "Envelope of " << data.size() << " samples has " << env.size() << " samples\n";
+    if (env.size() > 2002 || env.front() != 0 || env.back() != data.size() - 1) { --rtn; }
+    for (std::size_t i = 1; i < env.size(); ++i) { if (env[i] <= env[i-1]) { --rtn; break; } }
+    bool has_min = false;
+    bool has_max = false;
+    for (auto i : env) {
+        if (data[i] == data.min()) { has_min = true; }
+        if (data[i] == data.max()) { has_max = true; }
+    }
+    if (!has_min || !has_max) { --rtn; }
+
+    // A short range is returned complete
+    env = p.envelope (data, 10, 20, 1000);
+    if (env.size() != 10u) { --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,127 @@
+// Test the counter-based morph::philox4x32 engine and the bulk get() fills in Random.h
+
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <morph/Random.h>
+#include <morph/vvec.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+int main()
+{
+    int rtn = 0;
+
+    // Known answers for Philox4x32-10 from the Random123 distribution
+    morph::philox4x32 p0 (0, 0);
+    std::array<std::uint32_t, 4> b0 = p0.block (0);
+    if (b0 != std::array<std::uint32_t, 4>{ 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u }) {
+        std::cerr << "Philox known answer test (zeros) failed\n";
+        --rtn;
+    }
+    morph::philox4x32 p1 (~0ULL, ~0ULL);
+    std::array<std::uint32_t, 4> b1 = p1.block (~0ULL);
+    if (b1 != std::array<std::uint32_t, 4>{ 0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu }) {
+        std::cerr << "Philox known answer test (ones) failed\n";
+        --rtn;
+    }
+
+    // discard() lands at the same place as stepping
+    morph::philox4x32 pa (7);
+    morph::philox4x32 pb (7);
+    for (int i = 0; i < 1003; ++i) { pa(); }
+    pb.discard (1003);
+    if (pa() != pb()) {
+        std::cerr << "discard() differs from stepping\n";
+        --rtn;
+    }
+    // Different streams differ
+    morph::philox4x32 ps (7, 1);
+    morph::philox4x32 pt (7, 2);
+    if (ps() == pt()) {
+        std::cerr << "Streams 1 and 2 begin with the same output\n";
+        --rtn;
+    }
+
+    // The bulk fill gives the same numbers for any thread count
+    constexpr std::size_t n = 1000001;
+    morph::vvec<float> u1 (n);
+    morph::vvec<float> u2 (n);
+    {
+        morph::RandUniform<float, morph::philox4x32> ru (42);
+        ru.get (u1);
+    }
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
+    omp_set_num_threads (3);
+#endif
+    {
+        morph::RandUniform<float, morph::philox4x32> ru (42);
+        ru.get (u2);
+    }
+#ifdef _OPENMP
+    omp_set_num_threads (nthreads);
+#endif
+    if (u1 != u2) {
+        std::cerr << "Bulk uniform fill depends on the number of threads\n";
+        --rtn;
+    }
+    // Uniform [0,1): mean 1/2, variance 1/12, all in range
+    std::cout << "uniform mean " << u1.mean() << " variance " << u1.variance() << " range " << u1.range() << "\n";
+    if (std::abs (u1.mean() - 0.5f) > 0.002f || std::abs (u1.variance() - 1.0f/12.0f) > 0.002f
+        || u1.min() < 0.0f || u1.max() >= 1.0f) {
+        std::cerr << "Bulk uniform fill has the wrong statistics\n";
+        --rtn;
+    }
+
+    // A range, and a std::vector
+    morph::RandUniform<double, morph::philox4x32> rud (-2.0, 3.0, 1);
+    std::vector<double> ud (100001);
+    rud.get (ud);
+    double udsum = 0.0;
+    bool udinrange = true;
+    for (auto d : ud) { udsum += d; udinrange = udinrange && d >= -2.0 && d < 3.0; }
+    if (!udinrange || std::abs (udsum / ud.size() - 0.5) > 0.03) {
+        std::cerr << "Bulk uniform fill in [-2,3) failed\n";
+        --rtn;
+    }
+    // The next fill continues the sequence rather than repeating it
+    std::vector<double> ud2 (100001);
+    rud.get (ud2);
+    if (ud2[0] == ud[0]) {
+        std::cerr << "A second fill repeated the first\n";
+        --rtn;
+    }
+
+    // Normal fill
+    morph::RandNormal<double, morph::philox4x32> rn (5.0, 2.0, 3);
+    morph::vvec<double> nv (n);
+    rn.get (nv);
+    std::cout << "normal mean " << nv.mean() << " sd " << nv.std() << "\n";
+    if (std::abs (nv.mean() - 5.0) > 0.01 || std::abs (nv.std() - 2.0) > 0.01) {
+        std::cerr << "Bulk normal fill has the wrong statistics\n";
+        --rtn;
+    }
+
+    // Other engines fill serially
+    morph::RandUniform<float, std::mt19937> rmt (1);
+    morph::vvec<float> umt (1000);
+    rmt.get (umt);
+    if (umt.min() < 0.0f || umt.max() >= 1.0f || umt.mean() < 0.4f || umt.mean() > 0.6f) {
+        std::cerr << "Serial bulk fill failed\n";
+        --rtn;
+    }
+
+    // philox4x32 works as an engine for the std distributions (via the scalar get())
+    morph::RandUniform<int, morph::philox4x32> ri (1, 6, 9);
+    int isum = 0;
+    for (int i = 0; i < 6000; ++i) { int v = ri.get(); isum += v; if (v < 1 || v > 6) { --rtn; break; } }
+    if (std::abs (isum / 6000.0 - 3.5) > 0.1) {
+        std::cerr << "Integer uniform with philox4x32 failed\n";
+        --rtn;
+    }
+
+    std::cout << "test_philox " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
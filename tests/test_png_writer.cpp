@@ -0,0 +1,75 @@
+/*
+ * Test morph::png_writer, the background PNG encoder used by VisualOwnable::saveImageAsync.
+ */
+#include <morph/png_writer.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main()
+{
+    int rtn = 0;
+
+    constexpr unsigned int w = 5;
+    constexpr unsigned int h = 3;
+    constexpr int nimg = 12;
+    {
+        // A short queue, so that push() has to block on the writer
+        morph::png_writer pw (2);
+        for (int n = 0; n < nimg; ++n) {
+            morph::png_writer::job j;
+            j.filename = std::string("../test_png_writer_") + std::to_string (n) + ".png";
+            j.width = w;
+            j.height = h;
+            j.bottom_up = true;
+            j.opaque = true;
+            // Row r (counting from the bottom, as glReadPixels gives it) has red value r, alpha 0
+            j.rgba.resize (4 * w * h, 0);
+            for (unsigned int r = 0; r < h; ++r) {
+                for (unsigned int c = 0; c < w; ++c) {
+                    j.rgba[4 * (r * w + c)] = static_cast<unsigned char>(r);
+                    j.rgba[4 * (r * w + c) + 1] = static_cast<unsigned char>(n);
+                }
+            }
+            pw.push (std::move (j));
+        }
+        pw.wait();
+        if (pw.queued() != 0) { --rtn; }
+        if (pw.errors() != 0) { --rtn; }
+    }
+
+    // Each file must be top row first and opaque
+    for (int n = 0; n < nimg; ++n) {
+        std::vector<unsigned char> png;
+        unsigned int pw_ = 0, ph_ = 0;
+        std::string fn = std::string("../test_png_writer_") + std::to_string (n) + ".png";
+        unsigned int err = lodepng::decode (png, pw_, ph_, fn, LCT_RGBA, 8);
+        if (err || pw_ != w || ph_ != h) {
+            std::cout << "Failed to read back " << fn << "\n";
+            --rtn;
+            continue;
+        }
+        for (unsigned int r = 0; r < h; ++r) {
+            for (unsigned int c = 0; c < w; ++c) {
+                const unsigned char* px = &png[4 * (r * w + c)];
+                if (px[0] != h - 1 - r || px[1] != n || px[3] != 255) { --rtn; }
+            }
+        }
+    }
+
+    // A job that cannot be written is counted as an error
+    {
+        morph::png_writer pw;
+        morph::png_writer::job j;
+        j.filename = "../no/such/dir/test_png_writer.png";
+        j.width = w;
+        j.height = h;
+        j.rgba.resize (4 * w * h, 0);
+        pw.push (std::move (j));
+        pw.wait();
+        if (pw.errors() != 1) { --rtn; }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
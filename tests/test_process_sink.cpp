@@ -0,0 +1,60 @@
+/*
+ * Test morph::process_sink (the base of morph::ffmpeg_sink), which pipes raw frames to
+ * the stdin of a program. Here the program is a shell that copies its stdin to a file.
+ */
+#include <morph/ffmpeg_sink.h>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct cat_sink : public morph::process_sink
+{
+    cat_sink (const std::string& _outfile) : morph::process_sink("/bin/sh"), outfile(_outfile) {}
+    std::list<std::string> args (const int, const int) override
+    {
+        return { "sh", "-c", std::string("cat > ") + this->outfile };
+    }
+    std::string outfile;
+};
+
+int main()
+{
+    int rtn = 0;
+
+    constexpr int w = 6;
+    constexpr int h = 4;
+    constexpr int nframes = 5;
+    const std::string outfile = "../test_process_sink.raw";
+
+    cat_sink sink (outfile);
+    std::vector<unsigned char> frame (4 * w * h);
+    for (int f = 0; f < nframes; ++f) {
+        for (std::size_t i = 0; i < frame.size(); ++i) { frame[i] = static_cast<unsigned char>(f * 7 + i); }
+        if (!sink.write_frame (frame.data(), w, h)) { --rtn; }
+    }
+    // A frame of a different size is refused, and so is every frame after it
+    if (sink.write_frame (frame.data(), w + 1, h)) { --rtn; }
+    if (sink.write_frame (frame.data(), w, h)) { --rtn; }
+    sink.finish();
+    if (sink.exit_status != 0) { --rtn; }
+    if (sink.frames != nframes) { --rtn; }
+
+    // The file must hold exactly the frames that were accepted
+    std::ifstream fin (outfile, std::ios::binary);
+    std::vector<unsigned char> got ((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    if (got.size() != static_cast<std::size_t>(nframes) * frame.size()) {
+        std::cout << "Wrong number of bytes: " << got.size() << "\n";
+        --rtn;
+    } else {
+        for (int f = 0; f < nframes; ++f) {
+            for (std::size_t i = 0; i < frame.size(); ++i) {
+                if (got[f * frame.size() + i] != static_cast<unsigned char>(f * 7 + i)) { --rtn; break; }
+            }
+        }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,85 @@
+// Test the sparse (CSR) passes of morph::nn::recurrentnet::RecurrentNetwork against the
+// original loops over the connection list
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <morph/nn/RecurrentNetwork.h>
+#include <morph/Random.h>
+
+int main()
+{
+    int rtn = 0;
+
+    // About 1% connected
+    const int N = 1000;
+    morph::RandUniform<int> rnode (0, N - 1, 17);
+    std::vector<int> pre, post;
+    for (int i = 0; i < N * N / 100; ++i) {
+        pre.push_back (rnode.get());
+        post.push_back (rnode.get());
+    }
+
+    morph::nn::recurrentnet::RecurrentNetwork P (N, 0.02, 32.0, 1.0, 1.0, 0.000001, 400, pre, post);
+    morph::RandUniform<double> rw (-0.5, 0.5, 3);
+    for (auto& w : P.W) { w = rw.get(); }
+    for (int i = 0; i < N; ++i) { P.X[i] = rw.get(); P.Y[i] = rw.get(); P.Input[i] = rw.get(); }
+
+    if (P.Nweight != static_cast<int>(pre.size()) + N) {
+        std::cerr << "Wrong number of weights " << P.Nweight << "\n";
+        --rtn;
+    }
+    if (!P.Wptr.empty()) {
+        std::cerr << "setNet should not make the dense pointer matrix\n";
+        --rtn;
+    }
+
+    // Reference state, updated with the original dense-free COO loops
+    std::vector<double> X = P.X, Y = P.Y, W = P.W, U (N, 0.0), F (N, 0.0), V (N + 1, 0.0), Fp (N, 0.0);
+    std::vector<double> J (N, 0.0);
+    for (int i = 0; i < 10; ++i) { J[i] = 0.1 * i; }
+    P.J = J;
+
+    for (int step = 0; step < 5; ++step) {
+        P.forward();
+        std::fill (U.begin(), U.end(), 0.0);
+        for (int k = 0; k < P.Nweight; ++k) { U[P.Post[k]] += X[P.Pre[k]] * W[k]; }
+        for (int i = 0; i < N; ++i) { F[i] = 1.0 / (1.0 + std::exp (-U[i])); }
+        for (int i = 0; i < N; ++i) { X[i] += P.dtOverTauX * (-X[i] + F[i] + P.Input[i]); }
+
+        P.backward();
+        for (int i = 0; i < N; ++i) { Fp[i] = F[i] * (1.0 - F[i]); }
+        std::fill (V.begin(), V.end(), 0.0);
+        for (int k = 0; k < P.Nweight; ++k) { V[P.Pre[k]] += Fp[P.Post[k]] * W[k] * Y[P.Post[k]]; }
+        for (int i = 0; i < N; ++i) { Y[i] += P.dtOverTauY * (V[i] - Y[i] + J[i]); }
+
+        P.weightUpdate();
+        for (int k = 0; k < P.Nweight; ++k) {
+            double delta = X[P.Pre[k]] * Y[P.Post[k]] * Fp[P.Post[k]];
+            W[k] += delta < -1.0 ? -P.dtOverTauW : (delta > 1.0 ? P.dtOverTauW : P.dtOverTauW * delta);
+        }
+    }
+
+    double maxdiff = 0.0;
+    for (int i = 0; i < N; ++i) {
+        maxdiff = std::max (maxdiff, std::abs (X[i] - P.X[i]));
+        maxdiff = std::max (maxdiff, std::abs (Y[i] - P.Y[i]));
+    }
+    for (int k = 0; k < P.Nweight; ++k) { maxdiff = std::max (maxdiff, std::abs (W[k] - P.W[k])); }
+    std::cout << "Max difference from the connection list loops: " << maxdiff << "\n";
+    if (maxdiff > 1e-12) {
+        std::cerr << "Sparse passes differ from the connection list loops\n";
+        --rtn;
+    }
+
+    // The dense weight matrix for saving is still available
+    std::vector<double> wm = P.getWeightMatrix();
+    if (wm.size() != static_cast<std::size_t>((N + 1) * (N + 1))
+        || wm[static_cast<std::size_t>(P.Pre.back()) * (N + 1) + P.Post.back()] != P.W.back()) {
+        std::cerr << "getWeightMatrix is wrong\n";
+        --rtn;
+    }
+
+    std::cout << "test_recurrentnet " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
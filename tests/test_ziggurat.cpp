@@ -0,0 +1,115 @@
+// Test the ziggurat normal and exponential generators behind RandNormal, RandLogNormal and
+// RandExponential
+
+#include <iostream>
+#include <cmath>
+#include <array>
+#include <morph/Random.h>
+#include <morph/vvec.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+int main()
+{
+    int rtn = 0;
+
+    // The numbers for a seed are fixed (std::mt19937_64's output is fixed by the standard and
+    // the ziggurat uses no library maths), so they are the same with any standard library
+    morph::RandNormal<double> rn (0.0, 1.0, 42);
+    constexpr std::array<double, 4> known_n = { -0.90718034108279899, -0.87194980932288435,
+                                                -0.33745327744588899, 0.47151824657896596 };
+    for (auto k : known_n) {
+        if (rn.get() != k) { std::cerr << "RandNormal known answer differs\n"; --rtn; break; }
+    }
+    morph::RandExponential<double> re (1.0, 42);
+    constexpr std::array<double, 2> known_e = { 2.4580669850957673, 1.4309592911160181 };
+    for (auto k : known_e) {
+        if (re.get() != k) { std::cerr << "RandExponential known answer differs\n"; --rtn; break; }
+    }
+
+    // Moments and the tail of the normal distribution
+    morph::RandNormal<double> rn2 (0.0, 1.0, 1);
+    morph::vvec<double> v (2000000);
+    rn2.get (v);
+    double m4 = 0.0;
+    unsigned int ntail = 0;
+    for (auto x : v) {
+        m4 += x * x * x * x;
+        if (std::abs (x) > morph::ziggurat::nr) { ++ntail; }
+    }
+    m4 /= v.size();
+    const double ftail = static_cast<double>(ntail) / v.size();
+    std::cout << "normal mean " << v.mean() << " sd " << v.std() << " m4 " << m4 << " tail " << ftail << "\n";
+    if (std::abs (v.mean()) > 0.003 || std::abs (v.std() - 1.0) > 0.003 || std::abs (m4 - 3.0) > 0.03
+        || std::abs (ftail - 5.76e-4) > 1e-4) {
+        std::cerr << "Normal numbers have the wrong statistics\n";
+        --rtn;
+    }
+
+    // The exponential distribution: mean 1/lambda, variance 1/lambda^2
+    morph::RandExponential<float> rf (4.0f, 2);
+    morph::vvec<float> e (1000000);
+    rf.get (e);
+    std::cout << "exponential mean " << e.mean() << " variance " << e.variance() << "\n";
+    if (std::abs (e.mean() - 0.25f) > 0.002f || std::abs (e.variance() - 0.0625f) > 0.002f || e.min() < 0.0f) {
+        std::cerr << "Exponential numbers have the wrong statistics\n";
+        --rtn;
+    }
+
+    // Log normal: the log of the numbers is normal
+    morph::RandLogNormal<double> rl (1.0, 0.5, 3);
+    morph::vvec<double> l (500000);
+    rl.get (l);
+    l.log_inplace();
+    if (std::abs (l.mean() - 1.0) > 0.005 || std::abs (l.std() - 0.5) > 0.005) {
+        std::cerr << "Log normal numbers have the wrong statistics\n";
+        --rtn;
+    }
+
+    // The philox bulk fills give the same numbers for any thread count
+    morph::vvec<float> p1 (300001);
+    morph::vvec<float> p2 (300001);
+    morph::vvec<float> x1 (300001);
+    morph::vvec<float> x2 (300001);
+    {
+        morph::RandNormal<float, morph::philox4x32> r (2.0f, 3.0f, 9);
+        r.get (p1);
+        morph::RandExponential<float, morph::philox4x32> rx (1.0f, 9);
+        rx.get (x1);
+    }
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
+    omp_set_num_threads (3);
+#endif
+    {
+        morph::RandNormal<float, morph::philox4x32> r (2.0f, 3.0f, 9);
+        r.get (p2);
+        morph::RandExponential<float, morph::philox4x32> rx (1.0f, 9);
+        rx.get (x2);
+    }
+#ifdef _OPENMP
+    omp_set_num_threads (nthreads);
+#endif
+    if (p1 != p2 || x1 != x2) { std::cerr << "Bulk ziggurat fill depends on the number of threads\n"; --rtn; }
+    if (p1.has_nan() || std::abs (p1.mean() - 2.0f) > 0.03f || std::abs (p1.std() - 3.0f) > 0.03f) {
+        std::cerr << "Bulk normal fill has the wrong statistics\n";
+        --rtn;
+    }
+    if (x1.has_nan() || std::abs (x1.mean() - 1.0f) > 0.01f) {
+        std::cerr << "Bulk exponential fill has the wrong statistics\n";
+        --rtn;
+    }
+
+    // The portable exp and log agree with std:: to a few ulp
+    double maxerr = 0.0;
+    for (int i = 1; i < 10000; ++i) {
+        const double u = i / 10000.0;
+        maxerr = std::max (maxerr, std::abs (morph::ziggurat::log (u) - std::log (u)) / std::abs (std::log (u)));
+        maxerr = std::max (maxerr, std::abs (morph::ziggurat::exp (-20.0 * u) - std::exp (-20.0 * u)) / std::exp (-20.0 * u));
+    }
+    if (maxerr > 1e-15) { std::cerr << "ziggurat::exp/log error " << maxerr << std::endl; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
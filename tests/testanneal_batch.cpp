@@ -0,0 +1,78 @@
+/*
+ * Test Anneal's batch mode (batch_size > 1, with the batch computed in parallel by
+ * Anneal::compute) and AnnealEnsemble, on the Rosenbrock banana function.
+ */
+#include "morph/Anneal.h"
+#include "morph/AnnealEnsemble.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <atomic>
+
+double banana (const morph::vvec<double>& xy)
+{
+    const double a = 1.0;
+    const double b = 100.0;
+    return (a - xy[0]) * (a - xy[0]) + b * (xy[1] - xy[0] * xy[0]) * (xy[1] - xy[0] * xy[0]);
+}
+
+void set_params (morph::Anneal<double>& a)
+{
+    a.temperature_ratio_scale = 1e-3;
+    a.temperature_anneal_scale = 200;
+    a.cost_parameter_scale_ratio = 1.5;
+    a.acc_gen_reanneal_ratio = 1e-3;
+    a.f_x_best_repeat_max = 15;
+    a.display_temperatures = false;
+    a.display_reanneal = false;
+}
+
+int main()
+{
+    int rtn = 0;
+    morph::vvec<double> p = { 0.5, -0.5 };
+    morph::vvec<morph::vec<double, 2>> p_rng = {{ {-1.1, 1.1}, {-1.1, 1.1} }};
+    std::atomic<unsigned int> ncalls = 0;
+    auto objective = [&ncalls](const morph::vvec<double>& x) { ++ncalls; return banana (x); };
+
+    // Batch mode, driven by hand to check the states
+    morph::Anneal<double> anneal (p, p_rng);
+    set_params (anneal);
+    anneal.batch_size = 8;
+    anneal.init();
+    if (anneal.state != morph::Anneal_State::NeedToComputeBatch || anneal.x_cands.size() != 8) {
+        std::cerr << "Expected a batch of 8 after init()\n";
+        --rtn;
+    }
+    while (anneal.state != morph::Anneal_State::ReadyToStop) {
+        if (anneal.state == morph::Anneal_State::NeedToComputeBatch && anneal.x_cands.size() != 8) {
+            std::cerr << "Wrong batch size\n";
+            --rtn;
+            break;
+        }
+        anneal.compute (objective);
+        anneal.step();
+    }
+    std::cout << "Batch mode: f_x_best = " << anneal.f_x_best << " at " << anneal.x_best
+              << " after " << anneal.steps << " steps and " << ncalls << " objective calls\n";
+    if (anneal.f_x_hist.size() != anneal.T_k_hist.size()) { std::cerr << "History lengths differ\n"; --rtn; }
+    if (anneal.f_x_best != banana (anneal.x_best)) { std::cerr << "f_x_best does not match x_best\n"; --rtn; }
+    if (anneal.f_x_best > 0.1) { std::cerr << "Batch mode did not get near the minimum\n"; --rtn; }
+
+    // The ensemble
+    ncalls = 0;
+    morph::AnnealEnsemble<double> ens (p, p_rng, 4);
+    for (auto& a : ens.members) { set_params (a); }
+    ens.run (objective);
+    std::cout << "Ensemble: f_x_best = " << ens.f_x_best << " at " << ens.x_best
+              << " (member " << ens.best_member << ") after " << ncalls << " objective calls\n";
+    for (auto& a : ens.members) {
+        if (a.state != morph::Anneal_State::ReadyToStop) { std::cerr << "A member did not finish\n"; --rtn; }
+        if (a.f_x_best < ens.f_x_best) { std::cerr << "A member beat the ensemble best\n"; --rtn; }
+    }
+    if (ens.x_best.size() != 2 || ens.f_x_best != banana (ens.x_best)) { std::cerr << "Ensemble best is inconsistent\n"; --rtn; }
+    if (ens.f_x_best > 0.1) { std::cerr << "The ensemble did not get near the minimum\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
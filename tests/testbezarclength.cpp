@@ -0,0 +1,101 @@
+/*
+ * Test the arc length tables and the fast evaluations of BezCurve, and the cached points
+ * of BezCurvePath.
+ */
+#include "morph/BezCurve.h"
+#include "morph/BezCurvePath.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using morph::BezCurve;
+using morph::BezCoord;
+using morph::vec;
+
+// The length of c from t=0 to t=t1, summing the chords between many points
+float chord_length (const BezCurve<float>& c, const float t1 = 1.0f)
+{
+    constexpr int n = 20000;
+    float len = 0.0f;
+    BezCoord<float> a = c.computePoint (0.0f);
+    for (int i = 1; i <= n; ++i) {
+        BezCoord<float> b = c.computePoint (i == n ? t1 : t1 * i / n);
+        len += (b.coord - a.coord).length();
+        a = b;
+    }
+    return len;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    vec<float, 2> p0 = { 1.0f, 1.0f };
+    vec<float, 2> p1 = { 4.0f, 5.0f };
+    vec<float, 2> c1 = { 1.0f, 4.0f };
+    vec<float, 2> c2 = { 5.0f, 1.0f };
+    BezCurve<float> cubic (p0, p1, c1, c2);
+    BezCurve<float> quad (p0, p1, c1);
+    BezCurve<float> quartic (p0, p1, morph::vvec<vec<float, 2>>{ c1, c2, { 2.0f, 6.0f } });
+    BezCurve<float> line (p0, p1);
+    cubic.setScale (0.5f);
+
+    for (const BezCurve<float>* c : { &cubic, &quad, &quartic, &line }) {
+        // The table's length is close to the length from many chords
+        const float len = c->getArcLength();
+        const float ref = chord_length (*c);
+        if (std::abs (len - ref) > 1e-3f * ref) {
+            std::cerr << "Order " << c->getOrder() << ": arc length " << len << " should be " << ref << "\n";
+            --rtn;
+        }
+        // The tangent fast path gives the derivative's direction
+        for (float t : { 0.0f, 0.3f, 0.77f, 1.0f }) {
+            BezCoord<float> tn = c->computeTangentNormal (t).first;
+            BezCoord<float> d = c->getOrder() == 1 ? c->computePoint (t) : c->derivative().computePoint (t);
+            d.normalize();
+            if (tn.coord != d.coord) { std::cerr << "Order " << c->getOrder() << ": tangent differs at t=" << t << "\n"; --rtn; }
+        }
+        // Points by arc length are evenly spaced along the curve
+        const float l = len / 9.5f;
+        std::vector<BezCoord<float>> pts = c->computePointsByArcLength (l);
+        if (pts.size() != 10 || !pts.back().isNull() || std::abs (pts.back().getRemaining() - 0.5f * l) > 1e-4f * len) {
+            std::cerr << "Order " << c->getOrder() << ": wrong points by arc length\n";
+            --rtn;
+        }
+        for (std::size_t i = 0; i + 1 < pts.size(); ++i) {
+            const float s = chord_length (*c, pts[i].t());
+            if (std::abs (s - (i + 1) * l) > 2e-3f * len) { std::cerr << "Order " << c->getOrder() << ": uneven spacing\n"; --rtn; }
+        }
+    }
+    if (std::abs (line.computeParamAtLength (0.25f * line.getArcLength()) - 0.25f) > 1e-6f) {
+        std::cerr << "A line's parameter is not proportional to length\n";
+        --rtn;
+    }
+
+    // BezCurvePath keeps its points until the step or the curves change
+    morph::BezCurvePath<float> path;
+    path.addCurve (quad);
+    BezCurve<float> next (p1, { 8.0f, 2.0f }, { 6.0f, 6.0f }, { 7.0f, 0.0f });
+    path.addCurve (next);
+    path.computePoints (0.2f, true);
+    std::vector<BezCoord<float>> first = path.points;
+    path.points[0].coord = { 100.0f, 100.0f };
+    path.computePoints (0.2f, true);
+    if (path.points[0].coord[0] != 100.0f) { std::cerr << "computePoints recomputed unchanged points\n"; --rtn; }
+    path.computePoints (0.1f, true);
+    const std::size_t n_fine = path.points.size();
+    path.computePoints (0.2f, true);
+    if (path.points.size() != first.size() || path.points[0].coord != first[0].coord) { std::cerr << "Cached points are stale\n"; --rtn; }
+    if (n_fine < 2 * first.size() - 2) { std::cerr << "Halving the step did not double the points\n"; --rtn; }
+    path.setScale (2.0f);
+    path.computePoints (0.2f, true);
+    if (path.points.size() < 2 * first.size() - 2) { std::cerr << "Scaling did not invalidate the cached points\n"; --rtn; }
+    path.computePointsByArcLength (0.2f, true);
+    if (path.points.size() != path.tangents.size() || path.points.size() < 2 * first.size() - 2) {
+        std::cerr << "computePointsByArcLength gave the wrong points\n";
+        --rtn;
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,103 @@
+/*
+ * Test BezCurve::fitCubic, the least squares cubic fit, and BezCurvePath::fitCubics, which
+ * fits the segments of a path in parallel.
+ */
+#include "morph/BezCurve.h"
+#include "morph/BezCurvePath.h"
+#include "morph/mathconst.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+    using mc = morph::mathconst<double>;
+
+    // Points on a known cubic, at unevenly spaced t, are fitted by that cubic
+    {
+        morph::vec<double, 2> c0 = { 0.0, 0.0 };
+        morph::vec<double, 2> c1 = { 1.0, 2.0 };
+        morph::vec<double, 2> c2 = { 3.0, -1.0 };
+        morph::vec<double, 2> c3 = { 4.0, 1.0 };
+        morph::BezCurve<double> known (c0, c3, c1, c2);
+        morph::vvec<morph::vec<double, 2>> pts;
+        for (int i = 0; i <= 40; ++i) {
+            double t = static_cast<double>(i) / 40.0;
+            pts.push_back (known.computePoint (t * t * (3.0 - 2.0 * t)).coord);
+        }
+        morph::BezCurve<double> cv;
+        double sos = cv.fitCubic (pts, 100);
+        morph::vvec<morph::vec<double, 2>> ctrl = cv.getControls();
+        double cerr = 0.0;
+        cerr = std::max (cerr, (ctrl[1] - c1).length());
+        cerr = std::max (cerr, (ctrl[2] - c2).length());
+        std::cout << "Known cubic: sum of squares " << sos << ", control point error " << cerr << "\n";
+        if (cv.getOrder() != 3 || sos > 1e-8 || cerr > 1e-3 || (ctrl[0] - c0).length() > 0.0 || (ctrl[3] - c3).length() > 0.0) {
+            --rtn;
+        }
+        // Reparameterisation reduces the error of the chord length parameterisation
+        morph::BezCurve<double> cv0;
+        double sos0 = cv0.fitCubic (pts, 0);
+        if (!(sos < sos0)) {
+            std::cout << "Newton-Raphson did not improve the fit (" << sos0 << " -> " << sos << ")\n";
+            --rtn;
+        }
+    }
+
+    // Two points make a straight line
+    {
+        morph::vvec<morph::vec<float, 2>> pts = { { 0.0f, 0.0f }, { 3.0f, 3.0f } };
+        morph::BezCurve<float> cv;
+        cv.fitCubic (pts);
+        morph::vec<float, 2> mid = cv.computePoint (0.5f).coord;
+        if ((mid - morph::vec<float, 2>{ 1.5f, 1.5f }).length() > 1e-5f) { --rtn; }
+    }
+
+    // A circle of 400 points, fitted with 8 cubics in parallel
+    {
+        const std::size_t n = 400;
+        std::vector<morph::vec<double, 2>> pts (n + 1);
+        for (std::size_t i = 0; i <= n; ++i) {
+            double a = mc::two_pi * static_cast<double>(i) / n;
+            pts[i] = { std::cos (a), std::sin (a) };
+        }
+        std::vector<std::size_t> joins;
+        for (std::size_t k = 1; k < 8; ++k) { joins.push_back (k * n / 8); }
+
+        morph::BezCurvePath<double> path;
+        double sos = path.fitCubics (pts, joins);
+        std::cout << "Circle: " << path.curves.size() << " curves, sum of squares " << sos << "\n";
+        if (path.curves.size() != 8 || sos > 1e-5) { --rtn; }
+
+        // The same as fitting each segment in turn, joined end to end
+        double maxdiff = 0.0;
+        std::size_t start = 0;
+        auto ci = path.curves.begin();
+        for (std::size_t k = 0; k < 8; ++k, ++ci) {
+            const std::size_t end = k < 7 ? joins[k] : n;
+            morph::BezCurve<double> cv;
+            cv.fitCubic (std::span<const morph::vec<double, 2>> (pts).subspan (start, end - start + 1));
+            morph::vvec<morph::vec<double, 2>> a = cv.getControls();
+            morph::vvec<morph::vec<double, 2>> b = ci->getControls();
+            for (unsigned int j = 0; j < 4; ++j) { maxdiff = std::max (maxdiff, (a[j] - b[j]).length()); }
+            start = end;
+        }
+        if (maxdiff > 0.0) {
+            std::cout << "Parallel fit differs from serial fit by " << maxdiff << "\n";
+            --rtn;
+        }
+
+        // Points computed along the path lie on the circle
+        path.computePoints (0.01);
+        double rerr = 0.0;
+        for (const morph::BezCoord<double>& bc : path.points) { rerr = std::max (rerr, std::abs (bc.coord.length() - 1.0)); }
+        std::cout << "Largest distance of the path from the circle: " << rerr << "\n";
+        if (rerr > 1e-3) { --rtn; }
+    }
+
+    std::cout << "testbezfit_cubic " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
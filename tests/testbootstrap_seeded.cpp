@@ -0,0 +1,98 @@
+// Test that seeded bootstraps are reproducible, whatever the number of threads, and that they
+// give the expected standard errors.
+
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <morph/vvec.h>
+#include <morph/bootstrap.h>
+#include <morph/Random.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+int main()
+{
+    int rtn = 0;
+
+    morph::RandNormal<double, std::mt19937_64> rnorm (5, 1, 42);
+    morph::vvec<double> nd;
+    nd.set_from (rnorm.get (1000));
+
+    // The same seed gives the same result
+    double eom1 = morph::bootstrap<double>::error_of_mean (nd, 2000, 17);
+    double eom2 = morph::bootstrap<double>::error_of_mean (nd, 2000, 17);
+    if (eom1 != eom2) {
+        std::cerr << "error_of_mean with the same seed differs: " << eom1 << " vs " << eom2 << "\n";
+        --rtn;
+    }
+    // ...and a different seed a (slightly) different result
+    double eom3 = morph::bootstrap<double>::error_of_mean (nd, 2000, 18);
+    if (eom3 == eom1) {
+        std::cerr << "error_of_mean with a different seed is identical\n";
+        --rtn;
+    }
+
+    // The result does not depend on the number of threads
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
+    omp_set_num_threads (3);
+    double eom_3t = morph::bootstrap<double>::error_of_mean (nd, 2000, 17);
+    double eos_3t = morph::bootstrap<double>::error_of_std (nd, 2000, 17);
+    omp_set_num_threads (1);
+    double eos_1t = morph::bootstrap<double>::error_of_std (nd, 2000, 17);
+    omp_set_num_threads (nthreads);
+    if (eom_3t != eom1 || eos_3t != eos_1t) {
+        std::cerr << "Seeded bootstrap depends on the number of threads\n";
+        --rtn;
+    }
+#endif
+
+    // Compare with the parametric standard errors. For normal data, the SE of the mean is
+    // sigma/sqrt(n) and the SE of the SD is about sigma/sqrt(2(n-1)).
+    auto t0 = std::chrono::steady_clock::now();
+    double eom = morph::bootstrap<double>::error_of_mean (nd, 100000, 1);
+    auto t1 = std::chrono::steady_clock::now();
+    double eos = morph::bootstrap<double>::error_of_std (nd, 100000, 1);
+    std::cout << "B=1e5 error_of_mean took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() << " ms\n";
+    double se_mean = nd.std() / std::sqrt (static_cast<double>(nd.size()));
+    double se_std = nd.std() / std::sqrt (2.0 * (nd.size() - 1));
+    std::cout << "error_of_mean: " << eom << " (expect " << se_mean << ")\n";
+    std::cout << "error_of_std: " << eos << " (expect " << se_std << ")\n";
+    if (std::abs (eom - se_mean) > 0.03 * se_mean) {
+        std::cerr << "error_of_mean is far from sigma/sqrt(n)\n";
+        --rtn;
+    }
+    if (std::abs (eos - se_std) > 0.1 * se_std) {
+        std::cerr << "error_of_std is far from sigma/sqrt(2(n-1))\n";
+        --rtn;
+    }
+
+    // The t-test: reproducible, small ASL for different means and not small for equal means
+    morph::RandNormal<double, std::mt19937_64> rnorm_diff (5.5, 1, 43);
+    morph::vvec<double> nd_diff;
+    nd_diff.set_from (rnorm_diff.get (1000));
+    morph::vec<double, 2> asl_a = morph::bootstrap<double>::ttest_equalityofmeans (nd, nd_diff, 4000, 5);
+    morph::vec<double, 2> asl_b = morph::bootstrap<double>::ttest_equalityofmeans (nd, nd_diff, 4000, 5);
+    if (asl_a != asl_b) {
+        std::cerr << "ttest_equalityofmeans with the same seed differs\n";
+        --rtn;
+    }
+    if (asl_a[0] > asl_a[1]) {
+        std::cerr << "ASL for different means is " << asl_a[0] << " which is too big\n";
+        --rtn;
+    }
+    morph::RandNormal<double, std::mt19937_64> rnorm_same (5.0, 1.5, 44);
+    morph::vvec<double> nd_same;
+    nd_same.set_from (rnorm_same.get (1000));
+    morph::vec<double, 2> asl_s = morph::bootstrap<double>::ttest_equalityofmeans (nd, nd_same, 4000, 5);
+    std::cout << "ASL for the same means: " << asl_s[0] << "\n";
+    if (asl_s[0] < 0.001) {
+        std::cerr << "ASL for equal means is " << asl_s[0] << " which is too small\n";
+        --rtn;
+    }
+
+    std::cout << "testbootstrap_seeded " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
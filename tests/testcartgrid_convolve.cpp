@@ -0,0 +1,69 @@
+// Test CartGrid::convolve_separable against CartGrid::convolve with the equivalent 2D kernel, and
+// CartGrid::boxfilter against a direct box filter
+
+#include <morph/CartGrid.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+int main()
+{
+    int rtn = 0;
+
+    // A 40x30 grid
+    morph::CartGrid cg (0.01f, 0.01f, 0.0f, 0.0f, 40*0.01f-0.01f, 30*0.01f-0.01f);
+    cg.setBoundaryOnOuterEdge();
+
+    morph::vvec<float> data (cg.num());
+    data.randomize();
+
+    // Asymmetric kernels, so that a transposed or mirrored kernel would be detected
+    morph::vvec<float> kx = { 0.1f, 0.2f, 0.4f, 0.2f, 0.05f };
+    morph::vvec<float> ky = { 0.5f, 0.3f, 0.15f };
+
+    // The equivalent 2D kernel on a 5x3 kernel CartGrid centred on 0
+    morph::CartGrid kernel (0.01f, 0.01f, -0.02f, -0.01f, 0.02f, 0.01f);
+    kernel.setBoundaryOnOuterEdge();
+    morph::vvec<float> kdata (kernel.num());
+    for (auto& k : kernel.rects) { kdata[k.vi] = kx[k.xi + 2] * ky[k.yi + 1]; }
+
+    morph::vvec<float> expected (cg.num(), 0.0f);
+    cg.convolve (kernel, kdata, data, expected);
+
+    morph::vvec<float> result (cg.num(), 0.0f);
+    cg.convolve_separable (kx, ky, data, result);
+
+    float maxerr = (result - expected).abs().max();
+    std::cout << "Max difference between convolve and convolve_separable: " << maxerr << std::endl;
+    if (maxerr > 1e-5f) { --rtn; }
+
+    // Even-sized kernels are rejected
+    try {
+        morph::vvec<float> keven = { 0.5f, 0.5f };
+        cg.convolve_separable (keven, ky, data, result);
+        --rtn;
+    } catch (const std::exception&) {}
+
+    // boxfilter on the (unwrapped) rectangular grid, with an even box of side 4 which covers
+    // x-1 to x+2 and y-1 to y+2, clipped at the edges.
+    morph::vvec<float> boxed (cg.num(), 0.0f);
+    cg.boxfilter<float> (data, boxed, 4);
+    const int w = 40;
+    const int h = 30;
+    float maxboxerr = 0.0f;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            float s = 0.0f;
+            for (int yy = std::max (0, y - 1); yy <= std::min (h - 1, y + 2); ++yy) {
+                for (int xx = std::max (0, x - 1); xx <= std::min (w - 1, x + 2); ++xx) { s += data[yy * w + xx]; }
+            }
+            maxboxerr = std::max (maxboxerr, std::abs (s / 16.0f - boxed[y * w + x]));
+        }
+    }
+    std::cout << "Max difference between boxfilter and direct box filter: " << maxboxerr << std::endl;
+    if (maxboxerr > 1e-5f) { --rtn; }
+
+    std::cout << "testcartgrid_convolve " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,71 @@
+// Test CartGrid::resampleToPolar with a stencil from CartGrid::makePolarStencil against a direct
+// computation: a Gaussian weighted mean over the 3x3 pixels around the pixel nearest each sample
+
+#include <morph/CartGrid.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+int main()
+{
+    int rtn = 0;
+
+    // A 61x41 image grid
+    morph::CartGrid cg (0.02f, 0.02f, -0.6f, -0.4f, 0.6f, 0.4f);
+    cg.setBoundaryOnOuterEdge();
+    morph::vvec<float> img (cg.num());
+    for (unsigned int i = 0; i < cg.num(); ++i) { img[i] = std::sin (11.0f * cg.d_x[i]) * std::cos (7.0f * cg.d_y[i]) + 1.0f; }
+
+    // The polar grid, phi along x (which must have an odd number of columns) and r along y
+    morph::CartGrid cp_even (0.04f, 0.02f, 0.0f, 0.0f, 1.16f, 0.5f);
+    cp_even.setBoundaryOnOuterEdge();
+    bool threw = false;
+    try { cg.makePolarStencil (cp_even); } catch (const std::exception&) { threw = true; }
+    if (!threw) { std::cout << "Expected an even width polar grid to be rejected\n"; --rtn; }
+    morph::CartGrid cp (0.04f, 0.02f, -0.6f, 0.0f, 0.6f, 0.5f);
+    cp.setBoundaryOnOuterEdge();
+
+    const float assumecirc = 1.0f / (2.0f * 0.02f * 0.02f);
+    morph::CartGrid::polar_stencil st = cg.makePolarStencil (cp);
+    morph::vvec<float> polar;
+    float maxerr = 0.0f;
+    unsigned int n_inside = 0;
+    for (float angle : { 0.0f, 0.7f, -2.0f }) {
+        morph::vec<float, 2> view = { 0.103f, -0.047f }; // away from the midpoints between pixels
+        cg.resampleToPolar (img, st, polar, view, angle);
+        if (polar.size() != cp.num()) { std::cout << "polar data has the wrong size\n"; --rtn; break; }
+        for (unsigned int i = 0; i < cp.num(); ++i) {
+            const float phi = cp.d_x[i] * morph::mathconst<float>::two_pi / (1.2f + 0.04f) + angle;
+            const float x = cp.d_y[i] * std::cos (phi) + view[0];
+            const float y = cp.d_y[i] * std::sin (phi) + view[1];
+            float expected = 0.0f;
+            if (x >= -0.6f && x <= 0.6f && y >= -0.4f && y <= 0.4f) {
+                ++n_inside;
+                unsigned int nearest = 0;
+                float dmin = std::numeric_limits<float>::max();
+                for (unsigned int j = 0; j < cg.num(); ++j) {
+                    const float d = std::hypot (cg.d_x[j] - x, cg.d_y[j] - y);
+                    if (d < dmin) { dmin = d; nearest = j; }
+                }
+                float sum = 0.0f;
+                float n = 0.0f;
+                for (unsigned int j = 0; j < cg.num(); ++j) {
+                    if (std::abs (cg.d_x[j] - cg.d_x[nearest]) < 0.03f && std::abs (cg.d_y[j] - cg.d_y[nearest]) < 0.03f) {
+                        const float dx = x - cg.d_x[j];
+                        const float dy = y - cg.d_y[j];
+                        sum += std::exp (-assumecirc * (dx * dx + dy * dy)) * img[j];
+                        n += 1.0f;
+                    }
+                }
+                expected = sum / n;
+            }
+            maxerr = std::max (maxerr, std::abs (polar[i] - expected));
+        }
+    }
+    std::cout << n_inside << " samples inside the image; max error " << maxerr << std::endl;
+    if (n_inside == 0 || maxerr > 1e-5f) { --rtn; }
+
+    return rtn;
+}
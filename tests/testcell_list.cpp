@@ -0,0 +1,78 @@
+/*
+ * Test morph::cell_list neighbour queries against a brute force search over all points.
+ */
+#include "morph/cell_list.h"
+#include "morph/vec.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+
+// The indices of the points within radius of x, by looping over them all
+template <typename F, std::size_t N>
+std::vector<unsigned int> brute (const std::vector<morph::vec<F, N>>& pts, const morph::vec<F, N>& x, const F radius)
+{
+    std::vector<unsigned int> found;
+    for (unsigned int i = 0; i < pts.size(); ++i) {
+        if ((pts[i] - x).sos() <= radius * radius) { found.push_back (i); }
+    }
+    return found;
+}
+
+int main()
+{
+    int rtn = 0;
+    morph::RandUniform<float> rng (-0.2f, 1.2f, 42);
+
+    // 2D points, queried at the points themselves and at random locations, some off the grid
+    std::vector<morph::vec<float, 2>> pts (3000);
+    for (auto& p : pts) { p = { rng.get(), rng.get() }; }
+    morph::cell_list<float, 2> cells;
+    cells.build (pts, 0.1f);
+    if (cells.size() != pts.size()) { std::cout << "size is wrong\n"; --rtn; }
+    std::vector<unsigned int> found;
+    for (unsigned int i = 0; i < 500 && rtn == 0; ++i) {
+        morph::vec<float, 2> x = i % 2 ? pts[i] : morph::vec<float, 2>{ 2.0f * rng.get() - 0.5f, 2.0f * rng.get() - 0.5f };
+        for (float radius : { 0.0f, 0.05f, 0.1f, 0.25f }) {
+            cells.within (x, radius, found);
+            if (found != brute (pts, x, radius)) { std::cout << "2D query " << i << " radius " << radius << " differs\n"; --rtn; }
+        }
+    }
+
+    // for_each_within reports the stored locations
+    unsigned int visits = 0;
+    cells.for_each_within (pts[7], 0.1f, [&](unsigned int i, const morph::vec<float, 2>& p) {
+        if (p != pts[i]) { std::cout << "for_each_within location is wrong\n"; --rtn; }
+        ++visits;
+    });
+    if (visits != brute (pts, pts[7], 0.1f).size()) { std::cout << "for_each_within count is wrong\n"; --rtn; }
+
+    // A far outlier makes the grid grow its cells, but queries are still exact
+    pts.push_back ({ 1e6f, -1e6f });
+    cells.build (pts, 0.1f);
+    if (cells.num_cells() > 4 * pts.size() + 64) { std::cout << "too many cells: " << cells.num_cells() << std::endl; --rtn; }
+    if (!(cells.cell_side() > 0.1f)) { std::cout << "cell side did not grow\n"; --rtn; }
+    for (unsigned int i = 0; i < 100 && rtn == 0; ++i) {
+        cells.within (pts[i], 0.1f, found);
+        if (found != brute (pts, pts[i], 0.1f)) { std::cout << "query with outlier differs\n"; --rtn; }
+    }
+
+    // 3D points
+    std::vector<morph::vec<double, 3>> p3 (2000);
+    morph::RandUniform<double> rngd (0.0, 1.0, 7);
+    for (auto& p : p3) { p = { rngd.get(), rngd.get(), rngd.get() }; }
+    morph::cell_list<double, 3> c3;
+    c3.build (p3, 0.15);
+    for (unsigned int i = 0; i < 200 && rtn == 0; ++i) {
+        c3.within (p3[i], 0.15, found);
+        if (found != brute (p3, p3[i], 0.15)) { std::cout << "3D query differs\n"; --rtn; }
+    }
+
+    // No points
+    morph::cell_list<float, 2> empty;
+    empty.build (std::vector<morph::vec<float, 2>>{}, 1.0f);
+    empty.within ({ 0.0f, 0.0f }, 1.0f, found);
+    if (!found.empty()) { std::cout << "empty cell list found points\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,124 @@
+// Test morph::chunkstore, the directory-of-chunks (Zarr v2) array store
+#include <vector>
+#include <array>
+#include <deque>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <morph/chunkstore.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+
+int main()
+{
+    int rtn = 0;
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "testchunkstore.zarr";
+    std::filesystem::remove_all (root);
+
+    morph::vvec<double> d (100003);
+    d.linspace (-1.0, 1.0, d.size());
+    std::vector<morph::vec<float, 3>> coords (1001);
+    for (std::size_t i = 0; i < coords.size(); ++i) { coords[i] = { float(i), 2.0f * i, -1.0f * i }; }
+    std::deque<int> ints = { 3, 1, 4, 1, 5, 9, 2, 6 };
+
+    {
+        morph::chunkstore cs (root.string());
+        cs.chunk_elements = 1000; // many chunks, with a partial one at the end
+        cs.add_contained_vals ("/d", d);
+        cs.add_contained_vals ("/g/coords", coords);
+        cs.compress = false;
+        cs.add_contained_vals ("/g/h/ints", ints);
+        cs.add_val ("/g/dt", 0.25);
+
+        // A 2D array written a chunk at a time from several threads
+        cs.compress = true;
+        cs.create_array<std::uint16_t> ("/img", { 100, 130 }, { 32, 32 });
+        const morph::chunkstore::array_info ai = cs.info ("/img");
+        const std::vector<std::size_t> grid = ai.grid();
+        std::vector<std::thread> writers;
+        for (std::size_t r = 0; r < grid[0]; ++r) {
+            writers.emplace_back ([&, r] {
+                std::vector<std::uint16_t> chunk (ai.chunk_size());
+                for (std::size_t c = 0; c < grid[1]; ++c) {
+                    for (std::size_t i = 0; i < 32; ++i) {
+                        for (std::size_t j = 0; j < 32; ++j) { chunk[i * 32 + j] = static_cast<std::uint16_t>((r * 32 + i) * 1000 + c * 32 + j); }
+                    }
+                    if (c != 1) { cs.write_chunk ("/img", { r, c }, chunk.data()); } // leave one column of chunks unwritten
+                }
+            });
+        }
+        for (auto& w : writers) { w.join(); }
+    }
+
+    // The layout is Zarr's
+    if (!std::filesystem::exists (root / ".zgroup") || !std::filesystem::exists (root / "g" / ".zgroup")
+        || !std::filesystem::exists (root / "d" / ".zarray") || !std::filesystem::exists (root / "d" / "100")
+        || !std::filesystem::exists (root / "img" / "3.4") || std::filesystem::exists (root / "img" / "0.1")) {
+        std::cout << "Unexpected store layout\n";
+        --rtn;
+    }
+
+    {
+        morph::chunkstore cs (root.string(), true);
+        morph::vvec<double> d2;
+        cs.read_contained_vals ("/d", d2);
+        if (d2 != d) { std::cout << "/d read back wrongly\n"; --rtn; }
+
+        std::vector<morph::vec<float, 3>> c2;
+        cs.read_contained_vals ("/g/coords", c2);
+        if (c2 != coords) { std::cout << "/g/coords read back wrongly\n"; --rtn; }
+        std::vector<std::array<double, 3>> c3; // converted from float
+        cs.read_contained_vals ("/g/coords", c3);
+        if (c3.size() != coords.size() || c3[1000][1] != 2000.0) { --rtn; }
+
+        std::vector<long long int> i2;
+        cs.read_contained_vals ("/g/h/ints", i2);
+        if (i2.size() != ints.size() || i2[5] != 9) { --rtn; }
+        double dt = 0.0;
+        cs.read_val ("/g/dt", dt);
+        if (dt != 0.25) { --rtn; }
+        if (cs.info ("/g/h/ints").dtype != morph::chunkstore::dtype<int>() || cs.info ("/g/h/ints").compressed) { --rtn; }
+
+        // A slice across chunk boundaries, including the unwritten chunks (which read as zeros)
+        std::vector<std::uint16_t> s;
+        cs.read_slice ("/img", { 30, 20 }, { 40, 100 }, s);
+        for (std::size_t i = 0; i < 40 && rtn == 0; ++i) {
+            for (std::size_t j = 0; j < 100; ++j) {
+                const std::size_t r = 30 + i, c = 20 + j;
+                const std::uint16_t expect = (c >= 32 && c < 64) ? 0 : static_cast<std::uint16_t>(r * 1000 + c);
+                if (s[i * 100 + j] != expect) {
+                    std::cout << "Slice element (" << r << "," << c << ") is " << s[i * 100 + j] << " not " << expect << "\n";
+                    --rtn;
+                    break;
+                }
+            }
+        }
+
+        try {
+            cs.add_val ("/x", 1);
+            std::cout << "Expected an exception writing to a read only store\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+        try {
+            cs.read_contained_vals ("/nothere", d2);
+            --rtn;
+        } catch (const std::runtime_error&) {}
+    }
+
+    // A truncated chunk is an error, not bad data
+    {
+        std::filesystem::resize_file (root / "d" / "3", 10);
+        morph::chunkstore cs (root.string(), true);
+        morph::vvec<double> d2;
+        try {
+            cs.read_contained_vals ("/d", d2);
+            std::cout << "Expected an exception reading a truncated chunk\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+    }
+
+    std::filesystem::remove_all (root);
+    std::cout << "testchunkstore " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
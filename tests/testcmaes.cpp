@@ -0,0 +1,126 @@
+/*
+ * Test CMAES: an ill-conditioned ellipsoid and the Rosenbrock function in 10 dimensions, the
+ * multimodal Rastrigin function with IPOP and BIPOP restarts, and the saved history.
+ */
+#include "morph/CMAES.h"
+#include "morph/HdfData.h"
+#include "morph/vvec.h"
+#include "morph/mathconst.h"
+#include <iostream>
+#include <atomic>
+#include <cmath>
+
+double ellipsoid (const morph::vvec<double>& x)
+{
+    double f = 0.0;
+    for (std::size_t i = 0; i < x.size(); ++i) { f += std::pow (1e6, static_cast<double>(i) / (x.size() - 1)) * x[i] * x[i]; }
+    return f;
+}
+
+double rosenbrock (const morph::vvec<double>& x)
+{
+    double f = 0.0;
+    for (std::size_t i = 0; i + 1 < x.size(); ++i) {
+        f += (1.0 - x[i]) * (1.0 - x[i]) + 100.0 * (x[i + 1] - x[i] * x[i]) * (x[i + 1] - x[i] * x[i]);
+    }
+    return f;
+}
+
+double rastrigin (const morph::vvec<double>& x)
+{
+    double f = 10.0 * x.size();
+    for (auto xi : x) { f += xi * xi - 10.0 * std::cos (morph::mathconst<double>::two_pi * xi); }
+    return f;
+}
+
+int main()
+{
+    int rtn = 0;
+    std::atomic<unsigned long long int> ncalls = 0;
+
+    // The ellipsoid, driven by hand to check the states, without restarts
+    {
+        morph::CMAES<double> es (morph::vvec<double>(10, 1.0), 1u);
+        es.restart = morph::CMAES_Restart::None;
+        es.sigma0 = 0.5;
+        es.init();
+        if (es.state != morph::CMAES_State::NeedToComputeBatch || es.x_cands.size() != 10) {
+            std::cerr << "Expected a population of 10 after init()\n";
+            --rtn;
+        }
+        while (es.state != morph::CMAES_State::ReadyToStop) {
+            es.compute ([&ncalls](const morph::vvec<double>& x) { ++ncalls; return ellipsoid (x); });
+            es.step();
+        }
+        std::cout << "Ellipsoid: f_x_best = " << es.f_x_best << " after " << es.evaluations
+                  << " evaluations, stopped by " << static_cast<int>(es.reason_for_exit) << "\n";
+        if (es.evaluations != ncalls) { std::cerr << "evaluations miscounted\n"; --rtn; }
+        if (es.f_x_best > 1e-10) { std::cerr << "The ellipsoid was not minimised\n"; --rtn; }
+        if (es.restarts != 0 || es.f_x_best_hist.size() != es.generations) { --rtn; }
+        // C has learned the scaling: its axes lengths differ by about the 1000 of the ellipsoid
+        const double cond = std::sqrt (es.eigvals.max() / es.eigvals.min());
+        if (cond < 100.0) { std::cerr << "C did not adapt (axis ratio " << cond << ")\n"; --rtn; }
+    }
+
+    // Rosenbrock, to a target
+    {
+        morph::CMAES<double> es (morph::vvec<double>(10, 0.0), 2u);
+        es.stop_at_target = true;
+        es.target = 1e-8;
+        es.init();
+        es.run ([](const morph::vvec<double>& x) { return rosenbrock (x); });
+        std::cout << "Rosenbrock: f_x_best = " << es.f_x_best << " after " << es.evaluations << " evaluations\n";
+        if (es.reason_for_exit != morph::CMAES_StopCondition::TargetReached || (es.x_best - 1.0).abs().max() > 1e-3) {
+            std::cerr << "Rosenbrock was not minimised\n";
+            --rtn;
+        }
+    }
+
+    // Rastrigin, within ranges, with IPOP and with BIPOP restarts
+    for (auto strategy : { morph::CMAES_Restart::IPOP, morph::CMAES_Restart::BIPOP }) {
+        morph::vvec<morph::vec<double, 2>> ranges (5, { -5.0, 5.0 });
+        morph::CMAES<double> es (morph::vvec<double>(5, 3.0), ranges, 3u);
+        es.restart = strategy;
+        es.stop_at_target = true;
+        es.target = 1e-6;
+        es.max_evaluations = 200000;
+        es.save_populations = true;
+        es.init();
+        bool in_range = true;
+        es.run ([&in_range](const morph::vvec<double>& x) {
+            if (x.max() > 5.0 || x.min() < -5.0) { in_range = false; }
+            return rastrigin (x);
+        });
+        const char* name = strategy == morph::CMAES_Restart::IPOP ? "IPOP" : "BIPOP";
+        std::cout << name << " Rastrigin: f_x_best = " << es.f_x_best << " after " << es.evaluations
+                  << " evaluations and " << es.restarts << " restarts; lambdas";
+        for (auto g : es.restart_generations) { std::cout << " " << es.lambda_hist[g]; }
+        std::cout << "\n";
+        if (!in_range) { std::cerr << "A candidate left the ranges\n"; --rtn; }
+        if (es.f_x_best > 1e-6) { std::cerr << name << " did not find the global minimum\n"; --rtn; }
+        if (es.restarts == 0 || es.restart_generations.size() != es.restarts) { std::cerr << "Expected restarts\n"; --rtn; }
+        if (strategy == morph::CMAES_Restart::IPOP && es.restarts > 1
+            && es.lambda_hist[es.restart_generations[1]] != 2 * es.lambda_hist[es.restart_generations[0]]) {
+            std::cerr << "IPOP should double the population at each restart\n";
+            --rtn;
+        }
+        if (es.population_hist.size() != es.evaluations) { --rtn; }
+
+        if (strategy == morph::CMAES_Restart::BIPOP) {
+            es.param_names = { "a", "b", "c", "d", "e" };
+            es.save ("testcmaes.h5");
+            morph::HdfData d ("testcmaes.h5", morph::FileAccess::ReadOnly);
+            morph::vvec<double> fh;
+            d.read_contained_vals ("/f_x_best_hist", fh);
+            morph::vvec<double> xb;
+            d.read_contained_vals ("/x_best", xb);
+            if (fh.size() != es.generations || fh.back() != es.f_x_best || xb != es.x_best) {
+                std::cerr << "The saved history differs\n";
+                --rtn;
+            }
+        }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
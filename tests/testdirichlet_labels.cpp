@@ -0,0 +1,114 @@
+/*
+ * Test morph::dirichlet_labels and morph::dirichlet_analysis on Voronoi patterns whose
+ * centres drift: the labels must give the connected components of the identity map, the
+ * incremental update() must agree with labelling from scratch and dirichlet_analysis must
+ * find the domains that ShapeAnalysis::dirichlet_vertices finds.
+ */
+#include "morph/ShapeAnalysis.h"
+#include "morph/dirichlet_labels.h"
+#include "morph/HexGrid.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <list>
+#include <algorithm>
+
+// The identity map of the Voronoi cells of the centres c
+void voronoi (const morph::HexGrid& hg, const std::vector<morph::vec<float, 2>>& c, std::vector<float>& f)
+{
+    for (unsigned int h = 0; h < hg.num(); ++h) {
+        float best = 1e9f;
+        for (unsigned int i = 0; i < c.size(); ++i) {
+            const float d = (morph::vec<float, 2>{ hg.d_x[h], hg.d_y[h] } - c[i]).length();
+            if (d < best) { best = d; f[h] = (i + 1) / static_cast<float>(c.size() + 1); }
+        }
+    }
+}
+
+// Check the labels against a flood fill of the identity map
+int check_labels (const morph::HexGrid& hg, const std::vector<float>& f, const morph::dirichlet_labels<float>& dl)
+{
+    int rtn = 0;
+    const std::vector<const std::vector<int>*> nb = { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse };
+    std::vector<int> seen (hg.num(), 0);
+    unsigned int ndoms = 0;
+    for (unsigned int h = 0; h < hg.num(); ++h) {
+        if (seen[h]) { continue; }
+        ++ndoms;
+        std::vector<int> stack = { static_cast<int>(h) };
+        std::vector<int> comp;
+        seen[h] = 1;
+        while (!stack.empty()) {
+            const int k = stack.back();
+            stack.pop_back();
+            comp.push_back (k);
+            for (auto v : nb) {
+                const int j = (*v)[k];
+                if (j >= 0 && !seen[j] && f[j] == f[k]) { seen[j] = 1; stack.push_back (j); }
+            }
+        }
+        std::sort (comp.begin(), comp.end());
+        const int d = dl.label[h];
+        if (dl.domains[d].hexes != comp || dl.domains[d].f != f[h]) { std::cerr << "Domain of hex " << h << " is wrong\n"; --rtn; }
+    }
+    if (ndoms != dl.num_domains()) { std::cerr << "Wrong number of domains\n"; --rtn; }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg (0.015f, 3.0f, 0.0f);
+    hg.setEllipticalBoundary (0.8f, 0.6f);
+    morph::RandUniform<float> rng (-0.7f, 0.7f, 3);
+    std::vector<morph::vec<float, 2>> c (30);
+    for (auto& ci : c) { ci[0] = rng.get(); ci[1] = 0.7f * rng.get(); }
+    std::vector<float> f (hg.num());
+
+    morph::dirichlet_labels<float> dl (hg);
+    morph::dirichlet_analysis<float> da (&hg);
+    int partial = 0;
+    for (int it = 0; it < 8; ++it) {
+        voronoi (hg, c, f);
+        const unsigned int revisited = dl.update (f);
+        rtn += check_labels (hg, f, dl);
+        if (revisited < hg.num()) { ++partial; }
+
+        std::list<morph::DirichVtx<float>> v1, v2;
+        std::list<morph::DirichDom<float>> d1 = morph::ShapeAnalysis<float>::dirichlet_vertices (&hg, f, v1);
+        std::list<morph::DirichDom<float>> d2 = da.analyse (f, v2);
+        if (v1.size() != v2.size() || d1.size() != d2.size() || d1.empty()) {
+            std::cerr << "Step " << it << ": " << d2.size() << " domains instead of " << d1.size() << "\n";
+            --rtn;
+            continue;
+        }
+        auto a = d1.begin();
+        for (const morph::DirichDom<float>& b : d2) {
+            if (a->f != b.f || a->vertices.size() != b.vertices.size() || a->edge_deviation != b.edge_deviation) {
+                std::cerr << "Step " << it << ": domain " << b.f << " differs\n";
+                --rtn;
+            }
+            // Voronoi cells are connected, so a cell's area is the area of all hexes of its identity
+            const float area = hg.getHexArea() * std::count (f.begin(), f.end(), b.f);
+            if (b.area != area) { std::cerr << "Step " << it << ": area of domain " << b.f << " is wrong\n"; --rtn; }
+            ++a;
+        }
+        // Drift two of the centres
+        c[it % c.size()][0] += 0.01f;
+        c[(7 * it) % c.size()][1] -= 0.01f;
+    }
+
+    if (partial < 4) { std::cerr << "Only " << partial << " updates were incremental\n"; --rtn; }
+
+    // update() agrees with compute() from scratch
+    morph::dirichlet_labels<float> fresh (hg);
+    fresh.compute (f);
+    if (fresh.num_domains() != dl.num_domains()) { std::cerr << "Incremental labels differ\n"; --rtn; }
+    for (unsigned int h = 0; h < hg.num(); ++h) {
+        if (fresh.domains[fresh.label[h]].hexes != dl.domains[dl.label[h]].hexes) { std::cerr << "Incremental labels differ\n"; --rtn; break; }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,111 @@
+// Test morph::dual, for forward-mode differentiation, alone and as the element type of vec and vvec
+#include <cmath>
+#include <iostream>
+#include <morph/mathconst.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <morph/dual.h>
+
+using D = morph::dual<double, 2>;
+
+static bool close (const double a, const double b, const double tol = 1e-12)
+{
+    return std::abs (a - b) <= tol * std::max (1.0, std::abs (b));
+}
+
+// Check f's value and derivative at x against the analytic ones
+template <typename F>
+static int check (const char* name, F f, const double x, const double fx, const double dfx)
+{
+    morph::dual<double> r = f (morph::dual<double>::variable (x));
+    if (!close (r.v, fx) || !close (r.d[0], dfx)) {
+        std::cout << name << "(" << x << ") gave " << r << " not (" << fx << ", " << dfx << ")\n";
+        return -1;
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Arithmetic: f(x, y) = x^2 y / (1 + x) - 3 y
+    {
+        const D x = D::variable (2.0, 0);
+        const D y = D::variable (0.5, 1);
+        const D r = x * x * y / (1.0 + x) - 3.0 * y;
+        const double fx = 2.0 * 2.0 * 0.5 / 3.0 - 1.5;
+        const double dfdx = 0.5 * (2.0 * 2.0 * 3.0 - 2.0 * 2.0) / 9.0;
+        const double dfdy = 4.0 / 3.0 - 3.0;
+        if (!close (r.v, fx) || !close (r.d[0], dfdx) || !close (r.d[1], dfdy)) {
+            std::cout << "Arithmetic gave " << r << "\n";
+            --rtn;
+        }
+        D c = x;
+        c *= y;
+        c -= 1.0;
+        c /= y;
+        if (!close (c.v, 0.0) || !close (c.d[0], 1.0) || !close (c.d[1], 4.0)) { --rtn; }
+        // Comparisons are of the values alone
+        if (!(x > y) || !(x == D{2.0}) || x < 1.0) { --rtn; }
+    }
+
+    // The maths functions
+    rtn += check ("sqrt", [](auto x) { return morph::math::sqrt (x); }, 2.0, std::sqrt (2.0), 0.5 / std::sqrt (2.0));
+    rtn += check ("exp", [](auto x) { return exp (x); }, 0.3, std::exp (0.3), std::exp (0.3));
+    rtn += check ("log", [](auto x) { return morph::math::log (x); }, 3.0, std::log (3.0), 1.0 / 3.0);
+    rtn += check ("log10", [](auto x) { return log10 (x); }, 3.0, std::log10 (3.0), 1.0 / (3.0 * std::log (10.0)));
+    rtn += check ("pow", [](auto x) { return morph::math::pow (x, 3.0); }, 1.5, 3.375, 6.75);
+    rtn += check ("pow2", [](auto x) { return pow (2.0, x); }, 1.5, std::pow (2.0, 1.5), std::pow (2.0, 1.5) * std::log (2.0));
+    rtn += check ("powxx", [](auto x) { return pow (x, x); }, 1.5, std::pow (1.5, 1.5), std::pow (1.5, 1.5) * (std::log (1.5) + 1.0));
+    rtn += check ("sin", [](auto x) { return morph::math::sin (x); }, 0.7, std::sin (0.7), std::cos (0.7));
+    rtn += check ("cos", [](auto x) { return cos (x); }, 0.7, std::cos (0.7), -std::sin (0.7));
+    rtn += check ("tan", [](auto x) { return tan (x); }, 0.7, std::tan (0.7), 1.0 / (std::cos (0.7) * std::cos (0.7)));
+    rtn += check ("asin", [](auto x) { return asin (x); }, 0.4, std::asin (0.4), 1.0 / std::sqrt (1.0 - 0.16));
+    rtn += check ("acos", [](auto x) { return acos (x); }, 0.4, std::acos (0.4), -1.0 / std::sqrt (1.0 - 0.16));
+    rtn += check ("atan", [](auto x) { return atan (x); }, 0.4, std::atan (0.4), 1.0 / 1.16);
+    rtn += check ("tanh", [](auto x) { return tanh (x); }, 0.4, std::tanh (0.4), 1.0 - std::tanh (0.4) * std::tanh (0.4));
+    rtn += check ("erf", [](auto x) { return erf (x); }, 0.4, std::erf (0.4), 2.0 / std::sqrt (morph::mathconst<double>::pi) * std::exp (-0.16));
+    rtn += check ("abs", [](auto x) { return morph::math::abs (x); }, -0.4, 0.4, -1.0);
+    rtn += check ("hypot", [](auto x) { return hypot (x, morph::dual<double>{4.0}); }, 3.0, 5.0, 0.6);
+    rtn += check ("atan2", [](auto x) { return atan2 (x, morph::dual<double>{1.0}); }, 1.0, std::atan2 (1.0, 1.0), 0.5);
+
+    // A constant from mathconst has no tangents
+    {
+        constexpr D tp = morph::mathconst<D>::two_pi;
+        if (!close (tp.v, morph::mathconst<double>::two_pi) || tp.d[0] != 0.0 || tp.d[1] != 0.0) { --rtn; }
+    }
+
+    // vec<dual>: the gradient of the length of (x, y, 2) at (3, 4)
+    {
+        morph::vec<D, 3> v = { D::variable (3.0, 0), D::variable (4.0, 1), D{2.0} };
+        const D len = v.length();
+        const double l = std::sqrt (29.0);
+        if (!close (len.v, l) || !close (len.d[0], 3.0 / l) || !close (len.d[1], 4.0 / l)) {
+            std::cout << "vec<dual>::length gave " << len << "\n";
+            --rtn;
+        }
+        const D s = (v * 2.0).sum();
+        if (!close (s.v, 18.0) || !close (s.d[0], 2.0) || !close (s.d[1], 2.0)) { --rtn; }
+        const D dt = v.dot (v);
+        if (!close (dt.v, 29.0) || !close (dt.d[0], 6.0) || !close (dt.d[1], 8.0)) { --rtn; }
+    }
+
+    // vvec<dual>: the gradient of sum(exp(x)) is exp(x)
+    {
+        morph::vvec<D> v = { D::variable (0.1, 0), D::variable (-0.2, 1) };
+        const D s = v.exp().sum();
+        if (!close (s.v, std::exp (0.1) + std::exp (-0.2)) || !close (s.d[0], std::exp (0.1)) || !close (s.d[1], std::exp (-0.2))) {
+            std::cout << "vvec<dual>::exp().sum() gave " << s << "\n";
+            --rtn;
+        }
+        const D m = (v * v).mean();
+        if (!close (m.v, 0.025) || !close (m.d[0], 0.1) || !close (m.d[1], -0.2)) { --rtn; }
+        const D n = v.length();
+        const double l = std::sqrt (0.05);
+        if (!close (n.v, l) || !close (n.d[0], 0.1 / l) || !close (n.d[1], -0.2 / l)) { --rtn; }
+    }
+
+    std::cout << "testdual " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
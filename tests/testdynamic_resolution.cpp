@@ -0,0 +1,91 @@
+// Test morph::dynamic_resolution, which chooses the scale of each frame drawn by morph::Visual
+#include <chrono>
+#include <iostream>
+#include <morph/dynamic_resolution.h>
+
+int main()
+{
+    int rtn = 0;
+    using clk = morph::dynamic_resolution::clock;
+    using ms = std::chrono::milliseconds;
+    const clk::time_point t0 = clk::now();
+
+    // Disabled, every frame is full size, even during interaction
+    {
+        morph::dynamic_resolution d;
+        d.interacted (t0);
+        if (d.frame (true, 1, t0) != 1.0f || d.reduced()) { --rtn; }
+    }
+
+    // Interaction reduces frames until the view has been at rest for settle_ms
+    {
+        morph::dynamic_resolution d;
+        d.enabled = true;
+        if (d.frame (false, 0, t0) != 1.0f) { --rtn; }
+        d.interacted (t0 + ms(10));
+        if (d.frame (true, 1, t0 + ms(20)) != 0.5f || !d.reduced()) { --rtn; }
+        // Button released, but within settle_ms of the last movement
+        if (d.frame (false, 2, t0 + ms(100)) != 0.5f) { --rtn; }
+        if (d.frame (false, 2, t0 + ms(200)) != 1.0f || d.reduced()) {
+            std::cout << "Expected a full frame once at rest\n";
+            --rtn;
+        }
+    }
+
+    // With a budget, the scale of reduced frames follows the frame interval
+    {
+        morph::dynamic_resolution d;
+        d.enabled = true;
+        d.frame_budget_ms = 20.0;
+        d.frame (false, 0, t0);
+        d.interacted (t0);
+        float s = d.frame (true, 1, t0 + ms(5));
+        clk::time_point t = t0 + ms(5);
+        // Frames that come every 80 ms shrink to min_scale
+        for (int i = 0; i < 20; ++i) {
+            t += ms(80);
+            d.interacted (t);
+            s = d.frame (true, 2 + i, t);
+        }
+        if (s != 0.25f) {
+            std::cout << "Slow frames gave scale " << s << ", expected 0.25\n";
+            --rtn;
+        }
+        // Frames that come every 5 ms grow back to full size
+        for (int i = 0; i < 20; ++i) {
+            t += ms(5);
+            d.interacted (t);
+            s = d.frame (true, 100 + i, t);
+        }
+        if (s != 1.0f || !d.reduced()) {
+            std::cout << "Fast frames gave scale " << s << ", expected a reduced frame at 1\n";
+            --rtn;
+        }
+    }
+
+    // A changing scene that is over budget is reduced without interaction, until it stops changing
+    {
+        morph::dynamic_resolution d;
+        d.enabled = true;
+        d.frame_budget_ms = 20.0;
+        clk::time_point t = t0;
+        d.frame (false, 0, t);
+        t += ms(50);
+        if (d.frame (false, 1, t) >= 1.0f) { --rtn; }
+        t += ms(50);
+        if (d.frame (false, 2, t) >= 1.0f) { --rtn; }
+        t += ms(10);
+        if (d.frame (false, 2, t) != 1.0f) {
+            std::cout << "An unchanged scene should be drawn in full\n";
+            --rtn;
+        }
+        // A scene that changes within budget is drawn in full
+        for (int i = 0; i < 5; ++i) {
+            t += ms(10);
+            if (d.frame (false, 10 + i, t) != 1.0f) { --rtn; }
+        }
+    }
+
+    std::cout << "testdynamic_resolution " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
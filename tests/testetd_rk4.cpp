@@ -0,0 +1,237 @@
+/*
+ * Test morph::etd_rk4 and morph::fft_plan: the general length FFT against a direct DFT, the
+ * exact decay of Fourier modes under diffusion, the convergence of ETDRK4 against a fine
+ * rk4() reference on a wrapped Grid and on a parallelogram wrapped HexGrid, and
+ * large steps to a steady state, checked against diffusion_cg.
+ */
+#include "morph/etd_rk4.h"
+#include "morph/fft.h"
+#include "morph/rk_integrator.h"
+#include "morph/implicit_diffusion.h"
+#include "morph/stencil.h"
+#include "morph/Grid.h"
+#include "morph/HexGrid.h"
+#include "morph/Random.h"
+#include "morph/mathconst.h"
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <numeric>
+#include <cmath>
+
+using etd_t = morph::etd_rk4<double>;
+using integ_t = morph::rk_integrator<double>;
+
+double maxdiff (const std::vector<double>& a, const std::vector<double>& b)
+{
+    double e = 0.0;
+    for (std::size_t i = 0; i < a.size(); ++i) { e = std::max (e, std::abs (a[i] - b[i])); }
+    return e;
+}
+
+// The bistable reaction u (1 - u) (u - 0.3) and a linear decay of a second, coupled field
+void reactions (double, const std::vector<const std::vector<double>*>& y, std::vector<std::vector<double>>& dydt)
+{
+    const std::vector<double>& u = *y[0];
+    const std::vector<double>& v = *y[1];
+    for (std::size_t i = 0; i < u.size(); ++i) {
+        dydt[0][i] = u[i] * (1.0 - u[i]) * (u[i] - 0.3) - 0.1 * v[i];
+        dydt[1][i] = 0.2 * (u[i] - v[i]);
+    }
+}
+
+// Integrate reactions plus diffusion to time T with ETDRK4 steps of dt on grid
+template <typename G>
+std::vector<double> etd_solution (const G& grid, const std::vector<double>& u0, const double dt, const double T,
+                                  const double Du, const double Dv)
+{
+    std::vector<double> u = u0, v (u0.size(), 0.0);
+    etd_t etd (grid);
+    etd.add_field (u, Du);
+    etd.add_field (v, Dv);
+    const int nsteps = static_cast<int>(std::round (T / dt));
+    for (int i = 0; i < nsteps; ++i) { etd.step (reactions, dt); }
+    return u;
+}
+
+// The same with small explicit rk4() steps, with the Laplacian from laplace
+template <typename G, typename L>
+std::vector<double> rk4_solution (const G& grid, const std::vector<double>& u0, const double dt, const double T,
+                                  const double Du, const double Dv, L laplace)
+{
+    std::vector<double> u = u0, v (u0.size(), 0.0);
+    std::vector<double> lu, lv;
+    integ_t integ;
+    integ.add_field (u);
+    integ.add_field (v);
+    auto f = [&](double t, const integ_t::state& y, integ_t::derivs& dydt) {
+        reactions (t, y, dydt);
+        laplace (grid, *y[0], lu);
+        laplace (grid, *y[1], lv);
+        for (std::size_t i = 0; i < lu.size(); ++i) {
+            dydt[0][i] += Du * lu[i];
+            dydt[1][i] += Dv * lv[i];
+        }
+    };
+    const int nsteps = static_cast<int>(std::round (T / dt));
+    for (int i = 0; i < nsteps; ++i) { integ.rk4 (f, dt); }
+    return u;
+}
+
+int main()
+{
+    int rtn = 0;
+    morph::RandUniform<double> rng (0.0, 1.0, 17);
+    const double two_pi = morph::mathconst<double>::two_pi;
+
+    // fft_plan against a direct DFT, for power of 2 and other lengths, with and without a stride
+    for (std::size_t n : { 1u, 2u, 7u, 12u, 15u, 16u, 60u }) {
+        for (std::size_t stride : { 1u, 3u }) {
+            std::vector<std::complex<double>> a (n * stride);
+            for (auto& ai : a) { ai = std::complex<double>(rng.get() - 0.5, rng.get() - 0.5); }
+            std::vector<std::complex<double>> x (n), dft (n);
+            for (std::size_t j = 0; j < n; ++j) { x[j] = a[j * stride]; }
+            for (std::size_t k = 0; k < n; ++k) {
+                for (std::size_t j = 0; j < n; ++j) { dft[k] += x[j] * std::polar (1.0, -two_pi * double((j * k) % n) / double(n)); }
+            }
+            morph::fft_plan<double> plan (n);
+            std::vector<std::complex<double>> work;
+            plan.transform (a.data(), false, work, stride);
+            double err = 0.0;
+            for (std::size_t k = 0; k < n; ++k) { err = std::max (err, std::abs (a[k * stride] - dft[k])); }
+            plan.transform (a.data(), true, work, stride);
+            double ierr = 0.0;
+            for (std::size_t j = 0; j < n; ++j) { ierr = std::max (ierr, std::abs (a[j * stride] - x[j])); }
+            if (err > 1e-12 * double(n) || ierr > 1e-13 * double(n)) {
+                std::cout << "fft_plan n = " << n << " stride " << stride << ": error " << err << " inverse " << ierr << std::endl;
+                --rtn;
+            }
+        }
+    }
+
+    // A wrapped Grid of awkward dimensions
+    const double h = 0.5;
+    morph::Grid<unsigned int, double> g (24, 15, { h, h }, { 0.0, 0.0 }, morph::GridDomainWrap::Both);
+
+    // A Fourier mode decays exactly as exp(D lambda t), for both symbols
+    for (morph::laplacian_symbol sym : { morph::laplacian_symbol::stencil, morph::laplacian_symbol::spectral }) {
+        etd_t etd (g, sym);
+        if (etd.dims()[0] != 24 || etd.dims()[1] != 15) {
+            std::cout << "Grid lattice dims " << etd.dims()[0] << " x " << etd.dims()[1] << std::endl;
+            --rtn;
+        }
+        const double kx = two_pi * 3.0 / (24.0 * h);
+        const double ky = two_pi * 2.0 / (15.0 * h);
+        double lambda = -(kx * kx + ky * ky);
+        if (sym == morph::laplacian_symbol::stencil) {
+            lambda = (2.0 * std::cos (kx * h) - 2.0 + 2.0 * std::cos (ky * h) - 2.0) / (h * h);
+        }
+        std::vector<double> u (g.n());
+        for (unsigned int i = 0; i < g.n(); ++i) { u[i] = std::cos (kx * g[i][0] + ky * g[i][1]); }
+        const std::vector<double> u0 = u;
+        etd.add_field (u, 0.7);
+        auto none = [](double, const etd_t::state&, etd_t::derivs& dydt) { for (auto& d : dydt) { std::fill (d.begin(), d.end(), 0.0); } };
+        for (int i = 0; i < 4; ++i) { etd.step (none, 0.25); }
+        const double decay = std::exp (0.7 * lambda * 1.0);
+        double err = 0.0;
+        for (std::size_t i = 0; i < u.size(); ++i) { err = std::max (err, std::abs (u[i] - decay * u0[i])); }
+        if (err > 1e-12) {
+            std::cout << "Mode decay error " << err << " (symbol " << static_cast<int>(sym) << ")" << std::endl;
+            --rtn;
+        }
+    }
+
+    // Convergence to the rk4() solution with the 5 point Laplacian. The explicit steps must be
+    // shorter than h^2 / (4 D) = 0.0625. At the longer steps the error is dominated by the
+    // reactions, and falls more slowly than the asymptotic 4th order.
+    {
+        std::vector<double> u0 = rng.get (g.n());
+        auto lap5 = [h](const morph::Grid<unsigned int, double>& gr, const std::vector<double>& x, std::vector<double>& l) {
+            l.resize (x.size());
+            morph::apply_stencil<morph::stencils::laplace5<double>> (gr, x, l, 1.0 / (h * h));
+        };
+        const double T = 8.0;
+        const std::vector<double> ref = rk4_solution (g, u0, 0.01, T, 1.0, 0.5, lap5);
+        const double e0 = maxdiff (etd_solution (g, u0, 0.5, T, 1.0, 0.5), ref);
+        const double e1 = maxdiff (etd_solution (g, u0, 0.125, T, 1.0, 0.5), ref);
+        const double e2 = maxdiff (etd_solution (g, u0, 0.0625, T, 1.0, 0.5), ref);
+        std::cout << "Grid: ETDRK4 error at dt = 0.5: " << e0 << ", 0.125: " << e1 << ", 0.0625: " << e2
+                  << " (ratio " << e1 / e2 << ")" << std::endl;
+        if (e0 > 1e-3 || e1 / e2 < 8.0) { --rtn; }
+    }
+
+    // The same on a parallelogram wrapped HexGrid, with the 7 point hexagonal Laplacian
+    {
+        morph::HexGrid hg (0.1f, 5.0f, 0.0f);
+        hg.setParallelogramBoundary (8, 6);
+        hg.setParallelogramWrap (true, true);
+        hg.populate_d_neighbours();
+        const double d = static_cast<double>(hg.getd());
+        auto lap7 = [d](const morph::HexGrid& gr, const std::vector<double>& x, std::vector<double>& l) {
+            l.resize (x.size());
+            morph::apply_stencil<morph::stencils::hex_laplace<double>> (gr, x, l, 2.0 / (3.0 * d * d));
+        };
+        // Smoothed noise. From rough initial data, whose fastest modes are very stiff, ETDRK4
+        // converges at a lower order until dt is short.
+        const std::vector<double> u0 = rk4_solution (hg, rng.get (hg.num()), 0.001, 0.05, 1.0, 0.0, lap7);
+        etd_t etd (hg);
+        if (etd.dims()[0] * etd.dims()[1] != hg.num()) { --rtn; }
+        std::cout << "HexGrid lattice " << etd.dims()[0] << " x " << etd.dims()[1] << std::endl;
+        // Explicit steps must be shorter than d^2 / (3 D) = 0.0033; these are 30 and 60 times longer
+        const double T = 2.0;
+        const double Du = 1.0;
+        const double Dv = 0.2;
+        const std::vector<double> ref = rk4_solution (hg, u0, 0.001, T, Du, Dv, lap7);
+        const double e1 = maxdiff (etd_solution (hg, u0, 0.2, T, Du, Dv), ref);
+        const double e2 = maxdiff (etd_solution (hg, u0, 0.1, T, Du, Dv), ref);
+        std::cout << "HexGrid: ETDRK4 error at dt = 0.2: " << e1 << ", dt = 0.1: " << e2 << " (ratio " << e1 / e2 << ")" << std::endl;
+        if (e1 > 1e-6 || e1 / e2 < 4.0) { --rtn; }
+
+        // A HexGrid that does not wrap is refused
+        morph::HexGrid hg2 (0.1f, 5.0f, 0.0f);
+        hg2.setParallelogramBoundary (8, 6);
+        bool threw = false;
+        try { etd_t bad (hg2); } catch (const std::exception&) { threw = true; }
+        if (!threw) {
+            std::cout << "An unwrapped HexGrid was accepted" << std::endl;
+            --rtn;
+        }
+    }
+
+    // Long steps to the steady state of u' = D Del^2 u - u + s, which is (I - D Del^2)^-1 s,
+    // with the decay in the linear part. 20 steps of 10 reach it; explicit steps would have to
+    // be shorter than 0.0625 / D.
+    {
+        const double D = 2.0;
+        const std::vector<double> s = rng.get (g.n());
+        std::vector<double> u (g.n(), 0.0);
+        etd_t etd (g);
+        etd.add_field (u, D, -1.0);
+        auto source = [&s](double, const etd_t::state&, etd_t::derivs& dydt) {
+            std::copy (s.begin(), s.end(), dydt[0].begin());
+        };
+        for (int i = 0; i < 20; ++i) { etd.step (source, 10.0); }
+        std::vector<double> us (g.n(), 0.0);
+        morph::diffusion_cg<double> cg (g);
+        cg.tolerance = 1e-12;
+        cg.solve (us, s, D);
+        const double e = maxdiff (u, us);
+        std::cout << "Steady state error after 20 steps of dt = 10 (" << 200.0 / (0.0625 / D) << " explicit steps): " << e << std::endl;
+        if (e > 1e-8) { --rtn; }
+        if (etd.evaluations != 80) { --rtn; }
+    }
+
+    // A Grid that does not wrap is refused
+    {
+        morph::Grid<unsigned int, double> g2 (24, 15, { h, h });
+        bool threw = false;
+        try { etd_t bad (g2); } catch (const std::exception&) { threw = true; }
+        if (!threw) {
+            std::cout << "An unwrapped Grid was accepted" << std::endl;
+            --rtn;
+        }
+    }
+
+    std::cout << "testetd_rk4 " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,154 @@
+/*
+ * Test make_grid_part on a HexGrid and a CartGrid: the parts must tile the grid, each
+ * part's sends must match its peers' receives, and the local neighbour relations must be
+ * those of the whole grid. Then check that an RD_Base model split into pieces computes
+ * exactly the Laplacian of the undivided model.
+ */
+#include "morph/grid_partition.h"
+#include "morph/HexGrid.h"
+#include "morph/CartGrid.h"
+#include "morph/RD_Base.h"
+#include <iostream>
+#include <vector>
+#include <memory>
+
+// Check a set of parts made from the neighbour relations d_links
+int check_parts (const std::vector<const std::vector<int>*>& d_links, const std::vector<morph::grid_part>& parts)
+{
+    int rtn = 0;
+    const int n = static_cast<int>(d_links[0]->size());
+    int covered = 0;
+    for (const morph::grid_part& p : parts) {
+        if (p.begin != covered) { std::cerr << "Part " << p.index << " does not follow on\n"; --rtn; }
+        covered = p.end;
+        for (int g : p.ghosts) {
+            if (p.owns (g) || parts[p.owner (g)].owns (g) == false) { std::cerr << "Bad ghost owner\n"; --rtn; }
+        }
+        // Local neighbours are the global ones
+        for (std::size_t d = 0; d < d_links.size(); ++d) {
+            for (int i = 0; i < p.num_owned(); ++i) {
+                const int li = p.links[d][i];
+                const int gj = li < 0 ? -1 : (li < p.num_owned() ? p.begin + li : p.ghosts[li - p.num_owned()]);
+                if (gj != (*d_links[d])[p.begin + i]) { std::cerr << "Link differs\n"; --rtn; }
+            }
+        }
+        if (p.interior.size() + p.boundary.size() != static_cast<std::size_t>(p.num_owned())) { --rtn; }
+        // Every send is a receive of the peer, element for element
+        for (const auto& s : p.send) {
+            const morph::grid_part& q = parts[s.peer];
+            bool found = false;
+            for (const auto& r : q.recv) {
+                if (r.peer != p.index) { continue; }
+                found = true;
+                if (r.count != static_cast<int>(s.local.size())) { std::cerr << "Send and receive sizes differ\n"; --rtn; continue; }
+                for (int k = 0; k < r.count; ++k) {
+                    if (q.ghosts[r.offset + k] != p.begin + s.local[k]) { std::cerr << "Send order differs\n"; --rtn; }
+                }
+            }
+            if (!found) { std::cerr << "A send has no matching receive\n"; --rtn; }
+        }
+        std::size_t nrecv = 0;
+        for (const auto& r : p.recv) { nrecv += r.count; }
+        if (nrecv != p.ghosts.size()) { std::cerr << "Receives do not cover the ghosts\n"; --rtn; }
+    }
+    if (covered != n) { std::cerr << "Parts do not cover the grid\n"; --rtn; }
+    return rtn;
+}
+
+// Fills the ghosts of a part from a field on the whole grid
+struct global_halo : public morph::halo_exchange<float>
+{
+    global_halo (const morph::grid_part& p, const std::vector<float>& g) : part(p), global(g) {}
+    void start (const std::vector<float>&) override
+    {
+        this->ghost.resize (this->part.num_ghosts());
+        for (int k = 0; k < this->part.num_ghosts(); ++k) { this->ghost[k] = this->global[this->part.ghosts[k]]; }
+    }
+    const std::vector<float>& finish() override { return this->ghost; }
+    const morph::grid_part& part;
+    const std::vector<float>& global;
+    std::vector<float> ghost;
+};
+
+struct RD_Lap : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> lapu;
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+    }
+    // With no noise, noiseify_vector_variable gives a deterministic boundary roll-off
+    void init() { this->noiseify_vector_variable (this->u, 0.5f, 0.0f); }
+    void step() {}
+};
+
+int main()
+{
+    int rtn = 0;
+
+    {
+        morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+        hg.setEllipticalBoundary (1.0f, 0.6f);
+        hg.reorder (morph::HexGridOrder::hilbert);
+        const std::vector<const std::vector<int>*> links = { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse };
+        for (int np : { 1, 3, 8 }) {
+            std::vector<morph::grid_part> parts;
+            for (int i = 0; i < np; ++i) { parts.push_back (morph::make_grid_part (hg, np, i)); }
+            rtn += check_parts (links, parts);
+            if (np == 8) {
+                std::size_t ng = 0;
+                for (auto& p : parts) { ng += p.ghosts.size(); }
+                std::cout << "HexGrid of " << hg.num() << " hexes in 8 parts has " << ng << " ghosts\n";
+            }
+        }
+    }
+    {
+        morph::CartGrid cg (0.05f, 0.05f, 0.0f, 0.0f, 2.0f, 1.0f, 0.0f, morph::GridDomainShape::Rectangle,
+                            morph::GridDomainWrap::Horizontal);
+        cg.setBoundaryOnOuterEdge();
+        const std::vector<const std::vector<int>*> links = { &cg.d_ne, &cg.d_nne, &cg.d_nn, &cg.d_nnw,
+                                                             &cg.d_nw, &cg.d_nsw, &cg.d_ns, &cg.d_nse };
+        std::vector<morph::grid_part> parts;
+        for (int i = 0; i < 5; ++i) { parts.push_back (morph::make_grid_part (cg, 5, i)); }
+        rtn += check_parts (links, parts);
+    }
+
+    // A model in pieces computes the same Laplacian as the whole
+    {
+        RD_Lap whole;
+        whole.svgpath = "";
+        whole.hextohex_d = 0.03f;
+        whole.allocate();
+        whole.hg->reorder (morph::HexGridOrder::hilbert);
+        whole.init();
+        const std::vector<float> u0 = whole.u;
+        morph::RandUniform<float> rng (0.0f, 1.0f, 11);
+        rng.get (whole.u);
+        whole.compute_laplace (whole.u, whole.lapu);
+
+        constexpr int np = 4;
+        for (int i = 0; i < np; ++i) {
+            RD_Lap piece;
+            piece.svgpath = "";
+            piece.hextohex_d = 0.03f;
+            piece.num_parts = np;
+            piece.part_index = i;
+            piece.allocate();
+            piece.init();
+            piece.halo = std::make_unique<global_halo> (*piece.part, whole.u);
+            std::vector<float> expect;
+            piece.part->scatter (u0, expect);
+            if (piece.u != expect) { std::cerr << "Piece " << i << " initial state differs\n"; --rtn; }
+            piece.part->scatter (whole.u, piece.u);
+            piece.compute_laplace (piece.u, piece.lapu);
+            piece.part->scatter (whole.lapu, expect);
+            if (piece.lapu != expect) { std::cerr << "Piece " << i << " Laplacian differs\n"; --rtn; }
+        }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
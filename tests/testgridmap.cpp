@@ -0,0 +1,165 @@
+/*
+ * Test morph::GridMap, the precomputed interpolation between HexGrids, CartGrids, Grids and
+ * HEALPix grids, and its cache.
+ */
+#define GRIDMAP_COMPILE_LOAD_AND_SAVE 1
+#include <morph/GridMap.h>
+#include <morph/HexGrid.h>
+#include <morph/CartGrid.h>
+#include <morph/Grid.h>
+#include <morph/healpix/healpix_bare.hpp>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <vector>
+#include <filesystem>
+#include <cmath>
+
+// A linear field, which the linear method reproduces exactly inside the source
+float lin (const morph::vec<float, 2>& x) { return 0.3f + 1.5f * x[0] - 0.7f * x[1]; }
+
+template <typename S, typename D>
+int check_linear (const S& src, const D& dst, const char* what)
+{
+    morph::GridMap<float> gm (src, dst, morph::gridmap_method::linear);
+    const auto sl = morph::GridMap<float>::locations (src);
+    const auto dl = morph::GridMap<float>::locations (dst);
+    morph::vvec<float> f (sl.size());
+    for (std::size_t i = 0; i < sl.size(); ++i) { f[i] = lin (sl[i]); }
+    morph::vvec<float> g;
+    gm.apply (f, g);
+    float maxerr = 0.0f;
+    unsigned int n_covered = 0;
+    for (std::size_t i = 0; i < dl.size(); ++i) {
+        if (!gm.covers (i)) {
+            if (g[i] != 0.0f) { std::cerr << what << ": uncovered element is not zero\n"; return -1; }
+            continue;
+        }
+        auto [cols, w] = gm.row (i);
+        // Only elements that lie inside a whole triangle or rectangle of the source are exact
+        if (cols.size() < 3) { continue; }
+        maxerr = std::max (maxerr, std::abs (g[i] - lin (dl[i])));
+        ++n_covered;
+    }
+    std::cout << what << ": " << gm.num_entries() << " entries, " << n_covered << " of " << dl.size()
+              << " interior elements, max error " << maxerr << std::endl;
+    if (maxerr > 1e-4f || n_covered == 0) { std::cerr << what << ": linear field not reproduced\n"; return -1; }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+    morph::Grid<unsigned int, float> grid (60U, 50U, morph::vec<float, 2>{ 0.021f, 0.023f }, morph::vec<float, 2>{ -0.6f, -0.55f });
+    morph::Grid<unsigned int, float> gtl (60U, 50U, morph::vec<float, 2>{ 0.021f, 0.023f }, morph::vec<float, 2>{ -0.6f, 0.55f },
+                                          morph::GridDomainWrap::None, morph::GridOrder::topleft_to_bottomright_colmaj);
+    morph::CartGrid cg (0.015625f, 0.0125f, 1.5f, 1.25f);
+    cg.setBoundaryOnOuterEdge();
+
+    rtn += check_linear (hg, grid, "HexGrid->Grid");
+    rtn += check_linear (grid, hg, "Grid->HexGrid");
+    rtn += check_linear (gtl, hg, "Grid (topleft, colmaj)->HexGrid");
+    rtn += check_linear (cg, hg, "CartGrid->HexGrid");
+
+    // nearest agrees with HexGrid::findHexNearest inside the boundary
+    morph::GridMap<float> gn (hg, grid, morph::gridmap_method::nearest);
+    morph::vvec<float> idx (hg.num());
+    idx.arange (0.0f, static_cast<float>(hg.num()), 1.0f);
+    morph::vvec<float> nearest = gn.apply (idx);
+    unsigned int n_inside = 0;
+    for (unsigned int i = 0; i < grid.n(); ++i) {
+        const morph::vec<float, 2> c = grid.v_c[i];
+        if (c.length() > 0.55f) { continue; }
+        ++n_inside;
+        auto h = hg.findHexNearest (c);
+        if (static_cast<unsigned int>(nearest[i]) != h->vi) { std::cerr << "nearest differs from findHexNearest at " << c << "\n"; --rtn; break; }
+    }
+    if (n_inside == 0) { --rtn; }
+    // Far outside the HexGrid there is no source element
+    if (gn.covers (0)) { std::cerr << "A corner of the Grid should lie outside the HexGrid\n"; --rtn; }
+
+    // gaussian maps a constant to the same constant
+    morph::GridMap<float> gg (hg, grid, morph::gridmap_method::gaussian, 0.03f);
+    morph::vvec<float> one (hg.num(), 2.5f);
+    morph::vvec<float> gone = gg.apply (one);
+    for (unsigned int i = 0; i < grid.n(); ++i) {
+        if (gg.covers (i) && std::abs (gone[i] - 2.5f) > 1e-5f) { std::cerr << "gaussian doesn't preserve a constant\n"; --rtn; break; }
+    }
+    try {
+        morph::GridMap<float> bad (hg, grid, morph::gridmap_method::gaussian, 0.0f);
+        std::cerr << "Expected an exception for sigma 0\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+
+    // HEALPix: the same nside, nearest, is the identity
+    const morph::healpix_grid hp8 { 8 };
+    const morph::healpix_grid hp16 { 16 };
+    morph::GridMap<float> hid (hp8, hp8, morph::gridmap_method::nearest);
+    for (std::size_t i = 0; i < hid.dst_size(); ++i) {
+        auto [cols, w] = hid.row (i);
+        if (cols.size() != 1 || cols[0] != i || w[0] != 1.0f) { std::cerr << "HEALPix nearest isn't the identity\n"; --rtn; break; }
+    }
+    // linear from nside 8 to 16 (and the same grid): weights sum to 1 and z is smooth
+    for (const auto& dst : { hp16, hp8 }) {
+        morph::GridMap<float> hl (hp8, dst, morph::gridmap_method::linear);
+        const auto sl = morph::GridMap<float>::locations (hp8);
+        const auto dl = morph::GridMap<float>::locations (dst);
+        morph::vvec<float> z (sl.size());
+        for (std::size_t i = 0; i < sl.size(); ++i) { z[i] = sl[i][2]; }
+        morph::vvec<float> zi = hl.apply (z);
+        float maxerr = 0.0f;
+        for (std::size_t i = 0; i < dl.size(); ++i) {
+            auto [cols, w] = hl.row (i);
+            float ws = 0.0f;
+            for (float wk : w) { ws += wk; }
+            if (std::abs (ws - 1.0f) > 1e-5f) { std::cerr << "HEALPix linear weights don't sum to 1\n"; --rtn; break; }
+            maxerr = std::max (maxerr, std::abs (zi[i] - dl[i][2]));
+        }
+        std::cout << "HEALPix nside 8 -> " << dst.nside << " linear: max error in z " << maxerr << std::endl;
+        if (maxerr > 0.03f) { std::cerr << "HEALPix linear interpolation error too large\n"; --rtn; }
+    }
+    morph::GridMap<float> hg3 (hp8, hp16, morph::gridmap_method::gaussian, 0.1f);
+    morph::vvec<float> hone = hg3.apply (morph::vvec<float> (hp8.num(), 1.0f));
+    if (std::abs (hone.min() - 1.0f) > 1e-5f || std::abs (hone.max() - 1.0f) > 1e-5f) { std::cerr << "HEALPix gaussian doesn't preserve a constant\n"; --rtn; }
+
+    // A HexGrid onto the sphere, through an orthographic projection of the northern hemisphere
+    std::vector<morph::vec<float, 2>> hpn;
+    for (const auto& p : morph::GridMap<float>::locations (hp16)) {
+        if (p[2] > 0.0f) { hpn.push_back ({ p[0] * 0.5f, p[1] * 0.5f }); }
+    }
+    morph::GridMap<float> h2s (hg, hpn, morph::gridmap_method::linear);
+    if (h2s.dst_size() != hpn.size() || h2s.src_size() != hg.num()) { std::cerr << "Projected map has the wrong size\n"; --rtn; }
+    morph::vvec<float> hx (hg.num());
+    for (unsigned int i = 0; i < hg.num(); ++i) { hx[i] = hg.d_x[i]; }
+    morph::vvec<float> sx = h2s.apply (hx);
+    for (std::size_t i = 0; i < hpn.size(); ++i) {
+        if (h2s.row (i).first.size() == 3 && std::abs (sx[i] - hpn[i][0]) > 1e-4f) { std::cerr << "Projected map error\n"; --rtn; break; }
+    }
+
+    // Save, load and the cache
+    const std::string cachedir = "../gridmap_cache";
+    std::filesystem::remove_all (cachedir);
+    std::filesystem::create_directories (cachedir);
+    const auto gl = morph::GridMap<float>::locations (grid);
+    morph::GridMap<float> c1;
+    if (c1.valid() || c1.initCached (hg, gl, morph::gridmap_method::linear, 0.0f, cachedir)) { std::cerr << "Empty cache should miss\n"; --rtn; }
+    morph::GridMap<float> c2;
+    if (!c2.initCached (hg, grid, morph::gridmap_method::linear, 0.0f, cachedir)) { std::cerr << "Cache should hit\n"; --rtn; }
+    morph::vvec<float> f (hg.num());
+    for (unsigned int i = 0; i < hg.num(); ++i) { f[i] = std::sin (5.0f * hg.d_x[i]) + hg.d_y[i]; }
+    if (c1.apply (f) != c2.apply (f) || c1.num_entries() != c2.num_entries()) { std::cerr << "Cached map differs\n"; --rtn; }
+    // A different method has a different key
+    morph::GridMap<float> c3;
+    if (c3.initCached (hg, grid, morph::gridmap_method::nearest, 0.0f, cachedir)) { std::cerr << "Different method should miss\n"; --rtn; }
+    // A wrong key, or no file, doesn't load
+    const unsigned long long int key = morph::GridMap<float>::cacheKey (hg, gl, morph::gridmap_method::linear);
+    if (c3.load (morph::GridMap<float>::cacheName (cachedir, key), key + 1)) { std::cerr << "Loaded with the wrong key\n"; --rtn; }
+    if (c3.load (cachedir + "/nonexistent.h5")) { std::cerr << "Loaded a missing file\n"; --rtn; }
+    if (c3.get_method() != morph::gridmap_method::nearest) { std::cerr << "A failed load changed the map\n"; --rtn; }
+    std::filesystem::remove_all (cachedir);
+
+    std::cout << "testgridmap " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,120 @@
+// Test the keyframe plus quantised delta series, morph::hdf_series_writer/reader
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cmath>
+#include <morph/hdf_series.h>
+#include <morph/hdf_writer.h>
+#include <morph/HdfData.h>
+#include <morph/vvec.h>
+
+int main()
+{
+    int rtn = 0;
+    const std::size_t n = 5000;
+    const unsigned int nframes = 100;
+    const float tol = 1e-3f;
+
+    // A slowly changing field, with a jump (which needs a keyframe) at frame 50
+    auto frame = [n](unsigned int f) {
+        morph::vvec<float> v (n);
+        for (std::size_t i = 0; i < n; ++i) {
+            v[i] = std::sin (0.01f * i + 0.02f * f) + (f >= 50 ? 100.0f : 0.0f);
+        }
+        return v;
+    };
+
+    const std::string fn = "../testhdf_series.h5";
+    const std::string fn_full = "../testhdf_series_full.h5";
+    {
+        morph::hdf_series_writer<float> w ("/frames/A", tol, 16);
+        morph::HdfData d (fn);
+        for (unsigned int f = 0; f < nframes / 2; ++f) { w.append (d, frame (f)); }
+        // The uncompressed, full precision equivalent, for comparison
+        morph::HdfData full (fn_full);
+        for (unsigned int f = 0; f < nframes; ++f) { full.append_vals ("/frames/A", frame (f)); }
+    }
+    {
+        // Carry on in the same file, as after a restart
+        morph::hdf_series_writer<float> w ("/frames/A", tol, 16);
+        morph::HdfData d (fn, morph::FileAccess::ReadWrite);
+        for (unsigned int f = nframes / 2; f < nframes; ++f) {
+            if (w.append (d, frame (f)) != f) {
+                std::cerr << "Resumed series numbered a frame wrongly\n";
+                --rtn;
+            }
+        }
+    }
+
+    {
+        morph::HdfData d (fn, morph::FileAccess::ReadOnly);
+        morph::hdf_series_reader<float> r (d, "/frames/A");
+        if (r.frames() != nframes || r.tolerance() != tol) {
+            std::cerr << "Series has " << r.frames() << " frames and tolerance " << r.tolerance() << "\n";
+            --rtn;
+        }
+        if (!r.is_keyframe (0) || !r.is_keyframe (16) || r.is_keyframe (17) || !r.is_keyframe (50)) {
+            std::cerr << "Keyframes are not where expected\n";
+            --rtn;
+        }
+        // In order, then at random
+        morph::vvec<float> v;
+        float maxerr = 0.0f;
+        for (unsigned int f = 0; f < nframes; ++f) {
+            r.read (f, v);
+            maxerr = std::max (maxerr, (v - frame (f)).abs().max());
+        }
+        for (unsigned int f : { 93u, 7u, 31u, 32u, 64u, 3u }) {
+            r.read (f, v);
+            maxerr = std::max (maxerr, (v - frame (f)).abs().max());
+        }
+        // Allow for the rounding of the float arithmetic
+        if (maxerr > tol * 1.01f) {
+            std::cerr << "Largest error " << maxerr << " exceeds tolerance " << tol << "\n";
+            --rtn;
+        }
+    }
+
+    const auto sz = std::filesystem::file_size (fn);
+    const auto sz_full = std::filesystem::file_size (fn_full);
+    std::cout << "Series file is " << sz << " bytes; full precision file is " << sz_full << " bytes\n";
+    if (sz * 4 > sz_full) {
+        std::cerr << "Series file is not much smaller than the full one\n";
+        --rtn;
+    }
+    std::filesystem::remove (fn);
+    std::filesystem::remove (fn_full);
+
+    // Through hdf_writer, as RD_Base::save_async would
+    const std::string fnw = "../testhdf_series_writer.h5";
+    {
+        morph::hdf_writer<float> hw;
+        for (unsigned int f = 0; f < 40; ++f) {
+            morph::hdf_writer<float>::job j;
+            j.filename = fnw;
+            j.append = true;
+            j.tolerance = tol;
+            j.add ("/A", frame (f));
+            j.add ("/B", frame (f + 1));
+            hw.push (std::move (j));
+        }
+    }
+    {
+        morph::HdfData d (fnw, morph::FileAccess::ReadOnly);
+        morph::hdf_series_reader<float> ra (d, "/A");
+        morph::hdf_series_reader<float> rb (d, "/B");
+        morph::vvec<float> a, b;
+        ra.read (39, a);
+        rb.read (38, b);
+        if (ra.frames() != 40 || (a - frame (39)).abs().max() > tol * 1.01f
+            || (b - frame (39)).abs().max() > tol * 1.01f) {
+            std::cerr << "hdf_writer series are wrong\n";
+            --rtn;
+        }
+    }
+    std::filesystem::remove (fnw);
+
+    if (rtn == 0) { std::cout << "Test PASSED\n"; } else { std::cout << "Test FAILED\n"; }
+    return rtn;
+}
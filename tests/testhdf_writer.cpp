@@ -0,0 +1,96 @@
+// Test the background HDF5 snapshot writer, morph::hdf_writer
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <morph/hdf_writer.h>
+#include <morph/HdfData.h>
+#include <morph/vvec.h>
+
+int main()
+{
+    int rtn = 0;
+    const unsigned int nframes = 20;
+    const std::size_t n = 1000;
+
+    auto frame = [n](unsigned int f, float offset) {
+        morph::vvec<float> v (n);
+        for (std::size_t i = 0; i < n; ++i) { v[i] = f * 10000.0f + i + offset; }
+        return v;
+    };
+
+    {
+        // Room for about three frames of two vectors, so push() must wait for the disk
+        morph::hdf_writer<float> w (3 * 2 * n * sizeof(float));
+        for (unsigned int f = 0; f < nframes; ++f) {
+            // One file per frame, A moved in and B copied
+            morph::hdf_writer<float>::job j;
+            j.filename = "../testhdf_writer_" + std::to_string (f) + ".h5";
+            morph::vvec<float> B = frame (f, 0.5f);
+            j.add ("/A", frame (f, 0.0f));
+            j.add ("/B", B);
+            w.push (std::move (j));
+            // And all the frames appended to one compressed file
+            morph::hdf_writer<float>::job ja;
+            ja.filename = "../testhdf_writer_all.h5";
+            ja.append = true;
+            ja.compression = morph::Compression::Gzip;
+            ja.add ("/frames/A", frame (f, 0.0f));
+            w.push (std::move (ja));
+        }
+        w.wait();
+        if (w.queued() != 0 || w.errors() != 0) {
+            std::cerr << "After wait(), " << w.queued() << " queued and " << w.errors() << " errors\n";
+            --rtn;
+        }
+
+        // Appending again (after wait() closed the file) carries on in the same file
+        morph::hdf_writer<float>::job ja;
+        ja.filename = "../testhdf_writer_all.h5";
+        ja.append = true;
+        ja.add ("/frames/A", frame (nframes, 0.0f));
+        w.push (std::move (ja));
+
+        // A failed write is counted, and later jobs are still written
+        morph::hdf_writer<float>::job bad;
+        bad.filename = "../no/such/dir/x.h5";
+        bad.add ("/A", frame (0, 0.0f));
+        w.push (std::move (bad));
+    } // The destructor writes the last jobs
+
+    for (unsigned int f = 0; f < nframes; ++f) {
+        const std::string fn = "../testhdf_writer_" + std::to_string (f) + ".h5";
+        morph::vvec<float> A, B;
+        {
+            morph::HdfData d (fn, morph::FileAccess::ReadOnly);
+            d.read_contained_vals ("/A", A);
+            d.read_contained_vals ("/B", B);
+        }
+        if (A != frame (f, 0.0f) || B != frame (f, 0.5f)) {
+            std::cerr << "Frame " << f << " is wrong\n";
+            --rtn;
+        }
+        std::filesystem::remove (fn);
+    }
+    morph::vvec<morph::vvec<float>> all;
+    {
+        morph::HdfData d ("../testhdf_writer_all.h5", morph::FileAccess::ReadOnly);
+        d.read_contained_vals ("/frames/A", all);
+    }
+    if (all.size() != nframes + 1) {
+        std::cerr << "Appended file holds " << all.size() << " frames, not " << nframes + 1 << "\n";
+        --rtn;
+    } else {
+        for (unsigned int f = 0; f <= nframes; ++f) {
+            if (all[f] != frame (f, 0.0f)) {
+                std::cerr << "Appended frame " << f << " is wrong\n";
+                --rtn;
+                break;
+            }
+        }
+    }
+    std::filesystem::remove ("../testhdf_writer_all.h5");
+
+    std::cout << "testhdf_writer " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,79 @@
+// Test HdfData::map_contained_vals, which maps contiguous datasets straight from the file
+#include "morph/HdfData.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <vector>
+#include <iostream>
+#include <filesystem>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::vvec<double> d (100000);
+    d.linspace (-1.0, 1.0, d.size());
+    std::vector<int> ints = { 3, 1, 4, 1, 5, 9, 2, 6 };
+    std::vector<float> fl = { 0.5f, 1.5f, 2.5f };
+    std::vector<morph::vec<double, 3>> coords = { { 1, 2, 3 }, { 4, 5, 6 } };
+
+    {
+        morph::HdfData data("test10.h5");
+        data.add_contained_vals ("/d", d);
+        data.add_contained_vals ("/g/ints", ints);
+        data.add_contained_vals ("/g/fl", fl);
+        data.add_contained_vals ("/g/coords", coords);
+        data.compression = morph::Compression::Gzip;
+        data.add_contained_vals ("/d_gz", d);
+    }
+
+    morph::HdfData::mapped_vals<double> kept;
+    {
+        morph::HdfData data("test10.h5", morph::FileAccess::ReadOnly);
+        auto md = data.map_contained_vals<double> ("/d");
+        if (!md.mapped() || md.size() != d.size() || md.dims != std::vector<hsize_t>{ d.size() }) {
+            std::cout << "Expected /d to be mapped\n";
+            --rtn;
+        }
+        for (std::size_t i = 0; i < d.size(); ++i) { if (md[i] != d[i]) { --rtn; break; } }
+
+        // Stored as 64 bit integers, so long long int maps and int is read
+        auto mi = data.map_contained_vals<long long int> ("/g/ints");
+        auto ri = data.map_contained_vals<int> ("/g/ints");
+        if (!mi.mapped() || ri.mapped() || std::vector<int>(ri.begin(), ri.end()) != ints
+            || mi.size() != ints.size() || mi[5] != 9) { --rtn; }
+
+        // Floats are stored as doubles
+        auto mf = data.map_contained_vals<float> ("/g/fl");
+        if (mf.mapped() || mf.size() != 3u || mf[2] != 2.5f) { --rtn; }
+
+        // A 2D dataset is mapped as its elements, in row-major order
+        auto mc = data.map_contained_vals<double> ("/g/coords");
+        if (!mc.mapped() || mc.dims != std::vector<hsize_t>{ 2, 3 } || mc.span()[4] != 5.0) { --rtn; }
+
+        // A compressed dataset is chunked, so it is read
+        auto mg = data.map_contained_vals<double> ("/d_gz");
+        if (mg.mapped() || mg.size() != d.size() || mg[500] != d[500]) {
+            std::cout << "The compressed dataset was not read correctly\n";
+            --rtn;
+        }
+
+        data.read_error_action = morph::ReadErrorAction::Continue;
+        if (!data.map_contained_vals<double> ("/nothere").empty()) { --rtn; }
+
+        kept = std::move (md);
+    }
+    // The mapping outlives the HdfData
+    if (!kept.mapped() || kept[kept.size() - 1] != 1.0) { --rtn; }
+
+    {
+        // A file open for writing is read, not mapped
+        morph::HdfData data("test10.h5", morph::FileAccess::ReadWrite);
+        auto md = data.map_contained_vals<double> ("/d");
+        if (md.mapped() || md.size() != d.size()) { --rtn; }
+    }
+
+    std::filesystem::remove ("test10.h5");
+
+    std::cout << "testhdfdata10 " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
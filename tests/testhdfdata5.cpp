@@ -0,0 +1,123 @@
+// Test chunked and compressed datasets, and extendible datasets written with append_vals
+#include "morph/HdfData.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+#include <cmath>
+
+int main()
+{
+    int rtn = 0;
+
+    // A smooth field, which compresses well
+    morph::vvec<float> field (100000);
+    for (std::size_t i = 0; i < field.size(); ++i) { field[i] = std::round (100.0f * std::sin (i * 0.001f)) / 100.0f; }
+
+    {
+        morph::HdfData data("test5_plain.h5");
+        data.add_contained_vals ("/field", field);
+    }
+    {
+        morph::HdfData data("test5_gzip.h5");
+        data.compression = morph::Compression::Gzip;
+        data.add_contained_vals ("/field", field);
+        data.add_val ("/scalar", 3.0); // single values stay contiguous
+        data.chunk_dims = { 1000 };
+        data.add_contained_vals ("/group/field", field);
+    }
+    morph::vvec<float> r1, r2;
+    double scalar = 0.0;
+    {
+        morph::HdfData data("test5_gzip.h5", morph::FileAccess::ReadOnly);
+        data.read_contained_vals ("/field", r1);
+        data.read_contained_vals ("/group/field", r2);
+        data.read_val ("/scalar", scalar);
+    }
+    if (r1 != field || r2 != field || scalar != 3.0) {
+        std::cerr << "Compressed data did not read back correctly\n";
+        --rtn;
+    }
+    std::uintmax_t plain_sz = std::filesystem::file_size ("test5_plain.h5");
+    std::uintmax_t gzip_sz = std::filesystem::file_size ("test5_gzip.h5");
+    std::cout << "Uncompressed file " << plain_sz << " bytes; gzipped, with two copies " << gzip_sz << " bytes\n";
+    if (gzip_sz >= plain_sz) {
+        std::cerr << "Gzip compression did not shrink the file\n";
+        --rtn;
+    }
+
+    // Szip and LZ4 may not be available. If not, expect an exception.
+    for (auto c : { morph::Compression::Szip, morph::Compression::LZ4 }) {
+        try {
+            {
+                morph::HdfData data("test5_other.h5");
+                data.compression = c;
+                data.add_contained_vals ("/field", field);
+            }
+            morph::vvec<float> r3;
+            morph::HdfData data("test5_other.h5", morph::FileAccess::ReadOnly);
+            data.read_contained_vals ("/field", r3);
+            if (r3 != field) {
+                std::cerr << "Szip/LZ4 compressed data did not read back correctly\n";
+                --rtn;
+            }
+        } catch (const std::runtime_error& e) {
+            std::cout << "Filter not available: " << e.what() << std::endl;
+        }
+    }
+
+    // Frames appended to one dataset, over two sessions with the file
+    morph::vvec<morph::vvec<double>> frames;
+    for (int f = 0; f < 15; ++f) {
+        morph::vvec<double> fr (50);
+        for (int j = 0; j < 50; ++j) { fr[j] = f * 100 + j; }
+        frames.push_back (fr);
+    }
+    {
+        morph::HdfData data("test5_append.h5");
+        data.compression = morph::Compression::Gzip;
+        for (int f = 0; f < 10; ++f) {
+            if (data.append_vals ("/frames/A", frames[f]) != static_cast<hsize_t>(f)) {
+                std::cerr << "append_vals returned the wrong row\n";
+                --rtn;
+            }
+        }
+        try {
+            data.append_vals ("/frames/A", morph::vvec<double>(49, 0.0));
+            std::cerr << "Expected an exception for a row of the wrong length\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+        data.add_contained_vals ("/fixed", frames[0]);
+        try {
+            data.append_vals ("/fixed", frames[0]);
+            std::cerr << "Expected an exception for appending to a fixed size dataset\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+    }
+    {
+        morph::HdfData data("test5_append.h5", morph::FileAccess::ReadWrite);
+        for (int f = 10; f < 15; ++f) { data.append_vals ("/frames/A", frames[f]); }
+    }
+    morph::vvec<morph::vvec<double>> fread;
+    {
+        morph::HdfData data("test5_append.h5", morph::FileAccess::ReadOnly);
+        data.read_contained_vals ("/frames/A", fread);
+    }
+    if (fread.size() != frames.size()) {
+        std::cerr << "Read " << fread.size() << " appended frames, not " << frames.size() << "\n";
+        --rtn;
+    } else {
+        for (std::size_t f = 0; f < frames.size(); ++f) {
+            if (fread[f] != frames[f]) {
+                std::cerr << "Appended frame " << f << " differs\n";
+                --rtn;
+                break;
+            }
+        }
+    }
+
+    for (auto p : { "test5_plain.h5", "test5_gzip.h5", "test5_other.h5", "test5_append.h5" }) { std::filesystem::remove (p); }
+
+    std::cout << "testhdfdata5 " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
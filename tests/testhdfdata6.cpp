@@ -0,0 +1,125 @@
+// Test hyperslab reads (HdfData::read_slice) and streaming reads (HdfData::read_blocks)
+#include "morph/HdfData.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+
+int main()
+{
+    int rtn = 0;
+    const hsize_t nframes = 100;
+    const hsize_t n = 1000;
+    auto value = [](hsize_t f, hsize_t i) { return static_cast<double>(f * 10000 + i); };
+
+    morph::vvec<float> line (5000);
+    for (std::size_t i = 0; i < line.size(); ++i) { line[i] = static_cast<float>(i) * 0.5f; }
+    {
+        morph::HdfData data("test6.h5");
+        morph::vvec<double> fr (n);
+        for (hsize_t f = 0; f < nframes; ++f) {
+            for (hsize_t i = 0; i < n; ++i) { fr[i] = value (f, i); }
+            data.append_vals ("/frames", fr);
+        }
+        data.add_contained_vals ("/line", line);
+    }
+
+    {
+        morph::HdfData data("test6.h5", morph::FileAccess::ReadOnly);
+        std::vector<hsize_t> dims = data.get_dims ("/frames");
+        if (dims != std::vector<hsize_t>{nframes, n}) {
+            std::cerr << "Wrong dims for /frames\n";
+            --rtn;
+        }
+
+        // One frame
+        morph::vvec<double> f37;
+        data.read_slice ("/frames", {37, 0}, {1, n}, f37);
+        bool ok = f37.size() == n;
+        for (hsize_t i = 0; ok && i < n; ++i) { ok = f37[i] == value (37, i); }
+        if (!ok) {
+            std::cerr << "Wrong frame slice\n";
+            --rtn;
+        }
+
+        // A range of hexes over a range of frames, and every 10th frame of one hex, read as float
+        morph::vvec<double> block;
+        data.read_slice ("/frames", {10, 500}, {5, 8}, block);
+        std::vector<float> everytenth (10);
+        data.read_slice ("/frames", {3, 42}, {10, 1}, everytenth.data(), {10, 1});
+        ok = block.size() == 40 && block[0] == value (10, 500) && block[7] == value (10, 507) && block[39] == value (14, 507);
+        for (hsize_t k = 0; ok && k < 10; ++k) { ok = everytenth[k] == static_cast<float>(value (3 + 10 * k, 42)); }
+        if (!ok) {
+            std::cerr << "Wrong block or strided slice\n";
+            --rtn;
+        }
+
+        // 1D, with a stride
+        morph::vvec<float> odd;
+        data.read_slice ("/line", {1}, {100}, odd, {2});
+        if (odd.size() != 100 || odd[0] != line[1] || odd[99] != line[199]) {
+            std::cerr << "Wrong 1D strided slice\n";
+            --rtn;
+        }
+
+        // Errors
+        try {
+            data.read_slice ("/frames", {99, 0}, {2, n}, block);
+            std::cerr << "Expected an exception for a slice off the end\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+        try {
+            data.read_slice ("/frames", {0}, {1}, block);
+            std::cerr << "Expected an exception for a slice of the wrong rank\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+
+        // Streaming. /frames is chunked one row per chunk, so blocks are single frames.
+        {
+            auto blocks = data.read_blocks<double> ("/frames");
+            hsize_t nb = 0;
+            hsize_t expect_row = 0;
+            for (auto& b : blocks) {
+                if (b.row0 != expect_row || b.nrows != 1 || b.vals.size() != n || b.vals[5] != value (b.row0, 5)) { ok = false; }
+                expect_row += b.nrows;
+                ++nb;
+            }
+            if (nb != nframes || !ok) {
+                std::cerr << "Wrong chunk-sized blocks (" << nb << ")\n";
+                --rtn;
+            }
+        }
+        {
+            // Blocks of 7 rows; the last has 2
+            auto blocks = data.read_blocks<double> ("/frames", 7);
+            hsize_t nb = 0;
+            hsize_t rows = 0;
+            for (auto& b : blocks) {
+                for (hsize_t r = 0; r < b.nrows; ++r) {
+                    if (b.vals[r * n + 999] != value (b.row0 + r, 999)) { ok = false; }
+                }
+                rows += b.nrows;
+                ++nb;
+            }
+            if (nb != 15 || rows != nframes || !ok) {
+                std::cerr << "Wrong 7-row blocks\n";
+                --rtn;
+            }
+        }
+        {
+            // A contiguous 1D dataset in blocks of 1000 elements
+            auto blocks = data.read_blocks<float> ("/line", 1000);
+            morph::vvec<float> all;
+            for (auto& b : blocks) { all.insert (all.end(), b.vals.begin(), b.vals.end()); }
+            if (all != line) {
+                std::cerr << "Streamed 1D dataset differs\n";
+                --rtn;
+            }
+        }
+    } // data closes
+
+    std::filesystem::remove ("test6.h5");
+
+    std::cout << "testhdfdata6 " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,84 @@
+// Test the reads that go straight into the destination's memory, and the blockwise read of vvec<vvec<T>>
+#include "morph/HdfData.h"
+#include "morph/vec.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <vector>
+#include <list>
+#include <array>
+#include <filesystem>
+#include <stdexcept>
+
+int main()
+{
+    int rtn = 0;
+
+    std::vector<morph::vec<float, 3>> pos (5000);
+    for (std::size_t i = 0; i < pos.size(); ++i) { pos[i] = { i * 0.5f, i * -0.25f, 1.0f + i }; }
+    morph::vvec<morph::vec<double, 2>> pos2 (1000);
+    for (std::size_t i = 0; i < pos2.size(); ++i) { pos2[i] = { i * 0.1, i * 0.2 }; }
+    std::vector<int> ints = { 1, -2, 3, -4, 5 };
+    std::list<double> lst = { 1.5, 2.5, 3.5 };
+    // Enough rows to need several blocks, plus rows long enough to be read in place
+    morph::vvec<morph::vvec<double>> many (300000, morph::vvec<double>(4, 0.0));
+    for (std::size_t i = 0; i < many.size(); ++i) { for (std::size_t j = 0; j < 4; ++j) { many[i][j] = i * 4.0 + j; } }
+    morph::vvec<morph::vvec<float>> wide (3, morph::vvec<float>(morph::HdfData::read_block_elements + 7, 0.0f));
+    for (std::size_t i = 0; i < wide.size(); ++i) { wide[i][i] = 1.0f; wide[i].back() = -1.0f * i; }
+
+    {
+        morph::HdfData data("test7.h5");
+        data.add_contained_vals ("/pos", pos);
+        data.add_contained_vals ("/pos2", pos2);
+        data.add_contained_vals ("/ints", ints);
+        data.add_contained_vals ("/lst", lst);
+        data.add_contained_vals ("/many", many);
+        data.add_contained_vals ("/wide", wide);
+    }
+
+    std::vector<morph::vec<float, 3>> rpos;
+    morph::vvec<morph::vec<double, 2>> rpos2;
+    morph::vvec<int> rints;
+    std::list<double> rlst;
+    morph::vvec<morph::vvec<double>> rmany;
+    morph::vvec<morph::vvec<float>> rwide;
+    {
+        morph::HdfData data("test7.h5", morph::FileAccess::ReadOnly);
+        data.read_contained_vals ("/pos", rpos);
+        data.read_contained_vals ("/pos2", rpos2);
+        data.read_contained_vals ("/ints", rints);
+        data.read_contained_vals ("/lst", rlst);
+        data.read_contained_vals ("/many", rmany);
+        data.read_contained_vals ("/wide", rwide);
+
+        // An array is read in place, so its size must match the dataset
+        try {
+            std::array<int, 3> a;
+            data.read_contained_vals ("/ints", a);
+            std::cerr << "Expected an exception reading 5 values into array<int, 3>\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+        std::array<int, 5> a5;
+        data.read_contained_vals ("/ints", a5);
+        if (std::vector<int>(a5.begin(), a5.end()) != ints) { std::cerr << "array<int, 5> read wrongly\n"; --rtn; }
+
+        // The wrong width of vec
+        try {
+            std::vector<morph::vec<float, 2>> bad;
+            data.read_contained_vals ("/pos", bad);
+            std::cerr << "Expected an exception reading 3D positions into vec<float, 2>\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+    }
+
+    if (rpos != pos) { std::cerr << "vector<vec<float, 3>> read wrongly\n"; --rtn; }
+    if (rpos2 != pos2) { std::cerr << "vvec<vec<double, 2>> read wrongly\n"; --rtn; }
+    if (std::vector<int>(rints) != ints) { std::cerr << "vvec<int> read wrongly\n"; --rtn; }
+    if (rlst != lst) { std::cerr << "list<double> read wrongly\n"; --rtn; }
+    if (rmany != many) { std::cerr << "vvec<vvec<double>> of many rows read wrongly\n"; --rtn; }
+    if (rwide != wide) { std::cerr << "vvec<vvec<float>> of wide rows read wrongly\n"; --rtn; }
+
+    std::filesystem::remove ("test7.h5");
+
+    std::cout << "testhdfdata7 " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,60 @@
+// Test add_rank_vals/read_rank_vals. Built without MPI, the file has a single rank.
+#include "morph/HdfData.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::vvec<double> state (1000);
+    state.linspace (0.0, 1.0, 1000);
+    morph::vvec<int> params = { 3, 1, 4 };
+
+    {
+        morph::HdfData data("test8.h5");
+        if (data.rank() != 0 || data.ranks() != 1) { std::cerr << "Expected rank 0 of 1\n"; --rtn; }
+        data.add_rank_vals ("/sweep/state", state);
+        data.add_rank_vals ("/sweep/params", params);
+        data.compression = morph::Compression::Gzip;
+        data.add_rank_vals ("/sweep/state_gz", state);
+    }
+    {
+        // Rewrite a row in an existing file
+        morph::HdfData data("test8.h5", morph::FileAccess::ReadWrite);
+        params[0] = 2;
+        data.add_rank_vals ("/sweep/params", params);
+    }
+
+    morph::vvec<double> r1, r2;
+    morph::vvec<int> rp;
+    morph::vvec<morph::vvec<double>> all;
+    {
+        morph::HdfData data("test8.h5", morph::FileAccess::ReadOnly);
+        data.read_rank_vals ("/sweep/state", r1);
+        data.read_rank_vals ("/sweep/state_gz", r2, 0);
+        data.read_rank_vals ("/sweep/params", rp);
+        // The whole shared dataset, one row per rank
+        data.read_contained_vals ("/sweep/state", all);
+        if (data.get_dims ("/sweep/state") != std::vector<hsize_t>{ 1, 1000 }) {
+            std::cerr << "Shared dataset has the wrong shape\n";
+            --rtn;
+        }
+        try {
+            data.read_rank_vals ("/sweep/state", r1, 1);
+            std::cerr << "Expected an exception reading a missing rank's row\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+    }
+    if (r1 != state || r2 != state || rp != params || all.size() != 1 || all[0] != state) {
+        std::cerr << "Rank rows read back wrongly\n";
+        --rtn;
+    }
+
+    std::filesystem::remove ("test8.h5");
+
+    std::cout << "testhdfdata8 " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
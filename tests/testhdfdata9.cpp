@@ -0,0 +1,85 @@
+// Test HdfData::batch_scalars, which writes the scalars of each group as one compound dataset
+#include "morph/HdfData.h"
+#include <bitset>
+#include <string>
+#include <iostream>
+#include <filesystem>
+
+int main()
+{
+    int rtn = 0;
+
+    {
+        morph::HdfData data("test9.h5");
+        data.batch_scalars = true;
+        for (int i = 0; i < 3000; ++i) { data.add_val (("/params/p" + std::to_string (i)).c_str(), 0.5 * i); }
+        data.add_val ("/params/n", 42);
+        data.add_val ("/params/flag", true);
+        data.add_val ("/params/big", 12345678901234ull);
+        data.add_val ("/params/f", 1.5f);
+        data.add_val ("/params/bits", std::bitset<8>("10100101"));
+        data.add_string ("/params/name", "run seven");
+        data.add_string ("/params/empty", "");
+        data.add_val ("/top", -3.25);
+        data.add_val ("/params/n", 43); // replaces the first
+        data.flush();
+        // A later flush into the same group keeps what was written before
+        data.add_val ("/params/later", 7u);
+        // Datasets added while batching are written as usual
+        data.add_contained_vals ("/params/vec", std::vector<double>{ 1.0, 2.0 });
+    }
+    {
+        // Add to the batch dataset of an existing file
+        morph::HdfData data("test9.h5", morph::FileAccess::ReadWrite);
+        data.batch_scalars = true;
+        data.add_val ("/params/p0", -1.0);
+        data.add_val ("/params/added", 9);
+    }
+    {
+        morph::HdfData data("test9.h5", morph::FileAccess::ReadOnly);
+        double d = 0.0, top = 0.0;
+        for (int i = 1; i < 3000; ++i) {
+            data.read_val (("/params/p" + std::to_string (i)).c_str(), d);
+            if (d != 0.5 * i) { --rtn; break; }
+        }
+        data.read_val ("/params/p0", d);
+        if (d != -1.0) { std::cout << "p0 " << d << " not rewritten\n"; --rtn; }
+        int n = 0, added = 0;
+        bool flag = false;
+        unsigned long long int big = 0;
+        float f = 0.0f;
+        unsigned int later = 0;
+        std::bitset<8> bits;
+        std::string name, empty = "x";
+        data.read_val ("/params/n", n);
+        data.read_val ("/params/added", added);
+        data.read_val ("/params/flag", flag);
+        data.read_val ("/params/big", big);
+        data.read_val ("/params/f", f);
+        data.read_val ("/params/later", later);
+        data.read_val ("/params/bits", bits);
+        data.read_string ("/params/name", name);
+        data.read_string ("/params/empty", empty);
+        data.read_val ("/top", top);
+        if (n != 43 || added != 9 || !flag || big != 12345678901234ull || f != 1.5f || later != 7u
+            || bits != std::bitset<8>("10100101") || name != "run seven" || !empty.empty() || top != -3.25) {
+            std::cout << "Batched values read back wrongly\n";
+            --rtn;
+        }
+        std::vector<double> v;
+        data.read_contained_vals ("/params/vec", v);
+        if (v.size() != 2u) { --rtn; }
+        // A few datasets hold the group's scalars, as there are too many for the header of one
+        if (!data.exists ("/params/_batch") || !data.exists ("/params/_batch1") || data.exists ("/params/p1")) { --rtn; }
+        // A missing value is still missing
+        data.read_error_action = morph::ReadErrorAction::Continue;
+        double missing = 11.0;
+        data.read_val ("/params/nothere", missing);
+        if (missing != 11.0) { --rtn; }
+    }
+
+    std::filesystem::remove ("test9.h5");
+
+    std::cout << "testhdfdata9 " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,94 @@
+/*
+ * Test morph::hex_contours against a direct walk of the HexGrid's Hexes, and check that the
+ * ShapeAnalysis contour functions built on it give the same results.
+ */
+#include "morph/ShapeAnalysis.h"
+#include "morph/HexGrid.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <list>
+
+// The contour of field i of f, found by walking the Hexes and their neighbour pointers
+std::vector<unsigned int> walk_contour (const morph::HexGrid& hg, const std::vector<std::vector<float>>& f,
+                                        unsigned int i, float threshold, bool normalise)
+{
+    float minf = +1e7f;
+    float maxf = -1e7f;
+    for (const morph::Hex& h : hg.hexen) {
+        if (h.onBoundary()) { continue; }
+        for (const auto& fj : f) { minf = std::min (minf, fj[h.vi]); maxf = std::max (maxf, fj[h.vi]); }
+    }
+    const float scalef = normalise ? 1.0f / (maxf - minf) : 1.0f;
+    if (!normalise) { minf = 0.0f; }
+    auto nf = [&](unsigned int vi) { return (f[i][vi] - minf) * scalef; };
+    std::vector<unsigned int> c;
+    for (const morph::Hex& h : hg.hexen) {
+        if (nf (h.vi) < threshold) { continue; }
+        if (h.onBoundary()) {
+            if (normalise) { c.push_back (h.vi); }
+        } else if ((h.has_ne() && nf (h.ne->vi) < threshold) || (h.has_nne() && nf (h.nne->vi) < threshold)
+                   || (h.has_nnw() && nf (h.nnw->vi) < threshold) || (h.has_nw() && nf (h.nw->vi) < threshold)
+                   || (h.has_nsw() && nf (h.nsw->vi) < threshold) || (h.has_nse() && nf (h.nse->vi) < threshold)) {
+            c.push_back (h.vi);
+        }
+    }
+    return c;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+    hg.setEllipticalBoundary (0.8f, 0.5f);
+    const unsigned int nhex = hg.num();
+
+    // Four smooth fields, so that the contours are long curves
+    std::vector<std::vector<float>> f (4, std::vector<float> (nhex));
+    for (unsigned int i = 0; i < f.size(); ++i) {
+        for (unsigned int h = 0; h < nhex; ++h) {
+            f[i][h] = std::sin ((3.0f + i) * hg.d_x[h]) * std::cos ((2.0f + i) * hg.d_y[h]) + 0.1f * i;
+        }
+    }
+
+    morph::hex_contours<float> hc (hg);
+    for (float threshold : { 0.3f, 0.5f, 0.7f }) {
+        const std::vector<std::vector<unsigned int>>& c = hc.find (f, threshold);
+        if (c.size() != f.size()) { std::cerr << "Wrong number of contours\n"; --rtn; continue; }
+        for (unsigned int i = 0; i < f.size(); ++i) {
+            if (c[i] != walk_contour (hg, f, i, threshold, true)) { std::cerr << "Contour " << i << " differs\n"; --rtn; }
+            if (c[i].empty()) { std::cerr << "Contour " << i << " is empty\n"; --rtn; }
+        }
+        if (hc.find_nonorm (f[1], threshold) != walk_contour (hg, f, 1, threshold, false)) {
+            std::cerr << "Unnormalised contour differs\n";
+            --rtn;
+        }
+    }
+
+    // The ShapeAnalysis functions agree with the kernel
+    std::vector<std::list<morph::Hex>> lc = morph::ShapeAnalysis<float>::get_contours (&hg, f, 0.5f);
+    const std::vector<std::vector<unsigned int>>& c = hc.find (f, 0.5f);
+    for (unsigned int i = 0; i < f.size(); ++i) {
+        std::vector<unsigned int> vis;
+        for (const morph::Hex& h : lc[i]) { vis.push_back (h.vi); }
+        if (vis != c[i]) { std::cerr << "get_contours differs for field " << i << "\n"; --rtn; }
+    }
+    std::vector<float> map = morph::ShapeAnalysis<float>::get_contour_map (&hg, f, 0.5f);
+    std::vector<float> map_nz = morph::ShapeAnalysis<float>::get_contour_map_nozero (&hg, f, 0.5f);
+    std::vector<float> expect (nhex, 0.0f), expect_nz (nhex, 0.0f);
+    for (unsigned int i = 0; i < f.size(); ++i) {
+        for (unsigned int vi : c[i]) { expect[vi] = i / 4.0f; expect_nz[vi] = (i + 1) / 5.0f; }
+    }
+    if (map != expect || map_nz != expect_nz) { std::cerr << "Contour maps differ\n"; --rtn; }
+
+    // A field of the wrong size is an error
+    try {
+        hc.find_nonorm (std::vector<float> (nhex - 1, 0.0f), 0.5f);
+        std::cerr << "Expected an exception for a short field\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,144 @@
+/*
+ * Test HexGrid::initCached, saveCache and loadCache: a grid loaded from the cache must
+ * be the same as the one that was constructed, and a changed boundary must miss.
+ */
+#define HEXGRID_COMPILE_LOAD_AND_SAVE 1
+#include "morph/HexGrid.h"
+#include "morph/HexGridFlat.h"
+#include "morph/ReadCurves.h"
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+
+// Compare two grids, hex by hex and neighbour by neighbour
+int compare_grids (morph::HexGrid& a, morph::HexGrid& b, bool check_bhexen = true)
+{
+    int rtn = 0;
+    if (a.num() != b.num() || a.d_x != b.d_x || a.d_y != b.d_y || a.d_flags != b.d_flags
+        || a.d_ne != b.d_ne || a.d_nne != b.d_nne || a.d_nnw != b.d_nnw
+        || a.d_nw != b.d_nw || a.d_nsw != b.d_nsw || a.d_nse != b.d_nse
+        || a.d_distToBoundary != b.d_distToBoundary || a.hexorder != b.hexorder) {
+        std::cerr << "d_ vectors differ\n";
+        return -1;
+    }
+    auto ai = a.hexen.begin();
+    auto bi = b.hexen.begin();
+    for (; ai != a.hexen.end(); ++ai, ++bi) {
+        if (ai->vi != bi->vi || ai->x != bi->x || ai->y != bi->y || ai->ri != bi->ri || ai->gi != bi->gi
+            || ai->getFlags() != bi->getFlags() || ai->distToBoundary != bi->distToBoundary) { --rtn; break; }
+        if ((ai->has_ne() && ai->ne->vi != bi->ne->vi) || (ai->has_nne() && ai->nne->vi != bi->nne->vi)
+            || (ai->has_nnw() && ai->nnw->vi != bi->nnw->vi) || (ai->has_nw() && ai->nw->vi != bi->nw->vi)
+            || (ai->has_nsw() && ai->nsw->vi != bi->nsw->vi) || (ai->has_nse() && ai->nse->vi != bi->nse->vi)) { --rtn; break; }
+    }
+    if (rtn) { std::cerr << "Hexes differ\n"; }
+    if (check_bhexen && a.bhexen.size() != b.bhexen.size()) { std::cerr << "Boundary hexes differ\n"; --rtn; }
+    morph::vec<float, 2> p = { 0.123f, -0.2f };
+    if (a.findHexNearest (p)->vi != b.findHexNearest (p)->vi) { std::cerr << "findHexNearest differs\n"; --rtn; }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    using sc = std::chrono::steady_clock;
+    const std::string cachedir = "../hexgrid_cache";
+    std::filesystem::remove_all (cachedir);
+    std::filesystem::create_directories (cachedir);
+
+    try {
+        morph::ReadCurves r ("../../tests/trial.svg");
+        morph::BezCurvePath<float> bound = r.getCorticalPath();
+
+        // The reference, built the ordinary way
+        morph::HexGrid ref (0.02f, 3.0f, 0.0f);
+        ref.hexorder = morph::HexGridOrder::hilbert;
+        ref.setBoundary (bound);
+
+        sc::time_point t0 = sc::now();
+        morph::HexGrid hg1;
+        hg1.hexorder = morph::HexGridOrder::hilbert;
+        bool hit1 = hg1.initCached (0.02f, 3.0f, 0.0f, bound, cachedir);
+        sc::time_point t1 = sc::now();
+        morph::HexGrid hg2;
+        hg2.hexorder = morph::HexGridOrder::hilbert;
+        bool hit2 = hg2.initCached (0.02f, 3.0f, 0.0f, bound, cachedir);
+        sc::time_point t2 = sc::now();
+        std::cout << hg1.num() << " hexes: constructed in " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+                  << " ms; loaded from cache in " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms\n";
+        if (hit1 || !hit2) { std::cerr << "Expected a cache miss then a hit\n"; --rtn; }
+        rtn += compare_grids (ref, hg1);
+        rtn += compare_grids (ref, hg2);
+
+        // Cache the distances to the boundary too
+        ref.computeDistanceToBoundary();
+        ref.populate_d_vectors();
+        unsigned long long int key = ref.cacheKey (0.02f, 3.0f, 0.0f, bound);
+        ref.saveCache (morph::HexGrid::cacheName (cachedir, key), key);
+        morph::HexGrid hg3;
+        hg3.hexorder = morph::HexGridOrder::hilbert;
+        if (!hg3.initCached (0.02f, 3.0f, 0.0f, bound, cachedir)) { std::cerr << "Expected a cache hit\n"; --rtn; }
+        rtn += compare_grids (ref, hg3);
+
+        // A different d, ordering or boundary is a different grid
+        morph::HexGrid hg4;
+        if (hg4.cacheKey (0.02f, 3.0f, 0.0f, bound) == key) { std::cerr << "hexorder did not change the key\n"; --rtn; }
+        hg4.hexorder = morph::HexGridOrder::hilbert;
+        if (hg4.cacheKey (0.021f, 3.0f, 0.0f, bound) == key) { std::cerr << "d did not change the key\n"; --rtn; }
+        morph::ReadCurves r2 ("../../boundaries/ellipse.svg");
+        if (hg4.cacheKey (0.02f, 3.0f, 0.0f, r2.getCorticalPath()) == key) { std::cerr << "The boundary did not change the key\n"; --rtn; }
+        // and loadCache refuses a file saved with another key
+        if (hg4.loadCache (morph::HexGrid::cacheName (cachedir, key), key + 1) || hg4.num() != 0) {
+            std::cerr << "loadCache accepted the wrong key\n";
+            --rtn;
+        }
+        if (hg4.loadCache (cachedir + "/nonexistent.h5")) { std::cerr << "loadCache accepted a missing file\n"; --rtn; }
+
+        // A cache missing a dataset is refused, leaving the grid as it was
+        for (const char* dset : { "/originalBoundaryCentroid", "/d_nse" }) {
+            const std::string broken = cachedir + "/broken.h5";
+            std::filesystem::copy_file (morph::HexGrid::cacheName (cachedir, key), broken,
+                                        std::filesystem::copy_options::overwrite_existing);
+            hid_t bf = H5Fopen (broken.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+            H5Ldelete (bf, dset, H5P_DEFAULT);
+            H5Fclose (bf);
+            morph::HexGrid hg6 (0.05f, 1.0f, 0.0f);
+            morph::HexGrid hg7 (0.05f, 1.0f, 0.0f);
+            if (hg6.loadCache (broken, key)) { std::cerr << "loadCache accepted a cache without " << dset << "\n"; --rtn; }
+            if (hg6.getd() != 0.05f || hg6.getv() != hg7.getv()
+                || hg6.boundaryCentroid != hg7.boundaryCentroid || hg6.d_size != hg7.d_size) {
+                std::cerr << "A failed loadCache changed the grid\n";
+                --rtn;
+            }
+            rtn += compare_grids (hg6, hg7);
+        }
+
+        // The ordinary save/load still round trips (though load() doesn't repopulate bhexen)
+        ref.save ("../hexgrid_cache_save.h5");
+        morph::HexGrid hg5 ("../hexgrid_cache_save.h5");
+        rtn += compare_grids (ref, hg5, false);
+
+        // HexGridFlat reads the d_ vectors of either file, and round trips its own
+        morph::HexGridFlat f1 (morph::HexGrid::cacheName (cachedir, key));
+        morph::HexGridFlat f2 ("../hexgrid_cache_save.h5");
+        f2.save ("../hexgrid_flat_save.h5");
+        morph::HexGridFlat f3 ("../hexgrid_flat_save.h5");
+        for (const morph::HexGridFlat* f : { &f1, &f2, &f3 }) {
+            if (f->num() != ref.num() || f->d_x != ref.d_x || f->d_flags != ref.d_flags || f->d_nnw != ref.d_nnw
+                || f->d_distToBoundary != ref.d_distToBoundary || f->getd() != ref.getd()) {
+                std::cerr << "HexGridFlat::load differs\n";
+                --rtn;
+            }
+        }
+        std::filesystem::remove ("../hexgrid_cache_save.h5");
+        std::filesystem::remove ("../hexgrid_flat_save.h5");
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    std::filesystem::remove_all (cachedir);
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
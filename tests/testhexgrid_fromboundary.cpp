@@ -0,0 +1,131 @@
+/*
+ * Test that HexGrid::initFromBoundary makes the same grid as init followed by setBoundary,
+ * without building the full hexagonal grid.
+ */
+#include "morph/HexGrid.h"
+#include "morph/mathconst.h"
+#include <iostream>
+#include <vector>
+#include <map>
+#include <utility>
+#include <chrono>
+#include <cmath>
+
+// A closed boundary r(phi) = r0 (1 + k cos (lobes phi)) (stretched by sx in x), sampled finely
+std::vector<morph::BezCoord<float>> lobed (const float r0, const float k, const int lobes, const float sx, const float step)
+{
+    std::vector<morph::BezCoord<float>> b;
+    const float len = morph::mathconst<float>::two_pi * r0 * sx * (1.0f + k * lobes);
+    const int n = static_cast<int>(len / step);
+    for (int i = 0; i < n; ++i) {
+        const float phi = morph::mathconst<float>::two_pi * i / n;
+        const float r = r0 * (1.0f + k * std::cos (lobes * phi));
+        b.push_back (morph::BezCoord<float>(morph::vec<float, 2>{ 0.1f + sx * r * std::cos (phi), -0.05f + r * std::sin (phi) }));
+    }
+    return b;
+}
+
+// The d_ neighbour indices must refer to the hexes at the neighbouring axial coordinates
+int check_neighbours (const morph::HexGrid& hg)
+{
+    int rtn = 0;
+    const std::vector<int>* nbs[6] = { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse };
+    static constexpr int dr[6] = { 1, 0, -1, -1, 0, 1 };
+    static constexpr int dg[6] = { 0, 1, 1, 0, -1, -1 };
+    for (unsigned int i = 0; i < hg.num(); ++i) {
+        for (int k = 0; k < 6; ++k) {
+            const int j = (*nbs[k])[i];
+            if (j >= 0 && (hg.d_ri[j] != hg.d_ri[i] + dr[k] || hg.d_gi[j] != hg.d_gi[i] + dg[k])) { --rtn; }
+            if (j >= 0 && (hg.vhexen[i]->di != i || hg.vhexen[i]->vi != i)) { --rtn; }
+        }
+    }
+    return rtn;
+}
+
+int check (const float d, const std::vector<morph::BezCoord<float>>& boundary, const bool loffset)
+{
+    using sc = std::chrono::steady_clock;
+    int rtn = 0;
+
+    std::vector<morph::BezCoord<float>> b1 = boundary;
+    sc::time_point t0 = sc::now();
+    morph::HexGrid hb;
+    hb.initFromBoundary (d, b1, 0.0f, loffset);
+    sc::time_point t1 = sc::now();
+
+    // The x_span of hb is enough to hold the boundary
+    std::vector<morph::BezCoord<float>> b2 = boundary;
+    morph::HexGrid hg (d, hb.getXspan(), 0.0f);
+    hg.setBoundary (b2, loffset);
+    sc::time_point t2 = sc::now();
+
+    std::cout << "d=" << d << ": " << hg.num() << " hexes; init+setBoundary "
+              << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms, initFromBoundary "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+
+    // The same hexes, with the same flags
+    std::map<std::pair<int, int>, unsigned int> flags;
+    for (const auto& h : hg.hexen) { flags[{ h.ri, h.gi }] = h.getFlags(); }
+    if (hb.num() != hg.num()) { std::cerr << "initFromBoundary made " << hb.num() << " hexes, not " << hg.num() << "\n"; --rtn; }
+    for (const auto& h : hb.hexen) {
+        auto f = flags.find ({ h.ri, h.gi });
+        if (f == flags.end() || f->second != h.getFlags()) { std::cerr << "Hex " << h.ri << "," << h.gi << " differs\n"; --rtn; break; }
+    }
+    if (hb.getBoundary().size() != hg.getBoundary().size()) { std::cerr << "Different numbers of boundary hexes\n"; --rtn; }
+    if (hb.boundaryCentroid != hg.boundaryCentroid || hb.originalBoundaryCentroid != hg.originalBoundaryCentroid) {
+        std::cerr << "Different boundary centroids\n"; --rtn;
+    }
+    rtn += check_neighbours (hb);
+
+    // Along a Hilbert curve the two grids are numbered identically
+    std::vector<morph::BezCoord<float>> b3 = boundary;
+    morph::HexGrid hbh;
+    hbh.hexorder = morph::HexGridOrder::hilbert;
+    hbh.initFromBoundary (d, b3, 0.0f, loffset);
+    std::vector<morph::BezCoord<float>> b4 = boundary;
+    morph::HexGrid hgh (d, hb.getXspan(), 0.0f);
+    hgh.hexorder = morph::HexGridOrder::hilbert;
+    hgh.setBoundary (b4, loffset);
+    if (hbh.identityHash() != hgh.identityHash() || hbh.d_flags != hgh.d_flags) {
+        std::cerr << "Hilbert ordered grids differ\n"; --rtn;
+    }
+    rtn += check_neighbours (hbh);
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    for (float d : { 0.05f, 0.01f }) {
+        rtn += check (d, lobed (0.8f, 0.1f, 1, 1.0f, d / 4.0f), false);
+        // An elongated outline, most of whose hexagonal grid would be discarded
+        rtn += check (d, lobed (0.3f, 0.2f, 3, 4.0f, d / 4.0f), true);
+        // Deep lobes make narrow, concave channels
+        rtn += check (d, lobed (0.6f, 0.6f, 7, 1.0f, d / 4.0f), false);
+    }
+
+    // A BezCurvePath boundary, given as an ellipse
+    morph::HexGrid he;
+    std::vector<morph::BezCoord<float>> e = he.ellipseCompute (1.2f, 0.4f);
+    morph::BezCurvePath<float> bp;
+    for (std::size_t i = 0; i < e.size(); ++i) {
+        morph::BezCurve<float> c (e[i].coord, e[(i + 1) % e.size()].coord);
+        bp.addCurve (c);
+    }
+    he.initFromBoundary (0.02f, bp);
+    morph::HexGrid hf (0.02f, he.getXspan(), 0.0f);
+    hf.setBoundary (bp);
+    if (he.num() != hf.num() || he.num() == 0) { std::cerr << "BezCurvePath boundary gave " << he.num() << " hexes, not " << hf.num() << "\n"; --rtn; }
+
+    // A boundary with no points isn't a grid
+    try {
+        std::vector<morph::BezCoord<float>> none;
+        morph::HexGrid hn;
+        hn.initFromBoundary (0.02f, none);
+        --rtn;
+    } catch (const std::exception&) {}
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
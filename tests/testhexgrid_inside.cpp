@@ -0,0 +1,75 @@
+/*
+ * Test that HexGrid::setBoundary keeps exactly the boundary hexes and the hexes whose
+ * centres lie inside the boundary, for a convex and for a strongly concave boundary.
+ */
+#include "morph/HexGrid.h"
+#include "morph/mathconst.h"
+#include <iostream>
+#include <vector>
+#include <set>
+#include <utility>
+#include <cmath>
+
+// A closed boundary r(phi) = r0 (1 + k cos (lobes phi)), sampled finely
+std::vector<morph::BezCoord<float>> lobed (const float r0, const float k, const int lobes, const float step)
+{
+    std::vector<morph::BezCoord<float>> b;
+    const float len = morph::mathconst<float>::two_pi * r0 * (1.0f + k * lobes);
+    const int n = static_cast<int>(len / step);
+    for (int i = 0; i < n; ++i) {
+        const float phi = morph::mathconst<float>::two_pi * i / n;
+        const float r = r0 * (1.0f + k * std::cos (lobes * phi));
+        b.push_back (morph::BezCoord<float>(morph::vec<float, 2>{ r * std::cos (phi), r * std::sin (phi) }));
+    }
+    return b;
+}
+
+// Even-odd test of the point (x,y) against every edge of the closed boundary b
+bool inside (const std::vector<morph::BezCoord<float>>& b, const float x, const float y)
+{
+    bool in = false;
+    for (std::size_t i = 0, j = b.size() - 1; i < b.size(); j = i++) {
+        if ((b[i].y() > y) != (b[j].y() > y)
+            && x < b[j].x() + (y - b[j].y()) * (b[i].x() - b[j].x()) / (b[i].y() - b[j].y())) { in = !in; }
+    }
+    return in;
+}
+
+int check (const float d, const std::vector<morph::BezCoord<float>>& boundary)
+{
+    int rtn = 0;
+    morph::HexGrid full (d, 3.0f, 0.0f);
+    morph::HexGrid hg (d, 3.0f, 0.0f);
+    std::vector<morph::BezCoord<float>> b = boundary;
+    hg.setBoundary (b, false);
+
+    std::set<std::pair<int, int>> kept;
+    for (const auto& h : hg.hexen) { kept.insert ({ h.ri, h.gi }); }
+
+    unsigned int ninside = 0;
+    for (const auto& h : full.hexen) {
+        const bool in = inside (boundary, h.x, h.y);
+        if (in) {
+            ++ninside;
+            if (kept.count ({ h.ri, h.gi }) == 0) { std::cerr << "Hex at " << h.x << "," << h.y << " is inside but was discarded\n"; --rtn; }
+        }
+    }
+    for (const auto& h : hg.hexen) {
+        const bool in = inside (boundary, h.x, h.y);
+        if (!in && !h.boundaryHex()) { std::cerr << "Hex at " << h.x << "," << h.y << " is outside but was kept\n"; --rtn; }
+    }
+    std::cout << "d=" << d << ": kept " << hg.num() << " hexes, " << ninside << " with centres inside\n";
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    for (float d : { 0.05f, 0.02f }) {
+        rtn += check (d, lobed (0.8f, 0.1f, 1, d / 4.0f));
+        // Deep lobes make narrow, concave channels
+        rtn += check (d, lobed (0.6f, 0.6f, 7, d / 4.0f));
+    }
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
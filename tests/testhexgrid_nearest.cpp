@@ -0,0 +1,60 @@
+/*
+ * Test HexGrid::findHexNearest (which uses an axial-coordinate index) against an
+ * exhaustive search, for single and batch queries.
+ */
+#include "morph/HexGrid.h"
+#include "morph/Random.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <list>
+#include <limits>
+#include <cmath>
+
+// The exhaustive search
+unsigned int nearest_vi (const std::list<morph::Hex>& hexen, const morph::vec<float, 2>& pos)
+{
+    unsigned int vi = 0;
+    float dist = std::numeric_limits<float>::max();
+    for (auto h : hexen) {
+        float dx = pos[0] - h.x;
+        float dy = pos[1] - h.y;
+        float dl = std::sqrt (dx*dx + dy*dy);
+        if (dl < dist) {
+            dist = dl;
+            vi = h.vi;
+        }
+    }
+    return vi;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg(0.02f, 3.0f, 0.0f);
+    hg.setEllipticalBoundary (0.8f, 0.5f);
+
+    // Query points over the grid and around (and beyond) its edges
+    morph::RandUniform<float> rng(-1.2f, 1.2f);
+    morph::vvec<morph::vec<float, 2>> posns (5000);
+    for (auto& p : posns) { p = { rng.get(), rng.get() }; }
+
+    unsigned int mismatches = 0;
+    for (auto p : posns) {
+        if (hg.findHexNearest (p)->vi != nearest_vi (hg.hexen, p)) { ++mismatches; }
+    }
+
+    morph::vvec<unsigned int> batch = hg.findHexNearest (posns);
+    for (unsigned int i = 0; i < posns.size(); ++i) {
+        if (batch[i] != nearest_vi (hg.hexen, posns[i])) { ++mismatches; }
+    }
+
+    if (mismatches > 0) {
+        std::cout << mismatches << " queries did not find the nearest hex\n";
+        rtn = -1;
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
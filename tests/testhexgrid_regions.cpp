@@ -0,0 +1,104 @@
+/*
+ * Test the region queries of HexGrid: hexagonalRegionIndices against getHexagonalRegion,
+ * getRegionIndices against getRegion, the memoisation of both, and the index to iterator
+ * table ihexen.
+ */
+#include "morph/HexGrid.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <vector>
+#include <set>
+#include <span>
+
+std::set<unsigned int> to_set (const std::vector<std::list<morph::Hex>::iterator>& region)
+{
+    std::set<unsigned int> s;
+    for (auto h : region) { s.insert (h->vi); }
+    return s;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+
+    // ihexen[vi] is the Hex with vector index vi
+    for (unsigned int i = 0; i < hg.num(); ++i) {
+        if (hg.ihexen[i]->vi != i || &(*hg.ihexen[i]) != hg.vhexen[i]) {
+            std::cout << "ihexen[" << i << "] is the wrong Hex\n";
+            --rtn;
+            break;
+        }
+    }
+
+    // Hexagonal regions well inside the boundary are the same as getHexagonalRegion's
+    unsigned int checked = 0;
+    for (unsigned int i = 0; i < hg.num(); i += 37) {
+        if (hg.d_x[i] * hg.d_x[i] + hg.d_y[i] * hg.d_y[i] > 0.3f * 0.3f) { continue; }
+        for (float radius : { 0.0f, 0.02f, 0.05f, 0.1f }) {
+            std::set<unsigned int> expected = to_set (hg.getHexagonalRegion (i, radius));
+            std::span<const unsigned int> region = hg.hexagonalRegionIndices (i, radius);
+            std::set<unsigned int> got (region.begin(), region.end());
+            if (got != expected || region.size() != expected.size()) {
+                std::cout << "Hexagonal region about " << i << " of radius " << radius << " differs ("
+                          << region.size() << " hexes, expected " << expected.size() << ")\n";
+                --rtn;
+            }
+            // A repeated query returns the memoised region
+            if (hg.hexagonalRegionIndices (i, radius).data() != region.data()) {
+                std::cout << "Hexagonal region about " << i << " was not memoised\n";
+                --rtn;
+            }
+            ++checked;
+        }
+    }
+    if (checked == 0) { --rtn; }
+
+    // Near the boundary the region is cut off where the grid ends
+    {
+        unsigned int edge = hg.bhexen.front()->vi;
+        std::span<const unsigned int> region = hg.hexagonalRegionIndices (edge, 0.05f);
+        if (region.empty() || region.size() >= 37) {
+            std::cout << "A region at the boundary has " << region.size() << " hexes\n";
+            --rtn;
+        }
+    }
+
+    // A path region is the same as getRegion's, and is memoised by its points
+    {
+        std::vector<morph::BezCoord<float>> pts = hg.ellipseCompute (0.2f, 0.15f, { 0.1f, -0.05f });
+        std::vector<morph::BezCoord<float>> pts_copy = pts;
+        morph::vec<float, 2> centroid;
+        std::set<unsigned int> expected = to_set (hg.getRegion (pts_copy, centroid, false));
+        std::span<const unsigned int> region = hg.getRegionIndices (pts, false);
+        std::set<unsigned int> got (region.begin(), region.end());
+        if (expected.empty() || got != expected) {
+            std::cout << "Path region has " << got.size() << " hexes, expected " << expected.size() << "\n";
+            --rtn;
+        }
+        if (hg.getRegionIndices (pts, false).data() != region.data()) {
+            std::cout << "Path region was not memoised\n";
+            --rtn;
+        }
+        // A different path is a different region
+        std::vector<morph::BezCoord<float>> pts2 = hg.ellipseCompute (0.1f, 0.1f, { -0.2f, 0.1f });
+        if (hg.getRegionIndices (pts2, false).size() >= region.size()) {
+            std::cout << "A smaller path did not give a smaller region\n";
+            --rtn;
+        }
+
+        // After clearRegionCache the region is found again
+        hg.clearRegionCache();
+        std::span<const unsigned int> again = hg.getRegionIndices (pts, false);
+        std::set<unsigned int> got2 (again.begin(), again.end());
+        if (got2 != expected) {
+            std::cout << "Path region differs after clearRegionCache\n";
+            --rtn;
+        }
+    }
+
+    std::cout << "testhexgrid_regions " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
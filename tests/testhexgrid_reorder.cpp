@@ -0,0 +1,82 @@
+/*
+ * Test the space-filling curve orderings of HexGrid (HexGrid::hexorder and
+ * HexGrid::reorder) and that the ordering survives a save/load round trip.
+ */
+#define HEXGRID_COMPILE_LOAD_AND_SAVE 1
+#include "morph/HexGrid.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+
+// Mean separation in memory of each hex from its E and NE neighbours
+float mean_neighbour_stride (const morph::HexGrid& hg)
+{
+    double sum = 0.0;
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < hg.num(); ++i) {
+        if (hg.d_ne[i] >= 0) { sum += std::abs (hg.d_ne[i] - static_cast<int>(i)); ++n; }
+        if (hg.d_nne[i] >= 0) { sum += std::abs (hg.d_nne[i] - static_cast<int>(i)); ++n; }
+    }
+    return static_cast<float>(sum / n);
+}
+
+// Check that the d_ neighbour arrays are consistent with the hex positions
+int check_neighbours (const morph::HexGrid& hg)
+{
+    int rtn = 0;
+    for (unsigned int i = 0; i < hg.num(); ++i) {
+        if (hg.d_ne[i] >= 0 && std::abs (hg.d_x[hg.d_ne[i]] - hg.d_x[i] - hg.getd()) > 1e-5f) { --rtn; }
+        if (hg.d_nne[i] >= 0 && std::abs (hg.d_y[hg.d_nne[i]] - hg.d_y[i] - hg.getv()) > 1e-5f) { --rtn; }
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::HexGrid hg_list (0.02f, 4.0f, 0.0f);
+    hg_list.setEllipticalBoundary (1.2f, 0.7f);
+
+    // Choose Hilbert ordering before applying the boundary
+    morph::HexGrid hg_hilb (0.02f, 4.0f, 0.0f);
+    hg_hilb.hexorder = morph::HexGridOrder::hilbert;
+    hg_hilb.setEllipticalBoundary (1.2f, 0.7f);
+
+    if (hg_list.num() != hg_hilb.num()) {
+        std::cout << "Different number of hexes for different orderings\n";
+        --rtn;
+    }
+    rtn += check_neighbours (hg_hilb);
+
+    float stride_list = mean_neighbour_stride (hg_list);
+    float stride_hilb = mean_neighbour_stride (hg_hilb);
+    std::cout << "Mean neighbour stride: list order " << stride_list << ", hilbert order " << stride_hilb << "\n";
+    if (stride_hilb >= stride_list) { --rtn; }
+
+    // Reorder an existing grid (and its data) into Morton order
+    std::vector<float> data (hg_list.num());
+    for (unsigned int i = 0; i < hg_list.num(); ++i) { data[i] = hg_list.d_x[i] + 10.0f * hg_list.d_y[i]; }
+    std::vector<unsigned int> perm = hg_list.reorder (morph::HexGridOrder::morton);
+    morph::HexGrid::apply_reorder (perm, data);
+    rtn += check_neighbours (hg_list);
+    for (unsigned int i = 0; i < hg_list.num(); ++i) {
+        if (data[i] != hg_list.d_x[i] + 10.0f * hg_list.d_y[i]) { --rtn; break; }
+    }
+    if (mean_neighbour_stride (hg_list) >= stride_list) { --rtn; }
+
+    // The ordering must be the same after a save and load
+    hg_hilb.save ("../hexgrid_reorder.h5");
+    morph::HexGrid hg_loaded ("../hexgrid_reorder.h5");
+    if (hg_loaded.hexorder != morph::HexGridOrder::hilbert) { --rtn; }
+    if (hg_loaded.d_x != hg_hilb.d_x || hg_loaded.d_y != hg_hilb.d_y || hg_loaded.d_ne != hg_hilb.d_ne) {
+        std::cout << "Loaded grid has a different ordering\n";
+        --rtn;
+    }
+    std::filesystem::remove ("../hexgrid_reorder.h5");
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,130 @@
+/*
+ * Test morph::HexGridFlat: grids made by init and setBoundary must hold the same hexes, with
+ * the same positions, flags and neighbours, as the equivalent HexGrid (in raster order); a
+ * copy of a HexGrid must match it index for index.
+ */
+#include "morph/HexGridFlat.h"
+#include "morph/HexGrid.h"
+#include "morph/ShapeAnalysis.h"
+#include "morph/ReadCurves.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <map>
+#include <utility>
+
+// Compare the hexes of f with those of hg, matching them by axial coordinate
+int compare (const morph::HexGridFlat& f, const morph::HexGrid& hg, const std::string& what)
+{
+    if (f.num() != hg.num()) {
+        std::cerr << what << ": " << f.num() << " hexes, not " << hg.num() << std::endl;
+        return -1;
+    }
+    std::map<std::pair<int, int>, int> hgidx;
+    for (unsigned int i = 0; i < hg.num(); ++i) { hgidx[{ hg.d_ri[i], hg.d_gi[i] }] = i; }
+    // The flat index of each of hg's hexes
+    std::vector<int> fidx (hg.num(), -1);
+    for (unsigned int i = 0; i < f.num(); ++i) {
+        auto it = hgidx.find ({ f.d_ri[i], f.d_gi[i] });
+        if (it == hgidx.end()) { std::cerr << what << ": hex " << i << " is not in the HexGrid\n"; return -1; }
+        fidx[it->second] = i;
+    }
+    int rtn = 0;
+    const std::vector<int>* hnb[6] = { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse };
+    const auto fnb = f.neighbours();
+    for (unsigned int j = 0; j < hg.num() && rtn == 0; ++j) {
+        const int i = fidx[j];
+        if (f.d_x[i] != hg.d_x[j] || f.d_y[i] != hg.d_y[j] || f.d_flags[i] != hg.d_flags[j]) {
+            std::cerr << what << ": hex (" << hg.d_ri[j] << "," << hg.d_gi[j] << ") differs\n";
+            --rtn;
+        }
+        for (int k = 0; k < 6; ++k) {
+            const int hn = (*hnb[k])[j];
+            if ((*fnb[k])[i] != (hn < 0 ? -1 : fidx[hn])) { std::cerr << what << ": neighbour " << k << " of " << j << " differs\n"; --rtn; }
+        }
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Boundaries applied to the initial hexagon
+    {
+        morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+        morph::HexGridFlat f (0.01f, 3.0f, 0.0f);
+        hg.populate_d_vectors(); // HexGrid::init leaves the d_ vectors empty
+        rtn += compare (f, hg, "hexagon");
+        hg.setEllipticalBoundary (0.8f, 0.5f);
+        f.setEllipticalBoundary (0.8f, 0.5f);
+        rtn += compare (f, hg, "ellipse");
+        std::cout << f.num() << " hexes in " << f.memory_bytes() / 1024 << " kB\n";
+    }
+    {
+        morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+        morph::HexGridFlat f (0.02f, 3.0f, 0.0f);
+        hg.setCircularBoundary (0.6f, { 0.3f, -0.1f }, false);
+        f.setCircularBoundary (0.6f, { 0.3f, -0.1f }, false);
+        rtn += compare (f, hg, "offset circle");
+    }
+    try {
+        morph::ReadCurves r ("../../tests/trial.svg");
+        morph::BezCurvePath<float> bound = r.getCorticalPath();
+        morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+        morph::HexGridFlat f (0.02f, 3.0f, 0.0f);
+        hg.setBoundary (bound);
+        f.setBoundary (bound);
+        rtn += compare (f, hg, "trial.svg");
+        if (f.originalBoundaryCentroid != hg.originalBoundaryCentroid) { std::cerr << "Centroids differ\n"; --rtn; }
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        --rtn;
+    }
+
+    // A copy of a HexGrid, which keeps the HexGrid's order
+    morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+    hg.hexorder = morph::HexGridOrder::hilbert;
+    hg.setEllipticalBoundary (0.7f, 0.4f);
+    hg.computeDistanceToBoundary();
+    hg.populate_d_vectors();
+    morph::HexGridFlat f (hg);
+    if (f.d_x != hg.d_x || f.d_flags != hg.d_flags || f.d_nse != hg.d_nse || f.d_distToBoundary != hg.d_distToBoundary) {
+        std::cerr << "The copy differs\n";
+        --rtn;
+    }
+    for (unsigned int i = 0; i < f.num(); ++i) {
+        if (f.index_at (f[i].ri(), f[i].gi()) != static_cast<int>(i)) { std::cerr << "index_at failed for " << i << std::endl; --rtn; break; }
+    }
+    if (f.index_at (1000, 1000) != -1) { std::cerr << "index_at found a hex that isn't there\n"; --rtn; }
+    morph::RandUniform<float> rng (-1.0f, 1.0f, 42);
+    for (int k = 0; k < 1000; ++k) {
+        morph::vec<float, 2> p = { rng.get(), rng.get() };
+        if (f.findHexNearest (p) != static_cast<int>(hg.findHexNearest (p)->vi)) { std::cerr << "findHexNearest differs at " << p << std::endl; --rtn; break; }
+    }
+
+    // Distances to the boundary, computed on the flat grid
+    morph::HexGridFlat f2 (0.02f, 3.0f, 0.0f);
+    f2.setEllipticalBoundary (0.7f, 0.4f);
+    f2.computeDistanceToBoundary();
+    float maxerr = 0.0f;
+    for (unsigned int i = 0; i < f2.num(); ++i) {
+        const int j = f.index_at (f2[i].ri(), f2[i].gi());
+        if (j < 0) { std::cerr << "Hex " << i << " is missing from the copy\n"; --rtn; break; }
+        maxerr = std::max (maxerr, std::abs (f2[i].distToBoundary() - f[j].distToBoundary()));
+    }
+    if (maxerr != 0.0f) { std::cerr << "Distances to boundary differ by up to " << maxerr << std::endl; --rtn; }
+
+    // Contours are the same through the flat grid
+    std::vector<std::vector<float>> fld (2, std::vector<float> (f.num()));
+    for (unsigned int h = 0; h < f.num(); ++h) {
+        fld[0][h] = std::sin (5.0f * f.d_x[h]) * std::cos (4.0f * f.d_y[h]);
+        fld[1][h] = std::cos (3.0f * f.d_x[h] + f.d_y[h]);
+    }
+    morph::hex_contours<float> hc (hg);
+    morph::hex_contours<float, morph::HexGridFlat> fc (f);
+    if (hc.find (fld, 0.5f) != fc.find (fld, 0.5f)) { std::cerr << "Contours differ\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
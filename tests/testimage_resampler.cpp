@@ -0,0 +1,104 @@
+/*
+ * Test morph::gl::image_resampler, which resamples an image in a compute shader, against
+ * HexGrid::resampleImage and Grid::resample_image. Needs a headless GL context (EGL) with
+ * OpenGL 3.1 ES; a software renderer such as Mesa's llvmpipe will do.
+ */
+#include <GLES3/gl31.h>
+
+#include "morph/gl/compute_pool.h"
+#include "morph/gl/image_resampler.h"
+#include "morph/HexGrid.h"
+#include "morph/Grid.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <stdexcept>
+#include <cmath>
+
+constexpr int glver = morph::gl::version_3_1_es;
+
+int resampler_tests()
+{
+    int rtn = 0;
+    std::cout << "image_resampler<" << morph::gl::version::vstring (glver) << "> on OpenGL "
+              << reinterpret_cast<const char*>(glGetString (GL_VERSION)) << std::endl;
+
+    // A smooth image with some structure, 300 x 200 pixels
+    const unsigned int pw = 300;
+    const unsigned int ph = 200;
+    morph::vvec<float> img (pw * ph);
+    for (unsigned int j = 0; j < ph; ++j) {
+        for (unsigned int i = 0; i < pw; ++i) { img[j * pw + i] = 0.5f + 0.5f * std::sin (i * 0.071f) * std::cos (j * 0.043f); }
+    }
+    const morph::vec<unsigned int, 2> pixsz = { pw, ph };
+    const morph::vec<float, 2> offset = { 0.013f, -0.02f };
+
+    // HexGrid target. More hexes than one work group, and not a multiple of it.
+    morph::HexGrid hg (0.02f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+    const morph::vec<float, 2> hscale = { 2.0f, 2.0f };
+    morph::vvec<float> cpu = hg.resampleImage (img, pw, hscale, offset);
+    morph::gl::image_resampler<glver> hrs;
+    hrs.set_centres (hg.d_x, hg.d_y);
+    const morph::gl::resample_geometry hgeom = morph::gl::resample_geometry::hexgrid (pixsz, hscale, offset);
+    morph::vvec<float> gpu = hrs.resample (img, pw, hgeom);
+    if (gpu.size() != cpu.size()) {
+        std::cout << "HexGrid: GPU result has " << gpu.size() << " elements, not " << cpu.size() << std::endl;
+        return -1;
+    }
+    float maxdiff = (gpu - cpu).abs().max();
+    std::cout << "HexGrid (" << hg.num() << " hexes): max GPU/CPU difference " << maxdiff << std::endl;
+    if (maxdiff > 1e-4f) { --rtn; }
+
+    // A second image on the same points reuses the texture and the programs
+    morph::vvec<float> img2 = 1.0f - img;
+    cpu = hg.resampleImage (img2, pw, hscale, offset);
+    gpu = hrs.resample (img2, pw, hgeom);
+    maxdiff = (gpu - cpu).abs().max();
+    std::cout << "HexGrid, second image: max GPU/CPU difference " << maxdiff << std::endl;
+    if (maxdiff > 1e-4f) { --rtn; }
+
+    // Grid target
+    morph::Grid g (60U, 40U, morph::vec<float, 2>{ 0.02f, 0.02f });
+    const morph::vec<float, 2> gscale = { 1.0f, 1.0f };
+    cpu = g.resample_image (img, pw, gscale, offset);
+    morph::gl::image_resampler<glver> grs;
+    grs.set_centres (g.v_c);
+    const morph::gl::resample_geometry ggeom = morph::gl::resample_geometry::grid (pixsz, gscale, offset, g.width());
+    gpu = grs.resample (img, pw, ggeom);
+    maxdiff = (gpu - cpu).abs().max();
+    std::cout << "Grid (" << g.n() << " elements): max GPU/CPU difference " << maxdiff << std::endl;
+    if (maxdiff > 1e-4f) { --rtn; }
+
+    // A flat image is passed through unnormalised, as on the CPU
+    morph::vvec<float> flat (pw * ph, 0.25f);
+    cpu = g.resample_image (flat, pw, gscale, offset);
+    gpu = grs.resample (flat, pw, ggeom);
+    maxdiff = (gpu - cpu).abs().max();
+    std::cout << "Grid, flat image: max GPU/CPU difference " << maxdiff << std::endl;
+    if (maxdiff > 0.0f) { --rtn; }
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = -1;
+    try {
+        morph::gl::compute_pool<glver> pool (1);
+        pool.push ([&rtn](morph::gl::compute_context<glver>&) {
+            try {
+                rtn = resampler_tests();
+            } catch (const std::exception& e) {
+                std::cout << "Exception: " << e.what() << std::endl;
+                rtn = -1;
+            }
+        });
+        pool.wait();
+    } catch (const std::exception& e) {
+        std::cout << "No GL compute context: " << e.what() << std::endl;
+        rtn = -1;
+    }
+    std::cout << "testimage_resampler " << (rtn == 0 ? "passed" : "FAILED") << std::endl;
+    return rtn;
+}
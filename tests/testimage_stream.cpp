@@ -0,0 +1,83 @@
+/*
+ * Test morph::image_stream on a sequence of small PNGs written here, each a flat grey of its
+ * own level, so that the frames can be told apart.
+ */
+#include <morph/image_stream.h>
+#include <morph/loadpng.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main()
+{
+    int rtn = 0;
+
+    constexpr unsigned int w = 8;
+    constexpr unsigned int h = 6;
+    constexpr unsigned int nframes = 12;
+    std::vector<std::string> files;
+    for (unsigned int f = 0; f < nframes; ++f) {
+        std::vector<unsigned char> rgba (4 * w * h, 255);
+        for (unsigned int i = 0; i < w * h; ++i) {
+            for (unsigned int c = 0; c < 3; ++c) { rgba[4 * i + c] = static_cast<unsigned char>(f * 20); }
+        }
+        rgba[0] = rgba[1] = rgba[2] = 255; // A white top left pixel, to check the flip
+        files.push_back ("../testimage_stream_" + std::to_string (f) + ".png");
+        if (lodepng::encode (files.back(), rgba, w, h) != 0) { return -1; }
+    }
+
+    // Frames as loaded, in order
+    {
+        morph::image_stream s (files);
+        s.depth = 3;
+        s.threads = 2;
+        morph::vvec<float> frame;
+        unsigned int f = 0;
+        while (s.next (frame)) {
+            if (s.frame_index() != f || s.frame_dims() != morph::vec<unsigned int, 2>{w, h} || frame.size() != w * h) { --rtn; break; }
+            // With the default flip, the first row of the file is the last of the frame
+            const float level = static_cast<float>(f * 20 * 3) / 765.0f;
+            if (frame[1] != level || frame[w * (h - 1)] != 1.0f) {
+                std::cout << "Frame " << f << " has the wrong values\n";
+                --rtn;
+            }
+            ++f;
+        }
+        if (f != nframes || !s.finished()) { --rtn; }
+    }
+
+    // Transformed frames, polled with try_next, looping
+    {
+        morph::image_stream s (files);
+        s.loop = true;
+        s.transform = [](const morph::vvec<float>& img, const morph::vec<unsigned int, 2>&) {
+            return morph::vvec<float>{ img.mean() };
+        };
+        morph::vvec<float> frame;
+        unsigned int got = 0;
+        while (got < 2 * nframes + 3) {
+            if (!s.try_next (frame)) { std::this_thread::yield(); continue; }
+            if (frame.size() != 1u || s.frame_index() != got % nframes) { --rtn; break; }
+            ++got;
+        }
+        if (s.finished()) { --rtn; }
+    } // Stops the workers with frames still to load
+
+    // A missing file is thrown from next(), in its place in the stream
+    {
+        std::vector<std::string> bad = { files[0], "../no_such_frame.png", files[1] };
+        morph::image_stream s (bad);
+        morph::vvec<float> frame;
+        if (!s.next (frame)) { --rtn; }
+        try {
+            s.next (frame);
+            --rtn;
+        } catch (const std::runtime_error& e) {
+            std::cout << "Expected error: " << e.what() << std::endl;
+        }
+        if (!s.next (frame) || s.frame_index() != 2u || s.next (frame)) { --rtn; }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
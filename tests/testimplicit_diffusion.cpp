@@ -0,0 +1,117 @@
+/*
+ * Test the implicit diffusion solvers: diffusion_multigrid on Grid and CartGrid, and
+ * diffusion_cg on Grid, CartGrid and HexGrid. Each solution must satisfy
+ * (I - alpha Del^2) x = b, with Del^2 computed independently by morph::apply_stencil, and
+ * must conserve the total of the field (the boundaries are zero-flux).
+ */
+#include "morph/implicit_diffusion.h"
+#include "morph/stencil.h"
+#include "morph/Grid.h"
+#include "morph/CartGrid.h"
+#include "morph/HexGrid.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <numeric>
+#include <cmath>
+#include <chrono>
+
+// The relative residual of (I - alpha lap) x = b, given lap = Del^2 x
+double relres (const std::vector<double>& x, const std::vector<double>& lap, const std::vector<double>& b, const double alpha)
+{
+    double r2 = 0.0, b2 = 0.0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        const double ri = b[i] - (x[i] - alpha * lap[i]);
+        r2 += ri * ri;
+        b2 += static_cast<double>(b[i]) * b[i];
+    }
+    return std::sqrt (r2 / b2);
+}
+
+double total (const std::vector<double>& x) { return std::accumulate (x.begin(), x.end(), 0.0); }
+
+int main()
+{
+    int rtn = 0;
+    morph::RandUniform<double> rng (0.0, 1.0, 3);
+    using sc = std::chrono::steady_clock;
+
+    // A D dt far beyond the explicit limit of about d^2 / 4
+    // A spacing exactly representable as a float, so the grids' own spacings equal h
+    const double h = 1.0 / 128.0;
+    const double alpha = 2500.0 * h * h;
+
+    // Multigrid and CG on Grids of awkward sizes, orders and wrappings
+    const morph::GridOrder orders[] = { morph::GridOrder::bottomleft_to_topright, morph::GridOrder::topleft_to_bottomright_colmaj };
+    const morph::GridDomainWrap wraps[] = { morph::GridDomainWrap::None, morph::GridDomainWrap::Both };
+    for (auto o : orders) {
+        for (auto wr : wraps) {
+            morph::Grid<unsigned int, double> g (256, 97, { h, h }, { 0.0, 0.0 }, wr, o);
+            std::vector<double> b = rng.get (g.n());
+            std::vector<double> x_mg (g.n(), 0.0), x_cg (g.n(), 0.0), lap;
+
+            morph::diffusion_multigrid<double> mg (g);
+            morph::diffusion_cg<double> cg (g);
+            mg.tolerance = 1e-9;
+            cg.tolerance = 1e-9;
+            sc::time_point t0 = sc::now();
+            mg.solve (x_mg, b, alpha);
+            sc::time_point t1 = sc::now();
+                        cg.solve (x_cg, b, alpha);
+            sc::time_point t2 = sc::now();
+
+            morph::apply_stencil<morph::stencils::laplace5<double>> (g, x_mg, lap, 1.0 / (h * h));
+            const double r_mg = relres (x_mg, lap, b, alpha);
+            morph::apply_stencil<morph::stencils::laplace5<double>> (g, x_cg, lap, 1.0 / (h * h));
+            const double r_cg = relres (x_cg, lap, b, alpha);
+            std::cout << "Grid order " << int(o) << " wrap " << int(wr) << ": multigrid " << mg.cycles << " cycles ("
+                      << mg.num_levels() << " levels) in " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+                      << " ms, residual " << r_mg << "; CG " << cg.iterations << " iterations in "
+                      << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms, residual " << r_cg << "\n";
+            if (r_mg > 1e-8 || r_cg > 1e-8 || mg.cycles >= mg.max_cycles || cg.iterations >= cg.max_iterations) {
+                std::cerr << "Solver did not converge\n";
+                --rtn;
+            }
+            if (std::abs (total (x_mg) - total (b)) > 1e-9 * total (b) || std::abs (total (x_cg) - total (b)) > 1e-9 * total (b)) {
+                std::cerr << "Diffusion did not conserve the total\n";
+                --rtn;
+            }
+        }
+    }
+
+    // A rectangular CartGrid
+    {
+        morph::CartGrid cgd (static_cast<float>(h), static_cast<float>(h), 0.0f, 0.0f, 1.27f, 0.63f);
+        cgd.setBoundaryOnOuterEdge();
+        std::vector<double> u = rng.get (cgd.num());
+        std::vector<double> u0 = u, u2 = u, lap;
+        morph::diffusion_multigrid<double> mg (cgd);
+        mg.tolerance = 1e-9;
+        mg.diffuse (u, 1.0, alpha);
+        morph::apply_stencil<morph::stencils::laplace5<double>> (cgd, u, lap, 1.0 / (h * h));
+        if (relres (u, lap, u0, alpha) > 1e-8) { std::cerr << "CartGrid multigrid fails\n"; --rtn; }
+        morph::diffusion_cg<double> cg (cgd);
+        cg.tolerance = 1e-9;
+        cg.diffuse (u2, 1.0, alpha);
+        morph::apply_stencil<morph::stencils::laplace5<double>> (cgd, u2, lap, 1.0 / (h * h));
+        if (relres (u2, lap, u0, alpha) > 1e-8) { std::cerr << "CartGrid CG fails\n"; --rtn; }
+    }
+
+    // A HexGrid with an elliptical boundary
+    {
+        morph::HexGrid hg (static_cast<float>(h), 3.0f, 0.0f);
+        hg.setEllipticalBoundary (0.8f, 0.5f);
+        std::vector<double> u = rng.get (hg.num());
+        std::vector<double> u0 = u, lap;
+        morph::diffusion_cg<double> cg (hg);
+        cg.tolerance = 1e-9;
+        cg.diffuse (u, 1.0, alpha);
+        morph::apply_stencil<morph::stencils::hex_laplace<double>> (hg, u, lap, 2.0 / (3.0 * h * h));
+        const double r = relres (u, lap, u0, alpha);
+        std::cout << "HexGrid (" << hg.num() << " hexes): CG " << cg.iterations << " iterations, residual " << r << "\n";
+        if (r > 1e-8 || std::abs (total (u) - total (u0)) > 1e-9 * total (u0)) { std::cerr << "HexGrid CG fails\n"; --rtn; }
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,68 @@
+// Test morph::job_pool, the worker pool that VisualModel::reinit_async() builds on
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <iostream>
+#include <morph/job_pool.h>
+
+int main()
+{
+    int rtn = 0;
+    std::atomic<int> count = 0;
+
+    {
+        morph::job_pool p (3);
+        if (p.size() != 3u) { --rtn; }
+
+        // Every job pushed runs, and wait() returns only once they all have
+        for (int i = 0; i < 1000; ++i) { p.push ([&count] { ++count; }); }
+        p.wait();
+        if (count != 1000) {
+            std::cout << "count " << count << " != 1000\n";
+            --rtn;
+        }
+
+        // A job that throws is dropped without stopping the pool
+        p.push ([] { throw std::runtime_error ("expected test exception"); });
+        for (int i = 0; i < 10; ++i) { p.push ([&count] { ++count; }); }
+        p.wait();
+        if (count != 1010) {
+            std::cout << "count " << count << " != 1010 after a throwing job\n";
+            --rtn;
+        }
+
+        // Jobs still queued when the pool goes are finished first
+        for (int i = 0; i < 100; ++i) { p.push ([&count] { ++count; }); }
+    }
+    if (count != 1110) {
+        std::cout << "count " << count << " != 1110 after the pool was destroyed\n";
+        --rtn;
+    }
+
+    // Idle jobs wait for the jobs queued by push(), even those queued after them
+    {
+        morph::job_pool p (1);
+        std::atomic<bool> go = false;
+        std::vector<int> order;
+        p.push ([&go] { while (!go) { std::this_thread::yield(); } });
+        p.push_idle ([&order] { order.push_back (2); });
+        p.push ([&order] { order.push_back (1); });
+        p.push_idle ([&order] { order.push_back (3); });
+        go = true;
+        p.wait();
+        if (order != std::vector<int>{ 1, 2, 3 }) {
+            std::cout << "Idle jobs ran out of order\n";
+            --rtn;
+        }
+    }
+
+    // The shared pool has at least one worker
+    std::atomic<bool> ran = false;
+    morph::job_pool::shared().push ([&ran] { ran = true; });
+    morph::job_pool::shared().wait();
+    if (!ran || morph::job_pool::shared().size() < 1u) { --rtn; }
+
+    std::cout << "testjob_pool " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,84 @@
+/*
+ * Test morph::kd_tree nearest point and radius queries against a brute force search over all
+ * points.
+ */
+#include "morph/kd_tree.h"
+#include "morph/vec.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// The index of the point nearest to x (the lowest, of equals), by looping over them all
+template <typename F, std::size_t N>
+unsigned int brute (const std::vector<morph::vec<F, N>>& pts, const morph::vec<F, N>& x)
+{
+    unsigned int best = morph::kd_tree<F, N>::none;
+    F d2min = F{0};
+    for (unsigned int i = 0; i < pts.size(); ++i) {
+        const F d2 = (pts[i] - x).sos();
+        if (best == morph::kd_tree<F, N>::none || d2 < d2min) { best = i; d2min = d2; }
+    }
+    return best;
+}
+
+int main()
+{
+    int rtn = 0;
+    morph::RandUniform<float> rng (-0.2f, 1.2f, 42);
+
+    // 2D points, queried at random locations, some well away from the points
+    std::vector<morph::vec<float, 2>> pts (3000);
+    for (auto& p : pts) { p = { rng.get(), rng.get() }; }
+    morph::kd_tree<float, 2> tree;
+    tree.build (pts);
+    if (tree.size() != pts.size()) { std::cout << "size is wrong\n"; --rtn; }
+    for (unsigned int i = 0; i < 2000 && rtn == 0; ++i) {
+        morph::vec<float, 2> x = { 4.0f * rng.get() - 2.0f, 4.0f * rng.get() - 2.0f };
+        float d2 = 0.0f;
+        const unsigned int j = tree.nearest (x, &d2);
+        if (j != brute (pts, x) || d2 != (pts[j] - x).sos()) { std::cout << "2D query " << i << " differs\n"; --rtn; }
+    }
+
+    // Points on a lattice (like the boundary of a HexGrid), with many ties and repeats
+    std::vector<morph::vec<float, 2>> lat;
+    for (int k = 0; k < 400; ++k) { lat.push_back ({ 0.1f * static_cast<float>(k % 20), 0.1f * static_cast<float>(k % 7) }); }
+    tree.build (lat);
+    for (int a = -5; a < 25 && rtn == 0; ++a) {
+        for (int b = -5; b < 12; ++b) {
+            morph::vec<float, 2> x = { 0.05f * static_cast<float>(a), 0.05f * static_cast<float>(b) };
+            if (tree.nearest (x) != brute (lat, x)) { std::cout << "lattice query " << a << "," << b << " differs\n"; --rtn; break; }
+        }
+    }
+
+    // 3D points
+    morph::RandUniform<double> rngd (0.0, 1.0, 7);
+    std::vector<morph::vec<double, 3>> p3 (1000);
+    for (auto& p : p3) { p = { rngd.get(), rngd.get(), rngd.get() }; }
+    morph::kd_tree<double, 3> t3;
+    t3.build (p3);
+    for (int i = 0; i < 500 && rtn == 0; ++i) {
+        morph::vec<double, 3> x = { rngd.get(), rngd.get(), rngd.get() };
+        if (t3.nearest (x) != brute (p3, x)) { std::cout << "3D query " << i << " differs\n"; --rtn; }
+    }
+
+    // Radius queries on the lattice, whose ties lie exactly on the search radius
+    for (int a = -5; a < 25 && rtn == 0; a += 3) {
+        morph::vec<float, 2> x = { 0.05f * static_cast<float>(a), 0.1f };
+        for (float r : { 0.0f, 0.1f, 0.25f }) {
+            std::vector<unsigned int> found;
+            tree.within (x, r, found);
+            std::sort (found.begin(), found.end());
+            std::vector<unsigned int> expected;
+            for (unsigned int i = 0; i < lat.size(); ++i) { if ((lat[i] - x).sos() <= r * r) { expected.push_back (i); } }
+            if (found != expected) { std::cout << "radius query " << a << "," << r << " differs\n"; --rtn; break; }
+        }
+    }
+
+    // An empty tree has no nearest point
+    morph::kd_tree<float, 2> empty;
+    empty.build ({});
+    if (empty.nearest ({ 0.0f, 0.0f }) != morph::kd_tree<float, 2>::none) { std::cout << "empty tree found a point\n"; --rtn; }
+
+    return rtn;
+}
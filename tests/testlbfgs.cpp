@@ -0,0 +1,111 @@
+// Test morph::lbfgs on Rosenbrock functions, with gradients from morph::dual numbers
+#include <cmath>
+#include <iostream>
+#include <morph/vvec.h>
+#include <morph/dual.h>
+#include <morph/lbfgs.h>
+#include <morph/NM_Simplex.h>
+
+// The Rosenbrock function of x's length, for any number type
+template <typename V>
+static auto rosenbrock (const V& x)
+{
+    typename V::value_type f{0.0};
+    for (std::size_t i = 0; i + 1 < x.size(); ++i) {
+        auto a = 1.0 - x[i];
+        auto b = x[i + 1] - x[i] * x[i];
+        f += a * a + 100.0 * b * b;
+    }
+    return f;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // forward_gradient, in chunks smaller than the dimension, agrees with the analytic gradient
+    {
+        morph::vvec<double> x = { -1.2, 1.0, 0.5, -0.3, 2.0 };
+        morph::vvec<double> g;
+        const double f = morph::forward_gradient<2> ([](const auto& p) { return rosenbrock (p); }, x, g);
+        morph::vvec<double> ga (x.size(), 0.0);
+        for (std::size_t i = 0; i + 1 < x.size(); ++i) {
+            const double b = x[i + 1] - x[i] * x[i];
+            ga[i] += -2.0 * (1.0 - x[i]) - 400.0 * x[i] * b;
+            ga[i + 1] += 200.0 * b;
+        }
+        if (std::abs (f - rosenbrock (x)) > 1e-12 || (g - ga).abs().max() > 1e-10) {
+            std::cout << "forward_gradient gave " << g << " not " << ga << "\n";
+            --rtn;
+        }
+    }
+
+    // The 2D banana, from the classic start point
+    unsigned long long int lbfgs_evals = 0;
+    {
+        morph::lbfgs<double> opt;
+        opt.set_dual_objective<2> ([](const auto& p) { return rosenbrock (p); });
+        opt.reset ({ -1.2, 1.0 });
+        if (!opt.run()) { --rtn; }
+        std::cout << "2D: " << opt.x << " after " << opt.iterations << " iterations, "
+                  << opt.evaluations << " evaluations\n";
+        if (opt.stop_reason != morph::lbfgs_stop_reason::GradientTolerance
+            || (opt.x - morph::vvec<double>{ 1.0, 1.0 }).abs().max() > 1e-5) {
+            std::cout << "2D Rosenbrock was not minimised\n";
+            --rtn;
+        }
+        lbfgs_evals = opt.evaluations;
+    }
+
+    // The Nelder-Mead simplex needs many more evaluations to get as close
+    {
+        morph::vvec<morph::vvec<double>> v = { { -1.2, 1.0 }, { -1.1, 1.0 }, { -1.2, 1.1 } };
+        morph::NM_Simplex<double> simp (v);
+        unsigned long long int evals = 0;
+        simp.objective = [&evals](const morph::vvec<double>& p) { ++evals; return rosenbrock (p); };
+        simp.termination_threshold = 1e-14;
+        simp.run();
+        std::cout << "NM_Simplex: " << simp.best_vertex() << " after " << evals << " evaluations\n";
+        if (evals <= 2 * lbfgs_evals) {
+            std::cout << "L-BFGS was expected to use far fewer evaluations than NM_Simplex\n";
+            --rtn;
+        }
+    }
+
+    // 20 dimensions, with an analytic gradient set directly
+    {
+        morph::lbfgs<double> opt;
+        opt.m = 5;
+        opt.objective = [](const morph::vvec<double>& x, morph::vvec<double>& g) {
+            g.zero();
+            for (std::size_t i = 0; i + 1 < x.size(); ++i) {
+                const double b = x[i + 1] - x[i] * x[i];
+                g[i] += -2.0 * (1.0 - x[i]) - 400.0 * x[i] * b;
+                g[i + 1] += 200.0 * b;
+            }
+            return rosenbrock (x);
+        };
+        morph::vvec<double> x0 (20, -1.0);
+        x0[0] = -1.2;
+        opt.reset (x0);
+        opt.run();
+        std::cout << "20D: f = " << opt.f << " after " << opt.iterations << " iterations, " << opt.evaluations << " evaluations\n";
+        // Near the minimum, the objective may stop falling before the gradient is small enough
+        const bool converged = opt.stop_reason == morph::lbfgs_stop_reason::GradientTolerance
+                               || opt.stop_reason == morph::lbfgs_stop_reason::ObjectiveTolerance;
+        if (!converged || (opt.x - 1.0).abs().max() > 1e-5) {
+            std::cout << "20D Rosenbrock was not minimised\n";
+            --rtn;
+        }
+    }
+
+    // Without an objective, run() fails
+    {
+        morph::lbfgs<float> opt;
+        opt.reset ({ 1.0f });
+        if (opt.run() || opt.stop_reason != morph::lbfgs_stop_reason::NoObjective) { --rtn; }
+    }
+
+    std::cout << "testlbfgs " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
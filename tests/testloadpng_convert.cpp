@@ -0,0 +1,128 @@
+/*
+ * Test the morph::loadpng functions against a per-pixel reference, for each combination of
+ * flips, on an image written here with lodepng.
+ */
+#include <morph/loadpng.h>
+#include <morph/vec.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr unsigned int w = 7;
+constexpr unsigned int h = 5;
+
+// The RGBA bytes of pixel (x, y), counting from the top left as the PNG is stored
+unsigned char byte_at (const std::vector<unsigned char>& rgba, unsigned int x, unsigned int y, unsigned int ch)
+{
+    return rgba[4 * (x + w * y) + ch];
+}
+
+// The index in the loaded image of pixel (x, y)
+unsigned int idx_of (unsigned int x, unsigned int y, const morph::vec<bool, 2>& flip)
+{
+    return (flip[0] ? w - x - 1 : x) + w * (flip[1] ? h - y - 1 : y);
+}
+
+#ifdef MORPH_PNG_ZLIB
+const std::string tag = "_zlib";
+#else
+const std::string tag = "";
+#endif
+
+int main()
+{
+    int rtn = 0;
+
+    std::vector<unsigned char> rgba (4 * w * h);
+    for (unsigned int i = 0; i < rgba.size(); ++i) { rgba[i] = static_cast<unsigned char>((i * 37 + 11) % 256); }
+    const std::string fn = "../testloadpng_convert" + tag + ".png";
+    if (lodepng::encode (fn, rgba, w, h) != 0) {
+        std::cout << "Failed to write " << fn << std::endl;
+        return -1;
+    }
+
+    const std::vector<morph::vec<bool, 2>> flips = { {false, false}, {false, true}, {true, false}, {true, true} };
+    for (const auto& flip : flips) {
+        morph::vvec<float> mono;
+        morph::vvec<unsigned char> mono_b;
+        morph::vvec<morph::vec<float, 3>> rgbv;
+        morph::vvec<morph::vec<unsigned int, 4>> rgbav;
+        morph::vvec<float> rgb;
+        morph::vvec<unsigned char> rgba_b;
+        morph::vec<float, 4 * w * h> rgba_fixed;
+
+        morph::vec<unsigned int, 2> dims = morph::loadpng (fn, mono, flip);
+        if (dims != morph::vec<unsigned int, 2>{w, h}) { --rtn; }
+        morph::loadpng (fn, mono_b, flip);
+        morph::loadpng (fn, rgbv, flip);
+        morph::loadpng (fn, rgbav, flip);
+        morph::loadpng_rgb (fn, rgb, flip);
+        morph::loadpng_rgba (fn, rgba_b, flip);
+        morph::loadpng_rgba<float, w, h> (fn, rgba_fixed, flip);
+
+        if (mono.size() != w * h || rgb.size() != 3 * w * h || rgba_b.size() != 4 * w * h) {
+            std::cout << "Wrong size\n";
+            return -1;
+        }
+
+        int errs = 0;
+        for (unsigned int y = 0; y < h; ++y) {
+            for (unsigned int x = 0; x < w; ++x) {
+                const unsigned int k = idx_of (x, y, flip);
+                const unsigned int sum = byte_at (rgba, x, y, 0) + byte_at (rgba, x, y, 1) + byte_at (rgba, x, y, 2);
+                if (mono[k] != static_cast<float>(sum) / 765.0f) { ++errs; }
+                if (mono_b[k] != static_cast<unsigned char>(sum / 3)) { ++errs; }
+                for (unsigned int ch = 0; ch < 4; ++ch) {
+                    const unsigned char b = byte_at (rgba, x, y, ch);
+                    const float f = static_cast<float>(b) / 255.0f;
+                    if (ch < 3 && rgbv[k][ch] != f) { ++errs; }
+                    if (rgbav[k][ch] != b) { ++errs; }
+                    if (ch < 3 && rgb[3 * k + ch] != f) { ++errs; }
+                    if (rgba_b[4 * k + ch] != b) { ++errs; }
+                    if (rgba_fixed[4 * k + ch] != f) { ++errs; }
+                }
+            }
+        }
+        if (errs) {
+            std::cout << "Flip " << flip << ": " << errs << " wrong values\n";
+            --rtn;
+        }
+    }
+
+    // Batch loading matches loading one by one
+    std::vector<morph::vvec<morph::vec<float, 3>>> batch;
+    std::vector<morph::vec<unsigned int, 2>> bdims = morph::loadpng_batch (std::vector<std::string>(5, fn), batch);
+    morph::vvec<morph::vec<float, 3>> one;
+    morph::loadpng (fn, one);
+    if (batch.size() != 5u || bdims.size() != 5u) { --rtn; }
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i] != one || bdims[i] != morph::vec<unsigned int, 2>{w, h}) { --rtn; }
+    }
+
+    // A missing file is an error, from a batch as from loadpng
+    try {
+        std::vector<morph::vvec<float>> b2;
+        morph::loadpng_batch ({ fn, "../no_such_file.png", fn }, b2);
+        --rtn;
+    } catch (const std::runtime_error& e) {
+        std::cout << "Expected error: " << e.what() << std::endl;
+    }
+
+    // A corrupted file is an error
+    std::vector<unsigned char> file;
+    lodepng::load_file (file, fn);
+    file[file.size() - 20] ^= 0x5a; // in the image data
+    const std::string badfn = "../testloadpng_convert_bad" + tag + ".png";
+    lodepng::save_file (file, badfn);
+    try {
+        morph::vvec<float> bad;
+        morph::loadpng (badfn, bad);
+        --rtn;
+    } catch (const std::runtime_error& e) {
+        std::cout << "Expected error: " << e.what() << std::endl;
+    }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,149 @@
+/*
+ * Test the runtime (SIMD, where available) paths of mat44<float> and vec<float, 4> against
+ * mat44<double>, which always takes the generic code, and against constexpr evaluation.
+ */
+#include "morph/mat44.h"
+#include "morph/quaternion.h"
+#include "morph/vec.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+// Maximum absolute difference between a float and a double matrix
+float maxdiff (const morph::mat44<float>& a, const morph::mat44<double>& b)
+{
+    float d = 0.0f;
+    for (unsigned int i = 0; i < 16; ++i) { d = std::max (d, static_cast<float>(std::abs (a.mat[i] - b.mat[i]))); }
+    return d;
+}
+
+morph::mat44<double> to_double (const morph::mat44<float>& a)
+{
+    morph::mat44<double> b;
+    for (unsigned int i = 0; i < 16; ++i) { b.mat[i] = a.mat[i]; }
+    return b;
+}
+
+// A product computed at compile time, to show the constexpr path is still the generic code
+constexpr morph::mat44<float> ce_product()
+{
+    morph::mat44<float> a;
+    a.translate (1.0f, 2.0f, 3.0f);
+    morph::mat44<float> b;
+    b.rotate (morph::vec<float>{ 0.0f, 0.0f, 1.0f }, 0.5f);
+    morph::mat44<float> c = a * b;
+    return c.invert();
+}
+
+int main()
+{
+    int rtn = 0;
+#ifdef MORPH_SIMD4
+    std::cout << "Testing the SIMD paths\n";
+#else
+    std::cout << "No SIMD; testing the generic paths\n";
+#endif
+    morph::RandUniform<float> rng (-2.0f, 2.0f, 1234);
+
+    for (int k = 0; k < 200 && rtn == 0; ++k) {
+        morph::mat44<float> a;
+        morph::mat44<float> b;
+        for (unsigned int i = 0; i < 16; ++i) { a.mat[i] = rng.get(); b.mat[i] = rng.get(); }
+        const morph::mat44<double> ad = to_double (a);
+        const morph::mat44<double> bd = to_double (b);
+
+        // Products (the sums are in the same order, so against double they agree to rounding)
+        if (maxdiff (a * b, ad * bd) > 1e-5f) { std::cout << "a * b differs\n"; --rtn; }
+        morph::mat44<float> c = a;
+        c *= b;
+        if (c != a * b) { std::cout << "a *= b differs from a * b\n"; --rtn; }
+        c = a;
+        c *= c;
+        if (maxdiff (c, ad * ad) > 1e-5f) { std::cout << "a *= a differs\n"; --rtn; }
+
+        // Inverse of a well conditioned matrix (a plus 8 I), checked against the double inverse
+        morph::mat44<float> aw = a;
+        for (unsigned int i = 0; i < 16; i += 5) { aw.mat[i] += 8.0f; }
+        morph::mat44<double> awd = to_double (aw);
+        if (maxdiff (aw.invert(), awd.invert()) > 1e-6f) { std::cout << "inverse differs\n"; --rtn; }
+
+        // Matrix times vector
+        morph::vec<float, 4> v4 = { rng.get(), rng.get(), rng.get(), rng.get() };
+        morph::vec<float, 4> r4 = a * v4;
+        std::array<float, 4> r4a = a * static_cast<std::array<float, 4>>(v4);
+        morph::vec<float, 3> v3 = v4.less_one_dim();
+        morph::vec<float, 4> r3 = a * v3;
+        for (unsigned int j = 0; j < 4; ++j) {
+            const float e4 = a.mat[j] * v4[0] + a.mat[4 + j] * v4[1] + a.mat[8 + j] * v4[2] + a.mat[12 + j] * v4[3];
+            const float e3 = a.mat[j] * v3[0] + a.mat[4 + j] * v3[1] + a.mat[8 + j] * v3[2] + a.mat[12 + j];
+            if (r4[j] != e4 || r4a[j] != e4 || r3[j] != e3) { std::cout << "mat * vec differs\n"; --rtn; break; }
+        }
+
+        // vec<float, 4> element-wise arithmetic
+        morph::vec<float, 4> w4 = { rng.get(), rng.get(), rng.get(), rng.get() };
+        morph::vec<float, 4> sum = v4 + w4;
+        morph::vec<float, 4> dif = v4 - w4;
+        morph::vec<float, 4> had = v4 * w4;
+        morph::vec<float, 4> scl = v4 * 3.0f;
+        morph::vec<float, 4> acc = v4;
+        acc += w4;
+        acc -= v4;
+        acc *= w4;
+        for (unsigned int j = 0; j < 4; ++j) {
+            if (sum[j] != v4[j] + w4[j] || dif[j] != v4[j] - w4[j] || had[j] != v4[j] * w4[j]
+                || scl[j] != v4[j] * 3.0f || acc[j] != ((v4[j] + w4[j]) - v4[j]) * w4[j]) {
+                std::cout << "vec<float, 4> arithmetic differs\n";
+                --rtn;
+                break;
+            }
+        }
+
+        // Rotation by a quaternion, against a full product with the rotation matrix
+        morph::quaternion<float> q (morph::vec<float>{ rng.get(), rng.get(), rng.get() }, rng.get());
+        morph::quaternion<double> qd (q.w, q.x, q.y, q.z);
+        morph::mat44<float> ar = a;
+        ar.rotate (q);
+        morph::mat44<double> ard = ad;
+        ard.rotate (qd);
+        if (maxdiff (ar, ard) > 1e-5f) { std::cout << "rotate (quaternion) differs\n"; --rtn; }
+    }
+
+    // A singular matrix inverts to zeros
+    morph::mat44<float> sing;
+    sing.mat.fill (1.0f);
+    morph::mat44<float> singinv = sing.invert();
+    for (auto e : singinv.mat) { if (e != 0.0f) { std::cout << "singular inverse is not zero\n"; --rtn; break; } }
+
+    // Batch transforms of arrays of vec<float, 3>, including in place
+    morph::mat44<float> m;
+    m.translate (0.5f, -1.0f, 2.0f);
+    m.rotate (morph::vec<float>{ 1.0f, 1.0f, 0.0f }, 0.7f);
+    std::vector<morph::vec<float, 3>> pts (1001);
+    for (auto& p : pts) { p = { rng.get(), rng.get(), rng.get() }; }
+    std::vector<morph::vec<float, 3>> tp (pts.size());
+    std::vector<morph::vec<float, 3>> td (pts.size());
+    m.transform_points (pts, tp);
+    m.transform_directions (pts, td);
+    for (std::size_t i = 0; i < pts.size(); ++i) {
+        morph::vec<float, 3> ep = (m * pts[i]).less_one_dim();
+        morph::vec<float, 4> d4 = { pts[i][0], pts[i][1], pts[i][2], 0.0f };
+        morph::vec<float, 3> ed = (m * d4).less_one_dim();
+        if (tp[i] != ep || (td[i] - ed).length() > 1e-6f) { std::cout << "batch transform differs at " << i << std::endl; --rtn; break; }
+    }
+    std::vector<morph::vec<float, 3>> inplace = pts;
+    m.transform_points (inplace, inplace);
+    if (inplace != tp) { std::cout << "in-place batch transform differs\n"; --rtn; }
+
+    // The constexpr path is unchanged, and gives the same answer to within rounding
+    constexpr morph::mat44<float> ce = ce_product();
+    morph::mat44<float> ra;
+    ra.translate (1.0f, 2.0f, 3.0f);
+    morph::mat44<float> rb;
+    rb.rotate (morph::vec<float>{ 0.0f, 0.0f, 1.0f }, 0.5f);
+    morph::mat44<float> rt = (ra * rb).invert();
+    if (maxdiff (rt, to_double (ce)) > 1e-6f) { std::cout << "runtime and constexpr results differ\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,128 @@
+// Test the fast approximations in morph::math::fast against libm, for several accuracy targets
+#include <morph/math_fast.h>
+#include <morph/vvec.h>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <limits>
+
+// The error in y, in units in the last place of the (more precise) reference value
+template <typename T>
+double ulp_error (const T y, const long double ref)
+{
+    const T rt = static_cast<T>(ref);
+    if (!(std::abs (rt) >= std::numeric_limits<T>::min())) { return 0.0; } // only normal results count
+    const long double u = static_cast<long double>(std::nextafter (std::abs (rt), std::numeric_limits<T>::infinity())) - std::abs (rt);
+    return static_cast<double>(std::abs (static_cast<long double>(y) - ref) / u);
+}
+
+// Arguments uniformly in [lo, hi], and with magnitudes uniform in log between 1e-20 and hi
+template <typename T>
+std::vector<T> arguments (const T lo, const T hi, const unsigned int seed)
+{
+    std::mt19937_64 g (seed);
+    std::uniform_real_distribution<long double> u (lo, hi);
+    std::uniform_real_distribution<long double> lu (std::log (1e-20L), std::log (static_cast<long double>(hi)));
+    std::vector<T> x (400000);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        x[i] = static_cast<T>(i % 2 ? u(g) : std::exp (lu(g)));
+        if (i % 4 == 0 && lo < T{0}) { x[i] = -x[i]; }
+    }
+    return x;
+}
+
+template <typename T, typename F, typename R>
+int check (const char* name, const unsigned int ulp, const double limit, const std::vector<T>& xs, F f, R r)
+{
+    double emax = 0.0;
+    T worst = T{0};
+    for (const T x : xs) {
+        const double e = ulp_error<T> (f (x), r (static_cast<long double>(x)));
+        if (e > emax) { emax = e; worst = x; }
+    }
+    if (emax > limit) {
+        std::cout << name << "<" << ulp << "> (" << sizeof(T) << " byte): error " << emax << " ulp at x = " << worst
+                  << ", more than " << limit << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+template <typename T, unsigned int ulp>
+int test_target()
+{
+    namespace mf = morph::math::fast;
+    constexpr bool is_f = std::is_same_v<T, float>;
+    int rtn = 0;
+    const std::vector<T> xe = arguments<T> (is_f ? T{-87} : T{-708}, is_f ? T{88} : T{709}, 1);
+    const std::vector<T> xl = arguments<T> (T{0}, static_cast<T>(is_f ? 1e30 : 1e300), 2);
+    const std::vector<T> x1 = arguments<T> (T{0.25}, T{4}, 3);
+    const std::vector<T> xt = arguments<T> (T{-3e5}, T{3e5}, 4);
+    const std::vector<T> xs = arguments<T> (T{-20}, T{20}, 5);
+
+    rtn += check<T> ("exp", ulp, ulp, xe, [](T x) { return mf::exp<ulp>(x); }, [](long double x) { return std::exp (x); });
+    rtn += check<T> ("expm1", ulp, ulp, xs, [](T x) { return mf::expm1<ulp>(x); }, [](long double x) { return std::expm1 (x); });
+    rtn += check<T> ("log", ulp, ulp, xl, [](T x) { return mf::log<ulp>(x); }, [](long double x) { return std::log (x); });
+    rtn += check<T> ("log", ulp, ulp, x1, [](T x) { return mf::log<ulp>(x); }, [](long double x) { return std::log (x); });
+    rtn += check<T> ("sin", ulp, ulp, xt, [](T x) { return mf::sin<ulp>(x); }, [](long double x) { return std::sin (x); });
+    rtn += check<T> ("cos", ulp, ulp, xt, [](T x) { return mf::cos<ulp>(x); }, [](long double x) { return std::cos (x); });
+    rtn += check<T> ("sigmoid", ulp, 2.0 * ulp + 2.0, xe, [](T x) { return mf::sigmoid<ulp>(x); },
+                     [](long double x) { return 1.0L / (1.0L + std::exp (-x)); });
+    rtn += check<T> ("tanh", ulp, 2.0 * ulp + 2.0, xs, [](T x) { return mf::tanh<ulp>(x); }, [](long double x) { return std::tanh (x); });
+    return rtn;
+}
+
+template <typename T>
+int test_fast()
+{
+    namespace mf = morph::math::fast;
+    constexpr T inf = std::numeric_limits<T>::infinity();
+    int rtn = test_target<T, 4>() + test_target<T, 64>() + test_target<T, 4096>() + test_target<T, 1048576>();
+
+    // Limits and special values
+    if (mf::exp (inf) != inf || mf::exp (-inf) != T{0} || mf::exp (T{1000}) != inf || mf::exp (T{-1000}) != T{0}
+        || !std::isnan (mf::exp (std::numeric_limits<T>::quiet_NaN())) || mf::exp (T{0}) != T{1}) {
+        std::cout << "exp special values wrong\n"; --rtn;
+    }
+    if (mf::log (T{0}) != -inf || mf::log (inf) != inf || !std::isnan (mf::log (T{-1})) || mf::log (T{1}) != T{0}
+        || std::abs (mf::log (std::numeric_limits<T>::denorm_min()) - std::log (std::numeric_limits<T>::denorm_min())) > T{1e-3}) {
+        std::cout << "log special values wrong\n"; --rtn;
+    }
+    if (mf::tanh (T{100}) != T{1} || mf::tanh (T{-100}) != T{-1} || mf::sigmoid (T{-1000}) != T{0} || mf::sigmoid (T{1000}) != T{1}) {
+        std::cout << "tanh/sigmoid limits wrong\n"; --rtn;
+    }
+    volatile T big1 = T{1e7}; // volatile, so that the libm calls are not evaluated at compile time
+    volatile T big2 = T{-3e6};
+    if (mf::sin (T{big1}) != std::sin (T{big1}) || mf::cos (T{big2}) != std::cos (T{big2})) {
+        std::cout << "large arguments should use libm\n"; --rtn;
+    }
+
+    // The vvec element functions
+    morph::vvec<T> v (1000);
+    v.linspace (T{-5}, T{5});
+    morph::vvec<T> vp = v.abs() + T{0.5};
+    auto close = [](const morph::vvec<T>& a, const morph::vvec<T>& b, const T tol) { return (a - b).abs().max() <= tol; };
+    const T tol = T{64} * std::numeric_limits<T>::epsilon();
+    if (!close (v.exp_fast() / v.exp(), morph::vvec<T>(v.size(), T{1}), tol)
+        || !close (vp.log_fast(), vp.log(), tol * T{4})
+        || !close (v.sin_fast(), v.sin(), tol) || !close (v.cos_fast(), v.cos(), tol)
+        || !close (v.gauss_fast (T{1.5}), v.gauss (T{1.5}), tol)
+        || !close (v.logistic_fast (T{2}, T{0.5}), v.logistic (T{2}, T{0.5}), tol)) {
+        std::cout << "vvec fast element functions differ\n"; --rtn;
+    }
+    morph::vvec<T> w = v;
+    w.template tanh_fast_inplace<4096>();
+    morph::vvec<T> wt = v;
+    for (auto& x : wt) { x = std::tanh (x); }
+    if (!close (w, wt, T{1e-2})) { std::cout << "vvec tanh_fast wrong\n"; --rtn; }
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = test_fast<float>() + test_fast<double>();
+    std::cout << "testmath_fast " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,104 @@
+/*
+ * Test morph::memory_usage: heap_bytes counts what containers hold, the totals add up over
+ * the parts, and the reports of a HexGrid, a FeedForwardNet and an RD model find their data.
+ */
+#include "morph/memory_usage.h"
+#include "morph/HexGrid.h"
+#include "morph/RD_Base.h"
+#include "morph/nn/FeedForwardNet.h"
+#include <iostream>
+#include <vector>
+#include <list>
+#include <array>
+
+struct RD_Diffuse : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> lapu;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+        this->checkpoint_var ("u", this->u);
+    }
+
+    void init() { this->noiseify_vector_variable (this->u, 0.5f, 1.0f); }
+
+    void step()
+    {
+        this->compute_laplace (this->u, this->lapu);
+        for (unsigned int h = 0; h < this->nhex; ++h) { this->u[h] += this->dt * this->lapu[h]; }
+    }
+
+    morph::memory_usage memory_usage() const override
+    {
+        morph::memory_usage mu = morph::RD_Base<float>::memory_usage();
+        mu.add ("lapu", this->lapu);
+        return mu;
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+
+    // heap_bytes
+    std::vector<double> vd (100);
+    vd.reserve (200);
+    if (morph::heap_bytes (vd) != 200 * sizeof (double)) { std::cerr << "vector counts capacity\n"; --rtn; }
+    std::vector<std::vector<int>> vvi (3, std::vector<int>(10));
+    if (morph::heap_bytes (vvi) != vvi.capacity() * sizeof (std::vector<int>) + 3 * vvi[0].capacity() * sizeof (int)) {
+        std::cerr << "nested vectors\n"; --rtn;
+    }
+    std::array<std::vector<float>, 2> av = { std::vector<float>(5), std::vector<float>(7) };
+    if (morph::heap_bytes (av) != av[0].capacity() * sizeof (float) + av[1].capacity() * sizeof (float)) {
+        std::cerr << "array of vectors\n"; --rtn;
+    }
+    std::list<int> li (4, 1);
+    if (morph::heap_bytes (li) < 4 * sizeof (int)) { std::cerr << "list\n"; --rtn; }
+    if (morph::heap_bytes (3.0f) != 0) { std::cerr << "scalar\n"; --rtn; }
+
+    // Totals over the tree
+    morph::memory_usage mu ("top", 10, 5);
+    mu.add ("vd", vd, true);
+    morph::memory_usage& sub = mu.add (morph::memory_usage ("sub", 100, 1000));
+    sub.add ("vvi", vvi);
+    if (mu.total_cpu() != 10 + morph::heap_bytes (vd) + 100 + morph::heap_bytes (vvi)) { std::cerr << "total_cpu\n"; --rtn; }
+    if (mu.total_gpu() != 1005) { std::cerr << "total_gpu\n"; --rtn; }
+    if (mu.total_duplicated() != morph::heap_bytes (vd)) { std::cerr << "total_duplicated\n"; --rtn; }
+    if (mu.str().find ("    vvi") == std::string::npos) { std::cerr << "str\n"; --rtn; }
+    if (mu.str (1).find ("vvi") != std::string::npos) { std::cerr << "str max_depth\n"; --rtn; }
+    if (morph::memory_usage::bytes_str (2048) != "2.0 KB") { std::cerr << "bytes_str\n"; --rtn; }
+
+    // HexGrid: at the least, its d_ arrays
+    morph::HexGrid hg (0.02f, 1.0f, 0.0f);
+    hg.setCircularBoundary (0.4f);
+    morph::memory_usage hmu = hg.memory_usage();
+    if (hmu.total_cpu() < hg.num() * (6 * sizeof (int) + 2 * sizeof (float))) { std::cerr << "HexGrid too small\n"; --rtn; }
+    if (hmu.total_gpu() != 0) { std::cerr << "HexGrid on GPU\n"; --rtn; }
+
+    // FeedForwardNet: at the least, its weights
+    morph::nn::FeedForwardNet<float> ff (std::vector<unsigned int>{ 20, 30, 10 });
+    const std::size_t nweights = 20 * 30 + 30 * 10;
+    if (ff.memory_usage().total_cpu() < 2 * nweights * sizeof (float)) { std::cerr << "FeedForwardNet too small\n"; --rtn; }
+
+    // RD model: the grid, the registered and the model's own vectors
+    RD_Diffuse m;
+    m.hextohex_d = 0.05f;
+    m.svgpath = "";
+    m.allocate();
+    m.init();
+    m.step();
+    morph::memory_usage rmu = m.memory_usage();
+    if (rmu.total_cpu() < m.hg->memory_usage().total_cpu() + 2 * m.nhex * sizeof (float)) { std::cerr << "RD model too small\n"; --rtn; }
+    bool found_u = false;
+    for (const auto& p : rmu.parts) {
+        if (p.name == "vars") { for (const auto& v : p.parts) { found_u = found_u || (v.name == "u" && v.cpu >= m.nhex * sizeof (float)); } }
+    }
+    if (!found_u) { std::cerr << "RD model vars\n"; --rtn; }
+    if (rtn == 0) { std::cout << rmu.str(); }
+
+    return rtn;
+}
@@ -0,0 +1,88 @@
+// Test morph::mesh_cache, the on-disk cache of VisualModel meshes
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <morph/mesh_cache.h>
+
+int main()
+{
+    int rtn = 0;
+
+    namespace mc = morph::mesh_cache;
+    const std::filesystem::path d = std::filesystem::temp_directory_path() / "testmesh_cache";
+    std::filesystem::remove_all (d);
+
+    std::vector<std::uint32_t> idx = { 0, 1, 2, 2, 1, 3 };
+    std::vector<float> posn = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 };
+    std::vector<float> norm (12, 0.5f);
+    std::vector<float> col = { 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1 };
+
+    // With no directory, nothing is stored or found
+    mc::dir().clear();
+    if (mc::store ("quad", { &idx, &posn, &norm, &col, nullptr })) { --rtn; }
+
+    mc::dir() = d.string();
+    if (!mc::store ("quad", { &idx, &posn, &norm, &col, nullptr })) {
+        std::cout << "Failed to store a mesh\n";
+        --rtn;
+    }
+    // The odd length of this key checks the padding before the arrays
+    std::vector<float> inst = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+    if (!mc::store ("quad+i", { &idx, &posn, &norm, &col, &inst })) { --rtn; }
+
+    {
+        std::vector<std::uint32_t> i2;
+        std::vector<float> p2, n2, c2, in2 = { 99.0f };
+        if (!mc::load ("quad", { &i2, &p2, &n2, &c2, &in2 })) {
+            std::cout << "Failed to load the mesh\n";
+            --rtn;
+        }
+        if (i2 != idx || p2 != posn || n2 != norm || c2 != col || !in2.empty()) {
+            std::cout << "The loaded mesh differs from the stored one\n";
+            --rtn;
+        }
+        std::vector<float> in3;
+        if (!mc::load ("quad+i", { &i2, &p2, &n2, &c2, &in3 }) || in3 != inst || i2 != idx) { --rtn; }
+    }
+
+    // Another key misses, and leaves the arrays alone
+    {
+        std::vector<std::uint32_t> i2 = { 7 };
+        std::vector<float> p2;
+        if (mc::load ("quad2", { &i2, &p2, nullptr, nullptr, nullptr }) || i2.size() != 1) { --rtn; }
+    }
+
+    // A truncated file is ignored, and replaced by the next store
+    {
+        for (const auto& e : std::filesystem::directory_iterator (d)) {
+            std::filesystem::resize_file (e.path(), std::filesystem::file_size (e.path()) - 4);
+            break;
+        }
+        int hits = 0;
+        std::vector<std::uint32_t> i2;
+        std::vector<float> p2, n2, c2, in2;
+        for (const char* k : { "quad", "quad+i" }) { if (mc::load (k, { &i2, &p2, &n2, &c2, &in2 })) { ++hits; } }
+        if (hits != 1) {
+            std::cout << "Expected one of the two meshes to be unreadable, " << hits << " loaded\n";
+            --rtn;
+        }
+        mc::store ("quad", { &idx, &posn, &norm, &col, nullptr });
+        mc::store ("quad+i", { &idx, &posn, &norm, &col, &inst });
+        hits = 0;
+        for (const char* k : { "quad", "quad+i" }) { if (mc::load (k, { &i2, &p2, &n2, &c2, &in2 })) { ++hits; } }
+        if (hits != 2) { --rtn; }
+    }
+
+    // Keys built from the data of a mesh
+    {
+        std::vector<float> x = { 1.0f, 2.0f };
+        std::vector<float> y = { 1.0f, 2.5f };
+        if (mc::hash (x) == mc::hash (y) || mc::hash (x) != mc::hash (x.data(), 8)) { --rtn; }
+    }
+
+    std::filesystem::remove_all (d);
+    std::cout << "testmesh_cache " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,102 @@
+/*
+ * Test mpi_halo_exchange. Run on several MPI ranks, each holding one piece of an RD_Base
+ * model of diffusion; after a number of RK4 steps every piece must hold exactly the
+ * values of the same model run undivided.
+ */
+#include <mpi.h>
+#include "morph/mpi_halo.h"
+#include "morph/RD_Base.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <memory>
+
+struct RD_Diffuse : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> lapu;
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+        this->integrate_var (this->u);
+    }
+    void init() { this->set_dt (0.0001f); }
+    void step()
+    {
+        this->stepCount++;
+        this->step_rk4 ([this](float, const auto& y, auto& dydt) {
+            this->compute_laplace (*y[0], this->lapu);
+            for (unsigned int h = 0; h < this->nhex; ++h) { dydt[0][h] = this->lapu[h] - (*y[0])[h]; }
+        });
+    }
+};
+
+void setup (RD_Diffuse& m)
+{
+    m.svgpath = "";
+    m.hextohex_d = 0.02f;
+    m.ellipse_a = 0.8f;
+    m.ellipse_b = 0.5f;
+    m.allocate();
+    m.init();
+}
+
+int main (int argc, char** argv)
+{
+    MPI_Init (&argc, &argv);
+    int rank = 0;
+    int size = 1;
+    MPI_Comm_rank (MPI_COMM_WORLD, &rank);
+    MPI_Comm_size (MPI_COMM_WORLD, &size);
+    int rtn = 0;
+
+    try {
+        // Every rank runs the undivided model as the reference
+        RD_Diffuse whole;
+        setup (whole);
+        whole.hg->reorder (morph::HexGridOrder::hilbert);
+        morph::RandUniform<float> rng (0.0f, 1.0f, 5);
+        rng.get (whole.u);
+        std::vector<float> u0 = whole.u;
+        constexpr int nsteps = 20;
+        for (int i = 0; i < nsteps; ++i) { whole.step(); }
+
+        RD_Diffuse piece;
+        piece.num_parts = size;
+        piece.part_index = rank;
+        setup (piece);
+        if (!piece.part) { throw std::runtime_error ("run this test on more than one rank"); }
+        piece.halo = std::make_unique<morph::mpi_halo_exchange<float>> (*piece.part, MPI_COMM_WORLD);
+        piece.part->scatter (u0, piece.u);
+        for (int i = 0; i < nsteps; ++i) { piece.step(); }
+
+        std::vector<float> expect;
+        piece.part->scatter (whole.u, expect);
+        if (piece.u != expect) { std::cerr << "Rank " << rank << ": the piece differs from the undivided model\n"; --rtn; }
+
+        // The pieces gather back to the whole
+        std::vector<int> counts (size), displs (size);
+        const int nown = piece.part->num_owned();
+        MPI_Allgather (&nown, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        for (int r = 1; r < size; ++r) { displs[r] = displs[r - 1] + counts[r - 1]; }
+        std::vector<float> gathered (whole.nhex);
+        MPI_Allgatherv (piece.u.data(), nown, MPI_FLOAT, gathered.data(), counts.data(), displs.data(), MPI_FLOAT, MPI_COMM_WORLD);
+        if (gathered != whole.u) { std::cerr << "Rank " << rank << ": the gathered pieces differ from the whole\n"; --rtn; }
+
+        if (rank == 0) {
+            std::cout << size << " ranks; rank 0 owns " << piece.part->num_owned() << " of " << whole.nhex << " hexes, with "
+                      << piece.part->num_ghosts() << " ghosts from " << piece.part->recv.size() << " neighbours\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Rank " << rank << ": " << e.what() << "\n";
+        --rtn;
+    }
+
+    int allrtn = 0;
+    MPI_Allreduce (&rtn, &allrtn, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (rank == 0) { std::cout << "Test " << (allrtn == 0 ? "PASSED" : "FAILED") << std::endl; }
+    MPI_Finalize();
+    return allrtn;
+}
@@ -0,0 +1,67 @@
+// Test morph::numa: resize() under each placement policy, and pin_threads()
+#include <vector>
+#include <iostream>
+#include <morph/numa.h>
+
+template <typename T>
+int check (const std::vector<T>& v, std::size_t n, T value, const char* what)
+{
+    if (v.size() != n) {
+        std::cout << what << ": size " << v.size() << " != " << n << "\n";
+        return -1;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        if (v[i] != value) {
+            std::cout << what << ": element " << i << " is " << v[i] << ", not " << value << "\n";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    using morph::numa::policy;
+    // Sizes below a page, across a few pages, and large enough for malloc to map them apart
+    for (std::size_t n : { std::size_t{1}, std::size_t{100}, std::size_t{5000}, std::size_t{3000000} }) {
+        for (policy p : { policy::serial, policy::first_touch, policy::interleave }) {
+            std::vector<double> z;
+            morph::numa::resize (z, n, 0.0, p);
+            rtn += check (z, n, 0.0, "zeros");
+            std::vector<float> f;
+            morph::numa::resize (f, n, 2.5f, p);
+            rtn += check (f, n, 2.5f, "value");
+        }
+    }
+
+    // A vector that already has elements keeps them, as with std::vector::resize
+    {
+        std::vector<float> v (10, 1.0f);
+        morph::numa::resize (v, 200000, 3.0f);
+        if (v.size() != 200000 || v[9] != 1.0f || v[10] != 3.0f || v.back() != 3.0f) { --rtn; }
+        morph::numa::resize (v, 5, 0.0f);
+        rtn += check (v, 5, 1.0f, "shrunk");
+    }
+
+    // Memory placed by resize is ordinary memory to be written, copied and freed
+    {
+        std::vector<int> a;
+        morph::numa::resize (a, 1000000, 7, policy::interleave);
+        a[123456] = 8;
+        std::vector<int> b = a;
+        if (b[123456] != 8 || b[123455] != 7) { --rtn; }
+    }
+
+    if (morph::numa::nodes().empty()) { --rtn; }
+#ifdef __linux__
+    if (!morph::numa::pin_threads()) {
+        std::cout << "pin_threads failed\n";
+        --rtn;
+    }
+#endif
+
+    std::cout << "testnuma " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
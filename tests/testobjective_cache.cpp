@@ -0,0 +1,104 @@
+/*
+ * Test morph::objective_cache: exact hits on quantised parameters, the k-d tree's nearest
+ * neighbours against a brute force search, the surrogate's screening and its use from
+ * Anneal and NM_Simplex.
+ */
+#include "morph/objective_cache.h"
+#include "morph/Anneal.h"
+#include "morph/NM_Simplex.h"
+#include "morph/Random.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+double banana (const morph::vvec<double>& xy)
+{
+    return (1.0 - xy[0]) * (1.0 - xy[0]) + 100.0 * (xy[1] - xy[0] * xy[0]) * (xy[1] - xy[0] * xy[0]);
+}
+
+int main()
+{
+    int rtn = 0;
+    std::atomic<unsigned int> calls = 0;
+    auto objective = [&calls](const morph::vvec<double>& x) { ++calls; return banana (x); };
+
+    // Exact hits, including for parameters within a quantum of each other
+    morph::objective_cache<double> c1 (morph::vvec<double>{ 1e-6, 1e-6 });
+    double f1 = c1.evaluate ({ 0.5, 0.25 }, objective);
+    double f2 = c1.evaluate ({ 0.5 + 1e-8, 0.25 }, objective);
+    double f3 = c1.evaluate ({ 0.5 + 1e-5, 0.25 }, objective);
+    if (calls != 2 || c1.hits != 1 || c1.evaluations != 2 || f1 != f2 || f3 == f1) {
+        std::cerr << "Unexpected hits/evaluations: " << c1.hits << "/" << c1.evaluations << "\n";
+        --rtn;
+    }
+
+    // Nearest neighbours in 3D from the k-d tree match a brute force search
+    morph::RandUniform<double> rng (-1.0, 1.0, 42);
+    morph::objective_cache<double> c3 (morph::vvec<double>{ 1e-3, 1e-3, 1e-3 });
+    std::vector<morph::vvec<double>> pts;
+    for (int i = 0; i < 2000; ++i) {
+        morph::vvec<double> p = { rng.get(), rng.get(), rng.get() };
+        pts.push_back (p);
+        c3.evaluate (p, [](const morph::vvec<double>& x) { return x.sum(); });
+    }
+    for (int t = 0; t < 100; ++t) {
+        morph::vvec<double> q = { rng.get(), rng.get(), rng.get() };
+        std::vector<unsigned int> nn = c3.nearest (q, 5);
+        std::vector<double> d (c3.size());
+        for (unsigned int i = 0; i < c3.size(); ++i) { d[i] = c3.distance (q, c3.point (i)); }
+        std::vector<double> ds = d;
+        std::sort (ds.begin(), ds.end());
+        for (unsigned int j = 0; j < 5; ++j) {
+            if (d[nn[j]] != ds[j]) { std::cerr << "k-d tree nearest neighbour " << j << " is wrong\n"; --rtn; t = 100; break; }
+        }
+    }
+
+    // The surrogate: a smooth function is predicted well close to the evaluations
+    c3.kernel_width = 0.2;
+    double pred = 0.0;
+    if (!c3.predict ({ 0.1, 0.2, 0.3 }, pred) || std::abs (pred - 0.6) > 0.05) {
+        std::cerr << "Poor prediction " << pred << " of 0.6\n";
+        --rtn;
+    }
+    if (c3.predict ({ 5.0, 5.0, 5.0 }, pred)) { std::cerr << "Expected no prediction far from the history\n"; --rtn; }
+
+    // Anneal with the cache, screening candidates that look much worse than the best
+    morph::vvec<double> p = { 0.5, -0.5 };
+    morph::vvec<morph::vec<double, 2>> p_rng = {{ {-1.1, 1.1}, {-1.1, 1.1} }};
+    morph::objective_cache<double> ca (p_rng);
+    ca.screen_margin = 5.0;
+    morph::Anneal<double> anneal (p, p_rng);
+    anneal.temperature_ratio_scale = 1e-3;
+    anneal.temperature_anneal_scale = 200;
+    anneal.cost_parameter_scale_ratio = 1.5;
+    anneal.acc_gen_reanneal_ratio = 1e-3;
+    anneal.f_x_best_repeat_max = 15;
+    anneal.display_temperatures = false;
+    anneal.display_reanneal = false;
+    anneal.cache = &ca;
+    calls = 0;
+    anneal.run (objective);
+    std::cout << "Anneal: f_x_best " << anneal.f_x_best << " with " << ca.evaluations << " evaluations, "
+              << ca.hits << " hits and " << ca.screened << " screened\n";
+    if (calls != ca.evaluations || ca.screened == 0) { std::cerr << "The cache was not used as expected\n"; --rtn; }
+    if (anneal.f_x_best > 0.1) { std::cerr << "Anneal with a cache did not get near the minimum\n"; --rtn; }
+
+    // NM_Simplex through the cache. Vertices that survive a shrink are not recomputed.
+    morph::objective_cache<double> cn (morph::vvec<double>{ 1e-12, 1e-12 });
+    morph::NM_Simplex<double> simp (morph::vvec<morph::vvec<double>>{ { 0.7, 0.0 }, { 0.0, 0.6 }, { -0.6, -1.0 } });
+    simp.objective = objective;
+    simp.cache = &cn;
+    simp.termination_threshold = 1e-12;
+    calls = 0;
+    simp.run();
+    morph::vvec<double> b = simp.best_vertex();
+    std::cout << "NM_Simplex: best " << b << " with " << cn.evaluations << " evaluations and " << cn.hits << " hits\n";
+    if (calls != cn.evaluations || cn.hits == 0) { std::cerr << "NM_Simplex did not use the cache\n"; --rtn; }
+    if (std::abs (b[0] - 1.0) > 1e-3 || std::abs (b[1] - 1.0) > 1e-3) { std::cerr << "NM_Simplex with a cache missed the minimum\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
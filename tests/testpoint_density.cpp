@@ -0,0 +1,67 @@
+// Test morph::point_density, the parallel 2D binning behind ScatterVisual's density mode
+#include <vector>
+#include <numeric>
+#include <cmath>
+#include <iostream>
+#include <morph/point_density.h>
+#include <morph/Random.h>
+
+int main()
+{
+    int rtn = 0;
+
+    // A few points placed by hand, including one on the upper edge and some outside
+    {
+        std::vector<morph::vec<float, 3>> p = { { 0.1f, 0.1f, 0.0f }, { 0.9f, 0.1f, 1.0f }, { 0.6f, 0.6f, 0.0f },
+                                                { 1.0f, 1.0f, 0.0f }, { -0.1f, 0.5f, 0.0f }, { 0.5f, 1.5f, 0.0f },
+                                                { std::nanf(""), 0.5f, 0.0f } };
+        std::vector<std::uint32_t> h = morph::point_density::histogram (p, { 2u, 2u }, { 0.0f, 0.0f }, { 1.0f, 1.0f });
+        const std::vector<std::uint32_t> expected = { 1u, 1u, 0u, 2u };
+        if (h != expected) {
+            std::cout << "Binned " << h[0] << " " << h[1] << " " << h[2] << " " << h[3] << ", expected 1 1 0 2\n";
+            --rtn;
+        }
+        std::array<morph::vec<float, 2>, 2> ex = morph::point_density::extent (p);
+        if (ex[0][1] != 0.1f || ex[1][0] != 1.0f || ex[1][1] != 1.5f) { --rtn; }
+    }
+
+    // Millions of points binned in parallel give the same counts as a serial binning
+    {
+        const std::size_t n = 2000000;
+        morph::RandNormal<float> rng (0.0f, 1.0f, 7);
+        std::vector<float> r = rng.get (2 * n);
+        std::vector<morph::vec<float, 3>> p (n);
+        for (std::size_t i = 0; i < n; ++i) { p[i] = { r[2 * i], r[2 * i + 1], 0.0f }; }
+
+        const morph::vec<unsigned int, 2> nb = { 64u, 48u };
+        const morph::vec<float, 2> lo = { -2.0f, -1.5f };
+        const morph::vec<float, 2> hi = { 2.0f, 1.5f };
+        std::vector<std::uint32_t> h = morph::point_density::histogram (p, nb, lo, hi);
+
+        std::vector<std::uint32_t> serial (nb[0] * nb[1], 0u);
+        for (const morph::vec<float, 3>& q : p) {
+            const float x = (q[0] - lo[0]) * nb[0] / (hi[0] - lo[0]);
+            const float y = (q[1] - lo[1]) * nb[1] / (hi[1] - lo[1]);
+            if (x < 0.0f || x > nb[0] || y < 0.0f || y > nb[1]) { continue; }
+            ++serial[std::min (static_cast<unsigned int>(y), nb[1] - 1) * nb[0] + std::min (static_cast<unsigned int>(x), nb[0] - 1)];
+        }
+        if (h != serial) {
+            std::cout << "The parallel binning differs from the serial binning\n";
+            --rtn;
+        }
+        // The centre bins of a normal distribution hold the most points
+        const std::size_t total = std::accumulate (h.begin(), h.end(), std::size_t{0});
+        const std::uint32_t centre = h[24 * 64 + 32];
+        if (total == 0 || total > n || centre < h[0] * 10u) { --rtn; }
+    }
+
+    // An empty window counts nothing
+    {
+        std::vector<morph::vec<float, 3>> p = { { 0.0f, 0.0f, 0.0f } };
+        std::vector<std::uint32_t> h = morph::point_density::histogram (p, { 4u, 4u }, { 0.0f, 0.0f }, { 0.0f, 1.0f });
+        if (h.size() != 16 || std::accumulate (h.begin(), h.end(), 0u) != 0u) { --rtn; }
+    }
+
+    std::cout << "testpoint_density " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,114 @@
+/*
+ * Test RD_Base's active region stepping on a Fisher-KPP front spreading out from a seed: the
+ * active hexes are few and follow the front, the hexes ahead of it stay frozen, and the result
+ * stays close to that of stepping every hex.
+ */
+#include "morph/RD_Base.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+struct RD_Front : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> lapu;
+    float D = 0.001f;
+    float r = 10.0f;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+        this->checkpoint_var ("u", this->u);
+    }
+
+    void init()
+    {
+        // A spot of 1 in the middle
+        for (unsigned int h = 0; h < this->nhex; ++h) {
+            const float x = this->hg->d_x[h];
+            const float y = this->hg->d_y[h];
+            this->u[h] = x * x + y * y < 0.05f * 0.05f ? 1.0f : 0.0f;
+        }
+        this->set_dt (0.001f);
+    }
+
+    void step()
+    {
+        this->stepCount++;
+        this->compute_laplace (this->u, this->lapu);
+        this->for_active ([this](const unsigned int h) {
+            this->u[h] += this->dt * (this->D * this->lapu[h] + this->r * this->u[h] * (1.0f - this->u[h]));
+        });
+        this->active_update();
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+
+    RD_Front full;
+    RD_Front act;
+    for (RD_Front* m : { &full, &act }) {
+        m->hextohex_d = 0.01f;
+        m->svgpath = "";
+        m->allocate();
+        m->init();
+    }
+    act.active_region = true;
+    act.active_tol = 1e-7f;
+    act.profile.enabled = true;
+
+    const unsigned int nsteps = 1000;
+    double active_total = 0.0;
+    for (unsigned int i = 0; i < nsteps; ++i) {
+        full.step();
+        act.step_profiled();
+        active_total += static_cast<double>(act.active_hexes.size());
+        if (!std::is_sorted (act.active_hexes.begin(), act.active_hexes.end())) { std::cerr << "active hexes out of order\n"; --rtn; break; }
+    }
+    const double mean_active = active_total / nsteps;
+    std::cout << act.nhex << " hexes, mean active " << mean_active << "\n";
+    // The front covers a small part of the domain
+    if (mean_active > 0.25 * act.nhex) { std::cerr << "too many active hexes\n"; --rtn; }
+
+    // The profile counts the hexes actually stepped
+    for (const auto& c : act.profile.counters()) {
+        if (c.name == "hexes_updated" && c.total >= static_cast<double>(nsteps) * act.nhex) { std::cerr << "hexes_updated counts every hex\n"; --rtn; }
+    }
+
+    // Close to the full computation everywhere, and the far field is untouched
+    float maxdiff = 0.0f;
+    unsigned int n_spread = 0;
+    for (unsigned int h = 0; h < act.nhex; ++h) {
+        maxdiff = std::max (maxdiff, std::abs (act.u[h] - full.u[h]));
+        if (act.u[h] > 0.5f) { ++n_spread; }
+        const float x = act.hg->d_x[h];
+        const float y = act.hg->d_y[h];
+        if (x * x + y * y > 0.8f * 0.8f && act.u[h] != 0.0f) { std::cerr << "far hex " << h << " changed\n"; --rtn; break; }
+    }
+    std::cout << "max difference from stepping every hex " << maxdiff << "\n";
+    if (maxdiff > 0.01f) { std::cerr << "active region result differs\n"; --rtn; }
+    // The front has moved well out of the seed
+    unsigned int n_seed = 0;
+    for (unsigned int h = 0; h < act.nhex; ++h) {
+        if (act.hg->d_x[h] * act.hg->d_x[h] + act.hg->d_y[h] * act.hg->d_y[h] < 0.05f * 0.05f) { ++n_seed; }
+    }
+    if (n_spread < 2 * n_seed) { std::cerr << "the front did not spread\n"; --rtn; }
+
+    // A new seed far from the front is picked up after active_reset()
+    const unsigned int far = act.nhex - 1;
+    if (std::find (act.active_hexes.begin(), act.active_hexes.end(), far) != act.active_hexes.end()) { std::cerr << "far hex active\n"; --rtn; }
+    act.u[far] = 1.0f;
+    act.active_reset();
+    if (act.active_hexes.size() != act.nhex) { std::cerr << "active_reset did not activate every hex\n"; --rtn; }
+    act.step();
+    if (std::find (act.active_hexes.begin(), act.active_hexes.end(), far) == act.active_hexes.end()) { std::cerr << "new seed not active\n"; --rtn; }
+    if (act.active_hexes.size() > act.nhex / 4) { std::cerr << "quiescent hexes stayed active after active_reset\n"; --rtn; }
+
+    std::cout << "testrd_active " << (rtn ? "failed" : "passed") << std::endl;
+    return rtn;
+}
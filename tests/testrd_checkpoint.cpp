@@ -0,0 +1,100 @@
+/*
+ * Test RD_Base::save_checkpoint and load_checkpoint. A noisy model that is stopped,
+ * checkpointed and restarted in a new process (here, a new object) must reach exactly
+ * the same state as one that runs straight through.
+ */
+#include "morph/RD_Base.h"
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+// Diffusion of u plus a little noise from RD_Base::rng each step
+struct RD_Noisy : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<std::vector<float>> w;
+    std::vector<float> lapu;
+    std::vector<float> noise;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+        this->resize_vector_variable (this->noise);
+        this->resize_vector_vector (this->w, 2);
+        this->checkpoint_var ("u", this->u);
+        this->checkpoint_var ("w", this->w);
+    }
+
+    void init()
+    {
+        this->noiseify_vector_variable (this->u, 0.5f, 1.0f);
+        for (auto& wi : this->w) { this->zero_vector_variable (wi); }
+        this->set_dt (0.0001f);
+    }
+
+    void step()
+    {
+        this->stepCount++;
+        this->compute_laplace (this->u, this->lapu);
+        this->rng.get (this->noise);
+        for (unsigned int h = 0; h < this->nhex; ++h) {
+            this->u[h] += this->dt * this->lapu[h] + 0.01f * (this->noise[h] - 0.5f);
+            this->w[0][h] += this->u[h];
+            this->w[1][h] = this->rng.get();
+        }
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+    const std::string cpfile = "../testrd_checkpoint.h5";
+
+    try {
+        // The reference: 20 steps with a checkpoint after 10
+        RD_Noisy ref;
+        ref.hextohex_d = 0.05f;
+        ref.svgpath = "";
+        ref.allocate();
+        ref.init();
+        for (int i = 0; i < 10; ++i) { ref.step(); }
+        ref.save_checkpoint (cpfile);
+        for (int i = 0; i < 10; ++i) { ref.step(); }
+
+        // A fresh model (with different initial noise) restarted from the checkpoint
+        RD_Noisy m;
+        m.hextohex_d = 0.05f;
+        m.svgpath = "";
+        m.allocate();
+        m.init();
+        m.set_dt (0.5f);
+        m.load_checkpoint (cpfile);
+        if (m.stepCount != 10 || m.get_dt() != 0.0001f) { std::cerr << "stepCount or dt not restored\n"; --rtn; }
+        for (int i = 0; i < 10; ++i) { m.step(); }
+        if (m.u != ref.u || m.w != ref.w) { std::cerr << "Restarted model differs from the reference\n"; --rtn; }
+        if (m.rng.get() != ref.rng.get()) { std::cerr << "rng not in step after restart\n"; --rtn; }
+
+        // A checkpoint won't load on to a different grid
+        RD_Noisy other;
+        other.hextohex_d = 0.04f;
+        other.svgpath = "";
+        other.allocate();
+        other.init();
+        try {
+            other.load_checkpoint (cpfile);
+            std::cerr << "Expected an exception loading a checkpoint on to another HexGrid\n";
+            --rtn;
+        } catch (const std::runtime_error&) {}
+
+    } catch (const std::exception& e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    std::filesystem::remove (cpfile);
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,161 @@
+/*
+ * Test morph::gl::rd_compute, which steps an RD model in compute shaders, against the same
+ * Schnakenberg model as an RD_Base on the CPU, for RK4 and for forward Euler steps. Needs a
+ * headless GL context (EGL) with OpenGL 3.1 ES; a software renderer such as Mesa's llvmpipe
+ * will do.
+ */
+#include <GLES3/gl31.h>
+
+#include "morph/gl/compute_pool.h"
+#include "morph/gl/rd_compute.h"
+#include "morph/RD_Base.h"
+#include "morph/vvec.h"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+
+constexpr int glver = morph::gl::version_3_1_es;
+
+// F = k1 - k2 A + k3 A^2 B; G = k4 - k3 A^2 B, as in examples/schnakenberg/rd_schnakenberg.h
+struct RD_Schnak : public morph::RD_Base<float>
+{
+    std::vector<float> A;
+    std::vector<float> B;
+    std::vector<float> lapA;
+    std::vector<float> lapB;
+    float k1 = 0.1f;
+    float k2 = 1.0f;
+    float k3 = 1.0f;
+    float k4 = 0.9f;
+    float D_A = 0.001f;
+    float D_B = 0.02f;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->A);
+        this->resize_vector_variable (this->B);
+        this->resize_vector_variable (this->lapA);
+        this->resize_vector_variable (this->lapB);
+        this->integrate_var (this->A);
+        this->integrate_var (this->B);
+    }
+
+    void init()
+    {
+        this->noiseify_vector_variable (this->A, 1.0f, 0.2f);
+        this->noiseify_vector_variable (this->B, 0.9f, 0.2f);
+        this->set_dt (0.01f);
+    }
+
+    void derivatives (float, const morph::rk_integrator<float>::state& y, morph::rk_integrator<float>::derivs& dydt)
+    {
+        this->compute_laplace (*y[0], this->lapA);
+        this->compute_laplace (*y[1], this->lapB);
+        for (unsigned int h = 0; h < this->nhex; ++h) {
+            const float a2b = this->k3 * (*y[0])[h] * (*y[0])[h] * (*y[1])[h];
+            dydt[0][h] = this->k1 - this->k2 * (*y[0])[h] + a2b + this->D_A * this->lapA[h];
+            dydt[1][h] = this->k4 - a2b + this->D_B * this->lapB[h];
+        }
+    }
+
+    void step()
+    {
+        this->stepCount++;
+        this->step_rk4 ([this](float t, const auto& y, auto& dydt) { this->derivatives (t, y, dydt); });
+    }
+
+    void step_euler()
+    {
+        this->stepCount++;
+        this->compute_laplace (this->A, this->lapA);
+        this->compute_laplace (this->B, this->lapB);
+        for (unsigned int h = 0; h < this->nhex; ++h) {
+            const float a2b = this->k3 * this->A[h] * this->A[h] * this->B[h];
+            const float dA = this->k1 - this->k2 * this->A[h] + a2b + this->D_A * this->lapA[h];
+            const float dB = this->k4 - a2b + this->D_B * this->lapB[h];
+            this->A[h] += this->dt * dA;
+            this->B[h] += this->dt * dB;
+        }
+    }
+};
+
+const char* schnak_glsl =
+    "void derivs (float u[NF], float lap[NF], out float du[NF])\n"
+    "{\n"
+    "    float a2b = param (2u) * u[0] * u[0] * u[1];\n"
+    "    du[0] = param (0u) - param (1u) * u[0] + a2b + param (4u) * lap[0];\n"
+    "    du[1] = param (3u) - a2b + param (5u) * lap[1];\n"
+    "}\n";
+
+// The largest difference between GPU and CPU fields, relative to the largest CPU value
+float compare (morph::gl::rd_compute<glver>& rd, const RD_Schnak& cpu)
+{
+    morph::vvec<float> a_cpu (cpu.A.begin(), cpu.A.end());
+    morph::vvec<float> b_cpu (cpu.B.begin(), cpu.B.end());
+    const float da = (rd.field (0) - a_cpu).abs().max() / a_cpu.abs().max();
+    const float db = (rd.field (1) - b_cpu).abs().max() / b_cpu.abs().max();
+    return std::max (da, db);
+}
+
+int rd_tests()
+{
+    int rtn = 0;
+
+    for (morph::gl::rd_method method : { morph::gl::rd_method::rk4, morph::gl::rd_method::euler }) {
+        const char* name = method == morph::gl::rd_method::rk4 ? "RK4" : "Euler";
+        RD_Schnak cpu;
+        cpu.hextohex_d = 0.03f;
+        cpu.svgpath = "";
+        cpu.allocate();
+        cpu.init();
+
+        morph::gl::rd_compute<glver> rd (*cpu.hg, 2, 6);
+        rd.reaction = schnak_glsl;
+        rd.method = method;
+        rd.dt = cpu.get_dt();
+        rd.params = { cpu.k1, cpu.k2, cpu.k3, cpu.k4, cpu.D_A, cpu.D_B };
+        rd.set_field (0, cpu.A);
+        rd.set_field (1, cpu.B);
+        rd.init();
+
+        // The initial state comes back unchanged
+        if (compare (rd, cpu) != 0.0f) { std::cout << name << ": initial state not uploaded\n"; --rtn; }
+
+        // Several batches, fetching in between, as a client that saves the state would
+        for (unsigned int batch = 0; batch < 4; ++batch) {
+            rd.step (50);
+            for (unsigned int i = 0; i < 50; ++i) {
+                if (method == morph::gl::rd_method::rk4) { cpu.step(); } else { cpu.step_euler(); }
+            }
+            const float d = compare (rd, cpu);
+            std::cout << name << " after " << rd.steps << " steps: max relative GPU/CPU difference " << d << std::endl;
+            if (!(d < 1e-4f)) { --rtn; }
+        }
+    }
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = -1;
+    try {
+        morph::gl::compute_pool<glver> pool (1);
+        pool.push ([&rtn](morph::gl::compute_context<glver>&) {
+            try {
+                rtn = rd_tests();
+            } catch (const std::exception& e) {
+                std::cout << "Exception: " << e.what() << std::endl;
+                rtn = -1;
+            }
+        });
+        pool.wait();
+    } catch (const std::exception& e) {
+        std::cout << "No GL compute context: " << e.what() << std::endl;
+        rtn = -1;
+    }
+    std::cout << "testrd_compute " << (rtn == 0 ? "passed" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,101 @@
+/*
+ * Test RD_Base::profile: the sections that RD_Base and a model time turn up with one entry per
+ * step, counters add up, a disabled profile records nothing, and the statistics are exported.
+ */
+#include "morph/RD_Base.h"
+#include <iostream>
+#include <filesystem>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+struct RD_Diffuse : public morph::RD_Base<float>
+{
+    std::vector<float> u;
+    std::vector<float> lapu;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->resize_vector_variable (this->u);
+        this->resize_vector_variable (this->lapu);
+    }
+
+    void init()
+    {
+        this->noiseify_vector_variable (this->u, 0.5f, 1.0f);
+        this->set_dt (0.0001f);
+    }
+
+    void step()
+    {
+        this->stepCount++;
+        {
+            auto t = this->profile.time ("reaction");
+            for (unsigned int h = 0; h < this->nhex; ++h) { this->u[h] -= this->dt * this->u[h]; }
+            std::this_thread::sleep_for (std::chrono::microseconds (200));
+        }
+        this->compute_laplace (this->u, this->lapu);
+        for (unsigned int h = 0; h < this->nhex; ++h) { this->u[h] += this->dt * this->lapu[h]; }
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+    const std::string h5file = "../testrd_profile.h5";
+
+    try {
+        RD_Diffuse m;
+        m.hextohex_d = 0.05f;
+        m.svgpath = "";
+        m.allocate();
+        m.init();
+
+        // Disabled: nothing is recorded
+        for (int i = 0; i < 5; ++i) { m.step_profiled(); }
+        if (m.profile.steps() != 0 || !m.profile.sections().empty()) { std::cerr << "Disabled profile recorded\n"; --rtn; }
+
+        m.profile.enabled = true;
+        for (int i = 0; i < 50; ++i) { m.step_profiled(); }
+        std::cout << m.profile.summary();
+        if (m.profile.steps() != 50) { std::cerr << "Wrong number of steps\n"; --rtn; }
+
+        for (const char* name : { "step", "reaction", "compute_laplace" }) {
+            bool found = false;
+            for (const auto& s : m.profile.sections()) {
+                if (s.name != name) { continue; }
+                found = true;
+                if (s.calls != 50 || s.ms.count() != 50) { std::cerr << name << " timed " << s.calls << " times\n"; --rtn; }
+                if (!(s.ms.min() <= s.p50.get() && s.p50.get() <= s.p99.get() && s.p99.get() <= s.ms.max())) {
+                    std::cerr << name << " statistics out of order\n"; --rtn;
+                }
+            }
+            if (!found) { std::cerr << "No section " << name << "\n"; --rtn; }
+        }
+
+        // The step contains the reaction, which sleeps 0.2 ms
+        nlohmann::json j = m.profile.to_json();
+        if (j["sections"]["reaction"]["min_ms"].get<double>() < 0.2
+            || j["sections"]["step"]["mean_ms"].get<double>() < j["sections"]["reaction"]["mean_ms"].get<double>()) {
+            std::cerr << "Implausible times\n"; --rtn;
+        }
+        if (j["counters"]["hexes_updated"]["total"].get<double>() != 50.0 * m.nhex) { std::cerr << "hexes_updated is wrong\n"; --rtn; }
+
+        m.save_profile (h5file);
+        {
+            morph::HdfData d (h5file, morph::FileAccess::ReadOnly);
+            double mean_ms = 0.0;
+            d.read_val ("/profile/sections/compute_laplace/mean_ms", mean_ms);
+            if (mean_ms != m.profile.sections()[2].ms.mean()) { std::cerr << "Saved mean_ms differs\n"; --rtn; }
+        }
+        std::filesystem::remove (h5file);
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        rtn = -1;
+    }
+
+    std::cout << "testrd_profile " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
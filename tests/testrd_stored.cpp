@@ -0,0 +1,82 @@
+/*
+ * Test RD_Base::compute_laplace on fields held in reduced precision: it is the same as the
+ * Laplacian of the loaded values, and a reaction diffusion run with float16 state stays close
+ * to the float run, while the bfloat16 one reports the increments that its storage loses.
+ */
+#include "morph/RD_Base.h"
+#include <morph/stored_field.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Logistic growth with diffusion, with the state u held as S
+template <typename S>
+struct RD_Stored : public morph::RD_Base<float>
+{
+    morph::stored_field<S, float> u;
+    std::vector<float> lapu;
+
+    void allocate()
+    {
+        morph::RD_Base<float>::allocate();
+        this->u.resize (this->nhex);
+        this->resize_vector_variable (this->lapu);
+    }
+
+    void init()
+    {
+        this->u.update ([this](std::size_t h, float) {
+            return 0.5f + 0.4f * std::sin (20.0f * this->hg->d_x[h]) * std::cos (15.0f * this->hg->d_y[h]);
+        });
+        this->set_dt (0.005f);
+    }
+
+    void step()
+    {
+        this->stepCount++;
+        this->compute_laplace (this->u, this->lapu);
+        this->u.update ([this](std::size_t h, float x) { return x + this->dt * (0.001f * this->lapu[h] + 2.0f * x * (1.0f - x)); });
+    }
+};
+
+int main()
+{
+    int rtn = 0;
+
+    RD_Stored<float> mf;
+    RD_Stored<morph::bfloat16> mb;
+    RD_Stored<morph::float16> mh;
+    auto setup = [](auto& m) { m.hextohex_d = 0.01f; m.svgpath = ""; m.allocate(); m.init(); };
+    setup (mf);
+    setup (mb);
+    setup (mh);
+
+    // The stored Laplacian is that of the loaded values
+    std::vector<float> loaded = mb.u.load();
+    std::vector<float> lap_loaded (mb.nhex), lap_stored;
+    mb.compute_laplace (loaded, lap_loaded);
+    mb.compute_laplace (mb.u, lap_stored);
+    if (lap_loaded != lap_stored) { std::cerr << "stored Laplacian differs from the Laplacian of the loaded field\n"; --rtn; }
+
+    for (int i = 0; i < 40; ++i) { mf.step(); mb.step(); mh.step(); }
+    float db = 0.0f, dh = 0.0f;
+    for (unsigned int h = 0; h < mf.nhex; ++h) {
+        db = std::max (db, std::abs (mb.u[h] - mf.u[h]));
+        dh = std::max (dh, std::abs (mh.u[h] - mf.u[h]));
+    }
+    std::cout << "after 40 steps, max difference from float: bfloat16 " << db << ", float16 " << dh << "\n";
+    std::cout << "worst relative rounding error: bfloat16 " << mb.u.worst_error.max_rel << ", float16 " << mh.u.worst_error.max_rel << "\n";
+    std::cout << "most stalled values in a step: bfloat16 " << mb.u.worst_error.stalled << ", float16 " << mh.u.worst_error.stalled
+              << ", float " << mf.u.worst_error.stalled << " of " << mf.nhex << "\n";
+    if (dh > 0.01f || !(dh < db)) { std::cerr << "reduced precision runs drifted\n"; --rtn; }
+    // The increments of a step are lost more often in bfloat16 than in float16, and never in float
+    if (mf.u.worst_error.stalled != 0 || !(mb.u.worst_error.stalled > mh.u.worst_error.stalled)) { std::cerr << "stalled counts wrong\n"; --rtn; }
+    if (mb.u.worst_error.max_rel > std::ldexp (1.0f, -8) || mh.u.worst_error.max_rel > std::ldexp (1.0f, -11) || mf.u.worst_error.max_abs != 0.0f) {
+        std::cerr << "rounding errors out of bounds\n"; --rtn;
+    }
+    if (mb.u.bytes() * 2 != mf.u.bytes()) { std::cerr << "bfloat16 field is not half the size\n"; --rtn; }
+
+    std::cout << "testrd_stored " << (rtn ? "failed" : "passed") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,99 @@
+/*
+ * Test ReadCurves' streaming reader. Reading trial.svg whole, or just some of its layers,
+ * must give the same paths as the DOM reader. A file with the awkward parts of XML
+ * (a DOCTYPE with an internal subset, CDATA, comments and attribute values containing '>')
+ * and compact path data must read correctly, and asking for a missing layer must throw.
+ */
+#include "morph/ReadCurves.h"
+#include "morph/BezCurvePath.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cmath>
+
+// The same path: the same curves, giving the same points
+bool same (const morph::BezCurvePath<float>& a, const morph::BezCurvePath<float>& b)
+{
+    if (a.name != b.name || a.curves.size() != b.curves.size()) { return false; }
+    morph::BezCurvePath<float> pa = a;
+    morph::BezCurvePath<float> pb = b;
+    pa.computePoints (0.01f);
+    pb.computePoints (0.01f);
+    const std::vector<morph::BezCoord<float>> qa = pa.getPoints();
+    const std::vector<morph::BezCoord<float>> qb = pb.getPoints();
+    if (qa.size() != qb.size()) { return false; }
+    for (std::size_t i = 0; i < qa.size(); ++i) {
+        if (qa[i].x() != qb[i].x() || qa[i].y() != qb[i].y()) { return false; }
+    }
+    return true;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::ReadCurves dom ("../../tests/trial.svg");
+    morph::ReadCurves all ("../../tests/trial.svg", std::vector<std::string>{});
+    if (!same (dom.getCorticalPath(), all.getCorticalPath())) { std::cerr << "Cortex differs\n"; --rtn; }
+    if (dom.getEnclosedRegions().size() != all.getEnclosedRegions().size()) { std::cerr << "Region count differs\n"; --rtn; }
+    for (const auto& r : dom.getEnclosedRegions()) {
+        if (!same (r, all.getEnclosedRegion (r.name))) { std::cerr << "Region " << r.name << " differs\n"; --rtn; }
+    }
+    if (dom.getScale_mmpersvg() != all.getScale_mmpersvg()) { std::cerr << "Scale differs\n"; --rtn; }
+
+    morph::ReadCurves some ("../../tests/trial.svg", { "v1", "cortex" });
+    if (!same (dom.getCorticalPath(), some.getCorticalPath())) { std::cerr << "Cortex of some layers differs\n"; --rtn; }
+    if (some.getEnclosedRegions().size() != 1 || !same (dom.getEnclosedRegion ("v1"), some.getEnclosedRegion ("v1"))) {
+        std::cerr << "Expected just v1 as an enclosed region\n"; --rtn;
+    }
+
+    bool threw = false;
+    try {
+        morph::ReadCurves missing ("../../tests/trial.svg", { "nosuchlayer" });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    if (!threw) { std::cerr << "Asking for a missing layer did not throw\n"; --rtn; }
+
+    // A square traced with compact relative commands, amid awkward XML
+    const std::string fn ("./testreadcurves_stream.svg");
+    {
+        std::ofstream f (fn);
+        f << "<?xml version=\"1.0\"?>\n"
+          << "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"svg11.dtd\" [ <!ENTITY ns \"a>b\"> ]>\n"
+          << "<svg xmlns=\"http://www.w3.org/2000/svg\">\n"
+          << "<style><![CDATA[ g > path { fill: none } ]]></style>\n"
+          << "<!-- <g id=\"commented\"> is not a layer -->\n"
+          << "<g id=\"skipped\" title=\"a > b\"><path d=\"M0,0L1,1\"/></g>\n"
+          << "<g id=\"square\"><g><path id=\"path12\" d=\"m10 10h10v10H10z\"/></g></g>\n"
+          << "<g id=\"compact\"><path d=\"M.5.5l1e1-0 .0,1E1-10-10c1,0,2,0,3,0 1,0,2,0 3,0\"/></g>\n"
+          << "<g id=\"_3_mm\"><line x1=\"0\" y1=\"0\" x2=\"3\" y2=\"0\"/></g>\n"
+          << "</svg>\n";
+    }
+    try {
+        morph::ReadCurves s (fn, { "square", "compact" });
+        // The scale bar of length 3 represents 3 mm
+        if (std::abs (s.getScale_mmpersvg() - 1.0f) > 1e-6f) { std::cerr << "Scale " << s.getScale_mmpersvg() << "\n"; --rtn; }
+        morph::BezCurvePath<float> sq = s.getEnclosedRegion ("square");
+        if (sq.curves.size() != 4) { std::cerr << "square has " << sq.curves.size() << " curves\n"; --rtn; }
+        morph::BezCurvePath<float> cp = s.getEnclosedRegion ("compact");
+        if (cp.curves.size() != 5) { std::cerr << "compact has " << cp.curves.size() << " curves\n"; --rtn; }
+        if (!s.getEnclosedRegion ("skipped").curves.empty()) { std::cerr << "An unrequested layer was read\n"; --rtn; }
+        // The square's perimeter is 40 and the compact path's is 10 + 10 + 10*sqrt(2) + 3 + 3
+        float lsq = 0.0f;
+        for (const auto& b : sq.curves) { lsq += b.getArcLength(); }
+        float lcp = 0.0f;
+        for (const auto& b : cp.curves) { lcp += b.getArcLength(); }
+        if (std::abs (lsq - 40.0f) > 1e-3f) { std::cerr << "square perimeter " << lsq << "\n"; --rtn; }
+        if (std::abs (lcp - (26.0f + 10.0f * std::sqrt (2.0f))) > 1e-3f) { std::cerr << "compact length " << lcp << "\n"; --rtn; }
+    } catch (const std::exception& e) {
+        std::cerr << "Reading " << fn << ": " << e.what() << "\n";
+        --rtn;
+    }
+    std::remove (fn.c_str());
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
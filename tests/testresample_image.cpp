@@ -0,0 +1,99 @@
+/*
+ * Test Grid::resample_image and HexGrid::resampleImage, which visit only the image pixels
+ * in a 3 sigma window, against a brute force sum over every pixel.
+ */
+#include "morph/Grid.h"
+#include "morph/HexGrid.h"
+#include "morph/vvec.h"
+#include "morph/vec.h"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+// The Gaussian weighted sum of all pixels within 3 sigma of p, where pixel (i,j) is at
+// dpp * (i,j) + origin, renormalised as the resamplers do.
+morph::vvec<float> brute_resample (const morph::vvec<float>& img, const unsigned int pw,
+                                   const std::vector<morph::vec<float, 2>>& targets,
+                                   const morph::vec<float, 2>& dpp, const morph::vec<float, 2>& origin)
+{
+    const unsigned int ph = img.size() / pw;
+    morph::vec<float, 2> params = 1.0f / (2.0f * dpp * dpp);
+    morph::vec<float, 2> threesig = 3.0f * dpp;
+    morph::vvec<float> out (targets.size(), 0.0f);
+    for (std::size_t t = 0; t < targets.size(); ++t) {
+        double sum = 0.0;
+        for (unsigned int j = 0; j < ph; ++j) {
+            for (unsigned int i = 0; i < pw; ++i) {
+                float dx = targets[t][0] - (dpp[0] * i + origin[0]);
+                float dy = targets[t][1] - (dpp[1] * j + origin[1]);
+                if (std::abs (dx) < threesig[0] && std::abs (dy) < threesig[1]) {
+                    sum += std::exp (-params[0] * dx * dx) * std::exp (-params[1] * dy * dy) * img[j * pw + i];
+                }
+            }
+        }
+        out[t] = static_cast<float>(sum);
+    }
+    return out / out.max();
+}
+
+int main()
+{
+    int rtn = 0;
+    using sc = std::chrono::steady_clock;
+
+    // A smooth image with some structure, 120 x 80 pixels
+    const unsigned int pw = 120;
+    const unsigned int ph = 80;
+    morph::vvec<float> img (pw * ph);
+    for (unsigned int j = 0; j < ph; ++j) {
+        for (unsigned int i = 0; i < pw; ++i) { img[j * pw + i] = 0.5f + 0.5f * std::sin (i * 0.21f) * std::cos (j * 0.13f); }
+    }
+
+    // Grid target
+    morph::Grid g (50U, 30U, morph::vec<float, 2>{ 0.02f, 0.02f });
+    morph::vec<float, 2> scale = { 1.0f, 1.0f };
+    morph::vec<float, 2> offset = { 0.013f, -0.02f };
+    morph::vvec<float> gr = g.resample_image (img, pw, scale, offset);
+    {
+        morph::vec<float, 2> dims = { 1.0f, 1.0f / (pw - 1u) * (ph - 1u) };
+        dims *= g.width();
+        dims *= scale;
+        morph::vec<float, 2> dpp = dims / morph::vec<unsigned int, 2>{ pw - 1u, ph - 1u };
+        std::vector<morph::vec<float, 2>> targets (g.v_c.begin(), g.v_c.end());
+        morph::vvec<float> ref = brute_resample (img, pw, targets, dpp, offset);
+        float maxdiff = (gr - ref).abs().max();
+        std::cout << "Grid: max difference from brute force " << maxdiff << std::endl;
+        if (maxdiff > 1e-5f) { std::cerr << "Grid::resample_image differs from the brute force result\n"; --rtn; }
+    }
+
+    // HexGrid target
+    morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+    hg.setCircularBoundary (0.6f);
+    morph::vec<float, 2> hscale = { 1.5f, 1.5f };
+    morph::vvec<float> hr = hg.resampleImage (img, pw, hscale, offset);
+    {
+        morph::vec<float, 2> dpp = hscale / static_cast<float>(pw - 1u);
+        morph::vec<float, 2> centering = dpp * morph::vec<unsigned int, 2>{ pw, ph } * 0.5f;
+        std::vector<morph::vec<float, 2>> targets (hg.num());
+        for (unsigned int i = 0; i < hg.num(); ++i) { targets[i] = { hg.d_x[i], hg.d_y[i] }; }
+        morph::vvec<float> ref = brute_resample (img, pw, targets, dpp, offset - centering);
+        float maxdiff = (hr - ref).abs().max();
+        std::cout << "HexGrid: max difference from brute force " << maxdiff << std::endl;
+        if (maxdiff > 1e-5f) { std::cerr << "HexGrid::resampleImage differs from the brute force result\n"; --rtn; }
+    }
+
+    // A 1 megapixel image on to a large HexGrid should be quick
+    morph::vvec<float> big (1000 * 1000);
+    for (std::size_t i = 0; i < big.size(); ++i) { big[i] = static_cast<float>((i * 7919) % 1000) / 1000.0f; }
+    morph::HexGrid bighg (0.005f, 3.0f, 0.0f);
+    bighg.setCircularBoundary (0.8f);
+    sc::time_point t0 = sc::now();
+    morph::vvec<float> bigr = bighg.resampleImage (big, 1000, morph::vec<float, 2>{ 2.0f, 2.0f }, morph::vec<float, 2>{ 0.0f, 0.0f });
+    sc::time_point t1 = sc::now();
+    std::cout << "1 Mpixel image on to " << bighg.num() << " hexes in "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+    if (bigr.has_nan_or_inf() || bigr.max() != 1.0f) { std::cerr << "Bad result from the large resample\n"; --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,147 @@
+/*
+ * Test morph::rk_integrator: the order of convergence of rk4(), the error control of
+ * rk45() and the stability and accuracy of imex() for stiff diffusion on a HexGrid.
+ */
+#include "morph/rk_integrator.h"
+#include "morph/implicit_diffusion.h"
+#include "morph/stencil.h"
+#include "morph/HexGrid.h"
+#include <iostream>
+#include <vector>
+#include <numeric>
+#include <cmath>
+
+using integ_t = morph::rk_integrator<double>;
+
+// Harmonic oscillators x'' = -w^2 x with a different frequency for each element
+void oscillator (double, const integ_t::state& y, integ_t::derivs& dydt)
+{
+    const std::vector<double>& x = *y[0];
+    const std::vector<double>& v = *y[1];
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        const double w = 1.0 + static_cast<double>(i);
+        dydt[0][i] = v[i];
+        dydt[1][i] = -w * w * x[i];
+    }
+}
+
+// The error at t = T of the oscillators started from x = 1, v = 0
+double oscillator_error (const std::vector<double>& x, const double T)
+{
+    double e = 0.0;
+    for (std::size_t i = 0; i < x.size(); ++i) { e = std::max (e, std::abs (x[i] - std::cos ((1.0 + i) * T))); }
+    return e;
+}
+
+double rk4_error (const double dt, const double T)
+{
+    std::vector<double> x (3, 1.0), v (3, 0.0);
+    integ_t integ;
+    integ.add_field (x);
+    integ.add_field (v);
+    const int nsteps = static_cast<int>(std::lround (T / dt));
+    for (int i = 0; i < nsteps; ++i) { integ.rk4 (oscillator, dt); }
+    return oscillator_error (x, T);
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // rk4 is 4th order: halving dt divides the error by about 16
+    {
+        const double e1 = rk4_error (0.02, 2.0);
+        const double e2 = rk4_error (0.01, 2.0);
+        std::cout << "rk4 errors " << e1 << ", " << e2 << " (ratio " << e1 / e2 << ")\n";
+        if (!(e1 / e2 > 12.0 && e1 / e2 < 20.0)) { std::cerr << "rk4 is not 4th order\n"; --rtn; }
+
+        std::vector<double> x (3, 1.0), v (3, 0.0);
+        integ_t integ;
+        integ.add_field (x);
+        integ.add_field (v);
+        integ.rk4 (oscillator, 0.01);
+        integ.rk4 (oscillator, 0.01);
+        if (integ.evaluations != 8 || std::abs (integ.t - 0.02) > 1e-15) { std::cerr << "rk4 bookkeeping is wrong\n"; --rtn; }
+    }
+
+    // rk45 meets its tolerance, adapting the step size up from a poor first guess
+    {
+        std::vector<double> x (3, 1.0), v (3, 0.0);
+        integ_t integ;
+        integ.add_field (x);
+        integ.add_field (v);
+        integ.rtol = 1e-8;
+        integ.atol = 1e-10;
+        const double T = 10.0;
+        double dt = 1.0;
+        while (integ.t < T) {
+            dt = std::min (dt, T - integ.t);
+            integ.rk45 (oscillator, dt);
+        }
+        const double err = oscillator_error (x, T);
+        std::cout << "rk45: " << integ.accepted << " steps accepted, " << integ.rejected << " rejected, error " << err << "\n";
+        if (err > 1e-6 || integ.rejected == 0 || integ.accepted > 2000) { std::cerr << "rk45 error control fails\n"; --rtn; }
+        // The same error from fixed rk4 steps needs many more evaluations
+        const double e_fixed = rk4_error (T / (integ.evaluations / 4.0), T);
+        if (!(e_fixed > err)) { std::cerr << "rk45 is no better than rk4 for the same work\n"; --rtn; }
+    }
+
+    // imex: diffusion far beyond the explicit limit, with linear decay as the reaction
+    {
+        morph::HexGrid hg (0.05f, 3.0f, 0.0f);
+        hg.setEllipticalBoundary (0.6f, 0.4f);
+        const std::size_t n = hg.num();
+        const double D = 1.0;
+        const double kd = 2.0;
+        const double h = hg.getd();
+        std::vector<double> u0 (n);
+        for (std::size_t i = 0; i < n; ++i) { u0[i] = hg.d_x[i] > 0.0f ? 1.0 : 0.0; }
+
+        auto decay = [kd](double, const integ_t::state& y, integ_t::derivs& dydt) {
+            for (std::size_t i = 0; i < y[0]->size(); ++i) { dydt[0][i] = -kd * (*y[0])[i]; }
+        };
+        std::vector<double> lap;
+        auto full = [&](double, const integ_t::state& y, integ_t::derivs& dydt) {
+            morph::apply_stencil<morph::stencils::hex_laplace<double>> (hg, *y[0], lap, 2.0 / (3.0 * h * h));
+            for (std::size_t i = 0; i < n; ++i) { dydt[0][i] = D * lap[i] - kd * (*y[0])[i]; }
+        };
+
+        // An explicit reference, well inside the CFL limit of d^2 / (3D)
+        const double T = 0.1;
+        std::vector<double> uref = u0;
+        {
+            integ_t integ;
+            integ.add_field (uref);
+            for (int i = 0; i < 1000; ++i) { integ.rk4 (full, T / 1000); }
+        }
+
+        // imex at 12 and 24 times the explicit limit
+        morph::diffusion_cg<double> solver (hg);
+        solver.tolerance = 1e-10;
+        double errs[2] = { 0.0, 0.0 };
+        for (int k = 0; k < 2; ++k) {
+            const int nsteps = 5 << k;
+            std::vector<double> u = u0;
+            integ_t integ;
+            integ.add_field (u);
+            for (int i = 0; i < nsteps; ++i) { integ.imex (decay, solver, { D }, T / nsteps); }
+            for (std::size_t i = 0; i < n; ++i) { errs[k] = std::max (errs[k], std::abs (u[i] - uref[i])); }
+            const double m = std::accumulate (u.begin(), u.end(), 0.0);
+            const double m0 = std::accumulate (u0.begin(), u0.end(), 0.0);
+            if (std::abs (m - m0 * std::exp (-kd * T)) > 1e-6 * m0) { std::cerr << "imex total is wrong\n"; --rtn; }
+        }
+        std::cout << "imex errors " << errs[0] << ", " << errs[1] << " on " << n << " hexes\n";
+        if (!(errs[1] < 0.05 && errs[0] / errs[1] > 1.5)) { std::cerr << "imex does not converge\n"; --rtn; }
+    }
+
+    // A step with nothing registered is an error
+    try {
+        integ_t integ;
+        integ.rk4 (oscillator, 0.1);
+        std::cerr << "Expected an exception with no fields\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,118 @@
+// Test the one pass statistics accumulators in morph/running_stats.h against whole-data methods
+#include <morph/running_stats.h>
+#include <morph/vvec.h>
+#include <morph/MathAlgo.h>
+#include <morph/Random.h>
+#include <iostream>
+#include <cmath>
+
+template <typename T>
+bool close (const T a, const T b, const T tol) { return std::abs (a - b) <= tol * std::max (T{1}, std::abs (b)); }
+
+int main()
+{
+    int rtn = 0;
+    using T = double;
+    const std::size_t n = 100000;
+
+    morph::vvec<T> x (n);
+    morph::RandNormal<T> rn (T{3}, T{2}, 42);
+    for (auto& xi : x) { xi = rn.get(); }
+    // Offset by a large constant, which defeats the sum of squares method but not Welford's
+    morph::vvec<T> xo = x + T{1e8};
+
+    // Mean, variance, min and max, as vvec's
+    morph::running_stats<T> rs;
+    rs.add_all (xo);
+    if (rs.count() != n || !close (rs.mean(), xo.mean(), T{1e-12}) || !close (rs.variance(), x.variance(), T{1e-6})
+        || rs.min() != xo.min() || rs.max() != xo.max()) {
+        std::cout << "running_stats differs from vvec: mean " << rs.mean() << " var " << rs.variance() << " vs " << x.variance() << std::endl;
+        --rtn;
+    }
+
+    // Merging parts gives the statistics of the whole
+    morph::running_stats<T> ra;
+    morph::running_stats<T> rb;
+    morph::running_stats<T> re;
+    for (std::size_t i = 0; i < n; ++i) { (i < n / 3 ? ra : rb).add (xo[i]); }
+    ra += rb;
+    ra += re; // merging an empty accumulator changes nothing
+    if (ra.count() != n || !close (ra.mean(), rs.mean(), T{1e-12}) || !close (ra.variance(), rs.variance(), T{1e-8})
+        || ra.min() != rs.min() || ra.max() != rs.max()) {
+        std::cout << "merged running_stats differ\n"; --rtn;
+    }
+
+    // Higher moments of a normal distribution: skewness and excess kurtosis near 0
+    morph::running_moments<T> rm;
+    rm.add_all (x);
+    T m2 = T{0}, m3 = T{0}, m4 = T{0};
+    const T mu = x.mean();
+    for (T xi : x) { const T d = xi - mu; m2 += d * d; m3 += d * d * d; m4 += d * d * d * d; }
+    const T skew = std::sqrt (T(n)) * m3 / std::pow (m2, T{1.5});
+    const T kurt = T(n) * m4 / (m2 * m2) - T{3};
+    if (!close (rm.skewness(), skew, T{1e-8}) || !close (rm.kurtosis(), kurt, T{1e-8}) || std::abs (rm.kurtosis()) > T{0.1}) {
+        std::cout << "moments wrong: skewness " << rm.skewness() << " (" << skew << ") kurtosis " << rm.kurtosis() << " (" << kurt << ")\n";
+        --rtn;
+    }
+    morph::running_moments<T> rma;
+    morph::running_moments<T> rmb;
+    for (std::size_t i = 0; i < n; ++i) { (i % 7 == 0 ? rma : rmb).add (x[i]); }
+    rma += rmb;
+    if (!close (rma.skewness(), rm.skewness(), T{1e-8}) || !close (rma.kurtosis(), rm.kurtosis(), T{1e-8})
+        || !close (rma.variance(), rm.variance(), T{1e-10})) {
+        std::cout << "merged moments differ\n"; --rtn;
+    }
+
+    // Covariance and the regression line, as MathAlgo's
+    morph::vvec<T> y = x * T{2.5} - T{4};
+    morph::vvec<T> noise (n);
+    noise.randomize();
+    y += noise;
+    morph::running_covariance<T> rc;
+    morph::running_covariance<T> rc2;
+    for (std::size_t i = 0; i < n; ++i) { (i < n / 2 ? rc : rc2).add (x[i], y[i]); }
+    rc += rc2;
+    morph::vec<T, 2> lr = morph::MathAlgo::linregr (x, y);
+    morph::vec<T, 2> lrr = rc.linregr();
+    if (!close (lrr[0], lr[0], T{1e-9}) || !close (lrr[1], lr[1], T{1e-9})
+        || !close (rc.covariance(), morph::MathAlgo::covariance (x, y) / T(n - 1), T{1e-9}) || rc.correlation() < T{0.99}) {
+        std::cout << "running_covariance wrong: " << lrr << " vs " << lr << std::endl; --rtn;
+    }
+
+    // Per element statistics of a sequence of fields
+    morph::running_field_stats<float> fs;
+    morph::running_field_stats<float> fs2;
+    const std::size_t nf = 50;
+    morph::vvec<float> e3;
+    for (std::size_t t = 0; t < nf; ++t) {
+        morph::vvec<float> f (1000);
+        f.randomize();
+        f[3] = static_cast<float>(t);
+        e3.push_back (f[3]);
+        (t < 20 ? fs : fs2).add (f);
+    }
+    fs += fs2;
+    if (fs.count() != nf || fs.size() != 1000 || !close (fs.mean()[3], e3.mean(), 1e-6f) || !close (fs.variance()[3], e3.variance(), 1e-5f)
+        || fs.max()[3] != 49.0f || fs.min()[3] != 0.0f || std::abs (fs.mean()[10] - 0.5f) > 0.15f || fs.at (3).count() != nf) {
+        std::cout << "running_field_stats wrong\n"; --rtn;
+    }
+    try {
+        fs.add (morph::vvec<float>(10));
+        std::cout << "expected an exception for a field of the wrong size\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+
+    // P^2 quantiles of the normal distribution, mean 3, sd 2
+    morph::p2_quantile<T> med;
+    morph::p2_quantile<T> q90 (T{0.9});
+    med.add_all (x);
+    q90.add_all (x);
+    if (std::abs (med.get() - T{3}) > T{0.03} || std::abs (q90.get() - (T{3} + T{2} * T{1.2815516})) > T{0.05}) {
+        std::cout << "p2_quantile estimates wrong: median " << med.get() << " 0.9 quantile " << q90.get() << std::endl; --rtn;
+    }
+    morph::p2_quantile<T> few;
+    few.add_all (morph::vvec<T>{ T{4}, T{1}, T{3} });
+    if (few.get() != T{3}) { std::cout << "p2_quantile of few values should be exact\n"; --rtn; }
+
+    std::cout << "testrunning_stats " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
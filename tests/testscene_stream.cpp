@@ -0,0 +1,156 @@
+// Test morph::scene_stream, which streams the models of a scene, and then their changes, to remote viewers
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <morph/scene_stream.h>
+
+namespace ss = morph::scene_stream;
+
+static int count (const std::vector<ss::change>& ch, const ss::message m)
+{
+    int n = 0;
+    for (const auto& c : ch) { if (c.type == m) { ++n; } }
+    return n;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    ss::model_state quad;
+    quad.indices = { 0, 1, 2, 2, 1, 3 };
+    quad.positions = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 };
+    quad.normals = { 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1 };
+    quad.colours = { 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 1 };
+    quad.viewmatrix[12] = 2.0f;
+    ss::label lb;
+    lb.text = U"q²";
+    lb.offset = { 0.0f, -0.2f, 0.0f };
+    quad.labels.push_back (lb);
+    ss::model_state tri = quad;
+    tri.indices = { 0, 1, 2 };
+
+    ss::encoder enc;
+    ss::decoder dec;
+    auto send = [&enc, &dec](const ss::frame& f, const std::size_t piece) {
+        std::string out;
+        enc.encode (f, out);
+        // Deliver in pieces, as a socket may
+        std::vector<ss::change> ch;
+        for (std::size_t i = 0; i < out.size(); i += piece) {
+            dec.feed (out.data() + i, std::min (piece, out.size() - i));
+            for (const auto& c : dec.apply()) { ch.push_back (c); }
+        }
+        return std::make_pair (out.size(), ch);
+    };
+
+    // The first frame is a keyframe
+    ss::frame f;
+    f.add (1, quad);
+    f.add (2, tri);
+    f.view.trans = { 0.1f, 0.2f, -4.0f };
+    auto [key_bytes, ch] = send (f, 7);
+    if (count (ch, ss::message::geometry) != 2 || count (ch, ss::message::state) != 2
+        || count (ch, ss::message::labels) != 2 || count (ch, ss::message::scene) != 1) {
+        std::cout << "The keyframe should hold every part of both models\n";
+        --rtn;
+    }
+    {
+        const ss::model_state& q = dec.current.models[1];
+        if (q.indices != quad.indices || q.positions != quad.positions || q.normals != quad.normals
+            || q.colours != quad.colours || q.viewmatrix != quad.viewmatrix || q.labels.size() != 1
+            || q.labels[0].text != lb.text || q.labels[0].offset != lb.offset) {
+            std::cout << "The decoded model differs from the one sent\n";
+            --rtn;
+        }
+        if (dec.current.models[2].indices.size() != 3 || dec.current.view.trans != f.view.trans) { --rtn; }
+    }
+
+    // An unchanged frame sends nothing
+    if (send (f, 4096).first != 0) {
+        std::cout << "An unchanged frame was encoded\n";
+        --rtn;
+    }
+
+    // A change of colour sends only the colours, which are much smaller than the keyframe
+    quad.colours[0] = 0.5f;
+    {
+        ss::frame f2;
+        f2.add (1, quad);
+        f2.add (2, tri);
+        f2.view = f.view;
+        auto [bytes, ch2] = send (f2, 4096);
+        if (ch2.size() != 1 || ch2[0].type != ss::message::colours || ch2[0].id != 1 || bytes >= key_bytes / 2) {
+            std::cout << "Expected one colour update, got " << ch2.size() << " changes in " << bytes << " bytes\n";
+            --rtn;
+        }
+        if (dec.current.models[1].colours != quad.colours) { --rtn; }
+    }
+
+    // Changes of state and of mesh, and a model that leaves the scene
+    quad.hide = true;
+    quad.positions[0] = -1.0f;
+    {
+        ss::frame f3;
+        f3.add (1, quad);
+        f3.view = f.view;
+        auto [bytes, ch3] = send (f3, 3);
+        if (count (ch3, ss::message::geometry) != 1 || count (ch3, ss::message::state) != 1
+            || count (ch3, ss::message::remove) != 1 || count (ch3, ss::message::labels) != 0) {
+            std::cout << "Expected new geometry and state, and a removal\n";
+            --rtn;
+        }
+        if (dec.current.models.count (2) != 0 || !dec.current.models[1].hide || dec.current.models[1].positions[0] != -1.0f) { --rtn; }
+    }
+
+    // A malformed stream throws
+    {
+        ss::decoder bad;
+        const std::uint32_t h[4] = { 4, 2, 99, 0 };
+        bad.feed (reinterpret_cast<const char*>(h), sizeof (h));
+        bool threw = false;
+        try { bad.apply(); } catch (const std::runtime_error&) { threw = true; }
+        if (!threw) { --rtn; }
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    // Over a socket, a client that connects late still gets a keyframe
+    try {
+        ss::server srv (0);
+        ss::frame f4;
+        f4.add (1, quad);
+        f4.add (3, tri);
+        srv.publish (f4);
+        ss::client cl ("127.0.0.1", srv.port());
+        ss::scene got;
+        for (int i = 0; i < 100 && got.models.size() < 2; ++i) {
+            srv.publish (f4);
+            cl.poll (10);
+            got = cl.state();
+        }
+        if (srv.clients() != 1 || got.models.size() != 2 || got.models[3].indices != tri.indices) {
+            std::cout << "The client did not receive the scene over the socket\n";
+            --rtn;
+        }
+        // Only the colours follow
+        quad.colours[1] = 0.25f;
+        ss::frame f5;
+        f5.add (1, quad);
+        f5.add (3, tri);
+        srv.publish (f5);
+        std::vector<ss::change> ch5;
+        for (int i = 0; i < 100 && ch5.empty(); ++i) { ch5 = cl.poll (10); }
+        if (ch5.size() != 1 || ch5[0].type != ss::message::colours || cl.state().models.at (1).colours != quad.colours) {
+            std::cout << "Expected a colour update over the socket\n";
+            --rtn;
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Socket test failed: " << e.what() << std::endl;
+        --rtn;
+    }
+#endif
+
+    std::cout << "testscene_stream " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
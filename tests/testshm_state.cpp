@@ -0,0 +1,127 @@
+/*
+ * Test morph::shm_publisher and morph::shm_reader, in one process and then with a child
+ * process publishing frames as fast as it can while this one reads them.
+ */
+#include <morph/shm_state.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+extern "C" {
+#include <sys/wait.h>
+}
+
+int main()
+{
+    int rtn = 0;
+    const std::string name = "/morph_testshm_state_" + std::to_string (getpid());
+    constexpr std::size_t n = 10000;
+
+    // In one process
+    {
+        morph::shm_publisher pub (name);
+        pub.add_constant ("x", std::vector<float>{ 0.5f, 1.5f, 2.5f });
+        pub.add_field<double> ("u", n);
+        pub.add_field<std::int32_t> ("label", 2);
+        pub.metadata = "{\"d\": 0.01}";
+
+        morph::shm_reader rd (name);
+        if (rd.open()) { --rtn; } // not yet there
+        pub.open();
+        if (!rd.open()) { --rtn; }
+
+        const auto f = rd.fields();
+        if (f.size() != 3u || f[0].name != "x" || !f[0].constant || f[1].count != n || f[2].constant) { --rtn; }
+        if (rd.metadata() != "{\"d\": 0.01}") { --rtn; }
+        std::span<const float> x = rd.constant<float> ("x");
+        if (x.size() != 3u || x[2] != 2.5f) { --rtn; }
+
+        morph::shm_reader::frame fr;
+        if (rd.latest (fr)) { --rtn; } // nothing published yet
+
+        std::vector<double> u (n);
+        for (std::uint64_t k = 1; k <= 4; ++k) {
+            for (std::size_t i = 0; i < n; ++i) { u[i] = static_cast<double>(k * n + i); }
+            pub.set ("u", u);
+            pub.set ("label", std::vector<std::int32_t>{ static_cast<std::int32_t>(k), -1 });
+            pub.commit (10 * k, 0.5 * k);
+        }
+        if (pub.frames() != 4u) { --rtn; }
+        if (!rd.latest (fr) || fr.number != 4u || fr.step != 40u || fr.time != 2.0) { --rtn; }
+        std::span<const double> uv = rd.view<double> (fr, "u");
+        if (uv.size() != n || uv[7] != static_cast<double>(4 * n + 7) || rd.view<std::int32_t> (fr, "label")[0] != 4) { --rtn; }
+        if (!rd.valid (fr)) { --rtn; }
+        if (rd.latest (fr)) { --rtn; } // no newer frame
+
+        // The ring holds 3 frames, so frame 4 is overwritten by frame 7
+        for (std::uint64_t k = 5; k <= 7; ++k) {
+            pub.set ("label", std::vector<std::int32_t>{ static_cast<std::int32_t>(k), -1 });
+            pub.commit (10 * k);
+        }
+        if (rd.valid (fr)) { --rtn; }
+
+        // Type and size mismatches are errors
+        int errs = 0;
+        try { rd.view<float> (fr, "u"); } catch (const std::runtime_error&) { ++errs; }
+        try { rd.constant<float> ("u"); } catch (const std::runtime_error&) { ++errs; }
+        try { pub.set ("u", std::vector<double>(n - 1)); } catch (const std::runtime_error&) { ++errs; }
+        try { pub.set ("nothing", u); } catch (const std::runtime_error&) { ++errs; }
+        if (errs != 4) { --rtn; }
+
+        if (rd.closed()) { --rtn; }
+        pub.close();
+        if (!rd.closed()) { --rtn; }
+        // The mapping outlives the object
+        if (!rd.latest (fr) || fr.number != 7u || rd.view<std::int32_t> (fr, "label")[0] != 7) { --rtn; }
+    }
+
+    // Across processes. Every element of a frame that is still valid once read must be from
+    // that same frame.
+    constexpr std::uint64_t nframes = 20000;
+    pid_t child = fork();
+    if (child == 0) {
+        morph::shm_publisher pub (name);
+        pub.add_field<double> ("u", n);
+        pub.open();
+        std::vector<double> u (n);
+        for (std::uint64_t k = 1; k <= nframes; ++k) {
+            for (std::size_t i = 0; i < n; ++i) { u[i] = static_cast<double>(k); }
+            pub.set ("u", u);
+            pub.commit (k);
+        }
+        pub.unlink_on_close = false; // leave it for the parent to read the end
+        pub.close();
+        _exit (0);
+    }
+
+    morph::shm_reader rd (name);
+    while (!rd.open()) { usleep (100); }
+    morph::shm_reader::frame fr;
+    std::vector<double> u;
+    unsigned int seen = 0;
+    unsigned int torn = 0;
+    std::uint64_t last = 0;
+    for (;;) {
+        const bool done = rd.closed();
+        if (rd.latest (fr)) {
+            if (fr.number < last) { --rtn; }
+            last = fr.number;
+            if (rd.copy (fr, "u", u)) {
+                ++seen;
+                for (const double v : u) { if (v != static_cast<double>(fr.number)) { --rtn; break; } }
+            } else {
+                ++torn;
+            }
+        }
+        if (done && last == nframes) { break; }
+        if (done && !rd.latest (fr) && fr.number != nframes) { --rtn; break; }
+    }
+    int status = 0;
+    waitpid (child, &status, 0);
+    shm_unlink (name.c_str());
+    std::cout << "Read " << seen << " frames intact (and saw " << torn << " overwritten while copying)" << std::endl;
+    if (seen == 0 || last != nframes) { --rtn; }
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,130 @@
+// Test morph::sim_runner and morph::triple_buffer: snapshots are whole, in order, published as
+// often as asked, and the backpressure policies behave.
+
+#include <morph/sim_runner.h>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <cstdint>
+
+// A 'simulation' whose state is a vector in which every element holds the step count
+struct counter
+{
+    std::vector<std::uint64_t> u = std::vector<std::uint64_t>(10000, 0);
+    std::uint64_t n = 0;
+    void step() { ++this->n; for (auto& x : this->u) { x = this->n; } }
+};
+
+using snap_t = std::vector<std::uint64_t>;
+
+// Consume snapshots until the run ends, checking each. Returns the number of snapshots seen, or -1 on error.
+int consume (morph::sim_runner<snap_t>& r, const unsigned int every, const bool expect_all, const unsigned int sleep_us = 0)
+{
+    int seen = 0;
+    std::uint64_t last = 0;
+    bool first = true;
+    for (;;) {
+        const bool done = !r.running();
+        while (const snap_t* s = r.latest()) {
+            const std::uint64_t step = r.current_step();
+            for (auto x : *s) { if (x != step) { std::cerr << "Torn snapshot at step " << step << "\n"; return -1; } }
+            if (!first && step <= last) { std::cerr << "Snapshot " << step << " after " << last << "\n"; return -1; }
+            if (step % every != 0 && step != r.steps()) { std::cerr << "Snapshot at step " << step << " with publish_every " << every << "\n"; return -1; }
+            if (expect_all && !first && step != last + every && step != r.steps()) {
+                std::cerr << "Missed snapshots between " << last << " and " << step << "\n"; return -1;
+            }
+            first = false;
+            last = step;
+            ++seen;
+            if (sleep_us > 0) { std::this_thread::sleep_for (std::chrono::microseconds (sleep_us)); }
+        }
+        if (done) { break; }
+        std::this_thread::yield();
+    }
+    if (last != r.steps()) { std::cerr << "The final snapshot (" << last << ") isn't the final state (" << r.steps() << ")\n"; return -1; }
+    return seen;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // triple_buffer on one thread
+    morph::triple_buffer<int> tb;
+    if (tb.acquire() || tb.pending()) { std::cerr << "Empty triple_buffer has something\n"; --rtn; }
+    tb.back() = 1;
+    tb.publish();
+    tb.back() = 2;
+    tb.publish(); // replaces 1
+    if (!tb.pending() || !tb.acquire() || tb.front() != 2 || tb.acquire()) { std::cerr << "triple_buffer swap failed\n"; --rtn; }
+
+    for (auto bp : { morph::sim_backpressure::overwrite, morph::sim_backpressure::skip, morph::sim_backpressure::block }) {
+        for (unsigned int every : { 1u, 7u }) {
+            counter c;
+            morph::sim_runner<snap_t> r;
+            r.publish_every = every;
+            r.backpressure = bp;
+            r.max_steps = 3000;
+            r.start ([&c]() { c.step(); return true; }, [&c](snap_t& s) { s = c.u; });
+            // With block, the consumer sees every snapshot, however slowly it takes them
+            const bool block = bp == morph::sim_backpressure::block;
+            const int seen = consume (r, every, block, block ? 20 : 0);
+            r.stop();
+            std::cout << "backpressure " << static_cast<int>(bp) << ", publish_every " << every << ": "
+                      << seen << " snapshots of " << r.published() << " published\n";
+            if (seen < 1 || r.steps() != 3000) { --rtn; }
+            if (block && static_cast<std::uint64_t>(seen) != r.published()) { std::cerr << "Block lost snapshots\n"; --rtn; }
+        }
+    }
+
+    // publish_interval limits the rate
+    {
+        counter c;
+        morph::sim_runner<snap_t> r;
+        r.publish_interval = 0.01;
+        r.start ([&c]() { c.step(); std::this_thread::sleep_for (std::chrono::microseconds (100)); return c.n < 2000; },
+                 [&c](snap_t& s) { s = c.u; });
+        consume (r, 1, false);
+        r.stop();
+        // 2000 steps of at least 0.1 ms take at least 0.2 s, so about 20 snapshots, and not 2000
+        std::cout << "publish_interval 0.01 s: " << r.published() << " snapshots in " << r.steps() << " steps\n";
+        if (r.published() > 200 || r.published() < 3) { --rtn; }
+    }
+
+    // pause, and a stop of a run without end
+    {
+        counter c;
+        morph::sim_runner<snap_t> r;
+        r.start ([&c]() { c.step(); return true; }, [&c](snap_t& s) { s = c.u; });
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        r.pause();
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        const std::uint64_t n1 = r.steps();
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        if (r.steps() != n1) { std::cerr << "Paused simulation is still stepping\n"; --rtn; }
+        while (r.latest()) {}
+        if (r.current_step() != n1) { std::cerr << "The paused state wasn't published\n"; --rtn; }
+        r.pause (false);
+        std::this_thread::sleep_for (std::chrono::milliseconds (5));
+        r.stop();
+        if (r.steps() <= n1 || r.running()) { std::cerr << "Resume or stop failed\n"; --rtn; }
+    }
+
+    // An exception in the simulation reaches the renderer
+    {
+        morph::sim_runner<int> r;
+        int n = 0;
+        r.start ([&n]() { if (++n == 100) { throw std::runtime_error ("step 100"); } return true; }, [&n](int& s) { s = n; });
+        bool caught = false;
+        try {
+            while (true) { r.latest(); std::this_thread::yield(); }
+        } catch (const std::runtime_error&) { caught = true; }
+        if (!caught) { --rtn; }
+        try { r.stop(); --rtn; } catch (const std::runtime_error&) {}
+    }
+
+    std::cout << "testsim_runner " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
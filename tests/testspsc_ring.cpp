@@ -0,0 +1,68 @@
+// Test morph::spsc_ring: everything pushed by one thread is popped, in order, by another, and the
+// ring reports full and empty correctly.
+
+#include <morph/spsc_ring.h>
+#include <vector>
+#include <array>
+#include <thread>
+#include <iostream>
+#include <cstdint>
+
+int main()
+{
+    int rtn = 0;
+
+    // One thread
+    morph::spsc_ring<int> r (5);
+    if (r.capacity() != 8 || !r.empty()) { std::cerr << "Bad new ring\n"; --rtn; }
+    for (int i = 0; i < 8; ++i) { if (!r.push (i)) { std::cerr << "push failed before full\n"; --rtn; } }
+    if (r.push (8) || r.size() != 8) { std::cerr << "push succeeded on a full ring\n"; --rtn; }
+    int x = -1;
+    if (!r.pop (x) || x != 0) { std::cerr << "pop gave " << x << "\n"; --rtn; }
+    std::array<int, 4> more = { 8, 9, 10, 11 };
+    if (r.push (std::span<const int>(more)) != 1) { std::cerr << "span push overfilled\n"; --rtn; }
+    std::vector<int> out;
+    if (r.pop_all (out) != 8 || out.front() != 1 || out.back() != 8 || !r.empty() || r.pop (x)) {
+        std::cerr << "pop_all failed\n"; --rtn;
+    }
+
+    // Two threads, single pushes and spans, with a consumer that mixes pop and pop_all
+    constexpr std::uint64_t n = 200000;
+    morph::spsc_ring<std::uint64_t> q (1024);
+    std::thread producer ([&q]() {
+        std::uint64_t i = 0;
+        std::array<std::uint64_t, 16> chunk;
+        while (i < n) {
+            if (i % 3 == 0 && n - i >= chunk.size()) {
+                for (std::size_t j = 0; j < chunk.size(); ++j) { chunk[j] = i + j; }
+                std::size_t pushed = 0;
+                while (pushed < chunk.size()) {
+                    pushed += q.push (std::span<const std::uint64_t>(chunk).subspan (pushed));
+                }
+                i += chunk.size();
+            } else if (q.push (i)) {
+                ++i;
+            }
+        }
+    });
+    std::uint64_t expect = 0;
+    std::vector<std::uint64_t> got;
+    while (expect < n) {
+        got.clear();
+        std::uint64_t v = 0;
+        if (expect % 2 == 0) {
+            if (q.pop (v)) { got.push_back (v); }
+        } else {
+            q.pop_all (got);
+        }
+        for (auto g : got) {
+            if (g != expect) { std::cerr << "Got " << g << ", expected " << expect << "\n"; --rtn; expect = n; break; }
+            ++expect;
+        }
+    }
+    producer.join();
+    if (!q.empty()) { std::cerr << "Ring not empty at the end\n"; --rtn; }
+
+    std::cout << "testspsc_ring " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
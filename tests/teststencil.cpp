@@ -0,0 +1,168 @@
+/*
+ * Test morph::apply_stencil and apply_stencil_fused on Grid (every order and wrapping),
+ * Gridct, CartGrid and HexGrid, against straightforward per-element references.
+ */
+#include "morph/stencil.h"
+#include "morph/Grid.h"
+#include "morph/Gridct.h"
+#include "morph/CartGrid.h"
+#include "morph/HexGrid.h"
+#include "morph/Random.h"
+#include <iostream>
+#include <vector>
+#include <array>
+#include <cmath>
+
+// A stencil that reaches two elements away, and is not symmetric
+constexpr morph::stencil<float, 6> lopsided = { { { { 0, 0, 1.0f }, { 2, 0, 0.5f }, { -1, 0, -0.25f },
+                                                    { 0, 2, 2.0f }, { 1, -1, 0.125f }, { -2, -2, -1.0f } } } };
+
+// Wrap or reflect x into [0, len) as the stencil engine does
+long long fold (long long x, const long long len, const bool wrap)
+{
+    if (x >= 0 && x < len) { return x; }
+    if (wrap) { return ((x % len) + len) % len; }
+    x = x < 0 ? -1 - x : 2 * len - 1 - x;
+    return std::clamp (x, 0LL, len - 1);
+}
+
+// A reference for a rectangular Grid, working from each element's coordinates
+template <auto S>
+std::vector<float> reference (const morph::Grid<unsigned int, float>& g, const std::vector<float>& f)
+{
+    const morph::vec<float, 2> dx = g.get_dx();
+    const float ymin = g.ymin();
+    const auto wr = g.get_wrap();
+    const bool wh = wr == morph::GridDomainWrap::Horizontal || wr == morph::GridDomainWrap::Both;
+    const bool wv = wr == morph::GridDomainWrap::Vertical || wr == morph::GridDomainWrap::Both;
+    std::vector<float> out (g.n(), 0.0f);
+    for (unsigned int i = 0; i < g.n(); ++i) {
+        const long long c = std::lround ((g[i][0] - g.get_offset()[0]) / dx[0]);
+        const long long r = std::lround ((g[i][1] - ymin) / dx[1]); // counting northwards
+        for (auto t : S.taps) {
+            const long long cn = fold (c + t.dc, g.get_w(), wh);
+            const long long rn = fold (r + t.dr, g.get_h(), wv);
+            morph::vec<float, 2> p = { g.get_offset()[0] + dx[0] * cn, ymin + dx[1] * rn };
+            out[i] += t.weight * f[g.index_lookup (p)];
+        }
+    }
+    return out;
+}
+
+float maxdiff (const std::vector<float>& a, const std::vector<float>& b)
+{
+    float m = 0.0f;
+    for (std::size_t i = 0; i < a.size(); ++i) { m = std::max (m, std::abs (a[i] - b[i])); }
+    return a.size() == b.size() ? m : 1e9f;
+}
+
+int main()
+{
+    int rtn = 0;
+    morph::RandUniform<float> rng (-1.0f, 1.0f, 42);
+
+    const morph::GridOrder orders[] = { morph::GridOrder::bottomleft_to_topright, morph::GridOrder::topleft_to_bottomright,
+                                        morph::GridOrder::bottomleft_to_topright_colmaj, morph::GridOrder::topleft_to_bottomright_colmaj };
+    const morph::GridDomainWrap wraps[] = { morph::GridDomainWrap::None, morph::GridDomainWrap::Horizontal,
+                                            morph::GridDomainWrap::Vertical, morph::GridDomainWrap::Both };
+
+    // Grid: wide enough for several tiles along a row, and a few tiles high
+    for (auto o : orders) {
+        for (auto wr : wraps) {
+            morph::Grid<unsigned int, float> g (1100, 70, { 0.1f, 0.1f }, { 0.0f, 0.0f }, wr, o);
+            std::vector<float> f = rng.get (g.n());
+            std::vector<float> out;
+            morph::apply_stencil<morph::stencils::laplace5<float>> (g, f, out);
+            float e5 = maxdiff (out, reference<morph::stencils::laplace5<float>> (g, f));
+            morph::apply_stencil<morph::stencils::laplace9<float>> (g, f, out);
+            float e9 = maxdiff (out, reference<morph::stencils::laplace9<float>> (g, f));
+            morph::apply_stencil<lopsided> (g, f, out);
+            float el = maxdiff (out, reference<lopsided> (g, f));
+            if (e5 > 1e-5f || e9 > 1e-5f || el > 1e-5f) {
+                std::cerr << "Grid order " << int(o) << " wrap " << int(wr) << ": errors " << e5 << ", " << e9 << ", " << el << "\n";
+                --rtn;
+            }
+        }
+    }
+
+    // A grid smaller than the stencil in one direction
+    {
+        morph::Grid<unsigned int, float> g (1, 9);
+        std::vector<float> f = rng.get (g.n());
+        std::vector<float> out;
+        morph::apply_stencil<lopsided> (g, f, out);
+        if (maxdiff (out, reference<lopsided> (g, f)) > 1e-5f) { std::cerr << "1 x 9 Grid fails\n"; --rtn; }
+    }
+
+    // Gridct gives the same as the equivalent Grid
+    {
+        using gct_t = morph::Gridct<unsigned int, float, 50, 30, morph::vec<float, 2>{ 0.1f, 0.1f },
+                                    morph::vec<float, 2>{ 0.0f, 0.0f }, true, morph::GridDomainWrap::Horizontal>;
+        gct_t gct;
+        morph::Grid<unsigned int, float> g (50, 30, { 0.1f, 0.1f }, { 0.0f, 0.0f }, morph::GridDomainWrap::Horizontal);
+        std::vector<float> f = rng.get (g.n());
+        std::vector<float> out;
+        morph::apply_stencil<lopsided> (gct, f, out);
+        if (maxdiff (out, reference<lopsided> (g, f)) > 1e-5f) { std::cerr << "Gridct fails\n"; --rtn; }
+    }
+
+    // A rectangular CartGrid is bottom-left to top-right, row major
+    {
+        morph::CartGrid cg (0.1f, 0.1f, 0.0f, 0.0f, 4.0f, 2.0f);
+        cg.setBoundaryOnOuterEdge();
+        morph::Grid<unsigned int, float> g (cg.w_px, cg.h_px, { 0.1f, 0.1f });
+        std::vector<float> f = rng.get (cg.num());
+        std::vector<float> out;
+        morph::apply_stencil<morph::stencils::laplace9<float>> (cg, f, out);
+        if (maxdiff (out, reference<morph::stencils::laplace9<float>> (g, f)) > 1e-5f) { std::cerr << "CartGrid fails\n"; --rtn; }
+    }
+
+    // HexGrid matches RD_Base's ghost stencil Laplacian
+    {
+        morph::HexGrid hg (0.01f, 3.0f, 0.0f);
+        hg.setEllipticalBoundary (0.45f, 0.3f);
+        const unsigned int n = hg.num();
+        std::vector<float> A = rng.get (n);
+        std::vector<float> B = rng.get (n);
+        auto ghost = [&hg](const std::vector<int>& nb, unsigned int h) { return nb[h] < 0 ? static_cast<int>(h) : nb[h]; };
+        std::vector<float> lapA (n), lapB (n);
+        for (unsigned int h = 0; h < n; ++h) {
+            float sa = -6.0f * A[h];
+            float sb = -6.0f * B[h];
+            for (auto nbv : { &hg.d_ne, &hg.d_nne, &hg.d_nnw, &hg.d_nw, &hg.d_nsw, &hg.d_nse }) {
+                sa += A[ghost (*nbv, h)];
+                sb += B[ghost (*nbv, h)];
+            }
+            lapA[h] = sa;
+            lapB[h] = sb;
+        }
+        std::vector<float> out;
+        morph::apply_stencil<morph::stencils::hex_laplace<float>> (hg, A, out);
+        if (maxdiff (out, lapA) > 1e-5f) { std::cerr << "HexGrid Laplacian fails\n"; --rtn; }
+
+        // A fused, two field update in one pass
+        std::vector<float> dA (n), dB (n);
+        morph::apply_stencil_fused<morph::stencils::hex_laplace<float>> (hg, [&](std::size_t h, const std::array<float, 2>& s) {
+            dA[h] = 0.5f * s[0] - A[h] * B[h];
+            dB[h] = 2.0f * s[1] + A[h] * B[h];
+        }, A, B);
+        float e = 0.0f;
+        for (unsigned int h = 0; h < n; ++h) {
+            e = std::max (e, std::abs (dA[h] - (0.5f * lapA[h] - A[h] * B[h])));
+            e = std::max (e, std::abs (dB[h] - (2.0f * lapB[h] + A[h] * B[h])));
+        }
+        if (e > 1e-5f) { std::cerr << "Fused HexGrid update fails\n"; --rtn; }
+    }
+
+    // Mismatched field sizes are an error
+    try {
+        morph::Grid<unsigned int, float> g (10, 10);
+        std::vector<float> f (99, 0.0f), out;
+        morph::apply_stencil<morph::stencils::laplace5<float>> (g, f, out);
+        std::cerr << "Expected an exception for a wrongly sized field\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
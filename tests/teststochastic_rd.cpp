@@ -0,0 +1,160 @@
+/*
+ * Test morph::stochastic_rd: the stationary (Poisson) distribution of a birth-death process
+ * with diffusion, at high copy numbers (tau-leaping) and at low (the exact algorithm), the
+ * spread of diffusing molecules, conservation, results that do not depend on the number of
+ * threads, and the speed of leaping compared with simulating every event.
+ */
+#include "morph/stochastic_rd.h"
+#include "morph/HexGrid.h"
+#include "morph/Grid.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+using srd_t = morph::stochastic_rd<double>;
+
+// The mean and variance over all hexes of counts, accumulated over samples
+struct moments
+{
+    double s = 0.0, s2 = 0.0;
+    unsigned long long n = 0;
+    void add (const std::vector<std::uint32_t>& c) { for (std::uint32_t x : c) { s += x; s2 += double(x) * x; ++n; } }
+    double mean() const { return s / n; }
+    double var() const { return s2 / n - mean() * mean(); }
+};
+
+// Run 0 -> A (rate k per hex), A -> 0 (rate g per molecule) to stationarity and sample A
+moments birth_death (const morph::HexGrid& hg, const double k, const double g, const double tau,
+                     const double ssa_threshold, unsigned long long& leaped, unsigned long long& exact)
+{
+    srd_t srd (hg, 7);
+    srd.ssa_threshold = ssa_threshold;
+    const unsigned int A = srd.add_species (0.001, static_cast<std::uint32_t>(k / g));
+    srd.add_reaction (k, {}, { A });
+    srd.add_reaction (g, { A }, {});
+    for (int i = 0; i < 100; ++i) { srd.step (tau); }
+    moments m;
+    for (int i = 0; i < 400; ++i) {
+        srd.step (tau);
+        if (i % 20 == 0) { m.add (srd.counts[A]); }
+    }
+    leaped = srd.leaped;
+    exact = srd.exact;
+    return m;
+}
+
+int main()
+{
+    int rtn = 0;
+    using sc = std::chrono::steady_clock;
+
+    morph::HexGrid hg (0.02f, 1.0f, 0.0f);
+    hg.setCircularBoundary (0.3f);
+    std::cout << hg.num() << " hexes\n";
+
+    // Birth-death with diffusion is stationary at a Poisson distribution of mean k / g in each
+    // hex. Its Fano factor (variance / mean) is 1; a deterministic model would give 0.
+    {
+        unsigned long long leaped = 0, exact = 0;
+        moments hi = birth_death (hg, 400.0, 1.0, 0.05, 10.0, leaped, exact);
+        std::cout << "High copy number: mean " << hi.mean() << " Fano factor " << hi.var() / hi.mean()
+                  << " (" << leaped << " leaps, " << exact << " exact)\n";
+        if (std::abs (hi.mean() - 400.0) > 2.0 || std::abs (hi.var() / hi.mean() - 1.0) > 0.06 || exact > 0) { --rtn; }
+
+        moments lo = birth_death (hg, 2.0, 1.0, 0.05, 10.0, leaped, exact);
+        std::cout << "Low copy number: mean " << lo.mean() << " Fano factor " << lo.var() / lo.mean()
+                  << " (" << leaped << " leaps, " << exact << " exact)\n";
+        if (std::abs (lo.mean() - 2.0) > 0.05 || std::abs (lo.var() / lo.mean() - 1.0) > 0.06 || leaped > 0) { --rtn; }
+    }
+
+    // Diffusion from a point: the mean squared displacement grows as 4 D t, and no molecule
+    // is lost or made
+    {
+        morph::HexGrid big (0.02f, 3.0f, 0.0f);
+        big.setCircularBoundary (1.0f);
+        srd_t srd (big, 3);
+        const double D = 0.001;
+        const unsigned int A = srd.add_species (D);
+        unsigned int centre = 0;
+        for (unsigned int i = 0; i < big.num(); ++i) {
+            if (big.d_x[i] * big.d_x[i] + big.d_y[i] * big.d_y[i] < big.d_x[centre] * big.d_x[centre] + big.d_y[centre] * big.d_y[centre]) { centre = i; }
+        }
+        srd.counts[A][centre] = 200000;
+        const double tau = srd.suggest_tau();
+        const double T = 10.0;
+        const int nsteps = static_cast<int>(std::round (T / tau));
+        for (int i = 0; i < nsteps; ++i) { srd.step (tau); }
+        double msd = 0.0;
+        for (unsigned int i = 0; i < big.num(); ++i) {
+            const double dx = big.d_x[i] - big.d_x[centre];
+            const double dy = big.d_y[i] - big.d_y[centre];
+            msd += srd.counts[A][i] * (dx * dx + dy * dy);
+        }
+        msd /= 200000.0;
+        std::cout << "MSD " << msd << " (4 D t = " << 4.0 * D * srd.t << ") after " << nsteps << " steps of " << tau << "\n";
+        if (std::abs (msd / (4.0 * D * srd.t) - 1.0) > 0.03) { --rtn; }
+        if (srd.total (A) != 200000u) {
+            std::cout << "Molecules were not conserved: " << srd.total (A) << "\n";
+            --rtn;
+        }
+    }
+
+    // A reversible dimerisation 2A <-> B, which conserves A + 2B, on a wrapped Grid. The
+    // results are the same for any number of threads.
+    {
+        morph::Grid<unsigned int, float> g (40, 30, { 0.05f, 0.05f }, { 0.0f, 0.0f }, morph::GridDomainWrap::Both);
+        auto run = [&g]() {
+            srd_t srd (g, 11);
+            const unsigned int A = srd.add_species (0.01, 30);
+            const unsigned int B = srd.add_species (0.002, 0);
+            srd.add_reaction (0.01, { A, A }, { B });
+            srd.add_reaction (0.1, { B }, { A, A });
+            if (std::abs (srd.propensity (0, 0) - 0.01 * 30.0 * 29.0 / 2.0) > 1e-12) { std::cout << "Wrong 2A propensity\n"; }
+            for (int i = 0; i < 200; ++i) { srd.step (0.02); }
+            return srd;
+        };
+#ifdef _OPENMP
+        const int nt = omp_get_max_threads();
+        omp_set_num_threads (1);
+#endif
+        srd_t s1 = run();
+#ifdef _OPENMP
+        omp_set_num_threads (4);
+#endif
+        srd_t s4 = run();
+#ifdef _OPENMP
+        omp_set_num_threads (nt);
+#endif
+        if (s1.counts != s4.counts) {
+            std::cout << "The results depend on the number of threads\n";
+            --rtn;
+        }
+        if (s1.total (0) + 2 * s1.total (1) != 30u * g.n()) {
+            std::cout << "A + 2B was not conserved\n";
+            --rtn;
+        }
+        if (s1.propensity (0, 0) > 0.0 && s1.total (1) == 0) { --rtn; }
+    }
+
+    // Leaping against the exact algorithm at high copy numbers
+    {
+        unsigned long long leaped = 0, exact = 0;
+        sc::time_point t0 = sc::now();
+        moments ml = birth_death (hg, 400.0, 1.0, 0.05, 10.0, leaped, exact);
+        sc::time_point t1 = sc::now();
+        moments me = birth_death (hg, 400.0, 1.0, 0.05, 1e30, leaped, exact);
+        sc::time_point t2 = sc::now();
+        const double tl = std::chrono::duration<double> (t1 - t0).count();
+        const double te = std::chrono::duration<double> (t2 - t1).count();
+        std::cout << "Tau-leaping " << tl << " s, exact " << te << " s (" << te / tl << "x); means "
+                  << ml.mean() << " and " << me.mean() << "\n";
+        if (std::abs (me.mean() - 400.0) > 2.0 || std::abs (me.var() / me.mean() - 1.0) > 0.06) { --rtn; }
+    }
+
+    std::cout << "teststochastic_rd " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
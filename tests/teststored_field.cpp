@@ -0,0 +1,120 @@
+/*
+ * Test morph::bfloat16, morph::float16 and morph::stored_field: exact round trips of the
+ * representable values, rounding to nearest with ties to even (checked against a reference
+ * made with the float arithmetic), the special values, and the error monitoring of writes.
+ */
+#include <morph/stored_field.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+
+// The reference: the nearest of the representable values, ties to the one with an even bit pattern
+template <typename H>
+std::uint16_t nearest (const float f, const std::vector<float>& pos)
+{
+    const float a = std::abs (f);
+    std::size_t lo = 0, hi = pos.size() - 1;
+    while (hi - lo > 1) { std::size_t m = (lo + hi) / 2; if (pos[m] <= a) { lo = m; } else { hi = m; } }
+    std::uint16_t b = 0;
+    if (a >= pos.back()) {
+        b = static_cast<std::uint16_t>(pos.size() - 1);
+    } else {
+        const double dl = static_cast<double>(a) - pos[lo];
+        const double dh = static_cast<double>(pos[hi]) - a;
+        b = static_cast<std::uint16_t>(dl < dh ? lo : dh < dl ? hi : (lo % 2 == 0 ? lo : hi));
+    }
+    return static_cast<std::uint16_t>(b | (std::signbit (f) ? 0x8000 : 0));
+}
+
+int main()
+{
+    int rtn = 0;
+
+    // Every finite non-negative value, in order of bit pattern (which is also the order of value)
+    std::vector<float> bpos, hpos;
+    for (std::uint32_t b = 0; b < 0x7f80; ++b) { morph::bfloat16 x; x.bits = static_cast<std::uint16_t>(b); bpos.push_back (static_cast<float>(x)); }
+    for (std::uint32_t b = 0; b < 0x7c00; ++b) { morph::float16 x; x.bits = static_cast<std::uint16_t>(b); hpos.push_back (static_cast<float>(x)); }
+    for (std::size_t i = 1; i < bpos.size(); ++i) { if (!(bpos[i] > bpos[i - 1])) { std::cerr << "bfloat16 not increasing at " << i << "\n"; --rtn; break; } }
+    for (std::size_t i = 1; i < hpos.size(); ++i) { if (!(hpos[i] > hpos[i - 1])) { std::cerr << "float16 not increasing at " << i << "\n"; --rtn; break; } }
+    if (hpos.back() != morph::float16::max() || hpos[1] != std::ldexp (1.0f, -24) || hpos[0x400] != std::ldexp (1.0f, -14)) {
+        std::cerr << "float16 values wrong\n"; --rtn;
+    }
+
+    // Round trips of every pattern, both signs
+    for (std::uint32_t b = 0; b < 0x10000; ++b) {
+        morph::bfloat16 x; x.bits = static_cast<std::uint16_t>(b);
+        morph::float16 y; y.bits = static_cast<std::uint16_t>(b);
+        const float fx = static_cast<float>(x);
+        const float fy = static_cast<float>(y);
+        if (!std::isnan (fx) && morph::bfloat16 (fx).bits != b) { std::cerr << "bfloat16 round trip " << b << "\n"; --rtn; break; }
+        if (!std::isnan (fy) && morph::float16 (fy).bits != b) { std::cerr << "float16 round trip " << b << "\n"; --rtn; break; }
+        if (std::isnan (fx) != ((b & 0x7fff) > 0x7f80) || std::isnan (fy) != ((b & 0x7fff) > 0x7c00)) { std::cerr << "NaN patterns " << b << "\n"; --rtn; break; }
+    }
+
+    // Rounding: the midpoints between neighbours (exact ties) and points either side of them
+    auto check_rounding = [&rtn](const std::vector<float>& pos, auto conv, const char* name, const float maxfinite) {
+        for (std::size_t i = 0; i + 1 < pos.size(); ++i) {
+            const float mid = static_cast<float>((static_cast<double>(pos[i]) + pos[i + 1]) / 2.0);
+            for (const float f : { mid, std::nextafter (mid, 0.0f), std::nextafter (mid, 1e30f), -mid }) {
+                if (std::abs (f) > maxfinite) { continue; }
+                const std::uint16_t got = conv (f);
+                const std::uint16_t want = nearest<void> (f, pos);
+                if (got != want) { std::cerr << name << " rounds " << f << " to " << got << ", not " << want << "\n"; --rtn; return; }
+            }
+        }
+    };
+    check_rounding (bpos, [](float f) { return morph::bfloat16 (f).bits; }, "bfloat16", bpos.back());
+    check_rounding (hpos, [](float f) { return morph::float16 (f).bits; }, "float16", hpos.back());
+
+    // Specials
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    if (static_cast<float>(morph::float16 (70000.0f)) != inf || static_cast<float>(morph::float16 (-inf)) != -inf) { std::cerr << "float16 overflow\n"; --rtn; }
+    if (static_cast<float>(morph::float16 (65519.0f)) != 65504.0f || static_cast<float>(morph::float16 (65520.0f)) != inf) { std::cerr << "float16 rounding at max\n"; --rtn; }
+    if (!std::isnan (static_cast<float>(morph::float16 (nan))) || !std::isnan (static_cast<float>(morph::bfloat16 (nan)))) { std::cerr << "NaN lost\n"; --rtn; }
+    if (static_cast<float>(morph::bfloat16 (inf)) != inf || std::abs (static_cast<float>(morph::bfloat16 (3e38f)) - 3e38f) > 3e38f / 256.0f) { std::cerr << "bfloat16 range\n"; --rtn; }
+    if (static_cast<float>(morph::float16 (1e-9f)) != 0.0f || !std::signbit (static_cast<float>(morph::float16 (-1e-9f)))) { std::cerr << "float16 underflow\n"; --rtn; }
+
+    // stored_field: the errors of a write are measured, and are within the rounding bounds
+    const std::size_t n = 10000;
+    std::vector<float> v (n);
+    for (std::size_t i = 0; i < n; ++i) { v[i] = 0.001f + std::sin (static_cast<float>(i)) * 10.0f; }
+    morph::stored_field<morph::bfloat16> fb (n);
+    morph::stored_field<morph::float16> fh (n);
+    morph::stored_field<float, double> fd (n);
+    fb.store (v);
+    fh.store (v);
+    std::cout << "bfloat16 error: max abs " << fb.last_error.max_abs << ", max rel " << fb.last_error.max_rel << ", rms " << fb.last_error.rms << "\n";
+    std::cout << "float16 error: max abs " << fh.last_error.max_abs << ", max rel " << fh.last_error.max_rel << ", rms " << fh.last_error.rms << "\n";
+    if (!(fb.last_error.max_rel > 0.0f) || fb.last_error.max_rel > std::ldexp (1.0f, -8)) { std::cerr << "bfloat16 relative error out of bounds\n"; --rtn; }
+    if (!(fh.last_error.max_rel > 0.0f) || fh.last_error.max_rel > std::ldexp (1.0f, -11)) { std::cerr << "float16 relative error out of bounds\n"; --rtn; }
+    if (!(fb.last_error.rms < fb.last_error.max_abs) || !(fh.last_error.max_abs < fb.last_error.max_abs)) { std::cerr << "error statistics inconsistent\n"; --rtn; }
+    const std::vector<float> back = fb.load();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (std::abs (back[i] - v[i]) > fb.last_error.max_abs || back[i] != fb[i]) { std::cerr << "load disagrees with the error\n"; --rtn; break; }
+    }
+
+    // update() works in Flt, and a write of exactly representable values has no error
+    fb.update ([](std::size_t i, float) { return static_cast<float>(i % 256); });
+    if (fb.last_error.max_abs != 0.0f || fb.worst_error.max_abs == 0.0f || fb[255] != 255.0f) { std::cerr << "update error\n"; --rtn; }
+    // With 8 significant bits, 3.5 is exact and 255.5 is a tie that rounds to 256
+    fb.update ([](std::size_t, float x) { return x + 0.5f; });
+    if (fb[3] != 3.5f || fb[255] != 256.0f || fb.last_error.max_abs != 0.5f) { std::cerr << "update rounding " << fb[3] << " " << fb.last_error.max_abs << "\n"; --rtn; }
+    // An increment below half the resolution is lost, and counted
+    fb.update ([](std::size_t, float x) { return x + 0.001f; });
+    if (fb.last_error.stalled != n || fb.worst_error.stalled != n) { std::cerr << "stalled " << fb.last_error.stalled << "\n"; --rtn; }
+    fb.reset_error();
+    if (fb.worst_error.max_abs != 0.0f || fb.worst_error.stalled != 0) { std::cerr << "reset_error\n"; --rtn; }
+
+    // Doubles stored as float
+    std::vector<double> vd (n);
+    for (std::size_t i = 0; i < n; ++i) { vd[i] = 1.0 + 1e-9 * static_cast<double>(i); }
+    fd.store (vd);
+    if (fd.last_error.max_rel > std::ldexp (1.0, -24) || fd.get (n - 1) != static_cast<double>(static_cast<float>(vd[n - 1]))) { std::cerr << "float storage of double\n"; --rtn; }
+    if (fb.bytes() < n * 2 || fb.bytes() >= n * 4) { std::cerr << "bytes\n"; --rtn; }
+
+    std::cout << "teststored_field " << (rtn ? "failed" : "passed") << std::endl;
+    return rtn;
+}
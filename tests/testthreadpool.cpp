@@ -0,0 +1,96 @@
+// Test morph::threadpool, its task groups and parallel_for, and the routing of morph::parallel_for
+#define MORPH_THREADPOOL 1
+#include <atomic>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <morph/threadpool.h>
+
+int main()
+{
+    int rtn = 0;
+
+    {
+        morph::threadpool p (3);
+        if (p.size() != 3u) { --rtn; }
+
+        // Every index is visited exactly once, whatever the grain
+        for (std::size_t grain : { std::size_t{0}, std::size_t{1}, std::size_t{7}, std::size_t{5000} }) {
+            std::vector<int> hits (1000, 0);
+            p.parallel_for (0, 1000, [&hits](int i) { ++hits[i]; }, grain);
+            if (std::count (hits.begin(), hits.end(), 1) != 1000) {
+                std::cout << "parallel_for with grain " << grain << " missed or repeated an index\n";
+                --rtn;
+            }
+        }
+        // An empty range makes no calls
+        std::atomic<int> calls = 0;
+        p.parallel_for (5u, 5u, [&calls](unsigned int) { ++calls; });
+        if (calls != 0) { --rtn; }
+
+        // Nested loops, inside tasks, on a pool smaller than the number of tasks
+        std::atomic<long long> sum = 0;
+        {
+            morph::task_group g (p);
+            for (int t = 0; t < 16; ++t) {
+                g.run ([&p, &sum] {
+                    p.parallel_for (0, 100, [&p, &sum](int i) {
+                        p.parallel_for (0, 10, [&sum, i](int j) { sum += i * 10 + j; }, 2);
+                    }, 3);
+                });
+            }
+            g.wait();
+        }
+        if (sum != 16LL * 999 * 1000 / 2) {
+            std::cout << "nested sum " << sum << " != " << 16LL * 999 * 1000 / 2 << "\n";
+            --rtn;
+        }
+
+        // The first exception thrown in a loop gets back to the caller, and the pool carries on
+        bool caught = false;
+        try {
+            p.parallel_for (0, 100, [](int i) { if (i == 42) { throw std::runtime_error ("expected test exception"); } }, 1);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        if (!caught) {
+            std::cout << "the exception was not rethrown\n";
+            --rtn;
+        }
+        morph::task_group g (p);
+        std::atomic<int> count = 0;
+        for (int i = 0; i < 500; ++i) { g.run ([&count] { ++count; }); }
+        g.wait();
+        if (count != 500) {
+            std::cout << "count " << count << " != 500\n";
+            --rtn;
+        }
+    }
+
+    // A pool with no workers does everything in the waiting thread
+    {
+        morph::threadpool p0 (0);
+        long long s = 0;
+        p0.parallel_for (0, 100, [&s](int i) { s += i; });
+        morph::task_group g (p0);
+        g.run ([&s] { s += 1000; });
+        g.wait();
+        if (s != 5950) { --rtn; }
+    }
+
+    // morph::parallel_for runs on the shared pool, which the application can replace
+    {
+        morph::threadpool mine (2);
+        morph::threadpool::set_shared (&mine);
+        if (&morph::threadpool::shared() != &mine) { --rtn; }
+        std::vector<double> v (10000);
+        morph::parallel_for (std::size_t{0}, v.size(), [&v](std::size_t i) { v[i] = static_cast<double>(i); });
+        if (std::accumulate (v.begin(), v.end(), 0.0) != 9999.0 * 10000.0 / 2.0) { --rtn; }
+        morph::threadpool::set_shared (nullptr);
+    }
+
+    std::cout << "testthreadpool " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
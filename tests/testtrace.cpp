@@ -0,0 +1,85 @@
+// Test morph::trace: scopes on several threads are recorded, nest, and are written as valid
+// Chrome trace event JSON, including while other threads are still recording.
+
+#define MORPH_TRACE 1
+#include <morph/trace.h>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <cstdint>
+
+int main()
+{
+    int rtn = 0;
+    const std::string path = "./testtrace.json";
+
+    // Nothing is recorded before start()
+    { MORPH_TRACE_SCOPE ("before start"); }
+
+    morph::trace::start();
+    constexpr int nthreads = 3;
+    constexpr int nouter = 5000; // more than a chunk of events per thread
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back ([]() {
+            for (int i = 0; i < nouter; ++i) {
+                MORPH_TRACE_SCOPE ("outer");
+                { MORPH_TRACE_SCOPE_CAT ("inner", "test"); }
+                if (i % 1000 == 0) { MORPH_TRACE_COUNTER ("i", i); }
+            }
+        });
+    }
+    // A write while the threads record must still give whole events
+    morph::trace::write_json (path);
+    for (auto& th : threads) { th.join(); }
+    MORPH_TRACE_INSTANT ("joined");
+    morph::trace::stop();
+    { MORPH_TRACE_SCOPE ("after stop"); }
+    morph::trace::write_json (path);
+
+    nlohmann::json j;
+    {
+        std::ifstream f (path);
+        f >> j;
+    }
+    std::map<std::string, int> n;
+    std::map<std::uint32_t, int> outer_per_tid;
+    for (const auto& e : j["traceEvents"]) {
+        const std::string name = e["name"];
+        if (e["ph"] == "M") { continue; }
+        ++n[name];
+        if (name == "outer") { ++outer_per_tid[e["tid"].get<std::uint32_t>()]; }
+    }
+    if (n["outer"] != nthreads * nouter || n["inner"] != nthreads * nouter) {
+        std::cerr << n["outer"] << " outer and " << n["inner"] << " inner events\n"; --rtn;
+    }
+    if (outer_per_tid.size() != nthreads) { std::cerr << "Events on " << outer_per_tid.size() << " threads\n"; --rtn; }
+    if (n["i"] != nthreads * 5 || n["joined"] != 1) { std::cerr << "Counter or instant missing\n"; --rtn; }
+    if (n.count ("before start") || n.count ("after stop")) { std::cerr << "Recorded while stopped\n"; --rtn; }
+
+    // Within a thread, inner is recorded (closes) before the outer that contains it
+    const nlohmann::json* prev = nullptr;
+    for (const auto& e : j["traceEvents"]) {
+        if (e["name"] == "outer" && prev != nullptr && (*prev)["name"] == "inner" && (*prev)["tid"] == e["tid"]) {
+            const double ots = e["ts"], odur = e["dur"], its = (*prev)["ts"], idur = (*prev)["dur"];
+            if (its < ots || its + idur > ots + odur + 0.001) { std::cerr << "inner not within outer\n"; --rtn; break; }
+        }
+        prev = &e;
+    }
+
+    morph::trace::clear();
+    morph::trace::write_json (path);
+    {
+        std::ifstream f (path);
+        f >> j;
+        for (const auto& e : j["traceEvents"]) { if (e["ph"] != "M") { std::cerr << "clear() left events\n"; --rtn; break; } }
+    }
+    std::filesystem::remove (path);
+
+    std::cout << "testtrace " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,48 @@
+// Test the cached unit sphere meshes of morph::unit_sphere
+#include <cmath>
+#include <iostream>
+#include <morph/unit_sphere.h>
+
+// Every vertex on the unit sphere, every index in range
+int check (const morph::unit_sphere_mesh& m)
+{
+    int rtn = 0;
+    for (auto v : m.vertices) {
+        if (std::abs (v.length() - 1.0f) > 1e-5f) { --rtn; break; }
+    }
+    for (auto i : m.indices) {
+        if (i >= m.vertices.size()) { --rtn; break; }
+    }
+    if (m.indices.size() % 3 != 0) { --rtn; }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    for (int rings : { 2, 3, 10, 16 }) {
+        for (int segments : { 3, 12, 20 }) {
+            const morph::unit_sphere_mesh& m = morph::unit_sphere::uv (rings, segments);
+            rtn += check (m);
+            // Two caps and rings-1 rings; two triangles per segment per ring, less one at each cap
+            if (m.vertices.size() != static_cast<std::size_t>(2 + (rings - 1) * segments)) { --rtn; }
+            if (m.indices.size() != static_cast<std::size_t>(3 * 2 * (rings - 1) * segments)) { --rtn; }
+            // The same mesh comes back from the cache
+            if (&morph::unit_sphere::uv (rings, segments) != &m) { --rtn; }
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        const morph::unit_sphere_mesh& g = morph::unit_sphere::geodesic (i);
+        rtn += check (g);
+        const std::size_t T = std::size_t{1} << (2 * i);
+        if (g.vertices.size() != 10 * T + 2 || g.indices.size() != 3 * 20 * T) { --rtn; }
+        if (&morph::unit_sphere::geodesic (i) != &g) { --rtn; }
+        // float and double geodesics are cached separately
+        if (&morph::unit_sphere::geodesic<double> (i) == &g) { --rtn; }
+    }
+
+    std::cout << "testunit_sphere " << (rtn == 0 ? "passed" : "failed") << std::endl;
+    return rtn;
+}
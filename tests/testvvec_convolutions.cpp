@@ -1,4 +1,55 @@
 #include <morph/vvec.h>
+#include <morph/fft.h>
+#include <complex>
+#include <cmath>
+
+// The direct convolution sum, as in vvec::convolve, to check the FFT path against
+template <typename S>
+morph::vvec<S> direct_convolve (const morph::vvec<S>& d, const morph::vvec<S>& kernel, const bool wrap)
+{
+    int _n = d.size();
+    int kw = kernel.size();
+    int zki = kw%2 ? kw/2 : kw/2-1;
+    morph::vvec<S> rtn (_n, S{0});
+    for (int i = 0; i < _n; ++i) {
+        double sum = 0.0;
+        for (int j = 0; j < kw; ++j) {
+            int ii = i+j-zki;
+            ii += ii < 0 && wrap ? _n : 0;
+            ii -= ii >= _n && wrap ? _n : 0;
+            if (ii < 0 || ii >= _n) { continue; }
+            sum += double(d[ii]) * double(kernel[j]);
+        }
+        rtn[i] = S(sum);
+    }
+    return rtn;
+}
+
+// Compare vvec::convolve (which uses the FFT for wide kernels) with direct_convolve
+template <typename S>
+int check_fft_convolve (const unsigned int n, const unsigned int kw, const S tol)
+{
+    int rtn = 0;
+    morph::vvec<S> d (n);
+    d.randomize (S{-1}, S{1});
+    morph::vvec<S> k (kw);
+    k.randomize (S{0}, S{1});
+    for (auto wrap : { morph::vvec<S>::wrapdata::none, morph::vvec<S>::wrapdata::wrap }) {
+        const bool w = wrap == morph::vvec<S>::wrapdata::wrap;
+        morph::vvec<S> expct = direct_convolve (d, k, w);
+        morph::vvec<S> r = d.convolve (k, wrap);
+        S maxerr = (r - expct).abs().max();
+        if (maxerr > tol) {
+            std::cout << "FFT convolve n=" << n << " kw=" << kw << (w ? " wrap" : "")
+                      << " max error " << maxerr << " > " << tol << std::endl;
+            --rtn;
+        }
+        morph::vvec<S> ri = d;
+        ri.convolve_inplace (k, wrap);
+        if ((ri - expct).abs().max() > tol) { --rtn; }
+    }
+    return rtn;
+}
 
 int main()
 {
@@ -23,5 +74,36 @@ int main()
     if (r1 != r1expct) { rtn -= 1; }
     if (r2 != r2expct) { rtn -= 1; }
 
+    // FFT forward then inverse returns the input
+    std::vector<std::complex<double>> fa (256);
+    for (unsigned int i = 0; i < fa.size(); ++i) { fa[i] = std::complex<double>(std::sin (0.1 * i), 0.5 * i); }
+    std::vector<std::complex<double>> fb = fa;
+    morph::fft<double>::transform (fb.data(), fb.size(), false);
+    // The zero frequency term is the sum of the input
+    std::complex<double> fsum = 0.0;
+    for (auto c : fa) { fsum += c; }
+    if (std::abs (fb[0] - fsum) > 1e-9) { std::cout << "FFT DC term is wrong\n"; rtn -= 1; }
+    morph::fft<double>::transform (fb.data(), fb.size(), true);
+    for (unsigned int i = 0; i < fa.size(); ++i) {
+        if (std::abs (fa[i] - fb[i]) > 1e-10) { std::cout << "FFT round trip failed\n"; rtn -= 1; break; }
+    }
+
+    // The FFT path for wide kernels, odd and even widths, narrower and wider than the data
+    rtn += check_fft_convolve<double> (1000, 64, 1e-10);
+    rtn += check_fft_convolve<double> (1000, 201, 1e-10);
+    rtn += check_fft_convolve<double> (5000, 300, 1e-10);
+    rtn += check_fft_convolve<double> (100, 250, 1e-10);
+    rtn += check_fft_convolve<double> (1, 64, 1e-10);
+    rtn += check_fft_convolve<float> (3000, 129, 1e-3f);
+
+    // Gaussian smoothing with a wide kernel (2*6*20+1 elements) uses the FFT path
+    morph::vvec<double> g (2000);
+    g.randomize();
+    morph::vvec<double> gs = g.smooth_gauss (20.0, 6, morph::vvec<double>::wrapdata::wrap);
+    // Circular smoothing by a normalised kernel conserves the sum
+    if (std::abs (gs.sum() - g.sum()) > 1e-8) { std::cout << "smooth_gauss did not conserve the sum\n"; rtn -= 1; }
+    if (gs.std() >= g.std()) { rtn -= 1; }
+
+    if (rtn != 0) { std::cout << "testvvec_convolutions FAILED\n"; }
     return rtn;
 }
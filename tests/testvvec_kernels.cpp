@@ -0,0 +1,75 @@
+// Test the vectorised kernels used for floating point vvec arithmetic and reductions
+#include <morph/vvec.h>
+#include <iostream>
+#include <cmath>
+
+template <typename S>
+int test_kernels()
+{
+    int rtn = 0;
+    // Sizes either side of the pairwise block size, and one that needs a deep tree
+    for (std::size_t n : { 0ul, 1ul, 7ul, 127ul, 128ul, 129ul, 1000ul, 100003ul }) {
+        morph::vvec<S> a (n);
+        morph::vvec<S> b (n);
+        a.randomize();
+        b.randomize();
+        a -= S{0.5};
+
+        double sum = 0.0, dot = 0.0, sos = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += static_cast<double>(a[i]);
+            dot += static_cast<double>(a[i]) * static_cast<double>(b[i]);
+            sos += static_cast<double>(a[i]) * static_cast<double>(a[i]);
+        }
+        const double tol = 1e-5 * (1.0 + static_cast<double>(n));
+        if (std::abs (static_cast<double>(a.sum()) - sum) > tol) { std::cout << "sum wrong for n=" << n << std::endl; --rtn; }
+        if (std::abs (static_cast<double>(a.dot (b)) - dot) > tol) { std::cout << "dot wrong for n=" << n << std::endl; --rtn; }
+        if (std::abs (static_cast<double>(a.sos()) - sos) > tol) { std::cout << "sos wrong for n=" << n << std::endl; --rtn; }
+        if (n > 0 && std::abs (static_cast<double>(a.mean()) - sum / n) > 1e-5) { std::cout << "mean wrong for n=" << n << std::endl; --rtn; }
+
+        S mx = n > 0 ? a[0] : S{0};
+        for (auto ai : a) { mx = ai > mx ? ai : mx; }
+        if (a.max() != mx) { std::cout << "max wrong for n=" << n << std::endl; --rtn; }
+
+        morph::vvec<S> s = a + b;
+        morph::vvec<S> d = a - b;
+        morph::vvec<S> h = a * b;
+        morph::vvec<S> k = a * 3;
+        morph::vvec<S> c = a;
+        c += b;
+        c *= b;
+        c -= a;
+        for (std::size_t i = 0; i < n; ++i) {
+            if (s[i] != a[i] + b[i] || d[i] != a[i] - b[i] || h[i] != a[i] * b[i] || k[i] != a[i] * S{3}
+                || c[i] != (a[i] + b[i]) * b[i] - a[i]) {
+                std::cout << "element-wise op wrong at " << i << " for n=" << n << std::endl;
+                --rtn;
+                break;
+            }
+        }
+    }
+
+    // Pairwise summation is much more accurate than a running sum for many elements
+    morph::vvec<S> tenths (1000000, S{0.1});
+    const double exact = static_cast<double>(S{0.1}) * 1000000.0;
+    if (std::abs (static_cast<double>(tenths.sum()) - exact) > 1e-6 * exact) {
+        std::cout << "pairwise sum error too large: " << std::abs (static_cast<double>(tenths.sum()) - exact) << std::endl;
+        --rtn;
+    }
+    return rtn;
+}
+
+int main()
+{
+    int rtn = test_kernels<float>() + test_kernels<double>();
+
+    // Integer vvecs and differently typed operands still take the generic path
+    morph::vvec<unsigned char> uc (300, 10);
+    if (uc.sum<unsigned int>() != 3000u) { std::cout << "integer sum wrong\n"; --rtn; }
+    morph::vvec<float> f = { 1.0f, 2.0f, 3.0f };
+    morph::vvec<int> i = { 1, 2, 3 };
+    if (f.dot (i) != 14.0f) { std::cout << "mixed type dot wrong\n"; --rtn; }
+
+    std::cout << (rtn == 0 ? "PASS\n" : "FAIL\n");
+    return rtn;
+}
@@ -0,0 +1,58 @@
+// Test lazy (expression template) evaluation of vvec arithmetic
+#include <morph/vvec.h>
+#include <iostream>
+
+int main()
+{
+    int rtn = 0;
+
+    morph::vvec<float> a = { 1.0f, 2.0f, 3.0f, 4.0f };
+    morph::vvec<float> b = { 0.5f, -1.0f, 2.0f, 8.0f };
+    morph::vvec<float> c = { 3.0f, 3.0f, 3.0f, 3.0f };
+    morph::vvec<float> d = { -2.0f, 0.0f, 1.0f, 6.0f };
+    morph::vvec<float> e = { 1.0f, 1.0f, 2.0f, 2.0f };
+
+    // Compare a fused expression with the same expression made from temporaries
+    morph::vvec<float> eager = a * b + c * d - e;
+    morph::vvec<float> lazy = a.lazy() * b + c * d - e;
+    if (lazy != eager) { std::cout << "a * b + c * d - e: " << lazy << " != " << eager << std::endl; --rtn; }
+
+    // Scalars on either side, division and negation
+    eager = (a * 2.0f + 1.0f) / b - c;
+    lazy = (2.0f * a.lazy() + 1.0f) / b - c;
+    if (lazy != eager) { std::cout << "scalar expression: " << lazy << " != " << eager << std::endl; --rtn; }
+    eager = -a + b;
+    lazy = -a.lazy() + b;
+    if (lazy != eager) { std::cout << "negation: " << lazy << " != " << eager << std::endl; --rtn; }
+
+    // Assigning to a vvec that appears in the expression
+    morph::vvec<float> r = a;
+    r = r.lazy() * r + b;
+    if (r != a * a + b) { std::cout << "self assign: " << r << std::endl; --rtn; }
+
+    // Compound assignment
+    r = a;
+    r += b.lazy() * c;
+    r -= d.lazy() * 0.5f;
+    if (r != a + b * c - d * 0.5f) { std::cout << "compound ops: " << r << std::endl; --rtn; }
+
+    // A vvec is resized to take the result of an expression
+    morph::vvec<float> empty;
+    empty = a.lazy() + b;
+    if (empty.size() != 4u || empty != a + b) { std::cout << "resize on assign failed\n"; --rtn; }
+
+    // The element type of the target may differ from that of the expression
+    morph::vvec<double> dbl = a.lazy() * b;
+    if (dbl[3] != 32.0) { std::cout << "double target: " << dbl << std::endl; --rtn; }
+
+    // Mismatched sizes throw, as for the eager operators
+    morph::vvec<float> short_v = { 1.0f, 2.0f };
+    try {
+        morph::vvec<float> bad = a.lazy() + short_v;
+        std::cout << "Expected an exception for mismatched sizes\n";
+        --rtn;
+    } catch (const std::runtime_error&) {}
+
+    std::cout << (rtn == 0 ? "PASS\n" : "FAIL\n");
+    return rtn;
+}
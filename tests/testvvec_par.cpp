@@ -0,0 +1,105 @@
+// Test vvec::par(), the parallel versions of vvec's bulk operations, against the serial ones
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <cmath>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+template <typename S>
+int test_par (const int nthreads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads (nthreads);
+#endif
+    int rtn = 0;
+    // Below and above the default threshold, and sizes that split unevenly
+    for (std::size_t n : { 0ul, 1ul, 1000ul, 65536ul, 100003ul, 1234567ul }) {
+        morph::vvec<S> a (n);
+        morph::vvec<S> b (n);
+        a.randomize();
+        b.randomize();
+        a -= S{0.5};
+        b += S{0.5};
+
+        // The reductions are identical to the serial ones, bit for bit
+        if (a.par().sum() != a.sum()) { std::cout << "sum differs for n=" << n << std::endl; --rtn; }
+        if (a.par(0).sum() != a.sum()) { std::cout << "par(0) sum differs for n=" << n << std::endl; --rtn; }
+        if (a.par().sos() != a.sos()) { std::cout << "sos differs for n=" << n << std::endl; --rtn; }
+        if (a.par().dot (b) != a.dot (b)) { std::cout << "dot differs for n=" << n << std::endl; --rtn; }
+        if (n > 0 && a.par().mean() != a.mean()) { std::cout << "mean differs for n=" << n << std::endl; --rtn; }
+        if (a.par().max() != a.max() || a.par().min() != a.min()) { std::cout << "max/min differ for n=" << n << std::endl; --rtn; }
+        morph::range<S> r = a.par().range();
+        morph::range<S> rs = a.range();
+        if (r.min != rs.min || r.max != rs.max) { std::cout << "range differs for n=" << n << std::endl; --rtn; }
+
+        // Element-wise functions and arithmetic
+        if (b.par().sqrt() != b.sqrt() || b.par().exp() != b.exp() || b.par().log() != b.log()
+            || a.par().abs() != a.abs() || a.par().sq() != a * a) {
+            std::cout << "element-wise function differs for n=" << n << std::endl; --rtn;
+        }
+        if (a.par() + b != a + b || a.par() - b != a - b || a.par() * b != a * b || a.par() / b != a / b) {
+            std::cout << "vvec arithmetic differs for n=" << n << std::endl; --rtn;
+        }
+        if (a.par() * S{3} != a * S{3} || a.par() + S{2} != a + S{2}) {
+            std::cout << "scalar arithmetic differs for n=" << n << std::endl; --rtn;
+        }
+        if (a.par().threshold (S{-0.25}, S{0.25}) != a.threshold (S{-0.25}, S{0.25})) {
+            std::cout << "threshold differs for n=" << n << std::endl; --rtn;
+        }
+
+        // In place (with one element, rescale divides 0 by 0, serially too)
+        morph::vvec<S> c = a;
+        morph::vvec<S> cs = a;
+        c.par().rescale();
+        cs.rescale();
+        if (n != 1 && c != cs) { std::cout << "rescale differs for n=" << n << std::endl; --rtn; }
+        c.par().threshold_inplace (S{0.25}, S{0.75});
+        cs.threshold_inplace (S{0.25}, S{0.75});
+        c.par().exp_inplace();
+        cs.exp_inplace();
+        c.par() *= b;
+        cs *= b;
+        c.par() += S{1};
+        cs += S{1};
+        if (n != 1 && c != cs) { std::cout << "in place operations differ for n=" << n << std::endl; --rtn; }
+
+        // A vexpr evaluated in parallel, with the target in the expression
+        morph::vvec<S> e = a;
+        e.par() = e.lazy() * S{0.5} + a * b;
+        morph::vvec<S> es = a;
+        es = es.lazy() * S{0.5} + a * b;
+        if (e != es) { std::cout << "vexpr evaluation differs for n=" << n << std::endl; --rtn; }
+        morph::vvec<S> f;
+        f.par() = a.lazy() - b;
+        if (f != a - b) { std::cout << "vexpr into an empty vvec differs for n=" << n << std::endl; --rtn; }
+    }
+
+    // Different sizes are an error, as they are for the serial operators
+    morph::vvec<S> x (100000, S{1});
+    morph::vvec<S> y (100001, S{1});
+    try {
+        morph::vvec<S> z = x.par() + y;
+        std::cout << "Expected an exception from adding vvecs of different sizes\n"; --rtn;
+    } catch (const std::exception&) {}
+
+    // Integer and vec elements fall back to the serial methods
+    morph::vvec<int> vi (200000, 3);
+    if (vi.par().sum() != 600000 || vi.par().max() != 3) { std::cout << "int vvec wrong\n"; --rtn; }
+    const morph::vvec<morph::vec<float, 2>> vv (10, { 1.0f, 2.0f });
+    if (vv.par().sum() != morph::vec<float, 2>{ 10.0f, 20.0f }) { std::cout << "vvec of vecs wrong\n"; --rtn; }
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+    for (int t : { 1, 3, 4 }) {
+        rtn += test_par<float> (t);
+        rtn += test_par<double> (t);
+    }
+    std::cout << "testvvec_par " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
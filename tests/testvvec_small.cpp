@@ -0,0 +1,92 @@
+// Test morph::vvec_small, the vvec-like vector with inline storage
+#include <morph/vvec_small.h>
+#include <morph/vvec.h>
+#include <iostream>
+
+// True if v's elements are stored within v itself
+template <typename V>
+bool is_inline (const V& v)
+{
+    const char* d = reinterpret_cast<const char*>(v.data());
+    const char* o = reinterpret_cast<const char*>(&v);
+    return d >= o && d < o + sizeof (V);
+}
+
+template <typename S>
+int test_small()
+{
+    int rtn = 0;
+    using sv = morph::vvec_small<S, 8>;
+
+    morph::vvec<S> va = { S{1}, S{-2}, S{3}, S{0.5}, S{7} };
+    morph::vvec<S> vb = { S{2}, S{4}, S{-1}, S{3}, S{0.25} };
+    sv a (va);
+    sv b (vb);
+
+    // Results within the inline capacity are stored inline
+    sv c = a * S{2} + b;
+    c -= a;
+    c *= b;
+    sv d = c.abs().sqrt();
+    S dt = a.dot (b);
+    S s = c.sum();
+    S l = d.length();
+    sv e = std::move (d);
+    e.push_back (S{1});
+    e.pop_back();
+    if (!is_inline (c) || !is_inline (e) || a.on_heap() || e.on_heap()) { std::cout << "expected inline storage\n"; --rtn; }
+
+    // ...and matches vvec
+    morph::vvec<S> vc = va * S{2} + vb;
+    vc -= va;
+    vc *= vb;
+    if (c.as_vvec() != vc || s != vc.sum()) { std::cout << "arithmetic differs from vvec\n"; --rtn; }
+    if (dt != va.dot (vb) || l != vc.abs().sqrt().length()) { std::cout << "dot/length differ from vvec\n"; --rtn; }
+    if (e.as_vvec() != vc.abs().sqrt()) { std::cout << "moved inline vvec_small wrong\n"; --rtn; }
+    if (a.max() != va.max() || a.min() != va.min() || a.argmax() != va.argmax() || a.argmin() != va.argmin()) {
+        std::cout << "max/min differ from vvec\n"; --rtn;
+    }
+    if (a.mean() != va.mean() || a.sos() != va.sos()) { std::cout << "mean/sos differ from vvec\n"; --rtn; }
+    sv r = a;
+    morph::vvec<S> vr = va;
+    r.renormalize();
+    vr.renormalize();
+    if (r.as_vvec() != vr) { std::cout << "renormalize differs from vvec\n"; --rtn; }
+
+    // Growing past the capacity spills to the heap, keeping the elements
+    sv g = a;
+    for (int i = 0; i < 20; ++i) { g.push_back (static_cast<S>(i)); }
+    if (!g.on_heap() || is_inline (g) || g.size() != 25 || g[4] != S{7} || g.back() != S{19}) { std::cout << "spill to heap wrong\n"; --rtn; }
+    S* gp = g.data();
+    sv h = std::move (g);
+    if (h.data() != gp || !g.empty() || g.on_heap()) { std::cout << "move from the heap should take the storage\n"; --rtn; }
+    sv k = h;
+    if (k != h || k.data() == h.data()) { std::cout << "copy of heap vvec_small wrong\n"; --rtn; }
+    k.resize (3);
+    k = a;
+    if (k != a) { std::cout << "assign wrong\n"; --rtn; }
+
+    // Errors, as vvec
+    try {
+        sv z = a + g;
+        std::cout << "expected an exception from adding different sizes\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+    try {
+        a.at (5) = S{0};
+        std::cout << "expected an exception from at()\n"; --rtn;
+    } catch (const std::out_of_range&) {}
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = test_small<float>() + test_small<double>();
+
+    // Integer elements, with the default capacity
+    morph::vvec_small<int> vi = { 3, 1, 2 };
+    if (vi.sum() != 6 || vi.max() != 3 || vi.str() != "(3,1,2)") { std::cout << "int vvec_small wrong\n"; --rtn; }
+
+    std::cout << "testvvec_small " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
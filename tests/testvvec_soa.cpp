@@ -0,0 +1,97 @@
+// Test the structure-of-arrays container, morph::vvec_soa, against vvec<vec<T, N>>
+#include <morph/vvec_soa.h>
+#include <morph/vvec.h>
+#include <morph/vec.h>
+#include <iostream>
+#include <cmath>
+
+template <typename T>
+bool close (T a, T b) { return std::abs (a - b) <= T{8} * std::numeric_limits<T>::epsilon() * std::max (T{1}, std::abs (b)); }
+
+// Sums of many elements may be rounded differently
+template <typename T, std::size_t N>
+bool close (const morph::vec<T, N>& a, const morph::vec<T, N>& b) { return (a - b).length() <= T{1e-3} * std::max (T{1}, b.length()); }
+
+template <typename T, std::size_t N>
+bool close (const morph::vvec<morph::vec<T, N>>& a, const morph::vvec<morph::vec<T, N>>& b)
+{
+    if (a.size() != b.size()) { return false; }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        for (std::size_t k = 0; k < N; ++k) { if (!close (a[i][k], b[i][k])) { return false; } }
+    }
+    return true;
+}
+
+template <typename T>
+int test_soa()
+{
+    int rtn = 0;
+    const std::size_t n = 1001;
+    morph::vvec<morph::vec<T, 3>> a (n);
+    morph::vvec<morph::vec<T, 3>> b (n);
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i].randomize();
+        b[i].randomize();
+    }
+    a[7] = { T{0}, T{0}, T{0} }; // a zero vector, which renormalize leaves alone
+    a[500] = { T{3}, T{4}, T{12} }; // the longest
+
+    morph::vvec_soa<T, 3> sa (a);
+    morph::vvec_soa<T, 3> sb (b);
+
+    // Round trip and layout
+    if (sa.to_vvec() != a || sa.size() != n || sa[500] != a[500]) { std::cout << "round trip failed\n"; --rtn; }
+    if (sa.component (1)[500] != T{4} || sa.data()[2 * n + 500] != T{12}) { std::cout << "component layout wrong\n"; --rtn; }
+
+    // Per-vector kernels
+    morph::vvec<T> len = sa.lengths();
+    morph::vvec<T> dt = sa.dot (sb);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!close (len[i], a[i].length())) { std::cout << "length " << i << " wrong\n"; --rtn; break; }
+        if (!close (dt[i], a[i].dot (b[i]))) { std::cout << "dot " << i << " wrong\n"; --rtn; break; }
+    }
+    if (!close (len[500], T{13})) { std::cout << "length of (3,4,12) wrong\n"; --rtn; }
+    if (sa.arglongest() != 500 || sa.longest() != a.max() || sa.argshortest() != 7) { std::cout << "longest/shortest wrong\n"; --rtn; }
+
+    morph::vvec<morph::vec<T, 3>> cr (n);
+    for (std::size_t i = 0; i < n; ++i) { cr[i] = a[i].cross (b[i]); }
+    if (!close (sa.cross (sb).to_vvec(), cr)) { std::cout << "cross wrong\n"; --rtn; }
+
+    morph::vvec_soa<T, 3> sn = sa;
+    sn.renormalize();
+    morph::vvec<morph::vec<T, 3>> an = a;
+    for (auto& v : an) { v.renormalize(); }
+    if (!close (sn.to_vvec(), an) || sn[7] != morph::vec<T, 3>{}) { std::cout << "renormalize wrong\n"; --rtn; }
+
+    // Arithmetic
+    if (!close ((sa + sb).to_vvec(), a + b) || !close ((sa - sb).to_vvec(), a - b)) { std::cout << "+/- wrong\n"; --rtn; }
+    const morph::vec<T, 3> scl = { T{1}, T{2}, T{0.5} };
+    morph::vvec<morph::vec<T, 3>> as (n);
+    for (std::size_t i = 0; i < n; ++i) { as[i] = a[i] * scl; }
+    if (!close ((sa * scl).to_vvec(), as)) { std::cout << "component-wise scale wrong\n"; --rtn; }
+    if (!close ((sa * T{2}).to_vvec(), a * T{2}) || !close ((-sa).to_vvec(), -a)) { std::cout << "scalar arithmetic wrong\n"; --rtn; }
+    morph::vvec<T> per (n, T{3});
+    if (!close ((sa * per).to_vvec(), a * T{3})) { std::cout << "per-vector scale wrong\n"; --rtn; }
+    if (!close (sa.sum(), a.sum())) { std::cout << "sum wrong\n"; --rtn; }
+
+    // resize keeps the vectors that remain
+    morph::vvec_soa<T, 3> sr = sa;
+    sr.resize (10);
+    sr.resize (20, T{1});
+    if (sr[9] != a[9] || sr[19] != morph::vec<T, 3>{ T{1}, T{1}, T{1} }) { std::cout << "resize wrong\n"; --rtn; }
+
+    // Different sizes are an error
+    try {
+        sa += sr;
+        std::cout << "expected an exception\n"; --rtn;
+    } catch (const std::runtime_error&) {}
+
+    return rtn;
+}
+
+int main()
+{
+    int rtn = test_soa<float>() + test_soa<double>();
+    std::cout << "testvvec_soa " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}
@@ -0,0 +1,79 @@
+/*
+ * Test morph::Winder's batch point-in-polygon test. Winder::contains, with and without
+ * its edge bands, must agree with Winder::wind point by point, over a cortical outline
+ * read from an SVG file and over a clockwise, self-overlapping path.
+ */
+#include "morph/Winder.h"
+#include "morph/ReadCurves.h"
+#include "morph/BezCoord.h"
+#include "morph/Random.h"
+#include "morph/vec.h"
+#include "morph/vvec.h"
+#include "morph/mathconst.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+template <typename C>
+int check (const C& path, const morph::vvec<morph::vec<float, 2>>& pts, const int expect_max)
+{
+    int rtn = 0;
+    morph::Winder w (path);
+    const morph::vvec<int> wn1 = w.winding (pts, 1);
+    const morph::vvec<int> wnb = w.winding (pts);
+    const morph::vvec<int> in = w.contains (pts, 7);
+    unsigned int ninside = 0;
+    int wmax = 0;
+    for (std::size_t i = 0; i < pts.size(); ++i) {
+        int ws = 0;
+        if constexpr (std::is_same_v<typename C::value_type, morph::BezCoord<float>>) {
+            ws = w.wind (morph::BezCoord<float>(pts[i]));
+        } else {
+            ws = w.wind (pts[i]);
+        }
+        if (wn1[i] != ws || wnb[i] != ws || in[i] != (ws != 0 ? 1 : 0)) { --rtn; }
+        ninside += ws != 0 ? 1 : 0;
+        wmax = std::max (wmax, std::abs (ws));
+    }
+    if (wmax != expect_max) { std::cerr << "Greatest winding number " << wmax << ", expected " << expect_max << "\n"; --rtn; }
+    std::cout << ninside << " of " << pts.size() << " points inside\n";
+    return rtn;
+}
+
+int main()
+{
+    int rtn = 0;
+
+    morph::ReadCurves r ("../../tests/trial.svg");
+    morph::BezCurvePath<float> cp = r.getCorticalPath();
+    cp.computePoints (0.01f, true);
+    std::vector<morph::BezCoord<float>> outline = cp.getPoints();
+    if (outline.size() < 100) { std::cerr << "Too few outline points\n"; return -1; }
+    float xmin = 1e9f, xmax = -1e9f, ymin = 1e9f, ymax = -1e9f;
+    for (const auto& b : outline) {
+        xmin = std::min (xmin, b.x()); xmax = std::max (xmax, b.x());
+        ymin = std::min (ymin, b.y()); ymax = std::max (ymax, b.y());
+    }
+
+    morph::RandUniform<float> rx (xmin - 0.1f, xmax + 0.1f, 17);
+    morph::RandUniform<float> ry (ymin - 0.1f, ymax + 0.1f, 18);
+    morph::vvec<morph::vec<float, 2>> pts (50000);
+    for (auto& p : pts) { p = { rx.get(), ry.get() }; }
+    // Include some of the outline's own vertices
+    for (std::size_t i = 0; i < outline.size(); i += 10) { pts.push_back ({ outline[i].x(), outline[i].y() }); }
+    rtn += check (outline, pts, 1);
+
+    // A circle traced twice, clockwise, winds -2 about its inside points
+    std::vector<morph::vec<float, 2>> twice;
+    for (int i = 0; i < 720; ++i) {
+        const float phi = -morph::mathconst<float>::two_pi * i / 360.0f;
+        twice.push_back ({ std::cos (phi), std::sin (phi) });
+    }
+    morph::RandUniform<float> rc (-1.5f, 1.5f, 19);
+    morph::vvec<morph::vec<float, 2>> cpts (20000);
+    for (auto& p : cpts) { p = { rc.get(), rc.get() }; }
+    rtn += check (twice, cpts, 2);
+
+    std::cout << "Test " << (rtn == 0 ? "PASSED" : "FAILED") << std::endl;
+    return rtn;
+}